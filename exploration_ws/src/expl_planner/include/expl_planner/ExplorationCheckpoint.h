@@ -0,0 +1,111 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef EXPLORATION_CHECKPOINT_H_
+#define EXPLORATION_CHECKPOINT_H_
+
+#include <string>
+#include <vector>
+
+#include <eigen3/Eigen/StdVector>
+#include <eigen3/Eigen/Dense>
+#include <eigen3/Eigen/Geometry>
+
+#include <ros/ros.h>
+
+#include "PriorityQueue.h"
+
+
+namespace explplanner{
+
+///	\class ExplorationCheckpoint
+///	\author Luigi Freda
+///	\brief Exploration state which is saved on disk during the mission and restored at the next start, in order to 
+///        resume the exploration after a node restart instead of exploring again from scratch:  
+///        - the nodes of the exploration tree (the visited view points, used for backtracking) and the current one; 
+///        - the nodes of the frontier tree (the frontier set collected along the mission); 
+///        - the priority points;  
+///        - the pose of the map frame w.r.t. a fixed frame (optional) at save time, in order to align the restored 
+///          state with the current map frame when the map origin changed across the restart (see transform()).
+///        The octomap is saved in a separate binary file (see ExplorationPlanner::writeOctomap()). 
+///        The checkpoint is a text file; it is first written to a temporary file which is then renamed, hence a crash 
+///        while saving leaves the previous checkpoint untouched. 
+///	\note the team data are not saved: they expire in a few seconds (see TeamModel) and the teammates resend them 
+/// \todo 
+///	\date
+///	\warning
+class ExplorationCheckpoint
+{
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    
+    static const int kVersion; // file format version 
+    static const std::string kOctomapFilename; 
+    static const std::string kStateFilename; 
+    
+    struct TreeNode
+    {
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+        
+        TreeNode():id(0), parent_id(-1), state(Eigen::Vector4d::Zero()), gain(0), local_gain(0), is_frontier(false) {}
+        
+        int id; 
+        int parent_id; // -1 for the root 
+        Eigen::Vector4d state; // [x, y, z, yaw]
+        double gain; 
+        double local_gain; 
+        bool is_frontier; 
+    };
+    typedef std::vector<TreeNode, Eigen::aligned_allocator<TreeNode> > TreeNodes; 
+    
+public:
+    
+    ExplorationCheckpoint();
+    
+    void clear();
+    
+    // write the checkpoint in filename (atomically replaced) 
+    bool save(const std::string& filename) const;
+    // read the checkpoint from filename; returns false (and clears the checkpoint) if the file is missing or not valid 
+    bool load(const std::string& filename);
+    
+    // move the tree nodes and the priority points by the rigid transform T_new_old (the yaw of the nodes is rotated 
+    // by the yaw of T_new_old) and update T_fixed_map accordingly 
+    void transform(const Eigen::Affine3d& T_new_old);
+    
+public:
+    
+    ros::Time stamp; // save time 
+    
+    std::string map_frame; 
+    std::string fixed_frame; // empty if the alignment is disabled 
+    Eigen::Affine3d T_fixed_map; // pose of map_frame w.r.t. fixed_frame at save time 
+    
+    TreeNodes expl_tree_nodes; // parents before children, root first 
+    int expl_tree_current_id; 
+    
+    TreeNodes frontier_tree_nodes; // sorted by increasing id (insertion order), root first 
+    
+    std::vector<PriorityPointQueue::PriorityPoint> priority_points; 
+};
+
+} // namespace explplanner
+
+#endif // EXPLORATION_CHECKPOINT_H_
@@ -0,0 +1,118 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef EXPLORATION_CLOUD_ROUTER_H_
+#define EXPLORATION_CLOUD_ROUTER_H_
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/core/noncopyable.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <ros/ros.h>
+#include <sensor_msgs/PointCloud2.h>
+
+
+namespace explplanner{
+
+///	\class ExplorationCloudRouter
+///	\author Luigi Freda
+///	\brief Routes the teammate point clouds toward the volumetric mapping of this robot ("/volumetric_mapping/pointcloud2").
+///        Each teammate (source) has:
+///        - a rate limit ("max_rate" [Hz], overridable per robot with "<robot_name>/max_rate", 0 = unlimited) on the message stamps;
+///        - deduplication: a cloud whose stamp is not newer than the last accepted one of the same source is dropped
+///          (e.g. a scan received twice through the multimaster synch);
+///        - a bounded queue ("queue_size") which drops its oldest clouds when the routing thread falls behind.
+///        The routing thread serves the queues round-robin, so a chatty teammate cannot starve the others, and optionally
+///        voxel-downsamples the clouds ("voxel_size" [m], 0 = off). Without downsampling the received clouds are republished
+///        by pointer: in a nodelet manager they are forwarded to the mapping nodelets without any copy.
+///	\note
+/// \todo
+///	\date
+///	\warning
+class ExplorationCloudRouter: private boost::noncopyable
+{
+public:
+
+    static const int kMaxNumberOfRobots;
+
+public:
+
+    ExplorationCloudRouter(const ros::NodeHandle& nh, const ros::NodeHandle& nh_private);
+    ~ExplorationCloudRouter();
+
+protected:
+
+    struct Source
+    {
+        Source():robot_id(-1), min_period(0), num_received(0), num_dropped(0) {}
+
+        int robot_id;
+        std::string robot_name;
+        double min_period; // [s] minimum time between two accepted clouds (0 = no rate limit)
+        ros::Time last_stamp;  // stamp of the last accepted cloud
+
+        ros::Subscriber sub;
+        std::deque<sensor_msgs::PointCloud2::ConstPtr> queue;
+
+        size_t num_received;
+        size_t num_dropped;    // duplicated, throttled or pushed out of the queue
+    };
+
+    void addSource(int robot_id, const std::string& topic_name);
+
+    void pointCloudCallback(const sensor_msgs::PointCloud2::ConstPtr& pointcloud_msg, Source* source);
+
+    void routingLoop();
+
+    // returns the input cloud if voxel_size_ <= 0
+    sensor_msgs::PointCloud2::ConstPtr downsample(const sensor_msgs::PointCloud2::ConstPtr& pointcloud_msg) const;
+
+protected:
+
+    ros::NodeHandle nh_;
+    ros::NodeHandle nh_private_;
+
+    std::string robot_name_;
+    int robot_id_;
+
+    double max_rate_;    // [Hz] default rate limit of each source (0 = unlimited)
+    int queue_size_;     // max number of clouds waiting in the queue of each source
+    double voxel_size_;  // [m] leaf size of the voxel downsampling (0 = off)
+
+    ros::Publisher dynamic_cloud_router_pub_;
+
+    std::vector<boost::shared_ptr<Source> > sources_;
+    size_t next_source_;  // round-robin index of the routing thread
+
+    boost::mutex queue_mutex_;
+    boost::condition_variable queue_cond_;
+    bool b_stop_;
+    boost::thread routing_thread_;
+};
+
+} // namespace explplanner
+
+#endif // EXPLORATION_CLOUD_ROUTER_H_
@@ -51,6 +51,7 @@ class ExplorationMarkerController
     static const float kTextMessageHeight; 
     static const float kTextMessageVerticalOffset; 
     static const float kPoseUpdatePeriod; 
+    static const float kPoseUpdateMinDistance; // [m] the marker pose is not sent to the server for smaller robot displacements 
     
 public:
     
@@ -72,6 +73,12 @@ public:
         
     Transform transform_robot_; 
     
+    bool b_marker_pose_sent_; 
+    geometry_msgs::Pose last_marker_pose_;  // last pose sent to the marker server 
+    bool b_marker_color_sent_; 
+    Color last_marker_color_;       // last color sent to the marker server 
+    std::string last_marker_text_;  // last text sent to the marker server 
+    
 public: 
     ExplorationMarkerController(const tf::Vector3& p0, 
                      const ros::NodeHandle& nh,
@@ -44,6 +44,8 @@
 #include <eigen3/Eigen/StdVector>
 #include <eigen3/Eigen/Dense>
 
+#include "MarkerArrayDiffPublisher.h"
+
 namespace explplanner {
 
     
@@ -65,6 +67,10 @@ public:
   double igUnmapped_;
   double igArea_;
   double gainRange_;
+  bool bGainRaycast_; // compute the gain with the ray-cast engine (spherical grid of rays) instead of visiting the whole cube 
+  bool bCacheFrontierGains_; // recompute the gain of a frontier node only if the octomap changed within its gain region 
+  int gainNumThreads_; // number of threads for computing the gains of the search tree nodes (1: each gain is computed when its node is added)
+  bool bGainSnapshot_; // compute the cube gains of a batch of nodes on a dense snapshot of the octomap (instead of searching the octree for each voxel) 
   double degressiveCoeff_;
   double zero_gain_;
 
@@ -72,6 +78,8 @@ public:
   double dyaw_max_;
   double dOvershoot_;
   double extensionRange_;
+  bool bReuseTree_; // re-root the search tree of the previous planning step at the new root instead of rebuilding it 
+  double reuseTreeRadius_; // [m] nodes of the previous search tree farther than this from the new root are pruned 
   int numEdgeSteps_; 
   double explStep_;   
   double explStepBacktracking_;   
@@ -88,15 +96,18 @@ public:
   double maxZ_;
   bool softBounds_;
   Eigen::Vector3d boundingBox_;
+  bool bUseEsdf_; // check the collisions of the search tree edges in the voxblox ESDF map (esdfMapTopic_) instead of the octomap 
+  std::string esdfMapTopic_; 
 
   double meshResolution_;
 
   ros::Publisher inspectionPathPub_;
-  ros::Publisher explorationPathPub_;
+  MarkerArrayDiffPublisher::Ptr explorationPathPub_; // the tree marker arrays are published as deltas 
   ros::Publisher explorationNodesPub_;  
-  ros::Publisher explorationFrontierTreePub_;
-  ros::Publisher explorationFrontierClustersPub_;  
-  ros::Publisher explorationNavTreePub_;    
+  MarkerArrayDiffPublisher::Ptr explorationFrontierTreePub_;
+  MarkerArrayDiffPublisher::Ptr explorationFrontierClustersPub_;  
+  MarkerArrayDiffPublisher::Ptr explorationNavTreePub_;    
+  double vizDecimationDistance_; // [m] the tree markers farther than this from the robot are decimated (0 = off) 
   
   std::string navigationFrame_;
 
@@ -114,9 +125,21 @@ public:
   bool bDownSampleTraversability_;
   double downsampleTravResolution_; 
   
+  bool bUseNeighborhoodGraph_; // precompute the neighborhood graph of the traversability cloud (used when it is not cropped)
+
+  bool bAsyncMapIntegration_; // integrate the scans in a dedicated thread (the rays are cast without locking the octomap) 
+  int mapIntegrationQueueSize_; // maximum number of scans waiting for the integration thread (the oldest ones are dropped) 
+  
   double conflictDistance_; 
+  bool bCheckPathConflicts_; // a goal close to the path of a teammate with a shorter plan is also a conflict 
   
   double frontierClusteringRadius_;
+  
+  bool bCheckpoint_; // periodically save the exploration state (octomap, exploration/frontier trees, priority points) 
+  std::string checkpointDir_; // relative to ~/.ros; a sub-folder is created for each robot 
+  double checkpointPeriod_; // [s] 
+  bool bRestoreCheckpoint_; // restore the saved exploration state at the first planning step 
+  std::string checkpointFixedFrame_; // frame (fixed across restarts) used for aligning the restored state with the map frame (empty = no alignment) 
 };
 
 }
@@ -28,10 +28,15 @@
 #include <math.h>
 #include <limits>
 #include <algorithm>
+#include <map>
+#include <deque>
 
 #include <eigen3/Eigen/StdVector>
 
 #include <boost/thread/recursive_mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/core/noncopyable.hpp>
 
@@ -56,12 +61,15 @@
 #include <ros/ros.h>
 #include <sensor_msgs/PointCloud2.h>
 
+#include <exploration_msgs/ExplorationOctomapDelta.h>
+
 #include <path_planner/KdTreeFLANN.h>
 #include <path_planner/CostFunction.h>
+#include <path_planner/NeighborhoodGraph.h>
 
 #include <octomap_world/octomap_manager.h>
-#include <kdtree/kdtree.h>
 #include "Tree.h"
+#include "ExplorationCheckpoint.h"
 
 
 #define USE_MAP_SYNC 1
@@ -159,16 +167,27 @@ public:
     
     void insertOtherUgvPointcloudWithTf(const sensor_msgs::PointCloud2::ConstPtr& pointcloud); 
     
-    void mapMessageOverlapCheck(const geometry_msgs::PoseArray& message, std::vector<sensor_msgs::PointCloud2::Ptr>& cloudsToSend);
+    void mapMessageOverlapCheck(const geometry_msgs::PoseArray& message, std::vector<sensor_msgs::PointCloud2::ConstPtr>& cloudsToSend);
+    void getScheduledMapSyncClouds(std::vector<std::pair<int, sensor_msgs::PointCloud2::ConstPtr> >& cloudsToSend);
+
+    // octree-diff map sync: the leaves updated by the own scans after the last map version acknowledged by the teammate (the whole map if none)
+    void getOctomapDeltaMessage(int toRobotId, exploration_msgs::ExplorationOctomapDelta& message);
+    // merge a teammate delta into the octomap; return false if it is not compatible with the map
+    bool insertOctomapDeltaMessage(const exploration_msgs::ExplorationOctomapDelta& message);
+    void setOctomapDeltaAck(int fromRobotId, uint64_t version);
 
 public: // setters     
     
     // set the input
     // N.B: first setInput(), then you can set setGoal() and set2DUtility()
-    void setInput(pcl::PointCloud<pcl::PointXYZI>& noWall_in, pcl::PointCloud<pcl::PointXYZRGBNormal>& wall_in,
-                   pp::KdTreeFLANN<pcl::PointXYZRGBNormal>& wallKdTree_in, KdTreeFLANN& noWallKdTree_in, int start_point_idx_in);
+    void setInput(const pcl::PointCloud<pcl::PointXYZI>& noWall_in, const pcl::PointCloud<pcl::PointXYZRGBNormal>& wall_in,
+                   const pp::KdTreeFLANN<pcl::PointXYZRGBNormal>& wallKdTree_in, const KdTreeFLANN& noWallKdTree_in, int start_point_idx_in);
 
-    void set2DUtility(pcl::PointCloud<pcl::PointXYZI>& utility_pcl);
+    void set2DUtility(const pcl::PointCloud<pcl::PointXYZI>& utility_pcl);
+    
+    // set the precomputed neighborhood graph of the traversability cloud; it replaces the kd-tree radius search in findNeighbors()
+    // N.B: call it after setInput(); the graph is discarded if it was not built on the input traversability cloud with the expected parameters
+    void setNeighborhoodGraph(const NeighborhoodGraph::ConstPtr& graph);
         
     //set the exploration bias position
     bool setExplorationBias(pcl::PointXYZI& bias_in, bool bUseIt);
@@ -204,6 +223,9 @@ public: // getters
     
     ExplorationStepType getExplorationStepType() const { return explorationStepType_; }
     
+    // number of nodes expanded on the traversability map by the last planning step 
+    size_t getNumExpandedNodes() const { return nodes_.size(); }
+    
     const ExplParams& getParams() const { return params_; }
 
     void getMapSyncMessage(geometry_msgs::PoseArray& message);
@@ -212,6 +234,18 @@ public: // other utils
     
     void publishPlannedExplorationNode();    
     
+public: // checkpoint 
+    
+    // fill the tree nodes of the checkpoint with the exploration and frontier trees 
+    void getCheckpoint(ExplorationCheckpoint& checkpoint);
+    // rebuild the exploration and frontier trees from the checkpoint (which must be already aligned with the current map frame) 
+    void restoreCheckpoint(const ExplorationCheckpoint& checkpoint);
+    
+    // write the octomap in a binary file (atomically replaced)
+    bool writeOctomap(const std::string& filename);
+    // load the octomap from a binary file and move it by T_new_old (if it is not the identity)
+    bool loadOctomap(const std::string& filename, const Eigen::Affine3d& T_new_old);
+    
 public: // static functions 
     
     //Return the value of the euclidian distance between p1 and p2
@@ -254,6 +288,8 @@ private: // private data
     pcl::PointCloud<pcl::PointXYZI> pcl_traversability_;
     //Kd tree representation of the point cloud noWall
     KdTreeFLANN kdtree_traversability_;
+    //Precomputed neighborhood graph of the point cloud noWall (optional, shared)
+    NeighborhoodGraph::ConstPtr p_neighborhood_graph_;
     
     bool b_utility_2d_available_; 
     pcl::PointCloud<pcl::PointXYZI> pcl_utility_2d_; // [x,y,u(x,y),var(x,y)] we assume that pcl_2d_utility_ must contain info about the points in pcl_traversability_
@@ -286,6 +322,7 @@ private: // private data
       
     ExplParams params_;
     std::shared_ptr<volumetric_mapping::OctomapManager> p_octomap_manager_; 
+    std::shared_ptr<EsdfMapAdapter> p_esdf_map_; // optional ESDF map for the collision checks of the search tree (params_.bUseEsdf_)
     
     
     std::shared_ptr<RrtTree> p_search_tree_; // this data-structure is used for 
@@ -305,6 +342,8 @@ private: // private data
 
     std::shared_ptr<ScanHistoryManager> p_scan_history_manager_; 
 
+    std::map<int, uint64_t> octomap_delta_acked_versions_; // teammate id -> last acknowledged version of the own map
+
     ExplorationStepType explorationStepType_; 
     
 private:     
@@ -319,6 +358,13 @@ private:
     pcl::PointCloud<pcl::PointXYZ>::Ptr last_integrated_pointcloud_;     
 
     double last_pcl_stamp_ = std::numeric_limits<double>::lowest();
+
+    // asynchronous scan integration (see params_.bAsyncMapIntegration_)
+    boost::thread map_integration_thread_;
+    boost::mutex map_integration_mutex_;
+    boost::condition_variable map_integration_cond_;
+    std::deque<sensor_msgs::PointCloud2::ConstPtr> map_integration_queue_; // the accepted scans waiting for the integration (the oldest in front)
+    bool b_stop_map_integration_ = false;
         
 private: // private functions 
     
@@ -331,6 +377,11 @@ private: // private functions
     bool setParams();
     
     void insertPointcloudWithTf(const sensor_msgs::PointCloud2::ConstPtr& pointcloud);    
+    
+    // integrate a scan accepted by insertPointcloudWithTf() into the octomap
+    void integratePointcloud(const sensor_msgs::PointCloud2::ConstPtr& pointcloud);
+    // loop of the integration thread: integrate the queued scans
+    void mapIntegrationLoop();
 
     // Find the best node
     bool findNextNode();
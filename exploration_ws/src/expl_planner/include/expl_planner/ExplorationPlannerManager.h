@@ -31,6 +31,7 @@
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/recursive_mutex.hpp>
 #include <boost/core/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include <path_planner/Transform.h>
 
@@ -39,10 +40,64 @@
 #include "ExplorationPlanner.h"
 #include "PriorityQueue.h"
 #include "TeamModel.h"
+#include "VoxelBucketIndex.h"
 
 namespace explplanner{
 
 
+///	\class MapSnapshot
+///	\author Luigi Freda
+///	\brief Immutable snapshot of an input map of the ExplorationPlannerManager. 
+///        Each map callback builds a new snapshot and swaps it in with boost::atomic_store(), the planner takes the 
+///        snapshots with boost::atomic_load() at the start of a planning step. Hence, the callbacks never wait for the 
+///        planner and the planner works on a consistent set of maps for the whole step.  
+///	\note the cloud (and the kd-tree of the wall snapshot) must not be modified once the snapshot is published 
+/// \todo 
+///	\date
+///	\warning
+template<typename PointT>
+struct MapSnapshot
+{
+    typedef boost::shared_ptr<const MapSnapshot<PointT> > ConstPtr;
+    
+    typename pcl::PointCloud<PointT>::ConstPtr pcl;
+};
+
+typedef MapSnapshot<pcl::PointXYZI> Utility2DSnapshot; // [x,y,u(x,y),var(x,y)] 
+
+struct TraversabilitySnapshot : public MapSnapshot<pcl::PointXYZI>
+{
+    typedef boost::shared_ptr<const TraversabilitySnapshot> ConstPtr;
+    
+    VoxelBucketIndex<pcl::PointXYZI> index; // built on pcl, used for cropping both pcl and its utility cloud 
+};
+
+struct WallSnapshot : public MapSnapshot<pcl::PointXYZRGBNormal>
+{
+    typedef boost::shared_ptr<const WallSnapshot> ConstPtr;
+    
+    pp::KdTreeFLANN<pcl::PointXYZRGBNormal> kdtree;  // built on pcl 
+};
+
+///	\class TraversabilityGraph
+///	\author Luigi Freda
+///	\brief Neighborhood graph of the full cloud of a traversability snapshot. It is shared by the planning thread and 
+///        by the batch path-cost queries (see ExplorationPlannerManager::computePathCosts()) with boost::atomic_load() 
+///        and boost::atomic_store(), like the map snapshots. 
+///	\note the kd-tree is only built when a path-cost query needs it (the planning thread uses its own kd-tree) 
+/// \todo 
+///	\date
+///	\warning
+struct TraversabilityGraph
+{
+    typedef boost::shared_ptr<const TraversabilityGraph> ConstPtr;
+    
+    TraversabilitySnapshot::ConstPtr traversability; // the graph is built on traversability->pcl 
+    NeighborhoodGraph::ConstPtr graph; 
+    boost::shared_ptr<const ExplorationPlanner::KdTreeFLANN> kdtree; // built on traversability->pcl (can be null) 
+};
+
+
 ///	\class ExplorationPlannerManager
 ///	\author Luigi Freda
 ///	\brief Path planner for a single segment (start point,goal point)
@@ -70,6 +125,12 @@ public:
     
     static const double kDistanceThForRemovingPriorityPoint; // [m]
     
+    static const float kCropIndexBucketSize; // [m] size of the buckets of the traversability index used for cropping 
+    
+    static const float kMaxPathCostGoalDistance; // [m] max distance of a goal from the traversability map for computePathCosts()
+    
+    static const int kCheckpointMaxNumRestoreAttempts; // max number of planning steps waiting for the alignment transform of the checkpoint 
+    
     //static const float kTaskCallbackPeriod;  // [s] the duration period of the task callback 
     
     enum CropBoxMethod
@@ -115,6 +176,15 @@ public:
     
     void insertOtherUgvPointcloudWithTf(const sensor_msgs::PointCloud2::ConstPtr& pointcloud);
     
+    // compute the lengths [m] of the shortest paths from start to all the goals on the traversability map, with a single 
+    // Dijkstra sweep over the neighborhood graph of the full map (instead of a path planner query per goal); 
+    // costs[i] = -1 if goals[i] is not reachable or (when max_cost > 0) its path is longer than max_cost; 
+    // it does not lock expl_planner_mutex_, so it can be called while the planning thread is working; 
+    // returns false if the traversability map is not available or start is not on it 
+    bool computePathCosts(const pcl::PointXYZI& start, const std::vector<pcl::PointXYZI>& goals, std::vector<double>& costs, double max_cost = -1);
+    // as above, with start = current robot position 
+    bool computePathCostsFromRobot(const std::vector<pcl::PointXYZI>& goals, std::vector<double>& costs, double max_cost = -1);
+    
     void insertPriorityPoint(int id, const geometry_msgs::Point& point, int priority);
     void removePriorityPoint(int id);    
     void clearPriorityPointQueue(); 
@@ -143,8 +213,7 @@ public: /// < setters
     
     void setNo2DUtility()
     {
-        boost::recursive_mutex::scoped_lock wall_locker(utility_2d_mutex_);
-        b_utility_2d_info_available_ = false;
+        boost::atomic_store(&utility_2d_snapshot_, Utility2DSnapshot::ConstPtr());
     }
     
     void setCostFunctionType(int type, double lamda_trav = 1, double lambda_aux_utility = 1);
@@ -165,7 +234,12 @@ public: /// < setters
     
     void resetSelectedBackTrackingCluster() { p_expl_planner_->resetSelectedBackTrackingCluster(); }
 
-    void mapMessageOverlapCheck(const geometry_msgs::PoseArray& message, std::vector<sensor_msgs::PointCloud2::Ptr>& cloudsToSend);
+    void mapMessageOverlapCheck(const geometry_msgs::PoseArray& message, std::vector<sensor_msgs::PointCloud2::ConstPtr>& cloudsToSend);
+    void getScheduledMapSyncClouds(std::vector<std::pair<int, sensor_msgs::PointCloud2::ConstPtr> >& cloudsToSend) { p_expl_planner_->getScheduledMapSyncClouds(cloudsToSend); }
+
+    void getOctomapDeltaMessage(int toRobotId, exploration_msgs::ExplorationOctomapDelta& message) { p_expl_planner_->getOctomapDeltaMessage(toRobotId, message); }
+    bool insertOctomapDeltaMessage(const exploration_msgs::ExplorationOctomapDelta& message) { return p_expl_planner_->insertOctomapDeltaMessage(message); }
+    void setOctomapDeltaAck(int fromRobotId, uint64_t version) { p_expl_planner_->setOctomapDeltaAck(fromRobotId, version); }
     
 public: /// < getters 
     
@@ -199,29 +273,56 @@ public:
     
 protected:    
    
+    // get the indices of the traversability points in the crop box centered in start; 
+    // returns false if all the points are taken (kCropBoxTakeAll) and the indices are not filled 
+    static bool getCropIndices(const CropBoxMethod& crop_box_method, const pcl::PointXYZI& start, 
+                               const TraversabilitySnapshot& traversability, std::vector<int>& indices);
+    
+    // crop the traversability cloud; with kCropBoxTakeAll, pcl_out shares the cloud of the snapshot (no copy) 
     static void cropPcl(const CropBoxMethod& crop_box_method, const pcl::PointXYZI& start, 
-                        const pcl::PointCloud<pcl::PointXYZI>::Ptr pcl_in, 
-                        pcl::PointCloud<pcl::PointXYZI>::Ptr pcl_out);
+                        const TraversabilitySnapshot::ConstPtr& traversability, 
+                        pcl::PointCloud<pcl::PointXYZI>::ConstPtr& pcl_out);
+    // crop the traversability cloud and its utility cloud with the same indices; with kCropBoxTakeAll, the outputs share the snapshot clouds
     static bool cropTwoPcls(const CropBoxMethod& crop_box_method, const pcl::PointXYZI& start, 
-                            const pcl::PointCloud<pcl::PointXYZI>::Ptr pcl_in, 
-                            const pcl::PointCloud<pcl::PointXYZI>::Ptr pcl_in2,
-                            pcl::PointCloud<pcl::PointXYZI>::Ptr pcl_out, 
-                            pcl::PointCloud<pcl::PointXYZI>::Ptr pcl_out2);
+                            const TraversabilitySnapshot::ConstPtr& traversability, 
+                            const Utility2DSnapshot::ConstPtr& utility_2d,
+                            pcl::PointCloud<pcl::PointXYZI>::ConstPtr& pcl_out, 
+                            pcl::PointCloud<pcl::PointXYZI>::ConstPtr& pcl_out2);
     
 protected:
     
     double computePathLength(nav_msgs::Path& path);
     
+    // is the utility snapshot built on the points of the traversability snapshot? 
+    static bool isUtility2DConsistent(const TraversabilitySnapshot::ConstPtr& traversability, const Utility2DSnapshot::ConstPtr& utility_2d); 
+    
+    // get the neighborhood graph of the input traversability cloud (null if the cloud is cropped or the graph is disabled); 
+    // the graph of the full map is built once per traversability snapshot 
+    NeighborhoodGraph::ConstPtr getNeighborhoodGraph(const CropBoxMethod& crop_box_method, 
+                                                     const TraversabilitySnapshot::ConstPtr& traversability, 
+                                                     const pcl::PointCloud<pcl::PointXYZI>& traversability_pcl, 
+                                                     const ExplorationPlanner::KdTreeFLANN& traversability_kdtree);
+    
+    // get the graph of the full map of the input snapshot, with its kd-tree; built once per traversability snapshot 
+    TraversabilityGraph::ConstPtr getTraversabilityGraphWithKdTree(const TraversabilitySnapshot::ConstPtr& traversability);
+    
+protected: // checkpoint 
+    
+    // folder of the checkpoint of this robot (relative to ~/.ros)
+    std::string getCheckpointPath() const; 
+    
+    // save the octomap and the exploration state (see ExplorationCheckpoint) 
+    bool saveCheckpoint();
+    // restore the saved octomap and exploration state, aligned with the current map frame by using the fixed frame of the checkpoint (if any); 
+    // returns false if it must be retried, i.e. the alignment transform is not available yet 
+    bool restoreCheckpoint();
+    
 protected: 
     
     //ROS node handle
     ros::NodeHandle nh_;
     ros::NodeHandle nh_private_;    
     
-    volatile bool b_wall_info_available_;
-    volatile bool b_traversability_info_available_;
-    volatile bool b_utility_2d_info_available_;
-        
     volatile bool b_abort_; // true if we want to abort it 
     
     Transform transform_robot_;
@@ -230,15 +331,14 @@ protected:
     nav_msgs::Path path_; // last planned path 
     double path_cost_; // cost of the last planned path 
 
-    boost::recursive_mutex wall_mutex_;
-    pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr wall_pcl_;
-    pp::KdTreeFLANN<pcl::PointXYZRGBNormal> wall_kdtree_;
-
-    boost::recursive_mutex traversability_mutex_;
-    pcl::PointCloud<pcl::PointXYZI>::Ptr traversability_pcl_;
+    // input maps, always accessed with boost::atomic_load() and boost::atomic_store() (see MapSnapshot)
+    WallSnapshot::ConstPtr wall_snapshot_;
+    TraversabilitySnapshot::ConstPtr traversability_snapshot_;
+    Utility2DSnapshot::ConstPtr utility_2d_snapshot_; // we assume that it contains info about the points in traversability_snapshot_
     
-    boost::recursive_mutex utility_2d_mutex_;
-    pcl::PointCloud<pcl::PointXYZI>::Ptr utility_2d_pcl_; // [x,y,u(x,y),var(x,y)] we assume that utility_2d_pcl_ contains info about the points in traversability_pcl_
+    // neighborhood graph of the full traversability map (lazily built by the planning thread or by computePathCosts()), 
+    // always accessed with boost::atomic_load() and boost::atomic_store() 
+    TraversabilityGraph::ConstPtr traversability_graph_; 
     
     boost::shared_ptr<ExplorationPlanner> p_expl_planner_; // the used path planner instance
     boost::recursive_mutex expl_planner_mutex_;
@@ -251,6 +351,13 @@ protected:
     std::vector<PriorityPointQueue::PriorityPoint> removed_priority_points_;
     
     TeamModel team_model_;
+    
+    int my_robot_id_; 
+    
+    Transform transform_checkpoint_; // used for looking up the pose of the map frame w.r.t. the checkpoint fixed frame 
+    bool b_restore_checkpoint_pending_; // the checkpoint is restored at the first planning step 
+    int num_checkpoint_restore_attempts_; 
+    ros::Time last_checkpoint_time_; 
 };
 
 
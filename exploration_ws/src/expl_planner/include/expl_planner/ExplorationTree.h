@@ -32,6 +32,7 @@
 #include <nav_msgs/Odometry.h>
 
 #include "Tree.h"
+#include "ExplorationCheckpoint.h"
 
 namespace explplanner
 {
@@ -51,6 +52,7 @@ public:
     static const std::string kRvizNamespace; 
     
     enum VizIds { kVizSelectedNode=0, kVizSelectedNodeDisc, kVizCurrentNode}; 
+    enum VizNodeMarkers { kVizNodeSphere=0, kVizNodeText, kVizNodeArrow, kNumVizNodeMarkers}; // markers of a tree node (id = kNumVizNodeMarkers*node->id_ + marker)
     
 public:
     typedef Eigen::Vector4d StateVec;
@@ -73,6 +75,11 @@ public:
     
     int getNumNodes() { return counter_; }    
     
+    // get the nodes (parents before children) and the id of the current node, for saving a checkpoint 
+    void getNodes(ExplorationCheckpoint::TreeNodes& nodes, int& current_id);
+    // rebuild the tree from the nodes of a checkpoint (the first one is the root), keeping their ids 
+    void restore(const ExplorationCheckpoint::TreeNodes& nodes, int current_id);
+    
 public:
     
     void publishNode(Node<StateVec> * node);
@@ -30,12 +30,14 @@
 
 #include <geometry_msgs/PoseWithCovarianceStamped.h>
 #include <nav_msgs/Odometry.h>
-#include <kdtree/kdtree.h>
+#include "NodeKdTree.h"
+#include "NodeClusterer.h"
 
 #include <set>
 #include <map>
 
 #include "Tree.h"
+#include "ExplorationCheckpoint.h"
 #include "NodeSet.h"
 #include "NavigationTree.h"
 
@@ -57,6 +59,8 @@ public:
     
     static const std::string kRvizNamespace;     
     
+    enum VizNodeMarkers { kVizNodeSphere=0, kVizNodeArrow, kNumVizNodeMarkers}; // markers of a tree node (id = kNumVizNodeMarkers*node->id_ + marker)
+    
 public:
     typedef Eigen::Vector4d StateVec;
 
@@ -78,7 +82,13 @@ public:
     
     int getNumNodes() const { return counter_ + 1; }
     
-    kdtree* getKdTree() { return kdTree_; }
+    // get the nodes sorted by increasing id (root first), for saving a checkpoint 
+    void getNodes(ExplorationCheckpoint::TreeNodes& nodes);
+    // rebuild the tree by re-adding the nodes of a checkpoint in their insertion order (the first one is the root); 
+    // the frontier gains are recomputed at the next update 
+    void restore(const ExplorationCheckpoint::TreeNodes& nodes);
+    
+    NodeKdTree<Node<StateVec> >* getKdTree() { return &kdTree_; }
    
     void getClustersVecPtr(std::vector<NodeSet<StateVec>* >& clusters);
         
@@ -100,7 +110,7 @@ protected:
     int g_ID_; // graphics ID for visual markers    
     int iterationCount_; 
     
-    kdtree* kdTree_;
+    NodeKdTree<Node<StateVec> > kdTree_;
     
     std::set<Node<StateVec>*> frontierNodes_; 
         
@@ -115,6 +125,9 @@ protected: // clustering
     std::map<int, NodeSet<StateVec> > clusters_; 
     int numClusters_;
     
+    NodeClusterer<Node<StateVec> > clusterer_; // frontier nodes in a spatial hash + union-find clusters (kept in sync with frontierNodes_)
+    std::vector<int> clusterLabels_; // reused buffer: clusterer root index -> cluster label 
+    
     visualization_msgs::MarkerArray clustersMarkerArray_;    
 };
 
@@ -0,0 +1,114 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MAP_SYNC_SCHEDULER_H_
+#define MAP_SYNC_SCHEDULER_H_
+
+#include <set>
+#include <map>
+#include <cstdint>
+
+#include <boost/core/noncopyable.hpp>
+
+#include <ros/ros.h>
+
+#include "PriorityQueue.h"
+
+
+namespace explplanner{
+
+///	\class MapSyncParams
+///	\author Luigi Freda
+///	\brief
+///	\note
+/// \todo
+///	\date
+///	\warning
+struct MapSyncParams
+{
+    double bandwidth_            = 0;  // [bytes/s] budget of the missing scans sent to the teammates (<= 0: unlimited, the scans are sent at once)
+    double burst_                = 0;  // [bytes] maximum accumulated budget (<= 0: one second of bandwidth)
+    double resend_time_          = 60; // [s] a scan sent to a teammate is not scheduled again for it before this time
+    double downsample_leaf_size_ = 0;  // [m] voxel-grid downsampling of the sent scans (<= 0: none)
+};
+
+///	\class MapSyncScheduler
+///	\author Luigi Freda
+///	\brief Rate-limited scheduler of the missing scans to send to the teammates.
+///	       The requests are ranked by their expected information (the distance of the scan from the poses known by the teammate)
+///	       and released within a token-bucket budget of bytes (the budget is charged with the actual sent bytes and it can go negative, hence
+///	       a scan larger than the burst is delayed instead of blocked). A queued or recently sent (teammate, scan) pair is not scheduled again.
+///	\note  The class is not thread-safe (ScanHistoryManager locks it).
+/// \todo
+///	\date
+///	\warning
+class MapSyncScheduler: private boost::noncopyable
+{
+public:
+
+    struct Request
+    {
+        Request(int peerIdIn = -1, uint32_t scanIndexIn = 0):peerId(peerIdIn), scanIndex(scanIndexIn){}
+        int peerId;
+        uint32_t scanIndex;
+    };
+
+public:
+
+    MapSyncScheduler();
+
+    void setParams(const MapSyncParams& params);
+    const MapSyncParams& getParams() const { return params_; }
+
+    bool isRateLimited() const { return params_.bandwidth_ > 0; }
+
+    // queue the scan for the teammate with the given expected information; return false if it is already queued or it was recently sent
+    bool schedule(int peerId, uint32_t scanIndex, double information, const ros::Time& now);
+
+    // pop the most informative request if the budget is positive
+    bool next(const ros::Time& now, Request& request);
+
+    // charge the budget with the bytes actually sent
+    void consume(size_t bytes) { tokens_ -= bytes; }
+
+    size_t getNumPending() const { return queue_.Size(); }
+
+protected:
+
+    static uint64_t getKey(int peerId, uint32_t scanIndex) { return ((uint64_t)(uint32_t)peerId << 32) | scanIndex; }
+
+    void refill(const ros::Time& now);
+
+protected:
+
+    MapSyncParams params_;
+
+    UnsyncPriorityQueue<Request, double> queue_; // highest expected information on top
+    std::set<uint64_t> queued_;
+    std::map<uint64_t, ros::Time> lastSent_;
+
+    double tokens_; // [bytes]
+    ros::Time lastRefill_;
+};
+
+} // namespace explplanner
+
+
+#endif //MAP_SYNC_SCHEDULER_H_
@@ -0,0 +1,110 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MARKER_ARRAY_DIFF_PUBLISHER_H_
+#define MARKER_ARRAY_DIFF_PUBLISHER_H_
+
+#include <map>
+#include <string>
+#include <stdint.h>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/core/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <eigen3/Eigen/Dense>
+
+#include <ros/ros.h>
+#include <visualization_msgs/MarkerArray.h>
+
+
+namespace explplanner{
+
+///	\class MarkerArrayDiffPublisher
+///	\author Luigi Freda
+///	\brief Publishes a marker array as a delta w.r.t. the last published one: a marker is sent (ADD) only if it is new 
+///        or it changed, and a DELETE is sent for each marker which is not in the input array any more. Markers are 
+///        identified by their (ns,id) pair, which must then be stable across calls (e.g. derived from the tree node ids).
+///        - Without subscribers, nothing is serialized; the callers can also check hasSubscribers() before building 
+///          the input array. When a new subscriber connects, the next call sends a DELETEALL and the full array. 
+///        - Optional decimation by distance from a view point (e.g. the robot position, which RViz usually follows): 
+///          beyond decimationDistance the markers are progressively thinned out (1 out of 2, 4, 8, ... each time 
+///          the distance doubles). The selection only depends on the marker position, so it does not flicker. 
+///	\note markers with a non-zero lifetime are always sent, since RViz drops them when they expire 
+/// \todo 
+///	\date
+///	\warning the (ns,id) pairs must be unique within an input array 
+class MarkerArrayDiffPublisher: private boost::noncopyable
+{
+public:
+    
+    typedef boost::shared_ptr<MarkerArrayDiffPublisher> Ptr;
+    
+    static const int kMaxDecimationLevel;  // max stride is 2^kMaxDecimationLevel 
+    static const double kDecimationGridSize; // [m] resolution of the positions used for selecting the decimated markers 
+    
+public:
+    
+    MarkerArrayDiffPublisher(ros::NodeHandle& nh, const std::string& topic, uint32_t queue_size, double decimation_distance = 0);
+    
+    // publish the delta between the input (complete) array and the last published one 
+    void publish(const visualization_msgs::MarkerArray& markers);
+    
+    bool hasSubscribers() const { return pub_.getNumSubscribers() > 0; }
+    
+public: /// < setters 
+    
+    void setViewPoint(const Eigen::Vector3d& view_point); 
+    void setDecimationDistance(double decimation_distance); // 0 = no decimation 
+    
+protected:
+    
+    typedef std::pair<std::string,int> MarkerKey;
+    
+    struct PublishedMarker
+    {
+        visualization_msgs::Marker marker; 
+        uint32_t stamp; // publish() call which last contained the marker 
+    };
+    
+    void connectCallback(const ros::SingleSubscriberPublisher& pub);
+    
+    // is the marker kept after the decimation? 
+    bool isKept(const visualization_msgs::Marker& marker) const;
+    
+    // compare all the fields shown by RViz (header stamp and seq are ignored) 
+    static bool isSameMarker(const visualization_msgs::Marker& a, const visualization_msgs::Marker& b);
+    
+protected:
+    
+    ros::Publisher pub_;
+    
+    boost::mutex mutex_; 
+    std::map<MarkerKey, PublishedMarker> published_; // the markers currently shown by the subscribers 
+    uint32_t stamp_; 
+    bool b_resend_all_; // a subscriber connected: send everything at the next call 
+    
+    Eigen::Vector3d view_point_; 
+    double decimation_distance_; // [m] 0 = no decimation 
+};
+
+} // namespace explplanner
+
+#endif // MARKER_ARRAY_DIFF_PUBLISHER_H_
@@ -27,7 +27,7 @@
 #include <eigen3/Eigen/Dense>
 #include <eigen3/Eigen/StdVector>
 
-#include <kdtree/kdtree.h>
+#include "NodeKdTree.h"
 
 #include <set>
 #include <map>
@@ -52,17 +52,19 @@ public:
     static const double kTreeZVisualizationOffset;
     
     static const std::string kRvizNamespace;     
+    
+    enum VizNodeMarkers { kVizNodeSphere=0, kVizNodeArrow, kNumVizNodeMarkers}; // markers of a tree node (id = kNumVizNodeMarkers*node->id_ + marker)
        
 public:
     typedef Eigen::Vector4d StateVec;
     
     ///\class PriorityNodeQueue 
-    ///\brief Class for implementing a priority queue with nodes
+    ///\brief Class for implementing a priority queue with nodes (unsynchronized: it is used only inside expand())
     ///\author Luigi Freda    
-    class PriorityNodeQueue: public PriorityQueue<Node<StateVec>*, double> 
+    class PriorityNodeQueue: public UnsyncPriorityQueue<Node<StateVec>*, double> 
     {
     public: 
-        typedef PriorityQueue::PriorityElementT PriorityNode;
+        typedef UnsyncPriorityQueue::PriorityElementT PriorityNode;
 
     public:
 
@@ -83,7 +85,7 @@ public:
     void setParams(const ExplParams& params);
     void setRobotId(int id){ robot_id_ = id; }     
   
-    void setInputKdtree(kdtree* kdTree);
+    void setInputKdtree(NodeKdTree<Node<StateVec> >* kdTree);
     void setRoot(double x, double y, double z);
     
     void initialize();
@@ -92,8 +94,16 @@ public:
     Node<StateVec>* addNode(double x, double y, double z, Node<StateVec> * parent); 
     Node<StateVec>* addNode(StateVec& newState, Node<StateVec> * parent);
     
+    // expand the navigation tree from the root over the input tree (the nodes are popped by increasing distance from the root); 
+    // since the input graph is a tree, each external node is reached once along its shortest path: after this, 
+    // the distance field below is a lookup (computed once per planning cycle)  
     void expand();
     
+    // clone of the external node in the navigation tree (NULL if it was not reached by expand()); navNode->distance_ is its path length from the root 
+    Node<StateVec>* getNavNode(const Node<StateVec>* extNode) const;
+    // path length from the root to the external node (-1 if it was not reached by expand())
+    double getDistanceFromRoot(const Node<StateVec>* extNode) const;
+    
 public:
     
     void publishNode(Node<StateVec>* node);
@@ -111,8 +121,8 @@ public:
     void getExtNearestRange(const double x, const double y, const double z, const double range, std::vector<Node<StateVec>*>& neighbors);  
     
     // get nearest from input tree 
-    Node<StateVec>* getTreeNearest(kdtree* tree, const double x, const double y, const double z);
-    void getTreeNearestRange(kdtree* tree, const double x, const double y, const double z, const double range, std::vector<Node<StateVec>*>& neighbors);   
+    Node<StateVec>* getTreeNearest(const NodeKdTree<Node<StateVec> >* tree, const double x, const double y, const double z);
+    void getTreeNearestRange(const NodeKdTree<Node<StateVec> >* tree, const double x, const double y, const double z, const double range, std::vector<Node<StateVec>*>& neighbors);   
     
     // get neighbors from the tree data structure which the node belongs to
     void getNeighbors(Node<StateVec>* node, std::vector<Node<StateVec>*>& neighbors);
@@ -126,19 +136,21 @@ protected:
   
     int g_ID_; // graphics ID for visual markers    
     
-    kdtree* extKdTree_; // input kdTree_ (set from an external object), this acts as a set of nodes to reorganize in the form of a navigation tree
+    NodeKdTree<Node<StateVec> >* extKdTree_; // input kdTree_ (set from an external object), this acts as a set of nodes to reorganize in the form of a navigation tree
     
-    kdtree* kdTree_; // internal kdTree_    
+    NodeKdTree<Node<StateVec> > kdTree_; // internal kdTree_    
     Node<StateVec>* rootNode_;
     StateVec root_;    
     
     int counter_; // number of added nodes 
     
+    std::vector<NodeKdTree<Node<StateVec> >::DistanceItem> rangeResults_; // buffer of the range queries (reused) 
+    
     visualization_msgs::MarkerArray markerArray_;    
 
 protected:
 
-    std::unordered_map<int, bool> visitedNodes_;
+    std::unordered_map<int, Node<StateVec>*> visitedNodes_; // external node id -> its clone in the navigation tree (distance field)
     PriorityNodeQueue priorityQueue_;             
 };
 
@@ -0,0 +1,248 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NODE_CLUSTERER_H_
+#define NODE_CLUSTERER_H_
+
+#include <vector>
+#include <unordered_map>
+#include <cmath>
+#include <cstdint>
+
+#include <boost/core/noncopyable.hpp>
+
+
+namespace explplanner
+{
+
+///\class NodeClusterer
+///\brief Incremental single-linkage clustering of 3D nodes: two nodes are in the same cluster if they are connected by a chain of nodes
+///       whose consecutive distances are <= radius. The nodes are stored in a spatial hash of cubic cells of side radius (the neighbors
+///       of a node are in the 27 cells around it) and the clusters in a union-find forest (path halving, union by size).
+///\note  An insertion is merged at once with its neighbors. A removal can split a cluster: the forest is rebuilt by the next update().
+///       NodeT must have a state_ with the position in state_[0..2].
+///\author Luigi Freda
+template<typename NodeT>
+class NodeClusterer: private boost::noncopyable
+{
+public:
+
+    NodeClusterer():radius_(1.), b_dirty_(false){}
+
+    // set the clustering radius (the nodes are re-hashed if it changes)
+    void setRadius(double radius)
+    {
+        if (radius == radius_) return; /// < EXIT POINT
+        radius_ = radius;
+        rehash();
+    }
+
+    void clear()
+    {
+        nodes_.clear();
+        parents_.clear();
+        sizes_.clear();
+        indices_.clear();
+        cells_.clear();
+        b_dirty_ = false;
+    }
+
+    // add a node (nothing is done if it is already present) and merge it with the clusters of its neighbors
+    void insert(NodeT* node)
+    {
+        if (indices_.count(node)) return; /// < EXIT POINT
+
+        const int index = nodes_.size();
+        nodes_.push_back(node);
+        parents_.push_back(index);
+        sizes_.push_back(1);
+        indices_[node] = index;
+
+        addToCell(index);
+        if (!b_dirty_) mergeWithNeighbors(index); // otherwise the forest is rebuilt by update()
+    }
+
+    // remove a node (nothing is done if it is not present)
+    void remove(NodeT* node)
+    {
+        auto it = indices_.find(node);
+        if (it == indices_.end()) return; /// < EXIT POINT
+
+        const int index = it->second;
+        indices_.erase(it);
+        removeFromCell(index);
+        nodes_[index] = NULL;
+        b_dirty_ = true;
+    }
+
+    // rebuild the union-find forest if some nodes were removed; after this, the indices [0, size()) refer only to present nodes
+    void update()
+    {
+        if (!b_dirty_) return; /// < EXIT POINT
+        rehash();
+    }
+
+    size_t size() const { return nodes_.size(); }
+    NodeT* getNode(int index) const { return nodes_[index]; }
+
+    // index of the representative node of the cluster of the node index (call update() first)
+    int findRoot(int index)
+    {
+        while (parents_[index] != index)
+        {
+            parents_[index] = parents_[parents_[index]]; // path halving
+            index = parents_[index];
+        }
+        return index;
+    }
+
+protected:
+
+    typedef std::vector<int> Cell;
+
+protected:
+
+    uint64_t getCellKey(const NodeT* node) const
+    {
+        // 21 bits per axis
+        const uint64_t kOffset = 1 << 20;
+        const uint64_t ix = (uint64_t)((int64_t)floor(node->state_[0]/radius_) + kOffset) & 0x1fffff;
+        const uint64_t iy = (uint64_t)((int64_t)floor(node->state_[1]/radius_) + kOffset) & 0x1fffff;
+        const uint64_t iz = (uint64_t)((int64_t)floor(node->state_[2]/radius_) + kOffset) & 0x1fffff;
+        return (ix << 42) | (iy << 21) | iz;
+    }
+
+    void addToCell(int index)
+    {
+        cells_[getCellKey(nodes_[index])].push_back(index);
+    }
+
+    void removeFromCell(int index)
+    {
+        auto it = cells_.find(getCellKey(nodes_[index]));
+        if (it == cells_.end()) return; /// < EXIT POINT
+        Cell& cell = it->second;
+        for (size_t ii = 0, iiEnd = cell.size(); ii < iiEnd; ii++)
+        {
+            if (cell[ii] == index)
+            {
+                cell[ii] = cell.back();
+                cell.pop_back();
+                break;
+            }
+        }
+        if (cell.empty()) cells_.erase(it);
+    }
+
+    void merge(int a, int b)
+    {
+        a = findRoot(a);
+        b = findRoot(b);
+        if (a == b) return; /// < EXIT POINT
+        if (sizes_[a] < sizes_[b]) std::swap(a, b);
+        parents_[b] = a;
+        sizes_[a] += sizes_[b];
+    }
+
+    void mergeWithNeighbors(int index)
+    {
+        const NodeT* node = nodes_[index];
+        const double radius2 = radius_*radius_;
+        const int64_t cx = (int64_t)floor(node->state_[0]/radius_);
+        const int64_t cy = (int64_t)floor(node->state_[1]/radius_);
+        const int64_t cz = (int64_t)floor(node->state_[2]/radius_);
+        const uint64_t kOffset = 1 << 20;
+        for (int64_t dx = -1; dx <= 1; dx++)
+        {
+            for (int64_t dy = -1; dy <= 1; dy++)
+            {
+                for (int64_t dz = -1; dz <= 1; dz++)
+                {
+                    const uint64_t key = ((((uint64_t)(cx + dx + kOffset)) & 0x1fffff) << 42) |
+                                         ((((uint64_t)(cy + dy + kOffset)) & 0x1fffff) << 21) |
+                                          (((uint64_t)(cz + dz + kOffset)) & 0x1fffff);
+                    auto it = cells_.find(key);
+                    if (it == cells_.end()) continue; /// < CONTINUE
+
+                    const Cell& cell = it->second;
+                    for (size_t ii = 0, iiEnd = cell.size(); ii < iiEnd; ii++)
+                    {
+                        const int other = cell[ii];
+                        if (other == index) continue; /// < CONTINUE
+                        const NodeT* otherNode = nodes_[other];
+                        const double d0 = node->state_[0] - otherNode->state_[0];
+                        const double d1 = node->state_[1] - otherNode->state_[1];
+                        const double d2 = node->state_[2] - otherNode->state_[2];
+                        if (d0*d0 + d1*d1 + d2*d2 <= radius2) merge(index, other);
+                    }
+                }
+            }
+        }
+    }
+
+    // compact the present nodes, hash them again and rebuild the forest
+    void rehash()
+    {
+        size_t numNodes = 0;
+        for (size_t ii = 0, iiEnd = nodes_.size(); ii < iiEnd; ii++)
+        {
+            if (nodes_[ii]) nodes_[numNodes++] = nodes_[ii];
+        }
+        nodes_.resize(numNodes);
+        parents_.resize(numNodes);
+        sizes_.resize(numNodes);
+
+        for (auto it = cells_.begin(); it != cells_.end(); ++it) it->second.clear(); // the cell buffers are reused
+        for (size_t ii = 0; ii < numNodes; ii++)
+        {
+            parents_[ii] = ii;
+            sizes_[ii] = 1;
+            indices_[nodes_[ii]] = ii;
+            addToCell(ii);
+        }
+        for (auto it = cells_.begin(); it != cells_.end(); )
+        {
+            if (it->second.empty()) it = cells_.erase(it); else ++it;
+        }
+
+        for (size_t ii = 0; ii < numNodes; ii++)
+        {
+            mergeWithNeighbors(ii);
+        }
+        b_dirty_ = false;
+    }
+
+protected:
+
+    double radius_;
+
+    std::vector<NodeT*> nodes_;  // NULL if removed (until update())
+    std::vector<int> parents_;    // union-find forest
+    std::vector<int> sizes_;      // cluster sizes (valid for the roots)
+    std::unordered_map<NodeT*, int> indices_;
+
+    std::unordered_map<uint64_t, Cell> cells_; // spatial hash: cell key -> node indices
+
+    bool b_dirty_; // some nodes were removed: the forest must be rebuilt
+};
+
+} // namespace explplanner
+
+#endif // NODE_CLUSTERER_H_
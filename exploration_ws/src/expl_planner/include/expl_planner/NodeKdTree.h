@@ -0,0 +1,259 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NODE_KD_TREE_H_
+#define NODE_KD_TREE_H_
+
+#include <vector>
+#include <utility>      // std::pair
+#include <algorithm>    // std::nth_element
+#include <limits>
+#include <cstdint>
+
+#include <boost/core/noncopyable.hpp>
+
+
+namespace explplanner
+{
+
+///\class NodeKdTree
+///\brief 3D kd-tree of data pointers (replaces the C kdtree library in the exploration trees).
+///       The tree nodes are stored contiguously in a pool (a std::vector) and linked by index: an insertion
+///       does not allocate unless the pool grows, clear() keeps the pool capacity, queries do not allocate
+///       and write their results into caller-owned vectors.
+///\note  The tree is not rebalanced by insert(); insertBatch() on an empty tree builds a balanced tree (median splits).
+///\author Luigi Freda
+template<typename T>
+class NodeKdTree: private boost::noncopyable
+{
+public:
+
+    static const int kNull = -1;
+
+    typedef std::pair<double, T*> DistanceItem; // (squared distance, data)
+
+public:
+
+    NodeKdTree(){}
+
+    void clear() { nodes_.clear(); }
+    void reserve(size_t n) { nodes_.reserve(n); }
+
+    size_t size() const { return nodes_.size(); }
+    bool empty() const { return nodes_.empty(); }
+
+    // insert a single point
+    void insert(double x, double y, double z, T* data)
+    {
+        const int index = newNode(x, y, z, data);
+        if (index == 0) return; /// < EXIT POINT (root)
+
+        int current = 0;
+        while (true)
+        {
+            PoolNode& node = nodes_[current];
+            const int dir = node.dir;
+            int& child = (nodes_[index].pos[dir] < node.pos[dir]) ? node.left : node.right;
+            if (child == kNull)
+            {
+                nodes_[index].dir = (dir + 1) % 3;
+                child = index;
+                return; /// < EXIT POINT
+            }
+            current = child;
+        }
+    }
+
+    // insert a set of points; if the tree is empty, a balanced tree is built
+    // (PointT must have x(), y(), z(), e.g. an Eigen vector)
+    template<typename PointT>
+    void insertBatch(const std::vector<std::pair<PointT, T*> >& items)
+    {
+        if (!nodes_.empty())
+        {
+            for (size_t ii = 0, iiEnd = items.size(); ii < iiEnd; ii++)
+            {
+                insert(items[ii].first.x(), items[ii].first.y(), items[ii].first.z(), items[ii].second);
+            }
+            return; /// < EXIT POINT
+        }
+
+        std::vector<int> indices(items.size());
+        nodes_.reserve(items.size());
+        for (size_t ii = 0, iiEnd = items.size(); ii < iiEnd; ii++)
+        {
+            indices[ii] = newNode(items[ii].first.x(), items[ii].first.y(), items[ii].first.z(), items[ii].second);
+        }
+        root_ = build(indices, 0, (int)indices.size(), 0);
+    }
+
+    // return the data of the nearest point (NULL if the tree is empty); if distance2 is not NULL, it is set to the squared distance
+    T* nearest(double x, double y, double z, double* distance2 = NULL) const
+    {
+        if (nodes_.empty()) return NULL; /// < EXIT POINT
+
+        const double query[3] = {x, y, z};
+        int best = kNull;
+        double best_distance2 = std::numeric_limits<double>::max();
+        searchNearest(root_, query, best, best_distance2);
+
+        if (distance2) *distance2 = best_distance2;
+        return nodes_[best].data;
+    }
+
+    // append to results the data of the points within range (unsorted, as the C kdtree library); return the number of found points
+    size_t nearestRange(double x, double y, double z, double range, std::vector<T*>& results) const
+    {
+        const size_t initial_size = results.size();
+        if (nodes_.empty()) return 0; /// < EXIT POINT
+
+        const double query[3] = {x, y, z};
+        searchRange(root_, query, range, range*range, [&results](const PoolNode& node, double){ results.push_back(node.data); });
+        return results.size() - initial_size;
+    }
+
+    // as above, but append (squared distance, data) pairs
+    size_t nearestRange(double x, double y, double z, double range, std::vector<DistanceItem>& results) const
+    {
+        const size_t initial_size = results.size();
+        if (nodes_.empty()) return 0; /// < EXIT POINT
+
+        const double query[3] = {x, y, z};
+        searchRange(root_, query, range, range*range, [&results](const PoolNode& node, double d2){ results.push_back(DistanceItem(d2, node.data)); });
+        return results.size() - initial_size;
+    }
+
+protected:
+
+    struct PoolNode
+    {
+        double pos[3];
+        T* data;
+        int left;
+        int right;
+        uint8_t dir; // split axis
+    };
+
+protected:
+
+    int newNode(double x, double y, double z, T* data)
+    {
+        PoolNode node;
+        node.pos[0] = x;
+        node.pos[1] = y;
+        node.pos[2] = z;
+        node.data = data;
+        node.left = node.right = kNull;
+        node.dir = 0;
+        nodes_.push_back(node);
+        if (nodes_.size() == 1) root_ = 0;
+        return (int)nodes_.size() - 1;
+    }
+
+    // build a balanced subtree with the nodes indices[begin, end) splitting along the axis dir; return the index of the subtree root
+    int build(std::vector<int>& indices, int begin, int end, int dir)
+    {
+        if (begin >= end) return kNull; /// < EXIT POINT
+
+        const int mid = begin + (end - begin)/2;
+        std::nth_element(indices.begin() + begin, indices.begin() + mid, indices.begin() + end,
+                         [this, dir](int a, int b){ return nodes_[a].pos[dir] < nodes_[b].pos[dir]; });
+
+        const int index = indices[mid];
+        const int next_dir = (dir + 1) % 3;
+        const int left = build(indices, begin, mid, next_dir);
+        const int right = build(indices, mid + 1, end, next_dir);
+
+        PoolNode& node = nodes_[index];
+        node.dir = dir;
+        node.left = left;
+        node.right = right;
+        return index;
+    }
+
+    static double distanceSquared(const PoolNode& node, const double* query)
+    {
+        const double dx = node.pos[0] - query[0];
+        const double dy = node.pos[1] - query[1];
+        const double dz = node.pos[2] - query[2];
+        return dx*dx + dy*dy + dz*dz;
+    }
+
+    void searchNearest(int index, const double* query, int& best, double& best_distance2) const
+    {
+        while (index != kNull)
+        {
+            const PoolNode& node = nodes_[index];
+
+            const double distance2 = distanceSquared(node, query);
+            if (distance2 < best_distance2)
+            {
+                best_distance2 = distance2;
+                best = index;
+            }
+
+            const double delta = query[node.dir] - node.pos[node.dir];
+            const int near_child = (delta < 0) ? node.left : node.right;
+            const int far_child = (delta < 0) ? node.right : node.left;
+
+            // the far side is visited only if the splitting plane is closer than the current best
+            if ((far_child != kNull) && (delta*delta < best_distance2))
+            {
+                searchNearest(near_child, query, best, best_distance2);
+                if (delta*delta < best_distance2) searchNearest(far_child, query, best, best_distance2);
+                return; /// < EXIT POINT
+            }
+            index = near_child;
+        }
+    }
+
+    template<typename Visitor>
+    void searchRange(int index, const double* query, double range, double range2, const Visitor& visitor) const
+    {
+        while (index != kNull)
+        {
+            const PoolNode& node = nodes_[index];
+
+            const double distance2 = distanceSquared(node, query);
+            if (distance2 <= range2) visitor(node, distance2);
+
+            const double delta = query[node.dir] - node.pos[node.dir];
+            if (delta <= 0)
+            {
+                if ((node.right != kNull) && (-delta <= range)) searchRange(node.right, query, range, range2, visitor);
+                index = node.left;
+            }
+            else
+            {
+                if ((node.left != kNull) && (delta <= range)) searchRange(node.left, query, range, range2, visitor);
+                index = node.right;
+            }
+        }
+    }
+
+protected:
+
+    std::vector<PoolNode> nodes_; // pool of the tree nodes (nodes_[root_] is the root)
+    int root_ = kNull;
+};
+
+} // namespace explplanner
+
+#endif // NODE_KD_TREE_H_
@@ -0,0 +1,138 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PLANNING_PROFILER_H_
+#define PLANNING_PROFILER_H_
+
+#include <chrono>
+#include <cstddef>
+
+#include <mr3d_profiling/Profiler.h>
+
+
+namespace explplanner{
+
+///	\class PlanningProfiler
+///	\author Luigi Freda
+///	\brief Per-phase timing of the exploration planning, used by the benchmark (see expl_planner_benchmark.cpp). 
+///        A phase is timed by a ScopedPhase in the code of the phase. The nested phases are excluded from the enclosing one 
+///        (e.g. the collision checks and the gains of the nodes added while sampling are not counted as sampling time), 
+///        hence the phase times of a planning step add up to at most its wall time. 
+///        The profiler is disabled by default: a ScopedPhase then only reads a flag and records its (inclusive) time 
+///        in the shared profiler zone "expl/<phase>" (see mr3d_profiling::Profiler), on any thread. 
+///	\note the phases are recorded only on the thread which enabled the profiler: e.g. the gains computed by the worker 
+///       threads of TreeBase::computeGains() are counted once, as the wall time of computeGains() 
+/// \todo 
+///	\date
+///	\warning
+class PlanningProfiler
+{
+public:
+    
+    typedef std::chrono::steady_clock Clock; 
+    
+    enum Phase 
+    {
+        kSampling = 0,  // expansion of the search tree on the traversability map 
+        kCollision,     // collision checks of the search tree edges 
+        kGain,          // information gains 
+        kFrontiers,     // update and clustering of the frontier tree 
+        kPathPlanning,  // navigation tree and extraction of the path 
+        kNumPhases
+    };
+    static const char* kPhaseNames[kNumPhases]; /// < keep this coherent with Phase
+    
+    struct Stats
+    {
+        Stats() { clear(); }
+        void clear() 
+        { 
+            for(int ii=0; ii < kNumPhases; ii++) { time[ii] = 0; calls[ii] = 0; }
+        }
+        
+        double time[kNumPhases]; // [s] 
+        size_t calls[kNumPhases]; 
+    };
+    
+    class ScopedPhase
+    {
+    public:
+        
+        explicit ScopedPhase(Phase phase):phase_(phase), zone_(getZone(phase)), b_active_(b_enabled_)
+        {
+            if(!b_active_) return; /// < EXIT POINT
+            
+            const Clock::time_point now = Clock::now();
+            parent_ = current_;
+            if(parent_) parent_->pause(now);
+            current_ = this;
+            start_ = now;
+            stats_.calls[phase_]++;
+        }
+        
+        ~ScopedPhase()
+        {
+            if(!b_active_) return; /// < EXIT POINT
+            
+            const Clock::time_point now = Clock::now();
+            pause(now);
+            current_ = parent_;
+            if(parent_) parent_->start_ = now; // resume 
+        }
+        
+    private:
+        
+        void pause(const Clock::time_point& now)
+        {
+            stats_.time[phase_] += std::chrono::duration<double>(now - start_).count();
+        }
+        
+    private:
+        
+        Phase phase_; 
+        mr3d_profiling::ScopedZone zone_; 
+        bool b_active_; 
+        ScopedPhase* parent_; 
+        Clock::time_point start_; 
+    };
+    
+public:
+    
+    // enable/disable the profiler on the calling thread 
+    static void setEnabled(bool val) { b_enabled_ = val; }
+    static bool isEnabled() { return b_enabled_; }
+    
+    // the stats of the calling thread 
+    static const Stats& getStats() { return stats_; }
+    static void reset() { stats_.clear(); }
+    
+    // the id of the shared profiler zone of the phase 
+    static int getZone(Phase phase);
+    
+private:
+    
+    static thread_local bool b_enabled_; 
+    static thread_local ScopedPhase* current_; // innermost active phase 
+    static thread_local Stats stats_; 
+};
+
+} // namespace explplanner
+
+#endif // PLANNING_PROFILER_H_
@@ -24,9 +24,12 @@
 #include <utility>      // std::pair, std::make_pair
 #include <iostream>     // std::cout
 #include <queue>        // std::priority_queue
-#include <algorithm>    // std::sort
+#include <algorithm>    // std::sort, std::push_heap, std::pop_heap
+#include <vector>
+#include <atomic>
 
 #include <boost/thread/recursive_mutex.hpp>
+#include <boost/thread/mutex.hpp>
 #include <geometry_msgs/Point.h>
 
 
@@ -123,7 +126,7 @@ public:
             queue_.push_back(new_element);
         }
         // sort and move the highest priority on the back 
-        std::sort(queue_.begin(), queue_.begin(), comparison_);        
+        std::sort(queue_.begin(), queue_.end(), comparison_);        
     }
 
     // remove top element 
@@ -154,7 +157,7 @@ public:
         if (it != queue_.end())
         {
             queue_.erase(it);
-            std::sort(queue_.begin(), queue_.begin(), comparison_); // for security, re-sort it!
+            std::sort(queue_.begin(), queue_.end(), comparison_); // for security, re-sort it!
         }
     }
     
@@ -169,6 +172,13 @@ public:
         boost::recursive_mutex::scoped_lock locker(mutex_);
         return queue_.empty();
     }
+    
+    // get a copy of the elements (sorted by increasing priority)
+    PriorityContainerT GetElements()
+    {
+        boost::recursive_mutex::scoped_lock locker(mutex_);
+        return queue_;
+    }
    
 
 
@@ -194,6 +204,179 @@ protected:
 };
 
 
+///\class UnsyncPriorityQueue 
+///\brief Unsynchronized priority queue (binary heap) for single-thread use, e.g. in the inner loop of a graph search 
+///\note  Differently from PriorityQueue, Push() does not look for an element with the same id: pushing an id twice 
+///       inserts two elements (a search can skip the stale one when it is popped). 
+///\author Luigi Freda
+template<typename T, typename PriorityType = int>
+class UnsyncPriorityQueue
+{
+public:
+    typedef PriorityElement<T, PriorityType> PriorityElementT;
+    typedef std::vector<PriorityElementT> PriorityContainerT;
+    typedef PriorityQueueComparison<T, PriorityType> PriorityQueueComparisonT;
+
+public:
+
+    UnsyncPriorityQueue(){}
+
+    void Push(const int id, const T& data, const PriorityType priority)
+    {
+        PriorityElementT new_element;
+        new_element.id = id;        
+        new_element.data = data;
+        new_element.priority = priority;
+        
+        queue_.push_back(new_element);
+        std::push_heap(queue_.begin(), queue_.end(), comparison_); // the highest priority is on the front 
+    }
+
+    // remove top element 
+    void Pop()
+    {
+        std::pop_heap(queue_.begin(), queue_.end(), comparison_);
+        queue_.pop_back();
+    }
+
+    // get top element 
+    PriorityElementT& Top() { return queue_.front(); }
+    
+    void Clear() { queue_.clear(); } // the capacity is kept 
+    void Reserve(size_t n) { queue_.reserve(n); }
+    
+    bool IsEmpty() const { return queue_.empty(); }
+    size_t Size() const { return queue_.size(); }
+
+protected:
+
+    PriorityContainerT queue_;
+    PriorityQueueComparisonT comparison_;
+};
+
+
+///\class ConcurrentPriorityQueue 
+///\brief Relaxed priority queue for concurrent producers and consumers: the elements are spread over kNumShards heaps, each one 
+///       with its own (non-recursive) mutex. Push() picks the shards in round robin, TryPop() compares the tops of two random shards 
+///       and pops the higher one ("power of two choices"), hence the popped element is close to, but not always, the highest priority one. 
+///\note  Push() does not look for an element with the same id (as UnsyncPriorityQueue). 
+///\author Luigi Freda
+template<typename T, typename PriorityType = int, int kNumShards = 8>
+class ConcurrentPriorityQueue
+{
+public:
+    typedef PriorityElement<T, PriorityType> PriorityElementT;
+    typedef std::vector<PriorityElementT> PriorityContainerT;
+    typedef PriorityQueueComparison<T, PriorityType> PriorityQueueComparisonT;
+
+public:
+
+    ConcurrentPriorityQueue():push_count_(0),size_(0){}
+
+    void Push(const int id, const T& data, const PriorityType priority)
+    {
+        PriorityElementT new_element;
+        new_element.id = id;        
+        new_element.data = data;
+        new_element.priority = priority;
+        
+        Shard& shard = shards_[push_count_.fetch_add(1, std::memory_order_relaxed) % kNumShards];
+        boost::mutex::scoped_lock locker(shard.mutex);
+        size_.fetch_add(1, std::memory_order_release); // before the insertion: size_ is never smaller than the number of elements 
+        shard.queue.push_back(new_element);
+        std::push_heap(shard.queue.begin(), shard.queue.end(), comparison_);
+    }
+
+    // pop an element with (approximately) the highest priority into element; return false if the queue is empty 
+    bool TryPop(PriorityElementT& element)
+    {
+        while (size_.load(std::memory_order_acquire) > 0)
+        {
+            const size_t start = NextRandom();
+            int i = start % kNumShards;
+            int j = (start / kNumShards) % kNumShards;
+            if (i == j) j = (j + 1) % kNumShards;
+            if (i > j) std::swap(i, j); // lock in a fixed order
+            
+            {
+                boost::mutex::scoped_lock locker_i(shards_[i].mutex);
+                boost::mutex::scoped_lock locker_j(shards_[j].mutex);
+                PriorityContainerT& queue_i = shards_[i].queue;
+                PriorityContainerT& queue_j = shards_[j].queue;
+                if (!queue_i.empty() || !queue_j.empty())
+                {
+                    PriorityContainerT& queue = (queue_j.empty() || (!queue_i.empty() && !comparison_(queue_i.front(), queue_j.front()))) ? queue_i : queue_j;
+                    PopFrom(queue, element);
+                    return true; /// < EXIT POINT
+                }
+            }
+            
+            // both the sampled shards are empty: scan all of them 
+            for (int k = 0; k < kNumShards; k++)
+            {
+                boost::mutex::scoped_lock locker(shards_[k].mutex);
+                if (!shards_[k].queue.empty())
+                {
+                    PopFrom(shards_[k].queue, element);
+                    return true; /// < EXIT POINT
+                }
+            }
+        }
+        return false;
+    }
+    
+    void Clear()
+    {
+        for (int k = 0; k < kNumShards; k++)
+        {
+            boost::mutex::scoped_lock locker(shards_[k].mutex);
+            size_.fetch_sub(shards_[k].queue.size(), std::memory_order_release);
+            shards_[k].queue.clear();
+        }
+    }
+    
+    bool IsEmpty() const { return size_.load(std::memory_order_acquire) == 0; }
+    size_t Size() const { return size_.load(std::memory_order_acquire); }
+
+protected:
+    
+    struct Shard
+    {
+        PriorityContainerT queue; // heap 
+        boost::mutex mutex;
+    };
+    
+protected:
+    
+    // N.B.: the shard mutex must be locked 
+    void PopFrom(PriorityContainerT& queue, PriorityElementT& element)
+    {
+        std::pop_heap(queue.begin(), queue.end(), comparison_);
+        element = queue.back();
+        queue.pop_back();
+        size_.fetch_sub(1, std::memory_order_release);
+    }
+    
+    static size_t NextRandom()
+    {
+        // xorshift, one state per thread 
+        static thread_local size_t state = 0x9E3779B97F4A7C15ull ^ (size_t)&state;
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+protected:
+
+    Shard shards_[kNumShards];
+    PriorityQueueComparisonT comparison_;
+    
+    std::atomic<size_t> push_count_;
+    std::atomic<size_t> size_;
+};
+
+
 ///\class PriorityQueuePoint 
 ///\brief Class for implementing a priority queue with 3D points 
 ///\author Luigi Freda
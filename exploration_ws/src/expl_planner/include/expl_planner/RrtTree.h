@@ -50,7 +50,7 @@
 
 #include <geometry_msgs/PoseWithCovarianceStamped.h>
 #include <nav_msgs/Odometry.h>
-#include <kdtree/kdtree.h>
+#include "NodeKdTree.h"
 
 #include "Tree.h"
 
@@ -73,6 +73,9 @@ public:
     
     static const double kZVisibilityOffset; 
     
+    static const size_t kGainBatchSizePerThread; // addNode() scores the pending nodes once they are kGainBatchSizePerThread * params_.gainNumThreads_ 
+    static const size_t kGainSnapshotBatchSize; // min batch size with params_.bGainSnapshot_ (a snapshot is built for each batch) 
+    
     static const std::string kRvizNamespaceNodes; 
     static const std::string kRvizNamespaceTexts;   
     static const std::string kRvizNamespaceEdges;       
@@ -87,6 +90,7 @@ public:
     virtual void setStateFromPoseMsg(const geometry_msgs::PoseWithCovarianceStamped& pose);
     virtual void setStateFromOdometryMsg(const nav_msgs::Odometry& pose);
     virtual void setPeerStateFromPoseMsg(const geometry_msgs::PoseWithCovarianceStamped& pose, int n_peer);
+    // if params_.bReuseTree_ is set and the tree was not cleared, the nodes of the previous tree are re-rooted at the new root (see reattachNodes())
     virtual void initialize();
     virtual void iterate(int iterations);
     
@@ -111,8 +115,25 @@ public:
     
     std::vector<Node<StateVec>* >& getFrontierNodes() { return frontierNodes_; }
     
+    // if params_.gainNumThreads_ > 1 or params_.bGainSnapshot_, addNode() only inserts the node and defers its gain: this computes in parallel the gains of the pending nodes 
+    // and then updates the branch gains, the best node and the frontier nodes; it must be called before reading them 
+    void scorePendingNodes();
+    
+protected:
+    
+    // set the branch gain of a node from its local gain and update the best node and the frontier nodes 
+    void updateNodeGain(Node<StateVec>* newNode);
+    
+    // take out all the nodes of the tree (in breadth-first order, root included) without deleting them and reset the tree as clear() does   
+    void detachNodes(std::vector<Node<StateVec>*>& nodes);
+    
+    // insert the detached nodes in the tree of the new root: each node is connected to its nearest node in the new tree (as in addNode()); 
+    // the nodes out of bounds, beyond params_.reuseTreeRadius_ or with an invalid edge are deleted, the others keep their local gain 
+    // unless the octomap changed in their gain region; return the number of re-attached nodes 
+    int reattachNodes(std::vector<Node<StateVec>*>& nodes);
+    
 protected:
-    kdtree * kdTree_;
+    NodeKdTree<Node<StateVec> > kdTree_;
     std::stack<StateVec, std::deque<StateVec, Eigen::aligned_allocator<StateVec> > > history_; 
     std::vector<StateVec, Eigen::aligned_allocator<StateVec> > bestBranchMemory_;
     int g_ID_; // graphics ID for visual markers 
@@ -128,6 +149,8 @@ protected:
     double disc_sqrt3_;
     
     std::vector<Node<StateVec>* > frontierNodes_;
+    
+    std::vector<Node<StateVec>* > pendingGainNodes_; // nodes added by addNode() whose gain has not been computed yet (in insertion order)
 };
 
 }
@@ -73,6 +73,8 @@ public:
 
     void setRobotId(int id);
     
+    const std::string& getFolderPath() const { return folderPath_; }
+    
 private:
 
     std::string getFilePath(uint32_t index);
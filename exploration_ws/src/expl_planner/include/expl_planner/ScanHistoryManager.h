@@ -51,11 +51,16 @@
 #include <ros/ros.h>
 #include <sensor_msgs/PointCloud2.h>
 
+#include <path_planner/PointHashIndex.h>
+
+#include "MapSyncScheduler.h"
+
 
 namespace explplanner{
 
 class SpaceTimeFilterBase;
 class ScanFileManager; 
+class ScanLog; 
 
 ///	\class ScanInfo
 ///	\author Luigi Freda 
@@ -72,9 +77,11 @@ struct ScanInfo
         :index(indexIn), timestamp(timestampIn), timestampLastReload(timestampIn), cloud_ptr(ptr)
     {}
     uint32_t index; 
+    pcl::PointXYZ position; // scan pose 
     ros::Time timestamp;
     ros::Time timestampLastReload;
     pcl::PCLPointCloud2::Ptr cloud_ptr;
+    sensor_msgs::PointCloud2::ConstPtr msg_ptr; // message sent to the teammates (downsampled if required), shared by all the sends and released with cloud_ptr 
 };
 
 ///	\class ScanHistoryManager
@@ -108,13 +115,24 @@ public:
     void setRobotId(int id);
 
     void getPoseArrayMessage(geometry_msgs::PoseArray& message);    
-    bool getCloudMessage(sensor_msgs::PointCloud2::Ptr &cloud_msg, const uint32_t& index);
+    // get the (shared, not copied) message of the scan to be sent to the teammates 
+    bool getCloudMessage(sensor_msgs::PointCloud2::ConstPtr &cloud_msg, const uint32_t& index);
 
-    void mapMessageOverlapCheck(const geometry_msgs::PoseArray& message, std::vector<sensor_msgs::PointCloud2::Ptr>& cloudsToSend);
+    // check the poses of a teammate against our scans: the missing scans are returned in cloudsToSend or, if the map sync is rate-limited, 
+    // they are queued in the map sync scheduler and released by getScheduledClouds() 
+    void mapMessageOverlapCheck(const geometry_msgs::PoseArray& message, std::vector<sensor_msgs::PointCloud2::ConstPtr>& cloudsToSend);
+    
+    // get the scheduled (teammate id, cloud) pairs which fit the current map sync budget 
+    void getScheduledClouds(std::vector<std::pair<int, sensor_msgs::PointCloud2::ConstPtr> >& cloudsToSend);
 
 private: 
 
     void updateHistory();
+    
+    void downsampleCloudMessage(sensor_msgs::PointCloud2::Ptr &cloud_msg);
+
+    // closest stored scan to the input position 
+    bool getClosestScan(const pcl::PointXYZ& position, uint32_t& scanIndex, float& scanSquaredDistance) const;
 
 private: 
 
@@ -125,6 +143,8 @@ private:
 
     std::set<ScanInfo::Ptr> recent_scans_;
 
+    pp::PointHashIndex<pcl::PointXYZ> scan_position_index_; // positions of all the stored scans (id = scan index), cell size = kMaxScanDistance 
+
 private: 
 
     // interaction mutex: to be locked every time a public method is called (setters, getters and planning)
@@ -134,6 +154,12 @@ private:
 
     std::shared_ptr<ScanFileManager> p_scan_file_manager_; // to manage history cache: save and release the scan, and reload it at need 
 
+    std::shared_ptr<ScanLog> p_scan_log_; // if set, the scans are appended to a compressed log at insertion and reloaded from it (instead of p_scan_file_manager_)
+    bool useScanLog_ = false; 
+    double scanLogQuantization_ = 0.001; // [m]
+
+    MapSyncScheduler map_sync_scheduler_; // to rank and rate-limit the missing scans sent to the teammates 
+
     //! Point cloud counter.
     uint32_t counter_ = 0;
 
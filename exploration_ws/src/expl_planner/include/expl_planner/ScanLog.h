@@ -0,0 +1,121 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SCAN_LOG_H_
+#define SCAN_LOG_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+
+#include <boost/core/noncopyable.hpp>
+
+#include <pcl/PCLPointCloud2.h>
+
+
+namespace explplanner{
+
+///	\class ScanLog
+///	\author Luigi Freda
+///	\brief Append-only log of scans in a single memory-mapped file, with an in-memory index by scan id and scan pose.
+///	       Each record is a header (magic, id, stamp, pose, codec, sizes) followed by the payload: the cloud layout (fields, width, height, ...) and its data.
+///	       If the cloud has float x, y, z fields and all its points are finite, the coordinates are quantized with the log quantization step and
+///	       delta-coded as zig-zag varints (consecutive scan points are close); the other bytes of each point are stored verbatim. Otherwise, the data is stored raw.
+///	       Reading a scan is a lookup in the mapping plus the decoding (no file open/parse).
+///	\note  The coordinates are exact up to half the quantization step; all the other fields are bit-exact.
+///	       The log is truncated by open() as the scan indices restart from 0 in each run. The class is not thread-safe (ScanHistoryManager locks it).
+/// \todo
+///	\date
+///	\warning
+class ScanLog: private boost::noncopyable
+{
+public:
+
+    static const uint32_t kMagic;
+    static const double kDefaultQuantizationStep; // [m]
+
+    enum Codec
+    {
+        kCodecRaw = 0,
+        kCodecXyzDelta = 1
+    };
+
+    struct Entry
+    {
+        uint64_t offset;      // offset of the record header in the file
+        uint64_t recordSize;  // header + payload [bytes]
+        uint64_t stamp;       // cloud header stamp [us]
+        float position[3];    // scan pose
+    };
+
+public:
+
+    ScanLog();
+    ~ScanLog();
+
+    // create (or truncate) the log file
+    bool open(const std::string& filePath, double quantizationStep = kDefaultQuantizationStep);
+    void close();
+    bool isOpen() const { return fd_ >= 0; }
+
+    // append the scan with the given id and pose (an id can be appended once)
+    bool append(uint32_t id, const pcl::PCLPointCloud2& cloud, const float position[3]);
+
+    // decode the scan with the given id
+    bool read(uint32_t id, pcl::PCLPointCloud2& cloud);
+
+    bool contains(uint32_t id) const { return index_.count(id) > 0; }
+    size_t size() const { return index_.size(); }
+
+    // closest logged scan pose to (x,y,z)
+    bool getClosestScan(float x, float y, float z, uint32_t& id, float& squaredDistance) const;
+
+    uint64_t getFileSize() const { return fileSize_; }
+    uint64_t getRawDataSize() const { return rawDataSize_; } // sum of the data sizes of the appended clouds
+
+protected:
+
+    bool remap();
+
+    static void encode(const pcl::PCLPointCloud2& cloud, double quantizationStep, std::vector<uint8_t>& payload, uint32_t& codec);
+    static bool decode(const uint8_t* payload, size_t payloadSize, uint32_t codec, pcl::PCLPointCloud2& cloud);
+
+protected:
+
+    std::string filePath_;
+    int fd_;
+
+    uint8_t* map_;       // read-only shared mapping of the file
+    uint64_t mapSize_;
+    uint64_t fileSize_;
+    uint64_t rawDataSize_;
+
+    double quantizationStep_; // [m]
+
+    std::map<uint32_t, Entry> index_;
+
+    std::vector<uint8_t> buffer_; // reused encoding buffer
+};
+
+} // namespace explplanner
+
+
+#endif //SCAN_LOG_H_
@@ -28,6 +28,7 @@
 #include <math.h>
 #include <limits>
 #include <algorithm>
+#include <deque>
 
 #include <eigen3/Eigen/StdVector>
 #include <eigen3/Eigen/Dense>
@@ -57,6 +58,7 @@
 #include <sensor_msgs/PointCloud2.h>
 
 #include <path_planner/KdTreeFLANN.h>
+#include <path_planner/PointHashIndex.h>
 
 #include <tf/transform_listener.h>
 #include <kindr/minimal/quat-transformation.h>
@@ -143,16 +145,26 @@ public: // getters
     void getPoseArrayMessage(geometry_msgs::PoseArray& message);
 
     bool getClosestScanInfo(const pcl::PointNormal& searchPoint, uint32_t& scanIndex, float& scanSquaredDistance);
+    
+    // pose of the last cloud accepted by insertPointCloud()
+    const pcl::PointNormal& getLastInsertedPose() const { return last_inserted_pose_; }
 
 protected: // private data
     // interaction mutex: to be locked every time a public method is called (setters, getters and planning)
     boost::recursive_mutex interaction_mutex;
 
-    pcl::PointCloud<pcl::PointNormal>::Ptr pcl_pose_;                      
-    std::vector<ros::Time> pcl_pose_stamp_;
-    int oldest_pose_idx_;
+    struct PoseEntry
+    {
+        pcl::PointNormal pose; // the scan index is stored in data[3]
+        ros::Time stamp;
+    };
 
-    pp::KdTreeFLANN<pcl::PointNormal, ::flann::L2_3D<float>> kdtree_pose_; // to search closest pose in spatial-time filter
+    std::deque<PoseEntry, Eigen::aligned_allocator<PoseEntry> > poses_; // time-ordered ring buffer of the stored poses (the oldest in front)
+    uint64_t first_pose_id_;  // id of poses_.front(): poses_[i] has id first_pose_id_ + i
+    ros::Time last_pose_stamp_;
+    pcl::PointNormal last_inserted_pose_;
+
+    pp::PointHashIndex<pcl::PointNormal> pose_index_; // to search closest pose in spatial-time filter (cell size = dist_pose_thres_)
 
     SpaceTimeFilterParams params_;
 
@@ -21,7 +21,12 @@
 #ifndef TEAM_MODEL_H_
 #define TEAM_MODEL_H_
 
+#include <stdint.h>
+#include <math.h>
 #include <iostream>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
 
 #include <eigen3/Eigen/Dense>
 #include <eigen3/Eigen/StdVector>
@@ -51,6 +56,7 @@ public:  // planning information
     Eigen::Vector3d goal;    
     nav_msgs::Path path; 
     double path_length;  // nav cost 
+    double path_geometric_length; // length of path, computed once when the path is set 
     ros::Time timestamp;
     
     bool bNoInformation;     
@@ -63,6 +69,74 @@ public: // deployment information
 };
 
 
+///\class TeamConflictIndex 
+///\brief Spatial index of the teammates' goals, positions and path segments for conflict checks.
+///       The items are bucketed in a 2D (x,y) hash grid whose cells are as large as the conflict distance, so a 
+///       query only tests the items of the few cells around it. Points and segments are tested as spheres and 
+///       capsules (swept spheres) of radius equal to the conflict distance.
+///\author Luigi Freda
+class TeamConflictIndex
+{
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    
+    enum ItemType
+    {
+        kGoal = 0, 
+        kPosition, 
+        kPathSegment
+    };
+    
+    struct Item
+    {
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+        
+        Eigen::Vector3d a;   // point, or first point of the segment
+        Eigen::Vector3d b;   // = a for points 
+        int robot_id;
+        ItemType type; 
+        double path_length;  // nav cost of the robot plan (for goals)
+    };
+    
+public:
+    
+    TeamConflictIndex(double cell_size = 3.);
+    
+    void clear(double cell_size); 
+    
+    void addPoint(const Eigen::Vector3d& point, int robot_id, ItemType type, double path_length = -1);
+    void addSegment(const Eigen::Vector3d& a, const Eigen::Vector3d& b, int robot_id);
+    
+    // get the items whose distance from the segment [a,b] is smaller than radius (a point is the segment [a,a])
+    void query(const Eigen::Vector3d& a, const Eigen::Vector3d& b, double radius, std::vector<const Item*>& items);
+    
+    bool empty() const { return items_.empty(); }
+    
+public: 
+    
+    // distance between the segments [p0,p1] and [q0,q1]
+    static double segmentSegmentDistance(const Eigen::Vector3d& p0, const Eigen::Vector3d& p1, const Eigen::Vector3d& q0, const Eigen::Vector3d& q1);
+    
+protected:
+    
+    inline int getCellCoord(double val) const { return (int)floor(val*cell_size_inv_); } 
+    static inline int64_t getKey(int ix, int iy) { return (int64_t(ix) << 32) ^ (int64_t(iy) & 0xffffffff); }
+    
+    void addItem(const Item& item);
+    
+protected:
+    
+    double cell_size_; 
+    double cell_size_inv_;
+    
+    std::vector<Item, Eigen::aligned_allocator<Item> > items_;
+    boost::unordered_map<int64_t, std::vector<int> > cells_;  // cell key -> indices in items_
+    
+    std::vector<int> visit_stamps_; // for visiting each item once per query 
+    int visit_stamp_; 
+};
+
+
 ///\class TeamModel 
 ///\brief 
 ///\author Luigi Freda
@@ -88,9 +162,21 @@ public:
     
     bool IsNodeConflict();
     
+    // does the point conflict with the teammates' goals, positions or (if path conflicts are checked) paths? 
+    // e.g. for checking the nodes of the exploration tree 
+    bool IsPointConflict(const Eigen::Vector3d& point); 
+    
+    // does the swept capsule of the path (radius: conflict distance) overlap the teammates' paths? 
+    bool IsPathConflict(const nav_msgs::Path& path);
+    
 public: // setters 
     
-    void setMyRobotId(const int& my_robot_id) { my_robot_id_ = my_robot_id; }
+    void setMyRobotId(const int& my_robot_id) 
+    { 
+        boost::recursive_mutex::scoped_lock locker(mutex_);
+        my_robot_id_ = my_robot_id; 
+        b_index_dirty_ = true;
+    }
     
     void setNumRobots(const int& num_robots);
     
@@ -101,7 +187,15 @@ public: // setters
     
     void setRobotMessage(const exploration_msgs::ExplorationRobotMessage::ConstPtr msg, bool isMsgDirect = false);
     
-    void setConflictDistance(double distance) { conflict_distance_ = distance; }
+    void setConflictDistance(double distance) 
+    { 
+        boost::recursive_mutex::scoped_lock locker(mutex_);
+        conflict_distance_ = distance; 
+        b_index_dirty_ = true;
+    }
+    
+    // check my goal against the teammates' paths in IsNodeConflict() too 
+    void setCheckPathConflicts(bool val) { b_check_path_conflicts_ = val; }
 
 public: 
     
@@ -116,7 +210,10 @@ protected:
     
     void checkForRobotId(int robot_id); 
     
-    double computePathLength(const nav_msgs::Path& path);
+    static double computePathLength(const nav_msgs::Path& path);
+    
+    // rebuild the conflict index if the team data changed 
+    void updateIndex();
 
 protected:
 
@@ -128,6 +225,12 @@ protected:
     
     double conflict_distance_;
     std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> > conflicting_nodes_; 
+    
+    bool b_check_path_conflicts_; 
+    
+    TeamConflictIndex index_; // teammates' goals, positions and paths 
+    bool b_index_dirty_;
+    std::vector<const TeamConflictIndex::Item*> query_items_;
 };
 
 
@@ -48,6 +48,9 @@
 #include <octomap_world/octomap_manager.h>
 
 #include <multiagent_collision_check/Segment.h>
+#include <multiagent_collision_check/segment_index.h>
+
+#include <EsdfMapAdapter.h> // from path_planner
 
 #include "ExplorationParams.h"
 
@@ -75,6 +78,7 @@ public:
 
     double gain_; // total gain along the branch 
     double local_gain_; // local gain 
+    uint64_t local_gain_version_; // map version of the last local gain evaluation (0: none), see OctomapWorld::getMapVersion()
     double distance_; // distance from root 
 
     //double neighbors_radius_; // max distance to neighbor 
@@ -100,6 +104,8 @@ class TreeBase
 {
 public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW    
+  
+  static const size_t kMaxSnapshotVoxels; // computeGains() uses the octree if the snapshot would be larger
     
 protected:
      
@@ -111,10 +117,12 @@ protected:
   Node<StateVec> * selectedNode_;
   //mesh::StlMesh * mesh_;
   std::shared_ptr<volumetric_mapping::OctomapManager> p_octomap_manager_; 
+  std::shared_ptr<EsdfMapAdapter> p_esdf_map_; // optional backend of the collision checks (see params_.bUseEsdf_)
   StateVec root_;
   StateVec exact_root_;
   std::vector<std::vector<Eigen::Vector3d,Eigen::aligned_allocator<Eigen::Vector3d> >*> segments_;
   std::vector<std::string> agentNames_;
+  multiagent::SegmentIndex segmentIndex_; // grid index of segments_ for the collision checks (agent i -> segments_[i])
   int robot_id_; 
       
 public:
@@ -166,8 +174,47 @@ public:
   
   void setRobotId(int id){ robot_id_ = id; }   
   
+  void setEsdfMap(const std::shared_ptr<EsdfMapAdapter>& p_esdf_map) { p_esdf_map_ = p_esdf_map; }
+  
+  // gain of the voxels within params_.gainRange_ which are visible from the state (see params_.bGainRaycast_); it sets the best orientation state[3]
   double gain(StateVec& state);  
   
+  // as gain() but the octomap is not locked: the caller must hold p_octomap_manager_->interaction_mutex; 
+  // the octomap is only read, hence many threads can call it concurrently while a single thread holds the lock
+  double computeGain(StateVec& state);
+  
+  // compute with num_threads threads the local gains of the nodes (and set their versions); with params_.bGainSnapshot_ (and the cube gain), 
+  // the voxels of the gain regions of all the nodes are first copied into a dense snapshot, which is then read without searching the octree 
+  // N.B.: the caller must hold p_octomap_manager_->interaction_mutex
+  void computeGains(const std::vector<Node<StateVec>*>& nodes, int num_threads);
+  
+  // true if some voxel of the gain region of the state may have changed after the map version (i.e. a gain computed at that version may be stale)
+  // N.B.: the caller must hold p_octomap_manager_->interaction_mutex
+  bool isGainRegionChanged(const StateVec& state, uint64_t version) const;
+  
+protected:
+  
+  // status of the segment swept by the box: with params_.bUseEsdf_ (and a received ESDF map) the circumscribed sphere of the box is traced 
+  // in the ESDF map (O(1) queries), otherwise the octomap voxels of the swept box are checked 
+  volumetric_mapping::OctomapManager::CellStatus getLineStatusBoundingBox(const Eigen::Vector3d& start, const Eigen::Vector3d& end, 
+                                                                           const Eigen::Vector3d& bounding_box_size) const;
+  
+  // cube gain: it visits each voxel of the cube of half-size params_.gainRange_ and checks its visibility with a raycast from the state
+  double gainCube(StateVec& state);
+  
+  // ray-cast gain: it casts the rays of a spherical grid of directions from the state and walks the voxels of each ray once (up to the first occupied one); 
+  // the angular step is set so that the rays are spaced by the octomap resolution at params_.gainRange_, each voxel is counted once
+  double gainRaycast(StateVec& state);
+  
+  // cube gain computed on a snapshot which covers the gain region of the state (same voxels and visibility rays as gainCube())
+  double gainSnapshot(StateVec& state, const volumetric_mapping::OctomapManager::OccupancySnapshot& snapshot) const;
+  
+  // true if an occupied voxel of the snapshot occludes end from origin (the voxels of the ray are walked as by octomap computeRayKeys())
+  static bool isOccludedInSnapshot(const volumetric_mapping::OctomapManager::OccupancySnapshot& snapshot, const Eigen::Vector3d& origin, const Eigen::Vector3d& end);
+  
+  // gain of a visible cell 
+  double cellGain(volumetric_mapping::OctomapManager::CellStatus status, double probability) const;
+  
 };
 
 
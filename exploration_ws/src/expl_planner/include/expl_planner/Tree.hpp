@@ -39,7 +39,12 @@
 
 #include "Tree.h"
 #include "GainAngleHistogram.h"
+#include "PlanningProfiler.h"
 
+#include <limits>
+
+template<typename StateVec>
+const size_t explplanner::TreeBase<StateVec>::kMaxSnapshotVoxels = 20000000; // 100 MB
 
 template<typename StateVec>
 explplanner::Node<StateVec>::Node()
@@ -48,6 +53,7 @@ explplanner::Node<StateVec>::Node()
   distance_ = DBL_MAX;
   gain_ = 0.0;
   local_gain_ = 0.0; 
+  local_gain_version_ = 0;
   
   //neighbors_radius_ = 0.;
   
@@ -124,6 +130,28 @@ void explplanner::TreeBase<StateVec>::setParams(const ExplParams& params)
   params_ = params; 
 }
 
+template<typename StateVec>
+volumetric_mapping::OctomapManager::CellStatus explplanner::TreeBase<StateVec>::getLineStatusBoundingBox(const Eigen::Vector3d& start, const Eigen::Vector3d& end, 
+                                                                                                        const Eigen::Vector3d& bounding_box_size) const
+{
+  PlanningProfiler::ScopedPhase profiler_phase(PlanningProfiler::kCollision);
+  
+  if (params_.bUseEsdf_ && p_esdf_map_ && p_esdf_map_->isReady())
+  {
+    boost::recursive_mutex::scoped_lock locker(p_esdf_map_->getMutex());
+    switch (p_esdf_map_->getLineStatus(start, end, 0.5 * bounding_box_size.norm()))
+    {
+    case EsdfMapAdapter::kFree:
+      return volumetric_mapping::OctomapManager::CellStatus::kFree; /// < EXIT POINT
+    case EsdfMapAdapter::kOccupied:
+      return volumetric_mapping::OctomapManager::CellStatus::kOccupied; /// < EXIT POINT
+    default:
+      return volumetric_mapping::OctomapManager::CellStatus::kUnknown; /// < EXIT POINT
+    }
+  }
+  return p_octomap_manager_->getLineStatusBoundingBox(start, end, bounding_box_size);
+}
+
 template<typename StateVec>
 int explplanner::TreeBase<StateVec>::getCounter()
 {
@@ -166,6 +194,7 @@ void explplanner::TreeBase<StateVec>::evade(const multiagent_collision_check::Se
   for(typename std::vector<geometry_msgs::Pose>::const_iterator it = segmentMsg.poses.begin(); it != segmentMsg.poses.end(); it++) {
     segments_[i]->push_back(Eigen::Vector3d(it->position.x, it->position.y, it->position.z));
   }
+  segmentIndex_.setAgentPath(i, *segments_[i]);
 }
 
 template<typename StateVec>
@@ -190,8 +219,192 @@ explplanner::Node<StateVec>* explplanner::TreeBase<StateVec>::getSelectedNode()
 template<typename StateVec>
 double explplanner::TreeBase<StateVec>::gain(StateVec& state)
 {
-    //std::cout << "RrtTree::gain()" << std::endl;    
+    PlanningProfiler::ScopedPhase profiler_phase(PlanningProfiler::kGain);
     boost::recursive_mutex::scoped_lock locker(p_octomap_manager_->interaction_mutex);
+    return computeGain(state);
+}
+
+template<typename StateVec>
+double explplanner::TreeBase<StateVec>::computeGain(StateVec& state)
+{
+    if (params_.bGainRaycast_)
+    {
+        return gainRaycast(state);
+    }
+    else
+    {
+        return gainCube(state);
+    }
+}
+
+template<typename StateVec>
+void explplanner::TreeBase<StateVec>::computeGains(const std::vector<Node<StateVec>*>& nodes, int num_threads)
+{
+    const int num_nodes = nodes.size();
+    if (num_nodes == 0) return; /// < EXIT POINT
+    
+    PlanningProfiler::ScopedPhase profiler_phase(PlanningProfiler::kGain);
+    
+    const uint64_t map_version = p_octomap_manager_->getMapVersion();
+    
+    volumetric_mapping::OctomapManager::OccupancySnapshot snapshot;
+    bool bSnapshot = false; 
+    if (params_.bGainSnapshot_ && !params_.bGainRaycast_)
+    {
+        // box of the gain regions of the nodes (the origins are raised by one voxel), clipped to the exploration box 
+        const double disc = p_octomap_manager_->getResolution();
+        const Eigen::Vector3d margin = Eigen::Vector3d::Constant(params_.gainRange_ + disc);
+        Eigen::Vector3d min_point = Eigen::Vector3d::Constant(std::numeric_limits<double>::max());
+        Eigen::Vector3d max_point = Eigen::Vector3d::Constant(std::numeric_limits<double>::lowest());
+        for (int ii = 0; ii < num_nodes; ii++)
+        {
+            const Eigen::Vector3d point(nodes[ii]->state_[0], nodes[ii]->state_[1], nodes[ii]->state_[2]);
+            min_point = min_point.cwiseMin(point);
+            max_point = max_point.cwiseMax(point);
+        }
+        min_point = (min_point - margin).cwiseMax(Eigen::Vector3d(params_.minX_, params_.minY_, params_.minZ_) - Eigen::Vector3d::Constant(disc));
+        max_point = (max_point + margin).cwiseMin(Eigen::Vector3d(params_.maxX_, params_.maxY_, params_.maxZ_) + Eigen::Vector3d::Constant(disc));
+        
+        bSnapshot = p_octomap_manager_->getOccupancySnapshot(min_point, max_point, kMaxSnapshotVoxels, &snapshot);
+        if (!bSnapshot)
+        {
+            std::cout << "TreeBase::computeGains() - WARNING - snapshot too large, using the octree" << std::endl;
+        }
+    }
+    
+    #pragma omp parallel for num_threads(num_threads) schedule(dynamic, 1)
+    for (int ii = 0; ii < num_nodes; ii++)
+    {
+        Node<StateVec>* node = nodes[ii];
+        node->local_gain_ = bSnapshot ? gainSnapshot(node->state_, snapshot) : computeGain(node->state_);
+        node->local_gain_version_ = map_version;
+    }
+}
+
+template<typename StateVec>
+bool explplanner::TreeBase<StateVec>::isGainRegionChanged(const StateVec& state, uint64_t version) const
+{
+    const double half_size = params_.gainRange_ + p_octomap_manager_->getResolution(); // the gain origin is raised by one voxel 
+    const Eigen::Vector3d center(state[0], state[1], state[2]);
+    return p_octomap_manager_->isBoxChangedSince(center - Eigen::Vector3d::Constant(half_size), center + Eigen::Vector3d::Constant(half_size), version);
+}
+
+template<typename StateVec>
+double explplanner::TreeBase<StateVec>::cellGain(volumetric_mapping::OctomapManager::CellStatus status, double probability) const
+{
+    const double occupied_occupancy_scale = params_.clampingThresMax_ - params_.occupancyThres_;
+    const double free_occupancy_scale = params_.occupancyThres_ - params_.clampingThresMin_;
+    
+    if (status == volumetric_mapping::OctomapManager::CellStatus::kUnknown)
+    {
+        // TODO: Add probabilistic gain
+        return params_.igUnmapped_;
+    }
+    else if (status == volumetric_mapping::OctomapManager::CellStatus::kOccupied)
+    {
+        if (probability > params_.occupancyThres_ )
+        {
+            return params_.igOccupied_ * (params_.igProbabilistic_ / occupied_occupancy_scale) * (params_.clampingThresMax_ - probability); 
+        }
+    }
+    else
+    {
+        // < N.B. probability{cell is free} = 1.0 - probability
+        if (probability > params_.clampingThresMin_)
+        {                        
+            return params_.igFree_ * (params_.igProbabilistic_ / free_occupancy_scale) * (probability - params_.clampingThresMin_ );
+        }
+    }
+    return 0; 
+}
+
+template<typename StateVec>
+double explplanner::TreeBase<StateVec>::gainRaycast(StateVec& state)
+{
+    typedef volumetric_mapping::OctomapManager::RayCell RayCell;
+    
+    double gain = 0.0;
+    const double disc = p_octomap_manager_->getResolution();
+    const double disc2 = disc * disc; 
+    const double disc3 = disc * disc2; 
+    
+    const Eigen::Vector3d origin(state[0], state[1], state[2] + disc); // as in gainCube()
+    
+    const double range = params_.gainRange_ - disc; // as in gainCube()
+    const double range2 = range*range; 
+    if (range <= 0) return 0; /// < EXIT POINT
+    
+    // as in gainCube(), a cell is discarded if its z offset [m] is larger than maxCosVert
+    const double minAngleWrtVert = (M_PI/180.) * (90. - 0.5*params_.cameraVerticalFov_);
+    const double maxCosVert = cos(minAngleWrtVert);
+    
+    // spherical grid of directions: the rays are spaced by about disc at the max range 
+    const double angle_step = disc/range; 
+    const int num_elevations = std::max((int)ceil(M_PI/angle_step), 1);
+    const double elevation_step = M_PI/num_elevations; 
+    
+    GainAngleHistogram gainAngleHistogram; 
+    
+    octomap::KeySet visited_keys; // each cell is counted once even if it is crossed by many rays (close to the origin)
+    octomap::KeyRay key_ray;
+    std::vector<RayCell> cells; 
+    
+    for (int ie = 0; ie < num_elevations; ie++)
+    {
+        const double elevation = -0.5*M_PI + (ie + 0.5)*elevation_step;
+        const double cos_elevation = cos(elevation);
+        const double sin_elevation = sin(elevation);
+        
+        const int num_azimuths = std::max((int)ceil(2*M_PI*cos_elevation/angle_step), 1);
+        const double azimuth_step = 2*M_PI/num_azimuths;
+        
+        for (int ia = 0; ia < num_azimuths; ia++)
+        {
+            const double azimuth = ia*azimuth_step;
+            const Eigen::Vector3d ray_dir(cos_elevation*cos(azimuth), cos_elevation*sin(azimuth), sin_elevation);
+            
+            p_octomap_manager_->castVisibilityRay(origin, origin + range*ray_dir, &key_ray, &cells);
+            
+            for (size_t ii = 0; ii < cells.size(); ii++)
+            {
+                const RayCell& cell = cells[ii];
+                if (!visited_keys.insert(cell.key).second) continue; /// < CONTINUE
+                
+                const Eigen::Vector3d dir = cell.center - origin;
+                const double dirNorm2 = dir.squaredNorm();
+                if (dirNorm2 > range2) continue; /// < CONTINUE
+                
+                if (dir[2] > maxCosVert) continue; /// < CONTINUE
+                
+                // the cells out of the bounding box are not counted (as in gainCube()) but they do not stop the ray 
+                if ( (cell.center[0] < params_.minX_) || (cell.center[0] >= params_.maxX_) || 
+                     (cell.center[1] < params_.minY_) || (cell.center[1] >= params_.maxY_) || 
+                     (cell.center[2] < params_.minZ_) || (cell.center[2] >= params_.maxZ_) ) continue; /// < CONTINUE
+                
+                const double cell_gain = cellGain(cell.status, cell.probability); 
+                
+                // if the dirNorm is too small then the cell contributes to all the angles
+                if(dirNorm2 > disc2)  
+                {
+                    gainAngleHistogram.add(atan2(dir[1],dir[0]),cell_gain);
+                }
+                gain += cell_gain; 
+            }
+        }
+    }
+    
+    state[3]= gainAngleHistogram.getBestOrientation();
+    
+    // Scale with volume
+    gain *= disc3;
+    
+    return gain;
+}
+
+template<typename StateVec>
+double explplanner::TreeBase<StateVec>::gainCube(StateVec& state)
+{
+    //std::cout << "RrtTree::gain()" << std::endl;    
         
     // This function computes the gain
     double gain = 0.0;
@@ -205,9 +418,6 @@ double explplanner::TreeBase<StateVec>::gain(StateVec& state)
     const double range = params_.gainRange_ - disc; // we remove disc (the resolution in order to avoid counting possible unreachable cells)   
     const double range2 = range*range; 
 
-    static const double occupied_occupancy_scale = params_.clampingThresMax_ - params_.occupancyThres_;
-    static const double free_occupancy_scale = params_.occupancyThres_ - params_.clampingThresMin_;
-
     // TODO: here we can take into account the current robot pitch 
     static const double minAngleWrtVert = (M_PI/180.) * (90. - 0.5*params_.cameraVerticalFov_);
     static const double maxCosVert = cos(minAngleWrtVert);
@@ -276,62 +486,20 @@ double explplanner::TreeBase<StateVec>::gain(StateVec& state)
 
                 // Check cell status and add to the gain considering the corresponding factor.
                 double probability;
-                double cellGain = 0; 
+                double cell_gain = 0; 
                 volumetric_mapping::OctomapManager::CellStatus node = p_octomap_manager_->getCellProbabilityPoint(vec, &probability);
-                if (node == volumetric_mapping::OctomapManager::CellStatus::kUnknown)
+                // Rayshooting to evaluate inspectability of cell
+                if (volumetric_mapping::OctomapManager::CellStatus::kOccupied != this->p_octomap_manager_->getVisibility(origin, vec, false))
                 {
-                    // Rayshooting to evaluate inspectability of cell
-                    if (volumetric_mapping::OctomapManager::CellStatus::kOccupied != this->p_octomap_manager_->getVisibility(origin, vec, false))
-                    {
-                        //gain += params_.igUnmapped_;
-                        cellGain = params_.igUnmapped_;
-                        // TODO: Add probabilistic gain
-                        // gain += params_.igProbabilistic_ * PROBABILISTIC_MODEL(probability);
-                    }
-                }
-                else if (node == volumetric_mapping::OctomapManager::CellStatus::kOccupied)
-                {
-                    // Rayshooting to evaluate inspectability of cell
-                    if (volumetric_mapping::OctomapManager::CellStatus::kOccupied != this->p_octomap_manager_->getVisibility(origin, vec, false))
-                    {
-                        //gain += params_.igOccupied_;
-
-                        // probabilistic gain
-                        // gain += params_.igProbabilistic_ * PROBABILISTIC_MODEL(probability);
-                        //if (probability > params_.clamping_thres_min)
-                        if (probability > params_.occupancyThres_ )
-                        {
-                            //gain += params_.igOccupied_ * (params_.igProbabilistic_ / occupied_occupancy_scale) * (params_.clamping_thres_max - probability);
-                            cellGain = params_.igOccupied_ * (params_.igProbabilistic_ / occupied_occupancy_scale) * (params_.clampingThresMax_ - probability); 
-                        }
-
-                    }
-                }
-                else
-                {
-                    // Rayshooting to evaluate inspectability of cell
-                    if (volumetric_mapping::OctomapManager::CellStatus::kOccupied != this->p_octomap_manager_->getVisibility(origin, vec, false))
-                    {
-                        //gain += params_.igFree_;
-
-                        // probabilistic gain
-                        // gain += params_.igProbabilistic_ * PROBABILISTIC_MODEL(probability);
-                        // < N.B. probability{cell is free} = 1.0 - probability
-                        //gain += params_.igFree_ * (params_.igProbabilistic_ / free_occupancy_scale) * (1.0 - probability - params_.clamping_thres_min );
-                        if (probability > params_.clampingThresMin_)
-                        {                        
-                            //gain += params_.igFree_ * (params_.igProbabilistic_ / free_occupancy_scale) * (probability - params_.clamping_thres_min );
-                            cellGain = params_.igFree_ * (params_.igProbabilistic_ / free_occupancy_scale) * (probability - params_.clampingThresMin_ );
-                        }
-                    }
+                    cell_gain = cellGain(node, probability);
                 }
                 
                 // if the dirNorm is too small then the cell contributes to all the angles
                 if(dirNorm2 > disc2)  
                 {
-                    gainAngleHistogram.add(atan2(dir[1],dir[0]),cellGain);
+                    gainAngleHistogram.add(atan2(dir[1],dir[0]),cell_gain);
                 }
-                gain += cellGain; 
+                gain += cell_gain; 
             }
         }
     }
@@ -355,4 +523,119 @@ double explplanner::TreeBase<StateVec>::gain(StateVec& state)
     return gain;
 }
 
+template<typename StateVec>
+bool explplanner::TreeBase<StateVec>::isOccludedInSnapshot(const volumetric_mapping::OctomapManager::OccupancySnapshot& snapshot, const Eigen::Vector3d& origin, const Eigen::Vector3d& end)
+{
+    const double res = snapshot.resolution;
+    
+    int current[3], end_voxel[3], step[3];
+    double tMax[3], tDelta[3];
+    
+    for (int i = 0; i < 3; i++)
+    {
+        current[i] = snapshot.coordToVoxel(origin[i]);
+        end_voxel[i] = snapshot.coordToVoxel(end[i]);
+    }
+    if ((current[0] == end_voxel[0]) && (current[1] == end_voxel[1]) && (current[2] == end_voxel[2])) return false; /// < EXIT POINT (empty ray)
+    
+    Eigen::Vector3d direction = end - origin;
+    const double length = direction.norm();
+    direction /= length;
+    
+    for (int i = 0; i < 3; i++)
+    {
+        step[i] = (direction[i] > 0) ? 1 : ((direction[i] < 0) ? -1 : 0);
+        if (step[i] != 0)
+        {
+            const double voxelBorder = (current[i] + 0.5) * res + step[i] * 0.5 * res; 
+            tMax[i] = (voxelBorder - origin[i]) / direction[i];
+            tDelta[i] = res / fabs(direction[i]);
+        }
+        else
+        {
+            tMax[i] = std::numeric_limits<double>::max();
+            tDelta[i] = std::numeric_limits<double>::max();
+        }
+    }
+    
+    // walk the voxels from the origin one to the end one (excluded)
+    while (true)
+    {
+        const int index = snapshot.getIndex(current[0], current[1], current[2]);
+        if ((index >= 0) && (snapshot.status[index] == volumetric_mapping::OctomapManager::CellStatus::kOccupied)) return true; /// < EXIT POINT
+        
+        const int dim = (tMax[0] < tMax[1]) ? ((tMax[0] < tMax[2]) ? 0 : 2) : ((tMax[1] < tMax[2]) ? 1 : 2);
+        current[dim] += step[dim];
+        tMax[dim] += tDelta[dim];
+        
+        if ((current[0] == end_voxel[0]) && (current[1] == end_voxel[1]) && (current[2] == end_voxel[2])) return false; /// < EXIT POINT
+        if (std::min(std::min(tMax[0], tMax[1]), tMax[2]) > length) return false; /// < EXIT POINT
+    }
+}
+
+template<typename StateVec>
+double explplanner::TreeBase<StateVec>::gainSnapshot(StateVec& state, const volumetric_mapping::OctomapManager::OccupancySnapshot& snapshot) const
+{
+    double gain = 0.0;
+    const double disc = snapshot.resolution;
+    const double disc2 = disc * disc; 
+    const double disc3 = disc * disc2; 
+    
+    const Eigen::Vector3d origin(state[0], state[1], state[2] + disc); // as in gainCube()
+    Eigen::Vector3d vec;
+    
+    const double range = params_.gainRange_ - disc; // as in gainCube()
+    const double range2 = range*range; 
+    
+    const double minAngleWrtVert = (M_PI/180.) * (90. - 0.5*params_.cameraVerticalFov_);
+    const double maxCosVert = cos(minAngleWrtVert);
+    
+    GainAngleHistogram gainAngleHistogram; 
+
+    // same iteration as gainCube()
+    for (vec[0] = std::max(state[0] - params_.gainRange_, params_.minX_);
+            vec[0] < std::min(state[0] + params_.gainRange_, params_.maxX_); vec[0] += disc)
+    {
+        for (vec[1] = std::max(state[1] - params_.gainRange_, params_.minY_);
+                vec[1] < std::min(state[1] + params_.gainRange_, params_.maxY_); vec[1] += disc)
+        {
+            for (vec[2] = std::max(state[2] - params_.gainRange_, params_.minZ_);
+                    vec[2] < std::min(state[2] + params_.gainRange_, params_.maxZ_); vec[2] += disc)
+            {
+                const Eigen::Vector3d dir = vec - origin;
+                const double dirNorm2 = dir.squaredNorm();
+                if (dirNorm2 > range2) continue; /// < CONTINUE
+                
+                if (dir[2] > maxCosVert) continue; /// < CONTINUE
+                
+                // voxels out of the snapshot are unknown
+                const int index = snapshot.getIndex(snapshot.coordToVoxel(vec[0]), snapshot.coordToVoxel(vec[1]), snapshot.coordToVoxel(vec[2]));
+                const volumetric_mapping::OctomapManager::CellStatus status = (index >= 0) ? 
+                        (volumetric_mapping::OctomapManager::CellStatus)snapshot.status[index] : volumetric_mapping::OctomapManager::CellStatus::kUnknown;
+                const double probability = (index >= 0) ? snapshot.probability[index] : -1.0;
+                
+                double cell_gain = 0; 
+                if (!isOccludedInSnapshot(snapshot, origin, vec))
+                {
+                    cell_gain = cellGain(status, probability);
+                }
+                
+                // if the dirNorm is too small then the cell contributes to all the angles
+                if(dirNorm2 > disc2)  
+                {
+                    gainAngleHistogram.add(atan2(dir[1],dir[0]),cell_gain);
+                }
+                gain += cell_gain; 
+            }
+        }
+    }
+    
+    state[3]= gainAngleHistogram.getBestOrientation();
+    
+    // Scale with volume
+    gain *= disc3;
+    
+    return gain;
+}
+
 #endif
@@ -0,0 +1,195 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR. 
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef VOXEL_BUCKET_INDEX_H_
+#define VOXEL_BUCKET_INDEX_H_
+
+#include <stdint.h>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
+
+#include <Eigen/Core>
+
+#include <pcl/point_cloud.h>
+#include <pcl/common/point_tests.h>
+
+namespace explplanner
+{
+
+///	\class VoxelBucketIndex
+///	\author Luigi Freda
+///	\brief Spatial index of a point cloud: the point indices are bucketed in a voxel grid.
+///        It is built once per cloud and then an axis-aligned box crop only visits the buckets overlapping the box:
+///        the points of the buckets inside the box are taken without any test, only the points of the border buckets 
+///        are checked. The crop returns the indices of the points (as pcl::CropBox::filter(std::vector<int>&)), which 
+///        can be applied to any cloud with the same points (e.g. the utility cloud of the traversability cloud).
+///	\note the indexed cloud must not change after build() 
+/// \todo 
+///	\date
+///	\warning
+template<typename PointT>
+class VoxelBucketIndex
+{
+public:
+
+    VoxelBucketIndex(float bucket_size = 1.f):bucket_size_(bucket_size),bucket_size_inv_(1.f/bucket_size),num_points_(0)
+    {}
+
+    // index the finite points of the cloud 
+    void build(const pcl::PointCloud<PointT>& cloud)
+    {
+        buckets_.clear(); 
+        bucket_map_.clear();
+        indices_.clear();
+        num_points_ = cloud.size();
+
+        // sort the point indices by bucket key
+        std::vector<std::pair<uint64_t,int> > keyed_indices;
+        keyed_indices.reserve(cloud.size());
+        for(size_t ii=0; ii < cloud.size(); ii++)
+        {
+            const PointT& point = cloud.points[ii];
+            if(!pcl::isFinite(point)) continue; 
+            keyed_indices.push_back(std::make_pair(getKey(getBucketCoord(point.x),getBucketCoord(point.y),getBucketCoord(point.z)), (int)ii));
+        }
+        std::sort(keyed_indices.begin(), keyed_indices.end());
+
+        // store the indices contiguously, bucket by bucket
+        indices_.resize(keyed_indices.size());
+        for(size_t ii=0; ii < keyed_indices.size(); ii++)
+        {
+            indices_[ii] = keyed_indices[ii].second;
+            if( (ii == 0) || (keyed_indices[ii].first != keyed_indices[ii-1].first) )
+            {
+                const PointT& point = cloud.points[indices_[ii]];
+                Bucket bucket; 
+                bucket.coords = Eigen::Vector3i(getBucketCoord(point.x),getBucketCoord(point.y),getBucketCoord(point.z));
+                bucket.begin = ii; 
+                bucket.end = ii;
+                if(buckets_.empty())
+                {
+                    min_coords_ = max_coords_ = bucket.coords;
+                }
+                else
+                {
+                    min_coords_ = min_coords_.cwiseMin(bucket.coords);
+                    max_coords_ = max_coords_.cwiseMax(bucket.coords);                    
+                }
+                bucket_map_[keyed_indices[ii].first] = buckets_.size();
+                buckets_.push_back(bucket);
+            }
+            buckets_.back().end = ii + 1;
+        }
+    }
+
+    // get the (sorted) indices of the points of cloud in the box [min_pt, max_pt]; cloud must be the indexed cloud
+    void cropBox(const pcl::PointCloud<PointT>& cloud, const Eigen::Vector3f& min_pt, const Eigen::Vector3f& max_pt, std::vector<int>& indices) const
+    {
+        indices.clear();
+        if(buckets_.empty()) return; /// < EXIT POINT 
+
+        const Eigen::Vector3i min_coords = Eigen::Vector3i(getBucketCoord(min_pt.x()),getBucketCoord(min_pt.y()),getBucketCoord(min_pt.z())).cwiseMax(min_coords_);
+        const Eigen::Vector3i max_coords = Eigen::Vector3i(getBucketCoord(max_pt.x()),getBucketCoord(max_pt.y()),getBucketCoord(max_pt.z())).cwiseMin(max_coords_);
+
+        for(int ix = min_coords.x(); ix <= max_coords.x(); ix++)
+        {
+            for(int iy = min_coords.y(); iy <= max_coords.y(); iy++)
+            {
+                for(int iz = min_coords.z(); iz <= max_coords.z(); iz++)
+                {
+                    typename boost::unordered_map<uint64_t,size_t>::const_iterator it = bucket_map_.find(getKey(ix,iy,iz));
+                    if(it == bucket_map_.end()) continue; 
+                    const Bucket& bucket = buckets_[it->second];
+
+                    // is the bucket inside the box? 
+                    const Eigen::Vector3f bucket_min = bucket.coords.template cast<float>()*bucket_size_;
+                    const Eigen::Vector3f bucket_max = bucket_min + Eigen::Vector3f::Constant(bucket_size_);
+                    if( (bucket_min.array() > min_pt.array()).all() && (bucket_max.array() < max_pt.array()).all() )
+                    {
+                        indices.insert(indices.end(), indices_.begin() + bucket.begin, indices_.begin() + bucket.end);
+                    }
+                    else
+                    {
+                        for(size_t jj = bucket.begin; jj < bucket.end; jj++)
+                        {
+                            const PointT& point = cloud.points[indices_[jj]];
+                            if( (point.x >= min_pt.x()) && (point.x <= max_pt.x()) &&
+                                (point.y >= min_pt.y()) && (point.y <= max_pt.y()) &&
+                                (point.z >= min_pt.z()) && (point.z <= max_pt.z()) )
+                            {
+                                indices.push_back(indices_[jj]);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        // same order of the points in the cloud 
+        std::sort(indices.begin(), indices.end());
+    }
+
+    // number of points of the indexed cloud 
+    size_t size() const { return num_points_; }
+
+    size_t getNumBuckets() const { return buckets_.size(); }
+
+protected:
+
+    struct Bucket
+    {
+        Eigen::Vector3i coords; 
+        size_t begin;  // range [begin,end) in indices_ 
+        size_t end;
+    };
+
+    inline int getBucketCoord(float val) const 
+    {
+        return (int)std::floor(val*bucket_size_inv_);
+    }
+
+    // 21 bits per coordinate 
+    static inline uint64_t getKey(int ix, int iy, int iz)
+    {
+        const int64_t kOffset = 1 << 20;
+        const uint64_t kMask = (1 << 21) - 1;
+        return ((uint64_t(ix + kOffset) & kMask) << 42) | ((uint64_t(iy + kOffset) & kMask) << 21) | (uint64_t(iz + kOffset) & kMask);
+    }
+
+protected:
+
+    float bucket_size_;     // [m]
+    float bucket_size_inv_; // [1/m]
+    size_t num_points_; 
+
+    std::vector<Bucket> buckets_; 
+    boost::unordered_map<uint64_t,size_t> bucket_map_; // bucket key -> position in buckets_
+    std::vector<int> indices_;  // point indices sorted by bucket 
+
+    Eigen::Vector3i min_coords_; // bounds of the bucket coordinates  
+    Eigen::Vector3i max_coords_;
+};
+
+} // namespace explplanner
+
+#endif // VOXEL_BUCKET_INDEX_H_
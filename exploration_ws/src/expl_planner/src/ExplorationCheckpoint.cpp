@@ -0,0 +1,224 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ExplorationCheckpoint.h"
+
+#include <fstream>
+#include <iomanip>
+#include <cstdio>
+#include <cmath>
+
+
+namespace explplanner{
+
+const int ExplorationCheckpoint::kVersion = 1;
+const std::string ExplorationCheckpoint::kOctomapFilename = "octomap.bt";
+const std::string ExplorationCheckpoint::kStateFilename = "state.txt";
+
+static const std::string kNoFrame = "-"; // written in place of an empty frame id 
+
+static void writeTreeNodes(std::ofstream& file, const ExplorationCheckpoint::TreeNodes& nodes)
+{
+    for(size_t ii=0; ii < nodes.size(); ii++)
+    {
+        const ExplorationCheckpoint::TreeNode& node = nodes[ii];
+        file << node.id << " " << node.parent_id << " " 
+             << node.state[0] << " " << node.state[1] << " " << node.state[2] << " " << node.state[3] << " " 
+             << node.gain << " " << node.local_gain << " " << (int)node.is_frontier << std::endl;
+    }
+}
+
+static bool readTreeNodes(std::ifstream& file, size_t num_nodes, ExplorationCheckpoint::TreeNodes& nodes)
+{
+    nodes.resize(num_nodes);
+    for(size_t ii=0; ii < num_nodes; ii++)
+    {
+        ExplorationCheckpoint::TreeNode& node = nodes[ii];
+        int is_frontier = 0; 
+        file >> node.id >> node.parent_id 
+             >> node.state[0] >> node.state[1] >> node.state[2] >> node.state[3] 
+             >> node.gain >> node.local_gain >> is_frontier;
+        node.is_frontier = (is_frontier != 0);
+    }
+    return !file.fail();
+}
+
+static bool readTag(std::ifstream& file, const std::string& tag)
+{
+    std::string str;
+    file >> str;
+    return !file.fail() && (str == tag);
+}
+
+ExplorationCheckpoint::ExplorationCheckpoint()
+{
+    clear();
+}
+
+void ExplorationCheckpoint::clear()
+{
+    stamp = ros::Time();
+    map_frame.clear();
+    fixed_frame.clear();
+    T_fixed_map.setIdentity();
+    expl_tree_nodes.clear();
+    expl_tree_current_id = 0;
+    frontier_tree_nodes.clear();
+    priority_points.clear();
+}
+
+bool ExplorationCheckpoint::save(const std::string& filename) const
+{
+    const std::string tmp_filename = filename + ".tmp";
+    std::ofstream file(tmp_filename.c_str());
+    if(!file.is_open())
+    {
+        ROS_ERROR_STREAM("ExplorationCheckpoint::save() - cannot open " << tmp_filename);
+        return false; /// < EXIT POINT
+    }
+    file << std::setprecision(17);
+    
+    const Eigen::Vector3d t = T_fixed_map.translation();
+    const Eigen::Quaterniond q(T_fixed_map.rotation());
+    
+    file << "expl_checkpoint " << kVersion << std::endl;
+    file << "stamp " << stamp.sec << " " << stamp.nsec << std::endl;
+    file << "map_frame " << (map_frame.empty() ? kNoFrame : map_frame) << std::endl;
+    file << "fixed_frame " << (fixed_frame.empty() ? kNoFrame : fixed_frame) << std::endl;
+    file << "T_fixed_map " << t.x() << " " << t.y() << " " << t.z() << " " << q.x() << " " << q.y() << " " << q.z() << " " << q.w() << std::endl;
+    
+    file << "expl_tree " << expl_tree_nodes.size() << " " << expl_tree_current_id << std::endl;
+    writeTreeNodes(file, expl_tree_nodes);
+    
+    file << "frontier_tree " << frontier_tree_nodes.size() << std::endl;
+    writeTreeNodes(file, frontier_tree_nodes);
+    
+    file << "priority_points " << priority_points.size() << std::endl;
+    for(size_t ii=0; ii < priority_points.size(); ii++)
+    {
+        const PriorityPointQueue::PriorityPoint& point = priority_points[ii];
+        file << point.id << " " << point.priority << " " << point.data.x << " " << point.data.y << " " << point.data.z << std::endl;
+    }
+    
+    file.close();
+    if(file.fail())
+    {
+        ROS_ERROR_STREAM("ExplorationCheckpoint::save() - cannot write " << tmp_filename);
+        return false; /// < EXIT POINT
+    }
+    
+    // the old checkpoint is replaced only once the new one is complete 
+    if(std::rename(tmp_filename.c_str(), filename.c_str()) != 0)
+    {
+        ROS_ERROR_STREAM("ExplorationCheckpoint::save() - cannot rename " << tmp_filename << " to " << filename);
+        return false; /// < EXIT POINT
+    }
+    return true;
+}
+
+bool ExplorationCheckpoint::load(const std::string& filename)
+{
+    clear();
+    
+    std::ifstream file(filename.c_str());
+    if(!file.is_open())
+    {
+        return false; /// < EXIT POINT : no checkpoint 
+    }
+    
+    int version = -1;
+    if(!readTag(file, "expl_checkpoint") || !(file >> version) || (version != kVersion))
+    {
+        ROS_ERROR_STREAM("ExplorationCheckpoint::load() - " << filename << " is not a checkpoint of version " << kVersion);
+        return false; /// < EXIT POINT
+    }
+    
+    bool b_ok = true; 
+    
+    b_ok = b_ok && readTag(file, "stamp") && (file >> stamp.sec >> stamp.nsec);
+    b_ok = b_ok && readTag(file, "map_frame") && (file >> map_frame);
+    b_ok = b_ok && readTag(file, "fixed_frame") && (file >> fixed_frame);
+    if(map_frame == kNoFrame) map_frame.clear();
+    if(fixed_frame == kNoFrame) fixed_frame.clear();
+    
+    Eigen::Vector3d t;
+    Eigen::Quaterniond q;
+    b_ok = b_ok && readTag(file, "T_fixed_map") && (file >> t.x() >> t.y() >> t.z() >> q.x() >> q.y() >> q.z() >> q.w());
+    if(b_ok) T_fixed_map = Eigen::Translation3d(t) * q.normalized();
+    
+    size_t num_nodes = 0;
+    b_ok = b_ok && readTag(file, "expl_tree") && (file >> num_nodes >> expl_tree_current_id);
+    b_ok = b_ok && readTreeNodes(file, num_nodes, expl_tree_nodes);
+    
+    b_ok = b_ok && readTag(file, "frontier_tree") && (file >> num_nodes);
+    b_ok = b_ok && readTreeNodes(file, num_nodes, frontier_tree_nodes);
+    
+    size_t num_points = 0;
+    b_ok = b_ok && readTag(file, "priority_points") && (file >> num_points);
+    if(b_ok)
+    {
+        priority_points.resize(num_points);
+        for(size_t ii=0; ii < num_points; ii++)
+        {
+            PriorityPointQueue::PriorityPoint& point = priority_points[ii];
+            file >> point.id >> point.priority >> point.data.x >> point.data.y >> point.data.z;
+        }
+        b_ok = !file.fail();
+    }
+    
+    if(!b_ok)
+    {
+        ROS_ERROR_STREAM("ExplorationCheckpoint::load() - " << filename << " is corrupted");
+        clear();
+    }
+    return b_ok;
+}
+
+void ExplorationCheckpoint::transform(const Eigen::Affine3d& T_new_old)
+{
+    const Eigen::Matrix3d R = T_new_old.rotation();
+    const double delta_yaw = atan2(R(1,0), R(0,0));
+    
+    TreeNodes* trees[2] = {&expl_tree_nodes, &frontier_tree_nodes};
+    for(size_t kk=0; kk < 2; kk++)
+    {
+        TreeNodes& nodes = *trees[kk];
+        for(size_t ii=0; ii < nodes.size(); ii++)
+        {
+            Eigen::Vector4d& state = nodes[ii].state;
+            state.head<3>() = T_new_old * Eigen::Vector3d(state.head<3>());
+            state[3] = atan2(sin(state[3] + delta_yaw), cos(state[3] + delta_yaw));
+        }
+    }
+    
+    for(size_t ii=0; ii < priority_points.size(); ii++)
+    {
+        geometry_msgs::Point& point = priority_points[ii].data;
+        const Eigen::Vector3d p = T_new_old * Eigen::Vector3d(point.x, point.y, point.z);
+        point.x = p.x();
+        point.y = p.y();
+        point.z = p.z();
+    }
+    
+    // the data are now in the new frame: T_fixed_new = T_fixed_old * T_old_new 
+    T_fixed_map = T_fixed_map * T_new_old.inverse();
+}
+
+} // namespace explplanner
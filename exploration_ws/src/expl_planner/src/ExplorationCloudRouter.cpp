@@ -0,0 +1,220 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ExplorationCloudRouter.h"
+
+#include <sstream>
+#include <cstdlib>
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+
+#include <pcl/filters/voxel_grid.h>
+#include <pcl_conversions/pcl_conversions.h>
+
+
+namespace explplanner{
+
+const int ExplorationCloudRouter::kMaxNumberOfRobots = 16;
+
+template<typename T>
+static T getParam(ros::NodeHandle& n, const std::string& name, const T& defaultValue)
+{
+    T v;
+    if (n.getParam(name, v))
+    {
+        ROS_INFO_STREAM("Found parameter: " << name << ", value: " << v);
+        return v;
+    }
+    else
+    {
+        ROS_WARN_STREAM("Cannot find value for parameter: " << name << ", assigning default: " << defaultValue);
+    }
+    return defaultValue;
+}
+
+ExplorationCloudRouter::ExplorationCloudRouter(const ros::NodeHandle& nh, const ros::NodeHandle& nh_private)
+    :nh_(nh),
+     nh_private_(nh_private),
+     next_source_(0),
+     b_stop_(false)
+{
+    /// < get parameters
+
+    robot_name_ = getParam<std::string>(nh_private_, "robot_name", "ugv1");   /// < multi-robot
+    const std::string str_robot_prefix = "ugv";
+    robot_id_ = atoi(robot_name_.substr(3,robot_name_.size()).c_str()) - 1;
+
+    const std::string simulator_name = getParam<std::string>(nh_private_, "simulator", "");   /// < multi-robot
+
+    ROS_INFO_STREAM("==========================================================");
+    ROS_INFO_STREAM("exploration router of robot " << robot_id_ << " alive");
+    ROS_INFO_STREAM("==========================================================");
+
+    //std::string other_robot_dynamic_point_cloud_base_topic = getParam<std::string>(nh_private_, "other_robot_dynamic_point_cloud_base_topic", "dynamic_point_cloud");
+    const std::string other_robot_dynamic_point_cloud_base_topic = getParam<std::string>(nh_private_, "other_robot_dynamic_point_cloud_base_topic", "filtered_pointcloud");
+
+    max_rate_   = std::max(getParam<double>(nh_private_, "max_rate", 0.), 0.);
+    queue_size_ = std::max(getParam<int>(nh_private_, "queue_size", 2), 1);
+    voxel_size_ = std::max(getParam<double>(nh_private_, "voxel_size", 0.), 0.);
+
+    /// < publishers
+
+    dynamic_cloud_router_pub_ = nh_.advertise<sensor_msgs::PointCloud2>("/volumetric_mapping/pointcloud2", 20); // toward this robot dense/traversability octomap
+
+    /// < subscribers
+
+    for(int id=0; id < kMaxNumberOfRobots; id++)
+    {
+        /// < N.B.: the individual robot scan is integrated by the ExplorationPlanner
+        /// <       topic: "/expl_planner/exploration_pointcloud" => callback: ExplorationPlanner::insertPointcloudWithTf()
+
+        // integrate teammate scans
+        if(id == robot_id_) continue;
+
+        std::stringstream topic_name;
+        if(!simulator_name.empty())
+        {
+            topic_name << simulator_name;
+        }
+        topic_name << "/" << str_robot_prefix << id+1 << "/" << other_robot_dynamic_point_cloud_base_topic;
+        addSource(id, topic_name.str());
+    }
+
+    routing_thread_ = boost::thread(&ExplorationCloudRouter::routingLoop, this);
+}
+
+ExplorationCloudRouter::~ExplorationCloudRouter()
+{
+    for(size_t ii=0; ii < sources_.size(); ii++)
+    {
+        sources_[ii]->sub.shutdown();
+    }
+
+    {
+    boost::mutex::scoped_lock locker(queue_mutex_);
+    b_stop_ = true;
+    }
+    queue_cond_.notify_all();
+    if(routing_thread_.joinable()) routing_thread_.join();
+}
+
+void ExplorationCloudRouter::addSource(int robot_id, const std::string& topic_name)
+{
+    boost::shared_ptr<Source> source = boost::make_shared<Source>();
+    source->robot_id = robot_id;
+
+    std::stringstream robot_name;
+    robot_name << "ugv" << robot_id+1;
+    source->robot_name = robot_name.str();
+
+    double max_rate = max_rate_;
+    nh_private_.getParam(source->robot_name + "/max_rate", max_rate);  // per-robot override
+    source->min_period = (max_rate > 0) ? 1./max_rate : 0.;
+
+    source->sub = nh_.subscribe<sensor_msgs::PointCloud2>(topic_name, queue_size_,
+                    boost::bind(&ExplorationCloudRouter::pointCloudCallback, this, _1, source.get())); /// < multi-robot
+
+    ROS_INFO_STREAM("ExplorationCloudRouter - topic name in: " << topic_name << ", max rate: " << max_rate << " [Hz]");
+    sources_.push_back(source);
+}
+
+void ExplorationCloudRouter::pointCloudCallback(const sensor_msgs::PointCloud2::ConstPtr& pointcloud_msg, Source* source)
+{
+    const ros::Time& stamp = pointcloud_msg->header.stamp;
+
+    {
+    boost::mutex::scoped_lock locker(queue_mutex_);
+
+    source->num_received++;
+
+    // dedup: the same scan can be received twice (or late)
+    const bool bDuplicated = !source->last_stamp.isZero() && (stamp <= source->last_stamp);
+    // throttle
+    const bool bThrottled  = !source->last_stamp.isZero() && ((stamp - source->last_stamp).toSec() < source->min_period);
+    if(bDuplicated || bThrottled)
+    {
+        source->num_dropped++;
+        return; /// < EXIT POINT
+    }
+    source->last_stamp = stamp;
+
+    source->queue.push_back(pointcloud_msg);
+    while(source->queue.size() > (size_t)queue_size_)
+    {
+        source->queue.pop_front();  // drop the oldest one
+        source->num_dropped++;
+    }
+    }
+    queue_cond_.notify_one();
+
+    ROS_DEBUG_STREAM_THROTTLE(10., "ExplorationCloudRouter - " << source->robot_name << " received: " << source->num_received << ", dropped: " << source->num_dropped);
+}
+
+void ExplorationCloudRouter::routingLoop()
+{
+    while(true)
+    {
+        sensor_msgs::PointCloud2::ConstPtr pointcloud_msg;
+        {
+        boost::mutex::scoped_lock locker(queue_mutex_);
+        while(!b_stop_ && !pointcloud_msg)
+        {
+            // round-robin over the sources
+            for(size_t kk=0; kk < sources_.size() && !pointcloud_msg; kk++)
+            {
+                Source& source = *sources_[next_source_];
+                next_source_ = (next_source_ + 1) % sources_.size();
+                if(!source.queue.empty())
+                {
+                    pointcloud_msg = source.queue.front();
+                    source.queue.pop_front();
+                }
+            }
+            if(!pointcloud_msg && !b_stop_) queue_cond_.wait(locker);
+        }
+        if(b_stop_) return; /// < EXIT POINT
+        }
+
+        // route teammate point cloud toward pointcloud2 of 'dense' octomap
+        dynamic_cloud_router_pub_.publish(downsample(pointcloud_msg));
+    }
+}
+
+sensor_msgs::PointCloud2::ConstPtr ExplorationCloudRouter::downsample(const sensor_msgs::PointCloud2::ConstPtr& pointcloud_msg) const
+{
+    if(voxel_size_ <= 0) return pointcloud_msg; /// < EXIT POINT : shared, no copy
+
+    pcl::PCLPointCloud2::Ptr cloud(new pcl::PCLPointCloud2());
+    pcl_conversions::toPCL(*pointcloud_msg, *cloud);
+
+    pcl::PCLPointCloud2 cloudFiltered;
+    pcl::VoxelGrid<pcl::PCLPointCloud2> voxelGrid;
+    voxelGrid.setInputCloud(cloud);
+    voxelGrid.setLeafSize(voxel_size_, voxel_size_, voxel_size_);
+    voxelGrid.filter(cloudFiltered);
+
+    sensor_msgs::PointCloud2::Ptr out_msg(new sensor_msgs::PointCloud2());
+    pcl_conversions::moveFromPCL(cloudFiltered, *out_msg);
+    return out_msg;
+}
+
+} // namespace explplanner
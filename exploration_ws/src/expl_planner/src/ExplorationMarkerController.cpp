@@ -32,6 +32,7 @@ const float ExplorationMarkerController::kTextMessageHeight = 0.14;
 const float ExplorationMarkerController::kTextMessageVerticalOffset = 0.5; 
 
 const float ExplorationMarkerController::kPoseUpdatePeriod = 10; 
+const float ExplorationMarkerController::kPoseUpdateMinDistance = 0.05; // [m]
 
 ExplorationMarkerController::ExplorationMarkerController(const tf::Vector3& p0, 
                                    const ros::NodeHandle& nh, 
@@ -41,7 +42,9 @@ ExplorationMarkerController::ExplorationMarkerController(const tf::Vector3& p0,
                                    const std::string& expl_pause_topic_name, 
                                    const std::string& int_marker_server_name, 
                                    const std::string& marker_name)
-    :nh_(nh)
+    :nh_(nh),
+     b_marker_pose_sent_(false),
+     b_marker_color_sent_(false)
 {
     ugv_name_ = ugv_name;
     robot_frame_id_ = robot_frame_id;
@@ -235,6 +238,17 @@ void ExplorationMarkerController::processFeedback(const visualization_msgs::Inte
 void ExplorationMarkerController::setMarkerPosition(const geometry_msgs::Pose &pose)
 {
     boost::recursive_mutex::scoped_lock locker(marker_server_mtx); 
+    
+    if(b_marker_pose_sent_)
+    {
+        // do not update the server (and its subscribers) if the marker did not move 
+        const double dx = pose.position.x - last_marker_pose_.position.x;
+        const double dy = pose.position.y - last_marker_pose_.position.y;
+        const double dz = pose.position.z - last_marker_pose_.position.z;
+        if( (dx*dx + dy*dy + dz*dz) < kPoseUpdateMinDistance*kPoseUpdateMinDistance ) return; /// < EXIT POINT 
+    }
+    b_marker_pose_sent_ = true; 
+    last_marker_pose_ = pose; 
         
     marker_server_->setPose(marker_name_,pose);
     marker_server_->applyChanges();
@@ -248,12 +262,21 @@ void ExplorationMarkerController::setMarkerColor(const Color& color, const std::
 
     {   
     boost::recursive_mutex::scoped_lock locker(marker_server_mtx); 
+    // do not re-insert the marker if nothing changed 
+    if( b_marker_color_sent_ && (text == last_marker_text_) && 
+        (color.r == last_marker_color_.r) && (color.g == last_marker_color_.g) && (color.b == last_marker_color_.b) && (color.a == last_marker_color_.a) )
+    {
+        return; /// < EXIT POINT 
+    }
     // get the marker
     if (!marker_server_->get(marker_name_, int_marker))
     {
         ROS_ERROR("Interactive marker '%s' does not exist, but produces feedback!", marker_name_.c_str());
         return;
     }
+    b_marker_color_sent_ = true; 
+    last_marker_color_ = color; 
+    last_marker_text_ = text; 
     }
     // update the marker position
 //    marker.pose.position.x = position.x;
@@ -29,6 +29,7 @@
 
 #include <iostream>
 #include <fstream>
+#include <cstdio>
 
 #include "RrtTree.h"
 #include "ExplorationTree.h"
@@ -37,6 +38,8 @@
 #include "NavigationTree.h"
 #include "SpaceTimeFilterBase.h"
 #include "ScanHistoryManager.h"
+#include "PlanningProfiler.h"
+#include <mr3d_profiling/Profiler.h>
 
 #include "octomap_world/octomap_world.h"
 #include "octomap_world/octomap_manager.h"
@@ -147,6 +150,13 @@ void ExplorationPlanner::init()
     // < Initialize the search tree instance.
     p_search_tree_.reset( new RrtTree(p_octomap_manager_) );
     p_search_tree_->setParams(params_);
+    if (params_.bUseEsdf_)
+    {
+        // the edges are checked in the octomap until the first ESDF map is received 
+        p_esdf_map_.reset(new EsdfMapAdapter());
+        p_esdf_map_->init(nh_, params_.esdfMapTopic_);
+        p_search_tree_->setEsdfMap(p_esdf_map_);
+    }
     
     // < Initialize the exploration tree instance.
     p_expl_tree_.reset( new ExplorationTree(p_octomap_manager_) );
@@ -180,6 +190,11 @@ void ExplorationPlanner::init()
     robot_bounding_box_size_[2] = kRobotSizeVertical;       
     
     b_use_expl_bias_ = false;
+
+    if (params_.bAsyncMapIntegration_)
+    {
+        map_integration_thread_ = boost::thread(&ExplorationPlanner::mapIntegrationLoop, this);
+    }
 }
 
 
@@ -191,11 +206,12 @@ void ExplorationPlanner::setPubsAndSubs()
 
     params_.inspectionPathPub_ = nh_.advertise<visualization_msgs::Marker>("/expl_planner/inspection_path", 10000);  
 
-    params_.explorationPathPub_ = nh_.advertise<visualization_msgs::MarkerArray>("/expl_planner/exploration_path", 100); 
+    // N.B.: the tree marker arrays are published as deltas (a new subscriber receives the full arrays at the next tree update, hence no latching)
+    params_.explorationPathPub_.reset(new MarkerArrayDiffPublisher(nh_, "/expl_planner/exploration_path", 100, params_.vizDecimationDistance_)); 
     params_.explorationNodesPub_ = nh_.advertise<visualization_msgs::Marker>("/expl_planner/exploration_nodes", 100);             
-    params_.explorationFrontierTreePub_ = nh_.advertise<visualization_msgs::MarkerArray>("/expl_planner/frontier_tree", 100, true);  // latched 
-    params_.explorationFrontierClustersPub_ = nh_.advertise<visualization_msgs::MarkerArray>("/expl_planner/frontier_clusters", 100, true);  // latched 
-    params_.explorationNavTreePub_ = nh_.advertise<visualization_msgs::MarkerArray>("/expl_planner/back_nav_tree", 100);     
+    params_.explorationFrontierTreePub_.reset(new MarkerArrayDiffPublisher(nh_, "/expl_planner/frontier_tree", 100, params_.vizDecimationDistance_)); 
+    params_.explorationFrontierClustersPub_.reset(new MarkerArrayDiffPublisher(nh_, "/expl_planner/frontier_clusters", 100)); 
+    params_.explorationNavTreePub_.reset(new MarkerArrayDiffPublisher(nh_, "/expl_planner/back_nav_tree", 100, params_.vizDecimationDistance_));     
     
     // < Subscribers 
     
@@ -207,6 +223,16 @@ void ExplorationPlanner::setPubsAndSubs()
 ExplorationPlanner::~ExplorationPlanner()
 {
     std::cout << "ExplorationPlanner::~ExplorationPlanner() - start " << std::endl;
+    if (map_integration_thread_.joinable())
+    {
+        {
+        boost::mutex::scoped_lock queue_locker(map_integration_mutex_);
+        b_stop_map_integration_ = true;
+        }
+        map_integration_cond_.notify_all();
+        map_integration_thread_.join();
+    }
+    
     boost::recursive_mutex::scoped_lock locker(interaction_mutex);
 
     //count_ = 0;
@@ -229,6 +255,53 @@ void ExplorationPlanner::insertPointcloudWithTf(const sensor_msgs::PointCloud2::
     if (pcl_stamp >= last_pcl_stamp_ + params_.pcl_throttle_)
 #endif     
     {
+        last_pcl_stamp_ = pcl_stamp;
+        
+        if (!params_.bAsyncMapIntegration_)
+        {
+            integratePointcloud(pointcloud);
+            return; /// < EXIT POINT
+        }
+        
+        // queue the scan for the integration thread; if it falls behind, the stale scans are dropped in favor of the recent ones
+        {
+        boost::mutex::scoped_lock queue_locker(map_integration_mutex_);
+        map_integration_queue_.push_back(pointcloud);
+        while (map_integration_queue_.size() > (size_t)params_.mapIntegrationQueueSize_)
+        {
+            map_integration_queue_.pop_front();
+            ROS_WARN_STREAM("ExplorationPlanner::insertPointcloudWithTf() - integration is falling behind: dropped a stale scan");
+        }
+        }
+        map_integration_cond_.notify_one();
+    }
+}
+
+void ExplorationPlanner::mapIntegrationLoop()
+{
+    while (true)
+    {
+        sensor_msgs::PointCloud2::ConstPtr pointcloud;
+        {
+        boost::mutex::scoped_lock queue_locker(map_integration_mutex_);
+        while (map_integration_queue_.empty() && !b_stop_map_integration_) map_integration_cond_.wait(queue_locker);
+        if (b_stop_map_integration_) return; /// < EXIT POINT
+        pointcloud = map_integration_queue_.front();
+        map_integration_queue_.pop_front();
+        }
+        
+        integratePointcloud(pointcloud);
+    }
+}
+
+void ExplorationPlanner::integratePointcloud(const sensor_msgs::PointCloud2::ConstPtr& pointcloud)
+{
+    {
+        // in the integration thread, the rays are cast before locking the octomap: planning waits only for the map update 
+        volumetric_mapping::OctomapWorld::PointcloudUpdate update;
+        const bool bUpdateReady = params_.bAsyncMapIntegration_ && p_octomap_manager_->computePointcloudUpdateWithTf(pointcloud, &update);
+        if (params_.bAsyncMapIntegration_ && !bUpdateReady) return; /// < EXIT POINT (the TF is not available)
+        
         //std::cout << "ExplorationPlanner::insertPointcloudWithTf() - start " << std::endl;         
         boost::recursive_mutex::scoped_lock locker(p_octomap_manager_->interaction_mutex);
 
@@ -243,9 +316,15 @@ void ExplorationPlanner::insertPointcloudWithTf(const sensor_msgs::PointCloud2::
         double free_i = free_nodes.markers[p_octomap_manager_->getTreeDepth()].points.size();
 
         std::cout << "ExplorationPlanner::insertPointcloudWithTf() - inserting... " << std::endl;
-        p_octomap_manager_->insertPointcloudWithTf(pointcloud);
+        if (bUpdateReady)
+        {
+            p_octomap_manager_->applyPointcloudUpdate(&update);
+        }
+        else
+        {
+            p_octomap_manager_->insertPointcloudWithTf(pointcloud);
+        }
         std::cout << "\nExplorationPlanner::insertPointcloudWithTf() - added new point cloud with tf " << pointcloud->header.frame_id << std::endl;
-        last_pcl_stamp_ = pcl_stamp;
 
         last_integrated_pointcloud_ = p_octomap_manager_->getLastIntegratedPointcloud();
 
@@ -629,8 +708,62 @@ bool ExplorationPlanner::setParams()
     params_.downsampleTravResolution_ = 0.1; 
     params_.downsampleTravResolution_ = getParam<double>(nh_private_,ns + "/nbvp/downsample_trav_resolution", params_.downsampleTravResolution_);   
     
+    params_.bUseNeighborhoodGraph_ = true; 
+    params_.bUseNeighborhoodGraph_ = getParam<bool>(nh_private_,ns + "/nbvp/use_neighborhood_graph", params_.bUseNeighborhoodGraph_);   
+    
+    params_.bGainRaycast_ = false; 
+    params_.bGainRaycast_ = getParam<bool>(nh_private_,ns + "/nbvp/gain/raycast", params_.bGainRaycast_);   
+    
+    params_.bCacheFrontierGains_ = false; 
+    params_.bCacheFrontierGains_ = getParam<bool>(nh_private_,ns + "/nbvp/gain/cache_frontier_gains", params_.bCacheFrontierGains_);   
+    
+    params_.gainNumThreads_ = 1; 
+    params_.gainNumThreads_ = std::max(getParam<int>(nh_private_,ns + "/nbvp/gain/num_threads", params_.gainNumThreads_), 1);   
+    
+    params_.bGainSnapshot_ = false; 
+    params_.bGainSnapshot_ = getParam<bool>(nh_private_,ns + "/nbvp/gain/snapshot", params_.bGainSnapshot_);   
+    
+    params_.bReuseTree_ = false; 
+    params_.bReuseTree_ = getParam<bool>(nh_private_,ns + "/nbvp/tree/reuse", params_.bReuseTree_);   
+    
+    params_.bAsyncMapIntegration_ = false; 
+    params_.bAsyncMapIntegration_ = getParam<bool>(nh_private_,ns + "/nbvp/map_integration/async", params_.bAsyncMapIntegration_);   
+    
+    params_.mapIntegrationQueueSize_ = 2; 
+    params_.mapIntegrationQueueSize_ = std::max(getParam<int>(nh_private_,ns + "/nbvp/map_integration/queue_size", params_.mapIntegrationQueueSize_), 1);   
+    
+    params_.bUseEsdf_ = false; 
+    params_.bUseEsdf_ = getParam<bool>(nh_private_,ns + "/nbvp/esdf/enable", params_.bUseEsdf_);   
+    
+    params_.esdfMapTopic_ = "esdf_map"; 
+    params_.esdfMapTopic_ = getParam<std::string>(nh_private_,ns + "/nbvp/esdf/topic", params_.esdfMapTopic_);   
+    
+    params_.reuseTreeRadius_ = 2 * params_.gainRange_; 
+    params_.reuseTreeRadius_ = getParam<double>(nh_private_,ns + "/nbvp/tree/reuse_radius", params_.reuseTreeRadius_);   
+    
     params_.conflictDistance_ = TeamModel::kNodeConflictDistance; // default value 
     params_.conflictDistance_ = getParam<double>(nh_private_,ns + "/team/conflict_distance", params_.conflictDistance_);   
+    
+    params_.bCheckPathConflicts_ = false; // default value 
+    params_.bCheckPathConflicts_ = getParam<bool>(nh_private_,ns + "/team/check_path_conflicts", params_.bCheckPathConflicts_);   
+    
+    params_.vizDecimationDistance_ = 0; // default value: no decimation 
+    params_.vizDecimationDistance_ = std::max(getParam<double>(nh_private_,ns + "/viz/decimation_distance", params_.vizDecimationDistance_), 0.);   
+    
+    params_.bCheckpoint_ = false; // default value 
+    params_.bCheckpoint_ = getParam<bool>(nh_private_,ns + "/checkpoint/enable", params_.bCheckpoint_);   
+    
+    params_.checkpointDir_ = "3dmr_devel/expl_checkpoint"; // default value 
+    params_.checkpointDir_ = getParam<std::string>(nh_private_,ns + "/checkpoint/directory", params_.checkpointDir_);   
+    
+    params_.checkpointPeriod_ = 30; // default value 
+    params_.checkpointPeriod_ = std::max(getParam<double>(nh_private_,ns + "/checkpoint/period", params_.checkpointPeriod_), 0.);   
+    
+    params_.bRestoreCheckpoint_ = true; // default value 
+    params_.bRestoreCheckpoint_ = getParam<bool>(nh_private_,ns + "/checkpoint/restore", params_.bRestoreCheckpoint_);   
+    
+    params_.checkpointFixedFrame_ = ""; // default value: no alignment 
+    params_.checkpointFixedFrame_ = getParam<std::string>(nh_private_,ns + "/checkpoint/fixed_frame", params_.checkpointFixedFrame_);   
    
     params_.probHit_ = 0.75; 
     params_.probHit_ = getParam<double>(nh_private_, ns + "/probability_hit", params_.probHit_);
@@ -723,10 +856,19 @@ void ExplorationPlanner::findNeighbors(std::vector<IdxProbability>& neighbors, d
     /// < Find traversability neighbors of the current node within radius search
     std::vector<int> pointIdxRadiusSearch;
     std::vector<float> pointRadiusSquaredDistance;
-    int num_close_points = kdtree_traversability_.radiusSearch(point_noWall, radius, pointIdxRadiusSearch, pointRadiusSquaredDistance);
+    int num_close_points = 0;
+    if (p_neighborhood_graph_)
+    {
+        // the graph neighbors are already filtered by distance and Dz and sorted by distance: just take the ones within radius
+        num_close_points = p_neighborhood_graph_->radiusNeighbors(nodes_[current_node_idx_].point_idx, radius, pointIdxRadiusSearch, pointRadiusSquaredDistance);
+    }
+    else
+    {
+        num_close_points = kdtree_traversability_.radiusSearch(point_noWall, radius, pointIdxRadiusSearch, pointRadiusSquaredDistance);
 
-    // eliminate points which have Dz w.r.t. point_noWall higher than kMaxRobotStepDeltaZ
-    filterNeighborhoodByDistAndDz(pcl_traversability_, point_noWall, kMinStepExpansion2, kMaxRobotStepDeltaZ, pointIdxRadiusSearch, pointRadiusSquaredDistance);
+        // eliminate points which have Dz w.r.t. point_noWall higher than kMaxRobotStepDeltaZ
+        filterNeighborhoodByDistAndDz(pcl_traversability_, point_noWall, kMinStepExpansion2, kMaxRobotStepDeltaZ, pointIdxRadiusSearch, pointRadiusSquaredDistance);
+    }
 
 #ifdef VERBOSE2     
     std::cout << "ExplorationPlanner::find_neighbors() - num_close_points : " << num_close_points << std::endl;
@@ -971,8 +1113,8 @@ bool ExplorationPlanner::findNextNode()
     return b_found;
 }
 
-void ExplorationPlanner::setInput(pcl::PointCloud<pcl::PointXYZI>& traversability_pcl_in, pcl::PointCloud<pcl::PointXYZRGBNormal>& wall_pcl_in,
-                                  pp::KdTreeFLANN<pcl::PointXYZRGBNormal>& wall_kdtree_in, KdTreeFLANN& traversability_kdtree_in, int start_point_idx_in)
+void ExplorationPlanner::setInput(const pcl::PointCloud<pcl::PointXYZI>& traversability_pcl_in, const pcl::PointCloud<pcl::PointXYZRGBNormal>& wall_pcl_in,
+                                  const pp::KdTreeFLANN<pcl::PointXYZRGBNormal>& wall_kdtree_in, const KdTreeFLANN& traversability_kdtree_in, int start_point_idx_in)
 {
     boost::recursive_mutex::scoped_lock locker(interaction_mutex);
 
@@ -988,6 +1130,7 @@ void ExplorationPlanner::setInput(pcl::PointCloud<pcl::PointXYZI>& traversabilit
 
     kdtree_wall_ = wall_kdtree_in;
     kdtree_traversability_ = traversability_kdtree_in;
+    p_neighborhood_graph_.reset(); // a graph must be set again for the new input (see setNeighborhoodGraph())
 
     start_point_idx_ = start_point_idx_in;
 
@@ -1007,7 +1150,24 @@ void ExplorationPlanner::setInput(pcl::PointCloud<pcl::PointXYZI>& traversabilit
     visited_points_flag_[start_point_idx_] = true;
 }
 
-void ExplorationPlanner::set2DUtility(pcl::PointCloud<pcl::PointXYZI>& utility_pcl)
+void ExplorationPlanner::setNeighborhoodGraph(const NeighborhoodGraph::ConstPtr& graph)
+{
+    boost::recursive_mutex::scoped_lock locker(interaction_mutex);
+
+    p_neighborhood_graph_.reset();
+    if (!graph) return; /// < EXIT POINT
+
+    /// < check if it has been built on the current traversability pcl with the expected parameters 
+    if (!graph->isValidFor(pcl_traversability_, kMaxRobotStepDeltaZ, kMinStepExpansion2) || (graph->getRadius() < kMaxRobotStep))
+    {
+        ROS_WARN("ExplorationPlanner::setNeighborhoodGraph() - the graph does not match the traversability pcl, using kd-tree search");
+        return; /// < EXIT POINT
+    }
+
+    p_neighborhood_graph_ = graph;
+}
+
+void ExplorationPlanner::set2DUtility(const pcl::PointCloud<pcl::PointXYZI>& utility_pcl)
 {
     boost::recursive_mutex::scoped_lock locker(interaction_mutex);
 
@@ -1076,6 +1236,11 @@ void ExplorationPlanner::setRobotPosition(const double& x, const double& y, cons
     robot_position_[0] = x; 
     robot_position_[1] = y; 
     robot_position_[2] = z;     
+    
+    // the tree markers are decimated w.r.t. the robot position 
+    if(params_.explorationPathPub_) params_.explorationPathPub_->setViewPoint(robot_position_);
+    if(params_.explorationFrontierTreePub_) params_.explorationFrontierTreePub_->setViewPoint(robot_position_);
+    if(params_.explorationNavTreePub_) params_.explorationNavTreePub_->setViewPoint(robot_position_);
 }
 
 void ExplorationPlanner::setRobotId(int id)
@@ -1166,6 +1331,66 @@ void ExplorationPlanner::resetSelectedBackTrackingCluster()
     p_frontier_tree_->resetSelectedBackTrackingCluster();
 }
 
+void ExplorationPlanner::getCheckpoint(ExplorationCheckpoint& checkpoint)
+{
+    boost::recursive_mutex::scoped_lock locker(interaction_mutex);
+    
+    checkpoint.map_frame = params_.navigationFrame_;
+    p_expl_tree_->getNodes(checkpoint.expl_tree_nodes, checkpoint.expl_tree_current_id);
+    p_frontier_tree_->getNodes(checkpoint.frontier_tree_nodes);
+}
+
+void ExplorationPlanner::restoreCheckpoint(const ExplorationCheckpoint& checkpoint)
+{
+    boost::recursive_mutex::scoped_lock locker(interaction_mutex);
+    
+    if(checkpoint.expl_tree_nodes.empty()) return; /// < EXIT POINT 
+    
+    p_expl_tree_->restore(checkpoint.expl_tree_nodes, checkpoint.expl_tree_current_id);
+    p_frontier_tree_->restore(checkpoint.frontier_tree_nodes);
+    
+    // the roots are already set: planning() must not reset them at the robot position 
+    n_expl_nodes_ = std::max(n_expl_nodes_, checkpoint.expl_tree_nodes.size());
+    
+    p_expl_tree_->publishTree();
+    p_frontier_tree_->publishTree();
+}
+
+bool ExplorationPlanner::writeOctomap(const std::string& filename)
+{
+    const std::string tmp_filename = filename + ".tmp";
+    bool res = false; 
+    {
+    boost::recursive_mutex::scoped_lock locker(p_octomap_manager_->interaction_mutex);
+    res = p_octomap_manager_->writeOctomapToFile(tmp_filename);
+    }
+    
+    // the old file is replaced only once the new one is complete 
+    if(!res || (std::rename(tmp_filename.c_str(), filename.c_str()) != 0))
+    {
+        ROS_ERROR_STREAM("ExplorationPlanner::writeOctomap() - cannot write " << filename);
+        return false; /// < EXIT POINT
+    }
+    return true;
+}
+
+bool ExplorationPlanner::loadOctomap(const std::string& filename, const Eigen::Affine3d& T_new_old)
+{
+    boost::recursive_mutex::scoped_lock locker(p_octomap_manager_->interaction_mutex);
+    
+    if(!p_octomap_manager_->loadOctomapFromFile(filename))
+    {
+        ROS_ERROR_STREAM("ExplorationPlanner::loadOctomap() - cannot read " << filename);
+        return false; /// < EXIT POINT
+    }
+    
+    if(!T_new_old.isApprox(Eigen::Affine3d::Identity()))
+    {
+        p_octomap_manager_->transformMap(T_new_old);
+    }
+    return true;
+}
+
 bool ExplorationPlanner::setExplorationBias(pcl::PointXYZI& bias_in, bool bUseIt)
 {
     b_use_expl_bias_ = bUseIt;
@@ -1216,6 +1441,7 @@ pcl::PointXYZI& ExplorationPlanner::getExplorationBias()
 bool ExplorationPlanner::planning(nav_msgs::Path& path_out, bool bEnableBacktracking)
 {
     boost::recursive_mutex::scoped_lock locker(interaction_mutex);
+    PROFILE_ZONE("expl/planning");
 
 #ifdef VERBOSE 
     std::cout << "------------------------------------------------"<< std::endl;    
@@ -1262,8 +1488,8 @@ bool ExplorationPlanner::planning(nav_msgs::Path& path_out, bool bEnableBacktrac
 
     p_cost_->initTime();
     
-    // Clear old search exploration tree and reinitialize.
-    p_search_tree_->clear();
+    // Clear old search exploration tree and reinitialize (if it is reused, initialize() re-roots it at the new root).
+    if(!params_.bReuseTree_ || b_use_expl_bias_) p_search_tree_->clear();
     
     // Clear old navigation tree and reinitialize.    
     p_nav_tree_->clear();
@@ -1283,7 +1509,10 @@ bool ExplorationPlanner::planning(nav_msgs::Path& path_out, bool bEnableBacktrac
     p_nav_tree_->setRoot(robot_position_[0], robot_position_[1], robot_position_[2]);      
     
     if(b_use_expl_bias_) p_search_tree_->resetBestBranch(); // < if we bias the exploration forget about the last best branch!
-    p_search_tree_->initialize(); // < N.B: here we re-insert last best branch (if any) and perform collision checking on it!
+    {
+    PlanningProfiler::ScopedPhase profiler_phase(PlanningProfiler::kSampling);
+    p_search_tree_->initialize(); // < N.B: here we re-insert last best branch (if any) and perform collision checking on it! (or we re-root the previous tree)
+    }
             
     std::cout << "ExplorationPlanner::planning() - using cost function: " << p_cost_->getName() << std::endl;
     
@@ -1291,8 +1520,11 @@ bool ExplorationPlanner::planning(nav_msgs::Path& path_out, bool bEnableBacktrac
     while( (count_ < kExpansionMaxCount) && is_exist_path && !is_close_to_bias && !is_timeout && !b_abort_ )
     {
         count_++;
+        {
+        PlanningProfiler::ScopedPhase profiler_phase(PlanningProfiler::kSampling);
         sampleFollowers();
         is_exist_path = findNextNode();
+        }
         is_close_to_bias = false;
         if(b_use_expl_bias_ && is_exist_path)
         {
@@ -1312,15 +1544,23 @@ bool ExplorationPlanner::planning(nav_msgs::Path& path_out, bool bEnableBacktrac
     if (b_abort_) std::cout << "ExplorationPlanner::planning() - planning  aborted" << std::endl;
 #endif
            
+    p_search_tree_->scorePendingNodes(); // compute the gains deferred by addNode() (if any) 
+    
+    {
+    PlanningProfiler::ScopedPhase profiler_phase(PlanningProfiler::kFrontiers);
     std::vector<Node<ExplorationTree::StateVec>*>& frontierNodes = p_search_tree_->getFrontierNodes();       
     p_frontier_tree_->updateFrontierNodes();      
     p_frontier_tree_->addFrontierNodes(frontierNodes);    
     p_frontier_tree_->clusterFrontiers();  
+    }
     
+    {
+    PlanningProfiler::ScopedPhase profiler_phase(PlanningProfiler::kPathPlanning);
     p_nav_tree_->setInputKdtree(p_frontier_tree_->getKdTree());  // set the updated kdtree from the frontier tree  
     //p_nav_tree_->setExtensionDistance(p_frontier_tree_->getMaxNeighborDistance()*1.05); // let's give it a margin 
     p_nav_tree_->initialize();       
     p_nav_tree_->expand();
+    }
     std::cout << "#nodes in frontier tree: " << p_frontier_tree_->getNumNodes() << std::endl;
     
     p_frontier_tree_->publishTree();      
@@ -1337,6 +1577,7 @@ bool ExplorationPlanner::planning(nav_msgs::Path& path_out, bool bEnableBacktrac
         // Extract the best edges.
         //tree_path = p_search_tree_->getBestEdge(params_.navigationFrame_);        
         //tree_path = p_search_tree_->getBestEdges(params_.navigationFrame_,params_.numEdgeSteps_);
+        PlanningProfiler::ScopedPhase profiler_phase(PlanningProfiler::kPathPlanning);
         tree_path = p_search_tree_->getBestEdgesWithinRange(params_.navigationFrame_,params_.explStep_);
         
         p_search_tree_->memorizeBestBranch();       
@@ -1359,7 +1600,10 @@ bool ExplorationPlanner::planning(nav_msgs::Path& path_out, bool bEnableBacktrac
             tree_path = p_expl_tree_->getPathBackToPrevious();
 #else
             // select the best node on the frontier tree 
+            {
+            PlanningProfiler::ScopedPhase profiler_phase(PlanningProfiler::kPathPlanning);
             tree_path = p_frontier_tree_->getPathToBestFrontierCentroid(p_nav_tree_, robot_position_);
+            }
             
             // in order to avoid a long journey to a possible far backtracking node, cut down the maximum traveled distance in order to check again information gain
             
@@ -1514,9 +1758,83 @@ void ExplorationPlanner::getMapSyncMessage(geometry_msgs::PoseArray& message)
     p_scan_history_manager_->getPoseArrayMessage(message);
 }
 
-void ExplorationPlanner::mapMessageOverlapCheck(const geometry_msgs::PoseArray& message, std::vector<sensor_msgs::PointCloud2::Ptr>& cloudsToSend)
+void ExplorationPlanner::mapMessageOverlapCheck(const geometry_msgs::PoseArray& message, std::vector<sensor_msgs::PointCloud2::ConstPtr>& cloudsToSend)
 {
     p_scan_history_manager_->mapMessageOverlapCheck(message, cloudsToSend);
 }
 
+void ExplorationPlanner::getScheduledMapSyncClouds(std::vector<std::pair<int, sensor_msgs::PointCloud2::ConstPtr> >& cloudsToSend)
+{
+    p_scan_history_manager_->getScheduledClouds(cloudsToSend);
+}
+
+void ExplorationPlanner::getOctomapDeltaMessage(int toRobotId, exploration_msgs::ExplorationOctomapDelta& message)
+{
+    uint64_t fromVersion = 0;
+    std::map<int, uint64_t>::const_iterator it = octomap_delta_acked_versions_.find(toRobotId);
+    if (it != octomap_delta_acked_versions_.end()) fromVersion = it->second;
+
+    volumetric_mapping::OctomapWorld::MapDelta delta;
+    {
+    boost::recursive_mutex::scoped_lock locker(p_octomap_manager_->interaction_mutex);
+    p_octomap_manager_->getMapDeltaSince(fromVersion, &delta);
+    message.resolution = p_octomap_manager_->getResolution();
+    }
+
+    message.header.stamp = ros::Time::now();
+    message.header.frame_id = p_octomap_manager_->GetWorldFrame();
+    message.robot_id = robot_id_;
+    message.to_robot_id = toRobotId;
+    message.from_version = delta.from_version;
+    message.to_version = delta.to_version;
+    message.full = delta.full;
+
+    const size_t numLeaves = delta.keys.size();
+    message.keys.resize(3*numLeaves);
+    for (size_t ii = 0; ii < numLeaves; ii++)
+    {
+        message.keys[3*ii]   = delta.keys[ii][0];
+        message.keys[3*ii+1] = delta.keys[ii][1];
+        message.keys[3*ii+2] = delta.keys[ii][2];
+    }
+    message.log_odds.swap(delta.log_odds);
+}
+
+bool ExplorationPlanner::insertOctomapDeltaMessage(const exploration_msgs::ExplorationOctomapDelta& message)
+{
+    const size_t numLeaves = message.log_odds.size();
+    if (message.keys.size() != 3*numLeaves)
+    {
+        ROS_ERROR_STREAM("ExplorationPlanner::insertOctomapDeltaMessage() - malformed delta from robot " << (int)message.robot_id);
+        return false; /// < EXIT POINT
+    }
+
+    volumetric_mapping::OctomapWorld::MapDelta delta;
+    delta.from_version = message.from_version;
+    delta.to_version = message.to_version;
+    delta.full = message.full;
+    delta.keys.resize(numLeaves);
+    for (size_t ii = 0; ii < numLeaves; ii++)
+    {
+        delta.keys[ii] = octomap::OcTreeKey(message.keys[3*ii], message.keys[3*ii+1], message.keys[3*ii+2]);
+    }
+    delta.log_odds = message.log_odds;
+
+    boost::recursive_mutex::scoped_lock locker(p_octomap_manager_->interaction_mutex);
+    if (fabs(message.resolution - p_octomap_manager_->getResolution()) > 1e-6)
+    {
+        ROS_ERROR_STREAM("ExplorationPlanner::insertOctomapDeltaMessage() - delta from robot " << (int)message.robot_id << " has resolution " << message.resolution
+                         << " instead of " << p_octomap_manager_->getResolution());
+        return false; /// < EXIT POINT
+    }
+    p_octomap_manager_->mergeMapDelta(delta);
+    return true;
+}
+
+void ExplorationPlanner::setOctomapDeltaAck(int fromRobotId, uint64_t version)
+{
+    uint64_t& ackedVersion = octomap_delta_acked_versions_[fromRobotId];
+    ackedVersion = std::max(ackedVersion, version);
+}
+
 } // namespace explplanner
@@ -22,6 +22,13 @@
 #include "ExplorationPlannerManager.h"
 
 #include <pcl/filters/voxel_grid.h>
+#include <pcl/common/io.h>
+
+#include <queue>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <cstdlib>
 
 
 namespace explplanner{
@@ -44,6 +51,12 @@ const float ExplorationPlannerManager::kSizeZCropBoxPathAligned = 3; //
 
 const double ExplorationPlannerManager::kDistanceThForRemovingPriorityPoint = 1.; // [m]
 
+const float ExplorationPlannerManager::kCropIndexBucketSize = 1.; // [m] size of the buckets of the traversability index used for cropping 
+
+const float ExplorationPlannerManager::kMaxPathCostGoalDistance = 0.5; // [m] as the goal acceptance threshold of the path planner 
+
+const int ExplorationPlannerManager::kCheckpointMaxNumRestoreAttempts = 10; 
+
 //const float ExplorationPlannerManager::kTaskCallbackPeriod = 0.5; // [s] the duration period of the task callback 
 
 template<typename T>
@@ -65,34 +78,39 @@ T getParam(ros::NodeHandle& n, const std::string& name, const T& defaultValue)
 ExplorationPlannerManager::ExplorationPlannerManager(const ros::NodeHandle& nh, const ros::NodeHandle& nh_private)
     :nh_(nh),
      nh_private_(nh_private), 
-     b_wall_info_available_(false), b_traversability_info_available_(false),
-     b_utility_2d_info_available_(false),b_abort_(false)
+     b_abort_(false),
+     my_robot_id_(0),
+     num_checkpoint_restore_attempts_(0)
 {
-    wall_pcl_.reset(new pcl::PointCloud<pcl::PointXYZRGBNormal>());
-    traversability_pcl_.reset(new pcl::PointCloud<pcl::PointXYZI>());
-    utility_2d_pcl_.reset(new pcl::PointCloud<pcl::PointXYZI>());
-
     p_expl_planner_.reset(new ExplorationPlanner(nh,nh_private));
     const ExplParams& expl_params = p_expl_planner_->getParams(); 
     team_model_.setConflictDistance(expl_params.conflictDistance_);
+    team_model_.setCheckPathConflicts(expl_params.bCheckPathConflicts_);
     
     cost_function_type_ = BaseCostFunction::kSimpleCost;//kOriginalCost;
     
     expl_planning_status_ = kNone; 
     
     path_cost_ = -1; 
+    
+    b_restore_checkpoint_pending_ = expl_params.bCheckpoint_ && expl_params.bRestoreCheckpoint_;
 }
 
 ExplorationPlannerManager::~ExplorationPlannerManager()
 {
+    const ExplParams& expl_params = p_expl_planner_->getParams(); 
+    if(expl_params.bCheckpoint_ && !b_restore_checkpoint_pending_ && !last_checkpoint_time_.isZero()) 
+    {
+        // save the last state (only if planning started: a previous checkpoint is not overwritten with an empty state) 
+        boost::recursive_mutex::scoped_lock expl_planning_locker(expl_planner_mutex_);
+        saveCheckpoint();
+    }
 }
 
 void ExplorationPlannerManager::traversabilityCloudCallback(const sensor_msgs::PointCloud2& traversability_msg)
 {
-    boost::recursive_mutex::scoped_lock traversability_locker(traversability_mutex_);
-    boost::recursive_mutex::scoped_lock locker(utility_2d_mutex_);
-
-    pcl::fromROSMsg(traversability_msg, *traversability_pcl_);
+    pcl::PointCloud<pcl::PointXYZI>::Ptr traversability_pcl(new pcl::PointCloud<pcl::PointXYZI>());
+    pcl::fromROSMsg(traversability_msg, *traversability_pcl);
     
     const ExplParams& expl_params = p_expl_planner_->getParams(); 
      
@@ -100,77 +118,87 @@ void ExplorationPlannerManager::traversabilityCloudCallback(const sensor_msgs::P
     if(expl_params.bDownSampleTraversability_)
     {
         pcl::VoxelGrid<pcl::PointXYZI> voxelGridFilter;
-        //pcl::PointCloud<pcl::PointXYZI> filtered_trav_pcl;
-        ROS_INFO_STREAM("ExplorationPlannerManager::traversabilityCloudCallback() - voxelgrid filter - size before downsampling: " << traversability_pcl_->size());
-        voxelGridFilter.setInputCloud(traversability_pcl_->makeShared()); // necessary deep copy
+        pcl::PointCloud<pcl::PointXYZI>::Ptr filtered_traversability_pcl(new pcl::PointCloud<pcl::PointXYZI>());
+        ROS_INFO_STREAM("ExplorationPlannerManager::traversabilityCloudCallback() - voxelgrid filter - size before downsampling: " << traversability_pcl->size());
+        voxelGridFilter.setInputCloud(traversability_pcl); 
         double resolution = expl_params.downsampleTravResolution_;
         voxelGridFilter.setLeafSize(resolution,resolution,resolution); 
-        voxelGridFilter.filter(*traversability_pcl_);
-        ROS_INFO_STREAM("ExplorationPlannerManager::traversabilityCloudCallback() - voxelgrid filter - size after downsampling: " << traversability_pcl_->size());
+        voxelGridFilter.filter(*filtered_traversability_pcl);
+        traversability_pcl = filtered_traversability_pcl;
+        ROS_INFO_STREAM("ExplorationPlannerManager::traversabilityCloudCallback() - voxelgrid filter - size after downsampling: " << traversability_pcl->size());
     }
     
+    std::cout << "ExplorationPlannerManager::traversabilityCloudCallback() - pcl size: " << traversability_pcl->size() << std::endl;
     
-    std::cout << "ExplorationPlannerManager::traversabilityCloudCallback() - pcl size: " << traversability_pcl_->size() << std::endl;
+    boost::shared_ptr<TraversabilitySnapshot> snapshot(new TraversabilitySnapshot);
+    snapshot->pcl = traversability_pcl;
+    snapshot->index = VoxelBucketIndex<pcl::PointXYZI>(kCropIndexBucketSize);
+    snapshot->index.build(*traversability_pcl); // once per map update, the planning steps only query it 
     
-    b_traversability_info_available_ = false; // reset
-    b_utility_2d_info_available_ = false; // reset utility flag 
-
-    if (traversability_pcl_->size() > 0)
-    {
-        b_traversability_info_available_ = true;
-    }
+    /// < publish the snapshot; the current utility refers to the previous traversability cloud and is discarded 
+    boost::atomic_store(&traversability_snapshot_, TraversabilitySnapshot::ConstPtr(snapshot));
+    boost::atomic_store(&utility_2d_snapshot_, Utility2DSnapshot::ConstPtr());
 }
 
 void ExplorationPlannerManager::wallCloudCallback(const sensor_msgs::PointCloud2& wall_msg)
 {
-    boost::recursive_mutex::scoped_lock wall_locker(wall_mutex_);
-
-    pcl::fromROSMsg(wall_msg, *wall_pcl_);
+    pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr wall_pcl(new pcl::PointCloud<pcl::PointXYZRGBNormal>());
+    pcl::fromROSMsg(wall_msg, *wall_pcl);
      
     // this cloud can be empty 
-    if(wall_pcl_->size() == 0)
+    if(wall_pcl->size() == 0)
     {
         /// < HACK: add a single far point 
         pcl::PointXYZRGBNormal far_point;
         far_point.x = std::numeric_limits<float>::max(); 
         far_point.y = std::numeric_limits<float>::max(); 
         far_point.z = std::numeric_limits<float>::max(); 
-        wall_pcl_->push_back(far_point);
+        wall_pcl->push_back(far_point);
     }
     
-    wall_kdtree_.setInputCloud(wall_pcl_); 
-    b_wall_info_available_ = true;
+    boost::shared_ptr<WallSnapshot> snapshot(new WallSnapshot);
+    snapshot->pcl = wall_pcl;
+    snapshot->kdtree.setInputCloud(wall_pcl); 
+    
+    boost::atomic_store(&wall_snapshot_, WallSnapshot::ConstPtr(snapshot));
 }
 
 // N.B: here we assume the pointcloud contains PointXYZI: [x,y,u(x,y),var(x,y)] 
-// Moreover, we assume that utility_2d_pcl_ contains info about the points in traversability_pcl_
+// Moreover, we assume that the utility cloud contains info about the points in the traversability cloud
 void ExplorationPlannerManager::utility2DCloudCallback(const sensor_msgs::PointCloud2& utility_msg)
 {
-    boost::recursive_mutex::scoped_lock locker(utility_2d_mutex_);
-    boost::recursive_mutex::scoped_lock traversability_locker(traversability_mutex_);
-
-    pcl::fromROSMsg(utility_msg, *utility_2d_pcl_);
+    pcl::PointCloud<pcl::PointXYZI>::Ptr utility_2d_pcl(new pcl::PointCloud<pcl::PointXYZI>());
+    pcl::fromROSMsg(utility_msg, *utility_2d_pcl);
+    
+    std::cout << "ExplorationPlannerManager::utility2DCloudCallback() - pcl size: " << utility_2d_pcl->size() << std::endl;
+    
+    boost::shared_ptr<Utility2DSnapshot> snapshot(new Utility2DSnapshot);
+    snapshot->pcl = utility_2d_pcl;
     
-    std::cout << "ExplorationPlannerManager::utility2DCloudCallback() - pcl size: " << traversability_pcl_->size() << std::endl;
-        
-    b_utility_2d_info_available_ = false; // reset 
-            
     /// < check if it has the same size of the traversability pcl 
-    if( (utility_2d_pcl_->header.stamp != traversability_pcl_->header.stamp) || (utility_2d_pcl_->size() != traversability_pcl_->size()) )
+    const TraversabilitySnapshot::ConstPtr traversability = boost::atomic_load(&traversability_snapshot_);
+    if( !isUtility2DConsistent(traversability, snapshot) )
     {
         ROS_WARN("**********************************************************************************************************");
         ROS_WARN("ExplorationPlannerManager::utility2DCloudCallback() - traversability and utility pcls have different sizes or stamp");
         ROS_WARN("**********************************************************************************************************");
-        std::cout << "trav stamp: " << traversability_pcl_->header.stamp << ", utility stamp: " << utility_2d_pcl_->header.stamp << std::endl; 
-        std::cout << "trav size: " << traversability_pcl_->size() << ", utility size: " << utility_2d_pcl_->size() << std::endl; 
-        b_utility_2d_info_available_ = false; 
+        if(traversability)
+        {
+            std::cout << "trav stamp: " << traversability->pcl->header.stamp << ", utility stamp: " << utility_2d_pcl->header.stamp << std::endl; 
+            std::cout << "trav size: " << traversability->pcl->size() << ", utility size: " << utility_2d_pcl->size() << std::endl; 
+        }
+        boost::atomic_store(&utility_2d_snapshot_, Utility2DSnapshot::ConstPtr());
         return; /// < EXIT POINT 
     }
     
-    if (utility_2d_pcl_->size() > 0)
-    {
-        b_utility_2d_info_available_ = true;
-    }
+    boost::atomic_store(&utility_2d_snapshot_, Utility2DSnapshot::ConstPtr(snapshot));
+}
+
+bool ExplorationPlannerManager::isUtility2DConsistent(const TraversabilitySnapshot::ConstPtr& traversability, const Utility2DSnapshot::ConstPtr& utility_2d)
+{
+    return traversability && utility_2d && (utility_2d->pcl->size() > 0) && 
+           (utility_2d->pcl->header.stamp == traversability->pcl->header.stamp) && 
+           (utility_2d->pcl->size() == traversability->pcl->size());
 }
 
 //void ExplorationPlannerManager::goalSelectionCallback(geometry_msgs::PoseStamped goal_msg)
@@ -200,7 +228,8 @@ void ExplorationPlannerManager::abortCallback(std_msgs::Bool msg)
 
 bool ExplorationPlannerManager::isReady() const
 {
-    return b_traversability_info_available_ && b_wall_info_available_;
+    const TraversabilitySnapshot::ConstPtr traversability = boost::atomic_load(&traversability_snapshot_);
+    return traversability && (traversability->pcl->size() > 0) && boost::atomic_load(&wall_snapshot_);
 }
 
     
@@ -213,9 +242,30 @@ ExplorationPlannerManager::ExplorationPlannerStatus ExplorationPlannerManager::d
     expl_planning_status_ = kNotReady; 
     path_cost_ = -1; 
     
-    if (!isReady())
+    const ExplParams& expl_params = p_expl_planner_->getParams(); 
+    
+    /// < warm start: restore the saved exploration state (this replaces the scans integrated in the octomap before the first planning step)
+    if(b_restore_checkpoint_pending_)
+    {
+        num_checkpoint_restore_attempts_++;
+        if( restoreCheckpoint() || (num_checkpoint_restore_attempts_ >= kCheckpointMaxNumRestoreAttempts) )
+        {
+            b_restore_checkpoint_pending_ = false; 
+        }
+    }
+    
+    /// < take the input maps for this planning step: the callbacks can replace them meanwhile without waiting 
+    const TraversabilitySnapshot::ConstPtr traversability = boost::atomic_load(&traversability_snapshot_);
+    const WallSnapshot::ConstPtr wall = boost::atomic_load(&wall_snapshot_);
+    const Utility2DSnapshot::ConstPtr utility_2d = boost::atomic_load(&utility_2d_snapshot_);
+    
+    const bool b_traversability_info_available = traversability && (traversability->pcl->size() > 0);
+    const bool b_wall_info_available = (bool)wall;
+    const bool b_utility_2d_info_available = isUtility2DConsistent(traversability, utility_2d);
+    
+    if (!b_traversability_info_available || !b_wall_info_available)
     {
-        ROS_WARN("ExplorationPlannerManager::doPathPlanning() - traversability info: %d, wall info: %d, utility info: %d", (int) b_traversability_info_available_, (int) b_wall_info_available_, (int) b_utility_2d_info_available_);
+        ROS_WARN("ExplorationPlannerManager::doPathPlanning() - traversability info: %d, wall info: %d, utility info: %d", (int) b_traversability_info_available, (int) b_wall_info_available, (int) b_utility_2d_info_available);
         return kNotReady; /// < EXIT POINT 
     }
 
@@ -236,30 +286,25 @@ ExplorationPlannerManager::ExplorationPlannerStatus ExplorationPlannerManager::d
     //ROS_INFO_STREAM("ExplorationPlannerManager::doPathPlanning() - current robot position: " << robot_position); 
         
     /// < prepare intial traversability PCL (needed for computing the starting point )
-    pcl::PointCloud<pcl::PointXYZI>::Ptr p_traversability_pcl;
-    pcl::PointCloud<pcl::PointXYZI>::Ptr p_utility_2d_pcl;
+    pcl::PointCloud<pcl::PointXYZI>::ConstPtr p_traversability_pcl;
+    pcl::PointCloud<pcl::PointXYZI>::ConstPtr p_utility_2d_pcl;
     ExplorationPlanner::KdTreeFLANN traversability_kdtree;
+    NeighborhoodGraph::ConstPtr p_neighborhood_graph;
 
-    p_traversability_pcl.reset(new pcl::PointCloud<pcl::PointXYZI>);
-    p_utility_2d_pcl.reset(new pcl::PointCloud<pcl::PointXYZI>);
+    if(b_utility_2d_info_available)
     {
-        boost::recursive_mutex::scoped_lock locker_traversability(traversability_mutex_);
-        boost::recursive_mutex::scoped_lock locker_utility(utility_2d_mutex_); 
-        
-        if(b_utility_2d_info_available_)
-        {
-            cropTwoPcls((CropBoxMethod)crop_step, robot_position, traversability_pcl_, utility_2d_pcl_, p_traversability_pcl, p_utility_2d_pcl);
-        }
-        else
-        {
-            cropPcl((CropBoxMethod)crop_step, robot_position, traversability_pcl_, p_traversability_pcl);
-        }
+        cropTwoPcls((CropBoxMethod)crop_step, robot_position, traversability, utility_2d, p_traversability_pcl, p_utility_2d_pcl);
+    }
+    else
+    {
+        cropPcl((CropBoxMethod)crop_step, robot_position, traversability, p_traversability_pcl);
     }
     
     std::cout << "traversability pcl size: " << p_traversability_pcl->size() << std::endl;
     
     // organize cropped traversability points
     traversability_kdtree.setInputCloud(p_traversability_pcl);
+    p_neighborhood_graph = getNeighborhoodGraph((CropBoxMethod)crop_step, traversability, *p_traversability_pcl, traversability_kdtree);
     
     /// < compute starting point on the segment traversability map 
     std::vector<int> pointIdxNKNSearch(1);
@@ -292,13 +337,9 @@ ExplorationPlannerManager::ExplorationPlannerStatus ExplorationPlannerManager::d
     while ((num_failures < kExplPlannerMaxNumAttempts) && (!b_successful_planning) && (!b_abort_))
     {
         /// < first set input then the bias!
-        {
-            boost::recursive_mutex::scoped_lock locker(traversability_mutex_);
-            boost::recursive_mutex::scoped_lock wall_locker(wall_mutex_);
-            boost::recursive_mutex::scoped_lock utility_locker(utility_2d_mutex_);
-            p_expl_planner_->setInput(*p_traversability_pcl, *wall_pcl_, wall_kdtree_, traversability_kdtree, pointIdxNKNSearch[0]);
-            if(b_utility_2d_info_available_) p_expl_planner_->set2DUtility(*p_utility_2d_pcl);
-        }
+        p_expl_planner_->setInput(*p_traversability_pcl, *wall->pcl, wall->kdtree, traversability_kdtree, pointIdxNKNSearch[0]);
+        if(p_neighborhood_graph) p_expl_planner_->setNeighborhoodGraph(p_neighborhood_graph);
+        if(b_utility_2d_info_available) p_expl_planner_->set2DUtility(*p_utility_2d_pcl);
         
         /// < check if we have a priority point to bias the exploration 
         pcl::PointXYZI bias_in;
@@ -341,24 +382,17 @@ ExplorationPlannerManager::ExplorationPlannerStatus ExplorationPlannerManager::d
                 }
                     
                 /// < generate a bigger traversability map           
-                p_traversability_pcl.reset(new pcl::PointCloud<pcl::PointXYZI>);
-                p_utility_2d_pcl.reset(new pcl::PointCloud<pcl::PointXYZI>);
+                if(b_utility_2d_info_available)
                 {
-                    boost::recursive_mutex::scoped_lock locker(traversability_mutex_);
-                    boost::recursive_mutex::scoped_lock locker_utility(utility_2d_mutex_); 
-
-                    if(b_utility_2d_info_available_)
-                    {
-                        cropTwoPcls((CropBoxMethod)crop_step, robot_position, traversability_pcl_, utility_2d_pcl_, p_traversability_pcl, p_utility_2d_pcl);
-                    }
-                    else
-                    {
-                        cropPcl((CropBoxMethod)crop_step, robot_position, traversability_pcl_, p_traversability_pcl);
-                    }
-                    
+                    cropTwoPcls((CropBoxMethod)crop_step, robot_position, traversability, utility_2d, p_traversability_pcl, p_utility_2d_pcl);
+                }
+                else
+                {
+                    cropPcl((CropBoxMethod)crop_step, robot_position, traversability, p_traversability_pcl);
                 }
                 // organize cropped traversability points
                 traversability_kdtree.setInputCloud(p_traversability_pcl);
+                p_neighborhood_graph = getNeighborhoodGraph((CropBoxMethod)crop_step, traversability, *p_traversability_pcl, traversability_kdtree);
                 
                 /// compute starting point on the segment traversability map 
                 int found = traversability_kdtree.nearestKSearch(robot_position, 1, pointIdxNKNSearch, pointNKNSquaredDistance);
@@ -417,6 +451,13 @@ ExplorationPlannerManager::ExplorationPlannerStatus ExplorationPlannerManager::d
         ROS_INFO("ExplorationPlannerManager::doPathPlanning() - path aborted");
         expl_planning_status_ = kAborted;
     }
+    
+    /// < periodically save the exploration state 
+    if( expl_params.bCheckpoint_ && !b_restore_checkpoint_pending_ && 
+        ((ros::Time::now() - last_checkpoint_time_).toSec() >= expl_params.checkpointPeriod_) )
+    {
+        saveCheckpoint();
+    }
 
     return expl_planning_status_;
 }
@@ -470,201 +511,258 @@ bool ExplorationPlannerManager::getRobotPosition(pcl::PointXYZI& robot_position)
 }
 
 
-void ExplorationPlannerManager::cropPcl(const CropBoxMethod& crop_box_method, 
-                                        const pcl::PointXYZI& start, 
-                                        const pcl::PointCloud<pcl::PointXYZI>::Ptr pcl_in, 
-                                        pcl::PointCloud<pcl::PointXYZI>::Ptr pcl_out)
+NeighborhoodGraph::ConstPtr ExplorationPlannerManager::getNeighborhoodGraph(const CropBoxMethod& crop_box_method, 
+                                                                           const TraversabilitySnapshot::ConstPtr& traversability, 
+                                                                           const pcl::PointCloud<pcl::PointXYZI>& traversability_pcl, 
+                                                                           const ExplorationPlanner::KdTreeFLANN& traversability_kdtree)
 {
-    if( (crop_box_method == kCropBoxTakeAll) )// || (crop_box_method == kCropBoxTakeAll2) )
+    const ExplParams& expl_params = p_expl_planner_->getParams(); 
+    if( (crop_box_method != kCropBoxTakeAll) || !expl_params.bUseNeighborhoodGraph_ ) 
     {
-        *pcl_out = *pcl_in;
-        return; /// < EXIT POINT 
+        return NeighborhoodGraph::ConstPtr(); /// < EXIT POINT 
     }
-
-    // crop box initialization: traversability
-    pcl::CropBox<pcl::PointXYZI> cropbox_pcl;
-    cropbox_pcl.setInputCloud(pcl_in); 
-
-    // prepare for cropping: compute cloud translation
-    Eigen::Vector3f p1(start.x, start.y, start.z);
-    Eigen::Vector3f& middle_point = p1;
-    Eigen::Translation<float, 3> translation(-middle_point(0), -middle_point(1), -middle_point(2)); // bring the origin in the middle of the segment 
-
-    Eigen::Affine3f transform;
-
-    switch (crop_box_method)
+    
+    // the graph may have been already built by computePathCosts() 
+    const TraversabilityGraph::ConstPtr cached = boost::atomic_load(&traversability_graph_);
+    if( cached && (cached->traversability == traversability) && cached->graph->isValidFor(traversability_pcl, ExplorationPlanner::kMaxRobotStepDeltaZ, ExplorationPlanner::kMinStepExpansion2) )
     {
+        return cached->graph; /// < EXIT POINT 
+    }
+    
+    // built once per traversability message 
+    NeighborhoodGraph::Ptr p_graph(new NeighborhoodGraph);
+    p_graph->build(traversability_pcl, traversability_kdtree, ExplorationPlanner::kMaxRobotStep, ExplorationPlanner::kMaxRobotStepDeltaZ, ExplorationPlanner::kMinStepExpansion2);
+    std::cout << "ExplorationPlannerManager::getNeighborhoodGraph() - neighborhood graph edges: " << p_graph->getNumEdges() << ", memory: " << p_graph->getMemoryBytes()/(1024*1024) << " MB" << std::endl;
+    
+    boost::shared_ptr<TraversabilityGraph> p_traversability_graph(new TraversabilityGraph);
+    p_traversability_graph->traversability = traversability;
+    p_traversability_graph->graph = p_graph;
+    boost::atomic_store(&traversability_graph_, TraversabilityGraph::ConstPtr(p_traversability_graph));
+    
+    return p_graph;
+}
 
-    case kCropBoxMethodWorldAligned:
-    case kCropBoxMethodWorldAligned2:
-    case kCropBoxMethodWorldAligned3:        
-    case kCropBoxMethodWorldAligned4:
+TraversabilityGraph::ConstPtr ExplorationPlannerManager::getTraversabilityGraphWithKdTree(const TraversabilitySnapshot::ConstPtr& traversability)
+{
+    const TraversabilityGraph::ConstPtr cached = boost::atomic_load(&traversability_graph_);
+    if( cached && (cached->traversability == traversability) && cached->kdtree )
     {
-        // prepare for cropping: compute cloud transformation (this brings all the points in the world-aligned frame centered in middle_point)
-        transform = translation;
-
-    //    float dx = std::max(1.f * kMinXSizeCropBox, (float) fabs(delta[0])); // 1.f* is for compiling with debug flags 
-    //    float dy = std::max(1.f * kMinYSizeCropBox, (float) fabs(delta[1]));
-    //    float dz = std::max(1.f * kMinZSizeCropBox, (float) fabs(delta[2]));        
-        float dx = 1.f * kMinXSizeCropBox;
-        float dy = 1.f * kMinYSizeCropBox;
-        float dz = 1.f * kMinZSizeCropBox;
-
-        float gain = 1;
-        switch(crop_box_method)
-        {
-            case kCropBoxMethodWorldAligned:
-                gain = kGainCropBox; 
-                break; 
-                
-            case kCropBoxMethodWorldAligned2:
-                gain = kGainCropBox2; 
-                break;      
-                
-            case kCropBoxMethodWorldAligned3:
-                gain = kGainCropBox3; 
-                break;       
-
-            case kCropBoxMethodWorldAligned4:
-                gain = kGainCropBox4; 
-                break;  
-
-            default:
-                ROS_ERROR_STREAM("unmanaged crop_box_method");
-        }        
-
-        // apply crop box filter to the traversability cloud w.r.t. world aligned bounding box 
-        cropbox_pcl.setMin(Eigen::Vector4f(-0.5 * gain*dx, -0.5 * gain*dy, -0.5 * gain*dz, 1));
-        cropbox_pcl.setMax(Eigen::Vector4f(0.5 * gain*dx, 0.5 * gain*dy, 0.5 * gain*dz, 1));
-        cropbox_pcl.setTranslation(Eigen::Vector3f(0, 0, 0));
-        cropbox_pcl.setRotation(Eigen::Vector3f(0, 0, 0));
-        cropbox_pcl.setTransform(transform); // set a transformation that should be applied to the cloud before filtering
-        cropbox_pcl.filter(*pcl_out); // filter and write the output in segment->traversability_pcl
+        return cached; /// < EXIT POINT 
     }
-        break;
-
-
-    case kCropBoxTakeAll:
-    //case kCropBoxTakeAll2:
+    
+    boost::shared_ptr<TraversabilityGraph> p_traversability_graph(new TraversabilityGraph);
+    p_traversability_graph->traversability = traversability;
+    
+    boost::shared_ptr<ExplorationPlanner::KdTreeFLANN> p_kdtree(new ExplorationPlanner::KdTreeFLANN);
+    p_kdtree->setInputCloud(traversability->pcl);
+    p_traversability_graph->kdtree = p_kdtree;
+    
+    if( cached && (cached->traversability == traversability) )
     {
-        /// < managed above 
+        // reuse the graph built by the planning thread 
+        p_traversability_graph->graph = cached->graph;
     }
-        break;
-
-    default:
-        ROS_ERROR("Unknown cropbox method");
-
+    else
+    {
+        NeighborhoodGraph::Ptr p_graph(new NeighborhoodGraph);
+        p_graph->build(*traversability->pcl, *p_kdtree, ExplorationPlanner::kMaxRobotStep, ExplorationPlanner::kMaxRobotStepDeltaZ, ExplorationPlanner::kMinStepExpansion2);
+        p_traversability_graph->graph = p_graph;
     }
-
+    
+    // if two threads get here with the same snapshot, they build equivalent graphs and the last one is kept 
+    boost::atomic_store(&traversability_graph_, TraversabilityGraph::ConstPtr(p_traversability_graph));
+    return p_traversability_graph;
 }
 
-
-bool ExplorationPlannerManager::cropTwoPcls(const CropBoxMethod& crop_box_method, 
-                                            const pcl::PointXYZI& start, 
-                                            const pcl::PointCloud<pcl::PointXYZI>::Ptr pcl_in, 
-                                            const pcl::PointCloud<pcl::PointXYZI>::Ptr pcl_in2,
-                                            pcl::PointCloud<pcl::PointXYZI>::Ptr pcl_out, 
-                                            pcl::PointCloud<pcl::PointXYZI>::Ptr pcl_out2)
+bool ExplorationPlannerManager::computePathCosts(const pcl::PointXYZI& start, const std::vector<pcl::PointXYZI>& goals, std::vector<double>& costs, double max_cost)
 {
-    bool res_ok = true; 
-    if( (crop_box_method == kCropBoxTakeAll) ) //|| (crop_box_method == kCropBoxTakeAll2) )
+    costs.assign(goals.size(), -1.);
+    
+    const TraversabilitySnapshot::ConstPtr traversability = boost::atomic_load(&traversability_snapshot_);
+    if( !traversability || traversability->pcl->empty() ) 
     {
-        *pcl_out  = *pcl_in;
-        *pcl_out2 = *pcl_in2;
-        return true; /// < EXIT POINT 
+        ROS_WARN("ExplorationPlannerManager::computePathCosts() - traversability map not available");
+        return false; /// < EXIT POINT 
     }
-
-    // crop box initialization: traversability
-    pcl::CropBox<pcl::PointXYZI> cropbox_pcl;
-    cropbox_pcl.setInputCloud(pcl_in); 
     
-    pcl::ExtractIndices<pcl::PointXYZI> extract;
-    extract.setInputCloud(pcl_in); 
-    pcl::PointIndices::Ptr indices_filtered (new  pcl::PointIndices());
-
-    // prepare for cropping: compute cloud translation
-    Eigen::Vector3f p1(start.x, start.y, start.z);
-    Eigen::Vector3f& middle_point = p1;
-    Eigen::Translation<float, 3> translation(-middle_point(0), -middle_point(1), -middle_point(2)); // bring the origin in the middle of the segment 
-
-    Eigen::Affine3f transform;
+    const TraversabilityGraph::ConstPtr traversability_graph = getTraversabilityGraphWithKdTree(traversability);
+    const NeighborhoodGraph& graph = *traversability_graph->graph;
+    const ExplorationPlanner::KdTreeFLANN& kdtree = *traversability_graph->kdtree;
+    
+    const float max_goal_distance2 = kMaxPathCostGoalDistance*kMaxPathCostGoalDistance;
+    std::vector<int> pointIdxNKNSearch(1);
+    std::vector<float> pointNKNSquaredDistance(1);
+    
+    /// < start node 
+    /// < HACK : as in doPlanning(), we do not check the distance of start from the map 
+    if( kdtree.nearestKSearch(start, 1, pointIdxNKNSearch, pointNKNSquaredDistance) < 1 )
+    {
+        ROS_WARN("ExplorationPlannerManager::computePathCosts() - cannot find a close starting node");
+        return false; /// < EXIT POINT 
+    }
+    const int start_node = pointIdxNKNSearch[0];
     
-    switch (crop_box_method)
+    /// < goal nodes (-1 if the goal is too far from the map)
+    std::vector<int> goal_nodes(goals.size(), -1);
+    std::vector<int> num_goals_of_node; // number of goals attached to each node, only allocated if there are goals
+    int num_goals_to_reach = 0; 
+    for(size_t ii=0; ii < goals.size(); ii++)
     {
+        if( (kdtree.nearestKSearch(goals[ii], 1, pointIdxNKNSearch, pointNKNSquaredDistance) < 1) || (pointNKNSquaredDistance[0] > max_goal_distance2) ) continue;
+        if(num_goals_of_node.empty()) num_goals_of_node.assign(graph.size(), 0);
+        goal_nodes[ii] = pointIdxNKNSearch[0];
+        num_goals_of_node[goal_nodes[ii]]++;
+        num_goals_to_reach++;
+    }
+    
+    /// < single Dijkstra sweep from the start node, stopped when all the goal nodes are settled or max_cost is exceeded 
+    const float kInfinity = std::numeric_limits<float>::max();
+    std::vector<float> distances(graph.size(), kInfinity);
+    std::vector<char> settled(graph.size(), 0);
+    typedef std::pair<float,int> QueueItem; // (distance, node) 
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem> > open_queue;
+    
+    distances[start_node] = 0;
+    open_queue.push(QueueItem(0.f, start_node));
+    while( !open_queue.empty() && (num_goals_to_reach > 0) )
+    {
+        const QueueItem item = open_queue.top();
+        open_queue.pop();
+        const int node = item.second;
+        if(settled[node]) continue; // outdated queue item 
+        if( (max_cost > 0) && (item.first > max_cost) ) break; 
+        settled[node] = 1;
+        num_goals_to_reach -= num_goals_of_node[node];
+        
+        const size_t num_neighbors = graph.getNumNeighbors(node);
+        const int* neighbors = graph.getNeighbors(node);
+        const float* squared_distances = graph.getSquaredDistances(node);
+        for(size_t jj=0; jj < num_neighbors; jj++)
+        {
+            const int neighbor = neighbors[jj];
+            const float distance = item.first + sqrt(squared_distances[jj]);
+            if( !settled[neighbor] && (distance < distances[neighbor]) )
+            {
+                distances[neighbor] = distance;
+                open_queue.push(QueueItem(distance, neighbor));
+            }
+        }
+    }
+    
+    for(size_t ii=0; ii < goals.size(); ii++)
+    {
+        const int goal_node = goal_nodes[ii];
+        if( (goal_node >= 0) && settled[goal_node] )
+        {
+            costs[ii] = distances[goal_node];
+        }
+    }
+    return true;
+}
 
-    case kCropBoxMethodWorldAligned:
-    case kCropBoxMethodWorldAligned2:
-    case kCropBoxMethodWorldAligned3:
-    case kCropBoxMethodWorldAligned4:        
+bool ExplorationPlannerManager::computePathCostsFromRobot(const std::vector<pcl::PointXYZI>& goals, std::vector<double>& costs, double max_cost)
+{
+    // N.B.: getRobotPosition() is not used here since it locks expl_planner_mutex_ 
+    pcl::PointXYZI robot_position;
+    try
     {
-        // prepare for cropping: compute cloud transformation (this brings all the points in the world-aligned frame centered in middle_point)
-        transform = translation;
+        const tf::StampedTransform robot_pose = transform_robot_.get();
+        robot_position.x = robot_pose.getOrigin().x();
+        robot_position.y = robot_pose.getOrigin().y();
+        robot_position.z = robot_pose.getOrigin().z();
+    }
+    catch(TransformException e )
+    {
+        ROS_WARN("ExplorationPlannerManager::computePathCostsFromRobot() - %s",e.what());
+        costs.assign(goals.size(), -1.);
+        return false; /// < EXIT POINT 
+    }
+    return computePathCosts(robot_position, goals, costs, max_cost);
+}
 
-//        float dx = std::max(1.f * kMinXSizeCropBox, (float) fabs(delta[0])); // 1.f* is for compiling with debug flags 
-//        float dy = std::max(1.f * kMinYSizeCropBox, (float) fabs(delta[1]));
-//        float dz = std::max(1.f * kMinZSizeCropBox, (float) fabs(delta[2]));
-        float dx = 1.f * kMinXSizeCropBox; // 1.f* is for compiling with debug flags 
-        float dy = 1.f * kMinYSizeCropBox;
-        float dz = 1.f * kMinZSizeCropBox;        
+bool ExplorationPlannerManager::getCropIndices(const CropBoxMethod& crop_box_method, 
+                                               const pcl::PointXYZI& start, 
+                                               const TraversabilitySnapshot& traversability, 
+                                               std::vector<int>& indices)
+{
+    indices.clear();
+    
+    float gain = 1;
+    switch(crop_box_method)
+    {
+        case kCropBoxMethodWorldAligned:
+            gain = kGainCropBox; 
+            break; 
 
-        float gain = 1;
-        switch(crop_box_method)
-        {
-            case kCropBoxMethodWorldAligned:
-                gain = kGainCropBox; 
-                break; 
-                
-            case kCropBoxMethodWorldAligned2:
-                gain = kGainCropBox2; 
-                break;      
-                
-            case kCropBoxMethodWorldAligned3:
-                gain = kGainCropBox3; 
-                break;  
+        case kCropBoxMethodWorldAligned2:
+            gain = kGainCropBox2; 
+            break;      
 
-            case kCropBoxMethodWorldAligned4:
-                gain = kGainCropBox4; 
-                break;  
+        case kCropBoxMethodWorldAligned3:
+            gain = kGainCropBox3; 
+            break;       
 
-            default:
-                ROS_ERROR_STREAM("unmanaged crop_box_method");
-        }
+        case kCropBoxMethodWorldAligned4:
+            gain = kGainCropBox4; 
+            break;  
+            
+        case kCropBoxTakeAll:
+            return false; /// < EXIT POINT 
 
-        // apply crop box filter to the traversability cloud w.r.t. world aligned bounding box 
-        cropbox_pcl.setMin(Eigen::Vector4f(-0.5 * gain*dx, -0.5 * gain*dy, -0.5 * gain*dz, 1));
-        cropbox_pcl.setMax(Eigen::Vector4f(0.5 * gain*dx, 0.5 * gain*dy, 0.5 * gain*dz, 1));
-        cropbox_pcl.setTranslation(Eigen::Vector3f(0, 0, 0));
-        cropbox_pcl.setRotation(Eigen::Vector3f(0, 0, 0));
-        cropbox_pcl.setTransform(transform); // set a transformation that should be applied to the cloud before filtering
-        
-        //cropbox_pcl.filter(*pcl_out); // filter and write the output in segment->traversability_pcl
-        cropbox_pcl.filter(indices_filtered->indices); // filter and write the output in indices_filtered->indices
-        extract.setIndices (indices_filtered);   
+        default:
+            ROS_ERROR("Unknown cropbox method");
+            return false; /// < EXIT POINT 
     }
-    break;
-
+    
+    // world-aligned box centered in start 
+    const Eigen::Vector3f middle_point(start.x, start.y, start.z);
+    const Eigen::Vector3f half_size = 0.5f * gain * Eigen::Vector3f(kMinXSizeCropBox, kMinYSizeCropBox, kMinZSizeCropBox);
+    
+    traversability.index.cropBox(*traversability.pcl, middle_point - half_size, middle_point + half_size, indices);
+    return true; 
+}
 
-    case kCropBoxTakeAll:
+void ExplorationPlannerManager::cropPcl(const CropBoxMethod& crop_box_method, 
+                                        const pcl::PointXYZI& start, 
+                                        const TraversabilitySnapshot::ConstPtr& traversability, 
+                                        pcl::PointCloud<pcl::PointXYZI>::ConstPtr& pcl_out)
+{
+    std::vector<int> indices;
+    if( !getCropIndices(crop_box_method, start, *traversability, indices) )
     {
-        /// < managed above 
-    }
-    break;
-
-    default:
-        ROS_ERROR("Unknown cropbox method");
-        res_ok = false; 
+        pcl_out = traversability->pcl; // take all: share the cloud 
+        return; /// < EXIT POINT 
     }
     
-    /// < apply the filter 
-    if(res_ok)
-    {
-        extract.filter(*pcl_out);
+    pcl::PointCloud<pcl::PointXYZI>::Ptr p_cropped_pcl(new pcl::PointCloud<pcl::PointXYZI>);
+    pcl::copyPointCloud(*traversability->pcl, indices, *p_cropped_pcl);
+    pcl_out = p_cropped_pcl;
+}
 
-        extract.setInputCloud(pcl_in2);         
-        extract.setIndices (indices_filtered);
-        extract.filter(*pcl_out2);        
+bool ExplorationPlannerManager::cropTwoPcls(const CropBoxMethod& crop_box_method, 
+                                            const pcl::PointXYZI& start, 
+                                            const TraversabilitySnapshot::ConstPtr& traversability, 
+                                            const Utility2DSnapshot::ConstPtr& utility_2d,
+                                            pcl::PointCloud<pcl::PointXYZI>::ConstPtr& pcl_out, 
+                                            pcl::PointCloud<pcl::PointXYZI>::ConstPtr& pcl_out2)
+{
+    std::vector<int> indices;
+    if( !getCropIndices(crop_box_method, start, *traversability, indices) )
+    {
+        // take all: share the clouds 
+        pcl_out  = traversability->pcl; 
+        pcl_out2 = utility_2d->pcl;
+        return true; /// < EXIT POINT 
     }
-    return res_ok;
+    
+    /// < the utility cloud has the same points of the traversability cloud: the same indices are used 
+    pcl::PointCloud<pcl::PointXYZI>::Ptr p_cropped_pcl(new pcl::PointCloud<pcl::PointXYZI>);
+    pcl::PointCloud<pcl::PointXYZI>::Ptr p_cropped_pcl2(new pcl::PointCloud<pcl::PointXYZI>);
+    pcl::copyPointCloud(*traversability->pcl, indices, *p_cropped_pcl);
+    pcl::copyPointCloud(*utility_2d->pcl, indices, *p_cropped_pcl2);
+    pcl_out  = p_cropped_pcl;
+    pcl_out2 = p_cropped_pcl2;
+    return true;
 } 
 
 void ExplorationPlannerManager::setParamExplorationBoxXY(const double minX, const double maxX, const double minY, const double maxY)
@@ -681,11 +779,112 @@ void ExplorationPlannerManager::setCostFunctionType(int type, double lamda_trav,
 
  void ExplorationPlannerManager::setMyRobotId(int my_robot_id) 
  { 
+     my_robot_id_ = my_robot_id; 
+     
      team_model_.setMyRobotId(my_robot_id); 
      
      p_expl_planner_->setRobotId(my_robot_id);
  }    
 
+static Eigen::Affine3d transformTfToEigen(const tf::Transform& transform)
+{
+    const tf::Vector3& t = transform.getOrigin();
+    const tf::Quaternion q = transform.getRotation();
+    return Eigen::Translation3d(t.x(), t.y(), t.z()) * Eigen::Quaterniond(q.w(), q.x(), q.y(), q.z());
+}
+
+std::string ExplorationPlannerManager::getCheckpointPath() const
+{
+    std::stringstream path;
+    path << p_expl_planner_->getParams().checkpointDir_ << "/ugv" << my_robot_id_ + 1;
+    return path.str();
+}
+
+bool ExplorationPlannerManager::saveCheckpoint()
+{
+    const ExplParams& expl_params = p_expl_planner_->getParams(); 
+    
+    ExplorationCheckpoint checkpoint;
+    checkpoint.stamp = ros::Time::now();
+    last_checkpoint_time_ = checkpoint.stamp; // if it fails, it is not retried at each planning step 
+    
+    p_expl_planner_->getCheckpoint(checkpoint);
+    checkpoint.priority_points = priority_queue_.GetElements();
+    
+    if(!expl_params.checkpointFixedFrame_.empty())
+    {
+        try
+        {
+            const tf::StampedTransform transform = transform_checkpoint_.get(expl_params.checkpointFixedFrame_, checkpoint.map_frame);
+            if(!transform_checkpoint_.isOk()) return false; /// < EXIT POINT 
+            checkpoint.T_fixed_map = transformTfToEigen(transform);
+            checkpoint.fixed_frame = expl_params.checkpointFixedFrame_;
+        }
+        catch(TransformException e )
+        {
+            ROS_WARN("ExplorationPlannerManager::saveCheckpoint() - %s",e.what());
+            return false; /// < EXIT POINT 
+        }
+    }
+    
+    const std::string path = getCheckpointPath();
+    int ret_cmd = system(("mkdir -p ~/.ros/" + path).c_str());
+    
+    // the octomap first: a state file never refers to an older map 
+    if(!p_expl_planner_->writeOctomap(path + "/" + ExplorationCheckpoint::kOctomapFilename)) return false; /// < EXIT POINT 
+    if(!checkpoint.save(path + "/" + ExplorationCheckpoint::kStateFilename)) return false; /// < EXIT POINT 
+    
+    ROS_INFO_STREAM("ExplorationPlannerManager::saveCheckpoint() - saved " << checkpoint.expl_tree_nodes.size() << " exploration nodes, " 
+                    << checkpoint.frontier_tree_nodes.size() << " frontier nodes, " << checkpoint.priority_points.size() << " priority points in ~/.ros/" << path);
+    return true;
+}
+
+bool ExplorationPlannerManager::restoreCheckpoint()
+{
+    const std::string path = getCheckpointPath();
+    
+    ExplorationCheckpoint checkpoint;
+    if(!checkpoint.load(path + "/" + ExplorationCheckpoint::kStateFilename))
+    {
+        ROS_INFO_STREAM("ExplorationPlannerManager::restoreCheckpoint() - no valid checkpoint in ~/.ros/" << path);
+        return true; /// < EXIT POINT : nothing to restore 
+    }
+    
+    // T_new_old moves the saved state from the map frame at save time to the current one 
+    Eigen::Affine3d T_new_old = Eigen::Affine3d::Identity();
+    if(!checkpoint.fixed_frame.empty())
+    {
+        try
+        {
+            const tf::StampedTransform transform = transform_checkpoint_.get(checkpoint.fixed_frame, checkpoint.map_frame);
+            if(!transform_checkpoint_.isOk()) return false; /// < EXIT POINT : retry at the next planning step 
+            T_new_old = transformTfToEigen(transform).inverse() * checkpoint.T_fixed_map;
+        }
+        catch(TransformException e )
+        {
+            ROS_WARN("ExplorationPlannerManager::restoreCheckpoint() - %s",e.what());
+            return false; /// < EXIT POINT : retry at the next planning step 
+        }
+    }
+    
+    if(!p_expl_planner_->loadOctomap(path + "/" + ExplorationCheckpoint::kOctomapFilename, T_new_old))
+    {
+        return true; /// < EXIT POINT : the trees are not restored without their map 
+    }
+    
+    checkpoint.transform(T_new_old);
+    p_expl_planner_->restoreCheckpoint(checkpoint);
+    for(size_t ii=0; ii < checkpoint.priority_points.size(); ii++)
+    {
+        const PriorityPointQueue::PriorityPoint& point = checkpoint.priority_points[ii];
+        priority_queue_.Push(point.id, point.data, point.priority);
+    }
+    
+    ROS_INFO_STREAM("ExplorationPlannerManager::restoreCheckpoint() - restored the checkpoint of " << checkpoint.stamp << " from ~/.ros/" << path 
+                    << " (alignment translation: " << T_new_old.translation().transpose() << ")");
+    return true;
+}
+
 double ExplorationPlannerManager::computePathLength(nav_msgs::Path& path)
 {
     double d_estimated_distance_ = 0;
@@ -715,7 +914,7 @@ bool ExplorationPlannerManager::IsNodeConflict()
     return team_model_.IsNodeConflict();
 }
 
-void ExplorationPlannerManager::mapMessageOverlapCheck(const geometry_msgs::PoseArray& message, std::vector<sensor_msgs::PointCloud2::Ptr>& cloudsToSend)
+void ExplorationPlannerManager::mapMessageOverlapCheck(const geometry_msgs::PoseArray& message, std::vector<sensor_msgs::PointCloud2::ConstPtr>& cloudsToSend)
 {
     p_expl_planner_->mapMessageOverlapCheck(message, cloudsToSend);
 }    
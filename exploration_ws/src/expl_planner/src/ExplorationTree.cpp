@@ -21,6 +21,7 @@
 #include <cstdlib>
 #include <limits>
 #include <algorithm>
+#include <map>
 
 #include "ExplorationTree.h"
 #include "Tree.hpp"
@@ -193,6 +194,75 @@ void ExplorationTree::clear()
     counter_ = 0;
 }
 
+void ExplorationTree::getNodes(ExplorationCheckpoint::TreeNodes& nodes, int& current_id)
+{
+    nodes.clear();
+    current_id = currentNode_ ? currentNode_->id_ : 0;
+    if(!rootNode_) return; /// < EXIT POINT
+    
+    // breadth-first: the parents come before their children 
+    std::vector<Node<StateVec>*> queue(1, rootNode_);
+    for(size_t ii=0; ii < queue.size(); ii++)
+    {
+        Node<StateVec>* node = queue[ii];
+        
+        ExplorationCheckpoint::TreeNode tree_node;
+        tree_node.id = node->id_;
+        tree_node.parent_id = node->parent_ ? node->parent_->id_ : -1;
+        tree_node.state = node->state_;
+        tree_node.gain = node->gain_;
+        tree_node.local_gain = node->local_gain_;
+        tree_node.is_frontier = node->is_frontier_;
+        nodes.push_back(tree_node);
+        
+        queue.insert(queue.end(), node->children_.begin(), node->children_.end());
+    }
+}
+
+void ExplorationTree::restore(const ExplorationCheckpoint::TreeNodes& nodes, int current_id)
+{
+    clear();
+    initialize();
+    if(nodes.empty()) return; /// < EXIT POINT
+    
+    const ExplorationCheckpoint::TreeNode& root = nodes[0];
+    setRoot(root.state[0], root.state[1], root.state[2]);
+    rootNode_->gain_ = root.gain;
+    rootNode_->local_gain_ = root.local_gain;
+    
+    std::map<int, Node<StateVec>*> id_to_node;
+    id_to_node[root.id] = rootNode_;
+    for(size_t ii=1; ii < nodes.size(); ii++)
+    {
+        const ExplorationCheckpoint::TreeNode& tree_node = nodes[ii];
+        std::map<int, Node<StateVec>*>::iterator it = id_to_node.find(tree_node.parent_id);
+        if(it == id_to_node.end())
+        {
+            ROS_WARN_STREAM("ExplorationTree::restore() - cannot find the parent of node " << tree_node.id);
+            continue; 
+        }
+        Node<StateVec>* parent = it->second;
+        
+        Node<StateVec>* node = new Node<StateVec>;
+        node->id_ = tree_node.id;
+        node->state_ = tree_node.state;
+        node->parent_ = parent;
+        node->distance_ = parent->distance_ + (node->state_.head<3>() - parent->state_.head<3>()).norm();
+        node->gain_ = tree_node.gain;
+        node->local_gain_ = tree_node.local_gain;
+        node->is_frontier_ = tree_node.is_frontier;
+        parent->children_.push_back(node);
+        
+        id_to_node[node->id_] = node;
+        counter_ = std::max(counter_, tree_node.id); // the next ids do not collide with the restored ones 
+    }
+    
+    std::map<int, Node<StateVec>*>::iterator it = id_to_node.find(current_id);
+    currentNode_ = (it != id_to_node.end()) ? it->second : rootNode_;
+    
+    std::cout << "ExplorationTree::restore() - restored " << id_to_node.size() << " nodes" << std::endl;
+}
+
 
 void ExplorationTree::publishNode(Node<StateVec> * node)
 {
@@ -203,7 +273,7 @@ void ExplorationTree::publishNode(Node<StateVec> * node)
     p.header.stamp = timestamp;
     p.header.seq = g_ID_;
     p.header.frame_id = params_.navigationFrame_;
-    p.id = g_ID_;
+    p.id = kNumVizNodeMarkers*node->id_ + kVizNodeSphere; // stable id: the markers are published as deltas
     g_ID_++;
     p.ns = kRvizNamespace;
     p.type = visualization_msgs::Marker::SPHERE;
@@ -240,7 +310,7 @@ void ExplorationTree::publishNode(Node<StateVec> * node)
     tm.header.stamp = p.header.stamp;
     tm.header.seq = g_ID_;
     tm.header.frame_id = params_.navigationFrame_;
-    tm.id = g_ID_;
+    tm.id = kNumVizNodeMarkers*node->id_ + kVizNodeText;
     g_ID_++;
     tm.ns = kRvizNamespace;
     tm.type = visualization_msgs::Marker::TEXT_VIEW_FACING;
@@ -274,7 +344,7 @@ void ExplorationTree::publishNode(Node<StateVec> * node)
     arrowMarker.header.stamp = p.header.stamp;
     arrowMarker.header.seq = g_ID_;
     arrowMarker.header.frame_id = params_.navigationFrame_; 
-    arrowMarker.id = g_ID_;
+    arrowMarker.id = kNumVizNodeMarkers*node->id_ + kVizNodeArrow;
     g_ID_++;
     arrowMarker.ns = kRvizNamespace;
     arrowMarker.type = visualization_msgs::Marker::ARROW;
@@ -402,11 +472,13 @@ void ExplorationTree::publishTree()
     // delete all markers 
     treeMarkerArray_.markers.clear();
     
-    // now republish all the node markers by using a recursive function 
+    if(!params_.explorationPathPub_->hasSubscribers()) return; /// < EXIT POINT 
+    
+    // now republish all the node markers by using a recursive function (only the changes are actually sent)
     g_ID_ = 0;
     publishNodeRecursive(rootNode_);
     
-    params_.explorationPathPub_.publish(treeMarkerArray_);
+    params_.explorationPathPub_->publish(treeMarkerArray_);
 }
 
 void ExplorationTree::publishNodeRecursive(Node<StateVec> * node)
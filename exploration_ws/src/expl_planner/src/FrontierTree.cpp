@@ -50,23 +50,17 @@ FrontierTree::FrontierTree()
 {
     iterationCount_ = 0;
     numClusters_ = 0;
-    
-    kdTree_ = kd_create(3);
 }
 
 FrontierTree::FrontierTree(std::shared_ptr<volumetric_mapping::OctomapManager>& p_manager)
 {
     p_octomap_manager_ = p_manager;
     iterationCount_ = 0;
-    
-    kdTree_ = kd_create(3);    
-        
 }
 
 FrontierTree::~FrontierTree()
 {
     delete rootNode_;  // N.B.: deleting the root node we use the destructor ~Node() which recursively delete all its children
-    if(kdTree_) kd_free(kdTree_);    
 }
 
 void FrontierTree::setRoot(double x, double y, double z)
@@ -79,7 +73,7 @@ void FrontierTree::setRoot(double x, double y, double z)
     rootNode_->state_ = root_;
     exact_root_ = root_;    
     
-    kd_insert3(kdTree_, rootNode_->state_.x(), rootNode_->state_.y(), rootNode_->state_.z(), rootNode_);    
+    kdTree_.insert(rootNode_->state_.x(), rootNode_->state_.y(), rootNode_->state_.z(), rootNode_);    
         
     std::cout << "FrontierTree::setRoot() - root:  " <<  root_ << std::endl;     
 }
@@ -92,18 +86,14 @@ bool FrontierTree::addNode(Node<StateVec>* node)
     newState = node->state_;
     
     // Find nearest neighbor
-    kdres * nearest = kd_nearest3(kdTree_, newState.x(), newState.y(), newState.z());
-    if (kd_res_size(nearest) <= 0)
+    //Node<StateVec> * newParent = currentNode_;    
+    Node<StateVec> * newParent = kdTree_.nearest(newState.x(), newState.y(), newState.z());
+    if (!newParent)
     {
         std::cout << "FrontierTree::addNode() - WARNING - did not find nearest neighbour" << std::endl;
-        kd_res_free(nearest);
         return false;
     }
 
-    //Node<StateVec> * newParent = currentNode_;    
-    Node<StateVec> * newParent = (Node<StateVec> *) kd_res_item_data(nearest);
-    kd_res_free(nearest);
-
     Eigen::Vector3d origin(newParent->state_[0], newParent->state_[1], newParent->state_[2]);
     Eigen::Vector3d direction(newState[0] - origin[0], newState[1] - origin[1], newState[2] - origin[2]);
     
@@ -117,9 +107,14 @@ bool FrontierTree::addNode(Node<StateVec>* node)
         {
             //newParent->state_ = node->state_;            
             newParent->local_gain_ = node->local_gain_;
+            newParent->local_gain_version_ = 0; // the gain was computed at the state of node: it is recomputed at the next update 
             newParent->is_frontier_ = (node->local_gain_ > params_.zero_gain_);               
         }
-        if(newParent->is_frontier_) frontierNodes_.insert(newParent);
+        if(newParent->is_frontier_) 
+        {
+            frontierNodes_.insert(newParent);
+            clusterer_.insert(newParent);
+        }
         //newParent->neighbors_radius_ = std::max(newParent->neighbors_radius_, directionNorm);               
         return false; 
     }
@@ -133,6 +128,7 @@ bool FrontierTree::addNode(Node<StateVec>* node)
     newNode->parent_ = newParent;
     newNode->distance_ = newParent->distance_ + direction.norm();
     newNode->local_gain_ = node->local_gain_;
+    newNode->local_gain_version_ = node->local_gain_version_;
     //newNode->gain_ = node->gain_; // not actually used here!
     newNode->is_frontier_ = (node->local_gain_ > params_.zero_gain_); 
     
@@ -141,9 +137,13 @@ bool FrontierTree::addNode(Node<StateVec>* node)
     
     newParent->children_.push_back(newNode);
     
-    if(newNode->is_frontier_) frontierNodes_.insert(newNode);
+    if(newNode->is_frontier_) 
+    {
+        frontierNodes_.insert(newNode);
+        clusterer_.insert(newNode);
+    }
     
-    kd_insert3(kdTree_, newState.x(), newState.y(), newState.z(), newNode);    
+    kdTree_.insert(newState.x(), newState.y(), newState.z(), newNode);    
             
     currentNode_ = newNode; 
     
@@ -154,14 +154,26 @@ void FrontierTree::updateFrontierNodes()
 {        
     boost::recursive_mutex::scoped_lock locker(p_octomap_manager_->interaction_mutex);
     
+    const uint64_t map_version = p_octomap_manager_->getMapVersion();
+    size_t num_updated_gains = 0;
+    
     for (auto it = frontierNodes_.begin(); it != frontierNodes_.end(); ) 
     {
         Node<StateVec>* node = *it;
-        node->local_gain_ = gain(node->state_); // update local gain 
+        
+        // with the gain cache, the local gain is recomputed only if the map changed within the gain region of the node 
+        if ( !params_.bCacheFrontierGains_ || isGainRegionChanged(node->state_, node->local_gain_version_) )
+        {
+            node->local_gain_ = gain(node->state_); // update local gain 
+            node->local_gain_version_ = map_version;
+            num_updated_gains++;
+        }
+        
         if ( node->local_gain_ < params_.zero_gain_ ) 
         {
             node->is_frontier_ = false; 
             node->label_ = -1;
+            clusterer_.remove(node);
             it = frontierNodes_.erase(it++);
         }
         else 
@@ -169,6 +181,8 @@ void FrontierTree::updateFrontierNodes()
             ++it;
         }
     }        
+    
+    std::cout << "FrontierTree::updateFrontierNodes() - updated gains: " << num_updated_gains << ", frontier nodes: " << frontierNodes_.size() << std::endl; 
 }
     
 void FrontierTree::addFrontierNodes(const std::vector<Node<StateVec>* >& frontierNodes)
@@ -185,9 +199,8 @@ void FrontierTree::initialize()
     
     g_ID_ = 0;
     
-    if(kdTree_) kd_free(kdTree_);
     // Initialize kd-tree with root node and prepare log file
-    kdTree_ = kd_create(3);    
+    kdTree_.clear();
     
     std::cout << "FrontierTree::initialize() - log file created" << std::endl;   
 
@@ -213,7 +226,7 @@ void FrontierTree::initialize()
     currentNode_ = rootNode_;
     
     // we cannot insert here the root node cause its position may be not set 
-    //kd_insert3(kdTree_, rootNode_->state_.x(), rootNode_->state_.y(), rootNode_->state_.z(), rootNode_);    
+    //kdTree_.insert(rootNode_->state_.x(), rootNode_->state_.y(), rootNode_->state_.z(), rootNode_);    
 
     std::cout << "FrontierTree::initialize() - end " << std::endl;     
 }
@@ -227,9 +240,61 @@ void FrontierTree::clear()
 
     counter_ = 0;
     
-    if(kdTree_) kd_free(kdTree_);    
-    kdTree_ = 0;  
+    kdTree_.clear();
     
+    // the frontier nodes have been deleted with the tree 
+    frontierNodes_.clear();
+    clusterer_.clear();
+}
+
+void FrontierTree::getNodes(ExplorationCheckpoint::TreeNodes& nodes)
+{
+    nodes.clear();
+    if(!rootNode_) return; /// < EXIT POINT
+    
+    std::vector<Node<StateVec>*> stack(1, rootNode_);
+    while(!stack.empty())
+    {
+        Node<StateVec>* node = stack.back();
+        stack.pop_back();
+        
+        ExplorationCheckpoint::TreeNode tree_node;
+        tree_node.id = node->id_;
+        tree_node.parent_id = node->parent_ ? node->parent_->id_ : -1;
+        tree_node.state = node->state_;
+        tree_node.gain = node->gain_;
+        tree_node.local_gain = node->local_gain_;
+        tree_node.is_frontier = node->is_frontier_;
+        nodes.push_back(tree_node);
+        
+        stack.insert(stack.end(), node->children_.begin(), node->children_.end());
+    }
+    
+    // insertion order: each node is re-added after its nearest neighbours of that time 
+    std::sort(nodes.begin(), nodes.end(), 
+              [](const ExplorationCheckpoint::TreeNode& a, const ExplorationCheckpoint::TreeNode& b) { return a.id < b.id; });
+}
+
+void FrontierTree::restore(const ExplorationCheckpoint::TreeNodes& nodes)
+{
+    clear();
+    initialize();
+    if(nodes.empty()) return; /// < EXIT POINT
+    
+    const ExplorationCheckpoint::TreeNode& root = nodes[0];
+    setRoot(root.state[0], root.state[1], root.state[2]);
+    
+    for(size_t ii=1; ii < nodes.size(); ii++)
+    {
+        Node<StateVec> node;
+        node.state_ = nodes[ii].state;
+        node.gain_ = nodes[ii].gain;
+        node.local_gain_ = nodes[ii].local_gain;
+        node.local_gain_version_ = 0; // the gain refers to the map at save time: it is recomputed at the next update 
+        addNode(&node);
+    }
+    
+    std::cout << "FrontierTree::restore() - restored " << getNumNodes() << " nodes, " << frontierNodes_.size() << " frontier nodes" << std::endl;
 }
 
 
@@ -242,7 +307,7 @@ void FrontierTree::publishNode(Node<StateVec> * node)
     p.header.stamp = timestamp;
     p.header.seq = g_ID_;
     p.header.frame_id = params_.navigationFrame_;
-    p.id = g_ID_;
+    p.id = kNumVizNodeMarkers*node->id_ + kVizNodeSphere; // stable id: the markers are published as deltas
     g_ID_++;
     p.ns = kRvizNamespace;
     p.type = visualization_msgs::Marker::SPHERE;
@@ -282,7 +347,7 @@ void FrontierTree::publishNode(Node<StateVec> * node)
         p.header.stamp = ros::Time::now();
         p.header.seq = g_ID_;
         p.header.frame_id = params_.navigationFrame_;
-        p.id = g_ID_;
+        p.id = node->id_;
         g_ID_++;    
         p.ns = kRvizNamespace;
         p.type = visualization_msgs::Marker::CYLINDER;
@@ -318,7 +383,7 @@ void FrontierTree::publishNode(Node<StateVec> * node)
         arrowMarker.header.stamp = p.header.stamp;
         arrowMarker.header.seq = g_ID_;
         arrowMarker.header.frame_id = params_.navigationFrame_; 
-        arrowMarker.id = g_ID_;
+        arrowMarker.id = kNumVizNodeMarkers*node->id_ + kVizNodeArrow;
         g_ID_++;
         arrowMarker.ns = kRvizNamespace;
         arrowMarker.type = visualization_msgs::Marker::ARROW;
@@ -357,19 +422,25 @@ void FrontierTree::publishTree()
 {
     ros::Time timestamp = ros::Time::now();
     
+#if SHOW_FRONTIER_CLUSTERS 
+    if(!params_.explorationFrontierTreePub_->hasSubscribers() && !params_.explorationFrontierClustersPub_->hasSubscribers()) return; /// < EXIT POINT 
+#else
+    if(!params_.explorationFrontierTreePub_->hasSubscribers()) return; /// < EXIT POINT 
+#endif 
+    
     // delete all markers     
     frontiersMarkerArray_.markers.clear();
 #if SHOW_FRONTIER_CLUSTERS 
     clustersMarkerArray_.markers.clear();
 #endif     
     
-    // now republish all the node markers by using a recursive function 
+    // now republish all the node markers by using a recursive function (only the changes are actually sent)
     g_ID_ = 0;
     publishNodeRecursive(rootNode_);
     
-    params_.explorationFrontierTreePub_.publish(frontiersMarkerArray_); 
+    params_.explorationFrontierTreePub_->publish(frontiersMarkerArray_); 
 #if SHOW_FRONTIER_CLUSTERS     
-    params_.explorationFrontierClustersPub_.publish(clustersMarkerArray_);     
+    params_.explorationFrontierClustersPub_->publish(clustersMarkerArray_);     
 #endif     
 }
 
@@ -391,136 +462,27 @@ void FrontierTree::clusterFrontiers()
     numClusters_ = 0;
     clusters_.clear();    
     
-    // reset labels of frontier nodes 
-    for( auto it=frontierNodes_.begin(), itEnd=frontierNodes_.end(); it != itEnd; it++)
-    {
-        Node<StateVec>* node = *it; 
-        node->label_ = -1;
-    }    
+    // the clusterer keeps the frontier nodes in a spatial hash and their clusters in a union-find forest: 
+    // the added frontier nodes have already been merged, the forest is rebuilt only if some frontier nodes were removed 
+    clusterer_.setRadius(params_.frontierClusteringRadius_);
+    clusterer_.update();
     
-    int frontierNodeCount = 0; 
-    int currentLabel = 0;
-    const double maxDist = params_.frontierClusteringRadius_;
-    const double maxDist2 = squared(maxDist);    
-    
-    // let's cluster the frontier nodes 
-    for( auto it=frontierNodes_.begin(), itEnd=frontierNodes_.end(); it != itEnd; it++)
+    // label the clusters (labels start from 1 as before)
+    const size_t numFrontierNodes = clusterer_.size();
+    clusterLabels_.assign(numFrontierNodes, -1); // root index -> label 
+    for(size_t ii=0; ii<numFrontierNodes; ii++)
     {
-        frontierNodeCount++;
-        
-        Node<StateVec>* currentFrontierNode = *it;  
-        std::set<Node<StateVec>*> neighbors;
-        std::set<int> labelsOfClustersToMerge;
-        
-#if VERBOSE        
-        std::cout << "* frontier node " << frontierNodeCount <<", id: " << currentFrontierNode->id_ <<  std::endl;        
-#endif         
-        
-        // find neighbors 
-#if 0        
-        auto itNext = it; 
-        itNext++;
-        for( ; itNext != itEnd; itNext++)
-        {
-            Node<StateVec>* otherNode = *itNext;               
-            double distance2 = squared(currentFrontierNode->state_[0] - otherNode->state_[0]) + squared(currentFrontierNode->state_[1] - otherNode->state_[1]) + squared(currentFrontierNode->state_[2] - otherNode->state_[2]);
-            if( distance2 < maxDist2 )
-            {
-                neighbors.insert(otherNode);
-                if(otherNode->label_ != -1)
-                {
-                    labelsOfClustersToMerge.insert(otherNode->label_);
-                }
-            }
-        }
-#else
-        // Find nearest neighbors within range 
-        kdres * nnResult = kd_nearest_range3(kdTree_, currentFrontierNode->state_[0], currentFrontierNode->state_[1], currentFrontierNode->state_[2], maxDist);
-        if (kd_res_size(nnResult) <= 0)
+        Node<StateVec>* node = clusterer_.getNode(ii);
+        const int root = clusterer_.findRoot(ii);
+        if(clusterLabels_[root] == -1)
         {
-            std::cout << "FrontierTree::clusterFrontiers() - WARNING - did not find nearest neighbor" << std::endl;
-            kd_res_free(nnResult);
+            clusterLabels_[root] = ++numClusters_;
+            clusters_[numClusters_] = NodeSet<StateVec>(node, numClusters_); 
         }
         else
         {
-            while( !kd_res_end( nnResult ) ) 
-            {
-                Node<StateVec>* otherNode = (Node<StateVec> *) kd_res_item_data(nnResult);   
-                
-                // here, neighbors can be non-frontier nodes; we are clustering just frontier nodes 
-                if(otherNode->is_frontier_)
-                {
-                    neighbors.insert(otherNode);
-                    if(otherNode->label_ != -1)
-                    {
-                        labelsOfClustersToMerge.insert(otherNode->label_);
-                    }
-                }
-                // go to the next entry 
-                kd_res_next( nnResult );
-            }
-            
-        }   
-        kd_res_free(nnResult);           
-#endif         
-        
-#if VERBOSE            
-        std::cout << " #neighbors: " << neighbors.size() << std::endl;
-#endif        
-                
-        // if the current node has a label then let's put it inside labelsOfClustersToMerge
-        if(currentFrontierNode->label_ != -1)
-        {
-            labelsOfClustersToMerge.insert(currentFrontierNode->label_);
-        }        
-        
-        if(labelsOfClustersToMerge.empty())
-        {      
-            // the current node and its found neighbors do not belong to a cluster             
-            currentFrontierNode->label_ = ++currentLabel;
-            numClusters_++;               
-            
-#if VERBOSE              
-            std::cout << " no label to merge => creating new cluster: " << currentFrontierNode->label_  << std::endl;      
-#endif             
- 
-            // create a new cluster with the node and its neighbors 
-            neighbors.insert(currentFrontierNode);
-            clusters_[currentFrontierNode->label_] = NodeSet<StateVec>(neighbors,currentFrontierNode->label_);                                          
+            clusters_[clusterLabels_[root]].insert(node); 
         }
-        else
-        {            
-            std::vector<int> vecLabels(labelsOfClustersToMerge.begin(),labelsOfClustersToMerge.end());
-
-            // get the oldest cluster and merge all the other clusters into it
-            int destLabel = vecLabels[0];
-            
-            neighbors.insert(currentFrontierNode);            
-            
-            // insert the current node and its found neighbors into the oldest cluster 
-            clusters_[destLabel].insert(neighbors); 
-
-            size_t numClustersToMerge = vecLabels.size();
-            
-            // merge clusters and destroy the merged clusters [!starting from second element, in order to avoid vecLabels[0]!]
-            for(size_t ii=1,iiEnd=vecLabels.size(); ii<iiEnd; ii++)
-            {                
-                // merge and delete cluster `ii`
-                auto itDel = clusters_.find(vecLabels[ii]);
-                if(itDel != clusters_.end())
-                {
-#if VERBOSE                            
-                    std::cout << " merging cluster: " << vecLabels[ii] <<" into cluster: " << vecLabels[0] << std::endl;                    
-#endif                     
-                    // merge cluster `ii` into cluster `destLabel`
-                    clusters_[destLabel].insert(clusters_[vecLabels[ii]].nodes);
-                
-                    clusters_.erase(vecLabels[ii]);
-                    numClusters_--;
-                    //std::cout << " deleted cluster: " << vecLabels[ii] << std::endl;                      
-                }                            
-            }
-        }                
     }
 #if VERBOSE       
     std::cout << "FrontierTree::clusterFrontiers() - #clusters: " << numClusters_ << ", #frontier-nodes: " <<  frontierNodes_.size() << std::endl;   
@@ -561,7 +523,12 @@ Node<FrontierTree::StateVec>* FrontierTree::planBestFrontierCentroid(std::shared
     for(size_t ii=0, iiEnd=clusters.size(); ii<iiEnd; ii++)
     {
         Node<StateVec>* centroidNode = clusters[ii]->centroidNode;
-        Node<StateVec>* navNode = p_nav_tree->getNearest(centroidNode->state_[0], centroidNode->state_[1], centroidNode->state_[2]);
+        if(centroidNode == NULL) continue; /// < CONTINUE (empty cluster)
+        // the centroid node is a frontier-tree node: its distance from the robot is a lookup in the distance field of the navigation tree 
+        Node<StateVec>* navNode = p_nav_tree->getNavNode(centroidNode);
+        if(navNode == NULL) navNode = p_nav_tree->getNearest(centroidNode->state_[0], centroidNode->state_[1], centroidNode->state_[2]);
+        if(navNode == NULL) continue; /// < CONTINUE
+        clusters[ii]->navigationCost = navNode->distance_;
         clusters[ii]->utility = exp(-params_.degressiveCoeff_ * navNode->distance_) * clusters[ii]->informationGain;
         if( bestUtility < clusters[ii]->utility)
         {
@@ -618,6 +585,7 @@ void FrontierTree::resetSelectedBackTrackingCluster()
             node->is_frontier_ = false; 
             node->label_ = -1;
             frontierNodes_.erase(node);            
+            clusterer_.remove(node);
         }
         cluster.clear();
     }
@@ -0,0 +1,77 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "MapSyncScheduler.h"
+
+#include <algorithm>
+
+
+namespace explplanner
+{
+
+MapSyncScheduler::MapSyncScheduler():tokens_(0)
+{}
+
+void MapSyncScheduler::setParams(const MapSyncParams& params)
+{
+    params_ = params;
+    if (params_.burst_ <= 0) params_.burst_ = params_.bandwidth_; // one second of bandwidth
+    tokens_ = params_.burst_;
+    lastRefill_ = ros::Time(0);
+}
+
+bool MapSyncScheduler::schedule(int peerId, uint32_t scanIndex, double information, const ros::Time& now)
+{
+    const uint64_t key = getKey(peerId, scanIndex);
+    if (queued_.count(key)) return false; /// < EXIT POINT
+
+    auto it = lastSent_.find(key);
+    if ((it != lastSent_.end()) && ((now - it->second).toSec() < params_.resend_time_)) return false; /// < EXIT POINT
+
+    queued_.insert(key);
+    queue_.Push(scanIndex, Request(peerId, scanIndex), information);
+    return true;
+}
+
+bool MapSyncScheduler::next(const ros::Time& now, Request& request)
+{
+    refill(now);
+    if (queue_.IsEmpty() || (isRateLimited() && (tokens_ <= 0))) return false; /// < EXIT POINT
+
+    request = queue_.Top().data;
+    queue_.Pop();
+
+    const uint64_t key = getKey(request.peerId, request.scanIndex);
+    queued_.erase(key);
+    lastSent_[key] = now;
+    return true;
+}
+
+void MapSyncScheduler::refill(const ros::Time& now)
+{
+    if (!lastRefill_.isZero())
+    {
+        const double dt = std::max((now - lastRefill_).toSec(), 0.);
+        tokens_ = std::min(tokens_ + params_.bandwidth_ * dt, params_.burst_);
+    }
+    lastRefill_ = now;
+}
+
+} // namespace explplanner
@@ -0,0 +1,197 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "MarkerArrayDiffPublisher.h"
+
+#include <cmath>
+#include <algorithm>
+
+#include <boost/bind.hpp>
+
+
+namespace explplanner{
+
+const int MarkerArrayDiffPublisher::kMaxDecimationLevel = 6; // max stride is 2^kMaxDecimationLevel 
+const double MarkerArrayDiffPublisher::kDecimationGridSize = 0.1; // [m] resolution of the positions used for selecting the decimated markers 
+
+static inline bool isSamePoint(const geometry_msgs::Point& a, const geometry_msgs::Point& b)
+{
+    return (a.x == b.x) && (a.y == b.y) && (a.z == b.z);
+}
+
+static inline bool isSameColor(const std_msgs::ColorRGBA& a, const std_msgs::ColorRGBA& b)
+{
+    return (a.r == b.r) && (a.g == b.g) && (a.b == b.b) && (a.a == b.a);
+}
+
+// final mix of MurmurHash3: the low bits depend on all the input bits 
+static inline uint32_t mixHash(uint32_t h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
+
+MarkerArrayDiffPublisher::MarkerArrayDiffPublisher(ros::NodeHandle& nh, const std::string& topic, uint32_t queue_size, double decimation_distance)
+    :stamp_(0),
+     b_resend_all_(true),
+     view_point_(Eigen::Vector3d::Zero()),
+     decimation_distance_(std::max(decimation_distance, 0.))
+{
+    pub_ = nh.advertise<visualization_msgs::MarkerArray>(topic, queue_size, boost::bind(&MarkerArrayDiffPublisher::connectCallback, this, _1));
+}
+
+void MarkerArrayDiffPublisher::connectCallback(const ros::SingleSubscriberPublisher& pub)
+{
+    boost::mutex::scoped_lock locker(mutex_);
+    b_resend_all_ = true; 
+}
+
+void MarkerArrayDiffPublisher::setViewPoint(const Eigen::Vector3d& view_point)
+{
+    boost::mutex::scoped_lock locker(mutex_);
+    view_point_ = view_point; 
+}
+
+void MarkerArrayDiffPublisher::setDecimationDistance(double decimation_distance)
+{
+    boost::mutex::scoped_lock locker(mutex_);
+    decimation_distance_ = std::max(decimation_distance, 0.); 
+}
+
+void MarkerArrayDiffPublisher::publish(const visualization_msgs::MarkerArray& markers)
+{
+    boost::mutex::scoped_lock locker(mutex_);
+    
+    if(pub_.getNumSubscribers() == 0) return; /// < EXIT POINT : nothing to serialize 
+    
+    visualization_msgs::MarkerArray delta; 
+    
+    if(b_resend_all_)
+    {
+        // clean up what the subscribers may be showing and send everything again 
+        visualization_msgs::Marker delete_all;
+        if(!markers.markers.empty()) delete_all.header = markers.markers.front().header;
+        delete_all.action = visualization_msgs::Marker::DELETEALL;
+        delta.markers.push_back(delete_all);
+        published_.clear();
+        b_resend_all_ = false; 
+    }
+    
+    stamp_++;
+    
+    /// < new and changed markers 
+    for(size_t ii=0; ii < markers.markers.size(); ii++)
+    {
+        const visualization_msgs::Marker& marker = markers.markers[ii];
+        if(!isKept(marker)) continue; 
+        
+        std::map<MarkerKey, PublishedMarker>::iterator it = published_.find(MarkerKey(marker.ns, marker.id));
+        if(it == published_.end())
+        {
+            it = published_.insert(std::make_pair(MarkerKey(marker.ns, marker.id), PublishedMarker())).first;
+        }
+        else if( isSameMarker(it->second.marker, marker) && marker.lifetime.isZero() )
+        {
+            it->second.stamp = stamp_;
+            continue; // unchanged
+        }
+        
+        it->second.marker = marker;
+        it->second.stamp = stamp_;
+        delta.markers.push_back(marker);
+        delta.markers.back().action = visualization_msgs::Marker::ADD; // add or modify 
+    }
+    
+    /// < removed markers 
+    const ros::Time now = ros::Time::now(); 
+    for(std::map<MarkerKey, PublishedMarker>::iterator it = published_.begin(); it != published_.end(); )
+    {
+        if(it->second.stamp == stamp_)
+        {
+            ++it; 
+            continue; 
+        }
+        visualization_msgs::Marker marker_delete;
+        marker_delete.header.frame_id = it->second.marker.header.frame_id;
+        marker_delete.header.stamp = now;
+        marker_delete.ns = it->first.first;
+        marker_delete.id = it->first.second;
+        marker_delete.action = visualization_msgs::Marker::DELETE;
+        delta.markers.push_back(marker_delete);
+        published_.erase(it++);
+    }
+    
+    if(!delta.markers.empty()) pub_.publish(delta);
+}
+
+bool MarkerArrayDiffPublisher::isKept(const visualization_msgs::Marker& marker) const
+{
+    if(decimation_distance_ <= 0) return true; /// < EXIT POINT 
+    
+    // position of the marker (the end point for the markers with points, e.g. the arrow toward a tree node)
+    Eigen::Vector3d position(marker.pose.position.x, marker.pose.position.y, marker.pose.position.z);
+    if(!marker.points.empty())
+    {
+        const geometry_msgs::Point& point = marker.points.back();
+        position += Eigen::Vector3d(point.x, point.y, point.z);
+    }
+    
+    const double distance = (position - view_point_).norm();
+    if(distance <= decimation_distance_) return true; /// < EXIT POINT 
+    
+    const int level = std::min((int)floor(log2(distance/decimation_distance_)) + 1, kMaxDecimationLevel);
+    const uint32_t stride = 1u << level; 
+    
+    const uint32_t ix = (uint32_t)(int32_t)floor(position[0]/kDecimationGridSize);
+    const uint32_t iy = (uint32_t)(int32_t)floor(position[1]/kDecimationGridSize);
+    const uint32_t iz = (uint32_t)(int32_t)floor(position[2]/kDecimationGridSize);
+    const uint32_t hash = mixHash(ix*73856093u ^ iy*19349663u ^ iz*83492791u);
+    return (hash & (stride - 1)) == 0; 
+}
+
+bool MarkerArrayDiffPublisher::isSameMarker(const visualization_msgs::Marker& a, const visualization_msgs::Marker& b)
+{
+    if( (a.type != b.type) || (a.header.frame_id != b.header.frame_id) || (a.frame_locked != b.frame_locked) ) return false;
+    
+    if( !isSamePoint(a.pose.position, b.pose.position) || 
+        (a.pose.orientation.x != b.pose.orientation.x) || (a.pose.orientation.y != b.pose.orientation.y) || 
+        (a.pose.orientation.z != b.pose.orientation.z) || (a.pose.orientation.w != b.pose.orientation.w) ) return false;
+    
+    if( (a.scale.x != b.scale.x) || (a.scale.y != b.scale.y) || (a.scale.z != b.scale.z) || !isSameColor(a.color, b.color) ) return false;
+    
+    if( (a.text != b.text) || (a.mesh_resource != b.mesh_resource) ) return false; 
+    
+    if( (a.points.size() != b.points.size()) || (a.colors.size() != b.colors.size()) ) return false;
+    for(size_t ii=0; ii < a.points.size(); ii++)
+    {
+        if(!isSamePoint(a.points[ii], b.points[ii])) return false;
+    }
+    for(size_t ii=0; ii < a.colors.size(); ii++)
+    {
+        if(!isSameColor(a.colors[ii], b.colors[ii])) return false;
+    }
+    return true; 
+}
+
+} // namespace explplanner
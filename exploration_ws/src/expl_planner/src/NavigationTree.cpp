@@ -31,19 +31,15 @@ const std::string NavigationTree::kRvizNamespace = "expl_nav_tree";
 NavigationTree::NavigationTree()
 {
     extKdTree_ = NULL;
-    kdTree_ = NULL;
     
     rootNode_ = NULL;
     
     counter_ = 0;
-    
-    kdTree_ = kd_create(3);
 }    
     
 NavigationTree::~NavigationTree()
 {
     if(rootNode_) delete rootNode_;  // N.B.: deleting the root node we use the destructor ~Node() which recursively delete all its children
-    if(kdTree_) kd_free(kdTree_);    
 }
 
 void NavigationTree::setParams(const ExplParams& params) 
@@ -57,8 +53,7 @@ void NavigationTree::initialize()
     
     g_ID_ = 0;
     
-    if(kdTree_) kd_free(kdTree_);
-    kdTree_ = kd_create(3);    
+    kdTree_.clear();
 
     rootNode_ = new Node<StateVec>;
     rootNode_->id_ = 0;
@@ -66,7 +61,7 @@ void NavigationTree::initialize()
     rootNode_->distance_ = 0.0;
     rootNode_->parent_ = NULL; 
 
-    kd_insert3(kdTree_, rootNode_->state_.x(), rootNode_->state_.y(), rootNode_->state_.z(), rootNode_);  
+    kdTree_.insert(rootNode_->state_.x(), rootNode_->state_.y(), rootNode_->state_.z(), rootNode_);  
     
     if(extKdTree_ == NULL)
     {
@@ -84,7 +79,7 @@ void NavigationTree::initialize()
     newNode->data_ = extNearestNode;
     
     priorityQueue_.Push(newNode->id_,newNode,0);
-    visitedNodes_[extNearestNode->id_] = true;    
+    visitedNodes_[extNearestNode->id_] = newNode;    
 
     std::cout << "ExplorationFrontierTree::initialize() - end " << std::endl;     
 }
@@ -96,8 +91,7 @@ void NavigationTree::clear()
 
     counter_ = 0;     
     
-    if(kdTree_) kd_free(kdTree_);    
-    kdTree_ = 0;  
+    kdTree_.clear();
     
     extKdTree_ = 0;
     
@@ -114,7 +108,7 @@ void NavigationTree::setRoot(double x, double y, double z)
     root_[3] = 0;    
 }
 
-void NavigationTree::setInputKdtree(kdtree* kdTree)
+void NavigationTree::setInputKdtree(NodeKdTree<Node<StateVec> >* kdTree)
 {
     extKdTree_ = kdTree;
 }
@@ -151,19 +145,19 @@ Node<NavigationTree::StateVec>* NavigationTree::addNode(NavigationTree::StateVec
         parent->children_.push_back(newNode);    
     }
      
-    kd_insert3(kdTree_, newState.x(), newState.y(), newState.z(), newNode); // internal kdtree  
+    kdTree_.insert(newState.x(), newState.y(), newState.z(), newNode); // internal kdtree  
     
     return newNode;     
 }
 
 Node<NavigationTree::StateVec>* NavigationTree::getNearest(const double x, const double y, const double z)
 {
-    return getTreeNearest(kdTree_,x,y,z);
+    return getTreeNearest(&kdTree_,x,y,z);
 }
     
 void NavigationTree::getNearestRange(const double x, const double y, const double z, const double range, std::vector<Node<StateVec>*>& neighbors)
 {
-    return getTreeNearestRange(kdTree_,x,y,z,range,neighbors);    
+    return getTreeNearestRange(&kdTree_,x,y,z,range,neighbors);    
 }
 
 Node<NavigationTree::StateVec>* NavigationTree::getExtNearest(const double x, const double y, const double z)
@@ -176,58 +170,33 @@ void NavigationTree::getExtNearestRange(const double x, const double y, const do
     return getTreeNearestRange(extKdTree_,x,y,z,range,neighbors);    
 }
     
-Node<NavigationTree::StateVec>* NavigationTree::getTreeNearest(kdtree* tree, const double x, const double y, const double z)
+Node<NavigationTree::StateVec>* NavigationTree::getTreeNearest(const NodeKdTree<Node<StateVec> >* tree, const double x, const double y, const double z)
 {
-    Node<StateVec>* res = NULL;
-    
     // Find nearest neighbor
-    kdres * nearest = kd_nearest3(tree, x, y, z);
-    if (kd_res_size(nearest) <= 0)
+    Node<StateVec>* res = tree->nearest(x, y, z);
+    if (!res)
     {
         std::cout << "NavigationTree::getTreeNearestRange() - WARNING - did not find nearest neighbour" << std::endl;
-        kd_res_free(nearest);
-        return res;
     }
- 
-    res = (Node<StateVec> *) kd_res_item_data(nearest);
-    kd_res_free(nearest);
     return res;    
 }
 
 
-void NavigationTree::getTreeNearestRange(kdtree* tree, const double x, const double y, const double z, const double range, std::vector<Node<NavigationTree::StateVec>*>& neighbors)
+void NavigationTree::getTreeNearestRange(const NodeKdTree<Node<StateVec> >* tree, const double x, const double y, const double z, const double range, std::vector<Node<NavigationTree::StateVec>*>& neighbors)
 {
     neighbors.clear();
     
-    std::vector< std::pair<double,Node<StateVec>*> > list; 
-    
-    // Find nearest neighbors within range 
-    kdres * nnResult = kd_nearest_range3(tree, x, y, z, range);
-    if (kd_res_size(nnResult) <= 0)
+    // Find nearest neighbors within range (the kdtree returns their squared distances)
+    rangeResults_.clear();
+    if (tree->nearestRange(x, y, z, range, rangeResults_) == 0)
     {
         std::cout << "NavigationTree::getTreeNearestRange() - WARNING - did not find nearest neighbor" << std::endl;
-        kd_res_free(nnResult);
+        return; 
     }
-    else
-    {
-        while( !kd_res_end( nnResult ) ) 
-        {
-            Node<StateVec>* neighbor = (Node<StateVec> *) kd_res_item_data(nnResult);   
-            
-            Eigen::Vector3d direction(neighbor->state_[0] - x, neighbor->state_[1] - y, neighbor->state_[2] - z);
-            double distance2 = direction.squaredNorm();
-            
-            list.push_back(std::make_pair(distance2,neighbor));
-                                
-            // go to the next entry 
-            kd_res_next( nnResult );
-        }
-
-    }   
-    kd_res_free(nnResult);         
     
-    std::sort(list.begin(),list.end());
-    for(auto it=list.begin(),itEnd=list.end();it<itEnd;it++)
+    std::sort(rangeResults_.begin(),rangeResults_.end());
+    neighbors.reserve(rangeResults_.size());
+    for(auto it=rangeResults_.begin(),itEnd=rangeResults_.end();it<itEnd;it++)
     {
         neighbors.push_back(it->second);    
     }
@@ -304,7 +273,7 @@ void NavigationTree::expand()
                 
                 newNode->data_ = extNeighbors[ii];
 
-                visitedNodes_[extNeighbors[ii]->id_] = true;
+                visitedNodes_[extNeighbors[ii]->id_] = newNode;
                 priorityQueue_.Push(extNeighbors[ii]->id_, newNode, -newNode->distance_); // highest priority goes to the node with shortest distance from root (we invert the sign)                
             }
         }
@@ -313,6 +282,19 @@ void NavigationTree::expand()
     std::cout << "NavigationTree::expand() - expanded #nodes: " << count << std::endl;    
 }
 
+Node<NavigationTree::StateVec>* NavigationTree::getNavNode(const Node<StateVec>* extNode) const
+{
+    if(extNode == NULL) return NULL; /// < EXIT POINT
+    const auto foundElem = visitedNodes_.find(extNode->id_);
+    return (foundElem != visitedNodes_.end()) ? foundElem->second : NULL;
+}
+
+double NavigationTree::getDistanceFromRoot(const Node<StateVec>* extNode) const
+{
+    const Node<StateVec>* navNode = getNavNode(extNode);
+    return navNode ? navNode->distance_ : -1.;
+}
+
 void NavigationTree::publishNode(Node<StateVec> * node)
 {
     ros::Time timestamp = ros::Time::now();
@@ -322,7 +304,7 @@ void NavigationTree::publishNode(Node<StateVec> * node)
     p.header.stamp = timestamp;
     p.header.seq = g_ID_;
     p.header.frame_id = params_.navigationFrame_;
-    p.id = g_ID_;
+    p.id = kNumVizNodeMarkers*node->id_ + kVizNodeSphere; // stable id: the markers are published as deltas
     g_ID_++;
     p.ns = kRvizNamespace;
     p.type = visualization_msgs::Marker::SPHERE;
@@ -362,7 +344,7 @@ void NavigationTree::publishNode(Node<StateVec> * node)
         arrowMarker.header.stamp = p.header.stamp;
         arrowMarker.header.seq = g_ID_;
         arrowMarker.header.frame_id = params_.navigationFrame_; 
-        arrowMarker.id = g_ID_;
+        arrowMarker.id = kNumVizNodeMarkers*node->id_ + kVizNodeArrow;
         g_ID_++;
         arrowMarker.ns = kRvizNamespace;
         arrowMarker.type = visualization_msgs::Marker::ARROW;
@@ -399,14 +381,16 @@ void NavigationTree::publishTree()
 {
     ros::Time timestamp = ros::Time::now();
     
+    if(!params_.explorationNavTreePub_->hasSubscribers()) return; /// < EXIT POINT 
+    
     // delete all markers     
     markerArray_.markers.clear();
     
-    // now republish all the node markers by using a recursive function 
+    // now republish all the node markers by using a recursive function (only the changes are actually sent)
     g_ID_ = 0;
     publishNodeRecursive(rootNode_);
     
-    params_.explorationNavTreePub_.publish(markerArray_); 
+    params_.explorationNavTreePub_->publish(markerArray_); 
   
 }
 
@@ -0,0 +1,51 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "PlanningProfiler.h"
+
+#include <string>
+#include <vector>
+
+
+namespace explplanner{
+
+const char* PlanningProfiler::kPhaseNames[PlanningProfiler::kNumPhases] = {"sampling", "collision", "gain", "frontiers", "path_planning"};
+
+thread_local bool PlanningProfiler::b_enabled_ = false;
+thread_local PlanningProfiler::ScopedPhase* PlanningProfiler::current_ = NULL;
+thread_local PlanningProfiler::Stats PlanningProfiler::stats_;
+
+int PlanningProfiler::getZone(Phase phase)
+{
+#ifdef MR3D_PROFILING_DISABLED
+    (void)phase;
+    return -1; 
+#else
+    static const std::vector<int> zones = []()
+    {
+        std::vector<int> ids(kNumPhases);
+        for(int ii=0; ii < kNumPhases; ii++) ids[ii] = mr3d_profiling::Profiler::instance().registerZone(std::string("expl/") + kPhaseNames[ii]);
+        return ids;
+    }();
+    return zones[phase];
+#endif
+}
+
+} // namespace explplanner
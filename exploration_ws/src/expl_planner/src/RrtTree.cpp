@@ -38,6 +38,7 @@
 #define RRTTREE_HPP_
 
 #include <cstdlib>
+#include <algorithm>
 #include <limits>
 #include <multiagent_collision_check/multiagent_collision_checker.h>
 
@@ -68,6 +69,9 @@ const double RrtTree::kTreeTextMessageHeight = 0.14;
 
 const double RrtTree::kZVisibilityOffset = 0.1;  
 
+const size_t RrtTree::kGainBatchSizePerThread = 16; 
+const size_t RrtTree::kGainSnapshotBatchSize = 256; 
+
 const std::string RrtTree::kRvizNamespaceNodes = "search_tree_nodes";
 const std::string RrtTree::kRvizNamespaceTexts = "search_tree_texts";   
 const std::string RrtTree::kRvizNamespaceEdges = "search_tree_edges";       
@@ -85,9 +89,6 @@ inline double deadZone(const double& val, const double& th)
 RrtTree::RrtTree()
 : TreeBase<StateVec>::TreeBase()
 {
-    kdTree_ = kd_create(3);
-    //kd_data_destructor(kdTree_, nodeDestructor);
-    
     iterationCount_ = 0;
     for (int i = 0; i < 4; i++)
     {
@@ -120,9 +121,6 @@ RrtTree::RrtTree(std::shared_ptr<volumetric_mapping::OctomapManager>& p_manager)
     //mesh_ = mesh;
     p_octomap_manager_ = p_manager;
 
-    kdTree_ = kd_create(3);
-    //kd_data_destructor(kdTree_, nodeDestructor);
-    
     iterationCount_ = 0;
     for (int i = 0; i < 4; i++)
     {
@@ -153,7 +151,6 @@ RrtTree::RrtTree(std::shared_ptr<volumetric_mapping::OctomapManager>& p_manager)
 RrtTree::~RrtTree()
 {
     delete rootNode_;  // N.B.: deleting the root node we use the destructor ~Node() which recursively deletes all its children
-    if(kdTree_) kd_free(kdTree_);
     
     if (fileResponse_.is_open())
     {
@@ -424,14 +421,11 @@ void RrtTree::iterate(int iterations)
     }
 
     // Find nearest neighbour
-    kdres * nearest = kd_nearest3(kdTree_, newState.x(), newState.y(), newState.z());
-    if (kd_res_size(nearest) <= 0)
+    Node<StateVec> * newParent = kdTree_.nearest(newState.x(), newState.y(), newState.z());
+    if (!newParent)
     {
-        kd_res_free(nearest);
         return;
     }
-    Node<StateVec> * newParent = (Node<StateVec> *) kd_res_item_data(nearest);
-    kd_res_free(nearest);
 
     // Check for collision of new connection plus some overshoot distance.
     Eigen::Vector3d origin(newParent->state_[0], newParent->state_[1], newParent->state_[2]);
@@ -445,9 +439,9 @@ void RrtTree::iterate(int iterations)
     newState[1] = origin[1] + direction[1];
     newState[2] = origin[2] + direction[2];
     if (volumetric_mapping::OctomapManager::CellStatus::kFree
-            == p_octomap_manager_->getLineStatusBoundingBox(origin, direction + origin + direction.normalized() * params_.dOvershoot_,
+            == getLineStatusBoundingBox(origin, direction + origin + direction.normalized() * params_.dOvershoot_,
                                                             params_.boundingBox_)
-            && !multiagent::isInCollision(newParent->state_, newState, params_.boundingBox_, segments_))
+            && !segmentIndex_.isInCollision(newParent->state_, newState, params_.boundingBox_))
     {
         // Sample the new orientation
         newState[3] = 2.0 * M_PI * (((double) rand()) / ((double) RAND_MAX) - 0.5);
@@ -460,7 +454,7 @@ void RrtTree::iterate(int iterations)
         newParent->children_.push_back(newNode);
         newNode->gain_ = newParent->gain_ + gain(newNode->state_) * exp(-params_.degressiveCoeff_ * newNode->distance_);
 
-        kd_insert3(kdTree_, newState.x(), newState.y(), newState.z(), newNode);
+        kdTree_.insert(newState.x(), newState.y(), newState.z(), newNode);
 
         // Display new node
         publishNode(newNode);
@@ -524,15 +518,11 @@ bool RrtTree::addNode(double x, double y, double z)
     const double& disc = disc_sqrt3_;
     
     // Find nearest neighbor
-    kdres * nearest = kd_nearest3(kdTree_, newState.x(), newState.y(), newState.z());
-    if (kd_res_size(nearest) <= 0)
+    Node<StateVec> * newParent = kdTree_.nearest(newState.x(), newState.y(), newState.z());
+    if (!newParent)
     {
-        kd_res_free(nearest);
         return false;
     }
-    
-    Node<StateVec> * newParent = (Node<StateVec> *) kd_res_item_data(nearest);
-    kd_res_free(nearest);
 
 
     Eigen::Vector3d origin(newParent->state_[0], newParent->state_[1], newParent->state_[2]);
@@ -557,7 +547,7 @@ bool RrtTree::addNode(double x, double y, double z)
 //            && !multiagent::isInCollision(newParent->state_, newState, params_.boundingBox_, segments_))
 #if USE_SOFT_LINE_COLLISION_CHECKING
     if (volumetric_mapping::OctomapManager::CellStatus::kFree
-            == p_octomap_manager_->getLineStatusBoundingBox(origin + direction.normalized()*disc, origin + direction, params_.boundingBox_) ) /// < N.B soft geometric visibility check
+            == getLineStatusBoundingBox(origin + direction.normalized()*disc, origin + direction, params_.boundingBox_) ) /// < N.B soft geometric visibility check
 #else
         
 #if USE_SOFT_ENDPOINT_COLLISION_CHECKING        
@@ -578,48 +568,203 @@ bool RrtTree::addNode(double x, double y, double z)
         newNode->distance_ = newParent->distance_ + direction.norm();
         newParent->children_.push_back(newNode);
         
-        newNode->local_gain_ = gain(newNode->state_);
+        kdTree_.insert(newState.x(), newState.y(), newState.z(), newNode);
         
+        counter_++;
+        
+        if ((params_.gainNumThreads_ > 1) || params_.bGainSnapshot_)
+        {
+            /// < the gain is computed later in parallel with the other nodes of the batch (see scorePendingNodes())
+            pendingGainNodes_.push_back(newNode);
+            const size_t batchSize = params_.bGainSnapshot_ ? std::max(kGainSnapshotBatchSize, kGainBatchSizePerThread * params_.gainNumThreads_) : 
+                                                              kGainBatchSizePerThread * params_.gainNumThreads_;
+            if (pendingGainNodes_.size() >= batchSize)
+            {
+                scorePendingNodes();
+            }
+        }
+        else
+        {
+            newNode->local_gain_ = gain(newNode->state_);
+            newNode->local_gain_version_ = p_octomap_manager_->getMapVersion(); // the octomap is locked by addNode()
+            updateNodeGain(newNode);
+        }
+        
+        }
+#if USE_SOFT_LINE_COLLISION_CHECKING || USE_SOFT_ENDPOINT_COLLISION_CHECKING   
+    else
+    {
+        return false;
+    }
+#endif
+    
+    return true; 
+}
+
+void RrtTree::updateNodeGain(Node<StateVec>* newNode)
+{
+    Node<StateVec>* newParent = newNode->parent_;
+    
 #if USE_LOCAL_GAIN_AS_ACTUAL_GAIN
-        newNode->gain_ = newNode->local_gain_ * exp(-params_.degressiveCoeff_ * newNode->distance_);
+    newNode->gain_ = newNode->local_gain_ * exp(-params_.degressiveCoeff_ * newNode->distance_);
 #else
-        //newNode->gain_ = newParent->gain_ + newNode->local_gain_ * exp(-params_.degressiveCoeff_ * newNode->distance_);                 
-        newNode->gain_ = deadZone(newParent->gain_,params_.zero_gain_) + deadZone(newNode->local_gain_,params_.zero_gain_) * exp(-params_.degressiveCoeff_ * newNode->distance_);    
+    //newNode->gain_ = newParent->gain_ + newNode->local_gain_ * exp(-params_.degressiveCoeff_ * newNode->distance_);                 
+    newNode->gain_ = deadZone(newParent->gain_,params_.zero_gain_) + deadZone(newNode->local_gain_,params_.zero_gain_) * exp(-params_.degressiveCoeff_ * newNode->distance_);    
 #endif        
-        
-        kd_insert3(kdTree_, newState.x(), newState.y(), newState.z(), newNode);
 
-        // Display new node
-        publishNode(newNode);
+    // Display new node
+    publishNode(newNode);
 
-        // Update best IG and node if applicable
-        if (newNode->gain_ > bestGain_)
+    // Update best IG and node if applicable
+    if (newNode->gain_ > bestGain_)
+    {
+        bestGain_ = newNode->gain_;
+        bestNode_ = newNode;
+    }
+
+    if (newNode->local_gain_ > params_.zero_gain_)
+    {
+        frontierNodes_.push_back(newNode);
+    }
+    
+#if SHOW_DEBUG        
+    std::cout << "RrtTree: added new node with gain: "<< newNode->gain_<< " *** " << std::endl; 
+#endif     
+}
+
+void RrtTree::detachNodes(std::vector<Node<StateVec>*>& nodes)
+{
+    nodes.clear();
+    if (!rootNode_) return; /// < EXIT POINT
+    
+    // breadth-first visit: a parent comes before its children 
+    nodes.push_back(rootNode_);
+    for (size_t ii = 0; ii < nodes.size(); ii++)
+    {
+        Node<StateVec>* node = nodes[ii];
+        nodes.insert(nodes.end(), node->children_.begin(), node->children_.end());
+        node->children_.clear(); // N.B.: ~Node() recursively deletes the children 
+        node->parent_ = NULL;
+    }
+    rootNode_ = NULL;
+
+    counter_ = 0;
+    bestGain_ = params_.zero_gain_;
+    bestNode_ = NULL;
+    selectedNode_ = NULL;
+
+    kdTree_.clear();
+    
+    frontierNodes_.clear();  
+    pendingGainNodes_.clear();
+}
+
+int RrtTree::reattachNodes(std::vector<Node<StateVec>*>& nodes)
+{
+    if (nodes.empty()) return 0; /// < EXIT POINT
+    
+    const double& disc = disc_sqrt3_;
+    const Eigen::Vector3d rootPoint = rootNode_->state_.segment(0,3);
+    const double maxDist2 = SQ(params_.reuseTreeRadius_);
+    
+    // the nodes are inserted by increasing distance from the new root: the tree grows outwards as with the expansion on the traversability map
+    std::vector<std::pair<double, Node<StateVec>*> > sortedNodes;
+    sortedNodes.reserve(nodes.size());
+    for (size_t ii = 1, iiEnd = nodes.size(); ii < iiEnd; ii++) // nodes[0] is the old root 
+    {
+        const double distance2 = (nodes[ii]->state_.segment(0,3) - rootPoint).squaredNorm();
+        sortedNodes.push_back(std::make_pair(distance2, nodes[ii]));
+    }
+    delete nodes[0]; // its children have been detached 
+    nodes.clear();
+    std::sort(sortedNodes.begin(), sortedNodes.end());
+    
+    std::vector<Node<StateVec>*> keptNodes; // in insertion order 
+    std::vector<Node<StateVec>*> staleNodes; // kept nodes whose local gain must be recomputed 
+    keptNodes.reserve(sortedNodes.size());
+    for (size_t ii = 0, iiEnd = sortedNodes.size(); ii < iiEnd; ii++)
+    {
+        Node<StateVec>* node = sortedNodes[ii].second;
+        const StateVec& state = node->state_;
+        
+        bool bValid = (sortedNodes[ii].first <= maxDist2) &&
+                      (state.x() >= params_.minX_ + 0.5 * params_.boundingBox_.x()) && (state.x() <= params_.maxX_ - 0.5 * params_.boundingBox_.x()) &&
+                      (state.y() >= params_.minY_ + 0.5 * params_.boundingBox_.y()) && (state.y() <= params_.maxY_ - 0.5 * params_.boundingBox_.y()) &&
+                      (state.z() >= params_.minZ_ + 0.5 * params_.boundingBox_.z()) && (state.z() <= params_.maxZ_ - 0.5 * params_.boundingBox_.z());
+        
+        Node<StateVec>* newParent = NULL;
+        Eigen::Vector3d origin = Eigen::Vector3d::Zero(), direction = Eigen::Vector3d::Zero();
+        if (bValid)
         {
-            bestGain_ = newNode->gain_;
-            bestNode_ = newNode;
+            newParent = kdTree_.nearest(state.x(), state.y(), state.z());
+            bValid = (newParent != NULL);
         }
-        
-        if (newNode->local_gain_ > params_.zero_gain_)
+        if (bValid)
         {
-            frontierNodes_.push_back(newNode);
+            origin = newParent->state_.segment(0,3);
+            direction = state.segment(0,3) - origin;
+            bValid = (direction.norm() >= params_.extensionRange_); // as in addNode()
+        }
+#if USE_SOFT_LINE_COLLISION_CHECKING
+        bValid = bValid && (volumetric_mapping::OctomapManager::CellStatus::kFree
+                            == getLineStatusBoundingBox(origin + direction.normalized()*disc, origin + direction, params_.boundingBox_)); /// < N.B soft geometric visibility check
+#elif USE_SOFT_ENDPOINT_COLLISION_CHECKING
+        bValid = bValid && (volumetric_mapping::OctomapManager::CellStatus::kOccupied
+                            != p_octomap_manager_->getCellProbabilityPoint(origin + direction, NULL));
+#endif
+        if (!bValid)
+        {
+            delete node; // pruned (its children have been detached) 
+            continue; 
         }
         
-        counter_++;
+        node->parent_ = newParent;
+        node->distance_ = newParent->distance_ + direction.norm();
+        newParent->children_.push_back(node);
         
-#if SHOW_DEBUG        
-        std::cout << "RrtTree: added new node with gain: "<< newNode->gain_<< " *** " << std::endl; 
-        //std::cout << "                           point: (" << x << ", " << y << ", " << z << ")" << std::endl;          
-#endif 
+        kdTree_.insert(state.x(), state.y(), state.z(), node);
         
+        counter_++;
+        keptNodes.push_back(node);
+        
+        if ((node->local_gain_version_ == 0) || isGainRegionChanged(node->state_, node->local_gain_version_))
+        {
+            staleNodes.push_back(node);
         }
-#if USE_SOFT_LINE_COLLISION_CHECKING || USE_SOFT_ENDPOINT_COLLISION_CHECKING   
-    else
+    }
+    
+    // the octomap is locked by initialize()
+    const int num_stale_nodes = staleNodes.size();
+    computeGains(staleNodes, params_.gainNumThreads_);
+    
+    // the gain along the branch depends on the one of the parent (a parent is inserted before its children)
+    for (size_t ii = 0, iiEnd = keptNodes.size(); ii < iiEnd; ii++)
     {
-        return false;
+        updateNodeGain(keptNodes[ii]);
     }
-#endif
     
-    return true; 
+    std::cout << "RrtTree::reattachNodes() - kept nodes: " << keptNodes.size() << "/" << sortedNodes.size() << ", recomputed gains: " << num_stale_nodes << std::endl;
+    
+    return keptNodes.size();
+}
+
+void RrtTree::scorePendingNodes()
+{
+    if (pendingGainNodes_.empty()) return; /// < EXIT POINT
+    
+    // the octomap is locked for the whole batch: it cannot be modified while the workers read it  
+    boost::recursive_mutex::scoped_lock locker(p_octomap_manager_->interaction_mutex);
+    
+    const int num_nodes = pendingGainNodes_.size();
+    computeGains(pendingGainNodes_, params_.gainNumThreads_);
+    
+    // the gain along the branch depends on the one of the parent: the nodes are updated in insertion order (a parent is inserted before its children)
+    for (int ii = 0; ii < num_nodes; ii++)
+    {
+        updateNodeGain(pendingGainNodes_[ii]);
+    }
+    
+    pendingGainNodes_.clear();
 }
 
 void RrtTree::initialize()
@@ -649,12 +794,20 @@ void RrtTree::initialize()
     if (i < agentNames_.size())
     {
         segments_[i]->clear();
+        segmentIndex_.clearAgent(i);
+    }
+    
+    // if the previous tree was not cleared, keep its nodes: they are re-rooted below 
+    std::vector<Node<StateVec>*> oldNodes;
+    if (params_.bReuseTree_ && rootNode_)
+    {
+        detachNodes(oldNodes);
     }
     
-    if(kdTree_) kd_free(kdTree_);
     // Initialize kd-tree with root node and prepare log file
-    kdTree_ = kd_create(3);
-    //kd_data_destructor(kdTree_, nodeDestructor);    
+    kdTree_.clear();
+    
+    pendingGainNodes_.clear();
 
     if (params_.bLog_)
     {
@@ -684,7 +837,7 @@ void RrtTree::initialize()
     {
         rootNode_->state_ = root_;
     }
-    kd_insert3(kdTree_, rootNode_->state_.x(), rootNode_->state_.y(), rootNode_->state_.z(), rootNode_);
+    kdTree_.insert(rootNode_->state_.x(), rootNode_->state_.y(), rootNode_->state_.z(), rootNode_);
     iterationCount_++;
     
     
@@ -692,91 +845,98 @@ void RrtTree::initialize()
     bestNode_ = rootNode_;
     selectedNode_ = rootNode_;
 
-    std::cout << "RrtTree::initialize() - reinserting previous best branch " << std::endl; 
-        
-    // Insert all nodes of the remainder of the previous best branch, checking for collisions and
-    // recomputing the gain.
-    for (auto iter = bestBranchMemory_.rbegin(), iterEnd = bestBranchMemory_.rend(); iter != iterEnd; ++iter)
+    if (!oldNodes.empty())
+    {
+        // the remainder of the previous best branch is part of the previous tree  
+        std::cout << "RrtTree::initialize() - re-rooting previous tree " << std::endl; 
+        reattachNodes(oldNodes);
+    }
+    else
     {
-        StateVec newState = *iter;
-        kdres * nearest = kd_nearest3(kdTree_, newState.x(), newState.y(), newState.z());
-        if (kd_res_size(nearest) <= 0)
+        std::cout << "RrtTree::initialize() - reinserting previous best branch " << std::endl; 
+        
+        // Insert all nodes of the remainder of the previous best branch, checking for collisions and
+        // recomputing the gain.
+        for (auto iter = bestBranchMemory_.rbegin(), iterEnd = bestBranchMemory_.rend(); iter != iterEnd; ++iter)
         {
-            kd_res_free(nearest);
-            continue;
-        }
-        Node<StateVec> * newParent = (Node<StateVec> *) kd_res_item_data(nearest);
-        kd_res_free(nearest);
+            StateVec newState = *iter;
+            Node<StateVec> * newParent = kdTree_.nearest(newState.x(), newState.y(), newState.z());
+            if (!newParent)
+            {
+                continue;
+            }
 
-        // Check for collision
-        Eigen::Vector3d origin(newParent->state_[0], newParent->state_[1], newParent->state_[2]);
-        Eigen::Vector3d direction(newState[0] - origin[0], newState[1] - origin[1], newState[2] - origin[2]);
+            // Check for collision
+            Eigen::Vector3d origin(newParent->state_[0], newParent->state_[1], newParent->state_[2]);
+            Eigen::Vector3d direction(newState[0] - origin[0], newState[1] - origin[1], newState[2] - origin[2]);
         
-        //std::cout << "origin: " << origin << std::endl; 
-        //std::cout << "direction: " << direction << std::endl;  
+            //std::cout << "origin: " << origin << std::endl; 
+            //std::cout << "direction: " << direction << std::endl;  
         
-        if(direction.norm() < std::numeric_limits<double>::min())
-            continue; 
+            if(direction.norm() < std::numeric_limits<double>::min())
+                continue; 
                 
-//        if (direction.norm() > params_.extensionRange_)
-//        {
-//            direction = params_.extensionRange_ * direction.normalized();
-//        }
-//        newState[0] = origin[0] + direction[0];
-//        newState[1] = origin[1] + direction[1];
-//        newState[2] = origin[2] + direction[2];
+    //        if (direction.norm() > params_.extensionRange_)
+    //        {
+    //            direction = params_.extensionRange_ * direction.normalized();
+    //        }
+    //        newState[0] = origin[0] + direction[0];
+    //        newState[1] = origin[1] + direction[1];
+    //        newState[2] = origin[2] + direction[2];
         
-// < N.B: disabled collision checking         
-//        if (volumetric_mapping::OctomapManager::CellStatus::kFree
-//                == p_octomap_manager_->getLineStatusBoundingBox(
-//                                                                origin, direction + origin + direction.normalized() * params_.dOvershoot_,
-//                                                                params_.boundingBox_)
-//                && !multiagent::isInCollision(newParent->state_, newState, params_.boundingBox_,
-//                                              segments_))
-#if USE_SOFT_LINE_COLLISION_CHECKING         
-        if (volumetric_mapping::OctomapManager::CellStatus::kFree
-            == p_octomap_manager_->getLineStatusBoundingBox(origin + direction.normalized()*disc, origin + direction, params_.boundingBox_) )    /// < N.B soft geometric visibility check
-#else
+    // < N.B: disabled collision checking         
+    //        if (volumetric_mapping::OctomapManager::CellStatus::kFree
+    //                == p_octomap_manager_->getLineStatusBoundingBox(
+    //                                                                origin, direction + origin + direction.normalized() * params_.dOvershoot_,
+    //                                                                params_.boundingBox_)
+    //                && !multiagent::isInCollision(newParent->state_, newState, params_.boundingBox_,
+    //                                              segments_))
+    #if USE_SOFT_LINE_COLLISION_CHECKING         
+            if (volumetric_mapping::OctomapManager::CellStatus::kFree
+                == getLineStatusBoundingBox(origin + direction.normalized()*disc, origin + direction, params_.boundingBox_) )    /// < N.B soft geometric visibility check
+    #else
         
-#if USE_SOFT_ENDPOINT_COLLISION_CHECKING        
-        volumetric_mapping::OctomapManager::CellStatus node = p_octomap_manager_->getCellProbabilityPoint(origin + direction, NULL);
-        if (node != volumetric_mapping::OctomapManager::CellStatus::kOccupied)        
-#endif 
+    #if USE_SOFT_ENDPOINT_COLLISION_CHECKING        
+            volumetric_mapping::OctomapManager::CellStatus node = p_octomap_manager_->getCellProbabilityPoint(origin + direction, NULL);
+            if (node != volumetric_mapping::OctomapManager::CellStatus::kOccupied)        
+    #endif 
         
-#endif 
-        {
-            // Create new node and insert into tree
-            Node<StateVec> * newNode = new Node<StateVec>;
-            newNode->state_ = newState;
-            newNode->parent_ = newParent;
-            newNode->distance_ = newParent->distance_ + direction.norm();
-            newParent->children_.push_back(newNode);
-            
-            newNode->local_gain_ = gain(newNode->state_);
-#if USE_LOCAL_GAIN_AS_ACTUAL_GAIN
-            newNode->gain_ = newNode->local_gain_ * exp(-params_.degressiveCoeff_ * newNode->distance_);
-#else
-            //newNode->gain_ = newParent->gain_ + newNode->local_gain_ * exp(-params_.degressiveCoeff_ * newNode->distance_);               
-            newNode->gain_ = deadZone(newParent->gain_,params_.zero_gain_) + deadZone(newNode->local_gain_,params_.zero_gain_) * exp(-params_.degressiveCoeff_ * newNode->distance_);                       
-#endif                
-            kd_insert3(kdTree_, newState.x(), newState.y(), newState.z(), newNode);
-
-            // Display new node
-            publishNode(newNode);
-
-            // Update best IG and node if applicable
-            if (newNode->gain_ > bestGain_)
+    #endif 
             {
-                bestGain_ = newNode->gain_;
-                bestNode_ = newNode;
-            }
+                // Create new node and insert into tree
+                Node<StateVec> * newNode = new Node<StateVec>;
+                newNode->state_ = newState;
+                newNode->parent_ = newParent;
+                newNode->distance_ = newParent->distance_ + direction.norm();
+                newParent->children_.push_back(newNode);
             
-            if (newNode->local_gain_ > params_.zero_gain_)
-            {
-                frontierNodes_.push_back(newNode);
-            }
+                newNode->local_gain_ = gain(newNode->state_);
+                newNode->local_gain_version_ = p_octomap_manager_->getMapVersion(); // the octomap is locked by initialize()
+    #if USE_LOCAL_GAIN_AS_ACTUAL_GAIN
+                newNode->gain_ = newNode->local_gain_ * exp(-params_.degressiveCoeff_ * newNode->distance_);
+    #else
+                //newNode->gain_ = newParent->gain_ + newNode->local_gain_ * exp(-params_.degressiveCoeff_ * newNode->distance_);               
+                newNode->gain_ = deadZone(newParent->gain_,params_.zero_gain_) + deadZone(newNode->local_gain_,params_.zero_gain_) * exp(-params_.degressiveCoeff_ * newNode->distance_);                       
+    #endif                
+                kdTree_.insert(newState.x(), newState.y(), newState.z(), newNode);
+
+                // Display new node
+                publishNode(newNode);
+
+                // Update best IG and node if applicable
+                if (newNode->gain_ > bestGain_)
+                {
+                    bestGain_ = newNode->gain_;
+                    bestNode_ = newNode;
+                }
             
-            counter_++;
+                if (newNode->local_gain_ > params_.zero_gain_)
+                {
+                    frontierNodes_.push_back(newNode);
+                }
+            
+                counter_++;
+            }
         }
     }
 
@@ -1051,10 +1211,10 @@ void RrtTree::clear()
     bestNode_ = NULL;
     selectedNode_ = NULL;
 
-    if(kdTree_) kd_free(kdTree_);    
-    kdTree_ = 0;
+    kdTree_.clear();
     
     frontierNodes_.clear();  
+    pendingGainNodes_.clear();
 }
 
 
@@ -21,9 +21,11 @@
 #include "ScanHistoryManager.h"
 #include "SpaceTimeFilterBase.h"
 #include "ScanFileManager.h"
+#include "ScanLog.h"
 
 #include <pcl/io/pcd_io.h>
 #include <pcl/io/ply_io.h>
+#include <pcl/filters/voxel_grid.h>
 #include <pcl_conversions/pcl_conversions.h>
 
 #include <iomanip>
@@ -48,7 +50,7 @@ const float ScanHistoryManager::kCacheTimeInSec = 10; // [sec]
 const float ScanHistoryManager::kMaxScanDistance = 1; // [m]
 const float ScanHistoryManager::kMaxScanSquaredDistance = ScanHistoryManager::kMaxScanDistance * ScanHistoryManager::kMaxScanDistance; // [m^2]
 
-ScanHistoryManager::ScanHistoryManager(const int& robotId)
+ScanHistoryManager::ScanHistoryManager(const int& robotId):scan_position_index_(kMaxScanDistance)
 {
     robot_id_ = robotId;
     //init();
@@ -64,6 +66,27 @@ void ScanHistoryManager::init()
     p_space_time_filter_->init();
 
     p_scan_file_manager_.reset( new ScanFileManager(robot_id_));
+
+    std::string ns = ros::this_node::getName() + "/scan_history";
+    ros::param::get(ns + "/use_scan_log", useScanLog_);
+    ros::param::get(ns + "/scan_log_quantization", scanLogQuantization_);
+    p_scan_log_.reset();
+    if(useScanLog_)
+    {
+        p_scan_log_.reset( new ScanLog());
+        if(!p_scan_log_->open(p_scan_file_manager_->getFolderPath() + "/scans.log", scanLogQuantization_))
+        {
+            ROS_ERROR("ScanHistoryManager::init() - could not open the scan log, using the scan files");
+            p_scan_log_.reset();
+        }
+    }
+
+    MapSyncParams mapSyncParams; 
+    ros::param::get(ns + "/sync_bandwidth", mapSyncParams.bandwidth_);
+    ros::param::get(ns + "/sync_burst", mapSyncParams.burst_);
+    ros::param::get(ns + "/sync_resend_time", mapSyncParams.resend_time_);
+    ros::param::get(ns + "/sync_downsample_leaf_size", mapSyncParams.downsample_leaf_size_);
+    map_sync_scheduler_.setParams(mapSyncParams);
 }
 
 void ScanHistoryManager::insert(const sensor_msgs::PointCloud2::ConstPtr &cloud_msg)
@@ -84,9 +107,25 @@ void ScanHistoryManager::insert(const sensor_msgs::PointCloud2::ConstPtr &cloud_
         if( it == mapCloudPtrToScanInfoPtr_.end())
         {
             ScanInfo::Ptr scan(new ScanInfo(counter_, ros::Time::now(), cloud));
+            const pcl::PointNormal& pose = p_space_time_filter_->getLastInsertedPose();
+            scan->position.x = pose.x;
+            scan->position.y = pose.y;
+            scan->position.z = pose.z;
+            if(map_sync_scheduler_.getParams().downsample_leaf_size_ <= 0)
+            {
+                scan->msg_ptr = cloud_msg; // the input message can be sent as it is 
+            }
             mapCloudPtrToScanInfoPtr_[cloud] = scan; 
             mapIndexToScanInfoPtr_[counter_] = scan;             
             recent_scans_.insert(scan);
+            scan_position_index_.insert(counter_, scan->position);
+
+            if(p_scan_log_)
+            {
+                // append the scan at once: it does not need to be saved when it is released 
+                const float position[3] = {pose.x, pose.y, pose.z};
+                p_scan_log_->append(counter_, *cloud, position);
+            }
 
             counter_++; // increment the counter once we have actually inserted the pointcloud 
         }
@@ -107,7 +146,7 @@ void ScanHistoryManager::updateHistory()
     boost::recursive_mutex::scoped_lock locker(interaction_mutex);    
     ros::Time now = ros::Time::now();
     int savedClouds = 0; 
-    for(auto it=recent_scans_.begin(), itEnd=recent_scans_.end(); it != itEnd; it++)
+    for(auto it=recent_scans_.begin(); it != recent_scans_.end(); /*nop*/)
     {
         // release and save unused scans
         ScanInfo::Ptr scanInfo = *it; 
@@ -118,16 +157,24 @@ void ScanHistoryManager::updateHistory()
         {
             ROS_INFO_STREAM("ScanHistoryManager::updateHistory() - saving cloud " << scanInfo->index);
 
-            // save cloud to file 
-            p_scan_file_manager_->save(scanInfo->index, *(scanInfo->cloud_ptr));
+            // save cloud to file (if it is not already in the scan log)
+            if(!p_scan_log_ || !p_scan_log_->contains(scanInfo->index))
+            {
+                p_scan_file_manager_->save(scanInfo->index, *(scanInfo->cloud_ptr));
+            }
 
             // release cloud memory 
             scanInfo->cloud_ptr.reset();
+            scanInfo->msg_ptr.reset();
 
             // erase the scan from recent history
             it = recent_scans_.erase(it);
             savedClouds++;
         }
+        else
+        {
+            it++;
+        }
     }
     ROS_INFO_STREAM("ScanHistoryManager::updateHistory() - saved " << savedClouds);
 
@@ -152,36 +199,54 @@ void ScanHistoryManager::getPoseArrayMessage(geometry_msgs::PoseArray& message)
     message.header.frame_id = ss.str();
 } 
 
-bool ScanHistoryManager::getCloudMessage(sensor_msgs::PointCloud2::Ptr &cloud_msg, const uint32_t& index)
+bool ScanHistoryManager::getCloudMessage(sensor_msgs::PointCloud2::ConstPtr &cloud_msg, const uint32_t& index)
 {
     boost::recursive_mutex::scoped_lock locker(interaction_mutex);
 
-    bool res = true; 
     auto it = mapIndexToScanInfoPtr_.find(index);
-    if( it != mapIndexToScanInfoPtr_.end())
+    if( it == mapIndexToScanInfoPtr_.end())
+    {
+        ROS_ERROR_STREAM("ScanHistoryManager::getCloudMessage() didnt find cloud with index" << index);
+        return false; /// < EXIT POINT
+    }
+
+    ScanInfo::Ptr& scan = it->second;  
+    if(!scan->msg_ptr)
     {
-        ScanInfo::Ptr& scan = it->second;  
         if(!scan->cloud_ptr)
         {
             ROS_INFO_STREAM("ScanHistoryManager::getCloudMessage() - reloading back cloud " << index);
             scan->cloud_ptr.reset(new pcl::PCLPointCloud2());
-            p_scan_file_manager_->read(index, *(scan->cloud_ptr));
+            if(p_scan_log_ && p_scan_log_->contains(index))
+            {
+                p_scan_log_->read(index, *(scan->cloud_ptr)); // mapped record + decoding 
+            }
+            else
+            {
+                p_scan_file_manager_->read(index, *(scan->cloud_ptr));
+            }
 
-            //pcl_conversions::fromPCL(*(scan->cloud_ptr), *cloud_msg);
             scan->timestampLastReload = ros::Time::now();
             recent_scans_.insert(scan);
         }
 
-        pcl_conversions::fromPCL(*(scan->cloud_ptr), *cloud_msg);
-        // scan->timestampLastReload = ros::Time::now();
-        // recent_scans_.insert(scan);
+        // build the message once: it is shared by the next sends until the cloud is released by updateHistory()
+        sensor_msgs::PointCloud2::Ptr msg(new sensor_msgs::PointCloud2());
+        pcl_conversions::fromPCL(*(scan->cloud_ptr), *msg);
+        downsampleCloudMessage(msg);
+        scan->msg_ptr = msg;
     }
-    else
-    {
-        ROS_ERROR_STREAM("ScanHistoryManager::getPoseArrayMessage() didnt find cloud with index" << index);
-        res = false;
-    }
-    return res;
+
+    cloud_msg = scan->msg_ptr;
+    return true;
+}
+
+bool ScanHistoryManager::getClosestScan(const pcl::PointXYZ& position, uint32_t& scanIndex, float& scanSquaredDistance) const
+{
+    pp::PointHashIndex<pcl::PointXYZ>::Id id = 0; 
+    if(!scan_position_index_.nearestSearch(position, id, scanSquaredDistance)) return false; /// < EXIT POINT
+    scanIndex = (uint32_t)id;
+    return true; 
 }
 
 void ScanHistoryManager::mapMessageOverlapCheck(const geometry_msgs::PoseArray& message, std::vector<sensor_msgs::PointCloud2::Ptr>& cloudsToSend)
@@ -191,9 +256,16 @@ void ScanHistoryManager::mapMessageOverlapCheck(const geometry_msgs::PoseArray&
     ROS_INFO_STREAM("ScanHistoryManager::mapMessageOverlapCheck() - checking message with " << message.poses.size() << " poses");
 
     cloudsToSend.clear();
+    if(mapIndexToScanInfoPtr_.empty())
+    {
+        ROS_WARN_STREAM("ScanHistoryManager::mapMessageOverlapCheck() - no scan stored yet!");
+        return; /// < EXIT POINT
+    }
+
+    std::set<uint32_t> missingScans; // a scan can be the closest one to many poses: it is sent once 
     for(size_t i=0; i<message.poses.size();i++)
     {
-        pcl::PointNormal searchPoint; 
+        pcl::PointXYZ searchPoint; 
         uint32_t scanIndex;   
         float scanSquaredDistance; 
 
@@ -201,17 +273,12 @@ void ScanHistoryManager::mapMessageOverlapCheck(const geometry_msgs::PoseArray&
         searchPoint.y = message.poses[i].position.y;
         searchPoint.z = message.poses[i].position.z;
 
-        if( p_space_time_filter_->getClosestScanInfo(searchPoint, scanIndex, scanSquaredDistance) )
+        if( getClosestScan(searchPoint, scanIndex, scanSquaredDistance) )
         {
             //if(randomBool()) // this just for testing 
             if( scanSquaredDistance > kMaxScanSquaredDistance )            
             {
-                cloudsToSend.emplace_back(new sensor_msgs::PointCloud2());
-                if( !getCloudMessage( cloudsToSend.back(), scanIndex) )
-                {
-                    ROS_ERROR_STREAM("ScanHistoryManager::mapMessageOverlapCheck() - we could not find the cloud!");
-                    cloudsToSend.pop_back(); // remove last added element since for some reason we didn't fin the cloud
-                }
+                missingScans.insert(scanIndex);
             }
             else
             {
@@ -224,6 +291,85 @@ void ScanHistoryManager::mapMessageOverlapCheck(const geometry_msgs::PoseArray&
         }
 
     }    
+
+    if(!map_sync_scheduler_.isRateLimited())
+    {
+        // send all the missing scans at once 
+        cloudsToSend.reserve(missingScans.size());
+        for(auto it=missingScans.begin(), itEnd=missingScans.end(); it != itEnd; it++)
+        {
+            sensor_msgs::PointCloud2::ConstPtr cloud_msg;
+            if( !getCloudMessage( cloud_msg, *it) )
+            {
+                ROS_ERROR_STREAM("ScanHistoryManager::mapMessageOverlapCheck() - we could not find the cloud!");
+                continue; /// < CONTINUE
+            }
+            cloudsToSend.push_back(cloud_msg);
+        }
+        return; /// < EXIT POINT
+    }
+
+    // rank the missing scans by their expected information for the teammate: the squared distance of the scan from its closest teammate pose 
+    const int peerId = atoi(message.header.frame_id.c_str());
+    const ros::Time now = ros::Time::now();
+    pp::PointHashIndex<pcl::PointXYZ> teammatePoseIndex(kMaxScanDistance);
+    for(size_t i=0; i<message.poses.size();i++)
+    {
+        const geometry_msgs::Point& p = message.poses[i].position;
+        teammatePoseIndex.insert(i, pcl::PointXYZ(p.x, p.y, p.z));
+    }
+    int numScheduled = 0; 
+    for(auto it=missingScans.begin(), itEnd=missingScans.end(); it != itEnd; it++)
+    {
+        auto itScan = mapIndexToScanInfoPtr_.find(*it);
+        if(itScan == mapIndexToScanInfoPtr_.end()) continue; /// < CONTINUE
+        
+        pp::PointHashIndex<pcl::PointXYZ>::Id closestPoseId = 0;
+        float minSquaredDistance = std::numeric_limits<float>::max();
+        teammatePoseIndex.nearestSearch(itScan->second->position, closestPoseId, minSquaredDistance);
+        if(map_sync_scheduler_.schedule(peerId, *it, minSquaredDistance, now)) numScheduled++;
+    }
+    ROS_INFO_STREAM("ScanHistoryManager::mapMessageOverlapCheck() - scheduled " << numScheduled << " scans for robot " << peerId << " (pending: " << map_sync_scheduler_.getNumPending() << ")");
+}
+
+void ScanHistoryManager::getScheduledClouds(std::vector<std::pair<int, sensor_msgs::PointCloud2::Ptr> >& cloudsToSend)
+{
+    boost::recursive_mutex::scoped_lock locker(interaction_mutex);
+
+    cloudsToSend.clear();
+    if(!isInit_) return; 
+
+    const ros::Time now = ros::Time::now();
+    MapSyncScheduler::Request request; 
+    while(map_sync_scheduler_.next(now, request))
+    {
+        sensor_msgs::PointCloud2::ConstPtr cloud_msg;
+        if( !getCloudMessage( cloud_msg, request.scanIndex) )
+        {
+            ROS_ERROR_STREAM("ScanHistoryManager::getScheduledClouds() - we could not find the cloud!");
+            continue; 
+        }
+        
+        map_sync_scheduler_.consume(cloud_msg->data.size());
+        cloudsToSend.push_back(std::make_pair(request.peerId, cloud_msg));
+    }
+}
+
+void ScanHistoryManager::downsampleCloudMessage(sensor_msgs::PointCloud2::Ptr &cloud_msg)
+{
+    const double leafSize = map_sync_scheduler_.getParams().downsample_leaf_size_;
+    if(leafSize <= 0) return; 
+
+    pcl::PCLPointCloud2::Ptr cloud(new pcl::PCLPointCloud2()); 
+    pcl_conversions::toPCL(*cloud_msg, *cloud);
+    
+    pcl::PCLPointCloud2 cloudFiltered; 
+    pcl::VoxelGrid<pcl::PCLPointCloud2> voxelGrid;
+    voxelGrid.setInputCloud(cloud);
+    voxelGrid.setLeafSize(leafSize, leafSize, leafSize);
+    voxelGrid.filter(cloudFiltered);
+    
+    pcl_conversions::fromPCL(cloudFiltered, *cloud_msg);
 }
 
 } // namespace explplanner
@@ -0,0 +1,516 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ScanLog.h"
+
+#include <cstring>
+#include <cerrno>
+#include <cmath>
+#include <limits>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <ros/ros.h>
+
+
+namespace explplanner
+{
+
+const uint32_t ScanLog::kMagic = 0x314e4353; // "SCN1"
+const double ScanLog::kDefaultQuantizationStep = 0.001; // [m]
+
+static const size_t kRecordHeaderSize = 4 + 4 + 8 + 3*4 + 4 + 4; // magic, id, stamp, position, codec, payload size
+
+
+/// < little helpers for writing/reading the records (host byte order)
+
+class ByteWriter
+{
+public:
+    ByteWriter(std::vector<uint8_t>& buffer):buffer_(buffer){}
+
+    template<typename T>
+    void put(const T& value)
+    {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+        buffer_.insert(buffer_.end(), bytes, bytes + sizeof(T));
+    }
+
+    void putBytes(const uint8_t* bytes, size_t size) { buffer_.insert(buffer_.end(), bytes, bytes + size); }
+
+    void putString(const std::string& str)
+    {
+        put<uint32_t>(str.size());
+        putBytes(reinterpret_cast<const uint8_t*>(str.data()), str.size());
+    }
+
+    void putVarint(uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            buffer_.push_back((uint8_t)(value | 0x80));
+            value >>= 7;
+        }
+        buffer_.push_back((uint8_t)value);
+    }
+
+    size_t size() const { return buffer_.size(); }
+
+private:
+    std::vector<uint8_t>& buffer_;
+};
+
+class ByteReader
+{
+public:
+    ByteReader(const uint8_t* data, size_t size):data_(data), size_(size), pos_(0), b_ok_(true){}
+
+    template<typename T>
+    T get()
+    {
+        T value = T();
+        if (!check(sizeof(T))) return value; /// < EXIT POINT
+        memcpy(&value, data_ + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return value;
+    }
+
+    const uint8_t* getBytes(size_t size)
+    {
+        if (!check(size)) return NULL; /// < EXIT POINT
+        const uint8_t* bytes = data_ + pos_;
+        pos_ += size;
+        return bytes;
+    }
+
+    std::string getString()
+    {
+        const uint32_t size = get<uint32_t>();
+        const uint8_t* bytes = getBytes(size);
+        return bytes ? std::string(reinterpret_cast<const char*>(bytes), size) : std::string();
+    }
+
+    uint64_t getVarint()
+    {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            if (!check(1)) return 0; /// < EXIT POINT
+            const uint8_t byte = data_[pos_++];
+            value |= (uint64_t)(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return value; /// < EXIT POINT
+        }
+        b_ok_ = false;
+        return 0;
+    }
+
+    bool ok() const { return b_ok_; }
+
+private:
+    bool check(size_t size)
+    {
+        if (!b_ok_ || (pos_ + size > size_)) b_ok_ = false;
+        return b_ok_;
+    }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_;
+    bool b_ok_;
+};
+
+static inline uint64_t zigZagEncode(int64_t value) { return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63); }
+static inline int64_t zigZagDecode(uint64_t value) { return (int64_t)(value >> 1) ^ -(int64_t)(value & 1); }
+
+// offset of the float32 field name (-1 if it is missing or it is not a single float32)
+static int getFloatFieldOffset(const pcl::PCLPointCloud2& cloud, const std::string& name)
+{
+    for (size_t ii = 0; ii < cloud.fields.size(); ii++)
+    {
+        const pcl::PCLPointField& field = cloud.fields[ii];
+        if (field.name == name)
+        {
+            if ((field.datatype != pcl::PCLPointField::FLOAT32) || (field.count != 1) || (field.offset + 4 > cloud.point_step)) return -1; /// < EXIT POINT
+            return field.offset;
+        }
+    }
+    return -1;
+}
+
+// byte runs [start, start+length) of a point which are not covered by the x, y, z fields
+static void getResidualRuns(uint32_t pointStep, const int offsets[3], std::vector<std::pair<uint32_t, uint32_t> >& runs)
+{
+    std::vector<bool> covered(pointStep, false);
+    for (int k = 0; k < 3; k++)
+    {
+        for (int b = 0; b < 4; b++) covered[offsets[k] + b] = true;
+    }
+    runs.clear();
+    for (uint32_t b = 0; b < pointStep; )
+    {
+        if (covered[b]) { b++; continue; } /// < CONTINUE
+        const uint32_t start = b;
+        while ((b < pointStep) && !covered[b]) b++;
+        runs.push_back(std::make_pair(start, b - start));
+    }
+}
+
+
+ScanLog::ScanLog():fd_(-1), map_(NULL), mapSize_(0), fileSize_(0), rawDataSize_(0), quantizationStep_(kDefaultQuantizationStep)
+{}
+
+ScanLog::~ScanLog()
+{
+    close();
+}
+
+bool ScanLog::open(const std::string& filePath, double quantizationStep)
+{
+    close();
+
+    filePath_ = filePath;
+    quantizationStep_ = (quantizationStep > 0) ? quantizationStep : kDefaultQuantizationStep;
+
+    fd_ = ::open(filePath_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0)
+    {
+        ROS_ERROR_STREAM("ScanLog::open() - could not open " << filePath_ << ": " << strerror(errno));
+        return false; /// < EXIT POINT
+    }
+
+    ROS_INFO_STREAM("ScanLog::open() - logging scans to " << filePath_ << " (quantization step: " << quantizationStep_ << " m)");
+    return true;
+}
+
+void ScanLog::close()
+{
+    if (map_)
+    {
+        munmap(map_, mapSize_);
+        map_ = NULL;
+        mapSize_ = 0;
+    }
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    fileSize_ = 0;
+    rawDataSize_ = 0;
+    index_.clear();
+}
+
+bool ScanLog::append(uint32_t id, const pcl::PCLPointCloud2& cloud, const float position[3])
+{
+    if (!isOpen()) return false; /// < EXIT POINT
+    if (contains(id))
+    {
+        ROS_ERROR_STREAM("ScanLog::append() - scan " << id << " already logged");
+        return false; /// < EXIT POINT
+    }
+
+    /// < encode the payload after the record header
+    buffer_.clear();
+    buffer_.resize(kRecordHeaderSize);
+    uint32_t codec = kCodecRaw;
+    encode(cloud, quantizationStep_, buffer_, codec);
+
+    const uint32_t payloadSize = buffer_.size() - kRecordHeaderSize;
+    const uint64_t stamp = cloud.header.stamp;
+    uint8_t* header = buffer_.data();
+    memcpy(header, &kMagic, 4);           header += 4;
+    memcpy(header, &id, 4);               header += 4;
+    memcpy(header, &stamp, 8);            header += 8;
+    memcpy(header, position, 3*4);        header += 3*4;
+    memcpy(header, &codec, 4);            header += 4;
+    memcpy(header, &payloadSize, 4);
+
+    /// < append the record
+    size_t written = 0;
+    while (written < buffer_.size())
+    {
+        const ssize_t res = pwrite(fd_, buffer_.data() + written, buffer_.size() - written, fileSize_ + written);
+        if (res < 0)
+        {
+            if (errno == EINTR) continue; /// < CONTINUE
+            ROS_ERROR_STREAM("ScanLog::append() - could not write scan " << id << ": " << strerror(errno));
+            return false; /// < EXIT POINT (the partial record is overwritten by the next append)
+        }
+        written += res;
+    }
+
+    Entry entry;
+    entry.offset = fileSize_;
+    entry.recordSize = buffer_.size();
+    entry.stamp = stamp;
+    entry.position[0] = position[0];
+    entry.position[1] = position[1];
+    entry.position[2] = position[2];
+    index_[id] = entry;
+
+    fileSize_ += buffer_.size();
+    rawDataSize_ += cloud.data.size();
+
+    ROS_INFO_STREAM("ScanLog::append() - scan " << id << ": " << cloud.data.size() << " -> " << payloadSize << " bytes (codec " << codec << ")");
+    return true;
+}
+
+bool ScanLog::read(uint32_t id, pcl::PCLPointCloud2& cloud)
+{
+    auto it = index_.find(id);
+    if (it == index_.end())
+    {
+        ROS_ERROR_STREAM("ScanLog::read() - scan " << id << " not logged");
+        return false; /// < EXIT POINT
+    }
+    const Entry& entry = it->second;
+
+    if ((entry.offset + entry.recordSize > mapSize_) && !remap()) return false; /// < EXIT POINT
+
+    ByteReader header(map_ + entry.offset, kRecordHeaderSize);
+    const uint32_t magic = header.get<uint32_t>();
+    const uint32_t recordId = header.get<uint32_t>();
+    header.get<uint64_t>(); // stamp
+    header.getBytes(3*4);   // position
+    const uint32_t codec = header.get<uint32_t>();
+    const uint32_t payloadSize = header.get<uint32_t>();
+    if (!header.ok() || (magic != kMagic) || (recordId != id) || (kRecordHeaderSize + payloadSize != entry.recordSize))
+    {
+        ROS_ERROR_STREAM("ScanLog::read() - corrupted record of scan " << id);
+        return false; /// < EXIT POINT
+    }
+
+    if (!decode(map_ + entry.offset + kRecordHeaderSize, payloadSize, codec, cloud))
+    {
+        ROS_ERROR_STREAM("ScanLog::read() - could not decode scan " << id);
+        return false; /// < EXIT POINT
+    }
+    return true;
+}
+
+bool ScanLog::getClosestScan(float x, float y, float z, uint32_t& id, float& squaredDistance) const
+{
+    squaredDistance = std::numeric_limits<float>::max();
+    bool b_found = false;
+    for (auto it = index_.begin(), itEnd = index_.end(); it != itEnd; it++)
+    {
+        const float* p = it->second.position;
+        const float d2 = (p[0] - x)*(p[0] - x) + (p[1] - y)*(p[1] - y) + (p[2] - z)*(p[2] - z);
+        if (d2 < squaredDistance)
+        {
+            squaredDistance = d2;
+            id = it->first;
+            b_found = true;
+        }
+    }
+    return b_found;
+}
+
+bool ScanLog::remap()
+{
+    if (map_)
+    {
+        munmap(map_, mapSize_);
+        map_ = NULL;
+        mapSize_ = 0;
+    }
+    if (fileSize_ == 0) return false; /// < EXIT POINT
+
+    void* map = mmap(NULL, fileSize_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (map == MAP_FAILED)
+    {
+        ROS_ERROR_STREAM("ScanLog::remap() - could not map " << filePath_ << ": " << strerror(errno));
+        return false; /// < EXIT POINT
+    }
+    map_ = static_cast<uint8_t*>(map);
+    mapSize_ = fileSize_;
+    return true;
+}
+
+void ScanLog::encode(const pcl::PCLPointCloud2& cloud, double quantizationStep, std::vector<uint8_t>& payload, uint32_t& codec)
+{
+    ByteWriter writer(payload);
+
+    /// < cloud layout
+    writer.putString(cloud.header.frame_id);
+    writer.put<uint64_t>(cloud.header.stamp);
+    writer.put<uint32_t>(cloud.header.seq);
+    writer.put<uint32_t>(cloud.height);
+    writer.put<uint32_t>(cloud.width);
+    writer.put<uint8_t>(cloud.is_bigendian);
+    writer.put<uint32_t>(cloud.point_step);
+    writer.put<uint32_t>(cloud.row_step);
+    writer.put<uint8_t>(cloud.is_dense);
+    writer.put<uint32_t>(cloud.fields.size());
+    for (size_t ii = 0; ii < cloud.fields.size(); ii++)
+    {
+        writer.putString(cloud.fields[ii].name);
+        writer.put<uint32_t>(cloud.fields[ii].offset);
+        writer.put<uint8_t>(cloud.fields[ii].datatype);
+        writer.put<uint32_t>(cloud.fields[ii].count);
+    }
+
+    /// < check if the xyz codec applies
+    const size_t numPoints = (size_t)cloud.width * cloud.height;
+    const int offsets[3] = {getFloatFieldOffset(cloud, "x"), getFloatFieldOffset(cloud, "y"), getFloatFieldOffset(cloud, "z")};
+    bool b_xyz = (offsets[0] >= 0) && (offsets[1] >= 0) && (offsets[2] >= 0) && !cloud.is_bigendian &&
+                 (numPoints > 0) && (cloud.data.size() == numPoints * cloud.point_step);
+    if (b_xyz)
+    {
+        const double maxValue = quantizationStep * (double)std::numeric_limits<int32_t>::max();
+        for (size_t ii = 0; (ii < numPoints) && b_xyz; ii++)
+        {
+            const uint8_t* point = &cloud.data[ii * cloud.point_step];
+            for (int k = 0; k < 3; k++)
+            {
+                float value;
+                memcpy(&value, point + offsets[k], 4);
+                if (!std::isfinite(value) || (fabs(value) > maxValue)) { b_xyz = false; break; }
+            }
+        }
+    }
+
+    if (!b_xyz)
+    {
+        codec = kCodecRaw;
+        writer.put<uint64_t>(cloud.data.size());
+        writer.putBytes(cloud.data.data(), cloud.data.size());
+        return; /// < EXIT POINT
+    }
+
+    codec = kCodecXyzDelta;
+    writer.put<double>(quantizationStep);
+    writer.put<int32_t>(offsets[0]);
+    writer.put<int32_t>(offsets[1]);
+    writer.put<int32_t>(offsets[2]);
+
+    std::vector<std::pair<uint32_t, uint32_t> > runs;
+    getResidualRuns(cloud.point_step, offsets, runs);
+
+    /// < quantized xyz deltas (consecutive points of a scan are close, hence the deltas are mostly 1-2 byte varints)
+    const double invStep = 1./quantizationStep;
+    int64_t previous[3] = {0, 0, 0};
+    for (size_t ii = 0; ii < numPoints; ii++)
+    {
+        const uint8_t* point = &cloud.data[ii * cloud.point_step];
+        for (int k = 0; k < 3; k++)
+        {
+            float value;
+            memcpy(&value, point + offsets[k], 4);
+            const int64_t quantized = llround(value * invStep);
+            writer.putVarint(zigZagEncode(quantized - previous[k]));
+            previous[k] = quantized;
+        }
+    }
+
+    /// < the other bytes of the points, verbatim
+    for (size_t ii = 0; ii < numPoints; ii++)
+    {
+        const uint8_t* point = &cloud.data[ii * cloud.point_step];
+        for (size_t jj = 0; jj < runs.size(); jj++)
+        {
+            writer.putBytes(point + runs[jj].first, runs[jj].second);
+        }
+    }
+}
+
+bool ScanLog::decode(const uint8_t* payload, size_t payloadSize, uint32_t codec, pcl::PCLPointCloud2& cloud)
+{
+    ByteReader reader(payload, payloadSize);
+
+    /// < cloud layout
+    cloud.header.frame_id = reader.getString();
+    cloud.header.stamp = reader.get<uint64_t>();
+    cloud.header.seq = reader.get<uint32_t>();
+    cloud.height = reader.get<uint32_t>();
+    cloud.width = reader.get<uint32_t>();
+    cloud.is_bigendian = reader.get<uint8_t>();
+    cloud.point_step = reader.get<uint32_t>();
+    cloud.row_step = reader.get<uint32_t>();
+    cloud.is_dense = reader.get<uint8_t>();
+    const uint32_t numFields = reader.get<uint32_t>();
+    if (!reader.ok()) return false; /// < EXIT POINT
+    cloud.fields.resize(numFields);
+    for (size_t ii = 0; ii < numFields; ii++)
+    {
+        cloud.fields[ii].name = reader.getString();
+        cloud.fields[ii].offset = reader.get<uint32_t>();
+        cloud.fields[ii].datatype = reader.get<uint8_t>();
+        cloud.fields[ii].count = reader.get<uint32_t>();
+    }
+    if (!reader.ok()) return false; /// < EXIT POINT
+
+    if (codec == kCodecRaw)
+    {
+        const uint64_t dataSize = reader.get<uint64_t>();
+        const uint8_t* data = reader.getBytes(dataSize);
+        if (!data) return false; /// < EXIT POINT
+        cloud.data.assign(data, data + dataSize);
+        return true; /// < EXIT POINT
+    }
+
+    if (codec != kCodecXyzDelta) return false; /// < EXIT POINT
+
+    const double quantizationStep = reader.get<double>();
+    int offsets[3];
+    offsets[0] = reader.get<int32_t>();
+    offsets[1] = reader.get<int32_t>();
+    offsets[2] = reader.get<int32_t>();
+    if (!reader.ok()) return false; /// < EXIT POINT
+    for (int k = 0; k < 3; k++)
+    {
+        if ((offsets[k] < 0) || ((uint32_t)offsets[k] + 4 > cloud.point_step)) return false; /// < EXIT POINT
+    }
+
+    const size_t numPoints = (size_t)cloud.width * cloud.height;
+    cloud.data.resize(numPoints * cloud.point_step);
+
+    int64_t previous[3] = {0, 0, 0};
+    for (size_t ii = 0; ii < numPoints; ii++)
+    {
+        uint8_t* point = &cloud.data[ii * cloud.point_step];
+        for (int k = 0; k < 3; k++)
+        {
+            previous[k] += zigZagDecode(reader.getVarint());
+            const float value = (float)(previous[k] * quantizationStep);
+            memcpy(point + offsets[k], &value, 4);
+        }
+    }
+    if (!reader.ok()) return false; /// < EXIT POINT
+
+    std::vector<std::pair<uint32_t, uint32_t> > runs;
+    getResidualRuns(cloud.point_step, offsets, runs);
+    for (size_t ii = 0; ii < numPoints; ii++)
+    {
+        uint8_t* point = &cloud.data[ii * cloud.point_step];
+        for (size_t jj = 0; jj < runs.size(); jj++)
+        {
+            const uint8_t* bytes = reader.getBytes(runs[jj].second);
+            if (!bytes) return false; /// < EXIT POINT
+            memcpy(point + runs[jj].first, bytes, runs[jj].second);
+        }
+    }
+    return true;
+}
+
+} // namespace explplanner
@@ -39,7 +39,7 @@
 namespace explplanner
 {
 
-SpaceTimeFilterBase::SpaceTimeFilterBase():pcl_pose_(new pcl::PointCloud<pcl::PointNormal>()),oldest_pose_idx_(0)
+SpaceTimeFilterBase::SpaceTimeFilterBase():first_pose_id_(0)
 {
 }
 
@@ -144,53 +144,43 @@ bool SpaceTimeFilterBase::filterPointCloud(const sensor_msgs::PointCloud2::Const
     search_pose.z = q_p_i.z();
 
     // If Lf is empty
-    if (pcl_pose_->empty())
+    if (poses_.empty())
     {
         std::cout << "SpaceTimeFilterBase::filterPointCloud() - Pushing initial pose - (" << q_p_i.x() << ", " << q_p_i.y() << ", " << q_p_i.z() << ") with normal - (" << q_n_i(0) << ", " << q_n_i(1) << ", " << q_n_i(2) << ")" << std::endl;
         return true; // continue
     }
 
-    int K = 1;
-    std::vector<int> pointIdxNKNSearch(K);
-    std::vector<float> pointNKNSquaredDistance(K);
-    int num_founds = kdtree_pose_.nearestKSearch(search_pose, K, pointIdxNKNSearch, pointNKNSquaredDistance);
-    if (num_founds == 0)
+    // a pose farther than dist_pose_thres_ from all the stored ones is stored anyway: search the closest pose only within that radius
+    pose_index_.setCellSize(params_.dist_pose_thres_);
+    uint64_t closest_pose_id = 0;
+    float closest_squared_distance = 0;
+    if (!pose_index_.nearestSearch(search_pose, closest_pose_id, closest_squared_distance, params_.dist_pose_thres_))
     {
-        std::cout << "WARNING: getting transformation" << std::endl;
-        return false;
+        std::cout << "SpaceTimeFilterBase::filterPointCloud() - New pose to store - no close pose (pose cache size: "<< poses_.size() << ")" << std::endl;
+        return true;
     }
-
-#if 0        
-    Eigen::Vector3d q_pf;
-    q_pf(0) = pcl_pose_->points[pointIdxNKNSearch[0]].x;
-    q_pf(1) = pcl_pose_->points[pointIdxNKNSearch[0]].y;
-    q_pf(2) = pcl_pose_->points[pointIdxNKNSearch[0]].z;
-    std::cout << " closest pose found:  (" << q_pf(0) << ", " << q_pf(1) << ", " << q_pf(2) << ") and normal - (" <<  q_nf(0) << ", " << q_nf(1) << ", " << q_nf(2) << ")" << std::endl;
-#endif
+    const pcl::PointNormal& closest_pose = poses_[closest_pose_id - first_pose_id_].pose;
 
     Eigen::Vector3d q_nf;
-    q_nf(0) = pcl_pose_->points[pointIdxNKNSearch[0]].normal_x;
-    q_nf(1) = pcl_pose_->points[pointIdxNKNSearch[0]].normal_y;
-    q_nf(2) = pcl_pose_->points[pointIdxNKNSearch[0]].normal_z;
+    q_nf(0) = closest_pose.normal_x;
+    q_nf(1) = closest_pose.normal_y;
+    q_nf(2) = closest_pose.normal_z;
     q_nf.normalize(); // normalize in place
 
-    double dist_poses = sqrt(pointNKNSquaredDistance[0]);
+    double dist_poses = sqrt(closest_squared_distance);
 
     double cos_theta = q_n_i.dot(q_nf);            // avoid division by a quantity which risks to be zero or ill-conditioned
     double theta = acos(cos_theta) * (180 / M_PI); //  get angle in degs
     //std::cout << "q_nf= " << q_nf << " theta= " << theta << std::endl;
 
-    ros::Time pcl_pose_time;
-    fromUint64ToRosTime(pcl_pose_->header.stamp, pcl_pose_time);
-
-    const ros::Duration timestamp_age = pcl_stamp - pcl_pose_time;
+    const ros::Duration timestamp_age = pcl_stamp - last_pose_stamp_;
     if ((dist_poses > params_.dist_pose_thres_) || 
         (theta > params_.rot_pose_thres_) || 
         (timestamp_age.toSec() > params_.pcl_throttle_))
     {
         std::cout << "SpaceTimeFilterBase::filterPointCloud() - New pose to store - time: " << timestamp_age 
                   << " theta: " << theta << " dist: " << dist_poses 
-                  << " (pose cache size: "<< pcl_pose_->size() << ")" << std::endl;
+                  << " (pose cache size: "<< poses_.size() << ")" << std::endl;
         return true;
     }
     return false;
@@ -220,30 +210,24 @@ bool SpaceTimeFilterBase::insertPointCloud(const sensor_msgs::PointCloud2::Const
         pose.normal_y = q_n_i(1);
         pose.normal_z = q_n_i(2);
 
-        pcl_pose_->header.stamp = fromRosTimeToUint64(pcl_stamp);
-        pcl_pose_->push_back(pose);
-        pcl_pose_stamp_.push_back(pcl_stamp);
-
-        ROS_ASSERT_MSG(pcl_pose_->size()==pcl_pose_stamp_.size(),"pcl_pose_ and pcl_pose_stamp_ should have equal size");      
-
-        // control pcl_pose_ size: remove old poses 
-        while(pcl_pose_->size()>2)
+        PoseEntry entry;
+        entry.pose = pose;
+        entry.stamp = pcl_stamp;
+        poses_.push_back(entry);
+        pose_index_.setCellSize(params_.dist_pose_thres_);
+        pose_index_.insert(first_pose_id_ + poses_.size() - 1, pose);
+        last_pose_stamp_ = pcl_stamp;
+        last_inserted_pose_ = pose;
+
+        // control the pose cache size: remove the expired poses (the oldest one is in front)
+        while(poses_.size()>2)
         {
-            const ros::Duration timestamp_age = ros::Time::now() - pcl_pose_stamp_[oldest_pose_idx_];
+            const ros::Duration timestamp_age = ros::Time::now() - poses_.front().stamp;
             if(timestamp_age.toSec() > params_.pose_cache_time_length_)
             {
-                auto& oldest_pose = (*pcl_pose_)[oldest_pose_idx_];
-                auto& oldest_time = pcl_pose_stamp_[oldest_pose_idx_];
-
-                std::swap(oldest_pose, pcl_pose_->back());
-                pcl_pose_->points.pop_back();
-                pcl_pose_->width = pcl_pose_->size();            
-                ROS_ASSERT_MSG(pcl_pose_->height==1,"pcl_pose_ should have height=1!");  
-
-                std::swap(oldest_time, pcl_pose_stamp_.back());
-                pcl_pose_stamp_.pop_back();
-
-                oldest_pose_idx_ = (oldest_pose_idx_+1) % pcl_pose_->size();            
+                pose_index_.remove(first_pose_id_, poses_.front().pose);
+                poses_.pop_front();
+                first_pose_id_++;
             }
             else
             {
@@ -251,8 +235,6 @@ bool SpaceTimeFilterBase::insertPointCloud(const sensor_msgs::PointCloud2::Const
             }
         }
 
-        kdtree_pose_.setInputCloud(pcl_pose_);     
-
         return true; 
     }
     else 
@@ -321,10 +303,10 @@ void SpaceTimeFilterBase::getPoseArrayMessage(geometry_msgs::PoseArray& message)
     boost::recursive_mutex::scoped_lock locker(interaction_mutex);
     message.header.stamp = ros::Time::now();
 
-    message.poses.resize(pcl_pose_->size());
-    for(int i=0;i<pcl_pose_->size();i++)
+    message.poses.resize(poses_.size());
+    for(size_t i=0;i<poses_.size();i++)
     {
-        const auto& pose = (*pcl_pose_)[i];
+        const auto& pose = poses_[i].pose;
         message.poses[i].position.x = pose.x;
         message.poses[i].position.y = pose.y;
         message.poses[i].position.z = pose.z;
@@ -339,11 +321,8 @@ bool SpaceTimeFilterBase::getClosestScanInfo(const pcl::PointNormal& searchPoint
     boost::recursive_mutex::scoped_lock locker(interaction_mutex);
 
     bool res = true; 
-    const int K = 1;
-    std::vector<int> pointIdxNKNSearch(K);
-    std::vector<float> pointNKNSquaredDistance(K);
 
-    if(pcl_pose_->empty())
+    if(poses_.empty())
     {
         scanIndex = 0;
         scanSquaredDistance = -1;
@@ -352,8 +331,8 @@ bool SpaceTimeFilterBase::getClosestScanInfo(const pcl::PointNormal& searchPoint
     }
     else
     {
-        int num_founds = kdtree_pose_.nearestKSearch(searchPoint, K, pointIdxNKNSearch, pointNKNSquaredDistance);
-        if (num_founds == 0)
+        uint64_t closest_pose_id = 0;
+        if (!pose_index_.nearestSearch(searchPoint, closest_pose_id, scanSquaredDistance))
         {
             ROS_WARN_STREAM("SpaceTimeFilterBase::getClosestScanIndex() - could not get closest point");
             scanIndex = 0;
@@ -362,8 +341,7 @@ bool SpaceTimeFilterBase::getClosestScanInfo(const pcl::PointNormal& searchPoint
         }
         else
         { 
-            scanIndex = *(uint32_t*)&(pcl_pose_->points[pointIdxNKNSearch[0]].data[3]);
-            scanSquaredDistance = pointNKNSquaredDistance[0];
+            scanIndex = *(uint32_t*)&(poses_[closest_pose_id - first_pose_id_].pose.data[3]);
         }
     }
     return res; 
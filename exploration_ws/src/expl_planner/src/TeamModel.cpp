@@ -30,7 +30,7 @@
 //    uint8 kCompleted       = 7
 const std::string kActionString[]={"None", "Reached", "Planned", "Selected", "Aborted", "Position", "No Information", "Completed"}; // keep this coherent with the content of ExplorationRobotMessage.msg in exploration_msgs
 
-RobotPlanningState::RobotPlanningState():path_length(-1.),bValidPosition(false),bNoInformation(false),bCompleted(false)
+RobotPlanningState::RobotPlanningState():path_length(-1.),path_geometric_length(0.),bValidPosition(false),bNoInformation(false),bCompleted(false)
 {
 }
 
@@ -38,6 +38,7 @@ void RobotPlanningState::Reset()
 {
     path.poses.clear();
     path_length = -1.; 
+    path_geometric_length = 0.;
     timestamp = ros::Time::now();
     
     bValidPosition = false; 
@@ -48,6 +49,148 @@ void RobotPlanningState::Reset()
 }
 
 
+TeamConflictIndex::TeamConflictIndex(double cell_size):visit_stamp_(0)
+{
+    clear(cell_size);
+}
+
+void TeamConflictIndex::clear(double cell_size)
+{
+    cell_size_ = std::max(cell_size, 1e-3);
+    cell_size_inv_ = 1./cell_size_;
+    items_.clear();
+    cells_.clear();
+    visit_stamps_.clear();
+    visit_stamp_ = 0; 
+}
+
+void TeamConflictIndex::addPoint(const Eigen::Vector3d& point, int robot_id, ItemType type, double path_length)
+{
+    Item item; 
+    item.a = point; 
+    item.b = point; 
+    item.robot_id = robot_id;
+    item.type = type;
+    item.path_length = path_length;
+    addItem(item);
+}
+
+void TeamConflictIndex::addSegment(const Eigen::Vector3d& a, const Eigen::Vector3d& b, int robot_id)
+{
+    Item item; 
+    item.a = a; 
+    item.b = b; 
+    item.robot_id = robot_id;
+    item.type = kPathSegment;
+    item.path_length = -1;
+    addItem(item);
+}
+
+void TeamConflictIndex::addItem(const Item& item)
+{
+    const int id = items_.size();
+    items_.push_back(item);
+    visit_stamps_.push_back(0);
+    
+    // bucket the item in all the cells overlapped by its bounding box 
+    const int min_x = getCellCoord(std::min(item.a.x(), item.b.x()));
+    const int max_x = getCellCoord(std::max(item.a.x(), item.b.x()));
+    const int min_y = getCellCoord(std::min(item.a.y(), item.b.y()));
+    const int max_y = getCellCoord(std::max(item.a.y(), item.b.y()));
+    for(int ix = min_x; ix <= max_x; ix++)
+    {
+        for(int iy = min_y; iy <= max_y; iy++)
+        {
+            cells_[getKey(ix,iy)].push_back(id);
+        }
+    }
+}
+
+void TeamConflictIndex::query(const Eigen::Vector3d& a, const Eigen::Vector3d& b, double radius, std::vector<const Item*>& items)
+{
+    items.clear();
+    if(items_.empty()) return; /// < EXIT POINT 
+    
+    visit_stamp_++;
+    
+    const int min_x = getCellCoord(std::min(a.x(), b.x()) - radius);
+    const int max_x = getCellCoord(std::max(a.x(), b.x()) + radius);
+    const int min_y = getCellCoord(std::min(a.y(), b.y()) - radius);
+    const int max_y = getCellCoord(std::max(a.y(), b.y()) + radius);
+    for(int ix = min_x; ix <= max_x; ix++)
+    {
+        for(int iy = min_y; iy <= max_y; iy++)
+        {
+            boost::unordered_map<int64_t, std::vector<int> >::const_iterator it = cells_.find(getKey(ix,iy));
+            if(it == cells_.end()) continue; 
+            
+            const std::vector<int>& cell_items = it->second;
+            for(size_t kk = 0; kk < cell_items.size(); kk++)
+            {
+                const int id = cell_items[kk];
+                if(visit_stamps_[id] == visit_stamp_) continue; // already tested
+                visit_stamps_[id] = visit_stamp_;
+                
+                const Item& item = items_[id];
+                if(segmentSegmentDistance(a, b, item.a, item.b) < radius)
+                {
+                    items.push_back(&item);
+                }
+            }
+        }
+    }
+}
+
+// closest points of two segments, see C. Ericson, "Real-Time Collision Detection", 5.1.9
+double TeamConflictIndex::segmentSegmentDistance(const Eigen::Vector3d& p0, const Eigen::Vector3d& p1, const Eigen::Vector3d& q0, const Eigen::Vector3d& q1)
+{
+    static const double kEpsilon = 1e-12;
+    
+    const Eigen::Vector3d d1 = p1 - p0; 
+    const Eigen::Vector3d d2 = q1 - q0; 
+    const Eigen::Vector3d r = p0 - q0;
+    const double a = d1.squaredNorm(); 
+    const double e = d2.squaredNorm(); 
+    const double f = d2.dot(r);
+    
+    double s = 0, t = 0; 
+    if( (a <= kEpsilon) && (e <= kEpsilon) )
+    {
+        return r.norm(); /// < EXIT POINT : both segments are points
+    }
+    if(a <= kEpsilon)
+    {
+        t = std::min(std::max(f/e, 0.), 1.);
+    }
+    else
+    {
+        const double c = d1.dot(r);
+        if(e <= kEpsilon)
+        {
+            s = std::min(std::max(-c/a, 0.), 1.);
+        }
+        else
+        {
+            const double b = d1.dot(d2);
+            const double denom = a*e - b*b; 
+            s = (denom > kEpsilon) ? std::min(std::max((b*f - c*e)/denom, 0.), 1.) : 0.; 
+            t = (b*s + f)/e; 
+            if(t < 0.)
+            {
+                t = 0.; 
+                s = std::min(std::max(-c/a, 0.), 1.);
+            }
+            else if(t > 1.)
+            {
+                t = 1.; 
+                s = std::min(std::max((b - c)/a, 0.), 1.);
+            }
+        }
+    }
+    return ((p0 + d1*s) - (q0 + d2*t)).norm();
+}
+
+
 const double TeamModel::kExpirationTime = 10; // [sec]
 const double TeamModel::kNodeConflictDistance = 3; // [m]
 const int TeamModel::kNumRobotsDefault = 2;
@@ -57,6 +200,8 @@ TeamModel::TeamModel()
     my_robot_id_ = 0;
     num_robots_ = 0;
     conflict_distance_ = kNodeConflictDistance;
+    b_check_path_conflicts_ = false;
+    b_index_dirty_ = true;
     setNumRobots(kNumRobotsDefault);
 }
 
@@ -66,6 +211,7 @@ void TeamModel::setNumRobots(const int& num_robots)
     boost::recursive_mutex::scoped_lock locker(mutex_);
     num_robots_ = num_robots;
     robot_states_.resize(num_robots);
+    b_index_dirty_ = true;
 }
 
 // we assume robot_id are zero-based 
@@ -87,8 +233,10 @@ void TeamModel::setRobotPlanData(const int& robot_id, const Eigen::Vector3d& goa
     
     robot_states_[robot_id].goal = goal; 
     robot_states_[robot_id].path.poses.clear();
+    robot_states_[robot_id].path_geometric_length = 0.;
     //robot_states_[robot_id].path_length = -1;   
     robot_states_[robot_id].timestamp = timestamp; 
+    b_index_dirty_ = true;
 }
     
 void TeamModel::setRobotPlanData(const int& robot_id, const Eigen::Vector3d& goal, const nav_msgs::Path& path, const double path_cost, const ros::Time& timestamp)
@@ -97,6 +245,7 @@ void TeamModel::setRobotPlanData(const int& robot_id, const Eigen::Vector3d& goa
     setRobotPlanData(robot_id, goal, timestamp);
             
     robot_states_[robot_id].path = path; 
+    robot_states_[robot_id].path_geometric_length = computePathLength(path); // cached once here 
     //robot_states_[robot_id].path_length = computePathLength(path);
     robot_states_[robot_id].path_length = path_cost;  // this path cost is set by the path planner feedback 
 }
@@ -109,6 +258,7 @@ void TeamModel::setRobotPositionData(const int& robot_id, const Eigen::Vector3d&
     robot_states_[robot_id].position = position; 
     robot_states_[robot_id].bValidPosition = true;
     robot_states_[robot_id].timestampPosition = timestamp;     
+    b_index_dirty_ = true;
 }
 
 double TeamModel::computePathLength(const nav_msgs::Path& path)
@@ -117,9 +267,9 @@ double TeamModel::computePathLength(const nav_msgs::Path& path)
     int input_path_length = path.poses.size();
     for (int ii = 0; ii < (input_path_length - 1); ii++)
     {
-        d_estimated_distance_ += sqrt(pow(path.poses[ii + 1].pose.position.x - path.poses[ii].pose.position.x, 2) +
-                                      pow(path.poses[ii + 1].pose.position.y - path.poses[ii].pose.position.y, 2) +
-                                      pow(path.poses[ii + 1].pose.position.z - path.poses[ii].pose.position.z, 2));
+        const geometry_msgs::Point& p0 = path.poses[ii].pose.position;
+        const geometry_msgs::Point& p1 = path.poses[ii + 1].pose.position;
+        d_estimated_distance_ += Eigen::Vector3d(p1.x - p0.x, p1.y - p0.y, p1.z - p0.z).norm();
     }
     return d_estimated_distance_;
 }
@@ -143,17 +293,50 @@ void TeamModel::CleanExpiredData()
         if(elapsedTime.toSec() > kExpirationTime)
         {
             robot_states_[jj].Reset(); 
+            b_index_dirty_ = true;
         }
         
         ros::Duration elapsedTimePosition = robot_states_[jj].timestampPosition - time;
         if(elapsedTimePosition.toSec() > kExpirationTime)
         {
             robot_states_[jj].bValidPosition = false; 
+            b_index_dirty_ = true;
         }        
     }
 }
 
 
+void TeamModel::updateIndex()
+{
+    boost::recursive_mutex::scoped_lock locker(mutex_);    
+    if(!b_index_dirty_) return; /// < EXIT POINT 
+    
+    index_.clear(conflict_distance_);
+    for(int jj=0; jj< (int)robot_states_.size(); jj++)
+    {
+        if(jj == my_robot_id_) continue; 
+        
+        const RobotPlanningState& state = robot_states_[jj];
+        if(state.path_length > -1)  // not invalid goal 
+        {
+            index_.addPoint(state.goal, jj, TeamConflictIndex::kGoal, state.path_length);
+            
+            const std::vector<geometry_msgs::PoseStamped>& poses = state.path.poses; 
+            for(size_t ii=1; ii < poses.size(); ii++)
+            {
+                const geometry_msgs::Point& p0 = poses[ii-1].pose.position;
+                const geometry_msgs::Point& p1 = poses[ii].pose.position;
+                index_.addSegment(Eigen::Vector3d(p0.x, p0.y, p0.z), Eigen::Vector3d(p1.x, p1.y, p1.z), jj);
+            }
+        }
+        if(state.bValidPosition) // valid position received 
+        {
+            index_.addPoint(state.position, jj, TeamConflictIndex::kPosition);
+        }
+    }
+    b_index_dirty_ = false;
+}
+
 bool TeamModel::IsNodeConflict()
 {
     boost::recursive_mutex::scoped_lock locker(mutex_);    
@@ -171,47 +354,91 @@ bool TeamModel::IsNodeConflict()
     
     conflicting_nodes_.clear();
     
-    for(size_t jj=0; jj< robot_states_.size(); jj++)
-    {    
-        if(jj == my_robot_id_) continue; 
-        
-        std::cout << "TeamModel::IsNodeConflict() - robot " << jj << ": path_length: " << robot_states_[jj].path_length << std::endl;  
-        
-        // check my goal - teammate goal conflict 
-        if(robot_states_[jj].path_length > -1)  // not invalid goal 
-        {        
-            double distance = (my_goal - robot_states_[jj].goal).norm(); 
-            std::cout << "TeamModel::IsNodeConflict() - (my_id, other_id): (" << my_robot_id_ << ", " << jj << ") - goal-goal distance: " << distance << std::endl;        
-            if( 
-                (distance < conflict_distance_) &&
-                (my_path_length > robot_states_[jj].path_length)
-              )
+    updateIndex();
+    index_.query(my_goal, my_goal, conflict_distance_, query_items_);
+    
+    std::vector<bool> path_conflicts(robot_states_.size(), false); // a path conflict is reported once per teammate 
+    for(size_t kk=0; kk < query_items_.size(); kk++)
+    {
+        const TeamConflictIndex::Item& item = *query_items_[kk];
+        switch(item.type)
+        {
+        case TeamConflictIndex::kGoal:
+            // check my goal - teammate goal conflict: the robot with the shorter path keeps the goal 
+            ROS_DEBUG_STREAM("TeamModel::IsNodeConflict() - (my_id, other_id): (" << my_robot_id_ << ", " << item.robot_id << ") - goal-goal distance: " << (my_goal - item.a).norm());
+            if(my_path_length > item.path_length)
             {
-                std::cout << "TeamModel::IsNodeConflict() - conflict detected (my_id, other_id): (" << my_robot_id_ << ", " << jj << ")" << std::endl;       
+                ROS_INFO_STREAM("TeamModel::IsNodeConflict() - goal conflict detected (my_id, other_id): (" << my_robot_id_ << ", " << item.robot_id << ")");
                 res = true;
-                conflicting_nodes_.push_back(robot_states_[jj].goal); 
-                //break; // N.B.: at the present time, we just take the first one and then we break the loop 
+                conflicting_nodes_.push_back(item.a); 
             }
-        }
-        
-        // check my goal - teammate position conflict         
-        if(robot_states_[jj].bValidPosition) // valid position received 
-        {
-            double distance = (my_goal - robot_states_[jj].position).norm(); 
-            std::cout << "TeamModel::IsNodeConflict() - (my_id, other_id): (" << my_robot_id_ << ", " << jj << ") - goal-position distance: " << distance << std::endl;        
-            if(distance < conflict_distance_)
+            break;
+            
+        case TeamConflictIndex::kPosition:
+            // check my goal - teammate position conflict 
+            ROS_DEBUG_STREAM("TeamModel::IsNodeConflict() - (my_id, other_id): (" << my_robot_id_ << ", " << item.robot_id << ") - goal-position distance: " << (my_goal - item.a).norm());
+            ROS_INFO_STREAM("TeamModel::IsNodeConflict() - position conflict detected (my_id, other_id): (" << my_robot_id_ << ", " << item.robot_id << ")");
+            res = true;
+            conflicting_nodes_.push_back(item.a); 
+            break;
+            
+        case TeamConflictIndex::kPathSegment:
+            // check my goal - teammate path conflict: the teammate is going to see my goal on its way, if its path is shorter
+            if(b_check_path_conflicts_ && !path_conflicts[item.robot_id] && (my_path_length > robot_states_[item.robot_id].path_length))
             {
-                std::cout << "TeamModel::IsNodeConflict() - conflict detected (my_id, other_id): (" << my_robot_id_ << ", " << jj << ")" << std::endl;       
+                path_conflicts[item.robot_id] = true;
+                ROS_INFO_STREAM("TeamModel::IsNodeConflict() - path conflict detected (my_id, other_id): (" << my_robot_id_ << ", " << item.robot_id << ")");
                 res = true;
-                conflicting_nodes_.push_back(robot_states_[jj].position); 
-                //break; // N.B.: at the present time, we just take the first one and then we break the loop 
-            }            
+                conflicting_nodes_.push_back(robot_states_[item.robot_id].goal); 
+            }
+            break;
         }
     }
     
     return res; 
 }
 
+bool TeamModel::IsPointConflict(const Eigen::Vector3d& point)
+{
+    boost::recursive_mutex::scoped_lock locker(mutex_);    
+    
+    updateIndex();
+    index_.query(point, point, conflict_distance_, query_items_);
+    for(size_t kk=0; kk < query_items_.size(); kk++)
+    {
+        if( b_check_path_conflicts_ || (query_items_[kk]->type != TeamConflictIndex::kPathSegment) ) 
+        {
+            return true; /// < EXIT POINT 
+        }
+    }
+    return false; 
+}
+
+bool TeamModel::IsPathConflict(const nav_msgs::Path& path)
+{
+    boost::recursive_mutex::scoped_lock locker(mutex_);    
+    
+    updateIndex();
+    const std::vector<geometry_msgs::PoseStamped>& poses = path.poses; 
+    for(size_t ii=0; ii < poses.size(); ii++)
+    {
+        // the first segment starts from the first pose, a path with a single pose is checked as a point 
+        const geometry_msgs::Point& p0 = poses[(ii > 0) ? ii-1 : 0].pose.position;
+        const geometry_msgs::Point& p1 = poses[ii].pose.position;
+        if( (ii == 0) && (poses.size() > 1) ) continue; 
+        
+        index_.query(Eigen::Vector3d(p0.x, p0.y, p0.z), Eigen::Vector3d(p1.x, p1.y, p1.z), conflict_distance_, query_items_);
+        for(size_t kk=0; kk < query_items_.size(); kk++)
+        {
+            if(query_items_[kk]->type == TeamConflictIndex::kPathSegment) 
+            {
+                return true; /// < EXIT POINT 
+            }
+        }
+    }
+    return false; 
+}
+
 
 void TeamModel::setRobotMessage(const exploration_msgs::ExplorationRobotMessage::ConstPtr msg, bool isMsgDirect )
 {
@@ -228,6 +455,7 @@ void TeamModel::setRobotMessage(const exploration_msgs::ExplorationRobotMessage:
     //ros::Time timestamp = ros::Time::now();
     ros::Time timestamp = msg->header.stamp;
     robot_states_[msg->robot_id].timestamp = timestamp;
+    b_index_dirty_ = true;
                 
     switch(msg->action)
     {
@@ -248,6 +476,7 @@ void TeamModel::setRobotMessage(const exploration_msgs::ExplorationRobotMessage:
         robot_states_[msg->robot_id].goal[1] = msg->goal.y;
         robot_states_[msg->robot_id].goal[2] = msg->goal.z;    
         robot_states_[msg->robot_id].path = msg->path;             // path on the exploration tree as computed by the exploration planner  
+        robot_states_[msg->robot_id].path_geometric_length = computePathLength(msg->path); // cached once here 
         robot_states_[msg->robot_id].path_length = msg->path_cost; // navigation path cost as computed by the path planner            
         //robot_states_[msg->robot_id].path_length = computePathLength(msg->path);  
         ROS_INFO_STREAM("TeamModel::setRobotMessage() - path_length: " << robot_states_[msg->robot_id].path_length );
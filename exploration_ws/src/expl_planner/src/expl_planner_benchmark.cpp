@@ -0,0 +1,332 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PCL_NO_PRECOMPILE
+#define PCL_NO_PRECOMPILE
+#endif 
+
+/// < Headless benchmark of the exploration planner on recorded maps (no simulator, no mapping and no TF are needed, just a roscore 
+/// < for the parameters; see launch/expl_planner_benchmark.launch). 
+/// < It loads an octomap (.bt), a traversability and a wall cloud (.pcd) and runs planning iterations of the ExplorationPlanner 
+/// < (search tree RrtTree, FrontierTree and NavigationTree) with a fixed seed. For each iteration it reports the wall time, 
+/// < the time of each phase (see PlanningProfiler), the number of expanded nodes and the number of heap allocations. 
+/// < The results are written as JSON, in order to compare optimizations and catch regressions. 
+
+#include <ros/ros.h>
+
+#include <cstdlib>
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+
+#include <pcl/io/pcd_io.h>
+
+#include "ExplorationPlanner.h"
+#include "PlanningProfiler.h"
+
+using namespace explplanner;
+
+
+/// < heap allocation counters (all the threads of the process)
+
+static std::atomic<size_t> g_num_allocations(0);
+static std::atomic<size_t> g_allocated_bytes(0);
+
+void* operator new(std::size_t size)
+{
+    g_num_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    void* p = std::malloc(size ? size : 1);
+    if(!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+
+/// < PARAMETERS 
+
+template<typename T>
+static T getParam(ros::NodeHandle& n, const std::string& name, const T& defaultValue)
+{
+    T v;
+    if (n.getParam(name, v))
+    {
+        ROS_INFO_STREAM("Found parameter: " << name << ", value: " << v);
+        return v;
+    }
+    else
+    {
+        ROS_WARN_STREAM("Cannot find value for parameter: " << name << ", assigning default: " << defaultValue);
+    }
+    return defaultValue;
+}
+
+struct IterationResult
+{
+    int iteration; 
+    bool success; 
+    std::string step_type; 
+    double wall_time; // [s]
+    PlanningProfiler::Stats phases; 
+    size_t num_expanded_nodes; 
+    size_t num_allocations; 
+    size_t allocated_bytes; 
+    pcl::PointXYZI start; 
+};
+
+static double percentile(std::vector<double> values, double p)
+{
+    if(values.empty()) return 0; /// < EXIT POINT
+    std::sort(values.begin(), values.end());
+    const size_t idx = std::min(values.size()-1, (size_t)(p*(values.size()-1) + 0.5));
+    return values[idx];
+}
+
+static void writeJson(std::ostream& out, const std::string& name, const std::string& octomap_file, const std::string& traversability_file, 
+                      int seed, bool b_advance, const std::vector<IterationResult>& results)
+{
+    out << std::setprecision(9);
+    out << "{" << std::endl;
+    out << "  \"benchmark\": \"" << name << "\"," << std::endl;
+    out << "  \"octomap\": \"" << octomap_file << "\"," << std::endl;
+    out << "  \"traversability\": \"" << traversability_file << "\"," << std::endl;
+    out << "  \"seed\": " << seed << "," << std::endl;
+    out << "  \"advance\": " << (b_advance ? "true" : "false") << "," << std::endl;
+    
+    out << "  \"iterations\": [" << std::endl;
+    for(size_t ii=0; ii < results.size(); ii++)
+    {
+        const IterationResult& r = results[ii];
+        out << "    {\"iteration\": " << r.iteration << ", \"success\": " << (r.success ? "true" : "false") 
+            << ", \"step_type\": \"" << r.step_type << "\""
+            << ", \"start\": [" << r.start.x << ", " << r.start.y << ", " << r.start.z << "]"
+            << ", \"wall_time_ms\": " << 1e3*r.wall_time 
+            << ", \"expanded_nodes\": " << r.num_expanded_nodes 
+            << ", \"allocations\": " << r.num_allocations 
+            << ", \"allocated_bytes\": " << r.allocated_bytes 
+            << ", \"phases_ms\": {";
+        for(int kk=0; kk < PlanningProfiler::kNumPhases; kk++)
+        {
+            out << (kk ? ", " : "") << "\"" << PlanningProfiler::kPhaseNames[kk] << "\": " << 1e3*r.phases.time[kk];
+        }
+        out << "}, \"phase_calls\": {";
+        for(int kk=0; kk < PlanningProfiler::kNumPhases; kk++)
+        {
+            out << (kk ? ", " : "") << "\"" << PlanningProfiler::kPhaseNames[kk] << "\": " << r.phases.calls[kk];
+        }
+        out << "}}" << (ii+1 < results.size() ? "," : "") << std::endl;
+    }
+    out << "  ]," << std::endl;
+    
+    /// < summary 
+    std::vector<double> wall_times; 
+    double total_time = 0; 
+    size_t total_nodes = 0, total_allocations = 0, num_success = 0; 
+    double phase_times[PlanningProfiler::kNumPhases] = {0};
+    for(size_t ii=0; ii < results.size(); ii++)
+    {
+        const IterationResult& r = results[ii];
+        wall_times.push_back(r.wall_time);
+        total_time += r.wall_time;
+        total_nodes += r.num_expanded_nodes;
+        total_allocations += r.num_allocations;
+        if(r.success) num_success++;
+        for(int kk=0; kk < PlanningProfiler::kNumPhases; kk++) phase_times[kk] += r.phases.time[kk];
+    }
+    const double num_iterations = std::max<size_t>(results.size(), 1);
+    
+    out << "  \"summary\": {" << std::endl;
+    out << "    \"iterations\": " << results.size() << ", \"successes\": " << num_success << "," << std::endl;
+    out << "    \"wall_time_ms\": {\"mean\": " << 1e3*total_time/num_iterations << ", \"median\": " << 1e3*percentile(wall_times, 0.5) 
+        << ", \"p95\": " << 1e3*percentile(wall_times, 0.95) << ", \"max\": " << 1e3*percentile(wall_times, 1.) << "}," << std::endl;
+    out << "    \"phases_mean_ms\": {";
+    for(int kk=0; kk < PlanningProfiler::kNumPhases; kk++)
+    {
+        out << (kk ? ", " : "") << "\"" << PlanningProfiler::kPhaseNames[kk] << "\": " << 1e3*phase_times[kk]/num_iterations;
+    }
+    out << "}," << std::endl;
+    out << "    \"iterations_per_s\": " << (total_time > 0 ? results.size()/total_time : 0) 
+        << ", \"expanded_nodes_per_s\": " << (total_time > 0 ? total_nodes/total_time : 0) 
+        << ", \"allocations_per_iteration\": " << total_allocations/num_iterations << std::endl;
+    out << "  }" << std::endl;
+    out << "}" << std::endl;
+}
+
+
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "expl_planner_benchmark");
+
+    ros::NodeHandle nh;
+    ros::NodeHandle nh_private("~");
+    
+    /// < get parameters
+    
+    const std::string octomap_file = getParam<std::string>(nh_private, "octomap", "");  // .bt 
+    const std::string traversability_file = getParam<std::string>(nh_private, "traversability", "");  // .pcd (x,y,z,intensity = traversability cost)
+    const std::string wall_file = getParam<std::string>(nh_private, "wall", "");  // .pcd 
+    const std::string output_file = getParam<std::string>(nh_private, "output", "expl_planner_benchmark.json");  // JSON results (relative to ~/.ros)
+    const std::string name = getParam<std::string>(nh_private, "name", "expl_planner");
+    
+    const int seed = getParam<int>(nh_private, "seed", 0);
+    const int num_iterations = std::max(getParam<int>(nh_private, "iterations", 10), 1);
+    const int num_warmup_iterations = std::max(getParam<int>(nh_private, "warmup_iterations", 1), 0);
+    const bool b_advance = getParam<bool>(nh_private, "advance", true);   // move the robot to the end of each planned path (as the exploration does)
+    const bool b_backtracking = getParam<bool>(nh_private, "backtracking", true);
+    
+    pcl::PointXYZI start; 
+    start.x = getParam<double>(nh_private, "start/x", 0.);
+    start.y = getParam<double>(nh_private, "start/y", 0.);
+    start.z = getParam<double>(nh_private, "start/z", 0.);
+    
+    /// < load the maps 
+    
+    pcl::PointCloud<pcl::PointXYZI>::Ptr traversability_pcl(new pcl::PointCloud<pcl::PointXYZI>());
+    pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr wall_pcl(new pcl::PointCloud<pcl::PointXYZRGBNormal>());
+    if( (pcl::io::loadPCDFile(traversability_file, *traversability_pcl) == -1) || traversability_pcl->empty() )
+    {
+        ROS_ERROR_STREAM("expl_planner_benchmark - cannot load the traversability cloud " << traversability_file);
+        return EXIT_FAILURE; /// < EXIT POINT
+    }
+    if( (pcl::io::loadPCDFile(wall_file, *wall_pcl) == -1) || wall_pcl->empty() )
+    {
+        ROS_ERROR_STREAM("expl_planner_benchmark - cannot load the wall cloud " << wall_file);
+        return EXIT_FAILURE; /// < EXIT POINT
+    }
+    
+    boost::shared_ptr<ExplorationPlanner> p_expl_planner(new ExplorationPlanner(nh, nh_private));
+    if(!p_expl_planner->loadOctomap(octomap_file, Eigen::Affine3d::Identity()))
+    {
+        return EXIT_FAILURE; /// < EXIT POINT
+    }
+    
+    ExplorationPlanner::KdTreeFLANN traversability_kdtree;
+    traversability_kdtree.setInputCloud(traversability_pcl);
+    pp::KdTreeFLANN<pcl::PointXYZRGBNormal> wall_kdtree;
+    wall_kdtree.setInputCloud(wall_pcl);
+    
+    NeighborhoodGraph::Ptr p_graph;
+    if(p_expl_planner->getParams().bUseNeighborhoodGraph_)
+    {
+        p_graph.reset(new NeighborhoodGraph);
+        p_graph->build(*traversability_pcl, traversability_kdtree, ExplorationPlanner::kMaxRobotStep, ExplorationPlanner::kMaxRobotStepDeltaZ, ExplorationPlanner::kMinStepExpansion2);
+    }
+    
+    /// < run 
+    
+    srand(seed);
+    
+    std::vector<IterationResult> results;
+    pcl::PointXYZI robot_position = start; 
+    std::vector<int> pointIdxNKNSearch(1);
+    std::vector<float> pointNKNSquaredDistance(1);
+    
+    for(int iteration = -num_warmup_iterations; (iteration < num_iterations) && ros::ok(); iteration++)
+    {
+        if(traversability_kdtree.nearestKSearch(robot_position, 1, pointIdxNKNSearch, pointNKNSquaredDistance) < 1)
+        {
+            ROS_ERROR("expl_planner_benchmark - cannot find a close starting node");
+            return EXIT_FAILURE; /// < EXIT POINT
+        }
+        
+        IterationResult result; 
+        result.iteration = iteration; 
+        result.start = robot_position; 
+        
+        PlanningProfiler::reset();
+        PlanningProfiler::setEnabled(true);
+        const size_t num_allocations = g_num_allocations.load();
+        const size_t allocated_bytes = g_allocated_bytes.load();
+        const std::chrono::steady_clock::time_point time_start = std::chrono::steady_clock::now();
+        
+        /// < a planning step as ExplorationPlannerManager::doPlanning() on the full map 
+        nav_msgs::Path path;
+        p_expl_planner->setRobotPosition(robot_position.x, robot_position.y, robot_position.z);
+        p_expl_planner->setInput(*traversability_pcl, *wall_pcl, wall_kdtree, traversability_kdtree, pointIdxNKNSearch[0]);
+        if(p_graph) p_expl_planner->setNeighborhoodGraph(p_graph);
+        pcl::PointXYZI bias; 
+        p_expl_planner->setExplorationBias(bias, /*use exploration bias*/false);
+        result.success = p_expl_planner->planning(path, b_backtracking);
+        
+        result.wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - time_start).count();
+        result.num_allocations = g_num_allocations.load() - num_allocations;
+        result.allocated_bytes = g_allocated_bytes.load() - allocated_bytes;
+        PlanningProfiler::setEnabled(false);
+        
+        result.phases = PlanningProfiler::getStats();
+        result.num_expanded_nodes = p_expl_planner->getNumExpandedNodes();
+        result.step_type = ExplorationPlanner::kExplorationStepTypeStrings[p_expl_planner->getExplorationStepType()];
+        
+        if(b_advance && result.success && !path.poses.empty())
+        {
+            p_expl_planner->addSelectedNodeToExplorationTree();
+            
+            const geometry_msgs::Point& goal = path.poses.back().pose.position;
+            robot_position.x = goal.x;
+            robot_position.y = goal.y;
+            robot_position.z = goal.z;
+        }
+        
+        ROS_INFO_STREAM("expl_planner_benchmark - iteration " << iteration << ", success: " << result.success << ", time: " << 1e3*result.wall_time << " ms");
+        if(iteration >= 0) results.push_back(result);
+    }
+    
+    /// < write the results 
+    
+    std::ofstream out(output_file.c_str());
+    if(!out.is_open())
+    {
+        ROS_ERROR_STREAM("expl_planner_benchmark - cannot open " << output_file);
+        return EXIT_FAILURE; /// < EXIT POINT
+    }
+    writeJson(out, name, octomap_file, traversability_file, seed, b_advance, results);
+    ROS_INFO_STREAM("expl_planner_benchmark - results written in " << output_file);
+    
+    return EXIT_SUCCESS;
+}
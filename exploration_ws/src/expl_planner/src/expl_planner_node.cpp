@@ -28,6 +28,7 @@
 #include <signal.h>
 
 #include <limits>
+#include <set>
 
 #include <tf/tf.h>
 #include <tf/transform_listener.h>
@@ -53,8 +54,12 @@
 #include <exploration_msgs/ExplorationPriorityActions.h>
 #include <exploration_msgs/ExplorationRobotMessage.h>
 #include <exploration_msgs/ExplorationPlanningStatus.h>
+#include <exploration_msgs/ExplorationOctomapDelta.h>
+#include <exploration_msgs/ExplorationOctomapDeltaAck.h>
 
 #include <path_planner/Transform.h>
+#include <path_planner/PriorMapClient.h>
+#include <mr3d_profiling/ProfilerExporter.h>
 
 #include "ExplorationMarkerController.h"
 #include "ExplorationPlannerManager.h"
@@ -65,6 +70,7 @@
 
 const double kExplorationTaskCallbackPeriod =  1.0;  // [s] the period of the task callback 
 const double kMapSyncCallbackPeriod =  10.0;  // [s] the period of the task callback 
+const double kMapSyncSendCallbackPeriod =  0.2;  // [s] the period of the callback sending the scheduled missing scans (rate-limited map sync)
 
 const double kSleepTimeAfterRotation = 3.0; // [s] sleep time after rotation towards best informed orientation (this is to give time to the traversability map to update with new perceived information)
 const double kSleepTimeAfterAbort = 1.0; // [s] sleep time after abort
@@ -102,6 +108,11 @@ boost::recursive_mutex map_sync_messages_pub_mutex;
 
 ros::Subscriber other_dynamic_point_cloud_sub[kMaxNumberOfRobots];
 
+bool b_map_sync_octomap_deltas = false; // octree-diff map sync: send the updated octomap leaves instead of the missing scans
+ros::Publisher octomap_delta_pub;
+ros::Publisher octomap_delta_ack_pub;
+std::set<int> octomap_delta_peers; // teammates heard on the map sync topic
+
 ros::Time time_last_path_msg = ros::TIME_MIN;
 
 ros::Time time_backtracking_start = ros::TIME_MIN;
@@ -111,6 +122,7 @@ std::string robot_frame_id;
 
 ros::Timer expl_task_timer;
 ros::Timer map_sync_timer;
+ros::Timer map_sync_send_timer;
     
 boost::recursive_mutex expl_planner_ready_mutex;
 volatile bool bExplPlannerReady = false;  // am I ready to plan a new goal?
@@ -255,6 +267,32 @@ bool checkConnectivityAndPathLengthOnTraversability(const Eigen::Vector3d& goal,
         return checkConflict;
     }
     
+    /// < compute the path lengths toward all the conflicting nodes with a single sweep on the traversability map 
+    pcl::PointXYZI start; 
+    start.x = goal[0]; start.y = goal[1]; start.z = goal[2];
+    std::vector<pcl::PointXYZI> goals(conflictingNodes.size());
+    for(size_t ii=0; ii<conflictingNodes.size(); ii++)
+    {
+        goals[ii].x = conflictingNodes[ii][0]; goals[ii].y = conflictingNodes[ii][1]; goals[ii].z = conflictingNodes[ii][2];
+    }
+    std::vector<double> pathCosts; 
+    if(p_expl_planner_manager->computePathCosts(start, goals, pathCosts, maxPathLength))
+    {
+        for(size_t ii=0; ii<pathCosts.size(); ii++)
+        {
+            // pathCosts[ii] < 0 if the nodes cannot be connected within maxPathLength 
+            if( (pathCosts[ii] >= 0) && (pathCosts[ii] < maxPathLength) )
+            {
+                std::cout << "checkConnectivityAndPathLength() - goals can be connected with a path cost " << pathCosts[ii] << std::endl;
+                checkConflict = true; 
+                break; 
+            }
+        }
+        return checkConflict; /// < EXIT POINT 
+    }
+    
+    /// < fallback: call the path planner service for each conflicting node 
+    
     if (!path_planner_service_client.waitForExistence(ros::Duration(5.0)))  
     {
         ROS_ERROR("checkConnectivityAndPathLength() - path planning service is not UP!");       
@@ -1001,6 +1039,19 @@ void mapSyncTimerCallback(const ros::TimerEvent& timer_msg)
     geometry_msgs::PoseArray mapSyncMessage; 
     p_expl_planner_manager->getMapSyncMessage(mapSyncMessage);
     map_sync_pub.publish(mapSyncMessage);
+
+    if(b_map_sync_octomap_deltas)
+    {
+        boost::recursive_mutex::scoped_lock locker(map_sync_messages_pub_mutex); 
+        for(std::set<int>::const_iterator it=octomap_delta_peers.begin(); it != octomap_delta_peers.end(); ++it)
+        {
+            exploration_msgs::ExplorationOctomapDelta deltaMessage; 
+            p_expl_planner_manager->getOctomapDeltaMessage(*it, deltaMessage);
+            if(deltaMessage.log_odds.empty() && !deltaMessage.full) continue; // nothing changed since the last acknowledged version
+            octomap_delta_pub.publish(deltaMessage);
+            ROS_INFO_STREAM("mapSyncTimerCallback() - sent " <<  deltaMessage.log_odds.size() << " octomap leaves to robot " <<  *it);
+        }
+    }
 }
 
 void mapSyncRecCallback(const geometry_msgs::PoseArray::ConstPtr msg)
@@ -1017,7 +1068,14 @@ void mapSyncRecCallback(const geometry_msgs::PoseArray::ConstPtr msg)
     if(fromRobotId == robot_id)  return; 
     std::cout << "mapSyncRecCallback() - robot id: " <<  robot_id << " received message from robot " <<  fromRobotId << std::endl;    
 
-    std::vector<sensor_msgs::PointCloud2::Ptr> cloudsToSend;
+    if(b_map_sync_octomap_deltas)
+    {
+        // the teammate gets the octomap deltas from mapSyncTimerCallback()
+        octomap_delta_peers.insert(fromRobotId);
+        return; 
+    }
+
+    std::vector<sensor_msgs::PointCloud2::ConstPtr> cloudsToSend;
     p_expl_planner_manager->mapMessageOverlapCheck(*msg, cloudsToSend);
     if(!cloudsToSend.empty())
     {
@@ -1033,6 +1091,45 @@ void mapSyncRecCallback(const geometry_msgs::PoseArray::ConstPtr msg)
     }
 }
 
+void mapSyncSendTimerCallback(const ros::TimerEvent& timer_msg)
+{
+    boost::recursive_mutex::scoped_lock locker(map_sync_messages_pub_mutex); 
+
+    // send the scheduled missing scans which fit the map sync budget (nothing is scheduled if the map sync is not rate-limited)
+    std::vector<std::pair<int, sensor_msgs::PointCloud2::ConstPtr> > cloudsToSend;
+    p_expl_planner_manager->getScheduledMapSyncClouds(cloudsToSend);
+    for(size_t ii=0, iiEnd=cloudsToSend.size(); ii < iiEnd; ii++)
+    {
+        const int toRobotId = cloudsToSend[ii].first;
+        if(toRobotId < 0 || toRobotId > (kMaxNumberOfRobots-1) || toRobotId == robot_id) continue; 
+        missing_point_cloud_pub[toRobotId].publish(cloudsToSend[ii].second);
+    }
+    if(!cloudsToSend.empty()) ROS_INFO_STREAM("mapSyncSendTimerCallback() - sent " <<  cloudsToSend.size() << " scheduled pointclouds");
+}
+
+void octomapDeltaCallback(const exploration_msgs::ExplorationOctomapDelta::ConstPtr msg)
+{
+    if( (msg->to_robot_id != robot_id) || (msg->robot_id == robot_id) ) return; 
+
+    if(!p_expl_planner_manager->insertOctomapDeltaMessage(*msg)) return; 
+    ROS_INFO_STREAM("octomapDeltaCallback() - merged " <<  msg->log_odds.size() << " octomap leaves from robot " <<  (int)msg->robot_id);
+
+    exploration_msgs::ExplorationOctomapDeltaAck ack; 
+    ack.header.stamp = ros::Time::now();
+    ack.robot_id = robot_id;
+    ack.to_robot_id = msg->robot_id;
+    ack.version = msg->to_version;
+    octomap_delta_ack_pub.publish(ack);
+}
+
+void octomapDeltaAckCallback(const exploration_msgs::ExplorationOctomapDeltaAck::ConstPtr msg)
+{
+    if( (msg->to_robot_id != robot_id) || (msg->robot_id == robot_id) ) return; 
+
+    boost::recursive_mutex::scoped_lock locker(map_sync_messages_pub_mutex); 
+    p_expl_planner_manager->setOctomapDeltaAck(msg->robot_id, msg->version);
+}
+
 void mySigintHandler(int signum)
 {
     std::cout << "mySigintHandler()" << std::endl;
@@ -1073,6 +1170,17 @@ int main(int argc, char **argv)
     std::string int_marker_name = getParam<std::string>(nh_private, "int_marker_name", "expl_marker");
     
     bool b_use_marker_controller = getParam<bool>(nh_private, "use_marker_controller", true);
+    
+    /// < a non-negative seed makes the sampling of the planner reproducible (deterministic replays); each robot gets its own sequence
+    const int random_seed = getParam<int>(nh_private, "random_seed", -1);
+    if (random_seed >= 0) srand(random_seed + robot_id);
+    
+    const int num_spinner_threads = getParam<int>(nh_private, "num_spinner_threads", 2); // 1: callbacks in arrival order
+    
+    if (getParam<bool>(nh_private, "enable_profiler", false))
+    {
+        mr3d_profiling::ProfilerExporter::instance().start(nh_private, getParam<std::string>(nh_private, "profiler_stats_file", std::string()));
+    }
 
     int cost_function_type = getParam<int>(nh_private, "cost_function_type", (int)BaseCostFunction::kSimpleCost);
     double lambda_trav                  = getParam<double>(nh_private, "lambda_trav", 1.);
@@ -1093,6 +1201,8 @@ int main(int argc, char **argv)
     //std::string other_robot_dynamic_point_cloud_base_topic = getParam<std::string>(nh_private, "other_robot_dynamic_point_cloud_base_topic", "dynamic_point_cloud");
     std::string other_robot_dynamic_point_cloud_base_topic = getParam<std::string>(nh_private, "other_robot_dynamic_point_cloud_base_topic", "filtered_pointcloud");
 
+    b_map_sync_octomap_deltas = getParam<bool>(nh_private, "map_sync_octomap_deltas", false);
+
     std::cout << "got parameters" << std::endl;
 
     /// ========================================================================
@@ -1150,6 +1260,12 @@ int main(int argc, char **argv)
             missing_point_cloud_pub[id] = nh.advertise<sensor_msgs::PointCloud2>(missing_scan_topic_name.str(),1);
         }
     }
+
+    if(b_map_sync_octomap_deltas)
+    {
+        octomap_delta_pub = nh.advertise<exploration_msgs::ExplorationOctomapDelta>("/map_sync_octomap_deltas", 10);
+        octomap_delta_ack_pub = nh.advertise<exploration_msgs::ExplorationOctomapDeltaAck>("/map_sync_octomap_delta_acks", 10);
+    }
 #endif 
 
     /// < Subscribers
@@ -1157,6 +1273,22 @@ int main(int argc, char **argv)
     ros::Subscriber sub_trav = nh.subscribe("/trav/traversability", 1, traversabilityCloudCallback);
     ros::Subscriber sub_wall = nh.subscribe("/clustered_pcl/wall", 1, wallCloudCallback);
 
+    /// < boot from the prior map (if any): the wall and traversability layers are used until the mapping pipeline publishes its clouds 
+    const std::string prior_map_service = getParam<std::string>(nh_private, "prior_map_service", std::string());
+    if (!prior_map_service.empty())
+    {
+        PriorMapClient prior_map_client(nh, prior_map_service);
+        sensor_msgs::PointCloud2 prior_map_msg;
+        if (prior_map_client.getLayer("wall", prior_map_msg))
+        {
+            wallCloudCallback(prior_map_msg);
+        }
+        if (prior_map_client.getLayer("traversability", prior_map_msg))
+        {
+            traversabilityCloudCallback(prior_map_msg);
+        }
+    }
+
     //ros::Subscriber sub_goal = n.subscribe("/goal_topic", 1, goalSelectionCallback);
     ros::Subscriber sub_expl_pause = nh.subscribe("/expl_pause_topic", 1, explPauseCallback);
 
@@ -1180,6 +1312,13 @@ int main(int argc, char **argv)
     std::stringstream my_missing_scan_topic_name; 
     my_missing_scan_topic_name << "/" << str_robot_prefix << robot_id+1 << "/" << my_missing_scan_topic_suffix;
     ros::Subscriber my_missing_scans_sub = nh.subscribe(my_missing_scan_topic_name.str(), 20, missingPointCloudCallback); 
+
+    ros::Subscriber octomap_delta_sub, octomap_delta_ack_sub; 
+    if(b_map_sync_octomap_deltas)
+    {
+        octomap_delta_sub = nh.subscribe("/map_sync_octomap_deltas", 10, octomapDeltaCallback);
+        octomap_delta_ack_sub = nh.subscribe("/map_sync_octomap_delta_acks", 20, octomapDeltaAckCallback);
+    }
 #endif 
 
     for(size_t id=0; id < kMaxNumberOfRobots; id++)
@@ -1216,6 +1355,7 @@ int main(int argc, char **argv)
 
 #if USE_MAP_SYNC   
     map_sync_timer = nh.createTimer(ros::Duration(kMapSyncCallbackPeriod), mapSyncTimerCallback); // the timer will automatically fire at startup
+    map_sync_send_timer = nh.createTimer(ros::Duration(kMapSyncSendCallbackPeriod), mapSyncSendTimerCallback); 
 #endif 
 
     /// < Start
@@ -1230,7 +1370,7 @@ int main(int argc, char **argv)
 #if 0    
     ros::spin();
 #else
-    ros::MultiThreadedSpinner spinner(2); // Use 2-4 threads
+    ros::MultiThreadedSpinner spinner(num_spinner_threads); // Use 2-4 threads
     spinner.spin(); // spin() will not return until the node has been shutdown
 #endif 
     
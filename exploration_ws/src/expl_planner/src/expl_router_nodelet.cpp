@@ -0,0 +1,59 @@
+/**
+* This file is part of the ROS package trajectory_control which belongs to the framework 3DMR. 
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PCL_NO_PRECOMPILE
+#define PCL_NO_PRECOMPILE
+#endif 
+
+#include <boost/shared_ptr.hpp>
+
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+
+#include "ExplorationCloudRouter.h"
+
+namespace explplanner
+{
+
+///	\class ExplorationRouterNodelet
+///	\author Luigi Freda
+///	\brief Nodelet version of expl_router_node: loaded in the manager of the volumetric mapping, the routed clouds 
+///        are passed by pointer (no serialization, no copy when downsampling is off). 
+///	\note
+/// \todo
+///	\date
+///	\warning
+class ExplorationRouterNodelet : public nodelet::Nodelet
+{
+public:
+    ExplorationRouterNodelet() {}
+
+private:
+    virtual void onInit()
+    {
+        router_.reset(new ExplorationCloudRouter(getNodeHandle(), getPrivateNodeHandle()));
+    }
+
+    boost::shared_ptr<ExplorationCloudRouter> router_;
+};
+
+} // namespace explplanner
+
+PLUGINLIB_EXPORT_CLASS(explplanner::ExplorationRouterNodelet, nodelet::Nodelet)
@@ -59,7 +59,8 @@
 
 #include <Eigen/Dense>
 
-enum class PreFilterType {kNone, kDeterministicFilter, kStatisticFilter}; 
+// kSphericalGridFilter: outliers are rejected with the neighbor buckets of the spherical grid (see SphericalTransform::sphericalCloudGridFiltered()) 
+enum class PreFilterType {kNone, kDeterministicFilter, kStatisticFilter, kSphericalGridFilter}; 
 
 template<typename PointOut>
 class ExplPclFilter
@@ -90,6 +91,10 @@ private:
     //! prefilter type  		
 	PreFilterType prefilter_type;
 
+    //! min number of supporting neighbor buckets and support radius of the spherical grid filter
+    int grid_filter_min_neighbors;
+    double grid_filter_radius;
+
     //! Subscriber to input scans (default topic: "/scan_point_cloud")
     ros::Subscriber point_cloud_sub;	
 
@@ -98,6 +103,9 @@ private:
 
     SphericalTransform spherical_transform;
 
+    //! output cloud, preallocated with a point per bucket
+    PointCloud_Out pcl_out;
+
 public:
 	explicit ExplPclFilter(const PreFilterType& type=PreFilterType::kNone);
 	~ExplPclFilter();
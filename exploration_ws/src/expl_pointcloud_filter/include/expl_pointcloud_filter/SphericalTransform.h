@@ -27,8 +27,14 @@
 #include <pcl/point_types.h>
 #include <pcl_ros/transforms.h>
 
+#include <sensor_msgs/PointCloud2.h>
+
 #include <boost/make_shared.hpp>
 
+#include <vector>
+#include <limits>
+#include <cstring>
+
 #ifndef M_2PI
 #define M_2PI (2 * M_PI)
 #endif
@@ -48,6 +54,20 @@ public:
 
 		resPhi = rangePhi/static_cast<double>(subdivisionsPhi);
 		resTheta = rangeTheta/static_cast<double>(subdivisionsTheta);
+
+		// cache the max reading vectors of the buckets (the offset is added by initCloud())
+		maxReadingVectors.resize(subdivisionsPhi*subdivisionsTheta);
+		for(size_t bucketPhi = 0; bucketPhi < subdivisionsPhi; bucketPhi++)
+		{
+			for(size_t bucketTheta = 0; bucketTheta < subdivisionsTheta; bucketTheta++)
+			{
+				double phi, theta;
+				bucketToAngle(bucketPhi, bucketTheta, phi, theta);
+				maxReadingVectors[flatBucket(bucketPhi, bucketTheta)] = Eigen::Vector3d(maxReading * sin(theta) * cos(phi),
+				                                                                        maxReading * sin(theta) * sin(phi),
+				                                                                        maxReading * cos(theta));
+			}
+		}
 	}
 
 	void setMinMaxThetas(const double minThetaIn, const double maxThetaIn)
@@ -102,35 +122,23 @@ public:
 	{
 		// init the output pointcloud with max readings 
 		pcl_out.resize(subdivisionsPhi*subdivisionsTheta);
-		for(size_t bucketPhi = 0; bucketPhi < subdivisionsPhi; bucketPhi++)
+		for(size_t bucket = 0; bucket < maxReadingVectors.size(); bucket++)
 		{
-			for(size_t bucketTheta = 0; bucketTheta < subdivisionsTheta; bucketTheta++)
-			{
-				size_t bucket = flatBucket(bucketPhi, bucketTheta);
-
-				double phi, theta, x,y,z;
-				bucketToAngle(bucketPhi, bucketTheta, phi, theta);
-				coordsSphericalToEuclidean(maxReading, phi, theta, x, y, z);
-				pcl_out[bucket].x = x;
-				pcl_out[bucket].y = y;
-				pcl_out[bucket].z = z;			
-			}
+			const Eigen::Vector3d& v = maxReadingVectors[bucket];
+			pcl_out[bucket].x = offsetX + v.x();
+			pcl_out[bucket].y = offsetY + v.y();
+			pcl_out[bucket].z = offsetZ + v.z();
 		}	
 	}
 
-	template<typename PointT>
-	void sphericalCloud(const pcl::PCLPointCloud2& input, pcl::PointCloud<PointT>& output) const 
+	// get the offsets of the x, y, z fields of a PCLPointCloud2 or a sensor_msgs::PointCloud2
+	template<typename Cloud>
+	static void getXYZOffsets(const Cloud& input, unsigned int& pt_x_offset, unsigned int& pt_y_offset, unsigned int& pt_z_offset)
 	{
-		ROS_ASSERT_MSG(output.size()==subdivisionsPhi*subdivisionsTheta, "Output cloud has not been initialized!"); 
-
-		//ROS_INFO_STREAM("input cloud: " << input.height << "x " << input.width);
-
-		// getting information to parse the point cloud
-		const unsigned int pt_step = input.point_step; // size of the point structure
-		// offsets of the relevent fields (init values)
-		unsigned int pt_x_offset   = 0;
-		unsigned int pt_y_offset   = 4;
-		unsigned int pt_z_offset   = 8;
+		// init values 
+		pt_x_offset   = 0;
+		pt_y_offset   = 4;
+		pt_z_offset   = 8;
 
 		for (unsigned int j = 0; j < input.fields.size(); j++)
 		{
@@ -147,6 +155,18 @@ public:
 				pt_z_offset = input.fields[j].offset;
 			}
 		}
+	}
+
+	template<typename PointT>
+	void sphericalCloud(const pcl::PCLPointCloud2& input, pcl::PointCloud<PointT>& output) const 
+	{
+		ROS_ASSERT_MSG(output.size()==subdivisionsPhi*subdivisionsTheta, "Output cloud has not been initialized!"); 
+
+		//ROS_INFO_STREAM("input cloud: " << input.height << "x " << input.width);
+
+		// getting information to parse the point cloud: offsets of the relevent fields
+		unsigned int pt_x_offset, pt_y_offset, pt_z_offset;
+		getXYZOffsets(input, pt_x_offset, pt_y_offset, pt_z_offset);
 
 		// traverse point cloud
 		for (size_t j = 0; j < input.height; j++)
@@ -194,6 +214,89 @@ public:
 		}
 	} 
 
+	// Single pass alternative to the kd-tree outlier filters followed by sphericalCloud(): the points are read 
+	// directly from the ROS message and binned into the (phi, theta) grid keeping the closest point of each bucket, 
+	// then the point of a bucket is kept only if at least minNeighbors of the 8 neighbor buckets (azimuth wraps 
+	// around) have their point within radius + range * bucket angular size (the distance between adjacent buckets 
+	// grows with the range). Rejected buckets keep the max reading of initCloud(). 
+	template<typename PointT>
+	void sphericalCloudGridFiltered(const sensor_msgs::PointCloud2& input, const int minNeighbors, const double radius, pcl::PointCloud<PointT>& output)
+	{
+		ROS_ASSERT_MSG(output.size()==subdivisionsPhi*subdivisionsTheta, "Output cloud has not been initialized!"); 
+
+		const size_t numBuckets = subdivisionsPhi*subdivisionsTheta;
+		bucketRanges.assign(numBuckets, std::numeric_limits<float>::infinity());
+		bucketPoints.resize(numBuckets);
+
+		unsigned int pt_x_offset, pt_y_offset, pt_z_offset;
+		getXYZOffsets(input, pt_x_offset, pt_y_offset, pt_z_offset);
+
+		// binning 
+		for (size_t j = 0; j < input.height; j++)
+		{
+			const uint8_t* row = input.data.data() + j * input.row_step;
+			for (size_t i = 0; i < input.width; i++)
+			{
+				const uint8_t* pt = row + i * input.point_step;
+				float x, y, z; 
+				memcpy(&x, pt + pt_x_offset, sizeof(float));
+				memcpy(&y, pt + pt_y_offset, sizeof(float));
+				memcpy(&z, pt + pt_z_offset, sizeof(float));
+				if(!std::isfinite(x) || !std::isfinite(y) || !std::isfinite(z)) continue; 
+
+				double r, theta, phi;
+				coordsEuclideanToSpherical(x, y, z, r, phi, theta);
+				if(!(r < maxReading)) continue; // the bucket already has the max reading (as in sphericalCloud())
+
+				size_t bucketPhi = 0, bucketTheta = 0;
+				angleToBucket(phi, theta, bucketPhi, bucketTheta);
+				if(bucketPhi>=subdivisionsPhi || bucketTheta>=subdivisionsTheta) continue; 
+				const size_t bucket = flatBucket(bucketPhi, bucketTheta);
+
+				if(r < bucketRanges[bucket])
+				{
+					bucketRanges[bucket] = r;
+					bucketPoints[bucket] = Eigen::Vector3f(x, y, z);
+				}
+			}
+		}
+
+		// outlier rejection with the neighbor buckets 
+		const double bucketAngle = sqrt(resPhi*resPhi + resTheta*resTheta); 
+		for(size_t bucketPhi = 0; bucketPhi < subdivisionsPhi; bucketPhi++)
+		{
+			for(size_t bucketTheta = 0; bucketTheta < subdivisionsTheta; bucketTheta++)
+			{
+				const size_t bucket = flatBucket(bucketPhi, bucketTheta);
+				const float r = bucketRanges[bucket];
+				if(r == std::numeric_limits<float>::infinity()) continue; 
+
+				const Eigen::Vector3f& p = bucketPoints[bucket];
+				const float maxDist = radius + r * bucketAngle; 
+				const float maxDist2 = maxDist * maxDist; 
+				int numNeighbors = 0; 
+				for(int dPhi = -1; dPhi <= 1 && numNeighbors < minNeighbors; dPhi++)
+				{
+					const size_t neighborPhi = (bucketPhi + subdivisionsPhi + dPhi) % subdivisionsPhi; 
+					for(int dTheta = -1; dTheta <= 1; dTheta++)
+					{
+						const size_t neighborTheta = bucketTheta + dTheta; // wraps to a large value below 0 
+						if((dPhi == 0 && dTheta == 0) || neighborTheta >= subdivisionsTheta) continue; 
+						const size_t neighbor = flatBucket(neighborPhi, neighborTheta);
+						if(bucketRanges[neighbor] == std::numeric_limits<float>::infinity()) continue; 
+						if((bucketPoints[neighbor] - p).squaredNorm() < maxDist2) numNeighbors++; 
+					}
+				}
+				if(numNeighbors < minNeighbors) continue; 
+
+				PointT& po = output[bucket]; 
+				po.x = p.x(); 
+				po.y = p.y(); 
+				po.z = p.z(); 
+			}
+		}
+	}
+
 	size_t subdivisionsPhi = 180;
 	size_t subdivisionsTheta = 90;
 
@@ -213,4 +316,10 @@ public:
 	double rangeTheta = M_PI; 
 
 	double maxReading = 1000.0;
+
+	std::vector<Eigen::Vector3d> maxReadingVectors; // max reading vector of each bucket 
+
+	// working buffers of sphericalCloudGridFiltered() 
+	std::vector<float> bucketRanges; 
+	std::vector<Eigen::Vector3f> bucketPoints; 
 };
@@ -51,6 +51,11 @@ ExplPclFilter<PointOut>::ExplPclFilter(const PreFilterType& type):n_("~"), prefi
     const int num_subdivisions_phi = getParam<int>(n_, "num_subdivisions_phi", num_subdivisions_phi);    
     const int num_subdivisions_theta = getParam<int>(n_, "num_subdivisions_theta", num_subdivisions_theta);    	
 
+    // prefilter: 0 none, 1 radius outlier removal, 2 statistic outlier removal, 3 spherical grid filter 
+    prefilter_type = static_cast<PreFilterType>(getParam<int>(n_, "prefilter_type", static_cast<int>(prefilter_type)));
+    grid_filter_min_neighbors = getParam<int>(n_, "grid_filter_min_neighbors", 2);
+    grid_filter_radius = getParam<double>(n_, "grid_filter_radius", 0.5);
+
     // laser scan subscriber
     point_cloud_sub = n.subscribe("point_cloud", 1, &ExplPclFilter::point_cloud_cb, this);	
 
@@ -98,34 +103,41 @@ void ExplPclFilter<PointOut>::point_cloud_cb(const sensor_msgs::PointCloud2& clo
 	spherical_transform.offsetY = laser_center.y;
 	spherical_transform.offsetZ = laser_center.z;		
 
-	pcl::PCLPointCloud2::Ptr cloud_filtered (new pcl::PCLPointCloud2());
-
-	const int mean_k = 9;
-    const double stddev_mul_thresh = 3.0;
-	const int min_neighbors = 8;
-	const double radius_search = 0.5;
+	// init the output pointcloud with max readings 
+	spherical_transform.initCloud(pcl_out);
 
-	// remove outliers from scan
-	if(prefilter_type == PreFilterType::kStatisticFilter)
-	{
- 		statisticOutliersFilterPcl(mean_k,stddev_mul_thresh, cloud, cloud_filtered);
-	}
-	else if(prefilter_type == PreFilterType::kDeterministicFilter)
+	if(prefilter_type == PreFilterType::kSphericalGridFilter)
 	{
-		radiusOutliersFilterPcl(min_neighbors, radius_search, cloud, cloud_filtered);
+		// binning and outlier rejection in a single pass over the input cloud (no conversion, no kd-tree)
+		spherical_transform.sphericalCloudGridFiltered(cloud, grid_filter_min_neighbors, grid_filter_radius, pcl_out);
 	}
 	else 
 	{
-		pcl_conversions::toPCL(cloud, *cloud_filtered);
+		pcl::PCLPointCloud2::Ptr cloud_filtered (new pcl::PCLPointCloud2());
+
+		const int mean_k = 9;
+		const double stddev_mul_thresh = 3.0;
+		const int min_neighbors = 8;
+		const double radius_search = 0.5;
+
+		// remove outliers from scan
+		if(prefilter_type == PreFilterType::kStatisticFilter)
+		{
+			statisticOutliersFilterPcl(mean_k,stddev_mul_thresh, cloud, cloud_filtered);
+		}
+		else if(prefilter_type == PreFilterType::kDeterministicFilter)
+		{
+			radiusOutliersFilterPcl(min_neighbors, radius_search, cloud, cloud_filtered);
+		}
+		else 
+		{
+			pcl_conversions::toPCL(cloud, *cloud_filtered);
+		}
+
+		// create a spherical laser scan according to phi, theta
+		spherical_transform.sphericalCloud(*cloud_filtered, pcl_out);
 	}
 
-	// init the output pointcloud with max readings 
-	PointCloud_Out pcl_out;
-	spherical_transform.initCloud(pcl_out);
-
-	// create a spherical laser scan according to phi, theta
-	spherical_transform.sphericalCloud(*cloud_filtered, pcl_out);
-
     sensor_msgs::PointCloud2 expl_point_cloud;	
 	pcl::toROSMsg(pcl_out, expl_point_cloud);
 	expl_point_cloud.header = cloud.header; 	
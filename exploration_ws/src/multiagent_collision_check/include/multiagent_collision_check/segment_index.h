@@ -0,0 +1,97 @@
+/*
+ * Copyright 2015 Andreas Bircher, ASL, ETH Zurich, Switzerland
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _MULTIAGENT_SEGMENT_INDEX_H_
+#define _MULTIAGENT_SEGMENT_INDEX_H_
+
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+
+#include <eigen3/Eigen/Dense>
+#include <eigen3/Eigen/StdVector>
+
+namespace multiagent {
+
+// Uniform-grid index of the path segments of the agents: each segment is
+// stored in the cells it traverses, hence a collision query only tests the
+// segments in the cells overlapped by the query segment inflated by the
+// collision distance. The path of an agent is replaced (its cells only)
+// whenever a new path of the agent arrives.
+// Not thread-safe: the paths must not be changed during a query.
+class SegmentIndex
+{
+ public:
+  typedef std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> > Path;
+
+  static const double kDefaultCellSize;  // [m]
+
+  explicit SegmentIndex(double cell_size = kDefaultCellSize);
+
+  // Change the cell size (the paths are re-indexed); ignored if <= 0.
+  void setCellSize(double cell_size);
+  double getCellSize() const { return cell_size_; }
+
+  // Replace the path of the agent (agent ids are small indices).
+  void setAgentPath(size_t agent, const Path& path);
+  void clearAgent(size_t agent);
+  void clear();
+
+  // Same as multiagent::isInCollision(): true if a segment of a path is closer
+  // than boundingBox.norm() to the segment [start, end].
+  bool isInCollision(const Eigen::Vector3d& start, const Eigen::Vector3d& end,
+                     const Eigen::Vector3d& boundingBox) const;
+  bool isInCollision(const Eigen::Vector4d& start, const Eigen::Vector4d& end,
+                     const Eigen::Vector3d& boundingBox) const
+  {
+    return isInCollision(Eigen::Vector3d(start.x(), start.y(), start.z()),
+                         Eigen::Vector3d(end.x(), end.y(), end.z()), boundingBox);
+  }
+  bool isInCollision(const Eigen::Vector4d& state, const Eigen::Vector3d& boundingBox) const
+  {
+    return isInCollision(state, state, boundingBox);
+  }
+
+  size_t getNumSegments() const { return num_segments_; }
+
+ private:
+  struct SegmentRef
+  {
+    uint32_t agent;
+    uint32_t index;  // the segment is [path[index - 1], path[index]]
+  };
+  typedef std::unordered_map<uint64_t, std::vector<SegmentRef> > CellMap;
+
+  void insertAgent(size_t agent);
+  void removeAgent(size_t agent);
+
+  // Cells traversed by the segment (3D DDA).
+  void getSegmentCells(const Eigen::Vector3d& start, const Eigen::Vector3d& end,
+                       std::vector<uint64_t>* keys) const;
+
+  int64_t getCellCoord(double x) const;
+  static uint64_t getCellKey(int64_t cx, int64_t cy, int64_t cz);
+
+  double cell_size_;
+  std::vector<Path> paths_;
+  std::vector<std::vector<uint64_t> > agent_cells_;  // cells of the segments of each agent
+  CellMap cells_;
+  size_t num_segments_;
+};
+
+}
+
+#endif // _MULTIAGENT_SEGMENT_INDEX_H_
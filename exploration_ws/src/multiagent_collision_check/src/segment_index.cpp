@@ -0,0 +1,223 @@
+/*
+ * Copyright 2015 Andreas Bircher, ASL, ETH Zurich, Switzerland
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <multiagent_collision_check/segment_index.h>
+#include <multiagent_collision_check/multiagent_collision_checker.h>
+
+const double multiagent::SegmentIndex::kDefaultCellSize = 2.0;
+
+multiagent::SegmentIndex::SegmentIndex(double cell_size)
+    : cell_size_(cell_size > 0 ? cell_size : kDefaultCellSize),
+      num_segments_(0)
+{
+}
+
+void multiagent::SegmentIndex::setCellSize(double cell_size)
+{
+  if (cell_size <= 0 || cell_size == cell_size_) {
+    return;
+  }
+  cell_size_ = cell_size;
+  cells_.clear();
+  num_segments_ = 0;
+  for (size_t agent = 0; agent < paths_.size(); agent++) {
+    agent_cells_[agent].clear();
+    insertAgent(agent);
+  }
+}
+
+void multiagent::SegmentIndex::setAgentPath(size_t agent, const Path& path)
+{
+  if (agent >= paths_.size()) {
+    paths_.resize(agent + 1);
+    agent_cells_.resize(agent + 1);
+  }
+  removeAgent(agent);
+  paths_[agent] = path;
+  insertAgent(agent);
+}
+
+void multiagent::SegmentIndex::clearAgent(size_t agent)
+{
+  if (agent < paths_.size()) {
+    removeAgent(agent);
+  }
+}
+
+void multiagent::SegmentIndex::clear()
+{
+  paths_.clear();
+  agent_cells_.clear();
+  cells_.clear();
+  num_segments_ = 0;
+}
+
+bool multiagent::SegmentIndex::isInCollision(const Eigen::Vector3d& start, const Eigen::Vector3d& end,
+                                             const Eigen::Vector3d& boundingBox) const
+{
+  if (num_segments_ == 0) {
+    return false;
+  }
+  // A segment closer than the distance has a point (and then a traversed cell)
+  // in the bounding box of [start, end] inflated by the distance.
+  const double distance = boundingBox.norm();
+  const Eigen::Vector3d lower = start.cwiseMin(end) - Eigen::Vector3d::Constant(distance);
+  const Eigen::Vector3d upper = start.cwiseMax(end) + Eigen::Vector3d::Constant(distance);
+  const int64_t min_x = getCellCoord(lower.x()), max_x = getCellCoord(upper.x());
+  const int64_t min_y = getCellCoord(lower.y()), max_y = getCellCoord(upper.y());
+  const int64_t min_z = getCellCoord(lower.z()), max_z = getCellCoord(upper.z());
+
+  // Gather the candidate segments once (a segment can lie in many cells).
+  std::vector<uint64_t> candidates;
+  const double num_query_cells = (double) (max_x - min_x + 1) * (max_y - min_y + 1) * (max_z - min_z + 1);
+  if (num_query_cells > cells_.size()) {
+    for (CellMap::const_iterator it = cells_.begin(); it != cells_.end(); ++it) {
+      for (size_t i = 0; i < it->second.size(); i++) {
+        candidates.push_back(((uint64_t) it->second[i].agent << 32) | it->second[i].index);
+      }
+    }
+  } else {
+    for (int64_t cx = min_x; cx <= max_x; cx++) {
+      for (int64_t cy = min_y; cy <= max_y; cy++) {
+        for (int64_t cz = min_z; cz <= max_z; cz++) {
+          CellMap::const_iterator it = cells_.find(getCellKey(cx, cy, cz));
+          if (it == cells_.end()) {
+            continue;
+          }
+          for (size_t i = 0; i < it->second.size(); i++) {
+            candidates.push_back(((uint64_t) it->second[i].agent << 32) | it->second[i].index);
+          }
+        }
+      }
+    }
+  }
+  std::sort(candidates.begin(), candidates.end());
+  candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+  for (size_t i = 0; i < candidates.size(); i++) {
+    const Path& path = paths_[candidates[i] >> 32];
+    const uint32_t index = (uint32_t) candidates[i];
+    if (distance > closestDistanceBetweenLines(start, end, path[index - 1], path[index])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void multiagent::SegmentIndex::insertAgent(size_t agent)
+{
+  const Path& path = paths_[agent];
+  std::vector<uint64_t>& agent_cells = agent_cells_[agent];
+  std::vector<uint64_t> keys;
+  for (size_t index = 1; index < path.size(); index++) {
+    getSegmentCells(path[index - 1], path[index], &keys);
+    SegmentRef ref;
+    ref.agent = agent;
+    ref.index = index;
+    for (size_t k = 0; k < keys.size(); k++) {
+      cells_[keys[k]].push_back(ref);
+      agent_cells.push_back(keys[k]);
+    }
+    num_segments_++;
+  }
+}
+
+void multiagent::SegmentIndex::removeAgent(size_t agent)
+{
+  std::vector<uint64_t>& agent_cells = agent_cells_[agent];
+  for (size_t k = 0; k < agent_cells.size(); k++) {
+    CellMap::iterator it = cells_.find(agent_cells[k]);
+    if (it == cells_.end()) {
+      continue;  // already removed (cell shared by consecutive segments)
+    }
+    std::vector<SegmentRef>& refs = it->second;
+    size_t j = 0;
+    for (size_t i = 0; i < refs.size(); i++) {
+      if (refs[i].agent != agent) {
+        refs[j++] = refs[i];
+      }
+    }
+    refs.resize(j);
+    if (refs.empty()) {
+      cells_.erase(it);
+    }
+  }
+  agent_cells.clear();
+  if (paths_[agent].size() > 1) {
+    num_segments_ -= paths_[agent].size() - 1;
+  }
+  paths_[agent].clear();
+}
+
+void multiagent::SegmentIndex::getSegmentCells(const Eigen::Vector3d& start, const Eigen::Vector3d& end,
+                                               std::vector<uint64_t>* keys) const
+{
+  keys->clear();
+  int64_t cell[3] = { getCellCoord(start.x()), getCellCoord(start.y()), getCellCoord(start.z()) };
+  const int64_t end_cell[3] = { getCellCoord(end.x()), getCellCoord(end.y()), getCellCoord(end.z()) };
+  keys->push_back(getCellKey(cell[0], cell[1], cell[2]));
+
+  const Eigen::Vector3d direction = end - start;
+  int step[3];
+  double t_max[3], t_delta[3];
+  int64_t num_steps = 0;
+  for (int k = 0; k < 3; k++) {
+    num_steps += std::abs(end_cell[k] - cell[k]);
+    if (direction[k] > 0) {
+      step[k] = 1;
+      t_max[k] = ((cell[k] + 1) * cell_size_ - start[k]) / direction[k];
+      t_delta[k] = cell_size_ / direction[k];
+    } else if (direction[k] < 0) {
+      step[k] = -1;
+      t_max[k] = (cell[k] * cell_size_ - start[k]) / direction[k];
+      t_delta[k] = -cell_size_ / direction[k];
+    } else {
+      step[k] = 0;
+      t_max[k] = std::numeric_limits<double>::max();
+      t_delta[k] = std::numeric_limits<double>::max();
+    }
+  }
+  for (int64_t n = 0; n < num_steps; n++) {
+    int k = 0;
+    if (t_max[1] < t_max[k]) k = 1;
+    if (t_max[2] < t_max[k]) k = 2;
+    if (cell[k] == end_cell[k]) {
+      // numerical corner case: advance along an axis which is not done yet
+      for (k = 0; k < 3 && cell[k] == end_cell[k]; k++) {}
+    }
+    cell[k] += step[k];
+    t_max[k] += t_delta[k];
+    keys->push_back(getCellKey(cell[0], cell[1], cell[2]));
+  }
+}
+
+int64_t multiagent::SegmentIndex::getCellCoord(double x) const
+{
+  return (int64_t) floor(x / cell_size_);
+}
+
+uint64_t multiagent::SegmentIndex::getCellKey(int64_t cx, int64_t cy, int64_t cz)
+{
+  // 21 bits per axis
+  const int64_t kOffset = 1 << 20;
+  return ((((uint64_t) (cx + kOffset)) & 0x1fffff) << 42) |
+         ((((uint64_t) (cy + kOffset)) & 0x1fffff) << 21) |
+          (((uint64_t) (cz + kOffset)) & 0x1fffff);
+}
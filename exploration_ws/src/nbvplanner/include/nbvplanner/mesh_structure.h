@@ -47,12 +47,44 @@ class StlMesh
     manager_ = manager;
   }
   void incorporateViewFromPoseMsg(const geometry_msgs::Pose& pose, int n_peer);
+  // Incorporates the views of several poses of the same vehicle in a single traversal of the mesh.
+  void incorporateViewFromPoseMsgs(const std::vector<geometry_msgs::Pose>& poses, int n_peer);
   double computeInspectableArea(const tf::Transform& transform);
   void assembleMarkerArray(visualization_msgs::Marker& inspected,
                            visualization_msgs::Marker& uninspected) const;
 
  private:
+  // Camera frusta of a pose in the mesh frame, used to cull the boxes of the bounding volume hierarchy.
+  struct View
+  {
+    tf::Transform transform;
+    std::vector<bool> unobstructed;
+    Eigen::Vector3d origin;
+    std::vector<std::vector<Eigen::Vector3d> > boundNormals;  // only for the unobstructed cameras
+  };
+  // Node of the bounding volume hierarchy over the facets of the loaded mesh.
+  struct BvhNode
+  {
+    Eigen::Vector3d min;
+    Eigen::Vector3d max;
+    int left;   // index of the children nodes, -1 for a leaf
+    int right;
+    int first;  // range of the facets of a leaf in bvhFacets_
+    int count;
+  };
+
+  static void initView(const tf::Transform& transform, const std::vector<bool>& unobstructed,
+                       View& view);
+  static bool isBoxOutsideView(const BvhNode& node, const View& view);
+  bool getUnobstructedCameras(const geometry_msgs::Pose& pose, int n_peer,
+                              std::vector<bool>& unobstructed) const;
+  void buildBvh();
+  int buildBvhNode(int first, int count);
+  void incorporateViewsInBvh(int nodeIndex, const std::vector<View>& views,
+                             const std::vector<int>& activeViews);
+  double computeInspectableAreaInBvh(int nodeIndex, const View& view);
   void incorporateViewFromTf(const tf::Transform& transform, const std::vector<bool>& unobstructed);
+  void incorporateView(const tf::Transform& transform, const std::vector<bool>& unobstructed);
   void split();
   bool collapse();
   bool getVisibility(const tf::Transform& transform, bool& partialVisibility,
@@ -66,6 +98,9 @@ class StlMesh
   Eigen::Vector3d x2_;
   Eigen::Vector3d x3_;
   Eigen::Vector3d normal_;
+  // Bounding volume hierarchy over children_, only built for the root of a loaded mesh.
+  std::vector<BvhNode> bvh_;
+  std::vector<StlMesh*> bvhFacets_;
 
   static double resolution_;
   static std::vector<double> cameraPitch_;
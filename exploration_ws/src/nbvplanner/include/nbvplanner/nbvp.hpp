@@ -309,6 +309,11 @@ bool nbvInspection::nbvPlanner<stateVec>::setParams()
     ROS_WARN("No value for maximal extension range specified. Looking for %s. Default is 1.0m.",
              (ns + "/nbvp/tree/extension_range").c_str());
   }
+  params_.recedingHorizon_ = false;
+  if (!ros::param::get(ns + "/nbvp/tree/receding_horizon", params_.recedingHorizon_)) {
+    ROS_WARN("No receding horizon option specified. Looking for %s. Default is false.",
+             (ns + "/nbvp/tree/receding_horizon").c_str());
+  }
   params_.initIterations_ = 15;
   if (!ros::param::get(ns + "/nbvp/tree/initial_iterations", params_.initIterations_)) {
     ROS_WARN("No number of initial tree iterations specified. Looking for %s. Default is 15.",
@@ -324,6 +329,22 @@ bool nbvInspection::nbvPlanner<stateVec>::setParams()
     ROS_WARN("No gain range specified. Looking for %s. Default is 1.0m.",
              (ns + "/nbvp/gain/range").c_str());
   }
+  params_.gainRaycast_ = false;
+  if (!ros::param::get(ns + "/nbvp/gain/raycast", params_.gainRaycast_)) {
+    ROS_WARN("No gain raycast option specified. Looking for %s. Default is false.",
+             (ns + "/nbvp/gain/raycast").c_str());
+  }
+  params_.gainCache_ = false;
+  if (!ros::param::get(ns + "/nbvp/gain/cache", params_.gainCache_)) {
+    ROS_WARN("No gain cache option specified. Looking for %s. Default is false.",
+             (ns + "/nbvp/gain/cache").c_str());
+  }
+  params_.gainCacheYawBins_ = 16;
+  if (!ros::param::get(ns + "/nbvp/gain/cache_yaw_bins", params_.gainCacheYawBins_)) {
+    ROS_WARN("No number of yaw bins of the gain cache specified. Looking for %s. Default is 16.",
+             (ns + "/nbvp/gain/cache_yaw_bins").c_str());
+  }
+  params_.gainCacheYawBins_ = std::max(params_.gainCacheYawBins_, 1);
   if (!ros::param::get(ns + "/bbx/minX", params_.minX_)) {
     ROS_WARN("No x-min value specified. Looking for %s", (ns + "/bbx/minX").c_str());
     ret = false;
@@ -20,6 +20,8 @@
 #include <ros/ros.h>
 #include <ros/package.h>
 #include <sstream>
+#include <stdint.h>
+#include <unordered_map>
 #include <eigen3/Eigen/Dense>
 #include <geometry_msgs/PoseWithCovarianceStamped.h>
 #include <nav_msgs/Odometry.h>
@@ -54,6 +56,38 @@ class RrtTree : public TreeBase<Eigen::Vector4d>
   std::vector<geometry_msgs::Pose> samplePath(StateVec start, StateVec end,
                                               std::string targetFrame);
  protected:
+  typedef std::vector<std::vector<Eigen::Vector3d> > FovNormals;
+  // Gain of the voxels in the fields of view, without the mesh area: one visibility check per voxel
+  double gainCube(const StateVec& state, const FovNormals& normals);
+  // Gain of the voxels in the fields of view, without the mesh area: the voxels are collected by casting
+  // a bundle of rays from the node, each ray walked once up to the first occupied voxel
+  double gainRaycast(const StateVec& state, const FovNormals& normals);
+  // Normals of the camera bounds rotated by the yaw of the state and normalized
+  void getFovNormals(const StateVec& state, FovNormals* normals) const;
+  bool isInFieldOfView(const Eigen::Vector3d& dir, const FovNormals& normals, double minDist) const;
+  uint64_t getGainCacheKey(const StateVec& state) const;
+
+  // Receding horizon: inserts the retained subtree under the new root, checking again only the edges and
+  // the gains of the nodes around which the octomap changed, then rewires it (RRT*)
+  void insertRetainedTree(Node<StateVec> * retained);
+  bool isRetainedEdgeValid(const Node<StateVec> * node) const;
+  bool isEdgeFree(const StateVec& start, const StateVec& end) const;
+  void rewireRetainedNodes(const std::vector<Node<StateVec> *>& nodes);
+  void updateSubtree(Node<StateVec> * node);
+  void updateBestNode(Node<StateVec> * node);
+  void insertNode(Node<StateVec> * node);
+
+  Node<StateVec> * nextRootNode_;  // first node of the best branch, root of the subtree kept by clear()
+  Node<StateVec> * retainedRoot_;  // subtree kept by clear(), inserted by initialize()
+
+  struct GainCacheEntry
+  {
+    double gain;
+    uint64_t mapVersion;  // see OctomapWorld::getMapVersion()
+  };
+  std::unordered_map<uint64_t, GainCacheEntry> gainCache_;  // quantized state -> gain
+  static const size_t kMaxGainCacheSize;
+
   kdtree * kdTree_;
   std::stack<StateVec> history_;
   std::vector<StateVec> bestBranchMemory_;
@@ -18,11 +18,13 @@
 #define TREE_H_
 
 #include <vector>
+#include <stdint.h>
 #include <eigen3/Eigen/Dense>
 #include <geometry_msgs/PoseWithCovarianceStamped.h>
 #include <nav_msgs/Odometry.h>
 #include <octomap_world/octomap_manager.h>
 #include <multiagent_collision_check/Segment.h>
+#include <multiagent_collision_check/segment_index.h>
 #include <nbvplanner/mesh_structure.h>
 
 namespace nbvInspection {
@@ -40,6 +42,9 @@ struct Params
   double igUnmapped_;
   double igArea_;
   double gainRange_;
+  bool gainRaycast_;      // gain from a bundle of rays cast from the node instead of a visibility check per voxel
+  bool gainCache_;        // reuse the gains of the states in the same voxel and yaw bin until the octomap changes around them
+  int gainCacheYawBins_;  // number of yaw bins of the gain cache
   double degressiveCoeff_;
   double zero_gain_;
 
@@ -48,6 +53,7 @@ struct Params
   double dOvershoot_;
   double extensionRange_;
   bool exact_root_;
+  bool recedingHorizon_;  // keep the subtree of the next root between the planning calls
   int initIterations_;
   int cuttoffIterations_;
   double dt_;
@@ -83,6 +89,8 @@ class Node
   std::vector<Node*> children_;
   double gain_;
   double distance_;
+  double localGain_;     // gain of the node alone (gain_ accumulates it along the branch)
+  uint64_t mapVersion_;  // map version when localGain_ and the edge to the parent were checked
 };
 
 template<typename stateVec>
@@ -100,6 +108,7 @@ class TreeBase
   stateVec exact_root_;
   std::vector<std::vector<Eigen::Vector3d,Eigen::aligned_allocator<Eigen::Vector3d> >*> segments_;
   std::vector<std::string> agentNames_;
+  multiagent::SegmentIndex segmentIndex_; // grid index of segments_ for the collision checks (agent i -> segments_[i])
  public:
   TreeBase();
   TreeBase(mesh::StlMesh * mesh, volumetric_mapping::OctomapManager * manager);
@@ -25,6 +25,8 @@ nbvInspection::Node<stateVec>::Node()
   parent_ = NULL;
   distance_ = DBL_MAX;
   gain_ = 0.0;
+  localGain_ = 0.0;
+  mapVersion_ = 0;
 }
 
 template<typename stateVec>
@@ -125,6 +127,7 @@ void nbvInspection::TreeBase<stateVec>::evade(const multiagent_collision_check::
   for(typename std::vector<geometry_msgs::Pose>::const_iterator it = segmentMsg.poses.begin(); it != segmentMsg.poses.end(); it++) {
     segments_[i]->push_back(Eigen::Vector3d(it->position.x, it->position.y, it->position.z));
   }
+  segmentIndex_.setAgentPath(i, *segments_[i]);
 }
 
 #endif
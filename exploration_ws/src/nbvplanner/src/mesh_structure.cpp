@@ -17,6 +17,9 @@
 #ifndef _MESH_STRUCTURE_CPP_
 #define _MESH_STRUCTURE_CPP_
 
+#include <algorithm>
+#include <cfloat>
+#include <numeric>
 #include <eigen3/Eigen/Dense>
 #include <ros/ros.h>
 #include <nbvplanner/mesh_structure.h>
@@ -125,8 +128,10 @@ mesh::StlMesh::StlMesh(std::fstream& file)
   }
   free(line);
   file.close();
-  if (k > 0)
+  if (k > 0) {
     isLeaf_ = false;
+    buildBvh();
+  }
   ROS_INFO(
       "STL file read. Contains %i elements located inside (%2.2f,%2.2f)x(%2.2f,%2.2f)x(%2.2f,%2.2f)",
       k, minX, maxX, minY, maxY, minZ, maxZ);
@@ -182,15 +187,13 @@ void mesh::StlMesh::setPeerPose(const geometry_msgs::Pose& pose, int n_peer)
   }
 }
 
-void mesh::StlMesh::incorporateViewFromPoseMsg(const geometry_msgs::Pose& pose, int n_peer)
+bool mesh::StlMesh::getUnobstructedCameras(const geometry_msgs::Pose& pose, int n_peer,
+                                           std::vector<bool>& unobstructed) const
 {
-  tf::Transform transform;
-  tf::Point point;
-  tf::poseMsgToTF(pose, transform);
   // Check that no peer is within the field of view (multi agent only). Find transforms
   // for all specified vehicles by their tf frames and then check for interference.
   bool inAllFoV = true;
-  std::vector<bool> unobstructed;
+  unobstructed.clear();
   for (typename std::vector<std::vector<tf::Vector3>>::iterator itCBN = camBoundNormals_.begin();
       itCBN != camBoundNormals_.end(); itCBN++) {
     bool anyInFoV = false;
@@ -217,13 +220,187 @@ void mesh::StlMesh::incorporateViewFromPoseMsg(const geometry_msgs::Pose& pose,
     unobstructed.push_back(!anyInFoV);
     inAllFoV &= anyInFoV;
   }
-  if (!inAllFoV) {
-    // No total interference, can incorporate the data.
-    incorporateViewFromTf(transform, unobstructed);
+  // No total interference, the data can be incorporated.
+  return !inAllFoV;
+}
+
+void mesh::StlMesh::incorporateViewFromPoseMsg(const geometry_msgs::Pose& pose, int n_peer)
+{
+  incorporateViewFromPoseMsgs(std::vector<geometry_msgs::Pose>(1, pose), n_peer);
+}
+
+void mesh::StlMesh::incorporateViewFromPoseMsgs(const std::vector<geometry_msgs::Pose>& poses,
+                                                int n_peer)
+{
+  std::vector<View> views;
+  views.reserve(poses.size());
+  for (typename std::vector<geometry_msgs::Pose>::const_iterator it = poses.begin();
+      it != poses.end(); it++) {
+    std::vector<bool> unobstructed;
+    if (!getUnobstructedCameras(*it, n_peer, unobstructed)) {
+      continue;
+    }
+    tf::Transform transform;
+    tf::poseMsgToTF(*it, transform);
+    views.push_back(View());
+    initView(transform, unobstructed, views.back());
+  }
+  if (!views.empty()) {
+    if (bvh_.empty()) {
+      for (typename std::vector<View>::const_iterator it = views.begin(); it != views.end(); it++)
+        incorporateViewFromTf(it->transform, it->unobstructed);
+    } else {
+      // A single traversal of the hierarchy for all the views.
+      std::vector<int> activeViews(views.size());
+      std::iota(activeViews.begin(), activeViews.end(), 0);
+      incorporateViewsInBvh(0, views, activeViews);
+    }
   }
   collapse();
 }
 
+void mesh::StlMesh::initView(const tf::Transform& transform, const std::vector<bool>& unobstructed,
+                             View& view)
+{
+  view.transform = transform;
+  view.unobstructed = unobstructed;
+  const tf::Vector3& origin = transform.getOrigin();
+  view.origin = Eigen::Vector3d(origin.x(), origin.y(), origin.z());
+  // A point p is within the field of view of a camera if n.dot(R^T * (p - origin)) >= 0 for all
+  // its bound normals n, i.e. if (R * n).dot(p - origin) >= 0.
+  const tf::Matrix3x3& rotation = transform.getBasis();
+  view.boundNormals.clear();
+  for (int i = 0; i < camBoundNormals_.size(); i++) {
+    if (unobstructed.size() > 0 && !unobstructed[i]) {
+      continue;
+    }
+    std::vector<Eigen::Vector3d> boundNormals;
+    for (typename std::vector<tf::Vector3>::const_iterator it = camBoundNormals_[i].begin();
+        it != camBoundNormals_[i].end(); it++) {
+      const tf::Vector3 normal = rotation * (*it);
+      boundNormals.push_back(Eigen::Vector3d(normal.x(), normal.y(), normal.z()));
+    }
+    view.boundNormals.push_back(boundNormals);
+  }
+}
+
+bool mesh::StlMesh::isBoxOutsideView(const BvhNode& node, const View& view)
+{
+  // getVisibility() only reports a (partial) visibility if a corner of the facet is within maxDist_
+  // and within the field of view of a camera. If no point of the box is, no facet inside it is visible.
+  const Eigen::Vector3d closest = view.origin.cwiseMax(node.min).cwiseMin(node.max);
+  if ((closest - view.origin).squaredNorm() > maxDist_ * maxDist_)
+    return true;
+  const Eigen::Vector3d center = 0.5 * (node.min + node.max) - view.origin;
+  const Eigen::Vector3d halfExtent = 0.5 * (node.max - node.min);
+  for (typename std::vector<std::vector<Eigen::Vector3d> >::const_iterator itCam = view.boundNormals
+      .begin(); itCam != view.boundNormals.end(); itCam++) {
+    bool outside = false;
+    for (typename std::vector<Eigen::Vector3d>::const_iterator it = itCam->begin();
+        it != itCam->end(); it++) {
+      // Max of it->dot(p - origin) over the points p of the box
+      if (it->dot(center) + it->cwiseAbs().dot(halfExtent) < 0.0) {
+        outside = true;
+        break;
+      }
+    }
+    if (!outside)
+      return false;
+  }
+  return true;
+}
+
+void mesh::StlMesh::buildBvh()
+{
+  // The facets read from the file are head nodes, which are never deleted by collapse(), so the
+  // hierarchy is built once over them. Their subdivisions are contained in their boxes.
+  bvh_.clear();
+  bvhFacets_ = children_;
+  if (bvhFacets_.empty())
+    return;
+  bvh_.reserve(2 * bvhFacets_.size());
+  buildBvhNode(0, bvhFacets_.size());
+}
+
+int mesh::StlMesh::buildBvhNode(int first, int count)
+{
+  const int kMaxLeafFacets = 4;
+  BvhNode node;
+  node.min = Eigen::Vector3d::Constant(DBL_MAX);
+  node.max = Eigen::Vector3d::Constant(-DBL_MAX);
+  Eigen::Vector3d centroidMin = node.min;
+  Eigen::Vector3d centroidMax = node.max;
+  for (int i = first; i < first + count; i++) {
+    const StlMesh* facet = bvhFacets_[i];
+    node.min = node.min.cwiseMin(facet->x1_).cwiseMin(facet->x2_).cwiseMin(facet->x3_);
+    node.max = node.max.cwiseMax(facet->x1_).cwiseMax(facet->x2_).cwiseMax(facet->x3_);
+    const Eigen::Vector3d centroid = (facet->x1_ + facet->x2_ + facet->x3_) / 3.0;
+    centroidMin = centroidMin.cwiseMin(centroid);
+    centroidMax = centroidMax.cwiseMax(centroid);
+  }
+  node.left = -1;
+  node.right = -1;
+  node.first = first;
+  node.count = count;
+  const int index = bvh_.size();
+  bvh_.push_back(node);
+  if (count <= kMaxLeafFacets)
+    return index;
+
+  // Split at the median centroid along the longest axis of the centroids.
+  int axis;
+  (centroidMax - centroidMin).maxCoeff(&axis);
+  const int half = count / 2;
+  std::nth_element(bvhFacets_.begin() + first, bvhFacets_.begin() + first + half,
+                   bvhFacets_.begin() + first + count, [axis](const StlMesh* a, const StlMesh* b) {
+                     return (a->x1_ + a->x2_ + a->x3_)[axis] < (b->x1_ + b->x2_ + b->x3_)[axis];
+                   });
+  const int left = buildBvhNode(first, half);
+  const int right = buildBvhNode(first + half, count - half);
+  bvh_[index].left = left;
+  bvh_[index].right = right;
+  return index;
+}
+
+void mesh::StlMesh::incorporateViewsInBvh(int nodeIndex, const std::vector<View>& views,
+                                          const std::vector<int>& activeViews)
+{
+  const BvhNode& node = bvh_[nodeIndex];
+  std::vector<int> visibleViews;
+  for (typename std::vector<int>::const_iterator it = activeViews.begin(); it != activeViews.end();
+      it++) {
+    if (!isBoxOutsideView(node, views[*it]))
+      visibleViews.push_back(*it);
+  }
+  if (visibleViews.empty())
+    return;
+  if (node.left < 0) {
+    for (int i = node.first; i < node.first + node.count; i++) {
+      for (typename std::vector<int>::const_iterator it = visibleViews.begin();
+          it != visibleViews.end(); it++)
+        bvhFacets_[i]->incorporateView(views[*it].transform, views[*it].unobstructed);
+    }
+    return;
+  }
+  incorporateViewsInBvh(node.left, views, visibleViews);
+  incorporateViewsInBvh(node.right, views, visibleViews);
+}
+
+double mesh::StlMesh::computeInspectableAreaInBvh(int nodeIndex, const View& view)
+{
+  const BvhNode& node = bvh_[nodeIndex];
+  if (isBoxOutsideView(node, view))
+    return 0.0;
+  if (node.left < 0) {
+    double ret = 0.0;
+    for (int i = node.first; i < node.first + node.count; i++)
+      ret += bvhFacets_[i]->computeInspectableArea(view.transform);
+    return ret;
+  }
+  return computeInspectableAreaInBvh(node.left, view)
+      + computeInspectableAreaInBvh(node.right, view);
+}
+
 void mesh::StlMesh::assembleMarkerArray(visualization_msgs::Marker& inspected,
                                         visualization_msgs::Marker& uninspected) const
 {
@@ -286,31 +463,40 @@ void mesh::StlMesh::incorporateViewFromTf(const tf::Transform& transform,
                                           const std::vector<bool>& unobstructed)
 {
   for (typename std::vector<mesh::StlMesh*>::iterator it = children_.begin(); it != children_.end();
-      it++) {
-    mesh::StlMesh* currentNode = *it;
-    if (currentNode->isInspected_)
-      continue;
-    bool partialVisibility = false;
-    if (currentNode->getVisibility(transform, partialVisibility, true, unobstructed)) {
-      currentNode->isInspected_ = true;
-      if (!currentNode->isLeaf_) {
-        for (typename std::vector<mesh::StlMesh*>::iterator currentChild = currentNode->children_
-            .begin(); currentChild != currentNode->children_.end(); currentChild++)
-          delete *currentChild;
-        currentNode->children_.clear();
-        currentNode->isLeaf_ = true;
-      }
-    } else if (partialVisibility) {
-      if (currentNode->isLeaf_ && currentNode->normal_.norm() > 0.25 * resolution_) {
-        currentNode->split();
-      }
-      currentNode->incorporateViewFromTf(transform, unobstructed);
+      it++)
+    (*it)->incorporateView(transform, unobstructed);
+}
+
+void mesh::StlMesh::incorporateView(const tf::Transform& transform,
+                                    const std::vector<bool>& unobstructed)
+{
+  if (isInspected_)
+    return;
+  bool partialVisibility = false;
+  if (getVisibility(transform, partialVisibility, true, unobstructed)) {
+    isInspected_ = true;
+    if (!isLeaf_) {
+      for (typename std::vector<mesh::StlMesh*>::iterator currentChild = children_.begin();
+          currentChild != children_.end(); currentChild++)
+        delete *currentChild;
+      children_.clear();
+      isLeaf_ = true;
     }
+  } else if (partialVisibility) {
+    if (isLeaf_ && normal_.norm() > 0.25 * resolution_) {
+      split();
+    }
+    incorporateViewFromTf(transform, unobstructed);
   }
 }
 
 double mesh::StlMesh::computeInspectableArea(const tf::Transform& transform)
 {
+  if (!bvh_.empty()) {
+    View view;
+    initView(transform, std::vector<bool>(), view);
+    return computeInspectableAreaInBvh(0, view);
+  }
   if (isLeaf_) {
     if (isInspected_)
       return 0.0;
@@ -18,6 +18,8 @@
 #define RRTTREE_HPP_
 
 #include <cstdlib>
+#include <algorithm>
+#include <deque>
 #include <multiagent_collision_check/multiagent_collision_checker.h>
 #include <nbvplanner/rrt.h>
 #include <nbvplanner/tree.hpp>
@@ -27,6 +29,8 @@ nbvInspection::RrtTree::RrtTree()
 {
   kdTree_ = kd_create(3);
   iterationCount_ = 0;
+  nextRootNode_ = NULL;
+  retainedRoot_ = NULL;
   for (int i = 0; i < 4; i++) {
     inspectionThrottleTime_.push_back(ros::Time::now().toSec());
   }
@@ -57,6 +61,8 @@ nbvInspection::RrtTree::RrtTree(mesh::StlMesh * mesh, volumetric_mapping::Octoma
   manager_ = manager;
   kdTree_ = kd_create(3);
   iterationCount_ = 0;
+  nextRootNode_ = NULL;
+  retainedRoot_ = NULL;
   for (int i = 0; i < 4; i++) {
     inspectionThrottleTime_.push_back(ros::Time::now().toSec());
   }
@@ -84,6 +90,7 @@ nbvInspection::RrtTree::RrtTree(mesh::StlMesh * mesh, volumetric_mapping::Octoma
 nbvInspection::RrtTree::~RrtTree()
 {
   delete rootNode_;
+  delete retainedRoot_;
   kd_free(kdTree_);
   if (fileResponse_.is_open()) {
     fileResponse_.close();
@@ -345,7 +352,7 @@ void nbvInspection::RrtTree::iterate(int iterations)
       == manager_->getLineStatusBoundingBox(
           origin, direction + origin + direction.normalized() * params_.dOvershoot_,
           params_.boundingBox_)
-      && !multiagent::isInCollision(newParent->state_, newState, params_.boundingBox_, segments_)) {
+      && !segmentIndex_.isInCollision(newParent->state_, newState, params_.boundingBox_)) {
     // Sample the new orientation
     newState[3] = 2.0 * M_PI * (((double) rand()) / ((double) RAND_MAX) - 0.5);
     // Create new node and insert into tree
@@ -354,8 +361,10 @@ void nbvInspection::RrtTree::iterate(int iterations)
     newNode->parent_ = newParent;
     newNode->distance_ = newParent->distance_ + direction.norm();
     newParent->children_.push_back(newNode);
+    newNode->mapVersion_ = manager_->getMapVersion();
+    newNode->localGain_ = gain(newNode->state_);
     newNode->gain_ = newParent->gain_
-        + gain(newNode->state_) * exp(-params_.degressiveCoeff_ * newNode->distance_);
+        + newNode->localGain_ * exp(-params_.degressiveCoeff_ * newNode->distance_);
 
     kd_insert3(kdTree_, newState.x(), newState.y(), newState.z(), newNode);
 
@@ -384,6 +393,7 @@ void nbvInspection::RrtTree::initialize()
   }
   if (i < agentNames_.size()) {
     segments_[i]->clear();
+    segmentIndex_.clearAgent(i);
   }
 // Initialize kd-tree with root node and prepare log file
   kdTree_ = kd_create(3);
@@ -413,6 +423,12 @@ void nbvInspection::RrtTree::initialize()
              rootNode_);
   iterationCount_++;
 
+// Receding horizon: insert the subtree kept from the previous tree (it contains the previous best branch)
+  if (retainedRoot_ != NULL) {
+    insertRetainedTree(retainedRoot_);
+    retainedRoot_ = NULL;
+  }
+
 // Insert all nodes of the remainder of the previous best branch, checking for collisions and
 // recomputing the gain.
   for (typename std::vector<StateVec>::reverse_iterator iter = bestBranchMemory_.rbegin();
@@ -441,16 +457,17 @@ void nbvInspection::RrtTree::initialize()
         == manager_->getLineStatusBoundingBox(
             origin, direction + origin + direction.normalized() * params_.dOvershoot_,
             params_.boundingBox_)
-        && !multiagent::isInCollision(newParent->state_, newState, params_.boundingBox_,
-                                      segments_)) {
+        && !segmentIndex_.isInCollision(newParent->state_, newState, params_.boundingBox_)) {
       // Create new node and insert into tree
       nbvInspection::Node<StateVec> * newNode = new nbvInspection::Node<StateVec>;
       newNode->state_ = newState;
       newNode->parent_ = newParent;
       newNode->distance_ = newParent->distance_ + direction.norm();
       newParent->children_.push_back(newNode);
+      newNode->mapVersion_ = manager_->getMapVersion();
+      newNode->localGain_ = gain(newNode->state_);
       newNode->gain_ = newParent->gain_
-          + gain(newNode->state_) * exp(-params_.degressiveCoeff_ * newNode->distance_);
+          + newNode->localGain_ * exp(-params_.degressiveCoeff_ * newNode->distance_);
 
       kd_insert3(kdTree_, newState.x(), newState.y(), newState.z(), newNode);
 
@@ -496,6 +513,168 @@ void nbvInspection::RrtTree::initialize()
   params_.inspectionPath_.publish(p);
 }
 
+void nbvInspection::RrtTree::insertRetainedTree(Node<StateVec> * retained)
+{
+// The retained nodes are inserted parents first. If the new root is the retained root (exact root),
+// the retained root is replaced by it, otherwise the retained root is connected to it.
+  std::deque<Node<StateVec> *> queue;
+  if ((retained->state_.head<3>() - rootNode_->state_.head<3>()).norm() < 1e-6) {
+    for (size_t i = 0; i < retained->children_.size(); i++) {
+      retained->children_[i]->parent_ = rootNode_;
+      rootNode_->children_.push_back(retained->children_[i]);
+      queue.push_back(retained->children_[i]);
+    }
+    retained->children_.clear();
+    delete retained;
+  } else {
+    retained->parent_ = rootNode_;
+    rootNode_->children_.push_back(retained);
+    queue.push_back(retained);
+  }
+
+  const uint64_t mapVersion = manager_->getMapVersion();
+  const double disc = manager_->getResolution();
+  const double gainHalfSize = params_.gainRange_ + disc;
+  std::vector<Node<StateVec> *> retainedNodes;
+  while (!queue.empty()) {
+    Node<StateVec> * node = queue.front();
+    queue.pop_front();
+    Node<StateVec> * parent = node->parent_;
+    if (!isRetainedEdgeValid(node)) {
+      // The node and its subtree are dropped
+      std::vector<Node<StateVec> *>& siblings = parent->children_;
+      siblings.erase(std::remove(siblings.begin(), siblings.end(), node), siblings.end());
+      delete node;
+      continue;
+    }
+    // The gain is computed again only if the octomap changed within its range
+    const Eigen::Vector3d center(node->state_[0], node->state_[1], node->state_[2]);
+    if (manager_->isBoxChangedSince(center - Eigen::Vector3d::Constant(gainHalfSize),
+                                    center + Eigen::Vector3d::Constant(gainHalfSize),
+                                    node->mapVersion_)) {
+      node->localGain_ = gain(node->state_);
+    }
+    node->mapVersion_ = mapVersion;
+    node->distance_ = parent->distance_ + (node->state_.head<3>() - parent->state_.head<3>()).norm();
+    node->gain_ = parent->gain_ + node->localGain_ * exp(-params_.degressiveCoeff_ * node->distance_);
+    insertNode(node);
+    retainedNodes.push_back(node);
+    for (size_t i = 0; i < node->children_.size(); i++) {
+      queue.push_back(node->children_[i]);
+    }
+  }
+
+  rewireRetainedNodes(retainedNodes);
+}
+
+bool nbvInspection::RrtTree::isRetainedEdgeValid(const Node<StateVec> * node) const
+{
+  const Node<StateVec> * parent = node->parent_;
+  if (segmentIndex_.isInCollision(parent->state_, node->state_, params_.boundingBox_)) {
+    return false;
+  }
+// The edges from the root are new, the others are checked again only if the octomap changed around them
+  if (parent != rootNode_) {
+    const Eigen::Vector3d margin = 0.5 * params_.boundingBox_
+        + Eigen::Vector3d::Constant(params_.dOvershoot_ + manager_->getResolution());
+    const Eigen::Vector3d start = parent->state_.head<3>();
+    const Eigen::Vector3d end = node->state_.head<3>();
+    if (!manager_->isBoxChangedSince(start.cwiseMin(end) - margin, start.cwiseMax(end) + margin,
+                                     node->mapVersion_)) {
+      return true;
+    }
+  }
+  return isEdgeFree(parent->state_, node->state_);
+}
+
+bool nbvInspection::RrtTree::isEdgeFree(const StateVec& start, const StateVec& end) const
+{
+  Eigen::Vector3d origin(start[0], start[1], start[2]);
+  Eigen::Vector3d direction(end[0] - origin[0], end[1] - origin[1], end[2] - origin[2]);
+  return volumetric_mapping::OctomapManager::CellStatus::kFree
+      == manager_->getLineStatusBoundingBox(
+          origin, direction + origin + direction.normalized() * params_.dOvershoot_,
+          params_.boundingBox_);
+}
+
+void nbvInspection::RrtTree::rewireRetainedNodes(const std::vector<Node<StateVec> *>& nodes)
+{
+// RRT* rewiring: a node is connected to the neighbour within the extension range which gives the
+// shortest path from the root (a descendant cannot give a shorter path, hence no cycles)
+  bool rewired = false;
+  for (size_t i = 0; i < nodes.size(); i++) {
+    Node<StateVec> * node = nodes[i];
+    Node<StateVec> * bestParent = NULL;
+    double bestDistance = node->distance_ - 1e-6;
+    kdres * neighbours = kd_nearest_range3(kdTree_, node->state_.x(), node->state_.y(),
+                                           node->state_.z(), params_.extensionRange_);
+    for (; !kd_res_end(neighbours); kd_res_next(neighbours)) {
+      Node<StateVec> * neighbour = (Node<StateVec> *) kd_res_item_data(neighbours);
+      if (neighbour == node || neighbour == node->parent_) {
+        continue;
+      }
+      const double distance = neighbour->distance_
+          + (node->state_.head<3>() - neighbour->state_.head<3>()).norm();
+      if (distance < bestDistance && isEdgeFree(neighbour->state_, node->state_)
+          && !segmentIndex_.isInCollision(neighbour->state_, node->state_, params_.boundingBox_)) {
+        bestDistance = distance;
+        bestParent = neighbour;
+      }
+    }
+    kd_res_free(neighbours);
+    if (bestParent == NULL) {
+      continue;
+    }
+    std::vector<Node<StateVec> *>& siblings = node->parent_->children_;
+    siblings.erase(std::remove(siblings.begin(), siblings.end(), node), siblings.end());
+    node->parent_ = bestParent;
+    bestParent->children_.push_back(node);
+    updateSubtree(node);
+    rewired = true;
+  }
+  if (rewired) {
+    bestGain_ = params_.zero_gain_;
+    bestNode_ = NULL;
+    updateBestNode(rootNode_);
+  }
+}
+
+void nbvInspection::RrtTree::updateSubtree(Node<StateVec> * node)
+{
+  Node<StateVec> * parent = node->parent_;
+  node->distance_ = parent->distance_ + (node->state_.head<3>() - parent->state_.head<3>()).norm();
+  node->gain_ = parent->gain_ + node->localGain_ * exp(-params_.degressiveCoeff_ * node->distance_);
+  for (size_t i = 0; i < node->children_.size(); i++) {
+    updateSubtree(node->children_[i]);
+  }
+}
+
+void nbvInspection::RrtTree::updateBestNode(Node<StateVec> * node)
+{
+  if (node != rootNode_ && node->gain_ > bestGain_) {
+    bestGain_ = node->gain_;
+    bestNode_ = node;
+  }
+  for (size_t i = 0; i < node->children_.size(); i++) {
+    updateBestNode(node->children_[i]);
+  }
+}
+
+void nbvInspection::RrtTree::insertNode(Node<StateVec> * node)
+{
+  kd_insert3(kdTree_, node->state_.x(), node->state_.y(), node->state_.z(), node);
+
+  // Display new node
+  publishNode(node);
+
+  // Update best IG and node if applicable
+  if (node->gain_ > bestGain_) {
+    bestGain_ = node->gain_;
+    bestNode_ = node;
+  }
+  counter_++;
+}
+
 std::vector<geometry_msgs::Pose> nbvInspection::RrtTree::getBestEdge(std::string targetFrame)
 {
 // This function returns the first edge of the best branch
@@ -507,20 +686,72 @@ std::vector<geometry_msgs::Pose> nbvInspection::RrtTree::getBestEdge(std::string
     }
     ret = samplePath(current->parent_->state_, current->state_, targetFrame);
     history_.push(current->parent_->state_);
+    nextRootNode_ = current;
     exact_root_ = current->state_;
   }
   return ret;
 }
 
+const size_t nbvInspection::RrtTree::kMaxGainCacheSize = 100000;
+
 double nbvInspection::RrtTree::gain(StateVec state)
 {
 // This function computes the gain
+  double gain = 0.0;
+  bool cached = false;
+  uint64_t key = 0;
+  if (params_.gainCache_) {
+    // The gain of a state in the same voxel and yaw bin is reused until the octomap changes within its range
+    key = getGainCacheKey(state);
+    std::unordered_map<uint64_t, GainCacheEntry>::iterator it = gainCache_.find(key);
+    if (it != gainCache_.end()) {
+      const double halfSize = params_.gainRange_ + manager_->getResolution();
+      const Eigen::Vector3d center(state[0], state[1], state[2]);
+      if (!manager_->isBoxChangedSince(center - Eigen::Vector3d::Constant(halfSize),
+                                       center + Eigen::Vector3d::Constant(halfSize),
+                                       it->second.mapVersion)) {
+        gain = it->second.gain;
+        cached = true;
+      } else {
+        gainCache_.erase(it);
+      }
+    }
+  }
+  if (!cached) {
+    const uint64_t mapVersion = manager_->getMapVersion();
+    FovNormals normals;
+    getFovNormals(state, &normals);
+    gain = params_.gainRaycast_ ? gainRaycast(state, normals) : gainCube(state, normals);
+    if (params_.gainCache_) {
+      if (gainCache_.size() >= kMaxGainCacheSize) {
+        gainCache_.clear();
+      }
+      GainCacheEntry& entry = gainCache_[key];
+      entry.gain = gain;
+      entry.mapVersion = mapVersion;
+    }
+  }
+// Check the gain added by inspectable surface
+  if (mesh_) {
+    tf::Transform transform;
+    transform.setOrigin(tf::Vector3(state.x(), state.y(), state.z()));
+    tf::Quaternion quaternion;
+    quaternion.setEuler(0.0, 0.0, state[3]);
+    transform.setRotation(quaternion);
+    gain += params_.igArea_ * mesh_->computeInspectableArea(transform);
+  }
+  return gain;
+}
+
+double nbvInspection::RrtTree::gainCube(const StateVec& state, const FovNormals& normals)
+{
   double gain = 0.0;
   const double disc = manager_->getResolution();
   Eigen::Vector3d origin(state[0], state[1], state[2]);
   Eigen::Vector3d vec;
   double rangeSq = pow(params_.gainRange_, 2.0);
-// Iterate over all nodes within the allowed distance
+// Collect all nodes within the allowed distance and inside one of the fields of view
+  std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> > voxels;
   for (vec[0] = std::max(state[0] - params_.gainRange_, params_.minX_);
       vec[0] < std::min(state[0] + params_.gainRange_, params_.maxX_); vec[0] += disc) {
     for (vec[1] = std::max(state[1] - params_.gainRange_, params_.minY_);
@@ -532,75 +763,161 @@ double nbvInspection::RrtTree::gain(StateVec state)
         if (dir.transpose().dot(dir) > rangeSq) {
           continue;
         }
-        bool insideAFieldOfView = false;
         // Check that voxel center is inside one of the fields of view.
-        for (typename std::vector<std::vector<Eigen::Vector3d>>::iterator itCBN = params_
-            .camBoundNormals_.begin(); itCBN != params_.camBoundNormals_.end(); itCBN++) {
-          bool inThisFieldOfView = true;
-          for (typename std::vector<Eigen::Vector3d>::iterator itSingleCBN = itCBN->begin();
-              itSingleCBN != itCBN->end(); itSingleCBN++) {
-            Eigen::Vector3d normal = Eigen::AngleAxisd(state[3], Eigen::Vector3d::UnitZ())
-                * (*itSingleCBN);
-            double val = dir.dot(normal.normalized());
-            if (val < SQRT2 * disc) {
-              inThisFieldOfView = false;
-              break;
-            }
-          }
-          if (inThisFieldOfView) {
-            insideAFieldOfView = true;
-            break;
-          }
+        if (!isInFieldOfView(dir, normals, SQRT2 * disc)) {
+          continue;
+        }
+        voxels.push_back(vec);
+      }
+    }
+  }
+// Rayshooting to evaluate inspectability of the cells, as one batch
+  std::vector<volumetric_mapping::OctomapManager::CellStatus> visibilities;
+  manager_->getVisibilityBatch(origin, voxels, false, &visibilities);
+  for (size_t i = 0; i < voxels.size(); ++i) {
+    if (volumetric_mapping::OctomapManager::CellStatus::kOccupied == visibilities[i]) {
+      continue;
+    }
+    // Check cell status and add to the gain considering the corresponding factor.
+    double probability;
+    volumetric_mapping::OctomapManager::CellStatus node = manager_->getCellProbabilityPoint(
+        voxels[i], &probability);
+    if (node == volumetric_mapping::OctomapManager::CellStatus::kUnknown) {
+      gain += params_.igUnmapped_;
+      // TODO: Add probabilistic gain
+      // gain += params_.igProbabilistic_ * PROBABILISTIC_MODEL(probability);
+    } else if (node == volumetric_mapping::OctomapManager::CellStatus::kOccupied) {
+      gain += params_.igOccupied_;
+      // TODO: Add probabilistic gain
+      // gain += params_.igProbabilistic_ * PROBABILISTIC_MODEL(probability);
+    } else {
+      gain += params_.igFree_;
+      // TODO: Add probabilistic gain
+      // gain += params_.igProbabilistic_ * PROBABILISTIC_MODEL(probability);
+    }
+  }
+// Scale with volume
+  gain *= pow(disc, 3.0);
+  return gain;
+}
+
+double nbvInspection::RrtTree::gainRaycast(const StateVec& state, const FovNormals& normals)
+{
+  typedef volumetric_mapping::OctomapManager::RayCell RayCell;
+
+  double gain = 0.0;
+  const double disc = manager_->getResolution();
+  const Eigen::Vector3d origin(state[0], state[1], state[2]);
+  const double range = params_.gainRange_;
+  const double rangeSq = range * range;
+  if (range <= 0.0) {
+    return 0.0;
+  }
+
+// Spherical grid of directions: the rays are spaced by about one voxel at the gain range
+  const double angleStep = disc / range;
+  const int numElevations = std::max((int) ceil(M_PI / angleStep), 1);
+  const double elevationStep = M_PI / numElevations;
+// A ray is cast only if it can cross a field of view (the margin accounts for the voxels around the ray)
+  const double rayMargin = -disc / range;
+
+  octomap::KeySet visitedKeys;  // each voxel is counted once even if it is crossed by many rays
+  octomap::KeyRay keyRay;
+  std::vector<RayCell> cells;
+  for (int ie = 0; ie < numElevations; ie++) {
+    const double elevation = -0.5 * M_PI + (ie + 0.5) * elevationStep;
+    const double cosElevation = cos(elevation);
+    const double sinElevation = sin(elevation);
+    const int numAzimuths = std::max((int) ceil(2.0 * M_PI * cosElevation / angleStep), 1);
+    const double azimuthStep = 2.0 * M_PI / numAzimuths;
+    for (int ia = 0; ia < numAzimuths; ia++) {
+      const double azimuth = ia * azimuthStep;
+      const Eigen::Vector3d rayDir(cosElevation * cos(azimuth), cosElevation * sin(azimuth),
+                                   sinElevation);
+      if (!isInFieldOfView(rayDir, normals, rayMargin)) {
+        continue;
+      }
+      // The voxels along the ray up to the first occupied one (included) are visible
+      manager_->castVisibilityRay(origin, origin + range * rayDir, &keyRay, &cells);
+      for (size_t ii = 0; ii < cells.size(); ii++) {
+        const RayCell& cell = cells[ii];
+        if (!visitedKeys.insert(cell.key).second) {
+          continue;
+        }
+        // Same cell filters of gainCube()
+        const Eigen::Vector3d dir = cell.center - origin;
+        if (dir.squaredNorm() > rangeSq) {
+          continue;
         }
-        if (!insideAFieldOfView) {
+        if ((cell.center[0] < params_.minX_) || (cell.center[0] >= params_.maxX_)
+            || (cell.center[1] < params_.minY_) || (cell.center[1] >= params_.maxY_)
+            || (cell.center[2] < params_.minZ_) || (cell.center[2] >= params_.maxZ_)) {
           continue;
         }
-        // Check cell status and add to the gain considering the corresponding factor.
-        double probability;
-        volumetric_mapping::OctomapManager::CellStatus node = manager_->getCellProbabilityPoint(
-            vec, &probability);
-        if (node == volumetric_mapping::OctomapManager::CellStatus::kUnknown) {
-          // Rayshooting to evaluate inspectability of cell
-          if (volumetric_mapping::OctomapManager::CellStatus::kOccupied
-              != this->manager_->getVisibility(origin, vec, false)) {
-            gain += params_.igUnmapped_;
-            // TODO: Add probabilistic gain
-            // gain += params_.igProbabilistic_ * PROBABILISTIC_MODEL(probability);
-          }
-        } else if (node == volumetric_mapping::OctomapManager::CellStatus::kOccupied) {
-          // Rayshooting to evaluate inspectability of cell
-          if (volumetric_mapping::OctomapManager::CellStatus::kOccupied
-              != this->manager_->getVisibility(origin, vec, false)) {
-            gain += params_.igOccupied_;
-            // TODO: Add probabilistic gain
-            // gain += params_.igProbabilistic_ * PROBABILISTIC_MODEL(probability);
-          }
+        if (!isInFieldOfView(dir, normals, SQRT2 * disc)) {
+          continue;
+        }
+        if (cell.status == volumetric_mapping::OctomapManager::CellStatus::kUnknown) {
+          gain += params_.igUnmapped_;
+        } else if (cell.status == volumetric_mapping::OctomapManager::CellStatus::kOccupied) {
+          gain += params_.igOccupied_;
         } else {
-          // Rayshooting to evaluate inspectability of cell
-          if (volumetric_mapping::OctomapManager::CellStatus::kOccupied
-              != this->manager_->getVisibility(origin, vec, false)) {
-            gain += params_.igFree_;
-            // TODO: Add probabilistic gain
-            // gain += params_.igProbabilistic_ * PROBABILISTIC_MODEL(probability);
-          }
+          gain += params_.igFree_;
         }
       }
     }
   }
 // Scale with volume
   gain *= pow(disc, 3.0);
-// Check the gain added by inspectable surface
-  if (mesh_) {
-    tf::Transform transform;
-    transform.setOrigin(tf::Vector3(state.x(), state.y(), state.z()));
-    tf::Quaternion quaternion;
-    quaternion.setEuler(0.0, 0.0, state[3]);
-    transform.setRotation(quaternion);
-    gain += params_.igArea_ * mesh_->computeInspectableArea(transform);
-  }
   return gain;
 }
 
+void nbvInspection::RrtTree::getFovNormals(const StateVec& state, FovNormals* normals) const
+{
+  const Eigen::AngleAxisd rotation(state[3], Eigen::Vector3d::UnitZ());
+  normals->resize(params_.camBoundNormals_.size());
+  for (size_t i = 0; i < params_.camBoundNormals_.size(); i++) {
+    const std::vector<Eigen::Vector3d>& camBoundNormals = params_.camBoundNormals_[i];
+    (*normals)[i].resize(camBoundNormals.size());
+    for (size_t j = 0; j < camBoundNormals.size(); j++) {
+      (*normals)[i][j] = (rotation * camBoundNormals[j]).normalized();
+    }
+  }
+}
+
+bool nbvInspection::RrtTree::isInFieldOfView(const Eigen::Vector3d& dir,
+                                             const FovNormals& normals, double minDist) const
+{
+  for (typename FovNormals::const_iterator itCBN = normals.begin(); itCBN != normals.end();
+      itCBN++) {
+    bool inThisFieldOfView = true;
+    for (typename std::vector<Eigen::Vector3d>::const_iterator itSingleCBN = itCBN->begin();
+        itSingleCBN != itCBN->end(); itSingleCBN++) {
+      if (dir.dot(*itSingleCBN) < minDist) {
+        inThisFieldOfView = false;
+        break;
+      }
+    }
+    if (inThisFieldOfView) {
+      return true;
+    }
+  }
+  return false;
+}
+
+uint64_t nbvInspection::RrtTree::getGainCacheKey(const StateVec& state) const
+{
+// 16 bits per voxel coordinate and for the yaw bin
+  const double discInv = 1.0 / manager_->getResolution();
+  const uint64_t ix = (uint64_t) ((int64_t) floor(state[0] * discInv)) & 0xFFFF;
+  const uint64_t iy = (uint64_t) ((int64_t) floor(state[1] * discInv)) & 0xFFFF;
+  const uint64_t iz = (uint64_t) ((int64_t) floor(state[2] * discInv)) & 0xFFFF;
+  const double yaw = state[3] - 2.0 * M_PI * floor(state[3] / (2.0 * M_PI));  // [0, 2pi)
+  const uint64_t iyaw = ((uint64_t) (yaw * params_.gainCacheYawBins_ / (2.0 * M_PI)))
+      % params_.gainCacheYawBins_;
+  return (ix << 48) | (iy << 32) | (iz << 16) | iyaw;
+}
+
 std::vector<geometry_msgs::Pose> nbvInspection::RrtTree::getPathBackToPrevious(
     std::string targetFrame)
 {
@@ -609,6 +926,7 @@ std::vector<geometry_msgs::Pose> nbvInspection::RrtTree::getPathBackToPrevious(
     return ret;
   }
   ret = samplePath(root_, history_.top(), targetFrame);
+  nextRootNode_ = NULL;  // going back, the current tree is not kept
   history_.pop();
   return ret;
 }
@@ -625,6 +943,17 @@ void nbvInspection::RrtTree::memorizeBestBranch()
 
 void nbvInspection::RrtTree::clear()
 {
+  if (params_.recedingHorizon_ && nextRootNode_ != NULL) {
+    // Keep the subtree of the next root: it replaces the previous best branch memory
+    std::vector<Node<StateVec> *>& siblings = nextRootNode_->parent_->children_;
+    siblings.erase(std::remove(siblings.begin(), siblings.end(), nextRootNode_), siblings.end());
+    nextRootNode_->parent_ = NULL;
+    delete retainedRoot_;
+    retainedRoot_ = nextRootNode_;
+    bestBranchMemory_.clear();
+  }
+  nextRootNode_ = NULL;
+
   delete rootNode_;
   rootNode_ = NULL;
 
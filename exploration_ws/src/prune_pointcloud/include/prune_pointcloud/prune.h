@@ -33,6 +33,15 @@ class Prune
   ros::Subscriber pointcloudSub_;
   tf::TransformListener tf_listener_;
   void loadParams();
+  // Prune the points of pointcloudIn (x, y, z float fields) within maxDist2_ of
+  // the agents directly on the message buffer: the coordinates of blocks of
+  // points are gathered into SoA arrays, tested against all the agents in
+  // vectorizable loops, and the surviving points (all their fields) are
+  // compacted into pointcloudOut. Returns false if the cloud has no float
+  // x, y, z fields.
+  bool pruneBuffer(const sensor_msgs::PointCloud2& pointcloudIn,
+                   const std::vector<tf::Vector3>& agents,
+                   sensor_msgs::PointCloud2& pointcloudOut) const;
   std::vector<std::string> vehicle_tf_frames_;
   double maxDist2_;
 };
@@ -24,8 +24,16 @@
 #include <sensor_msgs/PointCloud2.h>
 #include <geometry_msgs/PoseWithCovarianceStamped.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
 #define SQ(x) ((x)*(x))
 
+namespace {
+const size_t kBlockSize = 256;  // points tested together (SoA block)
+}
+
 PointcloudPruning::Prune::Prune(ros::NodeHandle& n)
     : n_(n)
 {
@@ -64,7 +72,13 @@ void PointcloudPruning::Prune::pointcloud(const sensor_msgs::PointCloud2::ConstP
     }
     agents.push_back(tf_transform.getOrigin());
   }
-  
+
+  sensor_msgs::PointCloud2::Ptr pointcloudOut(new sensor_msgs::PointCloud2);
+  if (pruneBuffer(*pointcloudIn, agents, *pointcloudOut)) {
+    pcl_publisher_.publish(pointcloudOut);
+    return;
+  }
+
   // Prepare pointcloud.
   pcl::PointCloud<pcl::PointXYZ>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZ>);
   pcl::fromROSMsg(*pointcloudIn, *cloud);
@@ -89,12 +103,111 @@ void PointcloudPruning::Prune::pointcloud(const sensor_msgs::PointCloud2::ConstP
   }
   
   // Publish pruned pointcloud
-  sensor_msgs::PointCloud2::Ptr pointcloudOut(new sensor_msgs::PointCloud2);
   pcl::toROSMsg(*cloud_pruned, *pointcloudOut);
   pointcloudOut->header = pointcloudIn->header;
   pcl_publisher_.publish(pointcloudOut);
 }
 
+bool PointcloudPruning::Prune::pruneBuffer(const sensor_msgs::PointCloud2& pointcloudIn,
+                                           const std::vector<tf::Vector3>& agents,
+                                           sensor_msgs::PointCloud2& pointcloudOut) const
+{
+  int offsets[3] = { -1, -1, -1 };
+  for (size_t i = 0; i < pointcloudIn.fields.size(); i++) {
+    const sensor_msgs::PointField& field = pointcloudIn.fields[i];
+    if (field.datatype != sensor_msgs::PointField::FLOAT32 || field.count == 0) {
+      continue;
+    }
+    if (field.name == "x") {
+      offsets[0] = field.offset;
+    } else if (field.name == "y") {
+      offsets[1] = field.offset;
+    } else if (field.name == "z") {
+      offsets[2] = field.offset;
+    }
+  }
+  const size_t pointStep = pointcloudIn.point_step;
+  for (int k = 0; k < 3; k++) {
+    if (offsets[k] < 0 || offsets[k] + sizeof(float) > pointStep) {
+      return false;
+    }
+  }
+  if (pointcloudIn.is_bigendian) {
+    return false;  // the coordinates are read as native floats
+  }
+
+  // Agent positions as floats, once per scan.
+  const size_t numAgents = agents.size();
+  std::vector<float> ax(numAgents), ay(numAgents), az(numAgents);
+  for (size_t j = 0; j < numAgents; j++) {
+    ax[j] = agents[j].x();
+    ay[j] = agents[j].y();
+    az[j] = agents[j].z();
+  }
+  const float maxDist2 = maxDist2_;
+
+  const size_t width = pointcloudIn.width;
+  const size_t numPoints = width * pointcloudIn.height;
+  if (numPoints > 0 &&
+      pointcloudIn.data.size() < (pointcloudIn.height - 1) * pointcloudIn.row_step + width * pointStep) {
+    ROS_ERROR("Pointcloud data size does not match its layout.");
+    return false;
+  }
+
+  pointcloudOut.header = pointcloudIn.header;
+  pointcloudOut.fields = pointcloudIn.fields;
+  pointcloudOut.is_bigendian = pointcloudIn.is_bigendian;
+  pointcloudOut.point_step = pointStep;
+  pointcloudOut.height = 1;
+  pointcloudOut.is_dense = true;  // the NaN points are removed
+  pointcloudOut.data.resize(numPoints * pointStep);
+
+  const uint8_t* in = pointcloudIn.data.data();
+  uint8_t* out = pointcloudOut.data.data();
+  float x[kBlockSize], y[kBlockSize], z[kBlockSize];
+  uint8_t keep[kBlockSize];
+  size_t numKept = 0;
+  for (size_t start = 0; start < numPoints; start += kBlockSize) {
+    const size_t n = std::min(kBlockSize, numPoints - start);
+
+    // Gather the coordinates of the block.
+    for (size_t i = 0; i < n; i++) {
+      const size_t index = start + i;
+      const uint8_t* point = in + (index / width) * pointcloudIn.row_step + (index % width) * pointStep;
+      memcpy(&x[i], point + offsets[0], sizeof(float));
+      memcpy(&y[i], point + offsets[1], sizeof(float));
+      memcpy(&z[i], point + offsets[2], sizeof(float));
+    }
+
+    // Test the block against all the agents (branch-free, vectorizable).
+    for (size_t i = 0; i < n; i++) {
+      keep[i] = std::isfinite(x[i]) & std::isfinite(y[i]) & std::isfinite(z[i]);
+    }
+    for (size_t j = 0; j < numAgents; j++) {
+      const float px = ax[j], py = ay[j], pz = az[j];
+      for (size_t i = 0; i < n; i++) {
+        const float d2 = SQ(x[i] - px) + SQ(y[i] - py) + SQ(z[i] - pz);
+        keep[i] &= (d2 >= maxDist2);
+      }
+    }
+
+    // Compact the surviving points.
+    for (size_t i = 0; i < n; i++) {
+      if (keep[i]) {
+        const size_t index = start + i;
+        const uint8_t* point = in + (index / width) * pointcloudIn.row_step + (index % width) * pointStep;
+        memcpy(out + numKept * pointStep, point, pointStep);
+        numKept++;
+      }
+    }
+  }
+
+  pointcloudOut.data.resize(numKept * pointStep);
+  pointcloudOut.width = numKept;
+  pointcloudOut.row_step = numKept * pointStep;
+  return true;
+}
+
 void PointcloudPruning::Prune::loadParams()
 {
   std::string ns = ros::this_node::getName();
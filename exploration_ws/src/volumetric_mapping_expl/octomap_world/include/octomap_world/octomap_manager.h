@@ -70,6 +70,11 @@ namespace volumetric_mapping
             const stereo_msgs::DisparityImageConstPtr &disparity);
         void insertPointcloudWithTf(
             const sensor_msgs::PointCloud2::ConstPtr &pointcloud);
+        // First phase of insertPointcloudWithTf() (see computePointcloudUpdate()):
+        // it does not lock interaction_mutex; false if the TF is not available.
+        bool computePointcloudUpdateWithTf(
+            const sensor_msgs::PointCloud2::ConstPtr &pointcloud,
+            PointcloudUpdate *update);
 
         // Camera info callbacks.
         void leftCameraInfoCallback(const sensor_msgs::CameraInfoPtr &left_info);
@@ -34,7 +34,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define PCL_NO_PRECOMPILE
 #endif 
 
+#include <cmath>
 #include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+#include <eigen3/Eigen/Geometry>
 
 #include <octomap/octomap.h>
 #include <octomap_msgs/Octomap.h>
@@ -57,7 +63,11 @@ struct OctomapParameters {
         visualize_min_z(-std::numeric_limits<double>::max()),
         visualize_max_z(std::numeric_limits<double>::max()),
         treat_unknown_as_occupied(true),
-        change_detection_enabled(false) {
+        change_detection_enabled(false),
+        integration_num_threads(1),
+        bundle_rays(false),
+        bisect_path_collision_check(false),
+        query_num_threads(1) {
     // Set reasonable defaults here...
   }
 
@@ -91,6 +101,21 @@ struct OctomapParameters {
 
   // Whether to track changes -- must be set to true to use getChangedPoints().
   bool change_detection_enabled;
+
+  // Number of threads casting the rays of an inserted pointcloud.
+  int integration_num_threads;
+  // Cast a single ray also for the points beyond the sensor range ending (once
+  // truncated) in the same voxel: the rays of the points ending in the same
+  // voxel within the range are always bundled.
+  bool bundle_rays;
+
+  // Check the poses of a path coarse-to-fine (first, last, then bisection)
+  // instead of in time order: faster when a path collides early or late.
+  bool bisect_path_collision_check;
+
+  // Number of threads evaluating the batch queries (e.g.
+  // getCellStatusBoundingBoxBatch()).
+  int query_num_threads;
 };
 
 // A wrapper around octomap that allows insertion from various ROS message
@@ -108,6 +133,65 @@ class OctomapWorld : public WorldBase {
  public:
      
      static const float kMinTanAngleForFreeVoxelLineOfSight; 
+     static const int kChangeBlockBits;  // change tracking blocks of 2^kChangeBlockBits voxels per side
+
+  // Voxel walked by castVisibilityRay().
+  struct RayCell {
+    octomap::OcTreeKey key;
+    Eigen::Vector3d center;
+    CellStatus status;
+    double probability;  // occupancy probability, -1 if unknown
+  };
+
+  // Map update computed from a pointcloud (see computePointcloudUpdate()).
+  struct PointcloudUpdate {
+    pcl::PointCloud<pcl::PointXYZ>::Ptr cloud;  // in the world frame
+    octomap::KeySet free_cells;
+    octomap::KeySet occupied_cells;
+  };
+
+  // Leaves of the map updated after a map version (see getMapDeltaSince()),
+  // as voxel keys with their log-odds: they can be merged into the map of a
+  // teammate with mergeMapDelta().
+  struct MapDelta {
+    uint64_t from_version;
+    uint64_t to_version;  // map version of the delta
+    bool full;  // the map was reset after from_version: all the leaves
+    std::vector<octomap::OcTreeKey> keys;
+    std::vector<float> log_odds;
+
+    MapDelta() : from_version(0), to_version(0), full(false) {}
+  };
+
+  // Dense copy of the voxels of a box (see getOccupancySnapshot()): it is read
+  // without the octree, hence without locking it. Voxel indices are
+  // floor(coordinate / resolution), as the octree keys without their offset.
+  struct OccupancySnapshot {
+    int min_voxel[3];  // index of the first voxel along x, y, z
+    int size[3];       // number of voxels along x, y, z
+    double resolution;
+    std::vector<uint8_t> status;     // CellStatus of each voxel (x fastest)
+    std::vector<float> probability;  // occupancy probability, -1 if unknown
+
+    OccupancySnapshot() : resolution(0) {
+      min_voxel[0] = min_voxel[1] = min_voxel[2] = 0;
+      size[0] = size[1] = size[2] = 0;
+    }
+    int coordToVoxel(double coordinate) const {
+      return (int)floor(coordinate / resolution);
+    }
+    // Position in status/probability of a voxel, -1 if it is out of the box.
+    int getIndex(int vx, int vy, int vz) const {
+      vx -= min_voxel[0];
+      vy -= min_voxel[1];
+      vz -= min_voxel[2];
+      if (vx < 0 || vy < 0 || vz < 0 || vx >= size[0] || vy >= size[1] ||
+          vz >= size[2]) {
+        return -1;
+      }
+      return (vz * size[1] + vy) * size[0] + vx;
+    }
+  };
 
  public:
   // Default constructor - creates a valid octree using parameter defaults.
@@ -143,9 +227,51 @@ class OctomapWorld : public WorldBase {
   virtual CellStatus getVisibility(const Eigen::Vector3d& view_point,
                                    const Eigen::Vector3d& voxel_to_test,
                                    bool stop_at_unknown_cell) const;
+  // Walks once the voxels of the ray from view_point to end_point (the voxel
+  // of end_point excluded, as in computeRayKeys()) and stores them in order
+  // into cells until the first occupied voxel (included): these are the voxels
+  // visible from view_point along the ray (unknown voxels do not stop it).
+  // key_ray is a scratch buffer: pass the same one for casting many rays.
+  void castVisibilityRay(const Eigen::Vector3d& view_point,
+                         const Eigen::Vector3d& end_point,
+                         octomap::KeyRay* key_ray,
+                         std::vector<RayCell>* cells) const;
   virtual CellStatus getLineStatusBoundingBox(
       const Eigen::Vector3d& start, const Eigen::Vector3d& end,
       const Eigen::Vector3d& bounding_box_size) const;
+  // Copies the voxels of the box [min_point, max_point] into snapshot (the
+  // voxels of coarse leaves are expanded, the missing ones are unknown).
+  // Returns false if the box has more than max_num_voxels voxels.
+  bool getOccupancySnapshot(const Eigen::Vector3d& min_point,
+                            const Eigen::Vector3d& max_point,
+                            size_t max_num_voxels,
+                            OccupancySnapshot* snapshot) const;
+  // Swept-box line status: the keys of the lines of getLineStatusBoundingBox()
+  // are collected once, deduplicated and searched in Morton (octree) order,
+  // so that each voxel covered by the box along the segment is queried once.
+  // Returns the status of the first non-free voxel in that order (hence any
+  // non-free voxel makes the result non-free, as for the ray-by-ray check).
+  CellStatus getLineStatusSweptBox(const Eigen::Vector3d& start,
+                                   const Eigen::Vector3d& end,
+                                   const Eigen::Vector3d& bounding_box_size) const;
+  // Batch queries: (*statuses)[i] is the result of the single query with the
+  // i-th input. The queries are evaluated in the Morton (octree) order of the
+  // voxel of their (first) point, so that consecutive queries descend the same
+  // branches of the octree, in parallel with query_num_threads. They only read
+  // the map: lock it once around a batch instead of once per query.
+  void getCellStatusBoundingBoxBatch(
+      const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& points,
+      const Eigen::Vector3d& bounding_box_size,
+      std::vector<CellStatus>* statuses) const;
+  void getLineStatusBoundingBoxBatch(
+      const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& starts,
+      const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& ends,
+      const Eigen::Vector3d& bounding_box_size,
+      std::vector<CellStatus>* statuses) const;
+  void getVisibilityBatch(
+      const Eigen::Vector3d& view_point,
+      const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& voxels_to_test,
+      bool stop_at_unknown_cell, std::vector<CellStatus>* statuses) const;
   virtual void getOccupiedPointcloudInBoundingBox(
       const Eigen::Vector3d& center, const Eigen::Vector3d& bounding_box_size,
       pcl::PointCloud<pcl::PointXYZ>* output_cloud) const;
@@ -177,6 +303,13 @@ class OctomapWorld : public WorldBase {
   bool loadOctomapFromFile(const std::string& filename);
   bool writeOctomapToFile(const std::string& filename);
 
+  // Moves the whole map by the rigid transform T_new_old (e.g. to align a map
+  // loaded from a file with the current map frame). Each voxel of the new map
+  // takes the log-odds of the old voxel at its (inversely transformed) center,
+  // hence rotations leave no holes. It visits the voxels of the bounding box of
+  // the transformed map: it is meant for one-off alignments.
+  void transformMap(const Eigen::Affine3d& T_new_old);
+
   // Helpers for publishing.
   void generateMarkerArray(const std::string& tf_frame,
                            visualization_msgs::MarkerArray* occupied_nodes,
@@ -193,6 +326,35 @@ class OctomapWorld : public WorldBase {
                         std::vector<bool>* changed_states);
 
   pcl::PointCloud<pcl::PointXYZ>::Ptr getLastIntegratedPointcloud() { return last_integrated_pointcloud_; } 
+
+  // Map change tracking (used for caching the exploration gains): each map
+  // update increments the map version and stamps with it the blocks of the
+  // updated voxels; a reset or a replacement of the whole map changes all the
+  // blocks.
+  uint64_t getMapVersion() const { return map_version_; }
+  // True if some voxel within the box [min_point, max_point] may have been
+  // updated after the map version.
+  bool isBoxChangedSince(const Eigen::Vector3d& min_point,
+                         const Eigen::Vector3d& max_point,
+                         uint64_t version) const;
+
+  // Map deltas: the leaves updated by the sensor data inserted into this map
+  // (not by merged deltas, so that a delta is not echoed back) after the
+  // version; coarse leaves are expanded to voxels. If the map was reset after
+  // the version, the delta is the whole map.
+  void getMapDeltaSince(uint64_t version, MapDelta* delta) const;
+  // Sets the leaves of a delta with setNodeValue() and lazy evaluation: this
+  // costs O(leaves) instead of O(points x ray length) of the scan insertion.
+  void mergeMapDelta(const MapDelta& delta);
+
+  // Two-phase pointcloud insertion: computePointcloudUpdate() casts the rays
+  // (the expensive part) and reads only the octree key parameters, hence it
+  // can run concurrently with the map queries; applyPointcloudUpdate() is the
+  // only phase updating the map (O(update cells)). The cloud is consumed.
+  void computePointcloudUpdate(const Transformation& T_G_sensor,
+                               const pcl::PointCloud<pcl::PointXYZ>::Ptr& cloud,
+                               PointcloudUpdate* update) const;
+  void applyPointcloudUpdate(PointcloudUpdate* update);
   
  protected:
   // Actual implementation for inserting disparity data.
@@ -207,6 +369,24 @@ class OctomapWorld : public WorldBase {
   // Check if the node at the specified key has neighbors or not.
   bool isSpeckleNode(const octomap::OcTreeKey& key) const;
 
+  // Key of the voxels containing coordinate, clamped to the range of the tree.
+  octomap::key_type coordToKeyClamped(double coordinate) const;
+  // Indices of the points sorted by the Morton code of their (clamped) key.
+  void getMortonOrder(
+      const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& points,
+      std::vector<size_t>* order) const;
+  // Returns true if the subtree of node (at depth, with the smallest key
+  // min_key) has an occupied voxel (not a speckle) in the key box
+  // [bbx_min_key, bbx_max_key]. Sets unknown_found if the box has unknown
+  // voxels in the subtree; once it is set, only the subtrees which can contain
+  // an occupied voxel are visited. Requires up-to-date inner nodes.
+  bool searchOccupiedInKeyBox(const octomap::OcTreeNode* node,
+                              unsigned int depth,
+                              const octomap::OcTreeKey& min_key,
+                              const octomap::OcTreeKey& bbx_min_key,
+                              const octomap::OcTreeKey& bbx_max_key,
+                              bool* unknown_found) const;
+
   // Manually affect the probabilities of areas within a bounding box.
   void setLogOddsBoundingBox(const Eigen::Vector3d& position,
                              const Eigen::Vector3d& bounding_box_size,
@@ -216,8 +396,27 @@ class OctomapWorld : public WorldBase {
   void castRay(const octomap::point3d& sensor_origin,
                const octomap::point3d& point, octomap::KeySet* free_cells,
                octomap::KeySet* occupied_cells) const;
+  // Casts the rays of a pointcloud (in the world frame): in parallel with
+  // integration_num_threads, bundling the rays ending in the same voxel.
+  void castRays(const octomap::point3d& sensor_origin,
+                const pcl::PointCloud<pcl::PointXYZ>& cloud,
+                octomap::KeySet* free_cells,
+                octomap::KeySet* occupied_cells) const;
   void updateOccupancy(octomap::KeySet* free_cells,
                        octomap::KeySet* occupied_cells);
+  // Updates (and prunes) the inner nodes above the cells updated lazily, from
+  // the bottom up.
+  void updateInnerNodes(const octomap::KeySet& free_cells,
+                        const octomap::KeySet& occupied_cells);
+
+  // Change tracking: stamp the blocks of the keys with the current version.
+  void markChangedKeys(const octomap::KeySet& keys);
+  // Change tracking: the whole map has changed.
+  void markMapChanged();
+  uint64_t getChangeBlockKey(unsigned int bx, unsigned int by,
+                             unsigned int bz) const {
+    return (uint64_t(bx) << 32) | (uint64_t(by) << 16) | uint64_t(bz);
+  }
   bool isValidPoint(const cv::Vec3f& point) const;
 
   void setOctomapFromBinaryMsg(const octomap_msgs::Octomap& msg);
@@ -227,6 +426,31 @@ class OctomapWorld : public WorldBase {
 
   // Collision checking methods.
   bool checkSinglePoseCollision(const Eigen::Vector3d& robot_position) const;
+  // Voxel -> collision, for the swept volume of a path.
+  typedef std::unordered_map<octomap::OcTreeKey, bool,
+                             octomap::OcTreeKey::KeyHash> KeyCollisionMap;
+  // Same as above, looking up only the voxels of the box which are not in
+  // collision_cache yet (and adding them).
+  bool checkSinglePoseCollision(const Eigen::Vector3d& robot_position,
+                                KeyCollisionMap* collision_cache) const;
+  bool isVoxelInCollision(const octomap::OcTreeKey& key) const;
+  // Order in which the poses of a path are checked.
+  void getPathCheckOrder(size_t num_poses, bool bisect,
+                         std::vector<size_t>* order) const;
+
+  // Occupied voxel index: the keys (at the max depth) of the occupied voxels,
+  // bucketed in blocks of 2^kOccupiedBlockBits voxels per side. It is updated
+  // with the cells of each insertion; when the whole map changes it is
+  // invalidated, and rebuilt from the leaves by the next query (not thread
+  // safe, even from the const queries).
+  typedef std::unordered_map<octomap::OcTreeKey, octomap::KeySet,
+                             octomap::OcTreeKey::KeyHash> OccupiedBlockMap;
+  void updateOccupiedIndex(const octomap::OcTreeKey& key, bool occupied);
+  void invalidateOccupiedIndex();
+  void buildOccupiedIndex() const;
+  void insertOccupiedVoxel(const octomap::OcTreeKey& key) const;
+  bool isVoxelOccupiedInIndex(const octomap::OcTreeKey& key) const;
+  static octomap::OcTreeKey getOccupiedBlockKey(const octomap::OcTreeKey& key);
 
   std_msgs::ColorRGBA percentToColor(double h) const;
 
@@ -239,6 +463,19 @@ class OctomapWorld : public WorldBase {
 
   // a copy of the last integrated point cloud (rotated in the world frame)
   pcl::PointCloud<pcl::PointXYZ>::Ptr last_integrated_pointcloud_; 
+
+  // Change tracking.
+  uint64_t map_version_;
+  uint64_t map_reset_version_;  // version of the last change of the whole map
+  std::unordered_map<uint64_t, uint64_t> block_versions_;  // block -> version
+  // Blocks updated by the inserted sensor data only (for the map deltas).
+  std::unordered_map<uint64_t, uint64_t> own_block_versions_;
+
+  // Occupied voxel index (see buildOccupiedIndex()).
+  static const int kOccupiedBlockBits;
+  mutable OccupiedBlockMap occupied_blocks_;
+  mutable size_t num_occupied_voxels_;
+  mutable bool occupied_index_valid_;
 };
 
 }  // namespace volumetric_mapping
@@ -32,6 +32,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <glog/logging.h>
 #include <minkindr_conversions/kindr_tf.h>
 #include <minkindr_conversions/kindr_msg.h>
+#include <pcl_conversions/pcl_conversions.h>
 
 namespace volumetric_mapping
 {
@@ -113,6 +114,14 @@ namespace volumetric_mapping
                       params.treat_unknown_as_occupied);
     nh_private_.param("change_detection_enabled", params.change_detection_enabled,
                       params.change_detection_enabled);
+    nh_private_.param("integration_num_threads", params.integration_num_threads,
+                      params.integration_num_threads);
+    nh_private_.param("bundle_rays", params.bundle_rays, params.bundle_rays);
+    nh_private_.param("bisect_path_collision_check",
+                      params.bisect_path_collision_check,
+                      params.bisect_path_collision_check);
+    nh_private_.param("query_num_threads", params.query_num_threads,
+                      params.query_num_threads);
 
     // Try to initialize Q matrix from parameters, if available.
     std::vector<double> Q_vec;
@@ -377,6 +386,25 @@ namespace volumetric_mapping
 	file.close();*/
   }
 
+  bool OctomapManager::computePointcloudUpdateWithTf(
+      const sensor_msgs::PointCloud2::ConstPtr &pointcloud,
+      PointcloudUpdate *update)
+  {
+    // Look up transform from sensor frame to world frame.
+    Transformation sensor_to_world;
+    if (!lookupTransform(pointcloud->header.frame_id, world_frame_,
+                         pointcloud->header.stamp, &sensor_to_world))
+    {
+      return false;
+    }
+
+    pcl::PointCloud<pcl::PointXYZ>::Ptr pointcloud_pcl(
+        new pcl::PointCloud<pcl::PointXYZ>);
+    pcl::fromROSMsg(*pointcloud, *pointcloud_pcl);
+    computePointcloudUpdate(sensor_to_world, pointcloud_pcl, update);
+    return true;
+  }
+
   bool OctomapManager::lookupTransform(const std::string &from_frame,
                                        const std::string &to_frame,
                                        const ros::Time &timestamp,
@@ -29,6 +29,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "octomap_world/octomap_world.h"
 
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <utility>
+#include <vector>
+
 #include <glog/logging.h>
 #include <octomap_msgs/conversions.h>
 #include <octomap_ros/conversions.h>
@@ -38,6 +45,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 
 #define USE_NEW_FREE_SPACE_MANAGEMENT 1 
+#define USE_SWEPT_BOX_LINE_STATUS 1  // getLineStatusBoundingBox() queries once each voxel of the swept box 
 
 namespace volumetric_mapping {
 
@@ -49,7 +57,91 @@ Eigen::Vector3d pointOctomapToEigen(const octomap::point3d& point) {
   return Eigen::Vector3d(point.x(), point.y(), point.z());
 }
 
+// Morton code (bit interleaving) of the 16 bit octree keys: sorting the keys
+// by their code visits the voxels in the octree order.
+inline uint64_t spreadKeyBits(uint64_t x) {
+  x &= 0xffff;
+  x = (x | (x << 16)) & 0x0000ff0000ffULL;
+  x = (x | (x << 8)) & 0x00f00f00f00fULL;
+  x = (x | (x << 4)) & 0x0c30c30c30c3ULL;
+  x = (x | (x << 2)) & 0x249249249249ULL;
+  return x;
+}
+inline uint64_t compactKeyBits(uint64_t x) {
+  x &= 0x249249249249ULL;
+  x = (x | (x >> 2)) & 0x0c30c30c30c3ULL;
+  x = (x | (x >> 4)) & 0x00f00f00f00fULL;
+  x = (x | (x >> 8)) & 0x0000ff0000ffULL;
+  x = (x | (x >> 16)) & 0xffffULL;
+  return x;
+}
+inline uint64_t keyToMortonCode(const octomap::OcTreeKey& key) {
+  return spreadKeyBits(key[0]) | (spreadKeyBits(key[1]) << 1) |
+         (spreadKeyBits(key[2]) << 2);
+}
+inline octomap::OcTreeKey mortonCodeToKey(uint64_t code) {
+  return octomap::OcTreeKey(compactKeyBits(code), compactKeyBits(code >> 1),
+                            compactKeyBits(code >> 2));
+}
+
+// Morton codes of the keys of a set, sorted.
+void keySetToSortedCodes(const octomap::KeySet& keys,
+                         std::vector<uint64_t>* codes) {
+  codes->clear();
+  codes->reserve(keys.size());
+  for (const octomap::OcTreeKey& key : keys) {
+    codes->push_back(keyToMortonCode(key));
+  }
+  std::sort(codes->begin(), codes->end());
+}
+// Merges sorted runs of codes without duplicates into (*runs)[0]: pairwise,
+// the merges of each round run in parallel.
+void mergeSortedRuns(int num_threads, std::vector<std::vector<uint64_t> >* runs) {
+  for (size_t step = 1; step < runs->size(); step *= 2) {
+    const int num_merges = (runs->size() + 2 * step - 1) / (2 * step);
+#pragma omp parallel for num_threads(num_threads) if (num_threads > 1 && num_merges > 1)
+    for (int m = 0; m < num_merges; ++m) {
+      const size_t i = 2 * step * m;
+      const size_t j = i + step;
+      if (j >= runs->size()) {
+        continue;
+      }
+      std::vector<uint64_t> merged;
+      merged.reserve((*runs)[i].size() + (*runs)[j].size());
+      std::set_union((*runs)[i].begin(), (*runs)[i].end(), (*runs)[j].begin(),
+                     (*runs)[j].end(), std::back_inserter(merged));
+      (*runs)[i].swap(merged);
+      std::vector<uint64_t>().swap((*runs)[j]);
+    }
+  }
+}
+// Inserts the keys of the merged runs (see mergeSortedRuns()) into keys.
+void sortedCodesToKeySet(const std::vector<std::vector<uint64_t> >& runs,
+                         octomap::KeySet* keys) {
+  if (runs.empty()) {
+    return;
+  }
+  keys->reserve(keys->size() + runs[0].size());
+  for (uint64_t code : runs[0]) {
+    keys->insert(mortonCodeToKey(code));
+  }
+}
+
+// Runs query(i) for each index of order, in that order split into contiguous
+// chunks between the threads.
+template <typename Query>
+void runOrderedQueries(const std::vector<size_t>& order, int num_threads,
+                       const Query& query) {
+  const int num_queries = order.size();
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic, 16) if (num_threads > 1 && num_queries > 16)
+  for (int i = 0; i < num_queries; ++i) {
+    query(order[i]);
+  }
+}
+
 const float OctomapWorld::kMinTanAngleForFreeVoxelLineOfSight = tan(7 *M_PI/180.); 
+const int OctomapWorld::kChangeBlockBits = 4;  // 16 voxels
+const int OctomapWorld::kOccupiedBlockBits = 4;  // 16 voxels
      
 
 // Create a default parameters object and call the other constructor with it.
@@ -57,7 +149,11 @@ OctomapWorld::OctomapWorld() : OctomapWorld(OctomapParameters()) {}
 
 // Creates an octomap with the correct parameters.
 OctomapWorld::OctomapWorld(const OctomapParameters& params)
-    : robot_size_(Eigen::Vector3d::Zero()) {
+    : robot_size_(Eigen::Vector3d::Zero()),
+      map_version_(1),  // a version 0 is older than any map
+      map_reset_version_(1),
+      num_occupied_voxels_(0),
+      occupied_index_valid_(false) {
   setOctomapParameters(params);
 }
 
@@ -66,6 +162,7 @@ void OctomapWorld::resetMap() {
     octree_.reset(new octomap::OcTree(params_.resolution));
   }
   octree_->clear();
+  markMapChanged();
 }
 
 void OctomapWorld::prune(){ 
@@ -81,6 +178,7 @@ void OctomapWorld::setOctomapParameters(const OctomapParameters& params) {
     if (octree_->getResolution() != params.resolution) {
       LOG(WARNING) << "Octomap resolution has changed! Resetting tree!";
       octree_.reset(new octomap::OcTree(params.resolution));
+      markMapChanged();
     }  
   } else {
     octree_.reset(new octomap::OcTree(params.resolution));
@@ -93,6 +191,9 @@ void OctomapWorld::setOctomapParameters(const OctomapParameters& params) {
   octree_->setOccupancyThres(params.threshold_occupancy);
   octree_->enableChangeDetection(params.change_detection_enabled);
 
+  // The occupancy threshold may have changed.
+  invalidateOccupiedIndex();
+
   // Copy over all the parameters for future use (some are not used just for
   // creating the octree).
   params_ = params;
@@ -101,6 +202,16 @@ void OctomapWorld::setOctomapParameters(const OctomapParameters& params) {
 void OctomapWorld::insertPointcloudIntoMapImpl(
     const Transformation& T_G_sensor,
     const pcl::PointCloud<pcl::PointXYZ>::Ptr& cloud) {
+  PointcloudUpdate update;
+  computePointcloudUpdate(T_G_sensor, cloud, &update);
+  applyPointcloudUpdate(&update);
+}
+
+void OctomapWorld::computePointcloudUpdate(
+    const Transformation& T_G_sensor,
+    const pcl::PointCloud<pcl::PointXYZ>::Ptr& cloud,
+    PointcloudUpdate* update) const {
+  CHECK_NOTNULL(update);
   // Remove NaN values, if any.
   std::vector<int> indices;
   pcl::removeNaNFromPointCloud(*cloud, *cloud, indices);
@@ -108,29 +219,25 @@ void OctomapWorld::insertPointcloudIntoMapImpl(
   // First, rotate the pointcloud into the world frame.
   pcl::transformPointCloud(*cloud, *cloud,
                            T_G_sensor.getTransformationMatrix());
-  // Let's store a copy of the last integrated point cloud (rotated in the world frame)
-  last_integrated_pointcloud_ = cloud;
+  update->cloud = cloud;
   const octomap::point3d p_G_sensor =
       pointEigenToOctomap(T_G_sensor.getPosition());
 
   // Then add all the rays from this pointcloud.
   // We do this as a batch operation - so first get all the keys in a set, then
   // do the update in batch.
-  octomap::KeySet free_cells, occupied_cells;
-  for (pcl::PointCloud<pcl::PointXYZ>::const_iterator it = cloud->begin();
-       it != cloud->end(); ++it) {
-    const octomap::point3d p_G_point(it->x, it->y, it->z);
-    // First, check if we've already checked this.
-    octomap::OcTreeKey key = octree_->coordToKey(p_G_point);
+  octomap::KeySet& free_cells = update->free_cells;
+  octomap::KeySet& occupied_cells = update->occupied_cells;
+  castRays(p_G_sensor, *cloud, &free_cells, &occupied_cells);
+}
 
-    if (occupied_cells.find(key) == occupied_cells.end()) {
-      // Check if this is within the allowed sensor range.
-      castRay(p_G_sensor, p_G_point, &free_cells, &occupied_cells);
-    }
-  }
+void OctomapWorld::applyPointcloudUpdate(PointcloudUpdate* update) {
+  CHECK_NOTNULL(update);
+  // Let's store a copy of the last integrated point cloud (rotated in the world frame)
+  last_integrated_pointcloud_ = update->cloud;
 
   // Apply the new free cells and occupied cells from
-  updateOccupancy(&free_cells, &occupied_cells);
+  updateOccupancy(&update->free_cells, &update->occupied_cells);
 }
 
 void OctomapWorld::insertProjectedDisparityIntoMapImpl(
@@ -226,6 +333,72 @@ void OctomapWorld::castRay(const octomap::point3d& sensor_origin,
   }
 }
 
+void OctomapWorld::castRays(const octomap::point3d& sensor_origin,
+                            const pcl::PointCloud<pcl::PointXYZ>& cloud,
+                            octomap::KeySet* free_cells,
+                            octomap::KeySet* occupied_cells) const {
+  CHECK_NOTNULL(free_cells);
+  CHECK_NOTNULL(occupied_cells);
+
+  // Ray bundling: a single ray is cast for all the points ending in the same
+  // voxel. With bundle_rays, this is done also for the points beyond the
+  // sensor range (by the voxel of their truncated end point).
+  std::vector<int> ray_indices;
+  ray_indices.reserve(cloud.size());
+  {
+    octomap::KeySet end_keys;
+    for (size_t i = 0; i < cloud.size(); ++i) {
+      const octomap::point3d point(cloud[i].x, cloud[i].y, cloud[i].z);
+      const bool in_range =
+          params_.sensor_max_range < 0.0 ||
+          (point - sensor_origin).norm() <= params_.sensor_max_range;
+      if (!in_range && !params_.bundle_rays) {
+        ray_indices.push_back(i);
+        continue;
+      }
+      const octomap::point3d end_point =
+          in_range ? point
+                   : sensor_origin + (point - sensor_origin).normalized() *
+                                         params_.sensor_max_range;
+      octomap::OcTreeKey key;
+      if (!octree_->coordToKeyChecked(end_point, key) ||
+          end_keys.insert(key).second) {
+        ray_indices.push_back(i);
+      }
+    }
+  }
+
+  // The rays are cast in parallel into per-thread key sets. Each thread sorts
+  // its keys (by Morton code) and the sorted runs are merged pairwise in
+  // parallel, dropping the duplicates: every key is inserted once in the
+  // output sets.
+  const int num_threads = std::max(params_.integration_num_threads, 1);
+  const int num_rays = ray_indices.size();
+  std::vector<std::vector<uint64_t> > free_runs, occupied_runs;
+#pragma omp parallel num_threads(num_threads) if (num_threads > 1)
+  {
+    octomap::KeySet thread_free_cells, thread_occupied_cells;
+#pragma omp for schedule(dynamic, 256)
+    for (int i = 0; i < num_rays; ++i) {
+      const pcl::PointXYZ& p = cloud[ray_indices[i]];
+      castRay(sensor_origin, octomap::point3d(p.x, p.y, p.z),
+              &thread_free_cells, &thread_occupied_cells);
+    }
+    std::vector<uint64_t> thread_free_run, thread_occupied_run;
+    keySetToSortedCodes(thread_free_cells, &thread_free_run);
+    keySetToSortedCodes(thread_occupied_cells, &thread_occupied_run);
+#pragma omp critical(octomap_world_cast_rays)
+    {
+      free_runs.push_back(std::move(thread_free_run));
+      occupied_runs.push_back(std::move(thread_occupied_run));
+    }
+  }
+  mergeSortedRuns(num_threads, &free_runs);
+  mergeSortedRuns(num_threads, &occupied_runs);
+  sortedCodesToKeySet(free_runs, free_cells);
+  sortedCodesToKeySet(occupied_runs, occupied_cells);
+}
+
 bool OctomapWorld::isValidPoint(const cv::Vec3f& point) const {
   // Check both for disparities explicitly marked as invalid (where OpenCV maps
   // pt.z to MISSING_Z) and zero disparities (point mapped to infinity).
@@ -237,11 +410,17 @@ void OctomapWorld::updateOccupancy(octomap::KeySet* free_cells,
   CHECK_NOTNULL(free_cells);
   CHECK_NOTNULL(occupied_cells);
 
+  // The leaves are updated lazily: their inner nodes are updated (and pruned)
+  // once at the end by updateInnerNodes(), instead of at each update or by a
+  // full octomap::OccupancyOcTreeBase::updateInnerOccupancy().
+  const bool lazy_eval = true;
+
   // Mark occupied cells.
   for (octomap::KeySet::iterator it = occupied_cells->begin(),
                                  end = occupied_cells->end();
        it != end; it++) {
-    octree_->updateNode(*it, true);
+    const octomap::OcTreeNode* node = octree_->updateNode(*it, true, lazy_eval);
+    updateOccupiedIndex(*it, octree_->isNodeOccupied(node));
 
     // Remove any occupied cells from free cells - assume there are far fewer
     // occupied cells than free cells, so this is much faster than checking on
@@ -255,9 +434,284 @@ void OctomapWorld::updateOccupancy(octomap::KeySet* free_cells,
   for (octomap::KeySet::iterator it = free_cells->begin(),
                                  end = free_cells->end();
        it != end; ++it) {
-    octree_->updateNode(*it, false);
+    const octomap::OcTreeNode* node = octree_->updateNode(*it, false, lazy_eval);
+    updateOccupiedIndex(*it, octree_->isNodeOccupied(node));
+  }
+  updateInnerNodes(*free_cells, *occupied_cells);
+
+  map_version_++;
+  markChangedKeys(*occupied_cells);
+  markChangedKeys(*free_cells);
+}
+
+void OctomapWorld::updateInnerNodes(const octomap::KeySet& free_cells,
+                                    const octomap::KeySet& occupied_cells) {
+  // The ancestor at depth d of a cell has the Morton code of the cell shifted
+  // by 3 * (tree_depth - d): the ancestors of a level are the unique shifted
+  // codes of the level below.
+  std::vector<uint64_t> codes;
+  codes.reserve(free_cells.size() + occupied_cells.size());
+  for (const octomap::OcTreeKey& key : free_cells) {
+    codes.push_back(keyToMortonCode(key));
+  }
+  for (const octomap::OcTreeKey& key : occupied_cells) {
+    codes.push_back(keyToMortonCode(key));
+  }
+  std::sort(codes.begin(), codes.end());
+
+  // Bottom-up, as octomap::OccupancyOcTreeBase::updateNodeRecurs() without
+  // lazy_eval: prune the node if possible, otherwise update its occupancy.
+  const int tree_depth = octree_->getTreeDepth();
+  for (int depth = tree_depth - 1; depth >= 0; --depth) {
+    for (uint64_t& code : codes) {
+      code >>= 3;
+    }
+    codes.erase(std::unique(codes.begin(), codes.end()), codes.end());
+    const int shift = 3 * (tree_depth - depth);
+    for (uint64_t code : codes) {
+      // search() with depth 0 goes down to the leaves.
+      octomap::OcTreeNode* node =
+          (depth == 0) ? octree_->getRoot()
+                       : octree_->search(mortonCodeToKey(code << shift), depth);
+      // A node without children is a leaf above depth (already pruned).
+      if (node == NULL || !octree_->nodeHasChildren(node)) {
+        continue;
+      }
+      if (!octree_->pruneNode(node)) {
+        node->updateOccupancyChildren();
+      }
+    }
+  }
+}
+
+void OctomapWorld::updateOccupiedIndex(const octomap::OcTreeKey& key,
+                                       bool occupied) {
+  if (!occupied_index_valid_) {
+    return;  // Rebuilt from the leaves by the next query.
+  }
+  if (occupied) {
+    insertOccupiedVoxel(key);
+    return;
   }
+  OccupiedBlockMap::iterator block =
+      occupied_blocks_.find(getOccupiedBlockKey(key));
+  if (block != occupied_blocks_.end() && block->second.erase(key) > 0) {
+    --num_occupied_voxels_;
+    if (block->second.empty()) {
+      occupied_blocks_.erase(block);
+    }
+  }
+}
+
+void OctomapWorld::invalidateOccupiedIndex() {
+  occupied_index_valid_ = false;
+  occupied_blocks_.clear();
+  num_occupied_voxels_ = 0;
+}
+
+void OctomapWorld::buildOccupiedIndex() const {
+  if (occupied_index_valid_) {
+    return;
+  }
+  occupied_blocks_.clear();
+  num_occupied_voxels_ = 0;
+  const unsigned int tree_depth = octree_->getTreeDepth();
+  for (octomap::OcTree::leaf_iterator it = octree_->begin_leafs(),
+                                      end = octree_->end_leafs();
+       it != end; ++it) {
+    if (!octree_->isNodeOccupied(*it)) {
+      continue;
+    }
+    // A leaf above the max depth (pruned) covers 2^(tree_depth - depth)
+    // voxels per side, from its index key.
+    const unsigned int leaf_size = 1u << (tree_depth - it.getDepth());
+    const octomap::OcTreeKey min_key = it.getIndexKey();
+    octomap::OcTreeKey key;
+    for (unsigned int dz = 0; dz < leaf_size; ++dz) {
+      key[2] = min_key[2] + dz;
+      for (unsigned int dy = 0; dy < leaf_size; ++dy) {
+        key[1] = min_key[1] + dy;
+        for (unsigned int dx = 0; dx < leaf_size; ++dx) {
+          key[0] = min_key[0] + dx;
+          insertOccupiedVoxel(key);
+        }
+      }
+    }
+  }
+  occupied_index_valid_ = true;
+}
+
+void OctomapWorld::insertOccupiedVoxel(const octomap::OcTreeKey& key) const {
+  if (occupied_blocks_[getOccupiedBlockKey(key)].insert(key).second) {
+    ++num_occupied_voxels_;
+  }
+}
+
+bool OctomapWorld::isVoxelOccupiedInIndex(const octomap::OcTreeKey& key) const {
+  OccupiedBlockMap::const_iterator block =
+      occupied_blocks_.find(getOccupiedBlockKey(key));
+  return block != occupied_blocks_.end() && block->second.count(key) > 0;
+}
+
+octomap::OcTreeKey OctomapWorld::getOccupiedBlockKey(
+    const octomap::OcTreeKey& key) {
+  return octomap::OcTreeKey(key[0] >> kOccupiedBlockBits,
+                            key[1] >> kOccupiedBlockBits,
+                            key[2] >> kOccupiedBlockBits);
+}
+
+void OctomapWorld::markChangedKeys(const octomap::KeySet& keys) {
+  for (const octomap::OcTreeKey& key : keys) {
+    const uint64_t block_key = getChangeBlockKey(key[0] >> kChangeBlockBits,
+                                                 key[1] >> kChangeBlockBits,
+                                                 key[2] >> kChangeBlockBits);
+    block_versions_[block_key] = map_version_;
+    own_block_versions_[block_key] = map_version_;
+  }
+}
+
+void OctomapWorld::markMapChanged() {
+  map_version_++;
+  map_reset_version_ = map_version_;
+  block_versions_.clear();
+  own_block_versions_.clear();
+  invalidateOccupiedIndex();
+}
+
+void OctomapWorld::getMapDeltaSince(uint64_t version, MapDelta* delta) const {
+  CHECK_NOTNULL(delta);
+  delta->from_version = version;
+  delta->to_version = map_version_;
+  delta->full = (map_reset_version_ > version);
+  delta->keys.clear();
+  delta->log_odds.clear();
+
+  const int tree_depth = octree_->getTreeDepth();
+
+  // Appends the voxels of the leaf within the key range [min_key, max_key].
+  auto add_leaf = [&](const octomap::OcTree::iterator_base& it,
+                      const octomap::OcTreeKey& min_key,
+                      const octomap::OcTreeKey& max_key) {
+    const float log_odds = it->getLogOdds();
+    const octomap::OcTreeKey leaf_key = it.getKey();
+    // The key of a coarse leaf is the one of its center.
+    const int leaf_size = 1 << (tree_depth - it.getDepth());
+    int begin[3], end[3];
+    for (int i = 0; i < 3; ++i) {
+      begin[i] = std::max((int)leaf_key[i] - leaf_size / 2, (int)min_key[i]);
+      end[i] = std::min((int)leaf_key[i] - leaf_size / 2 + leaf_size - 1,
+                        (int)max_key[i]);
+    }
+    octomap::OcTreeKey key;
+    for (int kx = begin[0]; kx <= end[0]; ++kx) {
+      for (int ky = begin[1]; ky <= end[1]; ++ky) {
+        for (int kz = begin[2]; kz <= end[2]; ++kz) {
+          key[0] = kx;
+          key[1] = ky;
+          key[2] = kz;
+          delta->keys.push_back(key);
+          delta->log_odds.push_back(log_odds);
+        }
+      }
+    }
+  };
+
+  if (delta->full) {
+    const octomap::key_type kMaxKey =
+        std::numeric_limits<octomap::key_type>::max();
+    const octomap::OcTreeKey min_key(0, 0, 0);
+    const octomap::OcTreeKey max_key(kMaxKey, kMaxKey, kMaxKey);
+    for (octomap::OcTree::leaf_iterator it = octree_->begin_leafs(),
+                                        end = octree_->end_leafs();
+         it != end; ++it) {
+      add_leaf(it, min_key, max_key);
+    }
+    return;
+  }
+
+  const unsigned int kBlockSize = 1u << kChangeBlockBits;
+  for (const std::pair<const uint64_t, uint64_t>& block : own_block_versions_) {
+    if (block.second <= version) {
+      continue;
+    }
+    const octomap::OcTreeKey min_key(
+        ((block.first >> 32) & 0xffff) << kChangeBlockBits,
+        ((block.first >> 16) & 0xffff) << kChangeBlockBits,
+        (block.first & 0xffff) << kChangeBlockBits);
+    const octomap::OcTreeKey max_key(min_key[0] + kBlockSize - 1,
+                                     min_key[1] + kBlockSize - 1,
+                                     min_key[2] + kBlockSize - 1);
+    for (octomap::OcTree::leaf_bbx_iterator
+             it = octree_->begin_leafs_bbx(min_key, max_key),
+             end = octree_->end_leafs_bbx();
+         it != end; ++it) {
+      add_leaf(it, min_key, max_key);
+    }
+  }
+}
+
+void OctomapWorld::mergeMapDelta(const MapDelta& delta) {
+  if (delta.keys.empty() || (delta.keys.size() != delta.log_odds.size())) {
+    return;
+  }
+  const bool lazy_eval = true;
+  for (size_t i = 0; i < delta.keys.size(); ++i) {
+    const octomap::OcTreeNode* node =
+        octree_->setNodeValue(delta.keys[i], delta.log_odds[i], lazy_eval);
+    updateOccupiedIndex(delta.keys[i], octree_->isNodeOccupied(node));
+  }
+  // This is necessary since lazy_eval is set to true.
   octree_->updateInnerOccupancy();
+
+  // The merged blocks are changed for the gain caches, but not for the deltas
+  // of this map.
+  map_version_++;
+  for (const octomap::OcTreeKey& key : delta.keys) {
+    block_versions_[getChangeBlockKey(key[0] >> kChangeBlockBits,
+                                      key[1] >> kChangeBlockBits,
+                                      key[2] >> kChangeBlockBits)] =
+        map_version_;
+  }
+}
+
+bool OctomapWorld::isBoxChangedSince(const Eigen::Vector3d& min_point,
+                                     const Eigen::Vector3d& max_point,
+                                     uint64_t version) const {
+  if (map_reset_version_ > version) {
+    return true;
+  }
+  if (block_versions_.empty()) {
+    return false;
+  }
+
+  // Keys of the box corners, clamped to the octree range.
+  const octomap::key_type kMaxKey =
+      std::numeric_limits<octomap::key_type>::max();
+  octomap::OcTreeKey min_key, max_key;
+  for (int i = 0; i < 3; ++i) {
+    if (!octree_->coordToKeyChecked(min_point[i], min_key[i])) {
+      min_key[i] = (min_point[i] < 0) ? 0 : kMaxKey;
+    }
+    if (!octree_->coordToKeyChecked(max_point[i], max_key[i])) {
+      max_key[i] = (max_point[i] < 0) ? 0 : kMaxKey;
+    }
+  }
+
+  for (unsigned int bx = min_key[0] >> kChangeBlockBits;
+       bx <= (unsigned int)(max_key[0] >> kChangeBlockBits); ++bx) {
+    for (unsigned int by = min_key[1] >> kChangeBlockBits;
+         by <= (unsigned int)(max_key[1] >> kChangeBlockBits); ++by) {
+      for (unsigned int bz = min_key[2] >> kChangeBlockBits;
+           bz <= (unsigned int)(max_key[2] >> kChangeBlockBits); ++bz) {
+        std::unordered_map<uint64_t, uint64_t>::const_iterator it =
+            block_versions_.find(getChangeBlockKey(bx, by, bz));
+        if ((it != block_versions_.end()) && (it->second > version)) {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
 }
 
 OctomapWorld::CellStatus OctomapWorld::getCellStatusBoundingBox(
@@ -279,34 +733,102 @@ OctomapWorld::CellStatus OctomapWorld::getCellStatusBoundingBox(
     }
   }
 
-  // Now we have to iterate over everything in the bounding box.
+  // Now we have to check everything in the bounding box: the octree is
+  // descended once, pruning the subtrees outside of the box and, once an
+  // unknown voxel has been found, the subtrees which cannot contain an
+  // occupied voxel (an inner node holds the max log-odds of its children).
   Eigen::Vector3d bbx_min_eigen = point - bounding_box_size / 2;
   Eigen::Vector3d bbx_max_eigen = point + bounding_box_size / 2;
 
-  octomap::point3d bbx_min = pointEigenToOctomap(bbx_min_eigen);
-  octomap::point3d bbx_max = pointEigenToOctomap(bbx_max_eigen);
+  octomap::OcTreeKey bbx_min_key, bbx_max_key;
+  for (int i = 0; i < 3; ++i) {
+    bbx_min_key[i] = coordToKeyClamped(bbx_min_eigen[i]);
+    bbx_max_key[i] = coordToKeyClamped(bbx_max_eigen[i]);
+  }
 
-  for (octomap::OcTree::leaf_bbx_iterator
-           iter = octree_->begin_leafs_bbx(bbx_min, bbx_max),
-           end = octree_->end_leafs_bbx();
-       iter != end; ++iter) {
-    if (octree_->isNodeOccupied(*iter)) {
-      if (params_.filter_speckles && isSpeckleNode(iter.getKey())) {
-        continue;
-      } else {
-        return CellStatus::kOccupied;
+  const octomap::OcTreeNode* root = octree_->getRoot();
+  if (root == NULL) {
+    return CellStatus::kUnknown;
+  }
+  bool unknown_found = false;
+  if (searchOccupiedInKeyBox(root, 0, octomap::OcTreeKey(0, 0, 0),
+                             bbx_min_key, bbx_max_key, &unknown_found)) {
+    return CellStatus::kOccupied;
+  }
+  if (unknown_found) {
+    return CellStatus::kUnknown;
+  }
+  return CellStatus::kFree;
+}
+
+octomap::key_type OctomapWorld::coordToKeyClamped(double coordinate) const {
+  const double tree_max_val = 1 << (octree_->getTreeDepth() - 1);
+  const double scaled = std::min(
+      std::max(coordinate / octree_->getResolution(), -tree_max_val),
+      tree_max_val - 1);
+  return static_cast<octomap::key_type>(
+      static_cast<int>(std::floor(scaled)) + static_cast<int>(tree_max_val));
+}
+
+bool OctomapWorld::searchOccupiedInKeyBox(const octomap::OcTreeNode* node,
+                                          unsigned int depth,
+                                          const octomap::OcTreeKey& min_key,
+                                          const octomap::OcTreeKey& bbx_min_key,
+                                          const octomap::OcTreeKey& bbx_max_key,
+                                          bool* unknown_found) const {
+  const bool may_be_occupied = octree_->isNodeOccupied(node);
+  if (!may_be_occupied && *unknown_found) {
+    return false;
+  }
+  const unsigned int node_size = 1u << (octree_->getTreeDepth() - depth);
+  if (!octree_->nodeHasChildren(node)) {
+    if (!may_be_occupied) {
+      return false;
+    }
+    // Key of the center of the leaf, as the one of the leaf iterators.
+    octomap::OcTreeKey key = min_key;
+    if (node_size > 1) {
+      for (int i = 0; i < 3; ++i) {
+        key[i] += node_size / 2;
       }
     }
+    return !(params_.filter_speckles && isSpeckleNode(key));
   }
 
-  // The above only returns valid nodes - we should check for unknown nodes as
-  // well.
-  octomap::point3d_list unknown_centers;
-  octree_->getUnknownLeafCenters(unknown_centers, bbx_min, bbx_max);
-  if (unknown_centers.size() > 0) {
-    return CellStatus::kUnknown;
+  const unsigned int child_size = node_size / 2;
+  for (unsigned int child = 0; child < 8; ++child) {
+    // Same child indexing as octomap::computeChildIdx().
+    octomap::OcTreeKey child_min_key = min_key;
+    bool in_bbx = true;
+    for (int i = 0; i < 3; ++i) {
+      if (child & (1u << i)) {
+        child_min_key[i] += child_size;
+      }
+      const unsigned int child_max_key = child_min_key[i] + child_size - 1;
+      if (child_min_key[i] > bbx_max_key[i] || child_max_key < bbx_min_key[i]) {
+        in_bbx = false;
+      }
+    }
+    if (!in_bbx) {
+      continue;
+    }
+    if (!octree_->nodeChildExists(node, child)) {
+      *unknown_found = true;
+      if (!may_be_occupied) {
+        return false;
+      }
+      continue;
+    }
+    if (searchOccupiedInKeyBox(octree_->getNodeChild(node, child), depth + 1,
+                               child_min_key, bbx_min_key, bbx_max_key,
+                               unknown_found)) {
+      return true;
+    }
+    if (!may_be_occupied && *unknown_found) {
+      return false;
+    }
   }
-  return CellStatus::kFree;
+  return false;
 }
 
 OctomapWorld::CellStatus OctomapWorld::getCellStatusPoint(
@@ -392,9 +914,44 @@ OctomapWorld::CellStatus OctomapWorld::getVisibility(
   return CellStatus::kFree;
 }
 
+void OctomapWorld::castVisibilityRay(const Eigen::Vector3d& view_point,
+                                     const Eigen::Vector3d& end_point,
+                                     octomap::KeyRay* key_ray,
+                                     std::vector<RayCell>* cells) const {
+  cells->clear();
+  if (!octree_->computeRayKeys(pointEigenToOctomap(view_point),
+                               pointEigenToOctomap(end_point), *key_ray)) {
+    return;  // out of the octree range
+  }
+
+  for (const octomap::OcTreeKey& key : *key_ray) {
+    octomap::OcTreeNode* node = octree_->search(key);
+
+    RayCell cell;
+    cell.key = key;
+    cell.center = pointOctomapToEigen(octree_->keyToCoord(key));
+    if (node == NULL) {
+      cell.status = CellStatus::kUnknown;
+      cell.probability = -1.0;
+    } else {
+      cell.probability = node->getOccupancy();
+      cell.status = octree_->isNodeOccupied(node) ? CellStatus::kOccupied
+                                                  : CellStatus::kFree;
+    }
+    cells->push_back(cell);
+
+    if (cell.status == CellStatus::kOccupied) {
+      break;  // the voxels behind are not visible
+    }
+  }
+}
+
 OctomapWorld::CellStatus OctomapWorld::getLineStatusBoundingBox(
     const Eigen::Vector3d& start, const Eigen::Vector3d& end,
     const Eigen::Vector3d& bounding_box_size) const {
+#if USE_SWEPT_BOX_LINE_STATUS
+  return getLineStatusSweptBox(start, end, bounding_box_size);
+#else
   // TODO(helenol): Probably best way would be to get all the coordinates along
   // the line, then make a set of all the OcTreeKeys in all the bounding boxes
   // around the nodes... and then just go through and query once.
@@ -434,6 +991,188 @@ OctomapWorld::CellStatus OctomapWorld::getLineStatusBoundingBox(
     }
   }
   return CellStatus::kFree;
+#endif
+}
+
+bool OctomapWorld::getOccupancySnapshot(const Eigen::Vector3d& min_point,
+                                        const Eigen::Vector3d& max_point,
+                                        size_t max_num_voxels,
+                                        OccupancySnapshot* snapshot) const {
+  CHECK_NOTNULL(snapshot);
+  const double resolution = octree_->getResolution();
+  snapshot->resolution = resolution;
+
+  size_t num_voxels = 1;
+  for (int i = 0; i < 3; ++i) {
+    snapshot->min_voxel[i] = snapshot->coordToVoxel(min_point[i]);
+    snapshot->size[i] = std::max(
+        snapshot->coordToVoxel(max_point[i]) - snapshot->min_voxel[i] + 1, 1);
+    num_voxels *= snapshot->size[i];
+  }
+  if (num_voxels > max_num_voxels) {
+    snapshot->size[0] = snapshot->size[1] = snapshot->size[2] = 0;
+    snapshot->status.clear();
+    snapshot->probability.clear();
+    return false;
+  }
+
+  snapshot->status.assign(num_voxels, (uint8_t)CellStatus::kUnknown);
+  snapshot->probability.assign(num_voxels, -1.0f);
+
+  const octomap::point3d bbx_min = pointEigenToOctomap(min_point);
+  const octomap::point3d bbx_max = pointEigenToOctomap(max_point);
+  for (octomap::OcTree::leaf_bbx_iterator
+           it = octree_->begin_leafs_bbx(bbx_min, bbx_max),
+           end = octree_->end_leafs_bbx();
+       it != end; ++it) {
+    const uint8_t status = octree_->isNodeOccupied(*it)
+                               ? (uint8_t)CellStatus::kOccupied
+                               : (uint8_t)CellStatus::kFree;
+    const float probability = it->getOccupancy();
+
+    // Voxels covered by the leaf (a single one at the max depth).
+    const double half_size = 0.5 * it->getSize();
+    const int num_leaf_voxels = (int)floor(it->getSize() / resolution + 0.5);
+    const octomap::point3d center = it.getCoordinate();
+    const int vx0 = (int)floor((center.x() - half_size) / resolution + 0.5);
+    const int vy0 = (int)floor((center.y() - half_size) / resolution + 0.5);
+    const int vz0 = (int)floor((center.z() - half_size) / resolution + 0.5);
+    for (int vz = vz0; vz < vz0 + num_leaf_voxels; ++vz) {
+      for (int vy = vy0; vy < vy0 + num_leaf_voxels; ++vy) {
+        for (int vx = vx0; vx < vx0 + num_leaf_voxels; ++vx) {
+          const int index = snapshot->getIndex(vx, vy, vz);
+          if (index >= 0) {
+            snapshot->status[index] = status;
+            snapshot->probability[index] = probability;
+          }
+        }
+      }
+    }
+  }
+  return true;
+}
+
+OctomapWorld::CellStatus OctomapWorld::getLineStatusSweptBox(
+    const Eigen::Vector3d& start, const Eigen::Vector3d& end,
+    const Eigen::Vector3d& bounding_box_size) const {
+  const double epsilon = 0.001;  // Small offset
+  const double& resolution = getResolution();
+
+  // Same line offsets of the box as the ray-by-ray check.
+  double x_disc = bounding_box_size.x() /
+                  ceil((bounding_box_size.x() + epsilon) / resolution);
+  double y_disc = bounding_box_size.y() /
+                  ceil((bounding_box_size.y() + epsilon) / resolution);
+  double z_disc = bounding_box_size.z() /
+                  ceil((bounding_box_size.z() + epsilon) / resolution);
+
+  // Ensure that resolution is not infinit
+  if (x_disc <= 0.0) x_disc = 1.0;
+  if (y_disc <= 0.0) y_disc = 1.0;
+  if (z_disc <= 0.0) z_disc = 1.0;
+
+  const Eigen::Vector3d bounding_box_half_size = bounding_box_size * 0.5;
+  const octomap::point3d start_point = pointEigenToOctomap(start);
+  const octomap::point3d end_point = pointEigenToOctomap(end);
+
+  // Collect the keys of all the lines: the lines of neighboring offsets
+  // mostly cross the same voxels.
+  octomap::KeyRay key_ray;
+  std::vector<uint64_t> codes;
+  for (double x = -bounding_box_half_size.x(); x <= bounding_box_half_size.x();
+       x += x_disc) {
+    for (double y = -bounding_box_half_size.y();
+         y <= bounding_box_half_size.y(); y += y_disc) {
+      for (double z = -bounding_box_half_size.z();
+           z <= bounding_box_half_size.z(); z += z_disc) {
+        const octomap::point3d offset(x, y, z);
+        if (!octree_->computeRayKeys(start_point + offset, end_point + offset,
+                                     key_ray)) {
+          continue;  // out of the octree range (no keys, as in getLineStatus())
+        }
+        for (const octomap::OcTreeKey& key : key_ray) {
+          codes.push_back(keyToMortonCode(key));
+        }
+      }
+    }
+  }
+
+  // Query each voxel once, in octree order.
+  std::sort(codes.begin(), codes.end());
+  codes.erase(std::unique(codes.begin(), codes.end()), codes.end());
+  for (const uint64_t code : codes) {
+    octomap::OcTreeNode* node = octree_->search(mortonCodeToKey(code));
+    if (node == NULL) {
+      return CellStatus::kUnknown;
+    } else if (octree_->isNodeOccupied(node)) {
+      return CellStatus::kOccupied;
+    }
+  }
+  return CellStatus::kFree;
+}
+
+void OctomapWorld::getMortonOrder(
+    const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& points,
+    std::vector<size_t>* order) const {
+  std::vector<std::pair<uint64_t, size_t> > codes(points.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    octomap::OcTreeKey key;
+    for (int j = 0; j < 3; ++j) {
+      key[j] = coordToKeyClamped(points[i][j]);
+    }
+    codes[i] = std::make_pair(keyToMortonCode(key), i);
+  }
+  std::sort(codes.begin(), codes.end());
+  order->resize(points.size());
+  for (size_t i = 0; i < codes.size(); ++i) {
+    (*order)[i] = codes[i].second;
+  }
+}
+
+void OctomapWorld::getCellStatusBoundingBoxBatch(
+    const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& points,
+    const Eigen::Vector3d& bounding_box_size,
+    std::vector<CellStatus>* statuses) const {
+  CHECK_NOTNULL(statuses);
+  statuses->resize(points.size());
+  std::vector<size_t> order;
+  getMortonOrder(points, &order);
+  runOrderedQueries(order, std::max(params_.query_num_threads, 1),
+                    [&](size_t i) {
+    (*statuses)[i] = getCellStatusBoundingBox(points[i], bounding_box_size);
+  });
+}
+
+void OctomapWorld::getLineStatusBoundingBoxBatch(
+    const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& starts,
+    const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& ends,
+    const Eigen::Vector3d& bounding_box_size,
+    std::vector<CellStatus>* statuses) const {
+  CHECK_NOTNULL(statuses);
+  CHECK_EQ(starts.size(), ends.size());
+  statuses->resize(starts.size());
+  std::vector<size_t> order;
+  getMortonOrder(starts, &order);
+  runOrderedQueries(order, std::max(params_.query_num_threads, 1),
+                    [&](size_t i) {
+    (*statuses)[i] =
+        getLineStatusBoundingBox(starts[i], ends[i], bounding_box_size);
+  });
+}
+
+void OctomapWorld::getVisibilityBatch(
+    const Eigen::Vector3d& view_point,
+    const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& voxels_to_test,
+    bool stop_at_unknown_cell, std::vector<CellStatus>* statuses) const {
+  CHECK_NOTNULL(statuses);
+  statuses->resize(voxels_to_test.size());
+  std::vector<size_t> order;
+  getMortonOrder(voxels_to_test, &order);
+  runOrderedQueries(order, std::max(params_.query_num_threads, 1),
+                    [&](size_t i) {
+    (*statuses)[i] =
+        getVisibility(view_point, voxels_to_test[i], stop_at_unknown_cell);
+  });
 }
 
 double OctomapWorld::getResolution() const { return octree_->getResolution(); }
@@ -472,22 +1211,50 @@ void OctomapWorld::getOccupiedPointcloudInBoundingBox(
   Eigen::Vector3d bbx_max =
       center_corrected + bounding_box_size / 2 + epsilon_3d;
 
-  for (double x_position = bbx_min.x(); x_position <= bbx_max.x();
-       x_position += resolution) {
-    for (double y_position = bbx_min.y(); y_position <= bbx_max.y();
-         y_position += resolution) {
-      for (double z_position = bbx_min.z(); z_position <= bbx_max.z();
-           z_position += resolution) {
-        octomap::point3d point =
-            octomap::point3d(x_position, y_position, z_position);
-        octomap::OcTreeKey key = octree_->coordToKey(point);
-        octomap::OcTreeNode* node = octree_->search(key);
-        if (node != NULL && octree_->isNodeOccupied(node)) {
-          output_cloud->push_back(
-              pcl::PointXYZ(point.x(), point.y(), point.z()));
+  unsigned int min_key[3], max_key[3];
+  for (int i = 0; i < 3; ++i) {
+    min_key[i] = coordToKeyClamped(bbx_min[i]);
+    max_key[i] = coordToKeyClamped(bbx_max[i]);
+  }
+
+  // The occupied voxels of the blocks overlapping the box, looked up by block
+  // (or over all the occupied blocks, if there are fewer).
+  buildOccupiedIndex();
+  const auto add_block_voxels = [&](const octomap::KeySet& keys) {
+    for (const octomap::OcTreeKey& key : keys) {
+      if (key[0] >= min_key[0] && key[0] <= max_key[0] &&
+          key[1] >= min_key[1] && key[1] <= max_key[1] &&
+          key[2] >= min_key[2] && key[2] <= max_key[2]) {
+        const octomap::point3d point = octree_->keyToCoord(key);
+        output_cloud->push_back(
+            pcl::PointXYZ(point.x(), point.y(), point.z()));
+      }
+    }
+  };
+  const octomap::OcTreeKey min_block =
+      getOccupiedBlockKey(octomap::OcTreeKey(min_key[0], min_key[1], min_key[2]));
+  const octomap::OcTreeKey max_block =
+      getOccupiedBlockKey(octomap::OcTreeKey(max_key[0], max_key[1], max_key[2]));
+  size_t num_box_blocks = 1;
+  for (int i = 0; i < 3; ++i) {
+    num_box_blocks *= max_block[i] - min_block[i] + 1;
+  }
+  if (num_box_blocks < occupied_blocks_.size()) {
+    for (unsigned int bz = min_block[2]; bz <= max_block[2]; ++bz) {
+      for (unsigned int by = min_block[1]; by <= max_block[1]; ++by) {
+        for (unsigned int bx = min_block[0]; bx <= max_block[0]; ++bx) {
+          OccupiedBlockMap::const_iterator block =
+              occupied_blocks_.find(octomap::OcTreeKey(bx, by, bz));
+          if (block != occupied_blocks_.end()) {
+            add_block_voxels(block->second);
+          }
         }
       }
     }
+  } else {
+    for (const OccupiedBlockMap::value_type& block : occupied_blocks_) {
+      add_block_voxels(block.second);
+    }
   }
 }
 
@@ -517,6 +1284,7 @@ void OctomapWorld::setLogOddsBoundingBox(
   }
   // This is necessary since lazy_eval is set to true.
   octree_->updateInnerOccupancy();
+  markMapChanged();
 }
 
 bool OctomapWorld::getOctomapBinaryMsg(octomap_msgs::Octomap* msg) const {
@@ -538,11 +1306,13 @@ void OctomapWorld::setOctomapFromMsg(const octomap_msgs::Octomap& msg) {
 void OctomapWorld::setOctomapFromBinaryMsg(const octomap_msgs::Octomap& msg) {
   octree_.reset(
       dynamic_cast<octomap::OcTree*>(octomap_msgs::binaryMsgToMap(msg)));
+  markMapChanged();
 }
 
 void OctomapWorld::setOctomapFromFullMsg(const octomap_msgs::Octomap& msg) {
   octree_.reset(
       dynamic_cast<octomap::OcTree*>(octomap_msgs::fullMsgToMap(msg)));
+  markMapChanged();
 }
 
 bool OctomapWorld::loadOctomapFromFile(const std::string& filename) {
@@ -550,6 +1320,7 @@ bool OctomapWorld::loadOctomapFromFile(const std::string& filename) {
     // TODO(helenol): Resolution shouldn't matter... I think. I'm not sure.
     octree_.reset(new octomap::OcTree(0.05));
   }
+  markMapChanged();
   return octree_->readBinary(filename);
 }
 
@@ -557,6 +1328,64 @@ bool OctomapWorld::writeOctomapToFile(const std::string& filename) {
   return octree_->writeBinary(filename);
 }
 
+void OctomapWorld::transformMap(const Eigen::Affine3d& T_new_old) {
+  if (!octree_ || octree_->size() == 0) {
+    return;
+  }
+  const double resolution = octree_->getResolution();
+
+  // Bounding box of the transformed map.
+  double min_x, min_y, min_z, max_x, max_y, max_z;
+  octree_->getMetricMin(min_x, min_y, min_z);
+  octree_->getMetricMax(max_x, max_y, max_z);
+  Eigen::Vector3d new_min = Eigen::Vector3d::Constant(std::numeric_limits<double>::max());
+  Eigen::Vector3d new_max = -new_min;
+  for (int i = 0; i < 8; ++i) {
+    const Eigen::Vector3d corner((i & 1) ? max_x : min_x, (i & 2) ? max_y : min_y,
+                                 (i & 4) ? max_z : min_z);
+    const Eigen::Vector3d new_corner = T_new_old * corner;
+    new_min = new_min.cwiseMin(new_corner);
+    new_max = new_max.cwiseMax(new_corner);
+  }
+
+  std::shared_ptr<octomap::OcTree> new_octree(new octomap::OcTree(resolution));
+  new_octree->setProbHit(octree_->getProbHit());
+  new_octree->setProbMiss(octree_->getProbMiss());
+  new_octree->setClampingThresMin(octree_->getClampingThresMin());
+  new_octree->setClampingThresMax(octree_->getClampingThresMax());
+  new_octree->setOccupancyThres(octree_->getOccupancyThres());
+  new_octree->enableChangeDetection(params_.change_detection_enabled);
+
+  octomap::OcTreeKey min_key, max_key;
+  if (!new_octree->coordToKeyChecked(pointEigenToOctomap(new_min), min_key) ||
+      !new_octree->coordToKeyChecked(pointEigenToOctomap(new_max), max_key)) {
+    LOG(ERROR) << "The transformed map is out of the octree bounds.";
+    return;
+  }
+
+  // Inverse mapping: each new voxel center is looked up in the old map.
+  const Eigen::Affine3d T_old_new = T_new_old.inverse();
+  octomap::OcTreeKey key;
+  for (key[2] = min_key[2]; key[2] <= max_key[2]; ++key[2]) {
+    for (key[1] = min_key[1]; key[1] <= max_key[1]; ++key[1]) {
+      for (key[0] = min_key[0]; key[0] <= max_key[0]; ++key[0]) {
+        const Eigen::Vector3d center_old =
+            T_old_new * pointOctomapToEigen(new_octree->keyToCoord(key));
+        const octomap::OcTreeNode* node =
+            octree_->search(pointEigenToOctomap(center_old));
+        if (node != NULL) {
+          new_octree->setNodeValue(key, node->getLogOdds(), true);
+        }
+      }
+    }
+  }
+  new_octree->updateInnerOccupancy();
+  new_octree->prune();
+
+  octree_ = new_octree;
+  markMapChanged();
+}
+
 bool OctomapWorld::isSpeckleNode(const octomap::OcTreeKey& key) const {
   octomap::OcTreeKey current_key;
   // Search neighbors in a +/-1 key range cube. If there are neighbors, it's
@@ -779,21 +1608,102 @@ bool OctomapWorld::checkCollisionWithRobot(
 bool OctomapWorld::checkPathForCollisionsWithRobot(
     const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& robot_positions,
     size_t* collision_index) {
-  // Iterate over vector of poses.
-  // Check each one.
-  // Return when a collision is found, and return the index of the earliest
-  // collision.
-  for (size_t i = 0; i < robot_positions.size(); ++i) {
-    if (checkSinglePoseCollision(robot_positions[i])) {
-      if (collision_index != nullptr) {
-        *collision_index = i;
+  // The boxes of consecutive poses overlap by most of their volume: each
+  // voxel of the swept volume (the union of the boxes) is looked up once.
+  KeyCollisionMap collision_cache;
+  // Poses in time order, or coarse-to-fine (first, last, then bisection) to
+  // find an early collision without testing the whole path: the poses after
+  // the earliest collision found so far are skipped, so that the reported
+  // collision is still the earliest one.
+  std::vector<size_t> order;
+  getPathCheckOrder(robot_positions.size(),
+                    params_.bisect_path_collision_check, &order);
+  size_t first_collision = robot_positions.size();
+  for (size_t i : order) {
+    if (i < first_collision &&
+        checkSinglePoseCollision(robot_positions[i], &collision_cache)) {
+      first_collision = i;
+    }
+  }
+  if (first_collision == robot_positions.size()) {
+    return false;
+  }
+  if (collision_index != nullptr) {
+    *collision_index = first_collision;
+  }
+  return true;
+}
+
+void OctomapWorld::getPathCheckOrder(size_t num_poses, bool bisect,
+                                     std::vector<size_t>* order) const {
+  order->clear();
+  order->reserve(num_poses);
+  if (!bisect || num_poses <= 2) {
+    for (size_t i = 0; i < num_poses; ++i) {
+      order->push_back(i);
+    }
+    return;
+  }
+  order->push_back(0);
+  order->push_back(num_poses - 1);
+  // Breadth-first bisection of the intervals (both ends already tested).
+  std::vector<std::pair<size_t, size_t> > intervals(1, {0, num_poses - 1});
+  for (size_t next = 0; next < intervals.size(); ++next) {
+    const size_t start = intervals[next].first;
+    const size_t end = intervals[next].second;
+    if (end - start < 2) {
+      continue;
+    }
+    const size_t middle = start + (end - start) / 2;
+    order->push_back(middle);
+    intervals.emplace_back(start, middle);
+    intervals.emplace_back(middle, end);
+  }
+}
+
+bool OctomapWorld::checkSinglePoseCollision(
+    const Eigen::Vector3d& robot_position,
+    KeyCollisionMap* collision_cache) const {
+  // Same result as checkSinglePoseCollision() without the cache.
+  octomap::OcTreeKey key;
+  if (!octree_->coordToKeyChecked(pointEigenToOctomap(robot_position), key)) {
+    return true;
+  }
+  const Eigen::Vector3d bbx_min = robot_position - robot_size_ / 2;
+  const Eigen::Vector3d bbx_max = robot_position + robot_size_ / 2;
+  unsigned int min_key[3], max_key[3];
+  for (int i = 0; i < 3; ++i) {
+    min_key[i] = coordToKeyClamped(bbx_min[i]);
+    max_key[i] = coordToKeyClamped(bbx_max[i]);
+  }
+
+  for (unsigned int kz = min_key[2]; kz <= max_key[2]; ++kz) {
+    for (unsigned int ky = min_key[1]; ky <= max_key[1]; ++ky) {
+      for (unsigned int kx = min_key[0]; kx <= max_key[0]; ++kx) {
+        key = octomap::OcTreeKey(kx, ky, kz);
+        std::pair<KeyCollisionMap::iterator, bool> inserted =
+            collision_cache->emplace(key, false);
+        if (inserted.second) {
+          inserted.first->second = isVoxelInCollision(key);
+        }
+        if (inserted.first->second) {
+          return true;
+        }
       }
-      return true;
     }
   }
   return false;
 }
 
+bool OctomapWorld::isVoxelInCollision(const octomap::OcTreeKey& key) const {
+  const octomap::OcTreeNode* node = octree_->search(key);
+  if (node == NULL) {
+    return params_.treat_unknown_as_occupied;
+  }
+  return octree_->isNodeOccupied(node) &&
+         !(params_.filter_speckles && isSpeckleNode(key));
+}
+
 bool OctomapWorld::checkSinglePoseCollision(
     const Eigen::Vector3d& robot_position) const {
   if (params_.treat_unknown_as_occupied) {
@@ -821,8 +1731,11 @@ void OctomapWorld::getChangedPoints(
 
   for (octomap::KeyBoolMap::const_iterator iter = start_key; iter != end_key;
        ++iter) {
-    octomap::OcTreeNode* node = octree_->search(iter->first);
-    bool occupied = octree_->isNodeOccupied(node);
+    // The occupied index, if up to date, saves the search in the tree.
+    const bool occupied =
+        occupied_index_valid_
+            ? isVoxelOccupiedInIndex(iter->first)
+            : octree_->isNodeOccupied(octree_->search(iter->first));
     Eigen::Vector3d center =
         pointOctomapToEigen(octree_->keyToCoord(iter->first));
 
@@ -65,6 +65,11 @@
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/lock_guard.hpp>
 
+#include <random>
+#include <vector>
+
+#include <velodyne_gazebo_plugins/LidarScanToCloud.h>
+
 #if GAZEBO_GPU_RAY
 #define GazeboRosOusterLaser GazeboRosOusterGpuLaser
 #define RayPlugin GpuRayPlugin
@@ -120,16 +125,21 @@ namespace gazebo
     /// \brief organize cloud
     private: bool organize_cloud_;    
 
+    /// \brief Number of threads filling the point cloud
+    private: int num_threads_;
+
     /// \brief Gaussian noise generator
-    private: static double gaussianKernel(double mu, double sigma)
+    private: static double gaussianKernel(double mu, double sigma, std::mt19937 &generator)
     {
-      // using Box-Muller transform to generate two independent standard normally distributed normal variables
-      // see wikipedia
-      double U = (double)rand() / (double)RAND_MAX; // normalized uniform random variable
-      double V = (double)rand() / (double)RAND_MAX; // normalized uniform random variable
-      return sigma * (sqrt(-2.0 * ::log(U)) * cos(2.0 * M_PI * V)) + mu;
+      return std::normal_distribution<double>(mu, sigma)(generator);
     }
 
+    /// \brief One random engine per filling thread
+    private: std::vector<std::mt19937> noise_generators_;
+
+    /// \brief Projection of the scans, with the cached ray angles
+    private: velodyne_gazebo_plugins::LidarScanToCloud projector_;
+
     /// \brief A mutex to lock access
     private: boost::mutex lock_;
 
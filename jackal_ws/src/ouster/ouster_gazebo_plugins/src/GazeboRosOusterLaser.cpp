@@ -36,6 +36,8 @@
 
 #include <algorithm>
 #include <assert.h>
+#include <cmath>
+#include <thread>
 
 #include <gazebo/physics/World.hh>
 #include <gazebo/sensors/Sensor.hh>
@@ -70,7 +72,7 @@ GZ_REGISTER_SENSOR_PLUGIN(GazeboRosOusterLaser)
 
 ////////////////////////////////////////////////////////////////////////////////
 // Constructor
-GazeboRosOusterLaser::GazeboRosOusterLaser() : nh_(NULL), min_range_(0), max_range_(0), gaussian_noise_(0)
+GazeboRosOusterLaser::GazeboRosOusterLaser() : nh_(NULL), min_range_(0), max_range_(0), gaussian_noise_(0), num_threads_(1)
 {
 }
 
@@ -184,6 +186,18 @@ void GazeboRosOusterLaser::Load(sensors::SensorPtr _parent, sdf::ElementPtr _sdf
         organize_cloud_ = _sdf->GetElement("organize_cloud")->Get<bool>();
     }    
 
+    if (!_sdf->HasElement("num_threads")) {
+        num_threads_ = std::max(1u, std::thread::hardware_concurrency());
+        ROS_INFO("Ouster laser plugin missing <num_threads>, defaults to %i", num_threads_);
+    } else {
+        num_threads_ = std::max(1, _sdf->GetElement("num_threads")->Get<int>());
+        ROS_INFO("Ouster laser plugin : Number of threads set to %i", num_threads_);
+    }
+    std::random_device random_device;
+    for (int t = 0; t < num_threads_; t++){
+        noise_generators_.emplace_back(random_device());
+    }
+
     // Make sure the ROS node for Gazebo has already been initialized
     if (!ros::isInitialized()){
         ROS_FATAL_STREAM("A ROS node for Gazebo has not been initialized, unable to load plugin. "
@@ -285,9 +299,6 @@ void GazeboRosOusterLaser::OnScan(ConstLaserScanStampedPtr& _msg){
     const math::Angle verticalMinAngle = parent_ray_sensor_->GetVerticalAngleMin();
 #endif
 
-    const double yDiff = maxAngle.Radian() - minAngle.Radian();
-    const double pDiff = verticalMaxAngle.Radian() - verticalMinAngle.Radian();
-
     const double MIN_RANGE = std::max(min_range_, minRange);
     const double MAX_RANGE = std::min(max_range_, maxRange);
 
@@ -407,166 +418,60 @@ void GazeboRosOusterLaser::OnScan(ConstLaserScanStampedPtr& _msg){
 
 #endif 
 
-    msg.data.resize(verticalRangeCount * rangeCount * POINT_STEP);
-
-    int i, j;
-    uint8_t *ptr = msg.data.data();
-    for (i = 0; i < rangeCount; i++){
-        for (j = 0; j < verticalRangeCount; j++){
+    // Range, noise and intensity of each ray
+    auto ray_function = [&](int thread, int index, double &r, double &intensity){
+        r = _msg->scan().ranges(index);
 
-            // Range
-            double r = _msg->scan().ranges(i + j * rangeCount);
-   
-            if ((MIN_RANGE >= r) || (r >= MAX_RANGE) ) {
-                if (!organize_cloud_) continue;
-            }
+        if ((MIN_RANGE >= r) || (r >= MAX_RANGE) ) {
+            return false;
+        }
 
-            // Noise
-            if (gaussian_noise_ > 0.0){ // shouldn't it be compared to epsilon ?
-                r += gaussianKernel(0, gaussian_noise_);
-            }
-            else if (gaussian_noise_ != -1.0){
-                // Noise set by the datasheet
-                double g_noise = gaussianKernel(0, 1.);
-                if(r <= 2.){
-                    r += 0.03 * g_noise;
-                } else if(r <= 20.){
-                    r += 0.015 * g_noise;
-                } else if(r <= 60.){
-                    r += 0.03 * g_noise;
-                } else {
-                    r += 0.1 * g_noise;
-                }
+        // Noise
+        if (gaussian_noise_ > 0.0){ // shouldn't it be compared to epsilon ?
+            r += gaussianKernel(0, gaussian_noise_, noise_generators_[thread]);
+        }
+        else if (gaussian_noise_ != -1.0){
+            // Noise set by the datasheet
+            double g_noise = gaussianKernel(0, 1., noise_generators_[thread]);
+            if(r <= 2.){
+                r += 0.03 * g_noise;
+            } else if(r <= 20.){
+                r += 0.015 * g_noise;
+            } else if(r <= 60.){
+                r += 0.03 * g_noise;
+            } else {
+                r += 0.1 * g_noise;
             }
+        }
 
 #if USE_NEW_POINT_CLOUD_VERSION
-            // Intensity
-            // hack to get the cloud coloured (since many visualizations use the intensity field to color the points)
-            const double intensity = r;
-#else
-            // Intensity
-            const double intensity = _msg->scan().intensities(i + j * rangeCount);
-#endif 
-
-            // Get angles of ray to get xyz for point
-            double yAngle = minAngle.Radian();
-            double pAngle = verticalMinAngle.Radian();
-
-            if (rangeCount > 1)
-            {
-                yAngle = i * yDiff / (rangeCount - 1) + minAngle.Radian();
-            }
-
-            if (verticalRayCount > 1)
-            {
-                pAngle = j * pDiff / (verticalRangeCount - 1) + verticalMinAngle.Radian();
-            }
-
-            // pAngle is rotated by yAngle:
-            //if ((MIN_RANGE < r) && (r < MAX_RANGE))
-            if ((filter_radius_ < r) && (r < MAX_RANGE))
-            {
-                *((float*)(ptr + 0)) = (float)(r * cos(pAngle) * cos(yAngle)); // x
-                *((float*)(ptr + 4)) = (float)(r * cos(pAngle) * sin(yAngle)); // y
-#if GAZEBO_MAJOR_VERSION > 2
-                *((float*)(ptr + 8)) = (float)(r * sin(pAngle)); // z
-#else
-                *((float*)(ptr + 8)) = (float)(-r * sin(pAngle)); // z
-#endif
-#if !USE_NEW_POINT_CLOUD_VERSION 
-                *((float*)(ptr + 16)) = (float) intensity; // I
+        // Intensity
+        // hack to get the cloud coloured (since many visualizations use the intensity field to color the points)
+        intensity = r;
 #else
-                *((float*)(ptr + intensity_offset)) = (float) intensity; // I
-#endif 
-
-#if !USE_NEW_POINT_CLOUD_VERSION 
-    #if GAZEBO_MAJOR_VERSION > 2
-                *((uint16_t*)(ptr + ring_offset)) = (uint16_t) j; // ring
-    #else
-                *((uint16_t*)(ptr + ring_offset)) = (uint16_t) verticalRangeCount - 1 - j; // ring
-    #endif
-#else
-    //NOTE: in the new ouster point cloud version we have a single byte (uint16_t) for the ring
-    #if GAZEBO_MAJOR_VERSION > 2
-                *((uint16_t*)(ptr + ring_offset)) = (uint16_t) j; // ring
-    #else
-                *((uint16_t*)(ptr + ring_offset)) = (uint16_t) verticalRangeCount - 1 - j; // ring
-    #endif   
+        // Intensity
+        intensity = _msg->scan().intensities(index);
 #endif 
+        return true;
+    };
 
-#if USE_NEW_POINT_CLOUD_VERSION
-                *((uint32_t*)(ptr + time_offset)) = 0; // time (offset w.r.t. pointcloud message timestamp)
-#endif 
-                ptr += POINT_STEP;
-            } 
-            else if(organize_cloud_)
-            { 
-                //if out of range, create a NAN point to keep the organization
-                *((float*)(ptr + 0)) = nanf(""); //0.; // x
-                *((float*)(ptr + 4)) = nanf(""); //0.; // y
+    // Project the rays, the points closer than the filter radius are discarded
+    velodyne_gazebo_plugins::LidarPointLayout layout;
+    layout.point_step = POINT_STEP;
+    layout.xyz_offset = msg.fields[0].offset;
+    layout.intensity_offset = msg.fields[3].offset;
+    layout.ring_offset = ring_offset;
 #if GAZEBO_MAJOR_VERSION > 2
-                *((float*)(ptr + 8)) = nanf(""); //0.; // z
-#else
-                *((float*)(ptr + 8)) = nanf(""); //0.; // z
-#endif
-#if !USE_NEW_POINT_CLOUD_VERSION 
-                *((float*)(ptr + 16)) = 0. // I
-#else
-                *((float*)(ptr + intensity_offset)) = nanf(""); //0.; // I
-#endif 
-
-#if !USE_NEW_POINT_CLOUD_VERSION 
-    #if GAZEBO_MAJOR_VERSION > 2
-                *((uint16_t*)(ptr + ring_offset)) = (uint16_t) j; // ring
-    #else
-                *((uint16_t*)(ptr + ring_offset)) = (uint16_t) verticalRangeCount - 1 - j; // ring
-    #endif
+    layout.reverse_rings = false;
+    projector_.setAngles(minAngle.Radian(), maxAngle.Radian(), rangeCount,
+                         verticalMinAngle.Radian(), verticalMaxAngle.Radian(), verticalRangeCount);
 #else
-    //NOTE: in the new ouster point cloud version we have a single byte (uint16_t) for the ring
-    #if GAZEBO_MAJOR_VERSION > 2
-                *((uint16_t*)(ptr + ring_offset)) = (uint16_t) j; // ring
-    #else
-                *((uint16_t*)(ptr + ring_offset)) = (uint16_t) verticalRangeCount - 1 - j; // ring
-    #endif   
+    // the scan is upside down: negate the pitch (i.e. z) and reverse the rings
+    layout.reverse_rings = true;
+    projector_.setAngles(minAngle.Radian(), maxAngle.Radian(), rangeCount,
+                         -verticalMinAngle.Radian(), -verticalMaxAngle.Radian(), verticalRangeCount);
 #endif
-
-#if USE_NEW_POINT_CLOUD_VERSION
-                *((uint32_t*)(ptr + time_offset)) = 0; // time (offset w.r.t. pointcloud message timestamp)
-#endif 
-                ptr += POINT_STEP;
-            }         
-        }
-    }
-
-#if 0
-    // Populate message with number of valid points
-    msg.point_step = POINT_STEP;
-    msg.row_step = (uint32_t) (ptr - msg.data.data());
-    msg.height = 1;
-    msg.width = msg.row_step / POINT_STEP;
-    msg.is_bigendian = false;
-    msg.is_dense = true;
-    msg.data.resize(msg.row_step); // Shrink to actual size
-
-#else 
-
-    // Populate message with number of valid points
-    msg.data.resize(ptr - msg.data.data()); // Shrink to actual size
-    msg.point_step = POINT_STEP;
-    msg.is_bigendian = false;
-    if (organize_cloud_) {
-        msg.width = verticalRangeCount;
-        msg.height = msg.data.size() / POINT_STEP / msg.width;
-        msg.row_step = POINT_STEP * msg.width;
-        msg.is_dense = false;
-    } else {
-        msg.width = msg.data.size() / POINT_STEP;
-        msg.height = 1;
-        msg.row_step = msg.data.size();
-        msg.is_dense = true;
-    }
-    
-#endif 
+    projector_.project(ray_function, filter_radius_, MAX_RANGE, organize_cloud_, num_threads_, layout, &msg);
 
     // Publish output
     pub_.publish(msg);
@@ -65,6 +65,8 @@
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/lock_guard.hpp>
 
+#include <velodyne_gazebo_plugins/LidarScanToCloud.h>
+
 #if GAZEBO_GPU_RAY
 #define GazeboRosVelodyneLaser GazeboRosVelodyneGpuLaser
 #define RayPlugin GpuRayPlugin
@@ -133,6 +135,9 @@ namespace gazebo
       return sigma * (sqrt(-2.0 * ::log(U)) * cos(2.0 * M_PI * V)) + mu;
     }
 
+    /// \brief Projection of the scans, with the cached ray angles
+    private: velodyne_gazebo_plugins::LidarScanToCloud projector_;
+
     /// \brief A mutex to lock access
     private: boost::mutex lock_;
 
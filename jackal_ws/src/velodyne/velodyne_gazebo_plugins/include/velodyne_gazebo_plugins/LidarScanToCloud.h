@@ -0,0 +1,190 @@
+#ifndef VELODYNE_GAZEBO_PLUGINS_LIDAR_SCAN_TO_CLOUD_H_
+#define VELODYNE_GAZEBO_PLUGINS_LIDAR_SCAN_TO_CLOUD_H_
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include <sensor_msgs/PointCloud2.h>
+
+namespace velodyne_gazebo_plugins
+{
+
+/// \brief Offsets of the fields written by LidarScanToCloud in a point of PointCloud2::data.
+/// x, y, z (consecutive) and intensity are FLOAT32, ring is UINT16. The other fields
+/// of the point (e.g. time) are left to zero.
+struct LidarPointLayout
+{
+  uint32_t point_step;
+  uint32_t xyz_offset;
+  uint32_t intensity_offset;
+  uint32_t ring_offset;
+  /// \brief Number the rings from the last to the first one
+  bool reverse_rings;
+};
+
+/// \brief Projects the ranges of a multi-beam lidar scan into a PointCloud2, shared by the
+/// Velodyne and Ouster plugins. It only depends on sensor_msgs, so it can also be used for
+/// scans of real sensors.
+///
+/// The scan is a grid of columns (azimuth steps) by rings (beams), stored ring-major as in
+/// gazebo::msgs::LaserScan: the ray of column i and ring j is at index i + j * columns.
+/// The sines and cosines of the ray angles are cached between scans. The points of each
+/// column are computed in structure-of-arrays form, which the compiler vectorizes, and then
+/// packed into the point layout. The columns can be split between several threads.
+///
+/// Without organize, only the valid points are published (dense cloud). With organize,
+/// every ray is published and the invalid ones are NaN holes: the cloud has one row per
+/// column and one point per ring, so it can be used directly as a range image.
+class LidarScanToCloud
+{
+  public:
+    /// \brief Set the angles of the rays. The tables are only recomputed if they changed.
+    void setAngles(double min_yaw, double max_yaw, int columns,
+                   double min_pitch, double max_pitch, int rings)
+    {
+      if ((int)cos_yaw_.size() == columns && (int)cos_pitch_.size() == rings &&
+          min_yaw_ == min_yaw && max_yaw_ == max_yaw &&
+          min_pitch_ == min_pitch && max_pitch_ == max_pitch) {
+        return;
+      }
+      min_yaw_ = min_yaw;
+      max_yaw_ = max_yaw;
+      min_pitch_ = min_pitch;
+      max_pitch_ = max_pitch;
+
+      const double yaw_step = (columns > 1) ? (max_yaw - min_yaw) / (columns - 1) : 0.0;
+      cos_yaw_.resize(columns);
+      sin_yaw_.resize(columns);
+      for (int i = 0; i < columns; i++) {
+        const double yaw = i * yaw_step + min_yaw;
+        cos_yaw_[i] = cos(yaw);
+        sin_yaw_[i] = sin(yaw);
+      }
+
+      const double pitch_step = (rings > 1) ? (max_pitch - min_pitch) / (rings - 1) : 0.0;
+      cos_pitch_.resize(rings);
+      sin_pitch_.resize(rings);
+      for (int j = 0; j < rings; j++) {
+        const double pitch = j * pitch_step + min_pitch;
+        cos_pitch_[j] = cos(pitch);
+        sin_pitch_[j] = sin(pitch);
+      }
+    }
+
+    int columns() const { return cos_yaw_.size(); }
+    int rings() const { return cos_pitch_.size(); }
+
+    /// \brief Fill the data and the geometry of msg (the fields and header are left to the caller).
+    /// \param ray_function bool(int thread, int index, double &range, double &intensity),
+    ///        called once per ray. Returns false to discard the ray, otherwise sets its range
+    ///        (with noise) and intensity. thread is the index of the calling thread, to pick
+    ///        per-thread state like random engines.
+    /// \param min_range, max_range only the rays with a range in between are valid points
+    template <typename RayFunction>
+    void project(const RayFunction &ray_function, double min_range, double max_range,
+                 bool organize, int num_threads, const LidarPointLayout &layout,
+                 sensor_msgs::PointCloud2 *msg) const
+    {
+      const int num_columns = columns();
+      const int num_rings = rings();
+      const size_t column_step = (size_t)num_rings * layout.point_step;
+      msg->data.assign(num_columns * column_step, 0);
+
+      // Each column is written to its own slot of msg->data, then the slots are compacted
+      std::vector<int> column_sizes(num_columns, 0);
+      auto project_columns = [&](int thread, int first_column, int end_column) {
+        std::vector<float> range(num_rings), intensity(num_rings);
+        std::vector<float> x(num_rings), y(num_rings), z(num_rings);
+        std::vector<uint8_t> is_published(num_rings);
+        const float nan = std::numeric_limits<float>::quiet_NaN();
+
+        for (int i = first_column; i < end_column; i++) {
+          for (int j = 0; j < num_rings; j++) {
+            double r, ray_intensity;
+            const bool is_valid = ray_function(thread, i + j * num_columns, r, ray_intensity) &&
+                                  (min_range < r) && (r < max_range);
+            range[j] = is_valid ? (float)r : nan;
+            intensity[j] = is_valid ? (float)ray_intensity : nan;
+            is_published[j] = is_valid || organize;
+          }
+
+          // NaN ranges give NaN points
+          const float cos_yaw = cos_yaw_[i];
+          const float sin_yaw = sin_yaw_[i];
+          for (int j = 0; j < num_rings; j++) {
+            const float r_cos_pitch = range[j] * cos_pitch_[j];
+            x[j] = r_cos_pitch * cos_yaw;
+            y[j] = r_cos_pitch * sin_yaw;
+            z[j] = range[j] * sin_pitch_[j];
+          }
+
+          uint8_t * const column = msg->data.data() + i * column_step;
+          uint8_t *ptr = column;
+          for (int j = 0; j < num_rings; j++) {
+            if (!is_published[j]) {
+              continue;
+            }
+            const float xyz[3] = {x[j], y[j], z[j]};
+            const uint16_t ring = layout.reverse_rings ? num_rings - 1 - j : j;
+            memcpy(ptr + layout.xyz_offset, xyz, sizeof(xyz));
+            memcpy(ptr + layout.intensity_offset, &intensity[j], sizeof(float));
+            memcpy(ptr + layout.ring_offset, &ring, sizeof(uint16_t));
+            ptr += layout.point_step;
+          }
+          column_sizes[i] = (ptr - column) / layout.point_step;
+        }
+      };
+
+      num_threads = std::max(1, std::min(num_threads, num_columns));
+      if (num_threads == 1) {
+        project_columns(0, 0, num_columns);
+      } else {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads; t++) {
+          threads.emplace_back(project_columns, t, t * num_columns / num_threads,
+                               (t + 1) * num_columns / num_threads);
+        }
+        for (std::thread &thread : threads) {
+          thread.join();
+        }
+      }
+
+      uint8_t *ptr = msg->data.data();
+      for (int i = 0; i < num_columns; i++) {
+        const size_t column_bytes = (size_t)column_sizes[i] * layout.point_step;
+        const uint8_t *column = msg->data.data() + i * column_step;
+        if (column != ptr) {
+          memmove(ptr, column, column_bytes);
+        }
+        ptr += column_bytes;
+      }
+      msg->data.resize(ptr - msg->data.data()); // Shrink to actual size
+
+      msg->point_step = layout.point_step;
+      msg->is_bigendian = false;
+      if (organize) {
+        msg->width = num_rings;
+        msg->height = num_columns;
+        msg->row_step = layout.point_step * msg->width;
+        msg->is_dense = false;
+      } else {
+        msg->width = msg->data.size() / layout.point_step;
+        msg->height = 1;
+        msg->row_step = msg->data.size();
+        msg->is_dense = true;
+      }
+    }
+
+  private:
+    std::vector<float> cos_yaw_, sin_yaw_, cos_pitch_, sin_pitch_;
+    double min_yaw_ = 0.0, max_yaw_ = 0.0, min_pitch_ = 0.0, max_pitch_ = 0.0;
+};
+
+} // namespace velodyne_gazebo_plugins
+
+#endif // VELODYNE_GAZEBO_PLUGINS_LIDAR_SCAN_TO_CLOUD_H_
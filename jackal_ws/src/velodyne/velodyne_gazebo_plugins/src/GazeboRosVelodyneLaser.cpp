@@ -278,9 +278,6 @@ void GazeboRosVelodyneLaser::OnScan(ConstLaserScanStampedPtr& _msg)
   const math::Angle verticalMinAngle = parent_ray_sensor_->GetVerticalAngleMin();
 #endif
 
-  const double yDiff = maxAngle.Radian() - minAngle.Radian();
-  const double pDiff = verticalMaxAngle.Radian() - verticalMinAngle.Radian();
-
   const double MIN_RANGE = std::max(min_range_, minRange);
   const double MAX_RANGE = std::min(max_range_, maxRange);
   const double MIN_INTENSITY = min_intensity_;
@@ -315,82 +312,33 @@ void GazeboRosVelodyneLaser::OnScan(ConstLaserScanStampedPtr& _msg)
   msg.fields[5].offset = 18;
   msg.fields[5].datatype = sensor_msgs::PointField::FLOAT32;
   msg.fields[5].count = 1;
-  msg.data.resize(verticalRangeCount * rangeCount * POINT_STEP);
-
-  int i, j;
-  uint8_t *ptr = msg.data.data();
-  for (i = 0; i < rangeCount; i++) {
-    for (j = 0; j < verticalRangeCount; j++) {
-
-      // Range
-      double r = _msg->scan().ranges(i + j * rangeCount);
-      // Intensity
-      double intensity = _msg->scan().intensities(i + j * rangeCount);
-      // Ignore points that lay outside range bands or optionally, beneath a
-      // minimum intensity level.
-      if ((MIN_RANGE >= r) || (r >= MAX_RANGE) || (intensity < MIN_INTENSITY) ) {
-        if (!organize_cloud_) {
-          continue;
-        }
-      }
-
-      // Noise
-      if (gaussian_noise_ != 0.0) {
-        r += gaussianKernel(0,gaussian_noise_);
-      }
-
-      // Get angles of ray to get xyz for point
-      double yAngle;
-      double pAngle;
-
-      if (rangeCount > 1) {
-        yAngle = i * yDiff / (rangeCount -1) + minAngle.Radian();
-      } else {
-        yAngle = minAngle.Radian();
-      }
-
-      if (verticalRayCount > 1) {
-        pAngle = j * pDiff / (verticalRangeCount -1) + verticalMinAngle.Radian();
-      } else {
-        pAngle = verticalMinAngle.Radian();
-      }
-
-      // pAngle is rotated by yAngle:
-      if ((MIN_RANGE < r) && (r < MAX_RANGE)) {
-        *((float*)(ptr + 0)) = r * cos(pAngle) * cos(yAngle); // x
-        *((float*)(ptr + 4)) = r * cos(pAngle) * sin(yAngle); // y
-        *((float*)(ptr + 8)) = r * sin(pAngle); // z
-        *((float*)(ptr + 12)) = intensity; // intensity
-        *((uint16_t*)(ptr + 16)) = j; // ring
-        *((float*)(ptr + 18)) = 0.0; // time
-        ptr += POINT_STEP;
-      } else if (organize_cloud_) {
-        *((float*)(ptr + 0)) = nanf(""); // x
-        *((float*)(ptr + 4)) = nanf(""); // y
-        *((float*)(ptr + 8)) = nanf(""); // x
-        *((float*)(ptr + 12)) = nanf(""); // intensity
-        *((uint16_t*)(ptr + 16)) = j; // ring
-        *((float*)(ptr + 18)) = 0.0; // time
-        ptr += POINT_STEP;
-      }
-    }
-  }
 
-  // Populate message with number of valid points
-  msg.data.resize(ptr - msg.data.data()); // Shrink to actual size
-  msg.point_step = POINT_STEP;
-  msg.is_bigendian = false;
-  if (organize_cloud_) {
-    msg.width = verticalRangeCount;
-    msg.height = msg.data.size() / POINT_STEP / msg.width;
-    msg.row_step = POINT_STEP * msg.width;
-    msg.is_dense = false;
-  } else {
-    msg.width = msg.data.size() / POINT_STEP;
-    msg.height = 1;
-    msg.row_step = msg.data.size();
-    msg.is_dense = true;
-  }
+  // Range, intensity and noise of each ray
+  auto ray_function = [&](int thread, int index, double &r, double &intensity) {
+    r = _msg->scan().ranges(index);
+    intensity = _msg->scan().intensities(index);
+    // Ignore points that lay outside range bands or optionally, beneath a
+    // minimum intensity level.
+    if ((MIN_RANGE >= r) || (r >= MAX_RANGE) || (intensity < MIN_INTENSITY)) {
+      return false;
+    }
+    // Noise
+    if (gaussian_noise_ != 0.0) {
+      r += gaussianKernel(0,gaussian_noise_);
+    }
+    return true;
+  };
+
+  // Project the rays (gaussianKernel() is not thread safe, a single thread is used)
+  velodyne_gazebo_plugins::LidarPointLayout layout;
+  layout.point_step = POINT_STEP;
+  layout.xyz_offset = msg.fields[0].offset;
+  layout.intensity_offset = msg.fields[3].offset;
+  layout.ring_offset = msg.fields[4].offset;
+  layout.reverse_rings = false;
+  projector_.setAngles(minAngle.Radian(), maxAngle.Radian(), rangeCount,
+                       verticalMinAngle.Radian(), verticalMaxAngle.Radian(), verticalRangeCount);
+  projector_.project(ray_function, MIN_RANGE, MAX_RANGE, organize_cloud_, 1, layout, &msg);
 
   // Publish output
   pub_.publish(msg);
@@ -252,6 +252,27 @@ class ElevationMap {
    */
   bool fuse(const grid_map::Index& topLeftIndex, const grid_map::Index& size);
 
+  /*!
+   * Copies the raw map layers of the buffer (e.g. rawMapFusionBuffer_) into it, without reallocating it if the geometry did not change.
+   * The layers of the buffer which are not in the raw map are not modified. The raw data mutex has to be locked by the caller.
+   * @param buffer the buffer map.
+   */
+  void updateRawMapBuffer(grid_map::GridMap& buffer);
+
+  /*!
+   * Computes the linear raw map cell index of each point of the cloud (into pointCellIndices_).
+   * The raw data mutex has to be locked by the caller.
+   * @param pointCloud the point cloud (in the map frame).
+   * @return the number of cells of the map, which is also the index given to the points outside the map.
+   */
+  int computePointCellIndices(const PointCloudType& pointCloud);
+
+  /*!
+   * Sorts the points by cell (stable counting sort of pointCellIndices_) and collects the cells that received points.
+   * @param numberOfCells the number of cells of the map.
+   */
+  void bucketPointsByCell(int numberOfCells);
+
   /*!
    * Cleans the elevation map data to stay within the specified bounds.
    * @return true if successful.
@@ -282,7 +303,17 @@ class ElevationMap {
   //! Fused elevation map as grid map.
   grid_map::GridMap fusedMap_;
 
-  //! Visibility cleanup debug map.
+  //! Buffers of the batched point insertion of add(), kept to avoid reallocations. Only accessed with the raw data mutex locked.
+  std::vector<int> pointCellIndices_;
+  std::vector<unsigned int> cellPointOffsets_;
+  std::vector<unsigned int> cellPointInsertPositions_;
+  std::vector<unsigned int> sortedPointIndices_;
+  std::vector<int> updatedCells_;
+
+  //! Snapshot of the raw map layers read by the fusion, reused across calls. Only accessed with the fused data mutex locked.
+  grid_map::GridMap rawMapFusionBuffer_;
+
+  //! Visibility cleanup debug map: snapshot of the raw map layers read by the cleanup and the max. height layer, reused across calls.
   grid_map::GridMap visibilityCleanupMap_;
 
   //! Underlying map, used for ground truth maps, multi-robot mapping etc.
@@ -8,6 +8,11 @@
 
 #pragma once
 
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
 #include <ros/ros.h>
 #include <filters/filter_chain.hpp>
 #include <grid_map_core/GridMap.hpp>
@@ -29,10 +34,21 @@ namespace elevation_mapping {
  *   // Call the functor by feeding it some input data. It will postprocess and publish the processed data.
  *   postprocessor(gridMap);
  *
+ *   Tiled execution:
+ *   ========
+ *
+ *   If postprocessor_tile_size is set and every filter of the pipeline declares the border (in m) of the data it needs around
+ *   a cell with a tile_border parameter (0 for the per-cell filters), the map is split into tiles extended by the sum of the
+ *   borders. The pipeline runs on the tiles in parallel (see setParallelRunner()) and the tiles are stitched together.
+ *
  */
 class PostprocessingPipelineFunctor {
  public:
   using GridMap = grid_map::GridMap;
+  using FilterChain = filters::FilterChain<grid_map::GridMap>;
+
+  //! Runs numTasks tasks (called with the indices [0, numTasks)) and returns when all of them are done.
+  using ParallelRunner = std::function<void(std::size_t numTasks, const std::function<void(std::size_t)>& task)>;
 
   /**
    * @brief Explicit Constructor.
@@ -52,11 +68,17 @@ class PostprocessingPipelineFunctor {
    */
   GridMap operator()(GridMap& inputMap);
 
+  /**
+   * @brief Sets how the tiles of the tiled execution are run, sequentially by default.
+   * @param parallelRunner The runner, it has to be thread-safe.
+   */
+  void setParallelRunner(ParallelRunner parallelRunner);
+
   /**
    * Publishes a given grid map.
    * @param gridMap   The Grid Map that this functor will publish.
    */
-  void publish(const GridMap& gridMap) const;
+  void publish(GridMap gridMap) const;
 
   /**
    * Checks whether there are any subscribers to the result of this functor.
@@ -69,8 +91,30 @@ class PostprocessingPipelineFunctor {
   //! @brief Reads in the parameters from the ROS parameter server.
   void readParameters();
 
+  /**
+   * @brief Reads the sum of the tile_border parameters of the filters of the pipeline.
+   * @param tileBorder The border of the tiles [m].
+   * @return False if a filter does not declare its tile_border (the pipeline cannot run on tiles).
+   */
+  bool readTileBorder(double& tileBorder) const;
+
+  /**
+   * @brief Applies the filter chain on the tiles of the map.
+   * @param inputMap The input map, converted to the default start index.
+   * @param tileSize The side length of the tiles [m].
+   * @param outputMap The stitched output map.
+   * @return False if the filter chain failed on a tile.
+   */
+  bool applyTiled(GridMap& inputMap, double tileSize, GridMap& outputMap);
+
+  /**
+   * @brief Gets a filter chain that is not used by another tile, configures a new one if needed.
+   * @return The filter chain, returned to the available ones when released, or nullptr if it could not be configured.
+   */
+  std::shared_ptr<FilterChain> acquireTileChain();
+
   //! ROS nodehandle.
-  ros::NodeHandle& nodeHandle_;
+  ros::NodeHandle nodeHandle_;
 
   //! Grid map publisher.
   ros::Publisher publisher_;
@@ -84,11 +128,25 @@ class PostprocessingPipelineFunctor {
 
     //! Filter chain parameters name.
     std::string filterChainParametersName_;
+
+    //! Side length of the tiles of the tiled execution [m], 0 to filter the whole map at once.
+    double tileSize_;
   };
   ThreadSafeDataWrapper<Parameters> parameters_;
 
   //! Flag indicating if the filter chain was successfully configured.
   bool filterChainConfigured_;
+
+  //! Sum of the borders declared by the filters [m], negative if the filter chain cannot run on tiles.
+  double tileBorder_;
+
+  //! Runner of the tiles.
+  ParallelRunner parallelRunner_;
+
+  //! Filter chains of the tiles (a filter chain is not thread-safe), and the ones that are not in use.
+  std::mutex tileChainsMutex_;
+  std::vector<std::unique_ptr<FilterChain>> tileChains_;
+  std::vector<FilterChain*> availableTileChains_;
 };
 
 }  // namespace elevation_mapping
\ No newline at end of file
@@ -37,6 +37,9 @@ class PostprocessingWorker {
   std::thread& thread() { return thread_; }
   const GridMap& dataBuffer() { return dataBuffer_; }
   void setDataBuffer(GridMap data) { dataBuffer_ = std::move(data); }
+  void setParallelRunner(PostprocessingPipelineFunctor::ParallelRunner parallelRunner) {
+    functor_.setParallelRunner(std::move(parallelRunner));
+  }
   ///@}
 
   /*! @name Methods */
@@ -53,7 +56,7 @@ class PostprocessingWorker {
    *
    * @param gridMap The grid map to publish.
    */
-  void publish(const GridMap& gridMap) const;
+  void publish(GridMap gridMap) const;
 
   /**
    * @brief Checks whether the worker publisher has any active subscribers.
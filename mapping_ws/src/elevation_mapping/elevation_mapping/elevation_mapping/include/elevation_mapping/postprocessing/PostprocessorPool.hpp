@@ -11,6 +11,7 @@
 #include <boost/asio.hpp>
 #include <boost/thread.hpp>
 #include <deque>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <thread>
@@ -56,6 +57,17 @@ class PostprocessorPool {
    */
   bool runTask(const GridMap& gridMap);
 
+  /**
+   * @brief Runs numTasks independent tasks on the worker threads and on the calling thread, and blocks until all of them are done.
+   *
+   * @remark The tasks are claimed dynamically from a shared counter: a worker that is busy with a postprocessing pipeline simply
+   * joins later (or not at all) and the calling thread takes over its share, so this never waits for a pipeline to finish.
+   * Exceptions thrown by a task are logged and suppressed.
+   * @param numTasks The number of tasks.
+   * @param task The task to run, called once with each index in [0, numTasks).
+   */
+  void runParallel(std::size_t numTasks, const std::function<void(std::size_t)>& task);
+
   /**
    * @brief Performs a check on the number of subscribers.
    * @return True if someone listens to the topic that the managed postprocessor_ publishes to.
@@ -6,10 +6,15 @@
  *	 Institute: ETH Zurich, ANYbotics
  */
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
+#include <deque>
+#include <limits>
 
+#include <boost/make_shared.hpp>
 #include <grid_map_msgs/GridMap.h>
+#include <mr3d_profiling/Profiler.h>
 #include <ros/ros.h>
 #include <Eigen/Dense>
 
@@ -38,10 +43,15 @@ ElevationMap::ElevationMap(ros::NodeHandle nodeHandle)
       rawMap_({"elevation", "variance", "horizontal_variance_x", "horizontal_variance_y", "horizontal_variance_xy", "color", "time",
                "dynamic_time", "lowest_scan_point", "sensor_x_at_lowest_scan", "sensor_y_at_lowest_scan", "sensor_z_at_lowest_scan"}),
       fusedMap_({"elevation", "upper_bound", "lower_bound", "color"}),
+      rawMapFusionBuffer_({"elevation", "variance", "horizontal_variance_x", "horizontal_variance_y", "horizontal_variance_xy", "color"}),
+      visibilityCleanupMap_({"elevation", "variance", "time", "lowest_scan_point", "sensor_x_at_lowest_scan", "sensor_y_at_lowest_scan",
+                             "sensor_z_at_lowest_scan", "max_height"}),
       postprocessorPool_(nodeHandle.param("postprocessor_num_threads", 1), nodeHandle_),
       hasUnderlyingMap_(false) {
   rawMap_.setBasicLayers({"elevation", "variance"});
   fusedMap_.setBasicLayers({"elevation", "upper_bound", "lower_bound"});
+  rawMapFusionBuffer_.setBasicLayers({"elevation", "variance"});
+  visibilityCleanupMap_.setBasicLayers({"elevation", "variance"});
   clear();
   const Parameters parameters{parameters_.getData()};
 
@@ -74,7 +84,7 @@ bool ElevationMap::add(const PointCloudType::Ptr pointCloud, Eigen::VectorXf& po
   }
 
   // Initialization for time calculation.
-  const ros::WallTime methodStartTime(ros::WallTime::now());
+  PROFILE_ZONE_NAMED(profilerZone, "elevation_mapping/add");
   const ros::Time currentTime(ros::Time::now());
   const float currentTimeSecondsPattern{intAsFloat(static_cast<uint32_t>(static_cast<uint64_t>(currentTime.toSec())))};
   boost::recursive_mutex::scoped_lock scopedLockForRawData(rawMapMutex_);
@@ -99,98 +109,176 @@ bool ElevationMap::add(const PointCloudType::Ptr pointCloud, Eigen::VectorXf& po
   auto& sensorYatLowestScanLayer = rawMap_["sensor_y_at_lowest_scan"];
   auto& sensorZatLowestScanLayer = rawMap_["sensor_z_at_lowest_scan"];
 
-  std::vector<Eigen::Ref<const grid_map::Matrix>> basicLayers_;
-  for (const std::string& layer : rawMap_.getBasicLayers()) {
-    basicLayers_.emplace_back(rawMap_.get(layer));
-  }
+  const grid_map::Position3 sensorTranslation(transformationSensorToMap.translation());
+
+  // Batched insertion: the points are bucketed by cell (keeping their order within each cell) and every touched cell is then updated
+  // once, with its state kept in local variables. Cells are independent, so they are updated in parallel.
+  const int numberOfCells = computePointCellIndices(*pointCloud);
+  bucketPointsByCell(numberOfCells);
+
+  // Updates one cell with all its points, in the same order as they appear in the point cloud.
+  auto updateCell = [&](const int cell) {
+    float elevation = elevationLayer(cell);
+    float variance = varianceLayer(cell);
+    float horizontalVarianceX = horizontalVarianceXLayer(cell);
+    float horizontalVarianceY = horizontalVarianceYLayer(cell);
+    float horizontalVarianceXY = horizontalVarianceXYLayer(cell);
+    float color = colorLayer(cell);
+    float time = timeLayer(cell);
+    float dynamicTime = dynamicTimeLayer(cell);
+    float lowestScanPoint = lowestScanPointLayer(cell);
+    float sensorXatLowestScan = sensorXatLowestScanLayer(cell);
+    float sensorYatLowestScan = sensorYatLowestScanLayer(cell);
+    float sensorZatLowestScan = sensorZatLowestScanLayer(cell);
+
+    for (unsigned int k = cellPointOffsets_[cell]; k < cellPointOffsets_[cell + 1]; ++k) {
+      const unsigned int i = sortedPointIndices_[k];
+      const auto& point = pointCloud->points[i];
+
+      const float& pointVariance = pointCloudVariances(i);
+      // The basic layers of the raw map are elevation and variance.
+      const bool isValid = std::isfinite(elevation) && std::isfinite(variance);
+      if (!isValid) {
+        // No prior information in elevation map, use measurement.
+        elevation = point.z;  // NOLINT(cppcoreguidelines-pro-type-union-access)
+        variance = pointVariance;
+        horizontalVarianceX = parameters.minHorizontalVariance_;
+        horizontalVarianceY = parameters.minHorizontalVariance_;
+        horizontalVarianceXY = 0.0;
+        grid_map::colorVectorToValue(point.getRGBVector3i(), color);
+        continue;
+      }
 
-  for (unsigned int i = 0; i < pointCloud->size(); ++i) {
-    auto& point = pointCloud->points[i];
-    grid_map::Index index;
-    grid_map::Position position(point.x, point.y);  // NOLINT(cppcoreguidelines-pro-type-union-access)
-    if (!rawMap_.getIndex(position, index)) {
-      continue;  // Skip this point if it does not lie within the elevation map.
-    }
+      // Deal with multiple heights in one cell.
+      const double mahalanobisDistance = fabs(point.z - elevation) / sqrt(variance);  // NOLINT(cppcoreguidelines-pro-type-union-access)
+      if (mahalanobisDistance > parameters.mahalanobisDistanceThreshold_) {
+        if (scanTimeSinceInitialization - time <= parameters.scanningDuration_ &&
+            elevation > point.z) {  // NOLINT(cppcoreguidelines-pro-type-union-access)
+          // Ignore point if measurement is from the same point cloud (time comparison) and
+          // if measurement is lower then the elevation in the map.
+        } else if (scanTimeSinceInitialization - time <= parameters.scanningDuration_) {
+          // If point is higher.
+          elevation = parameters.increaseHeightAlpha_ * elevation +
+                      (1.0 - parameters.increaseHeightAlpha_) * point.z;  // NOLINT(cppcoreguidelines-pro-type-union-access)
+          variance = parameters.increaseHeightAlpha_ * variance + (1.0 - parameters.increaseHeightAlpha_) * pointVariance;
+        } else {
+          variance += parameters.multiHeightNoise_;
+        }
+        continue;
+      }
+
+      // Store lowest points from scan for visibility checking.
+      const float pointHeightPlusUncertainty =
+          point.z + 3.0 * sqrt(pointVariance);  // 3 sigma. // NOLINT(cppcoreguidelines-pro-type-union-access)
+      if (std::isnan(lowestScanPoint) || pointHeightPlusUncertainty < lowestScanPoint) {
+        lowestScanPoint = pointHeightPlusUncertainty;
+        sensorXatLowestScan = sensorTranslation.x();
+        sensorYatLowestScan = sensorTranslation.y();
+        sensorZatLowestScan = sensorTranslation.z();
+      }
 
-    auto& elevation = elevationLayer(index(0), index(1));
-    auto& variance = varianceLayer(index(0), index(1));
-    auto& horizontalVarianceX = horizontalVarianceXLayer(index(0), index(1));
-    auto& horizontalVarianceY = horizontalVarianceYLayer(index(0), index(1));
-    auto& horizontalVarianceXY = horizontalVarianceXYLayer(index(0), index(1));
-    auto& color = colorLayer(index(0), index(1));
-    auto& time = timeLayer(index(0), index(1));
-    auto& dynamicTime = dynamicTimeLayer(index(0), index(1));
-    auto& lowestScanPoint = lowestScanPointLayer(index(0), index(1));
-    auto& sensorXatLowestScan = sensorXatLowestScanLayer(index(0), index(1));
-    auto& sensorYatLowestScan = sensorYatLowestScanLayer(index(0), index(1));
-    auto& sensorZatLowestScan = sensorZatLowestScanLayer(index(0), index(1));
-
-    const float& pointVariance = pointCloudVariances(i);
-    bool isValid = std::all_of(basicLayers_.begin(), basicLayers_.end(),
-                               [&](Eigen::Ref<const grid_map::Matrix> layer) { return std::isfinite(layer(index(0), index(1))); });
-    if (!isValid) {
-      // No prior information in elevation map, use measurement.
-      elevation = point.z;  // NOLINT(cppcoreguidelines-pro-type-union-access)
-      variance = pointVariance;
+      // Fuse measurement with elevation map data.
+      elevation =
+          (variance * point.z + pointVariance * elevation) / (variance + pointVariance);  // NOLINT(cppcoreguidelines-pro-type-union-access)
+      variance = (pointVariance * variance) / (pointVariance + variance);
+      // TODO(max): Add color fusion.
+      grid_map::colorVectorToValue(point.getRGBVector3i(), color);
+      time = scanTimeSinceInitialization;
+      dynamicTime = currentTimeSecondsPattern;
+
+      // Horizontal variances are reset.
       horizontalVarianceX = parameters.minHorizontalVariance_;
       horizontalVarianceY = parameters.minHorizontalVariance_;
       horizontalVarianceXY = 0.0;
-      grid_map::colorVectorToValue(point.getRGBVector3i(), color);
-      continue;
-    }
-
-    // Deal with multiple heights in one cell.
-    const double mahalanobisDistance = fabs(point.z - elevation) / sqrt(variance);  // NOLINT(cppcoreguidelines-pro-type-union-access)
-    if (mahalanobisDistance > parameters.mahalanobisDistanceThreshold_) {
-      if (scanTimeSinceInitialization - time <= parameters.scanningDuration_ &&
-          elevation > point.z) {  // NOLINT(cppcoreguidelines-pro-type-union-access)
-        // Ignore point if measurement is from the same point cloud (time comparison) and
-        // if measurement is lower then the elevation in the map.
-      } else if (scanTimeSinceInitialization - time <= parameters.scanningDuration_) {
-        // If point is higher.
-        elevation = parameters.increaseHeightAlpha_ * elevation +
-                    (1.0 - parameters.increaseHeightAlpha_) * point.z;  // NOLINT(cppcoreguidelines-pro-type-union-access)
-        variance = parameters.increaseHeightAlpha_ * variance + (1.0 - parameters.increaseHeightAlpha_) * pointVariance;
-      } else {
-        variance += parameters.multiHeightNoise_;
-      }
-      continue;
     }
 
-    // Store lowest points from scan for visibility checking.
-    const float pointHeightPlusUncertainty =
-        point.z + 3.0 * sqrt(pointVariance);  // 3 sigma. // NOLINT(cppcoreguidelines-pro-type-union-access)
-    if (std::isnan(lowestScanPoint) || pointHeightPlusUncertainty < lowestScanPoint) {
-      lowestScanPoint = pointHeightPlusUncertainty;
-      const grid_map::Position3 sensorTranslation(transformationSensorToMap.translation());
-      sensorXatLowestScan = sensorTranslation.x();
-      sensorYatLowestScan = sensorTranslation.y();
-      sensorZatLowestScan = sensorTranslation.z();
+    elevationLayer(cell) = elevation;
+    varianceLayer(cell) = variance;
+    horizontalVarianceXLayer(cell) = horizontalVarianceX;
+    horizontalVarianceYLayer(cell) = horizontalVarianceY;
+    horizontalVarianceXYLayer(cell) = horizontalVarianceXY;
+    colorLayer(cell) = color;
+    timeLayer(cell) = time;
+    dynamicTimeLayer(cell) = dynamicTime;
+    lowestScanPointLayer(cell) = lowestScanPoint;
+    sensorXatLowestScanLayer(cell) = sensorXatLowestScan;
+    sensorYatLowestScanLayer(cell) = sensorYatLowestScan;
+    sensorZatLowestScanLayer(cell) = sensorZatLowestScan;
+  };
+
+  const std::size_t cellsPerTask = 512;
+  const std::size_t numberOfTasks = (updatedCells_.size() + cellsPerTask - 1) / cellsPerTask;
+  postprocessorPool_.runParallel(numberOfTasks, [&](std::size_t task) {
+    const std::size_t end = std::min(updatedCells_.size(), (task + 1) * cellsPerTask);
+    for (std::size_t j = task * cellsPerTask; j < end; ++j) {
+      updateCell(updatedCells_[j]);
     }
-
-    // Fuse measurement with elevation map data.
-    elevation =
-        (variance * point.z + pointVariance * elevation) / (variance + pointVariance);  // NOLINT(cppcoreguidelines-pro-type-union-access)
-    variance = (pointVariance * variance) / (pointVariance + variance);
-    // TODO(max): Add color fusion.
-    grid_map::colorVectorToValue(point.getRGBVector3i(), color);
-    time = scanTimeSinceInitialization;
-    dynamicTime = currentTimeSecondsPattern;
-
-    // Horizontal variances are reset.
-    horizontalVarianceX = parameters.minHorizontalVariance_;
-    horizontalVarianceY = parameters.minHorizontalVariance_;
-    horizontalVarianceXY = 0.0;
-  }
+  });
 
   clean();
   rawMap_.setTimestamp(timestamp.toNSec());  // Point cloud stores time in microseconds.
 
-  const ros::WallDuration duration = ros::WallTime::now() - methodStartTime;
-  ROS_DEBUG("Raw map has been updated with a new point cloud in %f s.", duration.toSec());
+  ROS_DEBUG("Raw map has been updated with a new point cloud in %f s.", profilerZone.elapsedSec());
   return true;
 }
 
+int ElevationMap::computePointCellIndices(const PointCloudType& pointCloud) {
+  // Same computation as grid_map::getIndexFromPosition(), written as a branch-free loop over all points so that the compiler can
+  // vectorize it. Points outside the map get the index numberOfCells.
+  const grid_map::Size& size = rawMap_.getSize();
+  const grid_map::Index& startIndex = rawMap_.getStartIndex();
+  const int numberOfCells = size.prod();
+  const double resolution = rawMap_.getResolution();
+  const grid_map::Vector offset = 0.5 * rawMap_.getLength().matrix();
+  const grid_map::Position& mapPosition = rawMap_.getPosition();
+  const grid_map::Length& length = rawMap_.getLength();
+
+  const std::size_t numberOfPoints = pointCloud.size();
+  pointCellIndices_.resize(numberOfPoints);
+  for (std::size_t i = 0; i < numberOfPoints; ++i) {
+    const auto& point = pointCloud.points[i];
+    const grid_map::Position position(point.x, point.y);  // NOLINT(cppcoreguidelines-pro-type-union-access)
+    // Buffer order is the map frame with flipped axes.
+    const grid_map::Vector positionInBufferOrder = -(position - mapPosition - offset);
+    const grid_map::Vector indexVector = -((position - offset - mapPosition).array() / resolution).matrix();
+    const int unwrappedRow = static_cast<int>(indexVector.x());
+    const int unwrappedCol = static_cast<int>(indexVector.y());
+    int row = unwrappedRow + startIndex(0);
+    int col = unwrappedCol + startIndex(1);
+    row -= (row >= size(0)) ? size(0) : 0;
+    col -= (col >= size(1)) ? size(1) : 0;
+    const bool isInside = positionInBufferOrder.x() >= 0.0 && positionInBufferOrder.y() >= 0.0 &&
+                          positionInBufferOrder.x() < length(0) && positionInBufferOrder.y() < length(1) && unwrappedRow < size(0) &&
+                          unwrappedCol < size(1);
+    pointCellIndices_[i] = isInside ? row + col * size(0) : numberOfCells;
+  }
+  return numberOfCells;
+}
+
+void ElevationMap::bucketPointsByCell(const int numberOfCells) {
+  // Counting sort by cell index, stable so that the points of a cell keep the order of the point cloud.
+  cellPointOffsets_.assign(numberOfCells + 2, 0);
+  for (const int cell : pointCellIndices_) {
+    ++cellPointOffsets_[cell + 1];
+  }
+  updatedCells_.clear();
+  for (int cell = 0; cell < numberOfCells; ++cell) {
+    if (cellPointOffsets_[cell + 1] > 0) {
+      updatedCells_.push_back(cell);
+    }
+    cellPointOffsets_[cell + 1] += cellPointOffsets_[cell];
+  }
+  // Points outside the map are counted in the last bucket and not sorted.
+  sortedPointIndices_.resize(cellPointOffsets_[numberOfCells]);
+  cellPointInsertPositions_.assign(cellPointOffsets_.begin(), cellPointOffsets_.begin() + numberOfCells);
+  for (unsigned int i = 0; i < pointCellIndices_.size(); ++i) {
+    const int cell = pointCellIndices_[i];
+    if (cell < numberOfCells) {
+      sortedPointIndices_[cellPointInsertPositions_[cell]++] = i;
+    }
+  }
+}
+
 bool ElevationMap::update(const grid_map::Matrix& varianceUpdate, const grid_map::Matrix& horizontalVarianceUpdateX,
                           const grid_map::Matrix& horizontalVarianceUpdateY, const grid_map::Matrix& horizontalVarianceUpdateXY,
                           const ros::Time& time) {
@@ -252,15 +340,18 @@ bool ElevationMap::fuse(const grid_map::Index& topLeftIndex, const grid_map::Ind
   }
 
   // Initializations.
-  const ros::WallTime methodStartTime(ros::WallTime::now());
-
-  // Copy raw elevation map data for safe multi-threading.
-  boost::recursive_mutex::scoped_lock scopedLockForRawData(rawMapMutex_);
-  auto rawMapCopy = rawMap_;
-  scopedLockForRawData.unlock();
+  PROFILE_ZONE_NAMED(profilerZone, "elevation_mapping/fuse");
 
   boost::recursive_mutex::scoped_lock scopedLock(fusedMapMutex_);
 
+  // Snapshot the raw layers needed by the fusion for safe multi-threading. The buffer keeps its memory across calls and the layers that
+  // are not read here (time, lowest scan point, etc.) are not copied.
+  {
+    boost::recursive_mutex::scoped_lock scopedLockForRawData(rawMapMutex_);
+    updateRawMapBuffer(rawMapFusionBuffer_);
+  }
+  const grid_map::GridMap& rawMapCopy = rawMapFusionBuffer_;
+
   // More initializations.
   const double halfResolution = fusedMap_.getResolution() / 2.0;
   const float minimalWeight = std::numeric_limits<float>::epsilon() * static_cast<float>(2.0);
@@ -277,138 +368,182 @@ bool ElevationMap::fuse(const grid_map::Index& topLeftIndex, const grid_map::Ind
     fusedMap_.move(rawMapCopy.getPosition());
   }
 
-  // For each cell in requested area.
-  for (grid_map::SubmapIterator areaIterator(rawMapCopy, topLeftIndex, size); !areaIterator.isPastEnd(); ++areaIterator) {
-    // Check if fusion for this cell has already been done earlier.
-    if (fusedMap_.isValid(*areaIterator)) {
-      continue;
-    }
-
-    if (!rawMapCopy.isValid(*areaIterator)) {
-      // This is an empty cell (hole in the map).
-      // TODO(max):
-      continue;
-    }
-
-    // Get size of error ellipse.
-    const float& sigmaXsquare = rawMapCopy.at("horizontal_variance_x", *areaIterator);
-    const float& sigmaYsquare = rawMapCopy.at("horizontal_variance_y", *areaIterator);
-    const float& sigmaXYsquare = rawMapCopy.at("horizontal_variance_xy", *areaIterator);
-
-    Eigen::Matrix2d covarianceMatrix;
-    covarianceMatrix << sigmaXsquare, sigmaXYsquare, sigmaXYsquare, sigmaYsquare;
-    // 95.45% confidence ellipse which is 2.486-sigma for 2 dof problem.
-    // http://www.reid.ai/2012/09/chi-squared-distribution-table-with.html
-    const double uncertaintyFactor = 2.486;  // sqrt(6.18)
-    Eigen::EigenSolver<Eigen::Matrix2d> solver(covarianceMatrix);
-    Eigen::Array2d eigenvalues(solver.eigenvalues().real().cwiseAbs());
-
-    Eigen::Array2d::Index maxEigenvalueIndex{0};
-    eigenvalues.maxCoeff(&maxEigenvalueIndex);
-    Eigen::Array2d::Index minEigenvalueIndex{0};
-    maxEigenvalueIndex == Eigen::Array2d::Index(0) ? minEigenvalueIndex = 1 : minEigenvalueIndex = 0;
-    const grid_map::Length ellipseLength =
-        2.0 * uncertaintyFactor * grid_map::Length(eigenvalues(maxEigenvalueIndex), eigenvalues(minEigenvalueIndex)).sqrt() +
-        ellipseExtension;
-    const double ellipseRotation(
-        atan2(solver.eigenvectors().col(maxEigenvalueIndex).real()(1), solver.eigenvectors().col(maxEigenvalueIndex).real()(0)));
-
-    // Requested length and position (center) of submap in map.
-    grid_map::Position requestedSubmapPosition;
-    rawMapCopy.getPosition(*areaIterator, requestedSubmapPosition);
-    grid_map::EllipseIterator ellipseIterator(rawMapCopy, requestedSubmapPosition, ellipseLength, ellipseRotation);
-
-    // Prepare data fusion.
+  // Store layer handles for efficient iteration.
+  const grid_map::ConstLayerHandle rawElevationLayer = rawMapCopy.getLayerHandle("elevation");
+  const grid_map::ConstLayerHandle rawVarianceLayer = rawMapCopy.getLayerHandle("variance");
+  const grid_map::ConstLayerHandle rawHorizontalVarianceXLayer = rawMapCopy.getLayerHandle("horizontal_variance_x");
+  const grid_map::ConstLayerHandle rawHorizontalVarianceYLayer = rawMapCopy.getLayerHandle("horizontal_variance_y");
+  const grid_map::ConstLayerHandle rawHorizontalVarianceXYLayer = rawMapCopy.getLayerHandle("horizontal_variance_xy");
+  const grid_map::ConstLayerHandle rawColorLayer = rawMapCopy.getLayerHandle("color");
+  const grid_map::LayerHandle elevationLayer = fusedMap_.getLayerHandle("elevation");
+  const grid_map::LayerHandle lowerBoundLayer = fusedMap_.getLayerHandle("lower_bound");
+  const grid_map::LayerHandle upperBoundLayer = fusedMap_.getLayerHandle("upper_bound");
+  const grid_map::LayerHandle colorLayer = fusedMap_.getLayerHandle("color");
+
+  // The raw and fused basic layers are (elevation, variance) and (elevation, upper_bound, lower_bound).
+  auto isRawValid = [&](const grid_map::Index& index) { return rawElevationLayer.isValid(index) && rawVarianceLayer.isValid(index); };
+  auto isFusedValid = [&](const grid_map::Index& index) {
+    return elevationLayer.isValid(index) && upperBoundLayer.isValid(index) && lowerBoundLayer.isValid(index);
+  };
+
+  // Each cell reads the (constant) raw snapshot and writes only its own fused cell, so the requested area is processed as independent
+  // tiles of rows on the postprocessor threads.
+  const int rowsPerTile = 8;
+  const std::size_t numberOfTiles = (size(0) + rowsPerTile - 1) / rowsPerTile;
+  const grid_map::Size& bufferSize = rawMapCopy.getSize();
+
+  auto fuseTile = [&](std::size_t tile) {
+    const int rowOffset = static_cast<int>(tile) * rowsPerTile;
+    grid_map::Index tileTopLeftIndex = topLeftIndex + grid_map::Index(rowOffset, 0);
+    grid_map::wrapIndexToRange(tileTopLeftIndex, bufferSize);
+    const grid_map::Index tileSize(std::min(rowsPerTile, size(0) - rowOffset), size(1));
+
+    // Per-tile buffers, reused for all cells of the tile.
     Eigen::ArrayXf means;
     Eigen::ArrayXf weights;
-    const unsigned int maxNumberOfCellsToFuse = ellipseIterator.getSubmapSize().prod();
-    means.resize(maxNumberOfCellsToFuse);
-    weights.resize(maxNumberOfCellsToFuse);
-    WeightedEmpiricalCumulativeDistributionFunction<float> lowerBoundDistribution;
-    WeightedEmpiricalCumulativeDistributionFunction<float> upperBoundDistribution;
-
-    float maxStandardDeviation = sqrt(eigenvalues(maxEigenvalueIndex));
-    float minStandardDeviation = sqrt(eigenvalues(minEigenvalueIndex));
-    Eigen::Rotation2Dd rotationMatrix(ellipseRotation);
-    std::string maxEigenvalueLayer;
-    std::string minEigenvalueLayer;
-    if (maxEigenvalueIndex == 0) {
-      maxEigenvalueLayer = "horizontal_variance_x";
-      minEigenvalueLayer = "horizontal_variance_y";
-    } else {
-      maxEigenvalueLayer = "horizontal_variance_y";
-      minEigenvalueLayer = "horizontal_variance_x";
-    }
 
-    // For each cell in error ellipse.
-    size_t i = 0;
-    for (; !ellipseIterator.isPastEnd(); ++ellipseIterator) {
-      if (!rawMapCopy.isValid(*ellipseIterator)) {
-        // Empty cell in submap (cannot be center cell because we checked above).
+    // For each cell in requested area.
+    for (grid_map::SubmapIterator areaIterator(rawMapCopy, tileTopLeftIndex, tileSize); !areaIterator.isPastEnd(); ++areaIterator) {
+      const grid_map::Index& index = *areaIterator;
+
+      // Check if fusion for this cell has already been done earlier.
+      if (isFusedValid(index)) {
         continue;
       }
 
-      means[i] = rawMapCopy.at("elevation", *ellipseIterator);
+      if (!isRawValid(index)) {
+        // This is an empty cell (hole in the map).
+        // TODO(max):
+        continue;
+      }
 
-      // Compute weight from probability.
-      grid_map::Position absolutePosition;
-      rawMapCopy.getPosition(*ellipseIterator, absolutePosition);
-      Eigen::Vector2d distanceToCenter = (rotationMatrix * (absolutePosition - requestedSubmapPosition)).cwiseAbs();
+      // Get size of error ellipse.
+      const float& sigmaXsquare = rawHorizontalVarianceXLayer(index);
+      const float& sigmaYsquare = rawHorizontalVarianceYLayer(index);
+      const float& sigmaXYsquare = rawHorizontalVarianceXYLayer(index);
+
+      Eigen::Matrix2d covarianceMatrix;
+      covarianceMatrix << sigmaXsquare, sigmaXYsquare, sigmaXYsquare, sigmaYsquare;
+      // 95.45% confidence ellipse which is 2.486-sigma for 2 dof problem.
+      // http://www.reid.ai/2012/09/chi-squared-distribution-table-with.html
+      const double uncertaintyFactor = 2.486;  // sqrt(6.18)
+      Eigen::EigenSolver<Eigen::Matrix2d> solver(covarianceMatrix);
+      Eigen::Array2d eigenvalues(solver.eigenvalues().real().cwiseAbs());
+
+      Eigen::Array2d::Index maxEigenvalueIndex{0};
+      eigenvalues.maxCoeff(&maxEigenvalueIndex);
+      Eigen::Array2d::Index minEigenvalueIndex{0};
+      maxEigenvalueIndex == Eigen::Array2d::Index(0) ? minEigenvalueIndex = 1 : minEigenvalueIndex = 0;
+      const grid_map::Length ellipseLength =
+          2.0 * uncertaintyFactor * grid_map::Length(eigenvalues(maxEigenvalueIndex), eigenvalues(minEigenvalueIndex)).sqrt() +
+          ellipseExtension;
+      const double ellipseRotation(
+          atan2(solver.eigenvectors().col(maxEigenvalueIndex).real()(1), solver.eigenvectors().col(maxEigenvalueIndex).real()(0)));
+
+      // Requested length and position (center) of submap in map.
+      grid_map::Position requestedSubmapPosition;
+      rawMapCopy.getPosition(index, requestedSubmapPosition);
+      grid_map::EllipseIterator ellipseIterator(rawMapCopy, requestedSubmapPosition, ellipseLength, ellipseRotation);
+
+      // Prepare data fusion.
+      const unsigned int maxNumberOfCellsToFuse = ellipseIterator.getSubmapSize().prod();
+      means.resize(maxNumberOfCellsToFuse);
+      weights.resize(maxNumberOfCellsToFuse);
+      WeightedEmpiricalCumulativeDistributionFunction<float> lowerBoundDistribution;
+      WeightedEmpiricalCumulativeDistributionFunction<float> upperBoundDistribution;
+
+      float maxStandardDeviation = sqrt(eigenvalues(maxEigenvalueIndex));
+      float minStandardDeviation = sqrt(eigenvalues(minEigenvalueIndex));
+      Eigen::Rotation2Dd rotationMatrix(ellipseRotation);
+
+      // For each cell in error ellipse.
+      size_t i = 0;
+      for (; !ellipseIterator.isPastEnd(); ++ellipseIterator) {
+        const grid_map::Index& ellipseIndex = *ellipseIterator;
+        if (!isRawValid(ellipseIndex)) {
+          // Empty cell in submap (cannot be center cell because we checked above).
+          continue;
+        }
 
-      float probability1 = cumulativeDistributionFunction(distanceToCenter.x() + halfResolution, 0.0, maxStandardDeviation) -
-                           cumulativeDistributionFunction(distanceToCenter.x() - halfResolution, 0.0, maxStandardDeviation);
-      float probability2 = cumulativeDistributionFunction(distanceToCenter.y() + halfResolution, 0.0, minStandardDeviation) -
-                           cumulativeDistributionFunction(distanceToCenter.y() - halfResolution, 0.0, minStandardDeviation);
+        means[i] = rawElevationLayer(ellipseIndex);
 
-      const float weight = std::max(minimalWeight, probability1 * probability2);
-      weights[i] = weight;
-      const float standardDeviation = sqrt(rawMapCopy.at("variance", *ellipseIterator));
-      lowerBoundDistribution.add(means[i] - 2.0 * standardDeviation, weight);
-      upperBoundDistribution.add(means[i] + 2.0 * standardDeviation, weight);
+        // Compute weight from probability.
+        grid_map::Position absolutePosition;
+        rawMapCopy.getPosition(ellipseIndex, absolutePosition);
+        Eigen::Vector2d distanceToCenter = (rotationMatrix * (absolutePosition - requestedSubmapPosition)).cwiseAbs();
 
-      i++;
-    }
+        float probability1 = cumulativeDistributionFunction(distanceToCenter.x() + halfResolution, 0.0, maxStandardDeviation) -
+                             cumulativeDistributionFunction(distanceToCenter.x() - halfResolution, 0.0, maxStandardDeviation);
+        float probability2 = cumulativeDistributionFunction(distanceToCenter.y() + halfResolution, 0.0, minStandardDeviation) -
+                             cumulativeDistributionFunction(distanceToCenter.y() - halfResolution, 0.0, minStandardDeviation);
 
-    if (i == 0) {
-      // Nothing to fuse.
-      fusedMap_.at("elevation", *areaIterator) = rawMapCopy.at("elevation", *areaIterator);
-      fusedMap_.at("lower_bound", *areaIterator) =
-          rawMapCopy.at("elevation", *areaIterator) - 2.0 * sqrt(rawMapCopy.at("variance", *areaIterator));
-      fusedMap_.at("upper_bound", *areaIterator) =
-          rawMapCopy.at("elevation", *areaIterator) + 2.0 * sqrt(rawMapCopy.at("variance", *areaIterator));
-      fusedMap_.at("color", *areaIterator) = rawMapCopy.at("color", *areaIterator);
-      continue;
-    }
+        const float weight = std::max(minimalWeight, probability1 * probability2);
+        weights[i] = weight;
+        const float standardDeviation = sqrt(rawVarianceLayer(ellipseIndex));
+        lowerBoundDistribution.add(means[i] - 2.0 * standardDeviation, weight);
+        upperBoundDistribution.add(means[i] + 2.0 * standardDeviation, weight);
 
-    // Fuse.
-    means.conservativeResize(i);
-    weights.conservativeResize(i);
+        i++;
+      }
 
-    float mean = (weights * means).sum() / weights.sum();
+      const float rawElevation = rawElevationLayer(index);
+      if (i == 0) {
+        // Nothing to fuse.
+        const float rawStandardDeviation = sqrt(rawVarianceLayer(index));
+        elevationLayer(index) = rawElevation;
+        lowerBoundLayer(index) = rawElevation - 2.0 * rawStandardDeviation;
+        upperBoundLayer(index) = rawElevation + 2.0 * rawStandardDeviation;
+        colorLayer(index) = rawColorLayer(index);
+        continue;
+      }
 
-    if (!std::isfinite(mean)) {
-      ROS_ERROR("Something went wrong when fusing the map: Mean = %f", mean);
-      continue;
+      // Fuse.
+      const float mean = (weights.head(i) * means.head(i)).sum() / weights.head(i).sum();
+
+      if (!std::isfinite(mean)) {
+        ROS_ERROR("Something went wrong when fusing the map: Mean = %f", mean);
+        continue;
+      }
+
+      // Add to fused map.
+      elevationLayer(index) = mean;
+      lowerBoundDistribution.compute();
+      upperBoundDistribution.compute();
+      lowerBoundLayer(index) = lowerBoundDistribution.quantile(0.01);  // TODO(max):
+      upperBoundLayer(index) = upperBoundDistribution.quantile(0.99);  // TODO(max):
+      // TODO(max): Add fusion of colors.
+      colorLayer(index) = rawColorLayer(index);
     }
+  };
 
-    // Add to fused map.
-    fusedMap_.at("elevation", *areaIterator) = mean;
-    lowerBoundDistribution.compute();
-    upperBoundDistribution.compute();
-    fusedMap_.at("lower_bound", *areaIterator) = lowerBoundDistribution.quantile(0.01);  // TODO(max):
-    fusedMap_.at("upper_bound", *areaIterator) = upperBoundDistribution.quantile(0.99);  // TODO(max):
-    // TODO(max): Add fusion of colors.
-    fusedMap_.at("color", *areaIterator) = rawMapCopy.at("color", *areaIterator);
-  }
+  postprocessorPool_.runParallel(numberOfTiles, fuseTile);
 
   fusedMap_.setTimestamp(rawMapCopy.getTimestamp());
 
-  const ros::WallDuration duration(ros::WallTime::now() - methodStartTime);
-  ROS_DEBUG("Elevation map has been fused in %f s.", duration.toSec());
+  ROS_DEBUG("Elevation map has been fused in %f s.", profilerZone.elapsedSec());
 
   return true;
 }
 
+void ElevationMap::updateRawMapBuffer(grid_map::GridMap& buffer) {
+  if ((buffer.getSize() != rawMap_.getSize()).any() || buffer.getResolution() != rawMap_.getResolution()) {
+    buffer.setGeometry(rawMap_.getLength(), rawMap_.getResolution(), rawMap_.getPosition());
+  } else {
+    buffer.setPosition(rawMap_.getPosition());
+  }
+  buffer.setStartIndex(rawMap_.getStartIndex());
+  buffer.setTimestamp(rawMap_.getTimestamp());
+  buffer.setFrameId(rawMap_.getFrameId());
+  for (const std::string& layer : buffer.getLayers()) {
+    // Layers of the buffer only (e.g. computed from the copy) are left as they are.
+    if (!rawMap_.exists(layer)) {
+      continue;
+    }
+    // Same size, so this is a plain copy into the existing storage.
+    buffer.get(layer) = rawMap_.get(layer);
+  }
+}
+
 bool ElevationMap::clear() {
   // Lock raw and fused map object in different scopes to prevent deadlock.
   {
@@ -428,99 +563,164 @@ bool ElevationMap::clear() {
 void ElevationMap::visibilityCleanup(const ros::Time& updatedTime) {
   const Parameters parameters{parameters_.getData()};
   // Get current time to compute calculation time.
-  const ros::WallTime methodStartTime(ros::WallTime::now());
+  PROFILE_ZONE_NAMED(profilerZone, "elevation_mapping/visibility_cleanup");
   const double timeSinceInitialization = (updatedTime - initialTime_).toSec();
 
-  // Copy raw elevation map data for safe multi-threading.
+  // Copy the raw map layers used by the cleanup for safe multi-threading (the buffer keeps its memory across calls).
   boost::recursive_mutex::scoped_lock scopedLockForVisibilityCleanupData(visibilityCleanupMapMutex_);
   boost::recursive_mutex::scoped_lock scopedLockForRawData(rawMapMutex_);
-  visibilityCleanupMap_ = rawMap_;
+  updateRawMapBuffer(visibilityCleanupMap_);
   rawMap_.clear("lowest_scan_point");
   rawMap_.clear("sensor_x_at_lowest_scan");
   rawMap_.clear("sensor_y_at_lowest_scan");
   rawMap_.clear("sensor_z_at_lowest_scan");
   scopedLockForRawData.unlock();
-  visibilityCleanupMap_.add("max_height");
 
-  // Create max. height layer with ray tracing.
-  for (grid_map::GridMapIterator iterator(visibilityCleanupMap_); !iterator.isPastEnd(); ++iterator) {
-    if (!visibilityCleanupMap_.isValid(*iterator)) {
-      continue;
-    }
-    const auto& lowestScanPoint = visibilityCleanupMap_.at("lowest_scan_point", *iterator);
-    const auto& sensorXatLowestScan = visibilityCleanupMap_.at("sensor_x_at_lowest_scan", *iterator);
-    const auto& sensorYatLowestScan = visibilityCleanupMap_.at("sensor_y_at_lowest_scan", *iterator);
-    const auto& sensorZatLowestScan = visibilityCleanupMap_.at("sensor_z_at_lowest_scan", *iterator);
-    if (std::isnan(lowestScanPoint)) {
-      continue;
-    }
-    grid_map::Index indexAtSensor;
-    if (!visibilityCleanupMap_.getIndex(grid_map::Position(sensorXatLowestScan, sensorYatLowestScan), indexAtSensor)) {
-      continue;
+  // Store layer handles for efficient iteration.
+  const grid_map::ConstLayerHandle elevationLayer = visibilityCleanupMap_.getLayerHandle("elevation");
+  const grid_map::ConstLayerHandle varianceLayer = visibilityCleanupMap_.getLayerHandle("variance");
+  const grid_map::ConstLayerHandle lowestScanPointLayer = visibilityCleanupMap_.getLayerHandle("lowest_scan_point");
+  const grid_map::ConstLayerHandle sensorXatLowestScanLayer = visibilityCleanupMap_.getLayerHandle("sensor_x_at_lowest_scan");
+  const grid_map::ConstLayerHandle sensorYatLowestScanLayer = visibilityCleanupMap_.getLayerHandle("sensor_y_at_lowest_scan");
+  const grid_map::ConstLayerHandle sensorZatLowestScanLayer = visibilityCleanupMap_.getLayerHandle("sensor_z_at_lowest_scan");
+  // The basic layers of the raw map are elevation and variance.
+  auto isValid = [&](const grid_map::Index& index) { return elevationLayer.isValid(index) && varianceLayer.isValid(index); };
+
+  // Create max. height layer with ray tracing. The rays of the cells cross each other, so the tiles of rows run on the postprocessor
+  // threads with one max. height buffer per concurrent tile, and the buffers are merged afterwards by keeping the lowest bound.
+  const grid_map::Size size = visibilityCleanupMap_.getSize();
+  const float noMaxHeight = std::numeric_limits<float>::infinity();
+  const int rowsPerTile = 8;
+  const std::size_t numberOfTiles = (size(0) + rowsPerTile - 1) / rowsPerTile;
+  std::deque<grid_map::Matrix> maxHeightBuffers;
+  std::vector<grid_map::Matrix*> freeMaxHeightBuffers;
+  boost::mutex maxHeightBuffersMutex;
+
+  auto traceTile = [&](std::size_t tile) {
+    grid_map::Matrix* maxHeightBuffer{nullptr};
+    {
+      boost::lock_guard<boost::mutex> lock(maxHeightBuffersMutex);
+      if (freeMaxHeightBuffers.empty()) {
+        maxHeightBuffers.emplace_back(grid_map::Matrix::Constant(size(0), size(1), noMaxHeight));
+        maxHeightBuffer = &maxHeightBuffers.back();
+      } else {
+        maxHeightBuffer = freeMaxHeightBuffers.back();
+        freeMaxHeightBuffers.pop_back();
+      }
     }
-    grid_map::Position point;
-    visibilityCleanupMap_.getPosition(*iterator, point);
-    float pointDiffX = point.x() - sensorXatLowestScan;
-    float pointDiffY = point.y() - sensorYatLowestScan;
-    float distanceToPoint = sqrt(pointDiffX * pointDiffX + pointDiffY * pointDiffY);
-    if (distanceToPoint > 0.0) {
-      for (grid_map::LineIterator iterator(visibilityCleanupMap_, indexAtSensor, *iterator); !iterator.isPastEnd(); ++iterator) {
-        grid_map::Position cellPosition;
-        visibilityCleanupMap_.getPosition(*iterator, cellPosition);
-        const float cellDiffX = cellPosition.x() - sensorXatLowestScan;
-        const float cellDiffY = cellPosition.y() - sensorYatLowestScan;
-        const float distanceToCell = distanceToPoint - sqrt(cellDiffX * cellDiffX + cellDiffY * cellDiffY);
-        const float maxHeightPoint = lowestScanPoint + (sensorZatLowestScan - lowestScanPoint) / distanceToPoint * distanceToCell;
-        auto& cellMaxHeight = visibilityCleanupMap_.at("max_height", *iterator);
-        if (std::isnan(cellMaxHeight) || cellMaxHeight > maxHeightPoint) {
-          cellMaxHeight = maxHeightPoint;
+    grid_map::Matrix& maxHeight = *maxHeightBuffer;
+
+    const int rowBegin = static_cast<int>(tile) * rowsPerTile;
+    const int rowEnd = std::min(rowBegin + rowsPerTile, size(0));
+    for (int col = 0; col < size(1); ++col) {
+      for (int row = rowBegin; row < rowEnd; ++row) {
+        const grid_map::Index index(row, col);
+        if (!isValid(index)) {
+          continue;
+        }
+        const float lowestScanPoint = lowestScanPointLayer(index);
+        const float sensorXatLowestScan = sensorXatLowestScanLayer(index);
+        const float sensorYatLowestScan = sensorYatLowestScanLayer(index);
+        const float sensorZatLowestScan = sensorZatLowestScanLayer(index);
+        if (std::isnan(lowestScanPoint)) {
+          continue;
+        }
+        grid_map::Index indexAtSensor;
+        if (!visibilityCleanupMap_.getIndex(grid_map::Position(sensorXatLowestScan, sensorYatLowestScan), indexAtSensor)) {
+          continue;
+        }
+        grid_map::Position point;
+        visibilityCleanupMap_.getPosition(index, point);
+        float pointDiffX = point.x() - sensorXatLowestScan;
+        float pointDiffY = point.y() - sensorYatLowestScan;
+        float distanceToPoint = sqrt(pointDiffX * pointDiffX + pointDiffY * pointDiffY);
+        if (distanceToPoint > 0.0) {
+          for (grid_map::LineIterator iterator(visibilityCleanupMap_, indexAtSensor, index); !iterator.isPastEnd(); ++iterator) {
+            grid_map::Position cellPosition;
+            visibilityCleanupMap_.getPosition(*iterator, cellPosition);
+            const float cellDiffX = cellPosition.x() - sensorXatLowestScan;
+            const float cellDiffY = cellPosition.y() - sensorYatLowestScan;
+            const float distanceToCell = distanceToPoint - sqrt(cellDiffX * cellDiffX + cellDiffY * cellDiffY);
+            const float maxHeightPoint = lowestScanPoint + (sensorZatLowestScan - lowestScanPoint) / distanceToPoint * distanceToCell;
+            float& cellMaxHeight = maxHeight((*iterator)(0), (*iterator)(1));
+            if (maxHeightPoint < cellMaxHeight) {
+              cellMaxHeight = maxHeightPoint;
+            }
+          }
         }
       }
     }
-  }
 
-  // Vector of indices that will be removed.
-  std::vector<grid_map::Position> cellPositionsToRemove;
-  for (grid_map::GridMapIterator iterator(visibilityCleanupMap_); !iterator.isPastEnd(); ++iterator) {
-    if (!visibilityCleanupMap_.isValid(*iterator)) {
-      continue;
-    }
-    const auto& time = visibilityCleanupMap_.at("time", *iterator);
-    if (timeSinceInitialization - time > parameters.scanningDuration_) {
-      // Only remove cells that have not been updated during the last scan duration.
-      // This prevents a.o. removal of overhanging objects.
-      const auto& elevation = visibilityCleanupMap_.at("elevation", *iterator);
-      const auto& variance = visibilityCleanupMap_.at("variance", *iterator);
-      const auto& maxHeight = visibilityCleanupMap_.at("max_height", *iterator);
-      if (!std::isnan(maxHeight) && elevation - 3.0 * sqrt(variance) > maxHeight) {
-        grid_map::Position position;
-        visibilityCleanupMap_.getPosition(*iterator, position);
-        cellPositionsToRemove.push_back(position);
-      }
-    }
+    boost::lock_guard<boost::mutex> lock(maxHeightBuffersMutex);
+    freeMaxHeightBuffers.push_back(maxHeightBuffer);
+  };
+  postprocessorPool_.runParallel(numberOfTiles, traceTile);
+
+  grid_map::Matrix& maxHeightLayer = visibilityCleanupMap_.get("max_height");
+  maxHeightLayer.setConstant(noMaxHeight);
+  for (const grid_map::Matrix& maxHeightBuffer : maxHeightBuffers) {
+    maxHeightLayer = maxHeightLayer.cwiseMin(maxHeightBuffer);
   }
+  // Cells without rays have no max. height.
+  maxHeightLayer = (maxHeightLayer.array() == noMaxHeight).select(grid_map::Matrix::Scalar(NAN), maxHeightLayer.array());
+
+  // Mask of the cells to remove. Only remove cells that have not been updated during the last scan duration.
+  // This prevents a.o. removal of overhanging objects. Comparisons with NaN are false, so the cells without max. height are kept.
+  const grid_map::Matrix& elevation = visibilityCleanupMap_.get("elevation");
+  const grid_map::Matrix& variance = visibilityCleanupMap_.get("variance");
+  const grid_map::Matrix& time = visibilityCleanupMap_.get("time");
+  const float maxUpdateTime = static_cast<float>(timeSinceInitialization - parameters.scanningDuration_);
+  const Eigen::Array<bool, Eigen::Dynamic, Eigen::Dynamic> removalMask =
+      elevation.array().isFinite() && variance.array().isFinite() && (time.array() < maxUpdateTime) &&
+      (elevation.array() - 3.0f * variance.array().sqrt() > maxHeightLayer.array());
+  const int numberOfCellsToRemove = static_cast<int>(removalMask.count());
 
   // Remove points in current raw map.
-  scopedLockForRawData.lock();
-  for (const auto& cellPosition : cellPositionsToRemove) {
-    grid_map::Index index;
-    if (!rawMap_.getIndex(cellPosition, index)) {
-      continue;
-    }
-    if (rawMap_.isValid(index)) {
-      rawMap_.at("elevation", index) = NAN;
-      rawMap_.at("dynamic_time", index) = 0.0f;
+  if (numberOfCellsToRemove > 0) {
+    scopedLockForRawData.lock();
+    grid_map::Matrix& rawElevation = rawMap_.get("elevation");
+    const grid_map::Matrix& rawVariance = rawMap_.get("variance");
+    grid_map::Matrix& rawDynamicTime = rawMap_.get("dynamic_time");
+    if ((rawMap_.getSize() == size).all() && (rawMap_.getStartIndex() == visibilityCleanupMap_.getStartIndex()).all() &&
+        rawMap_.getPosition() == visibilityCleanupMap_.getPosition() && rawMap_.getResolution() == visibilityCleanupMap_.getResolution()) {
+      // The raw map has not moved since the copy: the mask applies to its cells as they are.
+      const Eigen::Array<bool, Eigen::Dynamic, Eigen::Dynamic> rawRemovalMask =
+          removalMask && rawElevation.array().isFinite() && rawVariance.array().isFinite();
+      rawElevation = rawRemovalMask.select(grid_map::Matrix::Scalar(NAN), rawElevation.array());
+      rawDynamicTime = rawRemovalMask.select(grid_map::Matrix::Scalar(0.0f), rawDynamicTime.array());
+    } else {
+      // Otherwise, the cells are looked up by position.
+      const grid_map::LayerHandle rawElevationLayer = rawMap_.getLayerHandle("elevation");
+      const grid_map::ConstLayerHandle rawVarianceLayer = rawMap_.getLayerHandle("variance");
+      const grid_map::LayerHandle rawDynamicTimeLayer = rawMap_.getLayerHandle("dynamic_time");
+      for (int col = 0; col < size(1); ++col) {
+        for (int row = 0; row < size(0); ++row) {
+          if (!removalMask(row, col)) {
+            continue;
+          }
+          grid_map::Position cellPosition;
+          visibilityCleanupMap_.getPosition(grid_map::Index(row, col), cellPosition);
+          grid_map::Index index;
+          if (!rawMap_.getIndex(cellPosition, index)) {
+            continue;
+          }
+          if (rawElevationLayer.isValid(index) && rawVarianceLayer.isValid(index)) {
+            rawElevationLayer(index) = NAN;
+            rawDynamicTimeLayer(index) = 0.0f;
+          }
+        }
+      }
     }
+    scopedLockForRawData.unlock();
   }
-  scopedLockForRawData.unlock();
 
   // Publish visibility cleanup map for debugging.
   publishVisibilityCleanupMap();
 
-  ros::WallDuration duration(ros::WallTime::now() - methodStartTime);
-  ROS_DEBUG("Visibility cleanup has been performed in %f s (%d points).", duration.toSec(), (int)cellPositionsToRemove.size());
-  if (duration.toSec() > parameters.visibilityCleanupDuration_) {
-    ROS_WARN("Visibility cleanup duration is too high (current rate is %f).", 1.0 / duration.toSec());
+  const double duration = profilerZone.stop();
+  ROS_DEBUG("Visibility cleanup has been performed in %f s (%d points).", duration, numberOfCellsToRemove);
+  if (duration > parameters.visibilityCleanupDuration_) {
+    ROS_WARN("Visibility cleanup duration is too high (current rate is %f).", 1.0 / duration);
   }
 }
 
@@ -559,9 +759,8 @@ bool ElevationMap::publishFusedElevationMap() {
   grid_map::GridMap fusedMapCopy = fusedMap_;
   scopedLock.unlock();
   fusedMapCopy.add("uncertainty_range", fusedMapCopy.get("upper_bound") - fusedMapCopy.get("lower_bound"));
-  grid_map_msgs::GridMap message;
-  grid_map::GridMapRosConverter::toMessage(fusedMapCopy, message);
-  elevationMapFusedPublisher_.publish(message);
+  // Serialized directly from the layers of the copy, without an intermediate message.
+  elevationMapFusedPublisher_.publish(boost::make_shared<grid_map::GridMapMessageView>(std::move(fusedMapCopy)));
   ROS_DEBUG("Elevation map (fused) has been published.");
   return true;
 }
@@ -575,14 +774,8 @@ bool ElevationMap::publishVisibilityCleanupMap() {
   scopedLock.unlock();
   visibilityCleanupMapCopy.erase("elevation");
   visibilityCleanupMapCopy.erase("variance");
-  visibilityCleanupMapCopy.erase("horizontal_variance_x");
-  visibilityCleanupMapCopy.erase("horizontal_variance_y");
-  visibilityCleanupMapCopy.erase("horizontal_variance_xy");
-  visibilityCleanupMapCopy.erase("color");
   visibilityCleanupMapCopy.erase("time");
-  grid_map_msgs::GridMap message;
-  grid_map::GridMapRosConverter::toMessage(visibilityCleanupMapCopy, message);
-  visibilityCleanupMapPublisher_.publish(message);
+  visibilityCleanupMapPublisher_.publish(boost::make_shared<grid_map::GridMapMessageView>(std::move(visibilityCleanupMapCopy)));
   ROS_DEBUG("Visibility cleanup map has been published.");
   return true;
 }
@@ -21,6 +21,7 @@
 #include <grid_map_ros/grid_map_ros.hpp>
 #include <kindr/Core>
 #include <kindr_ros/kindr_ros.hpp>
+#include <mr3d_profiling/ProfilerExporter.h>
 
 #include "elevation_mapping/ElevationMap.hpp"
 #include "elevation_mapping/ElevationMapping.hpp"
@@ -50,6 +51,11 @@ ElevationMapping::ElevationMapping(ros::NodeHandle& nodeHandle)
   setupServices();
   setupTimers();
 
+  // Export the durations of the map updates (see ElevationMap) with the other profiler zones.
+  if (nodeHandle_.param("enable_profiler", false)) {
+    mr3d_profiling::ProfilerExporter::instance().start(nodeHandle_, nodeHandle_.param("profiler_stats_file", std::string()));
+  }
+
   initialize();
 
   ROS_INFO("Successfully launched node.");
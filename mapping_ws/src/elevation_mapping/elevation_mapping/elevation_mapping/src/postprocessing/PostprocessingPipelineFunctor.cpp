@@ -8,6 +8,11 @@
  *  Note. Large parts are adopted from grid_map_demos/FiltersDemo.cpp.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#include <boost/make_shared.hpp>
 #include <grid_map_ros/grid_map_ros.hpp>
 
 #include "elevation_mapping/postprocessing/PostprocessingPipelineFunctor.hpp"
@@ -15,7 +20,15 @@
 namespace elevation_mapping {
 
 PostprocessingPipelineFunctor::PostprocessingPipelineFunctor(ros::NodeHandle& nodeHandle)
-    : nodeHandle_(nodeHandle), filterChain_("grid_map::GridMap"), filterChainConfigured_(false) {
+    : nodeHandle_(nodeHandle),
+      filterChain_("grid_map::GridMap"),
+      filterChainConfigured_(false),
+      tileBorder_(-1.0),
+      parallelRunner_([](std::size_t numTasks, const std::function<void(std::size_t)>& task) {
+        for (std::size_t i = 0; i < numTasks; ++i) {
+          task(i);
+        }
+      }) {
   // TODO (magnus) Add logic when setting up failed. What happens actually if it is not configured?
   readParameters();
   const Parameters parameters{parameters_.getData()};
@@ -29,6 +42,11 @@ PostprocessingPipelineFunctor::PostprocessingPipelineFunctor(ros::NodeHandle& no
   }
 
   filterChainConfigured_ = true;
+
+  if (parameters.tileSize_ > 0.0 && !readTileBorder(tileBorder_)) {
+    ROS_WARN("The postprocessing pipeline cannot run on tiles, every filter has to declare its tile_border. Filtering the whole map.");
+    tileBorder_ = -1.0;
+  }
 }
 
 PostprocessingPipelineFunctor::~PostprocessingPipelineFunctor() = default;
@@ -37,16 +55,55 @@ void PostprocessingPipelineFunctor::readParameters() {
   Parameters parameters;
   nodeHandle_.param("output_topic", parameters.outputTopic_, std::string("elevation_map_raw"));
   nodeHandle_.param("postprocessor_pipeline_name", parameters.filterChainParametersName_, std::string("postprocessor_pipeline"));
+  nodeHandle_.param("postprocessor_tile_size", parameters.tileSize_, 0.0);
   parameters_.setData(parameters);
 }
 
+bool PostprocessingPipelineFunctor::readTileBorder(double& tileBorder) const {
+  const Parameters parameters{parameters_.getData()};
+  XmlRpc::XmlRpcValue filtersConfig;
+  if (!nodeHandle_.getParam(parameters.filterChainParametersName_, filtersConfig) ||
+      filtersConfig.getType() != XmlRpc::XmlRpcValue::TypeArray) {
+    return false;
+  }
+
+  // The input of a filter is the output of the previous one: the borders add up.
+  tileBorder = 0.0;
+  for (int i = 0; i < filtersConfig.size(); ++i) {
+    XmlRpc::XmlRpcValue& filterConfig = filtersConfig[i];
+    if (!filterConfig.hasMember("params") || !filterConfig["params"].hasMember("tile_border")) {
+      ROS_WARN_STREAM("Filter " << i << " of the postprocessing pipeline does not declare a tile_border.");
+      return false;
+    }
+    XmlRpc::XmlRpcValue& border = filterConfig["params"]["tile_border"];
+    if (border.getType() == XmlRpc::XmlRpcValue::TypeDouble) {
+      tileBorder += static_cast<double>(border);
+    } else if (border.getType() == XmlRpc::XmlRpcValue::TypeInt) {
+      tileBorder += static_cast<int>(border);
+    } else {
+      ROS_WARN_STREAM("The tile_border of filter " << i << " of the postprocessing pipeline is not a number.");
+      return false;
+    }
+  }
+  return true;
+}
+
 grid_map::GridMap PostprocessingPipelineFunctor::operator()(GridMap& inputMap) {
   if (not filterChainConfigured_) {
     ROS_WARN_ONCE("No postprocessing pipeline was configured. Forwarding the raw elevation map!");
     return inputMap;
   }
 
+  const Parameters parameters{parameters_.getData()};
   grid_map::GridMap outputMap;
+  if (parameters.tileSize_ > 0.0 && tileBorder_ >= 0.0) {
+    if (applyTiled(inputMap, parameters.tileSize_, outputMap)) {
+      return outputMap;
+    }
+    ROS_WARN_THROTTLE(10.0, "Could not perform the grid map filter chain on tiles! Filtering the whole map.");
+    outputMap = grid_map::GridMap();
+  }
+
   if (not filterChain_.update(inputMap, outputMap)) {
     ROS_ERROR("Could not perform the grid map filter chain! Forwarding the raw elevation map!");
     return inputMap;
@@ -55,11 +112,110 @@ grid_map::GridMap PostprocessingPipelineFunctor::operator()(GridMap& inputMap) {
   return outputMap;
 }
 
-void PostprocessingPipelineFunctor::publish(const GridMap& gridMap) const {
-  // Publish filtered output grid map.
-  grid_map_msgs::GridMap outputMessage;
-  grid_map::GridMapRosConverter::toMessage(gridMap, outputMessage);
-  publisher_.publish(outputMessage);
+bool PostprocessingPipelineFunctor::applyTiled(GridMap& inputMap, double tileSize, GridMap& outputMap) {
+  // Tiles are blocks of the data matrices.
+  inputMap.convertToDefaultStartIndex();
+  const double resolution = inputMap.getResolution();
+  const grid_map::Size size = inputMap.getSize();
+  const int tileCells = std::max(1, static_cast<int>(std::round(tileSize / resolution)));
+  const int borderCells = static_cast<int>(std::ceil(tileBorder_ / resolution));
+  const int numTileCols = (size(1) + tileCells - 1) / tileCells;
+  const std::size_t numTiles = static_cast<std::size_t>((size(0) + tileCells - 1) / tileCells) * numTileCols;
+
+  std::once_flag outputInitialized;
+  std::atomic<std::size_t> numFilteredTiles{0};
+  parallelRunner_(numTiles, [&](std::size_t tile) {
+    // The tile and the extended tile (with the border) in the map.
+    const grid_map::Index topLeftIndex(static_cast<int>(tile / numTileCols) * tileCells, static_cast<int>(tile % numTileCols) * tileCells);
+    const grid_map::Size tileSizeInCells = (size - topLeftIndex).min(tileCells);
+    const grid_map::Index extendedTopLeftIndex = (topLeftIndex - borderCells).max(0);
+    const grid_map::Index extendedBottomRightIndex = (topLeftIndex + tileSizeInCells - 1 + borderCells).min(size - 1);
+    const grid_map::Size extendedSize = extendedBottomRightIndex - extendedTopLeftIndex + 1;
+
+    grid_map::Position topLeftPosition;
+    grid_map::Position bottomRightPosition;
+    inputMap.getPosition(extendedTopLeftIndex, topLeftPosition);
+    inputMap.getPosition(extendedBottomRightIndex, bottomRightPosition);
+    GridMap tileMap(inputMap.getLayers());
+    tileMap.setGeometry(extendedSize.cast<double>() * resolution, resolution, 0.5 * (topLeftPosition + bottomRightPosition));
+    tileMap.setFrameId(inputMap.getFrameId());
+    tileMap.setTimestamp(inputMap.getTimestamp());
+    tileMap.setBasicLayers(inputMap.getBasicLayers());
+    for (const auto& layer : inputMap.getLayers()) {
+      tileMap[layer] =
+          inputMap[layer].block(extendedTopLeftIndex(0), extendedTopLeftIndex(1), extendedSize(0), extendedSize(1));
+    }
+
+    GridMap filteredTileMap;
+    {
+      const std::shared_ptr<FilterChain> tileChain = acquireTileChain();
+      if (!tileChain || !tileChain->update(tileMap, filteredTileMap)) {
+        return;
+      }
+    }
+    if ((filteredTileMap.getSize() != extendedSize).any() || !filteredTileMap.isDefaultStartIndex()) {
+      ROS_ERROR("A filter of the postprocessing pipeline changed the geometry of a tile.");
+      return;
+    }
+
+    // The layers of the output are the ones of the first filtered tile.
+    std::call_once(outputInitialized, [&]() {
+      outputMap.setGeometry(inputMap.getLength(), resolution, inputMap.getPosition());
+      outputMap.setFrameId(inputMap.getFrameId());
+      outputMap.setTimestamp(inputMap.getTimestamp());
+      for (const auto& layer : filteredTileMap.getLayers()) {
+        outputMap.add(layer);
+      }
+      outputMap.setBasicLayers(filteredTileMap.getBasicLayers());
+    });
+    if (filteredTileMap.getLayers() != outputMap.getLayers()) {
+      ROS_ERROR("The postprocessing pipeline produced different layers on different tiles.");
+      return;
+    }
+
+    // Each tile writes its own block of the output layers.
+    const grid_map::Index indexInTile = topLeftIndex - extendedTopLeftIndex;
+    for (const auto& layer : filteredTileMap.getLayers()) {
+      outputMap[layer].block(topLeftIndex(0), topLeftIndex(1), tileSizeInCells(0), tileSizeInCells(1)) =
+          filteredTileMap[layer].block(indexInTile(0), indexInTile(1), tileSizeInCells(0), tileSizeInCells(1));
+    }
+    ++numFilteredTiles;
+  });
+  return numFilteredTiles == numTiles;
+}
+
+std::shared_ptr<PostprocessingPipelineFunctor::FilterChain> PostprocessingPipelineFunctor::acquireTileChain() {
+  FilterChain* tileChain = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(tileChainsMutex_);
+    if (!availableTileChains_.empty()) {
+      tileChain = availableTileChains_.back();
+      availableTileChains_.pop_back();
+    } else {
+      // Configured under the lock: the chains are only created for the first tiles.
+      const Parameters parameters{parameters_.getData()};
+      std::unique_ptr<FilterChain> newTileChain(new FilterChain("grid_map::GridMap"));
+      if (!newTileChain->configure(parameters.filterChainParametersName_, nodeHandle_)) {
+        ROS_ERROR("Could not configure the filter chain of a tile.");
+        return nullptr;
+      }
+      tileChain = newTileChain.get();
+      tileChains_.push_back(std::move(newTileChain));
+    }
+  }
+  return std::shared_ptr<FilterChain>(tileChain, [this](FilterChain* releasedTileChain) {
+    std::lock_guard<std::mutex> lock(tileChainsMutex_);
+    availableTileChains_.push_back(releasedTileChain);
+  });
+}
+
+void PostprocessingPipelineFunctor::setParallelRunner(ParallelRunner parallelRunner) {
+  parallelRunner_ = std::move(parallelRunner);
+}
+
+void PostprocessingPipelineFunctor::publish(GridMap gridMap) const {
+  // Publish filtered output grid map, serialized directly from its layers.
+  publisher_.publish(boost::make_shared<grid_map::GridMapMessageView>(std::move(gridMap)));
   ROS_DEBUG("Elevation map raw has been published.");
 }
 
@@ -17,8 +17,8 @@ PostprocessingWorker::GridMap PostprocessingWorker::processBuffer() {
   return functor_(dataBuffer_);
 }
 
-void PostprocessingWorker::publish(const GridMap& gridMap) const {
-  functor_.publish(gridMap);
+void PostprocessingWorker::publish(GridMap gridMap) const {
+  functor_.publish(std::move(gridMap));
 }
 
 bool PostprocessingWorker::hasSubscribers() const {
@@ -8,12 +8,20 @@
 
 #include "elevation_mapping/postprocessing/PostprocessorPool.hpp"
 
+#include <algorithm>
+#include <atomic>
+
+#include <boost/thread/condition_variable.hpp>
+
 namespace elevation_mapping {
 
 PostprocessorPool::PostprocessorPool(std::size_t poolSize, ros::NodeHandle nodeHandle) {
   for (std::size_t i = 0; i < poolSize; ++i) {
     // Add worker to the collection.
     workers_.emplace_back(std::make_unique<PostprocessingWorker>(nodeHandle));
+    // The tiles of a pipeline run on all the workers.
+    workers_.back()->setParallelRunner(
+        [this](std::size_t numTasks, const std::function<void(std::size_t)>& task) { runParallel(numTasks, task); });
     // Create one service per thread
     availableServices_.push_back(i);
   }
@@ -57,11 +65,59 @@ bool PostprocessorPool::runTask(const GridMap& gridMap) {
   return true;
 }
 
+void PostprocessorPool::runParallel(std::size_t numTasks, const std::function<void(std::size_t)>& task) {
+  if (numTasks == 0) {
+    return;
+  }
+
+  // State shared with the workers. It is reference counted since a busy worker may only pick up its job after this call returned.
+  struct SharedState {
+    std::function<void(std::size_t)> task;
+    std::size_t numTasks{0};
+    std::atomic<std::size_t> nextTask{0};
+    boost::mutex mutex;
+    boost::condition_variable finishedCondition;
+    std::size_t numFinished{0};
+  };
+  auto state = std::make_shared<SharedState>();
+  state->task = task;
+  state->numTasks = numTasks;
+
+  auto drain = [state] {
+    std::size_t numFinished{0};
+    for (std::size_t i = state->nextTask++; i < state->numTasks; i = state->nextTask++) {
+      try {
+        state->task(i);
+      } catch (const std::exception& exception) {
+        ROS_ERROR_STREAM("Parallel task " << i << " experienced an error: " << exception.what());
+      }
+      ++numFinished;
+    }
+    if (numFinished > 0) {
+      boost::lock_guard<boost::mutex> lock(state->mutex);
+      state->numFinished += numFinished;
+      if (state->numFinished == state->numTasks) {
+        state->finishedCondition.notify_all();
+      }
+    }
+  };
+
+  // The calling thread takes one share of the work itself.
+  const std::size_t numHelpers = std::min(workers_.size(), numTasks - 1);
+  for (std::size_t i = 0; i < numHelpers; ++i) {
+    workers_[i]->ioService().post(drain);
+  }
+  drain();
+
+  boost::unique_lock<boost::mutex> lock(state->mutex);
+  state->finishedCondition.wait(lock, [&state] { return state->numFinished == state->numTasks; });
+}
+
 void PostprocessorPool::wrapTask(size_t serviceIndex) {
   // Run the user supplied task.
   try {
     GridMap postprocessedMap = workers_.at(serviceIndex)->processBuffer();
-    workers_.at(serviceIndex)->publish(postprocessedMap);
+    workers_.at(serviceIndex)->publish(std::move(postprocessedMap));
   }
   // Suppress all exceptions.
   catch (const std::exception& exception) {
@@ -115,6 +115,16 @@ bool getNormalizedCoordinates(const GridMap &gridMap, const Position &queriedPos
 bool assembleFunctionValueMatrix(const GridMap &gridMap, const std::string &layer,
                                  const Position &queriedPosition, FunctionValueMatrix *data);
 
+/*
+ * Stores the 16 function values around the middle knot in a matrix,
+ * see assembleFunctionValueMatrix() above.
+ * @param[in]  layerMatrix - data of the layer that we are interpolating
+ * @param[in]  middleKnotIndex - index of the middle knot, see getIndicesOfMiddleKnot()
+ * @param[out] data - 4x4 matrix with 16 function values used for interpolation
+ */
+void assembleFunctionValueMatrix(const Matrix &layerMatrix, const Index &middleKnotIndex,
+                                 FunctionValueMatrix *data);
+
 /*
  * Performs convolution in 1D. the function requires 4 function values
  * to compute the convolution. The result is interpolated data in 1D.
@@ -138,6 +148,22 @@ bool evaluateBicubicConvolutionInterpolation(const GridMap &gridMap, const std::
                                              const Position &queriedPosition,
                                              double *interpolatedValue);
 
+/*
+ * Performs bicubic convolution interpolation at many positions. The
+ * interpolation coefficients of a cell are computed once and reused for
+ * consecutive queries falling into the same cell, hence queries sorted
+ * by position are the fastest.
+ * @param[in]  gridMap - grid map with discrete function values
+ * @param[in]  layer - name of the layer for which we want to perform interpolation
+ * @param[in]  queriedPositions - positions for which the interpolation is requested
+ * @param[out] interpolatedValues - interpolated values at queried points, NaN for
+ *                                 the points outside of the map
+ * @return - true if all the positions could be interpolated
+ */
+bool evaluateBicubicConvolutionInterpolation(const GridMap &gridMap, const std::string &layer,
+                                             const std::vector<Position> &queriedPositions,
+                                             std::vector<double> *interpolatedValues);
+
 } /* namespace bicubic_conv */
 
 namespace bicubic {
@@ -212,6 +238,34 @@ void bindIndicesToRange(const GridMap &gridMap, IndicesMatrix *indices);
 bool evaluateBicubicInterpolation(const GridMap &gridMap, const std::string &layer,
                                   const Position &queriedPosition, double *interpolatedValue);
 
+/*
+ * Performs bicubic interpolation at many positions. The polynomial
+ * coefficients of a unit square are computed once and reused for consecutive
+ * queries falling into the same unit square, hence queries sorted by position
+ * are the fastest.
+ * @param[in]  gridMap - grid map with discrete function values
+ * @param[in]  layer - name of the layer for which we want to perform interpolation
+ * @param[in]  queriedPositions - positions for which the interpolation is requested
+ * @param[out] interpolatedValues - interpolated values at queried points, NaN for
+ *                                 the points outside of the map
+ * @return - true if all the positions could be interpolated
+ */
+bool evaluateBicubicInterpolation(const GridMap &gridMap, const std::string &layer,
+                                  const std::vector<Position> &queriedPositions,
+                                  std::vector<double> *interpolatedValues);
+
+/*
+ * Assembles the function values and derivatives at the corners of a unit
+ * square in the matrix used to compute the polynomial coefficients.
+ * @param[in]  layerMat - data of the layer that we are interpolating
+ * @param[in]  unitSquareCornerIndices - indices of the unit square corners
+ * @param[in]  resolution - resolution of the grid map
+ * @param[out] functionValues - function values and derivatives at the corners
+ * @return - true if success
+ */
+bool assembleFunctionValueMatrix(const Matrix &layerMat, const IndicesMatrix &unitSquareCornerIndices,
+                                 double resolution, FunctionValueMatrix *functionValues);
+
 /*
  * Deduces which points in the grid map close a unit square around the
  * queried point and returns their indices (row and column number)
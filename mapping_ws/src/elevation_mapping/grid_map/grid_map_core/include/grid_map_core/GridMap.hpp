@@ -9,6 +9,7 @@
 #pragma once
 
 #include "grid_map_core/BufferRegion.hpp"
+#include "grid_map_core/LayerHandle.hpp"
 #include "grid_map_core/SubmapGeometry.hpp"
 #include "grid_map_core/TypeDefs.hpp"
 
@@ -95,6 +96,13 @@ class GridMap {
    */
   void add(const std::string& layer, const Matrix& data);
 
+  /*!
+   * Add a new data layer by moving the data in (if the layer already exists, replace its data, otherwise add layer and data).
+   * @param layer the name of the layer.
+   * @param data the data to be added.
+   */
+  void add(const std::string& layer, Matrix&& data);
+
   /*!
    * Checks if data layer exists.
    * @param layer the name of the layer.
@@ -136,6 +144,23 @@ class GridMap {
    */
   Matrix& operator[](const std::string& layer);
 
+  /*!
+   * Returns a handle to the data of a layer, for access to the cells in loops without
+   * resolving the layer name for each cell. See LayerHandleBase for its lifetime.
+   * @param layer the name of the layer.
+   * @return the layer handle.
+   * @throw std::out_of_range if no map layer with name `layer` is present.
+   */
+  LayerHandle getLayerHandle(const std::string& layer);
+
+  /*!
+   * Returns a handle to the data of a layer (read-only).
+   * @param layer the name of the layer.
+   * @return the layer handle.
+   * @throw std::out_of_range if no map layer with name `layer` is present.
+   */
+  ConstLayerHandle getLayerHandle(const std::string& layer) const;
+
   /*!
    * Removes a layer from the grid map.
    * @param layer the name of the layer to be removed.
@@ -274,6 +299,16 @@ class GridMap {
    */
   bool getPosition3(const std::string& layer, const Index& index, Position3& position) const;
 
+  /*!
+   * Gets the 3d position of a data point (x, y of cell position & cell value as z) in
+   * the grid map frame, from a layer handle of this map.
+   * @param layer the handle of the layer to be accessed.
+   * @param index the index of the requested cell.
+   * @param position the position of the data point in the parent frame.
+   * @return true if successful, false if no valid data available.
+   */
+  bool getPosition3(const ConstLayerHandle& layer, const Index& index, Position3& position) const;
+
   /*!
    * Gets the 3d vector of three layers with suffixes 'x', 'y', and 'z'.
    * @param layerPrefix the prefix for the layer to bet get as vector.
@@ -0,0 +1,94 @@
+/*
+ * LayerHandle.hpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: Luigi Freda
+ */
+
+#pragma once
+
+#include "grid_map_core/TypeDefs.hpp"
+
+// STL
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+
+namespace grid_map {
+
+/*!
+ * Handle to the data of a single grid map layer, resolved once from the layer name
+ * (see GridMap::getLayerHandle(...)). Cell access through the handle is a plain matrix
+ * access, without the string lookup of GridMap::at(...) and GridMap::isValid(...).
+ *
+ * The handle refers to the layer matrix object of the map: it stays valid when the map is
+ * resized or moved (e.g. setGeometry(...), move(...)), but it is invalidated when the layer
+ * is erased and when the map object is destroyed or overwritten by assignment.
+ */
+template <typename MatrixType>
+class LayerHandleBase {
+ public:
+  //! Reference to a cell, const for handles of const layers.
+  using Reference = typename std::conditional<std::is_const<MatrixType>::value, const DataType&, DataType&>::type;
+
+  /*!
+   * Empty (invalid) handle.
+   */
+  LayerHandleBase() = default;
+
+  /*!
+   * Constructor.
+   * @param data the layer matrix.
+   */
+  explicit LayerHandleBase(MatrixType& data) : data_(&data) {}
+
+  /*!
+   * Conversion from a handle of a non-const layer to a handle of a const layer.
+   */
+  template <typename OtherMatrixType,
+            typename = typename std::enable_if<std::is_convertible<OtherMatrixType*, MatrixType*>::value>::type>
+  LayerHandleBase(const LayerHandleBase<OtherMatrixType>& other) : data_(&other.matrix()) {}  // NOLINT(google-explicit-constructor)
+
+  /*!
+   * Get the value of a cell.
+   * @param index the (buffer) index of the cell.
+   * @return the cell value.
+   */
+  Reference operator()(const Index& index) const { return (*data_)(index(0), index(1)); }
+
+  /*!
+   * Get the value of a cell from its linear (column-major) index, see GridMapIterator::getLinearIndex().
+   * @param linearIndex the linear index of the cell.
+   * @return the cell value.
+   */
+  Reference operator()(const size_t linearIndex) const { return (*data_)(linearIndex); }
+
+  /*!
+   * Checks if the cell holds a valid (finite) value.
+   * @param index the (buffer) index of the cell.
+   * @return true if the value is valid.
+   */
+  bool isValid(const Index& index) const { return std::isfinite((*data_)(index(0), index(1))); }
+
+  /*!
+   * @return true if the handle refers to a layer.
+   */
+  bool isResolved() const { return data_ != nullptr; }
+
+  /*!
+   * @return the layer matrix.
+   */
+  MatrixType& matrix() const { return *data_; }
+
+ private:
+  //! Layer matrix.
+  MatrixType* data_{nullptr};
+};
+
+//! Handle to a modifiable layer.
+using LayerHandle = LayerHandleBase<Matrix>;
+
+//! Handle to a read-only layer.
+using ConstLayerHandle = LayerHandleBase<const Matrix>;
+
+}  // namespace grid_map
@@ -10,6 +10,7 @@
 
 #include "grid_map_core/TypeDefs.hpp"
 #include "grid_map_core/GridMap.hpp"
+#include "grid_map_core/LayerHandle.hpp"
 #include "grid_map_core/SubmapGeometry.hpp"
 #include "grid_map_core/GridMapMath.hpp"
 #include "grid_map_core/BufferRegion.hpp"
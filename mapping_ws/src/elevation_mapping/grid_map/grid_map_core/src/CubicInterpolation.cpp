@@ -10,6 +10,8 @@
 
 #include "grid_map_core/GridMap.hpp"
 
+#include <limits>
+
 namespace grid_map {
 
 unsigned int bindIndexToRange(unsigned int idReq, unsigned int nElem)
@@ -69,6 +71,49 @@ bool evaluateBicubicConvolutionInterpolation(const GridMap &gridMap, const std::
   return true;
 }
 
+bool evaluateBicubicConvolutionInterpolation(const GridMap &gridMap, const std::string &layer,
+                                             const std::vector<Position> &queriedPositions,
+                                             std::vector<double> *interpolatedValues)
+{
+  const Matrix &layerMatrix = gridMap.get(layer);
+  const double resolution = gridMap.getResolution();
+  interpolatedValues->resize(queriedPositions.size());
+
+  // The two 1D convolutions of a cell collapse into a single coefficient matrix:
+  // value = 0.25 * ty^T * (C * F * C^T) * tx, see convolve1D().
+  bool isCellValid = false;
+  Index cellIndex;
+  Position cellPosition;
+  Eigen::Matrix4d coefficients;
+  bool allInterpolated = true;
+  for (size_t k = 0; k < queriedPositions.size(); ++k) {
+    const Position &queriedPosition = queriedPositions[k];
+    Index middleKnotIndex;
+    if (!getIndicesOfMiddleKnot(gridMap, queriedPosition, &middleKnotIndex)) {
+      (*interpolatedValues)[k] = std::numeric_limits<double>::quiet_NaN();
+      allInterpolated = false;
+      continue;
+    }
+
+    if (!isCellValid || (middleKnotIndex != cellIndex).any()) {
+      FunctionValueMatrix functionValues;
+      assembleFunctionValueMatrix(layerMatrix, middleKnotIndex, &functionValues);
+      coefficients = 0.25 * cubicInterpolationConvolutionMatrix * functionValues
+          * cubicInterpolationConvolutionMatrix.transpose();
+      gridMap.getPosition(middleKnotIndex, cellPosition);
+      cellIndex = middleKnotIndex;
+      isCellValid = true;
+    }
+
+    const double tx = (queriedPosition.x() - cellPosition.x()) / resolution;
+    const double ty = (queriedPosition.y() - cellPosition.y()) / resolution;
+    const Eigen::Vector4d txVector(1.0, tx, tx * tx, tx * tx * tx);
+    const Eigen::Vector4d tyVector(1.0, ty, ty * ty, ty * ty * ty);
+    (*interpolatedValues)[k] = tyVector.dot(coefficients * txVector);
+  }
+  return allInterpolated;
+}
+
 double convolve1D(double t, const Eigen::Vector4d &functionValues)
 {
   const Eigen::Vector4d tVector(1.0, t, t * t, t * t * t);
@@ -87,7 +132,13 @@ bool assembleFunctionValueMatrix(const GridMap &gridMap, const std::string &laye
     return false;
   }
 
-  const Matrix &layerMatrix = gridMap.get(layer);
+  assembleFunctionValueMatrix(gridMap.get(layer), middleKnotIndex, data);
+  return true;
+}
+
+void assembleFunctionValueMatrix(const Matrix &layerMatrix, const Index &middleKnotIndex,
+                                 FunctionValueMatrix *data)
+{
   auto f = [&layerMatrix](unsigned int rowReq, unsigned int colReq) {
     double retVal = getLayerValue(layerMatrix, rowReq, colReq);
     return retVal;
@@ -106,8 +157,6 @@ bool assembleFunctionValueMatrix(const GridMap &gridMap, const std::string &laye
   *data << f(i + 1, j + 1), f(i, j + 1), f(i - 1, j + 1), f(i - 2, j + 1), f(i + 1, j), f(i, j), f(
       i - 1, j), f(i - 2, j), f(i + 1, j - 1), f(i, j - 1), f(i - 1, j - 1), f(i - 2, j - 1), f(
       i + 1, j - 2), f(i, j - 2), f(i - 1, j - 2), f(i - 2, j - 2);
-
-  return true;
 }
 
 bool getNormalizedCoordinates(const GridMap &gridMap, const Position &queriedPosition,
@@ -160,6 +209,29 @@ bool evaluateBicubicInterpolation(const GridMap &gridMap, const std::string &lay
     return false;
   }
 
+  // get function values and derivatives
+  FunctionValueMatrix functionValues;
+  if (!assembleFunctionValueMatrix(layerMat, unitSquareCornerIndices, resolution, &functionValues)) {
+    return false;
+  }
+
+  // get normalized coordinates
+  Position normalizedCoordinates;
+  if (!computeNormalizedCoordinates(gridMap, unitSquareCornerIndices.bottomLeft_, queriedPosition,
+                                    &normalizedCoordinates)) {
+    return false;
+  }
+
+  // evaluate polynomial
+  *interpolatedValue = evaluatePolynomial(functionValues, normalizedCoordinates.x(),
+                                          normalizedCoordinates.y());
+
+  return true;
+}
+
+bool assembleFunctionValueMatrix(const Matrix &layerMat, const IndicesMatrix &unitSquareCornerIndices,
+                                 double resolution, FunctionValueMatrix *functionValues)
+{
   // get function values
   DataMatrix f;
   if (!getFunctionValues(layerMat, unitSquareCornerIndices, &f)) {
@@ -184,21 +256,57 @@ bool evaluateBicubicInterpolation(const GridMap &gridMap, const std::string &lay
   }
 
   // assemble function value matrix matrix
-  FunctionValueMatrix functionValues;
-  assembleFunctionValueMatrix(f, dfx, dfy, ddfxy, &functionValues);
+  assembleFunctionValueMatrix(f, dfx, dfy, ddfxy, functionValues);
 
-  // get normalized coordinates
-  Position normalizedCoordinates;
-  if (!computeNormalizedCoordinates(gridMap, unitSquareCornerIndices.bottomLeft_, queriedPosition,
-                                    &normalizedCoordinates)) {
-    return false;
-  }
+  return true;
+}
 
-  // evaluate polynomial
-  *interpolatedValue = evaluatePolynomial(functionValues, normalizedCoordinates.x(),
-                                          normalizedCoordinates.y());
+bool evaluateBicubicInterpolation(const GridMap &gridMap, const std::string &layer,
+                                  const std::vector<Position> &queriedPositions,
+                                  std::vector<double> *interpolatedValues)
+{
+  const Matrix& layerMat = gridMap.get(layer);
+  const double resolution = gridMap.getResolution();
+  interpolatedValues->resize(queriedPositions.size());
+
+  // The polynomial coefficients B * F * B^T of a unit square are computed once
+  // and reused for the following queries in the same unit square.
+  bool isUnitSquareValid = false;
+  IndicesMatrix unitSquareIndices;
+  Position unitSquareOrigin;
+  Eigen::Matrix4d polynomialCoeffMatrix;
+  bool allInterpolated = true;
+  for (size_t k = 0; k < queriedPositions.size(); ++k) {
+    const Position &queriedPosition = queriedPositions[k];
+    IndicesMatrix unitSquareCornerIndices;
+    if (!getUnitSquareCornerIndices(gridMap, queriedPosition, &unitSquareCornerIndices)) {
+      (*interpolatedValues)[k] = std::numeric_limits<double>::quiet_NaN();
+      allInterpolated = false;
+      continue;
+    }
 
-  return true;
+    const bool isSameUnitSquare = isUnitSquareValid
+        && (unitSquareCornerIndices.topLeft_ == unitSquareIndices.topLeft_).all()
+        && (unitSquareCornerIndices.topRight_ == unitSquareIndices.topRight_).all()
+        && (unitSquareCornerIndices.bottomLeft_ == unitSquareIndices.bottomLeft_).all()
+        && (unitSquareCornerIndices.bottomRight_ == unitSquareIndices.bottomRight_).all();
+    if (!isSameUnitSquare) {
+      FunctionValueMatrix functionValues;
+      assembleFunctionValueMatrix(layerMat, unitSquareCornerIndices, resolution, &functionValues);
+      polynomialCoeffMatrix = bicubicInterpolationMatrix * functionValues
+          * bicubicInterpolationMatrix.transpose();
+      gridMap.getPosition(unitSquareCornerIndices.bottomLeft_, unitSquareOrigin);
+      unitSquareIndices = unitSquareCornerIndices;
+      isUnitSquareValid = true;
+    }
+
+    const double tx = (queriedPosition.x() - unitSquareOrigin.x()) / resolution;
+    const double ty = (queriedPosition.y() - unitSquareOrigin.y()) / resolution;
+    const Eigen::Vector4d xVector(1, tx, tx * tx, tx * tx * tx);
+    const Eigen::Vector4d yVector(1, ty, ty * ty, ty * ty * ty);
+    (*interpolatedValues)[k] = xVector.dot(polynomialCoeffMatrix * yVector);
+  }
+  return allInterpolated;
 }
 
 bool getUnitSquareCornerIndices(const GridMap &gridMap, const Position &queriedPosition,
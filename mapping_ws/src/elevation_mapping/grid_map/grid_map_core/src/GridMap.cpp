@@ -97,6 +97,20 @@ void GridMap::add(const std::string& layer, const Matrix& data) {
   }
 }
 
+void GridMap::add(const std::string& layer, Matrix&& data) {
+  assert(size_(0) == data.rows());
+  assert(size_(1) == data.cols());
+
+  if (exists(layer)) {
+    // Type exists already, replace its data.
+    data_.at(layer) = std::move(data);
+  } else {
+    // Type does not exist yet, add type and data.
+    data_.emplace(layer, std::move(data));
+    layers_.push_back(layer);
+  }
+}
+
 bool GridMap::exists(const std::string& layer) const {
   return !(data_.find(layer) == data_.end());
 }
@@ -125,6 +139,14 @@ Matrix& GridMap::operator[](const std::string& layer) {
   return get(layer);
 }
 
+LayerHandle GridMap::getLayerHandle(const std::string& layer) {
+  return LayerHandle(get(layer));
+}
+
+ConstLayerHandle GridMap::getLayerHandle(const std::string& layer) const {
+  return ConstLayerHandle(get(layer));
+}
+
 bool GridMap::erase(const std::string& layer) {
   const auto dataIterator = data_.find(layer);
   if (dataIterator == data_.end()) {
@@ -258,7 +280,11 @@ bool GridMap::isValid(const Index& index, const std::vector<std::string>& layers
 }
 
 bool GridMap::getPosition3(const std::string& layer, const Index& index, Position3& position) const {
-  const auto value = at(layer, index);
+  return getPosition3(getLayerHandle(layer), index, position);
+}
+
+bool GridMap::getPosition3(const ConstLayerHandle& layer, const Index& index, Position3& position) const {
+  const auto value = layer(index);
   if (!isValid(value)) {
     return false;
   }
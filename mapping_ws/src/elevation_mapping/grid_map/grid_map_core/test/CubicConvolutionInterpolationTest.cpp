@@ -9,10 +9,14 @@
 #include "test_helpers.hpp"
 
 #include "grid_map_core/GridMap.hpp"
+#include "grid_map_core/CubicInterpolation.hpp"
 
 // gtest
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <cmath>
+
 namespace gm = grid_map;
 namespace gmt = grid_map_test;
 
@@ -128,3 +132,46 @@ TEST(CubicConvolutionInterpolation, GaussianWorld)
   }
 }
 
+TEST(CubicConvolutionInterpolation, BatchEqualsSingleQueries)
+{
+  const int seed = rand();
+  gmt::rndGenerator.seed(seed);
+  auto map = gmt::createMap(gm::Length(3.0, 3.0), 0.1, gm::Position(0.0, 0.0));
+  gmt::createSaddleWorld(&map);
+  const auto queryPoints = gmt::uniformlyDitributedPointsWithinMap(map, 1000);
+
+  // Random order and sorted order, the latter reuses the cell coefficients.
+  std::vector<gm::Position> positions;
+  for (const auto &point : queryPoints) {
+    positions.emplace_back(point.x_, point.y_);
+  }
+  std::vector<gm::Position> sortedPositions = positions;
+  std::sort(sortedPositions.begin(), sortedPositions.end(),
+            [](const gm::Position &a, const gm::Position &b) {
+              return a.x() < b.x() || (a.x() == b.x() && a.y() < b.y());
+            });
+
+  for (const auto &batch : {positions, sortedPositions}) {
+    std::vector<double> values;
+    EXPECT_TRUE(gm::bicubic_conv::evaluateBicubicConvolutionInterpolation(map, gmt::testLayer, batch, &values));
+    ASSERT_EQ(batch.size(), values.size());
+    for (size_t i = 0; i < batch.size(); ++i) {
+      double value;
+      ASSERT_TRUE(gm::bicubic_conv::evaluateBicubicConvolutionInterpolation(map, gmt::testLayer, batch[i], &value));
+      EXPECT_NEAR(value, values[i], 1e-9);
+    }
+  }
+
+  // Positions outside of the map are NaN.
+  std::vector<gm::Position> outsidePositions { positions.front(), gm::Position(10.0, 10.0) };
+  std::vector<double> values;
+  EXPECT_FALSE(gm::bicubic_conv::evaluateBicubicConvolutionInterpolation(map, gmt::testLayer, outsidePositions, &values));
+  ASSERT_EQ(2u, values.size());
+  EXPECT_FALSE(std::isnan(values[0]));
+  EXPECT_TRUE(std::isnan(values[1]));
+
+  if (::testing::Test::HasFailure()) {
+    std::cout << "\n Test CubicConvolutionInterpolation, BatchEqualsSingleQueries failed with seed: " << seed
+              << std::endl;
+  }
+}
@@ -493,4 +493,32 @@ TEST(ValueAtPosition, LinearInterpolated)
   EXPECT_NEAR(2.1963200, value, 0.0000001);
 }
 
+TEST(GridMap, LayerHandle)
+{
+  GridMap map({"layer_a", "layer_b"});
+  map.setGeometry(Length(1.0, 2.0), 0.1, Position(0.1, 0.2));
+  map["layer_a"].setConstant(1.0);
+  map["layer_b"].setConstant(NAN);
+
+  LayerHandle layerA = map.getLayerHandle("layer_a");
+  const Index index(3, 4);
+  EXPECT_TRUE(layerA.isValid(index));
+  layerA(index) = 5.0;
+  EXPECT_EQ(5.0, map.at("layer_a", index));
+
+  ConstLayerHandle layerB = static_cast<const GridMap&>(map).getLayerHandle("layer_b");
+  EXPECT_FALSE(layerB.isValid(index));
+  Position3 position;
+  EXPECT_FALSE(map.getPosition3(layerB, index, position));
+  EXPECT_TRUE(map.getPosition3(layerA, index, position));
+  EXPECT_EQ(5.0, position.z());
+
+  // Handles refer to the layer matrix and survive moving the map.
+  map.move(Position(0.3, 0.2));
+  layerA(Index(0, 0)) = 7.0;
+  EXPECT_EQ(7.0, map.at("layer_a", Index(0, 0)));
+
+  EXPECT_THROW(map.getLayerHandle("layer_c"), std::out_of_range);
+}
+
 }  // namespace grid_map
\ No newline at end of file
@@ -0,0 +1,71 @@
+/*
+ * InRadiusKernels.hpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: Luigi Freda
+ */
+
+#pragma once
+
+#include <vector>
+
+#include <grid_map_core/TypeDefs.hpp>
+
+namespace grid_map {
+
+/*!
+ * Kernels of the MeanInRadiusFilter and the MinInRadiusFilter on a whole layer.
+ * The disk around a cell is split in columns: the column at the offset dj holds the
+ * rows [i - w(dj), i + w(dj)], so that each column is a 1D sliding window (prefix sums
+ * for the mean, van Herk/Gil-Werman for the minimum). The cost is O(cells x disk diameter)
+ * instead of O(cells x disk area), with contiguous (vectorized) column accesses.
+ * The layers are unwrapped from the circular buffer of the map (see unwrapLayer()).
+ */
+namespace in_radius {
+
+/*!
+ * Half widths of the columns of the disk of cells around a cell, as the cells iterated
+ * by a CircleIterator: (di, dj) is in the disk if (di^2 + dj^2) * resolution^2 <= radius^2.
+ * @param radius the radius of the disk [m].
+ * @param resolution the resolution of the map [m/cell].
+ * @return the half widths w(dj) of the columns dj = -R, ..., R (2R + 1 values).
+ */
+std::vector<int> getDiskHalfWidths(double radius, double resolution);
+
+/*!
+ * Copies a layer from the circular buffer into a matrix starting at the start index.
+ * @param buffer the layer (buffer order).
+ * @param startIndex the start index of the map.
+ * @param unwrapped the layer with the start index at (0, 0).
+ */
+void unwrapLayer(const Matrix& buffer, const Index& startIndex, Matrix& unwrapped);
+
+/*!
+ * Inverse of unwrapLayer().
+ * @param unwrapped the layer with the start index at (0, 0).
+ * @param startIndex the start index of the map.
+ * @param buffer the layer (buffer order), resized if needed.
+ */
+void wrapLayer(const Matrix& unwrapped, const Index& startIndex, Matrix& buffer);
+
+/*!
+ * Mean of the valid (finite) values in the disk around each cell, NAN if there are none.
+ * @param input the (unwrapped) input layer.
+ * @param halfWidths the disk, see getDiskHalfWidths().
+ * @param parallel if true, the columns are processed in parallel (TBB).
+ * @param output the (unwrapped) output layer.
+ */
+void meanInDisk(const Matrix& input, const std::vector<int>& halfWidths, bool parallel, Matrix& output);
+
+/*!
+ * Minimum of the valid (finite) values in the disk around each valid cell, NAN for the
+ * invalid cells.
+ * @param input the (unwrapped) input layer.
+ * @param halfWidths the disk, see getDiskHalfWidths().
+ * @param parallel if true, the columns are processed in parallel (TBB).
+ * @param output the (unwrapped) output layer.
+ */
+void minInDisk(const Matrix& input, const std::vector<int>& halfWidths, bool parallel, Matrix& output);
+
+}  // namespace in_radius
+}  // namespace grid_map
@@ -9,15 +9,20 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include "EigenLab/EigenLab.h"
 
 #include <filters/filter_base.hpp>
 #include <grid_map_core/GridMap.hpp>
 
+#include "grid_map_filters/MathExpressionProgram.hpp"
+
 namespace grid_map {
 
 /*!
  * Parses and evaluates a mathematical matrix expression with layers of a grid map.
+ * The expression is parsed once (see MathExpressionProgram), the EigenLab parser is only
+ * used for the expressions that the program does not support.
  */
 class MathExpressionFilter : public filters::FilterBase<GridMap> {
  public:
@@ -47,11 +52,29 @@ class MathExpressionFilter : public filters::FilterBase<GridMap> {
   //! EigenLab parser.
   EigenLab::Parser<Eigen::MatrixXf> parser_;
 
+  //! Parsed expression, valid for the layers in programLayers_.
+  MathExpressionProgram program_;
+
+  //! Layers of the map when the expression has been parsed (the variables of the program).
+  std::vector<std::string> programLayers_;
+
+  //! If the program supports the expression (otherwise the EigenLab parser is used).
+  bool isProgramValid_;
+
+  //! Evaluation state of the program.
+  MathExpressionProgram::Workspace workspace_;
+
   //! Expression to parse.
   std::string expression_;
 
   //! Output layer name.
   std::string outputLayer_;
+
+  //! Whether the element-wise expressions are evaluated on blocks of columns in parallel.
+  bool parallelizationEnabled_;
+
+  //! Number of threads (TBB) if the parallelization is enabled.
+  int threadCount_;
 };
 
 }  // namespace grid_map
@@ -0,0 +1,192 @@
+/*
+ * MathExpressionProgram.hpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: Luigi Freda
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <Eigen/Core>
+#include <grid_map_core/TypeDefs.hpp>
+
+namespace grid_map {
+
+/*!
+ * A math expression (EigenLab syntax) parsed once into a postfix program, to be evaluated
+ * many times on different data without parsing it again.
+ *
+ * The supported subset of the EigenLab syntax is: numbers, variables, parentheses, the
+ * operators + - * / ^ .+ .- .* ./ .^ and the unary -, the element-wise functions abs, sqrt,
+ * square, exp, log, log10, sin, cos, tan, acos, asin, cwiseMin and cwiseMax and the
+ * reductions min, max, absmax, minOfFinites, maxOfFinites, mean, meanOfFinites, sum,
+ * sumOfFinites, prod, numberOfFinites, trace and norm. The operator precedence and the
+ * semantics (1x1 matrices are scalars, * of two matrices is the matrix product) are the
+ * ones of EigenLab. compile() fails on the rest (matrix definitions, indexing, assignments,
+ * ...), for which the EigenLab parser has to be used.
+ */
+class MathExpressionProgram {
+ public:
+  //! View on the data of a variable (a matrix or a block of a matrix).
+  using ConstMatrixView = Eigen::Map<const Matrix, Eigen::Unaligned, Eigen::OuterStride<>>;
+
+  /*!
+   * Evaluation state (stack of the intermediate results), to be reused between the
+   * evaluations to avoid allocations. Each thread needs its own workspace.
+   */
+  class Workspace {
+   public:
+    Workspace() = default;
+
+   private:
+    friend class MathExpressionProgram;
+
+    //! Entry of the stack: a view on a variable or a local result.
+    struct Entry {
+      const float* data{nullptr};
+      Eigen::Index rows{0};
+      Eigen::Index cols{0};
+      Eigen::Index outerStride{0};
+      Matrix local;
+
+      ConstMatrixView view() const { return ConstMatrixView(data, rows, cols, Eigen::OuterStride<>(outerStride)); }
+      void setView(const ConstMatrixView& matrix) {
+        data = matrix.data();
+        rows = matrix.rows();
+        cols = matrix.cols();
+        outerStride = matrix.outerStride();
+      }
+      void setLocal() {
+        data = local.data();
+        rows = local.rows();
+        cols = local.cols();
+        outerStride = local.rows();
+      }
+      bool isScalar() const { return rows == 1 && cols == 1; }
+    };
+
+    std::vector<Entry> stack_;
+  };
+
+  MathExpressionProgram() = default;
+
+  /*!
+   * Parses an expression.
+   * @param expression the expression.
+   * @param variables the names of the variables that the expression can use, in the order
+   * of the views given to evaluate().
+   * @return true if the expression is supported (see the class description), false otherwise.
+   */
+  bool compile(const std::string& expression, const std::vector<std::string>& variables);
+
+  /*!
+   * @return true if an expression has been compiled.
+   */
+  bool isCompiled() const { return !program_.empty(); }
+
+  /*!
+   * @return true if the result of each element only depends on the same element of the
+   * variables (no reductions and no matrix products), so that the expression can be evaluated
+   * on blocks of the variables independently.
+   */
+  bool isElementwise() const { return isElementwise_; }
+
+  /*!
+   * @return true if the result is a scalar whatever the variables.
+   */
+  bool hasScalarResult() const { return hasScalarResult_; }
+
+  /*!
+   * @return the names of the variables used by the expression (a subset of the ones given to compile()).
+   */
+  std::vector<std::string> getUsedVariables() const;
+
+  /*!
+   * Evaluates the expression.
+   * @param variables the data of the variables, in the order given to compile().
+   * @param workspace the evaluation state.
+   * @param result the result.
+   * @throw std::runtime_error if the dimensions of the operands do not match (as EigenLab).
+   */
+  void evaluate(const std::vector<ConstMatrixView>& variables, Workspace& workspace, Matrix& result) const;
+
+  /*!
+   * Evaluates an expression with a scalar result (see hasScalarResult()).
+   * @param variables the data of the variables, in the order given to compile().
+   * @param workspace the evaluation state.
+   * @param[out] result the result.
+   * @return false if the result is not a scalar.
+   * @throw std::runtime_error if the dimensions of the operands do not match (as EigenLab).
+   */
+  bool evaluateScalar(const std::vector<ConstMatrixView>& variables, Workspace& workspace, float& result) const;
+
+ private:
+  enum class OpCode {
+    Constant,
+    Variable,
+    Negate,
+    Add,
+    Subtract,
+    Multiply,
+    ElementwiseMultiply,
+    Divide,
+    ElementwiseDivide,
+    Power,
+    ElementwisePower,
+    CwiseMin,
+    CwiseMax,
+    Abs,
+    Sqrt,
+    Square,
+    Exp,
+    Log,
+    Log10,
+    Sin,
+    Cos,
+    Tan,
+    Acos,
+    Asin,
+    Min,
+    Max,
+    AbsMax,
+    MinOfFinites,
+    MaxOfFinites,
+    Mean,
+    MeanOfFinites,
+    Sum,
+    SumOfFinites,
+    Prod,
+    NumberOfFinites,
+    Trace,
+    Norm
+  };
+
+  struct Instruction {
+    OpCode opCode;
+    //! Value of a Constant, index of a Variable.
+    float value;
+    int variable;
+  };
+
+  class Parser;
+
+  //! Runs the program, the result is the only entry of the stack.
+  void run(const std::vector<ConstMatrixView>& variables, Workspace& workspace) const;
+
+  //! Postfix program.
+  std::vector<Instruction> program_;
+
+  //! Maximum depth of the stack.
+  size_t stackSize_{0};
+
+  //! Names of the variables given to compile().
+  std::vector<std::string> variables_;
+
+  bool isElementwise_{true};
+  bool hasScalarResult_{false};
+};
+
+}  // namespace grid_map
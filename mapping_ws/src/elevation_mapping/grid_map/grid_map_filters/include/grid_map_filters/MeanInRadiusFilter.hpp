@@ -52,6 +52,12 @@ class MeanInRadiusFilter : public filters::FilterBase<GridMap> {
 
   //! Output layer name.
   std::string outputLayer_;
+
+  //! Whether the columns of the layer are processed in parallel.
+  bool parallelizationEnabled_;
+
+  //! Number of threads (TBB) if the parallelization is enabled.
+  int threadCount_;
 };
 
 }  // namespace grid_map
@@ -58,6 +58,22 @@ class NormalVectorsFilter : public filters::FilterBase<GridMap> {
   bool update(const GridMap& mapIn, GridMap& mapOut) override;
 
  private:
+  //! Handles of the three output layers (x, y, z components of the normal vectors).
+  struct NormalVectorsLayers {
+    LayerHandle x;
+    LayerHandle y;
+    LayerHandle z;
+  };
+
+  /*!
+   * Resolves the handles of the output layers.
+   *
+   * @param map: grid map containing the output layers.
+   * @param outputLayersPrefix: Output layer name prefix.
+   * @return the output layer handles.
+   */
+  static NormalVectorsLayers getNormalVectorsLayers(GridMap& map, const std::string& outputLayersPrefix);
+
   /*!
    * Estimate the normal vector at each point of the input layer by using the areaSingleNormalComputation function.
    * This function makes use of the area method and is the serial version of such normal vector computation using a
@@ -100,11 +116,11 @@ class NormalVectorsFilter : public filters::FilterBase<GridMap> {
    * Finally, the sign normal vector is correct to be in the same direction as the user defined "normal vector positive axis"
    *
    * @param map: grid map containing the layer for which the normal vectors are computed for.
-   * @param inputLayer: Layer the normal vector should be computed for.
-   * @param outputLayersPrefix: Output layer name prefix.
+   * @param inputLayer: Handle of the layer the normal vector should be computed for.
+   * @param outputLayers: Handles of the output layers.
    * @param index: Index of point in the grid map for which this function calculates the normal vector.
    */
-  void areaSingleNormalComputation(GridMap& map, const std::string& inputLayer, const std::string& outputLayersPrefix,
+  void areaSingleNormalComputation(GridMap& map, const ConstLayerHandle& inputLayer, const NormalVectorsLayers& outputLayers,
                                    const grid_map::Index& index);
   /*!
    * Estimate the normal vector at each point of the input layer by using the rasterSingleNormalComputation function.
@@ -152,13 +168,11 @@ class NormalVectorsFilter : public filters::FilterBase<GridMap> {
    *
    * Finally, the sign normal vector is correct to be in the same direction as the user defined "normal vector positive axis"
    *
-   * @param map: grid map containing the layer for which the normal vectors are computed for.
-   * @param inputLayer: Layer the normal vector should be computed for.
-   * @param outputLayersPrefix: Output layer name prefix.
+   * @param outputLayers: Handles of the output layers.
    * @param dataMap: Matrix containing the input layer of the grid map in question.
    * @param index: Index of point in the grid map for which this function calculates the normal vector.
    */
-  void rasterSingleNormalComputation(GridMap& map, const std::string& outputLayersPrefix, const grid_map::Matrix& dataMap,
+  void rasterSingleNormalComputation(const NormalVectorsLayers& outputLayers, const grid_map::Matrix& dataMap,
                                      const grid_map::Index& index);
 
   enum class Method { AreaSerial, AreaParallel, RasterSerial, RasterParallel };
@@ -15,11 +15,14 @@
 #include <grid_map_core/grid_map_core.hpp>
 
 #include "EigenLab/EigenLab.h"
+#include "grid_map_filters/MathExpressionProgram.hpp"
 
 namespace grid_map {
 
 /*!
  * Parse and evaluate a mathematical matrix expression within a sliding window on a layer of a grid map.
+ * The expression is parsed once (see MathExpressionProgram) and evaluated on views of the
+ * windows, the EigenLab parser is only used for the expressions that the program does not support.
  */
 class SlidingWindowMathExpressionFilter : public filters::FilterBase<GridMap> {
  public:
@@ -55,6 +58,9 @@ class SlidingWindowMathExpressionFilter : public filters::FilterBase<GridMap> {
   //! EigenLab parser.
   EigenLab::Parser<Eigen::MatrixXf> parser_;
 
+  //! Parsed expression (the input layer is the only variable), if supported.
+  MathExpressionProgram program_;
+
   //! Expression to parse.
   std::string expression_;
 
@@ -72,6 +78,12 @@ class SlidingWindowMathExpressionFilter : public filters::FilterBase<GridMap> {
 
   //! Edge handling method.
   SlidingWindowIterator::EdgeHandling edgeHandling_;
+
+  //! Whether the columns of the map are processed in parallel.
+  bool parallelizationEnabled_;
+
+  //! Number of threads (TBB) if the parallelization is enabled.
+  int threadCount_;
 };
 
 }  // namespace grid_map
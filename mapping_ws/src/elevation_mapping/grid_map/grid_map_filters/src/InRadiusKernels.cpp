@@ -0,0 +1,182 @@
+/*
+ * InRadiusKernels.cpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: Luigi Freda
+ */
+
+#include "grid_map_filters/InRadiusKernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <tbb/tbb.h>
+#include <Eigen/Core>
+
+namespace grid_map {
+namespace in_radius {
+
+namespace {
+
+/*!
+ * Runs processColumns over the column range [0, cols), in parallel blocks if requested.
+ */
+template <typename Function>
+void forEachColumnRange(Eigen::Index cols, bool parallel, const Function& processColumns) {
+  if (parallel) {
+    tbb::parallel_for(tbb::blocked_range<Eigen::Index>(0, cols), processColumns);
+  } else {
+    processColumns(tbb::blocked_range<Eigen::Index>(0, cols));
+  }
+}
+
+/*!
+ * Sliding minimum (van Herk/Gil-Werman) of the windows of 2w + 1 values, 3 comparisons per
+ * value whatever the width: out(i) = min(padded(i), ..., padded(i + 2w)).
+ * The padded input has out.size() + 2w values; prefix and suffix are work buffers of the
+ * same size.
+ */
+void slidingMin(const Eigen::VectorXf& padded, int w, Eigen::VectorXf& prefix, Eigen::VectorXf& suffix, Eigen::VectorXf& out) {
+  const Eigen::Index length = padded.size();
+  const Eigen::Index windowSize = 2 * w + 1;
+  // Minimum from the start of the block of windowSize values (prefix) and up to its end (suffix).
+  for (Eigen::Index k = 0; k < length; ++k) {
+    prefix(k) = (k % windowSize == 0) ? padded(k) : std::min(prefix(k - 1), padded(k));
+  }
+  for (Eigen::Index k = length - 1; k >= 0; --k) {
+    suffix(k) = (k == length - 1 || (k + 1) % windowSize == 0) ? padded(k) : std::min(suffix(k + 1), padded(k));
+  }
+  // A window spans at most two blocks.
+  for (Eigen::Index i = 0; i < out.size(); ++i) {
+    out(i) = std::min(suffix(i), prefix(i + windowSize - 1));
+  }
+}
+
+}  // namespace
+
+std::vector<int> getDiskHalfWidths(double radius, double resolution) {
+  const double radiusSquare = radius * radius;
+  const auto isInside = [&](int di, int dj) { return (di * resolution) * (di * resolution) + (dj * resolution) * (dj * resolution) <= radiusSquare; };
+  int maxOffset = 0;
+  while (isInside(maxOffset + 1, 0)) {
+    ++maxOffset;
+  }
+  std::vector<int> halfWidths(2 * maxOffset + 1, 0);
+  for (int dj = 0; dj <= maxOffset; ++dj) {
+    int w = 0;
+    while (isInside(w + 1, dj)) {
+      ++w;
+    }
+    halfWidths[maxOffset + dj] = w;
+    halfWidths[maxOffset - dj] = w;
+  }
+  return halfWidths;
+}
+
+void unwrapLayer(const Matrix& buffer, const Index& startIndex, Matrix& unwrapped) {
+  // Rows and columns from the start index to the end of the buffer.
+  const Eigen::Index rowsToEnd = buffer.rows() - startIndex(0);
+  const Eigen::Index colsToEnd = buffer.cols() - startIndex(1);
+  unwrapped.resize(buffer.rows(), buffer.cols());
+  unwrapped.topLeftCorner(rowsToEnd, colsToEnd) = buffer.bottomRightCorner(rowsToEnd, colsToEnd);
+  unwrapped.topRightCorner(rowsToEnd, startIndex(1)) = buffer.bottomLeftCorner(rowsToEnd, startIndex(1));
+  unwrapped.bottomLeftCorner(startIndex(0), colsToEnd) = buffer.topRightCorner(startIndex(0), colsToEnd);
+  unwrapped.bottomRightCorner(startIndex(0), startIndex(1)) = buffer.topLeftCorner(startIndex(0), startIndex(1));
+}
+
+void wrapLayer(const Matrix& unwrapped, const Index& startIndex, Matrix& buffer) {
+  const Eigen::Index rowsToEnd = unwrapped.rows() - startIndex(0);
+  const Eigen::Index colsToEnd = unwrapped.cols() - startIndex(1);
+  buffer.resize(unwrapped.rows(), unwrapped.cols());
+  buffer.bottomRightCorner(rowsToEnd, colsToEnd) = unwrapped.topLeftCorner(rowsToEnd, colsToEnd);
+  buffer.bottomLeftCorner(rowsToEnd, startIndex(1)) = unwrapped.topRightCorner(rowsToEnd, startIndex(1));
+  buffer.topRightCorner(startIndex(0), colsToEnd) = unwrapped.bottomLeftCorner(startIndex(0), colsToEnd);
+  buffer.topLeftCorner(startIndex(0), startIndex(1)) = unwrapped.bottomRightCorner(startIndex(0), startIndex(1));
+}
+
+void meanInDisk(const Matrix& input, const std::vector<int>& halfWidths, bool parallel, Matrix& output) {
+  const Eigen::Index rows = input.rows();
+  const Eigen::Index cols = input.cols();
+  const int radius = static_cast<int>(halfWidths.size()) / 2;
+
+  // Prefix sums (and valid counts) of the columns, padded by radius cells at both ends:
+  // the sum of the rows [i - w, i + w] of a column is sums(i + radius + w + 1) - sums(i + radius - w).
+  Eigen::MatrixXd sums(rows + 2 * radius + 1, cols);
+  Eigen::MatrixXi counts(rows + 2 * radius + 1, cols);
+  forEachColumnRange(cols, parallel, [&](const tbb::blocked_range<Eigen::Index>& range) {
+    for (Eigen::Index j = range.begin(); j < range.end(); ++j) {
+      sums(0, j) = 0.0;
+      counts(0, j) = 0;
+      for (Eigen::Index k = 1; k < sums.rows(); ++k) {
+        const Eigen::Index i = k - 1 - radius;
+        const bool isValid = i >= 0 && i < rows && std::isfinite(input(i, j));
+        sums(k, j) = sums(k - 1, j) + (isValid ? input(i, j) : 0.0);
+        counts(k, j) = counts(k - 1, j) + (isValid ? 1 : 0);
+      }
+    }
+  });
+
+  output.resize(rows, cols);
+  forEachColumnRange(cols, parallel, [&](const tbb::blocked_range<Eigen::Index>& range) {
+    Eigen::VectorXd sum(rows);
+    Eigen::VectorXi count(rows);
+    for (Eigen::Index j = range.begin(); j < range.end(); ++j) {
+      sum.setZero();
+      count.setZero();
+      for (int dj = -radius; dj <= radius; ++dj) {
+        const Eigen::Index column = j + dj;
+        if (column < 0 || column >= cols) {
+          continue;
+        }
+        const int w = halfWidths[dj + radius];
+        sum += sums.col(column).segment(radius + w + 1, rows) - sums.col(column).segment(radius - w, rows);
+        count += counts.col(column).segment(radius + w + 1, rows) - counts.col(column).segment(radius - w, rows);
+      }
+      output.col(j) =
+          (count.array() > 0).select((sum.array() / count.array().cast<double>()).cast<float>(), std::numeric_limits<float>::quiet_NaN());
+    }
+  });
+}
+
+void minInDisk(const Matrix& input, const std::vector<int>& halfWidths, bool parallel, Matrix& output) {
+  const Eigen::Index rows = input.rows();
+  const Eigen::Index cols = input.cols();
+  const int radius = static_cast<int>(halfWidths.size()) / 2;
+  const float infinity = std::numeric_limits<float>::infinity();
+
+  // The invalid cells never are the minimum.
+  const Matrix values = input.unaryExpr([infinity](float value) { return std::isfinite(value) ? value : infinity; });
+
+  output.resize(rows, cols);
+  forEachColumnRange(cols, parallel, [&](const tbb::blocked_range<Eigen::Index>& range) {
+    Eigen::VectorXf minimum(rows);
+    Eigen::VectorXf columnMinimum(rows);
+    Eigen::VectorXf padded, prefix, suffix;
+    for (Eigen::Index j = range.begin(); j < range.end(); ++j) {
+      minimum.setConstant(infinity);
+      for (int dj = -radius; dj <= radius; ++dj) {
+        const Eigen::Index column = j + dj;
+        if (column < 0 || column >= cols) {
+          continue;
+        }
+        const int w = halfWidths[dj + radius];
+        if (w == 0) {
+          minimum = minimum.cwiseMin(values.col(column));
+          continue;
+        }
+        padded.setConstant(rows + 2 * w, infinity);
+        padded.segment(w, rows) = values.col(column);
+        prefix.resize(padded.size());
+        suffix.resize(padded.size());
+        slidingMin(padded, w, prefix, suffix, columnMinimum);
+        minimum = minimum.cwiseMin(columnMinimum);
+      }
+      // Only the valid cells get a minimum (they are in their own disk).
+      output.col(j) = input.col(j).array().isFinite().select(minimum.array(), std::numeric_limits<float>::quiet_NaN());
+    }
+  });
+}
+
+}  // namespace in_radius
+}  // namespace grid_map
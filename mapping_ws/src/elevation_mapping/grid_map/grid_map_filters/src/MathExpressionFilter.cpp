@@ -8,13 +8,18 @@
 
 #include "grid_map_filters/MathExpressionFilter.hpp"
 
+#include <memory>
+
+#include <tbb/task_scheduler_init.h>
+#include <tbb/tbb.h>
+
 #include <grid_map_core/grid_map_core.hpp>
 
 using namespace filters;
 
 namespace grid_map {
 
-MathExpressionFilter::MathExpressionFilter() = default;
+MathExpressionFilter::MathExpressionFilter() : isProgramValid_(false), parallelizationEnabled_(false), threadCount_(1) {}
 
 MathExpressionFilter::~MathExpressionFilter() = default;
 
@@ -29,18 +34,73 @@ bool MathExpressionFilter::configure() {
     return false;
   }
 
-  // TODO Can we make caching work with changing shared variable?
-  //  parser_.setCacheExpressions(true);
+  if (!FilterBase::getParam(std::string("parallelization_enabled"), parallelizationEnabled_)) {
+    ROS_DEBUG("MathExpressionFilter did not find parameter 'parallelization_enabled'. Setting to default value: 'false'.");
+    parallelizationEnabled_ = false;
+  }
+
+  if (!FilterBase::getParam(std::string("thread_number"), threadCount_)) {
+    ROS_DEBUG("MathExpressionFilter did not find parameter 'thread_number'. Setting to default value: 'automatic'.");
+    threadCount_ = tbb::task_scheduler_init::automatic;
+  }
+
+  // The expression is parsed in update(), when the layers (variables) are known.
+  programLayers_.clear();
+  isProgramValid_ = false;
   return true;
 }
 
 bool MathExpressionFilter::update(const GridMap& mapIn, GridMap& mapOut) {
   mapOut = mapIn;
-  for (const auto& layer : mapOut.getLayers()) {
-    parser_.var(layer).setShared(mapOut[layer]);
+  const std::vector<std::string>& layers = mapOut.getLayers();
+  if (layers != programLayers_) {
+    programLayers_ = layers;
+    isProgramValid_ = program_.compile(expression_, layers);
+    if (!isProgramValid_) {
+      ROS_DEBUG("MathExpressionFilter: expression '%s' is evaluated with the EigenLab parser.", expression_.c_str());
+    }
+  }
+
+  if (!isProgramValid_) {
+    // TODO Can we make caching work with changing shared variable?
+    //  parser_.setCacheExpressions(true);
+    for (const auto& layer : layers) {
+      parser_.var(layer).setShared(mapOut[layer]);
+    }
+    EigenLab::Value<Eigen::MatrixXf> result(parser_.eval(expression_));
+    mapOut.add(outputLayer_, result.matrix());
+    return true;
+  }
+
+  // All the layers have the same size, the variables are views on blocks of columns.
+  const Eigen::Index rows = mapOut.getSize()(0);
+  const auto getVariables = [&](Eigen::Index firstCol, Eigen::Index numCols) {
+    std::vector<MathExpressionProgram::ConstMatrixView> variables;
+    variables.reserve(layers.size());
+    for (const auto& layer : layers) {
+      variables.emplace_back(mapOut[layer].data() + firstCol * rows, rows, numCols, Eigen::OuterStride<>(rows));
+    }
+    return variables;
+  };
+
+  Matrix result;
+  const Eigen::Index cols = mapOut.getSize()(1);
+  if (!parallelizationEnabled_ || !program_.isElementwise() || program_.hasScalarResult()) {
+    program_.evaluate(getVariables(0, cols), workspace_, result);
+  } else {
+    std::unique_ptr<tbb::task_scheduler_init> TBBInitPtr;
+    if (threadCount_ != -1) {
+      TBBInitPtr.reset(new tbb::task_scheduler_init(threadCount_));
+    }
+    result.resize(rows, cols);
+    tbb::parallel_for(tbb::blocked_range<Eigen::Index>(0, cols), [&](const tbb::blocked_range<Eigen::Index>& range) {
+      MathExpressionProgram::Workspace workspace;
+      Matrix block;
+      program_.evaluate(getVariables(range.begin(), range.size()), workspace, block);
+      result.middleCols(range.begin(), range.size()) = block;
+    });
   }
-  EigenLab::Value<Eigen::MatrixXf> result(parser_.eval(expression_));
-  mapOut.add(outputLayer_, result.matrix());
+  mapOut.add(outputLayer_, result);
   return true;
 }
 
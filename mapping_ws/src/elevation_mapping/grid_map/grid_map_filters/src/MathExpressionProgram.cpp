@@ -0,0 +1,594 @@
+/*
+ * MathExpressionProgram.cpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: Luigi Freda
+ */
+
+#include "grid_map_filters/MathExpressionProgram.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+#include <utility>
+
+#include <grid_map_core/grid_map_core.hpp>
+
+namespace grid_map {
+
+/*!
+ * Recursive descent parser with the precedence of EigenLab (from the lowest):
+ * + - .+ .-, then * / .* ./, then ^ .^ (all left-associative), then the unary -.
+ */
+class MathExpressionProgram::Parser {
+ public:
+  Parser(const std::string& expression, MathExpressionProgram& program) : expression_(expression), program_(program) {}
+
+  bool parse() {
+    if (!parseSum()) {
+      return false;
+    }
+    skipSpaces();
+    return position_ == expression_.size() && kinds_.size() == 1;
+  }
+
+  //! True if the result of the expression is a scalar whatever the variables.
+  bool isScalarResult() const { return !kinds_.empty() && kinds_.back() == Kind::Scalar; }
+
+ private:
+  enum class Kind { Scalar, Matrix };
+
+  void skipSpaces() {
+    while (position_ < expression_.size() && std::isspace(static_cast<unsigned char>(expression_[position_]))) {
+      ++position_;
+    }
+  }
+
+  //! Reads the operator op (1 or 2 characters) if it is next.
+  bool accept(const std::string& op) {
+    skipSpaces();
+    if (expression_.compare(position_, op.size(), op) != 0) {
+      return false;
+    }
+    position_ += op.size();
+    return true;
+  }
+
+  void emit(OpCode opCode, float value = 0.0f, int variable = -1) {
+    program_.program_.push_back({opCode, value, variable});
+  }
+
+  void push(Kind kind) {
+    kinds_.push_back(kind);
+    program_.stackSize_ = std::max(program_.stackSize_, kinds_.size());
+  }
+
+  //! Emits a binary operation on the last two values.
+  void emitBinary(OpCode opCode, bool isMatrixOperationIfMatrices) {
+    const Kind rhs = kinds_.back();
+    kinds_.pop_back();
+    const Kind lhs = kinds_.back();
+    kinds_.pop_back();
+    if (isMatrixOperationIfMatrices && lhs == Kind::Matrix && rhs == Kind::Matrix) {
+      // Matrix product (or an error).
+      program_.isElementwise_ = false;
+    }
+    push(lhs == Kind::Scalar && rhs == Kind::Scalar ? Kind::Scalar : Kind::Matrix);
+    emit(opCode);
+  }
+
+  bool parseSum() {
+    if (!parseProduct()) {
+      return false;
+    }
+    while (true) {
+      OpCode opCode;
+      if (accept(".+") || accept("+")) {
+        opCode = OpCode::Add;
+      } else if (accept(".-") || accept("-")) {
+        opCode = OpCode::Subtract;
+      } else {
+        return true;
+      }
+      if (!parseProduct()) {
+        return false;
+      }
+      emitBinary(opCode, false);
+    }
+  }
+
+  bool parseProduct() {
+    if (!parsePower()) {
+      return false;
+    }
+    while (true) {
+      OpCode opCode;
+      bool isMatrixOperation = false;
+      if (accept(".*")) {
+        opCode = OpCode::ElementwiseMultiply;
+      } else if (accept("./")) {
+        opCode = OpCode::ElementwiseDivide;
+      } else if (accept("*")) {
+        opCode = OpCode::Multiply;
+        isMatrixOperation = true;
+      } else if (accept("/")) {
+        opCode = OpCode::Divide;
+        isMatrixOperation = true;
+      } else {
+        return true;
+      }
+      if (!parsePower()) {
+        return false;
+      }
+      emitBinary(opCode, isMatrixOperation);
+    }
+  }
+
+  bool parsePower() {
+    if (!parseUnary()) {
+      return false;
+    }
+    while (true) {
+      OpCode opCode;
+      bool isMatrixOperation = false;
+      if (accept(".^")) {
+        opCode = OpCode::ElementwisePower;
+      } else if (accept("^")) {
+        opCode = OpCode::Power;
+        isMatrixOperation = true;
+      } else {
+        return true;
+      }
+      if (!parseUnary()) {
+        return false;
+      }
+      emitBinary(opCode, isMatrixOperation);
+    }
+  }
+
+  bool parseUnary() {
+    if (accept("-")) {
+      if (!parseUnary()) {
+        return false;
+      }
+      emit(OpCode::Negate);
+      return true;
+    }
+    return parsePrimary();
+  }
+
+  bool parsePrimary() {
+    skipSpaces();
+    if (position_ == expression_.size()) {
+      return false;
+    }
+    const char c = expression_[position_];
+    if (c == '(') {
+      ++position_;
+      return parseSum() && accept(")");
+    }
+    if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+      return parseNumber();
+    }
+    if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+      return parseName();
+    }
+    return false;
+  }
+
+  bool parseNumber() {
+    // Digits, an optional decimal point (unless it starts an operator like .*) and an optional exponent.
+    const size_t start = position_;
+    const auto isDigit = [this](size_t i) { return i < expression_.size() && std::isdigit(static_cast<unsigned char>(expression_[i])); };
+    while (isDigit(position_)) {
+      ++position_;
+    }
+    if (position_ < expression_.size() && expression_[position_] == '.' &&
+        (position_ + 1 == expression_.size() || std::string("+-*/^").find(expression_[position_ + 1]) == std::string::npos)) {
+      ++position_;
+      while (isDigit(position_)) {
+        ++position_;
+      }
+    }
+    if (position_ == start || (position_ == start + 1 && expression_[start] == '.')) {
+      return false;
+    }
+    if (position_ < expression_.size() && (expression_[position_] == 'e' || expression_[position_] == 'E')) {
+      size_t exponent = position_ + 1;
+      if (exponent < expression_.size() && (expression_[exponent] == '+' || expression_[exponent] == '-')) {
+        ++exponent;
+      }
+      if (isDigit(exponent)) {
+        position_ = exponent;
+        while (isDigit(position_)) {
+          ++position_;
+        }
+      }
+    }
+    emit(OpCode::Constant, std::strtof(expression_.substr(start, position_ - start).c_str(), nullptr));
+    push(Kind::Scalar);
+    return true;
+  }
+
+  bool parseName() {
+    const size_t start = position_;
+    while (position_ < expression_.size() &&
+           (std::isalnum(static_cast<unsigned char>(expression_[position_])) || expression_[position_] == '_')) {
+      ++position_;
+    }
+    const std::string name = expression_.substr(start, position_ - start);
+    if (accept("(")) {
+      return parseFunction(name);
+    }
+    const auto variable = std::find(program_.variables_.begin(), program_.variables_.end(), name);
+    if (variable == program_.variables_.end()) {
+      return false;
+    }
+    emit(OpCode::Variable, 0.0f, static_cast<int>(variable - program_.variables_.begin()));
+    push(Kind::Matrix);
+    return true;
+  }
+
+  bool parseFunction(const std::string& name) {
+    if (!parseSum()) {
+      return false;
+    }
+    if (accept(",")) {
+      if (!parseSum() || !accept(")")) {
+        return false;
+      }
+      if (name == "cwiseMin") {
+        emitBinary(OpCode::CwiseMin, false);
+      } else if (name == "cwiseMax") {
+        emitBinary(OpCode::CwiseMax, false);
+      } else {
+        return false;
+      }
+      return true;
+    }
+    if (!accept(")")) {
+      return false;
+    }
+
+    static const std::vector<std::pair<std::string, OpCode>> elementwiseFunctions{
+        {"abs", OpCode::Abs}, {"sqrt", OpCode::Sqrt}, {"square", OpCode::Square}, {"exp", OpCode::Exp},
+        {"log", OpCode::Log}, {"log10", OpCode::Log10}, {"sin", OpCode::Sin},     {"cos", OpCode::Cos},
+        {"tan", OpCode::Tan}, {"acos", OpCode::Acos},   {"asin", OpCode::Asin}};
+    static const std::vector<std::pair<std::string, OpCode>> reductions{
+        {"min", OpCode::Min},
+        {"max", OpCode::Max},
+        {"absmax", OpCode::AbsMax},
+        {"minOfFinites", OpCode::MinOfFinites},
+        {"maxOfFinites", OpCode::MaxOfFinites},
+        {"mean", OpCode::Mean},
+        {"meanOfFinites", OpCode::MeanOfFinites},
+        {"sum", OpCode::Sum},
+        {"sumOfFinites", OpCode::SumOfFinites},
+        {"prod", OpCode::Prod},
+        {"numberOfFinites", OpCode::NumberOfFinites},
+        {"trace", OpCode::Trace},
+        {"norm", OpCode::Norm}};
+    const auto hasName = [&name](const std::pair<std::string, OpCode>& function) { return function.first == name; };
+
+    const auto elementwiseFunction = std::find_if(elementwiseFunctions.begin(), elementwiseFunctions.end(), hasName);
+    if (elementwiseFunction != elementwiseFunctions.end()) {
+      emit(elementwiseFunction->second);
+      return true;
+    }
+    const auto reduction = std::find_if(reductions.begin(), reductions.end(), hasName);
+    if (reduction != reductions.end()) {
+      if (kinds_.back() == Kind::Matrix) {
+        program_.isElementwise_ = false;
+      }
+      kinds_.pop_back();
+      push(Kind::Scalar);
+      emit(reduction->second);
+      return true;
+    }
+    return false;
+  }
+
+  const std::string& expression_;
+  MathExpressionProgram& program_;
+  size_t position_{0};
+
+  //! Kinds of the values on the stack of the program.
+  std::vector<Kind> kinds_;
+};
+
+bool MathExpressionProgram::compile(const std::string& expression, const std::vector<std::string>& variables) {
+  program_.clear();
+  stackSize_ = 0;
+  variables_ = variables;
+  isElementwise_ = true;
+  Parser parser(expression, *this);
+  if (!parser.parse()) {
+    program_.clear();
+    return false;
+  }
+  hasScalarResult_ = parser.isScalarResult();
+  return true;
+}
+
+std::vector<std::string> MathExpressionProgram::getUsedVariables() const {
+  std::vector<std::string> usedVariables;
+  for (const auto& instruction : program_) {
+    if (instruction.opCode == OpCode::Variable &&
+        std::find(usedVariables.begin(), usedVariables.end(), variables_[instruction.variable]) == usedVariables.end()) {
+      usedVariables.push_back(variables_[instruction.variable]);
+    }
+  }
+  return usedVariables;
+}
+
+void MathExpressionProgram::evaluate(const std::vector<ConstMatrixView>& variables, Workspace& workspace, Matrix& result) const {
+  run(variables, workspace);
+  result = workspace.stack_.front().view();
+}
+
+bool MathExpressionProgram::evaluateScalar(const std::vector<ConstMatrixView>& variables, Workspace& workspace, float& result) const {
+  run(variables, workspace);
+  const Workspace::Entry& entry = workspace.stack_.front();
+  if (!entry.isScalar()) {
+    return false;
+  }
+  result = entry.data[0];
+  return true;
+}
+
+namespace {
+
+// Element-wise operations, on arrays and scalars.
+struct AddOp {
+  template <typename A, typename B>
+  auto operator()(const A& a, const B& b) const -> decltype(a + b) {
+    return a + b;
+  }
+};
+
+struct SubtractOp {
+  template <typename A, typename B>
+  auto operator()(const A& a, const B& b) const -> decltype(a - b) {
+    return a - b;
+  }
+};
+
+struct MultiplyOp {
+  template <typename A, typename B>
+  auto operator()(const A& a, const B& b) const -> decltype(a * b) {
+    return a * b;
+  }
+};
+
+struct DivideOp {
+  template <typename A, typename B>
+  auto operator()(const A& a, const B& b) const -> decltype(a / b) {
+    return a / b;
+  }
+};
+
+/*!
+ * lhs = lhs op rhs with the broadcast of the 1x1 operands, as EigenLab. The result is written
+ * in the local matrix of lhs: the local matrix is only resized (reallocated) when lhs is a
+ * scalar, which is read before.
+ * @param isLhsBroadcast if a 1x1 lhs is broadcast to a matrix rhs.
+ * @param isMatrixMatrix if the operation is defined on two matrices of the same size.
+ */
+template <typename Entry, typename Op>
+void applyElementwise(Entry& lhs, const Entry& rhs, const Op& op, const char* symbol, bool isLhsBroadcast, bool isMatrixMatrix) {
+  if (rhs.isScalar()) {
+    const float value = rhs.data[0];
+    lhs.local = op(lhs.view().array(), value).matrix();
+  } else if (isLhsBroadcast && lhs.isScalar()) {
+    const float value = lhs.data[0];
+    lhs.local = op(value, rhs.view().array()).matrix();
+  } else if (isMatrixMatrix && lhs.rows == rhs.rows && lhs.cols == rhs.cols) {
+    lhs.local = op(lhs.view().array(), rhs.view().array()).matrix();
+  } else {
+    throw std::runtime_error(std::string("Invalid operand dimensions for operation '") + symbol + "'.");
+  }
+  lhs.setLocal();
+}
+
+// The same for the operations with no vectorized Eigen expression.
+template <typename Entry, typename Function>
+void applyElementwiseFunction(Entry& lhs, const Entry& rhs, const Function& function, const char* symbol, bool isLhsBroadcast,
+                              bool isMatrixMatrix) {
+  if (rhs.isScalar()) {
+    const float value = rhs.data[0];
+    lhs.local = lhs.view().unaryExpr([&function, value](float a) { return function(a, value); });
+  } else if (isLhsBroadcast && lhs.isScalar()) {
+    const float value = lhs.data[0];
+    lhs.local = rhs.view().unaryExpr([&function, value](float b) { return function(value, b); });
+  } else if (isMatrixMatrix && lhs.rows == rhs.rows && lhs.cols == rhs.cols) {
+    lhs.local = lhs.view().binaryExpr(rhs.view(), function);
+  } else {
+    throw std::runtime_error(std::string("Invalid operand dimensions for operation '") + symbol + "'.");
+  }
+  lhs.setLocal();
+}
+
+template <typename Entry>
+void setScalar(Entry& entry, float value) {
+  entry.local.resize(1, 1);
+  entry.local(0, 0) = value;
+  entry.setLocal();
+}
+
+struct PowerOp {
+  float operator()(float a, float b) const { return std::pow(a, b); }
+};
+
+struct MinOp {
+  float operator()(float a, float b) const { return std::min(a, b); }
+};
+
+struct MaxOp {
+  float operator()(float a, float b) const { return std::max(a, b); }
+};
+
+}  // namespace
+
+void MathExpressionProgram::run(const std::vector<ConstMatrixView>& variables, Workspace& workspace) const {
+  std::vector<Workspace::Entry>& stack = workspace.stack_;
+  if (stack.size() < stackSize_) {
+    stack.resize(stackSize_);
+  }
+  size_t size = 0;
+
+  for (const auto& instruction : program_) {
+    // The last value and, for the binary operations, the one before.
+    Workspace::Entry& top = stack[size > 0 ? size - 1 : 0];
+    Workspace::Entry& lhs = stack[size > 1 ? size - 2 : 0];
+    switch (instruction.opCode) {
+      case OpCode::Constant:
+        setScalar(stack[size++], instruction.value);
+        break;
+      case OpCode::Variable:
+        stack[size++].setView(variables[instruction.variable]);
+        break;
+      case OpCode::Negate:
+        top.local = -top.view();
+        top.setLocal();
+        break;
+      case OpCode::Add:
+        applyElementwise(lhs, top, AddOp(), "+", true, true);
+        --size;
+        break;
+      case OpCode::Subtract:
+        applyElementwise(lhs, top, SubtractOp(), "-", true, true);
+        --size;
+        break;
+      case OpCode::Multiply:
+        if (lhs.isScalar() || top.isScalar()) {
+          applyElementwise(lhs, top, MultiplyOp(), "*", true, false);
+        } else if (lhs.cols == top.rows) {
+          Matrix product = lhs.view() * top.view();
+          lhs.local.swap(product);
+          lhs.setLocal();
+        } else {
+          throw std::runtime_error("Invalid operand dimensions for operation '*'.");
+        }
+        --size;
+        break;
+      case OpCode::ElementwiseMultiply:
+        applyElementwise(lhs, top, MultiplyOp(), ".*", true, true);
+        --size;
+        break;
+      case OpCode::Divide:
+        applyElementwise(lhs, top, DivideOp(), "/", true, false);
+        --size;
+        break;
+      case OpCode::ElementwiseDivide:
+        applyElementwise(lhs, top, DivideOp(), "./", true, true);
+        --size;
+        break;
+      case OpCode::Power:
+        applyElementwiseFunction(lhs, top, PowerOp(), "^", true, false);
+        --size;
+        break;
+      case OpCode::ElementwisePower:
+        applyElementwiseFunction(lhs, top, PowerOp(), ".^", true, true);
+        --size;
+        break;
+      case OpCode::CwiseMin:
+        applyElementwiseFunction(lhs, top, MinOp(), "cwiseMin", false, true);
+        --size;
+        break;
+      case OpCode::CwiseMax:
+        applyElementwiseFunction(lhs, top, MaxOp(), "cwiseMax", false, true);
+        --size;
+        break;
+      case OpCode::Abs:
+        top.local = top.view().array().abs().matrix();
+        top.setLocal();
+        break;
+      case OpCode::Sqrt:
+        top.local = top.view().array().sqrt().matrix();
+        top.setLocal();
+        break;
+      case OpCode::Square:
+        top.local = top.view().array().square().matrix();
+        top.setLocal();
+        break;
+      case OpCode::Exp:
+        top.local = top.view().array().exp().matrix();
+        top.setLocal();
+        break;
+      case OpCode::Log:
+        top.local = top.view().array().log().matrix();
+        top.setLocal();
+        break;
+      case OpCode::Log10:
+        top.local = (top.view().array().log() * static_cast<float>(1.0 / std::log(10.0))).matrix();
+        top.setLocal();
+        break;
+      case OpCode::Sin:
+        top.local = top.view().array().sin().matrix();
+        top.setLocal();
+        break;
+      case OpCode::Cos:
+        top.local = top.view().array().cos().matrix();
+        top.setLocal();
+        break;
+      case OpCode::Tan:
+        top.local = top.view().array().tan().matrix();
+        top.setLocal();
+        break;
+      case OpCode::Acos:
+        top.local = top.view().array().acos().matrix();
+        top.setLocal();
+        break;
+      case OpCode::Asin:
+        top.local = top.view().array().asin().matrix();
+        top.setLocal();
+        break;
+      case OpCode::Min:
+        setScalar(top, top.view().minCoeff());
+        break;
+      case OpCode::Max:
+        setScalar(top, top.view().maxCoeff());
+        break;
+      case OpCode::AbsMax: {
+        const float minimum = top.view().minCoeff();
+        const float maximum = top.view().maxCoeff();
+        setScalar(top, std::abs(maximum) >= std::abs(minimum) ? maximum : minimum);
+        break;
+      }
+      case OpCode::MinOfFinites:
+        setScalar(top, top.view().minCoeffOfFinites());
+        break;
+      case OpCode::MaxOfFinites:
+        setScalar(top, top.view().maxCoeffOfFinites());
+        break;
+      case OpCode::Mean:
+        setScalar(top, top.view().mean());
+        break;
+      case OpCode::MeanOfFinites:
+        setScalar(top, top.view().meanOfFinites());
+        break;
+      case OpCode::Sum:
+        setScalar(top, top.view().sum());
+        break;
+      case OpCode::SumOfFinites:
+        setScalar(top, top.view().sumOfFinites());
+        break;
+      case OpCode::Prod:
+        setScalar(top, top.view().prod());
+        break;
+      case OpCode::NumberOfFinites:
+        setScalar(top, top.view().numberOfFinites());
+        break;
+      case OpCode::Trace:
+        setScalar(top, top.view().trace());
+        break;
+      case OpCode::Norm:
+        setScalar(top, top.view().norm());
+        break;
+    }
+  }
+}
+
+}  // namespace grid_map
@@ -9,13 +9,20 @@
 #include "grid_map_filters/MeanInRadiusFilter.hpp"
 
 #include <math.h>
+#include <memory>
+
+#include <tbb/task_scheduler_init.h>
+#include <tbb/tbb.h>
+
 #include <grid_map_core/grid_map_core.hpp>
 
+#include "grid_map_filters/InRadiusKernels.hpp"
+
 using namespace filters;
 
 namespace grid_map {
 
-MeanInRadiusFilter::MeanInRadiusFilter() : radius_(0.0) {}
+MeanInRadiusFilter::MeanInRadiusFilter() : radius_(0.0), parallelizationEnabled_(false), threadCount_(1) {}
 
 MeanInRadiusFilter::~MeanInRadiusFilter() = default;
 
@@ -45,6 +52,19 @@ bool MeanInRadiusFilter::configure() {
   }
 
   ROS_DEBUG("MeanInRadius output_layer = %s.", outputLayer_.c_str());
+
+  // The columns of the layer are processed in parallel (TBB) if enabled.
+  if (!FilterBase::getParam(std::string("parallelization_enabled"), parallelizationEnabled_)) {
+    ROS_DEBUG("MeanInRadius filter did not find parameter `parallelization_enabled`. Setting to default value: 'false'.");
+    parallelizationEnabled_ = false;
+  }
+  ROS_DEBUG("MeanInRadius parallelization_enabled = %d.", parallelizationEnabled_);
+
+  if (!FilterBase::getParam(std::string("thread_number"), threadCount_)) {
+    ROS_DEBUG("MeanInRadius filter did not find parameter `thread_number`. Setting to default value: 'automatic'.");
+    threadCount_ = tbb::task_scheduler_init::automatic;
+  }
+  ROS_DEBUG("MeanInRadius thread_number = %d.", threadCount_);
   return true;
 }
 
@@ -53,31 +73,18 @@ bool MeanInRadiusFilter::update(const GridMap& mapIn, GridMap& mapOut) {
   mapOut = mapIn;
   mapOut.add(outputLayer_);
 
-  double value{NAN};
-
-  // First iteration through the elevation map.
-  for (grid_map::GridMapIterator iterator(mapOut); !iterator.isPastEnd(); ++iterator) {
-    double valueSum = 0.0;
-    int counter = 0;
-    // Requested position (center) of circle in map.
-    Eigen::Vector2d center;
-    mapOut.getPosition(*iterator, center);
-
-    // Find the mean in a circle around the center
-    for (grid_map::CircleIterator submapIterator(mapOut, center, radius_); !submapIterator.isPastEnd(); ++submapIterator) {
-      if (!mapOut.isValid(*submapIterator, inputLayer_)) {
-        continue;
-      }
-      value = mapOut.at(inputLayer_, *submapIterator);
-      valueSum += value;
-      counter++;
-    }
-
-    if (counter != 0) {
-      mapOut.at(outputLayer_, *iterator) = valueSum / counter;
-    }
+  // The disk is the same for all the cells: compute the mean column by column on the unwrapped layer.
+  Matrix input;
+  Matrix output;
+  in_radius::unwrapLayer(mapOut[inputLayer_], mapOut.getStartIndex(), input);
+
+  std::unique_ptr<tbb::task_scheduler_init> TBBInitPtr;
+  if (parallelizationEnabled_ && threadCount_ != -1) {
+    TBBInitPtr.reset(new tbb::task_scheduler_init(threadCount_));
   }
+  in_radius::meanInDisk(input, in_radius::getDiskHalfWidths(radius_, mapOut.getResolution()), parallelizationEnabled_, output);
 
+  in_radius::wrapLayer(output, mapOut.getStartIndex(), mapOut[outputLayer_]);
   return true;
 }
 
@@ -9,13 +9,20 @@
 #include "grid_map_filters/MinInRadiusFilter.hpp"
 
 #include <math.h>
+#include <memory>
+
+#include <tbb/task_scheduler_init.h>
+#include <tbb/tbb.h>
+
 #include <grid_map_core/grid_map_core.hpp>
 
+#include "grid_map_filters/InRadiusKernels.hpp"
+
 using namespace filters;
 
 namespace grid_map {
 
-MinInRadiusFilter::MinInRadiusFilter() : radius_(0.0) {}
+MinInRadiusFilter::MinInRadiusFilter() : radius_(0.0), parallelizationEnabled_(false), threadCount_(1) {}
 
 MinInRadiusFilter::~MinInRadiusFilter() = default;
 
@@ -44,6 +51,19 @@ bool MinInRadiusFilter::configure() {
   }
 
   ROS_DEBUG("MinInRadius output_layer = %s.", outputLayer_.c_str());
+
+  // The columns of the layer are processed in parallel (TBB) if enabled.
+  if (!FilterBase::getParam(std::string("parallelization_enabled"), parallelizationEnabled_)) {
+    ROS_DEBUG("MinInRadius filter did not find parameter `parallelization_enabled`. Setting to default value: 'false'.");
+    parallelizationEnabled_ = false;
+  }
+  ROS_DEBUG("MinInRadius parallelization_enabled = %d.", parallelizationEnabled_);
+
+  if (!FilterBase::getParam(std::string("thread_number"), threadCount_)) {
+    ROS_DEBUG("MinInRadius filter did not find parameter `thread_number`. Setting to default value: 'automatic'.");
+    threadCount_ = tbb::task_scheduler_init::automatic;
+  }
+  ROS_DEBUG("MinInRadius thread_number = %d.", threadCount_);
   return true;
 }
 
@@ -52,43 +72,18 @@ bool MinInRadiusFilter::update(const GridMap& mapIn, GridMap& mapOut) {
   mapOut = mapIn;
   mapOut.add(outputLayer_);
 
-  double value{NAN};
-
-  // First iteration through the elevation map.
-  for (grid_map::GridMapIterator iterator(mapOut); !iterator.isPastEnd(); ++iterator) {
-    if (!mapOut.isValid(*iterator, inputLayer_)) {
-      continue;
-    }
-    value = mapOut.at(inputLayer_, *iterator);
-    double valueMin = 0.0;
-
-    // Requested position (center) of circle in map.
-    Eigen::Vector2d center;
-    mapOut.getPosition(*iterator, center);
-
-    // Get minimal value in the circular window.
-    bool init = false;
-    for (grid_map::CircleIterator submapIterator(mapOut, center, radius_); !submapIterator.isPastEnd(); ++submapIterator) {
-      if (!mapOut.isValid(*submapIterator, inputLayer_)) {
-        continue;
-      }
-      value = mapOut.at(inputLayer_, *submapIterator);
-
-      if (!init) {
-        valueMin = value;
-        init = true;
-        continue;
-      }
-      if (value < valueMin) {
-        valueMin = value;
-      }
-    }
-
-    if (init) {
-      mapOut.at(outputLayer_, *iterator) = valueMin;
-    }
+  // The disk is the same for all the cells: compute the min column by column on the unwrapped layer.
+  Matrix input;
+  Matrix output;
+  in_radius::unwrapLayer(mapOut[inputLayer_], mapOut.getStartIndex(), input);
+
+  std::unique_ptr<tbb::task_scheduler_init> TBBInitPtr;
+  if (parallelizationEnabled_ && threadCount_ != -1) {
+    TBBInitPtr.reset(new tbb::task_scheduler_init(threadCount_));
   }
+  in_radius::minInDisk(input, in_radius::getDiskHalfWidths(radius_, mapOut.getResolution()), parallelizationEnabled_, output);
 
+  in_radius::wrapLayer(output, mapOut.getStartIndex(), mapOut[outputLayer_]);
   return true;
 }
 
@@ -152,16 +152,23 @@ bool NormalVectorsFilter::update(const GridMap& mapIn, GridMap& mapOut) {
   return true;
 }
 
+NormalVectorsFilter::NormalVectorsLayers NormalVectorsFilter::getNormalVectorsLayers(GridMap& map, const std::string& outputLayersPrefix) {
+  return {map.getLayerHandle(outputLayersPrefix + "x"), map.getLayerHandle(outputLayersPrefix + "y"),
+          map.getLayerHandle(outputLayersPrefix + "z")};
+}
+
 // SVD Area based methods.
 void NormalVectorsFilter::computeWithAreaSerial(GridMap& map, const std::string& inputLayer, const std::string& outputLayersPrefix) {
   const double start = ros::Time::now().toSec();
+  const ConstLayerHandle input = map.getLayerHandle(inputLayer);
+  const NormalVectorsLayers outputLayers = getNormalVectorsLayers(map, outputLayersPrefix);
 
   // For each cell in submap.
   for (GridMapIterator iterator(map); !iterator.isPastEnd(); ++iterator) {
     // Check if this is an empty cell (hole in the map).
-    if (map.isValid(*iterator, inputLayer)) {
+    if (input.isValid(*iterator)) {
       const Index index(*iterator);
-      areaSingleNormalComputation(map, inputLayer, outputLayersPrefix, index);
+      areaSingleNormalComputation(map, input, outputLayers, index);
     }
   }
 
@@ -172,6 +179,8 @@ void NormalVectorsFilter::computeWithAreaSerial(GridMap& map, const std::string&
 void NormalVectorsFilter::computeWithAreaParallel(GridMap& map, const std::string& inputLayer, const std::string& outputLayersPrefix) {
   const double start = ros::Time::now().toSec();
   grid_map::Size gridMapSize = map.getSize();
+  const ConstLayerHandle input = map.getLayerHandle(inputLayer);
+  const NormalVectorsLayers outputLayers = getNormalVectorsLayers(map, outputLayersPrefix);
 
   // Set number of thread to use for parallel programming.
   std::unique_ptr<tbb::task_scheduler_init> TBBInitPtr;
@@ -183,8 +192,8 @@ void NormalVectorsFilter::computeWithAreaParallel(GridMap& map, const std::strin
   tbb::parallel_for(0, gridMapSize(0) * gridMapSize(1), [&](int range) {
     // Recover Cell index from range iterator.
     const Index index(range / gridMapSize(1), range % gridMapSize(1));
-    if (map.isValid(index, inputLayer)) {
-      areaSingleNormalComputation(map, inputLayer, outputLayersPrefix, index);
+    if (input.isValid(index)) {
+      areaSingleNormalComputation(map, input, outputLayers, index);
     }
   });
 
@@ -192,8 +201,8 @@ void NormalVectorsFilter::computeWithAreaParallel(GridMap& map, const std::strin
   ROS_DEBUG_THROTTLE(2.0, "NORMAL COMPUTATION TIME = %f", (end - start));
 }
 
-void NormalVectorsFilter::areaSingleNormalComputation(GridMap& map, const std::string& inputLayer, const std::string& outputLayersPrefix,
-                                                      const grid_map::Index& index) {
+void NormalVectorsFilter::areaSingleNormalComputation(GridMap& map, const ConstLayerHandle& inputLayer,
+                                                      const NormalVectorsLayers& outputLayers, const grid_map::Index& index) {
   // Requested position (center) of circle in map.
   Position center;
   map.getPosition(index, center);
@@ -245,9 +254,9 @@ void NormalVectorsFilter::areaSingleNormalComputation(GridMap& map, const std::s
     unitaryNormalVector = -unitaryNormalVector;
   }
 
-  map.at(outputLayersPrefix + "x", index) = unitaryNormalVector.x();
-  map.at(outputLayersPrefix + "y", index) = unitaryNormalVector.y();
-  map.at(outputLayersPrefix + "z", index) = unitaryNormalVector.z();
+  outputLayers.x(index) = unitaryNormalVector.x();
+  outputLayers.y(index) = unitaryNormalVector.y();
+  outputLayers.z(index) = unitaryNormalVector.z();
 }
 // Raster based methods.
 void NormalVectorsFilter::computeWithRasterSerial(GridMap& map, const std::string& inputLayer, const std::string& outputLayersPrefix) {
@@ -258,6 +267,7 @@ void NormalVectorsFilter::computeWithRasterSerial(GridMap& map, const std::strin
   gridMapResolution_ = map.getResolution();
   // Faster access to grid map values.
   const grid_map::Matrix dataMap = map[inputLayer];
+  const NormalVectorsLayers outputLayers = getNormalVectorsLayers(map, outputLayersPrefix);
   // Height and width of submap. Submap is Map without the outermost line of cells, no need to check if index is inside.
   const Index submapStartIndex(1, 1);
   const Index submapBufferSize(gridMapSize(0) - 2, gridMapSize(1) - 2);
@@ -265,7 +275,7 @@ void NormalVectorsFilter::computeWithRasterSerial(GridMap& map, const std::strin
   // For each cell in submap.
   for (SubmapIterator iterator(map, submapStartIndex, submapBufferSize); !iterator.isPastEnd(); ++iterator) {
     const Index index(*iterator);
-    rasterSingleNormalComputation(map, outputLayersPrefix, dataMap, index);
+    rasterSingleNormalComputation(outputLayers, dataMap, index);
   }
 
   const double end = ros::Time::now().toSec();
@@ -279,6 +289,7 @@ void NormalVectorsFilter::computeWithRasterParallel(GridMap& map, const std::str
   gridMapResolution_ = map.getResolution();
   // Faster access to grid map values if copy grid map layer into local matrix.
   const grid_map::Matrix dataMap = map[inputLayer];
+  const NormalVectorsLayers outputLayers = getNormalVectorsLayers(map, outputLayersPrefix);
   // Height and width of submap. Submap is Map without the outermost line of cells, no need to check if index is inside.
   const Index submapStartIndex(1, 1);
   const Index submapBufferSize(gridMapSize(0) - 2, gridMapSize(1) - 2);
@@ -291,7 +302,7 @@ void NormalVectorsFilter::computeWithRasterParallel(GridMap& map, const std::str
     // Parallelized iteration through the map.
     tbb::parallel_for(0, submapBufferSize(0) * submapBufferSize(1), [&](int range) {
       const Index index(range / submapBufferSize(1) + submapStartIndex(0), range % submapBufferSize(1) + submapStartIndex(1));
-      rasterSingleNormalComputation(map, outputLayersPrefix, dataMap, index);
+      rasterSingleNormalComputation(outputLayers, dataMap, index);
     });
   } else {
     ROS_ERROR("Grid map size is too small for normal raster computation");
@@ -301,8 +312,8 @@ void NormalVectorsFilter::computeWithRasterParallel(GridMap& map, const std::str
   ROS_DEBUG_THROTTLE(2.0, "NORMAL COMPUTATION TIME = %f", (end - start));
 }
 
-void NormalVectorsFilter::rasterSingleNormalComputation(GridMap& map, const std::string& outputLayersPrefix,
-                                                        const grid_map::Matrix& dataMap, const grid_map::Index& index) {
+void NormalVectorsFilter::rasterSingleNormalComputation(const NormalVectorsLayers& outputLayers, const grid_map::Matrix& dataMap,
+                                                        const grid_map::Index& index) {
   // Inspiration for algorithm:
   // http://www.flipcode.com/archives/Calculating_Vertex_Normals_for_Height_Maps.shtml
   const double centralCell = dataMap(index(0), index(1));
@@ -387,9 +398,9 @@ void NormalVectorsFilter::rasterSingleNormalComputation(GridMap& map, const std:
       normalVector = -normalVector;
     }
 
-    map.at(outputLayersPrefix + "x", index) = normalVector.x();
-    map.at(outputLayersPrefix + "y", index) = normalVector.y();
-    map.at(outputLayersPrefix + "z", index) = normalVector.z();
+    outputLayers.x(index) = normalVector.x();
+    outputLayers.y(index) = normalVector.y();
+    outputLayers.z(index) = normalVector.z();
   }
 }
 
@@ -8,6 +8,15 @@
 
 #include "grid_map_filters/SlidingWindowMathExpressionFilter.hpp"
 
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <new>
+#include <stdexcept>
+
+#include <tbb/task_scheduler_init.h>
+#include <tbb/tbb.h>
+
 using namespace filters;
 
 namespace grid_map {
@@ -17,7 +26,9 @@ SlidingWindowMathExpressionFilter::SlidingWindowMathExpressionFilter()
       useWindowLength_(false),
       windowLength_(0.0),
       isComputeEmptyCells_(true),
-      edgeHandling_(SlidingWindowIterator::EdgeHandling::INSIDE) {}
+      edgeHandling_(SlidingWindowIterator::EdgeHandling::INSIDE),
+      parallelizationEnabled_(false),
+      threadCount_(1) {}
 
 SlidingWindowMathExpressionFilter::~SlidingWindowMathExpressionFilter() = default;
 
@@ -66,6 +77,20 @@ bool SlidingWindowMathExpressionFilter::configure() {
     return false;
   }
 
+  if (!FilterBase::getParam(std::string("parallelization_enabled"), parallelizationEnabled_)) {
+    ROS_DEBUG("SlidingWindowMathExpressionFilter did not find parameter 'parallelization_enabled'. Setting to default value: 'false'.");
+    parallelizationEnabled_ = false;
+  }
+
+  if (!FilterBase::getParam(std::string("thread_number"), threadCount_)) {
+    ROS_DEBUG("SlidingWindowMathExpressionFilter did not find parameter 'thread_number'. Setting to default value: 'automatic'.");
+    threadCount_ = tbb::task_scheduler_init::automatic;
+  }
+
+  if (!program_.compile(expression_, {inputLayer_})) {
+    ROS_DEBUG("SlidingWindowMathExpressionFilter: expression '%s' is evaluated with the EigenLab parser.", expression_.c_str());
+  }
+
   // TODO(magnus): Can we make caching work with changing shared variable?
   //  parser_.setCacheExpressions(true);
   return true;
@@ -75,18 +100,92 @@ bool SlidingWindowMathExpressionFilter::update(const GridMap& mapIn, GridMap& ma
   mapOut = mapIn;
   mapOut.add(outputLayer_);
   Matrix& outputData = mapOut[outputLayer_];
-  grid_map::SlidingWindowIterator iterator(mapIn, inputLayer_, edgeHandling_, windowSize_);
+  if (!program_.isCompiled()) {
+    grid_map::SlidingWindowIterator iterator(mapIn, inputLayer_, edgeHandling_, windowSize_);
+    if (useWindowLength_) {
+      iterator.setWindowLength(mapIn, windowLength_);
+    }
+    for (; !iterator.isPastEnd(); ++iterator) {
+      parser_.var(inputLayer_).setLocal(iterator.getData());
+      EigenLab::Value<Eigen::MatrixXf> result(parser_.eval(expression_));
+      if (result.matrix().cols() == 1 && result.matrix().rows() == 1) {
+        outputData(iterator.getLinearIndex()) = result.matrix()(0);
+      } else {
+        ROS_ERROR("SlidingWindowMathExpressionFilter could not apply filter because expression has to result in a scalar!");
+      }
+    }
+    return true;
+  }
+
+  // Same windows as the SlidingWindowIterator, as views on the layer (no copies but for the
+  // padded windows at the edges).
+  if (!mapIn.isDefaultStartIndex()) {
+    throw std::runtime_error("SlidingWindowIterator cannot be used with grid maps that don't have a default buffer start index.");
+  }
+  int windowSize = windowSize_;
   if (useWindowLength_) {
-    iterator.setWindowLength(mapIn, windowLength_);
-  }
-  for (; !iterator.isPastEnd(); ++iterator) {
-    parser_.var(inputLayer_).setLocal(iterator.getData());
-    EigenLab::Value<Eigen::MatrixXf> result(parser_.eval(expression_));
-    if (result.matrix().cols() == 1 && result.matrix().rows() == 1) {
-      outputData(iterator.getLinearIndex()) = result.matrix()(0);
-    } else {
-      ROS_ERROR("SlidingWindowMathExpressionFilter could not apply filter because expression has to result in a scalar!");
+    windowSize = static_cast<int>(std::round(windowLength_ / mapIn.getResolution()));
+    if (windowSize % 2 != 1) {
+      ++windowSize;
+    }
+  }
+  if (windowSize % 2 == 0) {
+    throw std::runtime_error("SlidingWindowIterator has a wrong window size!");
+  }
+  const int windowMargin = (windowSize - 1) / 2;
+  const Matrix& data = mapIn[inputLayer_];
+  const Index size = mapIn.getSize();
+
+  std::atomic<bool> isScalarResult(true);
+  const auto processColumns = [&](const tbb::blocked_range<int>& range) {
+    MathExpressionProgram::Workspace workspace;
+    Matrix paddedWindow(windowSize, windowSize);
+    std::vector<MathExpressionProgram::ConstMatrixView> variables(1, MathExpressionProgram::ConstMatrixView(nullptr, 0, 0, Eigen::OuterStride<>(0)));
+    float result;
+    for (int col = range.begin(); col < range.end(); ++col) {
+      for (int row = 0; row < size(0); ++row) {
+        const Index originalTopLeftIndex(row - windowMargin, col - windowMargin);
+        const Index originalBottomRightIndex(row + windowMargin, col + windowMargin);
+        const Index topLeftIndex = originalTopLeftIndex.max(0);
+        const Index bottomRightIndex = originalBottomRightIndex.min(size - 1);
+        const bool isInside = (topLeftIndex == originalTopLeftIndex).all() && (bottomRightIndex == originalBottomRightIndex).all();
+        if (edgeHandling_ == SlidingWindowIterator::EdgeHandling::INSIDE && !isInside) {
+          continue;
+        }
+        const Index windowSizeInMap = bottomRightIndex - topLeftIndex + 1;
+        const MathExpressionProgram::ConstMatrixView window(&data(topLeftIndex(0), topLeftIndex(1)), windowSizeInMap(0), windowSizeInMap(1),
+                                                            Eigen::OuterStride<>(data.rows()));
+        if (isInside || edgeHandling_ == SlidingWindowIterator::EdgeHandling::CROP) {
+          // Eigen::Map has no assignment operator, rebind the view in place.
+          new (&variables[0]) MathExpressionProgram::ConstMatrixView(window);
+        } else {
+          paddedWindow.setConstant(edgeHandling_ == SlidingWindowIterator::EdgeHandling::EMPTY ? NAN : window.meanOfFinites());
+          const Index shift = topLeftIndex - originalTopLeftIndex;
+          paddedWindow.block(shift(0), shift(1), windowSizeInMap(0), windowSizeInMap(1)) = window;
+          new (&variables[0])
+              MathExpressionProgram::ConstMatrixView(paddedWindow.data(), windowSize, windowSize, Eigen::OuterStride<>(windowSize));
+        }
+        if (program_.evaluateScalar(variables, workspace, result)) {
+          outputData(row, col) = result;
+        } else {
+          isScalarResult = false;
+        }
+      }
     }
+  };
+
+  if (parallelizationEnabled_) {
+    std::unique_ptr<tbb::task_scheduler_init> TBBInitPtr;
+    if (threadCount_ != -1) {
+      TBBInitPtr.reset(new tbb::task_scheduler_init(threadCount_));
+    }
+    tbb::parallel_for(tbb::blocked_range<int>(0, size(1)), processColumns);
+  } else {
+    processColumns(tbb::blocked_range<int>(0, size(1)));
+  }
+
+  if (!isScalarResult) {
+    ROS_ERROR("SlidingWindowMathExpressionFilter could not apply filter because expression has to result in a scalar!");
   }
   return true;
 }
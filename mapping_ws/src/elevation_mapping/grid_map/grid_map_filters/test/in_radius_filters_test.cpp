@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+
+#include <filters/filter_base.hpp>
+#include <grid_map_core/grid_map_core.hpp>
+
+#include "grid_map_filters/MeanInRadiusFilter.hpp"
+#include "grid_map_filters/MinInRadiusFilter.hpp"
+
+using namespace grid_map;
+
+using BASE = filters::FilterBase<grid_map::GridMap>;
+
+namespace {
+
+XmlRpc::XmlRpcValue getConfig(const std::string& name, double radius, bool parallelizationEnabled) {
+  XmlRpc::XmlRpcValue config;
+  config["name"] = name;
+  config["type"] = "gridMapFilters/" + name;
+
+  XmlRpc::XmlRpcValue params;
+  params["radius"] = radius;
+  params["input_layer"] = "elevation";
+  params["output_layer"] = "filtered";
+  params["parallelization_enabled"] = parallelizationEnabled;
+
+  config["params"] = params;
+  return config;
+}
+
+// Map with random values and holes, moved so that the start index is not (0, 0).
+GridMap getInputMap() {
+  GridMap map({"elevation"});
+  map.setGeometry(Length(1.0, 0.8), 0.02, Position(0.0, 0.0));
+  map.setFrameId("map");
+  map.move(Position(0.23, -0.11));
+  EXPECT_NE(0, map.getStartIndex()(0));
+  EXPECT_NE(0, map.getStartIndex()(1));
+
+  std::srand(1);
+  for (GridMapIterator iterator(map); !iterator.isPastEnd(); ++iterator) {
+    const float value = static_cast<float>(std::rand()) / RAND_MAX;
+    map.at("elevation", *iterator) = value < 0.1 ? NAN : value;
+  }
+  return map;
+}
+
+// Reference implementations with a CircleIterator around each cell.
+bool getMeanInRadius(const GridMap& map, const Index& index, double radius, double& mean) {
+  Position center;
+  map.getPosition(index, center);
+  double sum = 0.0;
+  int counter = 0;
+  for (CircleIterator iterator(map, center, radius); !iterator.isPastEnd(); ++iterator) {
+    if (map.isValid(*iterator, "elevation")) {
+      sum += map.at("elevation", *iterator);
+      ++counter;
+    }
+  }
+  mean = counter > 0 ? sum / counter : NAN;
+  return counter > 0;
+}
+
+bool getMinInRadius(const GridMap& map, const Index& index, double radius, double& min) {
+  if (!map.isValid(index, "elevation")) {
+    return false;
+  }
+  Position center;
+  map.getPosition(index, center);
+  min = map.at("elevation", index);
+  for (CircleIterator iterator(map, center, radius); !iterator.isPastEnd(); ++iterator) {
+    if (map.isValid(*iterator, "elevation")) {
+      min = std::min(min, static_cast<double>(map.at("elevation", *iterator)));
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+TEST(InRadiusFilters, MeanMatchesCircleIterator) {  // NOLINT
+  // The radius is not a multiple of the resolution, no cell is on the circle.
+  const double radius = 0.07;
+  const GridMap filterInput = getInputMap();
+
+  for (const bool parallelizationEnabled : {false, true}) {
+    MeanInRadiusFilter filter;
+    filter.BASE::configure(getConfig("MeanInRadiusFilter", radius, parallelizationEnabled));
+    ASSERT_TRUE(filter.configure());
+
+    GridMap filterOutput;
+    ASSERT_TRUE(filter.update(filterInput, filterOutput));
+    ASSERT_TRUE(filterOutput.exists("filtered"));
+
+    for (GridMapIterator iterator(filterOutput); !iterator.isPastEnd(); ++iterator) {
+      double mean;
+      if (getMeanInRadius(filterInput, *iterator, radius, mean)) {
+        EXPECT_NEAR(mean, filterOutput.at("filtered", *iterator), 1e-5);
+      } else {
+        EXPECT_FALSE(filterOutput.isValid(*iterator, "filtered"));
+      }
+    }
+  }
+}
+
+TEST(InRadiusFilters, MinMatchesCircleIterator) {  // NOLINT
+  const double radius = 0.07;
+  const GridMap filterInput = getInputMap();
+
+  for (const bool parallelizationEnabled : {false, true}) {
+    MinInRadiusFilter filter;
+    filter.BASE::configure(getConfig("MinInRadiusFilter", radius, parallelizationEnabled));
+    ASSERT_TRUE(filter.configure());
+
+    GridMap filterOutput;
+    ASSERT_TRUE(filter.update(filterInput, filterOutput));
+    ASSERT_TRUE(filterOutput.exists("filtered"));
+
+    for (GridMapIterator iterator(filterOutput); !iterator.isPastEnd(); ++iterator) {
+      double min;
+      if (getMinInRadius(filterInput, *iterator, radius, min)) {
+        EXPECT_FLOAT_EQ(min, filterOutput.at("filtered", *iterator));
+      } else {
+        EXPECT_FALSE(filterOutput.isValid(*iterator, "filtered"));
+      }
+    }
+  }
+}
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include <grid_map_core/grid_map_core.hpp>
+
+#include "EigenLab/EigenLab.h"
+#include "grid_map_filters/MathExpressionProgram.hpp"
+
+using namespace grid_map;
+
+namespace {
+
+MathExpressionProgram::ConstMatrixView getView(const Matrix& matrix) {
+  return MathExpressionProgram::ConstMatrixView(matrix.data(), matrix.rows(), matrix.cols(), Eigen::OuterStride<>(matrix.rows()));
+}
+
+}  // namespace
+
+TEST(MathExpressionProgram, MatchesEigenLab) {  // NOLINT
+  Matrix a = Matrix::Random(6, 5).cwiseAbs();
+  Matrix b = Matrix::Random(6, 5);
+  a(2, 3) = NAN;
+  EigenLab::Parser<Eigen::MatrixXf> parser;
+  parser.var("a").setShared(a);
+  parser.var("b").setShared(b);
+
+  const std::vector<std::string> expressions{"a + b",
+                                             "a - 2 * b",
+                                             "-a^2",
+                                             "2^-1 * a",
+                                             "abs(a - b)",
+                                             "sqrt(sumOfFinites(square(a - meanOfFinites(a))) ./ numberOfFinites(a))",
+                                             "0.5 * (1.0 - (a / 0.6)) + 0.5 * (1.0 - (b / 0.1))",
+                                             "acos(b)",
+                                             "cwiseMin(a, 0.5) + cwiseMax(a, b)",
+                                             "a.*b./(a+1)",
+                                             "a.^2 - 1e-2",
+                                             "log10(a) + exp(-b)",
+                                             "2./a",
+                                             "min(b) + max(b) * mean(b)",
+                                             "absmax(b) + norm(b) + trace(b)",
+                                             "2.*a",
+                                             "b .- a .+ 1"};
+  MathExpressionProgram::Workspace workspace;
+  for (const auto& expression : expressions) {
+    MathExpressionProgram program;
+    ASSERT_TRUE(program.compile(expression, {"a", "b"})) << expression;
+    Matrix result;
+    program.evaluate({getView(a), getView(b)}, workspace, result);
+
+    const EigenLab::Value<Eigen::MatrixXf> value(parser.eval(expression));
+    const Matrix expected = value.matrix();
+    ASSERT_EQ(expected.rows(), result.rows()) << expression;
+    ASSERT_EQ(expected.cols(), result.cols()) << expression;
+    for (Eigen::Index i = 0; i < expected.size(); ++i) {
+      if (std::isnan(expected(i))) {
+        EXPECT_TRUE(std::isnan(result(i))) << expression;
+      } else {
+        EXPECT_NEAR(expected(i), result(i), 1e-4) << expression;
+      }
+    }
+  }
+}
+
+TEST(MathExpressionProgram, Properties) {  // NOLINT
+  MathExpressionProgram program;
+  ASSERT_TRUE(program.compile("0.5 * abs(a - b)", {"a", "b", "c"}));
+  EXPECT_TRUE(program.isElementwise());
+  EXPECT_FALSE(program.hasScalarResult());
+  EXPECT_EQ(std::vector<std::string>({"a", "b"}), program.getUsedVariables());
+
+  ASSERT_TRUE(program.compile("a - meanOfFinites(a)", {"a"}));
+  EXPECT_FALSE(program.isElementwise());
+  EXPECT_FALSE(program.hasScalarResult());
+
+  ASSERT_TRUE(program.compile("max(a) - min(a)", {"a"}));
+  EXPECT_TRUE(program.hasScalarResult());
+
+  // Matrix product.
+  ASSERT_TRUE(program.compile("a * a", {"a"}));
+  EXPECT_FALSE(program.isElementwise());
+}
+
+TEST(MathExpressionProgram, Unsupported) {  // NOLINT
+  MathExpressionProgram program;
+  EXPECT_FALSE(program.compile("sumOfFinites([0,1,0;1,-4,1;0,1,0].*a)", {"a"}));
+  EXPECT_FALSE(program.compile("a(1,1)", {"a"}));
+  EXPECT_FALSE(program.compile("transpose(a)", {"a"}));
+  EXPECT_FALSE(program.compile("b + 1", {"a"}));
+  EXPECT_FALSE(program.compile("a +", {"a"}));
+  EXPECT_FALSE(program.isCompiled());
+}
+
+TEST(MathExpressionProgram, WindowViews) {  // NOLINT
+  Matrix data = Matrix::Random(10, 8);
+  data(4, 4) = NAN;
+  MathExpressionProgram program;
+  ASSERT_TRUE(program.compile("sqrt(sumOfFinites(square(x - meanOfFinites(x))) ./ numberOfFinites(x))", {"x"}));
+
+  MathExpressionProgram::Workspace workspace;
+  for (Eigen::Index row = 0; row + 3 <= data.rows(); ++row) {
+    for (Eigen::Index col = 0; col + 3 <= data.cols(); ++col) {
+      const Matrix window = data.block(row, col, 3, 3);
+      const MathExpressionProgram::ConstMatrixView view(&data(row, col), 3, 3, Eigen::OuterStride<>(data.rows()));
+      float result;
+      ASSERT_TRUE(program.evaluateScalar({view}, workspace, result));
+      const float mean = window.meanOfFinites();
+      const float expected = std::sqrt((window.array() - mean).square().matrix().sumOfFinites() / window.numberOfFinites());
+      EXPECT_NEAR(expected, result, 1e-5);
+    }
+  }
+}
@@ -41,6 +41,10 @@ class GridMapOctomapConverter
    * Converts an Octomap to a grid map in the same coordinate frame, with a
    * cell resolution equal to the leaf voxel size in the Octomap. Only creates
    * a layer for elevation.
+   * The elevation of a cell is the highest occupied leaf voxel center above it.
+   * The tree is not copied: collapsed occupied nodes are not expanded but
+   * projected at their size, and the cells are filled in parallel tiles of
+   * rows (if OpenMP is available).
    * This changes the geometry of the grid map and deletes all layer contents.
    * Note: Bounding box coordinates are not checked for sanity - if you provide
    * values outside of the gridmap, undefined behavior may result.
@@ -10,6 +10,71 @@
 
 namespace grid_map {
 
+namespace {
+
+/*!
+ * Footprint (inclusive key ranges) and elevation of an occupied leaf node clipped to the bounding box.
+ */
+struct OccupiedColumn
+{
+  int xMin, xMax;
+  int yMin, yMax;
+  float z;
+};
+
+/*!
+ * Collects the occupied leaf nodes of the subtree intersecting the bounding box [minKey, maxKey].
+ * A collapsed node is emitted as a single column at its size, with the elevation of its top leaf voxel.
+ * @param[in] nodeKey minimum key of the node along x, y and z.
+ */
+void collectOccupiedColumns(const octomap::OcTree& octomap, const octomap::OcTreeNode* node, unsigned int depth,
+                            int nodeKeyX, int nodeKeyY, int nodeKeyZ,
+                            const octomap::OcTreeKey& minKey, const octomap::OcTreeKey& maxKey,
+                            std::vector<OccupiedColumn>& columns)
+{
+  const int size = 1 << (octomap.getTreeDepth() - depth);  // Node size in keys.
+  if (nodeKeyX > maxKey[0] || nodeKeyX + size - 1 < minKey[0] ||
+      nodeKeyY > maxKey[1] || nodeKeyY + size - 1 < minKey[1] ||
+      nodeKeyZ > maxKey[2] || nodeKeyZ + size - 1 < minKey[2]) {
+    return;
+  }
+
+#if OCTOMAP_VERSION_BEFORE_ROS_KINETIC
+  if (node->hasChildren()) {
+#else
+  if (octomap.nodeHasChildren(node)) {
+#endif
+    const int halfSize = size / 2;
+    for (unsigned int i = 0; i < 8; ++i) {
+#if OCTOMAP_VERSION_BEFORE_ROS_KINETIC
+      if (!node->childExists(i)) continue;
+      const octomap::OcTreeNode* child = node->getChild(i);
+#else
+      if (!octomap.nodeChildExists(node, i)) continue;
+      const octomap::OcTreeNode* child = octomap.getNodeChild(node, i);
+#endif
+      // Same child ordering as octomap::computeChildKey().
+      collectOccupiedColumns(octomap, child, depth + 1,
+                             nodeKeyX + ((i & 1) ? halfSize : 0),
+                             nodeKeyY + ((i & 2) ? halfSize : 0),
+                             nodeKeyZ + ((i & 4) ? halfSize : 0),
+                             minKey, maxKey, columns);
+    }
+    return;
+  }
+
+  if (!octomap.isNodeOccupied(node)) return;
+  OccupiedColumn column;
+  column.xMin = std::max(nodeKeyX, static_cast<int>(minKey[0]));
+  column.xMax = std::min(nodeKeyX + size - 1, static_cast<int>(maxKey[0]));
+  column.yMin = std::max(nodeKeyY, static_cast<int>(minKey[1]));
+  column.yMax = std::min(nodeKeyY + size - 1, static_cast<int>(maxKey[1]));
+  column.z = octomap.keyToCoord(static_cast<octomap::key_type>(std::min(nodeKeyZ + size - 1, static_cast<int>(maxKey[2]))));
+  columns.push_back(column);
+}
+
+} // namespace
+
 GridMapOctomapConverter::GridMapOctomapConverter()
 {
 }
@@ -29,39 +94,13 @@ bool GridMapOctomapConverter::fromOctomap(const octomap::OcTree& octomap,
     return false;
   }
 
-  // Copy octomap in order to expand any pruned occupied cells and maintain constness of input.
-  octomap::OcTree octomapCopy(octomap);
-
-  // Iterate through leaf nodes and project occupied cells to elevation map.
-  // On the first pass, expand all occupied cells that are not at maximum depth.
-  unsigned int max_depth = octomapCopy.getTreeDepth();
-  // Adapted from octomap octree2pointcloud.cpp.
-  std::vector<octomap::OcTreeNode*> collapsed_occ_nodes;
-  do {
-    collapsed_occ_nodes.clear();
-    for (octomap::OcTree::iterator it = octomapCopy.begin(); it != octomapCopy.end(); ++it) {
-      if (octomapCopy.isNodeOccupied(*it) && it.getDepth() < max_depth) {
-        collapsed_occ_nodes.push_back(&(*it));
-      }
-    }
-    for (std::vector<octomap::OcTreeNode*>::iterator it = collapsed_occ_nodes.begin();
-                                            it != collapsed_occ_nodes.end(); ++it) {
-      #if OCTOMAP_VERSION_BEFORE_ROS_KINETIC
-        (*it)->expandNode();
-      #else
-        octomapCopy.expandNode(*it);
-      #endif
-    }
-    // std::cout << "Expanded " << collapsed_occ_nodes.size() << " nodes" << std::endl;
-  } while (collapsed_occ_nodes.size() > 0);
-
   // Set up grid map geometry.
   // TODO Figure out whether to center map.
-  double resolution = octomapCopy.getResolution();
+  double resolution = octomap.getResolution();
   grid_map::Position3 minBound;
   grid_map::Position3 maxBound;
-  octomapCopy.getMetricMin(minBound(0), minBound(1), minBound(2));
-  octomapCopy.getMetricMax(maxBound(0), maxBound(1), maxBound(2));
+  octomap.getMetricMin(minBound(0), minBound(1), minBound(2));
+  octomap.getMetricMax(maxBound(0), maxBound(1), maxBound(2));
 
   // User can provide coordinate limits to only convert a bounding box.
   octomap::point3d minBbx(minBound(0), minBound(1), minBound(2));
@@ -88,25 +127,82 @@ bool GridMapOctomapConverter::fromOctomap(const octomap::OcTree& octomap,
   gridMap.add(layer);
   gridMap.setBasicLayers({layer});
 
-  // For each voxel, if its elevation is higher than the existing value for the
-  // corresponding grid map cell, overwrite it.
-  // std::cout << "Iterating from " << min_bbx << " to " << max_bbx << std::endl;
+  // Descend the tree and collect the occupied leaf nodes as columns, without expanding the collapsed ones.
+  octomap::OcTreeKey minKey;
+  octomap::OcTreeKey maxKey;
+  if (!octomap.coordToKeyChecked(minBbx, minKey) || !octomap.coordToKeyChecked(maxBbx, maxKey)) {
+    return true;  // Same as an empty bounding box iteration.
+  }
+  for (unsigned int i = 0; i < 3; ++i) {
+    if (minKey[i] > maxKey[i]) return true;
+  }
+  std::vector<OccupiedColumn> columns;
+  if (octomap.getRoot() != nullptr) {
+    collectOccupiedColumns(octomap, octomap.getRoot(), 0, 0, 0, 0, minKey, maxKey, columns);
+  }
+
+  // Grid map row (column) of each x (y) key of the bounding box, -1 if outside of the map.
+  // The rows depend only on x and the columns only on y.
+  const int numKeysX = static_cast<int>(maxKey[0]) - static_cast<int>(minKey[0]) + 1;
+  const int numKeysY = static_cast<int>(maxKey[1]) - static_cast<int>(minKey[1]) + 1;
+  std::vector<int> rowOfKey(numKeysX, -1);
+  std::vector<int> colOfKey(numKeysY, -1);
+  grid_map::Index index;
+  for (int i = 0; i < numKeysX; ++i) {
+    if (gridMap.getIndex(grid_map::Position(octomap.keyToCoord(minKey[0] + i), position.y()), index)) {
+      rowOfKey[i] = index(0);
+    }
+  }
+  for (int i = 0; i < numKeysY; ++i) {
+    if (gridMap.getIndex(grid_map::Position(position.x(), octomap.keyToCoord(minKey[1] + i)), index)) {
+      colOfKey[i] = index(1);
+    }
+  }
+
+  // The rows decrease with x and the keys outside of the map are at the ends of the range:
+  // the row range of a column is given by its first and last x key inside the map.
+  int validKeyXMin = 0;
+  int validKeyXMax = numKeysX - 1;
+  while (validKeyXMin <= validKeyXMax && rowOfKey[validKeyXMin] < 0) ++validKeyXMin;
+  while (validKeyXMax >= validKeyXMin && rowOfKey[validKeyXMax] < 0) --validKeyXMax;
+
+  // Assign the columns to tiles of grid map rows, a column goes to all the tiles its rows overlap.
+  const int tileRows = 32;
+  const int numTiles = (gridMap.getSize()(0) + tileRows - 1) / tileRows;
+  std::vector<std::vector<size_t>> tileColumns(numTiles);
+  for (size_t i = 0; i < columns.size(); ++i) {
+    const int xMin = std::max(columns[i].xMin - static_cast<int>(minKey[0]), validKeyXMin);
+    const int xMax = std::min(columns[i].xMax - static_cast<int>(minKey[0]), validKeyXMax);
+    if (xMin > xMax) continue;
+    const int rowMin = std::min(rowOfKey[xMin], rowOfKey[xMax]);
+    const int rowMax = std::max(rowOfKey[xMin], rowOfKey[xMax]);
+    for (int tile = rowMin / tileRows; tile <= rowMax / tileRows; ++tile) {
+      tileColumns[tile].push_back(i);
+    }
+  }
+
+  // For each column, if its elevation is higher than the existing value for the
+  // corresponding grid map cells, overwrite it. The tiles write disjoint rows.
   grid_map::Matrix& gridMapData = gridMap[layer];
-  for(octomap::OcTree::leaf_bbx_iterator it = octomapCopy.begin_leafs_bbx(minBbx, maxBbx),
-          end = octomapCopy.end_leafs_bbx(); it != end; ++it) {
-    if (octomapCopy.isNodeOccupied(*it)) {
-      octomap::point3d octoPos = it.getCoordinate();
-      grid_map::Position position(octoPos.x(), octoPos.y());
-      grid_map::Index index;
-      gridMap.getIndex(position, index);
-      // If no elevation has been set, use current elevation.
-      if (!gridMap.isValid(index)) {
-        gridMapData(index(0), index(1)) = octoPos.z();
-      }
-      // Check existing elevation, keep higher.
-      else {
-        if (gridMapData(index(0), index(1)) < octoPos.z()) {
-          gridMapData(index(0), index(1)) = octoPos.z();
+#ifdef GRID_MAP_OCTOMAP_OPENMP_FOUND
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (int tile = 0; tile < numTiles; ++tile) {
+    const int rowBegin = tile * tileRows;
+    const int rowEnd = rowBegin + tileRows;
+    for (const size_t i : tileColumns[tile]) {
+      const OccupiedColumn& column = columns[i];
+      for (int x = column.xMin; x <= column.xMax; ++x) {
+        const int row = rowOfKey[x - minKey[0]];
+        if (row < rowBegin || row >= rowEnd) continue;
+        for (int y = column.yMin; y <= column.yMax; ++y) {
+          const int col = colOfKey[y - minKey[1]];
+          if (col < 0) continue;
+          float& elevation = gridMapData(row, col);
+          // If no elevation has been set, use current elevation, otherwise keep higher.
+          if (std::isnan(elevation) || elevation < column.z) {
+            elevation = column.z;
+          }
         }
       }
     }
@@ -91,3 +91,35 @@ TEST(OctomapConversion, convertOctomapToGridMapWithBoundingBox)
   EXPECT_FLOAT_EQ(octomap.getResolution(), gridmap.getResolution());
   EXPECT_FLOAT_EQ(0.5 * octomap.getResolution(), gridmap.atPosition("elevation", Position(1.0, 1.0)));
 }
+
+TEST(OctomapConversion, convertOctomapWithCollapsedNodesToGridMap)
+{
+  // Generate Octomap (a pruned 0.4m occupied cube with a free voxel above it)
+  octomap::OcTree octomap(0.05);
+  for (double x = 0.025; x < 0.4; x += 0.05) {
+    for (double y = 0.025; y < 0.4; y += 0.05) {
+      for (double z = 0.025; z < 0.4; z += 0.05) {
+        octomap.updateNode(octomap::point3d(x, y, z), true);
+      }
+    }
+  }
+  octomap.updateNode(octomap::point3d(0.125, 0.125, 1.025), false);
+  octomap.prune();
+
+  // Convert to grid map.
+  GridMap gridMap;
+  ASSERT_TRUE(GridMapOctomapConverter::fromOctomap(octomap, "elevation", gridMap));
+  EXPECT_FLOAT_EQ(octomap.getResolution(), gridMap.getResolution());
+  for (double x = 0.025; x < 0.4; x += 0.05) {
+    for (double y = 0.025; y < 0.4; y += 0.05) {
+      EXPECT_NEAR(0.375, gridMap.atPosition("elevation", Position(x, y)), 1e-4);
+    }
+  }
+
+  // Bounding box cutting through the collapsed node.
+  grid_map::Position3 minpt(0.1, 0.1, 0.0);
+  grid_map::Position3 maxpt(0.3, 0.3, 0.19);
+  ASSERT_TRUE(GridMapOctomapConverter::fromOctomap(octomap, "elevation", gridMap, &minpt, &maxpt));
+  EXPECT_FLOAT_EQ(0.2, gridMap.getLength().x());
+  EXPECT_NEAR(0.175, gridMap.atPosition("elevation", Position(0.175, 0.175)), 1e-4);
+}
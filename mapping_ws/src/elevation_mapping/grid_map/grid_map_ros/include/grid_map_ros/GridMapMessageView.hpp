@@ -0,0 +1,179 @@
+/*
+ * GridMapMessageView.hpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: Luigi Freda
+ */
+
+#pragma once
+
+#include <grid_map_core/GridMap.hpp>
+#include <grid_map_msgs/GridMap.h>
+#include <grid_map_msgs/GridMapInfo.h>
+#include <std_msgs/MultiArrayLayout.h>
+
+#include "grid_map_ros/GridMapMsgHelpers.hpp"
+
+// ROS
+#include <ros/message_traits.h>
+#include <ros/serialization.h>
+
+// STL
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace grid_map {
+
+/*!
+ * Publish-only counterpart of a grid_map_msgs::GridMap message holding a grid map.
+ * The layers are serialized directly from the matrix storage of the grid map, without
+ * building the std_msgs::Float32MultiArray data of an intermediate message. The circular
+ * buffer is sent as it is (outer/inner start index), as GridMapRosConverter::toMessage() does.
+ *
+ * It has the wire format, MD5 sum and data type of grid_map_msgs::GridMap, so it can be published
+ * on a grid_map_msgs::GridMap topic and subscribers receive a regular grid_map_msgs::GridMap:
+ *
+ *   publisher.publish(boost::make_shared<GridMapMessageView>(std::move(gridMap)));
+ *
+ * Publish it through a shared pointer: roscpp then serializes it once for all the connections
+ * (subscribers in the same process with the grid_map_msgs::GridMap type get a deserialized copy).
+ */
+class GridMapMessageView {
+ public:
+  /*!
+   * Constructor, all the layers of the grid map are published.
+   * @param[in] gridMap the grid map (move it in to avoid a copy).
+   */
+  explicit GridMapMessageView(GridMap gridMap) : gridMap_(std::move(gridMap)), layers_(gridMap_.getLayers()) {}
+
+  /*!
+   * Constructor.
+   * @param[in] gridMap the grid map (move it in to avoid a copy).
+   * @param[in] layers the layers to be published.
+   */
+  GridMapMessageView(GridMap gridMap, std::vector<std::string> layers) : gridMap_(std::move(gridMap)), layers_(std::move(layers)) {}
+
+  const GridMap& getGridMap() const { return gridMap_; }
+
+  const std::vector<std::string>& getLayers() const { return layers_; }
+
+  /*!
+   * Gets the info (header and geometry) of the grid map message.
+   * @param[out] info the info message.
+   */
+  void getInfo(grid_map_msgs::GridMapInfo& info) const
+  {
+    info.header.stamp.fromNSec(gridMap_.getTimestamp());
+    info.header.frame_id = gridMap_.getFrameId();
+    info.resolution = gridMap_.getResolution();
+    info.length_x = gridMap_.getLength().x();
+    info.length_y = gridMap_.getLength().y();
+    info.pose.position.x = gridMap_.getPosition().x();
+    info.pose.position.y = gridMap_.getPosition().y();
+    info.pose.position.z = 0.0;
+    info.pose.orientation.x = 0.0;
+    info.pose.orientation.y = 0.0;
+    info.pose.orientation.z = 0.0;
+    info.pose.orientation.w = 1.0;
+  }
+
+ private:
+  //! The grid map to be published.
+  GridMap gridMap_;
+
+  //! The layers to be published.
+  std::vector<std::string> layers_;
+};
+
+} /* namespace */
+
+namespace ros {
+namespace message_traits {
+
+template<>
+struct MD5Sum<grid_map::GridMapMessageView>
+{
+  static const char* value() { return MD5Sum<grid_map_msgs::GridMap>::value(); }
+  static const char* value(const grid_map::GridMapMessageView&) { return value(); }
+};
+
+template<>
+struct DataType<grid_map::GridMapMessageView>
+{
+  static const char* value() { return DataType<grid_map_msgs::GridMap>::value(); }
+  static const char* value(const grid_map::GridMapMessageView&) { return value(); }
+};
+
+template<>
+struct Definition<grid_map::GridMapMessageView>
+{
+  static const char* value() { return Definition<grid_map_msgs::GridMap>::value(); }
+  static const char* value(const grid_map::GridMapMessageView&) { return value(); }
+};
+
+} /* namespace message_traits */
+
+namespace serialization {
+
+/*!
+ * Serializer of GridMapMessageView, with the field order of grid_map_msgs::GridMap.
+ * There is no read(): subscribers deserialize a grid_map_msgs::GridMap.
+ */
+template<>
+struct Serializer<grid_map::GridMapMessageView>
+{
+  template<typename Stream>
+  inline static void write(Stream& stream, const grid_map::GridMapMessageView& view)
+  {
+    const grid_map::GridMap& gridMap = view.getGridMap();
+    grid_map_msgs::GridMapInfo info;
+    view.getInfo(info);
+    stream.next(info);
+    stream.next(view.getLayers());
+    stream.next(gridMap.getBasicLayers());
+
+    stream.next(static_cast<uint32_t>(view.getLayers().size()));
+    std_msgs::MultiArrayLayout layout;
+    for (const auto& layer : view.getLayers()) {
+      const grid_map::Matrix& data = gridMap.get(layer);
+      grid_map::matrixEigenToMultiArrayLayout(data, layout);
+      stream.next(layout);
+      const uint32_t size = static_cast<uint32_t>(data.size());
+      stream.next(size);
+      if (size > 0) {
+        const uint32_t dataLength = size * sizeof(grid_map::DataType);
+        std::memcpy(stream.advance(dataLength), data.data(), dataLength);
+      }
+    }
+
+    stream.next(static_cast<uint16_t>(gridMap.getStartIndex()(0)));
+    stream.next(static_cast<uint16_t>(gridMap.getStartIndex()(1)));
+  }
+
+  inline static uint32_t serializedLength(const grid_map::GridMapMessageView& view)
+  {
+    const grid_map::GridMap& gridMap = view.getGridMap();
+    grid_map_msgs::GridMapInfo info;
+    view.getInfo(info);
+    uint32_t length = serializationLength(info);
+    length += serializationLength(view.getLayers());
+    length += serializationLength(gridMap.getBasicLayers());
+
+    length += 4;  // Number of data arrays.
+    std_msgs::MultiArrayLayout layout;
+    for (const auto& layer : view.getLayers()) {
+      const grid_map::Matrix& data = gridMap.get(layer);
+      grid_map::matrixEigenToMultiArrayLayout(data, layout);
+      length += serializationLength(layout);
+      length += 4 + static_cast<uint32_t>(data.size()) * sizeof(grid_map::DataType);
+    }
+
+    length += 2 * 2;  // Outer and inner start indices.
+    return length;
+  }
+};
+
+} /* namespace serialization */
+} /* namespace ros */
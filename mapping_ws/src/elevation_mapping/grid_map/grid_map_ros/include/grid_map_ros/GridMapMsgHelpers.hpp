@@ -74,6 +74,32 @@ unsigned int getRows(const MultiArrayMessageType_& message)
   return message.layout.dim.at(1).size;
 }
 
+/*!
+ * Sets the layout of a ROS MultiArray message for an Eigen matrix.
+ * Both column- and row-major matrices are allowed, and the type
+ * will be marked in the layout labels.
+ * @tparam EigenType_ an Eigen matrix.
+ * @param[in] e the Eigen matrix to be described.
+ * @param[out] layout the layout of the ROS message.
+ */
+template<typename EigenType_>
+void matrixEigenToMultiArrayLayout(const EigenType_& e, std_msgs::MultiArrayLayout& layout)
+{
+  layout.dim.resize(nDimensions());
+  layout.dim[0].stride = e.size();
+  layout.dim[0].size = e.outerSize();
+  layout.dim[1].stride = e.innerSize();
+  layout.dim[1].size = e.innerSize();
+
+  if (e.IsRowMajor) {
+    layout.dim[0].label = storageIndexNames[StorageIndices::Row];
+    layout.dim[1].label = storageIndexNames[StorageIndices::Column];
+  } else {
+    layout.dim[0].label = storageIndexNames[StorageIndices::Column];
+    layout.dim[1].label = storageIndexNames[StorageIndices::Row];
+  }
+}
+
 /*!
  * Copies an Eigen matrix into a ROS MultiArray message.
  * Both column- and row-major matrices are allowed, and the type
@@ -87,20 +113,7 @@ unsigned int getRows(const MultiArrayMessageType_& message)
 template<typename EigenType_, typename MultiArrayMessageType_>
 bool matrixEigenCopyToMultiArrayMessage(const EigenType_& e, MultiArrayMessageType_& m)
 {
-  m.layout.dim.resize(nDimensions());
-  m.layout.dim[0].stride = e.size();
-  m.layout.dim[0].size = e.outerSize();
-  m.layout.dim[1].stride = e.innerSize();
-  m.layout.dim[1].size = e.innerSize();
-
-  if (e.IsRowMajor) {
-    m.layout.dim[0].label = storageIndexNames[StorageIndices::Row];
-    m.layout.dim[1].label = storageIndexNames[StorageIndices::Column];
-  } else {
-    m.layout.dim[0].label = storageIndexNames[StorageIndices::Column];
-    m.layout.dim[1].label = storageIndexNames[StorageIndices::Row];
-  }
-
+  matrixEigenToMultiArrayLayout(e, m.layout);
   m.data.insert(m.data.begin() + m.layout.data_offset, e.data(), e.data() + e.size());
   return true;
 }
@@ -121,9 +134,8 @@ bool multiArrayMessageCopyToMatrixEigen(const MultiArrayMessageType_& m, EigenTy
     return false;
   }
 
-  EigenType_ tempE(getRows(m), getCols(m));
-  tempE = Eigen::Map<const EigenType_>(m.data.data(), getRows(m), getCols(m));
-  e = tempE;
+  // The map cannot alias e, so the data is copied directly (e is resized by the assignment).
+  e = Eigen::Map<const EigenType_>(m.data.data(), getRows(m), getCols(m));
   return true;
 }
 
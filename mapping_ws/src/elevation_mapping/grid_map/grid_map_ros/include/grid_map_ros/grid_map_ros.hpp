@@ -13,3 +13,4 @@
 #include <grid_map_ros/GridMapRosConverter.hpp>
 #include <grid_map_ros/PolygonRosConverter.hpp>
 #include <grid_map_ros/GridMapMsgHelpers.hpp>
+#include <grid_map_ros/GridMapMessageView.hpp>
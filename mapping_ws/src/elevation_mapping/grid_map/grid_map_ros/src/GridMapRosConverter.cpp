@@ -55,14 +55,14 @@ bool GridMapRosConverter::fromMessage(const grid_map_msgs::GridMap& message, gri
       continue;
     }
 
-    // TODO Could we use the data mapping (instead of copying) method here?
+    // The message is const, so its data has to be copied once (directly into the matrix that is moved into the map).
     Matrix data;
     if(!multiArrayMessageCopyToMatrixEigen(message.data[i], data)) {
       return false;
     }
 
     // TODO Check if size is good.   size_ << getRows(message.data[0]), getCols(message.data[0]);
-    gridMap.add(message.layers[i], data);
+    gridMap.add(message.layers[i], std::move(data));
   }
 
   // Copy basic layers.
@@ -103,11 +103,11 @@ void GridMapRosConverter::toMessage(const grid_map::GridMap& gridMap, const std:
   message.layers = layers;
   message.basic_layers = gridMap.getBasicLayers();
 
+  // Copy each layer directly into its (empty) array of the message.
   message.data.clear();
-  for (const auto& layer : layers) {
-    std_msgs::Float32MultiArray dataArray;
-    matrixEigenCopyToMultiArrayMessage(gridMap.get(layer), dataArray);
-    message.data.push_back(dataArray);
+  message.data.resize(layers.size());
+  for (size_t i = 0; i < layers.size(); ++i) {
+    matrixEigenCopyToMultiArrayMessage(gridMap.get(layers[i]), message.data[i]);
   }
 
   message.outer_start_index = gridMap.getStartIndex()(0);
@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <limits>
 #include <vector>
 
 #include <Eigen/Dense>
@@ -30,6 +31,9 @@ namespace grid_map {
  * The distance value and derivatives (dx,dy,dz) per voxel are stored next to each other in memory to support fast lookup during
  * interpolation, where we need all 4 values simultaneously. The entire dense grid is stored as a flat vector, with the indexing outsourced
  * to the Gridmap3dLookup class.
+ *
+ * With a finite maxDistance the signed distance is truncated to [-maxDistance, maxDistance]. A change of the elevation then only affects
+ * the cells within maxDistance of it, which lets update() recompute only a band around the changed cells instead of the whole grid.
  */
 class SignedDistanceField {
  public:
@@ -43,8 +47,21 @@ class SignedDistanceField {
    * @param elevationLayer : Name of the elevation layer.
    * @param minHeight : Desired starting height of the 3D SDF grid.
    * @param maxHeight : Desired ending height of the 3D SDF grid. (Will be rounded up to match the resolution)
+   * @param maxDistance : The signed distance is truncated to [-maxDistance, maxDistance]. (Infinite by default: no truncation)
+   */
+  SignedDistanceField(const GridMap& gridMap, const std::string& elevationLayer, double minHeight, double maxHeight,
+                      double maxDistance = std::numeric_limits<double>::infinity());
+
+  /**
+   * Update the signed distance field and its derivative for a new elevation layer with the same XY geometry.
+   * Only the bounding box of the cells with a changed elevation, extended by the band of maxDistance (+1 cell for the derivatives),
+   * is recomputed. The height range of the 3D grid is kept.
+   *
+   * @param gridMap : Input map with the same size, resolution and position as the one the SDF was created for.
+   * @param elevationLayer : Name of the elevation layer.
+   * @return false if the geometry of the map differs (nothing is updated, the SDF has to be created again).
    */
-  SignedDistanceField(const GridMap& gridMap, const std::string& elevationLayer, double minHeight, double maxHeight);
+  bool update(const GridMap& gridMap, const std::string& elevationLayer);
 
   /**
    * Get the signed distance value at a 3D position.
@@ -67,12 +84,24 @@ class SignedDistanceField {
    */
   std::pair<double, Derivative3> valueAndDerivative(const Position3& position) const noexcept;
 
+  /**
+   * Get the signed distance values and derivatives at a batch of 3D positions, e.g. all the query points of a planner iteration.
+   * The derivatives are looked up in the precomputed grid, like for single queries.
+   * @param positions : 3D positions in the frame of the gridmap.
+   * @param values [out] : signed distance values (resized to the number of positions).
+   * @param derivatives [out] : derivatives of the signed distance field (resized to the number of positions).
+   */
+  void valuesAndDerivatives(const std::vector<Position3>& positions, std::vector<double>& values,
+                            std::vector<Derivative3>& derivatives) const;
+
   size_t size() const noexcept;
 
   const std::string& getFrameId() const noexcept;
 
   Time getTime() const noexcept;
 
+  double getMaxDistance() const noexcept { return maxDistance_; }
+
   /**
    * Calls a function on each point in the signed distance field. The points are processed in the order they are stored in memory.
    * @param func : function taking the node position, signed distance value, and signed distance derivative.
@@ -83,9 +112,18 @@ class SignedDistanceField {
  private:
   /**
    * Implementation of the signed distance field computation in this class.
-   * @param elevation
+   * Recomputes the values and derivatives of the cells of a block of the elevation map (for all heights), from the elevation
+   * data of that block extended by the band of maxDistance (+1 cell for the finite differences).
+   * @param updateStart : first (row, col) of the block.
+   * @param updateSize : size of the block.
    */
-  void computeSignedDistance(const Matrix& elevation);
+  void computeSignedDistance(const Index& updateStart, const Size& updateSize);
+
+  /**
+   * Number of cells around a cell within which an elevation change can affect its (truncated) signed distance.
+   * Bounded by the size of the map.
+   */
+  Eigen::Index getBandCells() const;
 
   /**
    * Simultaneously compute the signed distance and derivative in x direction at a given height
@@ -104,14 +142,18 @@ class SignedDistanceField {
                                 Matrix& tmpTranspose, float height, float resolution, float minHeight, float maxHeight) const;
 
   /**
-   * Add the computed signed distance values and derivatives at a particular height to the grid.
-   * Adds the layer to the back of data_
-   * @param signedDistance : signed distance values.
+   * Write the computed signed distance values and derivatives of a block at a particular height to the grid.
+   * @param layerZ : index of the height.
+   * @param signedDistance : signed distance values of the window the block was computed in.
    * @param dxTranspose : x components of the derivative (matrix is transposed).
    * @param dy : y components of the derivative.
    * @param dz : z components of the derivative.
+   * @param windowStart : first (row, col) of the window in the map.
+   * @param updateStart : first (row, col) of the block in the map.
+   * @param updateSize : size of the block.
    */
-  void emplacebackLayerData(const Matrix& signedDistance, const Matrix& dxTranspose, const Matrix& dy, const Matrix& dz);
+  void writeLayerData(size_t layerZ, const Matrix& signedDistance, const Matrix& dxTranspose, const Matrix& dy, const Matrix& dz,
+                      const Index& windowStart, const Index& updateStart, const Size& updateSize);
 
   //! Data structure to store together {signed distance value, derivative}.
   using node_data_t = std::array<float, 4>;
@@ -136,6 +178,12 @@ class SignedDistanceField {
 
   //! Timestamp of the grid map (nanoseconds).
   Time timestamp_;
+
+  //! Elevation data the signed distance was computed for, to find the changed cells in update().
+  Matrix elevation_;
+
+  //! Truncation distance of the signed distance.
+  double maxDistance_;
 };
 
 }  // namespace grid_map
\ No newline at end of file
@@ -8,6 +8,8 @@
 
 #include "grid_map_sdf/SignedDistanceField.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 #include "grid_map_sdf/DistanceDerivatives.hpp"
@@ -22,9 +24,11 @@ using signed_distance_field::layerCentralDifference;
 using signed_distance_field::layerFiniteDifference;
 using signed_distance_field::signedDistanceAtHeightTranspose;
 
-SignedDistanceField::SignedDistanceField(const GridMap& gridMap, const std::string& elevationLayer, double minHeight, double maxHeight)
-    : frameId_(gridMap.getFrameId()), timestamp_(gridMap.getTimestamp()) {
+SignedDistanceField::SignedDistanceField(const GridMap& gridMap, const std::string& elevationLayer, double minHeight, double maxHeight,
+                                         double maxDistance)
+    : frameId_(gridMap.getFrameId()), timestamp_(gridMap.getTimestamp()), maxDistance_(maxDistance) {
   assert(maxHeight >= minHeight);
+  assert(maxDistance > 0.0);
 
   // Determine origin of the 3D grid
   Position mapOriginXY;
@@ -41,9 +45,34 @@ SignedDistanceField::SignedDistanceField(const GridMap& gridMap, const std::stri
   gridmap3DLookup_ = Gridmap3dLookup(gridsize, gridOrigin, gridMap.getResolution());
 
   // Allocate the internal data structure
-  data_.reserve(gridmap3DLookup_.linearSize());
+  data_.resize(gridmap3DLookup_.linearSize());
 
   // Check for NaN
+  elevation_ = gridMap.get(elevationLayer);
+  if (elevation_.hasNaN()) {
+    std::cerr
+        << "[grid_map_sdf::SignedDistanceField] elevation data contains NaN. The generated SDF will be invalid! Apply inpainting first"
+        << std::endl;
+  }
+
+  // Compute the SDF
+  computeSignedDistance(Index(0, 0), Size(elevation_.rows(), elevation_.cols()));
+}
+
+bool SignedDistanceField::update(const GridMap& gridMap, const std::string& elevationLayer) {
+  // The XY geometry has to match, the height range is kept.
+  Position mapOriginXY;
+  gridMap.getPosition(Eigen::Vector2i(0, 0), mapOriginXY);
+  const double resolution = gridmap3DLookup_.resolution_;
+  if (static_cast<size_t>(gridMap.getSize().x()) != gridmap3DLookup_.gridsize_.x ||
+      static_cast<size_t>(gridMap.getSize().y()) != gridmap3DLookup_.gridsize_.y || std::abs(gridMap.getResolution() - resolution) > 1e-9 ||
+      (mapOriginXY - gridmap3DLookup_.gridOrigin_.head<2>()).norm() > 1e-6 * resolution) {
+    return false;
+  }
+
+  frameId_ = gridMap.getFrameId();
+  timestamp_ = gridMap.getTimestamp();
+
   const auto& elevationData = gridMap.get(elevationLayer);
   if (elevationData.hasNaN()) {
     std::cerr
@@ -51,8 +80,37 @@ SignedDistanceField::SignedDistanceField(const GridMap& gridMap, const std::stri
         << std::endl;
   }
 
-  // Compute the SDF
-  computeSignedDistance(elevationData);
+  // Bounding box of the changed cells (NaN cells always count as changed).
+  const Eigen::Array<bool, Eigen::Dynamic, Eigen::Dynamic> changed = elevationData.array() != elevation_.array();
+  const Eigen::Array<bool, Eigen::Dynamic, 1> changedRows = changed.rowwise().any();
+  const Eigen::Array<bool, 1, Eigen::Dynamic> changedCols = changed.colwise().any();
+  if (!changedRows.any()) {
+    return true;
+  }
+  Eigen::Index firstRow = 0;
+  while (!changedRows(firstRow)) {
+    ++firstRow;
+  }
+  Eigen::Index lastRow = changedRows.size() - 1;
+  while (!changedRows(lastRow)) {
+    --lastRow;
+  }
+  Eigen::Index firstCol = 0;
+  while (!changedCols(firstCol)) {
+    ++firstCol;
+  }
+  Eigen::Index lastCol = changedCols.size() - 1;
+  while (!changedCols(lastCol)) {
+    --lastCol;
+  }
+  elevation_ = elevationData;
+
+  // The values change within the band around the changed cells, the derivatives one cell further.
+  const Eigen::Index band = getBandCells() + 1;
+  const Index updateStart(std::max<Eigen::Index>(firstRow - band, 0), std::max<Eigen::Index>(firstCol - band, 0));
+  const Index updateEnd(std::min<Eigen::Index>(lastRow + band, elevation_.rows() - 1), std::min<Eigen::Index>(lastCol + band, elevation_.cols() - 1));
+  computeSignedDistance(updateStart, updateEnd - updateStart + 1);
+  return true;
 }
 
 double SignedDistanceField::value(const Position3& position) const noexcept {
@@ -77,9 +135,34 @@ std::pair<double, SignedDistanceField::Derivative3> SignedDistanceField::valueAn
   return {distance(nodeData) + jacobian.dot(position - nodePosition), jacobian};
 }
 
-void SignedDistanceField::computeSignedDistance(const Matrix& elevation) {
+void SignedDistanceField::valuesAndDerivatives(const std::vector<Position3>& positions, std::vector<double>& values,
+                                               std::vector<Derivative3>& derivatives) const {
+  values.resize(positions.size());
+  derivatives.resize(positions.size());
+  for (size_t i = 0; i < positions.size(); ++i) {
+    const auto nodeIndex = gridmap3DLookup_.nearestNode(positions[i]);
+    const auto& nodeData = data_[gridmap3DLookup_.linearIndex(nodeIndex)];
+    derivatives[i] = derivative(nodeData);
+    values[i] = distance(nodeData) + derivatives[i].dot(positions[i] - gridmap3DLookup_.nodePosition(nodeIndex));
+  }
+}
+
+Eigen::Index SignedDistanceField::getBandCells() const {
+  // A cell further than the band from a changed cell is more than (band + 0.5) cells away from its border, so more than maxDistance.
+  const auto maxCells = static_cast<double>(std::max(gridmap3DLookup_.gridsize_.x, gridmap3DLookup_.gridsize_.y));
+  return static_cast<Eigen::Index>(std::min(std::ceil(maxDistance_ / gridmap3DLookup_.resolution_), maxCells));
+}
+
+void SignedDistanceField::computeSignedDistance(const Index& updateStart, const Size& updateSize) {
   const auto gridOriginZ = static_cast<float>(gridmap3DLookup_.gridOrigin_.z());
   const auto resolution = static_cast<float>(gridmap3DLookup_.resolution_);
+
+  // Window of the elevation data that determines the values of the block and of its neighbors (for the finite differences).
+  const int band = static_cast<int>(getBandCells()) + 1;
+  const Index windowStart = (updateStart - band).max(0);
+  const Index windowEnd = (updateStart + updateSize - 1 + band).min(Index(elevation_.rows() - 1, elevation_.cols() - 1));
+  const Size windowSize = windowEnd - windowStart + 1;
+  const Matrix elevation = elevation_.block(windowStart(0), windowStart(1), windowSize(0), windowSize(1));
   const auto minHeight = elevation.minCoeff();
   const auto maxHeight = elevation.maxCoeff();
 
@@ -120,7 +203,7 @@ void SignedDistanceField::computeSignedDistance(const Matrix& elevation) {
   layerFiniteDifference(currentLayer, nextLayer, dz, resolution);  // dz / layer = +resolution
   columnwiseCentralDifference(currentLayer, dy, -resolution);      // dy / dcol = -resolution
 
-  emplacebackLayerData(currentLayer, dxTranspose, dy, dz);
+  writeLayerData(0, currentLayer, dxTranspose, dy, dz, windowStart, updateStart, updateSize);
 
   // Middle layers: central difference in z
   for (size_t layerZ = 1; layerZ + 1 < gridmap3DLookup_.gridsize_.z; ++layerZ) {
@@ -138,7 +221,7 @@ void SignedDistanceField::computeSignedDistance(const Matrix& elevation) {
     columnwiseCentralDifference(currentLayer, dy, -resolution);
 
     // Add the data to the 3D structure
-    emplacebackLayerData(currentLayer, dxTranspose, dy, dz);
+    writeLayerData(layerZ, currentLayer, dxTranspose, dy, dz, windowStart, updateStart, updateSize);
   }
 
   // Circulate layer buffers one last time
@@ -151,22 +234,29 @@ void SignedDistanceField::computeSignedDistance(const Matrix& elevation) {
   columnwiseCentralDifference(currentLayer, dy, -resolution);
 
   // Add the data to the 3D structure
-  emplacebackLayerData(currentLayer, dxTranspose, dy, dz);
+  writeLayerData(gridmap3DLookup_.gridsize_.z - 1, currentLayer, dxTranspose, dy, dz, windowStart, updateStart, updateSize);
 }
 void SignedDistanceField::computeLayerSdfandDeltaX(const Matrix& elevation, Matrix& currentLayer, Matrix& dxTranspose, Matrix& sdfTranspose,
                                                    Matrix& tmp, Matrix& tmpTranspose, float height, float resolution, float minHeight,
                                                    float maxHeight) const {
   // Compute SDF + dx of layer: compute sdfTranspose -> take dxTranspose -> transpose to get sdf
   signedDistanceAtHeightTranspose(elevation, sdfTranspose, tmp, tmpTranspose, height, resolution, minHeight, maxHeight);
+  if (std::isfinite(maxDistance_)) {
+    const auto maxDistance = static_cast<float>(maxDistance_);
+    sdfTranspose = sdfTranspose.cwiseMax(-maxDistance).cwiseMin(maxDistance);
+  }
   columnwiseCentralDifference(sdfTranspose, dxTranspose, -resolution);  // dx / drow = -resolution
   currentLayer = sdfTranspose.transpose();
 }
 
-void SignedDistanceField::emplacebackLayerData(const Matrix& signedDistance, const Matrix& dxTranspose, const Matrix& dy,
-                                               const Matrix& dz) {
-  for (size_t colY = 0; colY < gridmap3DLookup_.gridsize_.y; ++colY) {
-    for (size_t rowX = 0; rowX < gridmap3DLookup_.gridsize_.x; ++rowX) {
-      data_.emplace_back(node_data_t{signedDistance(rowX, colY), dxTranspose(colY, rowX), dy(rowX, colY), dz(rowX, colY)});
+void SignedDistanceField::writeLayerData(size_t layerZ, const Matrix& signedDistance, const Matrix& dxTranspose, const Matrix& dy,
+                                         const Matrix& dz, const Index& windowStart, const Index& updateStart, const Size& updateSize) {
+  for (Eigen::Index colY = updateStart(1); colY < updateStart(1) + updateSize(1); ++colY) {
+    const Eigen::Index j = colY - windowStart(1);
+    auto index = gridmap3DLookup_.linearIndex({static_cast<size_t>(updateStart(0)), static_cast<size_t>(colY), layerZ});
+    for (Eigen::Index rowX = updateStart(0); rowX < updateStart(0) + updateSize(0); ++rowX, ++index) {
+      const Eigen::Index i = rowX - windowStart(0);
+      data_[index] = node_data_t{signedDistance(i, j), dxTranspose(j, i), dy(i, j), dz(i, j)};
     }
   }
 }
@@ -190,4 +190,56 @@ TEST(testSignedDistance3d, extrapolation) {
       }
     }
   }
-}
\ No newline at end of file
+}
+TEST(testSignedDistance3d, incrementalUpdate) {
+  const int n = 30;
+  const int m = 40;
+  const float resolution = 0.1;
+  const double maxDistance = 0.35;
+  GridMap map;
+  map.setGeometry({n * resolution, m * resolution}, resolution);
+  map.add("elevation");
+  map.get("elevation").setRandom();  // random [-1.0, 1.0]
+  const float minHeight = -1.0;
+  const float maxHeight = 1.0;
+
+  SignedDistanceField sdf(map, "elevation", minHeight, maxHeight, maxDistance);
+
+  // Change a small patch of the terrain.
+  map.get("elevation").block(12, 20, 3, 2).setConstant(0.8);
+  ASSERT_TRUE(sdf.update(map, "elevation"));
+  const SignedDistanceField sdfCheck(map, "elevation", minHeight, maxHeight, maxDistance);
+
+  std::vector<Position3> positions;
+  for (float height = minHeight; height < maxHeight; height += resolution) {
+    for (int i = 0; i < n; ++i) {
+      for (int j = 0; j < m; ++j) {
+        Position position2d;
+        map.getPosition({i, j}, position2d);
+        positions.emplace_back(position2d.x(), position2d.y(), height);
+
+        const auto sdfValueAndDerivative = sdf.valueAndDerivative(positions.back());
+        const auto sdfCheckValueAndDerivative = sdfCheck.valueAndDerivative(positions.back());
+        ASSERT_LE(std::abs(sdfValueAndDerivative.first), maxDistance + 1e-6);
+        ASSERT_LT(std::abs(sdfValueAndDerivative.first - sdfCheckValueAndDerivative.first), 1e-5);
+        ASSERT_LT((sdfValueAndDerivative.second - sdfCheckValueAndDerivative.second).norm(), 1e-4);
+      }
+    }
+  }
+
+  // Batch queries give the same result as single queries.
+  std::vector<double> values;
+  std::vector<SignedDistanceField::Derivative3> derivatives;
+  sdf.valuesAndDerivatives(positions, values, derivatives);
+  ASSERT_EQ(values.size(), positions.size());
+  for (size_t i = 0; i < positions.size(); ++i) {
+    const auto sdfValueAndDerivative = sdf.valueAndDerivative(positions[i]);
+    ASSERT_DOUBLE_EQ(values[i], sdfValueAndDerivative.first);
+    ASSERT_TRUE(derivatives[i].isApprox(sdfValueAndDerivative.second));
+  }
+
+  // A different geometry is rejected.
+  map.setGeometry({n * resolution, (m + 2) * resolution}, resolution);
+  map.add("elevation", 0.0);
+  ASSERT_FALSE(sdf.update(map, "elevation"));
+}
@@ -188,6 +188,22 @@ QuatTransformationTemplate<Scalar>::transformVectorized(
   return q_A_B_.rotateVectorized(rhs).colwise() + A_t_A_B_;
 }
 
+template<typename Scalar>
+template<typename DerivedIn, typename DerivedOut>
+void QuatTransformationTemplate<Scalar>::transformVectorized(
+    const Eigen::MatrixBase<DerivedIn>& rhs,
+    Eigen::MatrixBase<DerivedOut>* out) const {
+  CHECK_NOTNULL(out);
+  CHECK_EQ(rhs.rows(), 3);
+  CHECK_EQ(out->rows(), 3);
+  CHECK_EQ(rhs.cols(), out->cols());
+  const RotationMatrix R_A_B = q_A_B_.getRotationMatrix();
+  // Not noalias(): out may be a map over the same points as rhs, the product
+  // is evaluated into a temporary.
+  *out = R_A_B * rhs;
+  out->colwise() += A_t_A_B_;
+}
+
 template<typename Scalar>
 typename QuatTransformationTemplate<Scalar>::Vector3
 QuatTransformationTemplate<Scalar>::operator*(
@@ -213,6 +229,14 @@ QuatTransformationTemplate<Scalar>::inverseTransform(
   return q_A_B_.inverseRotate(rhs - A_t_A_B_);
 }
 
+template<typename Scalar>
+typename QuatTransformationTemplate<Scalar>::Matrix3X
+QuatTransformationTemplate<Scalar>::inverseTransformVectorized(
+    const typename QuatTransformationTemplate<Scalar>::Matrix3X& rhs) const {
+  CHECK_GT(rhs.cols(), 0);
+  return q_A_B_.inverseRotateVectorized(rhs.colwise() - A_t_A_B_);
+}
+
 template<typename Scalar>
 typename QuatTransformationTemplate<Scalar>::Vector4
 QuatTransformationTemplate<Scalar>::inverseTransform4(
@@ -365,6 +365,16 @@ RotationQuaternionTemplate<Scalar>::inverseRotate(
 }
 
 
+/// \brief rotate vectors, v, by the inverse
+template<typename Scalar>
+typename RotationQuaternionTemplate<Scalar>::Matrix3X
+RotationQuaternionTemplate<Scalar>::inverseRotateVectorized(
+    const typename RotationQuaternionTemplate<Scalar>::Matrix3X& v) const {
+  CHECK_GT(v.cols(), 0);
+  return q_A_B_.toRotationMatrix().transpose() * v;
+}
+
+
 /// \brief rotate a vector, v
 template<typename Scalar>
 typename RotationQuaternionTemplate<Scalar>::Vector4
@@ -135,6 +135,13 @@ class QuatTransformationTemplate {
   /// \brief transform points.
   Matrix3X transformVectorized(const Matrix3X& rhs) const;
 
+  /// \brief transform points, writing into out (e.g. an Eigen::Map over a
+  /// point cloud). The rotation matrix is computed once and applied to all the
+  /// points in a single matrix product. out may alias rhs.
+  template<typename DerivedIn, typename DerivedOut>
+  void transformVectorized(const Eigen::MatrixBase<DerivedIn>& rhs,
+                           Eigen::MatrixBase<DerivedOut>* out) const;
+
   /// \brief transform a point.
   Vector4 transform4(const Vector4& rhs) const;
 
@@ -144,6 +151,9 @@ class QuatTransformationTemplate {
   /// \brief transform a point by the inverse.
   Vector4 inverseTransform4(const Vector4& rhs) const;
 
+  /// \brief transform points by the inverse.
+  Matrix3X inverseTransformVectorized(const Matrix3X& rhs) const;
+
   /// \brief get the logarithmic map of the transformation
   /// note: this is the log map of SO(3)xR(3) and not SE(3)
   /// \return vector form of log map with first 3 components the translational
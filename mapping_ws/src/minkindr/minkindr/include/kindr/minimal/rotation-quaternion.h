@@ -155,6 +155,9 @@ class RotationQuaternionTemplate {
   /// \brief rotate a vector, v.
   Vector4 inverseRotate4(const Vector4& v) const;
 
+  /// \brief rotate vectors v by the inverse.
+  Matrix3X inverseRotateVectorized(const Matrix3X& v) const;
+
   /// \brief cast to the implementation type.
   Implementation& toImplementation();
 
@@ -142,6 +142,39 @@ TEST(MinKindrTests, testTransform) {
       EXPECT_NEAR(invTv4[i], invTv[i], 1e-4);
     }
   }
+
+  {
+    Eigen::Matrix3Xd invTvv1 = T.inverseTransformVectorized(vv);
+    for(int i = 0; i < 3; ++i) {
+      EXPECT_NEAR(invTvv1(i, 0), invTv[i], 1e-4);
+      EXPECT_NEAR(invTvv1(i, 1), invTv[i], 1e-4);
+    }
+  }
+}
+
+TEST(MinKindrTests, testTransformVectorizedInPlace) {
+  using namespace kindr::minimal;
+  Eigen::Vector4d q(0.64491714, 0.26382416,  0.51605132,  0.49816637);
+  RotationQuaternion q1(q[0], q[1], q[2], q[3]);
+  Eigen::Vector3d t( 4.67833851,  8.52053031,  6.71796159 );
+  Transformation T(q1,t);
+
+  // Points stored contiguously, as in a point cloud.
+  std::vector<Eigen::Vector3d> points(100);
+  for (size_t i = 0; i < points.size(); ++i) {
+    points[i] = Eigen::Vector3d::Random() * 10.0;
+  }
+  const std::vector<Eigen::Vector3d> points_in = points;
+
+  Eigen::Map<Eigen::Matrix3Xd> points_map(points[0].data(), 3, points.size());
+  T.transformVectorized(points_map, &points_map);
+
+  for (size_t i = 0; i < points.size(); ++i) {
+    const Eigen::Vector3d expected = T.transform(points_in[i]);
+    for(int j = 0; j < 3; ++j) {
+      EXPECT_NEAR(points[i][j], expected[j], 1e-8);
+    }
+  }
 }
 
 TEST(MinKindrTests, testCompose) {
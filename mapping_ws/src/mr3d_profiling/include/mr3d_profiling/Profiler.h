@@ -0,0 +1,433 @@
+/**
+* This file is part of the ROS package mr3d_profiling which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MR3D_PROFILING_PROFILER_H_
+#define MR3D_PROFILING_PROFILER_H_
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace mr3d_profiling
+{
+
+///	\class Histogram
+///	\author Luigi Freda
+///	\brief Log-linear histogram of durations in ns: the values below 16 ns have their own bucket, then each power of 2 is
+///	       split in 8 buckets (the relative error of a quantile is below 12.5%). The values above 2^42 ns (~73 min) fall
+///	       in the last bucket.
+class Histogram
+{
+public:
+
+    enum
+    {
+        kSubBucketBits = 3,
+        kSubBuckets = 1 << kSubBucketBits,
+        kMaxExponent = 41,
+        kNumBuckets = (kMaxExponent - kSubBucketBits + 2) * kSubBuckets
+    };
+
+    static int getBucket(uint64_t value_ns)
+    {
+        if (value_ns < 2 * kSubBuckets) return (int) value_ns; /// < EXIT POINT
+
+        const int exponent = 63 - __builtin_clzll(value_ns); // floor(log2(value_ns)) >= kSubBucketBits + 1
+        if (exponent > kMaxExponent) return kNumBuckets - 1; /// < EXIT POINT
+
+        const int shift = exponent - kSubBucketBits;
+        return shift * kSubBuckets + (int) (value_ns >> shift);
+    }
+
+    // [lower, upper) bounds of the values of the bucket
+    static uint64_t getBucketLower(int bucket)
+    {
+        if (bucket < 2 * kSubBuckets) return bucket; /// < EXIT POINT
+        const int shift = bucket / kSubBuckets - 1;
+        return uint64_t(bucket % kSubBuckets + kSubBuckets) << shift;
+    }
+
+    static uint64_t getBucketUpper(int bucket) { return getBucketLower(bucket + 1); }
+};
+
+
+///	\struct ZoneStats
+///	\author Luigi Freda
+///	\brief Merged samples of a zone (over all the threads): count, sum, min, max and histogram of the durations.
+struct ZoneStats
+{
+    ZoneStats():count(0), sum_ns(0), min_ns(0), max_ns(0), buckets(Histogram::kNumBuckets, 0) {}
+
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t min_ns;
+    uint64_t max_ns;
+    std::vector<uint64_t> buckets;
+
+    double meanSec() const { return count ? 1e-9 * sum_ns / count : 0.; }
+    double minSec() const { return 1e-9 * min_ns; }
+    double maxSec() const { return 1e-9 * max_ns; }
+
+    // q-quantile (q in [0,1]), interpolated in its bucket and clamped to [min, max]
+    double quantileSec(double q) const
+    {
+        if (count == 0) return 0.; /// < EXIT POINT
+
+        const double rank = std::min(std::max(q, 0.), 1.) * (count - 1);
+        uint64_t num_below = 0;
+        for (int ii = 0; ii < Histogram::kNumBuckets; ii++)
+        {
+            if (buckets[ii] == 0) continue; /// < CONTINUE
+            if (num_below + buckets[ii] > rank)
+            {
+                const double lower = Histogram::getBucketLower(ii);
+                const double upper = Histogram::getBucketUpper(ii);
+                const double value = lower + (upper - lower) * (rank - num_below + 0.5) / buckets[ii];
+                return 1e-9 * std::min(std::max(value, (double) min_ns), (double) max_ns); /// < EXIT POINT
+            }
+            num_below += buckets[ii];
+        }
+        return maxSec();
+    }
+
+    // standard deviation estimated from the histogram (the bucket midpoints)
+    double stdDevSec() const
+    {
+        if (count == 0) return 0.; /// < EXIT POINT
+
+        const double mean_ns = double(sum_ns) / count;
+        double sum_sq = 0;
+        for (int ii = 0; ii < Histogram::kNumBuckets; ii++)
+        {
+            if (buckets[ii] == 0) continue; /// < CONTINUE
+            const double mid = 0.5 * (Histogram::getBucketLower(ii) + Histogram::getBucketUpper(ii)) - mean_ns;
+            sum_sq += buckets[ii] * mid * mid;
+        }
+        return 1e-9 * std::sqrt(sum_sq / count);
+    }
+
+    // remove the samples of a previous snapshot of the same zone (the min and max are then estimated from the buckets)
+    void subtract(const ZoneStats& previous)
+    {
+        if (previous.count == 0) return; /// < EXIT POINT
+
+        count -= std::min(count, previous.count);
+        sum_ns -= std::min(sum_ns, previous.sum_ns);
+        int first = -1, last = -1;
+        for (int ii = 0; ii < Histogram::kNumBuckets; ii++)
+        {
+            buckets[ii] -= std::min(buckets[ii], previous.buckets[ii]);
+            if (buckets[ii] == 0) continue; /// < CONTINUE
+            if (first < 0) first = ii;
+            last = ii;
+        }
+        if (first < 0)
+        {
+            min_ns = max_ns = 0;
+            return; /// < EXIT POINT
+        }
+        min_ns = std::max(min_ns, Histogram::getBucketLower(first));
+        max_ns = std::min(max_ns, Histogram::getBucketUpper(last));
+    }
+};
+
+
+///	\class Profiler
+///	\author Luigi Freda
+///	\brief Lock-free recorder of the durations of named zones, shared by all the packages of the stack (header only).
+///	       Each thread adds its samples to its own histograms (one per zone): a sample costs a few relaxed atomic loads
+///	       and stores, without locks nor shared cache lines. The readers (e.g. the ProfilerExporter) merge the histograms
+///	       of all the threads at any time.
+///	       The zones are usually recorded with the PROFILE_ZONE() and PROFILE_LAP() macros, which compile out when
+///	       MR3D_PROFILING_DISABLED is defined.
+///	\note  The histograms of a thread are allocated the first time it records a zone and never released (they are
+///	       still read after the thread exits): use thread pools instead of short-lived threads.
+///	\date
+///	\warning at most kMaxZones zones, the samples of the zones registered above this limit are dropped
+class Profiler
+{
+public:
+
+    enum { kMaxZones = 256 };
+
+    static Profiler& instance()
+    {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    static int64_t nowNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // get the id of the zone (the same name always gets the same id), -1 if there are too many zones;
+    // a thread only locks the first time it looks up a name
+    int registerZone(const std::string& name)
+    {
+        static thread_local std::unordered_map<std::string, int> tl_zone_ids;
+        std::unordered_map<std::string, int>::const_iterator it = tl_zone_ids.find(name);
+        if (it != tl_zone_ids.end()) return it->second; /// < EXIT POINT
+
+        int zone = -1;
+        {
+            std::lock_guard<std::mutex> locker(mutex_);
+            std::unordered_map<std::string, int>::const_iterator it_zone = zone_ids_.find(name);
+            if (it_zone != zone_ids_.end())
+            {
+                zone = it_zone->second;
+            }
+            else if (zone_names_.size() < (size_t) kMaxZones)
+            {
+                zone = zone_names_.size();
+                zone_names_.push_back(name);
+                zone_ids_[name] = zone;
+            }
+            else
+            {
+                std::cerr << "mr3d_profiling::Profiler - too many zones, dropping the samples of " << name << std::endl;
+            }
+        }
+        tl_zone_ids[name] = zone;
+        return zone;
+    }
+
+    // add a sample of the zone (registered with registerZone()) from the calling thread
+    void record(int zone, int64_t duration_ns)
+    {
+        if (zone < 0 || zone >= kMaxZones) return; /// < EXIT POINT
+
+        ThreadZones& thread_zones = getThreadZones();
+        ZoneData* data = thread_zones.zones[zone].load(std::memory_order_relaxed);
+        if (!data)
+        {
+            data = new ZoneData();
+            thread_zones.zones[zone].store(data, std::memory_order_release);
+        }
+        data->add(duration_ns > 0 ? uint64_t(duration_ns) : 0);
+    }
+
+    std::vector<std::string> getZoneNames() const
+    {
+        std::lock_guard<std::mutex> locker(mutex_);
+        return std::vector<std::string>(zone_names_.begin(), zone_names_.end());
+    }
+
+    // merge the samples of the zone over all the threads
+    void getStats(int zone, ZoneStats& stats) const
+    {
+        stats = ZoneStats();
+        if (zone < 0 || zone >= kMaxZones) return; /// < EXIT POINT
+
+        std::vector<ThreadZones*> threads;
+        {
+            std::lock_guard<std::mutex> locker(mutex_);
+            threads = threads_;
+        }
+        for (size_t ii = 0; ii < threads.size(); ii++)
+        {
+            const ZoneData* data = threads[ii]->zones[zone].load(std::memory_order_acquire);
+            if (data) data->mergeInto(stats);
+        }
+    }
+
+protected:
+
+    // the samples of a zone recorded by a thread, written only by that thread
+    struct ZoneData
+    {
+        ZoneData():count(0), sum_ns(0), min_ns(UINT64_MAX), max_ns(0)
+        {
+            for (int ii = 0; ii < Histogram::kNumBuckets; ii++) buckets[ii].store(0, std::memory_order_relaxed);
+        }
+
+        void add(uint64_t value_ns)
+        {
+            // single writer: no read-modify-write needed
+            std::atomic<uint64_t>& bucket = buckets[Histogram::getBucket(value_ns)];
+            bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            sum_ns.store(sum_ns.load(std::memory_order_relaxed) + value_ns, std::memory_order_relaxed);
+            if (value_ns < min_ns.load(std::memory_order_relaxed)) min_ns.store(value_ns, std::memory_order_relaxed);
+            if (value_ns > max_ns.load(std::memory_order_relaxed)) max_ns.store(value_ns, std::memory_order_relaxed);
+            count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        void mergeInto(ZoneStats& stats) const
+        {
+            const uint64_t data_count = count.load(std::memory_order_acquire);
+            if (data_count == 0) return; /// < EXIT POINT
+
+            stats.min_ns = stats.count ? std::min(stats.min_ns, min_ns.load(std::memory_order_relaxed)) : min_ns.load(std::memory_order_relaxed);
+            stats.max_ns = std::max(stats.max_ns, max_ns.load(std::memory_order_relaxed));
+            stats.count += data_count;
+            stats.sum_ns += sum_ns.load(std::memory_order_relaxed);
+            for (int ii = 0; ii < Histogram::kNumBuckets; ii++) stats.buckets[ii] += buckets[ii].load(std::memory_order_relaxed);
+        }
+
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> sum_ns;
+        std::atomic<uint64_t> min_ns;
+        std::atomic<uint64_t> max_ns;
+        std::atomic<uint64_t> buckets[Histogram::kNumBuckets];
+    };
+
+    struct ThreadZones
+    {
+        ThreadZones()
+        {
+            for (int ii = 0; ii < kMaxZones; ii++) zones[ii].store(0, std::memory_order_relaxed);
+        }
+
+        std::atomic<ZoneData*> zones[kMaxZones];
+    };
+
+protected:
+
+    Profiler() {}
+    Profiler(const Profiler&);
+    Profiler& operator=(const Profiler&);
+
+    ThreadZones& getThreadZones()
+    {
+        static thread_local ThreadZones* tl_thread_zones = 0;
+        if (!tl_thread_zones)
+        {
+            tl_thread_zones = new ThreadZones();
+            std::lock_guard<std::mutex> locker(mutex_);
+            threads_.push_back(tl_thread_zones);
+        }
+        return *tl_thread_zones;
+    }
+
+protected:
+
+    mutable std::mutex mutex_; // protects the zone names and the threads list
+    std::deque<std::string> zone_names_;
+    std::unordered_map<std::string, int> zone_ids_;
+    std::vector<ThreadZones*> threads_; // never released (see the note above)
+};
+
+
+///	\class ScopedZone
+///	\author Luigi Freda
+///	\brief Records the lifetime of its scope (or the time until stop()) as a sample of a zone.
+class ScopedZone
+{
+public:
+
+    explicit ScopedZone(int zone):zone_(zone), start_ns_(Profiler::nowNs()), b_running_(true) {}
+
+    ~ScopedZone() { stop(); }
+
+    // record the sample now instead of at the end of the scope, return its duration [s]
+    double stop()
+    {
+        const int64_t duration_ns = Profiler::nowNs() - start_ns_;
+        if (b_running_)
+        {
+            Profiler::instance().record(zone_, duration_ns);
+            b_running_ = false;
+        }
+        return 1e-9 * duration_ns;
+    }
+
+    // [s] time since the start
+    double elapsedSec() const { return 1e-9 * (Profiler::nowNs() - start_ns_); }
+
+private:
+
+    ScopedZone(const ScopedZone&);
+    ScopedZone& operator=(const ScopedZone&);
+
+    int zone_;
+    int64_t start_ns_;
+    bool b_running_;
+};
+
+
+///	\class LapTimer
+///	\author Luigi Freda
+///	\brief Records the consecutive steps of a code path: each lap() records the time since the previous lap (or the
+///	       construction) as a sample of the given zone.
+class LapTimer
+{
+public:
+
+    LapTimer():last_ns_(Profiler::nowNs()) {}
+
+    void lap(int zone)
+    {
+        const int64_t now_ns = Profiler::nowNs();
+        Profiler::instance().record(zone, now_ns - last_ns_);
+        last_ns_ = now_ns;
+    }
+
+private:
+
+    int64_t last_ns_;
+};
+
+} // namespace mr3d_profiling
+
+
+#define MR3D_PROFILING_CONCAT_IMPL(a, b) a##b
+#define MR3D_PROFILING_CONCAT(a, b) MR3D_PROFILING_CONCAT_IMPL(a, b)
+
+#ifndef MR3D_PROFILING_DISABLED
+
+// profile the enclosing scope as the zone 'name' (a string constant: it is looked up once)
+#define PROFILE_ZONE(name) \
+    static const int MR3D_PROFILING_CONCAT(profiler_zone_id_, __LINE__) = mr3d_profiling::Profiler::instance().registerZone(name); \
+    mr3d_profiling::ScopedZone MR3D_PROFILING_CONCAT(profiler_zone_, __LINE__)(MR3D_PROFILING_CONCAT(profiler_zone_id_, __LINE__))
+
+// profile the enclosing scope as the zone 'name' with the ScopedZone 'zone' (e.g. to log zone.elapsedSec())
+#define PROFILE_ZONE_NAMED(zone, name) \
+    static const int MR3D_PROFILING_CONCAT(zone, _profiler_zone_id) = mr3d_profiling::Profiler::instance().registerZone(name); \
+    mr3d_profiling::ScopedZone zone(MR3D_PROFILING_CONCAT(zone, _profiler_zone_id))
+
+// declare a lap timer, then record the time since its previous lap as the zone 'name' (a string constant)
+#define PROFILE_LAP_TIMER(timer) mr3d_profiling::LapTimer timer
+#define PROFILE_LAP(timer, name) \
+    do { \
+        static const int profiler_lap_zone_id = mr3d_profiling::Profiler::instance().registerZone(name); \
+        (timer).lap(profiler_lap_zone_id); \
+    } while (0)
+
+#else
+
+#define PROFILE_ZONE(name)
+#define PROFILE_ZONE_NAMED(zone, name) mr3d_profiling::ScopedZone zone(-1) // still measures, records nothing
+#define PROFILE_LAP_TIMER(timer)
+#define PROFILE_LAP(timer, name) do {} while (0)
+
+#endif // MR3D_PROFILING_DISABLED
+
+
+#endif // MR3D_PROFILING_PROFILER_H_
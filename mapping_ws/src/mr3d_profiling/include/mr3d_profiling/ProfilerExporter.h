@@ -0,0 +1,227 @@
+/**
+* This file is part of the ROS package mr3d_profiling which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MR3D_PROFILING_PROFILER_EXPORTER_H_
+#define MR3D_PROFILING_PROFILER_EXPORTER_H_
+
+#include <stdio.h>
+
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ros/ros.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
+
+#include "mr3d_profiling/Profiler.h"
+
+
+namespace mr3d_profiling
+{
+
+///	\class ProfilerExporter
+///	\author Luigi Freda
+///	\brief Periodically exports the stats of the Profiler zones recorded in the report period (the samples count, the
+///	       mean, p50, p95, p99 and max durations) as a diagnostic_msgs/DiagnosticArray on /diagnostics and, optionally,
+///	       as tab-separated lines appended to a stats file (time, zone, n, mean, p50, p95, p99, max; durations in ms).
+///	       At stop(), the stats of all the samples recorded since start() are appended to the stats file as lines
+///	       with "total" in the time field. The exporter only reads the histograms: the recording threads are never blocked.
+class ProfilerExporter
+{
+public:
+
+    static constexpr double kDefaultReportPeriodSec = 5.0; // [s]
+
+    static ProfilerExporter& instance()
+    {
+        static ProfilerExporter exporter;
+        return exporter;
+    }
+
+    // start the background thread; the stats are also appended to stats_file_name if not empty
+    void start(ros::NodeHandle& n, const std::string& stats_file_name = std::string(), double report_period_sec = kDefaultReportPeriodSec)
+    {
+        std::lock_guard<std::mutex> start_locker(start_mutex_);
+        if (thread_.joinable()) return; /// < EXIT POINT
+
+        diagnostics_pub_ = n.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 10);
+        if (!stats_file_name.empty())
+        {
+            stats_file_.open(stats_file_name.c_str(), std::ios::out | std::ios::app);
+            if (!stats_file_.is_open()) ROS_WARN_STREAM("ProfilerExporter::start() - cannot open " << stats_file_name);
+        }
+        report_period_sec_ = kDefaultReportPeriodSec;
+        if (report_period_sec > 0) report_period_sec_ = report_period_sec;
+        node_name_ = ros::this_node::getName();
+
+        // the totals only cover the samples recorded from now on
+        Profiler& profiler = Profiler::instance();
+        start_stats_.resize(profiler.getZoneNames().size());
+        for (size_t zone = 0; zone < start_stats_.size(); zone++) profiler.getStats(zone, start_stats_[zone]);
+        previous_stats_ = start_stats_;
+
+        {
+            std::lock_guard<std::mutex> locker(mutex_);
+            b_stop_ = false;
+        }
+        thread_ = std::thread(&ProfilerExporter::reportLoop, this);
+        ROS_INFO_STREAM("ProfilerExporter::start() - exporting the profiler stats every " << report_period_sec_ << " s");
+    }
+
+    // export the last stats and join the background thread
+    void stop()
+    {
+        std::lock_guard<std::mutex> start_locker(start_mutex_);
+        if (!thread_.joinable()) return; /// < EXIT POINT
+
+        {
+            std::lock_guard<std::mutex> locker(mutex_);
+            b_stop_ = true;
+        }
+        cond_.notify_all();
+        thread_.join();
+        if (stats_file_.is_open())
+        {
+            writeTotals();
+            stats_file_.close();
+        }
+    }
+
+protected:
+
+    ProfilerExporter():b_stop_(false), report_period_sec_(kDefaultReportPeriodSec)
+    {
+        Profiler::instance(); // constructed first, so that it is still alive at the last report (in the destructor)
+    }
+    ~ProfilerExporter() { stop(); }
+    ProfilerExporter(const ProfilerExporter&);
+    ProfilerExporter& operator=(const ProfilerExporter&);
+
+    void reportLoop()
+    {
+        std::unique_lock<std::mutex> locker(mutex_);
+        while (!b_stop_)
+        {
+            cond_.wait_for(locker, std::chrono::duration<double>(report_period_sec_));
+            locker.unlock();
+            report();
+            locker.lock();
+        }
+    }
+
+    // publish the stats of the samples recorded since the previous report
+    void report()
+    {
+        Profiler& profiler = Profiler::instance();
+        const std::vector<std::string> zone_names = profiler.getZoneNames();
+        previous_stats_.resize(zone_names.size());
+
+        diagnostic_msgs::DiagnosticArray msg;
+        msg.header.stamp = ros::Time::now();
+        msg.status.resize(1);
+        diagnostic_msgs::DiagnosticStatus& status = msg.status[0];
+        status.level = diagnostic_msgs::DiagnosticStatus::OK;
+        status.name = "profiler: " + node_name_;
+
+        char buffer[256];
+        ZoneStats stats;
+        for (size_t zone = 0; zone < zone_names.size(); zone++)
+        {
+            profiler.getStats(zone, stats);
+            ZoneStats delta = stats;
+            delta.subtract(previous_stats_[zone]);
+            previous_stats_[zone] = stats;
+            if (delta.count == 0) continue; /// < CONTINUE
+
+            const double mean_ms = 1e3 * delta.meanSec();
+            const double p50_ms = 1e3 * delta.quantileSec(0.5);
+            const double p95_ms = 1e3 * delta.quantileSec(0.95);
+            const double p99_ms = 1e3 * delta.quantileSec(0.99);
+            const double max_ms = 1e3 * delta.maxSec();
+
+            diagnostic_msgs::KeyValue key_value;
+            key_value.key = zone_names[zone];
+            snprintf(buffer, sizeof(buffer), "n %lu, mean %.3f ms, p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, max %.3f ms",
+                     (unsigned long) delta.count, mean_ms, p50_ms, p95_ms, p99_ms, max_ms);
+            key_value.value = buffer;
+            status.values.push_back(key_value);
+
+            if (stats_file_.is_open())
+            {
+                snprintf(buffer, sizeof(buffer), "%.3f\t%s\t%lu\t%.3f\t%.3f\t%.3f\t%.3f\t%.3f\n", msg.header.stamp.toSec(),
+                         zone_names[zone].c_str(), (unsigned long) delta.count, mean_ms, p50_ms, p95_ms, p99_ms, max_ms);
+                stats_file_ << buffer;
+            }
+        }
+        snprintf(buffer, sizeof(buffer), "%lu active zones", (unsigned long) status.values.size());
+        status.message = buffer;
+
+        if (stats_file_.is_open()) stats_file_.flush();
+        diagnostics_pub_.publish(msg);
+    }
+
+    // append the stats of the samples recorded since start() (called after the background thread is joined)
+    void writeTotals()
+    {
+        Profiler& profiler = Profiler::instance();
+        const std::vector<std::string> zone_names = profiler.getZoneNames();
+        start_stats_.resize(zone_names.size());
+
+        char buffer[256];
+        ZoneStats stats;
+        for (size_t zone = 0; zone < zone_names.size(); zone++)
+        {
+            profiler.getStats(zone, stats);
+            stats.subtract(start_stats_[zone]);
+            if (stats.count == 0) continue; /// < CONTINUE
+
+            snprintf(buffer, sizeof(buffer), "total\t%s\t%lu\t%.3f\t%.3f\t%.3f\t%.3f\t%.3f\n", zone_names[zone].c_str(),
+                     (unsigned long) stats.count, 1e3 * stats.meanSec(), 1e3 * stats.quantileSec(0.5),
+                     1e3 * stats.quantileSec(0.95), 1e3 * stats.quantileSec(0.99), 1e3 * stats.maxSec());
+            stats_file_ << buffer;
+        }
+        stats_file_.flush();
+    }
+
+protected:
+
+    std::mutex start_mutex_; // serializes start() and stop()
+
+    std::mutex mutex_; // protects b_stop_
+    std::condition_variable cond_;
+    bool b_stop_;
+
+    // used only by the background thread
+    std::vector<ZoneStats> previous_stats_;
+    std::vector<ZoneStats> start_stats_; // also used by stop() after the thread is joined
+    std::ofstream stats_file_;
+
+    ros::Publisher diagnostics_pub_;
+    std::string node_name_;
+    double report_period_sec_;
+    std::thread thread_;
+};
+
+} // namespace mr3d_profiling
+
+#endif // MR3D_PROFILING_PROFILER_EXPORTER_H_
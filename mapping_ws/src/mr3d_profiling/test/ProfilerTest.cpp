@@ -0,0 +1,98 @@
+/**
+* This file is part of the ROS package mr3d_profiling which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "mr3d_profiling/Profiler.h"
+
+using namespace mr3d_profiling;
+
+TEST(Histogram, BucketsContainTheirValues)
+{
+    for (uint64_t value = 0; value < (uint64_t(1) << 42); value = value * 1.01 + 1)
+    {
+        const int bucket = Histogram::getBucket(value);
+        ASSERT_GE(bucket, 0);
+        ASSERT_LT(bucket, Histogram::kNumBuckets);
+        ASSERT_LE(Histogram::getBucketLower(bucket), value);
+        ASSERT_LT(value, Histogram::getBucketUpper(bucket));
+    }
+    EXPECT_EQ(Histogram::kNumBuckets - 1, Histogram::getBucket(UINT64_MAX));
+}
+
+TEST(Profiler, MergesTheThreadsSamples)
+{
+    Profiler& profiler = Profiler::instance();
+    const int zone = profiler.registerZone("test/merge");
+    EXPECT_EQ(zone, profiler.registerZone("test/merge"));
+
+    const int num_threads = 4;
+    const int num_samples = 10000;
+    std::vector<std::thread> threads;
+    for (int ii = 0; ii < num_threads; ii++)
+    {
+        threads.push_back(std::thread([&profiler, zone]()
+        {
+            for (int jj = 1; jj <= num_samples; jj++) profiler.record(zone, jj * 1000);
+        }));
+    }
+    for (size_t ii = 0; ii < threads.size(); ii++) threads[ii].join();
+
+    ZoneStats stats;
+    profiler.getStats(zone, stats);
+    EXPECT_EQ(uint64_t(num_threads * num_samples), stats.count);
+    EXPECT_NEAR(5e-3, stats.meanSec(), 1e-6);
+    EXPECT_DOUBLE_EQ(1e-6, stats.minSec());
+    EXPECT_DOUBLE_EQ(1e-2, stats.maxSec());
+    // the quantiles are within a bucket (12.5%) of the exact values
+    EXPECT_NEAR(5e-3, stats.quantileSec(0.5), 5e-3 * 0.125);
+    EXPECT_NEAR(9.5e-3, stats.quantileSec(0.95), 9.5e-3 * 0.125);
+    EXPECT_NEAR(1e-2 / std::sqrt(12.), stats.stdDevSec(), 1e-4);
+
+    // the samples recorded after a snapshot
+    const ZoneStats snapshot = stats;
+    for (int jj = 0; jj < 10; jj++) profiler.record(zone, 2000000);
+    profiler.getStats(zone, stats);
+    stats.subtract(snapshot);
+    EXPECT_EQ(10u, stats.count);
+    EXPECT_NEAR(2e-3, stats.meanSec(), 1e-9);
+    EXPECT_NEAR(2e-3, stats.quantileSec(0.5), 2e-3 * 0.125);
+    EXPECT_LE(stats.minSec(), 2e-3);
+    EXPECT_GE(stats.maxSec(), 2e-3);
+}
+
+TEST(Profiler, MacrosRecordTheirZones)
+{
+    {
+        PROFILE_ZONE("test/scope");
+        PROFILE_LAP_TIMER(timer);
+        PROFILE_LAP(timer, "test/lap");
+        PROFILE_LAP(timer, "test/lap");
+    }
+    Profiler& profiler = Profiler::instance();
+    ZoneStats stats;
+    profiler.getStats(profiler.registerZone("test/scope"), stats);
+    EXPECT_EQ(1u, stats.count);
+    profiler.getStats(profiler.registerZone("test/lap"), stats);
+    EXPECT_EQ(2u, stats.count);
+}
@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+
+# /**
+# * This file is part of the ROS package mr3d_replay which belongs to the framework 3DMR.
+# *
+# * Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+# * For more information see <https://github.com/luigifreda/3dmr>
+# *
+# * 3DMR is free software: you can redistribute it and/or modify
+# * it under the terms of the GNU General Public License as published by
+# * the Free Software Foundation, either version 3 of the License, or
+# * (at your option) any later version.
+# *
+# * 3DMR is distributed in the hope that it will be useful,
+# * but WITHOUT ANY WARRANTY; without even the implied warranty of
+# * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# * GNU General Public License for more details.
+# *
+# * You should have received a copy of the GNU General Public License
+# * along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+# */
+
+# compare a replay report with a baseline (e.g. in CI, after roslaunch mr3d_replay replay.launch):
+# exit code 0 if there is no regression, 1 otherwise
+
+import argparse
+import sys
+
+from mr3d_replay import report as replay_report
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Compare a replay report with a baseline report.')
+    parser.add_argument('report', help='report written by replay_driver.py')
+    parser.add_argument('baseline', help='baseline report')
+    parser.add_argument('--latency', type=float, help='max relative increase of the latencies (default %.2f)' % replay_report.kDefaultTolerances['latency'])
+    parser.add_argument('--cpu', type=float, help='max relative increase of the CPU time (default %.2f)' % replay_report.kDefaultTolerances['cpu'])
+    parser.add_argument('--memory', type=float, help='max relative increase of the peak RSS (default %.2f)' % replay_report.kDefaultTolerances['memory'])
+    parser.add_argument('--update-baseline', action='store_true', help='overwrite the baseline with the report')
+    args = parser.parse_args()
+
+    report = replay_report.load_json(args.report)
+    if args.update_baseline:
+        replay_report.save_json(report, args.baseline)
+        print('baseline updated: %s' % args.baseline)
+        return 0
+
+    tolerances = {}
+    for key in ['latency', 'cpu', 'memory']:
+        if getattr(args, key) is not None:
+            tolerances[key] = getattr(args, key)
+    regressions = replay_report.compare_with_baseline(report, replay_report.load_json(args.baseline), tolerances)
+
+    print('%s: %.1f s of sim time in %.1f s (x%.2f), %d quiescence timeouts' %
+          (args.report, report['sim_duration_sec'], report['wall_duration_sec'], report['real_time_factor'], report['num_timeouts']))
+    for stage_name in sorted(report['stages'].keys()):
+        stage = report['stages'][stage_name]
+        print('  %-24s latency mean %8.2f ms, p95 %8.2f ms (n %5d), cpu %8.2f s (%5.1f%%), peak rss %8.1f MB' %
+              (stage_name, stage['latency_ms']['mean'], stage['latency_ms']['p95'], stage['latency_ms']['n'],
+               stage['cpu_sec'], stage['cpu_percent'], stage['peak_rss_mb']))
+    for regression in regressions:
+        print('REGRESSION %s' % regression)
+    return 1 if regressions else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,317 @@
+#!/usr/bin/env python3
+
+# /**
+# * This file is part of the ROS package mr3d_replay which belongs to the framework 3DMR.
+# *
+# * Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+# * For more information see <https://github.com/luigifreda/3dmr>
+# *
+# * 3DMR is free software: you can redistribute it and/or modify
+# * it under the terms of the GNU General Public License as published by
+# * the Free Software Foundation, either version 3 of the License, or
+# * (at your option) any later version.
+# *
+# * 3DMR is distributed in the hope that it will be useful,
+# * but WITHOUT ANY WARRANTY; without even the implied warranty of
+# * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# * GNU General Public License for more details.
+# *
+# * You should have received a copy of the GNU General Public License
+# * along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+# */
+
+# Lockstep replay of recorded bags through the stack (use_sim_time must be true):
+# - the driver owns /clock: the simulated time only advances when all the stage nodes are idle (quiescence), so that
+#   each input is fully processed before the next one, as fast as the stack allows and independently of the machine load
+# - after each trigger message (e.g. a scan) the wall latency until each stage publishes its outputs is measured, and
+#   the outputs are hashed to check that two replays give the same results
+# - the CPU time and the peak RSS of the stage nodes are sampled from /proc, the profiler zones are read from the
+#   stats files of the nodes (profiler_stats_file, written when the nodes shut down at the end of the replay)
+# - the JSON report is compared with a baseline; the driver exits with 1 on regressions
+
+import heapq
+import hashlib
+import os
+import sys
+import threading
+import time
+
+import rospy
+import rosbag
+import rosnode
+import rospkg
+from rosgraph_msgs.msg import Clock
+from std_msgs.msg import Bool
+
+from mr3d_replay.process_monitor import ProcessMonitor, shutdown_node, read_cpu_sec
+from mr3d_replay import report as replay_report
+
+
+kTriggerTypes = ['sensor_msgs/PointCloud2', 'sensor_msgs/LaserScan']  # default trigger topics: the sensor data
+
+
+class Stage(object):
+    """ a stage of the stack: its nodes (one per robot) and the outputs which mark the end of its processing """
+
+    def __init__(self, name, config):
+        self.name = name
+        self.nodes = [rospy.names.canonicalize_name('/' + node.lstrip('/')) for node in config.get('nodes', [])]
+        self.outputs = config.get('outputs', [])
+        self.check_digests = config.get('check_digests', True)
+        self.latencies_ms = []
+        self.counts = dict((topic, 0) for topic in self.outputs)
+        self.digests = dict((topic, hashlib.sha1()) for topic in self.outputs)
+
+
+class ReplayDriver(object):
+
+    def __init__(self):
+        bags = rospy.get_param('~bags', [])
+        self.bag_names = bags.split() if isinstance(bags, str) else list(bags)
+        self.topics = rospy.get_param('~topics', [])
+        self.trigger_topics = rospy.get_param('~trigger_topics', [])
+        self.start_topics = rospy.get_param('~start_topics', [])   # std_msgs/Bool pause topics: false is published at the start
+        self.start_offset = rospy.get_param('~start_offset', 0.)   # [s] skipped at the start of the bags
+        self.duration = rospy.get_param('~duration', 0.)           # [s] replayed sim time (0: all)
+        self.clock_step = rospy.get_param('~clock_step', 0.05)     # [s] max sim time advance between two quiescence points
+        self.tail_time = rospy.get_param('~tail_time', 0.)         # [s] sim time advanced after the last message
+
+        self.min_wait = rospy.get_param('~quiescence/min_wait', 0.005)                # [s]
+        self.idle_window = rospy.get_param('~quiescence/idle_window', 0.05)           # [s]
+        self.idle_cpu_fraction = rospy.get_param('~quiescence/idle_cpu_fraction', 0.25)
+        self.step_timeout = rospy.get_param('~quiescence/step_timeout', 10.)          # [s]
+
+        self.startup_timeout = rospy.get_param('~startup_timeout', 60.)   # [s] waiting for the stage nodes
+        self.shutdown_timeout = rospy.get_param('~shutdown_timeout', 20.) # [s] waiting for the stage nodes to exit
+        self.shutdown_nodes = rospy.get_param('~shutdown_nodes', True)    # needed for the profiler totals
+
+        self.report_file = rospy.get_param('~report', 'replay_report.json')
+        self.baseline_file = rospy.get_param('~baseline', '')
+        self.update_baseline = rospy.get_param('~update_baseline', False)
+        self.tolerances = rospy.get_param('~tolerances', {})
+
+        stages = rospy.get_param('~stages', {})
+        self.stages = [Stage(name, stages[name]) for name in sorted(stages.keys())]
+
+        self.lock = threading.Lock()
+        self.step_start = None     # wall time of the last trigger publication (None: no latency measured)
+        self.step_arrivals = {}    # stage name -> wall time of its first output after step_start
+
+        self.publishers = {}
+        self.clock_pub = rospy.Publisher('/clock', Clock, queue_size=None)  # synchronous: published before the next inputs
+        self.subscribers = []
+        for stage in self.stages:
+            for topic in stage.outputs:
+                self.subscribers.append(rospy.Subscriber(topic, rospy.AnyMsg, self.output_callback, (stage, topic)))
+
+        self.num_messages = 0
+        self.num_steps = 0
+        self.num_timeouts = 0
+
+    def output_callback(self, msg, args):
+        stage, topic = args
+        now = time.time()
+        with self.lock:
+            stage.counts[topic] += 1
+            stage.digests[topic].update(msg._buff)
+            if self.step_start is not None and stage.name not in self.step_arrivals:
+                self.step_arrivals[stage.name] = now
+
+    def get_node_names(self):
+        return [node for stage in self.stages for node in stage.nodes]
+
+    def wait_for_nodes(self):
+        start = time.time()
+        node_names = set(self.get_node_names())
+        missing = node_names
+        while not rospy.is_shutdown() and time.time() - start < self.startup_timeout:
+            missing = node_names - set(rosnode.get_node_names())
+            # the nodes must also be connected to the clock, otherwise they would miss the first time steps
+            if not missing and self.clock_pub.get_num_connections() >= len(node_names):
+                return
+            time.sleep(0.5)
+        if missing:
+            rospy.logwarn('replay - nodes not found: %s' % ' '.join(sorted(missing)))
+
+    def read_messages(self):
+        """ the messages of all the bags in time order """
+        bags = [rosbag.Bag(bag_name) for bag_name in self.bag_names]
+        start_time = min(bag.get_start_time() for bag in bags) + self.start_offset
+        end_time = max(bag.get_end_time() for bag in bags)
+        if self.duration > 0:
+            end_time = min(end_time, start_time + self.duration)
+        topics = self.topics if self.topics else None
+        if not self.trigger_topics:
+            for bag in bags:
+                for topic, info in bag.get_type_and_topic_info().topics.items():
+                    if info.msg_type in kTriggerTypes and (topics is None or topic in topics):
+                        self.trigger_topics.append(topic)
+        generators = [bag.read_messages(topics=topics, start_time=rospy.Time.from_sec(start_time),
+                                        end_time=rospy.Time.from_sec(end_time)) for bag in bags]
+        return start_time, end_time, heapq.merge(*generators, key=lambda message: message[2])
+
+    def publish_clock(self, stamp):
+        self.clock_pub.publish(Clock(clock=stamp))
+
+    def wait_quiescence(self):
+        self.num_steps += 1
+        if not self.monitor.wait_quiescence(self.min_wait, self.idle_window, self.idle_cpu_fraction, self.step_timeout):
+            self.num_timeouts += 1
+            rospy.logwarn_throttle(10., 'replay - the stack did not become idle within %.1f s (%d timeouts)'
+                                   % (self.step_timeout, self.num_timeouts))
+
+    def get_publisher(self, topic, msg):
+        if topic not in self.publishers:
+            # synchronous publishers (no queue): the messages are written in the bag order
+            self.publishers[topic] = rospy.Publisher(topic, type(msg), queue_size=None, latch=(topic == '/tf_static'))
+            time.sleep(0.5)  # let the subscribers connect (only once per topic)
+        return self.publishers[topic]
+
+    def run(self):
+        self.wait_for_nodes()
+        start_time, end_time, messages = self.read_messages()
+        rospy.loginfo('replay - %s: %.1f s of sim time, triggers: %s' % (' '.join(self.bag_names), end_time - start_time,
+                                                                       ' '.join(self.trigger_topics)))
+
+        self.monitor = ProcessMonitor(self.get_node_names(), rospy.get_name())
+        if self.monitor.missing:
+            rospy.logwarn('replay - not monitored (not local or not running): %s' % ' '.join(self.monitor.missing))
+        profiler_offsets = self.get_profiler_stats_files()
+
+        clock = rospy.Time.from_sec(start_time)
+        self.publish_clock(clock)
+        self.wait_quiescence()
+        for topic in self.start_topics:
+            self.get_publisher(topic, Bool(data=False)).publish(Bool(data=False))  # the planners start in pause
+        self.wait_quiescence()
+
+        wall_start = time.time()
+        for topic, msg, stamp in messages:
+            if rospy.is_shutdown():
+                break
+            if (stamp - clock).to_sec() >= self.clock_step:
+                # advance the time (the timers of the nodes fire) before the inputs stamped later
+                clock = stamp
+                self.publish_clock(clock)
+                self.wait_quiescence()
+
+            publisher = self.get_publisher(topic, msg)
+            is_trigger = topic in self.trigger_topics
+            if is_trigger:
+                if stamp > clock:
+                    clock = stamp
+                    self.publish_clock(clock)
+                with self.lock:
+                    self.step_arrivals = {}
+                    self.step_start = time.time()
+            publisher.publish(msg)
+            self.num_messages += 1
+            if is_trigger:
+                self.wait_quiescence()
+                self.collect_latencies()
+
+        tail_end = clock + rospy.Duration.from_sec(self.tail_time)
+        while not rospy.is_shutdown() and clock < tail_end:
+            clock = min(clock + rospy.Duration.from_sec(self.clock_step), tail_end)
+            self.publish_clock(clock)
+            self.wait_quiescence()
+        wall_duration = time.time() - wall_start
+        sim_duration = (clock - rospy.Time.from_sec(start_time)).to_sec()
+
+        report = self.make_report(sim_duration, wall_duration, profiler_offsets)
+        return self.check_report(report)
+
+    def collect_latencies(self):
+        with self.lock:
+            for stage in self.stages:
+                if stage.name in self.step_arrivals:
+                    stage.latencies_ms.append(1e3 * (self.step_arrivals[stage.name] - self.step_start))
+            self.step_start = None
+
+    def get_profiler_stats_files(self):
+        """ node -> (stats file, size before the replay) for the nodes exporting their profiler stats """
+        ros_home = rospkg.get_ros_home()
+        files = {}
+        for node in self.get_node_names():
+            file_name = rospy.get_param(node + '/profiler_stats_file', '')
+            if file_name and rospy.get_param(node + '/enable_profiler', False):
+                file_name = os.path.join(ros_home, file_name)  # relative names are resolved in the cwd of the nodes
+                files[node] = (file_name, replay_report.get_file_size(file_name))
+        return files
+
+    def stop_nodes(self):
+        """ shut down the stage nodes, so that they write their profiler totals """
+        for node in self.get_node_names():
+            shutdown_node(node, rospy.get_name())
+        start = time.time()
+        while time.time() - start < self.shutdown_timeout:
+            if all(read_cpu_sec(pid) is None for pid in self.monitor.pids.values()):
+                return
+            time.sleep(0.1)
+        rospy.logwarn('replay - the stage nodes did not exit within %.1f s' % self.shutdown_timeout)
+
+    def make_report(self, sim_duration, wall_duration, profiler_offsets):
+        self.monitor.sample()
+        stages = {}
+        for stage in self.stages:
+            stage_report = self.monitor.get_stats(stage.nodes)
+            stage_report['latency_ms'] = replay_report.get_latency_stats(stage.latencies_ms)
+            stage_report['outputs'] = {}
+            with self.lock:
+                for topic in stage.outputs:
+                    output = {'count': stage.counts[topic]}
+                    if stage.check_digests:
+                        output['digest'] = stage.digests[topic].hexdigest()
+                    stage_report['outputs'][topic] = output
+            stages[stage.name] = stage_report
+
+        if self.shutdown_nodes:
+            self.stop_nodes()
+            for stage in self.stages:
+                zones = {}
+                for node in stage.nodes:
+                    if node in profiler_offsets:
+                        file_name, offset = profiler_offsets[node]
+                        for zone, stats in replay_report.read_profiler_totals(file_name, offset).items():
+                            zones[node + ':' + zone] = stats
+                stages[stage.name]['zones'] = zones
+
+        return {
+            'bags': self.bag_names,
+            'sim_duration_sec': sim_duration,
+            'wall_duration_sec': wall_duration,
+            'real_time_factor': sim_duration / max(wall_duration, 1e-9),
+            'num_messages': self.num_messages,
+            'num_steps': self.num_steps,
+            'num_timeouts': self.num_timeouts,
+            'missing_nodes': self.monitor.missing,
+            'stages': stages,
+        }
+
+    def check_report(self, report):
+        if self.baseline_file and not self.update_baseline and os.path.exists(self.baseline_file):
+            report['baseline'] = self.baseline_file
+            report['regressions'] = replay_report.compare_with_baseline(report, replay_report.load_json(self.baseline_file),
+                                                                       self.tolerances)
+        replay_report.save_json(report, self.report_file)
+        rospy.loginfo('replay - %d messages, %.1f s of sim time in %.1f s (x%.2f), report: %s' %
+                      (report['num_messages'], report['sim_duration_sec'], report['wall_duration_sec'],
+                       report['real_time_factor'], self.report_file))
+
+        if self.baseline_file and self.update_baseline:
+            replay_report.save_json(report, self.baseline_file)
+            rospy.loginfo('replay - baseline updated: %s' % self.baseline_file)
+            return 0
+        if report['num_timeouts'] > 0:
+            rospy.logwarn('replay - %d quiescence timeouts: the replay may not be deterministic' % report['num_timeouts'])
+        for regression in report.get('regressions', []):
+            rospy.logerr('replay - regression: %s' % regression)
+        return 1 if report.get('regressions') else 0
+
+
+if __name__ == '__main__':
+    rospy.init_node('replay_driver')
+    if not rospy.get_param('/use_sim_time', False):
+        rospy.logfatal('replay - /use_sim_time must be true: the driver publishes the clock')
+        sys.exit(2)
+    sys.exit(ReplayDriver().run())
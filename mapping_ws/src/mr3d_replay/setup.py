@@ -0,0 +1,10 @@
+from distutils.core import setup
+from catkin_pkg.python_setup import generate_distutils_setup
+
+
+setup_args = generate_distutils_setup(
+    packages=['mr3d_replay'],
+    package_dir={'': 'src'},
+)
+
+setup(**setup_args)
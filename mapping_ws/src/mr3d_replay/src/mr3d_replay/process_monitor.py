@@ -0,0 +1,147 @@
+# /**
+# * This file is part of the ROS package mr3d_replay which belongs to the framework 3DMR.
+# *
+# * Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+# * For more information see <https://github.com/luigifreda/3dmr>
+# *
+# * 3DMR is free software: you can redistribute it and/or modify
+# * it under the terms of the GNU General Public License as published by
+# * the Free Software Foundation, either version 3 of the License, or
+# * (at your option) any later version.
+# *
+# * 3DMR is distributed in the hope that it will be useful,
+# * but WITHOUT ANY WARRANTY; without even the implied warranty of
+# * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# * GNU General Public License for more details.
+# *
+# * You should have received a copy of the GNU General Public License
+# * along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+# */
+
+# CPU and memory of the monitored node processes, read from /proc (Linux only, local nodes only)
+
+import os
+import time
+
+try:
+    import xmlrpc.client as xmlrpclib  # python 3
+except ImportError:
+    import xmlrpclib  # python 2
+
+import rosnode
+import rosgraph
+
+
+kClockTicks = float(os.sysconf('SC_CLK_TCK'))
+
+
+def get_node_pid(node_name, caller_id):
+    """ pid of a node (through its slave API), None if the node is not found """
+    try:
+        uri = rosnode.get_api_uri(rosgraph.Master(caller_id), node_name)
+        if not uri:
+            return None
+        code, _, pid = xmlrpclib.ServerProxy(uri).getPid(caller_id)
+        return pid if code == 1 else None
+    except Exception:
+        return None
+
+
+def shutdown_node(node_name, caller_id, reason='replay done'):
+    """ ask a node to shut down (the same request as rosnode kill), return True on success """
+    try:
+        uri = rosnode.get_api_uri(rosgraph.Master(caller_id), node_name)
+        if not uri:
+            return False
+        code, _, _ = xmlrpclib.ServerProxy(uri).shutdown(caller_id, reason)
+        return code == 1
+    except Exception:
+        return False
+
+
+def read_cpu_sec(pid):
+    """ user + system CPU time of all the threads of the process [s], None if the process is gone """
+    try:
+        with open('/proc/%d/stat' % pid) as f:
+            stat = f.read()
+    except (IOError, OSError):
+        return None
+    # the command name (2nd field) may contain spaces: parse after its closing parenthesis
+    fields = stat[stat.rfind(')') + 2:].split()
+    return (int(fields[11]) + int(fields[12])) / kClockTicks  # utime, stime (fields 14, 15 of proc(5))
+
+
+def read_rss_mb(pid):
+    """ resident set size of the process [MB], None if the process is gone """
+    try:
+        with open('/proc/%d/status' % pid) as f:
+            for line in f:
+                if line.startswith('VmRSS:'):
+                    return int(line.split()[1]) / 1024.
+    except (IOError, OSError):
+        pass
+    return None
+
+
+class ProcessMonitor(object):
+    """ CPU time and peak memory of a set of nodes, and pipeline quiescence (all the nodes idle) """
+
+    def __init__(self, node_names, caller_id):
+        self.pids = {}  # node name -> pid
+        for node_name in node_names:
+            pid = get_node_pid(node_name, caller_id)
+            if pid is not None and read_cpu_sec(pid) is not None:
+                self.pids[node_name] = pid
+        self.missing = [node_name for node_name in node_names if node_name not in self.pids]
+
+        self.start_cpu_sec = {}
+        self.cpu_sec = {}
+        self.peak_rss_mb = {}
+        self.start_wall = time.time()
+        for node_name, pid in self.pids.items():
+            self.start_cpu_sec[node_name] = self.cpu_sec[node_name] = read_cpu_sec(pid)
+            self.peak_rss_mb[node_name] = read_rss_mb(pid) or 0.
+
+    def sample(self):
+        """ update the CPU times and the peak RSS, return the total CPU time of the nodes [s] """
+        total = 0.
+        for node_name, pid in self.pids.items():
+            cpu_sec = read_cpu_sec(pid)
+            if cpu_sec is not None:
+                self.cpu_sec[node_name] = cpu_sec
+            rss_mb = read_rss_mb(pid)
+            if rss_mb is not None:
+                # sampled instead of VmHWM, which would include the peak of the startup (before the replay)
+                self.peak_rss_mb[node_name] = max(self.peak_rss_mb[node_name], rss_mb)
+            total += self.cpu_sec[node_name]
+        return total
+
+    def wait_quiescence(self, min_wait, idle_window, idle_cpu_fraction, timeout, poll_period=0.005):
+        """ wait until the nodes have used less than idle_cpu_fraction of a CPU over idle_window seconds
+            (at least min_wait seconds after the call); return False on timeout """
+        start = time.time()
+        time.sleep(min_wait)
+        window_start = time.time()
+        window_cpu = self.sample()
+        while True:
+            time.sleep(poll_period)
+            now = time.time()
+            cpu = self.sample()
+            if cpu - window_cpu > idle_cpu_fraction * max(now - window_start, idle_window):
+                window_start, window_cpu = now, cpu  # still busy: restart the window
+            elif now - window_start >= idle_window:
+                return True
+            if now - start > timeout:
+                return False
+
+    def get_stats(self, node_names):
+        """ CPU time, mean CPU usage and peak RSS of a group of nodes (over the monitored ones) """
+        wall = max(time.time() - self.start_wall, 1e-9)
+        nodes = [node_name for node_name in node_names if node_name in self.pids]
+        cpu_sec = sum(self.cpu_sec[node_name] - self.start_cpu_sec[node_name] for node_name in nodes)
+        return {
+            'nodes': nodes,
+            'cpu_sec': cpu_sec,
+            'cpu_percent': 100. * cpu_sec / wall,
+            'peak_rss_mb': sum(self.peak_rss_mb[node_name] for node_name in nodes),
+        }
@@ -0,0 +1,157 @@
+# /**
+# * This file is part of the ROS package mr3d_replay which belongs to the framework 3DMR.
+# *
+# * Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+# * For more information see <https://github.com/luigifreda/3dmr>
+# *
+# * 3DMR is free software: you can redistribute it and/or modify
+# * it under the terms of the GNU General Public License as published by
+# * the Free Software Foundation, either version 3 of the License, or
+# * (at your option) any later version.
+# *
+# * 3DMR is distributed in the hope that it will be useful,
+# * but WITHOUT ANY WARRANTY; without even the implied warranty of
+# * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# * GNU General Public License for more details.
+# *
+# * You should have received a copy of the GNU General Public License
+# * along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+# */
+
+# replay report: latency stats, profiler stats files (see mr3d_profiling/ProfilerExporter.h) and baseline comparison
+
+import json
+import math
+
+
+kProfilerStatsFields = ['n', 'mean', 'p50', 'p95', 'p99', 'max']  # after the time and zone fields; durations in ms
+
+kDefaultTolerances = {
+    'latency': 0.25,         # max relative increase of the latencies (mean, p95)
+    'cpu': 0.25,             # max relative increase of the CPU time
+    'memory': 0.15,          # max relative increase of the peak RSS
+    'min_latency_ms': 1.0,   # latency increases below this are ignored (timer resolution, scheduling noise)
+    'min_cpu_sec': 0.5,      # CPU time increases below this are ignored (10 ms /proc ticks)
+    'min_memory_mb': 10.0,   # peak RSS increases below this are ignored
+}
+
+
+def get_quantile(sorted_values, q):
+    """ q-quantile of sorted values (linear interpolation between the closest ranks) """
+    if not sorted_values:
+        return 0.
+    rank = q * (len(sorted_values) - 1)
+    lower = int(math.floor(rank))
+    upper = min(lower + 1, len(sorted_values) - 1)
+    return sorted_values[lower] + (sorted_values[upper] - sorted_values[lower]) * (rank - lower)
+
+
+def get_latency_stats(values_ms):
+    """ n, mean, p50, p95, p99, max of a list of latencies [ms] """
+    values = sorted(values_ms)
+    return {
+        'n': len(values),
+        'mean': sum(values) / len(values) if values else 0.,
+        'p50': get_quantile(values, 0.5),
+        'p95': get_quantile(values, 0.95),
+        'p99': get_quantile(values, 0.99),
+        'max': values[-1] if values else 0.,
+    }
+
+
+def get_file_size(file_name):
+    """ size of a file [bytes], 0 if it does not exist """
+    try:
+        with open(file_name, 'rb') as f:
+            f.seek(0, 2)
+            return f.tell()
+    except (IOError, OSError):
+        return 0
+
+
+def read_profiler_totals(file_name, offset=0):
+    """ zone -> stats of the last "total" block of a profiler stats file (written when the exporter stops), reading
+        from offset (the stats files are appended run after run); empty if there is no such block (e.g. the node did
+        not stop cleanly) """
+    blocks = []
+    in_block = False
+    try:
+        with open(file_name) as f:
+            f.seek(offset)
+            for line in f:
+                fields = line.rstrip('\n').split('\t')
+                if len(fields) != 2 + len(kProfilerStatsFields):
+                    continue
+                if fields[0] != 'total':
+                    in_block = False
+                    continue
+                if not in_block:
+                    blocks.append({})
+                    in_block = True
+                stats = dict(zip(kProfilerStatsFields, [float(value) for value in fields[2:]]))
+                stats['n'] = int(stats['n'])
+                blocks[-1][fields[1]] = stats
+    except (IOError, OSError):
+        return {}
+    return blocks[-1] if blocks else {}
+
+
+def _is_regression(current, baseline, tolerance, min_increase):
+    return current - baseline > max(tolerance * baseline, min_increase)
+
+
+def compare_with_baseline(report, baseline, tolerances=None):
+    """ list of the regressions of the report with respect to the baseline (empty if none):
+        - determinism: the count and digest of each checked output topic must match exactly
+        - performance: latencies, CPU time and peak RSS within the relative tolerances """
+    tol = dict(kDefaultTolerances)
+    tol.update(tolerances or {})
+    regressions = []
+
+    def check(what, current, base, tolerance, min_increase, unit):
+        if _is_regression(current, base, tolerance, min_increase):
+            regressions.append('%s: %.3f %s (baseline %.3f %s, +%.1f%%)' %
+                               (what, current, unit, base, unit, 100. * (current - base) / max(base, 1e-9)))
+
+    for stage_name, base_stage in baseline.get('stages', {}).items():
+        stage = report.get('stages', {}).get(stage_name)
+        if stage is None:
+            regressions.append('%s: stage missing from the report' % stage_name)
+            continue
+
+        for topic, base_output in base_stage.get('outputs', {}).items():
+            output = stage.get('outputs', {}).get(topic)
+            if output is None:
+                regressions.append('%s: output %s missing from the report' % (stage_name, topic))
+            elif output['count'] != base_output['count'] or output.get('digest') != base_output.get('digest'):
+                regressions.append('%s: output %s differs from the baseline (count %d vs %d, digest %s vs %s): the replay is not deterministic'
+                                   % (stage_name, topic, output['count'], base_output['count'], output.get('digest'), base_output.get('digest')))
+
+        for key in ['mean', 'p95']:
+            if 'latency_ms' in base_stage and 'latency_ms' in stage and base_stage['latency_ms']['n'] > 0:
+                check('%s latency %s' % (stage_name, key), stage['latency_ms'][key], base_stage['latency_ms'][key],
+                      tol['latency'], tol['min_latency_ms'], 'ms')
+            for zone, base_zone in base_stage.get('zones', {}).items():
+                zone_stats = stage.get('zones', {}).get(zone)
+                if zone_stats is not None:
+                    check('%s zone %s %s' % (stage_name, zone, key), zone_stats[key], base_zone[key],
+                          tol['latency'], tol['min_latency_ms'], 'ms')
+
+        if 'cpu_sec' in base_stage and 'cpu_sec' in stage:
+            check('%s cpu' % stage_name, stage['cpu_sec'], base_stage['cpu_sec'], tol['cpu'], tol['min_cpu_sec'], 's')
+        if 'peak_rss_mb' in base_stage and 'peak_rss_mb' in stage:
+            check('%s peak rss' % stage_name, stage['peak_rss_mb'], base_stage['peak_rss_mb'],
+                  tol['memory'], tol['min_memory_mb'], 'MB')
+
+    return regressions
+
+
+def load_json(file_name):
+    with open(file_name) as f:
+        return json.load(f)
+
+
+def save_json(data, file_name):
+    with open(file_name, 'w') as f:
+        json.dump(data, f, indent=2, sort_keys=True)
+        f.write('\n')
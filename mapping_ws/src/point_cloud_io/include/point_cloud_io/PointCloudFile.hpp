@@ -0,0 +1,96 @@
+/*
+ * PointCloudFile.hpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: Luigi Freda
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ROS
+#include <sensor_msgs/PointCloud2.h>
+
+namespace point_cloud_io {
+
+/*!
+ * The points of a .ply, .vtk or .pcd file, in the PointCloud2 layout.
+ * The data of a binary .pcd file is memory-mapped, not read: the loading only parses the header and the
+ * points are paged in from the file when they are accessed. The other formats are loaded in memory.
+ */
+class PointCloudFile {
+ public:
+  /*!
+   * Constructor.
+   */
+  PointCloudFile() = default;
+
+  /*!
+   * Destructor.
+   */
+  virtual ~PointCloudFile();
+
+  PointCloudFile(const PointCloudFile&) = delete;
+  PointCloudFile& operator=(const PointCloudFile&) = delete;
+
+  /*!
+   * Loads (or maps) the point cloud of a file.
+   * @param filePath the path to the .ply, .vtk or .pcd file.
+   * @return true if successful.
+   */
+  bool load(const std::string& filePath);
+
+  /*!
+   * Frees the loaded (or mapped) points. The fields and the sizes are kept.
+   */
+  void release();
+
+  /*!
+   * @return the points, nullptr if they are not loaded.
+   */
+  const uint8_t* getData() const { return data_; }
+
+  /*!
+   * @return the point at the given index.
+   */
+  const uint8_t* getPoint(size_t index) const { return data_ + index * cloud_.point_step; }
+
+  const std::vector<sensor_msgs::PointField>& getFields() const { return cloud_.fields; }
+  uint32_t getPointStep() const { return cloud_.point_step; }
+  uint32_t getWidth() const { return cloud_.width; }
+  uint32_t getHeight() const { return cloud_.height; }
+  size_t getNumPoints() const { return static_cast<size_t>(cloud_.width) * cloud_.height; }
+  bool isDense() const { return cloud_.is_dense; }
+  bool isMemoryMapped() const { return mappedAddress_ != nullptr; }
+
+ private:
+  /*!
+   * Loads a .pcd file, mapping its data if they are stored as binary.
+   * @param filePath the path to the .pcd file.
+   * @return true if successful.
+   */
+  bool loadPcd(const std::string& filePath);
+
+  /*!
+   * Maps the file and points the data at the given offset.
+   * @param filePath the path to the file.
+   * @param dataOffset the offset of the points in the file [bytes].
+   * @return true if successful.
+   */
+  bool map(const std::string& filePath, size_t dataOffset);
+
+  //! Fields and sizes of the point cloud, and its data if they are loaded in memory.
+  sensor_msgs::PointCloud2 cloud_;
+
+  //! The points (in cloud_.data or in the mapped file).
+  const uint8_t* data_ = nullptr;
+
+  //! Mapped file.
+  void* mappedAddress_ = nullptr;
+  size_t mappedLength_ = 0u;
+};
+
+}  // namespace point_cloud_io
@@ -0,0 +1,98 @@
+/*
+ * PointCloudTiles.hpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: Luigi Freda
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "point_cloud_io/PointCloudFile.hpp"
+#include "point_cloud_io/SerializedPointCloud2.hpp"
+
+namespace point_cloud_io {
+
+/*!
+ * Splits a point cloud in square tiles on the xy plane, to publish a large map in chunks.
+ * A tile only stores the indices of its points. Its serialized PointCloud2 is built on the first request and
+ * cached, up to a maximum number of cached tiles (the least recently requested ones are dropped first).
+ */
+class PointCloudTiles {
+ public:
+  /*!
+   * Constructor.
+   */
+  PointCloudTiles() = default;
+
+  /*!
+   * Destructor.
+   */
+  virtual ~PointCloudTiles() = default;
+
+  /*!
+   * Assigns the points of the file to the tiles. The points with NaN x or y are discarded.
+   * @param file the point cloud, it must be kept loaded while the bodies of the tiles are requested.
+   * @param tileSize the side of the tiles [m].
+   * @return true if successful (the cloud has FLOAT32 x and y fields).
+   */
+  bool build(const PointCloudFile& file, double tileSize);
+
+  /*!
+   * Sets the maximum number of cached tile bodies.
+   * @param maxNumCachedTiles the maximum number of cached tiles, 0 for no limit.
+   */
+  void setMaxNumCachedTiles(size_t maxNumCachedTiles) { maxNumCachedTiles_ = maxNumCachedTiles; }
+
+  /*!
+   * Gets the indices of the tiles that intersect a disk, sorted by increasing distance from its center.
+   * @param x the x coordinate of the center [m].
+   * @param y the y coordinate of the center [m].
+   * @param radius the radius of the disk [m].
+   * @return the indices of the tiles.
+   */
+  std::vector<size_t> getTilesInRadius(double x, double y, double radius) const;
+
+  /*!
+   * Gets the serialized PointCloud2 of a tile.
+   * @param tile the index of the tile.
+   * @param file the point cloud the tiles were built from (only accessed if the tile is not cached).
+   * @return the serialized body.
+   */
+  SerializedPointCloud2::Body getBody(size_t tile, const PointCloudFile& file);
+
+  /*!
+   * @return true if the bodies of all the tiles are cached (the point cloud is not needed anymore).
+   */
+  bool isFullyCached() const { return numCachedTiles_ == tiles_.size(); }
+
+  size_t size() const { return tiles_.size(); }
+  bool empty() const { return tiles_.empty(); }
+
+ private:
+  struct Tile {
+    //! Index of the tile in the xy grid.
+    int ix = 0;
+    int iy = 0;
+    //! Indices of the points in the cloud.
+    std::vector<uint32_t> points;
+    //! Cached serialized PointCloud2.
+    SerializedPointCloud2::Body body;
+    //! Value of requestCounter_ at the last request.
+    uint64_t lastRequest = 0u;
+  };
+
+  //! Drops the least recently requested bodies beyond maxNumCachedTiles_.
+  void evictBodies();
+
+  std::vector<Tile> tiles_;
+  double tileSize_ = 0.0;
+
+  size_t maxNumCachedTiles_ = 0u;
+  size_t numCachedTiles_ = 0u;
+  uint64_t requestCounter_ = 0u;
+};
+
+}  // namespace point_cloud_io
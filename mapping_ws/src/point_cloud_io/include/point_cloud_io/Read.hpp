@@ -8,9 +8,17 @@
 
 #pragma once
 
+#include <memory>
+#include <set>
+
 // ROS
 #include <ros/ros.h>
 #include <sensor_msgs/PointCloud2.h>
+#include <tf2_ros/transform_listener.h>
+
+#include "point_cloud_io/PointCloudFile.hpp"
+#include "point_cloud_io/PointCloudTiles.hpp"
+#include "point_cloud_io/SerializedPointCloud2.hpp"
 
 namespace point_cloud_io {
 
@@ -40,12 +48,11 @@ class Read {
   void initialize();
 
   /*!
-   * Read the point cloud from a .ply or .vtk file.
-   * @param filePath the path to the .ply or .vtk file.
-   * @param pointCloudFrameId the id of the frame of the point cloud data.
+   * Read the point cloud from a .ply, .vtk or .pcd file.
+   * @param filePath the path to the .ply, .vtk or .pcd file.
    * @return true if successful.
    */
-  bool readFile(const std::string& filePath, const std::string& pointCloudFrameId);
+  bool readFile(const std::string& filePath);
 
   /*!
    * Timer callback function.
@@ -54,16 +61,50 @@ class Read {
   void timerCallback(const ros::TimerEvent& timerEvent);
 
   /*!
-   * Publish the point cloud as a PointCloud2.
+   * Publish the point cloud (or the next tiles) as a PointCloud2.
    * @return true if successful.
    */
   bool publish();
 
+  /*!
+   * Publish the next tiles, in round-robin.
+   * @param numTiles the number of tiles to publish.
+   */
+  void publishNextTiles(size_t numTiles);
+
+  /*!
+   * Publish the tiles that entered the query radius around the query frame since the last call.
+   * @return true if successful.
+   */
+  bool publishTilesAroundQuery();
+
+  /*!
+   * Publish a serialized point cloud.
+   * @param body the serialized point cloud.
+   */
+  void publishBody(const SerializedPointCloud2::Body& body);
+
+  /*!
+   * Releases the point cloud file once all the tiles are cached.
+   */
+  void releaseFileIfCached();
+
+  /*!
+   * @return true if the point cloud is published in tiles.
+   */
+  bool isTiled() const { return tileSize_ > 0.0; }
+
   //! ROS node handle.
   ros::NodeHandle& nodeHandle_;
 
-  //! Point cloud message to publish.
-  sensor_msgs::PointCloud2::Ptr pointCloudMessage_;
+  //! Loaded (or memory-mapped) point cloud file.
+  PointCloudFile pointCloudFile_;
+
+  //! Serialized point cloud to publish (if not tiled).
+  SerializedPointCloud2::Body pointCloudBody_;
+
+  //! Tiles of the point cloud (if tiled).
+  PointCloudTiles tiles_;
 
   //! Point cloud publisher.
   ros::Publisher pointCloudPublisher_;
@@ -88,6 +129,30 @@ class Read {
 
   //! Duration between publishing steps.
   ros::Duration updateDuration_;
+
+  //! Side of the tiles [m], 0 to publish the whole point cloud.
+  double tileSize_ = 0.0;
+
+  //! Maximum number of tiles published at each step, 0 for all of them.
+  size_t tilesPerUpdate_ = 0u;
+
+  //! Next tile published in round-robin.
+  size_t nextTile_ = 0u;
+
+  /*!
+   * Frame around which the tiles are published. If empty, all the tiles are streamed in round-robin.
+   */
+  std::string queryFrame_;
+
+  //! Radius around the query frame [m].
+  double queryRadius_ = 0.0;
+
+  //! Tiles already published which are still in the query radius.
+  std::set<size_t> publishedTiles_;
+
+  //! TF buffer and listener, for the query frame.
+  tf2_ros::Buffer tfBuffer_;
+  std::unique_ptr<tf2_ros::TransformListener> tfListener_;
 };
 
 }  // namespace point_cloud_io
@@ -0,0 +1,96 @@
+/*
+ * SerializedPointCloud2.hpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: Luigi Freda
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Boost
+#include <boost/shared_ptr.hpp>
+
+// ROS
+#include <ros/ros.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <std_msgs/Header.h>
+
+namespace point_cloud_io {
+
+/*!
+ * A PointCloud2 whose content (everything but the header) is kept already serialized.
+ * It is published on PointCloud2 topics (see the message traits below): a republish only writes the
+ * new header and copies the cached bytes, the fields and the data are not serialized again.
+ */
+struct SerializedPointCloud2 {
+  using Ptr = boost::shared_ptr<SerializedPointCloud2>;
+  using ConstPtr = boost::shared_ptr<const SerializedPointCloud2>;
+
+  //! Serialized height, width, fields, is_bigendian, point_step, row_step, data and is_dense.
+  using Body = boost::shared_ptr<const std::vector<uint8_t>>;
+
+  /*!
+   * Serializes the content of a PointCloud2.
+   * @param fields the point fields.
+   * @param pointStep the size of a point [bytes].
+   * @param width the width of the cloud.
+   * @param height the height of the cloud.
+   * @param isDense true if the cloud has no invalid points.
+   * @param writeData writes the width * height points to the given buffer.
+   * @return the serialized body.
+   */
+  static Body serializeBody(const std::vector<sensor_msgs::PointField>& fields, uint32_t pointStep, uint32_t width,
+                            uint32_t height, bool isDense, const std::function<void(uint8_t*)>& writeData);
+
+  std_msgs::Header header;
+  Body body;
+};
+
+}  // namespace point_cloud_io
+
+namespace ros {
+namespace message_traits {
+
+template <>
+struct MD5Sum<point_cloud_io::SerializedPointCloud2> {
+  static const char* value() { return MD5Sum<sensor_msgs::PointCloud2>::value(); }
+  static const char* value(const point_cloud_io::SerializedPointCloud2& /*m*/) { return value(); }
+};
+
+template <>
+struct DataType<point_cloud_io::SerializedPointCloud2> {
+  static const char* value() { return DataType<sensor_msgs::PointCloud2>::value(); }
+  static const char* value(const point_cloud_io::SerializedPointCloud2& /*m*/) { return value(); }
+};
+
+template <>
+struct Definition<point_cloud_io::SerializedPointCloud2> {
+  static const char* value() { return Definition<sensor_msgs::PointCloud2>::value(); }
+  static const char* value(const point_cloud_io::SerializedPointCloud2& /*m*/) { return value(); }
+};
+
+}  // namespace message_traits
+
+namespace serialization {
+
+//! Same wire format of sensor_msgs::PointCloud2.
+template <>
+struct Serializer<point_cloud_io::SerializedPointCloud2> {
+  template <typename Stream>
+  inline static void write(Stream& stream, const point_cloud_io::SerializedPointCloud2& m) {
+    stream.next(m.header);
+    std::copy(m.body->begin(), m.body->end(), stream.advance(m.body->size()));
+  }
+
+  inline static uint32_t serializedLength(const point_cloud_io::SerializedPointCloud2& m) {
+    return serializationLength(m.header) + m.body->size();
+  }
+};
+
+}  // namespace serialization
+}  // namespace ros
@@ -0,0 +1,125 @@
+/*
+ * PointCloudFile.cpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: Luigi Freda
+ */
+
+#include "point_cloud_io/PointCloudFile.hpp"
+
+// POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// PCL
+#include <pcl/io/pcd_io.h>
+#include <pcl/io/ply_io.h>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#include <pcl_conversions/pcl_conversions.h>
+// define the following in order to eliminate the deprecated headers warning
+#define VTK_EXCLUDE_STRSTREAM_HEADERS
+#include <pcl/io/vtk_lib_io.h>
+
+// ROS
+#include <ros/ros.h>
+
+namespace point_cloud_io {
+
+PointCloudFile::~PointCloudFile() {
+  release();
+}
+
+bool PointCloudFile::load(const std::string& filePath) {
+  release();
+  if (filePath.find(".ply") != std::string::npos) {
+    // Load .ply file.
+    pcl::PointCloud<pcl::PointXYZRGBNormal> pointCloud;
+    if (pcl::io::loadPLYFile(filePath, pointCloud) != 0) {
+      return false;
+    }
+    pcl::toROSMsg(pointCloud, cloud_);
+  } else if (filePath.find(".vtk") != std::string::npos) {
+    // Load .vtk file.
+    pcl::PolygonMesh polygonMesh;
+    pcl::io::loadPolygonFileVTK(filePath, polygonMesh);
+    pcl_conversions::moveFromPCL(polygonMesh.cloud, cloud_);
+  } else if (filePath.find(".pcd") != std::string::npos) {
+    return loadPcd(filePath);
+  } else {
+    ROS_ERROR_STREAM("Data format not supported.");
+    return false;
+  }
+
+  data_ = cloud_.data.data();
+  return true;
+}
+
+bool PointCloudFile::loadPcd(const std::string& filePath) {
+  pcl::PCDReader reader;
+  pcl::PCLPointCloud2 cloud;
+  Eigen::Vector4f origin;
+  Eigen::Quaternionf orientation;
+  int pcdVersion = 0;
+  int dataType = 0;
+  unsigned int dataOffset = 0u;
+  if (reader.readHeader(filePath, cloud, origin, orientation, pcdVersion, dataType, dataOffset) != 0) {
+    return false;
+  }
+
+  // Binary data: map the file, the points are read when they are accessed.
+  const int kBinaryDataType = 1;
+  if (dataType == kBinaryDataType) {
+    pcl_conversions::moveFromPCL(cloud, cloud_);
+    if (map(filePath, dataOffset)) {
+      return true;
+    }
+    ROS_WARN_STREAM("Could not map the file " << filePath << ", loading it in memory.");
+  }
+
+  // Ascii or compressed data.
+  if (reader.read(filePath, cloud) != 0) {
+    return false;
+  }
+  pcl_conversions::moveFromPCL(cloud, cloud_);
+  data_ = cloud_.data.data();
+  return true;
+}
+
+bool PointCloudFile::map(const std::string& filePath, size_t dataOffset) {
+  const int fd = open(filePath.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat fileStat;
+  const size_t dataSize = getNumPoints() * cloud_.point_step;
+  if (fstat(fd, &fileStat) != 0 || static_cast<size_t>(fileStat.st_size) < dataOffset + dataSize) {
+    ROS_ERROR_STREAM("The file " << filePath << " is shorter than its header says.");
+    close(fd);
+    return false;
+  }
+
+  void* address = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);  // The mapping keeps the file open.
+  if (address == MAP_FAILED) {
+    return false;
+  }
+  mappedAddress_ = address;
+  mappedLength_ = fileStat.st_size;
+  data_ = static_cast<const uint8_t*>(address) + dataOffset;
+  return true;
+}
+
+void PointCloudFile::release() {
+  if (mappedAddress_ != nullptr) {
+    munmap(mappedAddress_, mappedLength_);
+    mappedAddress_ = nullptr;
+    mappedLength_ = 0u;
+  }
+  std::vector<uint8_t>().swap(cloud_.data);
+  data_ = nullptr;
+}
+
+}  // namespace point_cloud_io
@@ -0,0 +1,140 @@
+/*
+ * PointCloudTiles.cpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: Luigi Freda
+ */
+
+#include "point_cloud_io/PointCloudTiles.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+
+// ROS
+#include <ros/ros.h>
+
+namespace point_cloud_io {
+
+namespace {
+
+bool getFloatFieldOffset(const std::vector<sensor_msgs::PointField>& fields, const std::string& name,
+                         uint32_t& offset) {
+  for (const auto& field : fields) {
+    if (field.name == name && field.datatype == sensor_msgs::PointField::FLOAT32) {
+      offset = field.offset;
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+bool PointCloudTiles::build(const PointCloudFile& file, double tileSize) {
+  tiles_.clear();
+  numCachedTiles_ = 0u;
+  tileSize_ = tileSize;
+
+  uint32_t xOffset = 0u;
+  uint32_t yOffset = 0u;
+  if (!getFloatFieldOffset(file.getFields(), "x", xOffset) || !getFloatFieldOffset(file.getFields(), "y", yOffset)) {
+    ROS_ERROR_STREAM("The point cloud has no float x and y fields, it cannot be tiled.");
+    return false;
+  }
+  if (file.getNumPoints() > std::numeric_limits<uint32_t>::max()) {
+    ROS_ERROR_STREAM("The point cloud has too many points to be tiled.");
+    return false;
+  }
+
+  // Single pass over the points, in file order (sequential reads of a mapped file).
+  std::unordered_map<uint64_t, size_t> tileIndices;
+  for (size_t i = 0u; i < file.getNumPoints(); ++i) {
+    const uint8_t* point = file.getPoint(i);
+    float x, y;
+    std::memcpy(&x, point + xOffset, sizeof(float));
+    std::memcpy(&y, point + yOffset, sizeof(float));
+    if (!std::isfinite(x) || !std::isfinite(y)) {
+      continue;
+    }
+    const int ix = static_cast<int>(std::floor(x / tileSize_));
+    const int iy = static_cast<int>(std::floor(y / tileSize_));
+    const uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(ix)) << 32) | static_cast<uint32_t>(iy);
+    const auto inserted = tileIndices.emplace(key, tiles_.size());
+    if (inserted.second) {
+      tiles_.emplace_back();
+      tiles_.back().ix = ix;
+      tiles_.back().iy = iy;
+    }
+    tiles_[inserted.first->second].points.push_back(static_cast<uint32_t>(i));
+  }
+
+  for (auto& tile : tiles_) {
+    tile.points.shrink_to_fit();
+  }
+  ROS_INFO_STREAM("Split the point cloud in " << tiles_.size() << " tiles of " << tileSize_ << " m.");
+  return true;
+}
+
+std::vector<size_t> PointCloudTiles::getTilesInRadius(double x, double y, double radius) const {
+  std::vector<std::pair<double, size_t>> squaredDistances;
+  for (size_t i = 0u; i < tiles_.size(); ++i) {
+    // Distance between the center and the closest point of the tile.
+    const double minX = tiles_[i].ix * tileSize_;
+    const double minY = tiles_[i].iy * tileSize_;
+    const double dx = std::max(std::max(minX - x, x - (minX + tileSize_)), 0.0);
+    const double dy = std::max(std::max(minY - y, y - (minY + tileSize_)), 0.0);
+    const double squaredDistance = dx * dx + dy * dy;
+    if (squaredDistance <= radius * radius) {
+      squaredDistances.emplace_back(squaredDistance, i);
+    }
+  }
+  std::sort(squaredDistances.begin(), squaredDistances.end());
+
+  std::vector<size_t> tiles;
+  tiles.reserve(squaredDistances.size());
+  for (const auto& squaredDistance : squaredDistances) {
+    tiles.push_back(squaredDistance.second);
+  }
+  return tiles;
+}
+
+SerializedPointCloud2::Body PointCloudTiles::getBody(size_t tile, const PointCloudFile& file) {
+  Tile& requestedTile = tiles_.at(tile);
+  requestedTile.lastRequest = ++requestCounter_;
+  if (requestedTile.body) {
+    return requestedTile.body;
+  }
+
+  const uint32_t pointStep = file.getPointStep();
+  const std::vector<uint32_t>& points = requestedTile.points;
+  const auto writeData = [&](uint8_t* data) {
+    for (const uint32_t point : points) {
+      std::memcpy(data, file.getPoint(point), pointStep);
+      data += pointStep;
+    }
+  };
+  requestedTile.body =
+      SerializedPointCloud2::serializeBody(file.getFields(), pointStep, points.size(), 1u, file.isDense(), writeData);
+  ++numCachedTiles_;
+  evictBodies();
+  return requestedTile.body;
+}
+
+void PointCloudTiles::evictBodies() {
+  while (maxNumCachedTiles_ > 0u && numCachedTiles_ > maxNumCachedTiles_) {
+    Tile* oldestTile = nullptr;
+    for (auto& tile : tiles_) {
+      if (tile.body && (oldestTile == nullptr || tile.lastRequest < oldestTile->lastRequest)) {
+        oldestTile = &tile;
+      }
+    }
+    oldestTile->body.reset();  // Still alive while it is being published.
+    --numCachedTiles_;
+  }
+}
+
+}  // namespace point_cloud_io
@@ -8,22 +8,20 @@
 
 #include "point_cloud_io/Read.hpp"
 
-// PCL
-#include <pcl/io/ply_io.h>
-#include <pcl/point_cloud.h>
-#include <pcl/point_types.h>
-#include <pcl_conversions/pcl_conversions.h>
-// define the following in order to eliminate the deprecated headers warning
-#define VTK_EXCLUDE_STRSTREAM_HEADERS
-#include <pcl/io/vtk_lib_io.h>
+#include <algorithm>
+#include <cstring>
+#include <limits>
 
 namespace point_cloud_io {
 
-Read::Read(ros::NodeHandle& nodeHandle) : nodeHandle_(nodeHandle), pointCloudMessage_(new sensor_msgs::PointCloud2()) {
+Read::Read(ros::NodeHandle& nodeHandle) : nodeHandle_(nodeHandle) {
   if (!readParameters()) {
     ros::requestShutdown();
   }
-  pointCloudPublisher_ = nodeHandle_.advertise<sensor_msgs::PointCloud2>(pointCloudTopic_, 1, true);
+  pointCloudPublisher_ = nodeHandle_.advertise<SerializedPointCloud2>(pointCloudTopic_, 1, !isTiled());
+  if (!queryFrame_.empty()) {
+    tfListener_.reset(new tf2_ros::TransformListener(tfBuffer_));
+  }
   initialize();
 }
 
@@ -42,6 +40,16 @@ bool Read::readParameters() {
     updateDuration_.fromSec(1.0 / updateRate);
   }
 
+  nodeHandle_.param("tile_size", tileSize_, 0.0);
+  int tilesPerUpdate;
+  nodeHandle_.param("tiles_per_update", tilesPerUpdate, 0);
+  tilesPerUpdate_ = std::max(tilesPerUpdate, 0);
+  int maxNumCachedTiles;
+  nodeHandle_.param("max_cached_tiles", maxNumCachedTiles, 0);
+  tiles_.setMaxNumCachedTiles(std::max(maxNumCachedTiles, 0));
+  nodeHandle_.param("query_frame", queryFrame_, std::string());
+  nodeHandle_.param("query_radius", queryRadius_, 50.0);
+
   if (!allParametersRead) {
     ROS_WARN(
         "Could not read all parameters. Typical command-line usage:\n"
@@ -49,7 +57,12 @@ bool Read::readParameters() {
         " _file_path:=/home/user/my_point_cloud.ply"
         " _topic:=/my_topic"
         " _frame:=sensor_frame"
-        " (optional: _rate:=publishing_rate)");
+        " (optional: _rate:=publishing_rate _tile_size:=tile_side_in_meters)");
+    return false;
+  }
+
+  if (!queryFrame_.empty() && (!isTiled() || !isContinuouslyPublishing_)) {
+    ROS_ERROR("The query_frame requires a tile_size and a rate.");
     return false;
   }
 
@@ -57,46 +70,48 @@ bool Read::readParameters() {
 }
 
 void Read::initialize() {
-  if (!readFile(filePath_, pointCloudFrameId_)) {
+  if (!readFile(filePath_)) {
     ros::requestShutdown();
+    return;
   }
 
   if (isContinuouslyPublishing_) {
     timer_ = nodeHandle_.createTimer(updateDuration_, &Read::timerCallback, this);
   } else {
     ros::Duration(1.0).sleep();  // Need this to get things ready before publishing.
-    if (!publish()) {
+    if (isTiled()) {
+      publishNextTiles(tiles_.size());
+    } else if (!publish()) {
       ROS_ERROR("Something went wrong when trying to read and publish the point cloud file.");
     }
     ros::requestShutdown();
   }
 }
 
-bool Read::readFile(const std::string& filePath, const std::string& pointCloudFrameId) {
-  if (filePath.find(".ply") != std::string::npos) {
-    // Load .ply file.
-    pcl::PointCloud<pcl::PointXYZRGBNormal> pointCloud;
-    if (pcl::io::loadPLYFile(filePath, pointCloud) != 0) {
-      return false;
-    }
-
-    // Define PointCloud2 message.
-    pcl::toROSMsg(pointCloud, *pointCloudMessage_);
-  } else if (filePath.find(".vtk") != std::string::npos) {
-    // Load .vtk file.
-    pcl::PolygonMesh polygonMesh;
-    pcl::io::loadPolygonFileVTK(filePath, polygonMesh);
-
-    // Define PointCloud2 message.
-    pcl_conversions::moveFromPCL(polygonMesh.cloud, *pointCloudMessage_);
-  } else {
-    ROS_ERROR_STREAM("Data format not supported.");
+bool Read::readFile(const std::string& filePath) {
+  if (!pointCloudFile_.load(filePath)) {
     return false;
   }
+  ROS_INFO_STREAM("Loaded point cloud with " << pointCloudFile_.getNumPoints() << " points"
+                                             << (pointCloudFile_.isMemoryMapped() ? " (memory-mapped)." : "."));
 
-  pointCloudMessage_->header.frame_id = pointCloudFrameId;
+  if (isTiled()) {
+    // The tiles are serialized when they are published for the first time.
+    return tiles_.build(pointCloudFile_, tileSize_);
+  }
 
-  ROS_INFO_STREAM("Loaded point cloud with " << pointCloudMessage_->height * pointCloudMessage_->width << " points.");
+  // Serialize the point cloud once, the file is not needed anymore.
+  const PointCloudFile& file = pointCloudFile_;
+  if (file.getNumPoints() * file.getPointStep() > std::numeric_limits<uint32_t>::max()) {
+    ROS_ERROR("The point cloud is too large for a single message, set a tile_size.");
+    return false;
+  }
+  const auto writeData = [&](uint8_t* data) {
+    std::memcpy(data, file.getData(), file.getNumPoints() * file.getPointStep());
+  };
+  pointCloudBody_ = SerializedPointCloud2::serializeBody(file.getFields(), file.getPointStep(), file.getWidth(),
+                                                         file.getHeight(), file.isDense(), writeData);
+  pointCloudFile_.release();
   return true;
 }
 
@@ -107,12 +122,76 @@ void Read::timerCallback(const ros::TimerEvent& /*timerEvent*/) {
 }
 
 bool Read::publish() {
-  pointCloudMessage_->header.stamp = ros::Time::now();
-  if (pointCloudPublisher_.getNumSubscribers() > 0u) {
-    pointCloudPublisher_.publish(pointCloudMessage_);
+  if (pointCloudPublisher_.getNumSubscribers() == 0u) {
+    return true;
+  }
+  if (!isTiled()) {
+    publishBody(pointCloudBody_);
     ROS_INFO_STREAM("Point cloud published to topic \"" << pointCloudTopic_ << "\".");
+    return true;
+  }
+  if (queryFrame_.empty()) {
+    publishNextTiles(tilesPerUpdate_ > 0u ? tilesPerUpdate_ : tiles_.size());
+    return true;
   }
+  return publishTilesAroundQuery();
+}
+
+void Read::publishNextTiles(size_t numTiles) {
+  numTiles = std::min(numTiles, tiles_.size());
+  for (size_t i = 0u; i < numTiles; ++i) {
+    publishBody(tiles_.getBody(nextTile_, pointCloudFile_));
+    nextTile_ = (nextTile_ + 1u) % tiles_.size();
+  }
+  releaseFileIfCached();
+  ROS_DEBUG_STREAM("Published " << numTiles << " tiles to topic \"" << pointCloudTopic_ << "\".");
+}
+
+bool Read::publishTilesAroundQuery() {
+  geometry_msgs::TransformStamped transform;
+  try {
+    transform = tfBuffer_.lookupTransform(pointCloudFrameId_, queryFrame_, ros::Time(0));
+  } catch (const tf2::TransformException& exception) {
+    ROS_WARN_STREAM_THROTTLE(5.0, "Could not get the query frame: " << exception.what());
+    return true;
+  }
+
+  // Publish the closest tiles first. The tiles that left the radius are forgotten: they are published again
+  // if they come back.
+  const std::vector<size_t> tilesInRadius =
+      tiles_.getTilesInRadius(transform.transform.translation.x, transform.transform.translation.y, queryRadius_);
+  std::set<size_t> publishedTiles;
+  size_t numPublishedTiles = 0u;
+  for (const size_t tile : tilesInRadius) {
+    if (publishedTiles_.count(tile) == 0u) {
+      if (tilesPerUpdate_ > 0u && numPublishedTiles >= tilesPerUpdate_) {
+        continue;
+      }
+      publishBody(tiles_.getBody(tile, pointCloudFile_));
+      ++numPublishedTiles;
+    }
+    publishedTiles.insert(tile);
+  }
+  publishedTiles_.swap(publishedTiles);
+  releaseFileIfCached();
+
+  ROS_DEBUG_STREAM("Published " << numPublishedTiles << " tiles to topic \"" << pointCloudTopic_ << "\".");
   return true;
 }
 
+void Read::releaseFileIfCached() {
+  if (pointCloudFile_.getData() != nullptr && tiles_.isFullyCached()) {
+    ROS_INFO("All the tiles are cached, releasing the point cloud file.");
+    pointCloudFile_.release();
+  }
+}
+
+void Read::publishBody(const SerializedPointCloud2::Body& body) {
+  SerializedPointCloud2::Ptr message(new SerializedPointCloud2());
+  message->header.frame_id = pointCloudFrameId_;
+  message->header.stamp = ros::Time::now();
+  message->body = body;
+  pointCloudPublisher_.publish(message);
+}
+
 }  // namespace point_cloud_io
@@ -0,0 +1,41 @@
+/*
+ * SerializedPointCloud2.cpp
+ *
+ *  Created on: Oct 15, 2026
+ *      Author: Luigi Freda
+ */
+
+#include "point_cloud_io/SerializedPointCloud2.hpp"
+
+namespace point_cloud_io {
+
+SerializedPointCloud2::Body SerializedPointCloud2::serializeBody(const std::vector<sensor_msgs::PointField>& fields,
+                                                                 uint32_t pointStep, uint32_t width, uint32_t height,
+                                                                 bool isDense,
+                                                                 const std::function<void(uint8_t*)>& writeData) {
+  namespace ser = ros::serialization;
+
+  const uint32_t rowStep = pointStep * width;
+  const uint32_t dataSize = rowStep * height;
+  const uint8_t isBigEndian = 0u;
+  const uint8_t isDenseByte = isDense ? 1u : 0u;
+  const uint32_t length = ser::serializationLength(height) + ser::serializationLength(width) +
+                          ser::serializationLength(fields) + ser::serializationLength(isBigEndian) +
+                          ser::serializationLength(pointStep) + ser::serializationLength(rowStep) +
+                          ser::serializationLength(dataSize) + dataSize + ser::serializationLength(isDenseByte);
+
+  boost::shared_ptr<std::vector<uint8_t>> body(new std::vector<uint8_t>(length));
+  ser::OStream stream(body->data(), length);
+  stream.next(height);
+  stream.next(width);
+  stream.next(fields);
+  stream.next(isBigEndian);
+  stream.next(pointStep);
+  stream.next(rowStep);
+  stream.next(dataSize);  // Length of the data array.
+  writeData(stream.advance(dataSize));
+  stream.next(isDenseByte);
+  return body;
+}
+
+}  // namespace point_cloud_io
@@ -150,6 +150,18 @@ public:
   Transformation T_B_D_;
 
   bool latch_topics_;
+  // Incremental publishing: the changed leaves are published on
+  // octomap_updates at each tick, the full map and its markers/point cloud
+  // only every map_keyframe_period seconds (and only if the map changed).
+  bool publish_map_updates_;
+  double map_keyframe_period_;  // [s]
+  ros::Time last_keyframe_time_;
+  bool b_changed_since_keyframe_;
+  // Publish only the markers of the changed chunks of the map, with a level
+  // of detail decreasing with the distance from the robot (see
+  // OctomapWorld::generateMarkerArrayIncremental()).
+  bool incremental_markers_;
+  Eigen::Vector3d marker_view_point_;
   // Subscriptions for input sensor data.
   ros::Subscriber disparity_sub_;
   ros::Subscriber left_info_sub_;
@@ -164,6 +176,8 @@ public:
   // Publish full state of octomap.
   ros::Publisher binary_map_pub_;
   ros::Publisher full_map_pub_;
+  // Publish the changed leaves (see publish_map_updates_).
+  ros::Publisher map_updates_pub_;
 
   // Publish voxel centroids as pcl.
   ros::Publisher nearest_obstacle_pub_;
@@ -31,6 +31,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define OCTOMAP_WORLD_OCTOMAP_WORLD_H_
 
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include <octomap/octomap.h>
 #include <octomap_msgs/Octomap.h>
@@ -54,8 +57,13 @@ struct OctomapParameters {
         sensor_max_range(5.0),
         visualize_min_z(-std::numeric_limits<double>::max()),
         visualize_max_z(std::numeric_limits<double>::max()),
+        visualize_lod_distance(0.0),
         treat_unknown_as_occupied(true),
-        change_detection_enabled(false) {
+        change_detection_enabled(false),
+        integration_num_threads(1),
+        bundle_rays(false),
+        bisect_path_collision_check(false),
+        query_num_threads(1) {
     // Set reasonable defaults here...
   }
 
@@ -89,12 +97,31 @@ struct OctomapParameters {
   // octomap, visualization.
   double visualize_min_z;
   double visualize_max_z;
+  // Level of detail of the incremental markers: beyond this distance from the
+  // view point, one depth level less per doubling of the distance (<= 0 for
+  // the full depth everywhere).
+  double visualize_lod_distance;
 
   // Collision checking.
   bool treat_unknown_as_occupied;
 
   // Whether to track changes -- must be set to true to use getChangedPoints().
   bool change_detection_enabled;
+
+  // Number of threads casting the rays of an inserted pointcloud.
+  int integration_num_threads;
+  // Cast a single ray also for the points beyond the sensor range ending (once
+  // truncated) in the same voxel: the rays of the points ending in the same
+  // voxel within the range are always bundled.
+  bool bundle_rays;
+
+  // Check the poses of a path coarse-to-fine (first, last, then bisection)
+  // instead of in time order: faster when a path collides early or late.
+  bool bisect_path_collision_check;
+
+  // Number of threads evaluating the batch queries (e.g.
+  // getCellStatusBoundingBoxBatch()).
+  int query_num_threads;
 };
 
 // A wrapper around octomap that allows insertion from various ROS message
@@ -149,6 +176,24 @@ public:
       const Eigen::Vector3d& bounding_box_size) const;
   virtual void getOccupiedPointCloud(
       pcl::PointCloud<pcl::PointXYZ>* output_cloud) const;
+  // Batch queries: (*statuses)[i] is the result of the single query with the
+  // i-th input. The queries are evaluated in the Morton (octree) order of the
+  // voxel of their (first) point, so that consecutive queries descend the same
+  // branches of the octree, in parallel with query_num_threads. They only read
+  // the map: lock it once around a batch instead of once per query.
+  void getCellStatusBoundingBoxBatch(
+      const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& points,
+      const Eigen::Vector3d& bounding_box_size,
+      std::vector<CellStatus>* statuses) const;
+  void getLineStatusBoundingBoxBatch(
+      const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& starts,
+      const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& ends,
+      const Eigen::Vector3d& bounding_box_size,
+      std::vector<CellStatus>* statuses) const;
+  void getVisibilityBatch(
+      const Eigen::Vector3d& view_point,
+      const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& voxels_to_test,
+      bool stop_at_unknown_cell, std::vector<CellStatus>* statuses) const;
   virtual void getOccupiedPointcloudInBoundingBox(
       const Eigen::Vector3d& center, const Eigen::Vector3d& bounding_box_size,
       pcl::PointCloud<pcl::PointXYZ>* output_cloud) const;
@@ -200,6 +245,18 @@ public:
   void generateMarkerArray(const std::string& tf_frame,
                            visualization_msgs::MarkerArray* occupied_nodes,
                            visualization_msgs::MarkerArray* free_nodes);
+  // Incremental markers: as generateMarkerArray(), with the map split into
+  // chunks of 2^kMarkerChunkBits voxels per side (a marker per chunk and
+  // depth). Only the markers of the chunks changed since the previous call
+  // are in the arrays: all of them after a change of the whole map or of the
+  // z bounds, or after requestFullMarkerUpdate() (e.g. for a new subscriber).
+  // See visualize_lod_distance for the depth of the chunks far from
+  // view_point.
+  void generateMarkerArrayIncremental(
+      const std::string& tf_frame, const Eigen::Vector3d& view_point,
+      visualization_msgs::MarkerArray* occupied_nodes,
+      visualization_msgs::MarkerArray* free_nodes);
+  void requestFullMarkerUpdate() { marker_full_update_ = true; }
 
   // Change detection -- when this is called, this resets the change detection
   // tracking within the map. So 2 consecutive calls will produce first the
@@ -210,6 +267,12 @@ public:
   // order for this to work!
   void getChangedPoints(std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >* changed_points,
                         std::vector<bool>* changed_states);
+  // Change detection as getChangedPoints(), but the changed leaves are stored
+  // with their log-odds in an octree serialized into msg (full octomap
+  // message): a subscriber can merge it into its copy of the map. If msg is
+  // NULL, the changes are only counted and reset. Returns the number of
+  // changed leaves.
+  size_t getChangedLeavesMsg(octomap_msgs::Octomap* msg);
 
   void coordToKey(const Eigen::Vector3d& coord, octomap::OcTreeKey* key) const;
   void keyToCoord(const octomap::OcTreeKey& key, Eigen::Vector3d* coord) const;
@@ -227,6 +290,24 @@ public:
   // Check if the node at the specified key has neighbors or not.
   bool isSpeckleNode(const octomap::OcTreeKey& key) const;
 
+  // Key of the voxels containing coordinate, clamped to the range of the tree.
+  octomap::key_type coordToKeyClamped(double coordinate) const;
+  // Indices of the points sorted by the Morton code of their (clamped) key.
+  void getMortonOrder(
+      const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& points,
+      std::vector<size_t>* order) const;
+  // Returns true if the subtree of node (at depth, with the smallest key
+  // min_key) has an occupied voxel (not a speckle) in the key box
+  // [bbx_min_key, bbx_max_key]. Sets unknown_found if the box has unknown
+  // voxels in the subtree; once it is set, only the subtrees which can contain
+  // an occupied voxel are visited. Requires up-to-date inner nodes.
+  bool searchOccupiedInKeyBox(const octomap::OcTreeNode* node,
+                              unsigned int depth,
+                              const octomap::OcTreeKey& min_key,
+                              const octomap::OcTreeKey& bbx_min_key,
+                              const octomap::OcTreeKey& bbx_max_key,
+                              bool* unknown_found) const;
+
   // Manually affect the probabilities of areas within a bounding box.
   void setLogOddsBoundingBox(const Eigen::Vector3d& position,
                              const Eigen::Vector3d& bounding_box_size,
@@ -244,8 +325,18 @@ public:
   void castRay(const octomap::point3d& sensor_origin,
                const octomap::point3d& point, octomap::KeySet* free_cells,
                octomap::KeySet* occupied_cells) const;
+  // Casts the rays of a pointcloud (in the world frame): in parallel with
+  // integration_num_threads, bundling the rays ending in the same voxel.
+  void castRays(const octomap::point3d& sensor_origin,
+                const pcl::PointCloud<pcl::PointXYZ>& cloud,
+                octomap::KeySet* free_cells,
+                octomap::KeySet* occupied_cells) const;
   void updateOccupancy(octomap::KeySet* free_cells,
                        octomap::KeySet* occupied_cells);
+  // Updates (and prunes) the inner nodes above the cells updated lazily, from
+  // the bottom up.
+  void updateInnerNodes(const octomap::KeySet& free_cells,
+                        const octomap::KeySet& occupied_cells);
   bool isValidPoint(const cv::Vec3f& point) const;
 
   void setOctomapFromBinaryMsg(const octomap_msgs::Octomap& msg);
@@ -255,9 +346,61 @@ public:
 
   // Collision checking methods.
   bool checkSinglePoseCollision(const Eigen::Vector3d& robot_position) const;
+  // Voxel -> collision, for the swept volume of a path.
+  typedef std::unordered_map<octomap::OcTreeKey, bool,
+                             octomap::OcTreeKey::KeyHash> KeyCollisionMap;
+  // Same as above, looking up only the voxels of the box which are not in
+  // collision_cache yet (and adding them).
+  bool checkSinglePoseCollision(const Eigen::Vector3d& robot_position,
+                                KeyCollisionMap* collision_cache) const;
+  bool isVoxelInCollision(const octomap::OcTreeKey& key) const;
+  // Order in which the poses of a path are checked.
+  void getPathCheckOrder(size_t num_poses, bool bisect,
+                         std::vector<size_t>* order) const;
+
+  // Occupied voxel index: the keys (at the max depth) of the occupied voxels,
+  // bucketed in blocks of 2^kOccupiedBlockBits voxels per side. It is updated
+  // with the cells of each insertion; when the whole map changes it is
+  // invalidated, and rebuilt from the leaves by the next query (not thread
+  // safe, even from the const queries).
+  typedef std::unordered_map<octomap::OcTreeKey, octomap::KeySet,
+                             octomap::OcTreeKey::KeyHash> OccupiedBlockMap;
+  void updateOccupiedIndex(const octomap::OcTreeKey& key, bool occupied);
+  void invalidateOccupiedIndex();
+  // The whole map changed: the occupied index and the incremental markers
+  // start over.
+  void markMapChanged();
+  void buildOccupiedIndex() const;
+  void insertOccupiedVoxel(const octomap::OcTreeKey& key) const;
+  bool isVoxelOccupiedInIndex(const octomap::OcTreeKey& key) const;
+  static octomap::OcTreeKey getOccupiedBlockKey(const octomap::OcTreeKey& key);
 
   std_msgs::ColorRGBA percentToColor(double h) const;
 
+  // Incremental markers (see generateMarkerArrayIncremental()).
+  struct MarkerChunk {
+    MarkerChunk()
+        : lod_depth(0),
+          node_depth(0),
+          occupied_depths(0),
+          free_depths(0),
+          update_count(0) {}
+    int lod_depth;
+    int node_depth;  // depth of the chunk node, -1 if the chunk is gone
+    uint32_t occupied_depths;  // bit mask of the depths with a marker
+    uint32_t free_depths;
+    uint64_t update_count;  // last update the chunk was in the map
+  };
+  typedef std::unordered_map<uint64_t, MarkerChunk> MarkerChunkMap;
+  void generateMarkerChunk(uint64_t chunk_code, const std::string& tf_frame,
+                           MarkerChunk* chunk,
+                           visualization_msgs::MarkerArray* occupied_nodes,
+                           visualization_msgs::MarkerArray* free_nodes);
+  int getMarkerLodDepth(uint64_t chunk_code,
+                        const Eigen::Vector3d& view_point) const;
+  // Memoized percentToColor(colorizeMapByHeight()) of the marker z bounds.
+  const std_msgs::ColorRGBA& getHeightColor(double z);
+
   std::shared_ptr<octomap::OcTree> octree_;
 
   OctomapParameters params_;
@@ -265,6 +408,23 @@ public:
   // For collision checking.
   Eigen::Vector3d robot_size_;
 
+  // Occupied voxel index (see buildOccupiedIndex()).
+  static const int kOccupiedBlockBits;
+  mutable OccupiedBlockMap occupied_blocks_;
+  mutable size_t num_occupied_voxels_;
+  mutable bool occupied_index_valid_;
+
+  // Incremental markers: chunks (by Morton code) with their published
+  // markers, and the chunks changed by the insertions since the last update.
+  static const int kMarkerChunkBits;
+  MarkerChunkMap marker_chunks_;
+  std::unordered_set<uint64_t> changed_marker_chunks_;
+  bool marker_full_update_;
+  uint64_t marker_update_count_;
+  double marker_min_z_;
+  double marker_max_z_;
+  std::unordered_map<long, std_msgs::ColorRGBA> height_colors_;
+
   // Temporary variable for KeyRay since it resizes it to a HUGE value by
   // default. Thanks a lot to @xiaopenghuang for catching this.
   octomap::KeyRay key_ray_;
@@ -47,6 +47,11 @@ OctomapManager::OctomapManager(const ros::NodeHandle& nh,
       robot_frame_("state"),
       use_tf_transforms_(true),
       latch_topics_(true),
+      publish_map_updates_(false),
+      map_keyframe_period_(10.0),
+      b_changed_since_keyframe_(true),
+      incremental_markers_(false),
+      marker_view_point_(Eigen::Vector3d::Zero()),
       timestamp_tolerance_ns_(10000000),
       Q_initialized_(false),
       Q_(Eigen::Matrix4d::Identity()),
@@ -105,6 +110,8 @@ void OctomapManager::setParametersFromROS() {
                     params.visualize_min_z);
   nh_private_.param("visualize_max_z", params.visualize_max_z,
                     params.visualize_max_z);
+  nh_private_.param("visualize_lod_distance", params.visualize_lod_distance,
+                    params.visualize_lod_distance);
   nh_private_.param("full_image_width", full_image_size_.x(),
                     full_image_size_.x());
   nh_private_.param("full_image_height", full_image_size_.y(),
@@ -116,6 +123,14 @@ void OctomapManager::setParametersFromROS() {
                     params.treat_unknown_as_occupied);
   nh_private_.param("change_detection_enabled", params.change_detection_enabled,
                     params.change_detection_enabled);
+  nh_private_.param("integration_num_threads", params.integration_num_threads,
+                    params.integration_num_threads);
+  nh_private_.param("bundle_rays", params.bundle_rays, params.bundle_rays);
+  nh_private_.param("bisect_path_collision_check",
+                    params.bisect_path_collision_check,
+                    params.bisect_path_collision_check);
+  nh_private_.param("query_num_threads", params.query_num_threads,
+                    params.query_num_threads);
 
   // Try to initialize Q matrix from parameters, if available.
   std::vector<double> Q_vec;
@@ -125,6 +140,16 @@ void OctomapManager::setParametersFromROS() {
 
   // Publisher/subscriber settings.
   nh_private_.param("latch_topics", latch_topics_, latch_topics_);
+  nh_private_.param("publish_map_updates", publish_map_updates_,
+                    publish_map_updates_);
+  nh_private_.param("map_keyframe_period", map_keyframe_period_,
+                    map_keyframe_period_);
+  nh_private_.param("incremental_markers", incremental_markers_,
+                    incremental_markers_);
+  if (publish_map_updates_) {
+    // The updates are the leaves changed since the previous tick.
+    params.change_detection_enabled = true;
+  }
 
   // Transform settings.
   nh_private_.param("use_tf_transforms", use_tf_transforms_,
@@ -229,10 +254,19 @@ void OctomapManager::advertiseServices() {
 }
 
 void OctomapManager::advertisePublishers() {
+  // With incremental markers, a new subscriber needs all the chunks.
+  ros::SubscriberStatusCallback marker_connect_callback;
+  if (incremental_markers_) {
+    marker_connect_callback = [this](const ros::SingleSubscriberPublisher&) {
+      requestFullMarkerUpdate();
+    };
+  }
   occupied_nodes_pub_ = nh_private_.advertise<visualization_msgs::MarkerArray>(
-      "octomap_occupied", 1, latch_topics_);
+      "octomap_occupied", 1, marker_connect_callback,
+      ros::SubscriberStatusCallback(), ros::VoidConstPtr(), latch_topics_);
   free_nodes_pub_ = nh_private_.advertise<visualization_msgs::MarkerArray>(
-      "octomap_free", 1, latch_topics_);
+      "octomap_free", 1, marker_connect_callback,
+      ros::SubscriberStatusCallback(), ros::VoidConstPtr(), latch_topics_);
 
   binary_map_pub_ = nh_private_.advertise<octomap_msgs::Octomap>(
       "octomap_binary", 1, latch_topics_);
@@ -241,6 +275,10 @@ void OctomapManager::advertisePublishers() {
 
   pcl_pub_ = nh_private_.advertise<sensor_msgs::PointCloud2>("octomap_pcl", 1,
                                                              latch_topics_);
+  if (publish_map_updates_) {
+    map_updates_pub_ = nh_private_.advertise<octomap_msgs::Octomap>(
+        "octomap_updates", 10, false);
+  }
   nearest_obstacle_pub_ = nh_private_.advertise<sensor_msgs::PointCloud2>(
       "nearest_obstacle", 1, false);
 
@@ -252,35 +290,83 @@ void OctomapManager::advertisePublishers() {
 }
 
 void OctomapManager::publishAll() {
-  if (latch_topics_ || occupied_nodes_pub_.getNumSubscribers() > 0 ||
-      free_nodes_pub_.getNumSubscribers() > 0) {
-    visualization_msgs::MarkerArray occupied_nodes, free_nodes;
-    generateMarkerArray(world_frame_, &occupied_nodes, &free_nodes);
-    occupied_nodes_pub_.publish(occupied_nodes);
-    free_nodes_pub_.publish(free_nodes);
+  const ros::Time now = ros::Time::now();
+  bool publish_keyframe = true;
+  if (publish_map_updates_) {
+    // The changes are consumed at each tick, even if nobody listens.
+    octomap_msgs::Octomap map_update;
+    const bool publish_update = map_updates_pub_.getNumSubscribers() > 0;
+    const size_t num_changed =
+        getChangedLeavesMsg(publish_update ? &map_update : NULL);
+    if (num_changed > 0) {
+      b_changed_since_keyframe_ = true;
+      if (publish_update) {
+        map_update.header.frame_id = world_frame_;
+        map_update.header.stamp = now;
+        map_updates_pub_.publish(map_update);
+      }
+    }
+    publish_keyframe = b_changed_since_keyframe_ &&
+                       (last_keyframe_time_.isZero() ||
+                        (now - last_keyframe_time_).toSec() >=
+                            map_keyframe_period_);
   }
 
-  if (latch_topics_ || binary_map_pub_.getNumSubscribers() > 0) {
-    octomap_msgs::Octomap binary_map;
-    getOctomapBinaryMsg(&binary_map);
-    binary_map.header.frame_id = world_frame_;
-    binary_map_pub_.publish(binary_map);
-  }
+  if (publish_keyframe) {
+    // With latched topics, a full map is computed even without subscribers
+    // (a later subscriber gets the last one).
+    if (latch_topics_ || occupied_nodes_pub_.getNumSubscribers() > 0 ||
+        free_nodes_pub_.getNumSubscribers() > 0) {
+      visualization_msgs::MarkerArray occupied_nodes, free_nodes;
+      if (incremental_markers_) {
+        // The level of detail is centered on the robot (on its last known
+        // position if the transform is not available).
+        Transformation robot_to_world;
+        if (use_tf_transforms_ &&
+            lookupTransformTf(robot_frame_, world_frame_, now,
+                              &robot_to_world)) {
+          marker_view_point_ = robot_to_world.getPosition();
+        }
+        generateMarkerArrayIncremental(world_frame_, marker_view_point_,
+                                       &occupied_nodes, &free_nodes);
+      } else {
+        generateMarkerArray(world_frame_, &occupied_nodes, &free_nodes);
+      }
+      if (!occupied_nodes.markers.empty()) {
+        occupied_nodes_pub_.publish(occupied_nodes);
+      }
+      if (!free_nodes.markers.empty()) {
+        free_nodes_pub_.publish(free_nodes);
+      }
+    }
 
-  if (latch_topics_ || full_map_pub_.getNumSubscribers() > 0) {
-    octomap_msgs::Octomap full_map;
-    getOctomapBinaryMsg(&full_map);
-    full_map.header.frame_id = world_frame_;
-    full_map_pub_.publish(full_map);
-  }
+    if (latch_topics_ || binary_map_pub_.getNumSubscribers() > 0) {
+      octomap_msgs::Octomap binary_map;
+      getOctomapBinaryMsg(&binary_map);
+      binary_map.header.frame_id = world_frame_;
+      binary_map.header.stamp = now;
+      binary_map_pub_.publish(binary_map);
+    }
+
+    if (latch_topics_ || full_map_pub_.getNumSubscribers() > 0) {
+      octomap_msgs::Octomap full_map;
+      getOctomapFullMsg(&full_map);
+      full_map.header.frame_id = world_frame_;
+      full_map.header.stamp = now;
+      full_map_pub_.publish(full_map);
+    }
+
+    if (latch_topics_ || pcl_pub_.getNumSubscribers() > 0) {
+      pcl::PointCloud<pcl::PointXYZ> point_cloud;
+      getOccupiedPointCloud(&point_cloud);
+      sensor_msgs::PointCloud2 cloud;
+      pcl::toROSMsg(point_cloud, cloud);
+      cloud.header.frame_id = world_frame_;
+      pcl_pub_.publish(cloud);
+    }
 
-  if (latch_topics_ || pcl_pub_.getNumSubscribers() > 0) {
-    pcl::PointCloud<pcl::PointXYZ> point_cloud;
-    getOccupiedPointCloud(&point_cloud);
-    sensor_msgs::PointCloud2 cloud;
-    pcl::toROSMsg(point_cloud, cloud);
-    cloud.header.frame_id = world_frame_;
-    pcl_pub_.publish(cloud);
+    last_keyframe_time_ = now;
+    b_changed_since_keyframe_ = false;
   }
 
   if (use_tf_transforms_ && nearest_obstacle_pub_.getNumSubscribers() > 0) {
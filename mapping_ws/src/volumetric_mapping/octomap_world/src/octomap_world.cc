@@ -29,6 +29,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "octomap_world/octomap_world.h"
 
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include <glog/logging.h>
 #include <octomap_msgs/conversions.h>
 #include <octomap_ros/conversions.h>
@@ -48,14 +55,104 @@ Eigen::Vector3d pointOctomapToEigen(const octomap::point3d& point) {
   return Eigen::Vector3d(point.x(), point.y(), point.z());
 }
 
+// Morton code (bit interleaving) of the 16 bit octree keys: sorting the keys
+// by their code visits the voxels in the octree order.
+inline uint64_t spreadKeyBits(uint64_t x) {
+  x &= 0xffff;
+  x = (x | (x << 16)) & 0x0000ff0000ffULL;
+  x = (x | (x << 8)) & 0x00f00f00f00fULL;
+  x = (x | (x << 4)) & 0x0c30c30c30c3ULL;
+  x = (x | (x << 2)) & 0x249249249249ULL;
+  return x;
+}
+inline uint64_t compactKeyBits(uint64_t x) {
+  x &= 0x249249249249ULL;
+  x = (x | (x >> 2)) & 0x0c30c30c30c3ULL;
+  x = (x | (x >> 4)) & 0x00f00f00f00fULL;
+  x = (x | (x >> 8)) & 0x0000ff0000ffULL;
+  x = (x | (x >> 16)) & 0xffffULL;
+  return x;
+}
+inline uint64_t keyToMortonCode(const octomap::OcTreeKey& key) {
+  return spreadKeyBits(key[0]) | (spreadKeyBits(key[1]) << 1) |
+         (spreadKeyBits(key[2]) << 2);
+}
+inline octomap::OcTreeKey mortonCodeToKey(uint64_t code) {
+  return octomap::OcTreeKey(compactKeyBits(code), compactKeyBits(code >> 1),
+                            compactKeyBits(code >> 2));
+}
+
+// Morton codes of the keys of a set, sorted.
+void keySetToSortedCodes(const octomap::KeySet& keys,
+                         std::vector<uint64_t>* codes) {
+  codes->clear();
+  codes->reserve(keys.size());
+  for (const octomap::OcTreeKey& key : keys) {
+    codes->push_back(keyToMortonCode(key));
+  }
+  std::sort(codes->begin(), codes->end());
+}
+// Merges sorted runs of codes without duplicates into (*runs)[0]: pairwise,
+// the merges of each round run in parallel.
+void mergeSortedRuns(int num_threads, std::vector<std::vector<uint64_t> >* runs) {
+  for (size_t step = 1; step < runs->size(); step *= 2) {
+    const int num_merges = (runs->size() + 2 * step - 1) / (2 * step);
+#pragma omp parallel for num_threads(num_threads) if (num_threads > 1 && num_merges > 1)
+    for (int m = 0; m < num_merges; ++m) {
+      const size_t i = 2 * step * m;
+      const size_t j = i + step;
+      if (j >= runs->size()) {
+        continue;
+      }
+      std::vector<uint64_t> merged;
+      merged.reserve((*runs)[i].size() + (*runs)[j].size());
+      std::set_union((*runs)[i].begin(), (*runs)[i].end(), (*runs)[j].begin(),
+                     (*runs)[j].end(), std::back_inserter(merged));
+      (*runs)[i].swap(merged);
+      std::vector<uint64_t>().swap((*runs)[j]);
+    }
+  }
+}
+// Inserts the keys of the merged runs (see mergeSortedRuns()) into keys.
+void sortedCodesToKeySet(const std::vector<std::vector<uint64_t> >& runs,
+                         octomap::KeySet* keys) {
+  if (runs.empty()) {
+    return;
+  }
+  keys->reserve(keys->size() + runs[0].size());
+  for (uint64_t code : runs[0]) {
+    keys->insert(mortonCodeToKey(code));
+  }
+}
+
+// Runs query(i) for each index of order, in that order split into contiguous
+// chunks between the threads.
+template <typename Query>
+void runOrderedQueries(const std::vector<size_t>& order, int num_threads,
+                       const Query& query) {
+  const int num_queries = order.size();
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic, 16) if (num_threads > 1 && num_queries > 16)
+  for (int i = 0; i < num_queries; ++i) {
+    query(order[i]);
+  }
+}
+
 const float OctomapWorld::kMinTanAngleForFreeVoxelLineOfSight = tan(7 *M_PI/180.);
+const int OctomapWorld::kOccupiedBlockBits = 4;  // 16 voxels
+const int OctomapWorld::kMarkerChunkBits = 6;  // 64 voxels
 
 // Create a default parameters object and call the other constructor with it.
 OctomapWorld::OctomapWorld() : OctomapWorld(OctomapParameters()) {}
 
 // Creates an octomap with the correct parameters.
 OctomapWorld::OctomapWorld(const OctomapParameters& params)
-    : robot_size_(Eigen::Vector3d::Ones()) {
+    : robot_size_(Eigen::Vector3d::Ones()),
+      num_occupied_voxels_(0),
+      occupied_index_valid_(false),
+      marker_full_update_(true),
+      marker_update_count_(0),
+      marker_min_z_(0.0),
+      marker_max_z_(0.0) {
   setOctomapParameters(params);
 }
 
@@ -64,6 +161,7 @@ void OctomapWorld::resetMap() {
     octree_.reset(new octomap::OcTree(params_.resolution));
   }
   octree_->clear();
+  markMapChanged();
 }
 
 void OctomapWorld::prune() { octree_->prune(); }
@@ -85,6 +183,9 @@ void OctomapWorld::setOctomapParameters(const OctomapParameters& params) {
   octree_->setOccupancyThres(params.threshold_occupancy);
   octree_->enableChangeDetection(params.change_detection_enabled);
 
+  // The occupancy threshold may have changed.
+  markMapChanged();
+
   // Copy over all the parameters for future use (some are not used just for
   // creating the octree).
   params_ = params;
@@ -107,17 +208,7 @@ void OctomapWorld::insertPointcloudIntoMapImpl(
   // We do this as a batch operation - so first get all the keys in a set, then
   // do the update in batch.
   octomap::KeySet free_cells, occupied_cells;
-  for (pcl::PointCloud<pcl::PointXYZ>::const_iterator it = cloud->begin();
-      it != cloud->end(); ++it) {
-    const octomap::point3d p_G_point(it->x, it->y, it->z);
-    // First, check if we've already checked this.
-    octomap::OcTreeKey key = octree_->coordToKey(p_G_point);
-
-    if (occupied_cells.find(key) == occupied_cells.end()) {
-      // Check if this is within the allowed sensor range.
-      castRay(p_G_sensor, p_G_point, &free_cells, &occupied_cells);
-    }
-  }
+  castRays(p_G_sensor, *cloud, &free_cells, &occupied_cells);
 
   // Apply the new free cells and occupied cells from
   updateOccupancy(&free_cells, &occupied_cells);
@@ -216,6 +307,71 @@ void OctomapWorld::castRay(const octomap::point3d& sensor_origin,
   }
 }
 
+void OctomapWorld::castRays(const octomap::point3d& sensor_origin,
+                            const pcl::PointCloud<pcl::PointXYZ>& cloud,
+                            octomap::KeySet* free_cells,
+                            octomap::KeySet* occupied_cells) const {
+  CHECK_NOTNULL(free_cells);
+  CHECK_NOTNULL(occupied_cells);
+
+  // Ray bundling: a single ray is cast for all the points ending in the same
+  // voxel. With bundle_rays, this is done also for the points beyond the
+  // sensor range (by the voxel of their truncated end point).
+  std::vector<int> ray_indices;
+  ray_indices.reserve(cloud.size());
+  {
+    octomap::KeySet end_keys;
+    for (size_t i = 0; i < cloud.size(); ++i) {
+      const octomap::point3d point(cloud[i].x, cloud[i].y, cloud[i].z);
+      const bool in_range =
+          params_.sensor_max_range < 0.0 ||
+          (point - sensor_origin).norm() <= params_.sensor_max_range;
+      if (!in_range && !params_.bundle_rays) {
+        ray_indices.push_back(i);
+        continue;
+      }
+      const octomap::point3d end_point =
+          in_range ? point
+                   : sensor_origin + (point - sensor_origin).normalized() *
+                                         params_.sensor_max_range;
+      octomap::OcTreeKey key;
+      if (!octree_->coordToKeyChecked(end_point, key) ||
+          end_keys.insert(key).second) {
+        ray_indices.push_back(i);
+      }
+    }
+  }
+
+  // The rays are cast in parallel into per-thread key sets. Each thread sorts
+  // its keys (by Morton code) and the sorted runs are merged pairwise in
+  // parallel, dropping the duplicates: every key is inserted once in the
+  // output sets.
+  const int num_threads = std::max(params_.integration_num_threads, 1);
+  const int num_rays = ray_indices.size();
+  std::vector<std::vector<uint64_t> > free_runs, occupied_runs;
+#pragma omp parallel num_threads(num_threads) if (num_threads > 1)
+  {
+    octomap::KeySet thread_free_cells, thread_occupied_cells;
+#pragma omp for schedule(dynamic, 256)
+    for (int i = 0; i < num_rays; ++i) {
+      const pcl::PointXYZ& p = cloud[ray_indices[i]];
+      castRay(sensor_origin, octomap::point3d(p.x, p.y, p.z),
+              &thread_free_cells, &thread_occupied_cells);
+    }
+    std::vector<uint64_t> thread_free_run, thread_occupied_run;
+    keySetToSortedCodes(thread_free_cells, &thread_free_run);
+    keySetToSortedCodes(thread_occupied_cells, &thread_occupied_run);
+#pragma omp critical(octomap_world_cast_rays)
+    {
+      free_runs.push_back(std::move(thread_free_run));
+      occupied_runs.push_back(std::move(thread_occupied_run));
+    }
+  }
+  mergeSortedRuns(num_threads, &free_runs);
+  mergeSortedRuns(num_threads, &occupied_runs);
+  sortedCodesToKeySet(free_runs, free_cells);
+  sortedCodesToKeySet(occupied_runs, occupied_cells);
+}
 
 bool OctomapWorld::isValidPoint(const cv::Vec3f& point) const {
   // Check both for disparities explicitly marked as invalid (where OpenCV maps
@@ -228,11 +384,17 @@ void OctomapWorld::updateOccupancy(octomap::KeySet* free_cells,
   CHECK_NOTNULL(free_cells);
   CHECK_NOTNULL(occupied_cells);
 
+  // The leaves are updated lazily: their inner nodes are updated (and pruned)
+  // once at the end by updateInnerNodes(), instead of at each update or by a
+  // full octomap::OccupancyOcTreeBase::updateInnerOccupancy().
+  const bool lazy_eval = true;
+
   // Mark occupied cells.
   for (octomap::KeySet::iterator it = occupied_cells->begin(),
       end = occupied_cells->end();
       it != end; it++) {
-    octree_->updateNode(*it, true);
+    const octomap::OcTreeNode* node = octree_->updateNode(*it, true, lazy_eval);
+    updateOccupiedIndex(*it, octree_->isNodeOccupied(node));
 
     // Remove any occupied cells from free cells - assume there are far fewer
     // occupied cells than free cells, so this is much faster than checking on
@@ -246,9 +408,135 @@ void OctomapWorld::updateOccupancy(octomap::KeySet* free_cells,
   for (octomap::KeySet::iterator it = free_cells->begin(),
       end = free_cells->end();
       it != end; ++it) {
-    octree_->updateNode(*it, false);
+    const octomap::OcTreeNode* node = octree_->updateNode(*it, false, lazy_eval);
+    updateOccupiedIndex(*it, octree_->isNodeOccupied(node));
   }
-  octree_->updateInnerOccupancy();
+  updateInnerNodes(*free_cells, *occupied_cells);
+}
+
+void OctomapWorld::updateInnerNodes(const octomap::KeySet& free_cells,
+                                    const octomap::KeySet& occupied_cells) {
+  // The ancestor at depth d of a cell has the Morton code of the cell shifted
+  // by 3 * (tree_depth - d): the ancestors of a level are the unique shifted
+  // codes of the level below.
+  std::vector<uint64_t> codes;
+  codes.reserve(free_cells.size() + occupied_cells.size());
+  for (const octomap::OcTreeKey& key : free_cells) {
+    codes.push_back(keyToMortonCode(key));
+  }
+  for (const octomap::OcTreeKey& key : occupied_cells) {
+    codes.push_back(keyToMortonCode(key));
+  }
+  std::sort(codes.begin(), codes.end());
+
+  // Bottom-up, as octomap::OccupancyOcTreeBase::updateNodeRecurs() without
+  // lazy_eval: prune the node if possible, otherwise update its occupancy.
+  const int tree_depth = octree_->getTreeDepth();
+  for (int depth = tree_depth - 1; depth >= 0; --depth) {
+    for (uint64_t& code : codes) {
+      code >>= 3;
+    }
+    codes.erase(std::unique(codes.begin(), codes.end()), codes.end());
+    if (depth == tree_depth - kMarkerChunkBits) {
+      changed_marker_chunks_.insert(codes.begin(), codes.end());
+    }
+    const int shift = 3 * (tree_depth - depth);
+    for (uint64_t code : codes) {
+      // search() with depth 0 goes down to the leaves.
+      octomap::OcTreeNode* node =
+          (depth == 0) ? octree_->getRoot()
+                       : octree_->search(mortonCodeToKey(code << shift), depth);
+      // A node without children is a leaf above depth (already pruned).
+      if (node == NULL || !octree_->nodeHasChildren(node)) {
+        continue;
+      }
+      if (!octree_->pruneNode(node)) {
+        node->updateOccupancyChildren();
+      }
+    }
+  }
+}
+
+void OctomapWorld::updateOccupiedIndex(const octomap::OcTreeKey& key,
+                                       bool occupied) {
+  if (!occupied_index_valid_) {
+    return;  // Rebuilt from the leaves by the next query.
+  }
+  if (occupied) {
+    insertOccupiedVoxel(key);
+    return;
+  }
+  OccupiedBlockMap::iterator block =
+      occupied_blocks_.find(getOccupiedBlockKey(key));
+  if (block != occupied_blocks_.end() && block->second.erase(key) > 0) {
+    --num_occupied_voxels_;
+    if (block->second.empty()) {
+      occupied_blocks_.erase(block);
+    }
+  }
+}
+
+void OctomapWorld::invalidateOccupiedIndex() {
+  occupied_index_valid_ = false;
+  occupied_blocks_.clear();
+  num_occupied_voxels_ = 0;
+}
+
+void OctomapWorld::markMapChanged() {
+  invalidateOccupiedIndex();
+  changed_marker_chunks_.clear();
+  marker_full_update_ = true;
+}
+
+void OctomapWorld::buildOccupiedIndex() const {
+  if (occupied_index_valid_) {
+    return;
+  }
+  occupied_blocks_.clear();
+  num_occupied_voxels_ = 0;
+  const unsigned int tree_depth = octree_->getTreeDepth();
+  for (octomap::OcTree::leaf_iterator it = octree_->begin_leafs(),
+                                      end = octree_->end_leafs();
+       it != end; ++it) {
+    if (!octree_->isNodeOccupied(*it)) {
+      continue;
+    }
+    // A leaf above the max depth (pruned) covers 2^(tree_depth - depth)
+    // voxels per side, from its index key.
+    const unsigned int leaf_size = 1u << (tree_depth - it.getDepth());
+    const octomap::OcTreeKey min_key = it.getIndexKey();
+    octomap::OcTreeKey key;
+    for (unsigned int dz = 0; dz < leaf_size; ++dz) {
+      key[2] = min_key[2] + dz;
+      for (unsigned int dy = 0; dy < leaf_size; ++dy) {
+        key[1] = min_key[1] + dy;
+        for (unsigned int dx = 0; dx < leaf_size; ++dx) {
+          key[0] = min_key[0] + dx;
+          insertOccupiedVoxel(key);
+        }
+      }
+    }
+  }
+  occupied_index_valid_ = true;
+}
+
+void OctomapWorld::insertOccupiedVoxel(const octomap::OcTreeKey& key) const {
+  if (occupied_blocks_[getOccupiedBlockKey(key)].insert(key).second) {
+    ++num_occupied_voxels_;
+  }
+}
+
+bool OctomapWorld::isVoxelOccupiedInIndex(const octomap::OcTreeKey& key) const {
+  OccupiedBlockMap::const_iterator block =
+      occupied_blocks_.find(getOccupiedBlockKey(key));
+  return block != occupied_blocks_.end() && block->second.count(key) > 0;
+}
+
+octomap::OcTreeKey OctomapWorld::getOccupiedBlockKey(
+    const octomap::OcTreeKey& key) {
+  return octomap::OcTreeKey(key[0] >> kOccupiedBlockBits,
+                            key[1] >> kOccupiedBlockBits,
+                            key[2] >> kOccupiedBlockBits);
 }
 
 OctomapWorld::CellStatus OctomapWorld::getCellStatusBoundingBox(
@@ -270,53 +558,102 @@ OctomapWorld::CellStatus OctomapWorld::getCellStatusBoundingBox(
     }
   }
 
-  // Now we have to iterate over everything in the bounding box.
+  // Now we have to check everything in the bounding box: the octree is
+  // descended once, pruning the subtrees outside of the box and, once an
+  // unknown voxel has been found, the subtrees which cannot contain an
+  // occupied voxel (an inner node holds the max log-odds of its children).
   Eigen::Vector3d bbx_min_eigen = point - bounding_box_size / 2;
   Eigen::Vector3d bbx_max_eigen = point + bounding_box_size / 2;
 
-  octomap::point3d bbx_min = pointEigenToOctomap(bbx_min_eigen);
-  octomap::point3d bbx_max = pointEigenToOctomap(bbx_max_eigen);
+  octomap::OcTreeKey bbx_min_key, bbx_max_key;
+  for (int i = 0; i < 3; ++i) {
+    bbx_min_key[i] = coordToKeyClamped(bbx_min_eigen[i]);
+    bbx_max_key[i] = coordToKeyClamped(bbx_max_eigen[i]);
+  }
 
-  for (octomap::OcTree::leaf_bbx_iterator
-      iter = octree_->begin_leafs_bbx(bbx_min, bbx_max),
-      end = octree_->end_leafs_bbx();
-      iter != end; ++iter) {
-    Eigen::Vector3d cube_center(iter.getX(), iter.getY(), iter.getZ());
-    int depth_level = iter.getDepth();
-    double cube_size = octree_->getNodeSize(depth_level);
+  const octomap::OcTreeNode* root = octree_->getRoot();
+  if (root == NULL) {
+    return CellStatus::kUnknown;
+  }
+  bool unknown_found = false;
+  if (searchOccupiedInKeyBox(root, 0, octomap::OcTreeKey(0, 0, 0),
+                             bbx_min_key, bbx_max_key, &unknown_found)) {
+    return CellStatus::kOccupied;
+  }
+  if (unknown_found) {
+    return CellStatus::kUnknown;
+  }
+  return CellStatus::kFree;
+}
 
-    // Check if it is really inside bounding box, since leaf_bbx_iterator begins
-    // "too early"
-    Eigen::Vector3d cube_lower_bound =
-        cube_center - (cube_size / 2) * Eigen::Vector3d::Ones();
-    Eigen::Vector3d cube_upper_bound =
-        cube_center + (cube_size / 2) * Eigen::Vector3d::Ones();
-    if (cube_upper_bound.x() < bbx_min.x() ||
-        cube_lower_bound.x() > bbx_max.x() ||
-        cube_upper_bound.y() < bbx_min.y() ||
-        cube_lower_bound.y() > bbx_max.y() ||
-        cube_upper_bound.z() < bbx_min.z() ||
-        cube_lower_bound.z() > bbx_max.z()) {
-      continue;
-    }
+octomap::key_type OctomapWorld::coordToKeyClamped(double coordinate) const {
+  const double tree_max_val = 1 << (octree_->getTreeDepth() - 1);
+  const double scaled = std::min(
+      std::max(coordinate / octree_->getResolution(), -tree_max_val),
+      tree_max_val - 1);
+  return static_cast<octomap::key_type>(
+      static_cast<int>(std::floor(scaled)) + static_cast<int>(tree_max_val));
+}
 
-    if (octree_->isNodeOccupied(*iter)) {
-      if (params_.filter_speckles && isSpeckleNode(iter.getKey())) {
-        continue;
-      } else {
-        return CellStatus::kOccupied;
+bool OctomapWorld::searchOccupiedInKeyBox(const octomap::OcTreeNode* node,
+                                          unsigned int depth,
+                                          const octomap::OcTreeKey& min_key,
+                                          const octomap::OcTreeKey& bbx_min_key,
+                                          const octomap::OcTreeKey& bbx_max_key,
+                                          bool* unknown_found) const {
+  const bool may_be_occupied = octree_->isNodeOccupied(node);
+  if (!may_be_occupied && *unknown_found) {
+    return false;
+  }
+  const unsigned int node_size = 1u << (octree_->getTreeDepth() - depth);
+  if (!octree_->nodeHasChildren(node)) {
+    if (!may_be_occupied) {
+      return false;
+    }
+    // Key of the center of the leaf, as the one of the leaf iterators.
+    octomap::OcTreeKey key = min_key;
+    if (node_size > 1) {
+      for (int i = 0; i < 3; ++i) {
+        key[i] += node_size / 2;
       }
     }
+    return !(params_.filter_speckles && isSpeckleNode(key));
   }
 
-  // The above only returns valid nodes - we should check for unknown nodes as
-  // well.
-  octomap::point3d_list unknown_centers;
-  octree_->getUnknownLeafCenters(unknown_centers, bbx_min, bbx_max);
-  if (unknown_centers.size() > 0) {
-    return CellStatus::kUnknown;
+  const unsigned int child_size = node_size / 2;
+  for (unsigned int child = 0; child < 8; ++child) {
+    // Same child indexing as octomap::computeChildIdx().
+    octomap::OcTreeKey child_min_key = min_key;
+    bool in_bbx = true;
+    for (int i = 0; i < 3; ++i) {
+      if (child & (1u << i)) {
+        child_min_key[i] += child_size;
+      }
+      const unsigned int child_max_key = child_min_key[i] + child_size - 1;
+      if (child_min_key[i] > bbx_max_key[i] || child_max_key < bbx_min_key[i]) {
+        in_bbx = false;
+      }
+    }
+    if (!in_bbx) {
+      continue;
+    }
+    if (!octree_->nodeChildExists(node, child)) {
+      *unknown_found = true;
+      if (!may_be_occupied) {
+        return false;
+      }
+      continue;
+    }
+    if (searchOccupiedInKeyBox(octree_->getNodeChild(node, child), depth + 1,
+                               child_min_key, bbx_min_key, bbx_max_key,
+                               unknown_found)) {
+      return true;
+    }
+    if (!may_be_occupied && *unknown_found) {
+      return false;
+    }
   }
-  return CellStatus::kFree;
+  return false;
 }
 
 OctomapWorld::CellStatus OctomapWorld::getCellStatusPoint(
@@ -447,6 +784,70 @@ OctomapWorld::CellStatus OctomapWorld::getLineStatusBoundingBox(
   return CellStatus::kFree;
 }
 
+void OctomapWorld::getMortonOrder(
+    const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& points,
+    std::vector<size_t>* order) const {
+  std::vector<std::pair<uint64_t, size_t> > codes(points.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    octomap::OcTreeKey key;
+    for (int j = 0; j < 3; ++j) {
+      key[j] = coordToKeyClamped(points[i][j]);
+    }
+    codes[i] = std::make_pair(keyToMortonCode(key), i);
+  }
+  std::sort(codes.begin(), codes.end());
+  order->resize(points.size());
+  for (size_t i = 0; i < codes.size(); ++i) {
+    (*order)[i] = codes[i].second;
+  }
+}
+
+void OctomapWorld::getCellStatusBoundingBoxBatch(
+    const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& points,
+    const Eigen::Vector3d& bounding_box_size,
+    std::vector<CellStatus>* statuses) const {
+  CHECK_NOTNULL(statuses);
+  statuses->resize(points.size());
+  std::vector<size_t> order;
+  getMortonOrder(points, &order);
+  runOrderedQueries(order, std::max(params_.query_num_threads, 1),
+                    [&](size_t i) {
+    (*statuses)[i] = getCellStatusBoundingBox(points[i], bounding_box_size);
+  });
+}
+
+void OctomapWorld::getLineStatusBoundingBoxBatch(
+    const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& starts,
+    const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& ends,
+    const Eigen::Vector3d& bounding_box_size,
+    std::vector<CellStatus>* statuses) const {
+  CHECK_NOTNULL(statuses);
+  CHECK_EQ(starts.size(), ends.size());
+  statuses->resize(starts.size());
+  std::vector<size_t> order;
+  getMortonOrder(starts, &order);
+  runOrderedQueries(order, std::max(params_.query_num_threads, 1),
+                    [&](size_t i) {
+    (*statuses)[i] =
+        getLineStatusBoundingBox(starts[i], ends[i], bounding_box_size);
+  });
+}
+
+void OctomapWorld::getVisibilityBatch(
+    const Eigen::Vector3d& view_point,
+    const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& voxels_to_test,
+    bool stop_at_unknown_cell, std::vector<CellStatus>* statuses) const {
+  CHECK_NOTNULL(statuses);
+  statuses->resize(voxels_to_test.size());
+  std::vector<size_t> order;
+  getMortonOrder(voxels_to_test, &order);
+  runOrderedQueries(order, std::max(params_.query_num_threads, 1),
+                    [&](size_t i) {
+    (*statuses)[i] =
+        getVisibility(view_point, voxels_to_test[i], stop_at_unknown_cell);
+  });
+}
+
 double OctomapWorld::getResolution() const { return octree_->getResolution(); }
 
 void OctomapWorld::setFree(const Eigen::Vector3d& position,
@@ -464,41 +865,13 @@ void OctomapWorld::setOccupied(const Eigen::Vector3d& position,
 void OctomapWorld::getOccupiedPointCloud(
     pcl::PointCloud<pcl::PointXYZ>* output_cloud) const {
   CHECK_NOTNULL(output_cloud)->clear();
-  unsigned int max_tree_depth = octree_->getTreeDepth();
-  double resolution = octree_->getResolution();
-  for (octomap::OcTree::leaf_iterator it = octree_->begin_leafs();
-      it != octree_->end_leafs(); ++it) {
-    if (octree_->isNodeOccupied(*it)) {
-      // If leaf is max depth add coordinates.
-      if (max_tree_depth == it.getDepth()) {
-        pcl::PointXYZ point(it.getX(), it.getY(), it.getZ());
-        output_cloud->push_back(point);
-      }
-      // If leaf is not max depth it represents an occupied voxel with edge
-      // length of 2^(max_tree_depth - leaf_depth) * resolution.
-      // We use multiple points to visualize this filled volume.
-      else {
-        const unsigned int box_edge_length =
-            pow(2, max_tree_depth - it.getDepth() - 1);
-        const double bbx_offset = box_edge_length * resolution - resolution / 2;
-        Eigen::Vector3d bbx_offset_vec(bbx_offset, bbx_offset, bbx_offset);
-        Eigen::Vector3d center(it.getX(), it.getY(), it.getZ());
-        Eigen::Vector3d bbx_min = center - bbx_offset_vec;
-        Eigen::Vector3d bbx_max = center + bbx_offset_vec;
-        // Add small offset to avoid overshooting bbx_max.
-        bbx_max += Eigen::Vector3d(0.001, 0.001, 0.001);
-        for (double x_position = bbx_min.x(); x_position <= bbx_max.x();
-            x_position += resolution) {
-          for (double y_position = bbx_min.y(); y_position <= bbx_max.y();
-              y_position += resolution) {
-            for (double z_position = bbx_min.z(); z_position <= bbx_max.z();
-                z_position += resolution) {
-              output_cloud->push_back(
-                  pcl::PointXYZ(x_position, y_position, z_position));
-            }
-          }
-        }
-      }
+  // The pruned leaves are already split into voxels by the index.
+  buildOccupiedIndex();
+  output_cloud->reserve(num_occupied_voxels_);
+  for (const OccupiedBlockMap::value_type& block : occupied_blocks_) {
+    for (const octomap::OcTreeKey& key : block.second) {
+      const octomap::point3d point = octree_->keyToCoord(key);
+      output_cloud->push_back(pcl::PointXYZ(point.x(), point.y(), point.z()));
     }
   }
 }
@@ -525,22 +898,50 @@ void OctomapWorld::getOccupiedPointcloudInBoundingBox(
   Eigen::Vector3d bbx_max =
       center_corrected + bounding_box_size / 2 + epsilon_3d;
 
-  for (double x_position = bbx_min.x(); x_position <= bbx_max.x();
-      x_position += resolution) {
-    for (double y_position = bbx_min.y(); y_position <= bbx_max.y();
-        y_position += resolution) {
-      for (double z_position = bbx_min.z(); z_position <= bbx_max.z();
-          z_position += resolution) {
-        octomap::point3d point =
-            octomap::point3d(x_position, y_position, z_position);
-        octomap::OcTreeKey key = octree_->coordToKey(point);
-        octomap::OcTreeNode* node = octree_->search(key);
-        if (node != NULL && octree_->isNodeOccupied(node)) {
-          output_cloud->push_back(
-              pcl::PointXYZ(point.x(), point.y(), point.z()));
+  unsigned int min_key[3], max_key[3];
+  for (int i = 0; i < 3; ++i) {
+    min_key[i] = coordToKeyClamped(bbx_min[i]);
+    max_key[i] = coordToKeyClamped(bbx_max[i]);
+  }
+
+  // The occupied voxels of the blocks overlapping the box, looked up by block
+  // (or over all the occupied blocks, if there are fewer).
+  buildOccupiedIndex();
+  const auto add_block_voxels = [&](const octomap::KeySet& keys) {
+    for (const octomap::OcTreeKey& key : keys) {
+      if (key[0] >= min_key[0] && key[0] <= max_key[0] &&
+          key[1] >= min_key[1] && key[1] <= max_key[1] &&
+          key[2] >= min_key[2] && key[2] <= max_key[2]) {
+        const octomap::point3d point = octree_->keyToCoord(key);
+        output_cloud->push_back(
+            pcl::PointXYZ(point.x(), point.y(), point.z()));
+      }
+    }
+  };
+  const octomap::OcTreeKey min_block =
+      getOccupiedBlockKey(octomap::OcTreeKey(min_key[0], min_key[1], min_key[2]));
+  const octomap::OcTreeKey max_block =
+      getOccupiedBlockKey(octomap::OcTreeKey(max_key[0], max_key[1], max_key[2]));
+  size_t num_box_blocks = 1;
+  for (int i = 0; i < 3; ++i) {
+    num_box_blocks *= max_block[i] - min_block[i] + 1;
+  }
+  if (num_box_blocks < occupied_blocks_.size()) {
+    for (unsigned int bz = min_block[2]; bz <= max_block[2]; ++bz) {
+      for (unsigned int by = min_block[1]; by <= max_block[1]; ++by) {
+        for (unsigned int bx = min_block[0]; bx <= max_block[0]; ++bx) {
+          OccupiedBlockMap::const_iterator block =
+              occupied_blocks_.find(octomap::OcTreeKey(bx, by, bz));
+          if (block != occupied_blocks_.end()) {
+            add_block_voxels(block->second);
+          }
         }
       }
     }
+  } else {
+    for (const OccupiedBlockMap::value_type& block : occupied_blocks_) {
+      add_block_voxels(block.second);
+    }
   }
 }
 
@@ -684,6 +1085,7 @@ void OctomapWorld::setLogOddsBoundingBox(
   }
   // This is necessary since lazy_eval is set to true.
   octree_->updateInnerOccupancy();
+  markMapChanged();
 }
 
 bool OctomapWorld::getOctomapBinaryMsg(octomap_msgs::Octomap* msg) const {
@@ -705,11 +1107,13 @@ void OctomapWorld::setOctomapFromMsg(const octomap_msgs::Octomap& msg) {
 void OctomapWorld::setOctomapFromBinaryMsg(const octomap_msgs::Octomap& msg) {
   octree_.reset(
       dynamic_cast<octomap::OcTree*>(octomap_msgs::binaryMsgToMap(msg)));
+  markMapChanged();
 }
 
 void OctomapWorld::setOctomapFromFullMsg(const octomap_msgs::Octomap& msg) {
   octree_.reset(
       dynamic_cast<octomap::OcTree*>(octomap_msgs::fullMsgToMap(msg)));
+  markMapChanged();
 }
 
 bool OctomapWorld::loadOctomapFromFile(const std::string& filename) {
@@ -717,6 +1121,7 @@ bool OctomapWorld::loadOctomapFromFile(const std::string& filename) {
     // TODO(helenol): Resolution shouldn't matter... I think. I'm not sure.
     octree_.reset(new octomap::OcTree(0.05));
   }
+  markMapChanged();
   return octree_->readBinary(filename);
 }
 
@@ -831,6 +1236,190 @@ void OctomapWorld::generateMarkerArray(
   }
 }
 
+void OctomapWorld::generateMarkerArrayIncremental(
+    const std::string& tf_frame, const Eigen::Vector3d& view_point,
+    visualization_msgs::MarkerArray* occupied_nodes,
+    visualization_msgs::MarkerArray* free_nodes) {
+  CHECK_NOTNULL(occupied_nodes)->markers.clear();
+  CHECK_NOTNULL(free_nodes)->markers.clear();
+  const int chunk_depth = octree_->getTreeDepth() - kMarkerChunkBits;
+
+  // Metric min and max z of the map, as in generateMarkerArray(): the colors
+  // of all the chunks change with them.
+  double min_x, min_y, min_z, max_x, max_y, max_z;
+  octree_->getMetricMin(min_x, min_y, min_z);
+  octree_->getMetricMax(max_x, max_y, max_z);
+  if (params_.visualize_min_z > min_z) {
+    min_z = params_.visualize_min_z;
+  }
+  if (params_.visualize_max_z < max_z) {
+    max_z = params_.visualize_max_z;
+  }
+  if (min_z != marker_min_z_ || max_z != marker_max_z_) {
+    marker_min_z_ = min_z;
+    marker_max_z_ = max_z;
+    height_colors_.clear();
+    marker_full_update_ = true;
+  }
+
+  if (marker_full_update_) {
+    visualization_msgs::Marker delete_all;
+    delete_all.header.frame_id = tf_frame;
+    delete_all.action = visualization_msgs::Marker::DELETEALL;
+    occupied_nodes->markers.push_back(delete_all);
+    free_nodes->markers.push_back(delete_all);
+    marker_chunks_.clear();
+  }
+
+  // The nodes at the chunk depth are the chunks; a leaf above it (pruned) is
+  // in the chunk of its index key.
+  ++marker_update_count_;
+  for (octomap::OcTree::leaf_iterator it = octree_->begin_leafs(chunk_depth),
+                                      end = octree_->end_leafs();
+       it != end; ++it) {
+    const uint64_t chunk_code =
+        keyToMortonCode(it.getIndexKey()) >> (3 * kMarkerChunkBits);
+    const int lod_depth = getMarkerLodDepth(chunk_code, view_point);
+    std::pair<MarkerChunkMap::iterator, bool> inserted =
+        marker_chunks_.emplace(chunk_code, MarkerChunk());
+    MarkerChunk& chunk = inserted.first->second;
+    chunk.update_count = marker_update_count_;
+    if (inserted.second || chunk.lod_depth != lod_depth ||
+        chunk.node_depth != static_cast<int>(it.getDepth()) ||
+        changed_marker_chunks_.count(chunk_code) > 0) {
+      chunk.lod_depth = lod_depth;
+      chunk.node_depth = it.getDepth();
+      generateMarkerChunk(chunk_code, tf_frame, &chunk, occupied_nodes,
+                          free_nodes);
+    }
+  }
+
+  // The chunks which are gone (merged into a larger leaf) are deleted.
+  for (MarkerChunkMap::iterator it = marker_chunks_.begin();
+       it != marker_chunks_.end();) {
+    if (it->second.update_count == marker_update_count_) {
+      ++it;
+      continue;
+    }
+    it->second.node_depth = -1;
+    generateMarkerChunk(it->first, tf_frame, &it->second, occupied_nodes,
+                        free_nodes);
+    it = marker_chunks_.erase(it);
+  }
+
+  changed_marker_chunks_.clear();
+  marker_full_update_ = false;
+}
+
+void OctomapWorld::generateMarkerChunk(
+    uint64_t chunk_code, const std::string& tf_frame, MarkerChunk* chunk,
+    visualization_msgs::MarkerArray* occupied_nodes,
+    visualization_msgs::MarkerArray* free_nodes) {
+  const int tree_depth = octree_->getTreeDepth();
+  const int chunk_depth = tree_depth - kMarkerChunkBits;
+  const int shift = 3 * kMarkerChunkBits;
+  std::vector<visualization_msgs::Marker> occupied_markers(tree_depth + 1);
+  std::vector<visualization_msgs::Marker> free_markers(tree_depth + 1);
+
+  if (chunk->node_depth >= 0) {
+    const octomap::OcTreeKey min_key = mortonCodeToKey(chunk_code << shift);
+    const unsigned int chunk_size = 1u << kMarkerChunkBits;
+    const octomap::OcTreeKey max_key(min_key[0] + chunk_size - 1,
+                                     min_key[1] + chunk_size - 1,
+                                     min_key[2] + chunk_size - 1);
+    for (octomap::OcTree::leaf_bbx_iterator
+             it = octree_->begin_leafs_bbx(min_key, max_key, chunk->lod_depth),
+             end = octree_->end_leafs_bbx();
+         it != end; ++it) {
+      if (static_cast<int>(it.getDepth()) < chunk_depth &&
+          (keyToMortonCode(it.getIndexKey()) >> shift) != chunk_code) {
+        continue;
+      }
+      if (it.getZ() > marker_max_z_ || it.getZ() < marker_min_z_) {
+        continue;
+      }
+      geometry_msgs::Point cube_center;
+      cube_center.x = it.getX();
+      cube_center.y = it.getY();
+      cube_center.z = it.getZ();
+      visualization_msgs::Marker& marker =
+          octree_->isNodeOccupied(*it) ? occupied_markers[it.getDepth()]
+                                       : free_markers[it.getDepth()];
+      marker.points.push_back(cube_center);
+      marker.colors.push_back(getHeightColor(it.getZ()));
+    }
+  }
+
+  // One marker per depth, replacing (or deleting) the published one.
+  const auto add_marker = [&](int depth, visualization_msgs::Marker* marker,
+                              uint32_t* published_depths,
+                              visualization_msgs::MarkerArray* markers) {
+    const uint32_t depth_bit = 1u << depth;
+    if (marker->points.empty() && !(*published_depths & depth_bit)) {
+      return;
+    }
+    const double size = octree_->getNodeSize(depth);
+    marker->header.frame_id = tf_frame;
+    marker->ns = "map_depth_" + std::to_string(depth);
+    marker->id = static_cast<int>(chunk_code);
+    marker->type = visualization_msgs::Marker::CUBE_LIST;
+    marker->scale.x = size;
+    marker->scale.y = size;
+    marker->scale.z = size;
+    if (marker->points.empty()) {
+      marker->action = visualization_msgs::Marker::DELETE;
+      *published_depths &= ~depth_bit;
+    } else {
+      marker->action = visualization_msgs::Marker::ADD;
+      *published_depths |= depth_bit;
+    }
+    markers->markers.push_back(*marker);
+  };
+  for (int depth = 0; depth <= tree_depth; ++depth) {
+    add_marker(depth, &occupied_markers[depth], &chunk->occupied_depths,
+               occupied_nodes);
+    add_marker(depth, &free_markers[depth], &chunk->free_depths, free_nodes);
+  }
+}
+
+int OctomapWorld::getMarkerLodDepth(uint64_t chunk_code,
+                                    const Eigen::Vector3d& view_point) const {
+  const int tree_depth = octree_->getTreeDepth();
+  if (params_.visualize_lod_distance <= 0.0) {
+    return tree_depth;
+  }
+  // Distance from the view point to the box of the chunk.
+  const double resolution = octree_->getResolution();
+  const Eigen::Vector3d box_min =
+      pointOctomapToEigen(octree_->keyToCoord(
+          mortonCodeToKey(chunk_code << (3 * kMarkerChunkBits)))) -
+      Eigen::Vector3d::Constant(resolution / 2);
+  const Eigen::Vector3d box_max =
+      box_min + Eigen::Vector3d::Constant(resolution * (1 << kMarkerChunkBits));
+  const double distance =
+      (view_point - view_point.cwiseMax(box_min).cwiseMin(box_max)).norm();
+
+  int depth = tree_depth;
+  for (double lod_distance = params_.visualize_lod_distance;
+       distance > lod_distance && depth > tree_depth - kMarkerChunkBits;
+       lod_distance *= 2) {
+    --depth;
+  }
+  return depth;
+}
+
+const std_msgs::ColorRGBA& OctomapWorld::getHeightColor(double z) {
+  // The node centers (at any depth) are on a grid of half a voxel.
+  const long bucket = std::lround(z / (0.5 * octree_->getResolution()));
+  std::pair<std::unordered_map<long, std_msgs::ColorRGBA>::iterator, bool>
+      inserted = height_colors_.emplace(bucket, std_msgs::ColorRGBA());
+  if (inserted.second) {
+    inserted.first->second = percentToColor(
+        colorizeMapByHeight(z, marker_min_z_, marker_max_z_));
+  }
+  return inserted.first->second;
+}
+
 double OctomapWorld::colorizeMapByHeight(double z, double min_z,
                                          double max_z) const {
   return (1.0 - std::min(std::max((z - min_z) / (max_z - min_z), 0.0), 1.0));
@@ -946,21 +1535,102 @@ bool OctomapWorld::checkCollisionWithRobot(
 bool OctomapWorld::checkPathForCollisionsWithRobot(
     const std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> >& robot_positions,
     size_t* collision_index) {
-  // Iterate over vector of poses.
-  // Check each one.
-  // Return when a collision is found, and return the index of the earliest
-  // collision.
-  for (size_t i = 0; i < robot_positions.size(); ++i) {
-    if (checkSinglePoseCollision(robot_positions[i])) {
-      if (collision_index != nullptr) {
-        *collision_index = i;
+  // The boxes of consecutive poses overlap by most of their volume: each
+  // voxel of the swept volume (the union of the boxes) is looked up once.
+  KeyCollisionMap collision_cache;
+  // Poses in time order, or coarse-to-fine (first, last, then bisection) to
+  // find an early collision without testing the whole path: the poses after
+  // the earliest collision found so far are skipped, so that the reported
+  // collision is still the earliest one.
+  std::vector<size_t> order;
+  getPathCheckOrder(robot_positions.size(),
+                    params_.bisect_path_collision_check, &order);
+  size_t first_collision = robot_positions.size();
+  for (size_t i : order) {
+    if (i < first_collision &&
+        checkSinglePoseCollision(robot_positions[i], &collision_cache)) {
+      first_collision = i;
+    }
+  }
+  if (first_collision == robot_positions.size()) {
+    return false;
+  }
+  if (collision_index != nullptr) {
+    *collision_index = first_collision;
+  }
+  return true;
+}
+
+void OctomapWorld::getPathCheckOrder(size_t num_poses, bool bisect,
+                                     std::vector<size_t>* order) const {
+  order->clear();
+  order->reserve(num_poses);
+  if (!bisect || num_poses <= 2) {
+    for (size_t i = 0; i < num_poses; ++i) {
+      order->push_back(i);
+    }
+    return;
+  }
+  order->push_back(0);
+  order->push_back(num_poses - 1);
+  // Breadth-first bisection of the intervals (both ends already tested).
+  std::vector<std::pair<size_t, size_t> > intervals(1, {0, num_poses - 1});
+  for (size_t next = 0; next < intervals.size(); ++next) {
+    const size_t start = intervals[next].first;
+    const size_t end = intervals[next].second;
+    if (end - start < 2) {
+      continue;
+    }
+    const size_t middle = start + (end - start) / 2;
+    order->push_back(middle);
+    intervals.emplace_back(start, middle);
+    intervals.emplace_back(middle, end);
+  }
+}
+
+bool OctomapWorld::checkSinglePoseCollision(
+    const Eigen::Vector3d& robot_position,
+    KeyCollisionMap* collision_cache) const {
+  // Same result as checkSinglePoseCollision() without the cache.
+  octomap::OcTreeKey key;
+  if (!octree_->coordToKeyChecked(pointEigenToOctomap(robot_position), key)) {
+    return true;
+  }
+  const Eigen::Vector3d bbx_min = robot_position - robot_size_ / 2;
+  const Eigen::Vector3d bbx_max = robot_position + robot_size_ / 2;
+  unsigned int min_key[3], max_key[3];
+  for (int i = 0; i < 3; ++i) {
+    min_key[i] = coordToKeyClamped(bbx_min[i]);
+    max_key[i] = coordToKeyClamped(bbx_max[i]);
+  }
+
+  for (unsigned int kz = min_key[2]; kz <= max_key[2]; ++kz) {
+    for (unsigned int ky = min_key[1]; ky <= max_key[1]; ++ky) {
+      for (unsigned int kx = min_key[0]; kx <= max_key[0]; ++kx) {
+        key = octomap::OcTreeKey(kx, ky, kz);
+        std::pair<KeyCollisionMap::iterator, bool> inserted =
+            collision_cache->emplace(key, false);
+        if (inserted.second) {
+          inserted.first->second = isVoxelInCollision(key);
+        }
+        if (inserted.first->second) {
+          return true;
+        }
       }
-      return true;
     }
   }
   return false;
 }
 
+bool OctomapWorld::isVoxelInCollision(const octomap::OcTreeKey& key) const {
+  const octomap::OcTreeNode* node = octree_->search(key);
+  if (node == NULL) {
+    return params_.treat_unknown_as_occupied;
+  }
+  return octree_->isNodeOccupied(node) &&
+         !(params_.filter_speckles && isSpeckleNode(key));
+}
+
 bool OctomapWorld::checkSinglePoseCollision(
     const Eigen::Vector3d& robot_position) const {
   if (params_.treat_unknown_as_occupied) {
@@ -988,8 +1658,11 @@ void OctomapWorld::getChangedPoints(
 
   for (octomap::KeyBoolMap::const_iterator iter = start_key; iter != end_key;
       ++iter) {
-    octomap::OcTreeNode* node = octree_->search(iter->first);
-    bool occupied = octree_->isNodeOccupied(node);
+    // The occupied index, if up to date, saves the search in the tree.
+    const bool occupied =
+        occupied_index_valid_
+            ? isVoxelOccupiedInIndex(iter->first)
+            : octree_->isNodeOccupied(octree_->search(iter->first));
     Eigen::Vector3d center =
         pointOctomapToEigen(octree_->keyToCoord(iter->first));
 
@@ -1001,6 +1674,27 @@ void OctomapWorld::getChangedPoints(
   octree_->resetChangeDetection();
 }
 
+size_t OctomapWorld::getChangedLeavesMsg(octomap_msgs::Octomap* msg) {
+  const size_t num_changed = octree_->numChangesDetected();
+  if (msg != NULL) {
+    octomap::OcTree changed_tree(octree_->getResolution());
+    const bool lazy_eval = true;
+    for (octomap::KeyBoolMap::const_iterator
+             iter = octree_->changedKeysBegin(),
+             end = octree_->changedKeysEnd();
+         iter != end; ++iter) {
+      const octomap::OcTreeNode* node = octree_->search(iter->first);
+      if (node != NULL) {
+        changed_tree.setNodeValue(iter->first, node->getLogOdds(), lazy_eval);
+      }
+    }
+    changed_tree.updateInnerOccupancy();
+    octomap_msgs::fullMapToMsg(changed_tree, *msg);
+  }
+  octree_->resetChangeDetection();
+  return num_changed;
+}
+
 void OctomapWorld::coordToKey(const Eigen::Vector3d& coord,
                               octomap::OcTreeKey* key) const {
   octomap::point3d position(coord.x(), coord.y(), coord.z());
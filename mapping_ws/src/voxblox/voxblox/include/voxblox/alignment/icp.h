@@ -41,6 +41,8 @@
 #define VOXBLOX_ALIGNMENT_ICP_H_
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <memory>
 #include <thread>
 
@@ -103,6 +105,11 @@ class ICP {
      */
     FloatingPoint inital_rotation_weighting = 100.0;
     size_t num_threads = std::thread::hardware_concurrency();
+    /**
+     * Maximum duration of runICP in seconds, 0 for no limit. If the alignment
+     * takes longer, it is abandoned and the initial guess is returned.
+     */
+    FloatingPoint time_budget_s = 0.0;
   };
 
   /**
@@ -113,7 +120,8 @@ class ICP {
 
   /**
    * Runs the ICP method to align the points with the tsdf_layer.
-   * @return the number of mini batches that were successful.
+   * @return the number of mini batches that were successful, 0 if the time
+   * budget was exceeded.
    */
   size_t runICP(const Layer<TsdfVoxel>& tsdf_layer, const Pointcloud& points,
                 const Transformation& inital_T_tsdf_sensor,
@@ -124,6 +132,9 @@ class ICP {
 
   bool refiningRollPitch() { return config_.refine_roll_pitch; }
 
+  /// Whether the last runICP call exceeded the time budget.
+  bool timedOut() const { return timed_out_; }
+
  private:
   typedef Transformation::Vector6 Vector6;
 
@@ -223,6 +234,11 @@ class ICP {
   std::atomic<size_t> atomic_idx_;
   std::mutex mutex_;
 
+  /// End of the time budget of the current run, if it has one.
+  bool has_deadline_;
+  std::chrono::steady_clock::time_point deadline_;
+  std::atomic<bool> timed_out_;
+
   FloatingPoint voxel_size_;
   FloatingPoint voxel_size_inv_;
   std::shared_ptr<Interpolator<TsdfVoxel>> interpolator_;
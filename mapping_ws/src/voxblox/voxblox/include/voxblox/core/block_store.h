@@ -0,0 +1,95 @@
+#ifndef VOXBLOX_CORE_BLOCK_STORE_H_
+#define VOXBLOX_CORE_BLOCK_STORE_H_
+
+#include <memory>
+#include <string>
+
+#include <glog/logging.h>
+
+#include "voxblox/Block.pb.h"
+#include "voxblox/core/block_hash.h"
+#include "voxblox/core/common.h"
+#include "voxblox/core/layer.h"
+
+namespace voxblox {
+
+/**
+ * On-disk store of the blocks of a layer, used to page blocks out of memory.
+ * Blocks far from the robot are evicted from the layer into the store, and
+ * faulted back into the layer when the robot gets close to them again, so the
+ * memory used by the layer is bounded by the size of the neighborhood of the
+ * robot instead of the size of the mission.
+ *
+ * Each block is stored in its own file (named after its BlockIndex) holding
+ * the BlockProto of the block, i.e. the format used by Layer::saveToFile().
+ * Only the indices of the stored blocks are kept in memory.
+ */
+template <typename VoxelType>
+class BlockStore {
+ public:
+  typedef std::shared_ptr<BlockStore> Ptr;
+  typedef Layer<VoxelType> LayerType;
+  typedef typename LayerType::BlockType BlockType;
+
+  /// The directory is created if it does not exist.
+  explicit BlockStore(const std::string& directory);
+
+  /// Removes the stored block files.
+  ~BlockStore() { clear(); }
+
+  /**
+   * Moves all the blocks of the layer with their origin farther than
+   * max_distance from center into the store. If a block with the same index
+   * is already stored (the block has been reallocated while it was paged
+   * out), the two are merged.
+   * Returns the number of evicted blocks.
+   */
+  size_t evictDistantBlocks(const Point& center, FloatingPoint max_distance,
+                            LayerType* layer);
+
+  /**
+   * Moves all the stored blocks with their origin within max_distance from
+   * center back into the layer, merging them with the blocks the layer
+   * already has at the same index. Loaded blocks are flagged as updated.
+   * Returns the number of loaded blocks.
+   */
+  size_t loadBlocksInRadius(const Point& center, FloatingPoint max_distance,
+                            LayerType* layer);
+
+  /// Moves a single block back into the layer, returns false if not stored.
+  bool loadBlock(const BlockIndex& index, LayerType* layer);
+
+  bool hasBlock(const BlockIndex& index) const {
+    return stored_blocks_.count(index) > 0u;
+  }
+
+  size_t getNumberOfStoredBlocks() const { return stored_blocks_.size(); }
+
+  /**
+   * Saves the blocks of the layer together with the stored blocks to a layer
+   * file, which can be loaded with io::LoadLayer() or
+   * io::LoadBlocksFromFile(). The stored blocks are streamed one at a time.
+   */
+  bool saveLayerToFile(const LayerType& layer, const std::string& file_path,
+                       bool clear_file = true) const;
+
+  /// Removes all the stored blocks.
+  void clear();
+
+  const std::string& getDirectory() const { return directory_; }
+
+ private:
+  std::string getBlockFilePath(const BlockIndex& index) const;
+
+  bool writeBlock(const BlockIndex& index, const BlockType& block) const;
+  bool readBlock(const BlockIndex& index, BlockProto* block_proto) const;
+
+  std::string directory_;
+  IndexSet stored_blocks_;
+};
+
+}  // namespace voxblox
+
+#include "voxblox/core/block_store_inl.h"
+
+#endif  // VOXBLOX_CORE_BLOCK_STORE_H_
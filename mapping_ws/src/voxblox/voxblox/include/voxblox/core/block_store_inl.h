@@ -0,0 +1,234 @@
+#ifndef VOXBLOX_CORE_BLOCK_STORE_INL_H_
+#define VOXBLOX_CORE_BLOCK_STORE_INL_H_
+
+#include <sys/stat.h>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>  // NOLINT
+#include <string>
+
+#include "voxblox/Layer.pb.h"
+#include "voxblox/utils/protobuf_utils.h"
+
+namespace voxblox {
+
+template <typename VoxelType>
+BlockStore<VoxelType>::BlockStore(const std::string& directory)
+    : directory_(directory) {
+  CHECK(!directory_.empty()) << "The block store needs a directory.";
+  if (mkdir(directory_.c_str(), 0755) != 0 && errno != EEXIST) {
+    LOG(FATAL) << "Could not create the block store directory " << directory_
+               << ": " << std::strerror(errno);
+  }
+}
+
+template <typename VoxelType>
+std::string BlockStore<VoxelType>::getBlockFilePath(
+    const BlockIndex& index) const {
+  return directory_ + "/" + std::to_string(index.x()) + "_" +
+         std::to_string(index.y()) + "_" + std::to_string(index.z()) +
+         ".block";
+}
+
+template <typename VoxelType>
+bool BlockStore<VoxelType>::writeBlock(const BlockIndex& index,
+                                       const BlockType& block) const {
+  const std::string file_path = getBlockFilePath(index);
+  std::fstream outfile(file_path, std::fstream::out | std::fstream::binary |
+                                      std::fstream::trunc);
+  if (!outfile.is_open()) {
+    LOG(ERROR) << "Could not open file for writing: " << file_path;
+    return false;
+  }
+  BlockProto block_proto;
+  block.getProto(&block_proto);
+  if (!utils::writeProtoMsgToStream(block_proto, &outfile)) {
+    LOG(ERROR) << "Could not write block message to " << file_path;
+    return false;
+  }
+  return true;
+}
+
+template <typename VoxelType>
+bool BlockStore<VoxelType>::readBlock(const BlockIndex& index,
+                                      BlockProto* block_proto) const {
+  CHECK_NOTNULL(block_proto);
+  const std::string file_path = getBlockFilePath(index);
+  std::ifstream infile(file_path, std::ios::in | std::ios::binary);
+  if (!infile.is_open()) {
+    LOG(ERROR) << "Could not open file for reading: " << file_path;
+    return false;
+  }
+  uint64_t tmp_byte_offset = 0u;
+  if (!utils::readProtoMsgFromStream(&infile, block_proto,
+                                     &tmp_byte_offset)) {
+    LOG(ERROR) << "Could not read block message from " << file_path;
+    return false;
+  }
+  return true;
+}
+
+template <typename VoxelType>
+size_t BlockStore<VoxelType>::evictDistantBlocks(const Point& center,
+                                                 FloatingPoint max_distance,
+                                                 LayerType* layer) {
+  CHECK_NOTNULL(layer);
+  BlockIndexList blocks;
+  layer->getAllAllocatedBlocks(&blocks);
+
+  size_t num_evicted = 0u;
+  for (const BlockIndex& index : blocks) {
+    typename BlockType::Ptr block_ptr = layer->getBlockPtrByIndex(index);
+    if ((block_ptr->origin() - center).squaredNorm() <=
+        max_distance * max_distance) {
+      continue;
+    }
+
+    // The block has been allocated again while an older version of it was
+    // paged out (e.g. a long ray reached it), keep the data of both.
+    if (hasBlock(index)) {
+      BlockProto block_proto;
+      if (readBlock(index, &block_proto)) {
+        block_ptr->mergeBlock(BlockType(block_proto));
+      }
+    }
+
+    if (writeBlock(index, *block_ptr)) {
+      stored_blocks_.insert(index);
+      layer->removeBlock(index);
+      ++num_evicted;
+    }
+  }
+  return num_evicted;
+}
+
+template <typename VoxelType>
+bool BlockStore<VoxelType>::loadBlock(const BlockIndex& index,
+                                      LayerType* layer) {
+  CHECK_NOTNULL(layer);
+  typename IndexSet::iterator it = stored_blocks_.find(index);
+  if (it == stored_blocks_.end()) {
+    return false;
+  }
+
+  BlockProto block_proto;
+  if (!readBlock(index, &block_proto) ||
+      !layer->addBlockFromProto(block_proto,
+                                LayerType::BlockMergingStrategy::kMerge)) {
+    return false;
+  }
+  stored_blocks_.erase(it);
+  std::remove(getBlockFilePath(index).c_str());
+  return true;
+}
+
+template <typename VoxelType>
+size_t BlockStore<VoxelType>::loadBlocksInRadius(const Point& center,
+                                                 FloatingPoint max_distance,
+                                                 LayerType* layer) {
+  CHECK_NOTNULL(layer);
+  if (stored_blocks_.empty()) {
+    return 0u;
+  }
+
+  const FloatingPoint block_size = layer->block_size();
+  const FloatingPoint max_distance_squared = max_distance * max_distance;
+
+  // Visit either the stored indices or the block indices around the center,
+  // whichever are fewer.
+  BlockIndexList candidates;
+  const BlockIndex min_index = getGridIndexFromPoint<BlockIndex>(
+      Point(center.array() - max_distance), 1.0 / block_size);
+  const BlockIndex max_index = getGridIndexFromPoint<BlockIndex>(
+      Point(center.array() + max_distance), 1.0 / block_size);
+  const double num_indices_in_radius =
+      (max_index - min_index + BlockIndex::Ones()).cast<double>().prod();
+  if (num_indices_in_radius < static_cast<double>(stored_blocks_.size())) {
+    BlockIndex index;
+    for (index.x() = min_index.x(); index.x() <= max_index.x(); ++index.x()) {
+      for (index.y() = min_index.y(); index.y() <= max_index.y(); ++index.y()) {
+        for (index.z() = min_index.z(); index.z() <= max_index.z();
+             ++index.z()) {
+          if (hasBlock(index)) {
+            candidates.push_back(index);
+          }
+        }
+      }
+    }
+  } else {
+    candidates.assign(stored_blocks_.begin(), stored_blocks_.end());
+  }
+
+  size_t num_loaded = 0u;
+  for (const BlockIndex& index : candidates) {
+    const Point origin = getOriginPointFromGridIndex(index, block_size);
+    if ((origin - center).squaredNorm() <= max_distance_squared &&
+        loadBlock(index, layer)) {
+      ++num_loaded;
+    }
+  }
+  return num_loaded;
+}
+
+template <typename VoxelType>
+bool BlockStore<VoxelType>::saveLayerToFile(const LayerType& layer,
+                                            const std::string& file_path,
+                                            bool clear_file) const {
+  std::fstream outfile;
+  std::ios_base::openmode file_flags = std::fstream::out | std::fstream::binary;
+  if (!clear_file) {
+    file_flags |= std::fstream::app | std::fstream::ate;
+  } else {
+    file_flags |= std::fstream::trunc;
+  }
+  outfile.open(file_path, file_flags);
+  if (!outfile.is_open()) {
+    LOG(ERROR) << "Could not open file for writing: " << file_path;
+    return false;
+  }
+
+  // One layer header, then the blocks in memory and the stored ones.
+  const uint32_t num_messages =
+      1u + layer.getNumberOfAllocatedBlocks() + stored_blocks_.size();
+  if (!utils::writeProtoMsgCountToStream(num_messages, &outfile)) {
+    LOG(ERROR) << "Could not write message number to file.";
+    return false;
+  }
+
+  LayerProto proto_layer;
+  layer.getProto(&proto_layer);
+  if (!utils::writeProtoMsgToStream(proto_layer, &outfile)) {
+    LOG(ERROR) << "Could not write layer header message.";
+    return false;
+  }
+
+  constexpr bool kIncludeAllBlocks = true;
+  if (!layer.saveBlocksToStream(kIncludeAllBlocks, BlockIndexList(),
+                                &outfile)) {
+    return false;
+  }
+
+  for (const BlockIndex& index : stored_blocks_) {
+    BlockProto block_proto;
+    if (!readBlock(index, &block_proto) ||
+        !utils::writeProtoMsgToStream(block_proto, &outfile)) {
+      LOG(ERROR) << "Could not write stored block " << index.transpose();
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename VoxelType>
+void BlockStore<VoxelType>::clear() {
+  for (const BlockIndex& index : stored_blocks_) {
+    std::remove(getBlockFilePath(index).c_str());
+  }
+  stored_blocks_.clear();
+}
+
+}  // namespace voxblox
+
+#endif  // VOXBLOX_CORE_BLOCK_STORE_INL_H_
@@ -272,10 +272,18 @@ inline void transformPointcloud(const Transformation& T_N_O,
                                 Pointcloud* ptcloud_out) {
   ptcloud_out->clear();
   ptcloud_out->resize(ptcloud.size());
-
-  for (size_t i = 0; i < ptcloud.size(); ++i) {
-    (*ptcloud_out)[i] = T_N_O * ptcloud[i];
+  if (ptcloud.empty()) {
+    return;
   }
+
+  // The points are contiguous, transform them all with one matrix product
+  // instead of rotating them one by one by the quaternion.
+  typedef Eigen::Matrix<FloatingPoint, 3, Eigen::Dynamic> PointMatrix;
+  const Eigen::Map<const PointMatrix> points_in(ptcloud[0].data(), 3,
+                                                ptcloud.size());
+  Eigen::Map<PointMatrix> points_out((*ptcloud_out)[0].data(), 3,
+                                     ptcloud_out->size());
+  T_N_O.transformVectorized(points_in, &points_out);
 }
 
 }  // namespace voxblox
@@ -0,0 +1,69 @@
+#ifndef VOXBLOX_INTEGRATOR_DEVICE_TSDF_BACKEND_H_
+#define VOXBLOX_INTEGRATOR_DEVICE_TSDF_BACKEND_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "voxblox/integrator/device_tsdf_kernels.h"
+
+namespace voxblox {
+namespace device_tsdf {
+
+/**
+ * Runs the kernels of the DeviceTsdfIntegrator on its own memory: the device
+ * memory for the CUDA backend, plain buffers and the integrator threads for
+ * the host backend. The map stays in host memory (the layer), the backend
+ * only holds the blocks of the scan being integrated. Buffers are kept from
+ * one scan to the next and only grow.
+ */
+class Backend {
+ public:
+  virtual ~Backend() = default;
+
+  /// True if the kernels run on a CUDA device.
+  virtual bool isCuda() const = 0;
+
+  /// Uploads the rays of the scan.
+  virtual void uploadRays(const std::vector<Ray>& rays) = 0;
+
+  /**
+   * Clears the block table, resizing it to 2^capacity_bits entries, and runs
+   * allocateRayBlocks() for all the rays. Returns false if the table got full.
+   */
+  virtual bool allocateBlocks(const Params& params, int capacity_bits) = 0;
+
+  /// Downloads the keys of the block table (kEmptyBlockKey if not used).
+  virtual void downloadBlockKeys(std::vector<BlockKey>* keys) = 0;
+
+  /**
+   * Uploads the slot of each entry of the block table and the voxels of the
+   * blocks, voxels_per_block voxels per slot.
+   */
+  virtual void uploadBlocks(const std::vector<int>& slots,
+                            const std::vector<DeviceVoxel>& voxels) = 0;
+
+  /// Runs integrateRay() for all the rays, then fuseVoxel() for all voxels.
+  virtual void integrate(const Params& params) = 0;
+
+  /**
+   * Downloads the blocks with at least a changed voxel into their slots of
+   * voxels (the other slots are left as they are). block_changed gets a flag
+   * per slot.
+   */
+  virtual void downloadChangedBlocks(std::vector<unsigned char>* block_changed,
+                                     std::vector<DeviceVoxel>* voxels) = 0;
+};
+
+/// Runs the kernels on num_threads host threads.
+std::unique_ptr<Backend> createHostBackend(size_t num_threads);
+
+#ifdef VOXBLOX_WITH_CUDA
+/// Returns nullptr if there is no CUDA device.
+std::unique_ptr<Backend> createCudaBackend();
+#endif
+
+}  // namespace device_tsdf
+}  // namespace voxblox
+
+#endif  // VOXBLOX_INTEGRATOR_DEVICE_TSDF_BACKEND_H_
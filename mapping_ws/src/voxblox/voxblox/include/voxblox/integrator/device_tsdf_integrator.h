@@ -0,0 +1,76 @@
+#ifndef VOXBLOX_INTEGRATOR_DEVICE_TSDF_INTEGRATOR_H_
+#define VOXBLOX_INTEGRATOR_DEVICE_TSDF_INTEGRATOR_H_
+
+#include <memory>
+#include <vector>
+
+#include "voxblox/core/block_hash.h"
+#include "voxblox/core/common.h"
+#include "voxblox/core/layer.h"
+#include "voxblox/core/voxel.h"
+#include "voxblox/integrator/device_tsdf_backend.h"
+#include "voxblox/integrator/tsdf_integrator.h"
+
+namespace voxblox {
+
+/**
+ * TSDF integrator that runs the ray casting on a CUDA device. The layer stays
+ * the map in host memory: for each scan the valid points are uploaded as
+ * rays, a first kernel finds the blocks the rays traverse (the blocks in the
+ * frustum), these blocks are allocated in the layer and uploaded, then the
+ * rays are cast again (one thread per ray) to sum up their measurements per
+ * voxel and a last kernel (one thread per voxel) fuses the sums into the
+ * voxels. Only the blocks with a changed voxel are downloaded back into the
+ * layer, so the mesh and ESDF integrators see the usual updated blocks.
+ *
+ * The rays traverse the same voxels as with the SimpleTsdfIntegrator, but the
+ * measurements of a scan are merged into a voxel as one weighted average (as
+ * the MergedTsdfIntegrator does for the points falling in the same voxel),
+ * so the distances are only clamped to the truncation distance once per scan.
+ *
+ * The CUDA backend is built with -DVOXBLOX_WITH_CUDA=ON. Without it (or
+ * without a CUDA device) the same kernels run on the integrator threads.
+ */
+class DeviceTsdfIntegrator : public TsdfIntegratorBase {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  DeviceTsdfIntegrator(const Config& config, Layer<TsdfVoxel>* layer);
+
+  void integratePointCloud(const Transformation& T_G_C,
+                           const Pointcloud& points_C, const Colors& colors,
+                           const bool freespace_points = false);
+
+  /// True if the kernels run on a CUDA device, false if on the host.
+  bool isUsingCuda() const { return backend_->isCuda(); }
+
+ private:
+  /// Fills rays_ with the valid points, returns false if there is none.
+  bool computeRays(const Transformation& T_G_C, const Pointcloud& points_C,
+                   const Colors& colors, const bool freespace_points);
+
+  device_tsdf::Params getParams(const Transformation& T_G_C) const;
+
+  /**
+   * Allocates in the layer the blocks of the block table, assigns them a slot
+   * and copies their voxels in staged_voxels_.
+   */
+  void stageBlocks();
+
+  std::unique_ptr<device_tsdf::Backend> backend_;
+
+  /// The block table has 2^block_table_bits_ entries, it grows with the scans.
+  int block_table_bits_;
+
+  std::vector<device_tsdf::Ray> rays_;
+  std::vector<device_tsdf::BlockKey> block_keys_;
+  std::vector<int> block_slots_;
+  /// Layer blocks of the slots, in slot order.
+  std::vector<Block<TsdfVoxel>::Ptr> staged_blocks_;
+  std::vector<device_tsdf::DeviceVoxel> staged_voxels_;
+  std::vector<unsigned char> block_changed_;
+};
+
+}  // namespace voxblox
+
+#endif  // VOXBLOX_INTEGRATOR_DEVICE_TSDF_INTEGRATOR_H_
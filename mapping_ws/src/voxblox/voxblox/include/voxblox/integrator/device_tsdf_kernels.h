@@ -0,0 +1,455 @@
+#ifndef VOXBLOX_INTEGRATOR_DEVICE_TSDF_KERNELS_H_
+#define VOXBLOX_INTEGRATOR_DEVICE_TSDF_KERNELS_H_
+
+/**
+ * Kernels of the DeviceTsdfIntegrator. They are compiled both by nvcc for the
+ * CUDA backend and by the host compiler for the host backend, so this header
+ * only uses plain C++ (no Eigen, glog or voxblox types) and the data it works
+ * on is made of flat POD structs that can be copied to device memory as they
+ * are.
+ */
+
+#include <cmath>
+#include <cstdint>
+
+#ifdef __CUDACC__
+#define VOXBLOX_HOST_DEVICE __host__ __device__
+#else
+#define VOXBLOX_HOST_DEVICE
+#endif
+
+namespace voxblox {
+namespace device_tsdf {
+
+/// Same as kEpsilon, used to floor the scaled coordinates.
+constexpr float kCoordinateEpsilon = 1e-6f;
+/// Same as kFloatEpsilon, used for the weights.
+constexpr float kWeightEpsilon = 1e-6f;
+
+/// Block indices are packed in 64 bits, 21 bits per axis.
+typedef unsigned long long BlockKey;  // NOLINT (matches CUDA atomicCAS)
+constexpr int kBlockKeyBits = 21;
+constexpr int kBlockKeyOffset = 1 << (kBlockKeyBits - 1);
+constexpr BlockKey kBlockKeyMask = (BlockKey(1) << kBlockKeyBits) - 1;
+/// Marks the empty entries of the block table (the top bit of a key is 0).
+constexpr BlockKey kEmptyBlockKey = ~BlockKey(0);
+
+/// Same memory layout as TsdfVoxel, so blocks are staged with a memcpy.
+struct DeviceVoxel {
+  float distance;
+  float weight;
+  uint8_t color[4];
+};
+
+/// Integration parameters, the same for all the rays of a scan.
+struct Params {
+  float origin[3];
+  float voxel_size;
+  float voxel_size_inv;
+  float voxels_per_side_inv;
+  int voxels_per_side;
+  float truncation_distance;
+  float max_weight;
+  float max_ray_length_m;
+  bool voxel_carving_enabled;
+  bool use_weight_dropoff;
+  bool use_sparsity_compensation_factor;
+  float sparsity_compensation_factor;
+};
+
+/// A valid point of the scan, in the global frame.
+struct Ray {
+  float point_G[3];
+  /// Weight of the measurement, see TsdfIntegratorBase::getVoxelWeight().
+  float weight;
+  uint8_t color[4];
+  /// True if the ray only clears the space in front of the point.
+  bool is_clearing;
+};
+
+/**
+ * Open addressing hash table from the packed index of a block to its slot in
+ * the staged voxel buffer. The capacity is 2^capacity_bits.
+ */
+struct BlockTable {
+  BlockKey* keys;
+  int* slots;
+  int capacity_bits;
+};
+
+/// Sums of the measurements of a scan for a voxel.
+struct VoxelAccumulator {
+  float weighted_distance;
+  float weight;
+  /// Only the measurements within the truncation distance are colored.
+  float color_weight;
+  float weighted_color[4];
+};
+
+VOXBLOX_HOST_DEVICE inline BlockKey packBlockKey(int x, int y, int z) {
+  return ((BlockKey(x + kBlockKeyOffset) & kBlockKeyMask)
+          << (2 * kBlockKeyBits)) |
+         ((BlockKey(y + kBlockKeyOffset) & kBlockKeyMask) << kBlockKeyBits) |
+         (BlockKey(z + kBlockKeyOffset) & kBlockKeyMask);
+}
+
+VOXBLOX_HOST_DEVICE inline void unpackBlockKey(BlockKey key, int* x, int* y,
+                                               int* z) {
+  *x = static_cast<int>((key >> (2 * kBlockKeyBits)) & kBlockKeyMask) -
+       kBlockKeyOffset;
+  *y = static_cast<int>((key >> kBlockKeyBits) & kBlockKeyMask) -
+       kBlockKeyOffset;
+  *z = static_cast<int>(key & kBlockKeyMask) - kBlockKeyOffset;
+}
+
+VOXBLOX_HOST_DEVICE inline unsigned int hashBlockKey(BlockKey key,
+                                                     int capacity_bits) {
+  // Fibonacci hashing, the top bits are the best mixed.
+  return static_cast<unsigned int>((key * 0x9E3779B97F4A7C15ull) >>
+                                   (64 - capacity_bits));
+}
+
+VOXBLOX_HOST_DEVICE inline BlockKey atomicCompareAndSwap(BlockKey* address,
+                                                         BlockKey expected,
+                                                         BlockKey desired) {
+#ifdef __CUDA_ARCH__
+  return atomicCAS(address, expected, desired);
+#else
+  __atomic_compare_exchange_n(address, &expected, desired, false,
+                              __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+  return expected;
+#endif
+}
+
+VOXBLOX_HOST_DEVICE inline void atomicAddFloat(float* address, float value) {
+#ifdef __CUDA_ARCH__
+  atomicAdd(address, value);
+#else
+  uint32_t* bits = reinterpret_cast<uint32_t*>(address);
+  uint32_t old_bits = __atomic_load_n(bits, __ATOMIC_RELAXED);
+  while (true) {
+    float old_value;
+    __builtin_memcpy(&old_value, &old_bits, sizeof(float));
+    const float new_value = old_value + value;
+    uint32_t new_bits;
+    __builtin_memcpy(&new_bits, &new_value, sizeof(float));
+    if (__atomic_compare_exchange_n(bits, &old_bits, new_bits, true,
+                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+      return;
+    }
+  }
+#endif
+}
+
+/**
+ * Inserts a block in the table, returns false if the table is full.
+ * Thread safe.
+ */
+VOXBLOX_HOST_DEVICE inline bool insertBlock(const BlockTable& table,
+                                            BlockKey key) {
+  const unsigned int mask = (1u << table.capacity_bits) - 1u;
+  unsigned int entry = hashBlockKey(key, table.capacity_bits);
+  for (unsigned int probe = 0u; probe <= mask; ++probe) {
+    const BlockKey previous_key =
+        atomicCompareAndSwap(&table.keys[entry], kEmptyBlockKey, key);
+    if (previous_key == kEmptyBlockKey || previous_key == key) {
+      return true;
+    }
+    entry = (entry + 1u) & mask;
+  }
+  return false;
+}
+
+/// Returns the slot of a block, -1 if it is not in the table.
+VOXBLOX_HOST_DEVICE inline int findBlockSlot(const BlockTable& table,
+                                             BlockKey key) {
+  const unsigned int mask = (1u << table.capacity_bits) - 1u;
+  unsigned int entry = hashBlockKey(key, table.capacity_bits);
+  for (unsigned int probe = 0u; probe <= mask; ++probe) {
+    const BlockKey entry_key = table.keys[entry];
+    if (entry_key == key) {
+      return table.slots[entry];
+    } else if (entry_key == kEmptyBlockKey) {
+      return -1;
+    }
+    entry = (entry + 1u) & mask;
+  }
+  return -1;
+}
+
+/**
+ * Voxel traversal of a segment, the same as RayCaster (including its floating
+ * point operations, so both visit the same voxels). Works in PRE-SCALED
+ * coordinates, where one unit = one voxel size.
+ */
+struct RayWalker {
+  int index[3];
+  int step_signs[3];
+  float t_to_next_boundary[3];
+  float t_step_size[3];
+  unsigned int length_in_steps;
+  unsigned int current_step;
+
+  VOXBLOX_HOST_DEVICE void setup(const float start_scaled[3],
+                                 const float end_scaled[3]) {
+    int length = 0;
+    for (int i = 0; i < 3; ++i) {
+      index[i] = static_cast<int>(floorf(start_scaled[i] + kCoordinateEpsilon));
+      const int end_index =
+          static_cast<int>(floorf(end_scaled[i] + kCoordinateEpsilon));
+      length += (end_index > index[i]) ? (end_index - index[i])
+                                       : (index[i] - end_index);
+
+      const float ray_scaled = end_scaled[i] - start_scaled[i];
+      step_signs[i] = (ray_scaled == 0.0f) ? 0 : (ray_scaled < 0.0f ? -1 : 1);
+      const float corrected_step = (step_signs[i] > 0) ? 1.0f : 0.0f;
+      const float start_scaled_shifted =
+          start_scaled[i] - static_cast<float>(index[i]);
+      t_to_next_boundary[i] =
+          (corrected_step - start_scaled_shifted) / ray_scaled;
+      t_step_size[i] = static_cast<float>(step_signs[i]) / ray_scaled;
+    }
+    length_in_steps = static_cast<unsigned int>(length);
+    current_step = 0u;
+  }
+
+  /// Returns false once the walk is over.
+  VOXBLOX_HOST_DEVICE bool next(int voxel_index[3]) {
+    if (current_step++ > length_in_steps) {
+      return false;
+    }
+    voxel_index[0] = index[0];
+    voxel_index[1] = index[1];
+    voxel_index[2] = index[2];
+
+    int t_min_idx = 0;
+    if (t_to_next_boundary[1] < t_to_next_boundary[t_min_idx]) {
+      t_min_idx = 1;
+    }
+    if (t_to_next_boundary[2] < t_to_next_boundary[t_min_idx]) {
+      t_min_idx = 2;
+    }
+    index[t_min_idx] += step_signs[t_min_idx];
+    t_to_next_boundary[t_min_idx] += t_step_size[t_min_idx];
+    return true;
+  }
+};
+
+/**
+ * Sets up the walk of the voxels a ray updates, the same segment as the one
+ * of RayCaster: up to the truncation distance behind the point, from the
+ * origin if voxel carving is enabled (else from the truncation distance in
+ * front of the point). Clearing rays stop at the truncation distance in front
+ * of the point (and at max_ray_length_m).
+ */
+VOXBLOX_HOST_DEVICE inline void setupRayWalker(const Params& params,
+                                               const Ray& ray,
+                                               RayWalker* walker) {
+  float v_point_origin[3];
+  float squared_norm = 0.0f;
+  for (int i = 0; i < 3; ++i) {
+    v_point_origin[i] = ray.point_G[i] - params.origin[i];
+    squared_norm += v_point_origin[i] * v_point_origin[i];
+  }
+  const float ray_length = sqrtf(squared_norm);
+  float unit_ray[3];
+  for (int i = 0; i < 3; ++i) {
+    unit_ray[i] =
+        (squared_norm > 0.0f) ? v_point_origin[i] / ray_length : v_point_origin[i];
+  }
+
+  float start_scaled[3], end_scaled[3];
+  if (ray.is_clearing) {
+    const float clearing_length =
+        fminf(fmaxf(ray_length - params.truncation_distance, 0.0f),
+              params.max_ray_length_m);
+    for (int i = 0; i < 3; ++i) {
+      const float ray_end = params.origin[i] + unit_ray[i] * clearing_length;
+      const float ray_start =
+          params.voxel_carving_enabled ? params.origin[i] : ray_end;
+      start_scaled[i] = ray_start * params.voxel_size_inv;
+      end_scaled[i] = ray_end * params.voxel_size_inv;
+    }
+  } else {
+    for (int i = 0; i < 3; ++i) {
+      const float ray_end =
+          ray.point_G[i] + unit_ray[i] * params.truncation_distance;
+      const float ray_start =
+          params.voxel_carving_enabled
+              ? params.origin[i]
+              : ray.point_G[i] - unit_ray[i] * params.truncation_distance;
+      start_scaled[i] = ray_start * params.voxel_size_inv;
+      end_scaled[i] = ray_end * params.voxel_size_inv;
+    }
+  }
+  walker->setup(start_scaled, end_scaled);
+}
+
+/// Splits a global voxel index into the key of its block and its linear index.
+VOXBLOX_HOST_DEVICE inline void getBlockKeyAndLinearIndex(
+    const Params& params, const int voxel_index[3], BlockKey* key,
+    int* linear_index) {
+  int block_index[3], local_index[3];
+  for (int i = 0; i < 3; ++i) {
+    block_index[i] = static_cast<int>(floorf(
+        static_cast<float>(voxel_index[i]) * params.voxels_per_side_inv));
+    local_index[i] = voxel_index[i] - block_index[i] * params.voxels_per_side;
+  }
+  *key = packBlockKey(block_index[0], block_index[1], block_index[2]);
+  *linear_index =
+      local_index[0] +
+      params.voxels_per_side *
+          (local_index[1] + local_index[2] * params.voxels_per_side);
+}
+
+/**
+ * First pass, one thread per ray: inserts the blocks traversed by the ray in
+ * the table. Returns false if the table is full.
+ */
+VOXBLOX_HOST_DEVICE inline bool allocateRayBlocks(const Params& params,
+                                                  const Ray& ray,
+                                                  const BlockTable& table) {
+  RayWalker walker;
+  setupRayWalker(params, ray, &walker);
+
+  BlockKey last_key = kEmptyBlockKey;
+  int voxel_index[3];
+  while (walker.next(voxel_index)) {
+    BlockKey key;
+    int linear_index;
+    getBlockKeyAndLinearIndex(params, voxel_index, &key, &linear_index);
+    if (key != last_key) {
+      if (!insertBlock(table, key)) {
+        return false;
+      }
+      last_key = key;
+    }
+  }
+  return true;
+}
+
+/// Same as TsdfIntegratorBase::computeDistance().
+VOXBLOX_HOST_DEVICE inline float computeDistance(const Params& params,
+                                                 const Ray& ray,
+                                                 const int voxel_index[3]) {
+  float dist_G_squared = 0.0f, dot = 0.0f;
+  for (int i = 0; i < 3; ++i) {
+    const float voxel_center =
+        (static_cast<float>(voxel_index[i]) + 0.5f) * params.voxel_size;
+    const float v_voxel_origin = voxel_center - params.origin[i];
+    const float v_point_origin = ray.point_G[i] - params.origin[i];
+    dist_G_squared += v_point_origin * v_point_origin;
+    dot += v_voxel_origin * v_point_origin;
+  }
+  const float dist_G = sqrtf(dist_G_squared);
+  return dist_G - dot / dist_G;
+}
+
+/// Same as TsdfIntegratorBase::computeUpdatedWeight().
+VOXBLOX_HOST_DEVICE inline float computeUpdatedWeight(const Params& params,
+                                                      float sdf,
+                                                      float weight) {
+  float updated_weight = weight;
+  const float dropoff_epsilon = params.voxel_size;
+  if (params.use_weight_dropoff && sdf < -dropoff_epsilon) {
+    updated_weight = weight * (params.truncation_distance + sdf) /
+                     (params.truncation_distance - dropoff_epsilon);
+    updated_weight = fmaxf(updated_weight, 0.0f);
+  }
+  if (params.use_sparsity_compensation_factor &&
+      fabsf(sdf) < params.truncation_distance) {
+    updated_weight *= params.sparsity_compensation_factor;
+  }
+  return updated_weight;
+}
+
+/**
+ * Second pass, one thread per ray: adds the measurement of the ray to the
+ * accumulators of the voxels it traverses. All the blocks of the ray must be
+ * in the table (see allocateRayBlocks()).
+ */
+VOXBLOX_HOST_DEVICE inline void integrateRay(const Params& params,
+                                             const Ray& ray,
+                                             const BlockTable& table,
+                                             VoxelAccumulator* accumulators) {
+  RayWalker walker;
+  setupRayWalker(params, ray, &walker);
+  const int voxels_per_block =
+      params.voxels_per_side * params.voxels_per_side * params.voxels_per_side;
+
+  BlockKey last_key = kEmptyBlockKey;
+  int slot = -1;
+  int voxel_index[3];
+  while (walker.next(voxel_index)) {
+    BlockKey key;
+    int linear_index;
+    getBlockKeyAndLinearIndex(params, voxel_index, &key, &linear_index);
+    if (key != last_key) {
+      slot = findBlockSlot(table, key);
+      last_key = key;
+    }
+    if (slot < 0) {
+      continue;
+    }
+
+    const float sdf = computeDistance(params, ray, voxel_index);
+    const float weight = computeUpdatedWeight(params, sdf, ray.weight);
+    if (weight <= 0.0f) {
+      continue;
+    }
+
+    VoxelAccumulator* accumulator =
+        &accumulators[static_cast<size_t>(slot) * voxels_per_block +
+                      linear_index];
+    atomicAddFloat(&accumulator->weighted_distance, weight * sdf);
+    atomicAddFloat(&accumulator->weight, weight);
+    if (fabsf(sdf) < params.truncation_distance) {
+      atomicAddFloat(&accumulator->color_weight, weight);
+      for (int c = 0; c < 4; ++c) {
+        atomicAddFloat(&accumulator->weighted_color[c],
+                       weight * static_cast<float>(ray.color[c]));
+      }
+    }
+  }
+}
+
+/**
+ * Third pass, one thread per staged voxel: merges the measurements of the
+ * scan into the voxel as one weighted average, like
+ * TsdfIntegratorBase::mergeTsdfVoxel() does for a single measurement.
+ * Returns true if the voxel changed.
+ */
+VOXBLOX_HOST_DEVICE inline bool fuseVoxel(const Params& params,
+                                          const VoxelAccumulator& accumulator,
+                                          DeviceVoxel* voxel) {
+  if (accumulator.weight <= 0.0f) {
+    return false;
+  }
+  const float new_weight = voxel->weight + accumulator.weight;
+  if (new_weight < kWeightEpsilon) {
+    return false;
+  }
+  const float new_sdf =
+      (accumulator.weighted_distance + voxel->distance * voxel->weight) /
+      new_weight;
+
+  if (accumulator.color_weight > 0.0f) {
+    const float total_color_weight = voxel->weight + accumulator.color_weight;
+    for (int c = 0; c < 4; ++c) {
+      voxel->color[c] = static_cast<uint8_t>(
+          roundf((static_cast<float>(voxel->color[c]) * voxel->weight +
+                  accumulator.weighted_color[c]) /
+                 total_color_weight));
+    }
+  }
+  voxel->distance = (new_sdf > 0.0f)
+                        ? fminf(params.truncation_distance, new_sdf)
+                        : fmaxf(-params.truncation_distance, new_sdf);
+  voxel->weight = fminf(params.max_weight, new_weight);
+  return true;
+}
+
+}  // namespace device_tsdf
+}  // namespace voxblox
+
+#endif  // VOXBLOX_INTEGRATOR_DEVICE_TSDF_KERNELS_H_
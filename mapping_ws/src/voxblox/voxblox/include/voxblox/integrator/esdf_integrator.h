@@ -3,6 +3,7 @@
 
 #include <algorithm>
 #include <queue>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -75,6 +76,14 @@ class EsdfIntegrator {
      */
     FloatingPoint clear_sphere_radius = 1.5;
     FloatingPoint occupied_sphere_radius = 5.0;
+
+    /**
+     * Number of threads processing the open set. With more than one thread,
+     * the blocks are partitioned among the threads: each thread propagates
+     * the distances inside its blocks and the updates crossing the block
+     * boundaries are exchanged between the threads in synchronized rounds.
+     */
+    size_t integrator_threads = 1;
   };
 
   EsdfIntegrator(const Config& config, Layer<TsdfVoxel>* tsdf_layer,
@@ -123,6 +132,15 @@ class EsdfIntegrator {
    */
   void processOpenSet();
 
+  /**
+   * Block-partitioned version of processOpenSet, used if
+   * config_.integrator_threads > 1. Each round processes the queued voxels up
+   * to the lowest non-empty bucket level in parallel, then the updates of the
+   * voxels in blocks owned by other threads are delivered at the start of the
+   * next round.
+   */
+  void processOpenSetParallel();
+
   /**
    * For new voxels, etc. -- update its value from its neighbors. Sort of the
    * inverse of what the open set does (pushes the value of voxels *TO* its
@@ -154,6 +172,34 @@ class EsdfIntegrator {
   }
 
  protected:
+  /// Counters of the voxel updates made while processing the open set.
+  struct UpdateCounters {
+    size_t num_updates = 0u;
+    size_t num_inside = 0u;
+    size_t num_outside = 0u;
+    size_t num_flipped = 0u;
+
+    void add(const UpdateCounters& other) {
+      num_updates += other.num_updates;
+      num_inside += other.num_inside;
+      num_outside += other.num_outside;
+      num_flipped += other.num_flipped;
+    }
+  };
+
+  /**
+   * Tries to lower the distance of the neighbor in direction idx (see
+   * NeighborhoodLookupTables) of a voxel with the given distance and parent.
+   * The neighbor must be observed and not fixed. Returns true if the neighbor
+   * was updated and has to be pushed to the open queue.
+   */
+  bool updateNeighbor(FloatingPoint distance, const SignedIndex& parent,
+                      unsigned int idx, EsdfVoxel* neighbor_voxel,
+                      UpdateCounters* counters) const;
+
+  /// Bucket of the open queue for the given distance.
+  int getBucketIndex(FloatingPoint distance) const;
+
   Config config_;
 
   Layer<TsdfVoxel>* tsdf_layer_;
@@ -80,6 +80,7 @@ class OccupancyIntegrator {
     timing::Timer integrate_timer("integrate_occ");
 
     const Point& origin = T_G_C.getPosition();
+    const Transformation::RotationMatrix R_G_C = T_G_C.getRotationMatrix();
 
     LongIndexSet free_cells;
     LongIndexSet occupied_cells;
@@ -89,7 +90,7 @@ class OccupancyIntegrator {
 
     for (size_t pt_idx = 0; pt_idx < points_C.size(); ++pt_idx) {
       const Point& point_C = points_C[pt_idx];
-      const Point point_G = T_G_C * point_C;
+      const Point point_G = R_G_C * point_C + origin;
       const Ray unit_ray = (point_G - origin).normalized();
 
       timing::Timer cast_ray_timer("integrate_occ/cast_ray");
@@ -0,0 +1,88 @@
+#ifndef VOXBLOX_INTEGRATOR_PROJECTIVE_TSDF_INTEGRATOR_H_
+#define VOXBLOX_INTEGRATOR_PROJECTIVE_TSDF_INTEGRATOR_H_
+
+#include <atomic>
+#include <vector>
+
+#include "voxblox/core/block_hash.h"
+#include "voxblox/core/common.h"
+#include "voxblox/core/layer.h"
+#include "voxblox/core/voxel.h"
+#include "voxblox/integrator/tsdf_integrator.h"
+
+namespace voxblox {
+
+/**
+ * Projective TSDF integrator for spinning LIDARs (e.g. Ouster, Velodyne).
+ * The pointcloud is first binned into a range image with the resolution of
+ * the sensor (one row per beam, one column per azimuth step). Then, instead of
+ * casting a ray for each point, every voxel of the blocks in the sensor
+ * frustum is projected into the range image and updated with the range of
+ * the pixel it falls in. The cost scales with the number of voxels in the
+ * frustum instead of the number of points times the ray length.
+ *
+ * The blocks are processed in parallel, each block by a single thread, so no
+ * voxel locking is needed. The beams are assumed to be evenly spaced over the
+ * vertical field of view. The points do not need to be organized: the pixel
+ * of each point is computed from its direction.
+ */
+class ProjectiveTsdfIntegrator : public TsdfIntegratorBase {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  ProjectiveTsdfIntegrator(const Config& config, Layer<TsdfVoxel>* layer);
+
+  void integratePointCloud(const Transformation& T_G_C,
+                           const Pointcloud& points_C, const Colors& colors,
+                           const bool freespace_points = false);
+
+ private:
+  /// A pixel of the range image.
+  struct RangePixel {
+    /// Range of the closest point in the pixel, 0 if the pixel is empty.
+    FloatingPoint range = 0.0;
+    /// Index of the closest point in the pixel.
+    size_t point_idx = 0u;
+    /// True if the point is beyond max_ray_length_m (free space only).
+    bool is_clearing = false;
+  };
+
+  /**
+   * Bins the points into range_image_. Points beyond max_ray_length_m and
+   * freespace points only clear the space in front of them.
+   */
+  void computeRangeImage(const Pointcloud& points_C,
+                         const bool freespace_points);
+
+  /// Gets the blocks traversed by the rays of the range image.
+  void getBlocksInFrustum(const Transformation& T_G_C,
+                          const Pointcloud& points_C,
+                          BlockIndexList* block_indices) const;
+
+  /// Integrates the blocks given by block_counter until none is left.
+  void integrateBlocks(const Transformation& T_G_C, const Colors& colors,
+                       const BlockIndexList& block_indices,
+                       std::atomic<size_t>* block_counter,
+                       std::vector<char>* block_updated);
+
+  /// Integrates all the voxels of a block, returns true if any was updated.
+  bool integrateBlock(const Transformation& T_C_G, const Colors& colors,
+                      Block<TsdfVoxel>* block);
+
+  /**
+   * Gets the pixel of the range image a point (in the sensor frame) projects
+   * to, returns false if it is outside the vertical field of view.
+   */
+  bool projectPointToImage(const Point& point_C, int* row, int* col) const;
+
+  const int horizontal_resolution_;
+  const int vertical_resolution_;
+  const FloatingPoint vertical_fov_rad_;
+
+  /// Row-major range image of the pointcloud being integrated.
+  std::vector<RangePixel> range_image_;
+};
+
+}  // namespace voxblox
+
+#endif  // VOXBLOX_INTEGRATOR_PROJECTIVE_TSDF_INTEGRATOR_H_
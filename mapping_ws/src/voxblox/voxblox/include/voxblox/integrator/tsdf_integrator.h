@@ -31,22 +31,27 @@ enum class TsdfIntegratorType : int {
   kSimple = 1,
   kMerged = 2,
   kFast = 3,
+  kProjective = 4,
+  kDevice = 5,
 };
 
-static constexpr size_t kNumTsdfIntegratorTypes = 3u;
+static constexpr size_t kNumTsdfIntegratorTypes = 5u;
 
 const std::array<std::string, kNumTsdfIntegratorTypes>
     kTsdfIntegratorTypeNames = {{/*kSimple*/ "simple",
                                  /*kMerged*/ "merged",
-                                 /*kFast*/ "fast"}};
+                                 /*kFast*/ "fast",
+                                 /*kProjective*/ "projective",
+                                 /*kDevice*/ "device"}};
 
 /**
- * Base class to the simple, merged and fast TSDF integrators. The integrator
- * takes in a pointcloud + pose and uses this information to update the TSDF
- * information in the given TSDF layer. Note most functions in this class state
- * if they are thread safe. Unless explicitly stated otherwise, this thread
- * safety is based on the assumption that any pointers passed to the functions
- * point to objects that are guaranteed to not be accessed by other threads.
+ * Base class to the simple, merged, fast, projective and device TSDF
+ * integrators. The integrator takes in a pointcloud + pose and uses this
+ * information to update the TSDF information in the given TSDF layer. Note most
+ * functions in this class state if they are thread safe. Unless explicitly
+ * stated otherwise, this thread safety is based on the assumption that any
+ * pointers passed to the functions point to objects that are guaranteed to not
+ * be accessed by other threads.
  */
 class TsdfIntegratorBase {
  public:
@@ -85,6 +90,13 @@ class TsdfIntegratorBase {
     /// fast integrator specific
     float max_integration_time_s = std::numeric_limits<float>::max();
 
+    /// projective integrator specific: number of columns of the range image
+    int sensor_horizontal_resolution = 0;
+    /// projective integrator specific: number of beams (rows)
+    int sensor_vertical_resolution = 0;
+    /// projective integrator specific: the beams span [-fov/2, fov/2]
+    double sensor_vertical_field_of_view_degrees = 0.0;
+
     std::string print() const;
   };
 
@@ -133,9 +145,9 @@ class TsdfIntegratorBase {
    * layer. Thread safe.
    * Takes in the last_block_idx and last_block to prevent unneeded map lookups.
    * If this voxel belongs to a block that has not been allocated, a block in
-   * temp_block_map_ is created/accessed and a voxel from this map is returned
-   * instead. Unlike the layer, accessing temp_block_map_ is controlled via a
-   * mutex allowing it to grow during integration.
+   * temp_block_shards_ is created/accessed and a voxel from this map is
+   * returned instead. Unlike the layer, each shard of the temporary blocks is
+   * controlled via its own mutex allowing them to grow during integration.
    * These temporary blocks can be merged into the layer later by calling
    * updateLayerWithStoredBlocks
    */
@@ -155,6 +167,19 @@ class TsdfIntegratorBase {
                        const Color& color, const float weight,
                        TsdfVoxel* tsdf_voxel);
 
+  /**
+   * Applies the weight dropoff and the sparsity compensation to the weight of
+   * a measurement with the given SDF. Thread safe.
+   */
+  float computeUpdatedWeight(const float sdf, const float weight) const;
+
+  /**
+   * Fuses an SDF measurement with its (updated) weight into tsdf_voxel. NOT
+   * thread safe, the caller must be the only one accessing the voxel.
+   */
+  void mergeTsdfVoxel(const float sdf, const Color& color, const float weight,
+                      TsdfVoxel* tsdf_voxel) const;
+
   /// Calculates TSDF distance, Thread safe.
   float computeDistance(const Point& origin, const Point& point_G,
                         const Point& voxel_center) const;
@@ -176,12 +201,20 @@ class TsdfIntegratorBase {
   FloatingPoint voxels_per_side_inv_;
   FloatingPoint block_size_inv_;
 
-  std::mutex temp_block_mutex_;
+  /// A shard of the temporary block storage.
+  struct TempBlockShard {
+    std::mutex mutex;
+    Layer<TsdfVoxel>::BlockHashMap blocks;
+  };
+
   /**
    * Temporary block storage, used to hold blocks that need to be created while
-   * integrating a new pointcloud
+   * integrating a new pointcloud. The blocks are split in 2^6 shards by the
+   * hash of their index, so that threads entering unexplored space only
+   * contend for the lock of a shard instead of a single map-wide lock.
    */
-  Layer<TsdfVoxel>::BlockHashMap temp_block_map_;
+  ApproxHashArray<6, TempBlockShard, BlockIndex, AnyIndexHash>
+      temp_block_shards_;
 
   /**
    * We need to prevent simultaneous access to the voxels in the map. We could
@@ -25,6 +25,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <vector>
 
 #include "voxblox/core/common.h"
 
@@ -70,6 +71,11 @@ struct Mesh {
     size_bytes += sizeof(block_size);
     size_bytes += sizeof(origin);
     size_bytes += sizeof(updated);
+
+    size_bytes += sizeof(lods);
+    for (const Ptr& lod : lods) {
+      size_bytes += lod->getMemorySize();
+    }
     return size_bytes;
   }
 
@@ -78,6 +84,7 @@ struct Mesh {
     normals.clear();
     colors.clear();
     indices.clear();
+    lods.clear();
   }
 
   inline void clearTriangles() { indices.clear(); }
@@ -157,6 +164,13 @@ struct Mesh {
   FloatingPoint block_size;
   Point origin;
 
+  /**
+   * Simplified versions of the mesh, lods[i] has its vertices clustered in
+   * cells 2^(i + 1) voxels wide. Empty unless the mesh integrator generates
+   * levels of detail.
+   */
+  std::vector<Ptr> lods;
+
   bool updated;
 };
 
@@ -39,6 +39,7 @@
 #include "voxblox/interpolator/interpolator.h"
 #include "voxblox/mesh/marching_cubes.h"
 #include "voxblox/mesh/mesh_layer.h"
+#include "voxblox/mesh/mesh_utils.h"
 #include "voxblox/utils/meshing_utils.h"
 #include "voxblox/utils/timing.h"
 
@@ -50,6 +51,13 @@ struct MeshIntegratorConfig {
   bool use_color = true;
   float min_weight = 1e-4;
 
+  /**
+   * Number of simplified meshes generated per block (see Mesh::lods), level i
+   * clusters the vertices in cells 2^(i + 1) voxels wide. Levels with cells
+   * larger than a block are not generated.
+   */
+  int num_lods = 0;
+
   size_t integrator_threads = std::thread::hardware_concurrency();
 
   inline std::string print() const {
@@ -58,6 +66,7 @@ struct MeshIntegratorConfig {
     ss << "================== Mesh Integrator Config ====================\n";
     ss << " - use_color:                 " << use_color << "\n";
     ss << " - min_weight:                " << min_weight << "\n";
+    ss << " - num_lods:                  " << num_lods << "\n";
     ss << " - integrator_threads:        " << integrator_threads << "\n";
     ss << "==============================================================\n";
     // clang-format on
@@ -256,10 +265,26 @@ class MeshIntegrator {
     if (config_.use_color) {
       updateMeshColor(*block, mesh.get());
     }
+    updateMeshLods(mesh.get());
 
     mesh->updated = true;
   }
 
+  /// Regenerates the levels of detail of the mesh from its full resolution.
+  void updateMeshLods(Mesh* mesh) const {
+    DCHECK(mesh != nullptr);
+    mesh->lods.clear();
+    FloatingPoint cell_size = 2.0 * voxel_size_;
+    for (int level = 0;
+         level < config_.num_lods && cell_size <= block_size_ + kEpsilon;
+         ++level) {
+      Mesh::Ptr lod = std::make_shared<Mesh>();
+      createClusteredMesh(*mesh, cell_size, lod.get());
+      mesh->lods.push_back(lod);
+      cell_size *= 2.0;
+    }
+  }
+
   void extractMeshInsideBlock(const Block<VoxelType>& block,
                               const VoxelIndex& index, const Point& coords,
                               VertexIndex* next_mesh_index, Mesh* mesh) {
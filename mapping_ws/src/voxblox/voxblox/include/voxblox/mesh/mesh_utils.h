@@ -1,6 +1,9 @@
 #ifndef VOXBLOX_MESH_MESH_UTILS_H_
 #define VOXBLOX_MESH_MESH_UTILS_H_
 
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <vector>
 
 #include "voxblox/core/block_hash.h"
@@ -185,6 +188,126 @@ inline void createConnectedMesh(
                       approximate_vertex_proximity_threshold);
 }
 
+/**
+ * Simplifies a mesh by vertex clustering: all the vertices falling in the same
+ * cell of a grid with the given cell size are merged into a single vertex at
+ * their mean position, with their mean color and normal. Triangles that
+ * collapse are removed, as are the duplicates. The resulting mesh is indexed,
+ * i.e. it can have fewer vertices than indices.
+ */
+inline void createClusteredMesh(const Mesh& mesh, const FloatingPoint cell_size,
+                                Mesh* clustered_mesh) {
+  CHECK_NOTNULL(clustered_mesh);
+  CHECK_GT(cell_size, 0.0);
+  CHECK_EQ(mesh.indices.size() % 3u, 0u);
+
+  clustered_mesh->clear();
+  clustered_mesh->block_size = mesh.block_size;
+  clustered_mesh->origin = mesh.origin;
+
+  const FloatingPoint cell_size_inv = 1.0 / cell_size;
+  LongIndexHashMapType<size_t>::type clusters;
+  std::vector<size_t> vertex_to_cluster(mesh.vertices.size());
+  std::vector<size_t> cluster_sizes;
+  // Sums of the colors of the vertices in each cluster, rgba.
+  std::vector<std::array<uint32_t, 4>> color_sums;
+
+  for (size_t vertex_idx = 0u; vertex_idx < mesh.vertices.size();
+       ++vertex_idx) {
+    const Point& vertex = mesh.vertices[vertex_idx];
+    const LongIndex cell_index =
+        getGridIndexFromPoint<LongIndex>(vertex, cell_size_inv);
+    const auto insert_result =
+        clusters.emplace(cell_index, clustered_mesh->vertices.size());
+    const size_t cluster_idx = insert_result.first->second;
+    vertex_to_cluster[vertex_idx] = cluster_idx;
+
+    if (insert_result.second) {
+      clustered_mesh->vertices.push_back(Point::Zero());
+      cluster_sizes.push_back(0u);
+      if (mesh.hasNormals()) {
+        clustered_mesh->normals.push_back(Point::Zero());
+      }
+      if (mesh.hasColors()) {
+        color_sums.push_back({{0u, 0u, 0u, 0u}});
+      }
+    }
+
+    clustered_mesh->vertices[cluster_idx] += vertex;
+    ++cluster_sizes[cluster_idx];
+    if (mesh.hasNormals()) {
+      CHECK_LT(vertex_idx, mesh.normals.size());
+      clustered_mesh->normals[cluster_idx] += mesh.normals[vertex_idx];
+    }
+    if (mesh.hasColors()) {
+      CHECK_LT(vertex_idx, mesh.colors.size());
+      const Color& color = mesh.colors[vertex_idx];
+      std::array<uint32_t, 4>& color_sum = color_sums[cluster_idx];
+      color_sum[0] += color.r;
+      color_sum[1] += color.g;
+      color_sum[2] += color.b;
+      color_sum[3] += color.a;
+    }
+  }
+
+  // Average the data of the clusters.
+  for (size_t cluster_idx = 0u; cluster_idx < cluster_sizes.size();
+       ++cluster_idx) {
+    const size_t cluster_size = cluster_sizes[cluster_idx];
+    clustered_mesh->vertices[cluster_idx] /= cluster_size;
+    if (mesh.hasNormals()) {
+      Point& normal = clustered_mesh->normals[cluster_idx];
+      const FloatingPoint length = normal.norm();
+      if (length > kEpsilon) {
+        normal /= length;
+      } else {
+        normal = Point(0.0f, 0.0f, 1.0f);
+      }
+    }
+    if (mesh.hasColors()) {
+      const std::array<uint32_t, 4>& color_sum = color_sums[cluster_idx];
+      const uint32_t half_size = cluster_size / 2u;
+      clustered_mesh->colors.emplace_back(
+          (color_sum[0] + half_size) / cluster_size,
+          (color_sum[1] + half_size) / cluster_size,
+          (color_sum[2] + half_size) / cluster_size,
+          (color_sum[3] + half_size) / cluster_size);
+    }
+  }
+
+  // Remap the triangles, dropping the collapsed ones. The triangles are
+  // rotated to start with their smallest index (keeping their orientation) so
+  // the duplicates can be found by sorting them.
+  std::vector<std::array<VertexIndex, 3>> triangles;
+  triangles.reserve(mesh.indices.size() / 3u);
+  for (size_t triangle_idx = 0u; triangle_idx < mesh.indices.size();
+       triangle_idx += 3u) {
+    std::array<VertexIndex, 3> triangle;
+    for (size_t i = 0u; i < 3u; ++i) {
+      const VertexIndex vertex_idx = mesh.indices[triangle_idx + i];
+      CHECK_LT(vertex_idx, vertex_to_cluster.size());
+      triangle[i] = vertex_to_cluster[vertex_idx];
+    }
+    if (triangle[0] == triangle[1] || triangle[1] == triangle[2] ||
+        triangle[0] == triangle[2]) {
+      continue;
+    }
+    std::rotate(triangle.begin(),
+                std::min_element(triangle.begin(), triangle.end()),
+                triangle.end());
+    triangles.push_back(triangle);
+  }
+  std::sort(triangles.begin(), triangles.end());
+  triangles.erase(std::unique(triangles.begin(), triangles.end()),
+                  triangles.end());
+
+  clustered_mesh->indices.reserve(3u * triangles.size());
+  for (const std::array<VertexIndex, 3>& triangle : triangles) {
+    clustered_mesh->indices.insert(clustered_mesh->indices.end(),
+                                   triangle.begin(), triangle.end());
+  }
+}
+
 };  // namespace voxblox
 
 #endif  // VOXBLOX_MESH_MESH_UTILS_H_
@@ -1,6 +1,7 @@
 #ifndef VOXBLOX_UTILS_APPROX_HASH_ARRAY_H_
 #define VOXBLOX_UTILS_APPROX_HASH_ARRAY_H_
 
+#include <array>
 #include <atomic>
 #include <limits>
 #include <vector>
@@ -52,6 +53,14 @@ class ApproxHashArray {
     return get(hash);
   }
 
+  /// Iteration over all the elements, NOT thread safe.
+  typename std::array<StoredElement, (1 << unmasked_bits)>::iterator begin() {
+    return pseudo_map_.begin();
+  }
+  typename std::array<StoredElement, (1 << unmasked_bits)>::iterator end() {
+    return pseudo_map_.end();
+  }
+
  private:
   static constexpr size_t pseudo_map_size_ = (1 << unmasked_bits);
   static constexpr size_t bit_mask_ = (1 << unmasked_bits) - 1;
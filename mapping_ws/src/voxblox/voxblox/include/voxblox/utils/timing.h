@@ -20,13 +20,11 @@
 #ifndef VOXBLOX_UTILS_TIMING_H_
 #define VOXBLOX_UTILS_TIMING_H_
 
-#include <algorithm>
-#include <chrono>
-#include <limits>
 #include <map>
 #include <mutex>
 #include <string>
-#include <vector>
+
+#include <mr3d_profiling/Profiler.h>
 
 #include "voxblox/core/common.h"
 
@@ -34,82 +32,6 @@ namespace voxblox {
 
 namespace timing {
 
-template <typename T, typename Total, int N>
-class Accumulator {
- public:
-  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
-
-  Accumulator()
-      : window_samples_(0),
-        totalsamples_(0),
-        window_sum_(0),
-        sum_(0),
-        min_(std::numeric_limits<T>::max()),
-        max_(std::numeric_limits<T>::min()) {}
-
-  void Add(T sample) {
-    if (window_samples_ < N) {
-      samples_[window_samples_++] = sample;
-      window_sum_ += sample;
-    } else {
-      T& oldest = samples_[window_samples_++ % N];
-      window_sum_ += sample - oldest;
-      oldest = sample;
-    }
-    sum_ += sample;
-    ++totalsamples_;
-    if (sample > max_) {
-      max_ = sample;
-    }
-    if (sample < min_) {
-      min_ = sample;
-    }
-  }
-
-  int TotalSamples() const { return totalsamples_; }
-
-  double Sum() const { return sum_; }
-
-  double Mean() const { return sum_ / totalsamples_; }
-
-  double RollingMean() const {
-    return window_sum_ / std::min(window_samples_, N);
-  }
-
-  double Max() const { return max_; }
-
-  double Min() const { return min_; }
-
-  double LazyVariance() const {
-    if (window_samples_ == 0) {
-      return 0.0;
-    }
-    double var = 0;
-    double mean = RollingMean();
-    for (int i = 0; i < std::min(window_samples_, N); ++i) {
-      var += (samples_[i] - mean) * (samples_[i] - mean);
-    }
-    var /= std::min(window_samples_, N);
-    return var;
-  }
-
- private:
-  int window_samples_;
-  int totalsamples_;
-  Total window_sum_;
-  Total sum_;
-  T min_;
-  T max_;
-  T samples_[N];
-};
-
-struct TimerMapValue {
-  TimerMapValue() {}
-
-  /// Create an accumulator with specified window size.
-  Accumulator<double, double, 50> acc_;
-};
-
 /**
  * A class that has the timer interface but does nothing. Swapping this in in
  * place of the Timer class (say with a typedef) should allow one to disable
@@ -129,6 +51,12 @@ class DummyTimer {
   bool IsTiming() { return false; }
 };
 
+/**
+ * Records the time between Start() and Stop() in the histogram of its timer.
+ * The samples are recorded in the per-thread histograms of the shared
+ * mr3d_profiling::Profiler (no lock), so the voxblox timers are also exported
+ * with the other zones of the node (with a "voxblox/" prefix).
+ */
 class Timer {
  public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
@@ -142,12 +70,17 @@ class Timer {
   bool IsTiming() const;
 
  private:
-  std::chrono::time_point<std::chrono::system_clock> time_;
+  int64_t start_ns_;
 
   bool timing_;
   size_t handle_;
 };
 
+/**
+ * Queries the timers. The stats are computed from the histograms of the
+ * samples: the mean, min and max are exact, the variance is estimated from the
+ * histogram buckets.
+ */
 class Timing {
  public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
@@ -174,22 +107,23 @@ class Timing {
   static void Print(std::ostream& out);
   static std::string Print();
   static std::string SecondsToTimeString(double seconds);
+  /// Discards the samples recorded so far, the handles stay valid.
   static void Reset();
-  static const map_t& GetTimers() { return Instance().tagMap_; }
+  static map_t GetTimers();
 
  private:
-  void AddTime(size_t handle, double seconds);
+  /// Samples of the timer since the last Reset().
+  static mr3d_profiling::ZoneStats GetStats(size_t handle);
 
   static Timing& Instance();
 
   Timing();
   ~Timing();
 
-  typedef AlignedVector<TimerMapValue> list_t;
-
-  list_t timers_;
   map_t tagMap_;
   size_t maxTagLength_;
+  /// Snapshots of the timers at the last Reset().
+  std::map<size_t, mr3d_profiling::ZoneStats> resetStats_;
   std::mutex mutex_;
 };
 
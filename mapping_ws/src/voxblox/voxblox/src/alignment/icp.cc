@@ -43,7 +43,8 @@
 
 namespace voxblox {
 
-ICP::ICP(const Config& config) : config_(config) {}
+ICP::ICP(const Config& config)
+    : config_(config), has_deadline_(false), timed_out_(false) {}
 
 bool ICP::getTransformFromMatchedPoints(const PointsMatrix& src,
                                         const PointsMatrix& tgt,
@@ -193,6 +194,10 @@ void ICP::runThread(const Pointcloud& points,
     if (start_idx > config_.subsample_keep_ratio * points.size()) {
       break;
     }
+    if (has_deadline_ && std::chrono::steady_clock::now() > deadline_) {
+      timed_out_ = true;
+      break;
+    }
 
     Vector6 est_info_vector;
     Transformation delta_T_tsdf_sensor;
@@ -224,6 +229,12 @@ size_t ICP::runICP(const Layer<TsdfVoxel>& tsdf_layer, const Pointcloud& points,
                    Transformation* refined_T_tsdf_sensor, const unsigned seed) {
   CHECK_NOTNULL(refined_T_tsdf_sensor);
 
+  has_deadline_ = config_.time_budget_s > 0.0;
+  deadline_ = std::chrono::steady_clock::now() +
+              std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                  std::chrono::duration<double>(config_.time_budget_s));
+  timed_out_ = false;
+
   interpolator_ = std::make_shared<Interpolator<TsdfVoxel>>(&tsdf_layer);
   voxel_size_ = tsdf_layer.voxel_size();
   voxel_size_inv_ = tsdf_layer.voxel_size_inv();
@@ -255,6 +266,12 @@ size_t ICP::runICP(const Layer<TsdfVoxel>& tsdf_layer, const Pointcloud& points,
 
   interpolator_.reset();
 
+  // A partial alignment only used the first mini batches, fall back to the
+  // initial guess.
+  if (timed_out_) {
+    *refined_T_tsdf_sensor = inital_T_tsdf_sensor;
+    return 0u;
+  }
   return num_updates;
 }
 
@@ -0,0 +1,311 @@
+#include "voxblox/integrator/device_tsdf_integrator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <list>
+#include <thread>
+#include <type_traits>
+
+namespace voxblox {
+
+static_assert(sizeof(device_tsdf::DeviceVoxel) == sizeof(TsdfVoxel) &&
+                  offsetof(device_tsdf::DeviceVoxel, distance) ==
+                      offsetof(TsdfVoxel, distance) &&
+                  offsetof(device_tsdf::DeviceVoxel, weight) ==
+                      offsetof(TsdfVoxel, weight) &&
+                  offsetof(device_tsdf::DeviceVoxel, color) ==
+                      offsetof(TsdfVoxel, color),
+              "DeviceVoxel and TsdfVoxel must have the same layout.");
+static_assert(std::is_trivially_copyable<TsdfVoxel>::value,
+              "The blocks are staged with memcpy.");
+
+namespace device_tsdf {
+
+namespace {
+
+/**
+ * Calls function(i) for i in [0, num_items) on num_threads threads, the items
+ * are handed out in chunks.
+ */
+template <typename Function>
+void parallelFor(size_t num_threads, size_t num_items,
+                 const Function& function) {
+  constexpr size_t kChunkSize = 64u;
+  std::atomic<size_t> next_item(0u);
+  auto worker = [&]() {
+    size_t begin;
+    while ((begin = next_item.fetch_add(kChunkSize)) < num_items) {
+      const size_t end = std::min(begin + kChunkSize, num_items);
+      for (size_t i = begin; i < end; ++i) {
+        function(i);
+      }
+    }
+  };
+
+  std::list<std::thread> threads;
+  for (size_t i = 1u; i < num_threads; ++i) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+/// Runs the kernels on the host, one kernel thread per loop iteration.
+class HostBackend : public Backend {
+ public:
+  explicit HostBackend(size_t num_threads) : num_threads_(num_threads) {}
+
+  bool isCuda() const { return false; }
+
+  void uploadRays(const std::vector<Ray>& rays) { rays_ = rays; }
+
+  bool allocateBlocks(const Params& params, int capacity_bits) {
+    capacity_bits_ = capacity_bits;
+    keys_.assign(size_t(1) << capacity_bits, kEmptyBlockKey);
+    const BlockTable table = getTable();
+
+    std::atomic<bool> table_full(false);
+    parallelFor(num_threads_, rays_.size(), [&](size_t i) {
+      if (!table_full && !allocateRayBlocks(params, rays_[i], table)) {
+        table_full = true;
+      }
+    });
+    return !table_full;
+  }
+
+  void downloadBlockKeys(std::vector<BlockKey>* keys) { *keys = keys_; }
+
+  void uploadBlocks(const std::vector<int>& slots,
+                    const std::vector<DeviceVoxel>& voxels) {
+    slots_ = slots;
+    voxels_ = voxels;
+  }
+
+  void integrate(const Params& params) {
+    const size_t voxels_per_block = params.voxels_per_side *
+                                    params.voxels_per_side *
+                                    params.voxels_per_side;
+    const size_t num_blocks = voxels_.size() / voxels_per_block;
+    accumulators_.assign(voxels_.size(), VoxelAccumulator());
+    const BlockTable table = getTable();
+
+    parallelFor(num_threads_, rays_.size(), [&](size_t i) {
+      integrateRay(params, rays_[i], table, accumulators_.data());
+    });
+
+    block_changed_.assign(num_blocks, 0u);
+    parallelFor(num_threads_, num_blocks, [&](size_t slot) {
+      bool changed = false;
+      for (size_t i = slot * voxels_per_block;
+           i < (slot + 1u) * voxels_per_block; ++i) {
+        changed |= fuseVoxel(params, accumulators_[i], &voxels_[i]);
+      }
+      block_changed_[slot] = changed;
+    });
+  }
+
+  void downloadChangedBlocks(std::vector<unsigned char>* block_changed,
+                             std::vector<DeviceVoxel>* voxels) {
+    *block_changed = block_changed_;
+    if (block_changed_.empty()) {
+      return;
+    }
+    const size_t voxels_per_block = voxels_.size() / block_changed_.size();
+    for (size_t slot = 0u; slot < block_changed_.size(); ++slot) {
+      if (block_changed_[slot]) {
+        std::memcpy(&(*voxels)[slot * voxels_per_block],
+                    &voxels_[slot * voxels_per_block],
+                    voxels_per_block * sizeof(DeviceVoxel));
+      }
+    }
+  }
+
+ private:
+  BlockTable getTable() {
+    BlockTable table;
+    table.keys = keys_.data();
+    table.slots = slots_.data();
+    table.capacity_bits = capacity_bits_;
+    return table;
+  }
+
+  const size_t num_threads_;
+
+  std::vector<Ray> rays_;
+  int capacity_bits_ = 0;
+  std::vector<BlockKey> keys_;
+  std::vector<int> slots_;
+  std::vector<DeviceVoxel> voxels_;
+  std::vector<VoxelAccumulator> accumulators_;
+  std::vector<unsigned char> block_changed_;
+};
+
+}  // namespace
+
+std::unique_ptr<Backend> createHostBackend(size_t num_threads) {
+  return std::unique_ptr<Backend>(new HostBackend(num_threads));
+}
+
+}  // namespace device_tsdf
+
+namespace {
+/// The block table starts with 4096 entries.
+constexpr int kMinBlockTableBits = 12;
+constexpr int kMaxBlockTableBits = 30;
+}  // namespace
+
+DeviceTsdfIntegrator::DeviceTsdfIntegrator(const Config& config,
+                                           Layer<TsdfVoxel>* layer)
+    : TsdfIntegratorBase(config, layer),
+      block_table_bits_(kMinBlockTableBits) {
+#ifdef VOXBLOX_WITH_CUDA
+  backend_ = device_tsdf::createCudaBackend();
+  if (!backend_) {
+    LOG(WARNING) << "No CUDA device found, the device TSDF integrator runs on "
+                    "the host.";
+  }
+#endif
+  if (!backend_) {
+    backend_ = device_tsdf::createHostBackend(config_.integrator_threads);
+  }
+}
+
+void DeviceTsdfIntegrator::integratePointCloud(const Transformation& T_G_C,
+                                               const Pointcloud& points_C,
+                                               const Colors& colors,
+                                               const bool freespace_points) {
+  timing::Timer integrate_timer("integrate/device");
+  CHECK_EQ(points_C.size(), colors.size());
+
+  if (!computeRays(T_G_C, points_C, colors, freespace_points)) {
+    return;
+  }
+  const device_tsdf::Params params = getParams(T_G_C);
+
+  timing::Timer allocate_timer("integrate/device/allocate_blocks");
+  backend_->uploadRays(rays_);
+  while (!backend_->allocateBlocks(params, block_table_bits_)) {
+    CHECK_LT(block_table_bits_, kMaxBlockTableBits);
+    ++block_table_bits_;
+  }
+  backend_->downloadBlockKeys(&block_keys_);
+  stageBlocks();
+  allocate_timer.Stop();
+
+  timing::Timer rays_timer("integrate/device/integrate_rays");
+  backend_->uploadBlocks(block_slots_, staged_voxels_);
+  backend_->integrate(params);
+  backend_->downloadChangedBlocks(&block_changed_, &staged_voxels_);
+  rays_timer.Stop();
+
+  // Like with the other integrators, all the traversed blocks are flagged as
+  // updated, but only the changed ones are copied back.
+  const size_t num_voxels = voxels_per_side_ * voxels_per_side_ *
+                            voxels_per_side_;
+  for (size_t slot = 0u; slot < staged_blocks_.size(); ++slot) {
+    Block<TsdfVoxel>& block = *staged_blocks_[slot];
+    block.updated().set();
+    if (block_changed_[slot]) {
+      std::memcpy(static_cast<void*>(&block.getVoxelByLinearIndex(0u)),
+                  &staged_voxels_[slot * num_voxels],
+                  num_voxels * sizeof(TsdfVoxel));
+      block.has_data() = true;
+    }
+  }
+  // Release the blocks, the layer owns them.
+  staged_blocks_.clear();
+  integrate_timer.Stop();
+}
+
+bool DeviceTsdfIntegrator::computeRays(const Transformation& T_G_C,
+                                       const Pointcloud& points_C,
+                                       const Colors& colors,
+                                       const bool freespace_points) {
+  const Point origin = T_G_C.getPosition();
+  const Transformation::RotationMatrix R_G_C = T_G_C.getRotationMatrix();
+
+  rays_.clear();
+  rays_.reserve(points_C.size());
+  for (size_t point_idx = 0u; point_idx < points_C.size(); ++point_idx) {
+    const Point& point_C = points_C[point_idx];
+    bool is_clearing;
+    if (!point_C.allFinite() ||
+        !isPointValid(point_C, freespace_points, &is_clearing)) {
+      continue;
+    }
+    const Point point_G = R_G_C * point_C + origin;
+    const Color& color = colors[point_idx];
+
+    device_tsdf::Ray ray;
+    ray.point_G[0] = point_G.x();
+    ray.point_G[1] = point_G.y();
+    ray.point_G[2] = point_G.z();
+    ray.weight = getVoxelWeight(point_C);
+    ray.color[0] = color.r;
+    ray.color[1] = color.g;
+    ray.color[2] = color.b;
+    ray.color[3] = color.a;
+    ray.is_clearing = is_clearing;
+    rays_.push_back(ray);
+  }
+  return !rays_.empty();
+}
+
+device_tsdf::Params DeviceTsdfIntegrator::getParams(
+    const Transformation& T_G_C) const {
+  const Point origin = T_G_C.getPosition();
+
+  device_tsdf::Params params;
+  params.origin[0] = origin.x();
+  params.origin[1] = origin.y();
+  params.origin[2] = origin.z();
+  params.voxel_size = voxel_size_;
+  params.voxel_size_inv = voxel_size_inv_;
+  params.voxels_per_side_inv = voxels_per_side_inv_;
+  params.voxels_per_side = static_cast<int>(voxels_per_side_);
+  params.truncation_distance = config_.default_truncation_distance;
+  params.max_weight = config_.max_weight;
+  params.max_ray_length_m = config_.max_ray_length_m;
+  params.voxel_carving_enabled = config_.voxel_carving_enabled;
+  params.use_weight_dropoff = config_.use_weight_dropoff;
+  params.use_sparsity_compensation_factor =
+      config_.use_sparsity_compensation_factor;
+  params.sparsity_compensation_factor = config_.sparsity_compensation_factor;
+  return params;
+}
+
+void DeviceTsdfIntegrator::stageBlocks() {
+  const size_t num_voxels = voxels_per_side_ * voxels_per_side_ *
+                            voxels_per_side_;
+  block_slots_.assign(block_keys_.size(), -1);
+  staged_blocks_.clear();
+  for (size_t entry = 0u; entry < block_keys_.size(); ++entry) {
+    if (block_keys_[entry] == device_tsdf::kEmptyBlockKey) {
+      continue;
+    }
+    BlockIndex block_idx;
+    device_tsdf::unpackBlockKey(block_keys_[entry], &block_idx.x(),
+                                &block_idx.y(), &block_idx.z());
+    block_slots_[entry] = static_cast<int>(staged_blocks_.size());
+    staged_blocks_.push_back(layer_->allocateBlockPtrByIndex(block_idx));
+  }
+
+  staged_voxels_.resize(staged_blocks_.size() * num_voxels);
+  for (size_t slot = 0u; slot < staged_blocks_.size(); ++slot) {
+    std::memcpy(&staged_voxels_[slot * num_voxels],
+                &staged_blocks_[slot]->getVoxelByLinearIndex(0u),
+                num_voxels * sizeof(TsdfVoxel));
+  }
+
+  // Keep the load factor of the table below 1/2 for the next scans.
+  if (2u * staged_blocks_.size() > block_keys_.size() &&
+      block_table_bits_ < kMaxBlockTableBits) {
+    ++block_table_bits_;
+  }
+}
+
+}  // namespace voxblox
@@ -0,0 +1,257 @@
+#include <cuda_runtime.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "voxblox/integrator/device_tsdf_backend.h"
+
+#define VOXBLOX_CUDA_CHECK(call)                                    \
+  do {                                                              \
+    const cudaError_t error = (call);                               \
+    CHECK_EQ(error, cudaSuccess) << cudaGetErrorString(error);      \
+  } while (false)
+
+namespace voxblox {
+namespace device_tsdf {
+
+namespace {
+
+constexpr int kThreadsPerBlock = 256;
+
+inline unsigned int getNumCudaBlocks(size_t num_threads) {
+  return static_cast<unsigned int>((num_threads + kThreadsPerBlock - 1) /
+                                   kThreadsPerBlock);
+}
+
+/// Device array that keeps its memory when shrunk.
+template <typename T>
+class DeviceBuffer {
+ public:
+  DeviceBuffer() : data_(nullptr), size_(0u), capacity_(0u) {}
+  ~DeviceBuffer() {
+    if (data_ != nullptr) {
+      cudaFree(data_);
+    }
+  }
+  DeviceBuffer(const DeviceBuffer&) = delete;
+  DeviceBuffer& operator=(const DeviceBuffer&) = delete;
+
+  void resize(size_t size) {
+    if (size > capacity_) {
+      if (data_ != nullptr) {
+        VOXBLOX_CUDA_CHECK(cudaFree(data_));
+      }
+      VOXBLOX_CUDA_CHECK(cudaMalloc(&data_, size * sizeof(T)));
+      capacity_ = size;
+    }
+    size_ = size;
+  }
+
+  void upload(const std::vector<T>& values) {
+    resize(values.size());
+    if (size_ > 0u) {
+      VOXBLOX_CUDA_CHECK(cudaMemcpy(data_, values.data(), size_ * sizeof(T),
+                                    cudaMemcpyHostToDevice));
+    }
+  }
+
+  void download(std::vector<T>* values) const {
+    values->resize(size_);
+    if (size_ > 0u) {
+      VOXBLOX_CUDA_CHECK(cudaMemcpy(values->data(), data_, size_ * sizeof(T),
+                                    cudaMemcpyDeviceToHost));
+    }
+  }
+
+  void setZero() {
+    if (size_ > 0u) {
+      VOXBLOX_CUDA_CHECK(cudaMemset(data_, 0, size_ * sizeof(T)));
+    }
+  }
+
+  T* data() { return data_; }
+  const T* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  T* data_;
+  size_t size_;
+  size_t capacity_;
+};
+
+__global__ void resetBlockTableKernel(BlockKey* keys, size_t capacity) {
+  const size_t i = blockIdx.x * blockDim.x + threadIdx.x;
+  if (i < capacity) {
+    keys[i] = kEmptyBlockKey;
+  }
+}
+
+__global__ void allocateBlocksKernel(const Params params, const Ray* rays,
+                                     size_t num_rays, const BlockTable table,
+                                     int* table_full) {
+  const size_t i = blockIdx.x * blockDim.x + threadIdx.x;
+  if (i < num_rays && !allocateRayBlocks(params, rays[i], table)) {
+    *table_full = 1;
+  }
+}
+
+__global__ void integrateRaysKernel(const Params params, const Ray* rays,
+                                    size_t num_rays, const BlockTable table,
+                                    VoxelAccumulator* accumulators) {
+  const size_t i = blockIdx.x * blockDim.x + threadIdx.x;
+  if (i < num_rays) {
+    integrateRay(params, rays[i], table, accumulators);
+  }
+}
+
+__global__ void fuseVoxelsKernel(const Params params,
+                                 const VoxelAccumulator* accumulators,
+                                 size_t num_voxels, int voxels_per_block,
+                                 DeviceVoxel* voxels,
+                                 unsigned char* block_changed) {
+  const size_t i = blockIdx.x * blockDim.x + threadIdx.x;
+  if (i < num_voxels && fuseVoxel(params, accumulators[i], &voxels[i])) {
+    // All the writers write the same value.
+    block_changed[i / voxels_per_block] = 1u;
+  }
+}
+
+__global__ void gatherBlocksKernel(const DeviceVoxel* voxels,
+                                   const int* block_slots, size_t num_voxels,
+                                   int voxels_per_block,
+                                   DeviceVoxel* gathered_voxels) {
+  const size_t i = blockIdx.x * blockDim.x + threadIdx.x;
+  if (i < num_voxels) {
+    const size_t slot = block_slots[i / voxels_per_block];
+    gathered_voxels[i] = voxels[slot * voxels_per_block + i % voxels_per_block];
+  }
+}
+
+/// Runs the kernels on the current CUDA device.
+class CudaBackend : public Backend {
+ public:
+  CudaBackend() : capacity_bits_(0), voxels_per_block_(0) {
+    table_full_.resize(1u);
+  }
+
+  bool isCuda() const { return true; }
+
+  void uploadRays(const std::vector<Ray>& rays) { rays_.upload(rays); }
+
+  bool allocateBlocks(const Params& params, int capacity_bits) {
+    capacity_bits_ = capacity_bits;
+    const size_t capacity = size_t(1) << capacity_bits;
+    keys_.resize(capacity);
+    resetBlockTableKernel<<<getNumCudaBlocks(capacity), kThreadsPerBlock>>>(
+        keys_.data(), capacity);
+    table_full_.setZero();
+
+    if (rays_.size() > 0u) {
+      allocateBlocksKernel<<<getNumCudaBlocks(rays_.size()),
+                             kThreadsPerBlock>>>(params, rays_.data(),
+                                                 rays_.size(), getTable(),
+                                                 table_full_.data());
+    }
+    VOXBLOX_CUDA_CHECK(cudaGetLastError());
+    std::vector<int> table_full;
+    table_full_.download(&table_full);
+    return table_full[0] == 0;
+  }
+
+  void downloadBlockKeys(std::vector<BlockKey>* keys) { keys_.download(keys); }
+
+  void uploadBlocks(const std::vector<int>& slots,
+                    const std::vector<DeviceVoxel>& voxels) {
+    slots_.upload(slots);
+    voxels_.upload(voxels);
+  }
+
+  void integrate(const Params& params) {
+    voxels_per_block_ = params.voxels_per_side * params.voxels_per_side *
+                        params.voxels_per_side;
+    const size_t num_voxels = voxels_.size();
+    accumulators_.resize(num_voxels);
+    accumulators_.setZero();
+    block_changed_.resize(num_voxels / voxels_per_block_);
+    block_changed_.setZero();
+    if (num_voxels == 0u) {
+      return;
+    }
+
+    integrateRaysKernel<<<getNumCudaBlocks(rays_.size()), kThreadsPerBlock>>>(
+        params, rays_.data(), rays_.size(), getTable(), accumulators_.data());
+    fuseVoxelsKernel<<<getNumCudaBlocks(num_voxels), kThreadsPerBlock>>>(
+        params, accumulators_.data(), num_voxels, voxels_per_block_,
+        voxels_.data(), block_changed_.data());
+    VOXBLOX_CUDA_CHECK(cudaGetLastError());
+  }
+
+  void downloadChangedBlocks(std::vector<unsigned char>* block_changed,
+                             std::vector<DeviceVoxel>* voxels) {
+    block_changed_.download(block_changed);
+
+    // Gather the changed blocks in a contiguous buffer, to download them with
+    // a single copy.
+    std::vector<int> changed_slots;
+    for (size_t slot = 0u; slot < block_changed->size(); ++slot) {
+      if ((*block_changed)[slot]) {
+        changed_slots.push_back(static_cast<int>(slot));
+      }
+    }
+    if (changed_slots.empty()) {
+      return;
+    }
+    changed_slots_.upload(changed_slots);
+    const size_t num_voxels = changed_slots.size() * voxels_per_block_;
+    gathered_voxels_.resize(num_voxels);
+    gatherBlocksKernel<<<getNumCudaBlocks(num_voxels), kThreadsPerBlock>>>(
+        voxels_.data(), changed_slots_.data(), num_voxels, voxels_per_block_,
+        gathered_voxels_.data());
+    VOXBLOX_CUDA_CHECK(cudaGetLastError());
+
+    gathered_voxels_.download(&gathered_voxels_host_);
+    for (size_t i = 0u; i < changed_slots.size(); ++i) {
+      std::copy(gathered_voxels_host_.begin() + i * voxels_per_block_,
+                gathered_voxels_host_.begin() + (i + 1u) * voxels_per_block_,
+                voxels->begin() + changed_slots[i] * voxels_per_block_);
+    }
+  }
+
+ private:
+  BlockTable getTable() {
+    BlockTable table;
+    table.keys = keys_.data();
+    table.slots = slots_.data();
+    table.capacity_bits = capacity_bits_;
+    return table;
+  }
+
+  int capacity_bits_;
+  int voxels_per_block_;
+
+  DeviceBuffer<Ray> rays_;
+  DeviceBuffer<BlockKey> keys_;
+  DeviceBuffer<int> slots_;
+  DeviceBuffer<int> table_full_;
+  DeviceBuffer<DeviceVoxel> voxels_;
+  DeviceBuffer<VoxelAccumulator> accumulators_;
+  DeviceBuffer<unsigned char> block_changed_;
+  DeviceBuffer<int> changed_slots_;
+  DeviceBuffer<DeviceVoxel> gathered_voxels_;
+  std::vector<DeviceVoxel> gathered_voxels_host_;
+};
+
+}  // namespace
+
+std::unique_ptr<Backend> createCudaBackend() {
+  int num_devices = 0;
+  if (cudaGetDeviceCount(&num_devices) != cudaSuccess || num_devices == 0) {
+    return std::unique_ptr<Backend>();
+  }
+  return std::unique_ptr<Backend>(new CudaBackend());
+}
+
+}  // namespace device_tsdf
+}  // namespace voxblox
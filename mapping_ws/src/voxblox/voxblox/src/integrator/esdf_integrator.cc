@@ -1,9 +1,54 @@
 #include "voxblox/integrator/esdf_integrator.h"
 
+#include <list>
+
 #include "voxblox/utils/planning_utils.h"
 
 namespace voxblox {
 
+namespace {
+
+/// Update of a voxel in a block owned by another thread.
+struct NeighborUpdate {
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  GlobalIndex neighbor_index;
+  /// Parent and distance of the voxel sending the update.
+  SignedIndex parent;
+  FloatingPoint distance;
+  /// Direction from the voxel to the neighbor.
+  unsigned int idx;
+};
+
+typedef AlignedVector<NeighborUpdate> NeighborUpdates;
+
+/// Open queue of a block: one stack of linear voxel indices per bucket.
+struct BlockQueue {
+  BlockIndex block_index;
+  Block<EsdfVoxel>* block = nullptr;
+  std::vector<std::vector<size_t>> buckets;
+  /// All the buckets below are empty.
+  int min_bucket = 0;
+  size_t size = 0u;
+  bool active = false;
+};
+
+/// Blocks, queues and outgoing updates of a thread.
+struct OpenSetWorker {
+  AnyIndexHashMapType<BlockQueue>::type blocks;
+  /// Queues with voxels, in the order in which they became non-empty.
+  std::vector<BlockQueue*> active_queues;
+  /// Number of queued voxels in each bucket (over all blocks).
+  std::vector<size_t> bucket_sizes;
+  /// Updates for each thread, double-buffered: one set is filled while the
+  /// other one is delivered.
+  std::vector<NeighborUpdates> outboxes[2];
+  /// Lowest bucket of the updates sent in the last round.
+  int sent_min_bucket = 0;
+};
+
+}  // namespace
+
 EsdfIntegrator::EsdfIntegrator(const Config& config,
                                Layer<TsdfVoxel>* tsdf_layer,
                                Layer<EsdfVoxel>* esdf_layer)
@@ -369,10 +414,12 @@ void EsdfIntegrator::processRaiseSet() {
 }
 
 void EsdfIntegrator::processOpenSet() {
-  size_t num_updates = 0u;
-  size_t num_inside = 0u;
-  size_t num_outside = 0u;
-  size_t num_flipped = 0u;
+  if (config_.integrator_threads > 1u) {
+    processOpenSetParallel();
+    return;
+  }
+
+  UpdateCounters counters;
   Neighborhood<>::IndexMatrix neighbor_indices;
 
   while (!open_.empty()) {
@@ -394,10 +441,6 @@ void EsdfIntegrator::processOpenSet() {
     // Go through the neighbors and see if we can update any of them.
     for (unsigned int idx = 0u; idx < neighbor_indices.cols(); ++idx) {
       const GlobalIndex& neighbor_index = neighbor_indices.col(idx);
-      const SignedIndex& direction =
-          NeighborhoodLookupTables::kOffsets.col(idx);
-      FloatingPoint distance =
-          NeighborhoodLookupTables::kDistances[idx] * voxel_size_;
 
       EsdfVoxel* neighbor_voxel =
           esdf_layer_->getVoxelPtrByGlobalIndex(neighbor_index);
@@ -411,88 +454,320 @@ void EsdfIntegrator::processOpenSet() {
         continue;
       }
 
-      SignedIndex new_parent = -direction;
-      if (config_.full_euclidean_distance) {
-        // In this case, the new parent is is actually the parent of the
-        // current voxel.
-        // And the distance is... Well, complicated.
-        new_parent = voxel->parent - direction;
-        distance = voxel_size_ * (new_parent.cast<FloatingPoint>().norm() -
-                                  voxel->parent.cast<FloatingPoint>().norm());
-
-        if (distance < 0.0) {
-          continue;
+      if (updateNeighbor(voxel->distance, voxel->parent, idx, neighbor_voxel,
+                         &counters)) {
+        // Push into the queue if necessary.
+        if (config_.multi_queue || !neighbor_voxel->in_queue) {
+          open_.push(neighbor_index, neighbor_voxel->distance);
+          neighbor_voxel->in_queue = true;
         }
       }
+    }
+  }
 
-      // Both are OUTSIDE the surface.
-      if (voxel->distance > 0 && neighbor_voxel->distance > 0) {
-        if (voxel->distance + distance + config_.min_diff_m <
-            neighbor_voxel->distance) {
-          num_updates++;
-          num_outside++;
-          neighbor_voxel->distance = voxel->distance + distance;
-          // Also update parent.
-          neighbor_voxel->parent = new_parent;
-          // Push into the queue if necessary.
-          if (config_.multi_queue || !neighbor_voxel->in_queue) {
-            open_.push(neighbor_index, neighbor_voxel->distance);
-            neighbor_voxel->in_queue = true;
-          }
+  VLOG(3) << "[ESDF update]: made " << counters.num_updates
+          << " voxel updates, of which outside: " << counters.num_outside
+          << " inside: " << counters.num_inside
+          << " flipped: " << counters.num_flipped;
+}
+
+void EsdfIntegrator::processOpenSetParallel() {
+  const size_t num_threads = config_.integrator_threads;
+  const int num_buckets = config_.num_buckets;
+  const FloatingPoint voxels_per_side_inv = 1.0 / voxels_per_side_;
+  const AnyIndexHash block_hash;
+  const auto get_owner = [&](const BlockIndex& block_index) {
+    return block_hash(block_index) % num_threads;
+  };
+
+  std::vector<OpenSetWorker> workers(num_threads);
+  for (OpenSetWorker& worker : workers) {
+    worker.bucket_sizes.resize(num_buckets, 0u);
+    worker.outboxes[0].resize(num_threads);
+    worker.outboxes[1].resize(num_threads);
+    worker.sent_min_bucket = num_buckets;
+  }
+
+  // Returns the queue of a block owned by the worker, nullptr if the block
+  // is not allocated. Only reads the block map of the layer.
+  const auto get_queue = [&](OpenSetWorker* worker,
+                             const BlockIndex& block_index) -> BlockQueue* {
+    AnyIndexHashMapType<BlockQueue>::type::iterator it =
+        worker->blocks.find(block_index);
+    if (it != worker->blocks.end()) {
+      return &it->second;
+    }
+    Block<EsdfVoxel>::Ptr block = esdf_layer_->getBlockPtrByIndex(block_index);
+    if (!block) {
+      return nullptr;
+    }
+    BlockQueue& queue = worker->blocks[block_index];
+    queue.block_index = block_index;
+    queue.block = block.get();
+    queue.buckets.resize(num_buckets);
+    queue.min_bucket = num_buckets;
+    return &queue;
+  };
+  const auto push = [&](OpenSetWorker* worker, BlockQueue* queue,
+                        size_t linear_index, FloatingPoint distance) {
+    const int bucket = getBucketIndex(distance);
+    queue->buckets[bucket].push_back(linear_index);
+    queue->min_bucket = std::min(queue->min_bucket, bucket);
+    ++queue->size;
+    ++worker->bucket_sizes[bucket];
+    if (!queue->active) {
+      queue->active = true;
+      worker->active_queues.push_back(queue);
+    }
+  };
+  // Updates a neighbor in a block owned by the worker.
+  const auto update_neighbor = [&](OpenSetWorker* worker,
+                                   const GlobalIndex& neighbor_index,
+                                   const BlockIndex& neighbor_block_index,
+                                   FloatingPoint distance,
+                                   const SignedIndex& parent, unsigned int idx,
+                                   UpdateCounters* counters) {
+    BlockQueue* queue = get_queue(worker, neighbor_block_index);
+    if (queue == nullptr) {
+      return;
+    }
+    const size_t linear_index = queue->block->computeLinearIndexFromVoxelIndex(
+        getLocalFromGlobalVoxelIndex(neighbor_index, voxels_per_side_));
+    EsdfVoxel& neighbor_voxel =
+        queue->block->getVoxelByLinearIndex(linear_index);
+    // Don't touch unobserved voxels and can't do anything with fixed voxels.
+    if (!neighbor_voxel.observed || neighbor_voxel.fixed) {
+      return;
+    }
+    if (updateNeighbor(distance, parent, idx, &neighbor_voxel, counters)) {
+      if (config_.multi_queue || !neighbor_voxel.in_queue) {
+        push(worker, queue, linear_index, neighbor_voxel.distance);
+        neighbor_voxel.in_queue = true;
+      }
+    }
+  };
+
+  // Distribute the open set among the owners of the blocks.
+  while (!open_.empty()) {
+    const GlobalIndex global_index = open_.front();
+    open_.pop();
+    const BlockIndex block_index =
+        getBlockIndexFromGlobalVoxelIndex(global_index, voxels_per_side_inv);
+    OpenSetWorker* worker = &workers[get_owner(block_index)];
+    BlockQueue* queue = get_queue(worker, block_index);
+    CHECK_NOTNULL(queue);
+    const size_t linear_index = queue->block->computeLinearIndexFromVoxelIndex(
+        getLocalFromGlobalVoxelIndex(global_index, voxels_per_side_));
+    push(worker, queue, linear_index,
+         queue->block->getVoxelByLinearIndex(linear_index).distance);
+  }
+
+  std::vector<UpdateCounters> counters(num_threads);
+  size_t num_rounds = 0u;
+  int outbox = 0;
+  while (true) {
+    // The round processes the voxels up to the lowest bucket with queued
+    // voxels or pending updates.
+    int level = num_buckets;
+    for (const OpenSetWorker& worker : workers) {
+      level = std::min(level, worker.sent_min_bucket);
+      for (int bucket = 0; bucket < level; ++bucket) {
+        if (worker.bucket_sizes[bucket] > 0u) {
+          level = bucket;
+          break;
         }
-        // Next case is both INSIDE the surface.
-      } else if (voxel->distance <= 0 && neighbor_voxel->distance <= 0) {
-        if (voxel->distance - distance - config_.min_diff_m >
-            neighbor_voxel->distance) {
-          num_updates++;
-          num_inside++;
-          neighbor_voxel->distance = voxel->distance - distance;
-          // Also update parent.
-          neighbor_voxel->parent = new_parent;
-          // Push into the queue if necessary.
-          if (config_.multi_queue || !neighbor_voxel->in_queue) {
-            open_.push(neighbor_index, neighbor_voxel->distance);
-            neighbor_voxel->in_queue = true;
-          }
+      }
+    }
+    if (level == num_buckets) {
+      break;
+    }
+    const int inbox = outbox;
+    outbox = 1 - outbox;
+
+    const auto process_worker = [&](size_t thread_idx) {
+      OpenSetWorker* worker = &workers[thread_idx];
+      UpdateCounters* worker_counters = &counters[thread_idx];
+
+      // Deliver the updates sent to this thread in the last round.
+      for (OpenSetWorker& sender : workers) {
+        NeighborUpdates& updates = sender.outboxes[inbox][thread_idx];
+        for (const NeighborUpdate& update : updates) {
+          update_neighbor(worker, update.neighbor_index,
+                          getBlockIndexFromGlobalVoxelIndex(
+                              update.neighbor_index, voxels_per_side_inv),
+                          update.distance, update.parent, update.idx,
+                          worker_counters);
         }
-        // Final case is if the signs are different.
-      } else {
-        const FloatingPoint potential_distance =
-            voxel->distance - signum(voxel->distance) * distance;
-        if (std::abs(potential_distance - neighbor_voxel->distance) >
-            distance) {
-          if (signum(potential_distance) == neighbor_voxel->distance) {
-            num_updates++;
-            num_flipped++;
-            neighbor_voxel->distance = potential_distance;
-            // Also update parent.
-            neighbor_voxel->parent = new_parent;
-            // Push into the queue if necessary.
-            if (config_.multi_queue || !neighbor_voxel->in_queue) {
-              open_.push(neighbor_index, neighbor_voxel->distance);
-              neighbor_voxel->in_queue = true;
-            }
-          } else {
-            num_updates++;
-            num_flipped++;
-            neighbor_voxel->distance =
-                signum(neighbor_voxel->distance) * distance;
-            // Also update parent.
-            neighbor_voxel->parent = new_parent;
-            // Push into the queue if necessary.
-            if (config_.multi_queue || !neighbor_voxel->in_queue) {
-              open_.push(neighbor_index, neighbor_voxel->distance);
-              neighbor_voxel->in_queue = true;
+        updates.clear();
+      }
+      worker->sent_min_bucket = num_buckets;
+
+      // Propagate inside the blocks, the active queues can grow meanwhile.
+      Neighborhood<>::IndexMatrix neighbor_indices;
+      for (size_t queue_idx = 0u; queue_idx < worker->active_queues.size();
+           ++queue_idx) {
+        BlockQueue* queue = worker->active_queues[queue_idx];
+        while (queue->size > 0u) {
+          while (queue->buckets[queue->min_bucket].empty()) {
+            ++queue->min_bucket;
+          }
+          const int bucket = queue->min_bucket;
+          if (bucket > level) {
+            break;
+          }
+          const size_t linear_index = queue->buckets[bucket].back();
+          queue->buckets[bucket].pop_back();
+          --queue->size;
+          --worker->bucket_sizes[bucket];
+
+          EsdfVoxel& voxel = queue->block->getVoxelByLinearIndex(linear_index);
+          voxel.in_queue = false;
+
+          // Skip voxels that are unobserved or outside the ranges we care
+          // about.
+          if (!voxel.observed || voxel.distance >= config_.max_distance_m ||
+              voxel.distance <= -config_.max_distance_m) {
+            continue;
+          }
+
+          const GlobalIndex global_index =
+              getGlobalVoxelIndexFromBlockAndVoxelIndex(
+                  queue->block_index,
+                  queue->block->computeVoxelIndexFromLinearIndex(linear_index),
+                  voxels_per_side_);
+          Neighborhood<>::getFromGlobalIndex(global_index, &neighbor_indices);
+
+          for (unsigned int idx = 0u; idx < neighbor_indices.cols(); ++idx) {
+            const GlobalIndex& neighbor_index = neighbor_indices.col(idx);
+            const BlockIndex neighbor_block_index =
+                getBlockIndexFromGlobalVoxelIndex(neighbor_index,
+                                                  voxels_per_side_inv);
+            const size_t owner = neighbor_block_index == queue->block_index
+                                     ? thread_idx
+                                     : get_owner(neighbor_block_index);
+            if (owner == thread_idx) {
+              update_neighbor(worker, neighbor_index, neighbor_block_index,
+                              voxel.distance, voxel.parent, idx,
+                              worker_counters);
+            } else {
+              // The block belongs to another thread, send the update.
+              NeighborUpdate update;
+              update.neighbor_index = neighbor_index;
+              update.parent = voxel.parent;
+              update.distance = voxel.distance;
+              update.idx = idx;
+              worker->outboxes[outbox][owner].push_back(update);
+              worker->sent_min_bucket = std::min(
+                  worker->sent_min_bucket, getBucketIndex(voxel.distance));
             }
           }
         }
       }
+
+      // Keep the queues that still have voxels.
+      size_t num_active = 0u;
+      for (BlockQueue* queue : worker->active_queues) {
+        if (queue->size > 0u) {
+          worker->active_queues[num_active++] = queue;
+        } else {
+          queue->active = false;
+        }
+      }
+      worker->active_queues.resize(num_active);
+    };
+
+    std::list<std::thread> threads;
+    for (size_t i = 0u; i < num_threads; ++i) {
+      threads.emplace_back(process_worker, i);
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    ++num_rounds;
+  }
+
+  UpdateCounters total;
+  for (const UpdateCounters& worker_counters : counters) {
+    total.add(worker_counters);
+  }
+  VLOG(3) << "[ESDF update]: made " << total.num_updates
+          << " voxel updates in " << num_rounds
+          << " rounds, of which outside: " << total.num_outside
+          << " inside: " << total.num_inside
+          << " flipped: " << total.num_flipped;
+}
+
+bool EsdfIntegrator::updateNeighbor(FloatingPoint voxel_distance,
+                                    const SignedIndex& voxel_parent,
+                                    unsigned int idx,
+                                    EsdfVoxel* neighbor_voxel,
+                                    UpdateCounters* counters) const {
+  const SignedIndex& direction = NeighborhoodLookupTables::kOffsets.col(idx);
+  FloatingPoint distance =
+      NeighborhoodLookupTables::kDistances[idx] * voxel_size_;
+
+  SignedIndex new_parent = -direction;
+  if (config_.full_euclidean_distance) {
+    // In this case, the new parent is is actually the parent of the
+    // current voxel.
+    // And the distance is... Well, complicated.
+    new_parent = voxel_parent - direction;
+    distance = voxel_size_ * (new_parent.cast<FloatingPoint>().norm() -
+                              voxel_parent.cast<FloatingPoint>().norm());
+
+    if (distance < 0.0) {
+      return false;
+    }
+  }
+
+  // Both are OUTSIDE the surface.
+  if (voxel_distance > 0 && neighbor_voxel->distance > 0) {
+    if (voxel_distance + distance + config_.min_diff_m <
+        neighbor_voxel->distance) {
+      counters->num_updates++;
+      counters->num_outside++;
+      neighbor_voxel->distance = voxel_distance + distance;
+      // Also update parent.
+      neighbor_voxel->parent = new_parent;
+      return true;
+    }
+    // Next case is both INSIDE the surface.
+  } else if (voxel_distance <= 0 && neighbor_voxel->distance <= 0) {
+    if (voxel_distance - distance - config_.min_diff_m >
+        neighbor_voxel->distance) {
+      counters->num_updates++;
+      counters->num_inside++;
+      neighbor_voxel->distance = voxel_distance - distance;
+      // Also update parent.
+      neighbor_voxel->parent = new_parent;
+      return true;
+    }
+    // Final case is if the signs are different.
+  } else {
+    const FloatingPoint potential_distance =
+        voxel_distance - signum(voxel_distance) * distance;
+    if (std::abs(potential_distance - neighbor_voxel->distance) > distance) {
+      counters->num_updates++;
+      counters->num_flipped++;
+      if (signum(potential_distance) == neighbor_voxel->distance) {
+        neighbor_voxel->distance = potential_distance;
+      } else {
+        neighbor_voxel->distance = signum(neighbor_voxel->distance) * distance;
+      }
+      // Also update parent.
+      neighbor_voxel->parent = new_parent;
+      return true;
     }
   }
+  return false;
+}
 
-  VLOG(3) << "[ESDF update]: made " << num_updates
-          << " voxel updates, of which outside: " << num_outside
-          << " inside: " << num_inside << " flipped: " << num_flipped;
+int EsdfIntegrator::getBucketIndex(FloatingPoint distance) const {
+  // Same bucketing as BucketQueue::push.
+  const FloatingPoint value = std::min(distance, config_.max_distance_m);
+  const int bucket_index = std::floor(std::abs(value) / config_.max_distance_m *
+                                      (config_.num_buckets - 1));
+  return std::min(bucket_index, config_.num_buckets - 1);
 }
 
 bool EsdfIntegrator::updateVoxelFromNeighbors(const GlobalIndex& global_index) {
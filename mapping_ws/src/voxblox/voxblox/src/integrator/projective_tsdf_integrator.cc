@@ -0,0 +1,252 @@
+#include "voxblox/integrator/projective_tsdf_integrator.h"
+
+#include <cmath>
+#include <functional>
+#include <list>
+#include <thread>
+
+namespace voxblox {
+
+ProjectiveTsdfIntegrator::ProjectiveTsdfIntegrator(const Config& config,
+                                                   Layer<TsdfVoxel>* layer)
+    : TsdfIntegratorBase(config, layer),
+      horizontal_resolution_(config.sensor_horizontal_resolution),
+      vertical_resolution_(config.sensor_vertical_resolution),
+      vertical_fov_rad_(config.sensor_vertical_field_of_view_degrees * M_PI /
+                        180.0) {
+  CHECK_GT(horizontal_resolution_, 0)
+      << "The projective integrator needs the sensor_horizontal_resolution.";
+  CHECK_GT(vertical_resolution_, 1)
+      << "The projective integrator needs the sensor_vertical_resolution.";
+  CHECK_GT(vertical_fov_rad_, 0.0)
+      << "The projective integrator needs the "
+         "sensor_vertical_field_of_view_degrees.";
+  range_image_.resize(horizontal_resolution_ * vertical_resolution_);
+}
+
+void ProjectiveTsdfIntegrator::integratePointCloud(
+    const Transformation& T_G_C, const Pointcloud& points_C,
+    const Colors& colors, const bool freespace_points) {
+  timing::Timer integrate_timer("integrate/projective");
+  CHECK_EQ(points_C.size(), colors.size());
+
+  timing::Timer range_image_timer("integrate/projective/range_image");
+  computeRangeImage(points_C, freespace_points);
+  range_image_timer.Stop();
+
+  timing::Timer allocate_timer("integrate/projective/allocate_blocks");
+  BlockIndexList block_indices;
+  getBlocksInFrustum(T_G_C, points_C, &block_indices);
+  std::vector<char> block_is_new(block_indices.size(), false);
+  for (size_t i = 0u; i < block_indices.size(); ++i) {
+    if (!layer_->getBlockPtrByIndex(block_indices[i])) {
+      layer_->allocateNewBlock(block_indices[i]);
+      block_is_new[i] = true;
+    }
+  }
+  allocate_timer.Stop();
+
+  std::atomic<size_t> block_counter(0u);
+  std::vector<char> block_updated(block_indices.size(), false);
+  std::list<std::thread> integration_threads;
+  for (size_t i = 0; i < config_.integrator_threads; ++i) {
+    integration_threads.emplace_back(
+        &ProjectiveTsdfIntegrator::integrateBlocks, this, T_G_C,
+        std::cref(colors), std::cref(block_indices), &block_counter,
+        &block_updated);
+  }
+  for (std::thread& thread : integration_threads) {
+    thread.join();
+  }
+
+  // Blocks in the frustum that are entirely occluded get no update.
+  for (size_t i = 0u; i < block_indices.size(); ++i) {
+    if (block_is_new[i] && !block_updated[i]) {
+      layer_->removeBlock(block_indices[i]);
+    }
+  }
+  integrate_timer.Stop();
+}
+
+void ProjectiveTsdfIntegrator::computeRangeImage(const Pointcloud& points_C,
+                                                 const bool freespace_points) {
+  for (RangePixel& pixel : range_image_) {
+    pixel = RangePixel();
+  }
+  for (size_t point_idx = 0u; point_idx < points_C.size(); ++point_idx) {
+    const Point& point_C = points_C[point_idx];
+    bool is_clearing;
+    int row, col;
+    if (!isPointValid(point_C, freespace_points, &is_clearing) ||
+        !projectPointToImage(point_C, &row, &col)) {
+      continue;
+    }
+    // Keep the closest surface point of each pixel.
+    RangePixel& pixel = range_image_[row * horizontal_resolution_ + col];
+    const FloatingPoint range = point_C.norm();
+    const bool is_closer = (pixel.range == 0.0) ||
+                           (pixel.is_clearing && !is_clearing) ||
+                           (pixel.is_clearing == is_clearing &&
+                            range < pixel.range);
+    if (is_closer) {
+      pixel.range = range;
+      pixel.point_idx = point_idx;
+      pixel.is_clearing = is_clearing;
+    }
+  }
+}
+
+void ProjectiveTsdfIntegrator::getBlocksInFrustum(
+    const Transformation& T_G_C, const Pointcloud& points_C,
+    BlockIndexList* block_indices) const {
+  DCHECK(block_indices != nullptr);
+  const Point& origin = T_G_C.getPosition();
+  const Transformation::RotationMatrix R_G_C = T_G_C.getRotationMatrix();
+
+  // Cast the rays at block resolution.
+  IndexSet block_set;
+  AlignedVector<GlobalIndex> ray_block_indices;
+  for (const RangePixel& pixel : range_image_) {
+    if (pixel.range == 0.0) {
+      continue;
+    }
+    const Point point_G = R_G_C * points_C[pixel.point_idx] + origin;
+    const Ray unit_ray = (point_G - origin) / pixel.range;
+
+    Point ray_start, ray_end;
+    if (pixel.is_clearing) {
+      ray_start = origin;
+      ray_end = origin +
+                unit_ray * std::min(pixel.range, config_.max_ray_length_m);
+    } else {
+      ray_start = config_.voxel_carving_enabled
+                      ? origin
+                      : Point(point_G - unit_ray *
+                                            config_.default_truncation_distance);
+      ray_end = point_G + unit_ray * config_.default_truncation_distance;
+    }
+
+    ray_block_indices.clear();
+    castRay(ray_start * block_size_inv_, ray_end * block_size_inv_,
+            &ray_block_indices);
+    for (const GlobalIndex& block_idx : ray_block_indices) {
+      block_set.insert(block_idx.cast<IndexElement>());
+    }
+  }
+
+  block_indices->assign(block_set.begin(), block_set.end());
+}
+
+void ProjectiveTsdfIntegrator::integrateBlocks(
+    const Transformation& T_G_C, const Colors& colors,
+    const BlockIndexList& block_indices,
+    std::atomic<size_t>* block_counter, std::vector<char>* block_updated) {
+  DCHECK(block_counter != nullptr);
+  DCHECK(block_updated != nullptr);
+  const Transformation T_C_G = T_G_C.inverse();
+
+  size_t i;
+  while ((i = (*block_counter)++) < block_indices.size()) {
+    Block<TsdfVoxel>::Ptr block = layer_->getBlockPtrByIndex(block_indices[i]);
+    // Each entry is written by one thread only.
+    (*block_updated)[i] = integrateBlock(T_C_G, colors, block.get());
+  }
+}
+
+bool ProjectiveTsdfIntegrator::integrateBlock(const Transformation& T_C_G,
+                                              const Colors& colors,
+                                              Block<TsdfVoxel>* block) {
+  DCHECK(block != nullptr);
+  const FloatingPoint truncation_distance = config_.default_truncation_distance;
+
+  // The voxel centers in the sensor frame are stepped along the voxel axes,
+  // in the order of the linear voxel index (x is the fastest).
+  const Eigen::Matrix<FloatingPoint, 3, 3> R_C_G = T_C_G.getRotationMatrix();
+  const Point step_x = R_C_G.col(0) * voxel_size_;
+  const Point step_y = R_C_G.col(1) * voxel_size_;
+  const Point step_z = R_C_G.col(2) * voxel_size_;
+  const Point first_voxel_C =
+      T_C_G * (block->origin() + Point::Constant(0.5 * voxel_size_));
+
+  bool block_updated = false;
+  size_t linear_idx = 0u;
+  for (size_t z = 0u; z < voxels_per_side_; ++z) {
+    for (size_t y = 0u; y < voxels_per_side_; ++y) {
+      Point voxel_C = first_voxel_C + static_cast<FloatingPoint>(y) * step_y +
+                      static_cast<FloatingPoint>(z) * step_z;
+      for (size_t x = 0u; x < voxels_per_side_;
+           ++x, ++linear_idx, voxel_C += step_x) {
+        const FloatingPoint voxel_range = voxel_C.norm();
+        if (voxel_range < config_.min_ray_length_m ||
+            voxel_range > config_.max_ray_length_m + truncation_distance) {
+          continue;
+        }
+
+        int row, col;
+        if (!projectPointToImage(voxel_C, &row, &col)) {
+          continue;
+        }
+        const RangePixel& pixel =
+            range_image_[row * horizontal_resolution_ + col];
+        if (pixel.range == 0.0) {
+          continue;
+        }
+
+        const float sdf = static_cast<float>(pixel.range - voxel_range);
+        if (pixel.is_clearing) {
+          // Only the free space in front of the point is observed.
+          if (sdf < 0.0f || voxel_range > config_.max_ray_length_m) {
+            continue;
+          }
+        } else if (sdf < -truncation_distance ||
+                   (!config_.voxel_carving_enabled &&
+                    sdf > truncation_distance)) {
+          continue;
+        }
+
+        // The range (not the camera z of getVoxelWeight()) is the depth of a
+        // LIDAR measurement.
+        float weight = 1.0f;
+        if (!config_.use_const_weight) {
+          weight = 1.0f / (pixel.range * pixel.range);
+        }
+        weight = computeUpdatedWeight(sdf, weight);
+
+        mergeTsdfVoxel(sdf, colors[pixel.point_idx], weight,
+                       &block->getVoxelByLinearIndex(linear_idx));
+        block_updated = true;
+      }
+    }
+  }
+
+  if (block_updated) {
+    block->has_data() = true;
+    block->updated().set();
+  }
+  return block_updated;
+}
+
+bool ProjectiveTsdfIntegrator::projectPointToImage(const Point& point_C,
+                                                   int* row, int* col) const {
+  DCHECK(row != nullptr);
+  DCHECK(col != nullptr);
+
+  const FloatingPoint horizontal_distance =
+      std::sqrt(point_C.x() * point_C.x() + point_C.y() * point_C.y());
+  const FloatingPoint vertical_angle =
+      std::atan2(point_C.z(), horizontal_distance);
+  *row = static_cast<int>(std::round((0.5 * vertical_fov_rad_ - vertical_angle) /
+                                     vertical_fov_rad_ *
+                                     (vertical_resolution_ - 1)));
+  if (*row < 0 || *row >= vertical_resolution_) {
+    return false;
+  }
+
+  const FloatingPoint horizontal_angle = std::atan2(point_C.y(), point_C.x());
+  *col = static_cast<int>(std::round((horizontal_angle + M_PI) / (2.0 * M_PI) *
+                                     horizontal_resolution_)) %
+         horizontal_resolution_;
+  return true;
+}
+
+}  // namespace voxblox
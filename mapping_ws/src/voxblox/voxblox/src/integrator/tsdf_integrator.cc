@@ -3,6 +3,9 @@
 #include <iostream>
 #include <list>
 
+#include "voxblox/integrator/device_tsdf_integrator.h"
+#include "voxblox/integrator/projective_tsdf_integrator.h"
+
 namespace voxblox {
 
 TsdfIntegratorBase::Ptr TsdfIntegratorFactory::create(
@@ -37,6 +40,13 @@ TsdfIntegratorBase::Ptr TsdfIntegratorFactory::create(
     case TsdfIntegratorType::kFast:
       return TsdfIntegratorBase::Ptr(new FastTsdfIntegrator(config, layer));
       break;
+    case TsdfIntegratorType::kProjective:
+      return TsdfIntegratorBase::Ptr(
+          new ProjectiveTsdfIntegrator(config, layer));
+      break;
+    case TsdfIntegratorType::kDevice:
+      return TsdfIntegratorBase::Ptr(new DeviceTsdfIntegrator(config, layer));
+      break;
     default:
       LOG(FATAL) << "Unknown TSDF integrator type: "
                  << static_cast<int>(integrator_type);
@@ -83,9 +93,10 @@ void TsdfIntegratorBase::setLayer(Layer<TsdfVoxel>* layer) {
 // layer. Thread safe.
 // Takes in the last_block_idx and last_block to prevent unneeded map lookups.
 // If the block this voxel would be in has not been allocated, a block in
-// temp_block_map_ is created/accessed and a voxel from this map is returned
-// instead. Unlike the layer, accessing temp_block_map_ is controlled via a
-// mutex allowing it to grow during integration.
+// temp_block_shards_ is created/accessed and a voxel from this map is returned
+// instead. Unlike the layer, the temporary blocks are split in shards by block
+// index, each with its own mutex, allowing them to grow during integration
+// while threads working on different blocks rarely wait for each other.
 // These temporary blocks can be merged into the layer later by calling
 // updateLayerWithStoredBlocks()
 TsdfVoxel* TsdfIntegratorBase::allocateStorageAndGetVoxelPtr(
@@ -105,23 +116,25 @@ TsdfVoxel* TsdfIntegratorBase::allocateStorageAndGetVoxelPtr(
   // If no block at this location currently exists, we allocate a temporary
   // voxel that will be merged into the map later
   if (*last_block == nullptr) {
-    // To allow temp_block_map_ to grow we can only let one thread in at once
-    std::lock_guard<std::mutex> lock(temp_block_mutex_);
-
-    typename Layer<TsdfVoxel>::BlockHashMap::iterator it =
-        temp_block_map_.find(block_idx);
-    if (it != temp_block_map_.end()) {
-      *last_block = it->second;
-    } else {
-      auto insert_status = temp_block_map_.emplace(
-          block_idx, std::make_shared<Block<TsdfVoxel>>(
-                         voxels_per_side_, voxel_size_,
-                         getOriginPointFromGridIndex(block_idx, block_size_)));
+    TempBlockShard& shard = temp_block_shards_.get(block_idx);
+    {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      typename Layer<TsdfVoxel>::BlockHashMap::iterator it =
+          shard.blocks.find(block_idx);
+      if (it != shard.blocks.end()) {
+        *last_block = it->second;
+      }
+    }
 
-      DCHECK(insert_status.second) << "Block already exists when allocating at "
-                                   << block_idx.transpose();
+    if (*last_block == nullptr) {
+      // Allocate (and zero) the block outside of the lock, if another thread
+      // inserted it in the meantime this one is dropped.
+      Block<TsdfVoxel>::Ptr new_block = std::make_shared<Block<TsdfVoxel>>(
+          voxels_per_side_, voxel_size_,
+          getOriginPointFromGridIndex(block_idx, block_size_));
 
-      *last_block = insert_status.first->second;
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      *last_block = shard.blocks.emplace(block_idx, new_block).first->second;
     }
   }
 
@@ -135,15 +148,13 @@ TsdfVoxel* TsdfIntegratorBase::allocateStorageAndGetVoxelPtr(
 
 // NOT thread safe
 void TsdfIntegratorBase::updateLayerWithStoredBlocks() {
-  BlockIndex last_block_idx;
-  Block<TsdfVoxel>::Ptr block = nullptr;
-
-  for (const std::pair<const BlockIndex, Block<TsdfVoxel>::Ptr>&
-           temp_block_pair : temp_block_map_) {
-    layer_->insertBlock(temp_block_pair);
+  for (TempBlockShard& shard : temp_block_shards_) {
+    for (const std::pair<const BlockIndex, Block<TsdfVoxel>::Ptr>&
+             temp_block_pair : shard.blocks) {
+      layer_->insertBlock(temp_block_pair);
+    }
+    shard.blocks.clear();
   }
-
-  temp_block_map_.clear();
 }
 
 // Updates tsdf_voxel. Thread safe.
@@ -159,6 +170,17 @@ void TsdfIntegratorBase::updateTsdfVoxel(const Point& origin,
 
   const float sdf = computeDistance(origin, point_G, voxel_center);
 
+  const float updated_weight = computeUpdatedWeight(sdf, weight);
+
+  // Lookup the mutex that is responsible for this voxel and lock it
+  std::lock_guard<std::mutex> lock(mutexes_.get(global_voxel_idx));
+
+  mergeTsdfVoxel(sdf, color, updated_weight, tsdf_voxel);
+}
+
+// Thread safe.
+float TsdfIntegratorBase::computeUpdatedWeight(const float sdf,
+                                               const float weight) const {
   float updated_weight = weight;
   // Compute updated weight in case we use weight dropoff. It's easier here
   // that in getVoxelWeight as here we have the actual SDF for the voxel
@@ -181,11 +203,16 @@ void TsdfIntegratorBase::updateTsdfVoxel(const Point& origin,
       updated_weight *= config_.sparsity_compensation_factor;
     }
   }
+  return updated_weight;
+}
 
-  // Lookup the mutex that is responsible for this voxel and lock it
-  std::lock_guard<std::mutex> lock(mutexes_.get(global_voxel_idx));
+// NOT thread safe, the caller must hold the voxel.
+void TsdfIntegratorBase::mergeTsdfVoxel(const float sdf, const Color& color,
+                                        const float weight,
+                                        TsdfVoxel* tsdf_voxel) const {
+  DCHECK(tsdf_voxel != nullptr);
 
-  const float new_weight = tsdf_voxel->weight + updated_weight;
+  const float new_weight = tsdf_voxel->weight + weight;
 
   // it is possible to have weights very close to zero, due to the limited
   // precision of floating points dividing by this small value can cause nans
@@ -194,13 +221,12 @@ void TsdfIntegratorBase::updateTsdfVoxel(const Point& origin,
   }
 
   const float new_sdf =
-      (sdf * updated_weight + tsdf_voxel->distance * tsdf_voxel->weight) /
-      new_weight;
+      (sdf * weight + tsdf_voxel->distance * tsdf_voxel->weight) / new_weight;
 
   // color blending is expensive only do it close to the surface
   if (std::abs(sdf) < config_.default_truncation_distance) {
     tsdf_voxel->color = Color::blendTwoColors(
-        tsdf_voxel->color, tsdf_voxel->weight, color, updated_weight);
+        tsdf_voxel->color, tsdf_voxel->weight, color, weight);
   }
   tsdf_voxel->distance =
       (new_sdf > 0.0) ? std::min(config_.default_truncation_distance, new_sdf)
@@ -273,6 +299,11 @@ void SimpleTsdfIntegrator::integrateFunction(const Transformation& T_G_C,
                                              ThreadSafeIndex* index_getter) {
   DCHECK(index_getter != nullptr);
 
+  // Rotate the points by a matrix computed once, rather than by the
+  // quaternion at every point.
+  const Point origin = T_G_C.getPosition();
+  const Transformation::RotationMatrix R_G_C = T_G_C.getRotationMatrix();
+
   size_t point_idx;
   while (index_getter->getNextIndex(&point_idx)) {
     const Point& point_C = points_C[point_idx];
@@ -282,8 +313,7 @@ void SimpleTsdfIntegrator::integrateFunction(const Transformation& T_G_C,
       continue;
     }
 
-    const Point origin = T_G_C.getPosition();
-    const Point point_G = T_G_C * point_C;
+    const Point point_G = R_G_C * point_C + origin;
 
     RayCaster ray_caster(origin, point_G, is_clearing,
                          config_.voxel_carving_enabled,
@@ -345,6 +375,9 @@ void MergedTsdfIntegrator::bundleRays(
   DCHECK(voxel_map != nullptr);
   DCHECK(clear_map != nullptr);
 
+  const Point& t_G_C = T_G_C.getPosition();
+  const Transformation::RotationMatrix R_G_C = T_G_C.getRotationMatrix();
+
   size_t point_idx;
   while (index_getter->getNextIndex(&point_idx)) {
     const Point& point_C = points_C[point_idx];
@@ -353,7 +386,7 @@ void MergedTsdfIntegrator::bundleRays(
       continue;
     }
 
-    const Point point_G = T_G_C * point_C;
+    const Point point_G = R_G_C * point_C + t_G_C;
 
     GlobalIndex voxel_index =
         getGridIndexFromPoint<GlobalIndex>(point_G, voxel_size_inv_);
@@ -492,6 +525,9 @@ void FastTsdfIntegrator::integrateFunction(const Transformation& T_G_C,
                                            ThreadSafeIndex* index_getter) {
   DCHECK(index_getter != nullptr);
 
+  const Point origin = T_G_C.getPosition();
+  const Transformation::RotationMatrix R_G_C = T_G_C.getRotationMatrix();
+
   size_t point_idx;
   while (index_getter->getNextIndex(&point_idx) &&
          (std::chrono::duration_cast<std::chrono::microseconds>(
@@ -504,8 +540,7 @@ void FastTsdfIntegrator::integrateFunction(const Transformation& T_G_C,
       continue;
     }
 
-    const Point origin = T_G_C.getPosition();
-    const Point point_G = T_G_C * point_C;
+    const Point point_G = R_G_C * point_C + origin;
     // Checks to see if another ray in this scan has already started 'close'
     // to this location. If it has then we skip ray casting this point. We
     // measure if a start location is 'close' to another points by inserting
@@ -612,6 +647,10 @@ std::string TsdfIntegratorBase::Config::print() const {
   ss << " - max_consecutive_ray_collisions:            " << max_consecutive_ray_collisions << "\n";
   ss << " - clear_checks_every_n_frames:               " << clear_checks_every_n_frames << "\n";
   ss << " - max_integration_time_s:                    " << max_integration_time_s << "\n";
+  ss << " ProjectiveTsdfIntegrator: \n";
+  ss << " - sensor_horizontal_resolution:              " << sensor_horizontal_resolution << "\n";
+  ss << " - sensor_vertical_resolution:                " << sensor_vertical_resolution << "\n";
+  ss << " - sensor_vertical_field_of_view_degrees:     " << sensor_vertical_field_of_view_degrees << "\n";
   ss << "==============================================================\n";
   // clang-format on
   return ss.str();
@@ -23,6 +23,7 @@
 #include <ostream>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 
 #include <glog/logging.h>
 
@@ -45,21 +46,26 @@ Timing::~Timing() {}
 
 // Static functions to query the timers:
 size_t Timing::GetHandle(std::string const& tag) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  // Search for an existing tag.
-  map_t::iterator i = Instance().tagMap_.find(tag);
-  if (i == Instance().tagMap_.end()) {
-    // If it is not there, create a tag.
-    size_t handle = Instance().timers_.size();
+  // Timers are usually constructed by tag, look it up without locking.
+  static thread_local std::unordered_map<std::string, size_t> tl_handles;
+  std::unordered_map<std::string, size_t>::const_iterator it =
+      tl_handles.find(tag);
+  if (it != tl_handles.end()) {
+    return it->second;
+  }
+
+  const int zone =
+      mr3d_profiling::Profiler::instance().registerZone("voxblox/" + tag);
+  const size_t handle = static_cast<size_t>(zone);
+  if (zone >= 0) {
+    std::lock_guard<std::mutex> lock(Instance().mutex_);
     Instance().tagMap_[tag] = handle;
-    Instance().timers_.push_back(TimerMapValue());
     // Track the maximum tag length to help printing a table of timing values
     // later.
     Instance().maxTagLength_ = std::max(Instance().maxTagLength_, tag.size());
-    return handle;
-  } else {
-    return i->second;
   }
+  tl_handles[tag] = handle;
+  return handle;
 }
 
 std::string Timing::GetTag(size_t handle) {
@@ -75,14 +81,19 @@ std::string Timing::GetTag(size_t handle) {
   return tag;
 }
 
+Timing::map_t Timing::GetTimers() {
+  std::lock_guard<std::mutex> lock(Instance().mutex_);
+  return Instance().tagMap_;
+}
+
 // Class functions used for timing.
 Timer::Timer(size_t handle, bool constructStopped)
-    : timing_(false), handle_(handle) {
+    : start_ns_(0), timing_(false), handle_(handle) {
   if (!constructStopped) Start();
 }
 
 Timer::Timer(std::string const& tag, bool constructStopped)
-    : timing_(false), handle_(Timing::GetHandle(tag)) {
+    : start_ns_(0), timing_(false), handle_(Timing::GetHandle(tag)) {
   if (!constructStopped) Start();
 }
 
@@ -92,76 +103,70 @@ Timer::~Timer() {
 
 void Timer::Start() {
   timing_ = true;
-  time_ = std::chrono::system_clock::now();
+  start_ns_ = mr3d_profiling::Profiler::nowNs();
 }
 
 void Timer::Stop() {
-  std::chrono::time_point<std::chrono::system_clock> now =
-      std::chrono::system_clock::now();
-  double dt =
-      static_cast<double>(
-          std::chrono::duration_cast<std::chrono::nanoseconds>(now - time_)
-              .count()) *
-      kNumSecondsPerNanosecond;
-
-  Timing::Instance().AddTime(handle_, dt);
+  mr3d_profiling::Profiler::instance().record(
+      static_cast<int>(handle_), mr3d_profiling::Profiler::nowNs() - start_ns_);
   timing_ = false;
 }
 
 bool Timer::IsTiming() const { return timing_; }
 
-void Timing::AddTime(size_t handle, double seconds) {
+mr3d_profiling::ZoneStats Timing::GetStats(size_t handle) {
+  mr3d_profiling::ZoneStats stats;
+  mr3d_profiling::Profiler::instance().getStats(static_cast<int>(handle),
+                                                stats);
   std::lock_guard<std::mutex> lock(Instance().mutex_);
-  timers_[handle].acc_.Add(seconds);
+  std::map<size_t, mr3d_profiling::ZoneStats>::const_iterator it =
+      Instance().resetStats_.find(handle);
+  if (it != Instance().resetStats_.end()) {
+    stats.subtract(it->second);
+  }
+  return stats;
 }
 
 double Timing::GetTotalSeconds(size_t handle) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  return Instance().timers_[handle].acc_.Sum();
+  return GetStats(handle).sum_ns * kNumSecondsPerNanosecond;
 }
 double Timing::GetTotalSeconds(std::string const& tag) {
   return GetTotalSeconds(GetHandle(tag));
 }
 double Timing::GetMeanSeconds(size_t handle) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  return Instance().timers_[handle].acc_.Mean();
+  return GetStats(handle).meanSec();
 }
 double Timing::GetMeanSeconds(std::string const& tag) {
   return GetMeanSeconds(GetHandle(tag));
 }
-size_t Timing::GetNumSamples(size_t handle) {
-  return Instance().timers_[handle].acc_.TotalSamples();
-}
+size_t Timing::GetNumSamples(size_t handle) { return GetStats(handle).count; }
 size_t Timing::GetNumSamples(std::string const& tag) {
   return GetNumSamples(GetHandle(tag));
 }
 double Timing::GetVarianceSeconds(size_t handle) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  return Instance().timers_[handle].acc_.LazyVariance();
+  const double stddev = GetStats(handle).stdDevSec();
+  return stddev * stddev;
 }
 double Timing::GetVarianceSeconds(std::string const& tag) {
   return GetVarianceSeconds(GetHandle(tag));
 }
 double Timing::GetMinSeconds(size_t handle) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  return Instance().timers_[handle].acc_.Min();
+  return GetStats(handle).minSec();
 }
 double Timing::GetMinSeconds(std::string const& tag) {
   return GetMinSeconds(GetHandle(tag));
 }
 double Timing::GetMaxSeconds(size_t handle) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  return Instance().timers_[handle].acc_.Max();
+  return GetStats(handle).maxSec();
 }
 double Timing::GetMaxSeconds(std::string const& tag) {
   return GetMaxSeconds(GetHandle(tag));
 }
 
 double Timing::GetHz(size_t handle) {
-  std::lock_guard<std::mutex> lock(Instance().mutex_);
-  const double rolling_mean = Instance().timers_[handle].acc_.RollingMean();
-  CHECK_GT(rolling_mean, 0.0);
-  return 1.0 / rolling_mean;
+  const double mean = GetMeanSeconds(handle);
+  CHECK_GT(mean, 0.0);
+  return 1.0 / mean;
 }
 
 double Timing::GetHz(std::string const& tag) { return GetHz(GetHandle(tag)); }
@@ -173,7 +178,7 @@ std::string Timing::SecondsToTimeString(double seconds) {
 }
 
 void Timing::Print(std::ostream& out) {
-  map_t& tagMap = Instance().tagMap_;
+  const map_t tagMap = GetTimers();
 
   if (tagMap.empty()) {
     return;
@@ -182,27 +187,22 @@ void Timing::Print(std::ostream& out) {
   out << "SM Timing\n";
   out << "-----------\n";
   for (typename map_t::value_type t : tagMap) {
-    size_t i = t.second;
+    const mr3d_profiling::ZoneStats stats = GetStats(t.second);
     out.width((std::streamsize)Instance().maxTagLength_);
     out.setf(std::ios::left, std::ios::adjustfield);
     out << t.first << "\t";
     out.width(7);
 
     out.setf(std::ios::right, std::ios::adjustfield);
-    out << GetNumSamples(i) << "\t";
-    if (GetNumSamples(i) > 0) {
-      out << SecondsToTimeString(GetTotalSeconds(i)) << "\t";
-      double meansec = GetMeanSeconds(i);
-      double stddev = sqrt(GetVarianceSeconds(i));
-      out << "(" << SecondsToTimeString(meansec) << " +- ";
-      out << SecondsToTimeString(stddev) << ")\t";
-
-      double minsec = GetMinSeconds(i);
-      double maxsec = GetMaxSeconds(i);
-
-      // The min or max are out of bounds.
-      out << "[" << SecondsToTimeString(minsec) << ","
-          << SecondsToTimeString(maxsec) << "]";
+    out << stats.count << "\t";
+    if (stats.count > 0) {
+      out << SecondsToTimeString(stats.sum_ns * kNumSecondsPerNanosecond)
+          << "\t";
+      out << "(" << SecondsToTimeString(stats.meanSec()) << " +- ";
+      out << SecondsToTimeString(stats.stdDevSec()) << ")\t";
+
+      out << "[" << SecondsToTimeString(stats.minSec()) << ","
+          << SecondsToTimeString(stats.maxSec()) << "]";
     }
     out << std::endl;
   }
@@ -214,8 +214,14 @@ std::string Timing::Print() {
 }
 
 void Timing::Reset() {
+  const map_t tagMap = GetTimers();
+  std::map<size_t, mr3d_profiling::ZoneStats> resetStats;
+  for (typename map_t::value_type t : tagMap) {
+    mr3d_profiling::Profiler::instance().getStats(static_cast<int>(t.second),
+                                                  resetStats[t.second]);
+  }
   std::lock_guard<std::mutex> lock(Instance().mutex_);
-  Instance().tagMap_.clear();
+  Instance().resetStats_.swap(resetStats);
 }
 
 }  // namespace timing
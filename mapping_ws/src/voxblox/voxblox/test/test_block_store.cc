@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include "voxblox/core/block_store.h"
+#include "voxblox/core/layer.h"
+#include "voxblox/core/voxel.h"
+#include "voxblox/io/layer_io.h"
+#include "voxblox/test/layer_test_utils.h"
+
+using namespace voxblox;  // NOLINT
+
+class BlockStoreTest : public ::testing::Test,
+                       public voxblox::test::LayerTest<TsdfVoxel> {
+ protected:
+  virtual void SetUp() {
+    layer_.reset(new Layer<TsdfVoxel>(voxel_size_, voxels_per_side_));
+    voxblox::test::SetUpTestLayer(kBlockVolumeDiameter, layer_.get());
+    block_store_.reset(new BlockStore<TsdfVoxel>("block_store_test"));
+  }
+
+  Layer<TsdfVoxel>::Ptr layer_;
+  BlockStore<TsdfVoxel>::Ptr block_store_;
+
+  const double voxel_size_ = 0.02;
+  const size_t voxels_per_side_ = 16u;
+
+  static constexpr size_t kBlockVolumeDiameter = 10u;
+};
+
+TEST_F(BlockStoreTest, EvictAndLoadAllBlocks) {
+  const Layer<TsdfVoxel> original_layer(*layer_);
+  const size_t num_blocks = layer_->getNumberOfAllocatedBlocks();
+
+  const Point far_away(100.0, 0.0, 0.0);
+  EXPECT_EQ(block_store_->evictDistantBlocks(far_away, 1.0, layer_.get()),
+            num_blocks);
+  EXPECT_EQ(layer_->getNumberOfAllocatedBlocks(), 0u);
+  EXPECT_EQ(block_store_->getNumberOfStoredBlocks(), num_blocks);
+
+  EXPECT_EQ(
+      block_store_->loadBlocksInRadius(Point::Zero(), 100.0, layer_.get()),
+      num_blocks);
+  EXPECT_EQ(block_store_->getNumberOfStoredBlocks(), 0u);
+  CompareLayers(original_layer, *layer_);
+}
+
+TEST_F(BlockStoreTest, EvictDistantBlocks) {
+  const size_t num_blocks = layer_->getNumberOfAllocatedBlocks();
+  const FloatingPoint max_distance = 1.0;
+  block_store_->evictDistantBlocks(Point::Zero(), max_distance, layer_.get());
+
+  EXPECT_GT(layer_->getNumberOfAllocatedBlocks(), 0u);
+  EXPECT_GT(block_store_->getNumberOfStoredBlocks(), 0u);
+  EXPECT_EQ(layer_->getNumberOfAllocatedBlocks() +
+                block_store_->getNumberOfStoredBlocks(),
+            num_blocks);
+
+  BlockIndexList blocks;
+  layer_->getAllAllocatedBlocks(&blocks);
+  for (const BlockIndex& index : blocks) {
+    EXPECT_LE(layer_->getBlockByIndex(index).origin().norm(), max_distance);
+    EXPECT_FALSE(block_store_->hasBlock(index));
+  }
+
+  // Nothing else is stored within the distance.
+  EXPECT_EQ(block_store_->loadBlocksInRadius(Point::Zero(), max_distance,
+                                             layer_.get()),
+            0u);
+}
+
+TEST_F(BlockStoreTest, SaveLayerWithStoredBlocks) {
+  const Layer<TsdfVoxel> original_layer(*layer_);
+  block_store_->evictDistantBlocks(Point::Zero(), 1.0, layer_.get());
+
+  const std::string file = "block_store_test.tsdf.voxblox";
+  ASSERT_TRUE(block_store_->saveLayerToFile(*layer_, file));
+
+  Layer<TsdfVoxel>::Ptr layer_from_file;
+  ASSERT_TRUE(io::LoadLayer<TsdfVoxel>(file, &layer_from_file));
+  CompareLayers(original_layer, *layer_from_file);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  google::InitGoogleLogging(argv[0]);
+
+  int result = RUN_ALL_TESTS();
+
+  return result;
+}
@@ -0,0 +1,178 @@
+#include <cmath>
+
+#include <gtest/gtest.h>
+
+#include "voxblox/core/layer.h"
+#include "voxblox/core/voxel.h"
+#include "voxblox/integrator/device_tsdf_integrator.h"
+#include "voxblox/integrator/tsdf_integrator.h"
+
+using namespace voxblox;  // NOLINT
+
+class DeviceTsdfIntegratorTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    config_.default_truncation_distance = 4 * voxel_size_;
+    config_.max_ray_length_m = 10.0;
+    config_.use_const_weight = true;
+    config_.integrator_threads = 2;
+
+    simple_layer_.reset(new Layer<TsdfVoxel>(voxel_size_, voxels_per_side_));
+    device_layer_.reset(new Layer<TsdfVoxel>(voxel_size_, voxels_per_side_));
+  }
+
+  /// Simulates a scan of the wall x = wall_x_, angle_step apart.
+  void getWallScan(double angle_step, Pointcloud* points_C,
+                   Colors* colors) const {
+    for (double yaw = -0.5; yaw <= 0.5; yaw += angle_step) {
+      for (double pitch = -0.3; pitch <= 0.3; pitch += angle_step) {
+        const Point direction(std::cos(pitch) * std::cos(yaw),
+                              std::cos(pitch) * std::sin(yaw),
+                              std::sin(pitch));
+        points_C->push_back(direction * (wall_x_ / direction.x()));
+        colors->push_back(Color(200, 100, 50));
+      }
+    }
+  }
+
+  void integrate(const Pointcloud& points_C, const Colors& colors) {
+    TsdfIntegratorBase::Config simple_config = config_;
+    // Integrate the rays in order, like the device integrator sums them up.
+    simple_config.integrator_threads = 1;
+    SimpleTsdfIntegrator simple_integrator(simple_config,
+                                           simple_layer_.get());
+    simple_integrator.integratePointCloud(T_G_C_, points_C, colors);
+
+    DeviceTsdfIntegrator device_integrator(config_, device_layer_.get());
+    EXPECT_FALSE(device_integrator.isUsingCuda());
+    device_integrator.integratePointCloud(T_G_C_, points_C, colors);
+  }
+
+  /**
+   * Compares the observed voxels of the two layers, returns the number of
+   * voxels with a distance further than distance_tolerance apart.
+   */
+  size_t compareLayers(FloatingPoint distance_tolerance) const {
+    EXPECT_EQ(simple_layer_->getNumberOfAllocatedBlocks(),
+              device_layer_->getNumberOfAllocatedBlocks());
+
+    BlockIndexList blocks;
+    simple_layer_->getAllAllocatedBlocks(&blocks);
+    size_t num_different_voxels = 0u;
+    for (const BlockIndex& block_idx : blocks) {
+      const Block<TsdfVoxel>& simple_block =
+          simple_layer_->getBlockByIndex(block_idx);
+      Block<TsdfVoxel>::ConstPtr device_block =
+          device_layer_->getBlockPtrByIndex(block_idx);
+      EXPECT_TRUE(device_block != nullptr);
+      if (!device_block) {
+        continue;
+      }
+      EXPECT_TRUE(device_block->updated().any());
+
+      for (size_t i = 0u; i < simple_block.num_voxels(); ++i) {
+        const TsdfVoxel& simple_voxel = simple_block.getVoxelByLinearIndex(i);
+        const TsdfVoxel& device_voxel = device_block->getVoxelByLinearIndex(i);
+        // Only the rounding of the sums differs.
+        EXPECT_NEAR(simple_voxel.weight, device_voxel.weight,
+                    1e-4 * simple_voxel.weight);
+        if (simple_voxel.weight > 0.0f &&
+            std::abs(simple_voxel.distance - device_voxel.distance) >
+                distance_tolerance) {
+          ++num_different_voxels;
+        }
+      }
+    }
+    return num_different_voxels;
+  }
+
+  TsdfIntegratorBase::Config config_;
+  std::unique_ptr<Layer<TsdfVoxel>> simple_layer_;
+  std::unique_ptr<Layer<TsdfVoxel>> device_layer_;
+
+  const Transformation T_G_C_ =
+      Transformation(Point(0.12, -0.31, 0.05), Quaternion::Identity());
+  const FloatingPoint voxel_size_ = 0.05;
+  const size_t voxels_per_side_ = 16u;
+  const FloatingPoint wall_x_ = 2.0;
+};
+
+TEST_F(DeviceTsdfIntegratorTest, SameAsSimpleWithoutOverlappingRays) {
+  // Without carving the rays only update the truncation band around their
+  // point, far enough apart no voxel is traversed by two rays.
+  config_.voxel_carving_enabled = false;
+  Pointcloud points_C;
+  Colors colors;
+  getWallScan(0.1, &points_C, &colors);
+  integrate(points_C, colors);
+
+  EXPECT_GT(device_layer_->getNumberOfAllocatedBlocks(), 0u);
+  EXPECT_EQ(compareLayers(1e-5), 0u);
+
+  // The colors are blended the same way.
+  const Point surface(wall_x_ + 0.5 * voxel_size_, T_G_C_.getPosition().y(),
+                      T_G_C_.getPosition().z());
+  Block<TsdfVoxel>::ConstPtr block =
+      device_layer_->getBlockPtrByCoordinates(surface);
+  ASSERT_TRUE(block != nullptr);
+  const TsdfVoxel& voxel = block->getVoxelByCoordinates(surface);
+  EXPECT_GT(voxel.weight, 0.0f);
+  EXPECT_EQ(voxel.color.r, 200);
+  EXPECT_EQ(voxel.color.g, 100);
+  EXPECT_EQ(voxel.color.b, 50);
+}
+
+TEST_F(DeviceTsdfIntegratorTest, CloseToSimpleWithCarving) {
+  Pointcloud points_C;
+  Colors colors;
+  getWallScan(0.005, &points_C, &colors);
+  // Integrate two scans, the second one into the allocated blocks.
+  integrate(points_C, colors);
+  integrate(points_C, colors);
+
+  // The voxels traversed by many rays only differ where the sequential merge
+  // clamps the distance to the truncation distance in between.
+  BlockIndexList blocks;
+  device_layer_->getAllAllocatedBlocks(&blocks);
+  const size_t num_voxels = blocks.size() * voxels_per_side_ *
+                            voxels_per_side_ * voxels_per_side_;
+  EXPECT_LT(compareLayers(1e-4), num_voxels / 100u);
+  EXPECT_EQ(compareLayers(config_.default_truncation_distance), 0u);
+}
+
+TEST_F(DeviceTsdfIntegratorTest, ClearingRays) {
+  Pointcloud points_C;
+  Colors colors;
+  getWallScan(0.05, &points_C, &colors);
+  // Beyond max_ray_length_m, the rays only clear the space in front of them.
+  config_.max_ray_length_m = 1.5;
+  integrate(points_C, colors);
+
+  EXPECT_EQ(compareLayers(1e-4), 0u);
+  const Point free_space(1.0, T_G_C_.getPosition().y(),
+                         T_G_C_.getPosition().z());
+  Block<TsdfVoxel>::ConstPtr block =
+      device_layer_->getBlockPtrByCoordinates(free_space);
+  ASSERT_TRUE(block != nullptr);
+  const TsdfVoxel& voxel = block->getVoxelByCoordinates(free_space);
+  EXPECT_GT(voxel.weight, 0.0f);
+  EXPECT_NEAR(voxel.distance, config_.default_truncation_distance, 1e-6);
+  EXPECT_TRUE(device_layer_->getBlockPtrByCoordinates(
+                  Point(wall_x_, 0.0, 0.0)) == nullptr);
+}
+
+TEST_F(DeviceTsdfIntegratorTest, Factory) {
+  TsdfIntegratorBase::Ptr integrator = TsdfIntegratorFactory::create(
+      "device", config_, device_layer_.get());
+  EXPECT_TRUE(dynamic_cast<DeviceTsdfIntegrator*>(integrator.get()) !=
+              nullptr);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  google::InitGoogleLogging(argv[0]);
+
+  int result = RUN_ALL_TESTS();
+
+  return result;
+}
@@ -0,0 +1,126 @@
+#include <cmath>
+
+#include <gtest/gtest.h>
+
+#include "voxblox/core/layer.h"
+#include "voxblox/core/voxel.h"
+#include "voxblox/mesh/mesh_integrator.h"
+#include "voxblox/mesh/mesh_layer.h"
+#include "voxblox/mesh/mesh_utils.h"
+
+using namespace voxblox;  // NOLINT
+
+class MeshLodTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    tsdf_layer_.reset(new Layer<TsdfVoxel>(voxel_size_, voxels_per_side_));
+    mesh_layer_.reset(new MeshLayer(tsdf_layer_->block_size()));
+
+    // A plane at z = plane_z_ through a 2x2x1 blocks map.
+    for (IndexElement x = 0; x < 2; ++x) {
+      for (IndexElement y = 0; y < 2; ++y) {
+        Block<TsdfVoxel>::Ptr block =
+            tsdf_layer_->allocateBlockPtrByIndex(BlockIndex(x, y, 0));
+        for (size_t i = 0u; i < block->num_voxels(); ++i) {
+          TsdfVoxel& voxel = block->getVoxelByLinearIndex(i);
+          const Point position =
+              block->computeCoordinatesFromLinearIndex(i);
+          voxel.distance = position.z() - plane_z_;
+          voxel.weight = 1.0;
+          voxel.color = Color(10, 20, 30);
+        }
+        block->has_data() = true;
+        block->updated().set();
+      }
+    }
+  }
+
+  const FloatingPoint voxel_size_ = 0.1;
+  const size_t voxels_per_side_ = 8u;
+  const FloatingPoint plane_z_ = 0.33;
+
+  std::unique_ptr<Layer<TsdfVoxel>> tsdf_layer_;
+  std::unique_ptr<MeshLayer> mesh_layer_;
+};
+
+TEST_F(MeshLodTest, ClusteredMeshMergesCells) {
+  // Two triangles sharing an edge, the second one has two vertices in the
+  // same cell, plus a duplicate of the first one.
+  Mesh mesh(1.0, Point::Zero());
+  mesh.vertices = {Point(0.1, 0.1, 0.0), Point(1.1, 0.1, 0.0),
+                   Point(0.1, 1.1, 0.0), Point(0.2, 0.2, 0.0),
+                   Point(1.1, 0.1, 0.0), Point(0.1, 1.1, 0.0),
+                   Point(1.1, 0.1, 0.0), Point(0.1, 1.1, 0.0),
+                   Point(0.1, 0.1, 0.0)};
+  mesh.indices = {0, 1, 2, 3, 4, 0, 6, 7, 8};
+  mesh.normals.resize(mesh.vertices.size(), Point(0.0, 0.0, 2.0));
+  mesh.colors = {Color(0, 0, 0),       Color(50, 50, 50),
+                 Color(50, 50, 50),    Color(100, 100, 100),
+                 Color(50, 50, 50),    Color(50, 50, 50),
+                 Color(50, 50, 50),    Color(50, 50, 50),
+                 Color(0, 0, 0)};
+
+  Mesh clustered_mesh;
+  createClusteredMesh(mesh, 1.0, &clustered_mesh);
+
+  ASSERT_EQ(clustered_mesh.vertices.size(), 3u);
+  ASSERT_EQ(clustered_mesh.colors.size(), 3u);
+  ASSERT_EQ(clustered_mesh.normals.size(), 3u);
+  // The collapsed triangle and the duplicate are removed.
+  ASSERT_EQ(clustered_mesh.indices.size(), 3u);
+
+  // The first cluster holds vertices 0, 3 and 8.
+  EXPECT_TRUE(
+      clustered_mesh.vertices[0].isApprox(Point(0.4 / 3.0, 0.4 / 3.0, 0.0)));
+  EXPECT_EQ(clustered_mesh.colors[0].r, 33);
+  EXPECT_TRUE(clustered_mesh.normals[0].isApprox(Point(0.0, 0.0, 1.0)));
+  EXPECT_EQ(clustered_mesh.indices[0], 0u);
+  EXPECT_EQ(clustered_mesh.indices[1], 1u);
+  EXPECT_EQ(clustered_mesh.indices[2], 2u);
+}
+
+TEST_F(MeshLodTest, IntegratorGeneratesLods) {
+  MeshIntegratorConfig config;
+  // Only 3 levels fit in a block of 8 voxels.
+  config.num_lods = 5;
+  MeshIntegrator<TsdfVoxel> mesh_integrator(config, tsdf_layer_.get(),
+                                            mesh_layer_.get());
+  mesh_integrator.generateMesh(false, true);
+
+  BlockIndexList mesh_indices;
+  mesh_layer_->getAllAllocatedMeshes(&mesh_indices);
+  ASSERT_EQ(mesh_indices.size(), 4u);
+  for (const BlockIndex& block_index : mesh_indices) {
+    Mesh::ConstPtr mesh = mesh_layer_->getMeshPtrByIndex(block_index);
+    ASSERT_TRUE(mesh->hasTriangles());
+    ASSERT_EQ(mesh->lods.size(), 3u);
+
+    // The coarsest level can have a single vertex in a corner block.
+    EXPECT_TRUE(mesh->lods.front()->hasTriangles());
+    size_t num_vertices = mesh->vertices.size();
+    for (const Mesh::Ptr& lod : mesh->lods) {
+      EXPECT_LT(lod->vertices.size(), num_vertices);
+      EXPECT_EQ(lod->colors.size(), lod->vertices.size());
+      num_vertices = lod->vertices.size();
+
+      // Clustering keeps the vertices of a plane on the plane.
+      for (size_t i = 0u; i < lod->vertices.size(); ++i) {
+        EXPECT_NEAR(lod->vertices[i].z(), plane_z_, 1e-5);
+        EXPECT_NEAR(std::abs(lod->normals[i].z()), 1.0, 1e-5);
+        EXPECT_EQ(lod->colors[i].g, 20);
+      }
+      for (const VertexIndex index : lod->indices) {
+        EXPECT_LT(index, lod->vertices.size());
+      }
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  google::InitGoogleLogging(argv[0]);
+
+  int result = RUN_ALL_TESTS();
+
+  return result;
+}
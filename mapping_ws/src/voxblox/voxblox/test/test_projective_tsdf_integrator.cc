@@ -0,0 +1,122 @@
+#include <cmath>
+
+#include <gtest/gtest.h>
+
+#include "voxblox/core/layer.h"
+#include "voxblox/core/voxel.h"
+#include "voxblox/integrator/projective_tsdf_integrator.h"
+
+using namespace voxblox;  // NOLINT
+
+class ProjectiveTsdfIntegratorTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    config_.default_truncation_distance = 4 * voxel_size_;
+    config_.max_ray_length_m = 10.0;
+    config_.use_const_weight = true;
+    config_.integrator_threads = 2;
+    config_.sensor_horizontal_resolution = 720;
+    config_.sensor_vertical_resolution = 32;
+    config_.sensor_vertical_field_of_view_degrees = 30.0;
+
+    layer_.reset(new Layer<TsdfVoxel>(voxel_size_, voxels_per_side_));
+  }
+
+  /// Simulates a scan of the wall x = wall_x_.
+  void getWallScan(Pointcloud* points_C, Colors* colors) const {
+    const int num_cols = config_.sensor_horizontal_resolution;
+    const int num_rows = config_.sensor_vertical_resolution;
+    const double fov = config_.sensor_vertical_field_of_view_degrees * M_PI /
+                       180.0;
+    for (int row = 0; row < num_rows; ++row) {
+      const double vertical_angle = 0.5 * fov - row * fov / (num_rows - 1);
+      for (int col = 0; col < num_cols; ++col) {
+        const double horizontal_angle = col * 2.0 * M_PI / num_cols - M_PI;
+        const Point direction(
+            std::cos(vertical_angle) * std::cos(horizontal_angle),
+            std::cos(vertical_angle) * std::sin(horizontal_angle),
+            std::sin(vertical_angle));
+        if (direction.x() < 1e-3) {
+          continue;
+        }
+        const FloatingPoint range = wall_x_ / direction.x();
+        if (range < config_.max_ray_length_m) {
+          points_C->push_back(direction * range);
+          colors->push_back(Color::Gray());
+        }
+      }
+    }
+  }
+
+  const TsdfVoxel* getVoxel(const Point& point) const {
+    Block<TsdfVoxel>::ConstPtr block = layer_->getBlockPtrByCoordinates(point);
+    if (!block) {
+      return nullptr;
+    }
+    return block->getVoxelPtrByCoordinates(point);
+  }
+
+  TsdfIntegratorBase::Config config_;
+  std::unique_ptr<Layer<TsdfVoxel>> layer_;
+
+  const FloatingPoint voxel_size_ = 0.05;
+  const size_t voxels_per_side_ = 16u;
+  const FloatingPoint wall_x_ = 2.0;
+};
+
+TEST_F(ProjectiveTsdfIntegratorTest, IntegrateWall) {
+  Pointcloud points_C;
+  Colors colors;
+  getWallScan(&points_C, &colors);
+  ASSERT_FALSE(points_C.empty());
+
+  ProjectiveTsdfIntegrator integrator(config_, layer_.get());
+  integrator.integratePointCloud(Transformation(), points_C, colors);
+  EXPECT_GT(layer_->getNumberOfAllocatedBlocks(), 0u);
+
+  const FloatingPoint truncation_distance = config_.default_truncation_distance;
+  const FloatingPoint half_voxel = 0.5 * voxel_size_;
+
+  // Voxels in front of the wall.
+  const Point in_front(wall_x_ - 3 * half_voxel, half_voxel, half_voxel);
+  const TsdfVoxel* voxel = getVoxel(in_front);
+  ASSERT_TRUE(voxel != nullptr);
+  EXPECT_GT(voxel->weight, 0.0f);
+  EXPECT_NEAR(voxel->distance, 3 * half_voxel, voxel_size_);
+
+  const Point free_space(1.0 + half_voxel, half_voxel, half_voxel);
+  voxel = getVoxel(free_space);
+  ASSERT_TRUE(voxel != nullptr);
+  EXPECT_GT(voxel->weight, 0.0f);
+  EXPECT_NEAR(voxel->distance, truncation_distance, 1e-4);
+
+  // Voxels behind the wall, within and beyond the truncation distance.
+  const Point behind(wall_x_ + 3 * half_voxel, half_voxel, half_voxel);
+  voxel = getVoxel(behind);
+  ASSERT_TRUE(voxel != nullptr);
+  EXPECT_GT(voxel->weight, 0.0f);
+  EXPECT_NEAR(voxel->distance, -3 * half_voxel, voxel_size_);
+
+  const Point occluded(wall_x_ + 2 * truncation_distance, half_voxel,
+                       half_voxel);
+  voxel = getVoxel(occluded);
+  if (voxel != nullptr) {
+    EXPECT_EQ(voxel->weight, 0.0f);
+  }
+
+  // Nothing is integrated outside of the vertical field of view.
+  const Point above(wall_x_ - 3 * half_voxel, half_voxel, 1.5);
+  voxel = getVoxel(above);
+  if (voxel != nullptr) {
+    EXPECT_EQ(voxel->weight, 0.0f);
+  }
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  google::InitGoogleLogging(argv[0]);
+
+  int result = RUN_ALL_TESTS();
+
+  return result;
+}
@@ -180,6 +180,42 @@ TEST_P(SdfIntegratorsTest, TsdfIntegrators) {
   io::SaveLayer(merged_layer, "tsdf_fast_test.voxblox", true);
 }
 
+TEST_P(SdfIntegratorsTest, MultiThreadedBlockAllocation) {
+  TsdfIntegratorBase::Config config;
+  config.default_truncation_distance = truncation_distance_;
+
+  // All the blocks are new in the first frames: the threads allocate them
+  // concurrently in the temporary block shards.
+  config.integrator_threads = 8;
+  Layer<TsdfVoxel> multi_thread_layer(voxel_size_, voxels_per_side_);
+  SimpleTsdfIntegrator multi_thread_integrator(config, &multi_thread_layer);
+  config.integrator_threads = 1;
+  Layer<TsdfVoxel> reference_layer(voxel_size_, voxels_per_side_);
+  SimpleTsdfIntegrator reference_integrator(config, &reference_layer);
+
+  constexpr size_t kNumFrames = 3u;
+  for (size_t i = 0; i < kNumFrames; i++) {
+    Pointcloud ptcloud, ptcloud_C;
+    Colors colors;
+
+    world_.getPointcloudFromTransform(poses_[i], depth_camera_resolution_,
+                                      fov_h_rad_, max_dist_, &ptcloud, &colors);
+    transformPointcloud(poses_[i].inverse(), ptcloud, &ptcloud_C);
+    multi_thread_integrator.integratePointCloud(poses_[i], ptcloud_C, colors);
+    reference_integrator.integratePointCloud(poses_[i], ptcloud_C, colors);
+  }
+
+  EXPECT_GT(reference_layer.getNumberOfAllocatedBlocks(), 0u);
+  EXPECT_EQ(multi_thread_layer.getNumberOfAllocatedBlocks(),
+            reference_layer.getNumberOfAllocatedBlocks());
+
+  BlockIndexList blocks;
+  reference_layer.getAllAllocatedBlocks(&blocks);
+  for (const BlockIndex& index : blocks) {
+    EXPECT_TRUE(multi_thread_layer.hasBlock(index));
+  }
+}
+
 TEST_P(SdfIntegratorsTest, EsdfIntegrators) {
   // TSDF layer + integrator
   TsdfIntegratorBase::Config config;
@@ -283,6 +319,90 @@ TEST_P(SdfIntegratorsTest, EsdfIntegrators) {
   io::SaveLayer(*esdf_gt_, "esdf_gt.voxblox", false);
 }
 
+TEST_P(SdfIntegratorsTest, EsdfIntegratorsParallel) {
+  // TSDF layer + integrator
+  TsdfIntegratorBase::Config config;
+  config.default_truncation_distance = truncation_distance_;
+  config.integrator_threads = 1;
+  Layer<TsdfVoxel> tsdf_layer(voxel_size_, voxels_per_side_);
+  MergedTsdfIntegrator tsdf_integrator(config, &tsdf_layer);
+
+  // ESDF layers, sequential and parallel.
+  Layer<EsdfVoxel> incremental_layer(voxel_size_, voxels_per_side_);
+  Layer<EsdfVoxel> incremental_parallel_layer(voxel_size_, voxels_per_side_);
+  Layer<EsdfVoxel> batch_layer(voxel_size_, voxels_per_side_);
+  Layer<EsdfVoxel> batch_parallel_layer(voxel_size_, voxels_per_side_);
+
+  EsdfIntegrator::Config esdf_config;
+  esdf_config.max_distance_m = esdf_max_distance_;
+  esdf_config.default_distance_m = esdf_max_distance_;
+  esdf_config.min_distance_m = truncation_distance_ / 2.0;
+  esdf_config.min_diff_m = 0.0;
+  esdf_config.full_euclidean_distance = false;
+  esdf_config.add_occupied_crust = false;
+  esdf_config.multi_queue = true;
+  EsdfIntegrator incremental_integrator(esdf_config, &tsdf_layer,
+                                        &incremental_layer);
+  EsdfIntegrator batch_integrator(esdf_config, &tsdf_layer, &batch_layer);
+  esdf_config.integrator_threads = 4;
+  EsdfIntegrator incremental_parallel_integrator(esdf_config, &tsdf_layer,
+                                                 &incremental_parallel_layer);
+  EsdfIntegrator batch_parallel_integrator(esdf_config, &tsdf_layer,
+                                           &batch_parallel_layer);
+
+  for (size_t i = 0; i < poses_.size(); i++) {
+    Pointcloud ptcloud, ptcloud_C;
+    Colors colors;
+
+    world_.getPointcloudFromTransform(poses_[i], depth_camera_resolution_,
+                                      fov_h_rad_, max_dist_, &ptcloud, &colors);
+    transformPointcloud(poses_[i].inverse(), ptcloud, &ptcloud_C);
+    tsdf_integrator.integratePointCloud(poses_[i], ptcloud_C, colors);
+
+    // Both incremental integrators see the same updated blocks.
+    incremental_integrator.updateFromTsdfLayer(false);
+    constexpr bool clear_updated_flag = true;
+    incremental_parallel_integrator.updateFromTsdfLayer(clear_updated_flag);
+  }
+
+  batch_integrator.updateFromTsdfLayerBatch();
+  batch_parallel_integrator.updateFromTsdfLayerBatch();
+
+  utils::VoxelEvaluationDetails batch_result, batch_parallel_result,
+      incremental_result, incremental_parallel_result;
+  utils::evaluateLayersRmse(*esdf_gt_, batch_layer,
+                            utils::VoxelEvaluationMode::kEvaluateAllVoxels,
+                            &batch_result);
+  utils::evaluateLayersRmse(*esdf_gt_, batch_parallel_layer,
+                            utils::VoxelEvaluationMode::kEvaluateAllVoxels,
+                            &batch_parallel_result);
+  utils::evaluateLayersRmse(*esdf_gt_, incremental_layer,
+                            utils::VoxelEvaluationMode::kEvaluateAllVoxels,
+                            &incremental_result);
+  utils::evaluateLayersRmse(*esdf_gt_, incremental_parallel_layer,
+                            utils::VoxelEvaluationMode::kEvaluateAllVoxels,
+                            &incremental_parallel_result);
+  std::cout << "Batch Parallel Integrator: "
+            << batch_parallel_result.toString();
+  std::cout << "Incremental Parallel Integrator: "
+            << incremental_parallel_result.toString();
+
+  // The processing order differs, the results are as accurate as the
+  // sequential ones.
+  constexpr FloatingPoint kKindaSimilar = 1e-2;
+  EXPECT_EQ(batch_result.num_overlapping_voxels,
+            batch_parallel_result.num_overlapping_voxels);
+  EXPECT_EQ(incremental_result.num_overlapping_voxels,
+            incremental_parallel_result.num_overlapping_voxels);
+  EXPECT_NEAR(batch_result.rmse, batch_parallel_result.rmse, kKindaSimilar);
+  EXPECT_NEAR(incremental_result.rmse, incremental_parallel_result.rmse,
+              kKindaSimilar);
+  EXPECT_LE(batch_parallel_result.max_error,
+            batch_result.max_error + voxel_size_);
+  EXPECT_LE(incremental_parallel_result.max_error,
+            incremental_result.max_error + voxel_size_);
+}
+
 INSTANTIATE_TEST_CASE_P(VoxelSizes, SdfIntegratorsTest,
                         ::testing::Values(0.1f, 0.2f, 0.3f, 0.4f, 0.5f));
 
@@ -150,6 +150,14 @@ void serializeLayerAsMsg(
     voxblox_msgs::Layer* msg,
     const MapDerializationAction& action = MapDerializationAction::kUpdate);
 
+/**
+ * Clears the map updated flag of all the blocks of the layer. Call it after
+ * the layer has been published with serializeLayerAsMsg(), so that the next
+ * message with only_updated set carries only the blocks updated in between.
+ */
+template <typename VoxelType>
+void clearLayerMapUpdatedFlags(Layer<VoxelType>* layer);
+
 /**
  * Returns true if could parse the data into the existing layer (all parameters
  * are compatible), false otherwise.
@@ -39,6 +39,16 @@ void serializeLayerAsMsg(const Layer<VoxelType>& layer, const bool only_updated,
   }
 }  // namespace voxblox
 
+template <typename VoxelType>
+void clearLayerMapUpdatedFlags(Layer<VoxelType>* layer) {
+  CHECK_NOTNULL(layer);
+  BlockIndexList block_list;
+  layer->getAllUpdatedBlocks(Update::kMap, &block_list);
+  for (const BlockIndex& index : block_list) {
+    layer->getBlockByIndex(index).updated().reset(Update::kMap);
+  }
+}
+
 template <typename VoxelType>
 bool deserializeMsgToLayer(const voxblox_msgs::Layer& msg,
                            Layer<VoxelType>* layer) {
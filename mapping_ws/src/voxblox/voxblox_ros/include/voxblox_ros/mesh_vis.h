@@ -150,8 +150,82 @@ inline std_msgs::ColorRGBA getVertexColor(const Mesh::ConstPtr& mesh,
   return color_msg;
 }
 
+/**
+ * Converts a vertex from an absolute global frame to a normalized local frame.
+ * Each vertex is given as its distance from the blocks origin in units of
+ * (2*block_size). This results in all points obtaining a value in the range 0
+ * to 1. To enforce this 0 to 1 range we technically only need to divide by
+ * (block_size + voxel_size). The + voxel_size comes from the way marching
+ * cubes allows the mesh to interpolate between this and a neighboring block.
+ * We instead divide by (block_size + block_size) as the mesh layer has no
+ * knowledge of how many voxels are inside a block.
+ */
+inline void quantizeMeshVertex(const Point& vertex,
+                               const BlockIndex& block_index,
+                               FloatingPoint block_size_inv, uint16_t* x,
+                               uint16_t* y, uint16_t* z) {
+  const Point normalized_verticies =
+      0.5f * (block_size_inv * vertex - block_index.cast<FloatingPoint>());
+
+  // check all points are in range [0, 1.0]
+  CHECK_LE(normalized_verticies.squaredNorm(), 1.0f);
+  CHECK((normalized_verticies.array() >= 0.0).all());
+
+  // convert to uint16_t fixed point representation
+  *x = std::numeric_limits<uint16_t>::max() * normalized_verticies.x();
+  *y = std::numeric_limits<uint16_t>::max() * normalized_verticies.y();
+  *z = std::numeric_limits<uint16_t>::max() * normalized_verticies.z();
+}
+
+/**
+ * Fills the message of a level of detail of a block mesh, returns false if the
+ * level has too many vertices for 16 bit indices.
+ */
+inline bool generateMeshLodMsg(const Mesh::ConstPtr& lod,
+                               const BlockIndex& block_index,
+                               FloatingPoint block_size_inv,
+                               ColorMode color_mode, uint8_t level,
+                               voxblox_msgs::MeshLod* lod_msg) {
+  CHECK_NOTNULL(lod_msg);
+  if (lod->vertices.size() > std::numeric_limits<uint16_t>::max()) {
+    return false;
+  }
+  lod_msg->level = level;
+
+  const size_t num_vertices = lod->vertices.size();
+  lod_msg->x.resize(num_vertices);
+  lod_msg->y.resize(num_vertices);
+  lod_msg->z.resize(num_vertices);
+  // normal coloring is used by RViz plugin by default, so no need to send it
+  if (color_mode != kNormals) {
+    lod_msg->r.resize(num_vertices);
+    lod_msg->g.resize(num_vertices);
+    lod_msg->b.resize(num_vertices);
+  }
+  for (size_t i = 0u; i < num_vertices; ++i) {
+    quantizeMeshVertex(lod->vertices[i], block_index, block_size_inv,
+                       &lod_msg->x[i], &lod_msg->y[i], &lod_msg->z[i]);
+    if (color_mode != kNormals) {
+      const std_msgs::ColorRGBA color_msg = getVertexColor(lod, color_mode, i);
+      lod_msg->r[i] = std::numeric_limits<uint8_t>::max() * color_msg.r;
+      lod_msg->g[i] = std::numeric_limits<uint8_t>::max() * color_msg.g;
+      lod_msg->b[i] = std::numeric_limits<uint8_t>::max() * color_msg.b;
+    }
+  }
+
+  lod_msg->triangles.assign(lod->indices.begin(), lod->indices.end());
+  return true;
+}
+
+/**
+ * Fills the message with the updated meshes. The levels of detail of the
+ * meshes from min_lod on are added to the blocks, with min_lod > 0 the full
+ * resolution triangles (level 0) are left out and the clients have to render
+ * the levels of detail.
+ */
 inline void generateVoxbloxMeshMsg(MeshLayer* mesh_layer, ColorMode color_mode,
-                                   voxblox_msgs::Mesh* mesh_msg) {
+                                   voxblox_msgs::Mesh* mesh_msg,
+                                   int min_lod = 0) {
   CHECK_NOTNULL(mesh_msg);
   CHECK_NOTNULL(mesh_layer);
 
@@ -171,40 +245,29 @@ inline void generateVoxbloxMeshMsg(MeshLayer* mesh_layer, ColorMode color_mode,
     mesh_block.index[1] = block_index.y();
     mesh_block.index[2] = block_index.z();
 
-    mesh_block.x.reserve(mesh->vertices.size());
-    mesh_block.y.reserve(mesh->vertices.size());
-    mesh_block.z.reserve(mesh->vertices.size());
+    // Level 0 is the full resolution, level l > 0 is mesh->lods[l - 1]. The
+    // coarsest level is sent if min_lod is above it.
+    const int first_level =
+        std::min(std::max(min_lod, 0), static_cast<int>(mesh->lods.size()));
+    const size_t num_vertices = first_level == 0 ? mesh->vertices.size() : 0u;
+
+    mesh_block.x.reserve(num_vertices);
+    mesh_block.y.reserve(num_vertices);
+    mesh_block.z.reserve(num_vertices);
 
     // normal coloring is used by RViz plugin by default, so no need to send it
     if (color_mode != kNormals) {
-      mesh_block.r.reserve(mesh->vertices.size());
-      mesh_block.g.reserve(mesh->vertices.size());
-      mesh_block.b.reserve(mesh->vertices.size());
+      mesh_block.r.reserve(num_vertices);
+      mesh_block.g.reserve(num_vertices);
+      mesh_block.b.reserve(num_vertices);
     }
-    for (size_t i = 0u; i < mesh->vertices.size(); ++i) {
-      // We convert from an absolute global frame to a normalized local frame.
-      // Each vertex is given as its distance from the blocks origin in units of
-      // (2*block_size). This results in all points obtaining a value in the
-      // range 0 to 1. To enforce this 0 to 1 range we technically only need to
-      // divide by (block_size + voxel_size). The + voxel_size comes from the
-      // way marching cubes allows the mesh to interpolate between this and a
-      // neighboring block. We instead divide by (block_size + block_size) as
-      // the mesh layer has no knowledge of how many voxels are inside a block.
-      const Point normalized_verticies =
-          0.5f * (mesh_layer->block_size_inv() * mesh->vertices[i] -
-                  block_index.cast<FloatingPoint>());
-
-      // check all points are in range [0, 1.0]
-      CHECK_LE(normalized_verticies.squaredNorm(), 1.0f);
-      CHECK((normalized_verticies.array() >= 0.0).all());
-
-      // convert to uint16_t fixed point representation
-      mesh_block.x.push_back(std::numeric_limits<uint16_t>::max() *
-                             normalized_verticies.x());
-      mesh_block.y.push_back(std::numeric_limits<uint16_t>::max() *
-                             normalized_verticies.y());
-      mesh_block.z.push_back(std::numeric_limits<uint16_t>::max() *
-                             normalized_verticies.z());
+    for (size_t i = 0u; i < num_vertices; ++i) {
+      uint16_t x, y, z;
+      quantizeMeshVertex(mesh->vertices[i], block_index,
+                         mesh_layer->block_size_inv(), &x, &y, &z);
+      mesh_block.x.push_back(x);
+      mesh_block.y.push_back(y);
+      mesh_block.z.push_back(z);
 
       if (color_mode != kNormals) {
         const std_msgs::ColorRGBA color_msg =
@@ -218,6 +281,16 @@ inline void generateVoxbloxMeshMsg(MeshLayer* mesh_layer, ColorMode color_mode,
       }
     }
 
+    for (size_t level = std::max(first_level, 1); level <= mesh->lods.size();
+         ++level) {
+      voxblox_msgs::MeshLod lod_msg;
+      if (generateMeshLodMsg(mesh->lods[level - 1u], block_index,
+                             mesh_layer->block_size_inv(), color_mode, level,
+                             &lod_msg)) {
+        mesh_block.lods.push_back(lod_msg);
+      }
+    }
+
     mesh_msg->mesh_blocks.push_back(mesh_block);
 
     // delete empty mesh blocks after sending them
@@ -231,10 +304,11 @@ inline void generateVoxbloxMeshMsg(MeshLayer* mesh_layer, ColorMode color_mode,
 
 inline void generateVoxbloxMeshMsg(const MeshLayer::Ptr& mesh_layer,
                                    ColorMode color_mode,
-                                   voxblox_msgs::Mesh* mesh_msg) {
+                                   voxblox_msgs::Mesh* mesh_msg,
+                                   int min_lod = 0) {
   CHECK_NOTNULL(mesh_msg);
   CHECK(mesh_layer);
-  generateVoxbloxMeshMsg(mesh_layer.get(), color_mode, mesh_msg);
+  generateVoxbloxMeshMsg(mesh_layer.get(), color_mode, mesh_msg, min_lod);
 }
 
 inline void fillMarkerWithMesh(const MeshLayer::ConstPtr& mesh_layer,
@@ -52,6 +52,8 @@ inline ICP::Config getICPConfigFromRosParam(const ros::NodeHandle& nh_private) {
   nh_private.param("icp_inital_rotation_weighting",
                    icp_config.inital_rotation_weighting,
                    icp_config.inital_rotation_weighting);
+  nh_private.param("icp_time_budget_s", icp_config.time_budget_s,
+                   icp_config.time_budget_s);
 
   return icp_config;
 }
@@ -107,6 +109,15 @@ inline TsdfIntegratorBase::Config getTsdfIntegratorConfigFromRosParam(
   nh_private.param("integration_order_mode",
                    integrator_config.integration_order_mode,
                    integrator_config.integration_order_mode);
+  nh_private.param("sensor_horizontal_resolution",
+                   integrator_config.sensor_horizontal_resolution,
+                   integrator_config.sensor_horizontal_resolution);
+  nh_private.param("sensor_vertical_resolution",
+                   integrator_config.sensor_vertical_resolution,
+                   integrator_config.sensor_vertical_resolution);
+  nh_private.param("sensor_vertical_field_of_view_degrees",
+                   integrator_config.sensor_vertical_field_of_view_degrees,
+                   integrator_config.sensor_vertical_field_of_view_degrees);
 
   integrator_config.default_truncation_distance =
       static_cast<float>(truncation_distance);
@@ -157,6 +168,14 @@ inline EsdfIntegrator::Config getEsdfIntegratorConfigFromRosParam(
   nh_private.param("esdf_add_occupied_crust",
                    esdf_integrator_config.add_occupied_crust,
                    esdf_integrator_config.add_occupied_crust);
+  int esdf_integrator_threads =
+      static_cast<int>(esdf_integrator_config.integrator_threads);
+  nh_private.param("esdf_integrator_threads", esdf_integrator_threads,
+                   esdf_integrator_threads);
+  if (esdf_integrator_threads > 0) {
+    esdf_integrator_config.integrator_threads =
+        static_cast<size_t>(esdf_integrator_threads);
+  }
   if (esdf_integrator_config.default_distance_m <
       esdf_integrator_config.max_distance_m) {
     esdf_integrator_config.default_distance_m =
@@ -174,6 +193,8 @@ inline MeshIntegratorConfig getMeshIntegratorConfigFromRosParam(
                    mesh_integrator_config.min_weight);
   nh_private.param("mesh_use_color", mesh_integrator_config.use_color,
                    mesh_integrator_config.use_color);
+  nh_private.param("mesh_num_lods", mesh_integrator_config.num_lods,
+                   mesh_integrator_config.num_lods);
 
   return mesh_integrator_config;
 }
@@ -1,6 +1,7 @@
 #ifndef VOXBLOX_ROS_TSDF_SERVER_H_
 #define VOXBLOX_ROS_TSDF_SERVER_H_
 
+#include <future>
 #include <memory>
 #include <queue>
 #include <string>
@@ -17,7 +18,10 @@
 #include <visualization_msgs/MarkerArray.h>
 
 #include <voxblox/alignment/icp.h>
+#include <voxblox/core/block_store.h>
 #include <voxblox/core/tsdf_map.h>
+#include <voxblox/integrator/device_tsdf_integrator.h>
+#include <voxblox/integrator/projective_tsdf_integrator.h>
 #include <voxblox/integrator/tsdf_integrator.h>
 #include <voxblox/io/layer_io.h>
 #include <voxblox/io/mesh_ply.h>
@@ -33,6 +37,8 @@
 namespace voxblox {
 
 constexpr float kDefaultMaxIntensity = 100.0;
+/// Queue size of the layer topics (incremental messages must not be dropped).
+constexpr int kLayerMsgQueueSize = 10;
 
 class TsdfServer {
  public:
@@ -43,7 +49,10 @@ class TsdfServer {
              const TsdfMap::Config& config,
              const TsdfIntegratorBase::Config& integrator_config,
              const MeshIntegratorConfig& mesh_config);
-  virtual ~TsdfServer() {}
+  virtual ~TsdfServer() {
+    waitForBackgroundIcp();
+    waitForBackgroundMeshing();
+  }
 
   void getServerConfigFromRosParam(const ros::NodeHandle& nh_private);
 
@@ -72,6 +81,8 @@ class TsdfServer {
   virtual void updateMesh();
   /// Batch update.
   virtual bool generateMesh();
+  /// Publishes the mesh blocks updated since the last call.
+  void publishMesh();
   // Publishes all available pointclouds.
   virtual void publishPointclouds();
   // Publish mesh as pointcloud 
@@ -130,6 +141,60 @@ class TsdfServer {
       std::queue<sensor_msgs::PointCloud2::Ptr>* queue,
       sensor_msgs::PointCloud2::Ptr* pointcloud_msg, Transformation* T_G_C);
 
+  /// Pointcloud waiting for its background ICP alignment.
+  struct PendingIcpScan {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    Transformation T_G_C;
+    Pointcloud points_C;
+    Colors colors;
+    ros::Time stamp;
+    std::future<Transformation> T_G_C_refined;
+  };
+
+  /**
+   * Integrates a (freespace) pointcloud at the ICP refined pose, and keeps the
+   * map around the pose T_G_C of the sensor.
+   */
+  void integrateScan(const Transformation& T_G_C,
+                     const Transformation& T_G_C_refined,
+                     const Pointcloud& points_C, const Colors& colors,
+                     const bool is_freespace_pointcloud);
+
+  /**
+   * Stores the ICP correction of the pose T_G_C and publishes it as both TF
+   * and message.
+   */
+  void applyIcpCorrection(const Transformation& T_G_C,
+                          const Transformation& T_G_C_refined,
+                          const ros::Time& stamp);
+
+  /**
+   * Pipelined ICP: starts the alignment of the pointcloud on a background
+   * thread, then integrates the previous pointcloud with its alignment.
+   * Each pointcloud is integrated when the next one arrives.
+   */
+  void insertPointcloudWithPipelinedIcp(const Transformation& T_G_C,
+                                        const ros::Time& stamp,
+                                        Pointcloud* points_C, Colors* colors);
+  /**
+   * Copies the TSDF blocks within the sensor range around the ICP initial
+   * guess and aligns the scan to the copy on a background thread.
+   */
+  void startBackgroundIcp(PendingIcpScan* scan);
+  /// Waits for the background ICP job, if any.
+  void waitForBackgroundIcp();
+
+  /**
+   * Copies the TSDF blocks flagged for meshing (and the neighbors read at their
+   * borders) and meshes the copy on a background thread, so that integration
+   * goes on meanwhile. The mesh layer must not be accessed until the job ends.
+   */
+  void startBackgroundMeshing();
+  bool isBackgroundMeshingRunning() const;
+  /// Waits for the background meshing job, if any.
+  void waitForBackgroundMeshing();
+
   ros::NodeHandle nh_;
   ros::NodeHandle nh_private_;
 
@@ -185,6 +250,12 @@ class TsdfServer {
 
   /// Delete blocks that are far from the system to help manage memory
   double max_block_distance_from_body_;
+  /**
+   * If not empty, the blocks farther than max_block_distance_from_body are
+   * paged out to this directory instead of being deleted, and paged back in
+   * when the sensor gets close to them again.
+   */
+  std::string block_store_directory_;
 
   /// Pointcloud visualization settings.
   double slice_level_;
@@ -215,6 +286,18 @@ class TsdfServer {
 
   /// Whether to save the latest mesh message sent (for inheriting classes).
   bool cache_mesh_;
+  /**
+   * Whether the mesh timer meshes the updated blocks on a background thread
+   * instead of blocking the integration. Its mesh is published at the next
+   * timer event.
+   */
+  bool mesh_in_background_;
+  /**
+   * Finest level of detail of the published meshes, above 0 the full
+   * resolution triangles are not published (see generateVoxbloxMeshMsg()).
+   * Requires mesh_num_lods levels of detail to be generated.
+   */
+  int mesh_min_lod_;
 
   /**
    *Whether to enable ICP corrections. Every pointcloud coming in will attempt
@@ -228,6 +311,14 @@ class TsdfServer {
    * iteration.
    */
   bool accumulate_icp_corrections_;
+  /**
+   * Whether the ICP alignment of a pointcloud runs on a background thread
+   * while the previous pointcloud is integrated, against the map without the
+   * previous pointcloud. The pointclouds are integrated one message late. The
+   * freespace pointclouds are not aligned and only get the current correction.
+   * Use with icp_time_budget_s to bound the latency.
+   */
+  bool icp_pipelined_;
 
   /// Subscriber settings.
   int pointcloud_queue_size_;
@@ -236,13 +327,20 @@ class TsdfServer {
   // Maps and integrators.
   std::shared_ptr<TsdfMap> tsdf_map_;
   std::unique_ptr<TsdfIntegratorBase> tsdf_integrator_;
+  /// On-disk store of the paged out TSDF blocks, null if paging is disabled.
+  BlockStore<TsdfVoxel>::Ptr tsdf_block_store_;
 
   /// ICP matcher
   std::shared_ptr<ICP> icp_;
+  /// Pointcloud being aligned in the ICP pipeline (see icp_pipelined_).
+  std::unique_ptr<PendingIcpScan> pending_icp_scan_;
 
   // Mesh accessories.
   std::shared_ptr<MeshLayer> mesh_layer_;
   std::unique_ptr<MeshIntegrator<TsdfVoxel>> mesh_integrator_;
+  MeshIntegratorConfig mesh_config_;
+  /// Background meshing job (see startBackgroundMeshing()).
+  std::future<void> mesh_job_;
   /// Optionally cached mesh message.
   voxblox_msgs::Mesh cached_mesh_msg_;
 
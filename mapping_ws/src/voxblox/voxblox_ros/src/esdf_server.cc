@@ -47,11 +47,11 @@ void EsdfServer::setupRos() {
   traversable_pub_ = nh_private_.advertise<pcl::PointCloud<pcl::PointXYZI> >(
       "traversable", 1, true);
 
-  esdf_map_pub_ =
-      nh_private_.advertise<voxblox_msgs::Layer>("esdf_map_out", 1, false);
+  esdf_map_pub_ = nh_private_.advertise<voxblox_msgs::Layer>(
+      "esdf_map_out", kLayerMsgQueueSize, false);
 
   // Set up subscriber.
-  esdf_map_sub_ = nh_private_.subscribe("esdf_map_in", 1,
+  esdf_map_sub_ = nh_private_.subscribe("esdf_map_in", kLayerMsgQueueSize,
                                         &EsdfServer::esdfMapCallback, this);
 
   // Whether to clear each new pose as it comes in, and then set a sphere
@@ -163,6 +163,7 @@ void EsdfServer::publishMap(bool reset_remote_map) {
       layer_msg.action = static_cast<uint8_t>(MapDerializationAction::kReset);
     }
     this->esdf_map_pub_.publish(layer_msg);
+    clearLayerMapUpdatedFlags(esdf_map_->getEsdfLayerPtr());
     publish_map_timer.Stop();
   }
   num_subscribers_esdf_map_ = subscribers;
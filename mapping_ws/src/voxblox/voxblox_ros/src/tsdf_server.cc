@@ -1,13 +1,34 @@
 #include "voxblox_ros/tsdf_server.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include <minkindr_conversions/kindr_msg.h>
 #include <minkindr_conversions/kindr_tf.h>
+#include <mr3d_profiling/ProfilerExporter.h>
 
 #include "voxblox_ros/conversions.h"
 #include "voxblox_ros/ros_params.h"
 
 namespace voxblox {
 
+namespace {
+
+/// Copies a TSDF block into the block of the same index of another layer.
+Block<TsdfVoxel>::Ptr copyBlock(const Block<TsdfVoxel>& block,
+                                const BlockIndex& block_index,
+                                Layer<TsdfVoxel>* layer) {
+  Block<TsdfVoxel>::Ptr copy = layer->allocateBlockPtrByIndex(block_index);
+  for (size_t linear_idx = 0u; linear_idx < block.num_voxels(); ++linear_idx) {
+    copy->getVoxelByLinearIndex(linear_idx) =
+        block.getVoxelByLinearIndex(linear_idx);
+  }
+  copy->set_has_data(block.has_data());
+  return copy;
+}
+
+}  // namespace
+
 TsdfServer::TsdfServer(const ros::NodeHandle& nh,
                        const ros::NodeHandle& nh_private)
     : TsdfServer(nh, nh_private, getTsdfMapConfigFromRosParam(nh_private),
@@ -35,10 +56,14 @@ TsdfServer::TsdfServer(const ros::NodeHandle& nh,
       publish_tsdf_map_(false),
       publish_mesh_pointcloud_(false),
       cache_mesh_(false),
+      mesh_in_background_(false),
+      mesh_min_lod_(0),
       enable_icp_(false),
       accumulate_icp_corrections_(true),
+      icp_pipelined_(false),
       pointcloud_queue_size_(1),
       num_subscribers_tsdf_map_(0),
+      mesh_config_(mesh_config),
       transformer_(nh, nh_private) {
   getServerConfigFromRosParam(nh_private);
 
@@ -68,11 +93,24 @@ TsdfServer::TsdfServer(const ros::NodeHandle& nh,
       "mesh_pointcloud", 1, true);
   nh_private_.param("publish_mesh_pointcloud", publish_mesh_pointcloud_, publish_mesh_pointcloud_);
 
+  // Export the timers with the other profiler zones of the node.
+  bool enable_profiler = false;
+  nh_private_.param("enable_profiler", enable_profiler, enable_profiler);
+  if (enable_profiler) {
+    std::string profiler_stats_file;
+    nh_private_.param("profiler_stats_file", profiler_stats_file,
+                      profiler_stats_file);
+    mr3d_profiling::ProfilerExporter::instance().start(nh_private_,
+                                                       profiler_stats_file);
+  }
+
   // Publishing/subscribing to a layer from another node (when using this as
-  // a library, for example within a planner).
-  tsdf_map_pub_ =
-      nh_private_.advertise<voxblox_msgs::Layer>("tsdf_map_out", 1, false);
-  tsdf_map_sub_ = nh_private_.subscribe("tsdf_map_in", 1,
+  // a library, for example within a planner). The layer messages only carry
+  // the blocks updated since the previous one, so they are queued rather than
+  // dropped.
+  tsdf_map_pub_ = nh_private_.advertise<voxblox_msgs::Layer>(
+      "tsdf_map_out", kLayerMsgQueueSize, false);
+  tsdf_map_sub_ = nh_private_.subscribe("tsdf_map_in", kLayerMsgQueueSize,
                                         &TsdfServer::tsdfMapCallback, this);
   nh_private_.param("publish_tsdf_map", publish_tsdf_map_, publish_tsdf_map_);
 
@@ -107,11 +145,29 @@ TsdfServer::TsdfServer(const ros::NodeHandle& nh,
   } else if (method.compare("fast") == 0) {
     tsdf_integrator_.reset(new FastTsdfIntegrator(
         integrator_config, tsdf_map_->getTsdfLayerPtr()));
+  } else if (method.compare("projective") == 0) {
+    tsdf_integrator_.reset(new ProjectiveTsdfIntegrator(
+        integrator_config, tsdf_map_->getTsdfLayerPtr()));
+  } else if (method.compare("device") == 0) {
+    tsdf_integrator_.reset(new DeviceTsdfIntegrator(
+        integrator_config, tsdf_map_->getTsdfLayerPtr()));
   } else {
     tsdf_integrator_.reset(new SimpleTsdfIntegrator(
         integrator_config, tsdf_map_->getTsdfLayerPtr()));
   }
 
+  if (!block_store_directory_.empty()) {
+    if (max_block_distance_from_body_ <
+        std::numeric_limits<FloatingPoint>::max()) {
+      tsdf_block_store_.reset(
+          new BlockStore<TsdfVoxel>(block_store_directory_));
+    } else {
+      ROS_WARN(
+          "block_store_directory is set but max_block_distance_from_body is "
+          "not: blocks are never paged out.");
+    }
+  }
+
   mesh_layer_.reset(new MeshLayer(tsdf_map_->block_size()));
 
   mesh_integrator_.reset(new MeshIntegrator<TsdfVoxel>(
@@ -167,6 +223,8 @@ void TsdfServer::getServerConfigFromRosParam(
   nh_private.param("max_block_distance_from_body",
                    max_block_distance_from_body_,
                    max_block_distance_from_body_);
+  nh_private.param("block_store_directory", block_store_directory_,
+                   block_store_directory_);
   nh_private.param("slice_level", slice_level_, slice_level_);
   nh_private.param("world_frame", world_frame_, world_frame_);
   nh_private.param("publish_pointclouds_on_update",
@@ -183,11 +241,15 @@ void TsdfServer::getServerConfigFromRosParam(
   nh_private.param("enable_icp", enable_icp_, enable_icp_);
   nh_private.param("accumulate_icp_corrections", accumulate_icp_corrections_,
                    accumulate_icp_corrections_);
+  nh_private.param("icp_pipelined", icp_pipelined_, icp_pipelined_);
 
   nh_private.param("verbose", verbose_, verbose_);
 
   // Mesh settings.
   nh_private.param("mesh_filename", mesh_filename_, mesh_filename_);
+  nh_private.param("mesh_in_background", mesh_in_background_,
+                   mesh_in_background_);
+  nh_private.param("mesh_min_lod", mesh_min_lod_, mesh_min_lod_);
   std::string color_mode("");
   nh_private.param("color_mode", color_mode, color_mode);
   color_mode_ = getColorModeFromString(color_mode);
@@ -258,12 +320,19 @@ void TsdfServer::processPointCloudMessageAndInsert(
   ptcloud_timer.Stop();
 
   Transformation T_G_C_refined = T_G_C;
-  if (enable_icp_) {
+  if (enable_icp_ && icp_pipelined_) {
+    if (!is_freespace_pointcloud) {
+      insertPointcloudWithPipelinedIcp(T_G_C, pointcloud_msg->header.stamp,
+                                       &points_C, &colors);
+      return;
+    }
+    // The matcher belongs to the pipeline.
+    T_G_C_refined = icp_corrected_transform_ * T_G_C;
+  } else if (enable_icp_) {
     timing::Timer icp_timer("icp");
     if (!accumulate_icp_corrections_) {
       icp_corrected_transform_.setIdentity();
     }
-    static Transformation T_offset;
     const size_t num_icp_updates =
         icp_->runICP(tsdf_map_->getTsdfLayer(), points_C,
                      icp_corrected_transform_ * T_G_C, &T_G_C_refined);
@@ -271,44 +340,33 @@ void TsdfServer::processPointCloudMessageAndInsert(
       ROS_INFO("ICP refinement performed %zu successful update steps",
                num_icp_updates);
     }
-    icp_corrected_transform_ = T_G_C_refined * T_G_C.inverse();
-
-    if (!icp_->refiningRollPitch()) {
-      // its already removed internally but small floating point errors can
-      // build up if accumulating transforms
-      Transformation::Vector6 T_vec = icp_corrected_transform_.log();
-      T_vec[3] = 0.0;
-      T_vec[4] = 0.0;
-      icp_corrected_transform_ = Transformation::exp(T_vec);
-    }
-
-    // Publish transforms as both TF and message.
-    tf::Transform icp_tf_msg, pose_tf_msg;
-    geometry_msgs::TransformStamped transform_msg;
-
-    tf::transformKindrToTF(icp_corrected_transform_.cast<double>(),
-                           &icp_tf_msg);
-    tf::transformKindrToTF(T_G_C.cast<double>(), &pose_tf_msg);
-    tf::transformKindrToMsg(icp_corrected_transform_.cast<double>(),
-                            &transform_msg.transform);
-    tf_broadcaster_.sendTransform(
-        tf::StampedTransform(icp_tf_msg, pointcloud_msg->header.stamp,
-                             world_frame_, icp_corrected_frame_));
-    tf_broadcaster_.sendTransform(
-        tf::StampedTransform(pose_tf_msg, pointcloud_msg->header.stamp,
-                             icp_corrected_frame_, pose_corrected_frame_));
-
-    transform_msg.header.frame_id = world_frame_;
-    transform_msg.child_frame_id = icp_corrected_frame_;
-    icp_transform_pub_.publish(transform_msg);
-
+    applyIcpCorrection(T_G_C, T_G_C_refined, pointcloud_msg->header.stamp);
     icp_timer.Stop();
   }
 
+  integrateScan(T_G_C, T_G_C_refined, points_C, colors,
+                is_freespace_pointcloud);
+}
+
+void TsdfServer::integrateScan(const Transformation& T_G_C,
+                               const Transformation& T_G_C_refined,
+                               const Pointcloud& points_C,
+                               const Colors& colors,
+                               const bool is_freespace_pointcloud) {
   if (verbose_) {
     ROS_INFO("Integrating a pointcloud with %lu points.", points_C.size());
   }
 
+  if (tsdf_block_store_) {
+    // Page the blocks around the sensor back in before the integrator (and
+    // the queries of the inheriting classes) touch them.
+    timing::Timer block_load_timer("load_stored_blocks");
+    tsdf_block_store_->loadBlocksInRadius(T_G_C.getPosition(),
+                                          max_block_distance_from_body_,
+                                          tsdf_map_->getTsdfLayerPtr());
+    block_load_timer.Stop();
+  }
+
   ros::WallTime start = ros::WallTime::now();
   integratePointcloud(T_G_C_refined, points_C, colors, is_freespace_pointcloud);
   ros::WallTime end = ros::WallTime::now();
@@ -319,16 +377,148 @@ void TsdfServer::processPointCloudMessageAndInsert(
   }
 
   timing::Timer block_remove_timer("remove_distant_blocks");
-  tsdf_map_->getTsdfLayerPtr()->removeDistantBlocks(
-      T_G_C.getPosition(), max_block_distance_from_body_);
-  mesh_layer_->clearDistantMesh(T_G_C.getPosition(),
-                                max_block_distance_from_body_);
+  if (tsdf_block_store_) {
+    tsdf_block_store_->evictDistantBlocks(T_G_C.getPosition(),
+                                          max_block_distance_from_body_,
+                                          tsdf_map_->getTsdfLayerPtr());
+  } else {
+    tsdf_map_->getTsdfLayerPtr()->removeDistantBlocks(
+        T_G_C.getPosition(), max_block_distance_from_body_);
+  }
+  if (!isBackgroundMeshingRunning()) {
+    mesh_layer_->clearDistantMesh(T_G_C.getPosition(),
+                                  max_block_distance_from_body_);
+  }
   block_remove_timer.Stop();
 
   // Callback for inheriting classes.
   newPoseCallback(T_G_C);
 }
 
+void TsdfServer::applyIcpCorrection(const Transformation& T_G_C,
+                                    const Transformation& T_G_C_refined,
+                                    const ros::Time& stamp) {
+  icp_corrected_transform_ = T_G_C_refined * T_G_C.inverse();
+
+  if (!icp_->refiningRollPitch()) {
+    // its already removed internally but small floating point errors can
+    // build up if accumulating transforms
+    Transformation::Vector6 T_vec = icp_corrected_transform_.log();
+    T_vec[3] = 0.0;
+    T_vec[4] = 0.0;
+    icp_corrected_transform_ = Transformation::exp(T_vec);
+  }
+
+  // Publish transforms as both TF and message.
+  tf::Transform icp_tf_msg, pose_tf_msg;
+  geometry_msgs::TransformStamped transform_msg;
+
+  tf::transformKindrToTF(icp_corrected_transform_.cast<double>(),
+                         &icp_tf_msg);
+  tf::transformKindrToTF(T_G_C.cast<double>(), &pose_tf_msg);
+  tf::transformKindrToMsg(icp_corrected_transform_.cast<double>(),
+                          &transform_msg.transform);
+  tf_broadcaster_.sendTransform(tf::StampedTransform(
+      icp_tf_msg, stamp, world_frame_, icp_corrected_frame_));
+  tf_broadcaster_.sendTransform(tf::StampedTransform(
+      pose_tf_msg, stamp, icp_corrected_frame_, pose_corrected_frame_));
+
+  transform_msg.header.frame_id = world_frame_;
+  transform_msg.child_frame_id = icp_corrected_frame_;
+  icp_transform_pub_.publish(transform_msg);
+}
+
+void TsdfServer::insertPointcloudWithPipelinedIcp(const Transformation& T_G_C,
+                                                  const ros::Time& stamp,
+                                                  Pointcloud* points_C,
+                                                  Colors* colors) {
+  CHECK_NOTNULL(points_C);
+  CHECK_NOTNULL(colors);
+
+  // The alignment of the previous pointcloud ran during the last integration,
+  // its correction is the initial guess of this one.
+  std::unique_ptr<PendingIcpScan> previous_scan = std::move(pending_icp_scan_);
+  Transformation previous_T_G_C_refined;
+  if (previous_scan) {
+    timing::Timer icp_wait_timer("icp/wait");
+    previous_T_G_C_refined = previous_scan->T_G_C_refined.get();
+    icp_wait_timer.Stop();
+    if (icp_->timedOut()) {
+      ROS_WARN_THROTTLE(1.0,
+                        "ICP exceeded its time budget, using the odometry.");
+    }
+    applyIcpCorrection(previous_scan->T_G_C, previous_T_G_C_refined,
+                       previous_scan->stamp);
+  }
+
+  pending_icp_scan_.reset(new PendingIcpScan);
+  pending_icp_scan_->T_G_C = T_G_C;
+  pending_icp_scan_->stamp = stamp;
+  pending_icp_scan_->points_C.swap(*points_C);
+  pending_icp_scan_->colors.swap(*colors);
+  startBackgroundIcp(pending_icp_scan_.get());
+
+  if (previous_scan) {
+    constexpr bool kIsFreespacePointcloud = false;
+    integrateScan(previous_scan->T_G_C, previous_T_G_C_refined,
+                  previous_scan->points_C, previous_scan->colors,
+                  kIsFreespacePointcloud);
+  }
+}
+
+void TsdfServer::startBackgroundIcp(PendingIcpScan* scan) {
+  CHECK_NOTNULL(scan);
+  timing::Timer snapshot_timer("icp/snapshot");
+  if (!accumulate_icp_corrections_) {
+    icp_corrected_transform_.setIdentity();
+  }
+  const Transformation initial_T_G_C = icp_corrected_transform_ * scan->T_G_C;
+
+  // The matched points only read the blocks within the sensor range.
+  FloatingPoint max_range = 0.0;
+  for (const Point& point_C : scan->points_C) {
+    max_range = std::max(max_range, point_C.norm());
+  }
+  const Layer<TsdfVoxel>& tsdf_layer = tsdf_map_->getTsdfLayer();
+  const FloatingPoint radius =
+      max_range + std::sqrt(3.0f) * tsdf_layer.block_size();
+
+  std::shared_ptr<Layer<TsdfVoxel>> snapshot =
+      std::make_shared<Layer<TsdfVoxel>>(tsdf_layer.voxel_size(),
+                                         tsdf_layer.voxels_per_side());
+  BlockIndexList allocated_blocks;
+  tsdf_layer.getAllAllocatedBlocks(&allocated_blocks);
+  for (const BlockIndex& block_index : allocated_blocks) {
+    const Point block_center = getCenterPointFromGridIndex(
+        block_index, tsdf_layer.block_size());
+    if ((block_center - initial_T_G_C.getPosition()).norm() <= radius) {
+      copyBlock(tsdf_layer.getBlockByIndex(block_index), block_index,
+                snapshot.get());
+    }
+  }
+  snapshot_timer.Stop();
+
+  scan->T_G_C_refined = std::async(
+      std::launch::async, [this, snapshot, scan, initial_T_G_C]() {
+        timing::Timer icp_timer("icp");
+        Transformation T_G_C_refined;
+        const size_t num_icp_updates = icp_->runICP(
+            *snapshot, scan->points_C, initial_T_G_C, &T_G_C_refined);
+        if (verbose_) {
+          ROS_INFO("ICP refinement performed %zu successful update steps",
+                   num_icp_updates);
+        }
+        icp_timer.Stop();
+        return T_G_C_refined;
+      });
+}
+
+void TsdfServer::waitForBackgroundIcp() {
+  if (pending_icp_scan_ && pending_icp_scan_->T_G_C_refined.valid()) {
+    pending_icp_scan_->T_G_C_refined.wait();
+  }
+}
+
 // Checks if we can get the next message from queue.
 bool TsdfServer::getNextPointcloudFromQueue(
     std::queue<sensor_msgs::PointCloud2::Ptr>* queue,
@@ -482,6 +672,7 @@ void TsdfServer::publishMap(bool reset_remote_map) {
       layer_msg.action = static_cast<uint8_t>(MapDerializationAction::kReset);
     }
     this->tsdf_map_pub_.publish(layer_msg);
+    clearLayerMapUpdatedFlags(tsdf_map_->getTsdfLayerPtr());
     publish_map_timer.Stop();
   }
   num_subscribers_tsdf_map_ = subscribers;
@@ -510,16 +701,44 @@ void TsdfServer::updateMesh() {
     ROS_INFO("Updating mesh.");
   }
 
-  timing::Timer generate_mesh_timer("mesh/update");
-  constexpr bool only_mesh_updated_blocks = true;
-  constexpr bool clear_updated_flag = true;
-  mesh_integrator_->generateMesh(only_mesh_updated_blocks, clear_updated_flag);
-  generate_mesh_timer.Stop();
+  if (mesh_in_background_) {
+    // Publish the blocks meshed by the previous job and hand over the blocks
+    // updated since then. If the job is still running, its blocks and the new
+    // ones are picked up at the next event.
+    if (!isBackgroundMeshingRunning()) {
+      waitForBackgroundMeshing();
+      publishMesh();
+      if (publish_mesh_pointcloud_) {
+        publishMeshAsPointcloud();
+      }
+      startBackgroundMeshing();
+    }
+  } else {
+    timing::Timer generate_mesh_timer("mesh/update");
+    constexpr bool only_mesh_updated_blocks = true;
+    constexpr bool clear_updated_flag = true;
+    mesh_integrator_->generateMesh(only_mesh_updated_blocks,
+                                   clear_updated_flag);
+    generate_mesh_timer.Stop();
 
+    publishMesh();
+
+    if (publish_mesh_pointcloud_) {
+      publishMeshAsPointcloud();
+    }
+  }
+
+  if (publish_pointclouds_ && !publish_pointclouds_on_update_) {
+    publishPointclouds();
+  }
+}
+
+void TsdfServer::publishMesh() {
   timing::Timer publish_mesh_timer("mesh/publish");
 
+  // Only the mesh blocks updated since the last message are sent.
   voxblox_msgs::Mesh mesh_msg;
-  generateVoxbloxMeshMsg(mesh_layer_, color_mode_, &mesh_msg);
+  generateVoxbloxMeshMsg(mesh_layer_, color_mode_, &mesh_msg, mesh_min_lod_);
   mesh_msg.header.frame_id = world_frame_;
   mesh_pub_.publish(mesh_msg);
 
@@ -528,17 +747,77 @@ void TsdfServer::updateMesh() {
   }
 
   publish_mesh_timer.Stop();
+}
 
-  if(publish_mesh_pointcloud_) {
-    publishMeshAsPointcloud();
+void TsdfServer::startBackgroundMeshing() {
+  timing::Timer snapshot_timer("mesh/snapshot");
+  Layer<TsdfVoxel>* tsdf_layer = tsdf_map_->getTsdfLayerPtr();
+  BlockIndexList updated_blocks;
+  tsdf_layer->getAllUpdatedBlocks(Update::kMesh, &updated_blocks);
+  if (updated_blocks.empty()) {
+    return;
   }
 
-  if (publish_pointclouds_ && !publish_pointclouds_on_update_) {
-    publishPointclouds();
+  std::shared_ptr<Layer<TsdfVoxel>> snapshot =
+      std::make_shared<Layer<TsdfVoxel>>(tsdf_layer->voxel_size(),
+                                         tsdf_layer->voxels_per_side());
+
+  // The updated blocks are meshed by the job, so their flag moves to the copy.
+  for (const BlockIndex& block_index : updated_blocks) {
+    Block<TsdfVoxel>& block = tsdf_layer->getBlockByIndex(block_index);
+    Block<TsdfVoxel>::Ptr copy =
+        copyBlock(block, block_index, snapshot.get());
+    copy->updated().set(Update::kMesh);
+    block.updated().reset(Update::kMesh);
+  }
+
+  // Marching cubes and mesh coloring also read the neighbors on the positive
+  // side of each block.
+  for (const BlockIndex& block_index : updated_blocks) {
+    for (IndexElement dx = 0; dx <= 1; ++dx) {
+      for (IndexElement dy = 0; dy <= 1; ++dy) {
+        for (IndexElement dz = 0; dz <= 1; ++dz) {
+          const BlockIndex neighbor_index =
+              block_index + BlockIndex(dx, dy, dz);
+          if (snapshot->hasBlock(neighbor_index)) {
+            continue;
+          }
+          Block<TsdfVoxel>::ConstPtr neighbor =
+              tsdf_layer->getBlockPtrByIndex(neighbor_index);
+          if (neighbor) {
+            copyBlock(*neighbor, neighbor_index, snapshot.get());
+          }
+        }
+      }
+    }
+  }
+  snapshot_timer.Stop();
+
+  mesh_job_ = std::async(std::launch::async, [this, snapshot]() {
+    timing::Timer generate_mesh_timer("mesh/update");
+    MeshIntegrator<TsdfVoxel> mesh_integrator(mesh_config_, *snapshot,
+                                              mesh_layer_.get());
+    constexpr bool only_mesh_updated_blocks = true;
+    constexpr bool clear_updated_flag = false;
+    mesh_integrator.generateMesh(only_mesh_updated_blocks,
+                                 clear_updated_flag);
+    generate_mesh_timer.Stop();
+  });
+}
+
+bool TsdfServer::isBackgroundMeshingRunning() const {
+  return mesh_job_.valid() && mesh_job_.wait_for(std::chrono::seconds(0)) !=
+                                  std::future_status::ready;
+}
+
+void TsdfServer::waitForBackgroundMeshing() {
+  if (mesh_job_.valid()) {
+    mesh_job_.get();
   }
 }
 
 bool TsdfServer::generateMesh() {
+  waitForBackgroundMeshing();
   timing::Timer generate_mesh_timer("mesh/generate");
   const bool clear_mesh = true;
   if (clear_mesh) {
@@ -556,7 +835,7 @@ bool TsdfServer::generateMesh() {
 
   timing::Timer publish_mesh_timer("mesh/publish");
   voxblox_msgs::Mesh mesh_msg;
-  generateVoxbloxMeshMsg(mesh_layer_, color_mode_, &mesh_msg);
+  generateVoxbloxMeshMsg(mesh_layer_, color_mode_, &mesh_msg, mesh_min_lod_);
   mesh_msg.header.frame_id = world_frame_;
   mesh_pub_.publish(mesh_msg);
 
@@ -579,6 +858,11 @@ bool TsdfServer::generateMesh() {
 
 bool TsdfServer::saveMap(const std::string& file_path) {
   // Inheriting classes should add saving other layers to this function.
+  if (tsdf_block_store_) {
+    // Also save the paged out blocks.
+    return tsdf_block_store_->saveLayerToFile(tsdf_map_->getTsdfLayer(),
+                                              file_path);
+  }
   return io::SaveLayer(tsdf_map_->getTsdfLayer(), file_path);
 }
 
@@ -645,7 +929,13 @@ void TsdfServer::publishMapEvent(const ros::TimerEvent& /*event*/) {
 }
 
 void TsdfServer::clear() {
+  waitForBackgroundIcp();
+  pending_icp_scan_.reset();
+  waitForBackgroundMeshing();
   tsdf_map_->getTsdfLayerPtr()->removeAllBlocks();
+  if (tsdf_block_store_) {
+    tsdf_block_store_->clear();
+  }
   mesh_layer_->clear();
 
   // Publish a message to reset the map to all subscribers.
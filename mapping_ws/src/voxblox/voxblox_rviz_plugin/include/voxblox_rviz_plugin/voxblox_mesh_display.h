@@ -4,6 +4,7 @@
 #include <memory>
 
 #include <rviz/message_filter_display.h>
+#include <rviz/properties/float_property.h>
 #include <voxblox_msgs/Mesh.h>
 
 #include "voxblox_rviz_plugin/voxblox_mesh_visual.h"
@@ -25,10 +26,15 @@ class VoxbloxMeshDisplay
 
   virtual void reset();
 
+  /// Updates the levels of detail of the mesh for the camera position.
+  virtual void update(float wall_dt, float ros_dt);
+
  private:
   void processMessage(const voxblox_msgs::Mesh::ConstPtr& msg);
 
   std::unique_ptr<VoxbloxMeshVisual> visual_;
+
+  rviz::FloatProperty* lod_distance_property_;
 };
 
 }  // namespace voxblox_rviz_plugin
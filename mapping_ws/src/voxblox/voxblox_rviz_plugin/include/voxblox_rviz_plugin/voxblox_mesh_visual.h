@@ -1,14 +1,27 @@
 #ifndef VOXBLOX_RVIZ_PLUGIN_VOXBLOX_MESH_VISUAL_H_
 #define VOXBLOX_RVIZ_PLUGIN_VOXBLOX_MESH_VISUAL_H_
 
+#include <memory>
+#include <string>
+#include <vector>
+
 #include <OGRE/OgreManualObject.h>
 
 #include <voxblox/core/block_hash.h>
+#include <voxblox/mesh/mesh.h>
 #include <voxblox_msgs/Mesh.h>
 
 namespace voxblox_rviz_plugin {
 
-/// Visualizes a single voxblox_msgs::Mesh message.
+/**
+ * Visualizes a single voxblox_msgs::Mesh message.
+ *
+ * The blocks closer to the camera than the LOD distance are shown at their
+ * finest level of detail, each in its own object. Further away, a block is
+ * shown at level l between lod_distance * 2^(l - 1) and lod_distance * 2^l
+ * (or the closest level it has) and merged with the other distant blocks of
+ * its batch (kBatchBlocksPerSide^3 blocks) into a single object.
+ */
 class VoxbloxMeshVisual {
  public:
   VoxbloxMeshVisual(Ogre::SceneManager* scene_manager,
@@ -17,18 +30,73 @@ class VoxbloxMeshVisual {
 
   void setMessage(const voxblox_msgs::Mesh::ConstPtr& msg);
 
+  /**
+   * Updates the levels of detail for a camera at the given position (in the
+   * world frame of Ogre). A lod_distance of 0 shows all blocks at their finest
+   * level.
+   */
+  void setCameraPosition(const Ogre::Vector3& camera_position,
+                         float lod_distance);
+
   /// Set the coordinate frame pose.
   void setFramePosition(const Ogre::Vector3& position);
   void setFrameOrientation(const Ogre::Quaternion& orientation);
 
  private:
+  static constexpr int kBatchBlocksPerSide = 4;
+
+  /// The decoded levels of detail of a block and how it is shown.
+  struct BlockMeshes {
+    /// levels[0] is the full resolution, null if the level was not sent.
+    std::vector<std::shared_ptr<voxblox::Mesh>> levels;
+    voxblox::Point center;
+    /// Level shown, -1 if the block is not shown yet.
+    int shown_level = -1;
+    /// Whether the block is shown in its batch or in its own object.
+    bool in_batch = false;
+    /// Whether the levels changed since the block was shown.
+    bool changed = true;
+  };
+
+  /**
+   * Shows the blocks at the level of detail of their distance to the camera.
+   * Only the changed blocks are updated unless update_all is true.
+   */
+  void updateLevelsOfDetail(bool update_all);
+
+  /// Shows the block in its own object.
+  void showBlock(const voxblox::BlockIndex& block_index,
+                 const voxblox::Mesh& mesh);
+  void hideBlock(const voxblox::BlockIndex& block_index);
+  void removeBlock(const voxblox::BlockIndex& block_index);
+
+  /// Merges the blocks of the batch shown in the batch in its object.
+  void rebuildBatch(const voxblox::BlockIndex& batch_index);
+
+  voxblox::BlockIndex getBatchIndex(
+      const voxblox::BlockIndex& block_index) const;
+
+  /// Creates an object attached to the frame node.
+  Ogre::ManualObject* createObject(const std::string& prefix,
+                                   const voxblox::BlockIndex& index);
+
   Ogre::SceneNode* frame_node_;
   Ogre::SceneManager* scene_manager_;
 
   unsigned int instance_number_;
   static unsigned int instance_counter_;
 
+  voxblox::AnyIndexHashMapType<BlockMeshes>::type block_meshes_;
   voxblox::AnyIndexHashMapType<Ogre::ManualObject*>::type object_map_;
+
+  /// Objects of the batches and the blocks in each batch.
+  voxblox::AnyIndexHashMapType<Ogre::ManualObject*>::type batch_object_map_;
+  voxblox::AnyIndexHashMapType<voxblox::BlockIndexList>::type batch_blocks_;
+  voxblox::IndexSet dirty_batches_;
+
+  /// Camera position in the frame of the mesh at the last update.
+  Ogre::Vector3 camera_position_;
+  float lod_distance_;
 };
 
 }  // namespace voxblox_rviz_plugin
@@ -1,16 +1,27 @@
 #include "voxblox_rviz_plugin/voxblox_mesh_display.h"
 
+#include <OGRE/OgreCamera.h>
 #include <OGRE/OgreSceneManager.h>
 #include <OGRE/OgreSceneNode.h>
 
 #include <tf/transform_listener.h>
 
 #include <rviz/frame_manager.h>
+#include <rviz/view_controller.h>
+#include <rviz/view_manager.h>
 #include <rviz/visualization_manager.h>
 
 namespace voxblox_rviz_plugin {
 
-VoxbloxMeshDisplay::VoxbloxMeshDisplay() {}
+VoxbloxMeshDisplay::VoxbloxMeshDisplay() {
+  lod_distance_property_ = new rviz::FloatProperty(
+      "LOD Distance", 10.0,
+      "Distance from the camera beyond which the blocks are shown at coarser "
+      "levels of detail (if the mesh has them), doubling at each level. 0 "
+      "always shows the finest level.",
+      this);
+  lod_distance_property_->setMin(0.0);
+}
 
 void VoxbloxMeshDisplay::onInitialize() { MFDClass::onInitialize(); }
 
@@ -21,6 +32,21 @@ void VoxbloxMeshDisplay::reset() {
   visual_.reset();
 }
 
+void VoxbloxMeshDisplay::update(float wall_dt, float ros_dt) {
+  MFDClass::update(wall_dt, ros_dt);
+  if (visual_ == nullptr) {
+    return;
+  }
+  rviz::ViewController* view_controller =
+      context_->getViewManager()->getCurrent();
+  if (view_controller == nullptr) {
+    return;
+  }
+  visual_->setCameraPosition(
+      view_controller->getCamera()->getDerivedPosition(),
+      lod_distance_property_->getFloat());
+}
+
 void VoxbloxMeshDisplay::processMessage(
     const voxblox_msgs::Mesh::ConstPtr& msg) {
   // Here we call the rviz::FrameManager to get the transform from the
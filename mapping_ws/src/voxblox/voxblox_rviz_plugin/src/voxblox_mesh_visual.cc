@@ -1,6 +1,9 @@
 #include "voxblox_rviz_plugin/voxblox_mesh_visual.h"
 
+#include <algorithm>
+#include <cmath>
 #include <limits>
+#include <string>
 
 #include <OGRE/OgreSceneManager.h>
 #include <OGRE/OgreSceneNode.h>
@@ -9,10 +12,180 @@
 
 namespace voxblox_rviz_plugin {
 
+namespace {
+
+/// The camera has to move this fraction of the LOD distance to update it.
+constexpr float kCameraMoveFraction = 0.1f;
+
+voxblox::Point decodeVertex(uint16_t x, uint16_t y, uint16_t z,
+                            const voxblox::BlockIndex& index,
+                            float block_edge_length) {
+  // Each vertex is given as its distance from the blocks origin in units of
+  // (2*block_size), see mesh_vis.h for the slightly convoluted justification
+  // of the 2.
+  constexpr float point_conv_factor =
+      2.0f / std::numeric_limits<uint16_t>::max();
+  const float mesh_x =
+      (static_cast<float>(x) * point_conv_factor +
+       static_cast<float>(index[0])) *
+      block_edge_length;
+  const float mesh_y =
+      (static_cast<float>(y) * point_conv_factor +
+       static_cast<float>(index[1])) *
+      block_edge_length;
+  const float mesh_z =
+      (static_cast<float>(z) * point_conv_factor +
+       static_cast<float>(index[2])) *
+      block_edge_length;
+  return voxblox::Point(mesh_x, mesh_y, mesh_z);
+}
+
+/**
+ * Uses the colors of the message if there are, else reconstructs the normals
+ * coloring.
+ */
+void setVertexColors(const std::vector<uint8_t>& r,
+                     const std::vector<uint8_t>& g,
+                     const std::vector<uint8_t>& b, voxblox::Mesh* mesh) {
+  mesh->colors.reserve(mesh->vertices.size());
+  const bool has_color = mesh->vertices.size() == r.size();
+  for (size_t i = 0; i < mesh->vertices.size(); ++i) {
+    voxblox::Color color;
+    if (has_color) {
+      color.r = r[i];
+      color.g = g[i];
+      color.b = b[i];
+
+    } else {
+      // reconstruct normals coloring
+      color.r = std::numeric_limits<uint8_t>::max() *
+                (mesh->normals[i].x() * 0.5f + 0.5f);
+      color.g = std::numeric_limits<uint8_t>::max() *
+                (mesh->normals[i].y() * 0.5f + 0.5f);
+      color.b = std::numeric_limits<uint8_t>::max() *
+                (mesh->normals[i].z() * 0.5f + 0.5f);
+    }
+    color.a = std::numeric_limits<uint8_t>::max();
+    mesh->colors.push_back(color);
+  }
+}
+
+/// Decodes the full resolution triangles of the block into a connected mesh.
+void decodeMeshBlock(const voxblox_msgs::MeshBlock& mesh_block,
+                     const voxblox::BlockIndex& index, float block_edge_length,
+                     voxblox::Mesh* connected_mesh) {
+  size_t vertex_index = 0u;
+  voxblox::Mesh mesh;
+  mesh.vertices.reserve(mesh_block.x.size());
+  mesh.indices.reserve(mesh_block.x.size());
+
+  // translate vertex data from message to voxblox mesh
+  for (size_t i = 0; i < mesh_block.x.size(); ++i) {
+    mesh.indices.push_back(vertex_index++);
+    mesh.vertices.push_back(decodeVertex(mesh_block.x[i], mesh_block.y[i],
+                                         mesh_block.z[i], index,
+                                         block_edge_length));
+  }
+
+  // calculate normals
+  mesh.normals.reserve(mesh.vertices.size());
+  for (size_t i = 0; i < mesh.vertices.size(); i += 3) {
+    const voxblox::Point dir0 = mesh.vertices[i] - mesh.vertices[i + 1];
+    const voxblox::Point dir1 = mesh.vertices[i] - mesh.vertices[i + 2];
+    const voxblox::Point normal = dir0.cross(dir1).normalized();
+
+    mesh.normals.push_back(normal);
+    mesh.normals.push_back(normal);
+    mesh.normals.push_back(normal);
+  }
+
+  // add color information
+  setVertexColors(mesh_block.r, mesh_block.g, mesh_block.b, &mesh);
+
+  // connect mesh
+  voxblox::createConnectedMesh(mesh, connected_mesh);
+}
+
+/// Decodes an indexed level of detail of the block.
+void decodeMeshLod(const voxblox_msgs::MeshLod& lod,
+                   const voxblox::BlockIndex& index, float block_edge_length,
+                   voxblox::Mesh* mesh) {
+  mesh->vertices.reserve(lod.x.size());
+  for (size_t i = 0; i < lod.x.size(); ++i) {
+    mesh->vertices.push_back(
+        decodeVertex(lod.x[i], lod.y[i], lod.z[i], index, block_edge_length));
+  }
+
+  // The vertex normals are the normalized sums of the triangle normals.
+  mesh->normals.resize(mesh->vertices.size(), voxblox::Point::Zero());
+  mesh->indices.reserve(lod.triangles.size());
+  for (size_t i = 0; i + 2 < lod.triangles.size(); i += 3) {
+    const uint16_t v0 = lod.triangles[i];
+    const uint16_t v1 = lod.triangles[i + 1];
+    const uint16_t v2 = lod.triangles[i + 2];
+    if (v0 >= mesh->vertices.size() || v1 >= mesh->vertices.size() ||
+        v2 >= mesh->vertices.size()) {
+      continue;
+    }
+    const voxblox::Point dir0 = mesh->vertices[v0] - mesh->vertices[v1];
+    const voxblox::Point dir1 = mesh->vertices[v0] - mesh->vertices[v2];
+    const voxblox::Point normal = dir0.cross(dir1);
+    mesh->normals[v0] += normal;
+    mesh->normals[v1] += normal;
+    mesh->normals[v2] += normal;
+    mesh->indices.push_back(v0);
+    mesh->indices.push_back(v1);
+    mesh->indices.push_back(v2);
+  }
+  for (voxblox::Point& normal : mesh->normals) {
+    const float length = normal.norm();
+    if (length > voxblox::kEpsilon) {
+      normal /= length;
+    } else {
+      normal = voxblox::Point(0.0f, 0.0f, 1.0f);
+    }
+  }
+
+  setVertexColors(lod.r, lod.g, lod.b, mesh);
+}
+
+/**
+ * Adds the mesh to the object between begin() and end(), first_vertex is the
+ * number of vertices added before.
+ */
+void addMeshToObject(const voxblox::Mesh& mesh, Ogre::uint32 first_vertex,
+                     Ogre::ManualObject* ogre_object) {
+  for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+    // note calling position changes what vertex the color and normal calls
+    // point to
+    ogre_object->position(mesh.vertices[i].x(), mesh.vertices[i].y(),
+                          mesh.vertices[i].z());
+
+    ogre_object->normal(mesh.normals[i].x(), mesh.normals[i].y(),
+                        mesh.normals[i].z());
+
+    constexpr float color_conv_factor =
+        1.0f / std::numeric_limits<uint8_t>::max();
+    ogre_object->colour(
+        color_conv_factor * static_cast<float>(mesh.colors[i].r),
+        color_conv_factor * static_cast<float>(mesh.colors[i].g),
+        color_conv_factor * static_cast<float>(mesh.colors[i].b),
+        color_conv_factor * static_cast<float>(mesh.colors[i].a));
+  }
+
+  // needed for anything other than flat rendering
+  for (const voxblox::VertexIndex index : mesh.indices) {
+    ogre_object->index(first_vertex + static_cast<Ogre::uint32>(index));
+  }
+}
+
+}  // namespace
+
 unsigned int VoxbloxMeshVisual::instance_counter_ = 0;
 
 VoxbloxMeshVisual::VoxbloxMeshVisual(Ogre::SceneManager* scene_manager,
-                                     Ogre::SceneNode* parent_node) {
+                                     Ogre::SceneNode* parent_node)
+    : camera_position_(Ogre::Vector3::ZERO), lod_distance_(0.0f) {
   scene_manager_ = scene_manager;
   frame_node_ = parent_node->createChildSceneNode();
   instance_number_ = instance_counter_++;
@@ -24,6 +197,10 @@ VoxbloxMeshVisual::~VoxbloxMeshVisual() {
        object_map_) {
     scene_manager_->destroyManualObject(ogre_object.second);
   }
+  for (std::pair<const voxblox::BlockIndex, Ogre::ManualObject*> ogre_object :
+       batch_object_map_) {
+    scene_manager_->destroyManualObject(ogre_object.second);
+  }
 }
 
 void VoxbloxMeshVisual::setMessage(const voxblox_msgs::Mesh::ConstPtr& msg) {
@@ -31,134 +208,234 @@ void VoxbloxMeshVisual::setMessage(const voxblox_msgs::Mesh::ConstPtr& msg) {
     const voxblox::BlockIndex index(mesh_block.index[0], mesh_block.index[1],
                                     mesh_block.index[2]);
 
-    size_t vertex_index = 0u;
-    voxblox::Mesh mesh;
-    mesh.vertices.reserve(mesh_block.x.size());
-    mesh.indices.reserve(mesh_block.x.size());
-
-    // translate vertex data from message to voxblox mesh
-    for (size_t i = 0; i < mesh_block.x.size(); ++i) {
-      // Each vertex is given as its distance from the blocks origin in units of
-      // (2*block_size), see mesh_vis.h for the slightly convoluted
-      // justification of the 2.
-      constexpr float point_conv_factor =
-          2.0f / std::numeric_limits<uint16_t>::max();
-      const float mesh_x =
-          (static_cast<float>(mesh_block.x[i]) * point_conv_factor +
-           static_cast<float>(index[0])) *
-          msg->block_edge_length;
-      const float mesh_y =
-          (static_cast<float>(mesh_block.y[i]) * point_conv_factor +
-           static_cast<float>(index[1])) *
-          msg->block_edge_length;
-      const float mesh_z =
-          (static_cast<float>(mesh_block.z[i]) * point_conv_factor +
-           static_cast<float>(index[2])) *
-          msg->block_edge_length;
-
-      mesh.indices.push_back(vertex_index++);
-      mesh.vertices.emplace_back(mesh_x, mesh_y, mesh_z);
-    }
-
-    // calculate normals
-    mesh.normals.reserve(mesh.vertices.size());
-    for (size_t i = 0; i < mesh.vertices.size(); i += 3) {
-      const voxblox::Point dir0 = mesh.vertices[i] - mesh.vertices[i + 1];
-      const voxblox::Point dir1 = mesh.vertices[i] - mesh.vertices[i + 2];
-      const voxblox::Point normal = dir0.cross(dir1).normalized();
-
-      mesh.normals.push_back(normal);
-      mesh.normals.push_back(normal);
-      mesh.normals.push_back(normal);
-    }
-
-    // add color information
-    mesh.colors.reserve(mesh.vertices.size());
-    const bool has_color = mesh_block.x.size() == mesh_block.r.size();
-    for (size_t i = 0; i < mesh_block.x.size(); ++i) {
-      voxblox::Color color;
-      if (has_color) {
-        color.r = mesh_block.r[i];
-        color.g = mesh_block.g[i];
-        color.b = mesh_block.b[i];
-
-      } else {
-        // reconstruct normals coloring
-        color.r = std::numeric_limits<uint8_t>::max() *
-                  (mesh.normals[i].x() * 0.5f + 0.5f);
-        color.g = std::numeric_limits<uint8_t>::max() *
-                  (mesh.normals[i].y() * 0.5f + 0.5f);
-        color.b = std::numeric_limits<uint8_t>::max() *
-                  (mesh.normals[i].z() * 0.5f + 0.5f);
+    // delete empty mesh blocks
+    if (mesh_block.x.empty() && mesh_block.lods.empty()) {
+      removeBlock(index);
+      continue;
+    }
+
+    std::vector<std::shared_ptr<voxblox::Mesh>> levels;
+    if (!mesh_block.x.empty()) {
+      levels.push_back(std::make_shared<voxblox::Mesh>());
+      decodeMeshBlock(mesh_block, index, msg->block_edge_length,
+                      levels.back().get());
+    }
+    for (const voxblox_msgs::MeshLod& lod : mesh_block.lods) {
+      if (levels.size() <= lod.level) {
+        levels.resize(lod.level + 1u);
       }
-      color.a = std::numeric_limits<uint8_t>::max();
-      mesh.colors.push_back(color);
-    }
-
-    // connect mesh
-    voxblox::Mesh connected_mesh;
-    voxblox::createConnectedMesh(mesh, &connected_mesh);
-
-    // create ogre object
-    Ogre::ManualObject* ogre_object;
-    const voxblox::AnyIndexHashMapType<
-        Ogre::ManualObject*>::type::const_iterator it = object_map_.find(index);
-    if (it != object_map_.end()) {
-      // delete empty mesh blocks
-      if (mesh_block.x.size() == 0) {
-        scene_manager_->destroyManualObject(it->second);
-        object_map_.erase(it);
-        continue;
+      levels[lod.level] = std::make_shared<voxblox::Mesh>();
+      decodeMeshLod(lod, index, msg->block_edge_length,
+                    levels[lod.level].get());
+    }
+
+    BlockMeshes& block_meshes = block_meshes_[index];
+    if (block_meshes.levels.empty()) {
+      batch_blocks_[getBatchIndex(index)].push_back(index);
+    }
+    block_meshes.levels = levels;
+    block_meshes.center =
+        (index.cast<voxblox::FloatingPoint>().array() + 0.5f).matrix() *
+        msg->block_edge_length;
+    block_meshes.changed = true;
+  }
+
+  updateLevelsOfDetail(false);
+}
+
+void VoxbloxMeshVisual::setCameraPosition(const Ogre::Vector3& camera_position,
+                                          float lod_distance) {
+  const Ogre::Vector3 camera_position_in_frame =
+      frame_node_->convertWorldToLocalPosition(camera_position);
+  // Only update when the camera moved enough to change levels.
+  if (lod_distance == lod_distance_ &&
+      (lod_distance <= 0.0f ||
+       camera_position_in_frame.distance(camera_position_) <
+           kCameraMoveFraction * lod_distance)) {
+    return;
+  }
+  camera_position_ = camera_position_in_frame;
+  lod_distance_ = lod_distance;
+  updateLevelsOfDetail(true);
+}
+
+void VoxbloxMeshVisual::updateLevelsOfDetail(bool update_all) {
+  const voxblox::Point camera_position(camera_position_.x, camera_position_.y,
+                                       camera_position_.z);
+  for (std::pair<const voxblox::BlockIndex, BlockMeshes>& block :
+       block_meshes_) {
+    BlockMeshes& block_meshes = block.second;
+    if (!update_all && !block_meshes.changed) {
+      continue;
+    }
+
+    // The level for the distance to the camera.
+    const float distance = (block_meshes.center - camera_position).norm();
+    const bool in_batch = lod_distance_ > 0.0f && distance >= lod_distance_;
+    int level = 0;
+    if (in_batch) {
+      level = 1 + static_cast<int>(std::log2(distance / lod_distance_));
+    }
+    // Or the closest level the block has, preferably finer.
+    const int num_levels = static_cast<int>(block_meshes.levels.size());
+    level = std::min(level, num_levels - 1);
+    int shown_level = level;
+    while (shown_level >= 0 && !block_meshes.levels[shown_level]) {
+      --shown_level;
+    }
+    if (shown_level < 0) {
+      shown_level = level;
+      while (!block_meshes.levels[shown_level]) {
+        ++shown_level;
       }
+    }
+    if (in_batch == block_meshes.in_batch &&
+        shown_level == block_meshes.shown_level && !block_meshes.changed) {
+      continue;
+    }
 
-      ogre_object = it->second;
-      ogre_object->clear();
+    if (block_meshes.shown_level >= 0 && block_meshes.in_batch) {
+      dirty_batches_.insert(getBatchIndex(block.first));
+    }
+    if (in_batch) {
+      hideBlock(block.first);
+      dirty_batches_.insert(getBatchIndex(block.first));
     } else {
-      std::string object_name = std::to_string(index.x()) + std::string(" ") +
-                                std::to_string(index.y()) + std::string(" ") +
-                                std::to_string(index.z()) + std::string(" ") +
-                                std::to_string(instance_number_);
-      ogre_object = scene_manager_->createManualObject(object_name);
-      object_map_.insert(std::make_pair(index, ogre_object));
-
-      frame_node_->attachObject(ogre_object);
+      showBlock(block.first, *block_meshes.levels[shown_level]);
     }
+    block_meshes.shown_level = shown_level;
+    block_meshes.in_batch = in_batch;
+    block_meshes.changed = false;
+  }
 
-    DCHECK(ogre_object != nullptr);
+  for (const voxblox::BlockIndex& batch_index : dirty_batches_) {
+    rebuildBatch(batch_index);
+  }
+  dirty_batches_.clear();
+}
 
-    ogre_object->estimateVertexCount(connected_mesh.vertices.size());
-    ogre_object->estimateIndexCount(connected_mesh.indices.size());
-    ogre_object->begin("BaseWhiteNoLighting",
-                       Ogre::RenderOperation::OT_TRIANGLE_LIST);
+void VoxbloxMeshVisual::showBlock(const voxblox::BlockIndex& block_index,
+                                  const voxblox::Mesh& mesh) {
+  // create ogre object
+  Ogre::ManualObject* ogre_object;
+  const voxblox::AnyIndexHashMapType<Ogre::ManualObject*>::type::const_iterator
+      it = object_map_.find(block_index);
+  if (it != object_map_.end()) {
+    ogre_object = it->second;
+    ogre_object->clear();
+  } else {
+    ogre_object = createObject("", block_index);
+    object_map_.insert(std::make_pair(block_index, ogre_object));
+  }
 
-    for (size_t i = 0; i < connected_mesh.vertices.size(); ++i) {
-      // note calling position changes what vertex the color and normal calls
-      // point to
-      ogre_object->position(connected_mesh.vertices[i].x(),
-                            connected_mesh.vertices[i].y(),
-                            connected_mesh.vertices[i].z());
+  DCHECK(ogre_object != nullptr);
 
-      ogre_object->normal(connected_mesh.normals[i].x(),
-                          connected_mesh.normals[i].y(),
-                          connected_mesh.normals[i].z());
+  ogre_object->estimateVertexCount(mesh.vertices.size());
+  ogre_object->estimateIndexCount(mesh.indices.size());
+  ogre_object->begin("BaseWhiteNoLighting",
+                     Ogre::RenderOperation::OT_TRIANGLE_LIST);
+  addMeshToObject(mesh, 0u, ogre_object);
+  ogre_object->end();
+}
 
-      constexpr float color_conv_factor =
-          1.0f / std::numeric_limits<uint8_t>::max();
-      ogre_object->colour(
-          color_conv_factor * static_cast<float>(connected_mesh.colors[i].r),
-          color_conv_factor * static_cast<float>(connected_mesh.colors[i].g),
-          color_conv_factor * static_cast<float>(connected_mesh.colors[i].b),
-          color_conv_factor * static_cast<float>(connected_mesh.colors[i].a));
+void VoxbloxMeshVisual::hideBlock(const voxblox::BlockIndex& block_index) {
+  const voxblox::AnyIndexHashMapType<Ogre::ManualObject*>::type::const_iterator
+      it = object_map_.find(block_index);
+  if (it != object_map_.end()) {
+    scene_manager_->destroyManualObject(it->second);
+    object_map_.erase(it);
+  }
+}
+
+void VoxbloxMeshVisual::removeBlock(const voxblox::BlockIndex& block_index) {
+  hideBlock(block_index);
+
+  const voxblox::AnyIndexHashMapType<BlockMeshes>::type::const_iterator it =
+      block_meshes_.find(block_index);
+  if (it == block_meshes_.end()) {
+    return;
+  }
+  const voxblox::BlockIndex batch_index = getBatchIndex(block_index);
+  if (it->second.in_batch) {
+    dirty_batches_.insert(batch_index);
+  }
+  block_meshes_.erase(it);
+
+  voxblox::BlockIndexList& batch_blocks = batch_blocks_[batch_index];
+  batch_blocks.erase(
+      std::remove(batch_blocks.begin(), batch_blocks.end(), block_index),
+      batch_blocks.end());
+  if (batch_blocks.empty()) {
+    batch_blocks_.erase(batch_index);
+  }
+}
+
+void VoxbloxMeshVisual::rebuildBatch(const voxblox::BlockIndex& batch_index) {
+  std::vector<const voxblox::Mesh*> meshes;
+  size_t num_vertices = 0u;
+  size_t num_indices = 0u;
+  const voxblox::AnyIndexHashMapType<voxblox::BlockIndexList>::type::
+      const_iterator blocks_it = batch_blocks_.find(batch_index);
+  if (blocks_it != batch_blocks_.end()) {
+    for (const voxblox::BlockIndex& block_index : blocks_it->second) {
+      const BlockMeshes& block_meshes = block_meshes_.at(block_index);
+      if (block_meshes.in_batch && block_meshes.shown_level >= 0) {
+        meshes.push_back(block_meshes.levels[block_meshes.shown_level].get());
+        num_vertices += meshes.back()->vertices.size();
+        num_indices += meshes.back()->indices.size();
+      }
     }
+  }
 
-    // needed for anything other than flat rendering
-    for (const voxblox::VertexIndex index : connected_mesh.indices) {
-      ogre_object->index(index);
+  const voxblox::AnyIndexHashMapType<Ogre::ManualObject*>::type::const_iterator
+      it = batch_object_map_.find(batch_index);
+  if (meshes.empty()) {
+    if (it != batch_object_map_.end()) {
+      scene_manager_->destroyManualObject(it->second);
+      batch_object_map_.erase(it);
     }
+    return;
+  }
 
-    ogre_object->end();
+  Ogre::ManualObject* ogre_object;
+  if (it != batch_object_map_.end()) {
+    ogre_object = it->second;
+    ogre_object->clear();
+  } else {
+    ogre_object = createObject("batch ", batch_index);
+    batch_object_map_.insert(std::make_pair(batch_index, ogre_object));
   }
-}  // namespace voxblox_rviz_plugin
+
+  // Ogre switches to 32 bit indices if needed.
+  ogre_object->estimateVertexCount(num_vertices);
+  ogre_object->estimateIndexCount(num_indices);
+  ogre_object->begin("BaseWhiteNoLighting",
+                     Ogre::RenderOperation::OT_TRIANGLE_LIST);
+  Ogre::uint32 first_vertex = 0u;
+  for (const voxblox::Mesh* mesh : meshes) {
+    addMeshToObject(*mesh, first_vertex, ogre_object);
+    first_vertex += static_cast<Ogre::uint32>(mesh->vertices.size());
+  }
+  ogre_object->end();
+}
+
+voxblox::BlockIndex VoxbloxMeshVisual::getBatchIndex(
+    const voxblox::BlockIndex& block_index) const {
+  return voxblox::getGridIndexFromPoint<voxblox::BlockIndex>(
+      block_index.cast<voxblox::FloatingPoint>(), 1.0f / kBatchBlocksPerSide);
+}
+
+Ogre::ManualObject* VoxbloxMeshVisual::createObject(
+    const std::string& prefix, const voxblox::BlockIndex& index) {
+  std::string object_name = prefix + std::to_string(index.x()) +
+                            std::string(" ") + std::to_string(index.y()) +
+                            std::string(" ") + std::to_string(index.z()) +
+                            std::string(" ") + std::to_string(instance_number_);
+  Ogre::ManualObject* ogre_object =
+      scene_manager_->createManualObject(object_name);
+  frame_node_->attachObject(ogre_object);
+  return ogre_object;
+}
 
 void VoxbloxMeshVisual::setFramePosition(const Ogre::Vector3& position) {
   frame_node_->setPosition(position);
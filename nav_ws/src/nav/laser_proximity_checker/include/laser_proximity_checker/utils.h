@@ -20,9 +20,94 @@
 #include <pcl/kdtree/kdtree_flann.h>
 
 #include <limits>
+#include <vector>
+#include <algorithm>
+#include <string.h>
+#include <arpa/inet.h>
 #include <pcl/point_types.h>
 
 
+///	\class PointCloud2Layout
+///	\author Luigi Freda
+///	\brief Offsets of the x, y, z (and intensity) fields of a PointCloud2: the fields are looked up only when the layout of the received cloud changes
+///	\note 
+/// \todo 
+///	\date
+///	\warning
+struct PointCloud2Layout
+{
+    PointCloud2Layout():point_step(0), x_offset(0), y_offset(4), z_offset(8), intensity_offset(12), b_has_intensity(false), b_valid(false) {}
+
+    // update the offsets if the layout of the cloud differs from the cached one; return false if x, y, z are not float32 fields in the host byte order 
+    bool update(const sensor_msgs::PointCloud2& cloud)
+    {
+        if (b_valid && (cloud.point_step == point_step) && hasSameFields(cloud.fields)) return true; /// < EXIT POINT
+
+        fields = cloud.fields;
+        point_step = cloud.point_step;
+        x_offset = 0;
+        y_offset = 4;
+        z_offset = 8;
+        intensity_offset = 12;
+        b_has_intensity = false;
+        int num_xyz_fields = 0;
+        bool b_float_xyz = true;
+        for (size_t j = 0; j < fields.size(); j++)
+        {
+            const sensor_msgs::PointField& field = fields[j];
+            const bool b_float = (field.datatype == sensor_msgs::PointField::FLOAT32);
+            if (field.name == "x")
+            {
+                x_offset = field.offset; num_xyz_fields++; b_float_xyz &= b_float;
+            }
+            else if (field.name == "y")
+            {
+                y_offset = field.offset; num_xyz_fields++; b_float_xyz &= b_float;
+            }
+            else if (field.name == "z")
+            {
+                z_offset = field.offset; num_xyz_fields++; b_float_xyz &= b_float;
+            }
+            else if ((field.name == "intensity") && b_float)
+            {
+                intensity_offset = field.offset; b_has_intensity = true;
+            }
+        }
+        const bool b_host_big_endian = (htonl(1) == 1);
+        b_valid = (num_xyz_fields == 3) && b_float_xyz && (bool(cloud.is_bigendian) == b_host_big_endian) &&
+                  (std::max(std::max(x_offset, y_offset), z_offset) + sizeof(float) <= point_step);
+        if (!b_valid) ROS_WARN_STREAM_THROTTLE(5, "[LPC] unsupported point cloud layout (x, y, z must be float32 in host byte order)");
+        return b_valid;
+    }
+
+    bool hasSameFields(const std::vector<sensor_msgs::PointField>& other) const
+    {
+        if (other.size() != fields.size()) return false; /// < EXIT POINT
+        for (size_t j = 0; j < fields.size(); j++)
+        {
+            if ((other[j].offset != fields[j].offset) || (other[j].datatype != fields[j].datatype) || (other[j].name != fields[j].name)) return false; /// < EXIT POINT
+        }
+        return true;
+    }
+
+    static float readFloat(const uint8_t* p)
+    {
+        float v;
+        memcpy(&v, p, sizeof(float)); // unaligned load 
+        return v;
+    }
+
+    std::vector<sensor_msgs::PointField> fields; // cached layout 
+    uint32_t point_step;
+    uint32_t x_offset;
+    uint32_t y_offset;
+    uint32_t z_offset;
+    uint32_t intensity_offset;
+    bool b_has_intensity;
+    bool b_valid;
+};
+
+
 void downsamplePointcloud(const float leaf_size,
                           const sensor_msgs::PointCloud2& cloud_in,
                           sensor_msgs::PointCloud2& cloud_out)
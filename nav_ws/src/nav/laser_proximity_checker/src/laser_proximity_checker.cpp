@@ -150,6 +150,12 @@ protected:
     //! Current aggregated point cloud
     sensor_msgs::PointCloud2 obst_point_cloud;
 
+    //! Cached field layout of the input scans 
+    PointCloud2Layout scan_layout;
+
+    //! Cached field layout of the point cloud checked for proximity 
+    PointCloud2Layout proximity_layout;
+
     //! Previous absolute value of the laser angle (to detect when to publish)
     double previous_angle;
 
@@ -336,64 +342,33 @@ void LaserProximityChecker::extract_laser_scan(const sensor_msgs::PointCloud2& p
     last_scan.header.stamp = ptcld.header.stamp;
 
     // reset array values
-    unsigned int i;
-    for (i = 0; i < 541; i++)
-    {
-        last_scan.ranges[i] = last_scan.range_max + 1;
-        last_scan.intensities[i] = 0;
-    }
+    std::fill(last_scan.ranges.begin(), last_scan.ranges.end(), last_scan.range_max + 1);
+    std::fill(last_scan.intensities.begin(), last_scan.intensities.end(), 0.f);
 
-    // getting information to parse the point cloud
-    unsigned int pt_step = ptcld.point_step; // size of the poitn structure
-    // offsets of the relevent fields (init values)
-    unsigned int pt_x = 0;
-    unsigned int pt_y = 4;
-    unsigned int pt_z = 8;
-    unsigned int pt_int = 12;
-    // getting real values
-    // TODO check that the size and type are correct
-    for (unsigned int j = 0; j < ptcld.fields.size(); j++)
-    {
-        if (!ptcld.fields[j].name.compare("x"))
-        {
-            pt_x = ptcld.fields[j].offset;
-        }
-        else if (!ptcld.fields[j].name.compare("y"))
-        {
-            pt_y = ptcld.fields[j].offset;
-        }
-        else if (!ptcld.fields[j].name.compare("z"))
-        {
-            pt_z = ptcld.fields[j].offset;
-        }
-        else if (!ptcld.fields[j].name.compare("intensity"))
-        {
-            pt_int = ptcld.fields[j].offset;
-        }
-    }
+    // getting information to parse the point cloud (the fields are looked up only when the layout changes)
+    if (!scan_layout.update(ptcld)) return; /// < EXIT POINT
+    
+    const int num_ranges = last_scan.ranges.size();
+    const size_t pt_step = scan_layout.point_step; // size of the point structure
+    const size_t num_points = std::min<size_t>(ptcld.width * ptcld.height, ptcld.data.size() / pt_step);
+    const uint8_t* p_x = &ptcld.data[0] + scan_layout.x_offset;
+    const uint8_t* p_y = &ptcld.data[0] + scan_layout.y_offset;
+    const uint8_t* p_z = &ptcld.data[0] + scan_layout.z_offset;
+    const uint8_t* p_int = &ptcld.data[0] + scan_layout.intensity_offset;
 
     // traverse point cloud
-    for (i = 0; i < ptcld.width; i++)
+    for (size_t i = 0; i < num_points; i++, p_x += pt_step, p_y += pt_step, p_z += pt_step, p_int += pt_step)
     {
-        float x, y, z, intensity; // fields from the point
-        // unpacking values (TODO check endianness)
-        std::copy(reinterpret_cast<const char*> (&ptcld.data[i * pt_step + pt_x]),
-                  reinterpret_cast<const char*> (&ptcld.data[i * pt_step + pt_x + 4]),
-                  reinterpret_cast<char*> (&x));
-        std::copy(reinterpret_cast<const char*> (&ptcld.data[i * pt_step + pt_y]),
-                  reinterpret_cast<const char*> (&ptcld.data[i * pt_step + pt_y + 4]),
-                  reinterpret_cast<char*> (&y));
-        std::copy(reinterpret_cast<const char*> (&ptcld.data[i * pt_step + pt_z]),
-                  reinterpret_cast<const char*> (&ptcld.data[i * pt_step + pt_z + 4]),
-                  reinterpret_cast<char*> (&z));
-        std::copy(reinterpret_cast<const char*> (&ptcld.data[i * pt_step + pt_int]),
-                  reinterpret_cast<const char*> (&ptcld.data[i * pt_step + pt_int + 4]),
-                  reinterpret_cast<char*> (&intensity));
+        // unpacking values 
+        const float x = PointCloud2Layout::readFloat(p_x);
+        const float y = PointCloud2Layout::readFloat(p_y);
+        const float z = PointCloud2Layout::readFloat(p_z);
+        const float intensity = scan_layout.b_has_intensity ? PointCloud2Layout::readFloat(p_int) : 0.f;
         // computing angle, index and distance
         const float d = sqrt(x * x + y * y + z * z);
         const float angle = atan2(y, x);
         const int index = static_cast<int> (round((angle - last_scan.angle_min) / last_scan.angle_increment));
-        assert((index >= 0)&&(index < 541));
+        if ((index < 0) || (index >= num_ranges)) continue; /// < CONTINUE
 
         // setting distance and intensity in point cloud
         last_scan.ranges[index] = d;
@@ -623,82 +598,44 @@ bool LaserProximityChecker::check_proximity(const sensor_msgs::PointCloud2& ptcl
     //obst_point_cloud.row_step = ptcld.row_step;  // filled below     
     obst_point_cloud.is_bigendian = ptcld.is_bigendian;
     obst_point_cloud.data.clear();
+    obst_point_cloud.data.reserve(ptcld.data.size()); // the capacity is kept across calls 
         
-    // getting information to parse the point cloud
-    unsigned int pt_step = ptcld.point_step; // size of the point structure
-    // offsets of the relevent fields (init values)
-    unsigned int pt_x_offset   = 0;
-    unsigned int pt_y_offset   = 4;
-    unsigned int pt_z_offset   = 8;
-    unsigned int pt_int_offset = 12;
-    for (unsigned int j = 0; j < ptcld.fields.size(); j++)
+    // getting information to parse the point cloud (the fields are looked up only when the layout changes)
+    if (!proximity_layout.update(ptcld)) 
     {
-        if (!ptcld.fields[j].name.compare("x"))
-        {
-            pt_x_offset = ptcld.fields[j].offset;
-        }
-        else if (!ptcld.fields[j].name.compare("y"))
-        {
-            pt_y_offset = ptcld.fields[j].offset;
-        }
-        else if (!ptcld.fields[j].name.compare("z"))
-        {
-            pt_z_offset = ptcld.fields[j].offset;
-        }
-        else if (!ptcld.fields[j].name.compare("intensity"))
-        {
-            pt_int_offset = ptcld.fields[j].offset;
-        }
+        obst_point_cloud.row_step = 0;
+        return false; /// < EXIT POINT
     }
     
-    // traverse point cloud
-    for (size_t i = 0; i < ptcld.width; i++)
+    const size_t pt_step = proximity_layout.point_step; // size of the point structure
+    const size_t num_points = std::min<size_t>(ptcld.width, ptcld.data.size() / pt_step);
+    const uint8_t* p_point = &ptcld.data[0]; 
+    const uint32_t x_offset = proximity_layout.x_offset;
+    const uint32_t y_offset = proximity_layout.y_offset;
+    const uint32_t z_offset = proximity_layout.z_offset;
+    const float min_proximity_dist_squared = min_proximity_distance_squared;
+    
+    // traverse point cloud with a fixed stride over the raw buffer
+    for (size_t i = 0; i < num_points; i++, p_point += pt_step)
     {
-        float x, y, z, intensity; // fields from the point
-
-        size_t i_x_pt_step_const = i * pt_step;
-        size_t i_x_pt_step       = i_x_pt_step_const;
-        
-        i_x_pt_step = i_x_pt_step_const + pt_x_offset; // i * pt_step + pt_x
-        std::copy(reinterpret_cast<const char*> (&ptcld.data[i_x_pt_step]),
-                  reinterpret_cast<const char*> (&ptcld.data[i_x_pt_step + 4]),
-                  reinterpret_cast<char*> (&x));
+        const float x = PointCloud2Layout::readFloat(p_point + x_offset);
+        const float y = PointCloud2Layout::readFloat(p_point + y_offset);
+        const float z = PointCloud2Layout::readFloat(p_point + z_offset);
+
+        const float dist_squared = x*x + y*y;
+        const bool b_in_region = (z > kZMin) & (z < kZMax) &
+                                 (x > kXMin);             // filter out close point (this also implies !((fabs(y) < kYmin) && (x < kXMin)))
+        if (!b_in_region || !(dist_squared < min_proximity_dist_squared)) continue; /// < CONTINUE
         
-        i_x_pt_step = i_x_pt_step_const + pt_y_offset;
-        std::copy(reinterpret_cast<const char*> (&ptcld.data[i_x_pt_step]),
-                  reinterpret_cast<const char*> (&ptcld.data[i_x_pt_step + 4]),
-                  reinterpret_cast<char*> (&y));
-        
-        i_x_pt_step = i_x_pt_step_const + pt_z_offset;
-        std::copy(reinterpret_cast<const char*> (&ptcld.data[i_x_pt_step]),
-                  reinterpret_cast<const char*> (&ptcld.data[i_x_pt_step + 4]),
-                  reinterpret_cast<char*> (&z));
-
-        if( 
-            (z > kZMin) && (z < kZMax) &&
-            (x > kXMin) &&                         // filter out close point 
-            !( (fabs(y) < kYmin) && (x < kXMin))   // filter out close point 
-          )
+        b_proximity = true; 
+        if (min_dist_squared > dist_squared) 
         {
-            float dist_squared = x*x + y*y;
-            //std::cout << "distance : " << sqrt(dist_squared) << ", z: " << z << std::endl; 
-            if (dist_squared < min_proximity_distance_squared) 
-            {
-                b_proximity = true; 
-                if(min_dist_squared > dist_squared) 
-                {
-                    min_dist_squared = dist_squared;
-                    z_dist_min = z;
-                }
-                    // ROS_WARN_STREAM("[LPC] proximity detected ");
-                    // std::cout << "distance : " << sqrt(dist_squared) << ", z: " << z << std::endl; 
-                    
-                //return true; /// < EXIT POINT 
-                
-                obst_point_cloud.width++; 
-                obst_point_cloud.data.insert(obst_point_cloud.data.end(), reinterpret_cast<const char*> (&ptcld.data[i_x_pt_step_const]), reinterpret_cast<const char*> (&ptcld.data[i_x_pt_step_const + ptcld.point_step]));
-            }
-        } 
+            min_dist_squared = dist_squared;
+            z_dist_min = z;
+        }
+
+        obst_point_cloud.width++; 
+        obst_point_cloud.data.insert(obst_point_cloud.data.end(), p_point, p_point + pt_step);
     }
     obst_point_cloud.row_step = obst_point_cloud.data.size()*obst_point_cloud.height;
     
@@ -743,14 +680,21 @@ void LaserProximityChecker::filter_obst_pcl_and_compute_closest_point()
     
     if(!pcl_cloud_out->empty())
     {
-        // get closest point 
-        pcl::KdTree<PointIn>::Ptr tree(new pcl::KdTreeFLANN<PointIn>); 
-        tree->setInputCloud(pcl_cloud_out); 
-        std::vector<int> nn_indices(1); 
-        std::vector<float> nn_dists(1); 
-        if( tree->nearestKSearch(PointIn(), 1, nn_indices, nn_dists) > 0)
+        // get closest point to the origin with a linear scan (a kd-tree built for a single query costs more than the scan) 
+        size_t closest_index = 0;
+        float closest_dist_squared = std::numeric_limits<float>::max();
+        for (size_t i = 0, iEnd = pcl_cloud_out->size(); i < iEnd; i++)
+        {
+            const PointIn& point = pcl_cloud_out->points[i];
+            const float dist_squared = point.x*point.x + point.y*point.y + point.z*point.z;
+            if (dist_squared < closest_dist_squared)
+            {
+                closest_dist_squared = dist_squared;
+                closest_index = i;
+            }
+        }
         {
-            PointIn& closest_point = pcl_cloud_out->points[nn_indices[0]];
+            PointIn& closest_point = pcl_cloud_out->points[closest_index];
             const float closest_point_distance = sqrt(closest_point.x*closest_point.x + closest_point.y*closest_point.y);// + closest_point.z*closest_point.z);
             const float distance_from_robot = std::max( closest_point_distance - robot_radius,0.f);
 
@@ -6,6 +6,9 @@
 #include <ros/ros.h>
 #include <sensor_msgs/PointCloud2.h>
 
+/// \brief Republishes the input clouds on a single topic. The input messages are
+/// forwarded by shared pointer: within a nodelet manager (see
+/// OctomapMuxNodelet) no copy or serialization takes place.
 class OctomapMux {
 
  public:
@@ -14,13 +17,13 @@ class OctomapMux {
   
  protected:
   /// \brief Callback for the dynamic cloud.
-  void dynamicCloudCallback(const sensor_msgs::PointCloud2& cloud_msg_in);
+  void dynamicCloudCallback(const sensor_msgs::PointCloud2ConstPtr& cloud_msg_in);
   
   /// \brief Callback for the point_map.
-  void pointMapCallback(const sensor_msgs::PointCloud2& cloud_msg_in);
+  void pointMapCallback(const sensor_msgs::PointCloud2ConstPtr& cloud_msg_in);
   
   /// \brief Callback for the cloud 3
-  void cloudCallback(const sensor_msgs::PointCloud2& cloud_msg_in);
+  void cloudCallback(const sensor_msgs::PointCloud2ConstPtr& cloud_msg_in);
   
 
  private:
@@ -20,7 +20,7 @@ OctomapMux::OctomapMux(ros::NodeHandle& n) : nh_(n) {
   mux_pub_ = nh_.advertise<sensor_msgs::PointCloud2>("/mux_point_cloud", kPubMessageQueueSize);
 }  
 
-void OctomapMux::dynamicCloudCallback(const sensor_msgs::PointCloud2& cloud_msg_in) {
+void OctomapMux::dynamicCloudCallback(const sensor_msgs::PointCloud2ConstPtr& cloud_msg_in) {
   std::cout << "OctomapMux::dynamicCloudCallback()" << std::endl; 
   mux_pub_mutex_.lock();
   mux_pub_.publish(cloud_msg_in);
@@ -28,7 +28,7 @@ void OctomapMux::dynamicCloudCallback(const sensor_msgs::PointCloud2& cloud_msg_
 }
 
 
-void OctomapMux::pointMapCallback(const sensor_msgs::PointCloud2& cloud_msg_in) {
+void OctomapMux::pointMapCallback(const sensor_msgs::PointCloud2ConstPtr& cloud_msg_in) {
   std::cout << "OctomapMux::pointMapCallback()" << std::endl; 
   mux_pub_mutex_.lock();
   mux_pub_.publish(cloud_msg_in);
@@ -36,7 +36,7 @@ void OctomapMux::pointMapCallback(const sensor_msgs::PointCloud2& cloud_msg_in)
 }
 
 /// \brief Callback for the cloud 3
-void OctomapMux::cloudCallback(const sensor_msgs::PointCloud2& cloud_msg_in)
+void OctomapMux::cloudCallback(const sensor_msgs::PointCloud2ConstPtr& cloud_msg_in)
 {
   std::cout << "OctomapMux::cloudCallback()" << std::endl; 
   mux_pub_mutex_.lock();
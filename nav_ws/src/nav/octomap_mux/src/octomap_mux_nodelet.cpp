@@ -0,0 +1,30 @@
+#include <memory>
+
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+
+#include "octomap_mux/octomap_mux.hpp"
+
+namespace octomap_mux {
+
+/// \brief Nodelet version of octomap_mux_node: loaded in the same manager of
+/// the producers and consumers of the clouds, the clouds are passed by pointer.
+class OctomapMuxNodelet : public nodelet::Nodelet {
+
+ public:
+  OctomapMuxNodelet() {}
+
+ private:
+  virtual void onInit() {
+    nh_ = getPrivateNodeHandle();
+    octomap_mux_.reset(new OctomapMux(nh_));
+  }
+
+  // Node handle (OctomapMux keeps a reference to it).
+  ros::NodeHandle nh_;
+  std::unique_ptr<OctomapMux> octomap_mux_;
+};
+
+} // namespace octomap_mux
+
+PLUGINLIB_EXPORT_CLASS(octomap_mux::OctomapMuxNodelet, nodelet::Nodelet)
@@ -25,50 +25,226 @@
 
 
 
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+
 #include <ros/ros.h>
 #include <tf/transform_broadcaster.h>
+#include <tf/transform_datatypes.h>
 #include <nav_msgs/Odometry.h>
+#include <geometry_msgs/PoseWithCovarianceStamped.h>
 
-static std::string topic = "/omron_ros_wheel/odom";
-static std::string parent_frame = "/odom";
-static std::string child_frame = "/base_link";
+// An odometry topic converted to the transform parent_frame -> child_frame.
+// Optionally, the pose with its covariance is republished on covariance_topic.
+struct OdomSource{
+  std::string topic;
+  std::string parent_frame;
+  std::string child_frame;
+  std::string covariance_topic;
 
-void odom_callback(const nav_msgs::OdometryConstPtr& odom){
-  static tf::TransformBroadcaster br;
-  tf::Transform tf;
-  geometry_msgs::Pose odom_pose = odom->pose.pose;
+  ros::Subscriber sub;
+  ros::Publisher covariance_pub;
 
-//  tf.setOrigin(tf::Vector3(odom_pose.position.x, odom_pose.position.y, odom_pose.position.z));
-//  tf::Quaternion quat;
-//  tf::quaternionMsgToTF(odom_pose.orientation, quat);
-//  tf.setRotation(quat);
-  tf::poseMsgToTF(odom_pose, tf);
+  // last received odometries, oldest first (used in the timed mode only)
+  std::deque<nav_msgs::OdometryConstPtr> buffer;
+};
 
-  tf::StampedTransform stamped_tf(tf, odom->header.stamp, parent_frame, child_frame);
+// Broadcasts the odometries of one or more robots as tf.
+// With publish_rate <= 0 (default), each odometry message is broadcast as soon as it is received.
+// With publish_rate > 0, a timer broadcasts all the sources at once, at the fixed rate: the pose of each source at
+// (now - time_delay) is interpolated in its odometry buffer, or extrapolated from its last two odometries for at
+// most max_extrapolation seconds, so the consumers get the tf at a steady rate regardless of the odometry rate.
+class Odom2Tf{
+public:
+  Odom2Tf(ros::NodeHandle& nh, ros::NodeHandle& private_nh);
 
-  br.sendTransform(stamped_tf);
-}
+private:
+  void addSource(const std::string& topic, const std::string& parent_frame, const std::string& child_frame,
+                 const std::string& covariance_topic);
 
-int main(int argc, char **argv){
+  void odomCallback(const nav_msgs::OdometryConstPtr& odom, OdomSource* source);
+  void timerCallback(const ros::TimerEvent& event);
 
-  ros::init(argc, argv, ros::this_node::getName());
-  ros::NodeHandle nh;
-  ros::NodeHandle private_nh("~");
+  // pose of the source at time stamp, returns false if there is no pose available
+  bool getPose(const OdomSource& source, const ros::Time& stamp, tf::Transform& tf, ros::Time& tf_stamp) const;
+
+  void publishCovariance(const OdomSource& source, const nav_msgs::Odometry& odom);
+
+private:
+  ros::NodeHandle nh_;
+  tf::TransformBroadcaster br_;
+  ros::Timer timer_;
+
+  std::vector<boost::shared_ptr<OdomSource> > sources_;
+
+  double publish_rate_ = 0.;
+  double time_delay_ = 0.;
+  double max_extrapolation_ = 0.1;
+  int buffer_size_ = 10;
+};
+
+Odom2Tf::Odom2Tf(ros::NodeHandle& nh, ros::NodeHandle& private_nh) : nh_(nh){
+  private_nh.getParam("publish_rate", publish_rate_);
+  private_nh.getParam("time_delay", time_delay_);
+  private_nh.getParam("max_extrapolation", max_extrapolation_);
+  private_nh.getParam("buffer_size", buffer_size_);
+  buffer_size_ = std::max(buffer_size_, 2);
 
   std::string robot_topic_prefix;
-  private_nh.getParam("odom_topic", topic);
+  private_nh.getParam("robot_topic_prefix", robot_topic_prefix);
+  ROS_INFO_STREAM("Topic prefix: " << robot_topic_prefix);
+
+  // list of sources {topic: <odom topic>, parent_frame: <frame>, child_frame: <frame>, covariance_topic: <topic>},
+  // the frames default to the parameters parent_frame and child_frame, covariance_topic is optional
+  std::string parent_frame = "/odom";
+  std::string child_frame = "/base_link";
   private_nh.getParam("parent_frame", parent_frame);
   private_nh.getParam("child_frame", child_frame);
-  private_nh.getParam("robot_topic_prefix", robot_topic_prefix);  
+
+  XmlRpc::XmlRpcValue sources;
+  if(private_nh.getParam("sources", sources) && sources.getType() == XmlRpc::XmlRpcValue::TypeArray){
+    for(int i = 0; i < sources.size(); i++){
+      XmlRpc::XmlRpcValue& item = sources[i];
+      if(item.getType() != XmlRpc::XmlRpcValue::TypeStruct || !item.hasMember("topic")){
+        ROS_ERROR_STREAM("odom2tf: skipping source " << i << ", it must be a struct with a topic");
+        continue;
+      }
+      std::string item_parent_frame = parent_frame;
+      std::string item_child_frame = child_frame;
+      std::string item_covariance_topic;
+      if(item.hasMember("parent_frame")) item_parent_frame = static_cast<std::string>(item["parent_frame"]);
+      if(item.hasMember("child_frame")) item_child_frame = static_cast<std::string>(item["child_frame"]);
+      if(item.hasMember("covariance_topic")) item_covariance_topic = static_cast<std::string>(item["covariance_topic"]);
+      addSource(static_cast<std::string>(item["topic"]), item_parent_frame, item_child_frame, item_covariance_topic);
+    }
+  }
+  else{
+    std::string topic = "/omron_ros_wheel/odom";
+    std::string covariance_topic;
+    private_nh.getParam("odom_topic", topic);
+    private_nh.getParam("covariance_topic", covariance_topic);
+    addSource(topic, parent_frame, child_frame, covariance_topic);
+  }
+
+  if(publish_rate_ > 0.){
+    ROS_INFO_STREAM("Publish rate: " << publish_rate_ << " Hz, time delay: " << time_delay_
+                    << " s, max extrapolation: " << max_extrapolation_ << " s");
+    timer_ = nh_.createTimer(ros::Duration(1. / publish_rate_), &Odom2Tf::timerCallback, this);
+  }
+}
+
+void Odom2Tf::addSource(const std::string& topic, const std::string& parent_frame, const std::string& child_frame,
+                        const std::string& covariance_topic){
+  boost::shared_ptr<OdomSource> source(new OdomSource);
+  source->topic = topic;
+  source->parent_frame = parent_frame;
+  source->child_frame = child_frame;
+  source->covariance_topic = covariance_topic;
 
   ROS_INFO_STREAM("Topic: " << topic);
-  ROS_INFO_STREAM("Topic prefix: " << robot_topic_prefix);   
   ROS_INFO_STREAM("Parent frame: " << parent_frame);
   ROS_INFO_STREAM("Child frame: " << child_frame);
- 
 
-  ros::Subscriber odom_sub = nh.subscribe(topic, 10, odom_callback);
+  if(!covariance_topic.empty()){
+    ROS_INFO_STREAM("Covariance topic: " << covariance_topic);
+    source->covariance_pub = nh_.advertise<geometry_msgs::PoseWithCovarianceStamped>(covariance_topic, 10);
+  }
+  source->sub = nh_.subscribe<nav_msgs::Odometry>(topic, 10, boost::bind(&Odom2Tf::odomCallback, this, _1, source.get()));
+  sources_.push_back(source);
+}
+
+void Odom2Tf::odomCallback(const nav_msgs::OdometryConstPtr& odom, OdomSource* source){
+  publishCovariance(*source, *odom);
+
+  if(publish_rate_ <= 0.){
+    tf::Transform tf;
+    tf::poseMsgToTF(odom->pose.pose, tf);
+    br_.sendTransform(tf::StampedTransform(tf, odom->header.stamp, source->parent_frame, source->child_frame));
+    return; /// < EXIT POINT
+  }
+
+  std::deque<nav_msgs::OdometryConstPtr>& buffer = source->buffer;
+  if(!buffer.empty() && odom->header.stamp <= buffer.back()->header.stamp){
+    // time jumped back (e.g. bag or simulation restart) or duplicate message
+    if(odom->header.stamp < buffer.back()->header.stamp) buffer.clear();
+    else return; /// < EXIT POINT
+  }
+  buffer.push_back(odom);
+  while((int)buffer.size() > buffer_size_) buffer.pop_front();
+}
+
+void Odom2Tf::timerCallback(const ros::TimerEvent& event){
+  const ros::Time stamp = ros::Time::now() - ros::Duration(time_delay_);
+
+  std::vector<tf::StampedTransform> transforms;
+  transforms.reserve(sources_.size());
+  for(size_t i = 0; i < sources_.size(); i++){
+    const OdomSource& source = *sources_[i];
+    tf::Transform tf;
+    ros::Time tf_stamp;
+    if(getPose(source, stamp, tf, tf_stamp)){
+      transforms.push_back(tf::StampedTransform(tf, tf_stamp, source.parent_frame, source.child_frame));
+    }
+  }
+  if(!transforms.empty()) br_.sendTransform(transforms);
+}
+
+bool Odom2Tf::getPose(const OdomSource& source, const ros::Time& stamp, tf::Transform& tf, ros::Time& tf_stamp) const{
+  const std::deque<nav_msgs::OdometryConstPtr>& buffer = source.buffer;
+  if(buffer.empty()) return false; /// < EXIT POINT
+
+  tf::Transform tf0, tf1;
+  ros::Time t0, t1;
+  if(buffer.size() == 1 || stamp <= buffer.front()->header.stamp){
+    // nothing to interpolate with: the oldest (or only) pose, with its own stamp
+    const nav_msgs::OdometryConstPtr& odom = (buffer.size() == 1) ? buffer.back() : buffer.front();
+    tf::poseMsgToTF(odom->pose.pose, tf);
+    tf_stamp = odom->header.stamp;
+    return true; /// < EXIT POINT
+  }
+
+  // find the two poses around stamp, or the last two if stamp is after the last pose
+  size_t i1 = 1;
+  while(i1 < buffer.size() - 1 && buffer[i1]->header.stamp < stamp) i1++;
+  t0 = buffer[i1 - 1]->header.stamp;
+  t1 = buffer[i1]->header.stamp;
+  tf::poseMsgToTF(buffer[i1 - 1]->pose.pose, tf0);
+  tf::poseMsgToTF(buffer[i1]->pose.pose, tf1);
+
+  // do not extrapolate beyond max_extrapolation from the last pose
+  tf_stamp = stamp;
+  const ros::Time max_stamp = t1 + ros::Duration(std::max(max_extrapolation_, 0.));
+  if(tf_stamp > max_stamp) tf_stamp = max_stamp;
+
+  const double alpha = (tf_stamp - t0).toSec() / (t1 - t0).toSec();
+  tf.setOrigin(tf0.getOrigin().lerp(tf1.getOrigin(), alpha));
+  tf.setRotation(tf0.getRotation().slerp(tf1.getRotation(), alpha).normalized());
+  return true;
+}
+
+void Odom2Tf::publishCovariance(const OdomSource& source, const nav_msgs::Odometry& odom){
+  if(source.covariance_topic.empty() || source.covariance_pub.getNumSubscribers() == 0) return; /// < EXIT POINT
+
+  geometry_msgs::PoseWithCovarianceStampedPtr msg(new geometry_msgs::PoseWithCovarianceStamped);
+  msg->header.stamp = odom.header.stamp;
+  msg->header.frame_id = source.parent_frame;
+  msg->pose = odom.pose;
+  source.covariance_pub.publish(msg);
+}
+
+int main(int argc, char **argv){
+
+  ros::init(argc, argv, ros::this_node::getName());
+  ros::NodeHandle nh;
+  ros::NodeHandle private_nh("~");
+
+  Odom2Tf odom2tf(nh, private_nh);
   ros::spin();
 
   return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,256 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BLOCK_HASH_MAP_H_
+#define BLOCK_HASH_MAP_H_
+
+#ifndef PCL_NO_PRECOMPILE
+#define PCL_NO_PRECOMPILE
+#endif 
+
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+#include <stdint.h>
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+
+#include "VoxelBinaryKey.h"
+
+
+///	\class BlockHashMap
+///	\author Luigi Freda
+///	\brief Point map stored by spatial blocks: a hash map from the block key (VoxelBinaryKey.h) to the points of the block.
+///	       A map update extracts only the points of the blocks it touches, processes them (e.g. by DynamicJoinPcl::joinPCL())
+///	       and replaces those blocks with the result: the cost of an update is proportional to the touched region and not to the map size.
+///	\note  the replaced blocks are marked as changed until clearChanged() is called (for publishing only the changed part of the map)
+/// 	\todo
+///	\date
+///	\warning not thread-safe
+template<typename PointT>
+class BlockHashMap
+{
+public:
+
+    typedef pcl::PointCloud<PointT> PointCloudT;
+    typedef uint64_t BlockKey;
+    typedef std::unordered_set<BlockKey> BlockKeySet;
+
+    static const double kDefaultBlockSize; // [m]
+
+protected:
+
+    struct Block
+    {
+        Block():b_changed(false) {}
+        std::vector<PointT, Eigen::aligned_allocator<PointT> > points;
+        bool b_changed;
+    };
+
+    typedef std::unordered_map<BlockKey, Block> BlockMap;
+
+public:
+
+    BlockHashMap(double block_size = kDefaultBlockSize):block_size_(block_size), num_points_(0) {}
+
+    // change the block size (the points are redistributed)
+    void setBlockSize(double block_size)
+    {
+        if (block_size == block_size_) return; /// < EXIT POINT
+        PointCloudT all;
+        toPointCloud(all);
+        clear();
+        block_size_ = block_size;
+        insert(all);
+    }
+
+    double getBlockSize() const { return block_size_; }
+
+    template<typename PointT2>
+    BlockKey getBlockKey(const PointT2& p) const { return voxelBinaryKey(p, block_size_); }
+
+    // add the keys of the existing blocks which intersect the cube containing the sphere (center, radius)
+    template<typename PointT2>
+    void getBlockKeysInSphere(const PointT2& center, double radius, BlockKeySet& keys) const
+    {
+        const int ix0 = (int)round((center.x - radius)/block_size_), ix1 = (int)round((center.x + radius)/block_size_);
+        const int iy0 = (int)round((center.y - radius)/block_size_), iy1 = (int)round((center.y + radius)/block_size_);
+        const int iz0 = (int)round((center.z - radius)/block_size_), iz1 = (int)round((center.z + radius)/block_size_);
+        pcl::PointXYZ p;
+        for (int ix = ix0; ix <= ix1; ix++)
+            for (int iy = iy0; iy <= iy1; iy++)
+                for (int iz = iz0; iz <= iz1; iz++)
+                {
+                    p.x = ix*block_size_;
+                    p.y = iy*block_size_;
+                    p.z = iz*block_size_;
+                    const BlockKey key = getBlockKey(p);
+                    if (blocks_.count(key)) keys.insert(key);
+                }
+    }
+
+    // add the keys of the blocks containing the points of the cloud (also the ones which do not exist yet)
+    template<typename PointT2>
+    void getBlockKeysOfPoints(const pcl::PointCloud<PointT2>& cloud, BlockKeySet& keys) const
+    {
+        for (size_t i = 0, iEnd = cloud.size(); i < iEnd; i++) keys.insert(getBlockKey(cloud[i]));
+    }
+
+    // append the points of the given blocks to out
+    void extract(const BlockKeySet& keys, PointCloudT& out) const
+    {
+        for (typename BlockKeySet::const_iterator it = keys.begin(); it != keys.end(); ++it)
+        {
+            typename BlockMap::const_iterator itb = blocks_.find(*it);
+            if (itb == blocks_.end()) continue; /// < CONTINUE
+            out.points.insert(out.points.end(), itb->second.points.begin(), itb->second.points.end());
+        }
+        updateCloudSize(out);
+    }
+
+    // remove the points of the given blocks and insert the new points (which are expected to lie in those blocks)
+    void replace(const BlockKeySet& keys, const PointCloudT& points)
+    {
+        for (typename BlockKeySet::const_iterator it = keys.begin(); it != keys.end(); ++it)
+        {
+            typename BlockMap::iterator itb = blocks_.find(*it);
+            if (itb == blocks_.end()) continue; /// < CONTINUE
+            num_points_ -= itb->second.points.size();
+            itb->second.points.clear();
+            itb->second.b_changed = true;
+        }
+        insert(points);
+        removeEmptyBlocks(keys);
+    }
+
+    // insert the points in their blocks
+    void insert(const PointCloudT& points)
+    {
+        for (size_t i = 0, iEnd = points.size(); i < iEnd; i++)
+        {
+            Block& block = blocks_[getBlockKey(points[i])];
+            block.points.push_back(points[i]);
+            block.b_changed = true;
+        }
+        num_points_ += points.size();
+    }
+
+    // replace all the points of the map with the cloud; add to changed_keys the keys of the blocks whose points changed (added, removed or modified)
+    void assign(const PointCloudT& cloud, BlockKeySet& changed_keys)
+    {
+        BlockMap new_blocks;
+        for (size_t i = 0, iEnd = cloud.size(); i < iEnd; i++)
+        {
+            new_blocks[getBlockKey(cloud[i])].points.push_back(cloud[i]);
+        }
+        for (typename BlockMap::iterator it = new_blocks.begin(); it != new_blocks.end(); ++it)
+        {
+            typename BlockMap::const_iterator itb = blocks_.find(it->first);
+            if ((itb == blocks_.end()) || !equalPoints(itb->second.points, it->second.points))
+            {
+                it->second.b_changed = true;
+                changed_keys.insert(it->first);
+            }
+        }
+        for (typename BlockMap::const_iterator it = blocks_.begin(); it != blocks_.end(); ++it)
+        {
+            if (!new_blocks.count(it->first)) changed_keys.insert(it->first);
+        }
+        blocks_.swap(new_blocks);
+        num_points_ = cloud.size();
+    }
+
+    // all the points of the map (the header of out is not changed)
+    void toPointCloud(PointCloudT& out) const
+    {
+        out.points.clear();
+        out.points.reserve(num_points_);
+        for (typename BlockMap::const_iterator it = blocks_.begin(); it != blocks_.end(); ++it)
+        {
+            out.points.insert(out.points.end(), it->second.points.begin(), it->second.points.end());
+        }
+        updateCloudSize(out);
+    }
+
+    // the points of the blocks changed since the last clearChanged()
+    void getChanged(PointCloudT& out) const
+    {
+        out.points.clear();
+        for (typename BlockMap::const_iterator it = blocks_.begin(); it != blocks_.end(); ++it)
+        {
+            if (!it->second.b_changed) continue; /// < CONTINUE
+            out.points.insert(out.points.end(), it->second.points.begin(), it->second.points.end());
+        }
+        updateCloudSize(out);
+    }
+
+    void clearChanged()
+    {
+        for (typename BlockMap::iterator it = blocks_.begin(); it != blocks_.end(); ++it) it->second.b_changed = false;
+    }
+
+    void clear()
+    {
+        blocks_.clear();
+        num_points_ = 0;
+    }
+
+    size_t size() const { return num_points_; }
+    size_t getNumBlocks() const { return blocks_.size(); }
+
+protected:
+
+    void removeEmptyBlocks(const BlockKeySet& keys)
+    {
+        for (typename BlockKeySet::const_iterator it = keys.begin(); it != keys.end(); ++it)
+        {
+            typename BlockMap::iterator itb = blocks_.find(*it);
+            if ((itb != blocks_.end()) && itb->second.points.empty()) blocks_.erase(itb);
+        }
+    }
+
+    // bytewise comparison: a point with different padding is just reported as changed
+    static bool equalPoints(const std::vector<PointT, Eigen::aligned_allocator<PointT> >& a, const std::vector<PointT, Eigen::aligned_allocator<PointT> >& b)
+    {
+        return (a.size() == b.size()) && (a.empty() || (memcmp(&a[0], &b[0], a.size()*sizeof(PointT)) == 0));
+    }
+
+    static void updateCloudSize(PointCloudT& cloud)
+    {
+        cloud.width = cloud.points.size();
+        cloud.height = 1;
+        cloud.is_dense = false;
+    }
+
+protected:
+
+    double block_size_;
+    BlockMap blocks_;
+    size_t num_points_;
+};
+
+template<typename PointT>
+const double BlockHashMap<PointT>::kDefaultBlockSize = 2.0; // [m]
+
+
+#endif //BLOCK_HASH_MAP_H_
@@ -50,6 +50,7 @@ using namespace path_planner;
 #include <Eigen/Dense>
 
 #include "KdTreeFLANN.h"
+#include "ScanArena.h"
 
 
 using namespace std;
@@ -119,6 +120,9 @@ private:
 
     std::vector<int> clusters_info_;
 
+    // temporaries of filterWallVoxelHash(), reused scan after scan
+    ScanArena arena_;
+
 private:
 
     bool inFilteredList(int p);
@@ -126,6 +130,9 @@ private:
     //void computeNormals();
 
     void filterWall();
+    
+    // same filter of filterWall() (after the downsampling) with a voxel hash of the points instead of the kd-tree radius searches
+    void filterWallVoxelHash();
 
     void elaborateCluster();
 
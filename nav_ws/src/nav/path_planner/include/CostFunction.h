@@ -30,9 +30,44 @@
 #include <pcl/point_types.h>
 #include <cstring>
 #include <limits>
+#include <vector>
+
+#include "ReservationTable.h"
 
 static const std::string CostFunctionNames[] = {"BaseCost","OriginalCost","TraversabilityCost","TraversabilityProdCost"};
 
+///	\struct CostBatch
+///	\author Luigi Freda
+///	\brief SoA input/output of BaseCostFunction::costBatch(): one entry for each candidate next node 
+///	\note 
+/// 	\todo 
+///	\date
+///	\warning
+struct CostBatch
+{
+    void resize(size_t n)
+    {
+        x.resize(n); y.resize(n); z.resize(n);
+        traversability.resize(n);
+        aux_utility.resize(n);
+        aux_conf.resize(n);
+        arrival_time.resize(n);
+        cost.resize(n);
+    }
+    
+    size_t size() const { return x.size(); }
+    
+    // input 
+    std::vector<float> x, y, z;
+    std::vector<float> traversability;
+    std::vector<float> aux_utility; // z of the 2D utility point 
+    std::vector<float> aux_conf;    // intensity of the 2D utility point
+    std::vector<double> arrival_time; // [s] expected arrival time at the node (only used with a reservation table)
+    
+    // output 
+    std::vector<float> cost;
+};
+
 ///	\class UtilityFunction
 ///	\author Luigi Freda
 ///	\brief Base class for utility function management: mixing traversability with an auxiliary function 
@@ -48,6 +83,7 @@ public:
     static const float kLamdaTravDefault; 
     static const float kLamdaAuxDefault; 
     static const float kLamdaDzDefault; 
+    static const float kLamdaReservationDefault; 
     static const double kEpsilon; 
             
 
@@ -72,6 +108,9 @@ public:
         
         time0_ = ros::Time::now();
         tau_exp_decay_ = std::numeric_limits<float>::max();
+        
+        reservation_robot_id_ = 0;
+        lambda_reservation_ = kLamdaReservationDefault;
     }
     
     virtual void initTime()
@@ -100,7 +139,18 @@ public:
         return dist(current,next) + heuristic(next, goal) + lambda_trav_*(traversability_cost-min_trav_cost_)/(range_trav_cost_+kEpsilon) + lambda_aux_*timeExpDecay()*aux_conf*(max_aux_utility_ - aux_utility)/(range_aux_utility_+kEpsilon);
     }
     
+    // compute batch.cost[i] = cost(current, next_i, goal, ...) for all the entries of the batch 
+    // the base version calls cost() for each entry; the derived classes provide vectorized versions (single precision, euclidean heuristic)
+    virtual void costBatch(const pcl::PointXYZI& current, const pcl::PointXYZI& goal, CostBatch& batch);
+    
+    // multiply batch.cost[i] by (1 + lambda_reservation*conflicts), where conflicts is the number of robots with a higher priority 
+    // which reserved the node at batch.arrival_time[i] (see ReservationTable); nothing is done if no reservation table is set
+    void applyReservationCost(CostBatch& batch);
+    
     virtual std::string getName() { return CostFunctionNames[type_]; }
+    
+    // create a new cost function of the input type (see CostFunctionType); the caller takes the ownership 
+    static BaseCostFunction* create(int type);
 
     
 public: // getters
@@ -127,6 +177,16 @@ public: // setters
     void SetLambdaAuxUtility(float val) { lambda_aux_ = val; }
     
     void SetTauExpDecay(float val) { tau_exp_decay_ = val; }
+    
+    // space-time reservations of the team (a null table disables them)
+    void SetReservationTable(const ReservationTable::Ptr& table, int robot_id, float lambda_reservation = kLamdaReservationDefault) 
+    { 
+        p_reservation_table_ = table; 
+        reservation_robot_id_ = robot_id; 
+        lambda_reservation_ = lambda_reservation; 
+    }
+    
+    bool HasReservationTable() const { return (bool)p_reservation_table_; }
         
 protected:
     
@@ -153,6 +213,11 @@ protected:
     float tau_exp_decay_;   // [s] exponential time constant for the decay 
     ros::Time time0_;
     
+    ReservationTable::Ptr p_reservation_table_; 
+    int reservation_robot_id_; 
+    float lambda_reservation_; 
+    std::vector<int> conflicts_; // scratch of applyReservationCost()
+    
     CostFunctionType type_; 
 };
 
@@ -178,6 +243,8 @@ public:
         return (dist(current,next) +  heuristic(next, goal) + lambda_dz_* fabs(current.z - next.z) )*(1. + lambda_trav_*(traversability_cost-min_trav_cost_)/(range_trav_cost_+kEpsilon) );
                 
     }
+    
+    void costBatch(const pcl::PointXYZI& current, const pcl::PointXYZI& goal, CostBatch& batch);
 };
 
 ///	\class TraversabilityCostFunction
@@ -199,6 +266,8 @@ public:
                 ( lambda_trav_*(traversability_cost-min_trav_cost_)/(range_trav_cost_+kEpsilon) 
                 + lambda_aux_*timeExpDecay()*aux_conf*(max_aux_utility_-aux_utility)/(range_aux_utility_+kEpsilon) +1.);
     }
+    
+    void costBatch(const pcl::PointXYZI& current, const pcl::PointXYZI& goal, CostBatch& batch);
 };
 
 ///	\class TraversabilityProdCostFunction
@@ -220,6 +289,8 @@ public:
                 ( lambda_trav_*(traversability_cost-min_trav_cost_)/(range_trav_cost_+kEpsilon) +1.)*
                 ( lambda_aux_*timeExpDecay()*aux_conf*(max_aux_utility_-aux_utility)/(range_aux_utility_+kEpsilon) +1. );
     }
+    
+    void costBatch(const pcl::PointXYZI& current, const pcl::PointXYZI& goal, CostBatch& batch);
 };
 
 
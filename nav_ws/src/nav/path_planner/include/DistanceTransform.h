@@ -0,0 +1,102 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DISTANCE_TRANSFORM_H_
+#define DISTANCE_TRANSFORM_H_
+
+#include <vector>
+#include <cmath>
+
+#include <Eigen/Dense>
+
+
+///	\class DistanceTransform
+///	\author Luigi Freda
+///	\brief Voxelized 3D Euclidean distance transform of a set of occupied points.
+///	       The exact squared distance transform of the voxel centers is computed with three separable 1D passes (Felzenszwalb-Huttenlocher),
+///	       each pass is parallelized over the grid lines. The distance of a query point is then trilinearly interpolated in O(1).
+///	\note  The grid covers a box set by init(); the distances are saturated at max_distance (this is also the value returned outside the box):
+///	       occupied points outside the box are ignored, hence the box should be larger than the query region by max_distance.
+/// 	\todo
+///	\date
+///	\warning the interpolated distance has an error of the order of the resolution
+class DistanceTransform
+{
+public:
+
+    static const size_t kMaxNumVoxels; // init() fails if the grid would be larger
+
+public:
+
+    DistanceTransform();
+
+    // allocate the grid covering the box [min_point, max_point] and mark all the voxels as free; return false if the grid is too large
+    bool init(const Eigen::Vector3f& min_point, const Eigen::Vector3f& max_point, float resolution, float max_distance);
+
+    // mark the voxel of the point as occupied (it is ignored if it is outside the grid)
+    template<typename PointT>
+    void addOccupied(const PointT& p)
+    {
+        int ix, iy, iz;
+        if (!getVoxel(p.x, p.y, p.z, ix, iy, iz)) return; /// < EXIT POINT
+        grid_[index(ix, iy, iz)] = 0;
+        num_occupied_++;
+    }
+
+    // compute the distance transform of the occupied voxels (num_threads <= 0: OpenMP default)
+    void compute(int num_threads = 0);
+
+    // trilinearly interpolated distance [m] from the closest occupied voxel, saturated at max_distance
+    float getDistance(float x, float y, float z) const;
+
+    bool isReady() const { return b_ready_; }
+    size_t getNumOccupied() const { return num_occupied_; }
+    size_t getNumVoxels() const { return grid_.size(); }
+
+protected:
+
+    size_t index(int ix, int iy, int iz) const { return ((size_t)iz*size_[1] + iy)*size_[0] + ix; }
+
+    bool getVoxel(float x, float y, float z, int& ix, int& iy, int& iz) const
+    {
+        ix = (int)floor((x - origin_[0])/resolution_);
+        iy = (int)floor((y - origin_[1])/resolution_);
+        iz = (int)floor((z - origin_[2])/resolution_);
+        return (ix >= 0) && (iy >= 0) && (iz >= 0) && (ix < size_[0]) && (iy < size_[1]) && (iz < size_[2]);
+    }
+
+    // 1D squared distance transform of the n samples f (spaced by stride), in place; v, z are scratch buffers of size n and n+1
+    static void transform1D(float* f, int n, size_t stride, std::vector<float>& d, std::vector<int>& v, std::vector<float>& z);
+
+protected:
+
+    Eigen::Vector3f origin_;   // min corner of the grid
+    int size_[3];              // number of voxels along x, y, z
+    float resolution_;
+    float max_distance_;
+
+    std::vector<float> grid_;  // before compute(): 0 if occupied, large if free; after compute(): distance [m] of the voxel center
+
+    size_t num_occupied_;
+    bool b_ready_;
+};
+
+
+#endif //DISTANCE_TRANSFORM_H_
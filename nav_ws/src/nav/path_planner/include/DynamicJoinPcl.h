@@ -59,6 +59,8 @@
 
 #include <Eigen/Dense>
 
+#include "ScanArena.h"
+
 using namespace path_planner;
 
 struct Quad
@@ -159,9 +161,16 @@ private:
 
 	DynamicJoinPclConfig config;
 
+	ScanArena arena; // temporaries of joinPCL(), reused scan after scan
+
 	void statisticOutliersFilter(const PointCloud_In& in, PointCloud_In& out);
 	void deterministicOutliersFilter(const PointCloud_In& in, PointCloud_In& out);
 
+	// carve the old map bucket by bucket with the volume models fitted on the scan points of each spherical bucket
+	void joinBuckets(const PointCloud_In& pcl_scan_filtered, const PointCloud_Out& pcl_map_old, PointCloud_Out& pcl_map_new, const pcl::PointXYZ& laser_center, std::vector<Quad>& quads, int num_threads);
+	// carve the old map in a single pass against the range image of the scan (minimum range per pixel)
+	void joinRangeImage(const PointCloud_In& pcl_scan_filtered, const PointCloud_Out& pcl_map_old, PointCloud_Out& pcl_map_new, const pcl::PointXYZ& laser_center, int num_threads);
+
 public:
 	DynamicJoinPcl();
 	~DynamicJoinPcl();
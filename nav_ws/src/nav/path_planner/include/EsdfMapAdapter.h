@@ -0,0 +1,80 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ESDF_MAP_ADAPTER_H_
+#define ESDF_MAP_ADAPTER_H_
+
+#include <memory>
+#include <string>
+
+#include <boost/thread/recursive_mutex.hpp>
+
+#include <ros/ros.h>
+
+#include <Eigen/Dense>
+
+
+///	\class EsdfMapAdapter
+///	\author Luigi Freda
+///	\brief Clearance and collision queries on the ESDF map of a voxblox EsdfServer (topic esdf_map_out).
+///	       The received layer is kept up to date with the incremental layer messages; each distance query is an O(1)
+///	       (trilinearly interpolated) voxel lookup, and a segment is checked by sphere tracing.
+///	\note  voxblox is an optional dependency: if path_planner is built without it, the adapter never gets a map (isReady() is always false)
+///	       and the users fall back to their own backends.
+///	\date
+///	\warning the ESDF distances are saturated at the max distance of the EsdfServer (esdf_max_distance_m)
+class EsdfMapAdapter
+{
+public:
+
+    enum LineStatus { kFree = 0, kOccupied, kUnknown };
+
+public:
+
+    EsdfMapAdapter();
+    ~EsdfMapAdapter();
+
+    // true if path_planner has been built with voxblox
+    static bool isAvailable();
+
+    // subscribe to the ESDF layer topic
+    void init(ros::NodeHandle& nh, const std::string& topic);
+
+    // true once an ESDF map has been received
+    bool isReady() const;
+
+    // N.B.: the queries do not lock the map: the caller must hold this mutex (a single thread can hold it while many threads query the map)
+    boost::recursive_mutex& getMutex();
+
+    // interpolated distance [m] of the point from the closest obstacle (negative inside the obstacles); return false if the point is not observed
+    bool getDistance(const Eigen::Vector3d& point, double& distance) const;
+
+    // status of the segment [start, end] swept by a sphere of the given radius: kOccupied if the sphere hits an obstacle,
+    // kUnknown if the segment crosses unobserved space, kFree otherwise
+    LineStatus getLineStatus(const Eigen::Vector3d& start, const Eigen::Vector3d& end, double radius) const;
+
+protected:
+
+    struct Impl;
+    std::unique_ptr<Impl> p_impl_; // hides the voxblox types from the users of path_planner
+};
+
+
+#endif //ESDF_MAP_ADAPTER_H_
@@ -0,0 +1,594 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INCREMENTAL_KDTREE_H_
+#define INCREMENTAL_KDTREE_H_
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+#include <boost/shared_ptr.hpp>
+
+#include <pcl/point_cloud.h>
+
+#include "KdTreeBatchResult.h"
+
+
+namespace pp
+{
+
+///	\class IncrementalKdTree
+///	\author Luigi Freda
+///	\brief Dynamic 3D kd-tree of the points of a cloud (identified by their cloud index) supporting insertion, deletion, radius and k-nn search.
+///	       It has the same search interface of pp::KdTreeFLANN (sorted results), hence it can be used in its place (see KdTreeFLANN.h).
+///	       setInputCloud() builds a balanced tree; then the points can be inserted/removed/updated one by one without rebuilding the tree:
+///	       deleted points are only marked (lazy deletion) and a subtree is rebuilt only when it becomes unbalanced
+///	       (a child with more than kBalanceAlpha of its nodes) or when more than kDeletedBeta of its nodes have been deleted (scapegoat rebalancing).
+///	\note  the tree keeps its own copy of the point coordinates: the indexed cloud can be modified/released after an insertion
+///	       (the searches return the indices used in the insertions); the non-finite points are skipped as in pcl::KdTreeFLANN
+/// 	\todo
+///	\date
+///	\warning the const methods can be called concurrently, the non-const ones need exclusive access
+template <typename PointT>
+class IncrementalKdTree
+{
+public:
+
+    typedef pcl::PointCloud<PointT> PointCloud;
+    typedef typename PointCloud::ConstPtr PointCloudConstPtr;
+
+    typedef boost::shared_ptr<IncrementalKdTree<PointT> > Ptr;
+    typedef boost::shared_ptr<const IncrementalKdTree<PointT> > ConstPtr;
+
+    static const int kMinRebuildSize;   // smaller subtrees are never rebuilt
+    static const float kBalanceAlpha;   // max fraction of the nodes of a subtree in one of its children
+    static const float kDeletedBeta;    // max fraction of deleted nodes of a subtree
+
+public:
+
+    IncrementalKdTree(bool sorted = true):b_sorted_(sorted), root_(kNull), num_points_(0) {}
+
+    /// < building
+
+    // index all the (finite) points of the cloud with a balanced tree (the previous points are removed)
+    void setInputCloud(const PointCloudConstPtr& cloud)
+    {
+        clear();
+        input_ = cloud;
+        if (!cloud) return; /// < EXIT POINT
+
+        const PointCloud& pcl = *cloud;
+        const int n = (int)pcl.size();
+        positions_.resize(n);
+        node_of_point_.assign(n, kNull);
+        std::vector<int> point_ids;
+        point_ids.reserve(n);
+        for (int i = 0; i < n; i++)
+        {
+            if (!isFinite(pcl[i])) continue;
+            setPosition(i, pcl[i]);
+            point_ids.push_back(i);
+        }
+        nodes_.reserve(point_ids.size());
+        num_points_ = point_ids.size();
+        root_ = build(point_ids, 0, (int)point_ids.size());
+    }
+
+    PointCloudConstPtr getInputCloud() const { return input_; }
+
+    // remove all the points
+    void clear()
+    {
+        nodes_.clear();
+        free_nodes_.clear();
+        positions_.clear();
+        node_of_point_.clear();
+        root_ = kNull;
+        num_points_ = 0;
+        input_.reset();
+    }
+
+    // insert the point with the given index (if the index is already in the tree, the point is moved)
+    void insert(int index, const PointT& point)
+    {
+        if (!isFinite(point)) return; /// < EXIT POINT
+        if (contains(index)) remove(index);
+
+        if (index >= (int)positions_.size())
+        {
+            positions_.resize(index + 1);
+            node_of_point_.resize(index + 1, kNull);
+        }
+        setPosition(index, point);
+        num_points_++;
+
+        const float* p = positions_[index].xyz;
+        path_.clear();
+        int parent = kNull;
+        int node_id = root_;
+        while (node_id != kNull)
+        {
+            Node& node = nodes_[node_id];
+            node.size++;
+            node.extendBox(p);
+            path_.push_back(node_id);
+            parent = node_id;
+            node_id = (p[node.axis] < node.split) ? node.left : node.right;
+        }
+
+        const int new_node = newNode(index, (parent == kNull) ? 0 : (nodes_[parent].axis + 1) % 3);
+        if (parent == kNull)
+        {
+            root_ = new_node;
+        }
+        else
+        {
+            Node& parent_node = nodes_[parent];
+            if (p[parent_node.axis] < parent_node.split) parent_node.left = new_node;
+            else parent_node.right = new_node;
+        }
+
+        rebalancePath();
+    }
+
+    // insert the points of the cloud with the indices [first_index, first_index + cloud.size())
+    void insert(const PointCloud& cloud, int first_index)
+    {
+        for (size_t i = 0, iEnd = cloud.size(); i < iEnd; i++) insert(first_index + (int)i, cloud[i]);
+    }
+
+    // remove the point with the given index (lazy deletion); return false if it is not in the tree
+    bool remove(int index)
+    {
+        if (!contains(index)) return false; /// < EXIT POINT
+
+        const float* p = positions_[index].xyz;
+        const int target = node_of_point_[index];
+        path_.clear();
+        int node_id = root_;
+        while (node_id != target)
+        {
+            path_.push_back(node_id);
+            const Node& node = nodes_[node_id];
+            // points equal to the split value go right
+            node_id = (p[node.axis] < node.split) ? node.left : node.right;
+        }
+        path_.push_back(target);
+        for (size_t k = 0; k < path_.size(); k++) nodes_[path_[k]].num_deleted++;
+
+        nodes_[target].b_deleted = true;
+        node_of_point_[index] = kNull;
+        num_points_--;
+
+        rebalancePath();
+        return true;
+    }
+
+    // move the point with the given index
+    void update(int index, const PointT& point) { insert(index, point); }
+
+    bool contains(int index) const { return (index >= 0) && (index < (int)node_of_point_.size()) && (node_of_point_[index] != kNull); }
+
+    // number of indexed (not deleted) points
+    size_t size() const { return num_points_; }
+
+    /// < searches (the same interface of pcl::KdTree)
+
+    int nearestKSearch(const PointT& point, int k, std::vector<int>& k_indices, std::vector<float>& k_sqr_distances) const
+    {
+        k_indices.clear();
+        k_sqr_distances.clear();
+        if ((k <= 0) || (root_ == kNull) || !isFinite(point)) return 0; /// < EXIT POINT
+
+        const float q[3] = {point.x, point.y, point.z};
+        std::vector<Neighbor> heap;  // max-heap on the distance
+        heap.reserve(k + 1);
+        nearestKSearch(root_, q, (size_t)k, heap);
+
+        std::sort_heap(heap.begin(), heap.end());
+        copyResults(heap, k_indices, k_sqr_distances);
+        return (int)k_indices.size();
+    }
+
+    int radiusSearch(const PointT& point, double radius, std::vector<int>& k_indices, std::vector<float>& k_sqr_distances, unsigned int max_nn = 0) const
+    {
+        k_indices.clear();
+        k_sqr_distances.clear();
+        if ((root_ == kNull) || !isFinite(point)) return 0; /// < EXIT POINT
+
+        const float q[3] = {point.x, point.y, point.z};
+        const float radius2 = (float)(radius*radius);
+        std::vector<Neighbor> neighbors;
+        radiusSearch(root_, q, radius2, neighbors);
+
+        if (b_sorted_ || ((max_nn > 0) && (neighbors.size() > max_nn))) std::sort(neighbors.begin(), neighbors.end());
+        if ((max_nn > 0) && (neighbors.size() > max_nn)) neighbors.resize(max_nn);
+        copyResults(neighbors, k_indices, k_sqr_distances);
+        return (int)k_indices.size();
+    }
+
+    /// < batch searches (the same interface of pp::KdTreeFLANN: the queries are x, y, z triplets; they are run one by one and cores is ignored)
+
+    int getDimensions() const { return 3; }
+
+    int nearestKSearch(const float* queries, size_t num_queries, int k, KdTreeBatchResult& result, int /*cores*/ = 1) const
+    {
+        return batchSearch(queries, num_queries, result, [&](const PointT& p, std::vector<int>& idx, std::vector<float>& dist) { return nearestKSearch(p, k, idx, dist); });
+    }
+
+    int nearestKSearch(const PointCloud& cloud, const std::vector<int>& query_indices, int k, KdTreeBatchResult& result, int cores = 1) const
+    {
+        vectorizeQueries(cloud, query_indices, result);
+        return nearestKSearch(result.queries.data(), result.queries.size()/3, k, result, cores);
+    }
+
+    int radiusSearch(const float* queries, size_t num_queries, double radius, KdTreeBatchResult& result, unsigned int max_nn = 0, int /*cores*/ = 1) const
+    {
+        return batchSearch(queries, num_queries, result, [&](const PointT& p, std::vector<int>& idx, std::vector<float>& dist) { return radiusSearch(p, radius, idx, dist, max_nn); });
+    }
+
+    int radiusSearch(const PointCloud& cloud, const std::vector<int>& query_indices, double radius, KdTreeBatchResult& result, unsigned int max_nn = 0, int cores = 1) const
+    {
+        vectorizeQueries(cloud, query_indices, result);
+        return radiusSearch(result.queries.data(), result.queries.size()/3, radius, result, max_nn, cores);
+    }
+
+protected:
+
+    static void vectorizeQueries(const PointCloud& cloud, const std::vector<int>& query_indices, KdTreeBatchResult& result)
+    {
+        const size_t num_queries = query_indices.empty() ? cloud.size() : query_indices.size();
+        result.queries.resize(3*num_queries);
+        for (size_t q = 0; q < num_queries; q++)
+        {
+            const PointT& p = cloud[query_indices.empty() ? q : query_indices[q]];
+            result.queries[3*q] = p.x;
+            result.queries[3*q + 1] = p.y;
+            result.queries[3*q + 2] = p.z;
+        }
+    }
+
+    template <typename SearchT>
+    static int batchSearch(const float* queries, size_t num_queries, KdTreeBatchResult& result, const SearchT& search)
+    {
+        result.reset(num_queries);
+        if (result.row_indices.empty())
+        {
+            result.row_indices.resize(1);
+            result.row_sqr_distances.resize(1);
+        }
+        PointT p;
+        for (size_t q = 0; q < num_queries; q++)
+        {
+            p.x = queries[3*q];
+            p.y = queries[3*q + 1];
+            p.z = queries[3*q + 2];
+            search(p, result.row_indices[0], result.row_sqr_distances[0]);
+            result.indices.insert(result.indices.end(), result.row_indices[0].begin(), result.row_indices[0].end());
+            result.sqr_distances.insert(result.sqr_distances.end(), result.row_sqr_distances[0].begin(), result.row_sqr_distances[0].end());
+            result.offsets[q + 1] = (int)result.indices.size();
+        }
+        return (int)result.indices.size();
+    }
+
+    static const int kNull;
+
+    struct Position
+    {
+        float xyz[3];
+    };
+
+    struct Node
+    {
+        int point;           // cloud index of the point
+        int left, right;     // children (kNull if missing)
+        int axis;            // split axis
+        float split;         // split value (the point coordinate at the node creation: the point may be moved after its deletion)
+        int size;            // number of nodes of the subtree (included the deleted ones)
+        int num_deleted;     // number of deleted nodes of the subtree
+        bool b_deleted;
+        float box_min[3], box_max[3]; // bounding box of the subtree (it may be larger than the one of the not deleted points)
+
+        void extendBox(const float* p)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                box_min[k] = std::min(box_min[k], p[k]);
+                box_max[k] = std::max(box_max[k], p[k]);
+            }
+        }
+
+        float boxSquaredDistance(const float* q) const
+        {
+            float d2 = 0;
+            for (int k = 0; k < 3; k++)
+            {
+                const float d = (q[k] < box_min[k]) ? (box_min[k] - q[k]) : ((q[k] > box_max[k]) ? (q[k] - box_max[k]) : 0.f);
+                d2 += d*d;
+            }
+            return d2;
+        }
+    };
+
+    struct Neighbor
+    {
+        float sqr_distance;
+        int index;
+        bool operator<(const Neighbor& other) const { return sqr_distance < other.sqr_distance; }
+    };
+
+protected:
+
+    template <typename T>
+    static bool isFinite(const T& p) { return std::isfinite(p.x) && std::isfinite(p.y) && std::isfinite(p.z); }
+
+    void setPosition(int index, const PointT& point)
+    {
+        Position& position = positions_[index];
+        position.xyz[0] = point.x;
+        position.xyz[1] = point.y;
+        position.xyz[2] = point.z;
+    }
+
+    float squaredDistance(int index, const float* q) const
+    {
+        const float* p = positions_[index].xyz;
+        const float dx = p[0] - q[0], dy = p[1] - q[1], dz = p[2] - q[2];
+        return dx*dx + dy*dy + dz*dz;
+    }
+
+    int newNode(int index, int axis)
+    {
+        int node_id;
+        if (!free_nodes_.empty())
+        {
+            node_id = free_nodes_.back();
+            free_nodes_.pop_back();
+        }
+        else
+        {
+            node_id = (int)nodes_.size();
+            nodes_.push_back(Node());
+        }
+        Node& node = nodes_[node_id];
+        node.point = index;
+        node.left = node.right = kNull;
+        node.axis = axis;
+        node.split = positions_[index].xyz[axis];
+        node.size = 1;
+        node.num_deleted = 0;
+        node.b_deleted = false;
+        for (int k = 0; k < 3; k++) node.box_min[k] = node.box_max[k] = positions_[index].xyz[k];
+        node_of_point_[index] = node_id;
+        return node_id;
+    }
+
+    // build a balanced subtree of the points point_ids[begin, end) (the points are reordered); return the root
+    int build(std::vector<int>& point_ids, int begin, int end)
+    {
+        if (begin >= end) return kNull; /// < EXIT POINT
+
+        // split on the axis of max extent
+        float box_min[3], box_max[3];
+        for (int k = 0; k < 3; k++)
+        {
+            box_min[k] = std::numeric_limits<float>::max();
+            box_max[k] = -std::numeric_limits<float>::max();
+        }
+        for (int i = begin; i < end; i++)
+        {
+            const float* p = positions_[point_ids[i]].xyz;
+            for (int k = 0; k < 3; k++)
+            {
+                box_min[k] = std::min(box_min[k], p[k]);
+                box_max[k] = std::max(box_max[k], p[k]);
+            }
+        }
+        int axis = 0;
+        for (int k = 1; k < 3; k++)
+        {
+            if (box_max[k] - box_min[k] > box_max[axis] - box_min[axis]) axis = k;
+        }
+
+        int mid = begin + (end - begin)/2;
+        std::nth_element(point_ids.begin() + begin, point_ids.begin() + mid, point_ids.begin() + end, AxisLess(positions_, axis));
+        // the points equal to the split value must be on the right (as in the insertion descent)
+        const float split = positions_[point_ids[mid]].xyz[axis];
+        for (int i = begin; i < mid; )
+        {
+            if (positions_[point_ids[i]].xyz[axis] < split) { i++; continue; } /// < CONTINUE
+            mid--;
+            std::swap(point_ids[i], point_ids[mid]);
+        }
+
+        const int node_id = newNode(point_ids[mid], axis);
+        const int left = build(point_ids, begin, mid);
+        const int right = build(point_ids, mid + 1, end);
+
+        Node& node = nodes_[node_id];
+        node.left = left;
+        node.right = right;
+        node.size = end - begin;
+        for (int k = 0; k < 3; k++)
+        {
+            node.box_min[k] = box_min[k];
+            node.box_max[k] = box_max[k];
+        }
+        return node_id;
+    }
+
+    struct AxisLess
+    {
+        AxisLess(const std::vector<Position>& positions, int axis):positions_(positions), axis_(axis) {}
+        bool operator()(int a, int b) const { return positions_[a].xyz[axis_] < positions_[b].xyz[axis_]; }
+        const std::vector<Position>& positions_;
+        int axis_;
+    };
+
+    // collect the not deleted points of the subtree and release its nodes
+    void collect(int node_id, std::vector<int>& point_ids)
+    {
+        if (node_id == kNull) return; /// < EXIT POINT
+        const Node& node = nodes_[node_id];
+        if (!node.b_deleted) point_ids.push_back(node.point);
+        const int left = node.left, right = node.right;
+        free_nodes_.push_back(node_id);
+        collect(left, point_ids);
+        collect(right, point_ids);
+    }
+
+    bool needsRebuild(const Node& node) const
+    {
+        if (node.size < kMinRebuildSize) return false; /// < EXIT POINT
+        const int left_size = (node.left != kNull) ? nodes_[node.left].size : 0;
+        const int right_size = (node.right != kNull) ? nodes_[node.right].size : 0;
+        return (std::max(left_size, right_size) > kBalanceAlpha*node.size) || (node.num_deleted > kDeletedBeta*node.size);
+    }
+
+    // rebuild the topmost subtree of path_ (root to leaf) which needs it
+    void rebalancePath()
+    {
+        for (size_t k = 0; k < path_.size(); k++)
+        {
+            const int node_id = path_[k];
+            if (!needsRebuild(nodes_[node_id])) continue; /// < CONTINUE
+
+            const int num_deleted = nodes_[node_id].num_deleted;
+            std::vector<int> point_ids;
+            point_ids.reserve(nodes_[node_id].size - num_deleted);
+            collect(node_id, point_ids);
+            const int new_root = build(point_ids, 0, (int)point_ids.size());
+
+            if (k == 0)
+            {
+                root_ = new_root;
+            }
+            else
+            {
+                Node& parent = nodes_[path_[k - 1]];
+                if (parent.left == node_id) parent.left = new_root;
+                else parent.right = new_root;
+            }
+            // the deleted nodes have been dropped
+            for (size_t j = 0; j < k; j++)
+            {
+                Node& ancestor = nodes_[path_[j]];
+                ancestor.size -= num_deleted;
+                ancestor.num_deleted -= num_deleted;
+            }
+            return; /// < EXIT POINT
+        }
+    }
+
+    void nearestKSearch(int node_id, const float* q, size_t k, std::vector<Neighbor>& heap) const
+    {
+        const Node& node = nodes_[node_id];
+        if ((heap.size() == k) && (node.boxSquaredDistance(q) > heap.front().sqr_distance)) return; /// < EXIT POINT
+        if (node.size == node.num_deleted) return; /// < EXIT POINT
+
+        if (!node.b_deleted)
+        {
+            Neighbor neighbor;
+            neighbor.sqr_distance = squaredDistance(node.point, q);
+            neighbor.index = node.point;
+            if (heap.size() < k)
+            {
+                heap.push_back(neighbor);
+                std::push_heap(heap.begin(), heap.end());
+            }
+            else if (neighbor.sqr_distance < heap.front().sqr_distance)
+            {
+                std::pop_heap(heap.begin(), heap.end());
+                heap.back() = neighbor;
+                std::push_heap(heap.begin(), heap.end());
+            }
+        }
+
+        // visit first the child on the side of the query
+        const bool b_left_first = q[node.axis] < node.split;
+        const int first = b_left_first ? node.left : node.right;
+        const int second = b_left_first ? node.right : node.left;
+        if (first != kNull) nearestKSearch(first, q, k, heap);
+        if (second != kNull) nearestKSearch(second, q, k, heap);
+    }
+
+    void radiusSearch(int node_id, const float* q, float radius2, std::vector<Neighbor>& neighbors) const
+    {
+        const Node& node = nodes_[node_id];
+        if (node.boxSquaredDistance(q) > radius2) return; /// < EXIT POINT
+        if (node.size == node.num_deleted) return; /// < EXIT POINT
+
+        if (!node.b_deleted)
+        {
+            const float d2 = squaredDistance(node.point, q);
+            if (d2 <= radius2)
+            {
+                Neighbor neighbor;
+                neighbor.sqr_distance = d2;
+                neighbor.index = node.point;
+                neighbors.push_back(neighbor);
+            }
+        }
+        if (node.left != kNull) radiusSearch(node.left, q, radius2, neighbors);
+        if (node.right != kNull) radiusSearch(node.right, q, radius2, neighbors);
+    }
+
+    static void copyResults(const std::vector<Neighbor>& neighbors, std::vector<int>& k_indices, std::vector<float>& k_sqr_distances)
+    {
+        k_indices.resize(neighbors.size());
+        k_sqr_distances.resize(neighbors.size());
+        for (size_t i = 0; i < neighbors.size(); i++)
+        {
+            k_indices[i] = neighbors[i].index;
+            k_sqr_distances[i] = neighbors[i].sqr_distance;
+        }
+    }
+
+protected:
+
+    bool b_sorted_;
+
+    std::vector<Node> nodes_;
+    std::vector<int> free_nodes_;          // released node slots
+    std::vector<Position> positions_;      // positions_[index]: coordinates of the point with the given cloud index
+    std::vector<int> node_of_point_;       // node_of_point_[index]: node of the point (kNull if it is not in the tree)
+    int root_;
+    size_t num_points_;
+
+    std::vector<int> path_;                // scratch: root-to-node path of the last insertion/deletion
+
+    PointCloudConstPtr input_;
+};
+
+template <typename PointT>
+const int IncrementalKdTree<PointT>::kMinRebuildSize = 16;
+template <typename PointT>
+const float IncrementalKdTree<PointT>::kBalanceAlpha = 0.75f;
+template <typename PointT>
+const float IncrementalKdTree<PointT>::kDeletedBeta = 0.5f;
+template <typename PointT>
+const int IncrementalKdTree<PointT>::kNull = -1;
+
+}
+
+
+#endif //INCREMENTAL_KDTREE_H_
@@ -0,0 +1,168 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INCREMENTAL_PATH_PLANNER_H_
+#define INCREMENTAL_PATH_PLANNER_H_
+
+#include <vector>
+#include <set>
+#include <limits>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/recursive_mutex.hpp>
+
+#include "PathPlanner.h"  // stay before any pcl include, it contains PCL_NO_PRECOMPILE directive
+#include "NeighborhoodGraph.h"
+#include "CostFunction.h"
+
+
+///	\class IncrementalPathPlanner
+///	\author Luigi Freda
+///	\brief D* Lite planner on the neighborhood graph of the full traversability map.
+///	       The search state is kept across map updates and robot motions: when a new traversability map is set,
+///	       its points are matched with the previous ones by voxel key and only the vertices whose traversability,
+///	       wall clearance or neighborhood changed are repaired.
+///	\note  The edge cost is the cost function evaluated with a null heuristic, i.e. cost(current, next, goal=next, traversability(next)):
+///	       for all the cost functions it is not smaller than dist(current, next), hence the euclidean distance is an admissible heuristic.
+///	       The traversability normalization (min, range) is frozen when the search is reset (new goal), so that map updates only change local edges.
+///	       An edge (u,v) exists only if dist(u,v) <= min(radius(u), radius(v)) with radius = min(wall clearance, PathPlanner::kMaxRobotStep):
+///	       this is the PathPlanner expansion rule made symmetric, so that predecessors and successors coincide.
+///	       The 2D utility is not used.
+/// 	\todo
+///	\date
+///	\warning
+class IncrementalPathPlanner
+{
+public:
+
+    static const double kVoxelKeyLeafSize;   // [m] voxel size used for matching the points of two consecutive maps
+    static const float kGoalChangeThreshold; // [m] if the goal moves more than this threshold, the search is reset
+    static const float kTravChangeThreshold; // minimum traversability change for marking a vertex as changed
+    static const float kPlanningTimeoutSec;  // maximum time in seconds for planning
+
+    static const double kInfinity;
+
+    typedef boost::shared_ptr<IncrementalPathPlanner> Ptr;
+
+public:
+
+    IncrementalPathPlanner();
+
+    // set the map: full traversability snapshot, its neighborhood graph (built with PathPlanner::kMaxRobotStep and PathPlanner::kMaxRobotStepDeltaZ) and the wall kd-tree
+    // if a search is active, the state is repaired by using the changes with respect to the previous map
+    // N.B.: the inputs are shared and not copied
+    bool setMap(const pcl::PointCloud<pcl::PointXYZI>::ConstPtr& traversability_pcl, const NeighborhoodGraph::ConstPtr& graph, const PathPlanner::WallKdTreeFLANNConstPtr& wall_kdtree);
+
+    // set the goal (index of the goal point in the current map); the search is reset only if the goal changed
+    void setGoal(const pcl::PointXYZI& goal, int goal_point_idx);
+
+    // compute the path from the start point (index in the current map) to the goal
+    bool planning(int start_point_idx, nav_msgs::Path& path_out);
+
+    // discard the search state
+    void reset();
+
+    void setAbort(bool val) { b_abort_ = val; }
+
+    void setCostFunctionType(int type, float lamda_trav = 1, float lambda_aux_utility = 1, float tau_exp_decay = std::numeric_limits<float>::max());
+
+public: // getters
+
+    bool isSearchActive() const { return b_search_active_; }
+
+    // number of vertices repaired at the last map update
+    size_t getNumRepairedVertices() const { return num_repaired_vertices_; }
+
+    // number of vertex expansions at the last planning()
+    size_t getNumExpansions() const { return num_expansions_; }
+
+protected:
+
+    struct Key
+    {
+        Key():k1(kInfinity), k2(kInfinity){}
+        Key(double k1_in, double k2_in):k1(k1_in), k2(k2_in){}
+        bool operator<(const Key& other) const { return (k1 < other.k1) || ((k1 == other.k1) && (k2 < other.k2)); }
+        double k1;
+        double k2;
+    };
+
+    typedef std::pair<Key, int> QueueEntry;
+
+protected:
+
+    // cost of the edge (u,v) whose squared length is squared_dist; infinite if the edge is not traversable
+    double edgeCost(int u, int v, float squared_dist) const;
+    double heuristic(int u) const;
+
+    Key calculateKey(int u) const;
+    double computeRhs(int u) const;
+
+    void updateVertex(int u);
+    void queueInsert(int u, const Key& key);
+    void queueRemove(int u);
+
+    // return false if the search is aborted or the timeout expired
+    bool computeShortestPath();
+
+    // compute the wall clearance radius and the voxel keys of the map points
+    void computeVertexData(const pcl::PointCloud<pcl::PointXYZI>& pcl, const PathPlanner::WallKdTreeFLANN& wall_kdtree, std::vector<float>& radius, std::vector<uint64_t>& keys);
+
+    // repair the search state after a map change and swap in the new map data
+    void repairSearch(const pcl::PointCloud<pcl::PointXYZI>::ConstPtr& traversability_pcl, const NeighborhoodGraph::ConstPtr& graph, std::vector<float>& radius, std::vector<uint64_t>& keys);
+
+    // extract the path by greedily descending g from the start
+    bool extractPath(int start_point_idx, nav_msgs::Path& path_out) const;
+
+    void initSearch(int start_point_idx);
+
+protected:
+
+    boost::recursive_mutex interaction_mutex;
+
+    pcl::PointCloud<pcl::PointXYZI>::ConstPtr pcl_traversability_;
+    NeighborhoodGraph::ConstPtr p_graph_;
+    PathPlanner::WallKdTreeFLANNConstPtr p_kdtree_wall_;
+
+    std::vector<float> radius_;     // edge radius of each vertex: min(wall clearance, PathPlanner::kMaxRobotStep)
+    std::vector<uint64_t> keys_;    // voxel key of each vertex
+
+    // D* Lite state
+    std::vector<double> g_;
+    std::vector<double> rhs_;
+    std::set<QueueEntry> open_;
+    std::vector<Key> open_key_;     // key of each vertex in open_
+    std::vector<char> in_open_;
+    double km_;
+    pcl::PointXYZI last_start_;     // start position used for computing the keys (km_ accumulates the start motions)
+    int start_idx_;
+    int goal_idx_;
+    pcl::PointXYZI goal_;
+
+    bool b_search_active_;
+    volatile bool b_abort_;
+
+    size_t num_repaired_vertices_;
+    size_t num_expansions_;
+
+    boost::shared_ptr<BaseCostFunction> p_cost_;
+};
+
+#endif //INCREMENTAL_PATH_PLANNER_H_
@@ -0,0 +1,107 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INDEX_WORK_QUEUE_H_
+#define INDEX_WORK_QUEUE_H_
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+
+#include <boost/core/noncopyable.hpp>
+
+
+///	\class IndexWorkQueue
+///	\author Luigi Freda
+///	\brief Lock-free multi-producer multi-consumer FIFO of the indices in [0, capacity).
+///	       Each index can be pushed at most once between two reset(): the queue is a plain array of capacity slots
+///	       (it can never overflow) where the producers reserve a slot with an atomic increment of the tail and the consumers
+///	       take the oldest ready slot with a compare-and-swap on the head.
+///	\note  pushing an index which has already been pushed is a no-op (as pushing an index whose work is already done).
+/// 	\todo
+///	\date
+///	\warning reset() is not thread-safe: it must be called when no producer/consumer is running
+class IndexWorkQueue: private boost::noncopyable
+{
+public:
+
+    IndexWorkQueue():head_(0), tail_(0) {}
+
+    // empty the queue and allow each index in [0, capacity) to be pushed once
+    void reset(size_t capacity)
+    {
+        if(capacity != items_.size())
+        {
+            items_.resize(capacity);
+            std::vector<std::atomic<bool> >(capacity).swap(pushed_);
+            std::vector<std::atomic<bool> >(capacity).swap(ready_);
+        }
+        std::fill(pushed_.begin(), pushed_.end(), false);
+        std::fill(ready_.begin(), ready_.end(), false);
+        head_ = 0;
+        tail_ = 0;
+    }
+
+    // return false if the index has already been pushed
+    bool push(size_t idx)
+    {
+        if(pushed_[idx].exchange(true, std::memory_order_acq_rel)) return false; /// < EXIT POINT
+
+        const size_t slot = tail_.fetch_add(1, std::memory_order_acq_rel); // slot < capacity since each index is pushed once
+        items_[slot] = idx;
+        ready_[slot].store(true, std::memory_order_release);
+        return true;
+    }
+
+    // return false if the queue is empty
+    bool pop(size_t& idx)
+    {
+        size_t head = head_.load(std::memory_order_acquire);
+        while(true)
+        {
+            if(head >= tail_.load(std::memory_order_acquire)) return false; /// < EXIT POINT
+            if(head_.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel)) break;
+        }
+
+        // the slot has been reserved by a producer which may be still writing it
+        while(!ready_[head].load(std::memory_order_acquire)) {}
+        idx = items_[head];
+        return true;
+    }
+
+    bool empty() const
+    {
+        return head_.load(std::memory_order_acquire) >= tail_.load(std::memory_order_acquire);
+    }
+
+    size_t getNumPushed() const { return tail_.load(std::memory_order_relaxed); }
+
+protected:
+
+    std::vector<size_t> items_;
+    std::vector<std::atomic<bool> > pushed_; // pushed_[i]: index i has been pushed
+    std::vector<std::atomic<bool> > ready_;  // ready_[k]: slot k has been written
+
+    std::atomic<size_t> head_; // next slot to pop
+    std::atomic<size_t> tail_; // next slot to push
+};
+
+
+#endif //INDEX_WORK_QUEUE_H_
@@ -0,0 +1,67 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef KDTREE_BATCH_RESULT_H_
+#define KDTREE_BATCH_RESULT_H_
+
+#include <vector>
+#include <cstddef>
+
+
+namespace pp
+{
+
+///	\class KdTreeBatchResult
+///	\author Luigi Freda
+///	\brief Results of a batch of kd-tree queries (see the batch searches of pp::KdTreeFLANN) in compressed sparse row (CSR) format:
+///	       the neighbors of the query q are indices[offsets[q]], ..., indices[offsets[q+1]-1], with their squared distances in sqr_distances.
+///	\note  It is owned by the caller and meant to be reused batch after batch: the buffers (and the search scratch) keep their capacity.
+/// 	\todo
+///	\date
+///	\warning a result cannot be shared by concurrent batches (use one per thread)
+struct KdTreeBatchResult
+{
+    std::vector<int> offsets;          // number of queries + 1
+    std::vector<int> indices;          // cloud indices of the neighbors
+    std::vector<float> sqr_distances;  // squared distances of the neighbors
+
+    // scratch of the searches
+    std::vector<float> queries;                         // vectorized query points
+    std::vector<std::vector<int> > row_indices;         // per-query radius search results
+    std::vector<std::vector<float> > row_sqr_distances;
+
+    size_t getNumQueries() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+
+    int getNumNeighbors(size_t q) const { return offsets[q + 1] - offsets[q]; }
+    const int* getIndices(size_t q) const { return indices.data() + offsets[q]; }
+    const float* getSqrDistances(size_t q) const { return sqr_distances.data() + offsets[q]; }
+
+    // set num_queries empty rows
+    void reset(size_t num_queries)
+    {
+        offsets.assign(num_queries + 1, 0);
+        indices.clear();
+        sqr_distances.clear();
+    }
+};
+
+}
+
+#endif // KDTREE_BATCH_RESULT_H_
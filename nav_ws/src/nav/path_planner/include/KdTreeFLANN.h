@@ -33,6 +33,10 @@
 #include "kdtree/kdtree_flann_pp.h"  // these files comes from pcl commit bdb91a3 which fixes a double free problem in KdTreeFLANN after copy operation; 
 // see here https://github.com/PointCloudLibrary/pcl/issues/335
 
+#include "IncrementalKdTree.h"
+
+#define USE_INCREMENTAL_KDTREE 0 // 1: pp::KdTreeFLANN is a pp::IncrementalKdTree (same search interface, the distance functor is ignored)
+
 
 /// < WE CANNOT USE c++11 with ros PCL see https://github.com/felixendres/rgbdslam_v2/issues/8
 //#if __cplusplus > 199711L
@@ -48,6 +52,18 @@
 
 namespace pp
 {
+
+#if USE_INCREMENTAL_KDTREE
+
+template <typename PointT, typename Dist = ::flann::L2_3D<float> >
+class KdTreeFLANN : public IncrementalKdTree<PointT>
+{
+public:
+
+    KdTreeFLANN(bool sorted = true) : IncrementalKdTree<PointT>(sorted) {} 
+};
+
+#else
                    
 //template <typename PointT, typename Dist = ::flann::L2_Simple<float> >
 template <typename PointT, typename Dist = ::flann::L2_3D<float> >
@@ -71,6 +87,8 @@ public:
     //KdTreeFLANN(const KdTreeFLANN<PointT> &k) : pcl::KdTreeFLANN<PointT, Dist>(k) {} 
 };
 
+#endif // USE_INCREMENTAL_KDTREE
+
 }
 
 
@@ -0,0 +1,90 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LATENCY_TRACER_H_
+#define LATENCY_TRACER_H_
+
+#include <string>
+
+#include <boost/thread/mutex.hpp>
+
+#include <ros/ros.h>
+
+#include <trajectory_control_msgs/PipelineLatency.h>
+
+
+///	\class LatencyTracer
+///	\author Luigi Freda
+///	\brief Records when a pipeline stage processes the data originated by a laser scan and publishes it on /pipeline_latency
+///	       (see the pipeline_latency node, which aggregates the per-stage latencies).
+///	\note  The stamp of the originating scan is propagated by the stages in the header of their outputs:
+///	       begin() is called with the stamp of the input and end() when the output is published.
+///	       end() is a no-op if there is no pending begin() (e.g. a control command not triggered by a new path).
+/// 	\todo
+///	\date
+///	\warning
+class LatencyTracer
+{
+public:
+
+    LatencyTracer():b_enabled_(false) {}
+
+    void init(ros::NodeHandle& n, const std::string& stage_name)
+    {
+        pub_ = n.advertise<trajectory_control_msgs::PipelineLatency>("/pipeline_latency", 10);
+        stage_name_ = stage_name;
+        b_enabled_ = true;
+    }
+
+    bool isEnabled() const { return b_enabled_; }
+
+    // the stage starts processing the data originated at origin_stamp
+    void begin(const ros::Time& origin_stamp)
+    {
+        if (!b_enabled_ || origin_stamp.isZero()) return; /// < EXIT POINT
+        boost::mutex::scoped_lock locker(mutex_);
+        msg_.header.stamp = origin_stamp;
+        msg_.start = ros::Time::now();
+    }
+
+    // the stage published its output
+    void end()
+    {
+        if (!b_enabled_) return; /// < EXIT POINT
+        boost::mutex::scoped_lock locker(mutex_);
+        if (msg_.header.stamp.isZero()) return; /// < EXIT POINT
+        msg_.stage = stage_name_;
+        msg_.end = ros::Time::now();
+        pub_.publish(msg_);
+        msg_.header.stamp = ros::Time();
+    }
+
+protected:
+
+    bool b_enabled_;
+    std::string stage_name_;
+    ros::Publisher pub_;
+
+    boost::mutex mutex_;
+    trajectory_control_msgs::PipelineLatency msg_; // pending sample
+};
+
+
+#endif //LATENCY_TRACER_H_
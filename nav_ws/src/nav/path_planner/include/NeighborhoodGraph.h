@@ -0,0 +1,179 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NEIGHBORHOOD_GRAPH_H_
+#define NEIGHBORHOOD_GRAPH_H_
+
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <cmath>
+#include <stdint.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <pcl/point_cloud.h>
+
+#include "KdTreeBatchResult.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+///	\class NeighborhoodGraph
+///	\author Luigi Freda
+///	\brief Adjacency of a traversability cloud in compressed sparse row (CSR) format.
+///	       For each point, it stores the neighbors within a max radius whose |dz| does not exceed a max delta z,
+///	       sorted by increasing distance (as returned by a sorted radius search), together with their squared distances.
+///	\note  The graph is meant to be built once per traversability map and shared (read-only) among planners:
+///	       a planner node expansion then only requires a prefix of the neighbor list and no kd-tree query.
+///	       Memory is about 8 bytes per edge (e.g. ~50 neighbors per point on a 0.05 m map with a 0.4 m radius).
+/// 	\todo
+///	\date
+///	\warning the graph refers to a specific cloud: check isValidFor() before using it with a given cloud
+class NeighborhoodGraph
+{
+public:
+
+    typedef boost::shared_ptr<NeighborhoodGraph> Ptr;
+    typedef boost::shared_ptr<const NeighborhoodGraph> ConstPtr;
+
+public:
+
+    NeighborhoodGraph():radius_(0), delta_z_(0), min_squared_dist_(0), size_(0), stamp_(0) {}
+
+    // build the graph of the cloud by using the input kd-tree (which must have been built on the same cloud)
+    // neighbors q of p are kept if |q-p| <= radius, |q.z-p.z| <= delta_z, |q-p|^2 >= min_squared_dist
+    template<typename PointT, typename KdTreeT>
+    void build(const pcl::PointCloud<PointT>& cloud, const KdTreeT& kdtree, float radius, float delta_z, float min_squared_dist = 0.f)
+    {
+        radius_ = radius;
+        delta_z_ = delta_z;
+        min_squared_dist_ = min_squared_dist;
+        size_ = cloud.size();
+        stamp_ = cloud.header.stamp;
+        frame_id_ = cloud.header.frame_id;
+
+        const int num_points = cloud.size();
+        offsets_.assign(num_points + 1, 0);
+        indices_.clear();
+        squared_distances_.clear();
+        if(num_points == 0) return; /// < EXIT POINT
+
+        /// < first pass: query the neighborhoods of all the points with a single batch search (results in CSR format)
+        pp::KdTreeBatchResult neighbors;
+        int cores = 1;
+#ifdef _OPENMP
+        cores = omp_get_max_threads();
+#endif
+        kdtree.radiusSearch(cloud, std::vector<int>(), radius, neighbors, 0, cores);
+
+        /// < second pass: filter the neighborhoods and compute the row offsets
+        #pragma omp parallel for schedule(dynamic, 256)
+        for(int i = 0; i < num_points; i++)
+        {
+            const PointT& p = cloud[i];
+            const int* idx = neighbors.getIndices(i);
+            const float* squared_dist = neighbors.getSqrDistances(i);
+            int num_kept = 0;
+            for(int j = 0, jEnd = neighbors.getNumNeighbors(i); j < jEnd; j++)
+            {
+                if( (fabs(cloud[idx[j]].z - p.z) > delta_z) || (squared_dist[j] < min_squared_dist) ) continue;
+                num_kept++;
+            }
+            offsets_[i + 1] = num_kept;
+        }
+        for(int i = 0; i < num_points; i++)
+        {
+            offsets_[i + 1] += offsets_[i];
+        }
+
+        /// < third pass: fill the arrays
+        indices_.resize(offsets_[num_points]);
+        squared_distances_.resize(offsets_[num_points]);
+        #pragma omp parallel for schedule(dynamic, 256)
+        for(int i = 0; i < num_points; i++)
+        {
+            const PointT& p = cloud[i];
+            const int* idx = neighbors.getIndices(i);
+            const float* squared_dist = neighbors.getSqrDistances(i);
+            size_t k = offsets_[i];
+            for(int j = 0, jEnd = neighbors.getNumNeighbors(i); j < jEnd; j++)
+            {
+                if( (fabs(cloud[idx[j]].z - p.z) > delta_z) || (squared_dist[j] < min_squared_dist) ) continue;
+                indices_[k] = idx[j];
+                squared_distances_[k] = squared_dist[j];
+                k++;
+            }
+        }
+    }
+
+    // check if the graph has been built on the input cloud (same header and size) with compatible parameters
+    template<typename PointT>
+    bool isValidFor(const pcl::PointCloud<PointT>& cloud, float delta_z, float min_squared_dist = 0.f) const
+    {
+        return (size_ > 0) && (size_ == cloud.size()) && (stamp_ == cloud.header.stamp) && (frame_id_ == cloud.header.frame_id) &&
+               (delta_z_ == delta_z) && (min_squared_dist_ == min_squared_dist);
+    }
+
+    // get the neighbors of point i within radius (which must be <= the build radius)
+    // the output is appended to the input vectors; it returns the number of found neighbors
+    int radiusNeighbors(int i, float radius, std::vector<int>& point_idx, std::vector<float>& point_squared_dist) const
+    {
+        const size_t begin = offsets_[i];
+        const size_t end = offsets_[i + 1];
+        const float squared_radius = radius*radius;
+        size_t j = begin;
+        for(; (j < end) && (squared_distances_[j] <= squared_radius); j++)
+        {
+            point_idx.push_back(indices_[j]);
+            point_squared_dist.push_back(squared_distances_[j]);
+        }
+        return (int)(j - begin);
+    }
+
+    size_t getNumNeighbors(int i) const { return offsets_[i + 1] - offsets_[i]; }
+    const int* getNeighbors(int i) const { return &indices_[0] + offsets_[i]; }
+    const float* getSquaredDistances(int i) const { return &squared_distances_[0] + offsets_[i]; }
+
+    size_t size() const { return size_; }
+    size_t getNumEdges() const { return indices_.size(); }
+    float getRadius() const { return radius_; }
+
+    size_t getMemoryBytes() const { return offsets_.size()*sizeof(size_t) + indices_.size()*sizeof(int) + squared_distances_.size()*sizeof(float); }
+
+protected:
+
+    std::vector<size_t> offsets_;  // offsets_[i] = index of the first neighbor of point i in indices_/squared_distances_ (size = num points + 1)
+    std::vector<int> indices_;     // neighbor point indices
+    std::vector<float> squared_distances_; // neighbor squared distances
+
+    float radius_;
+    float delta_z_;
+    float min_squared_dist_;
+
+    size_t size_;
+    uint64_t stamp_;
+    std::string frame_id_;
+};
+
+
+#endif //NEIGHBORHOOD_GRAPH_H_
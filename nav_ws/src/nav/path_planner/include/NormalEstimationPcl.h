@@ -51,10 +51,15 @@
 #include <cmath>
 #include <deque>
 #include <atomic>
+#include <unordered_set>
+#include <stdint.h>
 
 #include "KdTreeFLANN.h"
 #include "Transform.h"
 #include "MultiConfig.h"
+#include "WorkerPool.h"
+#include "IndexWorkQueue.h"
+#include "ScanArena.h"
 
 
 using namespace path_planner;
@@ -65,7 +70,9 @@ typedef std::vector<atom_bool> atom_bool_vec;
 ///	\class NormalEstimationPcl
 ///	\author Luigi Freda and Alcor Lab
 ///	\brief Class for computing normals 
-///	\note 
+///	\note the normals are computed by a persistent pool of config_.num_threads workers: in the standard approach each worker 
+///	      processes the chunks of its own slice of the cloud and then steals the chunks left in the other slices; 
+///	      in the direction propagation approach the workers share a lock-free queue of the points to process
 /// 	\todo 
 ///	\date
 ///	\warning
@@ -87,6 +94,10 @@ class NormalEstimationPcl
     
     static const float kMinCosToPropagate; 
     
+    static const size_t kChunkSize; // number of points of a chunk of work in computeNormalsStandard()
+    
+    static const double kIncrementalKeyLeafSize; // [m] voxel size for identifying a point across two consecutive maps (incremental update)
+    
 public:     
     
     typedef pcl::PointCloud<PointT> PointCloudT;
@@ -99,6 +110,13 @@ public:
     ~NormalEstimationPcl();
     
     void computeNormals(PointCloudT& pcl, KdTreeT& kdtree, const pcl::PointXYZ& center);
+    
+    // Compute the normals of the points with b_keep[i] == 0; the other points keep their normals and are used for aligning the new ones 
+    void computeNormals(PointCloudT& pcl, KdTreeT& kdtree, const pcl::PointXYZ& center, const std::vector<char>& b_keep);
+    
+    // Compute the normals reusing the ones of the previous cloud for the points whose neighborhood (radius) did not change:
+    // only the points around the added/removed points are recomputed, on a kd-tree built on their local region 
+    void computeNormalsIncremental(const typename PointCloudT::Ptr& p_pcl, const pcl::PointXYZ& center);
 
     void computeNormalsStandard(PointCloudT& pcl, KdTreeT& kdtree, atom_bool_vec& done, atom_bool_vec& propagate, const pcl::PointXYZ& center);  
     void computeNormalsByDirectionPropagation(PointCloudT& pcl, KdTreeT& kdtree, atom_bool_vec& done, atom_bool_vec& propagate, const pcl::PointXYZ& center);    
@@ -108,6 +126,7 @@ public: ///  < setters
     inline void setConfig(const NormalEstimationPclConfig& new_config)
     {
         config_ = new_config;
+        b_reset_incremental_ = true; // the previous normals may have been computed with different parameters 
     }
 
     // Set previously built map base_link trajectory 
@@ -145,12 +164,58 @@ protected:
     // Compute the covariance matrix between the point center and his neighbors. The covariance matrix is weighted with kernel function
     void computeCovarianceMatrix(const PointCloudT& neighbors, const pcl::PointXYZ& center, Eigen::Matrix3f& covariance_matrix);
 
+    // temporaries of computeNormal(): each worker takes one from the arena and reuses it for all its points 
+    struct NeighborhoodScratch
+    {
+        std::vector<int> indices;
+        std::vector<float> squared_distances;
+        PointCloudT neighbors;
+    };
+
     // Compute one normal for a given point i
-    bool computeNormal(const size_t i, const size_t begin, const size_t end, PointCloudT& pcl, KdTreeT& kdtree, atom_bool_vec& done, atom_bool_vec& propagate, const pcl::PointXYZ& center);
+    bool computeNormal(const size_t i, const size_t begin, const size_t end, PointCloudT& pcl, KdTreeT& kdtree, atom_bool_vec& done, atom_bool_vec& propagate, const pcl::PointXYZ& center, NeighborhoodScratch& scratch);
 
+    struct NormalsStats
+    {
+        NormalsStats():num_computed_points(0), num_isolated_points(0), num_invalid_normals(0) {}
+        size_t num_computed_points;
+        size_t num_isolated_points;
+        size_t num_invalid_normals;
+    };
+    
+    // Chunks of work of computeNormalsStandard(): the cloud is split in one slice per worker, each slice is consumed chunk by chunk 
+    struct PointRangeChunks
+    {
+        PointRangeChunks(size_t num_points, size_t num_slices_in):num_slices(num_slices_in), slice_end(num_slices_in), slice_next(num_slices_in)
+        {
+            for (size_t k = 0; k < num_slices; k++)
+            {
+                slice_next[k] = num_points * k / num_slices;
+                slice_end[k]  = num_points * (k + 1) / num_slices;
+            }
+        }
+        
+        // get the next chunk [begin, end) of the given slice; return false if the slice is exhausted 
+        bool next(size_t slice, size_t& begin, size_t& end)
+        {
+            begin = slice_next[slice].fetch_add(kChunkSize);
+            if (begin >= slice_end[slice]) return false; /// < EXIT POINT
+            end = std::min(begin + kChunkSize, slice_end[slice]);
+            return true;
+        }
+        
+        size_t num_slices; 
+        std::vector<size_t> slice_end; 
+        std::vector<std::atomic<size_t> > slice_next; // first point of the next chunk of each slice
+    };
+    
     // Compute normals in a given range
-    void computeNormalsInRange(const size_t num_thread, const size_t start, const size_t end, PointCloudT& pcl, KdTreeT& kdtree, atom_bool_vec& done, atom_bool_vec& propagate, const pcl::PointXYZ& center);
+    void computeNormalsInRange(const size_t start, const size_t end, PointCloudT& pcl, KdTreeT& kdtree, atom_bool_vec& done, atom_bool_vec& propagate, const pcl::PointXYZ& center, NormalsStats& stats);
 
+    // Compute normals in the chunks of the own slice of the worker and then in the chunks left in the other slices 
+    void computeNormalsInChunks(const size_t num_thread, PointRangeChunks& chunks, PointCloudT& pcl, KdTreeT& kdtree, atom_bool_vec& done, atom_bool_vec& propagate, const pcl::PointXYZ& center);
+
+    // Compute normals of the points in the propagation queue until all the workers are idle and the queue is empty 
     void computeNormalsInQueue(const size_t num_thread, const size_t start, const size_t end, PointCloudT& pcl, KdTreeT& kdtree, atom_bool_vec& done, atom_bool_vec& propagate, const pcl::PointXYZ& center);
     
     // Add a new laser center to the laser trajectory 
@@ -158,8 +223,14 @@ protected:
     
     // Compute closest laser point to each point of the cloud 
     void computeClosestLaserPoints(PointCloudT& pcl); 
+    
+    // Mark the cells (of size cell_size) within range cells from the cell of the point  
+    static void markNeighborCells(const PointT& point, const double cell_size, const int range, std::unordered_set<uint64_t>& cells);
         
     void checkTeammatePositionsFromTransform();
+    
+    // get the pool of workers (it is recreated only if the number of threads changes) 
+    WorkerPool& getWorkerPool(const int num_threads);
 
 protected:
     
@@ -187,8 +258,17 @@ protected:
     
     boost::recursive_mutex kdtree_mutex_;    
     
-    std::deque<size_t> queue_; 
-    boost::recursive_mutex queue_mutex_;      
+    IndexWorkQueue queue_; // propagation queue of the direction propagation approach 
+    std::atomic<int> num_busy_workers_; // workers of computeNormalsInQueue() which may still push points 
+    
+    boost::shared_ptr<WorkerPool> p_worker_pool_;
+    
+    /// < incremental update 
+    PointCloudT prev_pcl_;                    // last cloud with its normals 
+    std::vector<uint64_t> prev_point_keys_;   // voxel keys (kIncrementalKeyLeafSize) of prev_pcl_
+    bool b_reset_incremental_;                // the next incremental update must recompute all the normals 
+    
+    ScanArena arena_; // temporaries of the normal computation, reused scan after scan 
     
 protected:
     
@@ -0,0 +1,320 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef OPEN_SET_H_
+#define OPEN_SET_H_
+
+#include <vector>
+#include <limits>
+#include <cmath>
+#include <cstddef>
+
+
+///	\class BaseOpenSet
+///	\author Luigi Freda
+///	\brief Base interface of the open set (leaf nodes) used by the PathPlanner for extracting the min-cost node
+///	\note ids are dense node ids (i.e. indexes in the node vector of the planner)
+/// 	\todo
+///	\date
+///	\warning
+class BaseOpenSet
+{
+public:
+
+    static const size_t kInvalidPos;
+
+public:
+
+    virtual ~BaseOpenSet() {}
+
+    // remove all the elements; the capacity is kept for the next planning
+    virtual void clear() = 0;
+
+    virtual bool empty() const = 0;
+    virtual size_t size() const = 0;
+
+    // insert id with the given cost; if id is already in the set, its cost is updated
+    virtual void push(size_t id, double cost) = 0;
+
+    // extract the id with minimum cost; return false if the set is empty
+    virtual bool pop(size_t& id) = 0;
+
+    // remove id if it is contained in the set
+    virtual void erase(size_t id) = 0;
+
+    virtual bool contains(size_t id) const = 0;
+};
+
+
+///	\class IndexedBinaryHeap
+///	\author Luigi Freda
+///	\brief Binary min-heap with position index: O(log n) push/pop/decrease-key/erase and O(1) contains
+///	\note
+/// 	\todo
+///	\date
+///	\warning
+class IndexedBinaryHeap: public BaseOpenSet
+{
+public:
+
+    IndexedBinaryHeap(){}
+
+    void clear()
+    {
+        for(size_t i=0; i<heap_.size(); i++) pos_[heap_[i].id] = kInvalidPos;
+        heap_.clear();
+    }
+
+    bool empty() const { return heap_.empty(); }
+    size_t size() const { return heap_.size(); }
+
+    bool contains(size_t id) const { return (id < pos_.size()) && (pos_[id] != kInvalidPos); }
+
+    void push(size_t id, double cost)
+    {
+        if(id >= pos_.size()) pos_.resize(std::max(id + 1, 2*pos_.size()), kInvalidPos);
+
+        if(pos_[id] != kInvalidPos)
+        {
+            // update the key
+            const size_t pos = pos_[id];
+            const double old_cost = heap_[pos].cost;
+            heap_[pos].cost = cost;
+            if(cost < old_cost)
+                siftUp(pos);
+            else
+                siftDown(pos);
+            return; /// < EXIT POINT
+        }
+
+        Entry entry;
+        entry.id = id;
+        entry.cost = cost;
+        heap_.push_back(entry);
+        pos_[id] = heap_.size() - 1;
+        siftUp(heap_.size() - 1);
+    }
+
+    // decrease the key of an element already in the heap
+    void decreaseKey(size_t id, double cost)
+    {
+        if(!contains(id)) return; /// < EXIT POINT
+        const size_t pos = pos_[id];
+        if(cost < heap_[pos].cost)
+        {
+            heap_[pos].cost = cost;
+            siftUp(pos);
+        }
+    }
+
+    bool top(size_t& id, double& cost) const
+    {
+        if(heap_.empty()) return false; /// < EXIT POINT
+        id = heap_[0].id;
+        cost = heap_[0].cost;
+        return true;
+    }
+
+    bool pop(size_t& id)
+    {
+        if(heap_.empty()) return false; /// < EXIT POINT
+        id = heap_[0].id;
+        removeAt(0);
+        return true;
+    }
+
+    void erase(size_t id)
+    {
+        if(!contains(id)) return; /// < EXIT POINT
+        removeAt(pos_[id]);
+    }
+
+protected:
+
+    struct Entry
+    {
+        size_t id;
+        double cost;
+    };
+
+    void removeAt(size_t pos)
+    {
+        pos_[heap_[pos].id] = kInvalidPos;
+        const size_t last = heap_.size() - 1;
+        if(pos != last)
+        {
+            heap_[pos] = heap_[last];
+            pos_[heap_[pos].id] = pos;
+            heap_.pop_back();
+            siftUp(pos);
+            siftDown(pos);
+        }
+        else
+        {
+            heap_.pop_back();
+        }
+    }
+
+    void siftUp(size_t pos)
+    {
+        Entry entry = heap_[pos];
+        while(pos > 0)
+        {
+            const size_t parent = (pos - 1) >> 1;
+            if(!(entry.cost < heap_[parent].cost)) break;
+            heap_[pos] = heap_[parent];
+            pos_[heap_[pos].id] = pos;
+            pos = parent;
+        }
+        heap_[pos] = entry;
+        pos_[entry.id] = pos;
+    }
+
+    void siftDown(size_t pos)
+    {
+        const size_t num = heap_.size();
+        Entry entry = heap_[pos];
+        while(true)
+        {
+            size_t child = 2*pos + 1;
+            if(child >= num) break;
+            if((child + 1 < num) && (heap_[child + 1].cost < heap_[child].cost)) child++;
+            if(!(heap_[child].cost < entry.cost)) break;
+            heap_[pos] = heap_[child];
+            pos_[heap_[pos].id] = pos;
+            pos = child;
+        }
+        heap_[pos] = entry;
+        pos_[entry.id] = pos;
+    }
+
+protected:
+
+    std::vector<Entry> heap_;
+    std::vector<size_t> pos_;  // pos_[id] = position of id in heap_ (kInvalidPos if not contained)
+};
+
+
+///	\class BucketQueue
+///	\author Luigi Freda
+///	\brief Monotone-free bucket queue keyed on the quantized cost: O(1) push/erase, amortized O(1) pop
+///	\note elements in the same bucket are extracted in LIFO order, i.e. costs are compared up to the quantization resolution
+/// 	\todo
+///	\date
+///	\warning
+class BucketQueue: public BaseOpenSet
+{
+public:
+
+    static const double kDefaultResolution;  // cost quantization step
+    static const size_t kMaxNumBuckets;      // costs beyond kMaxNumBuckets*resolution are clamped into the last bucket
+
+public:
+
+    BucketQueue(double resolution = kDefaultResolution):resolution_(resolution), size_(0), cursor_(0)
+    {
+        if(!(resolution_ > 0)) resolution_ = kDefaultResolution;
+    }
+
+    void clear()
+    {
+        for(size_t b=cursor_; b<buckets_.size(); b++)
+        {
+            std::vector<size_t>& bucket = buckets_[b];
+            for(size_t i=0; i<bucket.size(); i++) pos_[bucket[i]].bucket = kInvalidPos;
+            bucket.clear();
+        }
+        size_ = 0;
+        cursor_ = 0;
+    }
+
+    bool empty() const { return size_ == 0; }
+    size_t size() const { return size_; }
+
+    bool contains(size_t id) const { return (id < pos_.size()) && (pos_[id].bucket != kInvalidPos); }
+
+    void push(size_t id, double cost)
+    {
+        if(id >= pos_.size()) pos_.resize(std::max(id + 1, 2*pos_.size()));
+
+        if(pos_[id].bucket != kInvalidPos) erase(id);
+
+        const size_t b = bucketIndex(cost);
+        if(b >= buckets_.size()) buckets_.resize(b + 1);
+
+        std::vector<size_t>& bucket = buckets_[b];
+        pos_[id].bucket = b;
+        pos_[id].offset = bucket.size();
+        bucket.push_back(id);
+        size_++;
+
+        // costs are not monotone in the planner: the cursor may need to go back
+        if(b < cursor_ || size_ == 1) cursor_ = b;
+    }
+
+    bool pop(size_t& id)
+    {
+        if(size_ == 0) return false; /// < EXIT POINT
+        while(buckets_[cursor_].empty()) cursor_++;
+        id = buckets_[cursor_].back();
+        erase(id);
+        return true;
+    }
+
+    void erase(size_t id)
+    {
+        if(!contains(id)) return; /// < EXIT POINT
+        std::vector<size_t>& bucket = buckets_[pos_[id].bucket];
+        const size_t offset = pos_[id].offset;
+        bucket[offset] = bucket.back();
+        pos_[bucket[offset]].offset = offset;
+        bucket.pop_back();
+        pos_[id].bucket = kInvalidPos;
+        size_--;
+    }
+
+protected:
+
+    size_t bucketIndex(double cost) const
+    {
+        if(!(cost > 0)) return 0; /// < EXIT POINT (also catches NaN)
+        const double q = cost/resolution_;
+        if(q >= (double)(kMaxNumBuckets - 1)) return kMaxNumBuckets - 1; /// < EXIT POINT
+        return (size_t)q;
+    }
+
+protected:
+
+    struct Position
+    {
+        Position():bucket(kInvalidPos),offset(0){}
+        size_t bucket;
+        size_t offset;
+    };
+
+    double resolution_;
+    size_t size_;
+    size_t cursor_;  // all the buckets before cursor_ are empty
+    std::vector<std::vector<size_t> > buckets_;
+    std::vector<Position> pos_;
+};
+
+
+#endif //OPEN_SET_H_
@@ -0,0 +1,137 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PATH_CACHE_H_
+#define PATH_CACHE_H_
+
+#include <list>
+#include <unordered_map>
+#include <stdint.h>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/core/noncopyable.hpp>
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+
+#include <nav_msgs/Path.h>
+
+
+///	\class PathCache
+///	\author Luigi Freda
+///	\brief LRU cache of planned paths keyed on (map version, start node, goal node, cost function type, lambdas).
+///	       Nodes are identified by the voxel key of their position, so that an entry can survive a map update:
+///	       when a new traversability map arrives, updateMap() removes the entries whose path passes close to a changed point
+///	       and moves the others to the new map version.
+///	\note  It is thread-safe: it can be shared by concurrent planning workers.
+/// 	\todo
+///	\date
+///	\warning changes of the wall cloud alone are not tracked (walls and traversability are computed from the same map)
+class PathCache: private boost::noncopyable
+{
+public:
+
+    static const size_t kDefaultCapacity;       // max number of entries
+    static const double kNodeKeyLeafSize;       // [m] voxel size for identifying a node across map versions
+    static const double kInvalidationCellSize;  // [m] a path is invalidated if a changed point falls in one of the cells (or in their neighbors) it crosses
+    static const float kTravChangeThreshold;    // minimum traversability change for marking a point as changed
+
+    struct Key
+    {
+        uint64_t map_version;
+        uint64_t start_key;     // voxel key of the start node
+        uint64_t goal_key;      // voxel key of the goal node
+        int cost_function_type;
+        float lambda_trav;
+        float lambda_aux_utility;
+
+        bool operator==(const Key& other) const
+        {
+            return (map_version == other.map_version) && (start_key == other.start_key) && (goal_key == other.goal_key) &&
+                   (cost_function_type == other.cost_function_type) && (lambda_trav == other.lambda_trav) && (lambda_aux_utility == other.lambda_aux_utility);
+        }
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const
+        {
+            size_t h = key.start_key;
+            h = h*31 + key.goal_key;
+            h = h*31 + key.map_version;
+            h = h*31 + key.cost_function_type;
+            return h;
+        }
+    };
+
+public:
+
+    // a capacity = 0 disables the cache
+    PathCache(size_t capacity = kDefaultCapacity):capacity_(capacity), num_hits_(0), num_misses_(0) {}
+
+    void setCapacity(size_t capacity);
+
+    bool isEnabled() const { return capacity_ > 0; }
+
+    // get the cached path (if any); the entry becomes the most recently used one
+    bool get(const Key& key, nav_msgs::Path& path, double& path_cost);
+
+    // insert the path; the least recently used entry is removed if the capacity is exceeded
+    void put(const Key& key, const nav_msgs::Path& path, double path_cost);
+
+    // move the entries to the new map version: the entries whose path passes close to a point which has been added, removed or
+    // whose traversability changed (from old_pcl to new_pcl) are removed
+    void updateMap(uint64_t new_map_version, const pcl::PointCloud<pcl::PointXYZI>& old_pcl, const pcl::PointCloud<pcl::PointXYZI>& new_pcl);
+
+    void clear();
+
+    size_t size();
+    size_t getNumHits() const { return num_hits_; }
+    size_t getNumMisses() const { return num_misses_; }
+
+    // key of the node at the input position
+    static uint64_t getNodeKey(const pcl::PointXYZI& point);
+
+protected:
+
+    struct Entry
+    {
+        Key key;
+        nav_msgs::Path path;
+        double path_cost;
+    };
+
+    typedef std::list<Entry> EntryList;
+    typedef std::unordered_map<Key, EntryList::iterator, KeyHash> EntryIndex;
+
+protected:
+
+    boost::mutex mutex_;
+
+    size_t capacity_;
+    EntryList entries_;   // most recently used first
+    EntryIndex index_;
+
+    size_t num_hits_;
+    size_t num_misses_;
+};
+
+
+#endif //PATH_CACHE_H_
@@ -28,6 +28,7 @@
 
 #include <boost/thread/recursive_mutex.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
 
 #include <pcl/point_types.h>
 #include <pcl/point_cloud.h>
@@ -45,6 +46,8 @@
 #include <math.h>
 #include <limits>
 #include <algorithm>
+#include <random>
+#include <stdint.h>
 
 #include <pcl/filters/extract_indices.h>
 #include <pcl/conversions.h>
@@ -59,6 +62,9 @@
 #include <sensor_msgs/PointCloud2.h>
 
 #include "CostFunction.h"
+#include "OpenSet.h"
+#include "NeighborhoodGraph.h"
+#include "SearchTreeMarkerPublisher.h"
 
 
 ///	\class PathPlanner
@@ -84,22 +90,88 @@ public: // static constants
     static const float kMaxRobotStep; // maximum radius where to search neighbors during each node expansion 
     static const float kMaxRobotStepDeltaZ; 
     
+    static const unsigned int kDefaultRandomSeed; // seed of the sample generator (the same seed gives the same sequence of samples at each planning())
+    
+    static const double kDefaultAnytimeRepublishPeriodSec; // [s] default min period between two partial paths in any-time mode 
+    
+    static const double kDefaultNominalSpeed; // [m/s] speed used for estimating the arrival times at the nodes (reservation table)
+    
     const static double kPathSmoothingKernel3[3];
     
+    enum OpenSetType 
+    {
+        kOpenSetBinaryHeap  = 0,  // indexed binary heap: exact min-cost extraction in O(log n)
+        kOpenSetBucketQueue = 1,  // bucket queue on quantized cost: min-cost extraction up to the quantization step
+        kNumOpenSetTypes
+    };
+    
 public: // typedefs
     
     //typedef pcl::KdTreeFLANN<Point,::flann::L2_Simple<float> > KdTreeFLANN;
     typedef pp::KdTreeFLANN<pcl::PointXYZI,::flann::L2_3D<float> > KdTreeFLANN; // it is necessary to define above PCL_NO_PRECOMPILE
+    typedef pp::KdTreeFLANN<pcl::PointXYZRGBNormal> WallKdTreeFLANN;
+    
+    // immutable ref-counted kd-tree snapshots: they can be shared by many planners (searches are const)
+    typedef boost::shared_ptr<const KdTreeFLANN> KdTreeFLANNConstPtr;
+    typedef boost::shared_ptr<const WallKdTreeFLANN> WallKdTreeFLANNConstPtr;
+    
+    // called by planning() with the partial path (from the start to the expanded node closest to the goal) in any-time mode
+    typedef boost::function<void (const nav_msgs::Path&)> PartialPathCallback;
 
 public: // custom structs 
     
-    struct PointPlanning
+    // flat structure-of-arrays pool of the search tree nodes: node i is (parent_id[i], point_idx[i], cost[i], length[i]), the root is its own parent
+    // N.B.: clear() keeps the capacity, so that the memory stays allocated across planning() calls
+    struct NodePool
+    {
+        size_t size() const { return point_idx.size(); }
+        
+        void clear() { parent_id.clear(); point_idx.clear(); cost.clear(); length.clear(); }
+        
+        // keep the first n nodes (n <= size())
+        void resize(size_t n) { parent_id.resize(n); point_idx.resize(n); cost.resize(n); length.resize(n); }
+        
+        // add a node and return its id 
+        size_t push(size_t parent, int point, double node_cost, float node_length = 0.f)
+        {
+            parent_id.push_back(parent);
+            point_idx.push_back(point);
+            cost.push_back(node_cost);
+            length.push_back(node_length);
+            return point_idx.size() - 1;
+        }
+        
+        void swap(NodePool& other) { parent_id.swap(other.parent_id); point_idx.swap(other.point_idx); cost.swap(other.cost); length.swap(other.length); }
+        
+        std::vector<size_t> parent_id;
+        std::vector<int> point_idx;
+        std::vector<double> cost;
+        std::vector<float> length; // [m] length of the tree path from the root
+    };
+    
+    // visited flags of the traversability points: a point is visited if its stamp equals the current generation, 
+    // so that reset() is O(1) (the array is only cleared when it grows or when the generation counter wraps around)
+    struct VisitedFlags
     {
-        size_t parent_id;
-        size_t id;
-        int point_idx;
-        double cost;
-        std::vector<size_t> child_id;
+        VisitedFlags():generation(0){}
+        
+        void reset(size_t n)
+        {
+            if (stamp.size() < n) stamp.resize(n, 0);
+            if (++generation == 0)
+            {
+                std::fill(stamp.begin(), stamp.end(), 0);
+                generation = 1;
+            }
+        }
+        
+        bool test(size_t i) const { return stamp[i] == generation; }
+        void set(size_t i) { stamp[i] = generation; }
+        
+        void swap(VisitedFlags& other) { stamp.swap(other.stamp); std::swap(generation, other.generation); }
+        
+        std::vector<uint32_t> stamp;
+        uint32_t generation;
     };
     
     struct IdxProbability
@@ -107,20 +179,45 @@ public: // custom structs
         size_t point_idx;
         float probability;
     };
+    
+    // expansion state of a search tree (used by the bidirectional search for storing the inactive tree)
+    struct SearchTree
+    {
+        NodePool nodes;
+        boost::shared_ptr<BaseOpenSet> p_leaf_nodes;
+        VisitedFlags visited_points_flag;
+        size_t current_node_idx;
+        pcl::PointXYZI goal; // target of the tree 
+    };
 
     
 public: 
 
     PathPlanner(ros::NodeHandle n_in);
     PathPlanner();
+    // b_publish = false: no node handle and no publishers are created (offline use, e.g. path_planner_bench, ros::init() is not needed)
+    explicit PathPlanner(bool b_publish);
     ~PathPlanner();
 
     // set the input
     // N.B: first setInput(), then you can set setGoal() and set2DUtility()
+    // N.B.2: the input clouds and kd-trees are shared and not copied; they must not be modified after this call (create new ones instead)
+    void setInput(const pcl::PointCloud<pcl::PointXYZI>::ConstPtr& noWall_in, const pcl::PointCloud<pcl::PointXYZRGBNormal>::ConstPtr& wall_in,
+                  const WallKdTreeFLANNConstPtr& wallKdTree_in, const KdTreeFLANNConstPtr& noWallKdTree_in, int start_point_idx_in);
+    
+    // set the input by deep copying it (legacy interface)
     void setInput(pcl::PointCloud<pcl::PointXYZI>& noWall_in, pcl::PointCloud<pcl::PointXYZRGBNormal>& wall_in,
                    pp::KdTreeFLANN<pcl::PointXYZRGBNormal>& wallKdTree_in, KdTreeFLANN& noWallKdTree_in, int start_point_idx_in);
 
+    // the utility cloud is shared and not copied (see setInput())
+    void set2DUtility(const pcl::PointCloud<pcl::PointXYZI>::ConstPtr& utility_pcl);
+    
+    // set the utility by deep copying it (legacy interface)
     void set2DUtility(pcl::PointCloud<pcl::PointXYZI>& utility_pcl);
+    
+    // set the precomputed neighborhood graph of the traversability cloud (shared, see setInput()); it replaces the kd-tree radius search in findNeighbors()
+    // N.B: call it after setInput(); the graph is discarded if it was not built on the input traversability cloud with radius kMaxRobotStep and delta z kMaxRobotStepDeltaZ
+    void setNeighborhoodGraph(const NeighborhoodGraph::ConstPtr& graph);
         
     //set the goal position
     bool setGoal(pcl::PointXYZI& goal_in);
@@ -128,12 +225,37 @@ public:
     //Compute the path if it is exist
     bool planning(nav_msgs::Path& path_out);
     
+    // one-to-many planning: a single Dijkstra sweep from the start (see setInput()) which stops once all the goals are settled; 
+    // for each goal it returns the path and its cost (infinite with an empty path if the goal is farther than kGoalAcceptCheckThreshold from the traversability cloud or not reachable)
+    // N.B.: the edge cost is the cost function with a null heuristic, i.e. cost(current, next, goal=next, traversability(next)), the 2D utility is used if set; 
+    //       it does not need setGoal(); return the number of reached goals 
+    int planningMultiGoal(const std::vector<pcl::PointXYZI>& goals, std::vector<nav_msgs::Path>& paths_out, std::vector<double>& costs_out);
+    
     // set the abort flag for possibly aborting current planning 
     void setAbort(bool val) { b_abort_ = val; }
     
     void setCostFunction(BaseCostFunction* new_cost, float lamda_trav = 1, float lambda_aux_utility = 1, float tau_exp_decay = std::numeric_limits<float>::max());
     
     void setCostFunctionType(int type, float lamda_trav = 1, float lambda_aux_utility = 1, float tau_exp_decay = std::numeric_limits<float>::max());
+    
+    // set the data structure used for storing the leaf nodes (see OpenSetType)
+    void setOpenSetType(int type, double bucket_resolution = BucketQueue::kDefaultResolution);
+    
+    // set the seed of the sample generator used for expanding the nodes; the generator is re-seeded at each planning() 
+    void setRandomSeed(unsigned int seed);
+    
+    // grow a second tree from the goal towards the start: planning() alternates the expansions of the two trees and stops when they meet
+    void setBidirectionalSearch(bool val);
+    
+    // any-time mode: once time_budget_sec has elapsed, planning() calls the callback with the best partial path found so far and then 
+    // calls it again (at most once every republish_period_sec) each time the partial path gets closer to the goal; time_budget_sec <= 0 disables it 
+    // N.B.: the callback is called from the planning thread with the planner locked: it must not call the planner; not used by the bidirectional search
+    void setAnytimePlanning(double time_budget_sec, const PartialPathCallback& callback, double republish_period_sec = kDefaultAnytimeRepublishPeriodSec);
+    
+    // cooperative planning: the cost of a node is increased when robots with a higher priority reserved it at the time the robot is expected 
+    // to arrive there (start of planning() + length of the tree path / nominal_speed), see BaseCostFunction::applyReservationCost(); a null table disables it
+    // N.B.: the table is shared and not copied; the reservations are not used by the backward tree of the bidirectional search and by planningMultiGoal()
+    void setReservationTable(const ReservationTable::Ptr& table, int robot_id, float lambda_reservation = BaseCostFunction::kLamdaReservationDefault, double nominal_speed = kDefaultNominalSpeed);
         
 public: // getters 
 
@@ -142,6 +264,13 @@ public: // getters
     
     bool isAbort() const { return b_abort_; }
     
+    bool isBidirectionalSearch() const { return b_bidirectional_search_; }
+    
+    bool isAnytimePlanning() const { return (anytime_time_budget_sec_ > 0) && anytime_callback_; }
+    
+    // number of node expansions of the last planning
+    int getNumExpansions() const { return count_; }
+    
 public: // static functions 
     
     //Return the value of the euclidian distane between p1 and p2
@@ -153,6 +282,10 @@ public: // static functions
     static double dist2D(const Point& p1, const Point& p2);
     
     static int getClosestNodeIdx(pcl::PointXYZI& position, KdTreeFLANN& kdtree, float radius);
+    
+    static void computeIMinMaxRange(const pcl::PointCloud<pcl::PointXYZI>& pcl_in, float& min_in, float& max_in, float& range_in);
+    
+    static nav_msgs::Path smoothPath3(const nav_msgs::Path& path);
 
 private: // private data 
     
@@ -160,15 +293,17 @@ private: // private data
     boost::recursive_mutex interaction_mutex; 
     
     //The graph
-    std::vector<PointPlanning> nodes_;
+    NodePool nodes_;
 
-    //List of leaf node indexes in the explored graph
-    std::vector<size_t> leaf_nodes_idxs_;
+    //Leaf node indexes in the explored graph, ordered by node cost
+    boost::shared_ptr<BaseOpenSet> p_leaf_nodes_;
+    OpenSetType open_set_type_;
+    double open_set_bucket_resolution_;
 
     //List of visited nodes indexes 
     std::vector<size_t> visited_nodes_idxs_;
     
-    std::vector<bool> visited_points_flag_;
+    VisitedFlags visited_points_flag_;
 
     size_t current_node_idx_;
 
@@ -178,31 +313,31 @@ private: // private data
     //List of the point composing the path
     std::vector<size_t> path_;
 
-    //Point Clouds of segmented part: wall and noWall, the intensity is the traversability cost of each point
-    pcl::PointCloud<pcl::PointXYZRGBNormal> pcl_wall_;
+    //Point Clouds of segmented part: wall and noWall, the intensity is the traversability cost of each point (shared snapshots)
+    pcl::PointCloud<pcl::PointXYZRGBNormal>::ConstPtr pcl_wall_;
     //Kd tree representation of the point cloud wall
-    pp::KdTreeFLANN<pcl::PointXYZRGBNormal> kdtree_wall_;
+    WallKdTreeFLANNConstPtr p_kdtree_wall_;
     
-    pcl::PointCloud<pcl::PointXYZI> pcl_traversability_;
+    pcl::PointCloud<pcl::PointXYZI>::ConstPtr pcl_traversability_;
     //Kd tree representation of the point cloud noWall
-    KdTreeFLANN kdtree_traversability_;
+    KdTreeFLANNConstPtr p_kdtree_traversability_;
+    //Precomputed neighborhood graph of the point cloud noWall (optional)
+    NeighborhoodGraph::ConstPtr p_neighborhood_graph_;
     
     bool b_utility_2d_available_; 
-    pcl::PointCloud<pcl::PointXYZI> pcl_utility_2d_; // [x,y,u(x,y),var(x,y)] we assume that pcl_2d_utility_ must contain info about the points in pcl_traversability_
+    pcl::PointCloud<pcl::PointXYZI>::ConstPtr pcl_utility_2d_; // [x,y,u(x,y),var(x,y)] we assume that pcl_2d_utility_ must contain info about the points in pcl_traversability_
 
     //Robot pose and goal
     pcl::PointXYZI goal_;
+    int goal_point_idx_; // index of goal_ in pcl_traversability_
 
     int start_point_idx_;
 
     //Count iteration
     int count_;
 
-    //Get the markerArray of visited node
-    visualization_msgs::MarkerArray markerArr_;
-
-    //Publisher for merkerArr
-    ros::Publisher markerArrPub_;
+    //Publisher of the visited nodes (from its own thread)
+    boost::shared_ptr<SearchTreeMarkerPublisher> p_marker_publisher_;
 
     //Publisher for path
     ros::Publisher localPathPub_;
@@ -211,6 +346,33 @@ private: // private data
     volatile bool b_abort_;  // set it true if you want to abort current planning
     
     boost::shared_ptr<BaseCostFunction> p_cost_; 
+    CostBatch cost_batch_; // SoA data of the current neighbors (see sampleFollowers())
+    
+    // sample generator (owned by each planner instance: no lock is shared with other planners)
+    unsigned int random_seed_; 
+    std::mt19937 random_generator_; 
+    std::uniform_real_distribution<float> uniform_distribution_; 
+    
+    // bidirectional search: the active tree lives in the members above (nodes_, p_leaf_nodes_, visited_points_flag_, current_node_idx_, goal_), the other one in other_tree_
+    bool b_bidirectional_search_; 
+    bool b_bidirectional_running_; // true while planningBidirectional() is running 
+    bool b_backward_tree_active_;  // true if the active tree is the one rooted at the goal 
+    SearchTree other_tree_; 
+    bool b_trees_met_; 
+    size_t meeting_node_idx_;      // node of the active tree whose expansion met the other tree
+    int meeting_point_idx_;        // point of the other tree reached by the expansion of meeting_node_idx_
+    
+    // any-time mode 
+    double anytime_time_budget_sec_; 
+    double anytime_republish_period_sec_;
+    PartialPathCallback anytime_callback_;
+    
+    // reservation table (see setReservationTable())
+    ReservationTable::Ptr p_reservation_table_; 
+    int reservation_robot_id_; 
+    float lambda_reservation_; 
+    double nominal_speed_;          // [m/s]
+    double reservation_start_time_; // [s] start time of the current planning 
 
 private: // private functions 
     
@@ -222,7 +384,22 @@ private: // private functions
         
     // Find the best node
     bool findNextNode();
+    
+    // create a new open set of the set type
+    BaseOpenSet* createOpenSet() const;
+    
+    // bidirectional version of planning() 
+    bool planningBidirectional(nav_msgs::Path& path_out);
+    
+    // swap the active tree with other_tree_
+    void swapSearchTree();
+    
+    // build the (smoothed) path from the root of the tree to the input node 
+    void buildPartialPath(size_t node_idx, nav_msgs::Path& path_out) const;
 
+    // Find the expansion neighbors of a traversability point (within the returned radius)
+    int findPointNeighbors(int point_idx, double& radius, std::vector<int>& pointIdxRadiusSearch, std::vector<float>& pointRadiusSquaredDistance);
+    
     // Find neighbors to current point and compute probability
     void findNeighbors(std::vector<IdxProbability>& neighbors, double& radius); 
 
@@ -237,11 +414,8 @@ private: // private functions
     bool checkGoal();
     
     void computeZMinMaxRange(const pcl::PointCloud<pcl::PointXYZI>& pcl_in, float& min_in, float& max_in, float& range_in);
-    void computeIMinMaxRange(const pcl::PointCloud<pcl::PointXYZI>& pcl_in, float& min_in, float& max_in, float& range_in);
     
     void filterNeighborhoodByDz(const pcl::PointCloud<pcl::PointXYZI>& pcl_wall, const pcl::PointXYZI& p, double deltaZ, std::vector<int>& pointIdx, std::vector<float>& pointSquaredDistance);
-    
-    nav_msgs::Path smoothPath3(const nav_msgs::Path& path);
 };
 
 template<class Point>
@@ -264,7 +438,7 @@ inline double PathPlanner::dist2D(const Point& p1, const Point& p2)
 
 inline bool PathPlanner::checkGoal()
 {
-    return (dist(pcl_traversability_[nodes_[current_node_idx_].point_idx], goal_) < kGoalPlanningCheckThreshold);
+    return (dist((*pcl_traversability_)[nodes_.point_idx[current_node_idx_]], goal_) < kGoalPlanningCheckThreshold);
 }
 
 #endif //PATH_PLANNING_H_
@@ -26,6 +26,9 @@
 #endif 
 
 #include "PathPlanner.h"  // stay before any pcl include, it contains PCL_NO_PRECOMPILE directive 
+#include "IncrementalPathPlanner.h"
+#include "PathCache.h"
+#include "PathSmoother.h"
 
 #include <pcl/filters/crop_box.h>
 #include <std_msgs/Bool.h>
@@ -62,6 +65,9 @@ public:
     static const float kSizeYCropBoxPathAligned; // 
     static const float kSizeZCropBoxPathAligned; // 
     
+    static const double kDefaultCoarseLeafSize; // [m] default voxel size of the coarse map used by the hierarchical planning (4 x mapping leaf_size)
+    static const float kCorridorCellSize; // [m] the refinement corridor is made of the cells (of this size) crossed by the coarse path and of their neighbors 
+    
     //static const float kTaskCallbackPeriod;  // [s] the duration period of the task callback 
     
     enum CropBoxMethod
@@ -105,6 +111,10 @@ public:
     void goalAbortCallback(std_msgs::Bool msg);
     
     PlannerStatus pathPlanningServiceCallback(const geometry_msgs::PoseStamped start, const geometry_msgs::PoseStamped end, nav_msgs::Path& path, double& path_cost);
+    
+    // one-to-many planning on the full traversability map (see PathPlanner::planningMultiGoal()): a path and a cost for each goal (infinite cost if not reached)
+    // return kSuccess if at least one goal has been reached 
+    PlannerStatus multiGoalPathPlanning(const geometry_msgs::PoseStamped& start, const std::vector<geometry_msgs::PoseStamped>& goals, std::vector<nav_msgs::Path>& paths, std::vector<double>& path_costs);
 
     // compute path
     PlannerStatus doPathPlanning();
@@ -140,6 +150,7 @@ public: /// < setters
             p_path_planner_->setAbort(val);
             planning_status_ = kAborted; 
         }
+        if(p_incremental_planner_) p_incremental_planner_->setAbort(val);
         if(val) setNoGoal();
     }
     
@@ -157,6 +168,39 @@ public: /// < setters
     
     void setCostFunctionType(int type, double lamda_trav = 1, double lambda_aux_utility = 1);
     
+    void setOpenSetType(int type, double bucket_resolution = BucketQueue::kDefaultResolution);
+    
+    // enable the precomputed neighborhood graph of the full traversability map (used when the map is not cropped)
+    void setUseNeighborhoodGraph(bool val);
+    
+    void setRandomSeed(unsigned int seed);
+    
+    // grow a second search tree from the goal (see PathPlanner::setBidirectionalSearch())
+    void setUseBidirectionalSearch(bool val);
+    
+    // max number of paths cached by pathPlanningServiceCallback() (0 disables the cache)
+    void setPathCacheSize(size_t size);
+    
+    // enable the incremental (D* Lite) planner on the full traversability map: its search is repaired at each new map instead of restarting;
+    // it requires the neighborhood graph and falls back to the randomized planner when it fails 
+    void setUseIncrementalPlanning(bool val);
+    
+    // enable the hierarchical (coarse-to-fine) planning: a first path is computed on the voxel-downsampled traversability map (with voxel size coarse_leaf_size) 
+    // and then refined on the full resolution points inside a corridor around it; on failure the planners fall back to the crop box attempts
+    void setUseHierarchicalPlanning(bool val, double coarse_leaf_size = kDefaultCoarseLeafSize);
+    
+    // any-time mode of doPathPlanning(): the callback receives the best partial path towards the goal once time_budget_sec has elapsed 
+    // and then each time it improves (see PathPlanner::setAnytimePlanning()); time_budget_sec <= 0 disables it
+    void setAnytimePlanning(double time_budget_sec, const PathPlanner::PartialPathCallback& callback, double republish_period_sec = PathPlanner::kDefaultAnytimeRepublishPeriodSec);
+    
+    // cooperative planning of doPathPlanning() with the space-time reservations of the team (see PathPlanner::setReservationTable()); 
+    // a null table disables it; the paths of pathPlanningServiceCallback() and multiGoalPathPlanning() do not use the reservations (they are not executed now)
+    void setReservationTable(const ReservationTable::Ptr& table, int robot_id, double lambda_reservation = BaseCostFunction::kLamdaReservationDefault, double nominal_speed = PathPlanner::kDefaultNominalSpeed);
+    
+    // post-process the paths of doPathPlanning() with the spline smoothing and timing stage (see PathSmoother); 
+    // the planned path is kept when the smoothed one cannot meet the limits
+    void setUsePathSmoothing(bool val, const PathSmoother::Config& config = PathSmoother::Config());
+    
 public: /// < getters 
     
     PlannerStatus getPlanningStatus() const { return planning_status_;} 
@@ -191,9 +235,46 @@ public:
                             pcl::PointCloud<pcl::PointXYZI>::Ptr pcl_out, 
                             pcl::PointCloud<pcl::PointXYZI>::Ptr pcl_out2);
     
+    // keep the points of pcl_in (and the corresponding points of pcl_in2, if not null) which fall in the cells crossed by the path or in their neighbors
+    static void cropCorridorPcl(const nav_msgs::Path& path, float cell_size,
+                                const pcl::PointCloud<pcl::PointXYZI>::Ptr pcl_in, 
+                                const pcl::PointCloud<pcl::PointXYZI>::Ptr pcl_in2,
+                                pcl::PointCloud<pcl::PointXYZI>::Ptr pcl_out, 
+                                pcl::PointCloud<pcl::PointXYZI>::Ptr pcl_out2);
+    
+    static double computePathLength(const nav_msgs::Path& path);
+    
 protected:
     
-    double computePathLength(nav_msgs::Path& path);
+    // plan with the incremental planner on the full map; return true if a path has been found 
+    bool doIncrementalPathPlanning(const pcl::PointXYZI& robot_position);
+    
+    // plan on the coarse map and then refine inside the corridor around the coarse path; return true if a path has been found 
+    bool doHierarchicalPathPlanning(const pcl::PointXYZI& start, const pcl::PointXYZI& goal, nav_msgs::Path& path_out);
+    
+    // get the voxel-downsampled traversability map together with its kd-tree (lazily built)
+    void getCoarseTraversability(pcl::PointCloud<pcl::PointXYZI>::Ptr& p_coarse_pcl, PathPlanner::KdTreeFLANNConstPtr& p_coarse_kdtree);
+    
+    // get the kd-tree of the full traversability map (lazily built)
+    PathPlanner::KdTreeFLANNConstPtr getTraversabilityKdTree();
+    
+    // replace path with its smoothed version (if the smoothing is enabled and successful)
+    void smoothPath(nav_msgs::Path& path);
+    
+    // install a new traversability snapshot: the path cache entries are moved to the new map version
+    void setTraversabilitySnapshot(const pcl::PointCloud<pcl::PointXYZI>::Ptr& traversability_pcl);
+    
+    // build the path cache key of the (start, goal) nodes of the full traversability map; return false if a node cannot be found
+    bool getPathCacheKey(const pcl::PointXYZI& start, const pcl::PointXYZI& goal, PathCache::Key& key);
+    
+    // prepare the (cropped) traversability and utility snapshots together with their kd-tree; 
+    // with kCropBoxTakeAll the full map snapshots are shared without any copy together with the neighborhood graph (null otherwise)
+    void prepareTraversabilityInput(const CropBoxMethod& crop_box_method, 
+                                    const pcl::PointXYZI& start, const pcl::PointXYZI& goal, 
+                                    pcl::PointCloud<pcl::PointXYZI>::Ptr& p_traversability_pcl, 
+                                    pcl::PointCloud<pcl::PointXYZI>::Ptr& p_utility_2d_pcl,
+                                    PathPlanner::KdTreeFLANNConstPtr& p_traversability_kdtree,
+                                    NeighborhoodGraph::ConstPtr& p_neighborhood_graph);
     
 protected: 
     
@@ -213,11 +294,18 @@ protected:
     double path_cost_; // cost of the last planned path 
 
     boost::recursive_mutex wall_mutex_;
+    // N.B.: the following clouds and kd-trees are immutable snapshots shared with the planners: a new instance is allocated at each input message
     pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr wall_pcl_;
-    pp::KdTreeFLANN<pcl::PointXYZRGBNormal> wall_kdtree_;
+    PathPlanner::WallKdTreeFLANNConstPtr wall_kdtree_;
 
     boost::recursive_mutex traversability_mutex_;
     pcl::PointCloud<pcl::PointXYZI>::Ptr traversability_pcl_;
+    PathPlanner::KdTreeFLANNConstPtr traversability_kdtree_; // kd-tree of the full traversability_pcl_ (lazily built)
+    NeighborhoodGraph::ConstPtr traversability_graph_; // neighborhood graph of the full traversability_pcl_ (lazily built)
+    bool b_use_neighborhood_graph_;
+    uint64_t traversability_map_version_; // incremented at each new traversability snapshot
+    pcl::PointCloud<pcl::PointXYZI>::Ptr traversability_coarse_pcl_; // voxel-downsampled traversability_pcl_ (lazily built)
+    PathPlanner::KdTreeFLANNConstPtr traversability_coarse_kdtree_; // kd-tree of traversability_coarse_pcl_ 
     
     boost::recursive_mutex utility_2d_mutex_;
     pcl::PointCloud<pcl::PointXYZI>::Ptr utility_2d_pcl_; // [x,y,u(x,y),var(x,y)] we assume that utility_2d_pcl_ contains info about the points in traversability_pcl_
@@ -226,9 +314,26 @@ protected:
     pcl::PointXYZI goal_position_;
 
     boost::shared_ptr<PathPlanner> p_path_planner_; // the used path planner instance
+    IncrementalPathPlanner::Ptr p_incremental_planner_; // the incremental planner instance (it keeps its search state across calls)
+    bool b_use_incremental_planning_;
+    bool b_use_hierarchical_planning_;
+    double anytime_time_budget_sec_; // [s] 
+    double anytime_republish_period_sec_; // [s]
+    PathPlanner::PartialPathCallback anytime_callback_;
+    ReservationTable::Ptr p_reservation_table_; 
+    int reservation_robot_id_; 
+    double lambda_reservation_; 
+    double nominal_speed_; // [m/s] 
+    bool b_use_path_smoothing_; 
+    PathSmoother path_smoother_; 
+    double coarse_leaf_size_; // [m] 
     boost::recursive_mutex path_planner_mutex_;
 
     BaseCostFunction::CostFunctionType cost_function_type_; 
+    float lambda_trav_; 
+    float lambda_aux_utility_; 
+    
+    PathCache path_cache_; // paths computed by pathPlanningServiceCallback()
     
     PlannerStatus planning_status_; 
     
@@ -0,0 +1,126 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PATH_SMOOTHER_H_
+#define PATH_SMOOTHER_H_
+
+#include "PathPlanner.h"  // stay before any pcl include, it contains PCL_NO_PRECOMPILE directive
+
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <nav_msgs/Path.h>
+
+
+///	\class PathSmoother
+///	\author Luigi Freda
+///	\brief Post-processing of the planned paths: a C2-continuous curve (natural cubic spline with chord-length parameterization)
+///	       is fitted through a subset of the path nodes (the knots) and it is time-parameterized with the velocity and acceleration limits of the robot.
+///	\note  The knots are first taken every knot_spacing meters along the path. Then, until the spline is valid:
+///	       - where a spline sample is farther than max_traversability_distance from the traversability cloud or closer to the wall cloud
+///	         than min_wall_clearance (or than the planned path itself there, if closer), the path node halfway between the two knots of the span is added as a knot;
+///	       - where the planar curvature exceeds max_curvature, the closest knot which was not added for clearance is removed.
+///	       The velocity profile is bounded by max_velocity, by the lateral acceleration and angular velocity limits on the curvature and by max_acceleration
+///	       (forward and backward passes, the robot starts and stops at rest).
+///	       The output poses are sampled every sample_step meters, their orientation is the tangent yaw and their stamp is the path stamp + the arrival time.
+/// 	\todo
+///	\date
+///	\warning the input clouds and kd-trees are shared and not copied (see PathPlanner::setInput())
+class PathSmoother
+{
+public:
+
+    struct Config
+    {
+        Config();
+
+        double knot_spacing;                // [m] initial spacing of the knots along the path
+        double sample_step;                 // [m] spacing of the output poses
+        double max_curvature;               // [1/m]
+        double max_traversability_distance; // [m] max distance of a sample from the closest traversability point
+        double min_wall_clearance;          // [m] min distance of a sample from the closest wall point
+        double max_velocity;                // [m/s]
+        double max_acceleration;            // [m/s^2]
+        double max_lateral_acceleration;    // [m/s^2]
+        double max_angular_velocity;        // [rad/s]
+        int max_iterations;                 // max number of knot refinements
+    };
+
+    struct Stats
+    {
+        size_t num_knots;
+        int num_iterations;
+        double max_curvature; // [1/m]
+        double length;        // [m]
+        double duration;      // [s]
+    };
+
+public:
+
+    PathSmoother(const Config& config = Config());
+
+    void setConfig(const Config& config) { config_ = config; }
+    const Config& getConfig() const { return config_; }
+
+    // set the maps used for checking the clearance of the spline (the wall cloud can be empty)
+    void setInput(const pcl::PointCloud<pcl::PointXYZI>::ConstPtr& traversability_pcl, const PathPlanner::KdTreeFLANNConstPtr& traversability_kdtree,
+                  const pcl::PointCloud<pcl::PointXYZRGBNormal>::ConstPtr& wall_pcl, const PathPlanner::WallKdTreeFLANNConstPtr& wall_kdtree);
+
+    // smooth and time-parameterize the input path; return false if the limits cannot be met (path_out is not modified)
+    bool smooth(const nav_msgs::Path& path_in, nav_msgs::Path& path_out);
+
+    const Stats& getStats() const { return stats_; }
+
+protected:
+
+    struct Sample
+    {
+        Eigen::Vector3d position;
+        double yaw;
+        double curvature;
+        double s; // [m] arc length
+        int span; // index of the first knot of its span
+    };
+
+    // natural cubic spline through the knots, sampled every sample_step
+    void fitSpline(const std::vector<Eigen::Vector3d>& knots, std::vector<Sample>& samples) const;
+
+    // time of the samples with the velocity limits
+    void computeTiming(const std::vector<Sample>& samples, std::vector<double>& times) const;
+
+    bool isTraversable(const Eigen::Vector3d& p) const;
+
+    // distance to the closest wall point (infinite if there are no walls)
+    double getWallClearance(const Eigen::Vector3d& p) const;
+
+protected:
+
+    Config config_;
+    Stats stats_;
+
+    pcl::PointCloud<pcl::PointXYZI>::ConstPtr traversability_pcl_;
+    PathPlanner::KdTreeFLANNConstPtr traversability_kdtree_;
+    pcl::PointCloud<pcl::PointXYZRGBNormal>::ConstPtr wall_pcl_;
+    PathPlanner::WallKdTreeFLANNConstPtr wall_kdtree_;
+};
+
+
+#endif //PATH_SMOOTHER_H_
@@ -0,0 +1,178 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef POINT_CLOUD_DELTA_H_
+#define POINT_CLOUD_DELTA_H_
+
+#ifndef PCL_NO_PRECOMPILE
+#define PCL_NO_PRECOMPILE
+#endif 
+
+#include <string>
+
+#include <ros/ros.h>
+#include <pcl/point_cloud.h>
+#include <pcl_conversions/pcl_conversions.h>
+
+#include <trajectory_control_msgs/PointCloudDelta.h>
+
+#include "BlockHashMap.h"
+
+
+///	\class PointCloudDeltaPublisher
+///	\author Luigi Freda
+///	\brief Publishes a point cloud map as a stream of trajectory_control_msgs/PointCloudDelta messages.
+///	       The cloud is partitioned in blocks (BlockHashMap): each delta carries only the points of the blocks which changed
+///	       w.r.t. the previously published cloud, together with the keys of those blocks.
+///	\note  A keyframe (full cloud) is sent every keyframe_period deltas and when a new subscriber connects:
+///	       a receiver which misses a delta waits for the next keyframe. Nothing is serialized when nobody is subscribed.
+/// 	\todo
+///	\date
+///	\warning
+template<typename PointT>
+class PointCloudDeltaPublisher
+{
+public:
+
+    typedef pcl::PointCloud<PointT> PointCloudT;
+
+    static const int kDefaultKeyframePeriod; // [number of deltas]
+
+public:
+
+    PointCloudDeltaPublisher():sequence_(0), keyframe_period_(kDefaultKeyframePeriod), num_deltas_since_keyframe_(0), num_subscribers_(0) {}
+
+    void init(ros::NodeHandle& n, const std::string& topic_name, double block_size = BlockHashMap<PointT>::kDefaultBlockSize, int keyframe_period = kDefaultKeyframePeriod)
+    {
+        pub_ = n.advertise<trajectory_control_msgs::PointCloudDelta>(topic_name, 10);
+        map_.setBlockSize(block_size);
+        keyframe_period_ = keyframe_period;
+    }
+
+    // publish the difference between the cloud and the previously published one
+    void publish(const PointCloudT& cloud)
+    {
+        typename BlockHashMap<PointT>::BlockKeySet changed_keys;
+        map_.assign(cloud, changed_keys);
+
+        const size_t num_subscribers = pub_.getNumSubscribers();
+        const bool b_new_subscriber = num_subscribers > num_subscribers_;
+        num_subscribers_ = num_subscribers;
+        if (num_subscribers == 0) return; /// < EXIT POINT
+
+        trajectory_control_msgs::PointCloudDelta msg;
+        msg.sequence = sequence_++;
+        msg.block_size = map_.getBlockSize();
+        msg.keyframe = b_new_subscriber || (num_deltas_since_keyframe_ >= keyframe_period_);
+        if (msg.keyframe)
+        {
+            pcl::toROSMsg(cloud, msg.points);
+            num_deltas_since_keyframe_ = 0;
+        }
+        else
+        {
+            PointCloudT points;
+            points.header = cloud.header;
+            map_.extract(changed_keys, points);
+            pcl::toROSMsg(points, msg.points);
+            msg.replaced_blocks.assign(changed_keys.begin(), changed_keys.end());
+            num_deltas_since_keyframe_++;
+        }
+        msg.header = msg.points.header;
+        pub_.publish(msg);
+    }
+
+protected:
+
+    ros::Publisher pub_;
+    BlockHashMap<PointT> map_; // last published cloud
+
+    uint32_t sequence_;
+    int keyframe_period_;
+    int num_deltas_since_keyframe_;
+    size_t num_subscribers_;
+};
+
+template<typename PointT>
+const int PointCloudDeltaPublisher<PointT>::kDefaultKeyframePeriod = 20;
+
+
+///	\class PointCloudDeltaReceiver
+///	\author Luigi Freda
+///	\brief Rebuilds the point cloud map published by a PointCloudDeltaPublisher by applying the received deltas to a local copy.
+///	\note  The points of the rebuilt cloud are ordered by block (not as in the published cloud).
+/// 	\todo
+///	\date
+///	\warning
+template<typename PointT>
+class PointCloudDeltaReceiver
+{
+public:
+
+    typedef pcl::PointCloud<PointT> PointCloudT;
+
+public:
+
+    PointCloudDeltaReceiver():b_synced_(false), last_sequence_(0) {}
+
+    // apply the delta and get the updated cloud; return false if the cloud cannot be updated (a delta was lost and a keyframe is awaited)
+    bool apply(const trajectory_control_msgs::PointCloudDelta& msg, PointCloudT& cloud)
+    {
+        if (!msg.keyframe && (!b_synced_ || (msg.sequence != last_sequence_ + 1)))
+        {
+            if (b_synced_) ROS_WARN_STREAM("PointCloudDeltaReceiver::apply() - lost delta (got " << msg.sequence << ", expected " << last_sequence_ + 1 << "), waiting for a keyframe");
+            b_synced_ = false;
+            return false; /// < EXIT POINT
+        }
+
+        PointCloudT points;
+        pcl::fromROSMsg(msg.points, points);
+        if (msg.keyframe)
+        {
+            map_.clear();
+            map_.setBlockSize(msg.block_size);
+            map_.insert(points);
+        }
+        else
+        {
+            typename BlockHashMap<PointT>::BlockKeySet keys(msg.replaced_blocks.begin(), msg.replaced_blocks.end());
+            map_.replace(keys, points);
+        }
+        map_.clearChanged();
+        b_synced_ = true;
+        last_sequence_ = msg.sequence;
+
+        map_.toPointCloud(cloud);
+        cloud.header = points.header;
+        return true;
+    }
+
+    bool isSynced() const { return b_synced_; }
+
+protected:
+
+    BlockHashMap<PointT> map_;
+
+    bool b_synced_;
+    uint32_t last_sequence_;
+};
+
+
+#endif //POINT_CLOUD_DELTA_H_
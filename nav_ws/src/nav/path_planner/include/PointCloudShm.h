@@ -0,0 +1,368 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef POINT_CLOUD_SHM_H_
+#define POINT_CLOUD_SHM_H_
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstring>
+#include <sstream>
+#include <algorithm>
+#include <new>
+
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/core/noncopyable.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/exceptions.hpp>
+
+#include <ros/ros.h>
+#include <sensor_msgs/PointCloud2.h>
+
+#include <trajectory_control_msgs/PointCloudShm.h>
+
+
+///	\class PointCloudShmSlot
+///	\author Luigi Freda
+///	\brief Layout of a slot of the shared memory ring of a PointCloudShmPublisher: a sequence counter followed by the 
+///	       serialized sensor_msgs/PointCloud2. The counter is odd while the publisher writes the slot (seqlock): a reader 
+///	       checks that it did not change while it deserialized the cloud.
+///	\note
+/// 	\todo
+///	\date
+///	\warning std::atomic<uint64_t> must be lock-free to be shared between processes
+struct PointCloudShmSlot
+{
+    static const size_t kHeaderSize = 64; // the cloud starts on its own cache line
+
+    static std::atomic<uint64_t>& sequence(void* address) { return *static_cast<std::atomic<uint64_t>*>(address); }
+    static uint8_t* data(void* address) { return static_cast<uint8_t*>(address) + kHeaderSize; }
+
+    // name of the segment of a slot: one per topic, slot and generation (a slot which has to grow gets a new segment, the 
+    // subscribers which still map the old one are not affected)
+    static std::string segmentName(const std::string& resolved_topic, const size_t slot, const size_t generation)
+    {
+        std::string name = "pc_shm" + resolved_topic;
+        std::replace(name.begin(), name.end(), '/', '_');
+        std::stringstream ss;
+        ss << name << "_" << slot << "_" << generation;
+        return ss.str();
+    }
+};
+
+
+///	\class PointCloudShmPublisher
+///	\author Luigi Freda
+///	\brief Publishes a sensor_msgs/PointCloud2 topic through a ring of shared memory slots for the subscribers on the same 
+///	       host: the cloud is serialized once in a slot and only a small trajectory_control_msgs/PointCloudShm descriptor 
+///	       goes through TCPROS on <topic>/shm. The cloud is also published as usual on <topic> for the other subscribers 
+///	       (e.g. rviz, remote nodes): nothing is serialized for a transport which nobody is subscribed to.
+///	\note  The names are resolved (remapped) before appending /shm, so that the remappings of the launch files hold for both.
+///	       A subscriber must copy the cloud out of its slot before kNumSlots newer clouds are published.
+///	       With use_shm the plain topic is only published when it has subscribers: a late subscriber of a latched topic 
+///	       gets the next cloud (the shm descriptors are latched as requested).
+/// 	\todo
+///	\date
+///	\warning
+class PointCloudShmPublisher: private boost::noncopyable
+{
+public:
+
+    static const size_t kNumSlots = 4;
+
+public:
+
+    PointCloudShmPublisher():b_use_shm_(true), b_latch_(false), num_published_(0) {}
+    
+    ~PointCloudShmPublisher() { shutdown(); }
+
+    void advertise(ros::NodeHandle& n, const std::string& topic_name, uint32_t queue_size, bool latch = false, bool use_shm = true)
+    {
+        shutdown();
+        resolved_topic_ = n.resolveName(topic_name);
+        pub_ = n.advertise<sensor_msgs::PointCloud2>(resolved_topic_, queue_size, latch);
+        b_use_shm_ = use_shm;
+        b_latch_ = latch;
+        if (b_use_shm_)
+        {
+            shm_pub_ = n.advertise<trajectory_control_msgs::PointCloudShm>(resolved_topic_ + "/shm", queue_size, latch);
+            slots_.resize(kNumSlots);
+        }
+    }
+
+    void publish(const sensor_msgs::PointCloud2& msg)
+    {
+        if (!b_use_shm_)
+        {
+            pub_.publish(msg);
+            return; /// < EXIT POINT
+        }
+        if (pub_.getNumSubscribers() > 0)
+        {
+            pub_.publish(msg);
+        }
+        if (shm_pub_.getNumSubscribers() > 0 || b_latch_)
+        {
+            publishShm(msg);
+        }
+    }
+
+    // the shared pointer goes as is to the plain topic: the subscribers in the same process (nodelets) receive it without copies
+    void publish(const sensor_msgs::PointCloud2ConstPtr& msg)
+    {
+        if (!b_use_shm_)
+        {
+            pub_.publish(msg);
+            return; /// < EXIT POINT
+        }
+        if (pub_.getNumSubscribers() > 0)
+        {
+            pub_.publish(msg);
+        }
+        if (shm_pub_.getNumSubscribers() > 0 || b_latch_)
+        {
+            publishShm(*msg);
+        }
+    }
+
+    uint32_t getNumSubscribers() const
+    { 
+        return pub_.getNumSubscribers() + (b_use_shm_ ? shm_pub_.getNumSubscribers() : 0); 
+    }
+
+    void shutdown()
+    {
+        shutdownShm();
+        pub_.shutdown();
+    }
+
+protected:
+
+    struct Slot
+    {
+        Slot():generation(0), capacity(0) {}
+        std::string name;
+        size_t generation;
+        size_t capacity; // [bytes] of the serialized cloud
+        boost::shared_ptr<boost::interprocess::mapped_region> p_region;
+    };
+
+    void shutdownShm()
+    {
+        for (size_t k = 0; k < slots_.size(); k++)
+        {
+            if (!slots_[k].name.empty()) boost::interprocess::shared_memory_object::remove(slots_[k].name.c_str());
+        }
+        slots_.clear();
+        shm_pub_.shutdown();
+        b_use_shm_ = false;
+    }
+
+    void publishShm(const sensor_msgs::PointCloud2& msg)
+    {
+        namespace bip = boost::interprocess;
+
+        const size_t slot_index = num_published_ % kNumSlots;
+        Slot& slot = slots_[slot_index];
+        const uint64_t size = ros::serialization::serializationLength(msg);
+        try
+        {
+            if (size > slot.capacity)
+            {
+                // a new segment with some headroom: the maps usually grow a little at each update 
+                if (!slot.name.empty()) bip::shared_memory_object::remove(slot.name.c_str());
+                slot.generation++;
+                slot.name = PointCloudShmSlot::segmentName(resolved_topic_, slot_index, slot.generation);
+                slot.capacity = size + size/2;
+                bip::shared_memory_object::remove(slot.name.c_str());
+                bip::shared_memory_object shm(bip::create_only, slot.name.c_str(), bip::read_write);
+                shm.truncate(PointCloudShmSlot::kHeaderSize + slot.capacity);
+                slot.p_region.reset(new bip::mapped_region(shm, bip::read_write));
+                new (slot.p_region->get_address()) std::atomic<uint64_t>(0);
+            }
+        }
+        catch (const bip::interprocess_exception& e)
+        {
+            ROS_WARN_STREAM("PointCloudShmPublisher - cannot create the segment " << slot.name << " (" << e.what() << "), publishing on " << resolved_topic_ << " only");
+            // an empty segment name makes the subscribers fall back on the plain topic
+            trajectory_control_msgs::PointCloudShm shm_msg;
+            shm_msg.header = msg.header;
+            shm_pub_.publish(shm_msg);
+            shutdownShm();
+            pub_.publish(msg);
+            return; /// < EXIT POINT
+        }
+
+        // seqlock write: odd while writing, then a value which identifies this cloud
+        void* address = slot.p_region->get_address();
+        std::atomic<uint64_t>& sequence = PointCloudShmSlot::sequence(address);
+        const uint64_t new_sequence = 2*(num_published_ + 1);
+        sequence.store(new_sequence - 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        ros::serialization::OStream stream(PointCloudShmSlot::data(address), size);
+        ros::serialization::serialize(stream, msg);
+        sequence.store(new_sequence, std::memory_order_release);
+        num_published_++;
+
+        trajectory_control_msgs::PointCloudShm shm_msg;
+        shm_msg.header = msg.header;
+        shm_msg.segment_name = slot.name;
+        shm_msg.slot = slot_index;
+        shm_msg.sequence = new_sequence;
+        shm_msg.size = size;
+        shm_pub_.publish(shm_msg);
+    }
+
+protected:
+
+    std::string resolved_topic_;
+    ros::Publisher pub_;
+    ros::Publisher shm_pub_;
+    bool b_use_shm_;
+    bool b_latch_;
+
+    std::vector<Slot> slots_;
+    uint64_t num_published_;
+};
+
+
+///	\class PointCloudShmSubscriber
+///	\author Luigi Freda
+///	\brief Subscribes to a sensor_msgs/PointCloud2 topic published by a PointCloudShmPublisher: the clouds are read from 
+///	       the shared memory slots named by the descriptors on <topic>/shm. If a segment cannot be opened (e.g. the 
+///	       publisher runs on another host) the subscriber falls back on the plain topic.
+///	\note  A cloud which has been overwritten while it was read (the subscriber is more than kNumSlots clouds late) is dropped.
+/// 	\todo
+///	\date
+///	\warning
+class PointCloudShmSubscriber: private boost::noncopyable
+{
+public:
+
+    typedef boost::function<void(const sensor_msgs::PointCloud2&)> Callback;
+
+public:
+
+    PointCloudShmSubscriber():queue_size_(1), num_dropped_(0) {}
+
+    void subscribe(ros::NodeHandle& n, const std::string& topic_name, uint32_t queue_size, const Callback& callback, bool use_shm = true)
+    {
+        n_ = n;
+        resolved_topic_ = n.resolveName(topic_name);
+        queue_size_ = queue_size;
+        callback_ = callback;
+        regions_.clear();
+        if (use_shm)
+        {
+            sub_ = n_.subscribe(resolved_topic_ + "/shm", queue_size_, &PointCloudShmSubscriber::shmCallback, this);
+        }
+        else
+        {
+            subscribePlain();
+        }
+    }
+
+    void shutdown() { sub_.shutdown(); regions_.clear(); }
+
+    size_t getNumDropped() const { return num_dropped_; }
+
+protected:
+
+    void subscribePlain()
+    {
+        sub_ = n_.subscribe(resolved_topic_, queue_size_, &PointCloudShmSubscriber::plainCallback, this);
+    }
+
+    void plainCallback(const sensor_msgs::PointCloud2ConstPtr& msg)
+    {
+        callback_(*msg);
+    }
+
+    void shmCallback(const trajectory_control_msgs::PointCloudShmConstPtr& msg)
+    {
+        namespace bip = boost::interprocess;
+
+        if (msg->slot >= regions_.size()) regions_.resize(msg->slot + 1);
+        std::pair<std::string, boost::shared_ptr<bip::mapped_region> >& region = regions_[msg->slot];
+        if (region.first != msg->segment_name)
+        {
+            try
+            {
+                bip::shared_memory_object shm(bip::open_only, msg->segment_name.c_str(), bip::read_only);
+                region.second.reset(new bip::mapped_region(shm, bip::read_only));
+                region.first = msg->segment_name;
+            }
+            catch (const bip::interprocess_exception& e)
+            {
+                ROS_WARN_STREAM("PointCloudShmSubscriber - cannot open " << msg->segment_name << " (" << e.what() << "), subscribing to " << resolved_topic_);
+                regions_.clear();
+                subscribePlain(); // replaces the subscription to the descriptors
+                return; /// < EXIT POINT
+            }
+        }
+
+        if (region.second->get_size() < PointCloudShmSlot::kHeaderSize + msg->size) return; /// < EXIT POINT (should not happen)
+
+        // seqlock read: the cloud is valid if the sequence did not change while it was deserialized 
+        void* address = region.second->get_address();
+        const std::atomic<uint64_t>& sequence = PointCloudShmSlot::sequence(address);
+        bool b_valid = (sequence.load(std::memory_order_acquire) == msg->sequence);
+        if (b_valid)
+        {
+            try
+            {
+                ros::serialization::IStream stream(PointCloudShmSlot::data(address), msg->size);
+                ros::serialization::deserialize(stream, cloud_);
+            }
+            catch (const ros::serialization::StreamOverrunException&)
+            {
+                b_valid = false; // torn by a concurrent write
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            b_valid = b_valid && (sequence.load(std::memory_order_relaxed) == msg->sequence);
+        }
+        if (!b_valid)
+        {
+            num_dropped_++;
+            ROS_WARN_STREAM_THROTTLE(5, "PointCloudShmSubscriber - " << resolved_topic_ << ": cloud overwritten before it was read (dropped: " << num_dropped_ << ")");
+            return; /// < EXIT POINT
+        }
+
+        callback_(cloud_);
+    }
+
+protected:
+
+    ros::NodeHandle n_;
+    std::string resolved_topic_;
+    uint32_t queue_size_;
+    Callback callback_;
+    ros::Subscriber sub_;
+
+    std::vector<std::pair<std::string, boost::shared_ptr<boost::interprocess::mapped_region> > > regions_; // mapped segment of each slot
+    sensor_msgs::PointCloud2 cloud_; // reused: its buffers keep their capacity
+    size_t num_dropped_;
+};
+
+
+#endif // POINT_CLOUD_SHM_H_
@@ -0,0 +1,208 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef POINT_HASH_INDEX_H_
+#define POINT_HASH_INDEX_H_
+
+#include <vector>
+#include <unordered_map>
+#include <limits>
+#include <cmath>
+#include <stdint.h>
+
+
+namespace pp
+{
+
+///	\class PointHashIndex
+///	\author Luigi Freda
+///	\brief Spatial hash of 3D points identified by an id: a hash map from the cubic cell (of side cell size) to the points it contains.
+///	       Insertion and removal are O(1); a nearest-neighbor search within a radius <= cell size visits the 27 cells around the query point.
+///	       A search with a larger (or no) radius visits the cells by growing cubic shells and falls back to a scan of all the cells
+///	       when a shell has more cells than the ones occupied.
+///	\note  the index keeps its own copy of the point coordinates; an id is expected to be inserted once
+/// 	\todo
+///	\date
+///	\warning not thread-safe
+template <typename PointT>
+class PointHashIndex
+{
+public:
+
+    typedef uint64_t Id;
+
+protected:
+
+    struct Entry
+    {
+        Id id;
+        float x, y, z;
+    };
+
+    typedef std::vector<Entry> Cell;
+    typedef std::unordered_map<uint64_t, Cell> CellMap;
+
+public:
+
+    PointHashIndex(double cell_size = 1.):cell_size_(cell_size), size_(0) {}
+
+    // change the cell size (the points are re-hashed)
+    void setCellSize(double cell_size)
+    {
+        if ((cell_size <= 0) || (cell_size == cell_size_)) return; /// < EXIT POINT
+        CellMap cells;
+        cells.swap(cells_);
+        cell_size_ = cell_size;
+        for (typename CellMap::const_iterator it = cells.begin(); it != cells.end(); ++it)
+        {
+            for (size_t i = 0, iEnd = it->second.size(); i < iEnd; i++)
+            {
+                const Entry& entry = it->second[i];
+                cells_[getCellKey(getCellCoord(entry.x), getCellCoord(entry.y), getCellCoord(entry.z))].push_back(entry);
+            }
+        }
+    }
+
+    double getCellSize() const { return cell_size_; }
+
+    void clear()
+    {
+        cells_.clear();
+        size_ = 0;
+    }
+
+    void insert(Id id, const PointT& p)
+    {
+        Entry entry;
+        entry.id = id;
+        entry.x = p.x;
+        entry.y = p.y;
+        entry.z = p.z;
+        cells_[getCellKey(getCellCoord(p.x), getCellCoord(p.y), getCellCoord(p.z))].push_back(entry);
+        size_++;
+    }
+
+    // remove the point with the given id (p must be the inserted point); return false if it is not found
+    bool remove(Id id, const PointT& p)
+    {
+        typename CellMap::iterator it = cells_.find(getCellKey(getCellCoord(p.x), getCellCoord(p.y), getCellCoord(p.z)));
+        if (it == cells_.end()) return false; /// < EXIT POINT
+        Cell& cell = it->second;
+        for (size_t i = 0, iEnd = cell.size(); i < iEnd; i++)
+        {
+            if (cell[i].id == id)
+            {
+                cell[i] = cell.back();
+                cell.pop_back();
+                if (cell.empty()) cells_.erase(it);
+                size_--;
+                return true; /// < EXIT POINT
+            }
+        }
+        return false;
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // closest point to p within the radius (< 0: no limit); return false if there is none
+    bool nearestSearch(const PointT& p, Id& id, float& squared_distance, double radius = -1) const
+    {
+        squared_distance = std::numeric_limits<float>::max();
+        if (size_ == 0) return false; /// < EXIT POINT
+
+        const double max_squared_distance = (radius < 0) ? std::numeric_limits<double>::max() : radius*radius;
+        const int64_t cx = getCellCoord(p.x), cy = getCellCoord(p.y), cz = getCellCoord(p.z);
+        bool found = false;
+
+        // a point outside the shell of radius r cells is farther than r*cell_size_ (the query lies in the central cell)
+        for (int64_t r = 0; ; r++)
+        {
+            const double shell_cells = (double)(2*r + 1)*(2*r + 1)*(2*r + 1);
+            if (shell_cells > cells_.size())
+            {
+                // the shell covers more cells than the occupied ones: scan them all
+                for (typename CellMap::const_iterator it = cells_.begin(); it != cells_.end(); ++it)
+                {
+                    searchCell(it->second, p, max_squared_distance, id, squared_distance, found);
+                }
+                return found; /// < EXIT POINT
+            }
+
+            for (int64_t dx = -r; dx <= r; dx++)
+            {
+                for (int64_t dy = -r; dy <= r; dy++)
+                {
+                    const bool on_border = (std::abs(dx) == r) || (std::abs(dy) == r);
+                    for (int64_t dz = -r; dz <= r; dz += (on_border ? 1 : 2*r))
+                    {
+                        typename CellMap::const_iterator it = cells_.find(getCellKey(cx + dx, cy + dy, cz + dz));
+                        if (it != cells_.end()) searchCell(it->second, p, max_squared_distance, id, squared_distance, found);
+                        if (r == 0) break; /// < BREAK
+                    }
+                }
+            }
+
+            const double covered_distance = r*cell_size_;
+            if (found && (squared_distance <= covered_distance*covered_distance)) return true; /// < EXIT POINT
+            if (covered_distance*covered_distance >= max_squared_distance) return found; /// < EXIT POINT
+        }
+    }
+
+protected:
+
+    int64_t getCellCoord(double x) const { return (int64_t)floor(x/cell_size_); }
+
+    static uint64_t getCellKey(int64_t cx, int64_t cy, int64_t cz)
+    {
+        // 21 bits per axis
+        const int64_t kOffset = 1 << 20;
+        return ((((uint64_t)(cx + kOffset)) & 0x1fffff) << 42) |
+               ((((uint64_t)(cy + kOffset)) & 0x1fffff) << 21) |
+                (((uint64_t)(cz + kOffset)) & 0x1fffff);
+    }
+
+    static void searchCell(const Cell& cell, const PointT& p, double max_squared_distance, Id& id, float& squared_distance, bool& found)
+    {
+        for (size_t i = 0, iEnd = cell.size(); i < iEnd; i++)
+        {
+            const Entry& entry = cell[i];
+            const float dx = entry.x - p.x, dy = entry.y - p.y, dz = entry.z - p.z;
+            const float d2 = dx*dx + dy*dy + dz*dz;
+            if ((d2 <= max_squared_distance) && (d2 < squared_distance))
+            {
+                squared_distance = d2;
+                id = entry.id;
+                found = true;
+            }
+        }
+    }
+
+protected:
+
+    double cell_size_; // [m]
+    CellMap cells_;
+    size_t size_;
+};
+
+}
+
+
+#endif //POINT_HASH_INDEX_H_
@@ -0,0 +1,175 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PRIOR_MAP_CLIENT_H_
+#define PRIOR_MAP_CLIENT_H_
+
+#include <string>
+#include <cstring>
+
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/interprocess/exceptions.hpp>
+
+#include <ros/ros.h>
+#include <sensor_msgs/PointCloud2.h>
+
+#include <trajectory_control_msgs/GetPriorMap.h>
+
+
+///	\class PriorMapSharedMemory
+///	\author Luigi Freda
+///	\brief A serialized PointCloud2 in a named shared memory segment: the prior map server writes its layers once and 
+///	       the clients on the same host read them without any transfer through the service.
+///	       Layout of the segment: magic number (uint64), size of the serialized cloud (uint64), serialized cloud.
+///	\note
+/// 	\todo
+///	\date
+///	\warning
+class PriorMapSharedMemory
+{
+public:
+
+    static const uint64_t kMagicNumber = 0x3D3A9912F00DCAFEull;
+    static const size_t kHeaderSize = 2*sizeof(uint64_t);
+
+public:
+
+    static bool write(const std::string& name, const sensor_msgs::PointCloud2& cloud)
+    {
+        namespace bip = boost::interprocess;
+        try
+        {
+            bip::shared_memory_object::remove(name.c_str());
+            bip::shared_memory_object shm(bip::create_only, name.c_str(), bip::read_write);
+            const uint64_t size = ros::serialization::serializationLength(cloud);
+            shm.truncate(kHeaderSize + size);
+            bip::mapped_region region(shm, bip::read_write);
+            uint8_t* data = static_cast<uint8_t*>(region.get_address());
+            const uint64_t magic_number = kMagicNumber;
+            memcpy(data, &magic_number, sizeof(uint64_t));
+            memcpy(data + sizeof(uint64_t), &size, sizeof(uint64_t));
+            ros::serialization::OStream stream(data + kHeaderSize, size);
+            ros::serialization::serialize(stream, cloud);
+        }
+        catch (const bip::interprocess_exception& e)
+        {
+            ROS_WARN_STREAM("PriorMapSharedMemory::write() - cannot write " << name << ": " << e.what());
+            return false; /// < EXIT POINT
+        }
+        return true;
+    }
+
+    static bool read(const std::string& name, sensor_msgs::PointCloud2& cloud)
+    {
+        namespace bip = boost::interprocess;
+        try
+        {
+            bip::shared_memory_object shm(bip::open_only, name.c_str(), bip::read_only);
+            bip::mapped_region region(shm, bip::read_only);
+            const uint8_t* data = static_cast<const uint8_t*>(region.get_address());
+            uint64_t magic_number = 0, size = 0;
+            if (region.get_size() < kHeaderSize) return false; /// < EXIT POINT
+            memcpy(&magic_number, data, sizeof(uint64_t));
+            memcpy(&size, data + sizeof(uint64_t), sizeof(uint64_t));
+            if ((magic_number != kMagicNumber) || (region.get_size() < kHeaderSize + size)) return false; /// < EXIT POINT
+            ros::serialization::IStream stream(const_cast<uint8_t*>(data) + kHeaderSize, size);
+            ros::serialization::deserialize(stream, cloud);
+        }
+        catch (const bip::interprocess_exception&)
+        {
+            return false; /// < EXIT POINT: e.g. the server runs on another host
+        }
+        catch (const ros::serialization::StreamOverrunException&)
+        {
+            return false; /// < EXIT POINT
+        }
+        return true;
+    }
+
+    static void remove(const std::string& name)
+    {
+        boost::interprocess::shared_memory_object::remove(name.c_str());
+    }
+};
+
+
+///	\class PriorMapClient
+///	\author Luigi Freda
+///	\brief Gets the layers of the prior map (see the prior_map_server node), in order to boot a node from the precomputed 
+///	       maps instead of waiting for the mapping pipeline. A layer is read from shared memory if the server is on the 
+///	       same host, otherwise it is received in the service response.
+///	\note
+/// 	\todo
+///	\date
+///	\warning
+class PriorMapClient
+{
+public:
+
+    PriorMapClient(ros::NodeHandle& n, const std::string& service_name)
+    {
+        client_ = n.serviceClient<trajectory_control_msgs::GetPriorMap>(service_name);
+    }
+
+    // get a whole layer ("map", "map_coarse", "wall", "no_wall" or "traversability")
+    bool getLayer(const std::string& layer, sensor_msgs::PointCloud2& cloud, double timeout = 5.0 /*[s]*/)
+    {
+        if (!client_.waitForExistence(ros::Duration(timeout)))
+        {
+            ROS_WARN_STREAM("PriorMapClient::getLayer() - service " << client_.getService() << " not available");
+            return false; /// < EXIT POINT
+        }
+
+        trajectory_control_msgs::GetPriorMap srv;
+        srv.request.layer = layer;
+        srv.request.use_shared_memory = true;
+        if (!client_.call(srv) || !srv.response.success)
+        {
+            ROS_WARN_STREAM("PriorMapClient::getLayer() - cannot get the layer " << layer);
+            return false; /// < EXIT POINT
+        }
+        if (srv.response.shared_memory_name.empty())
+        {
+            cloud = srv.response.cloud;
+            return true; /// < EXIT POINT
+        }
+        if (PriorMapSharedMemory::read(srv.response.shared_memory_name, cloud))
+        {
+            return true; /// < EXIT POINT
+        }
+
+        // the segment is not on this host: get the cloud through the service
+        srv.request.use_shared_memory = false;
+        if (!client_.call(srv) || !srv.response.success)
+        {
+            ROS_WARN_STREAM("PriorMapClient::getLayer() - cannot get the layer " << layer);
+            return false; /// < EXIT POINT
+        }
+        cloud = srv.response.cloud;
+        return true;
+    }
+
+protected:
+
+    ros::ServiceClient client_;
+};
+
+#endif // PRIOR_MAP_CLIENT_H_
@@ -0,0 +1,130 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PRIOR_MAP_SERVER_H_
+#define PRIOR_MAP_SERVER_H_
+
+#include <map>
+#include <string>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/core/noncopyable.hpp>
+
+#include <ros/ros.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <dynamic_reconfigure/server.h>
+
+#include <trajectory_control_msgs/GetPriorMap.h>
+
+#include "ClusterPcl.h"
+#include "NormalEstimationPcl.h"
+#include "TravAnalyzer.h"
+
+
+///	\class PriorMapServer
+///	\author Luigi Freda
+///	\brief Loads a prior map (.pcd or .ply) once and serves its precomputed layers:
+///	       - "map": the map downsampled at leaf_size, with normals (computed if the file has none), as the /dynjoinpcl output;
+///	       - "map_coarse": the map downsampled at coarse_leaf_size;
+///	       - "wall", "no_wall": the clustering of the map, as the /clustered_pcl/wall and /clustered_pcl/no_wall outputs;
+///	       - "traversability": the traversability of the map, as the /trav/traversability output.
+///	       The layers are cached on disk (binary PCD) in a directory keyed by the map file and the parameters, so that a
+///	       restart only reads them back. They are published (latched) on ~<layer> and served by ~get_prior_map: the clients 
+///	       on the same host read them from shared memory (see PriorMapClient), the other ones receive them in the response. 
+///	       A request with a radius gets the layer cropped around a center (a tile of the map).
+///	\note  The clustering and traversability configs are read from ~ClusteringPcl and ~TravAnal, as in the traversability 
+///	       node. They are not part of the cache key: set rebuild_cache to true after changing them.
+/// 	\todo
+///	\date
+///	\warning
+class PriorMapServer: private boost::noncopyable
+{
+public:
+
+    typedef pcl::PointCloud<pcl::PointXYZRGBNormal> PointCloudT;
+
+    static const char* kLayerNames[];
+    static const size_t kNumLayers;
+
+    static const double kDefaultLeafSize;       // [m]
+    static const double kDefaultCoarseLeafSize; // [m]
+
+public:
+
+    PriorMapServer(ros::NodeHandle& n);
+    ~PriorMapServer();
+
+    // load the layers from the cache or compute them, then publish and serve them
+    bool init();
+
+protected:
+
+    bool loadMapFile(PointCloudT& map_pcl, bool& b_has_normals);
+
+    void computeLayers(PointCloudT& map_pcl, bool b_has_normals);
+
+    std::string getCacheDir() const;
+    bool loadCache(const std::string& dir);
+    void saveCache(const std::string& dir) const;
+
+    void publishLayers();
+
+    bool getPriorMapServiceCallback(trajectory_control_msgs::GetPriorMap::Request& req, trajectory_control_msgs::GetPriorMap::Response& res);
+
+    // copy the points of in which are within radius from center on the xy plane
+    static void cropCloud(const sensor_msgs::PointCloud2& in, const geometry_msgs::Point& center, const double radius, sensor_msgs::PointCloud2& out);
+
+    template<typename PointT>
+    void setLayer(const std::string& name, const pcl::PointCloud<PointT>& pcl);
+
+    void clusteringConfigCallback(ClusterPclConfig& config, uint32_t level) { clustering_pcl_.setConfig(config); }
+    void travConfigCallback(TravAnalyzerConfig& config, uint32_t level) { trav_analyzer_.setConfig(config); }
+    void normalConfigCallback(NormalEstimationPclConfig& config, uint32_t level) { normal_estimator_.setConfig(config); }
+
+protected:
+
+    ros::NodeHandle n_;
+
+    std::string map_file_;
+    std::string frame_id_;
+    std::string cache_root_;     // the layers are cached in a sub-directory keyed by the map file and the parameters
+    bool b_rebuild_cache_;
+    bool b_use_shared_memory_;
+
+    double leaf_size_;           // [m]
+    double coarse_leaf_size_;    // [m]
+    double robot_radius_;        // [m]
+    pcl::PointXYZ viewpoint_;    // normals are oriented toward this point (if the map file has none)
+
+    ClusterPcl<pcl::PointXYZRGBNormal> clustering_pcl_;
+    TravAnalyzer trav_analyzer_;
+    NormalEstimationPcl<pcl::PointXYZRGBNormal> normal_estimator_;
+
+    boost::shared_ptr<dynamic_reconfigure::Server<ClusterPclConfig> > clustering_config_server_;
+    boost::shared_ptr<dynamic_reconfigure::Server<TravAnalyzerConfig> > trav_config_server_;
+    boost::shared_ptr<dynamic_reconfigure::Server<NormalEstimationPclConfig> > normal_config_server_;
+
+    std::map<std::string, sensor_msgs::PointCloud2> layers_;
+    std::map<std::string, std::string> shared_memory_names_; // layer name -> segment name (if written)
+    std::map<std::string, ros::Publisher> layer_pubs_;
+    ros::ServiceServer service_;
+};
+
+#endif // PRIOR_MAP_SERVER_H_
@@ -40,6 +40,9 @@
 #include "PathPlannerManager.h"
 
 #include "KdTreeFLANN.h"
+#include "WorkerPool.h"
+#include "PathCache.h"
+#include "WaypointSequencer.h"
 
 #include <trajectory_control_msgs/message_enums.h>
 
@@ -55,23 +58,42 @@
 ///	\warning
 struct TaskSegment
 {
-    TaskSegment():b_aborted(false),crop_step(0){}
+    TaskSegment():b_aborted(false),crop_step(0),map_version(0),b_done(false){}
+    
+    // called by the worker once the planning of the segment is over 
+    void setDone()
+    {
+        {
+            boost::mutex::scoped_lock locker(done_mutex);
+            b_done = true;
+        }
+        done_cond.notify_all();
+    }
+    
+    // wait for the worker to be done with the segment (this replaces the join of the old per-segment thread)
+    // N.B.: do not call it while holding the segment mutex 
+    void waitDone()
+    {
+        boost::mutex::scoped_lock locker(done_mutex);
+        while(!b_done) done_cond.wait(locker);
+    }
     
     SegmentStatus status;
     boost::recursive_mutex status_mutex; // status mutex (for synching on the basis of status)
     
     boost::recursive_mutex mutex; // segment mutex 
-    boost::thread thread;
     
     nav_msgs::Path path;
     
     trajectory_control_msgs::PlanningTask segment_task;
     
+    // N.B.: clouds and kd-trees are immutable snapshots, possibly shared with the planner node and with other segments
     pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr p_wall_pcl;
-    pp::KdTreeFLANN<pcl::PointXYZRGBNormal> wall_kdtree;
+    PathPlanner::WallKdTreeFLANNConstPtr p_wall_kdtree;
     
     pcl::PointCloud<pcl::PointXYZI>::Ptr p_traversability_pcl;
-    PathPlanner::KdTreeFLANN traversability_kdtree;
+    PathPlanner::KdTreeFLANNConstPtr p_traversability_kdtree;
+    NeighborhoodGraph::ConstPtr p_neighborhood_graph; // null if the traversability cloud is cropped
     
     pcl::PointCloud<pcl::PointXYZI>::Ptr p_utility_2d_pcl;
     
@@ -79,6 +101,14 @@ struct TaskSegment
     volatile bool b_aborted; // true if we want to abort it 
     
     int crop_step; // crop step applied by the path planner (see QueuePathPlanner::CropBoxMethod)
+    
+    uint64_t map_version; // version of the traversability snapshot (see QueuePathPlanner::path_cache_)
+    
+protected:
+    
+    bool b_done; // true when the worker is done with the segment 
+    boost::mutex done_mutex;
+    boost::condition_variable done_cond;
 }; 
 
 
@@ -128,14 +158,17 @@ public:
     QueuePathPlanner();
     
 protected:
-    // path planner library stuff: cloud of segmented walls
+    // path planner library stuff: cloud of segmented walls (a new snapshot is allocated at each message)
     volatile bool wall_flag_;
     pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr wall_pcl_;
+    PathPlanner::WallKdTreeFLANNConstPtr wall_kdtree_;
     boost::recursive_mutex wall_pcl_mutex_; 
     
-    // path planner library stuff: traversability cloud
+    // path planner library stuff: traversability cloud (a new snapshot is allocated at each message)
     volatile bool traversability_flag_;
     pcl::PointCloud<pcl::PointXYZI>::Ptr traversability_pcl_;
+    PathPlanner::KdTreeFLANNConstPtr traversability_kdtree_; // kd-tree of the full traversability_pcl_ (lazily built and shared by all the segments)
+    NeighborhoodGraph::ConstPtr traversability_graph_; // neighborhood graph of the full traversability_pcl_ (lazily built and shared by all the segments)
     boost::recursive_mutex traversability_pcl_mutex_; 
     
     // path planner library stuff: utility cloud (same points of traversability)
@@ -190,6 +223,21 @@ protected:
     // the main path planning callback: perform the planning on the input segment of the given input task
     void pathPlanningCallback(TaskSegmentPtr segment, TaskPtr task);
     
+    // push the segment planning in the worker pool queue 
+    void startSegmentPlanning(TaskSegmentPtr segment, TaskPtr task);
+    // job executed by a worker: plan the segment and then signal it is done 
+    void segmentPlanningJob(TaskSegmentPtr segment, TaskPtr task);
+    
+    // compute the visiting order of the task waypoints (waypoints[0] is the robot position, see PlanningTask::optimize_order): the cost matrix is 
+    // computed with one one-to-many planning per waypoint and the order with WaypointSequencer; order is a permutation of 1..waypoints.size()-1 
+    // N.B.: if the path cache is enabled, the planned paths between consecutive waypoints are cached for the segments 
+    bool computeWaypointsOrder(const std::vector<geometry_msgs::Point>& waypoints, const std::vector<int>& priorities, bool b_closed, std::vector<int>& order);
+    // job executed by a worker: the costs (and paths) from the start point (index in the traversability snapshot) to all the waypoints
+    void waypointsCostSweepJob(TaskSegmentPtr snapshot, const std::vector<pcl::PointXYZI>& points, int start_point_idx, std::vector<double>& costs, std::vector<nav_msgs::Path>& paths);
+    
+    // prepare the (cropped) traversability and utility snapshots of the segment together with their kd-tree (see segment->crop_step)
+    void prepareTraversabilityInput(TaskSegmentPtr segment, const pcl::PointXYZI& start, const pcl::PointXYZI& goal);
+    
     void publishCropboxPcl(TaskSegmentPtr segment, TaskPtr task);
     void publishTestCropboxPcl(TaskSegmentPtr segment, TaskPtr task);
     
@@ -206,6 +254,24 @@ protected:
     float lambda_trav_;
     float lambda_utility_2d_;
     float tau_exp_decay_;
+    
+    int open_set_type_;
+    double open_set_bucket_resolution_;
+    
+    bool b_use_neighborhood_graph_;
+    
+    int random_seed_;
+    
+    bool b_use_bidirectional_search_;
+    
+    double waypoints_order_time_budget_; // [s] time budget of the waypoints order optimization (see computeWaypointsOrder())
+    
+    uint64_t traversability_map_version_; // incremented at each new traversability snapshot 
+    PathCache path_cache_; // paths of the planned segments 
+    
+    // fixed pool of planning workers shared by all the segments of all the tasks 
+    // N.B.: keep it as the last member: it must be destroyed (and its workers joined) before the data used by the planning jobs 
+    boost::shared_ptr<WorkerPool> p_worker_pool_;
 };
 
 #endif
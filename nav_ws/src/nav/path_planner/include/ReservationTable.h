@@ -0,0 +1,120 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RESERVATION_TABLE_H_
+#define RESERVATION_TABLE_H_
+
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/core/noncopyable.hpp>
+
+
+///	\class ReservationTable
+///	\author Luigi Freda
+///	\brief Space-time reservation table shared by the planners of a team: each robot reserves the cells swept by its footprint
+///	       along its planned path, each cell for the time interval [t - time_margin, t + time_margin] around the time t the robot
+///	       is expected to be there. The planner of a robot queries the cells it is going to cross at its arrival times and
+///	       yields to the reservations of the robots with a higher priority (prioritized planning: a lower robot id has a higher priority).
+///	\note  It is thread-safe. The cells are 3D (with size cell_size), the footprint is a disk of radius footprint_radius which
+///	       also covers the cells just above and below the path.
+/// 	\todo
+///	\date
+///	\warning times are absolute [s]: the robot clocks must be synched
+class ReservationTable: private boost::noncopyable
+{
+public:
+
+    typedef boost::shared_ptr<ReservationTable> Ptr;
+
+    static const float kDefaultCellSize;        // [m]
+    static const double kDefaultTimeMargin;     // [s] half width of the time interval reserved around each arrival time
+    static const float kDefaultFootprintRadius; // [m]
+
+    struct TimedPoint
+    {
+        float x, y, z;
+        double time; // [s] arrival time
+    };
+
+public:
+
+    ReservationTable(float cell_size = kDefaultCellSize, double time_margin = kDefaultTimeMargin, float footprint_radius = kDefaultFootprintRadius);
+
+    // replace the reservations of the robot with the ones of the input path (an empty path clears them)
+    void reservePath(int robot_id, const std::vector<TimedPoint>& path);
+
+    void clearRobot(int robot_id);
+
+    // remove the reservations which ended before the input time
+    void removeExpired(double time);
+
+    void clear();
+
+    // number of robots with a higher priority than robot_id which reserved the cell of (x, y, z) at the input time
+    int getConflicts(int robot_id, float x, float y, float z, double time);
+
+    // batch version of getConflicts() (the table is locked once)
+    void getConflicts(int robot_id, const float* x, const float* y, const float* z, const double* time, size_t n, int* conflicts);
+
+    size_t getNumCells();
+
+    float getCellSize() const { return cell_size_; }
+    double getTimeMargin() const { return time_margin_; }
+    float getFootprintRadius() const { return footprint_radius_; }
+
+protected:
+
+    struct Interval
+    {
+        int robot_id;
+        double begin;
+        double end;
+    };
+
+    typedef uint64_t CellKey;
+
+    CellKey getCellKey(int ix, int iy, int iz) const;
+
+    // reserve the cells of the footprint centered at (x, y, z) for [time - time_margin, time + time_margin]
+    void reserveFootprint(int robot_id, float x, float y, float z, double time, std::vector<CellKey>& robot_cells);
+
+    // remove the intervals of the robot (the lock must be held)
+    void removeRobot(int robot_id);
+
+    int countConflicts(int robot_id, float x, float y, float z, double time) const;
+
+protected:
+
+    boost::mutex mutex_;
+
+    float cell_size_;
+    double time_margin_;
+    float footprint_radius_;
+
+    std::unordered_map<CellKey, std::vector<Interval> > cells_;
+    std::unordered_map<int, std::vector<CellKey> > robot_cells_; // cells reserved by each robot
+};
+
+
+#endif //RESERVATION_TABLE_H_
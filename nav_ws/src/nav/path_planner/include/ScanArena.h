@@ -0,0 +1,173 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SCAN_ARENA_H_
+#define SCAN_ARENA_H_
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <typeindex>
+#include <typeinfo>
+
+#include <boost/core/noncopyable.hpp>
+
+
+///	\class ScanArena
+///	\author Luigi Freda
+///	\brief Pool of the temporary containers of a scan callback (point clouds, index vectors, flag vectors, ...).
+///	       A container is taken from the pool with get<T>() and goes back to it when its ScanArena::Buffer is destroyed:
+///	       its storage is kept, so that after the first scans the temporaries of a callback are served without any 
+///	       malloc/free (the containers only grow up to the size of the largest scan).
+///	\note  get<T>() returns the container as left by its previous user: the caller must reset it (e.g. assign(), resize() 
+///	       or clear(), which keep the capacity). getVector() does it for the vectors.
+/// 	\todo
+///	\date
+///	\warning get() and the release of the buffers are thread-safe, a Buffer must not outlive its ScanArena. 
+///	         A copy of an arena is an empty arena (the pooled storage is not a state of the owner).
+class ScanArena
+{
+protected:
+
+    class PoolBase
+    {
+    public:
+        virtual ~PoolBase() {}
+        virtual void clear() = 0;
+    };
+
+    template<typename T>
+    class Pool: public PoolBase
+    {
+    public:
+        T* get()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (free_.empty()) return new T(); /// < EXIT POINT
+            T* p = free_.back().release();
+            free_.pop_back();
+            return p;
+        }
+
+        void release(T* p)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            free_.emplace_back(p);
+        }
+
+        size_t size()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return free_.size();
+        }
+
+        void clear()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            free_.clear();
+        }
+
+    protected:
+        std::mutex mutex_;
+        std::vector<std::unique_ptr<T> > free_;
+    };
+
+public:
+
+    // container taken from the pool, given back on destruction (movable, not copyable)
+    template<typename T>
+    class Buffer: private boost::noncopyable
+    {
+    public:
+        Buffer(T* p, Pool<T>* pool):p_(p), pool_(pool) {}
+        Buffer(Buffer&& other):p_(other.p_), pool_(other.pool_) { other.p_ = 0; }
+        ~Buffer() { if (p_) pool_->release(p_); }
+
+        T& operator*() const { return *p_; }
+        T* operator->() const { return p_; }
+        T& get() const { return *p_; }
+
+    protected:
+        T* p_;
+        Pool<T>* pool_;
+    };
+
+public:
+
+    ScanArena() {}
+    ScanArena(const ScanArena&) {}
+    ScanArena& operator=(const ScanArena&) { return *this; }
+
+    // a container of type T (see the note above: its content is the one left by the previous user)
+    template<typename T>
+    Buffer<T> get()
+    {
+        Pool<T>* pool = getPool<T>();
+        return Buffer<T>(pool->get(), pool);
+    }
+
+    // a vector of n copies of value
+    template<typename T>
+    Buffer<std::vector<T> > getVector(size_t n, const T& value = T())
+    {
+        Buffer<std::vector<T> > buffer = get<std::vector<T> >();
+        buffer->assign(n, value);
+        return buffer;
+    }
+
+    // number of free containers of type T in the pool
+    template<typename T>
+    size_t getNumFree()
+    {
+        return getPool<T>()->size();
+    }
+
+    // release the storage of all the free containers (the buffers in use are not affected)
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (PoolMap::iterator it = pools_.begin(); it != pools_.end(); ++it)
+        {
+            it->second->clear(); // the pools themselves are kept: the buffers in use refer to them
+        }
+    }
+
+protected:
+
+    typedef std::map<std::type_index, std::unique_ptr<PoolBase> > PoolMap;
+
+    template<typename T>
+    Pool<T>* getPool()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::unique_ptr<PoolBase>& pool = pools_[std::type_index(typeid(T))];
+        if (!pool) pool.reset(new Pool<T>());
+        return static_cast<Pool<T>*>(pool.get());
+    }
+
+protected:
+
+    std::mutex mutex_;
+    PoolMap pools_;
+};
+
+
+#endif //SCAN_ARENA_H_
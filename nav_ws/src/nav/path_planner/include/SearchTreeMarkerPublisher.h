@@ -0,0 +1,130 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SEARCH_TREE_MARKER_PUBLISHER_H_
+#define SEARCH_TREE_MARKER_PUBLISHER_H_
+
+#include <vector>
+#include <string>
+#include <atomic>
+#include <limits>
+
+#include <boost/thread.hpp>
+#include <boost/core/noncopyable.hpp>
+
+#include <pcl/point_types.h>
+
+#include <ros/ros.h>
+#include <visualization_msgs/MarkerArray.h>
+
+
+///	\class SearchTreeMarkerPublisher
+///	\author Luigi Freda
+///	\brief Publishes the nodes expanded by a planner as a single POINTS marker from its own low-rate thread.
+///	       The planner pushes the node positions into a lock-free single-producer single-consumer ring buffer;
+///	       the publisher thread drains it at each period, accumulates the points of the current search and publishes them.
+///	\note  push() and clear() never block and never allocate: when nobody is subscribed they return immediately,
+///	       when the ring buffer is full the points are dropped (visualization only).
+/// 	\todo
+///	\date
+///	\warning push() and clear() must be called by a single thread (the planning one)
+class SearchTreeMarkerPublisher: private boost::noncopyable
+{
+public:
+
+    static const size_t kDefaultRingCapacity;        // max number of points pushed and not yet drained (rounded up to a power of 2)
+    static const double kDefaultPublishPeriodSec;    // [s] period of the publisher thread
+    static const size_t kMaxNumPoints;               // max number of points of the published marker
+    static const double kPointSize;                  // [m]
+
+public:
+
+    SearchTreeMarkerPublisher(ros::NodeHandle& n, const std::string& topic_name,
+                              size_t ring_capacity = kDefaultRingCapacity, double publish_period_sec = kDefaultPublishPeriodSec);
+    ~SearchTreeMarkerPublisher();
+
+    // true if somebody is subscribed to the marker topic (updated by the publisher thread)
+    bool isActive() const { return b_active_.load(std::memory_order_relaxed); }
+
+    // add a node position of the current search
+    void push(const pcl::PointXYZI& point)
+    {
+        if (!isActive()) return; /// < EXIT POINT
+        pushEntry(point.x, point.y, point.z);
+    }
+
+    // start a new search: the points pushed so far are removed from the marker
+    void clear()
+    {
+        if (!isActive()) return; /// < EXIT POINT
+        pushEntry(std::numeric_limits<float>::quiet_NaN(), 0.f, 0.f); // sentinel
+    }
+
+protected:
+
+    struct Entry
+    {
+        float x, y, z;
+    };
+
+protected:
+
+    void pushEntry(float x, float y, float z)
+    {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) >= ring_.size())
+        {
+            num_dropped_points_.fetch_add(1, std::memory_order_relaxed);
+            return; /// < EXIT POINT
+        }
+        Entry& entry = ring_[head & ring_mask_];
+        entry.x = x;
+        entry.y = y;
+        entry.z = z;
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+    // publisher thread
+    void publishLoop();
+
+    // move the pushed entries into the marker; return true if the marker changed
+    bool drain();
+
+protected:
+
+    ros::Publisher pub_;
+    double publish_period_sec_;
+
+    // ring buffer: head_ is written only by the producer, tail_ only by the publisher thread
+    std::vector<Entry> ring_;
+    size_t ring_mask_;
+    std::atomic<size_t> head_;
+    std::atomic<size_t> tail_;
+    std::atomic<size_t> num_dropped_points_;
+
+    std::atomic<bool> b_active_;
+
+    visualization_msgs::MarkerArray marker_array_; // a single POINTS marker (used only by the publisher thread)
+
+    boost::thread thread_;
+};
+
+
+#endif //SEARCH_TREE_MARKER_PUBLISHER_H_
@@ -33,6 +33,11 @@
 
 #include <boost/make_shared.hpp>
 
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
 #ifndef M_2PI
 #define M_2PI (2 * M_PI)
 #endif
@@ -91,4 +96,61 @@ void sphericalPartition(const pcl::PointCloud<PointT>& input, pcl::PointCloud<Po
 	}
 }
 
+// compute the flat bucket of each point (-1 if the point is farther than max_range from the center);
+// the loop is branch-free and in single precision in order to be vectorized, and it is parallelized over the points
+template<typename PointT>
+void sphericalBuckets(const pcl::PointCloud<PointT>& input, const pcl::PointXYZ& center, unsigned int subdivisions, std::vector<int>& buckets,
+                      float max_range = std::numeric_limits<float>::max(), int num_threads = 1)
+{
+	const int n = input.size();
+	buckets.resize(n);
+	if(n == 0) return; /// < EXIT POINT
+
+	const float cx = center.x, cy = center.y, cz = center.z;
+	const float k_phi = subdivisions / M_2PI;
+	const float k_theta = subdivisions / M_PI;
+	const int max_bucket = subdivisions - 1;
+	const float max_range2 = (max_range < std::sqrt(std::numeric_limits<float>::max())) ? max_range * max_range : std::numeric_limits<float>::max();
+	const PointT* points = &input.points[0];
+	int* out = &buckets[0];
+
+	#pragma omp parallel for simd num_threads(num_threads) schedule(static)
+	for(int i = 0; i < n; i++)
+	{
+		const float dx = points[i].x - cx;
+		const float dy = points[i].y - cy;
+		const float dz = points[i].z - cz;
+		const float r2 = dx * dx + dy * dy + dz * dz;
+		const float r = std::sqrt(r2);
+		// inclination [0..PI] (0 for the center itself), azimuth [0..2PI)
+		const float theta = std::acos(std::min(std::max(dz / std::max(r, 1e-12f), -1.f), 1.f));
+		float phi = std::atan2(dy, dx);
+		phi += (phi < 0) ? (float)M_2PI : 0.f;
+		const int bucket1 = std::min((int)(phi * k_phi), max_bucket);
+		const int bucket2 = std::min((int)(theta * k_theta), max_bucket);
+		out[i] = (r2 <= max_range2) ? bucket1 * (int)subdivisions + bucket2 : -1;
+	}
+}
+
+// group the point indices by bucket (counting sort, the input order is kept within each bucket):
+// the points of bucket b are indices[offsets[b]..offsets[b+1]); the points with a negative bucket are discarded
+inline void bucketIndices(const std::vector<int>& buckets, const size_t num_buckets, std::vector<size_t>& offsets, std::vector<size_t>& indices)
+{
+	offsets.assign(num_buckets + 1, 0);
+	for(size_t i = 0; i < buckets.size(); i++)
+	{
+		if(buckets[i] >= 0) offsets[buckets[i] + 1]++;
+	}
+	for(size_t b = 0; b < num_buckets; b++)
+	{
+		offsets[b + 1] += offsets[b];
+	}
+	indices.resize(offsets[num_buckets]);
+	std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+	for(size_t i = 0; i < buckets.size(); i++)
+	{
+		if(buckets[i] >= 0) indices[next[buckets[i]]++] = i;
+	}
+}
+
 #endif // PCL_FILTERS_SPHERICALPARTITION_H_
@@ -27,8 +27,12 @@
 
 #include <cmath>
 #include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <stdint.h>
 
 #include <Eigen/Dense>
+#include <Eigen/Eigenvalues>
 #include <Eigen/StdVector>
 
 #include <boost/shared_ptr.hpp>
@@ -56,6 +60,10 @@
 #include "Transform.h"
 #include "KdTreeFLANN.h"
 #include "MultiConfig.h"
+#include "DistanceTransform.h"
+#include "EsdfMapAdapter.h"
+#include "TravPointTypes.h"
+#include "ScanArena.h"
 
 
 ///	\class TravAnalyzer
@@ -90,6 +98,9 @@ public:
     
     static const float kRobotZOffset; // [m] how much each point is pushed higher from the map in the robot direction (TODO: we should use here local normals!) 
     
+    static const double kBlockSize; // [m] size of the spatial blocks processed by the threads of computeTrav()
+    static const double kCacheKeyLeafSize; // [m] voxel size for identifying a point across two consecutive maps (incremental update)
+    
     static const double kObstPclResetTime; // [s] if elapsed time from last obst pcl check is > kObstPclResetTime then obst_pcl is not used anymore
     static const double kObstDistDiscardIfCloseToNoWall; // [m] distance threshold between (obstacle point, closest noWall point) to discard obstacle point 
     static const double kObstDist2DiscardIfCloseToNoWall; // squared distance     
@@ -109,6 +120,9 @@ public:
     
     void setInput(std::vector<int>& clusters_info, pcl::PointCloud<pcl::PointXYZRGBNormal>& wall_pcl, pcl::PointCloud<pcl::PointXYZRGBNormal>& input_pcl);
 
+    // N.B.: the points are processed in spatial blocks by config_.num_threads threads (0: all the hardware threads); the output does not depend on the number of threads 
+    //       if config_.incremental_update is set, the roughness and the density of a point are reused from the previous map when no point 
+    //       has been added or removed within the analysis radius; the label and the clearance are always recomputed
     void computeTrav(PointCloudI& traversabilty_pcl);
         
 public: /// < setters     
@@ -116,6 +130,7 @@ public: /// < setters
     inline void setConfig(TravAnalyzerConfig& new_config)
     {
         config_ = new_config;
+        b_reset_neighborhood_cache_ = true; // the cached terms depend on the config
     }
     
     void initTransformListener()
@@ -144,10 +159,16 @@ public: /// < setters
     void setMultiRobotPath(const trajectory_control_msgs::MultiRobotPath& msg);
     
     void setTeammateBaseFrame(const std::string& frame, int id) { teammate_base_link_frame_[id] = frame; } 
+    
+    // ESDF map used for the wall clearance if config_.use_esdf is set (instead of the nearest neighbor searches and the distance transform)
+    void setEsdfMap(const boost::shared_ptr<EsdfMapAdapter>& p_esdf_map) { p_esdf_map_ = p_esdf_map; }
 
 public: /// < getters 
     
     void getPcl(PointCloudI& clearence_pcl, PointCloudI& density_pcl, PointCloudI& label_pcl, PointCloudI& roughnes_pcl);
+    
+    // all the channels of the last computeTrav() in a single cloud (same points and order of the traversability cloud)
+    void getTravChannelsPcl(pcl::PointCloud<PointXYZTrav>& channels_pcl);
         
     inline TravAnalyzerConfig getConfig()
     {
@@ -162,6 +183,22 @@ public: /// < getters
     
 protected:
     
+    // traversability terms of a point 
+    struct TravTerms
+    {
+        TravTerms():wTot(0), wD(0), wR(0), wL(0), wC(0), b_valid(false), b_reused(false){}
+        double wTot, wD, wR, wL, wC;
+        bool b_valid; // false if the point is not traversable (e.g. it brings the robot into collision)
+        bool b_reused; // true if wR and wD have been taken from the neighborhood cache 
+    };
+    
+    // terms which only depend on the neighborhood of a point 
+    struct NeighborhoodTerms
+    {
+        float wR, wD;
+    };
+    typedef std::unordered_map<uint64_t, NeighborhoodTerms> NeighborhoodCache; // keyed on the voxel key (kCacheKeyLeafSize) of the point 
+    
     template<class Point1, class Point2>
     static double distSquared(const Point1& p1, const Point2& p2);
     
@@ -176,14 +213,39 @@ protected:
     
     void buildFutureTrailsPcl(); 
     
+    // append a point with its traversability terms to the output clouds 
+    void pushTravPoint(float x, float y, float z, const TravTerms& term);
+    
+    // adaptive resolution output (config_.adaptive_resolution): the valid points are grouped in a quadtree of x-y cells, from the 
+    // cells of size adaptive_max_cell_size down to leaf_size; a uniform cell is replaced by a single point at its centroid with the 
+    // max cost of its points, the other cells are split (the points of the finest level are kept as they are) 
+    void collectAdaptiveResolution(const std::vector<TravTerms>& terms, size_t num_points);
+    // a cell is uniform if it is filled (adaptive_min_fill_ratio), far from walls and obstacles (null clearance cost), with a single label, 
+    // a roughness range within adaptive_roughness_tolerance and its points within adaptive_max_plane_residual from their least-squares plane 
+    bool isUniformCell(const std::vector<int>& cell, double cell_size, const std::vector<TravTerms>& terms) const;
+    // group the points by x-y cell of size cell_size (the cells of size cell_size/2 are nested in them); the cells are sorted by key 
+    void groupByCell(const std::vector<int>& indices, double cell_size, std::vector<std::vector<int> >& cells) const;
+    
+    // set b_unchanged[i] if no point has been added or removed within radius from the point i since the last update 
+    void findUnchangedNeighborhoods(const std::vector<uint64_t>& point_keys, const double radius, std::vector<char>& b_unchanged);
+    static void markNeighborCells(const pcl::PointXYZRGBNormal& point, const double cell_size, std::unordered_set<uint64_t>& cells);
+    
 protected: // sub-methods for computing traversability contributions 
     
+    // dispatch to the roughness method selected by config_.roughness_method
     double computeRough(int point_index, const pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr& nh);
+    double computeRoughRansac(const pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr& nh);
+    // least-squares plane through the centroid, normal from the 3x3 covariance (closed-form eigen-solve); same residual as computeRoughRansac()
+    double computeRoughPca(const pcl::PointCloud<pcl::PointXYZRGBNormal>& nh);
     inline double computeDensity(int point_index, pcl::PointCloud<pcl::PointXYZRGBNormal>& nh);
     inline double computeDensity(int point_index, pcl::PointCloud<pcl::PointXYZRGBNormal>& nh, double pow_config_leaf_size_3, double volume_local_sphere);
     inline double computePlanarDensity(int point_index, pcl::PointCloud<pcl::PointXYZRGBNormal>& nh, double pow_config_leaf_size_3, double volume_local_sphere);
         
     double computeClearance(int point_index);
+    // clearance from the distance transforms (O(1) lookups)
+    double computeClearanceDT(int point_index);
+    // build the distance transforms of walls + obstacles and of the teammate future trails; return false if they cannot be used 
+    bool buildClearanceDistanceTransforms();
     double computeLabel(int point_index);
     
     void downSamplePath(const nav_msgs::Path& in, const PointOutI& start_point, nav_msgs::Path& out); 
@@ -200,9 +262,28 @@ protected:
     pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr noWall_pcl_;
     
     PointCloudI traversabilty_pcl_, density_pcl_, clearence_pcl_, label_pcl_, roughness_pcl_;
+    
+    // incremental update 
+    volatile bool b_reset_neighborhood_cache_;
+    NeighborhoodCache neighborhood_cache_;
+    double neighborhood_cache_radius_; // analysis radius used for the cached terms
+    pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr prev_noWall_pcl_;
+    std::vector<uint64_t> prev_point_keys_;
+    
+    // clearance distance transforms (built at each computeTrav() if config_.use_distance_transform is set)
+    DistanceTransform clearance_dt_; // walls and obstacles 
+    DistanceTransform trails_dt_;    // teammate future trails
+    bool b_clearance_dt_ready_; 
+    bool b_trails_dt_ready_; 
+    
+    // ESDF map (optional backend for the wall clearance)
+    boost::shared_ptr<EsdfMapAdapter> p_esdf_map_;
+    bool b_clearance_esdf_ready_; 
 
     pp::KdTreeFLANN<pcl::PointXYZRGBNormal> wall_kdtree_;
     pp::KdTreeFLANN<pcl::PointXYZRGBNormal> noWall_kdtree_; 
+
+    ScanArena arena_; // temporaries of computeTrav(), reused scan after scan
     
     bool b_ready_; // ready to compute 
     bool b_empty_wall_; 
@@ -0,0 +1,63 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRAV_POINT_TYPES_H_
+#define TRAV_POINT_TYPES_H_
+
+#ifndef PCL_NO_PRECOMPILE
+#define PCL_NO_PRECOMPILE
+#endif
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/register_point_struct.h>
+
+
+///	\struct PointXYZTrav
+///	\author Luigi Freda
+///	\brief Traversability point carrying all the traversability channels in a single cloud.
+///	\note  The field "intensity" is the total traversability cost, as in the /trav/traversability cloud (pcl::PointXYZI):
+///	       a subscriber of the combined cloud can read it as a pcl::PointXYZI cloud (the other fields are skipped by fromROSMsg).
+/// 	\todo
+///	\date
+///	\warning
+struct PointXYZTrav
+{
+    PCL_ADD_POINT4D;     // x, y, z (+ padding)
+    float intensity;     // total traversability cost
+    float clearance;
+    float density;
+    float label;
+    float roughness;
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+} EIGEN_ALIGN16;
+
+POINT_CLOUD_REGISTER_POINT_STRUCT(PointXYZTrav,
+                                  (float, x, x)
+                                  (float, y, y)
+                                  (float, z, z)
+                                  (float, intensity, intensity)
+                                  (float, clearance, clearance)
+                                  (float, density, density)
+                                  (float, label, label)
+                                  (float, roughness, roughness)
+)
+
+#endif //TRAV_POINT_TYPES_H_
@@ -0,0 +1,96 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef WAYPOINT_SEQUENCER_H_
+#define WAYPOINT_SEQUENCER_H_
+
+#include <vector>
+#include <cstddef>
+
+
+///	\class WaypointSequencer
+///	\author Luigi Freda
+///	\brief Visiting order of a list of waypoints which reduces the total travel cost from a start node (open or closed tour).
+///	       The waypoints are first sorted by priority (a higher priority comes first, ties keep the input order) and then chained by
+///	       nearest neighbor within each priority block; the order is then improved by local search (first improvement) with 2-opt moves
+///	       (reversal of a subsequence) and Or-opt moves (relocation of a chain of up to kMaxOrOptChainLength consecutive waypoints),
+///	       until no move improves the cost or the time budget is over.
+///	\note  The moves never cross the priority blocks: a waypoint is never visited before a waypoint with a higher priority.
+///	       The costs need not be symmetric (the 2-opt gains account for the reversed direction).
+/// 	\todo
+///	\date
+///	\warning the costs must be finite (map the unreachable pairs to a large penalty)
+class WaypointSequencer
+{
+public:
+
+    static const double kDefaultTimeBudgetSec;  // [s]
+    static const int kMaxOrOptChainLength;
+
+    struct Stats
+    {
+        double initial_cost; // cost of the nearest neighbor order
+        double cost;         // cost of the final order
+        int num_moves;       // number of applied 2-opt and Or-opt moves
+        bool b_timeout;      // true if the local search was stopped by the time budget
+    };
+
+public:
+
+    WaypointSequencer(double time_budget_sec = kDefaultTimeBudgetSec);
+
+    void setTimeBudget(double time_budget_sec) { time_budget_sec_ = time_budget_sec; }
+    double getTimeBudget() const { return time_budget_sec_; }
+
+    // costs: (n+1)x(n+1) row-major matrix, node 0 is the start and nodes 1..n are the waypoints, costs[i*(n+1) + j] is the cost from i to j
+    // priorities: priority of each waypoint (n values, empty if all the waypoints have the same priority)
+    // b_closed: if true the tour returns to the start
+    // order_out: visiting order (a permutation of 1..n); return its cost
+    double solve(const std::vector<double>& costs, const std::vector<int>& priorities, bool b_closed, std::vector<int>& order_out);
+
+    const Stats& getStats() const { return stats_; }
+
+protected:
+
+    double getCost(int from, int to) const { return (*p_costs_)[from*num_nodes_ + to]; }
+
+    // build the forward and backward cumulative costs of the tour
+    void updatePrefixCosts();
+
+    // try the 2-opt and Or-opt moves within the block [block_begin, block_end) of tour positions; return true if a move has been applied
+    bool improveTwoOpt(size_t block_begin, size_t block_end);
+    bool improveOrOpt(size_t block_begin, size_t block_end);
+
+protected:
+
+    double time_budget_sec_;
+    Stats stats_;
+
+    const std::vector<double>* p_costs_;
+    size_t num_nodes_;
+
+    std::vector<int> tour_;             // start node, waypoints (and start node again if closed)
+    size_t num_waypoint_positions_;     // the waypoints are at the tour positions 1..num_waypoint_positions_
+    std::vector<double> forward_cost_;  // forward_cost_[k] = cost of tour_[0] -> ... -> tour_[k]
+    std::vector<double> backward_cost_; // backward_cost_[k] = cost of tour_[k] -> ... -> tour_[0]
+};
+
+
+#endif //WAYPOINT_SEQUENCER_H_
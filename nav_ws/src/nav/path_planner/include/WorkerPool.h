@@ -0,0 +1,167 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef WORKER_POOL_H_
+#define WORKER_POOL_H_
+
+#include <deque>
+#include <vector>
+#include <algorithm>
+
+#include <boost/thread.hpp>
+#include <boost/function.hpp>
+#include <boost/bind.hpp>
+#include <boost/core/noncopyable.hpp>
+
+
+///	\class WorkerPool
+///	\author Luigi Freda
+///	\brief Fixed pool of worker threads which execute the pushed jobs in FIFO order
+///	\note the workers are created once in the constructor: pushing a job does not create any thread
+/// 	\todo
+///	\date
+///	\warning pending jobs are dropped by stop() (and by the destructor); running jobs are joined
+class WorkerPool: private boost::noncopyable
+{
+public:
+
+    typedef boost::function<void()> Job;
+
+public:
+
+    // if num_workers <= 0 then the number of hardware threads is used
+    WorkerPool(int num_workers = 0):b_stop_(false)
+    {
+        if(num_workers <= 0) num_workers = std::max((int)boost::thread::hardware_concurrency(), 1);
+        for(int i = 0; i < num_workers; i++)
+        {
+            workers_.create_thread(boost::bind(&WorkerPool::workerLoop, this));
+        }
+        num_workers_ = num_workers;
+    }
+
+    ~WorkerPool()
+    {
+        stop();
+    }
+
+    void push(const Job& job)
+    {
+        {
+            boost::mutex::scoped_lock locker(mutex_);
+            if(b_stop_) return; /// < EXIT POINT
+            jobs_.push_back(job);
+        }
+        cond_.notify_one();
+    }
+
+    // push the jobs and block until all of them have been executed
+    // N.B.: it must not be called by a worker and the pool must not be stopped meanwhile
+    void pushAndWait(const std::vector<Job>& jobs)
+    {
+        JobsBarrier barrier(jobs.size());
+        for(size_t i = 0; i < jobs.size(); i++)
+        {
+            push(boost::bind(&WorkerPool::runJob, jobs[i], &barrier));
+        }
+        barrier.wait();
+    }
+
+    // drop the pending jobs and join the workers
+    void stop()
+    {
+        {
+            boost::mutex::scoped_lock locker(mutex_);
+            if(b_stop_) return; /// < EXIT POINT
+            b_stop_ = true;
+            jobs_.clear();
+        }
+        cond_.notify_all();
+        workers_.join_all();
+    }
+
+    int getNumWorkers() const { return num_workers_; }
+
+    size_t getNumPendingJobs()
+    {
+        boost::mutex::scoped_lock locker(mutex_);
+        return jobs_.size();
+    }
+
+protected:
+
+    struct JobsBarrier
+    {
+        JobsBarrier(size_t num_jobs):num_pending(num_jobs) {}
+
+        void notifyDone()
+        {
+            boost::mutex::scoped_lock locker(mutex);
+            if(--num_pending == 0) cond.notify_all();
+        }
+
+        void wait()
+        {
+            boost::mutex::scoped_lock locker(mutex);
+            while(num_pending > 0) cond.wait(locker);
+        }
+
+        boost::mutex mutex;
+        boost::condition_variable cond;
+        size_t num_pending;
+    };
+
+    static void runJob(const Job& job, JobsBarrier* p_barrier)
+    {
+        job();
+        p_barrier->notifyDone();
+    }
+
+protected:
+
+    void workerLoop()
+    {
+        while(true)
+        {
+            Job job;
+            {
+                boost::mutex::scoped_lock locker(mutex_);
+                while(jobs_.empty() && !b_stop_) cond_.wait(locker);
+                if(b_stop_) return; /// < EXIT POINT
+                job = jobs_.front();
+                jobs_.pop_front();
+            }
+            job();
+        }
+    }
+
+protected:
+
+    boost::mutex mutex_;
+    boost::condition_variable cond_;
+    std::deque<Job> jobs_;
+    bool b_stop_;
+
+    boost::thread_group workers_;
+    int num_workers_;
+};
+
+
+#endif //WORKER_POOL_H_
@@ -46,6 +46,8 @@
 
 #include <boost/shared_array.hpp>
 
+#include "KdTreeBatchResult.h"
+
 // Forward declarations
 namespace flann
 {
@@ -184,7 +186,52 @@ namespace pcl
       radiusSearch (const PointT &point, double radius, std::vector<int> &k_indices,
                     std::vector<float> &k_sqr_distances, unsigned int max_nn = 0) const;
 
+      /** \brief Search for the k-nearest neighbors of a batch of query points (a single FLANN multi-query search).
+        * \param[in] queries the query points, row-major with \ref getDimensions() floats each (x, y, z with the default point representation)
+        * \param[in] num_queries the number of query points
+        * \param[in] k the number of neighbors to search for (clamped to the number of points of the tree)
+        * \param[out] result the neighbors of each query in CSR format (its buffers are reused)
+        * \param[in] cores number of threads of the search (0: automatic, as in ::flann::SearchParams)
+        * \return total number of neighbors found
+        */
+      int 
+      nearestKSearch (const float* queries, size_t num_queries, int k, pp::KdTreeBatchResult& result, int cores = 1) const;
+
+      /** \brief Search for the k-nearest neighbors of the points query_indices of cloud (all the points of cloud if query_indices is empty).
+        * The query points must be valid (i.e., finite). See the batch nearestKSearch() above.
+        */
+      int 
+      nearestKSearch (const PointCloud& cloud, const std::vector<int>& query_indices, int k, pp::KdTreeBatchResult& result, int cores = 1) const;
+
+      /** \brief Search for all the neighbors of a batch of query points in a given radius (a single FLANN multi-query search).
+        * \param[in] queries the query points, row-major with \ref getDimensions() floats each (x, y, z with the default point representation)
+        * \param[in] num_queries the number of query points
+        * \param[in] radius the radius of the sphere bounding the neighbors of each query
+        * \param[out] result the neighbors of each query in CSR format (its buffers are reused), sorted as in \ref radiusSearch()
+        * \param[in] max_nn if not 0, bounds the number of neighbors of each query
+        * \param[in] cores number of threads of the search (0: automatic, as in ::flann::SearchParams)
+        * \return total number of neighbors found
+        */
+      int 
+      radiusSearch (const float* queries, size_t num_queries, double radius, pp::KdTreeBatchResult& result, 
+                    unsigned int max_nn = 0, int cores = 1) const;
+
+      /** \brief Search for the neighbors in radius of the points query_indices of cloud (all the points of cloud if query_indices is empty).
+        * The query points must be valid (i.e., finite). See the batch radiusSearch() above.
+        */
+      int 
+      radiusSearch (const PointCloud& cloud, const std::vector<int>& query_indices, double radius, pp::KdTreeBatchResult& result, 
+                    unsigned int max_nn = 0, int cores = 1) const;
+
+      /** \brief Number of floats of a query point. */
+      inline int 
+      getDimensions () const { return (dim_); }
+
     private:
+      /** \brief Vectorize the query points of cloud into result.queries. */
+      void 
+      vectorizeQueries (const PointCloud& cloud, const std::vector<int>& query_indices, pp::KdTreeBatchResult& result) const;
+
       /** \brief Internal cleanup method. */
       void 
       cleanup ();
@@ -40,6 +40,7 @@
 #define PP_PCL_KDTREE_KDTREE_IMPL_FLANN_H_
 
 #include <cstdio>
+#include <algorithm>
 
 //#include <pcl/kdtree/kdtree_flann.h>
 #include "kdtree_flann_pp.h"
@@ -213,6 +214,132 @@ pcl::KdTreeFLANN_PP<PointT, Dist>::radiusSearch (const PointT &point, double rad
   return (neighbors_in_radius);
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT, typename Dist> void 
+pcl::KdTreeFLANN_PP<PointT, Dist>::vectorizeQueries (const PointCloud& cloud, const std::vector<int>& query_indices, 
+                                                     pp::KdTreeBatchResult& result) const
+{
+  const size_t num_queries = query_indices.empty () ? cloud.points.size () : query_indices.size ();
+  result.queries.resize (num_queries * dim_);
+  float* query_ptr = result.queries.data ();
+  for (size_t q = 0; q < num_queries; ++q, query_ptr += dim_)
+  {
+    const PointT& point = cloud.points[query_indices.empty () ? q : query_indices[q]];
+    assert (point_representation_->isValid (point) && "Invalid (NaN, Inf) point coordinates given to a batch search!");
+    point_representation_->vectorize (point, query_ptr);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT, typename Dist> int 
+pcl::KdTreeFLANN_PP<PointT, Dist>::nearestKSearch (const float* queries, size_t num_queries, int k, 
+                                                   pp::KdTreeBatchResult& result, int cores) const
+{
+  if (k > total_nr_points_)
+    k = total_nr_points_;
+  if ((k <= 0) || (num_queries == 0) || !flann_index_)
+  {
+    result.reset (num_queries);
+    return (0);
+  }
+
+  // every query gets k neighbors: fixed-size rows
+  result.offsets.resize (num_queries + 1);
+  for (size_t q = 0; q <= num_queries; ++q)
+    result.offsets[q] = static_cast<int> (q) * k;
+  result.indices.resize (num_queries * k);
+  result.sqr_distances.resize (num_queries * k);
+
+  ::flann::Matrix<int> k_indices_mat (result.indices.data (), num_queries, k);
+  ::flann::Matrix<float> k_distances_mat (result.sqr_distances.data (), num_queries, k);
+  ::flann::SearchParams params (param_k_);
+  params.cores = cores;
+  flann_index_->knnSearch (::flann::Matrix<float> (const_cast<float*> (queries), num_queries, dim_), 
+                           k_indices_mat, k_distances_mat, k, params);
+
+  // Do mapping to original point cloud
+  if (!identity_mapping_) 
+  {
+    for (size_t i = 0; i < result.indices.size (); ++i)
+      result.indices[i] = index_mapping_[result.indices[i]];
+  }
+
+  return (static_cast<int> (result.indices.size ()));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT, typename Dist> int 
+pcl::KdTreeFLANN_PP<PointT, Dist>::nearestKSearch (const PointCloud& cloud, const std::vector<int>& query_indices, int k, 
+                                                   pp::KdTreeBatchResult& result, int cores) const
+{
+  vectorizeQueries (cloud, query_indices, result);
+  return (nearestKSearch (result.queries.data (), result.queries.size () / dim_, k, result, cores));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT, typename Dist> int 
+pcl::KdTreeFLANN_PP<PointT, Dist>::radiusSearch (const float* queries, size_t num_queries, double radius, 
+                                                 pp::KdTreeBatchResult& result, unsigned int max_nn, int cores) const
+{
+  if ((num_queries == 0) || !flann_index_ || (total_nr_points_ == 0))
+  {
+    result.reset (num_queries);
+    return (0);
+  }
+
+  // Has max_nn been set properly?
+  if (max_nn == 0 || max_nn > static_cast<unsigned int> (total_nr_points_))
+    max_nn = total_nr_points_;
+
+  ::flann::SearchParams params (param_radius_);
+  if (max_nn == static_cast<unsigned int>(total_nr_points_))
+    params.max_neighbors = -1;  // return all neighbors in radius
+  else
+    params.max_neighbors = max_nn;
+  params.cores = cores;
+
+  // the per-query rows are kept in the result and reused (FLANN only resizes them)
+  if (result.row_indices.size () < num_queries)
+  {
+    result.row_indices.resize (num_queries);
+    result.row_sqr_distances.resize (num_queries);
+  }
+  flann_index_->radiusSearch (::flann::Matrix<float> (const_cast<float*> (queries), num_queries, dim_),
+                              result.row_indices, result.row_sqr_distances,
+                              static_cast<float> (radius * radius), params);
+
+  // flatten the rows 
+  result.offsets.resize (num_queries + 1);
+  result.offsets[0] = 0;
+  for (size_t q = 0; q < num_queries; ++q)
+    result.offsets[q + 1] = result.offsets[q] + static_cast<int> (result.row_indices[q].size ());
+  result.indices.resize (result.offsets[num_queries]);
+  result.sqr_distances.resize (result.offsets[num_queries]);
+  for (size_t q = 0; q < num_queries; ++q)
+  {
+    std::copy (result.row_indices[q].begin (), result.row_indices[q].end (), result.indices.begin () + result.offsets[q]);
+    std::copy (result.row_sqr_distances[q].begin (), result.row_sqr_distances[q].end (), result.sqr_distances.begin () + result.offsets[q]);
+  }
+
+  // Do mapping to original point cloud
+  if (!identity_mapping_) 
+  {
+    for (size_t i = 0; i < result.indices.size (); ++i)
+      result.indices[i] = index_mapping_[result.indices[i]];
+  }
+
+  return (result.offsets[num_queries]);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+template <typename PointT, typename Dist> int 
+pcl::KdTreeFLANN_PP<PointT, Dist>::radiusSearch (const PointCloud& cloud, const std::vector<int>& query_indices, double radius, 
+                                                 pp::KdTreeBatchResult& result, unsigned int max_nn, int cores) const
+{
+  vectorizeQueries (cloud, query_indices, result);
+  return (radiusSearch (result.queries.data (), result.queries.size () / dim_, radius, result, max_nn, cores));
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////
 template <typename PointT, typename Dist> void 
 pcl::KdTreeFLANN_PP<PointT, Dist>::cleanup ()
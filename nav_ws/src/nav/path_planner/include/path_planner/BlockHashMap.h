@@ -0,0 +1 @@
+../BlockHashMap.h
\ No newline at end of file
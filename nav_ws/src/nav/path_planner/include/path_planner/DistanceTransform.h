@@ -0,0 +1 @@
+../DistanceTransform.h
\ No newline at end of file
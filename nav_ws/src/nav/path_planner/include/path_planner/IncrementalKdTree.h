@@ -0,0 +1 @@
+../IncrementalKdTree.h
\ No newline at end of file
@@ -0,0 +1 @@
+../IncrementalPathPlanner.h
\ No newline at end of file
@@ -0,0 +1 @@
+../IndexWorkQueue.h
\ No newline at end of file
@@ -0,0 +1 @@
+../LatencyTracer.h
\ No newline at end of file
@@ -0,0 +1 @@
+../NeighborhoodGraph.h
\ No newline at end of file
@@ -0,0 +1 @@
+../OpenSet.h
\ No newline at end of file
@@ -0,0 +1 @@
+../PathCache.h
\ No newline at end of file
@@ -0,0 +1 @@
+../PointCloudDelta.h
\ No newline at end of file
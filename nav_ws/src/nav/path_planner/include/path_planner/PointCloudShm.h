@@ -0,0 +1 @@
+../PointCloudShm.h
\ No newline at end of file
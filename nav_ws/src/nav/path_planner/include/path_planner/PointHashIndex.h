@@ -0,0 +1 @@
+../PointHashIndex.h
\ No newline at end of file
@@ -0,0 +1 @@
+../PriorMapClient.h
\ No newline at end of file
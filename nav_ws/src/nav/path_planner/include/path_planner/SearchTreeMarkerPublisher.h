@@ -0,0 +1 @@
+../SearchTreeMarkerPublisher.h
\ No newline at end of file
@@ -0,0 +1 @@
+../TravPointTypes.h
\ No newline at end of file
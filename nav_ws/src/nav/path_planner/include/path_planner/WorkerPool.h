@@ -0,0 +1 @@
+../WorkerPool.h
\ No newline at end of file
@@ -1 +0,0 @@
-../ZTimer.h
\ No newline at end of file
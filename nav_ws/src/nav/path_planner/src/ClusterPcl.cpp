@@ -23,6 +23,9 @@
 
 #include <pcl/filters/extract_indices.h>
 
+#include <unordered_map>
+#include <algorithm>
+
 
 static const float DEG_2_RAD = M_PI/180; 
 
@@ -81,6 +84,14 @@ bool enforceNormalSimilarity(const pcl::PointXYZRGBNormal& point_a, const pcl::P
     return (false);
 }
 
+// key of the integer cell (ix, iy, iz), 21 bits per component 
+static inline uint64_t cellKey(long ix, long iy, long iz)
+{
+    const uint64_t mask = (1 << 21) - 1;
+    const uint64_t offset = 1 << 20;
+    return ((ix + offset) & mask) | (((iy + offset) & mask) << 21) | (((iz + offset) & mask) << 42);
+}
+
 template<typename PointT>
 bool ClusterPcl<PointT>::inFilteredList(int p)
 {
@@ -151,6 +162,12 @@ void ClusterPcl<PointT>::filterWall()
         return; /// < EXIT POINT
     }
     
+    if (config_.use_voxel_hash_wall_filter)
+    {
+        filterWallVoxelHash();
+        return; /// < EXIT POINT
+    }
+    
     auto pcl_wall_shared = pcl_wall_.makeShared(); // necessary deep copy 
 
     KdTreeIn kdtree_Wall;
@@ -217,6 +234,87 @@ void ClusterPcl<PointT>::filterWall()
 
 }
 
+template<typename PointT>
+void ClusterPcl<PointT>::filterWallVoxelHash()
+{
+    /// < sort the points by cell (cell size = radius): the neighbors of a point within radius lie in the 27 cells around its cell 
+    const float radius = kFilterWallRadiusMin;
+    const float radius2 = radius*radius;
+    const int num_points = pcl_wall_.size();
+    
+    typedef std::unordered_map<uint64_t, std::pair<int, int> > CellRanges;
+    ScanArena::Buffer<std::vector<long> > cell_coords_buffer = arena_.getVector<long>(3*num_points);
+    ScanArena::Buffer<std::vector<std::pair<uint64_t, int> > > cell_points_buffer = arena_.getVector<std::pair<uint64_t, int> >(num_points);
+    std::vector<long>& cell_coords = *cell_coords_buffer;
+    std::vector<std::pair<uint64_t, int> >& cell_points = *cell_points_buffer;
+    for (int i = 0; i < num_points; i++)
+    {
+        const PointOut& p = pcl_wall_[i];
+        long* c = &cell_coords[3*i];
+        c[0] = lround(p.x/radius);
+        c[1] = lround(p.y/radius);
+        c[2] = lround(p.z/radius);
+        cell_points[i] = std::make_pair(cellKey(c[0], c[1], c[2]), i);
+    }
+    std::sort(cell_points.begin(), cell_points.end());
+    
+    // range of each cell in cell_points
+    ScanArena::Buffer<CellRanges> cell_ranges_buffer = arena_.get<CellRanges>();
+    CellRanges& cell_ranges = *cell_ranges_buffer;
+    cell_ranges.clear(); // the buckets of the previous scans are kept
+    cell_ranges.reserve(num_points);
+    for (int j = 0; j < num_points; )
+    {
+        int jEnd = j + 1;
+        while ((jEnd < num_points) && (cell_points[jEnd].first == cell_points[j].first)) jEnd++;
+        cell_ranges[cell_points[j].first] = std::make_pair(j, jEnd);
+        j = jEnd;
+    }
+    
+    /// < count the neighbors of each point (the point itself included, as in the radius search)
+    ScanArena::Buffer<std::vector<char> > b_keep_buffer = arena_.getVector<char>(num_points, 1);
+    std::vector<char>& b_keep = *b_keep_buffer;
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (int i = 0; i < num_points; i++)
+    {
+        const PointOut& p = pcl_wall_[i];
+        const long* c = &cell_coords[3*i];
+        int n = 0;
+        for (int dx = -1; (dx <= 1) && (n < kFilterWallRadiusMinNumNeighbors); dx++)
+            for (int dy = -1; (dy <= 1) && (n < kFilterWallRadiusMinNumNeighbors); dy++)
+                for (int dz = -1; (dz <= 1) && (n < kFilterWallRadiusMinNumNeighbors); dz++)
+                {
+                    typename CellRanges::const_iterator it = cell_ranges.find(cellKey(c[0] + dx, c[1] + dy, c[2] + dz));
+                    if (it == cell_ranges.end()) continue; /// < CONTINUE
+                    for (int j = it->second.first; j < it->second.second; j++)
+                    {
+                        const PointOut& q = pcl_wall_[cell_points[j].second];
+                        const float d2 = (p.x - q.x)*(p.x - q.x) + (p.y - q.y)*(p.y - q.y) + (p.z - q.z)*(p.z - q.z);
+                        if (d2 < radius2) n++;
+                    }
+                }
+        
+        if (n < kFilterWallRadiusMinNumNeighbors) b_keep[i] = 0; /// < if the point has few neighbors filter out it
+    }
+    
+    /// < stable in-place compaction 
+    size_t num_kept = 0;
+    for (int i = 0; i < num_points; i++)
+    {
+        if (!b_keep[i])
+        {
+            point_idx_filter_out_.push_back(i);
+            continue; /// < CONTINUE
+        }
+        if (num_kept != (size_t)i) pcl_wall_.points[num_kept] = pcl_wall_.points[i];
+        num_kept++;
+    }
+    pcl_wall_.resize(num_kept);
+    
+    ROS_INFO("pointIdxFilterOut size: %d", (int) point_idx_filter_out_.size());
+    ROS_INFO("pcl Wall size after filtering: %d", (int) pcl_wall_.size());
+}
+
 template<typename PointT>
 void ClusterPcl<PointT>::elaborateCluster()
 {
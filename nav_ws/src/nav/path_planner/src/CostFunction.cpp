@@ -20,11 +20,140 @@
 
 #include "CostFunction.h"
 
+#include <algorithm>
+#include <cmath>
+
 
 const float BaseCostFunction::kLamdaTravDefault = 1.0; 
 const float BaseCostFunction::kLamdaAuxDefault  = 1.0; 
 const float BaseCostFunction::kLamdaDzDefault   = 0.1; 
+const float BaseCostFunction::kLamdaReservationDefault = 1.0; 
 const double BaseCostFunction::kEpsilon = 1e-3; 
 
 
+BaseCostFunction* BaseCostFunction::create(int type)
+{
+    type = std::max(std::min(type, (int) kNumCostFunctions - 1), 0);
+
+    switch (type)
+    {
+    case kTraversabilityCost:
+        return new TraversabilityCostFunction();
+    case kTraversabilityProdCost:
+        return new TraversabilityProdCostFunction();
+    case kSimpleCost:
+        return new SimpleCostFunction();
+    case kBaseCost:
+    default:
+        return new BaseCostFunction();
+    }
+}
+
+void BaseCostFunction::costBatch(const pcl::PointXYZI& current, const pcl::PointXYZI& goal, CostBatch& batch)
+{
+    pcl::PointXYZI next;
+    for (size_t i = 0, iEnd = batch.size(); i < iEnd; i++)
+    {
+        next.x = batch.x[i];
+        next.y = batch.y[i];
+        next.z = batch.z[i];
+        next.intensity = batch.traversability[i];
+        batch.cost[i] = cost(current, next, goal, batch.traversability[i], batch.aux_utility[i], batch.aux_conf[i]);
+    }
+}
+
+void BaseCostFunction::applyReservationCost(CostBatch& batch)
+{
+    if (!p_reservation_table_) return; /// < EXIT POINT
+    
+    const size_t n = batch.size();
+    conflicts_.resize(n);
+    p_reservation_table_->getConflicts(reservation_robot_id_, batch.x.data(), batch.y.data(), batch.z.data(), batch.arrival_time.data(), n, conflicts_.data());
+    for (size_t i = 0; i < n; i++)
+    {
+        if (conflicts_[i] > 0) batch.cost[i] *= 1.f + lambda_reservation_*conflicts_[i];
+    }
+}
+
+// N.B.: the loops below are vectorized by the compiler (this file is built with -fno-math-errno, see CMakeLists.txt)
+
+void SimpleCostFunction::costBatch(const pcl::PointXYZI& current, const pcl::PointXYZI& goal, CostBatch& batch)
+{
+    const size_t n = batch.size();
+    const float* x = batch.x.data();
+    const float* y = batch.y.data();
+    const float* z = batch.z.data();
+    const float* trav = batch.traversability.data();
+    float* cost = batch.cost.data();
+    
+    const float cx = current.x, cy = current.y, cz = current.z;
+    const float gx = goal.x, gy = goal.y, gz = goal.z;
+    const float lambda_dz = lambda_dz_;
+    const float trav_gain = lambda_trav_/(range_trav_cost_ + kEpsilon);
+    const float min_trav = min_trav_cost_;
+
+    #pragma omp simd
+    for (size_t i = 0; i < n; i++)
+    {
+        const float dx = x[i] - cx, dy = y[i] - cy, dz = z[i] - cz;
+        const float hx = x[i] - gx, hy = y[i] - gy, hz = z[i] - gz;
+        const float d = std::sqrt(dx*dx + dy*dy + dz*dz) + std::sqrt(hx*hx + hy*hy + hz*hz) + lambda_dz*std::fabs(dz);
+        cost[i] = d*(1.f + trav_gain*(trav[i] - min_trav));
+    }
+}
+
+void TraversabilityCostFunction::costBatch(const pcl::PointXYZI& current, const pcl::PointXYZI& goal, CostBatch& batch)
+{
+    const size_t n = batch.size();
+    const float* x = batch.x.data();
+    const float* y = batch.y.data();
+    const float* z = batch.z.data();
+    const float* trav = batch.traversability.data();
+    const float* aux_utility = batch.aux_utility.data();
+    const float* aux_conf = batch.aux_conf.data();
+    float* cost = batch.cost.data();
+    
+    const float cx = current.x, cy = current.y, cz = current.z;
+    const float gx = goal.x, gy = goal.y, gz = goal.z;
+    const float trav_gain = lambda_trav_/(range_trav_cost_ + kEpsilon);
+    const float min_trav = min_trav_cost_;
+    const float aux_gain = lambda_aux_*timeExpDecay()/(range_aux_utility_ + kEpsilon); // the time decay is computed once for the whole batch
+    const float max_aux = max_aux_utility_;
+
+    #pragma omp simd
+    for (size_t i = 0; i < n; i++)
+    {
+        const float dx = x[i] - cx, dy = y[i] - cy, dz = z[i] - cz;
+        const float hx = x[i] - gx, hy = y[i] - gy, hz = z[i] - gz;
+        const float d = std::sqrt(dx*dx + dy*dy + dz*dz) + std::sqrt(hx*hx + hy*hy + hz*hz);
+        cost[i] = d*(trav_gain*(trav[i] - min_trav) + aux_gain*aux_conf[i]*(max_aux - aux_utility[i]) + 1.f);
+    }
+}
+
+void TraversabilityProdCostFunction::costBatch(const pcl::PointXYZI& current, const pcl::PointXYZI& goal, CostBatch& batch)
+{
+    const size_t n = batch.size();
+    const float* x = batch.x.data();
+    const float* y = batch.y.data();
+    const float* z = batch.z.data();
+    const float* trav = batch.traversability.data();
+    const float* aux_utility = batch.aux_utility.data();
+    const float* aux_conf = batch.aux_conf.data();
+    float* cost = batch.cost.data();
+    
+    const float cx = current.x, cy = current.y, cz = current.z;
+    const float gx = goal.x, gy = goal.y, gz = goal.z;
+    const float trav_gain = lambda_trav_/(range_trav_cost_ + kEpsilon);
+    const float min_trav = min_trav_cost_;
+    const float aux_gain = lambda_aux_*timeExpDecay()/(range_aux_utility_ + kEpsilon); // the time decay is computed once for the whole batch
+    const float max_aux = max_aux_utility_;
 
+    #pragma omp simd
+    for (size_t i = 0; i < n; i++)
+    {
+        const float dx = x[i] - cx, dy = y[i] - cy, dz = z[i] - cz;
+        const float hx = x[i] - gx, hy = y[i] - gy, hz = z[i] - gz;
+        const float d = std::sqrt(dx*dx + dy*dy + dz*dz) + std::sqrt(hx*hx + hy*hy + hz*hz);
+        cost[i] = d*(trav_gain*(trav[i] - min_trav) + 1.f)*(aux_gain*aux_conf[i]*(max_aux - aux_utility[i]) + 1.f);
+    }
+}
@@ -0,0 +1,179 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "DistanceTransform.h"
+
+#include <limits>
+#include <algorithm>
+#include <iostream>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+const size_t DistanceTransform::kMaxNumVoxels = 100000000; // 400 MB of floats
+
+static const float kFreeValue = 1e10f; // squared distance [voxels^2] of a free voxel: larger than any squared distance in the grid
+
+DistanceTransform::DistanceTransform():origin_(Eigen::Vector3f::Zero()), resolution_(1), max_distance_(0), num_occupied_(0), b_ready_(false)
+{
+    size_[0] = size_[1] = size_[2] = 0;
+}
+
+bool DistanceTransform::init(const Eigen::Vector3f& min_point, const Eigen::Vector3f& max_point, float resolution, float max_distance)
+{
+    b_ready_ = false;
+    num_occupied_ = 0;
+
+    resolution_ = resolution;
+    max_distance_ = max_distance;
+    origin_ = min_point;
+
+    size_t num_voxels = 1;
+    for (int k = 0; k < 3; k++)
+    {
+        size_[k] = std::max((int)ceil((max_point[k] - min_point[k])/resolution) + 1, 1);
+        num_voxels *= size_[k];
+    }
+
+    if (num_voxels > kMaxNumVoxels)
+    {
+        std::cout << "DistanceTransform::init() - too many voxels: " << num_voxels << " (" << size_[0] << " x " << size_[1] << " x " << size_[2] << ")" << std::endl;
+        size_[0] = size_[1] = size_[2] = 0;
+        std::vector<float>().swap(grid_);
+        return false; /// < EXIT POINT
+    }
+
+    grid_.assign(num_voxels, kFreeValue);
+    return true;
+}
+
+void DistanceTransform::transform1D(float* f, int n, size_t stride, std::vector<float>& d, std::vector<int>& v, std::vector<float>& z)
+{
+    /// < lower envelope of the parabolas rooted at (q, f[q])
+    int k = 0;
+    v[0] = 0;
+    z[0] = -std::numeric_limits<float>::max();
+    z[1] = std::numeric_limits<float>::max();
+    for (int q = 1; q < n; q++)
+    {
+        const float fq = f[q*stride] + q*q;
+        float s = (fq - (f[v[k]*stride] + v[k]*v[k]))/(2*(q - v[k]));
+        while (s <= z[k])
+        {
+            k--;
+            s = (fq - (f[v[k]*stride] + v[k]*v[k]))/(2*(q - v[k]));
+        }
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = std::numeric_limits<float>::max();
+    }
+
+    /// < sample the envelope
+    k = 0;
+    for (int q = 0; q < n; q++)
+    {
+        while (z[k + 1] < q) k++;
+        d[q] = (q - v[k])*(q - v[k]) + f[v[k]*stride];
+    }
+    for (int q = 0; q < n; q++) f[q*stride] = d[q];
+}
+
+void DistanceTransform::compute(int num_threads)
+{
+    if (grid_.empty()) return; /// < EXIT POINT
+
+#ifdef _OPENMP
+    if (num_threads <= 0) num_threads = omp_get_max_threads();
+#endif
+
+    const size_t strides[3] = {1, (size_t)size_[0], (size_t)size_[0]*size_[1]};
+
+    /// < separable passes along x, y and z
+    for (int axis = 0; axis < 3; axis++)
+    {
+        const int n = size_[axis];
+        const int a1 = (axis + 1) % 3;
+        const int a2 = (axis + 2) % 3;
+        const int num_lines = size_[a1]*size_[a2];
+
+        #pragma omp parallel num_threads(num_threads)
+        {
+            std::vector<float> d(n), z(n + 1);
+            std::vector<int> v(n);
+
+            #pragma omp for schedule(static)
+            for (int line = 0; line < num_lines; line++)
+            {
+                const int i1 = line % size_[a1];
+                const int i2 = line / size_[a1];
+                float* f = &grid_[i1*strides[a1] + i2*strides[a2]];
+                transform1D(f, n, strides[axis], d, v, z);
+            }
+        }
+    }
+
+    /// < from squared voxel distances to saturated metric distances
+    const float max_distance = max_distance_;
+    const float resolution = resolution_;
+    #pragma omp parallel for num_threads(num_threads) schedule(static)
+    for (int i = 0; i < (int)grid_.size(); i++)
+    {
+        grid_[i] = std::min(sqrtf(grid_[i])*resolution, max_distance);
+    }
+
+    b_ready_ = true;
+}
+
+float DistanceTransform::getDistance(float x, float y, float z) const
+{
+    if (!b_ready_) return max_distance_; /// < EXIT POINT
+
+    /// < continuous coordinates w.r.t. the voxel centers
+    const float gx = (x - origin_[0])/resolution_ - 0.5f;
+    const float gy = (y - origin_[1])/resolution_ - 0.5f;
+    const float gz = (z - origin_[2])/resolution_ - 0.5f;
+
+    const int ix = (int)floor(gx);
+    const int iy = (int)floor(gy);
+    const int iz = (int)floor(gz);
+    if ((ix < -1) || (iy < -1) || (iz < -1) || (ix >= size_[0]) || (iy >= size_[1]) || (iz >= size_[2])) return max_distance_; /// < EXIT POINT
+
+    const float tx = gx - ix;
+    const float ty = gy - iy;
+    const float tz = gz - iz;
+
+    // clamp the corners to the grid (the distance is extended as constant on the border half voxels)
+    const int x0 = std::max(ix, 0), x1 = std::min(ix + 1, size_[0] - 1);
+    const int y0 = std::max(iy, 0), y1 = std::min(iy + 1, size_[1] - 1);
+    const int z0 = std::max(iz, 0), z1 = std::min(iz + 1, size_[2] - 1);
+
+    const float c00 = grid_[index(x0, y0, z0)]*(1 - tx) + grid_[index(x1, y0, z0)]*tx;
+    const float c10 = grid_[index(x0, y1, z0)]*(1 - tx) + grid_[index(x1, y1, z0)]*tx;
+    const float c01 = grid_[index(x0, y0, z1)]*(1 - tx) + grid_[index(x1, y0, z1)]*tx;
+    const float c11 = grid_[index(x0, y1, z1)]*(1 - tx) + grid_[index(x1, y1, z1)]*tx;
+
+    const float c0 = c00*(1 - ty) + c10*ty;
+    const float c1 = c01*(1 - ty) + c11*ty;
+
+    return c0*(1 - tz) + c1*tz;
+}
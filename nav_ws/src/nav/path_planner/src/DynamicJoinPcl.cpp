@@ -23,6 +23,9 @@
 #include <DistancePartition.h>
 #include <CopyPoint.h>
 #include <cmath>
+#include <limits>
+
+#include <boost/thread.hpp>
 
 static uint8_t bucketColor[2][2][3] = {{{0xFF,0x00,0x00},{0x00,0xFF,0x00}},{{0xFF,0xFF,0x00},{0x00,0x7F,0xFF}}};
 
@@ -38,6 +41,17 @@ inline void colorizePointInBucket1(PointT& p, size_t bucket1, size_t bucket2, si
 	p.b = bucketColor[bucket1 % 2][bucket2 % 2][2];
 }
 
+// pixel of the range image (rows: inclination theta, cols: azimuth phi) of the direction (dx,dy,dz) with norm r
+inline int rangeImagePixel(float dx, float dy, float dz, float r, float k_pixel, int num_rows, int num_cols)
+{
+	const float theta = acos(std::min(std::max(dz / std::max(r, 1e-12f), -1.f), 1.f));
+	float phi = atan2(dy, dx);
+	if(phi < 0) phi += M_2PI;
+	const int row = std::min((int)(theta * k_pixel), num_rows - 1);
+	const int col = std::min((int)(phi * k_pixel), num_cols - 1);
+	return row * num_cols + col;
+}
+
 template<typename PointT>
 inline double signedDistance(const PointT& p, const pcl::ModelCoefficients& m)
 {
@@ -80,8 +94,10 @@ void DynamicJoinPcl<Point_In, Point_Out>::joinPCL(const PointCloud_In& pcl_scan,
 
 	pcl_removed.clear();
 
-	// remove outliers from scan
-	PointCloud_In pcl_scan_filtered;
+	// remove outliers from scan (the temporaries of the scan are taken from the arena, see ScanArena)
+	ScanArena::Buffer<PointCloud_In> pcl_scan_filtered_buffer = arena.get<PointCloud_In>();
+	PointCloud_In& pcl_scan_filtered = *pcl_scan_filtered_buffer;
+	pcl_scan_filtered.clear();
 	if(config.outlier_removal == DynamicJoinPcl_OutlierRemoval_Deterministic)
 		deterministicOutliersFilter(pcl_scan, pcl_scan_filtered);
 	else if(config.outlier_removal == DynamicJoinPcl_OutlierRemoval_Statistical)
@@ -94,107 +110,259 @@ void DynamicJoinPcl<Point_In, Point_Out>::joinPCL(const PointCloud_In& pcl_scan,
 		return;
 	}
 
-	// partition laser scan according to theta,phi
-	PointCloud_In pcl_scan_partition[config.num_subdivisions * config.num_subdivisions];
-	sphericalPartition(pcl_scan_filtered, pcl_scan_partition, laser_center, config.num_subdivisions);
+	int num_threads = config.num_threads;
+	if(num_threads <= 0) num_threads = std::max((int)boost::thread::hardware_concurrency(), 1);
 
-	// partition map in near/far, and partition near according to theta,phi
-	PointCloud_Out pcl_map_near, pcl_map_far, pcl_map_partition[config.num_subdivisions * config.num_subdivisions];
-	distancePartition(pcl_map_old, pcl_map_near, pcl_map_far, laser_center, config.radius_near);
-	sphericalPartition(pcl_map_near, pcl_map_partition, laser_center, config.num_subdivisions);
+	if(config.carving_method == DynamicJoinPcl_CarvingMethod_RangeImage)
+		joinRangeImage(pcl_scan_filtered, pcl_map_old, pcl_map_new, laser_center, num_threads);
+	else
+		joinBuckets(pcl_scan_filtered, pcl_map_old, pcl_map_new, laser_center, quads, num_threads);
 
-	for(size_t bucket1 = 0; bucket1 < config.num_subdivisions; bucket1++)
+	ScanArena::Buffer<PointCloud_Out> temp_buffer = arena.get<PointCloud_Out>();
+	PointCloud_Out& temp = *temp_buffer;
+	temp.clear();
+	temp.header = pcl_map_new.header;
+
+	// downsample
+	pcl::VoxelGrid<Point_Out> sor;
+	sor.setInputCloud(pcl_map_new.makeShared());
+	sor.setLeafSize(config.leaf_size, config.leaf_size, config.leaf_size);
+	sor.filter(temp);
+
+	pcl_map_new.swap(temp);
+}
+
+template<typename Point_In, typename Point_Out>
+void DynamicJoinPcl<Point_In, Point_Out>::joinBuckets(const PointCloud_In& pcl_scan_filtered, const PointCloud_Out& pcl_map_old, PointCloud_Out& pcl_map_new, const pcl::PointXYZ& laser_center, std::vector<Quad>& quads, int num_threads)
+{
+	const size_t subdivisions = config.num_subdivisions;
+	const size_t num_buckets = subdivisions * subdivisions;
+	// partition laser scan according to theta,phi
+	ScanArena::Buffer<std::vector<int> > scan_buckets = arena.get<std::vector<int> >();
+	sphericalBuckets(pcl_scan_filtered, laser_center, subdivisions, *scan_buckets, std::numeric_limits<float>::max(), num_threads);
+	ScanArena::Buffer<std::vector<PointCloud_In> > pcl_scan_partition_buffer = arena.get<std::vector<PointCloud_In> >();
+	std::vector<PointCloud_In>& pcl_scan_partition = *pcl_scan_partition_buffer;
+	pcl_scan_partition.resize(num_buckets);
+	for(size_t bucket = 0; bucket < num_buckets; bucket++) pcl_scan_partition[bucket].clear(); // keep the capacity of the previous scans
+	for(size_t i = 0; i < pcl_scan_filtered.size(); i++)
 	{
-		for(size_t bucket2 = 0; bucket2 < config.num_subdivisions; bucket2++)
-		{
-			size_t bucket = flatBucket(bucket1, bucket2, config.num_subdivisions);
+		pcl_scan_partition[(*scan_buckets)[i]].push_back(pcl_scan_filtered[i]);
+	}
+
+	// partition map in near/far (far points get bucket -1), and partition near according to theta,phi
+	ScanArena::Buffer<std::vector<int> > map_buckets_buffer = arena.get<std::vector<int> >();
+	const std::vector<int>& map_buckets = *map_buckets_buffer;
+	sphericalBuckets(pcl_map_old, laser_center, subdivisions, *map_buckets_buffer, config.radius_near, num_threads);
+	ScanArena::Buffer<std::vector<size_t> > map_offsets_buffer = arena.get<std::vector<size_t> >();
+	ScanArena::Buffer<std::vector<size_t> > map_indices_buffer = arena.get<std::vector<size_t> >();
+	const std::vector<size_t>& map_offsets = *map_offsets_buffer;
+	const std::vector<size_t>& map_indices = *map_indices_buffer;
+	bucketIndices(map_buckets, num_buckets, *map_offsets_buffer, *map_indices_buffer);
+
+	// the buckets are independent: each one decides which of its map points are kept
+	ScanArena::Buffer<std::vector<char> > b_keep_map_point_buffer = arena.getVector<char>(pcl_map_old.size(), 1);
+	ScanArena::Buffer<std::vector<char> > b_has_quad_buffer = arena.getVector<char>(num_buckets, 0);
+	ScanArena::Buffer<std::vector<Quad> > bucket_quads_buffer = arena.getVector<Quad>(num_buckets);
+	std::vector<char>& b_keep_map_point = *b_keep_map_point_buffer;
+	std::vector<char>& b_has_quad = *b_has_quad_buffer;
+	std::vector<Quad>& bucket_quads = *bucket_quads_buffer;
+
+	#pragma omp parallel for num_threads(num_threads) schedule(dynamic, 1)
+	for(int bucket = 0; bucket < (int)num_buckets; bucket++)
+	{
+		const size_t bucket1 = bucket / subdivisions;
+		const size_t bucket2 = bucket % subdivisions;
 
-			BucketVolume_MinDistance<Point_In, Point_Out> v_min(bucket1, bucket2, config);
-			BucketVolume_Plane<Point_In, Point_Out> v_rsc(bucket1, bucket2, config);
-			v_min.estimate(pcl_scan_partition[bucket], laser_center);
-			BucketVolume<Point_In, Point_Out> *pv = &v_min;
+		BucketVolume_MinDistance<Point_In, Point_Out> v_min(bucket1, bucket2, config);
+		BucketVolume_Plane<Point_In, Point_Out> v_rsc(bucket1, bucket2, config);
+		v_min.estimate(pcl_scan_partition[bucket], laser_center);
+		BucketVolume<Point_In, Point_Out> *pv = &v_min;
+
+		if(pcl_scan_partition[bucket].size() >= 4)
+		{
+			// we have enough points for fitting a plane...
 
-			if(pcl_scan_partition[bucket].size() >= 4)
+			if(config.bucket_volume_model_type == DynamicJoinPcl_BucketVolumeModelType_SinglePlane)
 			{
-				// we have enough points for fitting a plane...
+				bool b_plane_estimated = false;
+#ifndef ESTIMATE_PLANE_USING_RANSAC
+				#pragma omp critical(dynamic_join_convex_hull) // qhull (non-reentrant) is used through a global state
+#endif
+				b_plane_estimated = v_rsc.estimate(pcl_scan_partition[bucket], laser_center);
 
-				if(config.bucket_volume_model_type == DynamicJoinPcl_BucketVolumeModelType_SinglePlane)
+				if(b_plane_estimated)
 				{
-					if(v_rsc.estimate(pcl_scan_partition[bucket], laser_center))
+					BucketVolume_MaxDistance<Point_In, Point_Out> v_max(bucket1, bucket2, config);
+					v_max.estimate(pcl_scan_partition[bucket], laser_center);
+					double v = v_rsc.getVolume(laser_center);
+					if(v >= v_min.getVolume(laser_center) && v <= v_max.getVolume(laser_center))
 					{
-						BucketVolume_MaxDistance<Point_In, Point_Out> v_max(bucket1, bucket2, config);
-						v_max.estimate(pcl_scan_partition[bucket], laser_center);
-						double v = v_rsc.getVolume(laser_center);
-						if(v >= v_min.getVolume(laser_center) && v <= v_max.getVolume(laser_center))
-						{
-							//ROS_INFO("plane: <%f, %f, %f, %f>", v_rsc.plane.values[0], v_rsc.plane.values[1], v_rsc.plane.values[2], v_rsc.plane.values[3]);
-							pv = &v_rsc;
-						}
-						else
-						{
-							//ROS_WARN("plane(bad volume): <%f, %f, %f, %f>, dist: %f", v_rsc.plane.values[0], v_rsc.plane.values[1], v_rsc.plane.values[2], v_rsc.plane.values[3], v_min.distance);
-						}
+						//ROS_INFO("plane: <%f, %f, %f, %f>", v_rsc.plane.values[0], v_rsc.plane.values[1], v_rsc.plane.values[2], v_rsc.plane.values[3]);
+						pv = &v_rsc;
 					}
 					else
 					{
-						//ROS_INFO("plane estimation failed. using min dist with dist=%f", v_min.distance);
+						//ROS_WARN("plane(bad volume): <%f, %f, %f, %f>, dist: %f", v_rsc.plane.values[0], v_rsc.plane.values[1], v_rsc.plane.values[2], v_rsc.plane.values[3], v_min.distance);
 					}
 				}
-				Quad quad;
-				pv->getQuad(laser_center, quad);
-				colorizePointInBucket1(quad.color, bucket1, bucket2, config.num_subdivisions);
-				quads.push_back(quad);
+				else
+				{
+					//ROS_INFO("plane estimation failed. using min dist with dist=%f", v_min.distance);
+				}
 			}
+			Quad& quad = bucket_quads[bucket];
+			pv->getQuad(laser_center, quad);
+			colorizePointInBucket1(quad.color, bucket1, bucket2, config.num_subdivisions);
+			b_has_quad[bucket] = 1;
 
-			// add points from map that do not fall into deletion volume
-			for(size_t j = 0; j < pcl_map_partition[bucket].size(); j++)
+			// mark the points from map that fall into deletion volume
+			for(size_t k = map_offsets[bucket]; k < map_offsets[bucket + 1]; k++)
 			{
-				double d = dist(laser_center, pcl_map_partition[bucket][j]);
-
-				if(pcl_scan_partition[bucket].size() < 4 ||
-						!pv->testPointForRemoval(pcl_map_partition[bucket][j], laser_center, 0.05 + d * 0.1))
+				const size_t j = map_indices[k];
+				double d = dist(laser_center, pcl_map_old[j]);
+				if(pv->testPointForRemoval(pcl_map_old[j], laser_center, 0.05 + d * 0.1))
 				{
-					if(config.colorize_points)
-						colorizePointInBucket1(pcl_map_partition[bucket][j], bucket1, bucket2, config.num_subdivisions);
-
-					pcl_map_new.push_back(pcl_map_partition[bucket][j]);
-				}
-				else
-				{
-					pcl_removed.push_back(pcl_map_partition[bucket][j]);
+					b_keep_map_point[j] = 0;
 				}
 			}
+		}
+	}
 
-			// add all points from scan
-			for(size_t j = 0; j < pcl_scan_partition[bucket].size(); j++)
-			{
-				Point_Out p;
-				copyPoint(pcl_scan_partition[bucket][j], p);
+	// assemble the new map in bucket order
+	pcl_map_new.reserve(pcl_map_old.size() + pcl_scan_filtered.size());
+	for(size_t bucket = 0; bucket < num_buckets; bucket++)
+	{
+		const size_t bucket1 = bucket / subdivisions;
+		const size_t bucket2 = bucket % subdivisions;
 
-				if(config.colorize_points)
-					colorizePointInBucket1(p, bucket1, bucket2, config.num_subdivisions);
+		if(b_has_quad[bucket]) quads.push_back(bucket_quads[bucket]);
 
-				pcl_map_new.push_back(p);
+		// add points from map that do not fall into deletion volume
+		for(size_t k = map_offsets[bucket]; k < map_offsets[bucket + 1]; k++)
+		{
+			const size_t j = map_indices[k];
+			if(b_keep_map_point[j])
+			{
+				pcl_map_new.push_back(pcl_map_old[j]);
+				if(config.colorize_points)
+					colorizePointInBucket1(pcl_map_new.back(), bucket1, bucket2, config.num_subdivisions);
+			}
+			else
+			{
+				pcl_removed.push_back(pcl_map_old[j]);
 			}
 		}
+
+		// add all points from scan
+		for(size_t j = 0; j < pcl_scan_partition[bucket].size(); j++)
+		{
+			Point_Out p;
+			copyPoint(pcl_scan_partition[bucket][j], p);
+
+			if(config.colorize_points)
+				colorizePointInBucket1(p, bucket1, bucket2, config.num_subdivisions);
+
+			pcl_map_new.push_back(p);
+		}
 	}
 
 	// re-add far points
-	for(size_t i = 0; i < pcl_map_far.size(); i++)
+	for(size_t i = 0; i < pcl_map_old.size(); i++)
 	{
-		pcl_map_new.push_back(pcl_map_far[i]);
+		if(map_buckets[i] < 0) pcl_map_new.push_back(pcl_map_old[i]);
 	}
+}
 
-	PointCloud_Out temp;
-	temp.header = pcl_map_new.header;
+template<typename Point_In, typename Point_Out>
+void DynamicJoinPcl<Point_In, Point_Out>::joinRangeImage(const PointCloud_In& pcl_scan_filtered, const PointCloud_Out& pcl_map_old, PointCloud_Out& pcl_map_new, const pcl::PointXYZ& laser_center, int num_threads)
+{
+	const float cx = laser_center.x, cy = laser_center.y, cz = laser_center.z;
+	const float resolution = config.range_image_resolution * M_PI / 180.0; // [rad]
+	const int num_rows = std::max((int)ceil(M_PI / resolution), 1);       // theta in [0, PI]
+	const int num_cols = std::max((int)ceil(M_2PI / resolution), 1);      // phi in [0, 2PI)
+	const float k_pixel = 1.f / resolution;
+	const float radius_near2 = config.radius_near * config.radius_near;
+
+	/// < range image of the scan: minimum range of the scan points in each pixel (infinity if empty)
+	ScanArena::Buffer<std::vector<float> > range_image_buffer = arena.getVector<float>(num_rows * num_cols, std::numeric_limits<float>::infinity());
+	ScanArena::Buffer<std::vector<int> > scan_pixels_buffer = arena.getVector<int>(pcl_scan_filtered.size());
+	std::vector<float>& range_image = *range_image_buffer;
+	std::vector<int>& scan_pixels = *scan_pixels_buffer;
+	for(size_t i = 0; i < pcl_scan_filtered.size(); i++)
+	{
+		const Point_In& p = pcl_scan_filtered[i];
+		const float dx = p.x - cx, dy = p.y - cy, dz = p.z - cz;
+		const float r = sqrt(dx * dx + dy * dy + dz * dz);
+		if(!std::isfinite(r))
+		{
+			scan_pixels[i] = 0;
+			continue; /// < CONTINUE
+		}
+		const int pixel = rangeImagePixel(dx, dy, dz, r, k_pixel, num_rows, num_cols);
+		scan_pixels[i] = pixel;
+		range_image[pixel] = std::min(range_image[pixel], r);
+	}
 
-	// downsample
-	pcl::VoxelGrid<Point_Out> sor;
-	sor.setInputCloud(pcl_map_new.makeShared());
-	sor.setLeafSize(config.leaf_size, config.leaf_size, config.leaf_size);
-	sor.filter(temp);
+	// a map point is carved only if it lies in front of the scan in its pixel and in the 8 pixels around (no carving across depth discontinuities or pixel borders)
+	ScanArena::Buffer<std::vector<float> > carve_image_buffer = arena.getVector<float>(range_image.size());
+	std::vector<float>& carve_image = *carve_image_buffer;
+	#pragma omp parallel for num_threads(num_threads) schedule(static)
+	for(int row = 0; row < num_rows; row++)
+	{
+		for(int col = 0; col < num_cols; col++)
+		{
+			float min_range = std::numeric_limits<float>::infinity();
+			bool b_all_filled = true;
+			for(int drow = -1; drow <= 1; drow++)
+			{
+				const int row_n = row + drow;
+				if(row_n < 0 || row_n >= num_rows) continue;
+				for(int dcol = -1; dcol <= 1; dcol++)
+				{
+					const int col_n = (col + dcol + num_cols) % num_cols; // phi wraps around
+					const float range = range_image[row_n * num_cols + col_n];
+					b_all_filled = b_all_filled && (range < std::numeric_limits<float>::infinity());
+					min_range = std::min(min_range, range);
+				}
+			}
+			carve_image[row * num_cols + col] = b_all_filled ? min_range : 0.f; // 0: nothing is carved
+		}
+	}
 
-	pcl_map_new.swap(temp);
+	/// < single pass over the old map: remove the near points lying in the free space in front of the scan
+	ScanArena::Buffer<std::vector<char> > b_keep_map_point_buffer = arena.getVector<char>(pcl_map_old.size(), 1);
+	std::vector<char>& b_keep_map_point = *b_keep_map_point_buffer;
+	#pragma omp parallel for num_threads(num_threads) schedule(static)
+	for(int i = 0; i < (int)pcl_map_old.size(); i++)
+	{
+		const Point_Out& p = pcl_map_old[i];
+		const float dx = p.x - cx, dy = p.y - cy, dz = p.z - cz;
+		const float r2 = dx * dx + dy * dy + dz * dz;
+		if(!(r2 <= radius_near2)) continue; /// < CONTINUE far (and invalid) points are kept
+		const float r = sqrt(r2);
+		const int pixel = rangeImagePixel(dx, dy, dz, r, k_pixel, num_rows, num_cols);
+		// same removal threshold of the bucket approach
+		if(r + 0.05f + r * 0.1f < carve_image[pixel]) b_keep_map_point[i] = 0;
+	}
+
+	pcl_map_new.reserve(pcl_map_old.size() + pcl_scan_filtered.size());
+	for(size_t i = 0; i < pcl_map_old.size(); i++)
+	{
+		if(b_keep_map_point[i])
+			pcl_map_new.push_back(pcl_map_old[i]);
+		else
+			pcl_removed.push_back(pcl_map_old[i]);
+	}
+	for(size_t i = 0; i < pcl_scan_filtered.size(); i++)
+	{
+		Point_Out p;
+		copyPoint(pcl_scan_filtered[i], p);
+
+		if(config.colorize_points)
+			colorizePointInBucket1(p, scan_pixels[i] / num_cols, scan_pixels[i] % num_cols, num_cols);
+
+		pcl_map_new.push_back(p);
+	}
 }
 
 template<typename Point_In, typename Point_Out>
@@ -0,0 +1,141 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "EsdfMapAdapter.h"
+
+#include <algorithm>
+
+#ifdef USE_VOXBLOX
+#include <voxblox/core/esdf_map.h>
+#include <voxblox_msgs/Layer.h>
+#include <voxblox_ros/conversions.h>
+#endif
+
+
+struct EsdfMapAdapter::Impl
+{
+    boost::recursive_mutex mutex;
+    ros::Subscriber layer_sub;
+    volatile bool b_ready = false;
+
+#ifdef USE_VOXBLOX
+    voxblox::EsdfMap::Ptr p_esdf_map;
+    double min_step = 0; // [m] minimum step of the sphere tracing
+
+    void layerCallback(const voxblox_msgs::Layer& layer_msg)
+    {
+        boost::recursive_mutex::scoped_lock locker(mutex);
+
+        if (!p_esdf_map)
+        {
+            voxblox::EsdfMap::Config config;
+            config.esdf_voxel_size = layer_msg.voxel_size;
+            config.esdf_voxels_per_side = layer_msg.voxels_per_side;
+            p_esdf_map.reset(new voxblox::EsdfMap(config));
+            min_step = 0.5 * layer_msg.voxel_size;
+        }
+
+        // the messages only carry the updated blocks: they are merged into the current layer
+        if (!voxblox::deserializeMsgToLayer<voxblox::EsdfVoxel>(layer_msg, p_esdf_map->getEsdfLayerPtr()))
+        {
+            ROS_ERROR_THROTTLE(10, "EsdfMapAdapter::layerCallback() - got an invalid ESDF map message");
+            return; /// < EXIT POINT
+        }
+        b_ready = true;
+    }
+#endif
+};
+
+
+EsdfMapAdapter::EsdfMapAdapter() : p_impl_(new Impl())
+{
+}
+
+EsdfMapAdapter::~EsdfMapAdapter()
+{
+}
+
+bool EsdfMapAdapter::isAvailable()
+{
+#ifdef USE_VOXBLOX
+    return true;
+#else
+    return false;
+#endif
+}
+
+void EsdfMapAdapter::init(ros::NodeHandle& nh, const std::string& topic)
+{
+#ifdef USE_VOXBLOX
+    // N.B.: the layer messages are incremental, they must not be dropped
+    p_impl_->layer_sub = nh.subscribe(topic, 10, &EsdfMapAdapter::Impl::layerCallback, p_impl_.get());
+    ROS_INFO_STREAM("EsdfMapAdapter::init() - ESDF map topic: " << topic);
+#else
+    ROS_WARN_STREAM("EsdfMapAdapter::init() - path_planner has been built without voxblox, the ESDF map " << topic << " is not used");
+#endif
+}
+
+bool EsdfMapAdapter::isReady() const
+{
+    return p_impl_->b_ready;
+}
+
+boost::recursive_mutex& EsdfMapAdapter::getMutex()
+{
+    return p_impl_->mutex;
+}
+
+bool EsdfMapAdapter::getDistance(const Eigen::Vector3d& point, double& distance) const
+{
+#ifdef USE_VOXBLOX
+    if (!p_impl_->p_esdf_map) return false; /// < EXIT POINT
+
+    // the interpolation needs the 8 surrounding voxels: close to the unobserved space use the voxel of the point
+    const voxblox::EsdfMap& esdf_map = *p_impl_->p_esdf_map;
+    return esdf_map.getDistanceAtPosition(point, true, &distance) || esdf_map.getDistanceAtPosition(point, false, &distance);
+#else
+    return false;
+#endif
+}
+
+EsdfMapAdapter::LineStatus EsdfMapAdapter::getLineStatus(const Eigen::Vector3d& start, const Eigen::Vector3d& end, double radius) const
+{
+#ifdef USE_VOXBLOX
+    if (!p_impl_->p_esdf_map) return kUnknown; /// < EXIT POINT
+
+    const Eigen::Vector3d segment = end - start;
+    const double length = segment.norm();
+    const Eigen::Vector3d direction = (length > 0) ? Eigen::Vector3d(segment / length) : Eigen::Vector3d::Zero();
+
+    // sphere tracing: the sphere of radius (distance - radius) around a sample is free, hence the next sample is taken on its border
+    // (at least half a voxel away: an obstacle is at least one voxel thick)
+    double s = 0;
+    while (true)
+    {
+        double distance = 0;
+        if (!getDistance(start + direction * std::min(s, length), distance)) return kUnknown; /// < EXIT POINT
+        if (distance <= radius) return kOccupied; /// < EXIT POINT
+        if (s >= length) return kFree; /// < EXIT POINT
+        s += std::max(distance - radius, p_impl_->min_step);
+    }
+#else
+    return kUnknown;
+#endif
+}
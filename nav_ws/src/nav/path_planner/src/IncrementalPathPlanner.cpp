@@ -0,0 +1,540 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "IncrementalPathPlanner.h"
+#include "VoxelBinaryKey.h"
+
+#include <limits>       // std::numeric_limits
+#include <algorithm>
+#include <unordered_map>
+
+//#define VERBOSE  // entry level of verbosity
+
+const double IncrementalPathPlanner::kVoxelKeyLeafSize = 0.01; // [m] much smaller than the map resolution: a point with the same key is the same point
+const float IncrementalPathPlanner::kGoalChangeThreshold = 0.1; // [m] same as PathPlanner::kGoalPlanningCheckThreshold
+const float IncrementalPathPlanner::kTravChangeThreshold = 1e-3;
+const float IncrementalPathPlanner::kPlanningTimeoutSec = 100; // same as PathPlanner::kPlanningTimeoutSec
+
+const double IncrementalPathPlanner::kInfinity = std::numeric_limits<double>::infinity();
+
+static const size_t kAbortCheckPeriod = 256; // number of vertex expansions between two checks of abort and timeout
+
+IncrementalPathPlanner::IncrementalPathPlanner()
+{
+    km_ = 0;
+    start_idx_ = -1;
+    goal_idx_ = -1;
+    b_search_active_ = false;
+    b_abort_ = false;
+    num_repaired_vertices_ = 0;
+    num_expansions_ = 0;
+
+    p_cost_.reset(new BaseCostFunction());
+}
+
+void IncrementalPathPlanner::reset()
+{
+    boost::recursive_mutex::scoped_lock locker(interaction_mutex);
+
+    b_search_active_ = false;
+    g_.clear();
+    rhs_.clear();
+    open_.clear();
+    open_key_.clear();
+    in_open_.clear();
+    km_ = 0;
+}
+
+void IncrementalPathPlanner::setCostFunctionType(int type, float lamda_trav, float lambda_aux_utility, float tau_exp_decay)
+{
+    boost::recursive_mutex::scoped_lock locker(interaction_mutex);
+
+    p_cost_.reset(BaseCostFunction::create(type));
+    p_cost_->SetLambdaTrav(lamda_trav);
+    p_cost_->SetLambdaAuxUtility(lambda_aux_utility);
+    p_cost_->SetTauExpDecay(tau_exp_decay);
+    std::cout << "IncrementalPathPlanner::setCostFunctionType()- setting " << p_cost_->getName() << std::endl;
+
+    // the edge costs changed: the search must restart
+    reset();
+}
+
+bool IncrementalPathPlanner::setMap(const pcl::PointCloud<pcl::PointXYZI>::ConstPtr& traversability_pcl, const NeighborhoodGraph::ConstPtr& graph, const PathPlanner::WallKdTreeFLANNConstPtr& wall_kdtree)
+{
+    boost::recursive_mutex::scoped_lock locker(interaction_mutex);
+
+    if ((traversability_pcl == pcl_traversability_) && (graph == p_graph_) && (wall_kdtree == p_kdtree_wall_))
+    {
+        return true; /// < EXIT POINT: same snapshot
+    }
+
+    if (!traversability_pcl || traversability_pcl->empty() || !graph || !wall_kdtree ||
+        !graph->isValidFor(*traversability_pcl, PathPlanner::kMaxRobotStepDeltaZ) || (graph->getRadius() < PathPlanner::kMaxRobotStep))
+    {
+        ROS_WARN("IncrementalPathPlanner::setMap() - invalid input map");
+        reset();
+        pcl_traversability_.reset();
+        p_graph_.reset();
+        p_kdtree_wall_.reset();
+        return false; /// < EXIT POINT
+    }
+
+    std::vector<float> radius;
+    std::vector<uint64_t> keys;
+    computeVertexData(*traversability_pcl, *wall_kdtree, radius, keys);
+
+    p_kdtree_wall_ = wall_kdtree;
+
+    if (b_search_active_)
+    {
+        repairSearch(traversability_pcl, graph, radius, keys);
+    }
+    else
+    {
+        pcl_traversability_ = traversability_pcl;
+        p_graph_ = graph;
+        radius_.swap(radius);
+        keys_.swap(keys);
+        num_repaired_vertices_ = 0;
+    }
+
+    return true;
+}
+
+void IncrementalPathPlanner::setGoal(const pcl::PointXYZI& goal, int goal_point_idx)
+{
+    boost::recursive_mutex::scoped_lock locker(interaction_mutex);
+
+    if (b_search_active_ && (PathPlanner::dist(goal, goal_) < kGoalChangeThreshold))
+    {
+        return; /// < EXIT POINT: same goal, keep the search state (goal_idx_ has been tracked through the map updates)
+    }
+
+    goal_ = goal;
+    goal_idx_ = goal_point_idx;
+    reset();
+}
+
+bool IncrementalPathPlanner::planning(int start_point_idx, nav_msgs::Path& path_out)
+{
+    boost::recursive_mutex::scoped_lock locker(interaction_mutex);
+
+    b_abort_ = false;
+
+    path_out.poses.clear();
+    path_out.header.frame_id = "map";
+
+    if (!pcl_traversability_ || (goal_idx_ < 0) || (goal_idx_ >= (int)pcl_traversability_->size()) ||
+        (start_point_idx < 0) || (start_point_idx >= (int)pcl_traversability_->size()))
+    {
+        ROS_WARN("IncrementalPathPlanner::planning() - invalid map, start or goal");
+        return false; /// < EXIT POINT
+    }
+
+    const pcl::PointXYZI& start = (*pcl_traversability_)[start_point_idx];
+    start_idx_ = start_point_idx;
+    if (!b_search_active_)
+    {
+        initSearch(start_point_idx);
+    }
+    else
+    {
+        // the robot moved: the keys in the queue are lower bounds of the new ones
+        km_ += PathPlanner::dist(last_start_, start);
+        last_start_ = start;
+    }
+
+    std::cout << "IncrementalPathPlanner::planning() - using cost function: " << p_cost_->getName() << ", repaired vertices: " << num_repaired_vertices_ << std::endl;
+
+    if (!computeShortestPath())
+    {
+        // the partial state is still consistent: the next planning() resumes from it
+        ROS_WARN("IncrementalPathPlanner::planning() - aborted or timeout");
+        return false; /// < EXIT POINT
+    }
+
+    std::cout << "IncrementalPathPlanner::planning() - expansions: " << num_expansions_ << std::endl;
+
+    if (!extractPath(start_point_idx, path_out))
+    {
+        ROS_WARN("IncrementalPathPlanner::planning() - NO PATH");
+        path_out.poses.clear();
+        return false; /// < EXIT POINT
+    }
+
+    // smooth the path
+    path_out = PathPlanner::smoothPath3(path_out);
+
+    ROS_INFO("path length: %ld", path_out.poses.size());
+    return true;
+}
+
+void IncrementalPathPlanner::initSearch(int start_point_idx)
+{
+    const size_t num_vertices = pcl_traversability_->size();
+
+    // freeze the traversability normalization for this goal
+    PathPlanner::computeIMinMaxRange(*pcl_traversability_, p_cost_->GetMinTrav(), p_cost_->GetMaxTrav(), p_cost_->GetRangeTrav());
+    p_cost_->initTime();
+
+    g_.assign(num_vertices, kInfinity);
+    rhs_.assign(num_vertices, kInfinity);
+    open_.clear();
+    open_key_.assign(num_vertices, Key());
+    in_open_.assign(num_vertices, 0);
+
+    km_ = 0;
+    last_start_ = (*pcl_traversability_)[start_point_idx];
+
+    rhs_[goal_idx_] = 0;
+    queueInsert(goal_idx_, calculateKey(goal_idx_));
+
+    b_search_active_ = true;
+    num_repaired_vertices_ = 0;
+}
+
+double IncrementalPathPlanner::heuristic(int u) const
+{
+    return PathPlanner::dist(last_start_, (*pcl_traversability_)[u]);
+}
+
+double IncrementalPathPlanner::edgeCost(int u, int v, float squared_dist) const
+{
+    const float max_step = std::min(radius_[u], radius_[v]);
+    if (squared_dist > max_step*max_step) return kInfinity; /// < EXIT POINT
+
+    const pcl::PointXYZI& pv = (*pcl_traversability_)[v];
+    if (!(pv.intensity < std::numeric_limits<double>::infinity())) return kInfinity; /// < EXIT POINT
+
+    // clamp to the normalization frozen at the search start
+    const float trav = std::max(std::min(pv.intensity, p_cost_->GetMaxTrav()), p_cost_->GetMinTrav());
+
+    // goal = next: the heuristic term of the cost function vanishes
+    return p_cost_->cost((*pcl_traversability_)[u], pv, pv, trav);
+}
+
+IncrementalPathPlanner::Key IncrementalPathPlanner::calculateKey(int u) const
+{
+    const double k2 = std::min(g_[u], rhs_[u]);
+    return Key(k2 + heuristic(u) + km_, k2);
+}
+
+double IncrementalPathPlanner::computeRhs(int u) const
+{
+    double rhs = kInfinity;
+    const size_t num_neighbors = p_graph_->getNumNeighbors(u);
+    const int* neighbors = p_graph_->getNeighbors(u);
+    const float* squared_distances = p_graph_->getSquaredDistances(u);
+    const float squared_radius = radius_[u]*radius_[u];
+    for (size_t j = 0; j < num_neighbors; j++)
+    {
+        if (squared_distances[j] > squared_radius) break; // neighbors are sorted by distance
+        const int v = neighbors[j];
+        if ((v == u) || !(g_[v] < kInfinity)) continue;
+        rhs = std::min(rhs, edgeCost(u, v, squared_distances[j]) + g_[v]);
+    }
+    return rhs;
+}
+
+void IncrementalPathPlanner::queueInsert(int u, const Key& key)
+{
+    queueRemove(u);
+    open_.insert(QueueEntry(key, u));
+    open_key_[u] = key;
+    in_open_[u] = 1;
+}
+
+void IncrementalPathPlanner::queueRemove(int u)
+{
+    if (!in_open_[u]) return; /// < EXIT POINT
+    open_.erase(QueueEntry(open_key_[u], u));
+    in_open_[u] = 0;
+}
+
+void IncrementalPathPlanner::updateVertex(int u)
+{
+    if (u != goal_idx_) rhs_[u] = computeRhs(u);
+
+    if (g_[u] != rhs_[u])
+        queueInsert(u, calculateKey(u));
+    else
+        queueRemove(u);
+}
+
+bool IncrementalPathPlanner::computeShortestPath()
+{
+    ros::Time time_start = ros::Time::now();
+    num_expansions_ = 0;
+
+    while (!open_.empty())
+    {
+        const QueueEntry top = *open_.begin();
+        if (!(top.first < calculateKey(start_idx_)) && (rhs_[start_idx_] == g_[start_idx_])) break;
+
+        num_expansions_++;
+        if ((num_expansions_ % kAbortCheckPeriod) == 0)
+        {
+            if (b_abort_) return false; /// < EXIT POINT
+            if ((ros::Time::now() - time_start).toSec() > kPlanningTimeoutSec) return false; /// < EXIT POINT
+        }
+
+        const int u = top.second;
+        const Key key_old = top.first;
+        const Key key_new = calculateKey(u);
+
+        const size_t num_neighbors = p_graph_->getNumNeighbors(u);
+        const int* neighbors = p_graph_->getNeighbors(u);
+        const float* squared_distances = p_graph_->getSquaredDistances(u);
+        const float squared_radius = radius_[u]*radius_[u];
+
+        if (key_old < key_new)
+        {
+            queueInsert(u, key_new);
+        }
+        else if (g_[u] > rhs_[u])
+        {
+            g_[u] = rhs_[u];
+            queueRemove(u);
+            for (size_t j = 0; j < num_neighbors; j++)
+            {
+                if (squared_distances[j] > squared_radius) break;
+                const int s = neighbors[j];
+                if (s == u) continue;
+                // only the predecessor s through the edge (s,u) can improve
+                if (s != goal_idx_) rhs_[s] = std::min(rhs_[s], edgeCost(s, u, squared_distances[j]) + g_[u]);
+                if (g_[s] != rhs_[s])
+                    queueInsert(s, calculateKey(s));
+                else
+                    queueRemove(s);
+            }
+        }
+        else
+        {
+            g_[u] = kInfinity;
+            updateVertex(u);
+            for (size_t j = 0; j < num_neighbors; j++)
+            {
+                if (squared_distances[j] > squared_radius) break;
+                const int s = neighbors[j];
+                if (s == u) continue;
+                updateVertex(s);
+            }
+        }
+    }
+
+    return true;
+}
+
+bool IncrementalPathPlanner::extractPath(int start_point_idx, nav_msgs::Path& path_out) const
+{
+    if (!(g_[start_point_idx] < kInfinity)) return false; /// < EXIT POINT
+
+    int u = start_point_idx;
+    size_t num_steps = 0;
+    while (true)
+    {
+        const pcl::PointXYZI& point = (*pcl_traversability_)[u];
+        geometry_msgs::PoseStamped pose;
+        pose.header.frame_id = "map";
+        pose.pose.position.x = point.x;
+        pose.pose.position.y = point.y;
+        pose.pose.position.z = point.z;
+        path_out.poses.push_back(pose);
+
+        if (u == goal_idx_) break;
+        if (++num_steps > pcl_traversability_->size()) return false; /// < EXIT POINT: cycle
+
+        // move to the successor minimizing c(u,s) + g(s)
+        int best = -1;
+        double best_cost = kInfinity;
+        const size_t num_neighbors = p_graph_->getNumNeighbors(u);
+        const int* neighbors = p_graph_->getNeighbors(u);
+        const float* squared_distances = p_graph_->getSquaredDistances(u);
+        const float squared_radius = radius_[u]*radius_[u];
+        for (size_t j = 0; j < num_neighbors; j++)
+        {
+            if (squared_distances[j] > squared_radius) break;
+            const int s = neighbors[j];
+            if ((s == u) || !(g_[s] < kInfinity)) continue;
+            const double cost = edgeCost(u, s, squared_distances[j]) + g_[s];
+            if (cost < best_cost)
+            {
+                best_cost = cost;
+                best = s;
+            }
+        }
+        if (best < 0) return false; /// < EXIT POINT
+        u = best;
+    }
+
+    return true;
+}
+
+void IncrementalPathPlanner::computeVertexData(const pcl::PointCloud<pcl::PointXYZI>& pcl, const PathPlanner::WallKdTreeFLANN& wall_kdtree, std::vector<float>& radius, std::vector<uint64_t>& keys)
+{
+    const int num_points = pcl.size();
+    radius.resize(num_points);
+    keys.resize(num_points);
+
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < num_points; i++)
+    {
+        const pcl::PointXYZI& p = pcl[i];
+
+        std::vector<int> point_idx(1);
+        std::vector<float> squared_dist(1, std::numeric_limits<float>::max());
+        pcl::PointXYZRGBNormal p_RGBN;
+        p_RGBN.x = p.x;
+        p_RGBN.y = p.y;
+        p_RGBN.z = p.z;
+        if (wall_kdtree.nearestKSearch(p_RGBN, 1, point_idx, squared_dist) < 1)
+        {
+            squared_dist[0] = std::numeric_limits<float>::max();
+        }
+        // same rule of PathPlanner::findNeighbors()
+        radius[i] = std::min((float)sqrt(squared_dist[0]), PathPlanner::kMaxRobotStep);
+
+        keys[i] = voxelBinaryKey(p, kVoxelKeyLeafSize);
+    }
+}
+
+void IncrementalPathPlanner::repairSearch(const pcl::PointCloud<pcl::PointXYZI>::ConstPtr& traversability_pcl, const NeighborhoodGraph::ConstPtr& graph, std::vector<float>& radius, std::vector<uint64_t>& keys)
+{
+    const pcl::PointCloud<pcl::PointXYZI>& old_pcl = *pcl_traversability_;
+    const pcl::PointCloud<pcl::PointXYZI>& new_pcl = *traversability_pcl;
+    const size_t num_old = old_pcl.size();
+    const size_t num_new = new_pcl.size();
+
+    /// < match the points of the two maps by voxel key
+    std::unordered_map<uint64_t, int> old_key_map;
+    old_key_map.reserve(num_old);
+    for (size_t j = 0; j < num_old; j++)
+    {
+        old_key_map.insert(std::make_pair(keys_[j], (int)j)); // in case of duplicated keys, only the first one is matched
+    }
+
+    std::vector<int> new_to_old(num_new, -1);
+    std::vector<int> old_to_new(num_old, -1);
+    for (size_t i = 0; i < num_new; i++)
+    {
+        std::unordered_map<uint64_t, int>::iterator it = old_key_map.find(keys[i]);
+        if ((it == old_key_map.end()) || (old_to_new[it->second] >= 0)) continue;
+        new_to_old[i] = it->second;
+        old_to_new[it->second] = i;
+    }
+
+    const int new_goal_idx = (goal_idx_ >= 0) ? old_to_new[goal_idx_] : -1;
+    if (new_goal_idx < 0)
+    {
+        std::cout << "IncrementalPathPlanner::repairSearch() - goal removed from the map, resetting the search" << std::endl;
+        pcl_traversability_ = traversability_pcl;
+        p_graph_ = graph;
+        radius_.swap(radius);
+        keys_.swap(keys);
+        goal_idx_ = -1;
+        reset();
+        return; /// < EXIT POINT
+    }
+
+    /// < mark the changed vertices: new points, points whose traversability or edge radius changed, old neighbors of removed points
+    std::vector<char> changed(num_new, 0);
+    for (size_t i = 0; i < num_new; i++)
+    {
+        const int j = new_to_old[i];
+        if (j < 0)
+        {
+            changed[i] = 1;
+            continue;
+        }
+        const float trav_new = new_pcl[i].intensity;
+        const float trav_old = old_pcl[j].intensity;
+        const bool is_finite_new = trav_new < std::numeric_limits<double>::infinity();
+        const bool is_finite_old = trav_old < std::numeric_limits<double>::infinity();
+        if ((is_finite_new != is_finite_old) || (is_finite_new && (fabs(trav_new - trav_old) > kTravChangeThreshold)) || (radius[i] != radius_[j]))
+        {
+            changed[i] = 1;
+        }
+    }
+    for (size_t j = 0; j < num_old; j++)
+    {
+        if (old_to_new[j] >= 0) continue;
+        const size_t num_neighbors = p_graph_->getNumNeighbors(j);
+        const int* neighbors = p_graph_->getNeighbors(j);
+        for (size_t k = 0; k < num_neighbors; k++)
+        {
+            const int i = old_to_new[neighbors[k]];
+            if (i >= 0) changed[i] = 1;
+        }
+    }
+
+    /// < transfer the search state
+    std::vector<double> g(num_new, kInfinity);
+    std::vector<double> rhs(num_new, kInfinity);
+    for (size_t i = 0; i < num_new; i++)
+    {
+        const int j = new_to_old[i];
+        if (j < 0) continue;
+        g[i] = g_[j];
+        rhs[i] = rhs_[j];
+    }
+
+    pcl_traversability_ = traversability_pcl;
+    p_graph_ = graph;
+    radius_.swap(radius);
+    keys_.swap(keys);
+    g_.swap(g);
+    rhs_.swap(rhs);
+    goal_idx_ = new_goal_idx;
+    rhs_[goal_idx_] = 0;
+
+    /// < the rhs of the changed vertices and of their neighbors must be recomputed (the edges incident to a changed vertex changed)
+    std::vector<char> to_update(changed);
+    for (size_t i = 0; i < num_new; i++)
+    {
+        if (!changed[i]) continue;
+        const size_t num_neighbors = p_graph_->getNumNeighbors(i);
+        const int* neighbors = p_graph_->getNeighbors(i);
+        for (size_t k = 0; k < num_neighbors; k++)
+        {
+            to_update[neighbors[k]] = 1;
+        }
+    }
+
+    num_repaired_vertices_ = 0;
+    for (size_t i = 0; i < num_new; i++)
+    {
+        if (!to_update[i]) continue;
+        if ((int)i != goal_idx_) rhs_[i] = computeRhs(i);
+        num_repaired_vertices_++;
+    }
+
+    /// < rebuild the queue with the inconsistent vertices
+    open_.clear();
+    open_key_.assign(num_new, Key());
+    in_open_.assign(num_new, 0);
+    for (size_t i = 0; i < num_new; i++)
+    {
+        if (g_[i] != rhs_[i]) queueInsert(i, calculateKey(i));
+    }
+
+#ifdef VERBOSE
+    std::cout << "IncrementalPathPlanner::repairSearch() - repaired vertices: " << num_repaired_vertices_ << ", queue size: " << open_.size() << std::endl;
+#endif
+}
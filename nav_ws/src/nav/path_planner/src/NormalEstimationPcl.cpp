@@ -19,9 +19,12 @@
 */
 
 #include <NormalEstimationPcl.h>
-#include <ZTimer.h>
+#include <mr3d_profiling/Profiler.h>
+#include <VoxelBinaryKey.h>
 #include <limits>
 #include <queue>
+#include <algorithm>
+#include <unordered_map>
 
 
 #define USE_DIRECTION_PROPAGATION 1
@@ -35,10 +38,11 @@
 
 #define LOG_NORMALS_STATISTICS 1
 
+// per point steps of computeNormal() (define LOG_TIMES to record them in the profiler)
 #ifdef LOG_TIMES
-#define LOG_TIME(obj, name, ...) (obj).measureAndLog(name, __VA_ARGS__) 
+#define LOG_TIME(timer, name) PROFILE_LAP(timer, name)
 #else
-#define LOG_TIME(obj, name, ...)
+#define LOG_TIME(timer, name)
 #endif
 
 static const Eigen::Vector3f zAxis(0.0f,0.0f,1.0f);
@@ -67,7 +71,13 @@ template<typename PointT>
 const float NormalEstimationPcl<PointT>::kMinCosToPropagate= cos((90-40)*M_PI/180.);
 
 template<typename PointT>
-NormalEstimationPcl<PointT>::NormalEstimationPcl(): threshold_(0.5)
+const size_t NormalEstimationPcl<PointT>::kChunkSize = 2048; // small enough to balance the workers, large enough to keep the block assignment within the chunk effective 
+
+template<typename PointT>
+const double NormalEstimationPcl<PointT>::kIncrementalKeyLeafSize = 0.01; // [m] much smaller than the map leaf size 
+
+template<typename PointT>
+NormalEstimationPcl<PointT>::NormalEstimationPcl(): threshold_(0.5), num_busy_workers_(0), b_reset_incremental_(true)
 {
     pcl_laser_trajectory_.reset(new PointCloudT());
 
@@ -133,7 +143,7 @@ void NormalEstimationPcl<PointT>::computeCovarianceMatrix(const PointCloudT& nei
 }
 
 template<typename PointT>
-bool NormalEstimationPcl<PointT>::computeNormal(const size_t i, const size_t begin, const size_t end, PointCloudT& pcl, KdTreeT& kdtree, atom_bool_vec& done, atom_bool_vec& propagate, const pcl::PointXYZ& center)
+bool NormalEstimationPcl<PointT>::computeNormal(const size_t i, const size_t begin, const size_t end, PointCloudT& pcl, KdTreeT& kdtree, atom_bool_vec& done, atom_bool_vec& propagate, const pcl::PointXYZ& center, NeighborhoodScratch& scratch)
 {    
     if (done[i]) return true;
     
@@ -153,8 +163,8 @@ bool NormalEstimationPcl<PointT>::computeNormal(const size_t i, const size_t beg
 
 #if !USE_PSEUDONORMALS_AS_NORMALS
     //Find neighbors of point
-    std::vector<int> pointIdxSearch;
-    std::vector<float> pointSquaredDistance;
+    std::vector<int>& pointIdxSearch = scratch.indices;
+    std::vector<float>& pointSquaredDistance = scratch.squared_distances;
     int found = 0;
     {
     //boost::recursive_mutex::scoped_lock locker(kdtree_mutex_);
@@ -193,14 +203,17 @@ bool NormalEstimationPcl<PointT>::computeNormal(const size_t i, const size_t beg
         }*/
 #endif
 
-        ZTimer ztimer;
+#ifdef LOG_TIMES
+        PROFILE_LAP_TIMER(lap_timer);
+#endif
 
         //cout<<"neghbors size:"<<pointIdxRadiusSearch.size()<<endl;
         
         bool bCanAlignToNeighbor = false; 
         size_t indexNeighborToAlign = 0; 
 
-        PointCloudT neighbors;
+        PointCloudT& neighbors = scratch.neighbors;
+        neighbors.clear(); // keep the capacity of the previous points 
         pcl::PointXYZ baricenter(0.0, 0.0, 0.0);
         const size_t neighborhood_size = pointIdxSearch.size();
         for (size_t j = 0, jEnd = neighborhood_size; j < jEnd; j++)  
@@ -222,14 +235,14 @@ bool NormalEstimationPcl<PointT>::computeNormal(const size_t i, const size_t beg
         baricenter.y /= neighborhood_size;
         baricenter.z /= neighborhood_size;
 
-        LOG_TIME(ztimer, "build_neighbours", size);
+        LOG_TIME(lap_timer, "normals/build_neighbours");
 
         typedef Eigen::Matrix3f MatrixT;
 
         MatrixT covariance_matrix;
         computeCovarianceMatrix(neighbors, baricenter, covariance_matrix);
 
-        LOG_TIME(ztimer, "covariance_matrix", size);
+        LOG_TIME(lap_timer, "normals/covariance_matrix");
 
         //Eigen::JacobiSVD<MatrixT> svd(covariance_matrix, Eigen::ComputeThinU | Eigen::ComputeThinV);
         Eigen::JacobiSVD<MatrixT> svd(covariance_matrix, Eigen::ComputeFullV);
@@ -270,7 +283,7 @@ bool NormalEstimationPcl<PointT>::computeNormal(const size_t i, const size_t beg
         pcl[i].normal[2] = normal(2);
         done[i] = true;
 
-        LOG_TIME(ztimer, "svd", size);
+        LOG_TIME(lap_timer, "normals/svd");
 
         
         if (3 * Sv[2] / (Sv[0] + Sv[1] + Sv[2]) < config_.flatness_curvature_threshold)
@@ -289,7 +302,7 @@ bool NormalEstimationPcl<PointT>::computeNormal(const size_t i, const size_t beg
                 delta.y = baricenter.y - pcl[neighbor_j].y;
                 delta.z = baricenter.z - pcl[neighbor_j].z;
                 if (neighbor_j >= begin
-                    && neighbor_j <= end
+                    && neighbor_j < end
                     && NORM3_L2_2(delta.x, delta.y, delta.z) < half_radius2)
                 {
                     pcl[neighbor_j].normal[0] = normal(0);
@@ -300,7 +313,7 @@ bool NormalEstimationPcl<PointT>::computeNormal(const size_t i, const size_t beg
             }
         }
 
-        LOG_TIME(ztimer, "block_assign");
+        LOG_TIME(lap_timer, "normals/block_assign");
         
 #if USE_DIRECTION_PROPAGATION     
         for(size_t j=1, jEnd=pointIdxSearch.size(); j < jEnd; j++) // we start from pointIdxRadiusSearch[1] since pointIdxRadiusSearch[0] is the index of plc[i] itself 
@@ -308,8 +321,7 @@ bool NormalEstimationPcl<PointT>::computeNormal(const size_t i, const size_t beg
             const size_t& point_idx = pointIdxSearch[j];
             if(!done[point_idx]) 
             {
-                boost::recursive_mutex::scoped_lock locker(queue_mutex_);                
-                queue_.push_back(point_idx); 
+                queue_.push(point_idx); // no-op if already pushed 
             }
         }
 #endif            
@@ -337,52 +349,79 @@ bool NormalEstimationPcl<PointT>::computeNormal(const size_t i, const size_t beg
 }
 
 template<typename PointT>
-void NormalEstimationPcl<PointT>::computeNormalsInRange(const size_t num_thread, const size_t start, const size_t end, PointCloudT& pcl, KdTreeT& kdtree, atom_bool_vec& done, atom_bool_vec& propagate, const pcl::PointXYZ& center)
+void NormalEstimationPcl<PointT>::computeNormalsInRange(const size_t start, const size_t end, PointCloudT& pcl, KdTreeT& kdtree, atom_bool_vec& done, atom_bool_vec& propagate, const pcl::PointXYZ& center, NormalsStats& stats)
 {
-    ROS_INFO("NormalEstimationPcl::computeNormalsInRange: spawn thread #%ld (point range: %ld-%ld)", num_thread, start, end);
-
-    try
-    {
-        size_t num_computed_points = 0, num_isolated_points = 0, num_invalid_normals = 0;
-        ZTimer ztimer;
-
+    ScanArena::Buffer<NeighborhoodScratch> scratch = arena_.get<NeighborhoodScratch>();
+    
 #if LOG_NORMALS_STATISTICS        
-        for (size_t i = start; i < end; i++)
+    for (size_t i = start; i < end; i++)
+    {
+        if (!done[i])
         {
-            if (!done[i])
-            {
-                num_computed_points++;
-            }
+            stats.num_computed_points++;
+        }
 
-            if (!computeNormal(i, start, end, pcl, kdtree, done, propagate, center))
-            {
-                num_isolated_points++;
-            }
+        if (!computeNormal(i, start, end, pcl, kdtree, done, propagate, center, *scratch))
+        {
+            stats.num_isolated_points++;
+        }
 
-            //if (NORM3_L2_2(pcl[i].normal_x, pcl[i].normal_y, pcl[i].normal_z) < 0.99)
-            if( !VALID_VECTOR(pcl[i].normal_x, pcl[i].normal_y, pcl[i].normal_z) )
-            {
-                num_invalid_normals++;
-            }
+        //if (NORM3_L2_2(pcl[i].normal_x, pcl[i].normal_y, pcl[i].normal_z) < 0.99)
+        if( !VALID_VECTOR(pcl[i].normal_x, pcl[i].normal_y, pcl[i].normal_z) )
+        {
+            stats.num_invalid_normals++;
         }
+    }
 #else
-        for (size_t i = start; i < end; i++)
+    for (size_t i = start; i < end; i++)
+    {
+       bool res = computeNormal(i, start, end, pcl, kdtree, done, propagate, center, *scratch);     
+    }
+#endif             
+}
+
+template<typename PointT>
+void NormalEstimationPcl<PointT>::computeNormalsInChunks(const size_t num_thread, PointRangeChunks& chunks, PointCloudT& pcl, KdTreeT& kdtree, atom_bool_vec& done, atom_bool_vec& propagate, const pcl::PointXYZ& center)
+{
+    ROS_INFO("NormalEstimationPcl::computeNormalsInChunks: start thread #%ld", num_thread);
+
+    try
+    {
+        PROFILE_ZONE_NAMED(zone, "normals/thread_chunks");
+        NormalsStats stats;
+        size_t num_stolen_chunks = 0;
+
+        // first the own slice, then steal from the other slices 
+        for (size_t k = 0; k < chunks.num_slices; k++)
         {
-           bool res = computeNormal(i, start, end, pcl, kdtree, done, propagate, center);     
+            const size_t slice = (num_thread + k) % chunks.num_slices;
+            size_t begin = 0, end = 0;
+            while (chunks.next(slice, begin, end))
+            {
+                computeNormalsInRange(begin, end, pcl, kdtree, done, propagate, center, stats);
+                if (k > 0) num_stolen_chunks++;
+            }
         }
-#endif             
-        double tt = ztimer.measure();
-        ROS_INFO("NormalEstimationPcl::computeNormalsInRange: finished thread #%ld: computed %ld normals in %fs (%f normal/s), #isolated: %ld, #invalid: %ld", num_thread, num_computed_points, tt, num_computed_points / tt, num_isolated_points, num_invalid_normals);
+        
+        double tt = zone.elapsedSec();
+        ROS_INFO("NormalEstimationPcl::computeNormalsInChunks: finished thread #%ld: computed %ld normals in %fs (%f normal/s), #isolated: %ld, #invalid: %ld, #stolen chunks: %ld", num_thread, stats.num_computed_points, tt, stats.num_computed_points / tt, stats.num_isolated_points, stats.num_invalid_normals, num_stolen_chunks);
     }
     catch (boost::thread_interrupted&)
     {
-        ROS_INFO("NormalEstimationPcl::computeNormalsInRange: thread #%ld has been interrupted", num_thread);
+        ROS_INFO("NormalEstimationPcl::computeNormalsInChunks: thread #%ld has been interrupted", num_thread);
     }
 }
 
 template<typename PointT>
 void NormalEstimationPcl<PointT>::computeNormals(PointCloudT& pcl, KdTreeT& kdtree, const pcl::PointXYZ& center)
 {
+    computeNormals(pcl, kdtree, center, std::vector<char>());
+}
+
+template<typename PointT>
+void NormalEstimationPcl<PointT>::computeNormals(PointCloudT& pcl, KdTreeT& kdtree, const pcl::PointXYZ& center, const std::vector<char>& b_keep)
+{
+    PROFILE_ZONE("normals/compute_normals");
 
     addPointToLaserTraj(center, robot_id_);
     checkTeammatePositionsFromTransform();
@@ -407,7 +446,23 @@ void NormalEstimationPcl<PointT>::computeNormals(PointCloudT& pcl, KdTreeT& kdtr
     atom_bool_vec propagate(pcl.size()); 
     std::fill(propagate.begin(),propagate.end(),false);     
 
-    queue_.clear(); // used by direct propagation approach
+    queue_.reset(pcl.size()); // used by direct propagation approach
+
+    if (!b_keep.empty())
+    {
+        /// < the kept normals are already done and can be propagated as the computed ones 
+        for (size_t i = 0, iEnd = pcl.size(); i < iEnd; i++)
+        {
+            if (!b_keep[i]) continue;
+            done[i] = true;
+            const Eigen::Vector3f normal(pcl[i].normal[0], pcl[i].normal[1], pcl[i].normal[2]);
+            propagate[i] = (normal.dot(zAxis) > kMinCosToPropagate);
+        }
+        
+        // N.B.: the direction propagation would stop at the kept points: the new points are aligned to their kept neighbors instead 
+        computeNormalsStandard(pcl, kdtree, done, propagate, center);
+        return; /// < EXIT POINT
+    }
 
 #if USE_DIRECTION_PROPAGATION   
     
@@ -428,39 +483,32 @@ void NormalEstimationPcl<PointT>::computeNormalsStandard(PointCloudT& pcl, KdTre
     const size_t n = pcl.size();
     if (n > 0)
     {
-        if (config_.num_threads > 1)
+        const size_t num_threads = std::max(config_.num_threads, 1);
+        PointRangeChunks chunks(n, num_threads);
+        if (num_threads > 1)
         {
-            std::vector<boost::shared_ptr<boost::thread> > threads;
-            for (size_t num_thread = 0; num_thread < config_.num_threads; num_thread++)
+            std::vector<WorkerPool::Job> jobs;
+            for (size_t num_thread = 0; num_thread < num_threads; num_thread++)
             {
-                size_t begin = n * num_thread / config_.num_threads;
-                size_t end   = n * (num_thread + 1) / config_.num_threads;
-                threads.push_back(
-                                  boost::make_shared<boost::thread>(
+                jobs.push_back(
                                   boost::bind(
-                                              &NormalEstimationPcl::computeNormalsInRange,
+                                              &NormalEstimationPcl::computeNormalsInChunks,
                                               this,
                                               num_thread,
-                                              begin,
-                                              end,
+                                              boost::ref(chunks),
                                               boost::ref(pcl),
                                               boost::ref(kdtree),
                                               boost::ref(done),
                                               boost::ref(propagate),                        
                                               boost::cref(center)
                                               )
-                                  )
                                   );
             }
-
-            for (size_t num_thread = 0; num_thread < threads.size(); num_thread++)
-            {
-                threads[num_thread]->join();
-            }
+            getWorkerPool(num_threads).pushAndWait(jobs);
         }
         else
         {
-            computeNormalsInRange(0, 0, n, pcl, kdtree, done, propagate, center);
+            computeNormalsInChunks(0, chunks, pcl, kdtree, done, propagate, center);
         }
 
 #if LOG_NORMALS_STATISTICS
@@ -495,34 +543,40 @@ void NormalEstimationPcl<PointT>::computeNormalsStandard(PointCloudT& pcl, KdTre
 template<typename PointT>
 void NormalEstimationPcl<PointT>::computeNormalsInQueue(const size_t num_thread, const size_t start, const size_t end, PointCloudT& pcl, KdTreeT& kdtree, atom_bool_vec& done, atom_bool_vec& propagate, const pcl::PointXYZ& center)
 {
+    PROFILE_ZONE_NAMED(zone, "normals/thread_queue");
     size_t num_computed_points = 0;
-    ZTimer ztimer;    
+    ScanArena::Buffer<NeighborhoodScratch> scratch = arena_.get<NeighborhoodScratch>();
     
-    bool ok = true;
     size_t point_idx = 0;    
-    while(ok)
+    while(true)
     {
+        if(queue_.pop(point_idx))
         {
-        boost::recursive_mutex::scoped_lock locker(queue_mutex_);          
-        ok = !queue_.empty();
-        if(!ok) 
-        {    
-            double tt = ztimer.measure();
-            ROS_INFO("NormalEstimationPcl::computeNormalsInQueue: finished thread #%ld: computed %ld normals in %fs (%f normal/s)", num_thread, num_computed_points, tt, num_computed_points / tt);    
-            return; /// < EXIT 
+            const bool res = computeNormal(point_idx, start, end, pcl, kdtree, done, propagate, center, *scratch);    
+            if(res) num_computed_points++;
+            continue; /// < CONTINUE
         }
-        point_idx = queue_.front();
-        queue_.pop_front();     
+        
+        // the queue is empty: wait until either a busy worker pushes new points or all the workers are idle 
+        num_busy_workers_--;
+        while(queue_.empty())
+        {
+            if(num_busy_workers_ == 0)
+            {    
+                double tt = zone.stop();
+                ROS_INFO("NormalEstimationPcl::computeNormalsInQueue: finished thread #%ld: computed %ld normals in %fs (%f normal/s)", num_thread, num_computed_points, tt, num_computed_points / tt);    
+                return; /// < EXIT 
+            }
+            boost::this_thread::yield();
         }
-        const bool res = computeNormal(point_idx, start, end, pcl, kdtree, done, propagate, center);    
-        if(res) num_computed_points++;
+        num_busy_workers_++;
     } 
 }
 
 template<typename PointT>
 void NormalEstimationPcl<PointT>::computeNormalsByDirectionPropagation(PointCloudT& pcl, KdTreeT& kdtree, atom_bool_vec& done, atom_bool_vec& propagate, const pcl::PointXYZ& center)
 {    
-    ZTimer ztimer;
+    PROFILE_ZONE_NAMED(zone, "normals/direction_propagation");
     const size_t n = pcl.size();
     if (n > 0)
     {    
@@ -547,7 +601,7 @@ void NormalEstimationPcl<PointT>::computeNormalsByDirectionPropagation(PointClou
             if(found>0) 
             {
                 for(size_t j=0, jEnd=pointIdxSearch.size(); j < jEnd; j++)
-                    queue_.push_back(pointIdxSearch[j]); 
+                    queue_.push(pointIdxSearch[j]); 
             }
             else 
             {
@@ -558,11 +612,11 @@ void NormalEstimationPcl<PointT>::computeNormalsByDirectionPropagation(PointClou
         if (config_.num_threads == 1)
         {
             // mono-thread version 
-            while(!queue_.empty())
+            ScanArena::Buffer<NeighborhoodScratch> scratch = arena_.get<NeighborhoodScratch>();
+            size_t point_idx = 0;
+            while(queue_.pop(point_idx))
             {                
-                const size_t point_idx = queue_.front();
-                queue_.pop_front();
-                bool res = computeNormal(point_idx, 0, n, pcl, kdtree, done, propagate, center); 
+                bool res = computeNormal(point_idx, 0, n, pcl, kdtree, done, propagate, center, *scratch); 
             }
         }    
         else
@@ -570,11 +624,11 @@ void NormalEstimationPcl<PointT>::computeNormalsByDirectionPropagation(PointClou
             size_t begin = 0;
             size_t end   = n;                
 
-            std::vector<boost::shared_ptr<boost::thread> > threads;
+            num_busy_workers_ = config_.num_threads;
+            std::vector<WorkerPool::Job> jobs;
             for (size_t num_thread = 0; num_thread < config_.num_threads; num_thread++)
             {
-                threads.push_back(
-                                  boost::make_shared<boost::thread>(
+                jobs.push_back(
                                   boost::bind(
                                               &NormalEstimationPcl::computeNormalsInQueue,
                                               this,
@@ -587,14 +641,9 @@ void NormalEstimationPcl<PointT>::computeNormalsByDirectionPropagation(PointClou
                                               boost::ref(propagate),                        
                                               boost::cref(center)
                                               )
-                                  )
                                   );
             }
-
-            for (size_t num_thread = 0; num_thread < threads.size(); num_thread++)
-            {
-                threads[num_thread]->join();
-            }
+            getWorkerPool(config_.num_threads).pushAndWait(jobs);
         }      
 
         size_t num_done = 0;
@@ -629,7 +678,7 @@ void NormalEstimationPcl<PointT>::computeNormalsByDirectionPropagation(PointClou
         ROS_WARN("NormalEstimationPcl::computeNormalsByDirectionPropagation(): received empty point cloud");
     }
 
-    double tt = ztimer.measure();
+    double tt = zone.stop();
     ROS_INFO("NormalEstimationPcl::computeNormalsByDirectionPropagation(): computed %ld normals in %fs (%f normal/s)", n, tt, n / tt);   
 }
 
@@ -766,6 +815,139 @@ void NormalEstimationPcl<PointT>::checkTeammatePositionsFromTransform()
     }
 }
     
+template<typename PointT>
+void NormalEstimationPcl<PointT>::computeNormalsIncremental(const typename PointCloudT::Ptr& p_pcl, const pcl::PointXYZ& center)
+{
+    PROFILE_ZONE_NAMED(zone, "normals/compute_normals_incremental");
+    PointCloudT& pcl = *p_pcl;
+    const size_t n = pcl.size();
+    
+    ScanArena::Buffer<std::vector<uint64_t> > point_keys_buffer = arena_.getVector<uint64_t>(n);
+    std::vector<uint64_t>& point_keys = *point_keys_buffer;
+    for (size_t i = 0; i < n; i++)
+    {
+        point_keys[i] = voxelBinaryKey(pcl[i], kIncrementalKeyLeafSize);
+    }
+    
+    if (b_reset_incremental_ || prev_pcl_.empty())
+    {
+        ROS_INFO("NormalEstimationPcl::computeNormalsIncremental(): computing all the normals");
+        KdTreeT kdtree;
+        kdtree.setInputCloud(p_pcl);
+        computeNormals(pcl, kdtree, center);
+    }
+    else
+    {
+        /// < mark the cells around the points which have been added or removed since the last update 
+        // a point whose neighborhood (radius) contains a changed point lies in one of the 27 cells (of size radius) around it, 
+        // and the neighbors of such a point lie in one of the 125 cells around the changed point  
+        const double cell_size = config_.radius; 
+        std::unordered_set<uint64_t> dirty_cells, support_cells;
+        size_t num_changed_points = 0;
+        
+        const std::unordered_set<uint64_t> new_keys(point_keys.begin(), point_keys.end());
+        for (size_t j = 0, jEnd = prev_pcl_.size(); j < jEnd; j++)
+        {
+            if (new_keys.count(prev_point_keys_[j])) continue; 
+            markNeighborCells(prev_pcl_[j], cell_size, 1, dirty_cells); // removed point
+            markNeighborCells(prev_pcl_[j], cell_size, 2, support_cells); 
+            num_changed_points++;
+        }
+        
+        std::unordered_map<uint64_t, size_t> old_index; 
+        old_index.reserve(prev_pcl_.size());
+        for (size_t j = 0, jEnd = prev_pcl_.size(); j < jEnd; j++)
+        {
+            old_index[prev_point_keys_[j]] = j;
+        }
+        
+        ScanArena::Buffer<std::vector<size_t> > local_index_buffer = arena_.getVector<size_t>(0);
+        ScanArena::Buffer<std::vector<char> > b_keep_buffer = arena_.getVector<char>(0);
+        std::vector<size_t>& local_index = *local_index_buffer; // points of the local region: the dirty points and their neighbors 
+        std::vector<char>& b_keep = *b_keep_buffer; 
+        for (size_t i = 0; i < n; i++)
+        {
+            std::unordered_map<uint64_t, size_t>::const_iterator it = old_index.find(point_keys[i]);
+            if (it == old_index.end())
+            {
+                markNeighborCells(pcl[i], cell_size, 1, dirty_cells); // added point
+                markNeighborCells(pcl[i], cell_size, 2, support_cells); 
+                num_changed_points++;
+            }
+            else
+            {
+                // keep the previous normal (it is recomputed below if the point is dirty)
+                const PointT& old_point = prev_pcl_[it->second];
+                pcl[i].normal[0] = old_point.normal[0];
+                pcl[i].normal[1] = old_point.normal[1];
+                pcl[i].normal[2] = old_point.normal[2];
+            }
+        }
+        
+        if (num_changed_points > 0)
+        {
+            typename PointCloudT::Ptr p_local_pcl = boost::make_shared<PointCloudT>();
+            for (size_t i = 0; i < n; i++)
+            {
+                const uint64_t cell_key = voxelBinaryKey(pcl[i], cell_size);
+                if (!support_cells.count(cell_key)) continue; 
+                local_index.push_back(i);
+                p_local_pcl->push_back(pcl[i]);
+                b_keep.push_back(dirty_cells.count(cell_key) ? 0 : 1);
+            }
+            
+            KdTreeT kdtree;
+            kdtree.setInputCloud(p_local_pcl);
+            computeNormals(*p_local_pcl, kdtree, center, b_keep);
+            
+            for (size_t k = 0, kEnd = local_index.size(); k < kEnd; k++)
+            {
+                if (b_keep[k]) continue;
+                PointT& point = pcl[local_index[k]];
+                point.normal[0] = (*p_local_pcl)[k].normal[0];
+                point.normal[1] = (*p_local_pcl)[k].normal[1];
+                point.normal[2] = (*p_local_pcl)[k].normal[2];
+            }
+        }
+        
+        const size_t num_recomputed = std::count(b_keep.begin(), b_keep.end(), 0);
+        ROS_INFO("NormalEstimationPcl::computeNormalsIncremental(): changed points: %ld, recomputed normals: %ld, local region: %ld points (over %ld)", num_changed_points, num_recomputed, local_index.size(), n);
+    }
+    
+    prev_pcl_ = pcl; 
+    prev_point_keys_.swap(point_keys);
+    b_reset_incremental_ = false;
+    
+    double tt = zone.stop();
+    ROS_INFO("NormalEstimationPcl::computeNormalsIncremental(): updated %ld normals in %fs", n, tt);   
+}
+
+template<typename PointT>
+void NormalEstimationPcl<PointT>::markNeighborCells(const PointT& point, const double cell_size, const int range, std::unordered_set<uint64_t>& cells)
+{
+    pcl::PointXYZ p;
+    for (int dx = -range; dx <= range; dx++)
+        for (int dy = -range; dy <= range; dy++)
+            for (int dz = -range; dz <= range; dz++)
+            {
+                p.x = point.x + dx*cell_size;
+                p.y = point.y + dy*cell_size;
+                p.z = point.z + dz*cell_size;
+                cells.insert(voxelBinaryKey(p, cell_size));
+            }
+}
+
+template<typename PointT>
+WorkerPool& NormalEstimationPcl<PointT>::getWorkerPool(const int num_threads)
+{
+    if (!p_worker_pool_ || (p_worker_pool_->getNumWorkers() != num_threads))
+    {
+        ROS_INFO("NormalEstimationPcl::getWorkerPool(): creating a pool of %d workers", num_threads);
+        p_worker_pool_.reset(new WorkerPool(num_threads));
+    }
+    return *p_worker_pool_;
+}
+
 template class NormalEstimationPcl<pcl::PointNormal>;
 template class NormalEstimationPcl<pcl::PointXYZINormal>;
 template class NormalEstimationPcl<pcl::PointXYZRGBNormal>;
@@ -0,0 +1,183 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "PathCache.h"
+
+#include <cmath>
+#include <limits>
+#include <unordered_set>
+#include <iostream>
+
+#include "VoxelBinaryKey.h"
+
+
+const size_t PathCache::kDefaultCapacity = 128;
+const double PathCache::kNodeKeyLeafSize = 0.01; // [m] much smaller than the map resolution
+const double PathCache::kInvalidationCellSize = 0.5; // [m] larger than PathPlanner::kMaxRobotStep
+const float PathCache::kTravChangeThreshold = 1e-3;
+
+void PathCache::setCapacity(size_t capacity)
+{
+    boost::mutex::scoped_lock locker(mutex_);
+
+    capacity_ = capacity;
+    while (entries_.size() > capacity_)
+    {
+        index_.erase(entries_.back().key);
+        entries_.pop_back();
+    }
+}
+
+bool PathCache::get(const Key& key, nav_msgs::Path& path, double& path_cost)
+{
+    boost::mutex::scoped_lock locker(mutex_);
+
+    EntryIndex::iterator it = index_.find(key);
+    if (it == index_.end())
+    {
+        num_misses_++;
+        return false; /// < EXIT POINT
+    }
+
+    entries_.splice(entries_.begin(), entries_, it->second); // now the most recently used
+    path = it->second->path;
+    path_cost = it->second->path_cost;
+    num_hits_++;
+    return true;
+}
+
+void PathCache::put(const Key& key, const nav_msgs::Path& path, double path_cost)
+{
+    boost::mutex::scoped_lock locker(mutex_);
+
+    if (capacity_ == 0) return; /// < EXIT POINT
+
+    EntryIndex::iterator it = index_.find(key);
+    if (it != index_.end())
+    {
+        entries_.erase(it->second);
+        index_.erase(it);
+    }
+
+    Entry entry;
+    entry.key = key;
+    entry.path = path;
+    entry.path_cost = path_cost;
+    entries_.push_front(entry);
+    index_[key] = entries_.begin();
+
+    while (entries_.size() > capacity_)
+    {
+        index_.erase(entries_.back().key);
+        entries_.pop_back();
+    }
+}
+
+void PathCache::updateMap(uint64_t new_map_version, const pcl::PointCloud<pcl::PointXYZI>& old_pcl, const pcl::PointCloud<pcl::PointXYZI>& new_pcl)
+{
+    boost::mutex::scoped_lock locker(mutex_);
+
+    if (entries_.empty()) return; /// < EXIT POINT
+
+    /// < collect the cells of the changed points
+    std::unordered_map<uint64_t, float> old_points;
+    old_points.reserve(old_pcl.size());
+    for (size_t i = 0; i < old_pcl.size(); i++)
+    {
+        old_points[voxelBinaryKey(old_pcl[i], kNodeKeyLeafSize)] = old_pcl[i].intensity;
+    }
+
+    std::unordered_set<uint64_t> changed_cells;
+    for (size_t i = 0; i < new_pcl.size(); i++)
+    {
+        const pcl::PointXYZI& p = new_pcl[i];
+        std::unordered_map<uint64_t, float>::iterator it = old_points.find(voxelBinaryKey(p, kNodeKeyLeafSize));
+        bool b_changed = (it == old_points.end());
+        if (!b_changed)
+        {
+            const bool is_finite_new = p.intensity < std::numeric_limits<float>::infinity();
+            const bool is_finite_old = it->second < std::numeric_limits<float>::infinity();
+            b_changed = (is_finite_new != is_finite_old) || (is_finite_new && (fabs(p.intensity - it->second) > kTravChangeThreshold));
+            old_points.erase(it); // the remaining old points are the removed ones
+        }
+        if (b_changed) changed_cells.insert(voxelBinaryKey(p, kInvalidationCellSize));
+    }
+    for (size_t i = 0; i < old_pcl.size(); i++)
+    {
+        const pcl::PointXYZI& p = old_pcl[i];
+        if (old_points.count(voxelBinaryKey(p, kNodeKeyLeafSize))) changed_cells.insert(voxelBinaryKey(p, kInvalidationCellSize));
+    }
+
+    /// < check the paths against the changed cells (and their neighbors)
+    size_t num_removed = 0;
+    index_.clear();
+    for (EntryList::iterator it = entries_.begin(); it != entries_.end(); )
+    {
+        bool b_valid = true;
+        const std::vector<geometry_msgs::PoseStamped>& poses = it->path.poses;
+        for (size_t i = 0; b_valid && (!changed_cells.empty()) && (i < poses.size()); i++)
+        {
+            pcl::PointXYZI p;
+            for (int dx = -1; b_valid && (dx <= 1); dx++)
+                for (int dy = -1; b_valid && (dy <= 1); dy++)
+                    for (int dz = -1; b_valid && (dz <= 1); dz++)
+                    {
+                        p.x = poses[i].pose.position.x + dx*kInvalidationCellSize;
+                        p.y = poses[i].pose.position.y + dy*kInvalidationCellSize;
+                        p.z = poses[i].pose.position.z + dz*kInvalidationCellSize;
+                        if (changed_cells.count(voxelBinaryKey(p, kInvalidationCellSize))) b_valid = false;
+                    }
+        }
+
+        if (b_valid)
+        {
+            it->key.map_version = new_map_version;
+            index_[it->key] = it;
+            ++it;
+        }
+        else
+        {
+            it = entries_.erase(it);
+            num_removed++;
+        }
+    }
+
+    std::cout << "PathCache::updateMap() - changed cells: " << changed_cells.size() << ", removed entries: " << num_removed << ", kept entries: " << entries_.size() << std::endl;
+}
+
+void PathCache::clear()
+{
+    boost::mutex::scoped_lock locker(mutex_);
+
+    entries_.clear();
+    index_.clear();
+}
+
+size_t PathCache::size()
+{
+    boost::mutex::scoped_lock locker(mutex_);
+
+    return entries_.size();
+}
+
+uint64_t PathCache::getNodeKey(const pcl::PointXYZI& point)
+{
+    return voxelBinaryKey(point, kNodeKeyLeafSize);
+}
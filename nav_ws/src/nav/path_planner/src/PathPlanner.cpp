@@ -20,6 +20,7 @@
 
 #include "PathPlanner.h"
 #include "TravAnalyzer.h"
+#include <mr3d_profiling/Profiler.h>
 
 #include <limits>       // std::numeric_limits
 
@@ -45,8 +46,14 @@ const float PathPlanner::kMinNeighborsRadius = 0.1; // minimum radius where to s
 const float PathPlanner::kMaxRobotStep = 0.4; // maximum radius where to search neighbors during each node expansion 
 const float PathPlanner::kMaxRobotStepDeltaZ = 0.2; // 0.2
 
+const unsigned int PathPlanner::kDefaultRandomSeed = 1; // same as the default seed of rand()
+
 const double PathPlanner::kPathSmoothingKernel3[3] = {0.3, 0.4, 0.3};
 
+const double PathPlanner::kDefaultAnytimeRepublishPeriodSec = 1.0; // [s]
+
+const double PathPlanner::kDefaultNominalSpeed = 0.3; // [m/s]
+
 PathPlanner::PathPlanner(ros::NodeHandle n_in)
 {
     initVars();
@@ -65,18 +72,57 @@ PathPlanner::PathPlanner()
     setPublishers();
 }
 
+PathPlanner::PathPlanner(bool b_publish)
+{
+    initVars();
+
+    if (b_publish) setPublishers();
+}
+
 // initialize the vars 
 
 void PathPlanner::initVars()
 {
     count_ = 0;
-    n_ = ros::NodeHandle("~");
 
     b_abort_ = false;
     b_utility_2d_available_ = false;
 
+    pcl_traversability_.reset(new pcl::PointCloud<pcl::PointXYZI>);
+    pcl_wall_.reset(new pcl::PointCloud<pcl::PointXYZRGBNormal>);
+    pcl_utility_2d_.reset(new pcl::PointCloud<pcl::PointXYZI>);
+
     /// < set the default cost function 
     p_cost_.reset(new SimpleCostFunction());
+    
+    /// < set the default open set 
+    open_set_type_ = kOpenSetBinaryHeap;
+    open_set_bucket_resolution_ = BucketQueue::kDefaultResolution;
+    p_leaf_nodes_.reset(createOpenSet());
+    
+    /// < set the sample generator 
+    random_seed_ = kDefaultRandomSeed;
+    random_generator_.seed(random_seed_);
+    uniform_distribution_ = std::uniform_real_distribution<float>(0.f, 1.f);
+    
+    /// < bidirectional search (disabled by default)
+    goal_point_idx_ = -1;
+    b_bidirectional_search_ = false;
+    b_bidirectional_running_ = false;
+    b_backward_tree_active_ = false;
+    b_trees_met_ = false;
+    meeting_node_idx_ = 0;
+    meeting_point_idx_ = -1;
+    
+    /// < any-time mode (disabled by default)
+    anytime_time_budget_sec_ = 0;
+    anytime_republish_period_sec_ = kDefaultAnytimeRepublishPeriodSec;
+    
+    /// < reservation table (disabled by default)
+    reservation_robot_id_ = 0;
+    lambda_reservation_ = BaseCostFunction::kLamdaReservationDefault;
+    nominal_speed_ = kDefaultNominalSpeed;
+    reservation_start_time_ = 0;
 }
 
 /// < DESTRUCTOR
@@ -102,7 +148,8 @@ PathPlanner::~PathPlanner()
 
 void PathPlanner::setPublishers()
 {
-    markerArrPub_ = n_.advertise<visualization_msgs::MarkerArray>("/path_planner/visited_nodes", 1);
+    n_ = ros::NodeHandle("~");
+    p_marker_publisher_.reset(new SearchTreeMarkerPublisher(n_, "/path_planner/visited_nodes"));
     localPathPub_ = n_.advertise<nav_msgs::Path>("/path_planner/localPath", 1);
 }
 
@@ -111,6 +158,11 @@ bool sortProbFunction(const PathPlanner::IdxProbability& i, const PathPlanner::I
     return (i.probability < j.probability);
 }
 
+bool lowerProbFunction(const PathPlanner::IdxProbability& i, const float prob)
+{
+    return (i.probability < prob);
+}
+
 void PathPlanner::filterNeighborhoodByDz(const pcl::PointCloud<pcl::PointXYZI>& pcl_trav, const pcl::PointXYZI& p, const double deltaZ, std::vector<int>& pointIdx, std::vector<float>& pointSquaredDistance)
 {
     std::vector<float>::iterator it_dist = pointSquaredDistance.begin();
@@ -132,28 +184,28 @@ void PathPlanner::filterNeighborhoodByDz(const pcl::PointCloud<pcl::PointXYZI>&
     }
 }
 
-//Create the neighborhood for the current node and the probability associate with each neighbor
-void PathPlanner::findNeighbors(std::vector<IdxProbability>& neighbors, double& radius)
+// Find the expansion neighbors of the input point: the traversability points within radius = min(wall distance, kMaxRobotStep) and kMaxRobotStepDeltaZ
+int PathPlanner::findPointNeighbors(int point_idx, double& radius, std::vector<int>& pointIdxRadiusSearch, std::vector<float>& pointRadiusSquaredDistance)
 {
     /// < Find the nearest point labeled as wall and set the search radius according to this distance
     std::vector<int> pointIdxNKNSearch(1);
     std::vector<float> pointNKNSquaredDistance(1, std::numeric_limits<float>::max());
-    const pcl::PointXYZI& point_noWall = pcl_traversability_[nodes_[current_node_idx_].point_idx];
+    const pcl::PointXYZI& point_noWall = (*pcl_traversability_)[point_idx];
     pcl::PointXYZRGBNormal point_noWall_RGBN;
     point_noWall_RGBN.x = point_noWall.x;
     point_noWall_RGBN.y = point_noWall.y;
     point_noWall_RGBN.z = point_noWall.z;
 
     /// < NOTE: This function returns squared distances
-    int num_wall_neighbors = kdtree_wall_.nearestKSearch(point_noWall_RGBN, 1, pointIdxNKNSearch, pointNKNSquaredDistance);
+    int num_wall_neighbors = p_kdtree_wall_->nearestKSearch(point_noWall_RGBN, 1, pointIdxNKNSearch, pointNKNSquaredDistance);
     if (num_wall_neighbors < 1)
     {
         ROS_WARN("could not find wall neighbors");
     }
     /*double checkradius = sqrt(pointNKNSquaredDistance[0]);
-    if( fabs(checkradius-dist(point_wall,pcl_wall_.points[pointIdxNKNSearch[0]])) > 1e-6) 
+    if( fabs(checkradius-dist(point_wall,pcl_wall_->points[pointIdxNKNSearch[0]])) > 1e-6) 
     {
-        std::cout << "PathPlanner::findNeighbors() - error - radius: " << checkradius << ", dist: " << dist(point_wall,pcl_wall_.points[pointIdxNKNSearch[0]]) << std::endl;
+        std::cout << "PathPlanner::findNeighbors() - error - radius: " << checkradius << ", dist: " << dist(point_wall,pcl_wall_->points[pointIdxNKNSearch[0]]) << std::endl;
         quick_exit(-1);
     }*/
 
@@ -167,16 +219,25 @@ void PathPlanner::findNeighbors(std::vector<IdxProbability>& neighbors, double&
 
 #ifdef VERBOSE2    
     ROS_INFO("PathPlanner::findNeighbors() - radius: %f", radius);
-    std::cout << "PathPlanner::find_neighbors() - current point : " << pcl_traversability_[nodes_[current_node_idx_].point_idx] << ", radius " << radius << std::endl;
+    std::cout << "PathPlanner::find_neighbors() - current point : " << point_noWall << ", radius " << radius << std::endl;
 #endif
 
-    /// < Find traversability neighbors of the current node within radius search
-    std::vector<int> pointIdxRadiusSearch;
-    std::vector<float> pointRadiusSquaredDistance;
-    int num_close_points = kdtree_traversability_.radiusSearch(point_noWall, radius, pointIdxRadiusSearch, pointRadiusSquaredDistance);
+    /// < Find traversability neighbors of the point within radius search
+    pointIdxRadiusSearch.clear();
+    pointRadiusSquaredDistance.clear();
+    int num_close_points = 0;
+    if (p_neighborhood_graph_)
+    {
+        // the graph neighbors are already filtered by Dz and sorted by distance: just take the ones within radius
+        num_close_points = p_neighborhood_graph_->radiusNeighbors(point_idx, radius, pointIdxRadiusSearch, pointRadiusSquaredDistance);
+    }
+    else
+    {
+        num_close_points = p_kdtree_traversability_->radiusSearch(point_noWall, radius, pointIdxRadiusSearch, pointRadiusSquaredDistance);
 
-    // eliminate points which have Dz w.r.t. point_noWall higher than kMaxRobotStepDeltaZ
-    filterNeighborhoodByDz(pcl_traversability_, point_noWall, kMaxRobotStepDeltaZ, pointIdxRadiusSearch, pointRadiusSquaredDistance);
+        // eliminate points which have Dz w.r.t. point_noWall higher than kMaxRobotStepDeltaZ
+        filterNeighborhoodByDz(*pcl_traversability_, point_noWall, kMaxRobotStepDeltaZ, pointIdxRadiusSearch, pointRadiusSquaredDistance);
+    }
 
 #ifdef VERBOSE2     
     std::cout << "PathPlanner::find_neighbors() - num_close_points : " << num_close_points << std::endl;
@@ -186,14 +247,22 @@ void PathPlanner::findNeighbors(std::vector<IdxProbability>& neighbors, double&
         ROS_WARN("could not find point close to current node");
     }
 
+    return num_close_points;
+}
 
+//Create the neighborhood for the current node and the probability associate with each neighbor
+void PathPlanner::findNeighbors(std::vector<IdxProbability>& neighbors, double& radius)
+{
+    std::vector<int> pointIdxRadiusSearch;
+    std::vector<float> pointRadiusSquaredDistance;
+    findPointNeighbors(nodes_.point_idx[current_node_idx_], radius, pointIdxRadiusSearch, pointRadiusSquaredDistance);
 
     /// < Extract the traversability neighbors and compute probability associated with each point
     /// < Point with low cost will have higher probability	  
     float normalization_factor = 0;
     for (size_t i = 0, iEnd = pointIdxRadiusSearch.size(); i < iEnd; i++)
     {
-        if (dist(pcl_traversability_[pointIdxRadiusSearch[i]], goal_) < 0.1 * kGoalPlanningCheckThreshold) // we want to be more precise in the expansion
+        if (dist((*pcl_traversability_)[pointIdxRadiusSearch[i]], goal_) < 0.1 * kGoalPlanningCheckThreshold) // we want to be more precise in the expansion
         {
 #ifdef VERBOSE
             std::cout << "PathPlanner::find_neighbors() - found point close to goal" << std::endl;
@@ -207,10 +276,10 @@ void PathPlanner::findNeighbors(std::vector<IdxProbability>& neighbors, double&
             normalization_factor = 1;
             break;
         }
-        else if (pcl_traversability_[pointIdxRadiusSearch[i]].intensity < std::numeric_limits<double>::infinity())
+        else if ((*pcl_traversability_)[pointIdxRadiusSearch[i]].intensity < std::numeric_limits<double>::infinity())
         {
 #if ENABLE_TRAVERSABILITY_BIAS_IN_RANDOM_SAMPLE_GENERATOR            
-            float prob = 1 / pcl_traversability_[pointIdxRadiusSearch[i]].intensity;
+            float prob = 1 / (*pcl_traversability_)[pointIdxRadiusSearch[i]].intensity;
 #else
             float prob = 1.f;
 #endif
@@ -259,7 +328,7 @@ bool PathPlanner::visitedPoint(size_t pointIdx)
     //            return true;
     //    }
     //    return false;
-    return visited_points_flag_[pointIdx];
+    return visited_points_flag_.test(pointIdx);
 }
 
 //Sample the followers from the current point p
@@ -270,6 +339,34 @@ void PathPlanner::sampleFollowers()
     double radius;
     findNeighbors(neighbors, radius);
 
+    // score all the neighbors at once (the cost function can vectorize the computation)
+    const pcl::PointXYZI& current_point = (*pcl_traversability_)[nodes_.point_idx[current_node_idx_]];
+    const float current_length = nodes_.length[current_node_idx_];
+    cost_batch_.resize(neighbors.size());
+    for (size_t i = 0; i < neighbors.size(); i++)
+    {
+        const pcl::PointXYZI& point = (*pcl_traversability_)[neighbors[i].point_idx];
+        cost_batch_.arrival_time[i] = reservation_start_time_ + (current_length + dist(current_point, point))/nominal_speed_;
+        cost_batch_.x[i] = point.x;
+        cost_batch_.y[i] = point.y;
+        cost_batch_.z[i] = point.z;
+        cost_batch_.traversability[i] = point.intensity;
+        if (b_utility_2d_available_)
+        {
+            cost_batch_.aux_utility[i] = (*pcl_utility_2d_)[neighbors[i].point_idx].z;
+            cost_batch_.aux_conf[i] = (*pcl_utility_2d_)[neighbors[i].point_idx].intensity;
+        }
+        else
+        {
+            cost_batch_.aux_utility[i] = 0.f;
+            cost_batch_.aux_conf[i] = 1.f;
+        }
+    }
+    if (!neighbors.empty()) p_cost_->costBatch(current_point, goal_, cost_batch_);
+    
+    // the arrival times of the backward tree of the bidirectional search are unknown: only the forward tree uses the reservations 
+    if (!neighbors.empty() && !b_backward_tree_active_) p_cost_->applyReservationCost(cost_batch_);
+
     //Sample the child from the neighbors if the neighbors are more then a threshold, else use all the neighbors
     int num_generated_followers = 0;
     int num_random_samples = 0;
@@ -277,71 +374,45 @@ void PathPlanner::sampleFollowers()
     double w = std::min(weight(radius), 1.d);
     int weighted_neighbors_size = lrint(w * neighbors.size());
     
-    bool b_publish_markers = markerArrPub_.getNumSubscribers()>0;
+    const bool b_publish_markers = p_marker_publisher_ && p_marker_publisher_->isActive();
     
     while ((num_generated_followers < weighted_neighbors_size) && (num_random_samples < neighbors.size()))
     {
-        // Generate a random sample by using traversability-based probability 
-        float r = ((double) rand() / (RAND_MAX));
-        int i = 0;
-        while (neighbors[i].probability < r)
+        // Generate a random sample by using traversability-based probability: 
+        // binary search of the first neighbor whose cumulative probability is not lower than r
+        const float r = uniform_distribution_(random_generator_);
+        const int i = std::min((int)(std::lower_bound(neighbors.begin(), neighbors.end(), r, lowerProbFunction) - neighbors.begin()), (int)neighbors.size() - 1);
+        num_random_samples++;
+
+        if (b_bidirectional_running_ && other_tree_.visited_points_flag.test(neighbors[i].point_idx))
         {
-            i++;
+            // the two trees met: the path is closed through this point 
+            b_trees_met_ = true;
+            meeting_node_idx_ = current_node_idx_;
+            meeting_point_idx_ = neighbors[i].point_idx;
+            break;
         }
-        num_random_samples++;
 
         if (!visitedPoint(neighbors[i].point_idx))
         {
             // Create new child
-            PointPlanning child;
-
-            child.id = nodes_.size();
-
+            //double heuristic = dist(pcl_traversability_->points[neighbors[i].point_idx], goal_); // A* heuristic             
+            //child.cost = dist((*pcl_traversability_)[nodes_.point_idx[current_node_idx_]], (*pcl_traversability_)[neighbors[i].point_idx])
+            //        + (*pcl_traversability_)[neighbors[i].point_idx].intensity + heuristic;
 
-            //double heuristic = dist(pcl_traversability_.points[neighbors[i].point_idx], goal_); // A* heuristic             
-            //child.cost = dist(pcl_traversability_[nodes_[current_node_idx_].point_idx], pcl_traversability_[neighbors[i].point_idx])
-            //        + pcl_traversability_[neighbors[i].point_idx].intensity + heuristic;
-
-            double aux_2d_cost = 0.;
-            double aux_2d_confidence = 1.;
-            if (!pcl_utility_2d_.empty())
-            {
-                aux_2d_cost = pcl_utility_2d_[neighbors[i].point_idx].z;
-                aux_2d_confidence = pcl_utility_2d_[neighbors[i].point_idx].intensity;
-            }
             //double cost(const pcl::PointXYZI& current, const pcl::PointXYZI& next, const pcl::PointXYZI& goal, double traversability, double aux_utility = 0, double aux_conf = 0)    
-            child.cost = p_cost_->cost(pcl_traversability_[nodes_[current_node_idx_].point_idx], pcl_traversability_[neighbors[i].point_idx], goal_, pcl_traversability_[neighbors[i].point_idx].intensity, aux_2d_cost, aux_2d_confidence);
-
-            child.parent_id = current_node_idx_;
-            child.point_idx = neighbors[i].point_idx;
-            nodes_[current_node_idx_].child_id.push_back(child.id);
-            nodes_.push_back(child);
+            const double child_cost = cost_batch_.cost[i];
+            const float child_length = current_length + dist(current_point, (*pcl_traversability_)[neighbors[i].point_idx]);
+            const size_t child_id = nodes_.push(current_node_idx_, neighbors[i].point_idx, child_cost, child_length);
 
-            leaf_nodes_idxs_.push_back(child.id);
+            p_leaf_nodes_->push(child_id, child_cost);
 #ifndef NO_OLD_VISITED_STRUCT            
-            visited_nodes_idxs_.push_back(child.id);
+            visited_nodes_idxs_.push_back(child_id);
 #endif
-            visited_points_flag_[child.point_idx] = true;
+            visited_points_flag_.set(neighbors[i].point_idx);
 
-            if(b_publish_markers)
-            {
-                visualization_msgs::Marker marker;
-                marker.header.frame_id = "map";
-                marker.header.stamp = ros::Time::now();
-                marker.type = visualization_msgs::Marker::SPHERE;
-                marker.action = visualization_msgs::Marker::ADD;
-                marker.scale.x = marker.scale.y = marker.scale.z = 0.05;
-                marker.color.a = 1.0;
-                marker.color.r = 0.0;
-                marker.color.g = 0.0;
-                marker.color.b = 1.0;
-                marker.pose.position.x = pcl_traversability_[neighbors[i].point_idx].x;
-                marker.pose.position.y = pcl_traversability_[neighbors[i].point_idx].y;
-                marker.pose.position.z = pcl_traversability_[neighbors[i].point_idx].z;
-                marker.lifetime = ros::Duration(5);
-                marker.id = markerArr_.markers.size() + 1;
-                markerArr_.markers.push_back(marker);
-            }
+            // snapshot the node for the marker publisher thread (lock-free, it does not wait for ROS)
+            if(b_publish_markers) p_marker_publisher_->push((*pcl_traversability_)[neighbors[i].point_idx]);
             
             num_generated_followers++;
             
@@ -355,48 +426,23 @@ void PathPlanner::sampleFollowers()
     std::cout << "PathPlanner::sample_followers() - num_generated_followers : " << num_generated_followers << std::endl;
 #endif
 
-    // Remove current node from leaf nodes structure
-    for (std::vector<size_t>::iterator it = leaf_nodes_idxs_.begin(), itEnd = leaf_nodes_idxs_.end(); it != itEnd; ++it)
-    {
-        if (*it == current_node_idx_)
-        {
-            std::swap(*it, leaf_nodes_idxs_.back());
-            leaf_nodes_idxs_.pop_back(); // no problem with invalidation of begin()-end() since we exit from the loop!
-            break; // exit from loop!
-        }
-    }
+    // N.B.: the current node has been already removed from the leaf nodes structure by findNextNode()
 
 #ifdef VERBOSE2  
-    ROS_INFO("num visited nodes: %ld", markerArr_.markers.size());
+    ROS_INFO("num visited nodes: %ld", nodes_.size());
 #ifndef NO_OLD_VISITED_STRUCT 
     ROS_INFO("num leaf nodes: %ld", visited_nodes_idxs_.size());
 #endif
 #endif
 
-    if(b_publish_markers) markerArrPub_.publish(markerArr_);
-
     //Add the current point to the path
 }
 
-//Find the best node from all the leaf node
+//Find the best node from all the leaf node and remove it from the leaf nodes structure 
 bool PathPlanner::findNextNode()
 {
-    //double minCost = INFINITY;
-    double minCost = std::numeric_limits<double>::max();
-
     size_t minCostNodeIdx = 0;
-    bool b_found = false;
-
-    //Find the best expansion within the leaf nodes.
-    for (std::vector<size_t>::iterator it = leaf_nodes_idxs_.begin(); it != leaf_nodes_idxs_.end(); ++it)
-    {
-        if (nodes_[*it].cost < minCost)
-        {
-            minCost = nodes_[*it].cost;
-            minCostNodeIdx = *it;
-            b_found = true;
-        }
-    }
+    bool b_found = p_leaf_nodes_->pop(minCostNodeIdx);
 
     if (b_found)
     {
@@ -407,69 +453,102 @@ bool PathPlanner::findNextNode()
 
 void PathPlanner::setInput(pcl::PointCloud<pcl::PointXYZI>& traversability_pcl_in, pcl::PointCloud<pcl::PointXYZRGBNormal>& wall_pcl_in,
                            pp::KdTreeFLANN<pcl::PointXYZRGBNormal>& wall_kdtree_in, KdTreeFLANN& traversability_kdtree_in, int start_point_idx_in)
+{
+    // legacy interface: deep copy the input into new shared snapshots 
+    pcl::PointCloud<pcl::PointXYZI>::ConstPtr p_traversability_pcl(new pcl::PointCloud<pcl::PointXYZI>(traversability_pcl_in));
+    pcl::PointCloud<pcl::PointXYZRGBNormal>::ConstPtr p_wall_pcl(new pcl::PointCloud<pcl::PointXYZRGBNormal>(wall_pcl_in));
+    WallKdTreeFLANNConstPtr p_wall_kdtree(new WallKdTreeFLANN(wall_kdtree_in));
+    KdTreeFLANNConstPtr p_traversability_kdtree(new KdTreeFLANN(traversability_kdtree_in));
+    
+    setInput(p_traversability_pcl, p_wall_pcl, p_wall_kdtree, p_traversability_kdtree, start_point_idx_in);
+}
+
+void PathPlanner::setInput(const pcl::PointCloud<pcl::PointXYZI>::ConstPtr& traversability_pcl_in, const pcl::PointCloud<pcl::PointXYZRGBNormal>::ConstPtr& wall_pcl_in,
+                           const WallKdTreeFLANNConstPtr& wall_kdtree_in, const KdTreeFLANNConstPtr& traversability_kdtree_in, int start_point_idx_in)
 {
     boost::recursive_mutex::scoped_lock locker(interaction_mutex);
 
     b_utility_2d_available_ = false; // reset the utility function, we are required to add new information synched with traversability cloud 
+    pcl_utility_2d_.reset(new pcl::PointCloud<pcl::PointXYZI>); // release the previous snapshot
 
-    std::cout << "PathPlanner::setInput() - traversability pcl size: " << traversability_pcl_in.size() << std::endl;
+    std::cout << "PathPlanner::setInput() - traversability pcl size: " << traversability_pcl_in->size() << std::endl;
 
+    // N.B.: no copy here, we just share the (immutable) input snapshots 
     pcl_traversability_ = traversability_pcl_in;
 
-    computeIMinMaxRange(pcl_traversability_, p_cost_->GetMinTrav(), p_cost_->GetMaxTrav(), p_cost_->GetRangeTrav());
+    computeIMinMaxRange(*pcl_traversability_, p_cost_->GetMinTrav(), p_cost_->GetMaxTrav(), p_cost_->GetRangeTrav());
 
     pcl_wall_ = wall_pcl_in;
 
-    kdtree_wall_ = wall_kdtree_in;
-    kdtree_traversability_ = traversability_kdtree_in;
+    p_kdtree_wall_ = wall_kdtree_in;
+    p_kdtree_traversability_ = traversability_kdtree_in;
+    p_neighborhood_graph_.reset(); // a graph must be set again for the new input (see setNeighborhoodGraph())
 
     start_point_idx_ = start_point_idx_in;
 
     // clear the nodes and set the actual robot position as start 
-    nodes_.clear();
-    PointPlanning node;
-    node.id = nodes_.size();
-    node.cost = 0;
-    node.parent_id = 0; //node.id;
-    node.point_idx = start_point_idx_;
-    current_node_idx_ = node.id;
-    nodes_.push_back(node);
+    nodes_.clear(); // the capacity is kept 
+    current_node_idx_ = nodes_.push(0, start_point_idx_, 0); // the root is its own parent 
 
 #ifndef NO_OLD_VISITED_STRUCT 
     // set the starting node as visited 
-    visited_nodes_idxs_.push_back(node.id);
+    visited_nodes_idxs_.push_back(current_node_idx_);
 #endif
 
     // reset visited points 
-    visited_points_flag_ = std::vector<bool>(pcl_traversability_.size(), false);
+    visited_points_flag_.reset(pcl_traversability_->size());
     // set the starting node as visited 
-    visited_points_flag_[start_point_idx_] = true;
+    visited_points_flag_.set(start_point_idx_);
+}
+
+void PathPlanner::setNeighborhoodGraph(const NeighborhoodGraph::ConstPtr& graph)
+{
+    boost::recursive_mutex::scoped_lock locker(interaction_mutex);
+
+    p_neighborhood_graph_.reset();
+    if (!graph) return; /// < EXIT POINT
+
+    /// < check if it has been built on the current traversability pcl with the expected parameters 
+    if (!graph->isValidFor(*pcl_traversability_, kMaxRobotStepDeltaZ) || (graph->getRadius() < kMaxRobotStep))
+    {
+        ROS_WARN("PathPlanner::setNeighborhoodGraph() - the graph does not match the traversability pcl, using kd-tree search");
+        return; /// < EXIT POINT
+    }
+
+    p_neighborhood_graph_ = graph;
 }
 
 void PathPlanner::set2DUtility(pcl::PointCloud<pcl::PointXYZI>& utility_pcl)
+{
+    // legacy interface: deep copy the input into a new shared snapshot 
+    pcl::PointCloud<pcl::PointXYZI>::ConstPtr p_utility_pcl(new pcl::PointCloud<pcl::PointXYZI>(utility_pcl));
+    set2DUtility(p_utility_pcl);
+}
+
+void PathPlanner::set2DUtility(const pcl::PointCloud<pcl::PointXYZI>::ConstPtr& utility_pcl)
 {
     boost::recursive_mutex::scoped_lock locker(interaction_mutex);
 
-    std::cout << "PathPlanner::set2DUtility() - utility  pcl size: " << utility_pcl.size() << std::endl;
+    std::cout << "PathPlanner::set2DUtility() - utility  pcl size: " << utility_pcl->size() << std::endl;
 
     pcl_utility_2d_ = utility_pcl;
 
     /// < check if it has the same size of the traversability pcl 
-    if ((pcl_utility_2d_.header.stamp != pcl_traversability_.header.stamp) || (pcl_utility_2d_.size() != pcl_traversability_.size()))
+    if ((pcl_utility_2d_->header.stamp != pcl_traversability_->header.stamp) || (pcl_utility_2d_->size() != pcl_traversability_->size()))
     {
         ROS_WARN("**********************************************************************************************************");
         ROS_WARN("PathPlanner::set2DUtility() - traversability and utility pcls have different sizes or stamp");
         ROS_WARN("**********************************************************************************************************");
-        std::cout << "trav stamp: " << pcl_traversability_.header.stamp << ", utility stamp: " << pcl_utility_2d_.header.stamp << std::endl;
-        std::cout << "trav size: " << pcl_traversability_.size() << ", utility size: " << pcl_utility_2d_.size() << std::endl;
+        std::cout << "trav stamp: " << pcl_traversability_->header.stamp << ", utility stamp: " << pcl_utility_2d_->header.stamp << std::endl;
+        std::cout << "trav size: " << pcl_traversability_->size() << ", utility size: " << pcl_utility_2d_->size() << std::endl;
         b_utility_2d_available_ = false;
         return; /// < EXIT POINT 
     }
 
-    if (!pcl_utility_2d_.empty())
+    if (!pcl_utility_2d_->empty())
     {
         b_utility_2d_available_ = true;
-        computeZMinMaxRange(utility_pcl, p_cost_->GetMinAuxUtility(), p_cost_->GetMaxAuxUtility(), p_cost_->GetRangeAuxUtility());
+        computeZMinMaxRange(*pcl_utility_2d_, p_cost_->GetMinAuxUtility(), p_cost_->GetMaxAuxUtility(), p_cost_->GetRangeAuxUtility());
     }
 }
 
@@ -481,48 +560,100 @@ void PathPlanner::setCostFunction(BaseCostFunction* new_cost, float lamda_trav,
     p_cost_->SetLambdaTrav(lamda_trav);
     p_cost_->SetLambdaAuxUtility(lambda_aux_utility);
     p_cost_->SetTauExpDecay(tau_exp_decay);
+    p_cost_->SetReservationTable(p_reservation_table_, reservation_robot_id_, lambda_reservation_);
 }
 
 void PathPlanner::setCostFunctionType(int type, float lamda_trav, float lambda_aux_utility, float tau_exp_decay)
 {
     boost::recursive_mutex::scoped_lock locker(interaction_mutex);
 
-    type = std::max(std::min(type, (int) BaseCostFunction::kNumCostFunctions - 1), 0);
+    BaseCostFunction* p_cost = BaseCostFunction::create(type);
+    std::cout << "PathPlanner::setCostFunctionType()- setting " << p_cost->getName() << std::endl;
+    setCostFunction(p_cost, lamda_trav, lambda_aux_utility, tau_exp_decay);
+}
+
+void PathPlanner::setRandomSeed(unsigned int seed)
+{
+    boost::recursive_mutex::scoped_lock locker(interaction_mutex);
+
+    random_seed_ = seed;
+    random_generator_.seed(random_seed_);
+}
+
+void PathPlanner::setOpenSetType(int type, double bucket_resolution)
+{
+    boost::recursive_mutex::scoped_lock locker(interaction_mutex);
+
+    type = std::max(std::min(type, (int) kNumOpenSetTypes - 1), 0);
+    open_set_type_ = (OpenSetType) type;
+    open_set_bucket_resolution_ = bucket_resolution;
 
-    switch (type)
+    switch (open_set_type_)
     {
-    case BaseCostFunction::kTraversabilityCost:
-        std::cout << "PathPlanner::setCostFunctionType()- setting TraversabilityCostFunction()" << std::endl;
-        setCostFunction(new TraversabilityCostFunction(), lamda_trav, lambda_aux_utility, tau_exp_decay);
-        break;
-    case BaseCostFunction::kTraversabilityProdCost:
-        setCostFunction(new TraversabilityProdCostFunction(), lamda_trav, lambda_aux_utility, tau_exp_decay);
-        std::cout << "PathPlanner::setCostFunctionType()- setting TraversabilityProdCostFunction()" << std::endl;
-        break;
-    case BaseCostFunction::kSimpleCost:
-        setCostFunction(new SimpleCostFunction(), lamda_trav, lambda_aux_utility, tau_exp_decay);
-        std::cout << "PathPlanner::setCostFunctionType()- setting OriginalCostFunction()" << std::endl;
+    case kOpenSetBucketQueue:
+        std::cout << "PathPlanner::setOpenSetType()- setting BucketQueue(), resolution: " << bucket_resolution << std::endl;
         break;
-    case BaseCostFunction::kBaseCost:
+    case kOpenSetBinaryHeap:
+    default:
+        std::cout << "PathPlanner::setOpenSetType()- setting IndexedBinaryHeap()" << std::endl;
+    }
+    p_leaf_nodes_.reset(createOpenSet());
+    other_tree_.p_leaf_nodes.reset(); // recreated with the new type at the next bidirectional planning
+}
+
+BaseOpenSet* PathPlanner::createOpenSet() const
+{
+    switch (open_set_type_)
+    {
+    case kOpenSetBucketQueue:
+        return new BucketQueue(open_set_bucket_resolution_);
+    case kOpenSetBinaryHeap:
     default:
-        setCostFunction(new BaseCostFunction(), lamda_trav, lambda_aux_utility, tau_exp_decay);
-        std::cout << "PathPlanner::setCostFunctionType()- setting BaseCostFunction()" << std::endl;
+        return new IndexedBinaryHeap();
     }
 }
 
+void PathPlanner::setBidirectionalSearch(bool val)
+{
+    boost::recursive_mutex::scoped_lock locker(interaction_mutex);
+
+    b_bidirectional_search_ = val;
+    if (!val) other_tree_ = SearchTree(); // release the memory of the backward tree 
+}
+
+void PathPlanner::setAnytimePlanning(double time_budget_sec, const PartialPathCallback& callback, double republish_period_sec)
+{
+    boost::recursive_mutex::scoped_lock locker(interaction_mutex);
+
+    anytime_time_budget_sec_ = time_budget_sec;
+    anytime_republish_period_sec_ = std::max(republish_period_sec, 0.);
+    anytime_callback_ = callback;
+}
+
+void PathPlanner::setReservationTable(const ReservationTable::Ptr& table, int robot_id, float lambda_reservation, double nominal_speed)
+{
+    boost::recursive_mutex::scoped_lock locker(interaction_mutex);
+
+    p_reservation_table_ = table;
+    reservation_robot_id_ = robot_id;
+    lambda_reservation_ = lambda_reservation;
+    nominal_speed_ = (nominal_speed > 0) ? nominal_speed : kDefaultNominalSpeed;
+    p_cost_->SetReservationTable(p_reservation_table_, reservation_robot_id_, lambda_reservation_);
+}
+
 bool PathPlanner::setGoal(pcl::PointXYZI& goal_in)
 {
     bool res = true;
 
     boost::recursive_mutex::scoped_lock locker(interaction_mutex);
 
-    if (pcl_traversability_.empty())
+    if (pcl_traversability_->empty())
     {
         ROS_WARN("PathPlanner::set_goal() - cannot  set goal if traversability kdtree is empty");
         return false;
     }
 
-    leaf_nodes_idxs_.clear();
+    p_leaf_nodes_->clear();
 
 #ifndef NO_OLD_VISITED_STRUCT 
     //visited_nodes_idxs_.clear();
@@ -530,9 +661,9 @@ bool PathPlanner::setGoal(pcl::PointXYZI& goal_in)
 #endif 
 
     // reset visited points 
-    visited_points_flag_ = std::vector<bool>(pcl_traversability_.size(), false);
+    visited_points_flag_.reset(pcl_traversability_->size());
     // set the starting node as visited 
-    visited_points_flag_[start_point_idx_] = true;
+    visited_points_flag_.set(start_point_idx_);
 
     //nodes_.erase(nodes_.begin() + 1, nodes_.end());
     nodes_.resize(1); // leave the starting node we set with the function set_input()
@@ -540,21 +671,21 @@ bool PathPlanner::setGoal(pcl::PointXYZI& goal_in)
     // Find the goal nearest point in noWall point cloud
     std::vector<int> pointIdxNKNSearch(1);
     std::vector<float> pointNKNSquaredDistance(1);
-    //int found = kdtree_traversability_.nearestKSearch(goal_in, 1, pointIdxNKNSearch, pointNKNSquaredDistance);
-    int found = kdtree_traversability_.radiusSearch(goal_in, kGoalAcceptCheckThreshold, pointIdxNKNSearch, pointNKNSquaredDistance);
+    //int found = p_kdtree_traversability_->nearestKSearch(goal_in, 1, pointIdxNKNSearch, pointNKNSquaredDistance);
+    int found = p_kdtree_traversability_->radiusSearch(goal_in, kGoalAcceptCheckThreshold, pointIdxNKNSearch, pointNKNSquaredDistance);
 
     if (found < 1)
     {
         ROS_WARN("PathPlanner::setGoal() - cannot find a close node ");
         res = false;
+        goal_point_idx_ = -1;
     }
+    else
     {
-        goal_ = pcl_traversability_[pointIdxNKNSearch[0]];
+        goal_point_idx_ = pointIdxNKNSearch[0];
     }
-
-    for (size_t i = 0, iEnd = markerArr_.markers.size(); i < iEnd; i++)
     {
-        markerArr_.markers[i].action = visualization_msgs::Marker::DELETE;
+        goal_ = (*pcl_traversability_)[pointIdxNKNSearch[0]];
     }
 
     return res;
@@ -569,27 +700,37 @@ pcl::PointXYZI& PathPlanner::getGoal()
 
 bool PathPlanner::planning(nav_msgs::Path& path_out)
 {
+    PROFILE_ZONE("planning/planning");
     boost::recursive_mutex::scoped_lock locker(interaction_mutex);
 
 #ifdef VERBOSE     
-    std::cout << "PathPlanner::planning() - start position: " << pcl_traversability_[start_point_idx_] << std::endl;
+    std::cout << "PathPlanner::planning() - start position: " << (*pcl_traversability_)[start_point_idx_] << std::endl;
     std::cout << "PathPlanner::planning() - goal position: " << goal_ << std::endl;
 #endif
 
     b_abort_ = false;
 
-    if (pcl_traversability_.empty())
+    if (pcl_traversability_->empty())
     {
         ROS_WARN("PathPlanner::planning() - cannot plan if traversability kdtree is empty");
         return false;
     }
 
+    if (b_bidirectional_search_ && (goal_point_idx_ >= 0))
+    {
+        return planningBidirectional(path_out); /// < EXIT POINT 
+    }
+
     std::cout << "PathPlanner::planning() - using cost function: " << p_cost_->getName() << std::endl;
 
     path_out.poses.clear();
     path_out.header.frame_id = "map";
 
-    leaf_nodes_idxs_.clear();
+    p_leaf_nodes_->clear();
+    
+    // restart the sample sequence: the same input and seed give the same path 
+    random_generator_.seed(random_seed_);
+    uniform_distribution_.reset();
 
 #ifndef NO_OLD_VISITED_STRUCT 
     //visited_nodes_idxs_.clear();
@@ -597,9 +738,9 @@ bool PathPlanner::planning(nav_msgs::Path& path_out)
 #endif
 
     // reset visited points 
-    visited_points_flag_ = std::vector<bool>(pcl_traversability_.size(), false);
+    visited_points_flag_.reset(pcl_traversability_->size());
     // set the starting node as visited 
-    visited_points_flag_[start_point_idx_] = true;
+    visited_points_flag_.set(start_point_idx_);
 
     //nodes_.erase(nodes_.begin() + 1, nodes_.end());
     nodes_.resize(1); // leave the starting node we set with the function set_input()
@@ -607,7 +748,7 @@ bool PathPlanner::planning(nav_msgs::Path& path_out)
     nav_msgs::Path local_path;
     local_path.header.frame_id = "map";
 
-    markerArr_.markers.clear();
+    if (p_marker_publisher_) p_marker_publisher_->clear();
 
     bool is_found_path = false;
     bool is_exist_path = true;
@@ -617,6 +758,14 @@ bool PathPlanner::planning(nav_msgs::Path& path_out)
     count_ = 0;
 
     p_cost_->initTime();
+    reservation_start_time_ = time_start.toSec();
+    
+    // any-time mode: the best partial path ends in the expanded node closest to the goal 
+    const bool b_anytime = isAnytimePlanning();
+    size_t best_node_idx = 0;
+    double best_dist_to_goal = dist(goal_, (*pcl_traversability_)[start_point_idx_]);
+    bool b_best_node_changed = false;
+    double last_partial_path_time = -std::numeric_limits<double>::max();
 
     while (!is_found_path && is_exist_path && !is_timeout && !b_abort_)
     {
@@ -635,6 +784,30 @@ bool PathPlanner::planning(nav_msgs::Path& path_out)
             ROS_WARN("PathPlanner::planning() - timeout **********************");
             is_timeout = true;
         }
+        
+        if (b_anytime && is_exist_path && !is_found_path)
+        {
+            const double dist_to_goal = dist(goal_, (*pcl_traversability_)[nodes_.point_idx[current_node_idx_]]);
+            if (dist_to_goal < best_dist_to_goal)
+            {
+                best_dist_to_goal = dist_to_goal;
+                best_node_idx = current_node_idx_;
+                b_best_node_changed = true;
+            }
+            const double elapsed_sec = elapsed_time.toSec();
+            if (b_best_node_changed && (elapsed_sec > anytime_time_budget_sec_) && (elapsed_sec - last_partial_path_time >= anytime_republish_period_sec_))
+            {
+                nav_msgs::Path partial_path;
+                buildPartialPath(best_node_idx, partial_path);
+                if (partial_path.poses.size() > 1)
+                {
+                    ROS_INFO("PathPlanner::planning() - partial path, length: %ld, distance to goal: %f", partial_path.poses.size(), best_dist_to_goal);
+                    anytime_callback_(partial_path);
+                }
+                last_partial_path_time = elapsed_sec;
+                b_best_node_changed = false;
+            }
+        }
     }
 
 #ifdef VERBOSE
@@ -658,16 +831,16 @@ bool PathPlanner::planning(nav_msgs::Path& path_out)
 #ifdef VERBOSE2
         std::cout << "parent node id: " << node_idx << std::endl;
 #endif        
-        const pcl::PointXYZI& point = pcl_traversability_[nodes_[node_idx].point_idx];
+        const pcl::PointXYZI& point = (*pcl_traversability_)[nodes_.point_idx[node_idx]];
         geometry_msgs::PoseStamped pose;
         pose.header.frame_id = "map";
         pose.pose.position.x = point.x;
         pose.pose.position.y = point.y;
         pose.pose.position.z = point.z;
         local_path.poses.push_back(pose);
-        if (node_idx == nodes_[node_idx].parent_id) // we got the root!
+        if (node_idx == nodes_.parent_id[node_idx]) // we got the root!
             bDone = true;
-        node_idx = nodes_[node_idx].parent_id;
+        node_idx = nodes_.parent_id[node_idx];
 
     }
     while (!bDone);
@@ -694,11 +867,359 @@ bool PathPlanner::planning(nav_msgs::Path& path_out)
 
 
     //localPathPub_.publish(path_in);
-    localPathPub_.publish(local_path);
+    if (localPathPub_) localPathPub_.publish(local_path);
     //return is_exist_path;
     return is_found_path;
 }
 
+int PathPlanner::planningMultiGoal(const std::vector<pcl::PointXYZI>& goals, std::vector<nav_msgs::Path>& paths_out, std::vector<double>& costs_out)
+{
+    PROFILE_ZONE("planning/planning_multi_goal");
+    boost::recursive_mutex::scoped_lock locker(interaction_mutex);
+
+    b_abort_ = false;
+
+    const double kInfinity = std::numeric_limits<double>::infinity();
+    paths_out.assign(goals.size(), nav_msgs::Path());
+    costs_out.assign(goals.size(), kInfinity);
+    for (size_t k = 0; k < goals.size(); k++) paths_out[k].header.frame_id = "map";
+
+    if (pcl_traversability_->empty() || goals.empty())
+    {
+        ROS_WARN("PathPlanner::planningMultiGoal() - empty input");
+        return 0; /// < EXIT POINT 
+    }
+
+    std::cout << "PathPlanner::planningMultiGoal() - num goals: " << goals.size() << ", using cost function: " << p_cost_->getName() << std::endl;
+
+    const size_t num_points = pcl_traversability_->size();
+
+    /// < map the goals on the traversability points (as in setGoal())
+    std::vector<int> goal_point_idxs(goals.size(), -1);
+    std::vector<char> is_goal_point(num_points, 0);
+    size_t num_goal_points = 0; // distinct goal points still to be settled 
+    {
+        std::vector<int> pointIdxNKNSearch;
+        std::vector<float> pointNKNSquaredDistance;
+        for (size_t k = 0; k < goals.size(); k++)
+        {
+            if (p_kdtree_traversability_->radiusSearch(goals[k], kGoalAcceptCheckThreshold, pointIdxNKNSearch, pointNKNSquaredDistance) < 1)
+            {
+                ROS_WARN("PathPlanner::planningMultiGoal() - cannot find a close node for goal %ld", k);
+                continue;
+            }
+            goal_point_idxs[k] = pointIdxNKNSearch[0];
+            if (!is_goal_point[pointIdxNKNSearch[0]])
+            {
+                is_goal_point[pointIdxNKNSearch[0]] = 1;
+                num_goal_points++;
+            }
+        }
+    }
+
+    /// < Dijkstra sweep on the traversability points 
+    std::vector<double> cost(num_points, kInfinity);
+    std::vector<int> parent(num_points, -1);
+    std::vector<char> settled(num_points, 0);
+    IndexedBinaryHeap open_set;
+
+    cost[start_point_idx_] = 0;
+    parent[start_point_idx_] = start_point_idx_;
+    open_set.push(start_point_idx_, 0);
+
+    std::vector<int> pointIdxRadiusSearch;
+    std::vector<float> pointRadiusSquaredDistance;
+    double radius = 0;
+
+    ros::Time time_start = ros::Time::now();
+    p_cost_->initTime();
+    count_ = 0;
+
+    size_t u = 0;
+    while ((num_goal_points > 0) && open_set.pop(u) && !b_abort_)
+    {
+        count_++;
+        settled[u] = 1;
+        if (is_goal_point[u]) num_goal_points--;
+
+        const pcl::PointXYZI& point_u = (*pcl_traversability_)[u];
+        findPointNeighbors(u, radius, pointIdxRadiusSearch, pointRadiusSquaredDistance);
+        for (size_t i = 0; i < pointIdxRadiusSearch.size(); i++)
+        {
+            const int v = pointIdxRadiusSearch[i];
+            if (settled[v]) continue;
+            const pcl::PointXYZI& point_v = (*pcl_traversability_)[v];
+            if (!(point_v.intensity < std::numeric_limits<double>::infinity())) continue;
+
+            double aux_2d_cost = 0.;
+            double aux_2d_confidence = 1.;
+            if (b_utility_2d_available_)
+            {
+                aux_2d_cost = (*pcl_utility_2d_)[v].z;
+                aux_2d_confidence = (*pcl_utility_2d_)[v].intensity;
+            }
+            const double new_cost = cost[u] + p_cost_->cost(point_u, point_v, point_v, point_v.intensity, aux_2d_cost, aux_2d_confidence);
+            if (new_cost < cost[v])
+            {
+                cost[v] = new_cost;
+                parent[v] = u;
+                open_set.push(v, new_cost);
+            }
+        }
+
+        ros::Duration elapsed_time = ros::Time::now() - time_start;
+        if (elapsed_time.toSec() > kPlanningTimeoutSec)
+        {
+            ROS_WARN("PathPlanner::planningMultiGoal() - timeout **********************");
+            break;
+        }
+    }
+
+    /// < build the paths of the settled goals 
+    int num_reached_goals = 0;
+    for (size_t k = 0; k < goals.size(); k++)
+    {
+        const int goal_idx = goal_point_idxs[k];
+        if ((goal_idx < 0) || !settled[goal_idx]) continue;
+
+        nav_msgs::Path& path = paths_out[k];
+        geometry_msgs::PoseStamped pose;
+        pose.header.frame_id = "map";
+        int idx = goal_idx;
+        while (true)
+        {
+            const pcl::PointXYZI& point = (*pcl_traversability_)[idx];
+            pose.pose.position.x = point.x;
+            pose.pose.position.y = point.y;
+            pose.pose.position.z = point.z;
+            path.poses.push_back(pose);
+            if (idx == parent[idx]) break; // we got the root!
+            idx = parent[idx];
+        }
+        std::reverse(path.poses.begin(), path.poses.end());
+        path = smoothPath3(path);
+
+        costs_out[k] = cost[goal_idx];
+        num_reached_goals++;
+    }
+
+    ROS_INFO("PathPlanner::planningMultiGoal() - reached goals: %d/%ld, expansions: %d", num_reached_goals, goals.size(), count_);
+    return num_reached_goals;
+}
+
+void PathPlanner::buildPartialPath(size_t node_idx, nav_msgs::Path& path_out) const
+{
+    path_out.poses.clear();
+    path_out.header.frame_id = "map";
+    path_out.header.stamp = ros::Time::now();
+
+    geometry_msgs::PoseStamped pose;
+    pose.header.frame_id = "map";
+    while (true)
+    {
+        const pcl::PointXYZI& point = (*pcl_traversability_)[nodes_.point_idx[node_idx]];
+        pose.pose.position.x = point.x;
+        pose.pose.position.y = point.y;
+        pose.pose.position.z = point.z;
+        path_out.poses.push_back(pose);
+        if (node_idx == nodes_.parent_id[node_idx]) break; // we got the root!
+        node_idx = nodes_.parent_id[node_idx];
+    }
+    std::reverse(path_out.poses.begin(), path_out.poses.end());
+
+    path_out = smoothPath3(path_out);
+}
+
+bool PathPlanner::planningBidirectional(nav_msgs::Path& path_out)
+{
+    PROFILE_ZONE("planning/planning_bidirectional");
+    std::cout << "PathPlanner::planningBidirectional() - using cost function: " << p_cost_->getName() << std::endl;
+
+    path_out.poses.clear();
+    path_out.header.frame_id = "map";
+
+    p_leaf_nodes_->clear();
+
+    // restart the sample sequence: the same input and seed give the same path 
+    random_generator_.seed(random_seed_);
+    uniform_distribution_.reset();
+
+    /// < forward tree: rooted at the start (set with setInput()), towards the goal 
+    visited_points_flag_.reset(pcl_traversability_->size());
+    visited_points_flag_.set(start_point_idx_);
+    nodes_.resize(1);
+    current_node_idx_ = 0;
+
+    /// < backward tree: rooted at the goal, towards the start 
+    if (!other_tree_.p_leaf_nodes) other_tree_.p_leaf_nodes.reset(createOpenSet());
+    other_tree_.p_leaf_nodes->clear();
+    other_tree_.visited_points_flag.reset(pcl_traversability_->size());
+    other_tree_.visited_points_flag.set(goal_point_idx_);
+    other_tree_.nodes.clear();
+    other_tree_.current_node_idx = other_tree_.nodes.push(0, goal_point_idx_, 0);
+    other_tree_.goal = (*pcl_traversability_)[start_point_idx_];
+
+    if (p_marker_publisher_) p_marker_publisher_->clear();
+
+    b_backward_tree_active_ = false;
+    b_trees_met_ = false;
+    b_bidirectional_running_ = true;
+
+    bool is_found_path = false;   // one of the tree reached its goal 
+    bool is_exist_path = true;
+    bool is_timeout = false;
+
+    ros::Time time_start = ros::Time::now();
+    count_ = 0;
+
+    p_cost_->initTime();
+    reservation_start_time_ = time_start.toSec();
+
+    // alternate the expansions of the two trees: each tree keeps its current node between two turns  
+    while (!is_found_path && !b_trees_met_ && is_exist_path && !is_timeout && !b_abort_)
+    {
+        count_++;
+        sampleFollowers();
+        if (b_trees_met_) break;
+        is_exist_path = findNextNode();
+        if (is_exist_path)
+        {
+            is_found_path = checkGoal();
+        }
+        if (is_found_path || !is_exist_path) break;
+
+        swapSearchTree();
+
+        ros::Duration elapsed_time = ros::Time::now() - time_start;
+        if (elapsed_time.toSec() > kPlanningTimeoutSec)
+        {
+            ROS_WARN("PathPlanner::planningBidirectional() - timeout **********************");
+            is_timeout = true;
+        }
+    }
+
+    b_bidirectional_running_ = false;
+
+    /// < get the connection nodes of the two trees 
+    size_t active_node_idx = current_node_idx_;
+    bool is_other_connected = false; 
+    size_t other_node_idx = 0;
+    if (b_trees_met_)
+    {
+        active_node_idx = meeting_node_idx_;
+        for (size_t i = 0; i < other_tree_.nodes.size(); i++)
+        {
+            if (other_tree_.nodes.point_idx[i] == meeting_point_idx_)
+            {
+                other_node_idx = i;
+                is_other_connected = true;
+                break;
+            }
+        }
+    }
+
+    // restore the forward tree as the active one 
+    const bool b_backward_tree_was_active = b_backward_tree_active_;
+    if (b_backward_tree_active_) 
+    {
+        swapSearchTree();
+        std::swap(active_node_idx, other_node_idx);
+    }
+    const size_t forward_node_idx = active_node_idx;
+    const size_t backward_node_idx = other_node_idx;
+    const bool has_forward_chain = (b_trees_met_ && is_other_connected) || !b_backward_tree_was_active; 
+    const bool has_backward_chain = (b_trees_met_ && is_other_connected) || b_backward_tree_was_active;
+
+#ifdef VERBOSE
+    std::cout << "PathPlanner::planningBidirectional() - trees met: " << b_trees_met_ << ", found path: " << is_found_path << ", exist path: " << is_exist_path << std::endl;
+    if (b_abort_) std::cout << "PathPlanner::planningBidirectional() - planning  aborted" << std::endl;
+#endif
+
+    const bool is_success = (b_trees_met_ && is_other_connected) || is_found_path;
+    if (is_success)
+    {
+        geometry_msgs::PoseStamped pose;
+        pose.header.frame_id = "map";
+
+        /// < forward chain: start -> forward node
+        if (has_forward_chain)
+        {
+            std::vector<int> chain;
+            size_t node_idx = forward_node_idx;
+            while (true)
+            {
+                chain.push_back(nodes_.point_idx[node_idx]);
+                if (node_idx == nodes_.parent_id[node_idx]) break; // we got the root!
+                node_idx = nodes_.parent_id[node_idx];
+            }
+            for (int i = chain.size(); i > 0; i--)
+            {
+                const pcl::PointXYZI& point = (*pcl_traversability_)[chain[i - 1]];
+                pose.pose.position.x = point.x;
+                pose.pose.position.y = point.y;
+                pose.pose.position.z = point.z;
+                path_out.poses.push_back(pose);
+            }
+        }
+        else
+        {
+            // the backward tree reached the start 
+            const pcl::PointXYZI& point = (*pcl_traversability_)[start_point_idx_];
+            pose.pose.position.x = point.x;
+            pose.pose.position.y = point.y;
+            pose.pose.position.z = point.z;
+            path_out.poses.push_back(pose);
+        }
+
+        /// < backward chain: backward node -> goal
+        if (has_backward_chain)
+        {
+            size_t node_idx = backward_node_idx;
+            while (true)
+            {
+                const pcl::PointXYZI& point = (*pcl_traversability_)[other_tree_.nodes.point_idx[node_idx]];
+                pose.pose.position.x = point.x;
+                pose.pose.position.y = point.y;
+                pose.pose.position.z = point.z;
+                path_out.poses.push_back(pose);
+                if (node_idx == other_tree_.nodes.parent_id[node_idx]) break; // we got the root (goal)!
+                node_idx = other_tree_.nodes.parent_id[node_idx];
+            }
+        }
+        else
+        {
+            // the forward tree reached the goal 
+            pose.pose.position.x = goal_.x;
+            pose.pose.position.y = goal_.y;
+            pose.pose.position.z = goal_.z;
+            path_out.poses.push_back(pose);
+        }
+
+        // smooth the path 
+        path_out = smoothPath3(path_out);
+
+        ROS_INFO("path length: %ld, expansions: %d, forward nodes: %ld, backward nodes: %ld", path_out.poses.size(), count_, nodes_.size(), other_tree_.nodes.size());
+    }
+    else
+    {
+        ROS_INFO("PathPlanner::planningBidirectional() - forward nodes: %ld, backward nodes: %ld", nodes_.size(), other_tree_.nodes.size());
+        ROS_WARN("PathPlanner::planningBidirectional() - NO PATH");
+    }
+
+    if (localPathPub_) localPathPub_.publish(path_out);
+    return is_success;
+}
+
+void PathPlanner::swapSearchTree()
+{
+    nodes_.swap(other_tree_.nodes);
+    p_leaf_nodes_.swap(other_tree_.p_leaf_nodes);
+    visited_points_flag_.swap(other_tree_.visited_points_flag);
+    std::swap(current_node_idx_, other_tree_.current_node_idx);
+    std::swap(goal_, other_tree_.goal);
+    b_backward_tree_active_ = !b_backward_tree_active_;
+}
+
 /// static functions 
 
 int PathPlanner::getClosestNodeIdx(pcl::PointXYZI& position, KdTreeFLANN& kdtree, float radius)
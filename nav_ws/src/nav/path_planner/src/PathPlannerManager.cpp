@@ -20,6 +20,10 @@
 
 #include "PathPlannerManager.h"
 
+#include <unordered_set>
+
+#include "VoxelGridDownsample.h"
+
 const float PathPlannerManager::k3DDistanceArrivedToGoal = 4.0*PathPlanner::kGoalPlanningCheckThreshold; //2.5*PathPlanner::kGoalPlanningCheckThreshold;
 const float PathPlannerManager::k2DDistanceArrivedToGoal = 2.1*PathPlanner::kGoalPlanningCheckThreshold;
 const float PathPlannerManager::k3DDistanceCloseToGoal = 5.0*PathPlanner::kGoalPlanningCheckThreshold;// [m]
@@ -34,6 +38,9 @@ const float PathPlannerManager::kGainXCropBoxPathAligned = 1.1; // crop box exte
 const float PathPlannerManager::kSizeYCropBoxPathAligned = 3; // 
 const float PathPlannerManager::kSizeZCropBoxPathAligned = 3; // 
 
+const double PathPlannerManager::kDefaultCoarseLeafSize = 0.14; // [m] 4 x mapping leaf_size; it must be smaller than PathPlanner::kMaxRobotStep for keeping the coarse map connected 
+const float PathPlannerManager::kCorridorCellSize = 0.5; // [m] the corridor half-width is in [kCorridorCellSize, 2*kCorridorCellSize]
+
 //const float PathPlannerManager::kTaskCallbackPeriod = 0.5; // [s] the duration period of the task callback 
 
 
@@ -80,11 +87,27 @@ T getParam(ros::NodeHandle& n, const std::string& name, const T& defaultValue)
 PathPlannerManager::PathPlannerManager(): b_wall_info_available_(false), b_traversability_info_available_(false),b_utility_2d_info_available_(false), b_goal_selected_(false),b_is_close_to_goal_(false),b_abort_(false)
 {
     p_path_planner_.reset(new PathPlanner);
+    p_incremental_planner_.reset(new IncrementalPathPlanner);
     wall_pcl_.reset(new pcl::PointCloud<pcl::PointXYZRGBNormal>());
     traversability_pcl_.reset(new pcl::PointCloud<pcl::PointXYZI>());
     utility_2d_pcl_.reset(new pcl::PointCloud<pcl::PointXYZI>());
 
     cost_function_type_ = BaseCostFunction::kSimpleCost;
+    lambda_trav_ = 1; 
+    lambda_aux_utility_ = 1; 
+    
+    traversability_map_version_ = 0; 
+    
+    b_use_neighborhood_graph_ = true; 
+    b_use_incremental_planning_ = false; 
+    b_use_hierarchical_planning_ = false; 
+    coarse_leaf_size_ = kDefaultCoarseLeafSize; 
+    anytime_time_budget_sec_ = 0; 
+    anytime_republish_period_sec_ = PathPlanner::kDefaultAnytimeRepublishPeriodSec; 
+    reservation_robot_id_ = 0; 
+    lambda_reservation_ = BaseCostFunction::kLamdaReservationDefault; 
+    nominal_speed_ = PathPlanner::kDefaultNominalSpeed; 
+    b_use_path_smoothing_ = false; 
     
     planning_status_ = kNone; 
     
@@ -100,7 +123,9 @@ void PathPlannerManager::traversabilityCloudCallback(const sensor_msgs::PointClo
     boost::recursive_mutex::scoped_lock traversability_locker(traversability_mutex_);
     boost::recursive_mutex::scoped_lock locker(utility_2d_mutex_);
 
-    pcl::fromROSMsg(traversability_msg, *traversability_pcl_);
+    pcl::PointCloud<pcl::PointXYZI>::Ptr p_traversability_pcl(new pcl::PointCloud<pcl::PointXYZI>()); // new snapshot, the previous one may be still in use by a planner 
+    pcl::fromROSMsg(traversability_msg, *p_traversability_pcl);
+    setTraversabilitySnapshot(p_traversability_pcl);
     
     std::cout << "PathPlannerManager::traversabilityCloudCallback() - pcl size: " << traversability_pcl_->size() << std::endl;
     
@@ -118,7 +143,7 @@ void PathPlannerManager::setTraversabilityCloud(const pcl::PointCloud<pcl::Point
     boost::recursive_mutex::scoped_lock traversability_locker(traversability_mutex_);
     boost::recursive_mutex::scoped_lock locker(utility_2d_mutex_);
 
-    *traversability_pcl_ = traversability_pcl_in;
+    setTraversabilitySnapshot(pcl::PointCloud<pcl::PointXYZI>::Ptr(new pcl::PointCloud<pcl::PointXYZI>(traversability_pcl_in))); // new snapshot
     
     std::cout << "PathPlannerManager::traversabilityCloudCallback() - pcl size: " << traversability_pcl_->size() << std::endl;
     
@@ -132,10 +157,25 @@ void PathPlannerManager::setTraversabilityCloud(const pcl::PointCloud<pcl::Point
 }
 
 
+void PathPlannerManager::setTraversabilitySnapshot(const pcl::PointCloud<pcl::PointXYZI>::Ptr& traversability_pcl)
+{
+    boost::recursive_mutex::scoped_lock traversability_locker(traversability_mutex_);
+    
+    traversability_map_version_++;
+    if(path_cache_.isEnabled()) path_cache_.updateMap(traversability_map_version_, *traversability_pcl_, *traversability_pcl);
+    
+    traversability_pcl_ = traversability_pcl;
+    traversability_kdtree_.reset();
+    traversability_graph_.reset();
+    traversability_coarse_pcl_.reset();
+    traversability_coarse_kdtree_.reset();
+}
+
 void PathPlannerManager::wallCloudCallback(const sensor_msgs::PointCloud2& wall_msg)
 {
     boost::recursive_mutex::scoped_lock wall_locker(wall_mutex_);
 
+    wall_pcl_.reset(new pcl::PointCloud<pcl::PointXYZRGBNormal>()); // new snapshot, the previous one may be still in use by a planner 
     pcl::fromROSMsg(wall_msg, *wall_pcl_);
      
     // this cloud be empty 
@@ -149,7 +189,9 @@ void PathPlannerManager::wallCloudCallback(const sensor_msgs::PointCloud2& wall_
         wall_pcl_->push_back(far_point);
     }
     
-    wall_kdtree_.setInputCloud(wall_pcl_); 
+    boost::shared_ptr<PathPlanner::WallKdTreeFLANN> p_wall_kdtree(new PathPlanner::WallKdTreeFLANN);
+    p_wall_kdtree->setInputCloud(wall_pcl_); 
+    wall_kdtree_ = p_wall_kdtree;
     b_wall_info_available_ = true;
 }
 
@@ -160,6 +202,7 @@ void PathPlannerManager::utility2DCloudCallback(const sensor_msgs::PointCloud2&
     boost::recursive_mutex::scoped_lock locker(utility_2d_mutex_);
     boost::recursive_mutex::scoped_lock traversability_locker(traversability_mutex_);
 
+    utility_2d_pcl_.reset(new pcl::PointCloud<pcl::PointXYZI>()); // new snapshot
     pcl::fromROSMsg(utility_msg, *utility_2d_pcl_);
     
     std::cout << "PathPlannerManager::utility2DCloudCallback() - pcl size: " << traversability_pcl_->size() << std::endl;
@@ -246,6 +289,9 @@ PathPlannerManager::PlannerStatus PathPlannerManager::doPathPlanning()
     int num_failures = 0;
     int crop_step = 0;
     
+    p_path_planner_->setAnytimePlanning(anytime_time_budget_sec_, anytime_callback_, anytime_republish_period_sec_);
+    p_path_planner_->setReservationTable(p_reservation_table_, reservation_robot_id_, lambda_reservation_, nominal_speed_);
+    
     /// < update robot position
     pcl::PointXYZI robot_position;
     bool is_transform_ok = getRobotPosition(robot_position);
@@ -275,39 +321,51 @@ PathPlannerManager::PlannerStatus PathPlannerManager::doPathPlanning()
         return kArrived; /// < EXIT POINT 
     }
     
+    /// < first try the incremental planner (it reuses the search of the previous calls)
+    if(b_use_incremental_planning_ && doIncrementalPathPlanning(robot_position))
+    {
+        b_found_a_solution_once_ = true; 
+        planning_status_ = kSuccess;      
+        smoothPath(path_);
+        path_cost_ = computePathLength(path_);
+        
+        ROS_INFO("PathPlannerManager::doPathPlanning() - path successfully computed by the incremental planner");
+        return planning_status_; /// < EXIT POINT 
+    }
+    
+    /// < then try the hierarchical planner (coarse map + corridor)
+    if(b_use_hierarchical_planning_ && !b_abort_ && doHierarchicalPathPlanning(robot_position, goal_position_, path_))
+    {
+        b_found_a_solution_once_ = true; 
+        planning_status_ = kSuccess;      
+        smoothPath(path_);
+        path_cost_ = computePathLength(path_);
+        
+        ROS_INFO("PathPlannerManager::doPathPlanning() - path successfully computed by the hierarchical planner");
+        return planning_status_; /// < EXIT POINT 
+    }
+    if(b_abort_)
+    {
+        ROS_INFO("PathPlannerManager::doPathPlanning() - path aborted");
+        planning_status_ = kAborted;
+        return kAborted; /// < EXIT POINT 
+    }
+    
     /// < prepare intial traversability PCL (needed for computing the starting point )
     pcl::PointCloud<pcl::PointXYZI>::Ptr p_traversability_pcl;
     pcl::PointCloud<pcl::PointXYZI>::Ptr p_utility_2d_pcl;
-    PathPlanner::KdTreeFLANN traversability_kdtree;
+    PathPlanner::KdTreeFLANNConstPtr p_traversability_kdtree;
+    NeighborhoodGraph::ConstPtr p_neighborhood_graph;
 
-    p_traversability_pcl.reset(new pcl::PointCloud<pcl::PointXYZI>);
-    p_utility_2d_pcl.reset(new pcl::PointCloud<pcl::PointXYZI>);
-    {
-        boost::recursive_mutex::scoped_lock locker_traversability(traversability_mutex_);
-        boost::recursive_mutex::scoped_lock locker_utility(utility_2d_mutex_); 
-        
-        if(b_utility_2d_info_available_)
-        {
-            cropTwoPcls((CropBoxMethod)crop_step, 
-                         robot_position, goal_position_, 
-                         traversability_pcl_, utility_2d_pcl_,
-                         p_traversability_pcl, p_utility_2d_pcl);
-        }
-        else
-        {
-            cropPcl((CropBoxMethod)crop_step, robot_position, goal_position_, traversability_pcl_, p_traversability_pcl);
-        }
-    }
+    // crop and organize cropped traversability points
+    prepareTraversabilityInput((CropBoxMethod)crop_step, robot_position, goal_position_, p_traversability_pcl, p_utility_2d_pcl, p_traversability_kdtree, p_neighborhood_graph);
     //std::cout << "p_traversability_pcl size: " << p_traversability_pcl->size() << std::endl; 
     
-    // organize cropped traversability points
-    traversability_kdtree.setInputCloud(p_traversability_pcl);
-    
     /// < compute starting point on the segment traversability map 
     std::vector<int> pointIdxNKNSearch(1);
     std::vector<float> pointNKNSquaredDistance(1);
     /// < HACK : here we do not check the distance in order to avoid problems with outlier obstacle points or holes (this must be fixed)
-    int found = traversability_kdtree.nearestKSearch(robot_position, 1, pointIdxNKNSearch, pointNKNSquaredDistance);
+    int found = p_traversability_kdtree->nearestKSearch(robot_position, 1, pointIdxNKNSearch, pointNKNSquaredDistance);
     //int found = traversability_kdtree.radiusSearch(start_position, PathPlanner::kGoalAcceptCheckThreshold, pointIdxNKNSearch, pointNKNSquaredDistance);
     if (found < 1)
     {
@@ -328,8 +386,9 @@ PathPlannerManager::PlannerStatus PathPlannerManager::doPathPlanning()
             boost::recursive_mutex::scoped_lock locker(traversability_mutex_);
             boost::recursive_mutex::scoped_lock wall_locker(wall_mutex_);
             boost::recursive_mutex::scoped_lock utility_locker(utility_2d_mutex_);
-            p_path_planner_->setInput(*p_traversability_pcl, *wall_pcl_, wall_kdtree_, traversability_kdtree, pointIdxNKNSearch[0]);
-            if(b_utility_2d_info_available_) p_path_planner_->set2DUtility(*p_utility_2d_pcl);
+            p_path_planner_->setInput(p_traversability_pcl, wall_pcl_, wall_kdtree_, p_traversability_kdtree, pointIdxNKNSearch[0]);
+            if(p_neighborhood_graph) p_path_planner_->setNeighborhoodGraph(p_neighborhood_graph);
+            if(b_utility_2d_info_available_) p_path_planner_->set2DUtility(p_utility_2d_pcl);
         }
         
         /// < set goal and check if close enough to the traversability map
@@ -377,32 +436,13 @@ PathPlannerManager::PlannerStatus PathPlannerManager::doPathPlanning()
                     return kArrived; /// < EXIT POINT 
                 }
 
-                /// < generate a bigger traversability map           
-                p_traversability_pcl.reset(new pcl::PointCloud<pcl::PointXYZI>);
-                p_utility_2d_pcl.reset(new pcl::PointCloud<pcl::PointXYZI>);
+                /// < generate a bigger traversability map and organize its points          
                 {
                     boost::recursive_mutex::scoped_lock goal_locker(goal_mutex_);
-                    boost::recursive_mutex::scoped_lock locker(traversability_mutex_);
-                    boost::recursive_mutex::scoped_lock locker_utility(utility_2d_mutex_); 
-
-                    if(b_utility_2d_info_available_)
-                    {
-                        cropTwoPcls((CropBoxMethod)crop_step, 
-                                     robot_position, goal_position_, 
-                                     traversability_pcl_, utility_2d_pcl_,
-                                     p_traversability_pcl, p_utility_2d_pcl);
-                    }
-                    else
-                    {
-                        cropPcl((CropBoxMethod)crop_step, robot_position, goal_position_, traversability_pcl_, p_traversability_pcl);
-                    }
-                    
+                    prepareTraversabilityInput((CropBoxMethod)crop_step, robot_position, goal_position_, p_traversability_pcl, p_utility_2d_pcl, p_traversability_kdtree, p_neighborhood_graph);
                 }
-                // organize cropped traversability points
-                traversability_kdtree.setInputCloud(p_traversability_pcl);
-                
                 
-                int found = traversability_kdtree.nearestKSearch(robot_position, 1, pointIdxNKNSearch, pointNKNSquaredDistance);
+                int found = p_traversability_kdtree->nearestKSearch(robot_position, 1, pointIdxNKNSearch, pointNKNSquaredDistance);
                 if (found < 1)
                 {
                     ROS_WARN("PathPlannerManager::doPathPlanning() - cannot find a close starting node - aborting");
@@ -446,6 +486,7 @@ PathPlannerManager::PlannerStatus PathPlannerManager::doPathPlanning()
     {
         b_found_a_solution_once_ = true; 
         planning_status_ = kSuccess;      
+        smoothPath(path_);
         path_cost_ = computePathLength(path_);
         
         ROS_INFO("PathPlannerManager::doPathPlanning() - path successfully computed - #failed attempts %d, crop step %d", num_failures, crop_step);
@@ -485,6 +526,9 @@ PathPlannerManager::PlannerStatus PathPlannerManager::pathPlanningServiceCallbac
     int num_failures = 0;
     int crop_step = 0;
     
+    p_path_planner_->setAnytimePlanning(0, PathPlanner::PartialPathCallback()); // partial paths are only provided for the robot goal (see doPathPlanning())
+    p_path_planner_->setReservationTable(ReservationTable::Ptr(), reservation_robot_id_); // the service paths are not executed now 
+    
     /// < set start and goal position
     pcl::PointXYZI start_position;
     start_position.x = start.pose.position.x;
@@ -496,42 +540,48 @@ PathPlannerManager::PlannerStatus PathPlannerManager::pathPlanningServiceCallbac
     end_position.y = end.pose.position.y;
     end_position.z = end.pose.position.z;
 
+    /// < check the path cache (the 2D utility is not part of the key: do not cache when it is used)
+    PathCache::Key cache_key;
+    const bool b_use_path_cache = path_cache_.isEnabled() && !b_utility_2d_info_available_ && getPathCacheKey(start_position, end_position, cache_key);
+    if(b_use_path_cache && path_cache_.get(cache_key, path_out, path_cost))
+    {
+        ROS_INFO("PathPlannerManager::pathPlanningServiceCallback() - cached path, path_cost %f, cache hits: %ld, misses: %ld", path_cost, path_cache_.getNumHits(), path_cache_.getNumMisses());
+        return kSuccess; /// < EXIT POINT 
+    }
+    
+    /// < try the hierarchical planner (coarse map + corridor)
+    if(b_use_hierarchical_planning_ && doHierarchicalPathPlanning(start_position, end_position, path_out))
+    {
+        path_cost = computePathLength(path_out);
+        if(b_use_path_cache && !b_abort_) path_cache_.put(cache_key, path_out, path_cost);
+        ROS_INFO("PathPlannerManager::pathPlanningServiceCallback() - path successfully computed by the hierarchical planner, path_cost %f", path_cost);
+        return kSuccess; /// < EXIT POINT 
+    }
+    if(b_abort_)
+    {
+        ROS_INFO("PathPlannerManager::pathPlanningServiceCallback() - path aborted");
+        return kAborted; /// < EXIT POINT 
+    }
+
     /// < prepare intial traversability PCL (needed for computing the starting point )
     pcl::PointCloud<pcl::PointXYZI>::Ptr p_traversability_pcl;
     pcl::PointCloud<pcl::PointXYZI>::Ptr p_utility_2d_pcl;
-    PathPlanner::KdTreeFLANN traversability_kdtree;
+    PathPlanner::KdTreeFLANNConstPtr p_traversability_kdtree;
+    NeighborhoodGraph::ConstPtr p_neighborhood_graph;
 
-    p_traversability_pcl.reset(new pcl::PointCloud<pcl::PointXYZI>);
-    p_utility_2d_pcl.reset(new pcl::PointCloud<pcl::PointXYZI>);
-    {
-        boost::recursive_mutex::scoped_lock locker_traversability(traversability_mutex_);
-        boost::recursive_mutex::scoped_lock locker_utility(utility_2d_mutex_); 
-        
-        if(b_utility_2d_info_available_)
-        {
-            cropTwoPcls((CropBoxMethod)crop_step, 
-                         start_position, end_position, 
-                         traversability_pcl_, utility_2d_pcl_,
-                         p_traversability_pcl, p_utility_2d_pcl);
-        }
-        else
-        {
-            cropPcl((CropBoxMethod)crop_step, start_position, end_position, traversability_pcl_, p_traversability_pcl);
-        }
-    }
+    // crop and organize cropped traversability points
+    prepareTraversabilityInput((CropBoxMethod)crop_step, start_position, end_position, p_traversability_pcl, p_utility_2d_pcl, p_traversability_kdtree, p_neighborhood_graph);
     if(p_traversability_pcl->empty())
     {
         ROS_WARN("PathPlannerManager::pathPlanningServiceCallback() - point cloud empty");
         return kInputFailure; /// < EXIT POINT         
     }
-    // organize cropped traversability points
-    traversability_kdtree.setInputCloud(p_traversability_pcl);
     
     /// < compute starting point on the segmented traversability map 
     std::vector<int> pointIdxNKNSearch(1);
     std::vector<float> pointNKNSquaredDistance(1);
     //int found = traversability_kdtree.nearestKSearch(start_position, 1, pointIdxNKNSearch, pointNKNSquaredDistance);
-    int found = traversability_kdtree.radiusSearch(start_position, PathPlanner::kGoalAcceptCheckThreshold, pointIdxNKNSearch, pointNKNSquaredDistance);
+    int found = p_traversability_kdtree->radiusSearch(start_position, PathPlanner::kGoalAcceptCheckThreshold, pointIdxNKNSearch, pointNKNSquaredDistance);
     if (found < 1)
     {
         ROS_WARN("PathPlannerManager::pathPlanningServiceCallback() - cannot find a close starting node");
@@ -551,8 +601,9 @@ PathPlannerManager::PlannerStatus PathPlannerManager::pathPlanningServiceCallbac
             boost::recursive_mutex::scoped_lock locker(traversability_mutex_);
             boost::recursive_mutex::scoped_lock wall_locker(wall_mutex_);
             boost::recursive_mutex::scoped_lock utility_locker(utility_2d_mutex_);
-            p_path_planner_->setInput(*p_traversability_pcl, *wall_pcl_, wall_kdtree_, traversability_kdtree, pointIdxNKNSearch[0]);
-            if(b_utility_2d_info_available_) p_path_planner_->set2DUtility(*p_utility_2d_pcl);
+            p_path_planner_->setInput(p_traversability_pcl, wall_pcl_, wall_kdtree_, p_traversability_kdtree, pointIdxNKNSearch[0]);
+            if(p_neighborhood_graph) p_path_planner_->setNeighborhoodGraph(p_neighborhood_graph);
+            if(b_utility_2d_info_available_) p_path_planner_->set2DUtility(p_utility_2d_pcl);
         }
         
         /// < set goal and check if close enough to the traversability map
@@ -575,31 +626,10 @@ PathPlannerManager::PlannerStatus PathPlannerManager::pathPlanningServiceCallbac
             if (crop_step < kNumCropBoxMethod)
             {
                 
-                /// < generate a bigger traversability map           
-                p_traversability_pcl.reset(new pcl::PointCloud<pcl::PointXYZI>);
-                p_utility_2d_pcl.reset(new pcl::PointCloud<pcl::PointXYZI>);
-                {
-                    boost::recursive_mutex::scoped_lock locker(traversability_mutex_);
-                    boost::recursive_mutex::scoped_lock locker_utility(utility_2d_mutex_); 
-
-                    if(b_utility_2d_info_available_)
-                    {
-                        cropTwoPcls((CropBoxMethod)crop_step, 
-                                     start_position, end_position, 
-                                     traversability_pcl_, utility_2d_pcl_,
-                                     p_traversability_pcl, p_utility_2d_pcl);
-                    }
-                    else
-                    {
-                        cropPcl((CropBoxMethod)crop_step, start_position, end_position, traversability_pcl_, p_traversability_pcl);
-                    }
-                    
-                }
-                // organize cropped traversability points
-                traversability_kdtree.setInputCloud(p_traversability_pcl);
+                /// < generate a bigger traversability map and organize its points          
+                prepareTraversabilityInput((CropBoxMethod)crop_step, start_position, end_position, p_traversability_pcl, p_utility_2d_pcl, p_traversability_kdtree, p_neighborhood_graph);
                 
-                
-                int found = traversability_kdtree.nearestKSearch(start_position, 1, pointIdxNKNSearch, pointNKNSquaredDistance);
+                int found = p_traversability_kdtree->nearestKSearch(start_position, 1, pointIdxNKNSearch, pointNKNSquaredDistance);
                 if (found < 1)
                 {
                     ROS_WARN("PathPlannerManager::pathPlanningServiceCallback() - cannot find a close starting node - aborting");
@@ -614,6 +644,7 @@ PathPlannerManager::PlannerStatus PathPlannerManager::pathPlanningServiceCallbac
     {
         path_cost = computePathLength(path_out);
         //b_found_a_solution_once_ = true; // not needed here
+        if(b_use_path_cache && !b_abort_) path_cache_.put(cache_key, path_out, path_cost);
         ROS_INFO("PathPlannerManager::pathPlanningServiceCallback() - path successfully computed - #failed attempts %d, crop step %d, path_cost %f", num_failures, crop_step, path_cost);
     }
     else
@@ -626,6 +657,72 @@ PathPlannerManager::PlannerStatus PathPlannerManager::pathPlanningServiceCallbac
     return (b_successful_planning ? kSuccess : kFailure);
 }
 
+PathPlannerManager::PlannerStatus PathPlannerManager::multiGoalPathPlanning(const geometry_msgs::PoseStamped& start, const std::vector<geometry_msgs::PoseStamped>& goals, std::vector<nav_msgs::Path>& paths, std::vector<double>& path_costs)
+{
+    boost::recursive_mutex::scoped_lock path_planning_locker(path_planner_mutex_);
+
+    std::cout << "PathPlannerManager::multiGoalPathPlanning() - num goals: " << goals.size() << std::endl;
+    
+    paths.assign(goals.size(), nav_msgs::Path());
+    path_costs.assign(goals.size(), std::numeric_limits<double>::infinity());
+
+    if (!isReadyForService())
+    {
+        ROS_WARN("PathPlannerManager::multiGoalPathPlanning() - traversability info: %d, wall info: %d", (int) b_traversability_info_available_, (int) b_wall_info_available_);
+        return kNotReady; /// < EXIT POINT 
+    }
+
+    b_abort_ = false; 
+    
+    pcl::PointXYZI start_position;
+    start_position.x = start.pose.position.x;
+    start_position.y = start.pose.position.y;
+    start_position.z = start.pose.position.z;
+    
+    std::vector<pcl::PointXYZI> goal_positions(goals.size());
+    for(size_t i = 0; i < goals.size(); i++)
+    {
+        goal_positions[i].x = goals[i].pose.position.x;
+        goal_positions[i].y = goals[i].pose.position.y;
+        goal_positions[i].z = goals[i].pose.position.z;
+    }
+
+    /// < a single search on the full map: the goals can be anywhere 
+    pcl::PointCloud<pcl::PointXYZI>::Ptr p_traversability_pcl;
+    pcl::PointCloud<pcl::PointXYZI>::Ptr p_utility_2d_pcl;
+    PathPlanner::KdTreeFLANNConstPtr p_traversability_kdtree;
+    NeighborhoodGraph::ConstPtr p_neighborhood_graph;
+    prepareTraversabilityInput(kCropBoxTakeAll, start_position, start_position, p_traversability_pcl, p_utility_2d_pcl, p_traversability_kdtree, p_neighborhood_graph);
+    if(p_traversability_pcl->empty())
+    {
+        ROS_WARN("PathPlannerManager::multiGoalPathPlanning() - point cloud empty");
+        return kInputFailure; /// < EXIT POINT         
+    }
+    
+    std::vector<int> pointIdxNKNSearch(1);
+    std::vector<float> pointNKNSquaredDistance(1);
+    int found = p_traversability_kdtree->radiusSearch(start_position, PathPlanner::kGoalAcceptCheckThreshold, pointIdxNKNSearch, pointNKNSquaredDistance);
+    if (found < 1)
+    {
+        ROS_WARN("PathPlannerManager::multiGoalPathPlanning() - cannot find a close starting node");
+        return kInputFailure; /// < EXIT POINT 
+    }
+    
+    {
+        boost::recursive_mutex::scoped_lock wall_locker(wall_mutex_);
+        boost::recursive_mutex::scoped_lock utility_locker(utility_2d_mutex_);
+        p_path_planner_->setInput(p_traversability_pcl, wall_pcl_, wall_kdtree_, p_traversability_kdtree, pointIdxNKNSearch[0]);
+        if(p_neighborhood_graph) p_path_planner_->setNeighborhoodGraph(p_neighborhood_graph);
+        if(b_utility_2d_info_available_) p_path_planner_->set2DUtility(p_utility_2d_pcl);
+    }
+    
+    const int num_reached_goals = p_path_planner_->planningMultiGoal(goal_positions, paths, path_costs);
+    
+    if(b_abort_) return kAborted; /// < EXIT POINT 
+
+    return ((num_reached_goals > 0) ? kSuccess : kFailure);
+}
+
 bool PathPlannerManager::getRobotPosition(pcl::PointXYZI& robot_position)
 {
     std::cout << "PathPlannerManager::getRobotPosition()" << std::endl;
@@ -870,10 +967,391 @@ void PathPlannerManager::setCostFunctionType(int type, double lamda_trav, double
     boost::recursive_mutex::scoped_lock path_planning_locker(path_planner_mutex_);
     
     p_path_planner_->setCostFunctionType(type, lamda_trav, lambda_aux_utility);
+    p_incremental_planner_->setCostFunctionType(type, lamda_trav, lambda_aux_utility);
+    
+    cost_function_type_ = (BaseCostFunction::CostFunctionType) std::max(std::min(type, (int) BaseCostFunction::kNumCostFunctions - 1), 0);
+    lambda_trav_ = lamda_trav;
+    lambda_aux_utility_ = lambda_aux_utility;
+}
+
+void PathPlannerManager::setOpenSetType(int type, double bucket_resolution)
+{
+    boost::recursive_mutex::scoped_lock path_planning_locker(path_planner_mutex_);
+    
+    p_path_planner_->setOpenSetType(type, bucket_resolution);
+}
+
+void PathPlannerManager::setRandomSeed(unsigned int seed)
+{
+    boost::recursive_mutex::scoped_lock path_planning_locker(path_planner_mutex_);
+    
+    p_path_planner_->setRandomSeed(seed);
+}
+
+void PathPlannerManager::setPathCacheSize(size_t size)
+{
+    path_cache_.setCapacity(size);
+}
+
+void PathPlannerManager::setUseBidirectionalSearch(bool val)
+{
+    boost::recursive_mutex::scoped_lock path_planning_locker(path_planner_mutex_);
+    
+    p_path_planner_->setBidirectionalSearch(val);
+}
+
+void PathPlannerManager::setUseIncrementalPlanning(bool val)
+{
+    boost::recursive_mutex::scoped_lock path_planning_locker(path_planner_mutex_);
+    
+    b_use_incremental_planning_ = val; 
+    if(!val) p_incremental_planner_->reset(); // release the search state 
+}
+
+void PathPlannerManager::setUseHierarchicalPlanning(bool val, double coarse_leaf_size)
+{
+    boost::recursive_mutex::scoped_lock path_planning_locker(path_planner_mutex_);
+    boost::recursive_mutex::scoped_lock traversability_locker(traversability_mutex_);
+    
+    if(coarse_leaf_size >= PathPlanner::kMaxRobotStep)
+    {
+        ROS_WARN("PathPlannerManager::setUseHierarchicalPlanning() - coarse leaf size %f too big, the coarse map would be disconnected: using %f", coarse_leaf_size, kDefaultCoarseLeafSize);
+        coarse_leaf_size = kDefaultCoarseLeafSize;
+    }
+    
+    b_use_hierarchical_planning_ = val; 
+    if(coarse_leaf_size != coarse_leaf_size_)
+    {
+        coarse_leaf_size_ = coarse_leaf_size;
+        traversability_coarse_pcl_.reset(); // rebuilt with the new leaf size 
+        traversability_coarse_kdtree_.reset();
+    }
+}
+
+void PathPlannerManager::setAnytimePlanning(double time_budget_sec, const PathPlanner::PartialPathCallback& callback, double republish_period_sec)
+{
+    boost::recursive_mutex::scoped_lock path_planning_locker(path_planner_mutex_);
+    
+    anytime_time_budget_sec_ = time_budget_sec; 
+    anytime_republish_period_sec_ = republish_period_sec; 
+    anytime_callback_ = callback; 
+}
+
+void PathPlannerManager::setReservationTable(const ReservationTable::Ptr& table, int robot_id, double lambda_reservation, double nominal_speed)
+{
+    boost::recursive_mutex::scoped_lock path_planning_locker(path_planner_mutex_);
+    
+    p_reservation_table_ = table; 
+    reservation_robot_id_ = robot_id; 
+    lambda_reservation_ = lambda_reservation; 
+    nominal_speed_ = nominal_speed; 
+}
+
+void PathPlannerManager::setUsePathSmoothing(bool val, const PathSmoother::Config& config)
+{
+    boost::recursive_mutex::scoped_lock path_planning_locker(path_planner_mutex_);
+    
+    b_use_path_smoothing_ = val; 
+    path_smoother_.setConfig(config);
+}
+
+void PathPlannerManager::smoothPath(nav_msgs::Path& path)
+{
+    boost::recursive_mutex::scoped_lock path_planning_locker(path_planner_mutex_);
+    
+    if(!b_use_path_smoothing_) return; /// < EXIT POINT 
+    
+    {
+        boost::recursive_mutex::scoped_lock traversability_locker(traversability_mutex_);
+        boost::recursive_mutex::scoped_lock wall_locker(wall_mutex_);
+        path_smoother_.setInput(traversability_pcl_, getTraversabilityKdTree(), wall_pcl_, wall_kdtree_);
+    }
+    
+    nav_msgs::Path smoothed_path; 
+    if(path_smoother_.smooth(path, smoothed_path))
+    {
+        const PathSmoother::Stats& stats = path_smoother_.getStats();
+        ROS_INFO("PathPlannerManager::smoothPath() - #knots %lu, #iterations %d, max curvature %f, length %f, duration %f", 
+                 stats.num_knots, stats.num_iterations, stats.max_curvature, stats.length, stats.duration);
+        path.poses.swap(smoothed_path.poses);
+    }
+    else
+    {
+        ROS_WARN("PathPlannerManager::smoothPath() - cannot smooth the path, keeping the planned one");
+    }
+}
+
+void PathPlannerManager::setUseNeighborhoodGraph(bool val)
+{
+    boost::recursive_mutex::scoped_lock traversability_locker(traversability_mutex_);
+    
+    b_use_neighborhood_graph_ = val; 
+    if(!val) traversability_graph_.reset(); // release the memory 
+}
+
+
+void PathPlannerManager::prepareTraversabilityInput(const CropBoxMethod& crop_box_method, 
+                                                    const pcl::PointXYZI& start, const pcl::PointXYZI& goal, 
+                                                    pcl::PointCloud<pcl::PointXYZI>::Ptr& p_traversability_pcl, 
+                                                    pcl::PointCloud<pcl::PointXYZI>::Ptr& p_utility_2d_pcl,
+                                                    PathPlanner::KdTreeFLANNConstPtr& p_traversability_kdtree,
+                                                    NeighborhoodGraph::ConstPtr& p_neighborhood_graph)
+{
+    boost::recursive_mutex::scoped_lock locker_traversability(traversability_mutex_);
+    boost::recursive_mutex::scoped_lock locker_utility(utility_2d_mutex_); 
+    
+    if(crop_box_method == kCropBoxTakeAll)
+    {
+        // share the full map snapshots (no copy)
+        p_traversability_pcl = traversability_pcl_;
+        p_utility_2d_pcl     = utility_2d_pcl_;
+        p_traversability_kdtree = getTraversabilityKdTree();
+        if(b_use_neighborhood_graph_ && !traversability_graph_)
+        {
+            // built once per traversability message and reused until the next one 
+            NeighborhoodGraph::Ptr p_graph(new NeighborhoodGraph);
+            p_graph->build(*traversability_pcl_, *traversability_kdtree_, PathPlanner::kMaxRobotStep, PathPlanner::kMaxRobotStepDeltaZ);
+            std::cout << "PathPlannerManager::prepareTraversabilityInput() - neighborhood graph edges: " << p_graph->getNumEdges() << ", memory: " << p_graph->getMemoryBytes()/(1024*1024) << " MB" << std::endl;
+            traversability_graph_ = p_graph;
+        }
+        p_neighborhood_graph = traversability_graph_;
+        return; /// < EXIT POINT 
+    }
+    
+    p_neighborhood_graph.reset(); // the graph refers to the full map 
+    p_traversability_pcl.reset(new pcl::PointCloud<pcl::PointXYZI>);
+    p_utility_2d_pcl.reset(new pcl::PointCloud<pcl::PointXYZI>);
+    if(b_utility_2d_info_available_)
+    {
+        cropTwoPcls(crop_box_method, 
+                     start, goal, 
+                     traversability_pcl_, utility_2d_pcl_,
+                     p_traversability_pcl, p_utility_2d_pcl);
+    }
+    else
+    {
+        cropPcl(crop_box_method, start, goal, traversability_pcl_, p_traversability_pcl);
+    }
+    
+    // organize cropped traversability points
+    boost::shared_ptr<PathPlanner::KdTreeFLANN> p_kdtree(new PathPlanner::KdTreeFLANN);
+    p_kdtree->setInputCloud(p_traversability_pcl);
+    p_traversability_kdtree = p_kdtree;
+}
+
+PathPlanner::KdTreeFLANNConstPtr PathPlannerManager::getTraversabilityKdTree()
+{
+    boost::recursive_mutex::scoped_lock locker_traversability(traversability_mutex_);
+    
+    if(!traversability_kdtree_)
+    {
+        // built once per traversability message 
+        boost::shared_ptr<PathPlanner::KdTreeFLANN> p_kdtree(new PathPlanner::KdTreeFLANN);
+        p_kdtree->setInputCloud(traversability_pcl_);
+        traversability_kdtree_ = p_kdtree;
+    }
+    return traversability_kdtree_;
+}
+
+bool PathPlannerManager::getPathCacheKey(const pcl::PointXYZI& start, const pcl::PointXYZI& goal, PathCache::Key& key)
+{
+    boost::recursive_mutex::scoped_lock locker_traversability(traversability_mutex_);
+    
+    if(traversability_pcl_->empty()) return false; /// < EXIT POINT 
+    
+    PathPlanner::KdTreeFLANNConstPtr p_kdtree = getTraversabilityKdTree();
+    const float max_squared_dist = PathPlanner::kGoalAcceptCheckThreshold*PathPlanner::kGoalAcceptCheckThreshold;
+    
+    std::vector<int> pointIdxNKNSearch(1);
+    std::vector<float> pointNKNSquaredDistance(1);
+    
+    int found = p_kdtree->nearestKSearch(start, 1, pointIdxNKNSearch, pointNKNSquaredDistance);
+    if( (found < 1) || (pointNKNSquaredDistance[0] > max_squared_dist) ) return false; /// < EXIT POINT 
+    key.start_key = PathCache::getNodeKey((*traversability_pcl_)[pointIdxNKNSearch[0]]);
+    
+    found = p_kdtree->nearestKSearch(goal, 1, pointIdxNKNSearch, pointNKNSquaredDistance);
+    if( (found < 1) || (pointNKNSquaredDistance[0] > max_squared_dist) ) return false; /// < EXIT POINT 
+    key.goal_key = PathCache::getNodeKey((*traversability_pcl_)[pointIdxNKNSearch[0]]);
+    
+    key.map_version = traversability_map_version_;
+    key.cost_function_type = cost_function_type_;
+    key.lambda_trav = lambda_trav_;
+    key.lambda_aux_utility = lambda_aux_utility_;
+    return true;
+}
+
+bool PathPlannerManager::doIncrementalPathPlanning(const pcl::PointXYZI& robot_position)
+{
+    pcl::PointCloud<pcl::PointXYZI>::Ptr p_traversability_pcl;
+    pcl::PointCloud<pcl::PointXYZI>::Ptr p_utility_2d_pcl;
+    PathPlanner::KdTreeFLANNConstPtr p_traversability_kdtree;
+    NeighborhoodGraph::ConstPtr p_neighborhood_graph;
+    prepareTraversabilityInput(kCropBoxTakeAll, robot_position, goal_position_, p_traversability_pcl, p_utility_2d_pcl, p_traversability_kdtree, p_neighborhood_graph);
+    if(!p_neighborhood_graph)
+    {
+        ROS_WARN("PathPlannerManager::doIncrementalPathPlanning() - the neighborhood graph is required (see use_neighborhood_graph)");
+        return false; /// < EXIT POINT 
+    }
+    
+    {
+        boost::recursive_mutex::scoped_lock wall_locker(wall_mutex_);
+        if(!p_incremental_planner_->setMap(p_traversability_pcl, p_neighborhood_graph, wall_kdtree_)) return false; /// < EXIT POINT 
+    }
+    
+    std::vector<int> pointIdxNKNSearch(1);
+    std::vector<float> pointNKNSquaredDistance(1);
+    
+    /// < goal node: it must be close enough to the traversability map (as in PathPlanner::setGoal())
+    int found = p_traversability_kdtree->nearestKSearch(goal_position_, 1, pointIdxNKNSearch, pointNKNSquaredDistance);
+    if( (found < 1) || (pointNKNSquaredDistance[0] > PathPlanner::kGoalAcceptCheckThreshold*PathPlanner::kGoalAcceptCheckThreshold) )
+    {
+        ROS_WARN("PathPlannerManager::doIncrementalPathPlanning() - cannot find a close goal node");
+        return false; /// < EXIT POINT 
+    }
+    const int goal_idx = pointIdxNKNSearch[0];
+    p_incremental_planner_->setGoal((*p_traversability_pcl)[goal_idx], goal_idx);
+    
+    /// < start node (same HACK of doPathPlanning(): the distance is not checked)
+    found = p_traversability_kdtree->nearestKSearch(robot_position, 1, pointIdxNKNSearch, pointNKNSquaredDistance);
+    if (found < 1)
+    {
+        ROS_WARN("PathPlannerManager::doIncrementalPathPlanning() - cannot find a close starting node");
+        return false; /// < EXIT POINT 
+    }
+    
+    return p_incremental_planner_->planning(pointIdxNKNSearch[0], path_);
+}
+
+void PathPlannerManager::getCoarseTraversability(pcl::PointCloud<pcl::PointXYZI>::Ptr& p_coarse_pcl, PathPlanner::KdTreeFLANNConstPtr& p_coarse_kdtree)
+{
+    boost::recursive_mutex::scoped_lock locker_traversability(traversability_mutex_);
+    
+    if(!traversability_coarse_pcl_)
+    {
+        // built once per traversability message 
+        pcl::PointCloud<pcl::PointXYZI>::Ptr p_pcl(new pcl::PointCloud<pcl::PointXYZI>);
+        voxelGridDownsample(*traversability_pcl_, *p_pcl, coarse_leaf_size_);
+        boost::shared_ptr<PathPlanner::KdTreeFLANN> p_kdtree(new PathPlanner::KdTreeFLANN);
+        if(!p_pcl->empty()) p_kdtree->setInputCloud(p_pcl);
+        traversability_coarse_pcl_ = p_pcl;
+        traversability_coarse_kdtree_ = p_kdtree;
+        std::cout << "PathPlannerManager::getCoarseTraversability() - coarse pcl size: " << p_pcl->size() << " (full: " << traversability_pcl_->size() << ")" << std::endl;
+    }
+    p_coarse_pcl = traversability_coarse_pcl_;
+    p_coarse_kdtree = traversability_coarse_kdtree_;
+}
+
+bool PathPlannerManager::doHierarchicalPathPlanning(const pcl::PointXYZI& start, const pcl::PointXYZI& goal, nav_msgs::Path& path_out)
+{
+    std::vector<int> pointIdxNKNSearch(1);
+    std::vector<float> pointNKNSquaredDistance(1);
+    
+    /// < coarse level: plan on the voxel-downsampled map (the 2D utility is not used here)
+    pcl::PointCloud<pcl::PointXYZI>::Ptr p_coarse_pcl;
+    PathPlanner::KdTreeFLANNConstPtr p_coarse_kdtree;
+    getCoarseTraversability(p_coarse_pcl, p_coarse_kdtree);
+    if(p_coarse_pcl->empty()) return false; /// < EXIT POINT 
+    
+    int found = p_coarse_kdtree->nearestKSearch(start, 1, pointIdxNKNSearch, pointNKNSquaredDistance);
+    if (found < 1)
+    {
+        ROS_WARN("PathPlannerManager::doHierarchicalPathPlanning() - cannot find a close coarse starting node");
+        return false; /// < EXIT POINT 
+    }
+    
+    {
+        boost::recursive_mutex::scoped_lock wall_locker(wall_mutex_);
+        p_path_planner_->setInput(p_coarse_pcl, wall_pcl_, wall_kdtree_, p_coarse_kdtree, pointIdxNKNSearch[0]);
+    }
+    
+    nav_msgs::Path coarse_path;
+    if( !p_path_planner_->setGoal(goal) || !p_path_planner_->planning(coarse_path) )
+    {
+        ROS_INFO("PathPlannerManager::doHierarchicalPathPlanning() - coarse planning failed");
+        return false; /// < EXIT POINT 
+    }
+    
+    /// < fine level: plan on the full resolution points inside the corridor around the coarse path 
+    geometry_msgs::PoseStamped pose;
+    pose.pose.position.x = start.x; pose.pose.position.y = start.y; pose.pose.position.z = start.z;
+    coarse_path.poses.push_back(pose);
+    pose.pose.position.x = goal.x; pose.pose.position.y = goal.y; pose.pose.position.z = goal.z;
+    coarse_path.poses.push_back(pose);
+    
+    pcl::PointCloud<pcl::PointXYZI>::Ptr p_traversability_pcl(new pcl::PointCloud<pcl::PointXYZI>);
+    pcl::PointCloud<pcl::PointXYZI>::Ptr p_utility_2d_pcl(new pcl::PointCloud<pcl::PointXYZI>);
+    bool b_use_utility_2d = false;
+    {
+        boost::recursive_mutex::scoped_lock locker_traversability(traversability_mutex_);
+        boost::recursive_mutex::scoped_lock locker_utility(utility_2d_mutex_);
+        b_use_utility_2d = b_utility_2d_info_available_ && (utility_2d_pcl_->size() == traversability_pcl_->size());
+        cropCorridorPcl(coarse_path, kCorridorCellSize, traversability_pcl_, (b_use_utility_2d ? utility_2d_pcl_ : pcl::PointCloud<pcl::PointXYZI>::Ptr()), p_traversability_pcl, p_utility_2d_pcl);
+    }
+    if(p_traversability_pcl->empty()) return false; /// < EXIT POINT 
+    
+    boost::shared_ptr<PathPlanner::KdTreeFLANN> p_kdtree(new PathPlanner::KdTreeFLANN);
+    p_kdtree->setInputCloud(p_traversability_pcl);
+    
+    found = p_kdtree->nearestKSearch(start, 1, pointIdxNKNSearch, pointNKNSquaredDistance);
+    if (found < 1)
+    {
+        ROS_WARN("PathPlannerManager::doHierarchicalPathPlanning() - cannot find a close starting node");
+        return false; /// < EXIT POINT 
+    }
+    
+    {
+        boost::recursive_mutex::scoped_lock wall_locker(wall_mutex_);
+        p_path_planner_->setInput(p_traversability_pcl, wall_pcl_, wall_kdtree_, p_kdtree, pointIdxNKNSearch[0]);
+        if(b_use_utility_2d) p_path_planner_->set2DUtility(p_utility_2d_pcl);
+    }
+    
+    if( !p_path_planner_->setGoal(goal) || !p_path_planner_->planning(path_out) )
+    {
+        ROS_INFO("PathPlannerManager::doHierarchicalPathPlanning() - corridor planning failed (coarse path poses: %ld, corridor size: %ld)", coarse_path.poses.size(), p_traversability_pcl->size());
+        return false; /// < EXIT POINT 
+    }
+    
+    std::cout << "PathPlannerManager::doHierarchicalPathPlanning() - coarse pcl size: " << p_coarse_pcl->size() << ", corridor pcl size: " << p_traversability_pcl->size() << std::endl;
+    return true;
 }
 
+void PathPlannerManager::cropCorridorPcl(const nav_msgs::Path& path, float cell_size,
+                                         const pcl::PointCloud<pcl::PointXYZI>::Ptr pcl_in, 
+                                         const pcl::PointCloud<pcl::PointXYZI>::Ptr pcl_in2,
+                                         pcl::PointCloud<pcl::PointXYZI>::Ptr pcl_out, 
+                                         pcl::PointCloud<pcl::PointXYZI>::Ptr pcl_out2)
+{
+    /// < collect the cells crossed by the path together with their neighbors 
+    std::unordered_set<uint64_t> corridor_cells;
+    pcl::PointXYZI p;
+    for(size_t i = 0; i < path.poses.size(); i++)
+    {
+        for (int dx = -1; dx <= 1; dx++)
+            for (int dy = -1; dy <= 1; dy++)
+                for (int dz = -1; dz <= 1; dz++)
+                {
+                    p.x = path.poses[i].pose.position.x + dx*cell_size;
+                    p.y = path.poses[i].pose.position.y + dy*cell_size;
+                    p.z = path.poses[i].pose.position.z + dz*cell_size;
+                    corridor_cells.insert(voxelBinaryKey(p, cell_size));
+                }
+    }
+    
+    /// < keep the points inside the corridor (and the corresponding points of the second cloud)
+    const bool b_second_pcl = pcl_in2 && (pcl_in2->size() == pcl_in->size());
+    pcl_out->clear();
+    if(pcl_out2) pcl_out2->clear();
+    for(size_t i = 0; i < pcl_in->size(); i++)
+    {
+        if(!corridor_cells.count(voxelBinaryKey((*pcl_in)[i], cell_size))) continue;
+        pcl_out->push_back((*pcl_in)[i]);
+        if(b_second_pcl && pcl_out2) pcl_out2->push_back((*pcl_in2)[i]);
+    }
+    pcl_out->header = pcl_in->header;
+    if(b_second_pcl && pcl_out2) pcl_out2->header = pcl_in2->header;
+}
 
-double PathPlannerManager::computePathLength(nav_msgs::Path& path)
+double PathPlannerManager::computePathLength(const nav_msgs::Path& path)
 {
     double d_estimated_distance_ = 0;
     int input_path_length = path.poses.size();
@@ -0,0 +1,329 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "PathSmoother.h"
+
+#include <tf/tf.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+PathSmoother::Config::Config()
+{
+    knot_spacing = 1.0;                 // [m]
+    sample_step = 0.1;                  // [m]
+    max_curvature = 2.0;                // [1/m]
+    max_traversability_distance = 0.15; // [m]
+    min_wall_clearance = 0.3;           // [m]
+    max_velocity = PathPlanner::kDefaultNominalSpeed; // [m/s]
+    max_acceleration = 0.3;             // [m/s^2]
+    max_lateral_acceleration = 0.3;     // [m/s^2]
+    max_angular_velocity = 0.6;         // [rad/s]
+    max_iterations = 50;
+}
+
+PathSmoother::PathSmoother(const Config& config):config_(config)
+{
+    stats_ = Stats();
+}
+
+void PathSmoother::setInput(const pcl::PointCloud<pcl::PointXYZI>::ConstPtr& traversability_pcl, const PathPlanner::KdTreeFLANNConstPtr& traversability_kdtree,
+                            const pcl::PointCloud<pcl::PointXYZRGBNormal>::ConstPtr& wall_pcl, const PathPlanner::WallKdTreeFLANNConstPtr& wall_kdtree)
+{
+    traversability_pcl_ = traversability_pcl;
+    traversability_kdtree_ = traversability_kdtree;
+    wall_pcl_ = wall_pcl;
+    wall_kdtree_ = wall_kdtree;
+}
+
+bool PathSmoother::isTraversable(const Eigen::Vector3d& p) const
+{
+    pcl::PointXYZI point;
+    point.x = p.x(); point.y = p.y(); point.z = p.z();
+    std::vector<int> indices(1);
+    std::vector<float> squared_distances(1);
+    if (traversability_kdtree_->nearestKSearch(point, 1, indices, squared_distances) < 1) return false; /// < EXIT POINT
+    return squared_distances[0] <= config_.max_traversability_distance*config_.max_traversability_distance;
+}
+
+double PathSmoother::getWallClearance(const Eigen::Vector3d& p) const
+{
+    if (!wall_kdtree_ || !wall_pcl_ || wall_pcl_->empty()) return std::numeric_limits<double>::infinity(); /// < EXIT POINT
+
+    pcl::PointXYZRGBNormal point;
+    point.x = p.x(); point.y = p.y(); point.z = p.z();
+    std::vector<int> indices(1);
+    std::vector<float> squared_distances(1);
+    if (wall_kdtree_->nearestKSearch(point, 1, indices, squared_distances) < 1) return std::numeric_limits<double>::infinity(); /// < EXIT POINT
+    return sqrt(squared_distances[0]);
+}
+
+void PathSmoother::fitSpline(const std::vector<Eigen::Vector3d>& knots, std::vector<Sample>& samples) const
+{
+    const size_t m = knots.size() - 1; // number of spans
+
+    // chord-length parameterization
+    std::vector<double> h(m);
+    for (size_t j = 0; j < m; j++) h[j] = std::max((knots[j + 1] - knots[j]).norm(), 1e-6);
+
+    // second derivatives of the natural spline (zero at the ends): tridiagonal system solved with the Thomas algorithm
+    std::vector<Eigen::Vector3d> M(m + 1, Eigen::Vector3d::Zero());
+    if (m > 1)
+    {
+        std::vector<double> c(m + 1, 0.);
+        std::vector<Eigen::Vector3d> d(m + 1, Eigen::Vector3d::Zero());
+        for (size_t j = 1; j < m; j++)
+        {
+            const double a = h[j - 1];
+            const double b = 2.*(h[j - 1] + h[j]);
+            const Eigen::Vector3d r = 6.*((knots[j + 1] - knots[j])/h[j] - (knots[j] - knots[j - 1])/h[j - 1]);
+            const double denominator = b - a*c[j - 1];
+            c[j] = h[j]/denominator;
+            d[j] = (r - a*d[j - 1])/denominator;
+        }
+        for (size_t j = m - 1; j >= 1; j--)
+        {
+            M[j] = d[j] - c[j]*M[j + 1];
+        }
+    }
+
+    samples.clear();
+    const double step = std::max(config_.sample_step, 1e-3);
+    for (size_t j = 0; j < m; j++)
+    {
+        const int num_steps = std::max((int) ceil(h[j]/step), 1);
+        const int k_end = (j + 1 == m) ? num_steps : num_steps - 1; // the last span also includes its end
+        const Eigen::Vector3d A = knots[j]/h[j] - M[j]*h[j]/6.;
+        const Eigen::Vector3d B = knots[j + 1]/h[j] - M[j + 1]*h[j]/6.;
+        for (int k = 0; k <= k_end; k++)
+        {
+            const double u1 = h[j]*k/num_steps; // u - u_j
+            const double u0 = h[j] - u1;        // u_{j+1} - u
+            Sample sample;
+            sample.position = M[j]*(u0*u0*u0)/(6.*h[j]) + M[j + 1]*(u1*u1*u1)/(6.*h[j]) + A*u0 + B*u1;
+            const Eigen::Vector3d d1 = -M[j]*(u0*u0)/(2.*h[j]) + M[j + 1]*(u1*u1)/(2.*h[j]) - A + B;
+            const Eigen::Vector3d d2 = (M[j]*u0 + M[j + 1]*u1)/h[j];
+            const double speed2 = d1.x()*d1.x() + d1.y()*d1.y();
+            sample.yaw = atan2(d1.y(), d1.x());
+            sample.curvature = (speed2 > 1e-12) ? (d1.x()*d2.y() - d1.y()*d2.x())/(speed2*sqrt(speed2)) : 0.;
+            sample.s = samples.empty() ? 0. : samples.back().s + (sample.position - samples.back().position).norm();
+            sample.span = (int) j;
+            samples.push_back(sample);
+        }
+    }
+}
+
+void PathSmoother::computeTiming(const std::vector<Sample>& samples, std::vector<double>& times) const
+{
+    const size_t n = samples.size();
+    const double max_acceleration = std::max(config_.max_acceleration, 1e-3);
+
+    // velocity limits along the curve
+    std::vector<double> v(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        v[i] = config_.max_velocity;
+        const double curvature = fabs(samples[i].curvature);
+        if (curvature > 1e-6)
+        {
+            v[i] = std::min(v[i], std::min(sqrt(config_.max_lateral_acceleration/curvature), config_.max_angular_velocity/curvature));
+        }
+    }
+
+    // acceleration limits: start and stop at rest
+    v[0] = 0.;
+    v[n - 1] = 0.;
+    for (size_t i = 1; i < n; i++)
+    {
+        v[i] = std::min(v[i], sqrt(v[i - 1]*v[i - 1] + 2.*max_acceleration*(samples[i].s - samples[i - 1].s)));
+    }
+    for (size_t i = n - 1; i > 0; i--)
+    {
+        v[i - 1] = std::min(v[i - 1], sqrt(v[i]*v[i] + 2.*max_acceleration*(samples[i].s - samples[i - 1].s)));
+    }
+
+    times.resize(n);
+    times[0] = 0.;
+    for (size_t i = 1; i < n; i++)
+    {
+        const double ds = samples[i].s - samples[i - 1].s;
+        const double v_sum = v[i - 1] + v[i];
+        times[i] = times[i - 1] + ((v_sum > 1e-9) ? 2.*ds/v_sum : 0.);
+    }
+}
+
+bool PathSmoother::smooth(const nav_msgs::Path& path_in, nav_msgs::Path& path_out)
+{
+    stats_ = Stats();
+
+    if (!traversability_kdtree_) return false; /// < EXIT POINT
+
+    // path nodes without duplicates
+    std::vector<Eigen::Vector3d> nodes;
+    nodes.reserve(path_in.poses.size());
+    for (size_t i = 0; i < path_in.poses.size(); i++)
+    {
+        const geometry_msgs::Point& position = path_in.poses[i].pose.position;
+        const Eigen::Vector3d node(position.x, position.y, position.z);
+        if (nodes.empty() || (node - nodes.back()).norm() > 1e-3) nodes.push_back(node);
+    }
+    if (nodes.size() < 3) return false; /// < EXIT POINT (nothing to smooth)
+
+    const size_t n = nodes.size();
+    std::vector<double> node_s(n, 0.);
+    std::vector<double> node_clearance(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        if (i > 0) node_s[i] = node_s[i - 1] + (nodes[i] - nodes[i - 1]).norm();
+        node_clearance[i] = getWallClearance(nodes[i]);
+    }
+
+    // initial knots (indices of the nodes) every knot_spacing meters; pinned knots cannot be removed
+    std::vector<int> knot_idx(1, 0);
+    std::vector<bool> pinned(1, true);
+    for (size_t i = 1; i + 1 < n; i++)
+    {
+        if ((node_s[i] - node_s[knot_idx.back()] >= config_.knot_spacing) && (node_s[n - 1] - node_s[i] >= 0.5*config_.knot_spacing))
+        {
+            knot_idx.push_back(i);
+            pinned.push_back(false);
+        }
+    }
+    knot_idx.push_back(n - 1);
+    pinned.push_back(true);
+
+    std::vector<Sample> samples;
+    std::vector<Eigen::Vector3d> knots;
+    bool b_valid = false;
+    for (stats_.num_iterations = 0; (stats_.num_iterations <= config_.max_iterations) && !b_valid; stats_.num_iterations++)
+    {
+        knots.resize(knot_idx.size());
+        for (size_t j = 0; j < knot_idx.size(); j++) knots[j] = nodes[knot_idx[j]];
+        fitSpline(knots, samples);
+
+        // the clearance required in each span: the one of config or the one of the planned path there, if smaller
+        const size_t num_spans = knot_idx.size() - 1;
+        std::vector<double> required_clearance(num_spans, config_.min_wall_clearance);
+        for (size_t j = 0; j < num_spans; j++)
+        {
+            for (int i = knot_idx[j]; i <= knot_idx[j + 1]; i++) required_clearance[j] = std::min(required_clearance[j], node_clearance[i] - 1e-3);
+        }
+
+        std::vector<bool> span_blocked(num_spans, false);
+        bool b_blocked = false;
+        size_t worst_sample = 0;
+        stats_.max_curvature = 0;
+        for (size_t k = 0; k < samples.size(); k++)
+        {
+            const Sample& sample = samples[k];
+            if (fabs(sample.curvature) > stats_.max_curvature)
+            {
+                stats_.max_curvature = fabs(sample.curvature);
+                worst_sample = k;
+            }
+            if (span_blocked[sample.span]) continue; /// < CONTINUE
+            if (!isTraversable(sample.position) || (getWallClearance(sample.position) < required_clearance[sample.span]))
+            {
+                span_blocked[sample.span] = true;
+                b_blocked = true;
+            }
+        }
+
+        if (b_blocked)
+        {
+            // follow the planned path more closely: add the node halfway between the knots of each blocked span
+            std::vector<int> new_knot_idx(1, knot_idx[0]);
+            std::vector<bool> new_pinned(1, pinned[0]);
+            for (size_t j = 0; j < num_spans; j++)
+            {
+                if (span_blocked[j])
+                {
+                    if (knot_idx[j + 1] - knot_idx[j] < 2)
+                    {
+                        ROS_WARN("PathSmoother::smooth() - the clearance cannot be met between nodes %d and %d", knot_idx[j], knot_idx[j + 1]);
+                        return false; /// < EXIT POINT
+                    }
+                    new_knot_idx.push_back((knot_idx[j] + knot_idx[j + 1])/2);
+                    new_pinned.push_back(true);
+                }
+                new_knot_idx.push_back(knot_idx[j + 1]);
+                new_pinned.push_back(pinned[j + 1]);
+            }
+            knot_idx.swap(new_knot_idx);
+            pinned.swap(new_pinned);
+        }
+        else if (stats_.max_curvature > config_.max_curvature)
+        {
+            // widen the turn: remove the closest knot of the span with the max curvature which was not added for clearance
+            const int j = samples[worst_sample].span;
+            int removed = -1;
+            double min_dist = std::numeric_limits<double>::max();
+            for (int c = j; c <= j + 1; c++)
+            {
+                const double dist = (knots[c] - samples[worst_sample].position).norm();
+                if (!pinned[c] && (dist < min_dist))
+                {
+                    min_dist = dist;
+                    removed = c;
+                }
+            }
+            if (removed < 0)
+            {
+                ROS_WARN("PathSmoother::smooth() - the max curvature %f cannot be met (%f)", config_.max_curvature, stats_.max_curvature);
+                return false; /// < EXIT POINT
+            }
+            knot_idx.erase(knot_idx.begin() + removed);
+            pinned.erase(pinned.begin() + removed);
+        }
+        else
+        {
+            b_valid = true;
+        }
+    }
+    if (!b_valid)
+    {
+        ROS_WARN("PathSmoother::smooth() - no valid spline after %d iterations", config_.max_iterations);
+        return false; /// < EXIT POINT
+    }
+
+    std::vector<double> times;
+    computeTiming(samples, times);
+
+    stats_.num_knots = knot_idx.size();
+    stats_.length = samples.back().s;
+    stats_.duration = times.back();
+
+    const ros::Time start_time = path_in.header.stamp.isZero() ? ros::Time::now() : path_in.header.stamp;
+    path_out.header = path_in.header;
+    path_out.poses.resize(samples.size());
+    for (size_t k = 0; k < samples.size(); k++)
+    {
+        geometry_msgs::PoseStamped& pose = path_out.poses[k];
+        pose.header.frame_id = path_in.header.frame_id.empty() ? path_in.poses[0].header.frame_id : path_in.header.frame_id;
+        pose.header.stamp = start_time + ros::Duration(times[k]);
+        pose.pose.position.x = samples[k].position.x();
+        pose.pose.position.y = samples[k].position.y();
+        pose.pose.position.z = samples[k].position.z();
+        pose.pose.orientation = tf::createQuaternionMsgFromYaw(samples[k].yaw);
+    }
+    return true;
+}
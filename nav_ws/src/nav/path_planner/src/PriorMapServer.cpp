@@ -0,0 +1,351 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "PriorMapServer.h"
+
+#include <sys/stat.h>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+#include <functional>
+#include <algorithm>
+
+#include <pcl/io/pcd_io.h>
+#include <pcl/io/ply_io.h>
+#include <pcl/filters/voxel_grid.h>
+#include <pcl/filters/filter.h>
+#include <pcl_conversions/pcl_conversions.h>
+
+#include "KdTreeFLANN.h"
+#include "PriorMapClient.h"
+
+
+const char* PriorMapServer::kLayerNames[] = {"map", "map_coarse", "wall", "no_wall", "traversability"};
+const size_t PriorMapServer::kNumLayers = sizeof(PriorMapServer::kLayerNames)/sizeof(PriorMapServer::kLayerNames[0]);
+
+const double PriorMapServer::kDefaultLeafSize = 0.1;       // [m]
+const double PriorMapServer::kDefaultCoarseLeafSize = 0.4; // [m]
+
+template<typename T>
+static T getParam(ros::NodeHandle& n, const std::string& name, const T& defaultValue)
+{
+    T v;
+    if (n.getParam(name, v))
+    {
+        ROS_INFO_STREAM("Found parameter: " << name << ", value: " << v);
+        return v;
+    }
+    else
+    {
+        ROS_WARN_STREAM("Cannot find value for parameter: " << name << ", assigning default: " << defaultValue);
+    }
+    return defaultValue;
+}
+
+PriorMapServer::PriorMapServer(ros::NodeHandle& n):n_(n)
+{
+    /// < get parameters
+    map_file_           = getParam<std::string>(n_, "map_file", std::string());
+    frame_id_           = getParam<std::string>(n_, "frame", "map");
+    const char* home    = getenv("HOME");
+    cache_root_         = getParam<std::string>(n_, "cache_dir", std::string(home ? home : ".") + "/.ros/prior_map_cache");
+    b_rebuild_cache_    = getParam<bool>(n_, "rebuild_cache", false);
+    b_use_shared_memory_= getParam<bool>(n_, "use_shared_memory", true);
+    leaf_size_          = getParam<double>(n_, "leaf_size", kDefaultLeafSize);
+    coarse_leaf_size_   = getParam<double>(n_, "coarse_leaf_size", kDefaultCoarseLeafSize);
+    robot_radius_       = getParam<double>(n_, "robot_radius", TravAnalyzer::kRobotRadiusDefault);
+    viewpoint_.x        = getParam<double>(n_, "viewpoint_x", 0.);
+    viewpoint_.y        = getParam<double>(n_, "viewpoint_y", 0.);
+    viewpoint_.z        = getParam<double>(n_, "viewpoint_z", 1.);
+
+    trav_analyzer_.setRobotRadius(robot_radius_);
+
+    /// < the same configs of the traversability and compute_normals nodes (the callbacks are called once with the parameters)
+    clustering_config_server_.reset(new dynamic_reconfigure::Server<ClusterPclConfig>(ros::NodeHandle(n_, "ClusteringPcl")));
+    clustering_config_server_->setCallback(boost::bind(&PriorMapServer::clusteringConfigCallback, this, _1, _2));
+    trav_config_server_.reset(new dynamic_reconfigure::Server<TravAnalyzerConfig>(ros::NodeHandle(n_, "TravAnal")));
+    trav_config_server_->setCallback(boost::bind(&PriorMapServer::travConfigCallback, this, _1, _2));
+    normal_config_server_.reset(new dynamic_reconfigure::Server<NormalEstimationPclConfig>(ros::NodeHandle(n_, "NormalEstimationPcl")));
+    normal_config_server_->setCallback(boost::bind(&PriorMapServer::normalConfigCallback, this, _1, _2));
+}
+
+PriorMapServer::~PriorMapServer()
+{
+    for (std::map<std::string, std::string>::const_iterator it = shared_memory_names_.begin(); it != shared_memory_names_.end(); ++it)
+    {
+        PriorMapSharedMemory::remove(it->second);
+    }
+}
+
+bool PriorMapServer::init()
+{
+    if (map_file_.empty())
+    {
+        ROS_ERROR("PriorMapServer::init() - no map_file");
+        return false; /// < EXIT POINT
+    }
+
+    const std::string cache_dir = getCacheDir();
+    if (b_rebuild_cache_ || !loadCache(cache_dir))
+    {
+        PointCloudT map_pcl;
+        bool b_has_normals = false;
+        if (!loadMapFile(map_pcl, b_has_normals)) return false; /// < EXIT POINT
+
+        ros::Time time_start = ros::Time::now();
+        computeLayers(map_pcl, b_has_normals);
+        ROS_INFO_STREAM("PriorMapServer::init() - layers computed in " << (ros::Time::now() - time_start).toSec() << " s");
+
+        saveCache(cache_dir);
+    }
+
+    /// < shared memory: one segment per layer, named after the node namespace (several robots can run on the same host)
+    if (b_use_shared_memory_)
+    {
+        std::string prefix = "prior_map" + n_.getNamespace();
+        std::replace(prefix.begin(), prefix.end(), '/', '_');
+        for (std::map<std::string, sensor_msgs::PointCloud2>::const_iterator it = layers_.begin(); it != layers_.end(); ++it)
+        {
+            const std::string name = prefix + "_" + it->first;
+            if (PriorMapSharedMemory::write(name, it->second))
+            {
+                shared_memory_names_[it->first] = name;
+            }
+        }
+    }
+
+    publishLayers();
+    service_ = n_.advertiseService("get_prior_map", &PriorMapServer::getPriorMapServiceCallback, this);
+    return true;
+}
+
+bool PriorMapServer::loadMapFile(PointCloudT& map_pcl, bool& b_has_normals)
+{
+    pcl::PCLPointCloud2 cloud;
+    int res = -1;
+    if (map_file_.find(".ply") != std::string::npos)
+    {
+        res = pcl::io::loadPLYFile(map_file_, cloud);
+    }
+    else
+    {
+        res = pcl::io::loadPCDFile(map_file_, cloud);
+    }
+    if (res < 0)
+    {
+        ROS_ERROR_STREAM("PriorMapServer::loadMapFile() - cannot load " << map_file_);
+        return false; /// < EXIT POINT
+    }
+
+    b_has_normals = false;
+    for (size_t i = 0; i < cloud.fields.size(); i++)
+    {
+        if (cloud.fields[i].name == "normal_x") b_has_normals = true;
+    }
+    pcl::fromPCLPointCloud2(cloud, map_pcl);
+    map_pcl.header.frame_id = frame_id_;
+
+    ROS_INFO_STREAM("PriorMapServer::loadMapFile() - loaded " << map_pcl.size() << " points from " << map_file_ << (b_has_normals ? " (with normals)" : ""));
+    return true;
+}
+
+template<typename PointT>
+void PriorMapServer::setLayer(const std::string& name, const pcl::PointCloud<PointT>& pcl)
+{
+    sensor_msgs::PointCloud2& layer = layers_[name];
+    pcl::toROSMsg(pcl, layer);
+    layer.header.frame_id = frame_id_;
+}
+
+void PriorMapServer::computeLayers(PointCloudT& map_pcl, bool b_has_normals)
+{
+    /// < downsample
+    PointCloudT::Ptr p_map_pcl(new PointCloudT());
+    pcl::VoxelGrid<pcl::PointXYZRGBNormal> voxel_grid;
+    voxel_grid.setInputCloud(map_pcl.makeShared());
+    voxel_grid.setLeafSize(leaf_size_, leaf_size_, leaf_size_);
+    voxel_grid.filter(*p_map_pcl);
+
+    /// < normals (the voxel grid averages the normals of the file, if any)
+    if (!b_has_normals)
+    {
+        pp::KdTreeFLANN<pcl::PointXYZRGBNormal> kdtree;
+        kdtree.setInputCloud(p_map_pcl);
+        normal_estimator_.computeNormals(*p_map_pcl, kdtree, viewpoint_);
+    }
+    PointCloudT dyn_pcl;
+    std::vector<int> index;
+    pcl::removeNaNNormalsFromPointCloud(*p_map_pcl, dyn_pcl, index);
+    setLayer("map", dyn_pcl);
+
+    PointCloudT coarse_pcl;
+    voxel_grid.setInputCloud(dyn_pcl.makeShared());
+    voxel_grid.setLeafSize(coarse_leaf_size_, coarse_leaf_size_, coarse_leaf_size_);
+    voxel_grid.filter(coarse_pcl);
+    setLayer("map_coarse", coarse_pcl);
+
+    /// < clustering and traversability, as in the traversability node
+    PointCloudT nowall_pcl, border_pcl, segmented_pcl, wall_pcl;
+    std::vector<int> cluster_info;
+    clustering_pcl_.setInputPcl(dyn_pcl);
+    clustering_pcl_.clustering(nowall_pcl, border_pcl, segmented_pcl, wall_pcl);
+    clustering_pcl_.getClusterInfo(cluster_info);
+    setLayer("wall", wall_pcl);
+    setLayer("no_wall", nowall_pcl);
+
+    TravAnalyzer::PointCloudI traversability_pcl;
+    trav_analyzer_.setInput(cluster_info, wall_pcl, nowall_pcl);
+    trav_analyzer_.computeTrav(traversability_pcl);
+    setLayer("traversability", traversability_pcl);
+}
+
+std::string PriorMapServer::getCacheDir() const
+{
+    // the key changes with the map file (path, size, modification time) and the parameters of the layers
+    struct stat file_stat;
+    std::memset(&file_stat, 0, sizeof(file_stat));
+    stat(map_file_.c_str(), &file_stat);
+
+    std::stringstream key;
+    key << map_file_ << "|" << file_stat.st_size << "|" << file_stat.st_mtime << "|" << leaf_size_ << "|" << coarse_leaf_size_ << "|"
+        << robot_radius_ << "|" << viewpoint_.x << "," << viewpoint_.y << "," << viewpoint_.z;
+
+    const size_t slash = map_file_.find_last_of('/');
+    const std::string base_name = (slash == std::string::npos) ? map_file_ : map_file_.substr(slash + 1);
+
+    std::stringstream dir;
+    dir << cache_root_ << "/" << base_name << "_" << std::hex << std::hash<std::string>()(key.str());
+    return dir.str();
+}
+
+bool PriorMapServer::loadCache(const std::string& dir)
+{
+    for (size_t i = 0; i < kNumLayers; i++)
+    {
+        pcl::PCLPointCloud2 cloud;
+        const std::string file = dir + "/" + kLayerNames[i] + ".pcd";
+        struct stat file_stat;
+        if ((stat(file.c_str(), &file_stat) != 0) || (pcl::io::loadPCDFile(file, cloud) < 0))
+        {
+            layers_.clear();
+            return false; /// < EXIT POINT
+        }
+        sensor_msgs::PointCloud2& layer = layers_[kLayerNames[i]];
+        pcl_conversions::moveFromPCL(cloud, layer);
+        layer.header.frame_id = frame_id_;
+    }
+    ROS_INFO_STREAM("PriorMapServer::loadCache() - loaded the layers from " << dir);
+    return true;
+}
+
+void PriorMapServer::saveCache(const std::string& dir) const
+{
+    const int res_command = system(("mkdir -p " + dir).c_str());
+    if (res_command != 0)
+    {
+        ROS_WARN_STREAM("PriorMapServer::saveCache() - cannot create " << dir);
+        return; /// < EXIT POINT
+    }
+    pcl::PCDWriter writer;
+    for (std::map<std::string, sensor_msgs::PointCloud2>::const_iterator it = layers_.begin(); it != layers_.end(); ++it)
+    {
+        pcl::PCLPointCloud2 cloud;
+        pcl_conversions::toPCL(it->second, cloud);
+        writer.writeBinary(dir + "/" + it->first + ".pcd", cloud);
+    }
+    ROS_INFO_STREAM("PriorMapServer::saveCache() - saved the layers in " << dir);
+}
+
+void PriorMapServer::publishLayers()
+{
+    const ros::Time stamp = ros::Time::now();
+    for (std::map<std::string, sensor_msgs::PointCloud2>::iterator it = layers_.begin(); it != layers_.end(); ++it)
+    {
+        it->second.header.stamp = stamp;
+        ros::Publisher& pub = layer_pubs_[it->first];
+        pub = n_.advertise<sensor_msgs::PointCloud2>(it->first, 1, true);
+        pub.publish(it->second);
+        ROS_INFO_STREAM("PriorMapServer::publishLayers() - " << it->first << ": " << it->second.width * it->second.height << " points");
+    }
+}
+
+bool PriorMapServer::getPriorMapServiceCallback(trajectory_control_msgs::GetPriorMap::Request& req, trajectory_control_msgs::GetPriorMap::Response& res)
+{
+    std::map<std::string, sensor_msgs::PointCloud2>::const_iterator it = layers_.find(req.layer);
+    if (it == layers_.end())
+    {
+        ROS_WARN_STREAM("PriorMapServer - unknown layer " << req.layer);
+        res.success = false;
+        return true; /// < EXIT POINT
+    }
+
+    res.success = true;
+    if (req.radius > 0)
+    {
+        cropCloud(it->second, req.center, req.radius, res.cloud);
+    }
+    else if (req.use_shared_memory && shared_memory_names_.count(req.layer))
+    {
+        res.shared_memory_name = shared_memory_names_[req.layer];
+    }
+    else
+    {
+        res.cloud = it->second;
+    }
+    return true;
+}
+
+void PriorMapServer::cropCloud(const sensor_msgs::PointCloud2& in, const geometry_msgs::Point& center, const double radius, sensor_msgs::PointCloud2& out)
+{
+    int x_offset = -1, y_offset = -1;
+    for (size_t i = 0; i < in.fields.size(); i++)
+    {
+        if (in.fields[i].name == "x") x_offset = in.fields[i].offset;
+        if (in.fields[i].name == "y") y_offset = in.fields[i].offset;
+    }
+
+    out.header = in.header;
+    out.fields = in.fields;
+    out.is_bigendian = in.is_bigendian;
+    out.point_step = in.point_step;
+    out.is_dense = in.is_dense;
+    out.height = 1;
+    out.data.clear();
+    if (x_offset >= 0 && y_offset >= 0)
+    {
+        const size_t num_points = in.width * in.height;
+        const double radius2 = radius * radius;
+        for (size_t i = 0; i < num_points; i++)
+        {
+            const uint8_t* point = &in.data[i * in.point_step];
+            float x, y;
+            memcpy(&x, point + x_offset, sizeof(float));
+            memcpy(&y, point + y_offset, sizeof(float));
+            const double dx = x - center.x, dy = y - center.y;
+            if (dx * dx + dy * dy <= radius2)
+            {
+                out.data.insert(out.data.end(), point, point + in.point_step);
+            }
+        }
+    }
+    out.width = out.data.size() / out.point_step;
+    out.row_step = out.data.size();
+}
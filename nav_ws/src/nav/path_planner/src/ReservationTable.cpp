@@ -0,0 +1,229 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ReservationTable.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+const float ReservationTable::kDefaultCellSize = 0.5;        // [m]
+const double ReservationTable::kDefaultTimeMargin = 2.0;     // [s]
+const float ReservationTable::kDefaultFootprintRadius = 0.5; // [m]
+
+namespace
+{
+const int kCellKeyBits = 21;
+const int kCellKeyOffset = 1 << (kCellKeyBits - 1);
+const uint64_t kCellKeyMask = (uint64_t(1) << kCellKeyBits) - 1;
+}
+
+ReservationTable::ReservationTable(float cell_size, double time_margin, float footprint_radius)
+{
+    cell_size_ = std::max(cell_size, 1e-3f);
+    time_margin_ = std::max(time_margin, 0.);
+    footprint_radius_ = std::max(footprint_radius, 0.f);
+}
+
+ReservationTable::CellKey ReservationTable::getCellKey(int ix, int iy, int iz) const
+{
+    return  ((uint64_t(ix + kCellKeyOffset) & kCellKeyMask) << (2*kCellKeyBits)) |
+            ((uint64_t(iy + kCellKeyOffset) & kCellKeyMask) << kCellKeyBits) |
+             (uint64_t(iz + kCellKeyOffset) & kCellKeyMask);
+}
+
+void ReservationTable::reservePath(int robot_id, const std::vector<TimedPoint>& path)
+{
+    boost::mutex::scoped_lock locker(mutex_);
+
+    removeRobot(robot_id);
+    if (path.empty()) return; /// < EXIT POINT
+
+    std::vector<CellKey>& robot_cells = robot_cells_[robot_id];
+
+    // sample the path with a step of half a cell, the time is linearly interpolated along each segment
+    const float step = 0.5f*cell_size_;
+    reserveFootprint(robot_id, path[0].x, path[0].y, path[0].z, path[0].time, robot_cells);
+    for (size_t i = 1; i < path.size(); i++)
+    {
+        const TimedPoint& p0 = path[i - 1];
+        const TimedPoint& p1 = path[i];
+        const float dx = p1.x - p0.x, dy = p1.y - p0.y, dz = p1.z - p0.z;
+        const int num_steps = std::max((int) std::ceil(std::sqrt(dx*dx + dy*dy + dz*dz)/step), 1);
+        for (int k = 1; k <= num_steps; k++)
+        {
+            const float s = (float) k/num_steps;
+            reserveFootprint(robot_id, p0.x + s*dx, p0.y + s*dy, p0.z + s*dz, p0.time + s*(p1.time - p0.time), robot_cells);
+        }
+    }
+
+    std::sort(robot_cells.begin(), robot_cells.end());
+    robot_cells.erase(std::unique(robot_cells.begin(), robot_cells.end()), robot_cells.end());
+}
+
+void ReservationTable::reserveFootprint(int robot_id, float x, float y, float z, double time, std::vector<CellKey>& robot_cells)
+{
+    const double begin = time - time_margin_;
+    const double end = time + time_margin_;
+
+    const int ix_min = (int) std::floor((x - footprint_radius_)/cell_size_);
+    const int ix_max = (int) std::floor((x + footprint_radius_)/cell_size_);
+    const int iy_min = (int) std::floor((y - footprint_radius_)/cell_size_);
+    const int iy_max = (int) std::floor((y + footprint_radius_)/cell_size_);
+    const int iz = (int) std::floor(z/cell_size_);
+    const float radius2 = footprint_radius_*footprint_radius_;
+
+    for (int ix = ix_min; ix <= ix_max; ix++)
+    {
+        // distance from (x, y) to the closest point of the cell
+        const float cx = std::min(std::max(x, ix*cell_size_), (ix + 1)*cell_size_) - x;
+        for (int iy = iy_min; iy <= iy_max; iy++)
+        {
+            const float cy = std::min(std::max(y, iy*cell_size_), (iy + 1)*cell_size_) - y;
+            if (cx*cx + cy*cy > radius2) continue; /// < CONTINUE
+
+            for (int jz = iz - 1; jz <= iz + 1; jz++)
+            {
+                const CellKey key = getCellKey(ix, iy, jz);
+                std::vector<Interval>& intervals = cells_[key];
+
+                // the samples come in time order: extend the last interval of the robot if it overlaps
+                bool b_merged = false;
+                for (std::vector<Interval>::reverse_iterator it = intervals.rbegin(); it != intervals.rend(); ++it)
+                {
+                    if (it->robot_id != robot_id) continue; /// < CONTINUE
+                    if (begin <= it->end)
+                    {
+                        it->begin = std::min(it->begin, begin);
+                        it->end = std::max(it->end, end);
+                        b_merged = true;
+                    }
+                    break; /// < BREAK
+                }
+                if (!b_merged)
+                {
+                    Interval interval;
+                    interval.robot_id = robot_id;
+                    interval.begin = begin;
+                    interval.end = end;
+                    intervals.push_back(interval);
+                    robot_cells.push_back(key);
+                }
+            }
+        }
+    }
+}
+
+void ReservationTable::clearRobot(int robot_id)
+{
+    boost::mutex::scoped_lock locker(mutex_);
+
+    removeRobot(robot_id);
+}
+
+void ReservationTable::removeRobot(int robot_id)
+{
+    std::unordered_map<int, std::vector<CellKey> >::iterator it_robot = robot_cells_.find(robot_id);
+    if (it_robot == robot_cells_.end()) return; /// < EXIT POINT
+
+    for (size_t i = 0; i < it_robot->second.size(); i++)
+    {
+        std::unordered_map<CellKey, std::vector<Interval> >::iterator it_cell = cells_.find(it_robot->second[i]);
+        if (it_cell == cells_.end()) continue; /// < CONTINUE
+
+        std::vector<Interval>& intervals = it_cell->second;
+        intervals.erase(std::remove_if(intervals.begin(), intervals.end(), [robot_id](const Interval& interval) { return interval.robot_id == robot_id; }), intervals.end());
+        if (intervals.empty()) cells_.erase(it_cell);
+    }
+    robot_cells_.erase(it_robot);
+}
+
+void ReservationTable::removeExpired(double time)
+{
+    boost::mutex::scoped_lock locker(mutex_);
+
+    for (std::unordered_map<CellKey, std::vector<Interval> >::iterator it = cells_.begin(); it != cells_.end(); )
+    {
+        std::vector<Interval>& intervals = it->second;
+        intervals.erase(std::remove_if(intervals.begin(), intervals.end(), [time](const Interval& interval) { return interval.end < time; }), intervals.end());
+        if (intervals.empty())
+        {
+            it = cells_.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    // N.B.: the cell lists of the robots may still contain removed cells, removeRobot() skips them
+}
+
+void ReservationTable::clear()
+{
+    boost::mutex::scoped_lock locker(mutex_);
+
+    cells_.clear();
+    robot_cells_.clear();
+}
+
+int ReservationTable::countConflicts(int robot_id, float x, float y, float z, double time) const
+{
+    const CellKey key = getCellKey((int) std::floor(x/cell_size_), (int) std::floor(y/cell_size_), (int) std::floor(z/cell_size_));
+    std::unordered_map<CellKey, std::vector<Interval> >::const_iterator it = cells_.find(key);
+    if (it == cells_.end()) return 0; /// < EXIT POINT
+
+    // the overlapping intervals of a robot are merged: at most one interval of each robot contains the input time
+    int conflicts = 0;
+    for (size_t i = 0; i < it->second.size(); i++)
+    {
+        const Interval& interval = it->second[i];
+        if ((interval.robot_id < robot_id) && (interval.begin <= time) && (time <= interval.end)) conflicts++;
+    }
+    return conflicts;
+}
+
+int ReservationTable::getConflicts(int robot_id, float x, float y, float z, double time)
+{
+    boost::mutex::scoped_lock locker(mutex_);
+
+    return countConflicts(robot_id, x, y, z, time);
+}
+
+void ReservationTable::getConflicts(int robot_id, const float* x, const float* y, const float* z, const double* time, size_t n, int* conflicts)
+{
+    boost::mutex::scoped_lock locker(mutex_);
+
+    if (cells_.empty())
+    {
+        std::fill(conflicts, conflicts + n, 0);
+        return; /// < EXIT POINT
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        conflicts[i] = countConflicts(robot_id, x[i], y[i], z[i], time[i]);
+    }
+}
+
+size_t ReservationTable::getNumCells()
+{
+    boost::mutex::scoped_lock locker(mutex_);
+
+    return cells_.size();
+}
@@ -0,0 +1,129 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SearchTreeMarkerPublisher.h"
+
+#include <cmath>
+#include <iostream>
+
+#include <boost/bind.hpp>
+
+
+const size_t SearchTreeMarkerPublisher::kDefaultRingCapacity = 1 << 16;
+const double SearchTreeMarkerPublisher::kDefaultPublishPeriodSec = 0.5; // [s]
+const size_t SearchTreeMarkerPublisher::kMaxNumPoints = 200000;
+const double SearchTreeMarkerPublisher::kPointSize = 0.05; // [m] same size of the old sphere markers
+
+SearchTreeMarkerPublisher::SearchTreeMarkerPublisher(ros::NodeHandle& n, const std::string& topic_name, size_t ring_capacity, double publish_period_sec)
+:publish_period_sec_(publish_period_sec), head_(0), tail_(0), num_dropped_points_(0), b_active_(false)
+{
+    size_t capacity = 1;
+    while (capacity < ring_capacity) capacity <<= 1;
+    ring_.resize(capacity);
+    ring_mask_ = capacity - 1;
+
+    marker_array_.markers.resize(1);
+    visualization_msgs::Marker& marker = marker_array_.markers[0];
+    marker.header.frame_id = "map";
+    marker.ns = "search_tree";
+    marker.id = 0;
+    marker.type = visualization_msgs::Marker::POINTS;
+    marker.action = visualization_msgs::Marker::ADD;
+    marker.pose.orientation.w = 1.0;
+    marker.scale.x = marker.scale.y = kPointSize;
+    marker.color.a = 1.0;
+    marker.color.r = 0.0;
+    marker.color.g = 0.0;
+    marker.color.b = 1.0;
+
+    pub_ = n.advertise<visualization_msgs::MarkerArray>(topic_name, 1);
+
+    thread_ = boost::thread(boost::bind(&SearchTreeMarkerPublisher::publishLoop, this));
+}
+
+SearchTreeMarkerPublisher::~SearchTreeMarkerPublisher()
+{
+    thread_.interrupt();
+    thread_.join();
+}
+
+bool SearchTreeMarkerPublisher::drain()
+{
+    std::vector<geometry_msgs::Point>& points = marker_array_.markers[0].points;
+
+    const size_t head = head_.load(std::memory_order_acquire);
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    const bool b_changed = (tail != head);
+    for (; tail != head; tail++)
+    {
+        const Entry& entry = ring_[tail & ring_mask_];
+        if (std::isnan(entry.x))
+        {
+            points.clear(); // a new search started
+            continue;
+        }
+        if (points.size() >= kMaxNumPoints) continue;
+
+        geometry_msgs::Point point;
+        point.x = entry.x;
+        point.y = entry.y;
+        point.z = entry.z;
+        points.push_back(point);
+    }
+    tail_.store(tail, std::memory_order_release);
+
+    return b_changed;
+}
+
+void SearchTreeMarkerPublisher::publishLoop()
+{
+    try
+    {
+        while (true)
+        {
+            boost::this_thread::sleep_for(boost::chrono::milliseconds((int) (publish_period_sec_ * 1000)));
+
+            const bool b_active = pub_.getNumSubscribers() > 0;
+            b_active_.store(b_active, std::memory_order_relaxed);
+
+            const bool b_changed = drain();
+            if (!b_active)
+            {
+                marker_array_.markers[0].points.clear(); // the next subscriber will see the next search
+                continue;
+            }
+
+            if (b_changed)
+            {
+                marker_array_.markers[0].header.stamp = ros::Time::now();
+                pub_.publish(marker_array_);
+            }
+        }
+    }
+    catch (boost::thread_interrupted&)
+    {
+    }
+
+    const size_t num_dropped_points = num_dropped_points_.load();
+    if (num_dropped_points > 0)
+    {
+        std::cout << "SearchTreeMarkerPublisher::publishLoop() - dropped points: " << num_dropped_points << std::endl;
+    }
+}
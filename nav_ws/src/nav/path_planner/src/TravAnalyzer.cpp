@@ -20,10 +20,18 @@
 
 #include <TravAnalyzer.h>
 
+#include <algorithm>
 #include <limits>       // std::numeric_limits
+#include <unordered_map>
+#include <unordered_set>
+
+#include <boost/thread/thread.hpp>
 
 #include <pcl/common/common.h>
 
+#include "VoxelBinaryKey.h"
+#include <mr3d_profiling/Profiler.h>
+
 
 // #define ROBOT_CLOCKS_ARE_SYNCHED IT DOES NOT WORK
 
@@ -52,6 +60,9 @@ const float TravAnalyzer::kClearanceLambda = 5; //
 const float TravAnalyzer::kNeighborhoodDeltaZ = 0.1; // [m]
 
 const float TravAnalyzer::kRobotZOffset = 0.2; // [m] how much each point is pushed higher from the map in the robot direction (we could also use here local normals!)
+
+const double TravAnalyzer::kBlockSize = 2.0; // [m] size of the spatial blocks processed by the threads of computeTrav()
+const double TravAnalyzer::kCacheKeyLeafSize = 0.01; // [m] much smaller than the map leaf size 
     
 
 // from https://www.codeproject.com/Articles/69941/Best-Square-Root-Method-Algorithm-Function-Precisi
@@ -84,6 +95,13 @@ TravAnalyzer::TravAnalyzer()
             
     b_ready_ = false;
     b_empty_wall_ = true;
+    
+    b_reset_neighborhood_cache_ = true;
+    b_clearance_dt_ready_ = false;
+    b_trails_dt_ready_ = false;
+    b_clearance_esdf_ready_ = false;
+    neighborhood_cache_radius_ = 0;
+    prev_noWall_pcl_.reset(new pcl::PointCloud<pcl::PointXYZRGBNormal>());
 
     b_set_ost_pcl_ = false;
 
@@ -178,6 +196,7 @@ void TravAnalyzer::setInput(std::vector<int>& clusters_info, pcl::PointCloud<pcl
 
 void TravAnalyzer::computeTrav(PointCloudI& traversabilty_pcl)
 {
+    PROFILE_ZONE("trav/compute_trav");
     if (!b_ready_) return; /// < EXIT POINT 
     
     
@@ -222,91 +241,392 @@ void TravAnalyzer::computeTrav(PointCloudI& traversabilty_pcl)
     const double area_local_surface     = M_PI * pow(config_.density_radius_multiplier * config_.leaf_size, 2);
    
     const double radius = config_.density_radius_multiplier * config_.leaf_size;
-        
-    pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr nh(new pcl::PointCloud<pcl::PointXYZRGBNormal>());
-
-    //for (size_t i = 0; (i < noWall_pcl_->size()) && (i < clusters_info_.size()); i++)
-    for (size_t i = 0, iEnd = std::min(noWall_pcl_->size(),clusters_info_.size()) ; i < iEnd; i++)        
+    
+    // the future trails are read by computeClearance() from the worker threads: keep them locked for the whole computation 
+    boost::recursive_mutex::scoped_lock team_future_trails_pcl_locker(team_future_trails_pcl_mutex_);
+    
+    /// < clearance: the walls are read from the ESDF map (if enabled and received), which is locked for the whole computation 
+    boost::unique_lock<boost::recursive_mutex> esdf_locker;
+    b_clearance_esdf_ready_ = false;
+    if (config_.use_esdf && p_esdf_map_)
     {
-        if (clusters_info_[i] != -1)
+        esdf_locker = boost::unique_lock<boost::recursive_mutex>(p_esdf_map_->getMutex());
+        b_clearance_esdf_ready_ = p_esdf_map_->isReady();
+        if (!b_clearance_esdf_ready_) ROS_WARN_THROTTLE(10, "TravAnalyzer::computeTrav() - ESDF map not received yet");
+    }
+    
+    /// < otherwise build the distance transforms once (if enabled), or the nearest neighbors are searched for each point 
+    b_clearance_dt_ready_ = !b_clearance_esdf_ready_ && config_.use_distance_transform && buildClearanceDistanceTransforms();
+    
+    const size_t num_points = std::min(noWall_pcl_->size(),clusters_info_.size());
+    
+    /// < split the points into spatial blocks: the points of a block share most of their kd-tree paths and neighborhoods 
+    /// < (the temporaries of the scan are taken from the arena, their storage is reused scan after scan, see ScanArena)
+    ScanArena::Buffer<std::vector<std::vector<int> > > blocks_buffer = arena_.get<std::vector<std::vector<int> > >();
+    std::vector<std::vector<int> >& blocks = *blocks_buffer;
+    size_t num_blocks = 0;
+    {
+        ScanArena::Buffer<std::unordered_map<uint64_t, size_t> > block_of_key_buffer = arena_.get<std::unordered_map<uint64_t, size_t> >();
+        std::unordered_map<uint64_t, size_t>& block_of_key = *block_of_key_buffer;
+        block_of_key.clear();
+        for (size_t i = 0; i < num_points; i++)
         {
-            double wL = computeLabel(clusters_info_[i]);
-
-            std::vector<int> pointIdxRadiusSearch(1);
-            std::vector<float> pointRadiusSquaredDistance(1);
-
-            const pcl::PointXYZRGBNormal& p = (*noWall_pcl_)[i];
-            
-            //input_kdtree.radiusSearch(p,0.2,pointIdxRadiusSearch,pointRadiusSquaredDistance);
-            int neighbors_in_radius = noWall_kdtree_.radiusSearch(p, radius, pointIdxRadiusSearch, pointRadiusSquaredDistance);
-
-            //pcl::PointCloud<pcl::PointXYZRGBNormal> nh;
-            nh->resize(pointIdxRadiusSearch.size());
-
-            //pcl::PointCloud<pcl::PointXYZRGBNormal> nh_planar;
+            if (clusters_info_[i] == -1) continue; /// < CONTINUE
             
-            for (size_t k = 0, kEnd = pointIdxRadiusSearch.size(); k < kEnd; k++)
+            const uint64_t key = voxelBinaryKey((*noWall_pcl_)[i], kBlockSize);
+            std::unordered_map<uint64_t, size_t>::iterator it = block_of_key.find(key);
+            if (it == block_of_key.end())
             {
-                const pcl::PointXYZRGBNormal& p_k = (*noWall_pcl_)[pointIdxRadiusSearch[k]];
-                //nh.push_back(p_k);
-                (*nh)[k]=p_k;
-            //    if( fabs(p_k.z - p.z) < kNeighborhoodDeltaZ )
-            //    {
-            //        nh_planar.push_back(p_k);
-            //    }
-               
+                it = block_of_key.insert(std::make_pair(key, num_blocks)).first;
+                if (num_blocks == blocks.size()) blocks.push_back(std::vector<int>());
+                blocks[num_blocks++].clear(); // keep the capacity of the previous scans
             }
+            blocks[it->second].push_back(i);
+        }
+    }
+    
+    int num_threads = config_.num_threads;
+    if (num_threads <= 0) num_threads = std::max((int)boost::thread::hardware_concurrency(), 1);
+    
+    /// < incremental update: the roughness and density terms are reused for the points far from the map changes 
+    ScanArena::Buffer<std::vector<uint64_t> > point_keys_buffer = arena_.getVector<uint64_t>(noWall_pcl_->size());
+    std::vector<uint64_t>& point_keys = *point_keys_buffer;
+    for (size_t i = 0, iEnd = noWall_pcl_->size(); i < iEnd; i++)
+    {
+        point_keys[i] = voxelBinaryKey((*noWall_pcl_)[i], kCacheKeyLeafSize);
+    }
+    if (b_reset_neighborhood_cache_ || (radius != neighborhood_cache_radius_))
+    {
+        neighborhood_cache_.clear();
+        b_reset_neighborhood_cache_ = false;
+    }
+    ScanArena::Buffer<std::vector<char> > b_can_reuse_buffer = arena_.getVector<char>(num_points, 0);
+    std::vector<char>& b_can_reuse = *b_can_reuse_buffer;
+    if (config_.incremental_update && !neighborhood_cache_.empty())
+    {
+        findUnchangedNeighborhoods(point_keys, radius, b_can_reuse);
+    }
+    
+    /// < compute the traversability terms of each point (the points are independent)
+    ScanArena::Buffer<std::vector<TravTerms> > terms_buffer = arena_.getVector<TravTerms>(num_points);
+    std::vector<TravTerms>& terms = *terms_buffer;
+    
+    #pragma omp parallel num_threads(num_threads)
+    {
+        // thread-local scratch data 
+        ScanArena::Buffer<pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr> nh_buffer = arena_.get<pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr>();
+        if (!*nh_buffer) nh_buffer->reset(new pcl::PointCloud<pcl::PointXYZRGBNormal>());
+        pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr& nh = *nh_buffer;
+        ScanArena::Buffer<std::vector<int> > pointIdxRadiusSearch_buffer = arena_.get<std::vector<int> >();
+        ScanArena::Buffer<std::vector<float> > pointRadiusSquaredDistance_buffer = arena_.get<std::vector<float> >();
+        std::vector<int>& pointIdxRadiusSearch = *pointIdxRadiusSearch_buffer;
+        std::vector<float>& pointRadiusSquaredDistance = *pointRadiusSquaredDistance_buffer;
+        
+        #pragma omp for schedule(dynamic, 1)
+        for (int b = 0; b < (int)num_blocks; b++)
+        {
+            const std::vector<int>& block = blocks[b];
+            for (size_t j = 0, jEnd = block.size(); j < jEnd; j++)
+            {
+                const int i = block[j];
+                TravTerms& term = terms[i];
+                
+                // the clearance depends on the obstacles and on the teammates: it is always recomputed 
+                term.wC = computeClearance(i);
 
-            const double wC = computeClearance(i);
+                /// < throw away all the points that bring robot into collision 
+                if (term.wC >= TravAnalyzer::kClearanceCollisionValue) continue; /// < CONTINUE
 
-            /// < throw away all the points that bring robot into collision 
-            if (wC >= TravAnalyzer::kClearanceCollisionValue) continue; /// < CONTINUE
+                term.wL = computeLabel(clusters_info_[i]);
+                
+                if (b_can_reuse[i])
+                {
+                    NeighborhoodCache::const_iterator it = neighborhood_cache_.find(point_keys[i]);
+                    if (it != neighborhood_cache_.end())
+                    {
+                        term.wR = it->second.wR;
+                        term.wD = it->second.wD;
+                        term.b_reused = true;
+                    }
+                }
+                
+                if (!term.b_reused)
+                {
+                    const pcl::PointXYZRGBNormal& p = (*noWall_pcl_)[i];
+
+                    //input_kdtree.radiusSearch(p,0.2,pointIdxRadiusSearch,pointRadiusSquaredDistance);
+                    noWall_kdtree_.radiusSearch(p, radius, pointIdxRadiusSearch, pointRadiusSquaredDistance);
+
+                    nh->resize(pointIdxRadiusSearch.size());
+                    for (size_t k = 0, kEnd = pointIdxRadiusSearch.size(); k < kEnd; k++)
+                    {
+                        (*nh)[k] = (*noWall_pcl_)[pointIdxRadiusSearch[k]];
+                    }
+
+                    term.wR = computeRough(i, nh);
+                    term.wD = computeDensity(i, *nh, pow_config_leaf_size_3, volume_local_sphere);
+                    //const double wD = computePlanarDensity(i, nh_planar, pow_config_leaf_size_2, area_local_surface);
+                }
+
+                //double wTot = wL * (wD + wR + wC) / 3; // original 
+                term.wTot = term.wL*(term.wD + 1)*(term.wR + 1)*(kClearanceLambda*term.wC+1);
+                term.b_valid = true;
+            }
+        }
+    }
+    
+    /// < update the neighborhood cache and keep the current map for the next incremental update 
+    size_t num_reused = 0;
+    if (config_.incremental_update)
+    {
+        ScanArena::Buffer<NeighborhoodCache> new_cache_buffer = arena_.get<NeighborhoodCache>();
+        NeighborhoodCache& new_cache = *new_cache_buffer;
+        new_cache.clear();
+        new_cache.reserve(num_points);
+        for (size_t i = 0; i < num_points; i++)
+        {
+            const TravTerms& term = terms[i];
+            if (!term.b_valid) continue; /// < CONTINUE
+            if (term.b_reused) num_reused++;
+            NeighborhoodTerms& cached = new_cache[point_keys[i]];
+            cached.wR = term.wR;
+            cached.wD = term.wD;
+        }
+        neighborhood_cache_.swap(new_cache);
+        neighborhood_cache_radius_ = radius;
+        *prev_noWall_pcl_ = *noWall_pcl_;
+        prev_point_keys_.swap(point_keys);
+        std::cout << "TravAnalyzer::computeTrav() - reused neighborhoods: " << num_reused << std::endl;
+    }
+    else
+    {
+        neighborhood_cache_.clear();
+    }
+    
+    /// < collect the valid points in the input order (or the cells of the adaptive resolution map) 
+    if (config_.adaptive_resolution)
+    {
+        collectAdaptiveResolution(terms, num_points);
+    }
+    else
+    {
+        for (size_t i = 0; i < num_points; i++)        
+        {
+            if (!terms[i].b_valid) continue; /// < CONTINUE
+            pushTravPoint((*noWall_pcl_)[i].x, (*noWall_pcl_)[i].y, (*noWall_pcl_)[i].z, terms[i]);
+        }
+    }
+    traversabilty_pcl = traversabilty_pcl_;
+    
+    ROS_INFO_STREAM("TravAnalyzer::computeTrav() - end "); 
+}
 
-            const double wR = computeRough(i, nh);
+void TravAnalyzer::pushTravPoint(float x, float y, float z, const TravTerms& term)
+{
+    PointOutI point;
+    point.x = x;
+    point.y = y;
+    point.z = z;
 
-            const double wD = computeDensity(i, *nh, pow_config_leaf_size_3, volume_local_sphere);
-            //const double wD = computePlanarDensity(i, nh_planar, pow_config_leaf_size_2, area_local_surface);
+    point.intensity = term.wTot;
+    traversabilty_pcl_.push_back(point);
 
-            //cout<<"cost wR: "<<wR<<" cost wD: "<<wD<<" cost wC: "<<wC<<endl;
+    point.intensity = term.wD;
+    density_pcl_.push_back(point);
 
-            //double wTot = wL * (wD + wR + wC) / 3; // original 
-            const double wTot = wL*(wD + 1)*(wR + 1)*(kClearanceLambda*wC+1);
-            //double wTot = wC;
-            //if ((wC < TravAnalyzer::kClearanceCollisionValue) && (wTot < kTraversabilityMaxCost))
-            //if (wTot < kTraversabilityMaxCost)
-            {
+    point.intensity = term.wR;
+    roughness_pcl_.push_back(point);
 
-                PointOutI point;
-                point.x = (*noWall_pcl_)[i].x;
-                point.y = (*noWall_pcl_)[i].y;
-                point.z = (*noWall_pcl_)[i].z;
+    point.intensity = term.wL;
+    label_pcl_.push_back(point);
 
-                point.intensity = wTot;
-                traversabilty_pcl_.push_back(point);
+    point.intensity = term.wC;
+    clearence_pcl_.push_back(point);
+}
 
-                point.intensity = wD;
-                density_pcl_.push_back(point);
+void TravAnalyzer::collectAdaptiveResolution(const std::vector<TravTerms>& terms, size_t num_points)
+{
+    std::vector<int> valid_points;
+    valid_points.reserve(num_points);
+    for (size_t i = 0; i < num_points; i++)        
+    {
+        if (terms[i].b_valid) valid_points.push_back(i);
+    }
+    
+    // cells of size leaf_size*2^level, level = num_levels..1 
+    const int num_levels = std::min((int)floor(log2(config_.adaptive_max_cell_size/config_.leaf_size) + 1e-6), 16);
+    
+    std::vector<std::vector<int> > cells, split_cells;
+    if (num_levels >= 1)
+    {
+        groupByCell(valid_points, config_.leaf_size*(1 << num_levels), cells);
+    }
+    else
+    {
+        cells.push_back(valid_points); // no coarser level: keep all the points 
+    }
+    
+    size_t num_coarse_cells = 0;
+    for (int level = num_levels; level >= 1; level--)
+    {
+        const double cell_size = config_.leaf_size*(1 << level);
+        split_cells.clear();
+        for (size_t c = 0; c < cells.size(); c++)
+        {
+            const std::vector<int>& cell = cells[c];
+            if (isUniformCell(cell, cell_size, terms))
+            {
+                // a single point at the centroid (on the fitted plane) with the max of the terms (conservative)
+                double x = 0, y = 0, z = 0;
+                TravTerms cell_term = terms[cell[0]];
+                for (size_t j = 0; j < cell.size(); j++)
+                {
+                    const pcl::PointXYZRGBNormal& p = (*noWall_pcl_)[cell[j]];
+                    x += p.x; y += p.y; z += p.z;
+                    const TravTerms& term = terms[cell[j]];
+                    cell_term.wTot = std::max(cell_term.wTot, term.wTot);
+                    cell_term.wD = std::max(cell_term.wD, term.wD);
+                    cell_term.wR = std::max(cell_term.wR, term.wR);
+                }
+                pushTravPoint(x/cell.size(), y/cell.size(), z/cell.size(), cell_term);
+                num_coarse_cells++;
+            }
+            else
+            {
+                groupByCell(cell, 0.5*cell_size, split_cells);
+            }
+        }
+        cells.swap(split_cells);
+    }
+    
+    /// < finest level: keep the points 
+    for (size_t c = 0; c < cells.size(); c++)
+    {
+        for (size_t j = 0; j < cells[c].size(); j++)
+        {
+            const int i = cells[c][j];
+            pushTravPoint((*noWall_pcl_)[i].x, (*noWall_pcl_)[i].y, (*noWall_pcl_)[i].z, terms[i]);
+        }
+    }
+    
+    std::cout << "TravAnalyzer::collectAdaptiveResolution() - valid points: " << valid_points.size() << ", coarse cells: " << num_coarse_cells 
+              << ", output points: " << traversabilty_pcl_.size() << std::endl;
+}
 
-                point.intensity = wR;
-                roughness_pcl_.push_back(point);
+bool TravAnalyzer::isUniformCell(const std::vector<int>& cell, double cell_size, const std::vector<TravTerms>& terms) const
+{
+    const double expected_num_points = pow(cell_size/config_.leaf_size, 2); // on flat ground 
+    if (cell.size() < std::max(config_.adaptive_min_fill_ratio*expected_num_points, 3.)) return false; /// < EXIT POINT (holes or borders)
+    
+    const double wL = terms[cell[0]].wL;
+    double wR_min = terms[cell[0]].wR, wR_max = terms[cell[0]].wR;
+    double mx = 0, my = 0, mz = 0;
+    for (size_t j = 0; j < cell.size(); j++)
+    {
+        const TravTerms& term = terms[cell[j]];
+        if ((term.wC > 0) || (term.wL != wL)) return false; /// < EXIT POINT (close to walls, obstacles or teammates, or label change)
+        wR_min = std::min(wR_min, term.wR);
+        wR_max = std::max(wR_max, term.wR);
+        
+        const pcl::PointXYZRGBNormal& p = (*noWall_pcl_)[cell[j]];
+        mx += p.x; my += p.y; mz += p.z;
+    }
+    if (wR_max - wR_min > config_.adaptive_roughness_tolerance) return false; /// < EXIT POINT 
+    
+    /// < least-squares plane z = mz + a*(x - mx) + b*(y - my): the residuals detect the slope changes and the steps 
+    mx /= cell.size(); my /= cell.size(); mz /= cell.size();
+    double sxx = 0, sxy = 0, syy = 0, sxz = 0, syz = 0;
+    for (size_t j = 0; j < cell.size(); j++)
+    {
+        const pcl::PointXYZRGBNormal& p = (*noWall_pcl_)[cell[j]];
+        const double dx = p.x - mx, dy = p.y - my, dz = p.z - mz;
+        sxx += dx*dx; sxy += dx*dy; syy += dy*dy; sxz += dx*dz; syz += dy*dz;
+    }
+    const double det = sxx*syy - sxy*sxy;
+    if (det <= 1e-6*sxx*syy) return false; /// < EXIT POINT (degenerate cell, e.g. collinear points)
+    const double a = (syy*sxz - sxy*syz)/det;
+    const double b = (sxx*syz - sxy*sxz)/det;
+    for (size_t j = 0; j < cell.size(); j++)
+    {
+        const pcl::PointXYZRGBNormal& p = (*noWall_pcl_)[cell[j]];
+        if (fabs(p.z - mz - a*(p.x - mx) - b*(p.y - my)) > config_.adaptive_max_plane_residual) return false; /// < EXIT POINT 
+    }
+    return true;
+}
 
-                point.intensity = wL;
-                label_pcl_.push_back(point);
+void TravAnalyzer::groupByCell(const std::vector<int>& indices, double cell_size, std::vector<std::vector<int> >& cells) const
+{
+    std::vector<std::pair<uint64_t, int> > keys(indices.size());
+    for (size_t j = 0; j < indices.size(); j++)
+    {
+        // floor (and not round as in voxelBinaryKey()) so that the cells of the next level are nested 
+        const pcl::PointXYZRGBNormal& p = (*noWall_pcl_)[indices[j]];
+        const uint64_t ix = (uint64_t)((int64_t)floor(p.x/cell_size) + (1LL << 31)) & 0xFFFFFFFF;
+        const uint64_t iy = (uint64_t)((int64_t)floor(p.y/cell_size) + (1LL << 31)) & 0xFFFFFFFF;
+        keys[j] = std::make_pair((ix << 32) | iy, indices[j]);
+    }
+    std::sort(keys.begin(), keys.end());
+    
+    for (size_t j = 0; j < keys.size(); j++)
+    {
+        if ((j == 0) || (keys[j].first != keys[j - 1].first)) cells.push_back(std::vector<int>());
+        cells.back().push_back(keys[j].second);
+    }
+}
 
-                point.intensity = wC;
-                clearence_pcl_.push_back(point);
+void TravAnalyzer::findUnchangedNeighborhoods(const std::vector<uint64_t>& point_keys, const double radius, std::vector<char>& b_unchanged)
+{
+    /// < mark the cells around the points which have been added or removed since the last update 
+    // a point whose neighborhood (radius) contains a changed point lies in one of the 27 cells (of size radius) around it 
+    const double cell_size = radius; 
+    std::unordered_set<uint64_t> dirty_cells;
+    
+    const std::unordered_set<uint64_t> new_keys(point_keys.begin(), point_keys.end());
+    for (size_t j = 0, jEnd = prev_noWall_pcl_->size(); j < jEnd; j++)
+    {
+        if (!new_keys.count(prev_point_keys_[j])) markNeighborCells((*prev_noWall_pcl_)[j], cell_size, dirty_cells); // removed point
+    }
+    
+    const std::unordered_set<uint64_t> old_keys(prev_point_keys_.begin(), prev_point_keys_.end());
+    for (size_t i = 0, iEnd = point_keys.size(); i < iEnd; i++)
+    {
+        if (!old_keys.count(point_keys[i])) markNeighborCells((*noWall_pcl_)[i], cell_size, dirty_cells); // added point
+    }
+    
+    for (size_t i = 0, iEnd = b_unchanged.size(); i < iEnd; i++)
+    {
+        b_unchanged[i] = dirty_cells.count(voxelBinaryKey((*noWall_pcl_)[i], cell_size)) ? 0 : 1;
+    }
+    
+    std::cout << "TravAnalyzer::findUnchangedNeighborhoods() - dirty cells: " << dirty_cells.size() << std::endl;
+}
 
+void TravAnalyzer::markNeighborCells(const pcl::PointXYZRGBNormal& point, const double cell_size, std::unordered_set<uint64_t>& cells)
+{
+    pcl::PointXYZRGBNormal p = point;
+    for (int dx = -1; dx <= 1; dx++)
+        for (int dy = -1; dy <= 1; dy++)
+            for (int dz = -1; dz <= 1; dz++)
+            {
+                p.x = point.x + dx*cell_size;
+                p.y = point.y + dy*cell_size;
+                p.z = point.z + dz*cell_size;
+                cells.insert(voxelBinaryKey(p, cell_size));
             }
+}
 
-        }
-
+double TravAnalyzer::computeRough(int point_index, const pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr& nh)
+{
+    switch (config_.roughness_method)
+    {
+    case TravAnalyzer_RoughnessPca: return computeRoughPca(*nh);
+    case TravAnalyzer_RoughnessRansac:
+    default:
+        return computeRoughRansac(nh);
     }
-    traversabilty_pcl = traversabilty_pcl_;
-    
-    ROS_INFO_STREAM("TravAnalyzer::computeTrav() - end "); 
 }
 
-double TravAnalyzer::computeRough(int point_index, const pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr& nh)
+double TravAnalyzer::computeRoughRansac(const pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr& nh)
 {
     if (nh->size() > 3)
     {
@@ -337,6 +657,40 @@ double TravAnalyzer::computeRough(int point_index, const pcl::PointCloud<pcl::Po
         return 1;
 }
 
+double TravAnalyzer::computeRoughPca(const pcl::PointCloud<pcl::PointXYZRGBNormal>& nh)
+{
+    const size_t size = nh.size();
+    if (size <= 3) return 1; /// < EXIT POINT
+    
+    /// < centroid and covariance in a single pass (the points are taken relative to the first one for numerical stability)
+    const Eigen::Vector3d p0(nh[0].x, nh[0].y, nh[0].z);
+    Eigen::Vector3d sum = Eigen::Vector3d::Zero();
+    Eigen::Matrix3d sum_sq = Eigen::Matrix3d::Zero();
+    for (size_t i = 0; i < size; i++)
+    {
+        const Eigen::Vector3d v = Eigen::Vector3d(nh[i].x, nh[i].y, nh[i].z) - p0;
+        sum += v;
+        sum_sq.noalias() += v * v.transpose();
+    }
+    const Eigen::Vector3d mean = sum / size;
+    const Eigen::Matrix3d covariance_matrix = sum_sq / size - mean * mean.transpose();
+    
+    /// < the plane normal is the eigenvector of the smallest eigenvalue (the eigenvalues are sorted in increasing order)
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver;
+    solver.computeDirect(covariance_matrix);
+    const Eigen::Vector3d normal = solver.eigenvectors().col(0);
+    
+    /// < mean point-plane distance 
+    const double d = -normal.dot(mean);
+    double tot = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        tot += fabs(normal.dot(Eigen::Vector3d(nh[i].x, nh[i].y, nh[i].z) - p0) + d);
+    }
+    
+    return std::min(10 * tot / size, 1.0);
+}
+
 
 inline double TravAnalyzer::computeDensity(int point_index, pcl::PointCloud<pcl::PointXYZRGBNormal>& nh)
 {
@@ -368,15 +722,114 @@ double dist_fun(const Point1& p1, const Point2& p2)
     return sqrt(pow(p1.x - p2.x, 2) + pow(p1.y - p2.y, 2) + pow(p1.z - p2.z, 2));
 }
 
+bool TravAnalyzer::buildClearanceDistanceTransforms()
+{
+    PROFILE_ZONE("trav/clearance_distance_transforms");
+    if (noWall_pcl_->empty()) return false; /// < EXIT POINT
+    
+    const float resolution = config_.distance_transform_resolution;
+    
+    /// < the query points are the noWall points pushed up by kRobotZOffset: beyond kClearanceDoCareRange the clearance is zero 
+    pcl::PointXYZRGBNormal min_pt, max_pt;
+    pcl::getMinMax3D(*noWall_pcl_, min_pt, max_pt);
+    const float max_distance = kClearanceDoCareRange;
+    const float max_distance_trails = kClearanceDoCareRange + robot_to_avoid_radius_;
+    const float margin = max_distance_trails + resolution;
+    const Eigen::Vector3f box_min(min_pt.x - margin, min_pt.y - margin, min_pt.z + kRobotZOffset - margin);
+    const Eigen::Vector3f box_max(max_pt.x + margin, max_pt.y + margin, max_pt.z + kRobotZOffset + margin);
+    
+    int num_threads = config_.num_threads;
+    if (num_threads <= 0) num_threads = std::max((int)boost::thread::hardware_concurrency(), 1);
+    
+    /// < walls and obstacles 
+    if (!clearance_dt_.init(box_min, box_max, resolution, max_distance))
+    {
+        ROS_WARN("TravAnalyzer::buildClearanceDistanceTransforms() - grid too large, using the nearest neighbor searches");
+        return false; /// < EXIT POINT
+    }
+    
+    if (!b_empty_wall_)
+    {
+        for (size_t i = 0, iEnd = wall_pcl_->size(); i < iEnd; i++) clearance_dt_.addOccupied((*wall_pcl_)[i]);
+    }
+    
+    if (b_set_ost_pcl_)
+    {
+        std::vector<int> pointObstIdxNKNSearch(1);
+        std::vector<float> pointObstNKNSquaredDistance(1);
+        for (size_t i = 0, iEnd = obst_pcl_->size(); i < iEnd; i++)
+        {
+            // same check of computeClearance(): discard the obstacle points which lie on a non-wall area 
+            const pcl::PointXYZRGBNormal& obst_point = (*obst_pcl_)[i];
+            noWall_kdtree_.nearestKSearch(obst_point, 1, pointObstIdxNKNSearch, pointObstNKNSquaredDistance);
+            if (distSquared((*noWall_pcl_)[pointObstIdxNKNSearch[0]], obst_point) > kObstDist2DiscardIfCloseToNoWall)
+            {
+                clearance_dt_.addOccupied(obst_point);
+            }
+        }
+    }
+    clearance_dt_.compute(num_threads);
+    
+    /// < teammate future trails 
+    b_trails_dt_ready_ = false;
+    if (b_enable_team_avoidance_ && b_set_team_future_trails_pcl_)
+    {
+        if (trails_dt_.init(box_min, box_max, resolution, max_distance_trails))
+        {
+            for (size_t i = 0, iEnd = future_trails_pcl_->size(); i < iEnd; i++) trails_dt_.addOccupied((*future_trails_pcl_)[i]);
+            trails_dt_.compute(num_threads);
+            b_trails_dt_ready_ = true;
+        }
+        else
+        {
+            return false; /// < EXIT POINT
+        }
+    }
+    
+    std::cout << "TravAnalyzer::buildClearanceDistanceTransforms() - voxels: " << clearance_dt_.getNumVoxels() << std::endl;
+    return true;
+}
+
+double TravAnalyzer::computeClearanceDT(int point_index)
+{
+    const pcl::PointXYZRGBNormal& p = (*noWall_pcl_)[point_index]; 
+    const float z = p.z + kRobotZOffset;
+    
+    // N.B.: the distances are saturated: at the saturation value the clearance is zero 
+    float dist_squared = std::numeric_limits<float>::max();
+    const float dist = clearance_dt_.getDistance(p.x, p.y, z);
+    if (dist < kClearanceDoCareRange) dist_squared = dist*dist;
+    
+    if (b_trails_dt_ready_)
+    {
+        const float dist_future_trails = std::max(trails_dt_.getDistance(p.x, p.y, z) - robot_to_avoid_radius_, 0.f);
+        if (dist_future_trails < kClearanceDoCareRange) dist_squared = std::min(dist_squared, dist_future_trails*dist_future_trails);
+    }
+    
+    return (dist_squared < robot_radius_squared_ ) ? kClearanceCollisionValue : (dist_squared < kClearanceDoCareRangeSquared? robot_radius_squared_ / dist_squared : 0);
+}
+
 double TravAnalyzer::computeClearance(int point_index)
 {
+    if (b_clearance_dt_ready_) return computeClearanceDT(point_index); /// < EXIT POINT
+    
     // point2point squared distance
     float dist_squared = std::numeric_limits<float>::max();
     
     pcl::PointXYZRGBNormal point = (*noWall_pcl_)[point_index]; 
     point.z += kRobotZOffset; 
 
-    if (!b_empty_wall_)
+    if (b_clearance_esdf_ready_)
+    {
+        // O(1) lookup; the ESDF distances are saturated beyond kClearanceDoCareRange, an unobserved point has no wall clearance 
+        double dist = 0;
+        if (p_esdf_map_->getDistance(Eigen::Vector3d(point.x, point.y, point.z), dist) && (dist < kClearanceDoCareRange))
+        {
+            dist = std::max(dist, 0.);
+            dist_squared = dist*dist;
+        }
+    }
+    else if (!b_empty_wall_)
     {
         std::vector<int> pointIdxNKNSearch(1);
         std::vector<float> pointNKNSquaredDistance(1,std::numeric_limits<float>::max());
@@ -449,10 +902,9 @@ double TravAnalyzer::computeClearance(int point_index)
 //        dist_squared = std::min(dist_squared, dist_squared_path);
 //    }
     
+    // N.B.: team_future_trails_pcl_mutex_ is locked by computeTrav()
     if (b_enable_team_avoidance_ && b_set_team_future_trails_pcl_)
     {
-        boost::recursive_mutex::scoped_lock team_future_trails_pcl_locker(team_future_trails_pcl_mutex_);
-        
         float dist_future_trails_pcl = std::numeric_limits<float>::max();
                 
         std::vector<int> pointIdxNKNSearch(1);
@@ -500,6 +952,25 @@ void TravAnalyzer::getPcl(PointCloudI& clearence_pcl, PointCloudI& density_pcl,
     roughness_pcl = roughness_pcl_;
 }
 
+void TravAnalyzer::getTravChannelsPcl(pcl::PointCloud<PointXYZTrav>& channels_pcl)
+{
+    channels_pcl.clear();
+    channels_pcl.header = traversabilty_pcl_.header;
+    channels_pcl.resize(traversabilty_pcl_.size());
+    for (size_t i = 0, iEnd = traversabilty_pcl_.size(); i < iEnd; i++)
+    {
+        PointXYZTrav& p = channels_pcl[i];
+        p.x = traversabilty_pcl_[i].x;
+        p.y = traversabilty_pcl_[i].y;
+        p.z = traversabilty_pcl_[i].z;
+        p.intensity = traversabilty_pcl_[i].intensity;
+        p.clearance = clearence_pcl_[i].intensity;
+        p.density = density_pcl_[i].intensity;
+        p.label = label_pcl_[i].intensity;
+        p.roughness = roughness_pcl_[i].intensity;
+    }
+}
+
 void TravAnalyzer::setRobotToAvoidPosition(const geometry_msgs::TransformStamped& msg)
 {
 //    if (!b_enable_team_avoidance_) return;
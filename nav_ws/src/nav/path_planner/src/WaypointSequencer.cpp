@@ -0,0 +1,191 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "WaypointSequencer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+
+const double WaypointSequencer::kDefaultTimeBudgetSec = 0.5; // [s]
+const int WaypointSequencer::kMaxOrOptChainLength = 3;
+
+namespace
+{
+const double kMinGain = 1e-9; // min cost decrease for applying a move
+}
+
+WaypointSequencer::WaypointSequencer(double time_budget_sec):time_budget_sec_(time_budget_sec), p_costs_(0), num_nodes_(0), num_waypoint_positions_(0)
+{
+    stats_.initial_cost = stats_.cost = 0;
+    stats_.num_moves = 0;
+    stats_.b_timeout = false;
+}
+
+double WaypointSequencer::solve(const std::vector<double>& costs, const std::vector<int>& priorities, bool b_closed, std::vector<int>& order_out)
+{
+    typedef std::chrono::steady_clock Clock;
+    const Clock::time_point time_start = Clock::now();
+
+    p_costs_ = &costs;
+    num_nodes_ = (size_t) std::floor(std::sqrt((double) costs.size()) + 0.5);
+    const size_t num_waypoints = (num_nodes_ > 0) ? num_nodes_ - 1 : 0;
+    const bool b_use_priorities = (priorities.size() == num_waypoints);
+
+    stats_.initial_cost = stats_.cost = 0;
+    stats_.num_moves = 0;
+    stats_.b_timeout = false;
+    order_out.clear();
+    if (num_waypoints == 0) return 0; /// < EXIT POINT
+
+    /// < sort the waypoints by decreasing priority (stable) and split them in blocks of equal priority
+    std::vector<int> waypoints(num_waypoints);
+    for (size_t i = 0; i < num_waypoints; i++) waypoints[i] = i + 1;
+    if (b_use_priorities)
+    {
+        std::stable_sort(waypoints.begin(), waypoints.end(), [&priorities](int a, int b) { return priorities[a - 1] > priorities[b - 1]; });
+    }
+    std::vector<size_t> block_begins; // tour positions, the last one is the end of the last block
+    for (size_t i = 0; i < num_waypoints; i++)
+    {
+        if ((i == 0) || (b_use_priorities && (priorities[waypoints[i] - 1] != priorities[waypoints[i - 1] - 1]))) block_begins.push_back(i + 1);
+    }
+    block_begins.push_back(num_waypoints + 1);
+
+    /// < nearest neighbor chain within each block
+    tour_.assign(1, 0);
+    for (size_t b = 0; b + 1 < block_begins.size(); b++)
+    {
+        std::vector<int> remaining(waypoints.begin() + block_begins[b] - 1, waypoints.begin() + block_begins[b + 1] - 1);
+        while (!remaining.empty())
+        {
+            size_t best = 0;
+            for (size_t k = 1; k < remaining.size(); k++)
+            {
+                if (getCost(tour_.back(), remaining[k]) < getCost(tour_.back(), remaining[best])) best = k;
+            }
+            tour_.push_back(remaining[best]);
+            remaining.erase(remaining.begin() + best);
+        }
+    }
+    if (b_closed) tour_.push_back(0);
+    num_waypoint_positions_ = num_waypoints;
+
+    updatePrefixCosts();
+    stats_.initial_cost = forward_cost_.back();
+
+    /// < local search
+    bool b_improved = true;
+    while (b_improved)
+    {
+        b_improved = false;
+        for (size_t b = 0; b + 1 < block_begins.size(); b++)
+        {
+            if (std::chrono::duration<double>(Clock::now() - time_start).count() > time_budget_sec_)
+            {
+                stats_.b_timeout = true;
+                break; /// < BREAK
+            }
+            while (improveTwoOpt(block_begins[b], block_begins[b + 1]) || improveOrOpt(block_begins[b], block_begins[b + 1]))
+            {
+                b_improved = true;
+                stats_.num_moves++;
+                if (std::chrono::duration<double>(Clock::now() - time_start).count() > time_budget_sec_) break; /// < BREAK
+            }
+        }
+        if (stats_.b_timeout) break; /// < BREAK
+    }
+
+    stats_.cost = forward_cost_.back();
+    order_out.assign(tour_.begin() + 1, tour_.begin() + 1 + num_waypoints);
+    p_costs_ = 0;
+    return stats_.cost;
+}
+
+void WaypointSequencer::updatePrefixCosts()
+{
+    forward_cost_.resize(tour_.size());
+    backward_cost_.resize(tour_.size());
+    forward_cost_[0] = backward_cost_[0] = 0;
+    for (size_t k = 1; k < tour_.size(); k++)
+    {
+        forward_cost_[k] = forward_cost_[k - 1] + getCost(tour_[k - 1], tour_[k]);
+        backward_cost_[k] = backward_cost_[k - 1] + getCost(tour_[k], tour_[k - 1]);
+    }
+}
+
+bool WaypointSequencer::improveTwoOpt(size_t block_begin, size_t block_end)
+{
+    const size_t tour_size = tour_.size();
+    for (size_t i = block_begin; i < block_end; i++)
+    {
+        const int prev = tour_[i - 1];
+        for (size_t j = i + 1; j < block_end; j++)
+        {
+            // reverse the positions i..j: prev -> tour_[j] -> ... -> tour_[i] -> next
+            double gain = getCost(prev, tour_[i]) - getCost(prev, tour_[j]);
+            gain += (forward_cost_[j] - forward_cost_[i]) - (backward_cost_[j] - backward_cost_[i]);
+            if (j + 1 < tour_size) gain += getCost(tour_[j], tour_[j + 1]) - getCost(tour_[i], tour_[j + 1]);
+            if (gain > kMinGain)
+            {
+                std::reverse(tour_.begin() + i, tour_.begin() + j + 1);
+                updatePrefixCosts();
+                return true; /// < EXIT POINT
+            }
+        }
+    }
+    return false;
+}
+
+bool WaypointSequencer::improveOrOpt(size_t block_begin, size_t block_end)
+{
+    const size_t tour_size = tour_.size();
+    for (int length = 1; length <= kMaxOrOptChainLength; length++)
+    {
+        for (size_t i = block_begin; i + length <= block_end; i++)
+        {
+            // chain tour_[i..last] between prev and next
+            const size_t last = i + length - 1;
+            const int prev = tour_[i - 1];
+            double removal_gain = getCost(prev, tour_[i]);
+            if (last + 1 < tour_size) removal_gain += getCost(tour_[last], tour_[last + 1]) - getCost(prev, tour_[last + 1]);
+
+            // insert the chain after the position p (between tour_[p] and tour_[p + 1]) within the block
+            for (size_t p = block_begin - 1; p < block_end; p++)
+            {
+                if ((p + 1 >= i) && (p <= last)) continue; /// < CONTINUE (same place or inside the chain)
+                double insertion_cost = getCost(tour_[p], tour_[i]);
+                if (p + 1 < tour_size) insertion_cost += getCost(tour_[last], tour_[p + 1]) - getCost(tour_[p], tour_[p + 1]);
+                if (removal_gain - insertion_cost > kMinGain)
+                {
+                    std::vector<int> chain(tour_.begin() + i, tour_.begin() + last + 1);
+                    tour_.erase(tour_.begin() + i, tour_.begin() + last + 1);
+                    const size_t insert_pos = (p < i) ? p + 1 : p + 1 - length;
+                    tour_.insert(tour_.begin() + insert_pos, chain.begin(), chain.end());
+                    updatePrefixCosts();
+                    return true; /// < EXIT POINT
+                }
+            }
+        }
+    }
+    return false;
+}
@@ -30,7 +30,15 @@
 #include <robot_trajectory_saver_msgs/GetRobotTrajectories.h>
 
 #include "KdTreeFLANN.h"
+#include "PointCloudDelta.h"
+#include <mr3d_profiling/ProfilerExporter.h>
+#include "LatencyTracer.h"
 #include "MultiConfig.h"
+#include "PointCloudShm.h"
+
+// the node state is shared by the compute_normals node and the ComputeNormalsNodelet (one instance per process)
+namespace compute_normals
+{
 
 int number_of_robots = 2; 
 int robot_id         = 0;
@@ -39,7 +47,12 @@ NormalEstimationPcl<pcl::PointXYZRGBNormal> normal_estimator;
 ConversionPcl<pcl::PointXYZRGBNormal> conv_pcl;
 
 ros::Publisher marker_normal_pub;
-ros::Publisher pcl_pub;
+PointCloudShmPublisher pcl_pub;
+
+bool b_publish_delta = false;
+PointCloudDeltaPublisher<pcl::PointXYZRGBNormal> pcl_delta_pub;
+
+LatencyTracer latency_tracer;
 
 ros::ServiceClient robot_traj_service_client;
 
@@ -98,21 +111,30 @@ void computeAndPublishNormals()
         pcl::PointCloud<pcl::PointXYZRGBNormal> pcl_out;
             
         /// < normal estimation
-        pp::KdTreeFLANN<pcl::PointXYZRGBNormal> kdtree;
-        kdtree.setInputCloud(pcl_shared);
         tf::Transform t;
         pcl::PointXYZ laser_center;
         conv_pcl.getLastTransform(t);
         conv_pcl.getFrameOrigin(normal_config.laser_frame, laser_center);
-        normal_estimator.computeNormals(*pcl_shared, kdtree, laser_center);
+        if (normal_config.incremental_update)
+        {
+            normal_estimator.computeNormalsIncremental(pcl_shared, laser_center);
+        }
+        else
+        {
+            pp::KdTreeFLANN<pcl::PointXYZRGBNormal> kdtree;
+            kdtree.setInputCloud(pcl_shared);
+            normal_estimator.computeNormals(*pcl_shared, kdtree, laser_center);
+        }
         std::vector<int> index;
         pcl::removeNaNNormalsFromPointCloud(*pcl_shared, pcl_out, index);
 
         //colorNormalsPCL(map_pcl);
         visualizeNormals(pcl_out);
-        sensor_msgs::PointCloud2 msg_out;
-        pcl::toROSMsg(pcl_out, msg_out);
+        sensor_msgs::PointCloud2Ptr msg_out(new sensor_msgs::PointCloud2()); // published by pointer: no copies for the nodelets in the same process
+        pcl::toROSMsg(pcl_out, *msg_out);
         pcl_pub.publish(msg_out);
+        if (b_publish_delta) pcl_delta_pub.publish(pcl_out);
+        latency_tracer.end();
         
         lastCallTime = ros::Time::now();   
         ROS_INFO_STREAM("computeAndPublishNormals() - lastCallTime: " << (lastCallTime-time0).toSec());           
@@ -123,6 +145,8 @@ void pointCloudCallback(const sensor_msgs::PointCloud2& pcl_msg)
 {
     boost::recursive_mutex::scoped_lock locker(compute_mutex);    
     
+    latency_tracer.begin(pcl_msg.header.stamp); // the output cloud keeps the stamp of the input one
+    
     std::cout << std::endl; 
     ROS_INFO_STREAM("compute normals - Received a new PointCloud2 message ");
 
@@ -199,13 +223,16 @@ void normalConfigCallback(NormalEstimationPclConfig& config, uint32_t level)
     normal_estimator.setConfig(config);
 }
 
-int main(int argc, char **argv)
-{
-    ros::init(argc, argv, "compute_normals");
-
-    tf::TransformListener tf_listener(ros::Duration(10.0));
+// resources which live as long as the node 
+boost::shared_ptr<tf::TransformListener> p_tf_listener;
+boost::shared_ptr<dynamic_reconfigure::Server<NormalEstimationPclConfig> > p_normal_config_server;
+PointCloudShmSubscriber sub_pcl;
+ros::Subscriber sub_saved_trajectory;
 
-    ros::NodeHandle n("~");
+// n is the private node handle of the node (or of the nodelet)
+void init(ros::NodeHandle& n)
+{
+    p_tf_listener.reset(new tf::TransformListener(ros::Duration(10.0)));
     
     time0 = ros::Time::now();
 
@@ -234,21 +261,29 @@ int main(int argc, char **argv)
         NormalEstimationPclConfig& normal_config = normal_estimator.getConfig();
         normal_config.laser_frame = laser_frame_name;
     }
+    b_publish_delta = getParam<bool>(n, "publish_delta", false);
+    if (getParam<bool>(n, "enable_latency_tracing", false)) latency_tracer.init(n, "compute_normals");
+    if (getParam<bool>(n, "enable_profiler", false))
+    {
+        mr3d_profiling::ProfilerExporter::instance().start(n, getParam<std::string>(n, "profiler_stats_file", std::string()));
+    }
     robot_traj_service_name = getParam<std::string>(n, "robot_traj_service_name", "/robot_trajectory_saver_node/get_robot_trajectories_nav_msgs");
 
     /// < dynamic reconfigure 
-    dynamic_reconfigure::Server<NormalEstimationPclConfig> normal_config_server(ros::NodeHandle("~/NormalEstimationPcl"));
-    normal_config_server.setCallback(boost::bind(&normalConfigCallback, _1, _2));
+    p_normal_config_server.reset(new dynamic_reconfigure::Server<NormalEstimationPclConfig>(ros::NodeHandle(n, "NormalEstimationPcl")));
+    p_normal_config_server->setCallback(boost::bind(&normalConfigCallback, _1, _2));
 
-    conv_pcl.setTFListener(tf_listener);
+    conv_pcl.setTFListener(*p_tf_listener);
 
     /// < Input
-    ros::Subscriber sub_pcl = n.subscribe("/cloud_in", 1, pointCloudCallback);
-    ros::Subscriber sub_saved_trajectory = n.subscribe("/laser_mapper/trajectory_from_file", 1, savedTrajCallback);
+    const bool b_use_shm_transport = getParam<bool>(n, "use_shm_transport", false);
+    sub_pcl.subscribe(n, "/cloud_in", 1, pointCloudCallback, b_use_shm_transport);
+    sub_saved_trajectory = n.subscribe("/laser_mapper/trajectory_from_file", 1, savedTrajCallback);
 
     /// < Ouput
     marker_normal_pub = n.advertise<geometry_msgs::PoseArray>("/normals_marker", 1);
-    pcl_pub = n.advertise<sensor_msgs::PointCloud2>("/cloud_out", 1, true);
+    pcl_pub.advertise(n, "/cloud_out", 1, true, b_use_shm_transport);
+    if (b_publish_delta) pcl_delta_pub.init(n, "/cloud_out_delta");
 
     /// < Services 
     robot_traj_service_client = n.serviceClient<robot_trajectory_saver_msgs::GetRobotTrajectories>(robot_traj_service_name);
@@ -257,8 +292,20 @@ int main(int argc, char **argv)
 #if 0    
     normals_task_timer = n.createTimer(ros::Duration(kNormalsTaskCallbackPeriod), normalsTaskCallback); // the timer will automatically fire at startup        
 #endif     
+}
+
+} // namespace compute_normals
+
+#ifndef PATH_PLANNER_NODELET // the nodelet library is built from the same sources 
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "compute_normals");
+
+    ros::NodeHandle n("~");
+    compute_normals::init(n);
 
     ros::spin();
     return 0;
 }
+#endif
 
@@ -28,6 +28,10 @@
 #include <dynamic_reconfigure/server.h>
 
 #include "KdTreeFLANN.h"
+#include "BlockHashMap.h"
+#include "PointCloudDelta.h"
+#include "LatencyTracer.h"
+#include "PointCloudShm.h"
 
 
 DynamicJoinPcl<pcl::PointXYZRGBNormal, pcl::PointXYZRGBNormal> dynjoinpcl;
@@ -36,10 +40,20 @@ ConversionPcl<pcl::PointXYZ> conv_pcl;
 
 ros::Publisher pcl_normal_pub;
 ros::Publisher marker_normal_pub;
-ros::Publisher pcl_pub;
+PointCloudShmPublisher pcl_pub;
+
+// map deltas: only the changed blocks are serialized
+bool b_publish_delta = false;
+PointCloudDeltaPublisher<pcl::PointXYZRGBNormal> pcl_delta_pub;
+
+LatencyTracer latency_tracer;
 
 pcl::PointCloud<pcl::PointXYZRGBNormal> map_pcl;
 
+// map stored by spatial blocks: each join processes only the blocks around the laser and the blocks of the scan
+bool b_use_block_map = false;
+BlockHashMap<pcl::PointXYZRGBNormal> block_map;
+
 std::string laser_frame_name;
 std::string global_frame_name;
 
@@ -68,6 +82,7 @@ void visualizeNormals(pcl::PointCloud<pcl::PointXYZRGBNormal>& pcl_norm)
 void pointCloudCallback(const sensor_msgs::PointCloud2& scan_msg)
 {
     ROS_INFO("Received a new PointCloud2 message");
+    latency_tracer.begin(scan_msg.header.stamp);
 
     DynamicJoinPclConfig dynjoinpcl_config = dynjoinpcl.getConfig();
     NormalEstimationPclConfig normal_config = normal_estimator.getConfig();
@@ -95,13 +110,36 @@ void pointCloudCallback(const sensor_msgs::PointCloud2& scan_msg)
     // dynamic join
     pcl::PointCloud<pcl::PointXYZRGBNormal> map_new_pcl;
     map_new_pcl.header = map_pcl.header;
-    dynjoinpcl.joinPCL(scan_norm_pcl, map_pcl, map_new_pcl, laser_center);
-    map_pcl.swap(map_new_pcl);
+    if (b_use_block_map)
+    {
+        // join only the local map: the blocks within radius_near from the laser (where points can be removed) and the blocks of the scan (where points are added)
+        BlockHashMap<pcl::PointXYZRGBNormal>::BlockKeySet keys;
+        block_map.getBlockKeysInSphere(laser_center, dynjoinpcl_config.radius_near, keys);
+        block_map.getBlockKeysOfPoints(scan_norm_pcl, keys);
+
+        pcl::PointCloud<pcl::PointXYZRGBNormal> local_map_pcl;
+        local_map_pcl.header = map_pcl.header;
+        block_map.extract(keys, local_map_pcl);
+        dynjoinpcl.joinPCL(scan_norm_pcl, local_map_pcl, map_new_pcl, laser_center);
+        block_map.replace(keys, map_new_pcl);
+        block_map.clearChanged();
+
+        block_map.toPointCloud(map_pcl); // the header is kept
+        ROS_INFO("block map: %ld points, %ld blocks, %ld joined points", block_map.size(), block_map.getNumBlocks(), local_map_pcl.size());
+    }
+    else
+    {
+        dynjoinpcl.joinPCL(scan_norm_pcl, map_pcl, map_new_pcl, laser_center);
+        map_pcl.swap(map_new_pcl);
+    }
     //colorNormalsPCL(map_pcl);
     visualizeNormals(map_pcl);
+    pcl_conversions::toPCL(scan_msg.header.stamp, map_pcl.header.stamp); // the map carries the stamp of the last joined scan
     sensor_msgs::PointCloud2 map_msg_out;
     pcl::toROSMsg(map_pcl, map_msg_out);
     pcl_pub.publish(map_msg_out);
+    if (b_publish_delta) pcl_delta_pub.publish(map_pcl);
+    latency_tracer.end();
 }
 
 void dynjoinpclConfigCallback(DynamicJoinPclConfig& config, uint32_t level)
@@ -132,6 +170,11 @@ int main(int argc, char **argv)
         normal_config.laser_frame = laser_frame_name;
     }
 
+    b_use_block_map = getParam<bool>(n, "use_block_map", false);
+    b_publish_delta = getParam<bool>(n, "publish_delta", false);
+    if (getParam<bool>(n, "enable_latency_tracing", false)) latency_tracer.init(n, "mapping");
+    block_map.setBlockSize(getParam<double>(n, "block_size", BlockHashMap<pcl::PointXYZRGBNormal>::kDefaultBlockSize));
+
     dynamic_reconfigure::Server<DynamicJoinPclConfig> dynjoinpcl_config_server(ros::NodeHandle("~/DynamicJoinPcl"));
     dynjoinpcl_config_server.setCallback(boost::bind(&dynjoinpclConfigCallback, _1, _2));
 
@@ -143,7 +186,8 @@ int main(int argc, char **argv)
     ros::Subscriber sub_pcl = n.subscribe("/dynamic_point_cloud", 1, pointCloudCallback);
 
     marker_normal_pub = n.advertise<geometry_msgs::PoseArray>("/normals_marker", 1);
-    pcl_pub = n.advertise<sensor_msgs::PointCloud2>("/dynjoinpcl", 1, true);
+    pcl_pub.advertise(n, "/dynjoinpcl", 1, true, getParam<bool>(n, "use_shm_transport", false));
+    if (b_publish_delta) pcl_delta_pub.init(n, "/dynjoinpcl_delta");
 
     ros::spin();
     return 0;
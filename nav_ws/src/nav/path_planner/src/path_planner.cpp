@@ -27,6 +27,7 @@
 #include "PathPlanner.h"  // stay before any pcl include, it contains PCL_NO_PRECOMPILE directive
 
 #include <MarkerController.h>
+#include <mr3d_profiling/ProfilerExporter.h>
 #include <geometry_msgs/PoseArray.h>
 #include <dynamic_reconfigure/server.h>
 #include <boost/thread/thread.hpp>
@@ -331,6 +332,10 @@ int main(int argc, char **argv)
     /// < get parameters
 
     robot_frame_id = getParam<std::string>(n, "robot_frame_name", "/base_link");
+    if (getParam<bool>(n, "enable_profiler", false))
+    {
+        mr3d_profiling::ProfilerExporter::instance().start(n, getParam<std::string>(n, "profiler_stats_file", std::string()));
+    }
     goal_topic_name = getParam<std::string>(n, "goal_topic_name", "/goal_topic");
     goal_abort_topic_name = getParam<std::string>(n, "goal_abort_topic_name", "/goal_abort_topic");
     int_marker_server_name = getParam<std::string>(n, "int_marker_server_name", "marker_controller");
@@ -366,7 +371,7 @@ int main(int argc, char **argv)
 
     p_act_client.reset(new actionlib::SimpleActionClient<trajectory_control_msgs::TrajectoryControlAction>(trajectory_control_node_name,true)); 
     
-    ros::MultiThreadedSpinner spinner(4); // Use 4 threads
+    ros::MultiThreadedSpinner spinner(getParam<int>(n, "num_spinner_threads", 4)); // Use 4 threads (1: callbacks in arrival order)
     spinner.spin(); // spin() will not return until the node has been shutdown
     
     //ros::spin();
@@ -0,0 +1,330 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <ros/time.h>
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/resource.h>
+
+#include <boost/format.hpp>
+
+#include <pcl/io/pcd_io.h>
+#include <pcl/filters/filter.h>
+
+#include <DynamicJoinPcl.h>
+#include <NormalEstimationPcl.h>
+#include <ClusterPcl.h>
+#include <TravAnalyzer.h>
+#include <PathPlanner.h>
+
+#include "KdTreeFLANN.h"
+
+
+/// < offline benchmark of the navigation stack: no ROS master, no topics, no tf
+/// < the PCD snapshots (in map frame, the sensor origin is read from the VIEWPOINT field) are joined one by one as scans by DynamicJoinPcl, 
+/// < then the normals, the clustering, the traversability and a set of seeded random planning queries are computed on the assembled map
+/// < N.B.: bag snapshots can be exported to PCD first, e.g. with 'rosrun pcl_ros bag_to_pcd <bag> <topic> <folder>'
+
+const int kDefaultNumThreads = 2;
+const unsigned int kDefaultSeed = 0;
+const int kDefaultNumQueries = 20;
+const int kDefaultNumRepetitions = 1;
+
+struct BenchOptions
+{
+    std::vector<std::string> pcd_files;
+    int num_threads = kDefaultNumThreads;
+    unsigned int seed = kDefaultSeed;
+    int num_queries = kDefaultNumQueries;
+    int num_repetitions = kDefaultNumRepetitions;
+};
+
+struct StageStats
+{
+    std::string name;
+    double time_sec = 0;      // [s] mean time of a repetition
+    double time_min_sec = 0;  // [s] min time of a repetition
+    size_t num_items = 0;     // processed points (or expansions for the planning)
+    long max_rss_kb = 0;      // [KB] memory high-water mark of the process at the end of the stage
+};
+
+void printUsage(const char* name)
+{
+    std::cout << "usage: " << name << " [options] <map_0.pcd> [<map_1.pcd> ...]" << std::endl;
+    std::cout << "  -t <num>  number of threads (default: " << kDefaultNumThreads << ")" << std::endl;
+    std::cout << "  -s <num>  random seed of the planning queries and of the planner (default: " << kDefaultSeed << ")" << std::endl;
+    std::cout << "  -q <num>  number of planning queries (default: " << kDefaultNumQueries << ")" << std::endl;
+    std::cout << "  -r <num>  number of repetitions of each stage (default: " << kDefaultNumRepetitions << ")" << std::endl;
+}
+
+bool parseOptions(int argc, char** argv, BenchOptions& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        if ((arg.size() == 2) && (arg[0] == '-'))
+        {
+            if (i + 1 >= argc) return false; /// < EXIT POINT
+            const int value = atoi(argv[++i]);
+            switch (arg[1])
+            {
+            case 't': options.num_threads = std::max(value, 1); break;
+            case 's': options.seed = (unsigned int) value; break;
+            case 'q': options.num_queries = std::max(value, 0); break;
+            case 'r': options.num_repetitions = std::max(value, 1); break;
+            default: return false; /// < EXIT POINT
+            }
+        }
+        else
+        {
+            options.pcd_files.push_back(arg);
+        }
+    }
+    return !options.pcd_files.empty();
+}
+
+long getMaxRssKb()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss; // [KB] on Linux
+}
+
+void addStageTime(StageStats& stats, double time_sec, int repetition)
+{
+    stats.time_min_sec = (repetition == 0) ? time_sec : std::min(stats.time_min_sec, time_sec);
+    stats.time_sec += time_sec;
+}
+
+void endStage(StageStats& stats, int num_repetitions, std::vector<StageStats>& all_stats)
+{
+    stats.time_sec /= num_repetitions;
+    stats.max_rss_kb = getMaxRssKb();
+    all_stats.push_back(stats);
+    std::cout << "- " << stats.name << ": " << stats.time_sec << " s " << std::endl;
+}
+
+void printReport(const std::vector<StageStats>& all_stats)
+{
+    std::cout << std::endl;
+    std::cout << boost::format("%-14s %12s %12s %12s %16s %14s") % "stage" % "mean [s]" % "min [s]" % "items" % "items/s" % "max RSS [MB]" << std::endl;
+    for (size_t i = 0; i < all_stats.size(); i++)
+    {
+        const StageStats& stats = all_stats[i];
+        const double throughput = (stats.time_sec > 0) ? stats.num_items/stats.time_sec : 0;
+        std::cout << boost::format("%-14s %12.4f %12.4f %12d %16.1f %14.1f") % stats.name % stats.time_sec % stats.time_min_sec % stats.num_items % throughput % (stats.max_rss_kb/1024.) << std::endl;
+    }
+    std::cout << "(items: points for the map stages, node expansions for the planning)" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    ros::Time::init(); // some modules stamp their timings with ros::Time::now() (no master is needed)
+
+    std::vector<StageStats> all_stats;
+    const int num_repetitions = options.num_repetitions;
+
+    /// < load the snapshots
+
+    StageStats load_stats;
+    load_stats.name = "load";
+    std::vector<pcl::PointCloud<pcl::PointXYZ> > snapshots(options.pcd_files.size());
+    ros::WallTime time_start = ros::WallTime::now();
+    for (size_t i = 0; i < options.pcd_files.size(); i++)
+    {
+        if (pcl::io::loadPCDFile(options.pcd_files[i], snapshots[i]) < 0)
+        {
+            std::cout << "cannot load " << options.pcd_files[i] << std::endl;
+            return 1;
+        }
+        std::vector<int> index;
+        pcl::removeNaNFromPointCloud(snapshots[i], snapshots[i], index);
+        load_stats.num_items += snapshots[i].size();
+    }
+    addStageTime(load_stats, (ros::WallTime::now() - time_start).toSec(), 0);
+    endStage(load_stats, 1, all_stats);
+
+    /// < join the snapshots into the map
+
+    DynamicJoinPcl<pcl::PointXYZ, pcl::PointXYZRGBNormal> dynjoinpcl;
+    DynamicJoinPclConfig join_config = DynamicJoinPclConfig::__getDefault__();
+    join_config.num_threads = options.num_threads;
+    dynjoinpcl.setConfig(join_config);
+
+    StageStats join_stats;
+    join_stats.name = "join";
+    pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr map_pcl(new pcl::PointCloud<pcl::PointXYZRGBNormal>);
+    for (int rep = 0; rep < num_repetitions; rep++)
+    {
+        pcl::PointCloud<pcl::PointXYZRGBNormal> map_old, map_new;
+        map_old.header.frame_id = join_config.global_frame;
+        time_start = ros::WallTime::now();
+        for (size_t i = 0; i < snapshots.size(); i++)
+        {
+            snapshots[i].header.frame_id = join_config.global_frame;
+            const pcl::PointXYZ laser_center(snapshots[i].sensor_origin_[0], snapshots[i].sensor_origin_[1], snapshots[i].sensor_origin_[2]);
+            dynjoinpcl.joinPCL(snapshots[i], map_old, map_new, laser_center);
+            map_new.header.frame_id = join_config.global_frame;
+            map_old.swap(map_new);
+        }
+        addStageTime(join_stats, (ros::WallTime::now() - time_start).toSec(), rep);
+        *map_pcl = map_old;
+    }
+    join_stats.num_items = load_stats.num_items;
+    endStage(join_stats, num_repetitions, all_stats);
+    std::cout << "  map size: " << map_pcl->size() << std::endl;
+
+    /// < normals 
+
+    NormalEstimationPcl<pcl::PointXYZRGBNormal> normal_estimator;
+    NormalEstimationPclConfig normal_config = NormalEstimationPclConfig::__getDefault__();
+    normal_config.num_threads = options.num_threads;
+    normal_config.incremental_update = false;
+    normal_estimator.setConfig(normal_config);
+
+    const pcl::PointXYZ map_center(snapshots.back().sensor_origin_[0], snapshots.back().sensor_origin_[1], snapshots.back().sensor_origin_[2]);
+
+    StageStats normals_stats;
+    normals_stats.name = "normals";
+    pcl::PointCloud<pcl::PointXYZRGBNormal> normals_pcl;
+    for (int rep = 0; rep < num_repetitions; rep++)
+    {
+        pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr pcl_in(new pcl::PointCloud<pcl::PointXYZRGBNormal>(*map_pcl));
+        time_start = ros::WallTime::now();
+        pp::KdTreeFLANN<pcl::PointXYZRGBNormal> kdtree;
+        kdtree.setInputCloud(pcl_in);
+        normal_estimator.computeNormals(*pcl_in, kdtree, map_center);
+        addStageTime(normals_stats, (ros::WallTime::now() - time_start).toSec(), rep);
+
+        std::vector<int> index;
+        pcl::removeNaNNormalsFromPointCloud(*pcl_in, normals_pcl, index);
+    }
+    normals_stats.num_items = map_pcl->size();
+    endStage(normals_stats, num_repetitions, all_stats);
+
+    /// < clustering
+
+    ClusterPcl<pcl::PointXYZRGBNormal> clustering_pcl;
+    ClusterPclConfig cluster_config = ClusterPclConfig::__getDefault__();
+    clustering_pcl.setConfig(cluster_config);
+
+    StageStats clustering_stats;
+    clustering_stats.name = "clustering";
+    std::vector<int> cluster_info;
+    pcl::PointCloud<pcl::PointXYZRGBNormal> nowall_pcl, border_pcl, segmented_pcl, wall_pcl;
+    for (int rep = 0; rep < num_repetitions; rep++)
+    {
+        nowall_pcl.clear(); border_pcl.clear(); segmented_pcl.clear(); wall_pcl.clear();
+        time_start = ros::WallTime::now();
+        clustering_pcl.setInputPcl(normals_pcl);
+        clustering_pcl.clustering(nowall_pcl, border_pcl, segmented_pcl, wall_pcl);
+        clustering_pcl.getClusterInfo(cluster_info);
+        addStageTime(clustering_stats, (ros::WallTime::now() - time_start).toSec(), rep);
+    }
+    clustering_stats.num_items = normals_pcl.size();
+    endStage(clustering_stats, num_repetitions, all_stats);
+
+    /// < traversability
+
+    TravAnalyzer trav_analyzer;
+    TravAnalyzerConfig trav_config = TravAnalyzerConfig::__getDefault__();
+    trav_config.num_threads = options.num_threads;
+    trav_config.incremental_update = false;
+    trav_analyzer.setConfig(trav_config);
+
+    StageStats trav_stats;
+    trav_stats.name = "traversability";
+    pcl::PointCloud<pcl::PointXYZI>::Ptr traversability_pcl(new pcl::PointCloud<pcl::PointXYZI>);
+    for (int rep = 0; rep < num_repetitions; rep++)
+    {
+        traversability_pcl->clear();
+        time_start = ros::WallTime::now();
+        trav_analyzer.setInput(cluster_info, wall_pcl, nowall_pcl);
+        trav_analyzer.computeTrav(*traversability_pcl);
+        addStageTime(trav_stats, (ros::WallTime::now() - time_start).toSec(), rep);
+    }
+    trav_stats.num_items = nowall_pcl.size();
+    endStage(trav_stats, num_repetitions, all_stats);
+    std::cout << "  traversability size: " << traversability_pcl->size() << ", wall size: " << wall_pcl.size() << std::endl;
+
+    /// < planning between seeded random pairs of traversability points (the planner needs the wall cloud for computing the clearance)
+
+    if ((traversability_pcl->size() > 1) && !wall_pcl.empty() && (options.num_queries > 0))
+    {
+        pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr p_wall_pcl(new pcl::PointCloud<pcl::PointXYZRGBNormal>(wall_pcl));
+
+        boost::shared_ptr<PathPlanner::KdTreeFLANN> p_traversability_kdtree(new PathPlanner::KdTreeFLANN);
+        p_traversability_kdtree->setInputCloud(traversability_pcl);
+        boost::shared_ptr<PathPlanner::WallKdTreeFLANN> p_wall_kdtree(new PathPlanner::WallKdTreeFLANN);
+        p_wall_kdtree->setInputCloud(p_wall_pcl);
+
+        PathPlanner path_planner(false); // no publishers
+        path_planner.setRandomSeed(options.seed);
+
+        std::mt19937 query_generator(options.seed);
+        std::uniform_int_distribution<int> index_distribution(0, traversability_pcl->size() - 1);
+        std::vector<std::pair<int, int> > queries(options.num_queries);
+        for (size_t i = 0; i < queries.size(); i++)
+        {
+            queries[i].first = index_distribution(query_generator);
+            queries[i].second = index_distribution(query_generator);
+        }
+
+        StageStats planning_stats;
+        planning_stats.name = "planning";
+        int num_found_paths = 0;
+        for (int rep = 0; rep < num_repetitions; rep++)
+        {
+            size_t num_expansions = 0;
+            num_found_paths = 0;
+            time_start = ros::WallTime::now();
+            for (size_t i = 0; i < queries.size(); i++)
+            {
+                pcl::PointXYZI goal = (*traversability_pcl)[queries[i].second];
+                nav_msgs::Path path;
+                path_planner.setInput(traversability_pcl, p_wall_pcl, p_wall_kdtree, p_traversability_kdtree, queries[i].first);
+                if (path_planner.setGoal(goal) && path_planner.planning(path)) num_found_paths++;
+                num_expansions += path_planner.getNumExpansions();
+            }
+            addStageTime(planning_stats, (ros::WallTime::now() - time_start).toSec(), rep);
+            planning_stats.num_items = num_expansions;
+        }
+        endStage(planning_stats, num_repetitions, all_stats);
+        std::cout << "  found paths: " << num_found_paths << "/" << queries.size() << std::endl;
+    }
+
+    printReport(all_stats);
+
+    return 0;
+}
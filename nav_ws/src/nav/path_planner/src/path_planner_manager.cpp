@@ -46,7 +46,9 @@
 #include <trajectory_control_msgs/PlanningGlobalPath.h>
 #include <trajectory_control_msgs/PlanningStatus.h>
 #include <trajectory_control_msgs/PathPlanning.h>
+#include <trajectory_control_msgs/PathCosts.h>
 #include <trajectory_control_msgs/RobotPath.h>
+#include <trajectory_control_msgs/MultiRobotPath.h>
  
 #include <wireless_network_msgs/RequestRSS_PC.h>
 #include <networkanalysis_msgs/wirelesslink.h>
@@ -57,8 +59,17 @@
 #include "MarkerController.h"
 #include "Transform.h"
 #include "QueuePathPlanner.h"
+#include "PriorMapClient.h"
+#include "PointCloudDelta.h"
+#include <mr3d_profiling/ProfilerExporter.h>
+#include "LatencyTracer.h"
+#include "PointCloudShm.h"
 
 
+// the node state is shared by the path_planner_manager node and the PathPlannerManagerNodelet (one instance per process)
+namespace path_planner_manager
+{
+
 /// < PARAMETERS 
 
 const double kMinimumWaitingTimeForPublishingANewPath = 0.5;//0.5; // [s] minimum time to wait for giving a new path as input 
@@ -123,6 +134,12 @@ std::string robot_frame_id;
 
 bool b_enable_laser_proximity_callback=false;
 
+// space-time reservations of the team (cooperative planning, see ReservationTable)
+ReservationTable::Ptr p_reservation_table; // null if disabled 
+ros::Publisher path_reservations_pub;
+int robot_id = 0; 
+double nominal_speed = PathPlanner::kDefaultNominalSpeed; // [m/s]
+
 
 // RSS stuff 
 boost::shared_ptr<ros::ServiceClient> p_srv_client_rss;
@@ -329,6 +346,7 @@ void setDefinitiveFailure()
     p_planner_manager->setNoGoal();
     
     resetGlobalPath();
+    publishPathReservation(nav_msgs::Path());
     
     // communicate definitive failure
     trajectory_control_msgs::PlanningStatus msg_plan_status;
@@ -349,32 +367,52 @@ bool isSolutionFoundOnce()
     return global_path.isSet() || p_planner_manager->isSolutionFoundOnce(); 
 }
 
-void publishPath(nav_msgs::Path& path, bool is_global, bool need_start_vel_ramp,  bool is_close)
+// publish the timed footprint of the path towards the other robots: the pose stamps are the expected arrival times at nominal speed
+// (an empty path releases the reservations of this robot)
+void publishPathReservation(const nav_msgs::Path& path)
 {
-    ros::Duration elapsed_time = ros::Time::now() - time_last_path_msg;
-    
-    double timeIntervalToCheck = 0; 
-    /// < if we are close to the goal wait more before publishing a new path 
-    if(is_close) 
+    if (!p_reservation_table) return; /// < EXIT POINT 
+    
+    trajectory_control_msgs::MultiRobotPath msg; 
+    msg.header.stamp = ros::Time::now();
+    msg.header.frame_id = "map";
+    msg.robot_id = robot_id; 
+    msg.poses = path.poses; 
+    double length = 0; 
+    for (size_t i = 0; i < msg.poses.size(); i++)
     {
-        timeIntervalToCheck = kMinimumWaitingTimeForPublishingANewPathWhenClose;
-    }
-    else
-    {
-        timeIntervalToCheck = kMinimumWaitingTimeForPublishingANewPath;
+        if (i > 0) length += PathPlanner::dist(msg.poses[i].pose.position, msg.poses[i-1].pose.position); 
+        msg.poses[i].header.stamp = msg.header.stamp + ros::Duration(length/nominal_speed); 
     }
+    path_reservations_pub.publish(msg);
+}
+
+void pathReservationsCallback(const trajectory_control_msgs::MultiRobotPath& msg)
+{
+    if (msg.robot_id == robot_id) return; /// < EXIT POINT 
     
-    if (elapsed_time.toSec() < timeIntervalToCheck)
+    std::vector<ReservationTable::TimedPoint> timed_path(msg.poses.size()); 
+    for (size_t i = 0; i < msg.poses.size(); i++)
     {
-        ROS_WARN("path publication dropped");
-        return; /// < EXIT POINT 
+        timed_path[i].x = msg.poses[i].pose.position.x; 
+        timed_path[i].y = msg.poses[i].pose.position.y; 
+        timed_path[i].z = msg.poses[i].pose.position.z; 
+        timed_path[i].time = msg.poses[i].header.stamp.toSec(); 
     }
+    p_reservation_table->removeExpired(ros::Time::now().toSec());
+    p_reservation_table->reservePath(msg.robot_id, timed_path);
+}
 
-    time_last_path_msg = ros::Time::now();
+LatencyTracer latency_tracer;
+ros::Time traversability_stamp; // stamp of the last traversability cloud, propagated to the trajectory control in the RobotPath header
 
+void sendPath(const nav_msgs::Path& path, bool is_global, bool need_start_vel_ramp)
+{
+    publishPathReservation(path);
+    
 #if USE_PP_PATH_PUB
     trajectory_control_msgs::RobotPath pp_msg; 
-    pp_msg.header.stamp = ros::Time::now();
+    pp_msg.header.stamp = traversability_stamp.isZero() ? ros::Time::now() : traversability_stamp;
     pp_msg.header.frame_id = "map";
     pp_msg.path = path;
 #endif 
@@ -406,6 +444,40 @@ void publishPath(nav_msgs::Path& path, bool is_global, bool need_start_vel_ramp,
     }
 }
 
+void publishPath(nav_msgs::Path& path, bool is_global, bool need_start_vel_ramp,  bool is_close)
+{
+    ros::Duration elapsed_time = ros::Time::now() - time_last_path_msg;
+    
+    double timeIntervalToCheck = 0; 
+    /// < if we are close to the goal wait more before publishing a new path 
+    if(is_close) 
+    {
+        timeIntervalToCheck = kMinimumWaitingTimeForPublishingANewPathWhenClose;
+    }
+    else
+    {
+        timeIntervalToCheck = kMinimumWaitingTimeForPublishingANewPath;
+    }
+    
+    if (elapsed_time.toSec() < timeIntervalToCheck)
+    {
+        ROS_WARN("path publication dropped");
+        return; /// < EXIT POINT 
+    }
+
+    time_last_path_msg = ros::Time::now();
+
+    sendPath(path, is_global, need_start_vel_ramp);
+}
+
+// any-time planning: the partial path is sent as a local path (it does not reach the goal) 
+// N.B.: called from the planning thread; it does not update time_last_path_msg so that the complete path is not dropped 
+void publishPartialPath(const nav_msgs::Path& path)
+{
+    ROS_INFO_STREAM("publishing partial path with " << path.poses.size() << " poses");
+    sendPath(path, false, b_need_start_vel_ramp);
+}
+
 void resetGlobalPath()
 {
     boost::recursive_mutex::scoped_lock locker(global_path.mutex_);
@@ -513,6 +585,7 @@ void doPathPlanning()
 
         if(p_marker_controller) p_marker_controller->setMarkerColor(Colors::LightGrey(), "Arrived...select another goal");
         p_planner_manager->setNoGoal();
+        publishPathReservation(nav_msgs::Path());
 
         {
         boost::recursive_mutex::scoped_lock locker(global_path.mutex_);
@@ -562,11 +635,16 @@ void doPathPlanning()
 
 }
 
+PointCloudDeltaReceiver<pcl::PointXYZI> traversability_delta_receiver;
+
 void traversabilityCloudCallback(const sensor_msgs::PointCloud2& traversability_msg)
 {
     std::cout << "===============================================" << std::endl;
     std::cout << "traversabilityCloudCallback() " << std::endl;
     
+    latency_tracer.begin(traversability_msg.header.stamp);
+    traversability_stamp = traversability_msg.header.stamp;
+    
     p_planner_manager->traversabilityCloudCallback(traversability_msg);
     
     rssManagement(traversability_msg);
@@ -574,6 +652,19 @@ void traversabilityCloudCallback(const sensor_msgs::PointCloud2& traversability_
     localGoalCallback();
     doPathPlanning();
     time_last_planning = ros::Time::now();
+    
+    latency_tracer.end();
+}
+
+void traversabilityCloudDeltaCallback(const trajectory_control_msgs::PointCloudDelta& traversability_delta_msg)
+{
+    pcl::PointCloud<pcl::PointXYZI> traversability_pcl;
+    if (!traversability_delta_receiver.apply(traversability_delta_msg, traversability_pcl)) return; /// < EXIT POINT
+
+    // the rebuilt cloud is processed as a full cloud message (a local copy, nothing crosses the network)
+    sensor_msgs::PointCloud2 traversability_msg;
+    pcl::toROSMsg(traversability_pcl, traversability_msg);
+    traversabilityCloudCallback(traversability_msg);
 }
 
 void localPlanningCallback(const ros::TimerEvent& e)
@@ -725,6 +816,7 @@ void goalAbortCallback(std_msgs::Bool msg)
     if(p_marker_controller) p_marker_controller->setMarkerColor(Colors::Red(), "Abort");
     
     resetGlobalPath(); // needed since all the tasks are executed as a global path 
+    publishPathReservation(nav_msgs::Path());
     
     /// < N.B..: the same topic arrive to the trajectory control and stops it
     std::cout << "goalAbortCallback() - end " << std::endl;
@@ -769,6 +861,30 @@ bool pathPlanningServiceCallback(trajectory_control_msgs::PathPlanning::Request
     return true; 
 }
 
+// one-to-many planning: the path length from the start to each goal with a single search (see PathPlannerManager::multiGoalPathPlanning())
+bool pathCostsServiceCallback(trajectory_control_msgs::PathCosts::Request  &req, trajectory_control_msgs::PathCosts::Response &res)
+{
+    std::cout << "pathCostsServiceCallback() - num goals: " << req.goals.size() << std::endl;
+    
+    boost::recursive_mutex::scoped_lock planner_manager_locker(planner_manager_mutex);
+    
+    std::vector<nav_msgs::Path> paths;
+    std::vector<double> path_costs; 
+    PathPlannerManager::PlannerStatus planner_status = p_planner_manager->multiGoalPathPlanning(req.start, req.goals, paths, path_costs);
+    
+    res.success = (planner_status == PathPlannerManager::kSuccess);
+    res.path_costs.assign(req.goals.size(), -1);
+    if (res.success)
+    {
+        for (size_t i = 0; i < paths.size(); i++)
+        {
+            // the same cost returned by pathPlanningServiceCallback()
+            if (!paths[i].poses.empty()) res.path_costs[i] = PathPlannerManager::computePathLength(paths[i]);
+        }
+    }
+    return true; 
+}
+
 bool isRobotFarFromFirstWp()
 {
     bool res = true; 
@@ -1185,17 +1301,32 @@ void mySigintHandler(int signum)
     exit(signum);
 }
 
-int main(int argc, char **argv)
+// resources which live as long as the node 
+ros::Timer local_goal_timer;
+ros::Subscriber sub_trav;
+PointCloudShmSubscriber sub_trav_shm;
+PointCloudShmSubscriber sub_wall;
+ros::Subscriber sub_goal;
+ros::Subscriber sub_goal_abort;
+ros::Subscriber sub_global_path;
+ros::Subscriber laser_proximity_sub;
+ros::Subscriber rss_enable_sub;
+ros::Subscriber rss_signal_sub;
+ros::Subscriber rss_min_signal_value_sub;
+ros::ServiceServer path_planning_service;
+ros::ServiceServer path_costs_service;
+ros::Subscriber path_reservations_sub;
+
+// n is the private node handle of the node (or of the nodelet)
+void init(ros::NodeHandle& n)
 {
-    ros::init(argc, argv, "path_planner_manager_node");
-
-    //override default sigint handler 
-    signal(SIGINT, mySigintHandler);
-
-    ros::NodeHandle n("~");
-
     /// < get parameters
     robot_frame_id = getParam<std::string>(n, "robot_frame_name", "/base_link");
+    if (getParam<bool>(n, "enable_profiler", false))
+    {
+        mr3d_profiling::ProfilerExporter::instance().start(n, getParam<std::string>(n, "profiler_stats_file", std::string()));
+    }
+    if (getParam<bool>(n, "enable_latency_tracing", false)) latency_tracer.init(n, "path_planner_manager");
     std::string int_marker_server_name = getParam<std::string>(n, "int_marker_server_name", "marker_controller");
     std::string int_marker_name = getParam<std::string>(n, "int_marker_name", "Goal");
 
@@ -1209,11 +1340,43 @@ int main(int argc, char **argv)
     int cost_function_type = getParam<int>(n, "cost_function_type", (int)BaseCostFunction::kSimpleCost);
     double lambda_trav                  = getParam<double>(n, "lambda_trav", 1.0);
     double lambda_utility_2d            = getParam<double>(n, "lambda_aux_utility", 1.);
+    int open_set_type                   = getParam<int>(n, "open_set_type", (int)PathPlanner::kOpenSetBinaryHeap);
+    double open_set_bucket_resolution   = getParam<double>(n, "open_set_bucket_resolution", BucketQueue::kDefaultResolution);
+    bool b_use_neighborhood_graph       = getParam<bool>(n, "use_neighborhood_graph", true);
+    bool b_use_incremental_planning     = getParam<bool>(n, "use_incremental_planning", false);
+    int random_seed                     = getParam<int>(n, "random_seed", (int)PathPlanner::kDefaultRandomSeed);
+    bool b_use_bidirectional_search     = getParam<bool>(n, "use_bidirectional_search", false);
+    int path_cache_size                 = getParam<int>(n, "path_cache_size", (int)PathCache::kDefaultCapacity);
+    double anytime_time_budget          = getParam<double>(n, "anytime_time_budget", 0.);
+    double anytime_republish_period     = getParam<double>(n, "anytime_republish_period", PathPlanner::kDefaultAnytimeRepublishPeriodSec);
+    bool b_use_hierarchical_planning    = getParam<bool>(n, "use_hierarchical_planning", false);
+    double coarse_leaf_size             = getParam<double>(n, "coarse_leaf_size", PathPlannerManager::kDefaultCoarseLeafSize);
     //std::string utility_2d_service_name = getParam<std::string>(n, "utility_2d_service_name", "");
     rss_service_name = getParam<std::string>(n, "rss_service_name", "/Request_RSS_PointCloud"); /// < rss map is used as an utility function 
     b_use_rss = getParam<bool>(n, "use_rss", false);
         
     std::string path_planning_service_name = getParam<std::string>(n, "path_planning_service_name", "/path_planning_service"); 
+    std::string path_costs_service_name = getParam<std::string>(n, "path_costs_service_name", "/path_costs_service"); 
+    
+    bool b_enable_path_reservations     = getParam<bool>(n, "enable_path_reservations", false);   /// < multi-robot
+    std::string str_robot_name          = getParam<std::string>(n, "robot_name", "ugv1");       /// < multi-robot
+    robot_id = atoi(str_robot_name.substr(3,str_robot_name.size()).c_str()) - 1;  // as in the traversability node 
+    double lambda_reservation           = getParam<double>(n, "lambda_reservation", BaseCostFunction::kLamdaReservationDefault);
+    double reservation_cell_size        = getParam<double>(n, "reservation_cell_size", ReservationTable::kDefaultCellSize);
+    double reservation_time_margin      = getParam<double>(n, "reservation_time_margin", ReservationTable::kDefaultTimeMargin);
+    double robot_radius                 = getParam<double>(n, "robot_radius", ReservationTable::kDefaultFootprintRadius);
+    nominal_speed                       = getParam<double>(n, "nominal_speed", PathPlanner::kDefaultNominalSpeed);
+    if (nominal_speed <= 0) nominal_speed = PathPlanner::kDefaultNominalSpeed;
+    
+    bool b_use_path_smoothing           = getParam<bool>(n, "use_path_smoothing", false);
+    PathSmoother::Config smoothing_config;
+    smoothing_config.knot_spacing             = getParam<double>(n, "smoothing_knot_spacing", smoothing_config.knot_spacing);
+    smoothing_config.max_curvature            = getParam<double>(n, "smoothing_max_curvature", smoothing_config.max_curvature);
+    smoothing_config.min_wall_clearance       = getParam<double>(n, "smoothing_min_wall_clearance", smoothing_config.min_wall_clearance);
+    smoothing_config.max_velocity             = getParam<double>(n, "smoothing_max_velocity", smoothing_config.max_velocity);
+    smoothing_config.max_acceleration         = getParam<double>(n, "smoothing_max_acceleration", smoothing_config.max_acceleration);
+    smoothing_config.max_lateral_acceleration = getParam<double>(n, "smoothing_max_lateral_acceleration", smoothing_config.max_lateral_acceleration);
+    smoothing_config.max_angular_velocity     = getParam<double>(n, "smoothing_max_angular_velocity", smoothing_config.max_angular_velocity);
         
     std::cout << "got parameters" << std::endl;
 
@@ -1235,6 +1398,20 @@ int main(int argc, char **argv)
     p_planner_manager->setFramesRobot("map", robot_frame_id);
     
     p_planner_manager->setCostFunctionType(cost_function_type,lambda_trav,lambda_utility_2d);
+    p_planner_manager->setOpenSetType(open_set_type,open_set_bucket_resolution);
+    p_planner_manager->setUseNeighborhoodGraph(b_use_neighborhood_graph);
+    p_planner_manager->setUseIncrementalPlanning(b_use_incremental_planning);
+    p_planner_manager->setRandomSeed(random_seed);
+    p_planner_manager->setUseBidirectionalSearch(b_use_bidirectional_search);
+    p_planner_manager->setPathCacheSize(std::max(path_cache_size, 0));
+    p_planner_manager->setUseHierarchicalPlanning(b_use_hierarchical_planning, coarse_leaf_size);
+    p_planner_manager->setAnytimePlanning(anytime_time_budget, publishPartialPath, anytime_republish_period);
+    p_planner_manager->setUsePathSmoothing(b_use_path_smoothing, smoothing_config);
+    if (b_enable_path_reservations)
+    {
+        p_reservation_table.reset(new ReservationTable(reservation_cell_size, reservation_time_margin, robot_radius));
+        p_planner_manager->setReservationTable(p_reservation_table, robot_id, lambda_reservation, nominal_speed);
+    }
     
     /// < Publishers 
 
@@ -1263,30 +1440,62 @@ int main(int argc, char **argv)
     
     /// < Timer
 
-    ros::Timer local_goal_timer = n.createTimer(ros::Duration(1.0), localPlanningCallback);
+    local_goal_timer = n.createTimer(ros::Duration(1.0), localPlanningCallback);
     
     /// < Subscribers
-    ros::Subscriber sub_trav = n.subscribe("/trav/traversability", 1, traversabilityCloudCallback);
-    ros::Subscriber sub_wall = n.subscribe("/clustered_pcl/wall", 1, wallCloudCallback);
+    const bool b_use_shm_transport = getParam<bool>(n, "use_shm_transport", false); /// < intra-host large clouds through shared memory (see PointCloudShm.h)
+    if (getParam<bool>(n, "use_delta_input", false))
+    {
+        sub_trav = n.subscribe("/trav/traversability_delta", 10, traversabilityCloudDeltaCallback); // deltas must not be dropped
+    }
+    else
+    {
+        sub_trav_shm.subscribe(n, "/trav/traversability", 1, traversabilityCloudCallback, b_use_shm_transport);
+    }
+    sub_wall.subscribe(n, "/clustered_pcl/wall", 1, wallCloudCallback, b_use_shm_transport);
+
+    /// < boot from the prior map (if any): the wall and traversability layers are used until the mapping pipeline publishes its clouds 
+    const std::string prior_map_service = getParam<std::string>(n, "prior_map_service", std::string());
+    if (!prior_map_service.empty())
+    {
+        PriorMapClient prior_map_client(n, prior_map_service);
+        sensor_msgs::PointCloud2 prior_map_msg;
+        if (prior_map_client.getLayer("wall", prior_map_msg))
+        {
+            wallCloudCallback(prior_map_msg);
+        }
+        if (prior_map_client.getLayer("traversability", prior_map_msg))
+        {
+            p_planner_manager->traversabilityCloudCallback(prior_map_msg);
+        }
+    }
 
-    ros::Subscriber sub_goal = n.subscribe("/goal_topic", 1, goalSelectionCallback);
-    ros::Subscriber sub_goal_abort = n.subscribe("/goal_abort_topic", 1, goalAbortCallback);
-    ros::Subscriber sub_global_path = n.subscribe("/planner/tasks/global_path", 1, globalPathCallback);
+    sub_goal = n.subscribe("/goal_topic", 1, goalSelectionCallback);
+    sub_goal_abort = n.subscribe("/goal_abort_topic", 1, goalAbortCallback);
+    sub_global_path = n.subscribe("/planner/tasks/global_path", 1, globalPathCallback);
 
     // feedback between nodes: "tool", "planner" and "control"
     queue_task_feedback_sub = n.subscribe(queue_task_feedback_topic, 10, feedbackCallback);
 
-    ros::Subscriber laser_proximity_sub = n.subscribe("/laser_proximity_topic", 1, laserProximityCallback);
+    laser_proximity_sub = n.subscribe("/laser_proximity_topic", 1, laserProximityCallback);
     
-    ros::Subscriber rss_enable_sub = n.subscribe("/rss_enable", 1, rssEnableCallback);
+    rss_enable_sub = n.subscribe("/rss_enable", 1, rssEnableCallback);
     
-    ros::Subscriber rss_signal_sub = n.subscribe("/networkanalysis/wirelessquality", 1, rssSignalCallback);
+    rss_signal_sub = n.subscribe("/networkanalysis/wirelessquality", 1, rssSignalCallback);
     
-    ros::Subscriber rss_min_signal_value_sub = n.subscribe("/rss_min_value", 1, rssMinSignalValueCallback);
+    rss_min_signal_value_sub = n.subscribe("/rss_min_value", 1, rssMinSignalValueCallback);
+    
+    if (p_reservation_table)
+    {
+        // N.B.: the topic is shared by the team (not remapped in the robot namespace); the robots with a lower id have a higher priority 
+        path_reservations_pub = n.advertise<trajectory_control_msgs::MultiRobotPath>("/path_reservations", 10);
+        path_reservations_sub = n.subscribe("/path_reservations", 10, pathReservationsCallback);
+    }
     
     
     /// < Services 
-    ros::ServiceServer service = n.advertiseService(path_planning_service_name, pathPlanningServiceCallback);
+    path_planning_service = n.advertiseService(path_planning_service_name, pathPlanningServiceCallback);
+    path_costs_service = n.advertiseService(path_costs_service_name, pathCostsServiceCallback);
 
     // add service client for requesting wifi RSS point cloud 
     p_srv_client_rss.reset(new ros::ServiceClient); 
@@ -1303,11 +1512,27 @@ int main(int argc, char **argv)
     /// < just for for testing
     //ros::Subscriber sub_rssi = n.subscribe("/RSS_PointCloud2", 1, rssiCloudCallback);
 
-    ros::MultiThreadedSpinner spinner(2); // Use 2-4 threads
+}
+
+} // namespace path_planner_manager
+
+#ifndef PATH_PLANNER_NODELET // the nodelet library is built from the same sources 
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "path_planner_manager_node");
+
+    //override default sigint handler 
+    signal(SIGINT, path_planner_manager::mySigintHandler);
+
+    ros::NodeHandle n("~");
+    path_planner_manager::init(n);
+
+    ros::MultiThreadedSpinner spinner(path_planner_manager::getParam<int>(n, "num_spinner_threads", 2)); // Use 2-4 threads (1: callbacks in arrival order)
     spinner.spin(); // spin() will not return until the node has been shutdown
     //ros::spin();
 
-    //if(p_marker_controller) p_marker_controller->reset();
+    //if(path_planner_manager::p_marker_controller) path_planner_manager::p_marker_controller->reset();
 
     return 0;
 }
+#endif
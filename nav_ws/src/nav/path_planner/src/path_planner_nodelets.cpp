@@ -0,0 +1,75 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR. 
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+
+// the setup functions of the nodes (the nodelet library is built from their sources with PATH_PLANNER_NODELET, see CMakeLists.txt)
+namespace compute_normals { void init(ros::NodeHandle& n); }
+namespace traversability { void init(ros::NodeHandle& n); }
+namespace path_planner_manager { void init(ros::NodeHandle& n); }
+
+namespace path_planner
+{
+
+///	\class ComputeNormalsNodelet, TraversabilityNodelet, PathPlannerManagerNodelet
+///	\author Luigi Freda
+///	\brief Nodelet versions of compute_normals, traversability and path_planner_manager: loaded in the same nodelet manager 
+///        (see launch/sim_nav_pipeline_nodelets.launch), the clouds are published and received as shared pointers without 
+///        serialization. The parameters, topics and remappings are the ones of the nodes. 
+///	\note  Keep use_shm_transport false: the shared-memory transport (PointCloudShm.h) is for separate processes. 
+/// \todo
+///	\date
+///	\warning The state of a node is global: at most one nodelet of each type can be loaded in a process (e.g. one per robot manager). 
+class ComputeNormalsNodelet : public nodelet::Nodelet
+{
+private:
+    virtual void onInit()
+    {
+        ros::NodeHandle& n = getPrivateNodeHandle();
+        compute_normals::init(n);
+    }
+};
+
+class TraversabilityNodelet : public nodelet::Nodelet
+{
+private:
+    virtual void onInit()
+    {
+        ros::NodeHandle& n = getPrivateNodeHandle();
+        traversability::init(n);
+    }
+};
+
+class PathPlannerManagerNodelet : public nodelet::Nodelet
+{
+private:
+    virtual void onInit()
+    {
+        ros::NodeHandle& n = getPrivateNodeHandle();
+        path_planner_manager::init(n);
+    }
+};
+
+} // namespace path_planner
+
+PLUGINLIB_EXPORT_CLASS(path_planner::ComputeNormalsNodelet, nodelet::Nodelet)
+PLUGINLIB_EXPORT_CLASS(path_planner::TraversabilityNodelet, nodelet::Nodelet)
+PLUGINLIB_EXPORT_CLASS(path_planner::PathPlannerManagerNodelet, nodelet::Nodelet)
@@ -0,0 +1,209 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <ros/ros.h>
+
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <sstream>
+
+#include <boost/format.hpp>
+
+#include <diagnostic_msgs/DiagnosticArray.h>
+#include <trajectory_control_msgs/PipelineLatency.h>
+
+
+/// < aggregates the samples published by the LatencyTracer of each pipeline stage on /pipeline_latency 
+/// < and periodically publishes the per-stage latency stats and histograms on /diagnostics
+
+const double kDefaultReportPeriodSec = 5.0; // [s]
+const double kMaxTraceAgeSec = 30.0;        // [s] the traces of older origin stamps are discarded
+const double kHistogramBinSec = 0.1;        // [s]
+const int kHistogramNumBins = 20;           // the last bin collects all the larger latencies
+
+struct StageSamples
+{
+    std::vector<double> processing; // [s] end - start
+    std::vector<double> queue;      // [s] start - end of the upstream stage (or origin stamp for the first stage)
+    std::vector<double> total;      // [s] end - origin stamp
+};
+
+std::vector<std::string> stages;        // in pipeline order
+std::vector<double> stage_budgets;      // [s] max p95 total latency of each stage (0: no budget)
+std::map<std::string, StageSamples> stage_samples;
+std::map<ros::Time, std::map<std::string, ros::Time> > stage_end_times; // origin stamp -> (stage -> end time)
+
+ros::Publisher diagnostics_pub;
+
+template<typename T>
+T getParam(ros::NodeHandle& n, const std::string& name, const T& defaultValue)
+{
+    T v;
+    if (n.getParam(name, v))
+    {
+        ROS_INFO_STREAM("Found parameter: " << name << ", value: " << v);
+        return v;
+    }
+    else
+    {
+        ROS_WARN_STREAM("Cannot find value for parameter: " << name << ", assigning default: " << defaultValue);
+    }
+    return defaultValue;
+}
+
+int getStageIndex(const std::string& stage)
+{
+    std::vector<std::string>::const_iterator it = std::find(stages.begin(), stages.end(), stage);
+    return (it != stages.end()) ? (it - stages.begin()) : -1;
+}
+
+void latencyCallback(const trajectory_control_msgs::PipelineLatency& msg)
+{
+    const ros::Time& origin = msg.header.stamp;
+    std::map<std::string, ros::Time>& end_times = stage_end_times[origin];
+    end_times[msg.stage] = msg.end;
+
+    // the input of the stage was published at the end of the closest upstream stage which processed the same origin
+    ros::Time input_time = origin;
+    for (int i = getStageIndex(msg.stage) - 1; i >= 0; i--)
+    {
+        std::map<std::string, ros::Time>::const_iterator it = end_times.find(stages[i]);
+        if (it != end_times.end())
+        {
+            input_time = it->second;
+            break;
+        }
+    }
+
+    StageSamples& samples = stage_samples[msg.stage];
+    samples.processing.push_back((msg.end - msg.start).toSec());
+    samples.queue.push_back((msg.start - input_time).toSec());
+    samples.total.push_back((msg.end - origin).toSec());
+
+    while (!stage_end_times.empty() && ((origin - stage_end_times.begin()->first).toSec() > kMaxTraceAgeSec))
+    {
+        stage_end_times.erase(stage_end_times.begin());
+    }
+}
+
+std::string getStats(std::vector<double>& values)
+{
+    std::sort(values.begin(), values.end());
+    const size_t n = values.size();
+    return (boost::format("p50 %.3f s, p95 %.3f s, max %.3f s") % values[n/2] % values[std::min(n - 1, (size_t)(0.95*n))] % values[n - 1]).str();
+}
+
+std::string getHistogram(const std::vector<double>& values)
+{
+    std::vector<int> bins(kHistogramNumBins, 0);
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        const int bin = std::min(std::max((int)(values[i]/kHistogramBinSec), 0), kHistogramNumBins - 1);
+        bins[bin]++;
+    }
+    std::stringstream ss;
+    for (int i = 0; i < kHistogramNumBins; i++) ss << (i > 0 ? " " : "") << bins[i];
+    return ss.str();
+}
+
+void addStageStatus(const std::string& stage, StageSamples& samples, diagnostic_msgs::DiagnosticArray& msg)
+{
+    if (samples.total.empty()) return; /// < EXIT POINT
+
+    diagnostic_msgs::DiagnosticStatus status;
+    status.name = "pipeline latency: " + stage;
+    status.level = diagnostic_msgs::DiagnosticStatus::OK;
+    status.message = (boost::format("%d samples") % samples.total.size()).str();
+
+    diagnostic_msgs::KeyValue key_value;
+    key_value.key = (boost::format("total histogram [%.1f s bins]") % kHistogramBinSec).str();
+    key_value.value = getHistogram(samples.total);
+    status.values.push_back(key_value);
+
+    key_value.key = "processing";
+    key_value.value = getStats(samples.processing);
+    status.values.push_back(key_value);
+    key_value.key = "queue";
+    key_value.value = getStats(samples.queue);
+    status.values.push_back(key_value);
+    key_value.key = "total";
+    key_value.value = getStats(samples.total);
+    status.values.push_back(key_value);
+
+    // samples.total is sorted by getStats()
+    const int index = getStageIndex(stage);
+    const double budget = ((index >= 0) && (index < (int)stage_budgets.size())) ? stage_budgets[index] : 0;
+    const double p95 = samples.total[std::min(samples.total.size() - 1, (size_t)(0.95*samples.total.size()))];
+    if ((budget > 0) && (p95 > budget))
+    {
+        status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+        status.message += (boost::format(", p95 total latency %.3f s over budget %.3f s") % p95 % budget).str();
+    }
+
+    msg.status.push_back(status);
+
+    samples.processing.clear();
+    samples.queue.clear();
+    samples.total.clear();
+}
+
+void reportCallback(const ros::TimerEvent& e)
+{
+    diagnostic_msgs::DiagnosticArray msg;
+    msg.header.stamp = ros::Time::now();
+
+    // first the known stages in pipeline order, then the others
+    for (size_t i = 0; i < stages.size(); i++)
+    {
+        std::map<std::string, StageSamples>::iterator it = stage_samples.find(stages[i]);
+        if (it != stage_samples.end()) addStageStatus(it->first, it->second, msg);
+    }
+    for (std::map<std::string, StageSamples>::iterator it = stage_samples.begin(); it != stage_samples.end(); ++it)
+    {
+        if (getStageIndex(it->first) < 0) addStageStatus(it->first, it->second, msg);
+    }
+
+    if (!msg.status.empty()) diagnostics_pub.publish(msg);
+}
+
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "pipeline_latency");
+
+    ros::NodeHandle n("~");
+
+    if (!n.getParam("stages", stages))
+    {
+        const char* default_stages[] = {"mapping", "compute_normals", "traversability", "path_planner_manager", "trajectory_control"};
+        stages.assign(default_stages, default_stages + sizeof(default_stages)/sizeof(default_stages[0]));
+    }
+    n.getParam("stage_budgets", stage_budgets);
+    const double report_period_sec = getParam<double>(n, "report_period", kDefaultReportPeriodSec);
+
+    ros::Subscriber latency_sub = n.subscribe("/pipeline_latency", 100, latencyCallback);
+    diagnostics_pub = n.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 10);
+
+    ros::Timer report_timer = n.createTimer(ros::Duration(report_period_sec), reportCallback);
+
+    ros::spin();
+    return 0;
+}
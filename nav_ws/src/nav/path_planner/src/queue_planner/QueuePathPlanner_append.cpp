@@ -69,10 +69,9 @@ void QueuePathPlanner::appendCallback(const trajectory_control_msgs::PlanningTas
 	segment->segment_task.segment_id=1;
 	segment->segment_task.segment_count=task_msg.segment_count;
 
-	// start planning thread
-	// (this is needed because we synchronize with join())
-	//segment->thread=boost::thread(&QueuePathPlanner::pathPlanningCallback,segment); 
-        segment->thread=boost::thread(boost::bind(&QueuePathPlanner::pathPlanningCallback, this, segment, task)); /// < START NEW THREAD 
+	// start segment planning 
+	// (this is needed because we synchronize with waitDone())
+        startSegmentPlanning(segment, task); 
 
 	// add segment to the task
 	task->push_back(segment);
@@ -100,6 +99,22 @@ void QueuePathPlanner::appendCallback(const trajectory_control_msgs::PlanningTas
     waypoints.push_back(robot_position);
     waypoints.insert(waypoints.end(),task_msg.waypoints.begin(),task_msg.waypoints.end());
     
+    // reorder the waypoints for reducing the total path cost (the robot position stays the first one)
+    if(task_msg.optimize_order && (task_msg.waypoints.size() > 1))
+    {
+        std::vector<int> order;
+        if(computeWaypointsOrder(waypoints, task_msg.priorities, task_msg.type == kPathCyclic, order))
+        {
+            std::vector<geometry_msgs::Point> ordered_waypoints(1, robot_position);
+            for(size_t i = 0; i < order.size(); i++) ordered_waypoints.push_back(waypoints[order[i]]);
+            waypoints.swap(ordered_waypoints);
+        }
+        else
+        {
+            ROS_WARN("task %s: cannot optimize the waypoints order, the input order is kept", task_msg.name.c_str());
+        }
+    }
+    
     int num_segments = task_msg.segment_count;
     if(task_msg.type == kPathCyclic)
     {
@@ -132,9 +147,8 @@ void QueuePathPlanner::appendCallback(const trajectory_control_msgs::PlanningTas
 	segment->segment_task.waypoints.push_back(waypoints[i+1]);
         
         
-	// start planning thread
-	//segment->thread=boost::thread(&QueuePathPlanner::pathPlanningCallback,segment); 
-        segment->thread=boost::thread(boost::bind(&QueuePathPlanner::pathPlanningCallback, this, segment, task)); /// < START NEW THREAD 
+	// start segment planning (the segment is queued in the worker pool)
+        startSegmentPlanning(segment, task); 
 
 	// add segment to the task
 	task->push_back(segment);
@@ -58,6 +58,21 @@ QueuePathPlanner::~QueuePathPlanner(void)
     task_msg.name = "ALL";
     task_msg.header.stamp = ros::Time::now();
     task_remove_pub_.publish(task_msg);
+    
+    // abort the running planners and stop the workers (pending segments are dropped)
+    {
+        boost::recursive_mutex::scoped_lock locker(task_queue_mutex_);
+        for (std::list<TaskPtr>::iterator it = task_queue_.begin(); it != task_queue_.end(); it++)
+        {
+            for (size_t i = 0; i < (*it)->size(); i++)
+            {
+                TaskSegmentPtr segment = (**it)[i];
+                segment->b_aborted = true;
+                if(segment->p_path_planner) segment->p_path_planner->setAbort(true);
+            }
+        }
+    }
+    p_worker_pool_->stop();
 }
 
 QueuePathPlanner::QueuePathPlanner(void)
@@ -88,6 +103,22 @@ QueuePathPlanner::QueuePathPlanner(void)
     lambda_utility_2d_ = getParam<float>(param_node_, "lambda_utility_2d", 1.); 
     tau_exp_decay_ = getParam<float>(param_node_, "tau_exp_decay", std::numeric_limits<float>::max());
     
+    open_set_type_ = getParam<int>(param_node_, "open_set_type", (int)PathPlanner::kOpenSetBinaryHeap);
+    open_set_bucket_resolution_ = getParam<double>(param_node_, "open_set_bucket_resolution", BucketQueue::kDefaultResolution);
+    b_use_neighborhood_graph_ = getParam<bool>(param_node_, "use_neighborhood_graph", true);
+    random_seed_ = getParam<int>(param_node_, "random_seed", (int)PathPlanner::kDefaultRandomSeed);
+    b_use_bidirectional_search_ = getParam<bool>(param_node_, "use_bidirectional_search", false);
+    
+    waypoints_order_time_budget_ = getParam<double>(param_node_, "waypoints_order_time_budget", WaypointSequencer::kDefaultTimeBudgetSec);
+    
+    traversability_map_version_ = 0;
+    path_cache_.setCapacity(std::max(getParam<int>(param_node_, "path_cache_size", (int)PathCache::kDefaultCapacity), 0));
+    
+    // planning workers: 0 means one worker per hardware thread 
+    int num_planning_workers = getParam<int>(param_node_, "num_planning_workers", 0);
+    p_worker_pool_.reset(new WorkerPool(num_planning_workers));
+    ROS_INFO_STREAM("QueuePathPlanner::QueuePathPlanner() - number of planning workers: " << p_worker_pool_->getNumWorkers());
+    
     // ros stuff: path planner library stuff
     traversability_sub_ = node_.subscribe("/trav/traversability", 1, &QueuePathPlanner::traversabilityCallback, this);
     wall_sub_ = node_.subscribe("/clustered_pcl/wall", 1, &QueuePathPlanner::wallCallback, this);
@@ -125,7 +156,15 @@ void QueuePathPlanner::traversabilityCallback(const sensor_msgs::PointCloud2& tr
     boost::recursive_mutex::scoped_lock locker_traversability(traversability_pcl_mutex_); 
         
     // cloud having traversability labels
-    pcl::fromROSMsg(traversability_msg, *traversability_pcl_);
+    pcl::PointCloud<pcl::PointXYZI>::Ptr p_traversability_pcl(new pcl::PointCloud<pcl::PointXYZI>()); // new snapshot, the previous one may be still in use by a segment
+    pcl::fromROSMsg(traversability_msg, *p_traversability_pcl);
+    
+    traversability_map_version_++;
+    if(path_cache_.isEnabled()) path_cache_.updateMap(traversability_map_version_, *traversability_pcl_, *p_traversability_pcl);
+    
+    traversability_pcl_ = p_traversability_pcl;
+    traversability_kdtree_.reset();
+    traversability_graph_.reset();
 
     traversability_flag_ = true;
     utility_2d_flag_     = false; // reset utility 
@@ -142,6 +181,7 @@ void QueuePathPlanner::wallCallback(const sensor_msgs::PointCloud2& wall_msg)
     boost::recursive_mutex::scoped_lock locker(wall_pcl_mutex_); 
         
     // cloud of the segmented walls of the scene
+    wall_pcl_.reset(new pcl::PointCloud<pcl::PointXYZRGBNormal>()); // new snapshot, the previous one may be still in use by a segment
     pcl::fromROSMsg(wall_msg, *wall_pcl_);
     
     // this cloud can be empty
@@ -154,6 +194,11 @@ void QueuePathPlanner::wallCallback(const sensor_msgs::PointCloud2& wall_msg)
         far_point.z = std::numeric_limits<float>::max(); 
         wall_pcl_->push_back(far_point);
     }
+    
+    // organize wall points once for all the segments
+    boost::shared_ptr<PathPlanner::WallKdTreeFLANN> p_wall_kdtree(new PathPlanner::WallKdTreeFLANN);
+    p_wall_kdtree->setInputCloud(wall_pcl_);
+    wall_kdtree_ = p_wall_kdtree;
 
     wall_flag_ = true;
 }
@@ -164,6 +209,7 @@ void QueuePathPlanner::utility2DCloudCallback(const sensor_msgs::PointCloud2& ut
     boost::recursive_mutex::scoped_lock locker_traversability(traversability_pcl_mutex_); 
         
     // cloud of an aux utility 2d
+    utility_2d_pcl_.reset(new pcl::PointCloud<pcl::PointXYZI>()); // new snapshot
     pcl::fromROSMsg(utility_msg, *utility_2d_pcl_);
     
     utility_2d_flag_ = false;  
@@ -0,0 +1,155 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR. 
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "QueuePathPlanner.h"
+
+namespace
+{
+// the cost of an unreachable pair of waypoints is its Euclidean distance plus this gain times the max cost of the reachable pairs
+const double kUnreachableCostGain = 1e3; 
+}
+
+bool QueuePathPlanner::computeWaypointsOrder(const std::vector<geometry_msgs::Point>& waypoints, const std::vector<int>& priorities, bool b_closed, std::vector<int>& order)
+{
+    order.clear();
+    const size_t num_nodes = waypoints.size();
+    if (num_nodes < 2) return false; /// < EXIT POINT 
+
+    std::vector<pcl::PointXYZI> points(num_nodes);
+    for (size_t i = 0; i < num_nodes; i++)
+    {
+        points[i].x = waypoints[i].x;
+        points[i].y = waypoints[i].y;
+        points[i].z = waypoints[i].z;
+    }
+
+    /// < share the full map snapshots (the same ones used by the segments, see prepareTraversabilityInput())
+    TaskSegmentPtr snapshot(new TaskSegment);
+    {
+        boost::recursive_mutex::scoped_lock locker(wall_pcl_mutex_);
+        snapshot->p_wall_pcl = wall_pcl_;
+        snapshot->p_wall_kdtree = wall_kdtree_;
+    }
+    snapshot->crop_step = PathPlannerManager::kCropBoxTakeAll;
+    prepareTraversabilityInput(snapshot, points[0], points[1]);
+    if (snapshot->p_traversability_pcl->empty()) return false; /// < EXIT POINT 
+
+    /// < map the waypoints on the traversability points 
+    std::vector<int> point_idxs(num_nodes, -1);
+    std::vector<float> point_sqr_dists(num_nodes, std::numeric_limits<float>::max());
+    {
+        std::vector<int> pointIdxNKNSearch(1);
+        std::vector<float> pointNKNDistance(1);
+        for (size_t i = 0; i < num_nodes; i++)
+        {
+            if (snapshot->p_traversability_kdtree->nearestKSearch(points[i], 1, pointIdxNKNSearch, pointNKNDistance) < 1) continue; /// < CONTINUE
+            point_idxs[i] = pointIdxNKNSearch[0];
+            point_sqr_dists[i] = pointNKNDistance[0];
+        }
+    }
+
+    /// < one-to-many planning from each waypoint to all the waypoints (in parallel on the planning workers)
+    std::vector<std::vector<double> > costs(num_nodes);
+    std::vector<std::vector<nav_msgs::Path> > paths(num_nodes);
+    std::vector<WorkerPool::Job> jobs;
+    for (size_t i = 0; i < num_nodes; i++)
+    {
+        costs[i].assign(num_nodes, std::numeric_limits<double>::infinity());
+        if (point_idxs[i] < 0) continue; /// < CONTINUE
+        jobs.push_back(boost::bind(&QueuePathPlanner::waypointsCostSweepJob, this, snapshot, boost::cref(points), point_idxs[i], boost::ref(costs[i]), boost::ref(paths[i])));
+    }
+    ros::Time time_start = ros::Time::now();
+    p_worker_pool_->pushAndWait(jobs);
+    const double sweeps_time = (ros::Time::now() - time_start).toSec();
+
+    /// < cost matrix (the unreachable pairs get a large penalty, so that they are avoided whenever possible)
+    double max_cost = 0;
+    for (size_t i = 0; i < num_nodes; i++)
+    {
+        for (size_t j = 0; j < num_nodes; j++)
+        {
+            if (costs[i][j] < std::numeric_limits<double>::infinity()) max_cost = std::max(max_cost, costs[i][j]);
+        }
+    }
+    std::vector<double> cost_matrix(num_nodes*num_nodes);
+    int num_unreachable = 0;
+    for (size_t i = 0; i < num_nodes; i++)
+    {
+        for (size_t j = 0; j < num_nodes; j++)
+        {
+            double& cost = cost_matrix[i*num_nodes + j];
+            cost = costs[i][j];
+            if ((i != j) && !(cost < std::numeric_limits<double>::infinity()))
+            {
+                const double dx = waypoints[i].x - waypoints[j].x, dy = waypoints[i].y - waypoints[j].y, dz = waypoints[i].z - waypoints[j].z;
+                cost = std::sqrt(dx*dx + dy*dy + dz*dz) + kUnreachableCostGain*(max_cost + 1.);
+                num_unreachable++;
+            }
+        }
+    }
+
+    /// < visiting order 
+    WaypointSequencer sequencer(waypoints_order_time_budget_);
+    sequencer.solve(cost_matrix, priorities, b_closed, order);
+    const WaypointSequencer::Stats& stats = sequencer.getStats();
+    ROS_INFO("QueuePathPlanner::computeWaypointsOrder() - waypoints: %ld, unreachable pairs: %d, cost: %f (nearest neighbor: %f), moves: %d, timeout: %d, sweeps time: %f", 
+             num_nodes - 1, num_unreachable, stats.cost, stats.initial_cost, stats.num_moves, (int)stats.b_timeout, sweeps_time);
+
+    /// < cache the paths between the consecutive waypoints for the segments (same conditions and key as in pathPlanningCallback())
+    if (path_cache_.isEnabled() && !utility_2d_flag_)
+    {
+        const float max_squared_dist = PathPlanner::kGoalAcceptCheckThreshold*PathPlanner::kGoalAcceptCheckThreshold;
+        std::vector<int> sequence(1, 0);
+        sequence.insert(sequence.end(), order.begin(), order.end());
+        if (b_closed) sequence.push_back(0);
+        for (size_t k = 1; k < sequence.size(); k++)
+        {
+            const int from = sequence[k - 1], to = sequence[k];
+            if (paths[from].empty() || paths[from][to].poses.empty()) continue; /// < CONTINUE
+            if ((point_sqr_dists[from] > max_squared_dist) || (point_sqr_dists[to] > max_squared_dist)) continue; /// < CONTINUE
+            const nav_msgs::Path& path = paths[from][to];
+
+            PathCache::Key cache_key;
+            cache_key.map_version = snapshot->map_version;
+            cache_key.start_key = PathCache::getNodeKey((*snapshot->p_traversability_pcl)[point_idxs[from]]);
+            cache_key.goal_key = PathCache::getNodeKey((*snapshot->p_traversability_pcl)[point_idxs[to]]);
+            cache_key.cost_function_type = cost_function_type_;
+            cache_key.lambda_trav = lambda_trav_;
+            cache_key.lambda_aux_utility = lambda_utility_2d_;
+            path_cache_.put(cache_key, path, PathPlannerManager::computePathLength(path));
+        }
+    }
+
+    return true;
+}
+
+void QueuePathPlanner::waypointsCostSweepJob(TaskSegmentPtr snapshot, const std::vector<pcl::PointXYZI>& points, int start_point_idx, std::vector<double>& costs, std::vector<nav_msgs::Path>& paths)
+{
+    PathPlanner path_planner;
+    path_planner.setCostFunctionType(cost_function_type_,lambda_trav_,lambda_utility_2d_,tau_exp_decay_);
+    path_planner.setOpenSetType(open_set_type_,open_set_bucket_resolution_);
+    path_planner.setRandomSeed(random_seed_);
+    
+    path_planner.setInput(snapshot->p_traversability_pcl, snapshot->p_wall_pcl, snapshot->p_wall_kdtree, snapshot->p_traversability_kdtree, start_point_idx);
+    if(snapshot->p_neighborhood_graph) path_planner.setNeighborhoodGraph(snapshot->p_neighborhood_graph);
+    if(utility_2d_flag_) path_planner.set2DUtility(snapshot->p_utility_2d_pcl);
+    
+    path_planner.planningMultiGoal(points, paths, costs);
+}
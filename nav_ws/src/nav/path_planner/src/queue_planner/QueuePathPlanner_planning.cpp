@@ -21,6 +21,17 @@
 #include "QueuePathPlanner.h"
 
 
+void QueuePathPlanner::startSegmentPlanning(TaskSegmentPtr segment, TaskPtr task)
+{
+    p_worker_pool_->push(boost::bind(&QueuePathPlanner::segmentPlanningJob, this, segment, task));
+}
+
+void QueuePathPlanner::segmentPlanningJob(TaskSegmentPtr segment, TaskPtr task)
+{
+    pathPlanningCallback(segment, task); 
+    segment->setDone();
+}
+
 // perform the planning on the input segment of the given input task
 void QueuePathPlanner::pathPlanningCallback(TaskSegmentPtr segment, TaskPtr task)
 {
@@ -36,8 +47,10 @@ void QueuePathPlanner::pathPlanningCallback(TaskSegmentPtr segment, TaskPtr task
         /// < test segment status flag before proceeding
         boost::recursive_mutex::scoped_lock locker_status(segment->status_mutex);
         {
-            if (STATUS_FAILURE == segment->status)
+            if ((STATUS_FAILURE == segment->status) || segment->b_aborted)
             {
+                segment->status = STATUS_FAILURE;
+
                 // planning information
 #ifdef VERBOSE
                 ROS_INFO("%s %02d/%02d aborted", segment->segment_task.name.c_str(), segment->segment_task.segment_id, segment->segment_task.segment_count);
@@ -75,45 +88,22 @@ void QueuePathPlanner::pathPlanningCallback(TaskSegmentPtr segment, TaskPtr task
 
     { // start scope for locking mutex     
         boost::recursive_mutex::scoped_lock locker(wall_pcl_mutex_);
-        segment->p_wall_pcl = wall_pcl_->makeShared(); // necessary deep copy 
+        // share the current wall snapshot and its kd-tree (no copy)
+        segment->p_wall_pcl = wall_pcl_;
+        segment->p_wall_kdtree = wall_kdtree_;
     } // end scope for locking mutex  
-    
-    // organize wall points
-    segment->wall_kdtree.setInputCloud(segment->p_wall_pcl);
 
     /// < prepare intial traversability PCL (needed for computing the starting point ) and utilit_2d PCL
-    segment->p_traversability_pcl.reset(new pcl::PointCloud<pcl::PointXYZI>);
-    segment->p_utility_2d_pcl.reset(new pcl::PointCloud<pcl::PointXYZI>);
     
     //segment->crop_step = 0;
     segment->crop_step = PathPlannerManager::kCropBoxTakeAll;
     
-    {
-    boost::recursive_mutex::scoped_lock locker_traversability(traversability_pcl_mutex_); 
-    boost::recursive_mutex::scoped_lock locker_utility(utility_2d_mutex_); 
-
-    if (utility_2d_flag_)
-    {
-        PathPlannerManager::cropTwoPcls((PathPlannerManager::CropBoxMethod)segment->crop_step, 
-                                         start, goal, traversability_pcl_, utility_2d_pcl_,
-                                         segment->p_traversability_pcl, segment->p_utility_2d_pcl);
-    }
-    else
-    {
-        PathPlannerManager::cropPcl((PathPlannerManager::CropBoxMethod)segment->crop_step, 
-                                     start, goal, 
-                                     traversability_pcl_, segment->p_traversability_pcl);
-    }
-    
-    }
-    // organize cropped traversability points
-    segment->traversability_kdtree.setInputCloud(segment->p_traversability_pcl);
-    
+    prepareTraversabilityInput(segment, start, goal);
  
     /// < compute starting point on the segment traversability map 
     std::vector<int> pointIdxNKNSearch(1);
     std::vector<float> pointNKNDistance(1);
-    int found = segment->traversability_kdtree.nearestKSearch(start, 1, pointIdxNKNSearch, pointNKNDistance);
+    int found = segment->p_traversability_kdtree->nearestKSearch(start, 1, pointIdxNKNSearch, pointNKNDistance);
     if (found < 1)
     {
         ROS_WARN("%s %02d/%02d - cannot find a close starting node", segment->segment_task.name.c_str(), segment->segment_task.segment_id, segment->segment_task.segment_count);
@@ -130,14 +120,42 @@ void QueuePathPlanner::pathPlanningCallback(TaskSegmentPtr segment, TaskPtr task
     boost::shared_ptr<PathPlanner> p_path_planner(new PathPlanner);
     segment->p_path_planner = p_path_planner;
     segment->p_path_planner->setCostFunctionType(cost_function_type_,lambda_trav_,lambda_utility_2d_,tau_exp_decay_);
-
-    bool b_successful_planning = false;
+    segment->p_path_planner->setOpenSetType(open_set_type_,open_set_bucket_resolution_);
+    segment->p_path_planner->setRandomSeed(random_seed_); // each segment planner has its own generator
+    segment->p_path_planner->setBidirectionalSearch(b_use_bidirectional_search_);
+
+    /// < check the path cache (the 2D utility is not part of the key: do not cache when it is used)
+    PathCache::Key cache_key;
+    bool b_use_path_cache = false;
+    if (path_cache_.isEnabled() && !utility_2d_flag_)
+    {
+        const float max_squared_dist = PathPlanner::kGoalAcceptCheckThreshold*PathPlanner::kGoalAcceptCheckThreshold;
+        std::vector<int> goalIdxNKNSearch(1);
+        std::vector<float> goalNKNDistance(1);
+        if ((pointNKNDistance[0] <= max_squared_dist) &&
+            (segment->p_traversability_kdtree->nearestKSearch(goal, 1, goalIdxNKNSearch, goalNKNDistance) > 0) && 
+            (goalNKNDistance[0] <= max_squared_dist))
+        {
+            cache_key.map_version = segment->map_version;
+            cache_key.start_key = PathCache::getNodeKey((*segment->p_traversability_pcl)[pointIdxNKNSearch[0]]);
+            cache_key.goal_key = PathCache::getNodeKey((*segment->p_traversability_pcl)[goalIdxNKNSearch[0]]);
+            cache_key.cost_function_type = cost_function_type_;
+            cache_key.lambda_trav = lambda_trav_;
+            cache_key.lambda_aux_utility = lambda_utility_2d_;
+            b_use_path_cache = true;
+        }
+    }
+    
+    double path_cost = 0;
+    bool b_successful_planning = b_use_path_cache && path_cache_.get(cache_key, segment->path, path_cost);
+    const bool b_cached_path = b_successful_planning;
 
     while ((segment->crop_step < PathPlannerManager::kNumCropBoxMethod) && (!b_successful_planning) && (!segment->b_aborted))
     {
         /// < first set input then the utility and the goal!
-        p_path_planner->setInput(*segment->p_traversability_pcl, *segment->p_wall_pcl, segment->wall_kdtree, segment->traversability_kdtree, pointIdxNKNSearch[0]);
-        if(utility_2d_flag_) p_path_planner->set2DUtility(*segment->p_utility_2d_pcl);
+        p_path_planner->setInput(segment->p_traversability_pcl, segment->p_wall_pcl, segment->p_wall_kdtree, segment->p_traversability_kdtree, pointIdxNKNSearch[0]);
+        if(segment->p_neighborhood_graph) p_path_planner->setNeighborhoodGraph(segment->p_neighborhood_graph);
+        if(utility_2d_flag_) p_path_planner->set2DUtility(segment->p_utility_2d_pcl);
         p_path_planner->setGoal(goal);
         
 #ifdef VERBOSE
@@ -154,34 +172,10 @@ void QueuePathPlanner::pathPlanningCallback(TaskSegmentPtr segment, TaskPtr task
 
             if (segment->crop_step < PathPlannerManager::kNumCropBoxMethod)
             {
-                /// < generate a bigger traversability map and utility map
-                segment->p_traversability_pcl.reset(new pcl::PointCloud<pcl::PointXYZI>);
-                segment->p_utility_2d_pcl.reset(new pcl::PointCloud<pcl::PointXYZI>);
-                {
-                    boost::recursive_mutex::scoped_lock locker_traversability(traversability_pcl_mutex_); 
-                    boost::recursive_mutex::scoped_lock locker_utility(utility_2d_mutex_); 
-
-                    if (utility_2d_flag_)
-                    {
-                        PathPlannerManager::cropTwoPcls((PathPlannerManager::CropBoxMethod) segment->crop_step, 
-                                                         start, goal, 
-                                                         traversability_pcl_, utility_2d_pcl_,
-                                                         segment->p_traversability_pcl, segment->p_utility_2d_pcl);
-                    }
-                    else
-                    {
-                        PathPlannerManager::cropPcl((PathPlannerManager::CropBoxMethod) segment->crop_step, 
-                                                     start, goal, 
-                                                     traversability_pcl_, segment->p_traversability_pcl);
-                    }
-                    
-                    
-                }
-                
-                // organize cropped traversability points
-                segment->traversability_kdtree.setInputCloud(segment->p_traversability_pcl);
+                /// < generate a bigger traversability map and utility map and organize its points
+                prepareTraversabilityInput(segment, start, goal);
                 
-                int found = segment->traversability_kdtree.nearestKSearch(start, 1, pointIdxNKNSearch, pointNKNDistance);
+                int found = segment->p_traversability_kdtree->nearestKSearch(start, 1, pointIdxNKNSearch, pointNKNDistance);
                 if (found < 1) 
                 {
                     segment->b_aborted = true;
@@ -194,6 +188,8 @@ void QueuePathPlanner::pathPlanningCallback(TaskSegmentPtr segment, TaskPtr task
 
     if (b_successful_planning)
     {
+        if (b_use_path_cache && !b_cached_path && !segment->b_aborted) path_cache_.put(cache_key, segment->path, PathPlannerManager::computePathLength(segment->path));
+        
         /// < cloud cropping visualization
 #ifdef VERBOSE
         publishCropboxPcl(segment, task);
@@ -210,7 +206,7 @@ void QueuePathPlanner::pathPlanningCallback(TaskSegmentPtr segment, TaskPtr task
         }
 
         // planning information
-        ROS_INFO("QueuePathPlanner::pathPlanningCallback() - %s %02d/%02d success, #attempts: %d", segment->segment_task.name.c_str(), segment->segment_task.segment_id, segment->segment_task.segment_count,segment->crop_step);
+        ROS_INFO("QueuePathPlanner::pathPlanningCallback() - %s %02d/%02d success, #attempts: %d, cached: %d", segment->segment_task.name.c_str(), segment->segment_task.segment_id, segment->segment_task.segment_count,segment->crop_step,(int)b_cached_path);
     }
     else
     {
@@ -226,6 +222,59 @@ void QueuePathPlanner::pathPlanningCallback(TaskSegmentPtr segment, TaskPtr task
     }
 }
 
+void QueuePathPlanner::prepareTraversabilityInput(TaskSegmentPtr segment, const pcl::PointXYZI& start, const pcl::PointXYZI& goal)
+{
+    boost::recursive_mutex::scoped_lock locker_traversability(traversability_pcl_mutex_); 
+    boost::recursive_mutex::scoped_lock locker_utility(utility_2d_mutex_); 
+    
+    if (segment->crop_step == PathPlannerManager::kCropBoxTakeAll)
+    {
+        // share the full map snapshots (no copy)
+        segment->p_traversability_pcl = traversability_pcl_;
+        segment->p_utility_2d_pcl = utility_2d_pcl_;
+        segment->map_version = traversability_map_version_;
+        if (!traversability_kdtree_)
+        {
+            // built once per traversability message
+            boost::shared_ptr<PathPlanner::KdTreeFLANN> p_kdtree(new PathPlanner::KdTreeFLANN);
+            p_kdtree->setInputCloud(traversability_pcl_);
+            traversability_kdtree_ = p_kdtree;
+        }
+        segment->p_traversability_kdtree = traversability_kdtree_;
+        if (b_use_neighborhood_graph_ && !traversability_graph_)
+        {
+            // built once per traversability message and shared by all the segments
+            NeighborhoodGraph::Ptr p_graph(new NeighborhoodGraph);
+            p_graph->build(*traversability_pcl_, *traversability_kdtree_, PathPlanner::kMaxRobotStep, PathPlanner::kMaxRobotStepDeltaZ);
+            traversability_graph_ = p_graph;
+        }
+        segment->p_neighborhood_graph = traversability_graph_;
+        return; /// < EXIT POINT 
+    }
+    
+    segment->p_neighborhood_graph.reset(); // the graph refers to the full map
+    segment->p_traversability_pcl.reset(new pcl::PointCloud<pcl::PointXYZI>);
+    segment->p_utility_2d_pcl.reset(new pcl::PointCloud<pcl::PointXYZI>);
+    if (utility_2d_flag_)
+    {
+        PathPlannerManager::cropTwoPcls((PathPlannerManager::CropBoxMethod) segment->crop_step, 
+                                         start, goal, 
+                                         traversability_pcl_, utility_2d_pcl_,
+                                         segment->p_traversability_pcl, segment->p_utility_2d_pcl);
+    }
+    else
+    {
+        PathPlannerManager::cropPcl((PathPlannerManager::CropBoxMethod) segment->crop_step, 
+                                     start, goal, 
+                                     traversability_pcl_, segment->p_traversability_pcl);
+    }
+    
+    // organize cropped traversability points
+    boost::shared_ptr<PathPlanner::KdTreeFLANN> p_kdtree(new PathPlanner::KdTreeFLANN);
+    p_kdtree->setInputCloud(segment->p_traversability_pcl);
+    segment->p_traversability_kdtree = p_kdtree;
+}
+
 void QueuePathPlanner::publishCropboxPcl(TaskSegmentPtr segment, TaskPtr task)
 {
     boost::recursive_mutex::scoped_lock locker(task->cropbox_pcl_mutex);
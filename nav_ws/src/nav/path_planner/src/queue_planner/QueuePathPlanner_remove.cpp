@@ -58,8 +58,8 @@ void QueuePathPlanner::removeCallback(const trajectory_control_msgs::PlanningTas
                 /// here we could force a stop of the planner
                 if(segment->p_path_planner) segment->p_path_planner->setAbort(true); 
                 
-                // join the planning thread
-                segment->thread.join();
+                // wait for the planning worker 
+                segment->waitDone();
 
                 // delete the task's segment
                 // (this line should not be commented but there is an
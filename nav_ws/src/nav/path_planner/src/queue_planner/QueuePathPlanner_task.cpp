@@ -105,6 +105,9 @@ void QueuePathPlanner::taskTimerCallback(const ros::TimerEvent& timer_msg)
             {
                 TaskSegmentPtr p_segment = (*p_task)[i];
 
+                // wait for the planning worker (all the segments succeeded, this does not block)
+                p_segment->waitDone();
+
                 // lock the segment 
                 boost::recursive_mutex::scoped_lock locker(p_segment->mutex);
 
@@ -114,9 +117,6 @@ void QueuePathPlanner::taskTimerCallback(const ros::TimerEvent& timer_msg)
                     global_path_msg.waypoint_path_idxs.push_back(0);
                 }
                 global_path_msg.waypoints.push_back(p_segment->segment_task.waypoints[1]); // then just the end point of each segment 
-                
-                // join the planning thread
-                p_segment->thread.join();
 
                 // append poses to the complete path
                 path_msg.poses.insert(path_msg.poses.end(), p_segment->path.poses.begin(), p_segment->path.poses.end());
@@ -174,17 +174,21 @@ void QueuePathPlanner::taskTimerCallback(const ros::TimerEvent& timer_msg)
             // remove task from the queue
             task_queue_.pop_front();
 
+            // abort the other segments of the task: the queued ones will not even start 
+            for (size_t i = 0; p_task->size() > i; i++)
+            {
+                TaskSegmentPtr p_segment = (*p_task)[i];
+                p_segment->b_aborted = true; // we use it as a volatile flag, can be changed without locking mutex 
+                if(p_segment->p_path_planner) p_segment->p_path_planner->setAbort(true); 
+            }
+            
             // for each segment of the task,
             for (size_t i = 0; p_task->size() > i; i++)
             {
                 TaskSegmentPtr p_segment = (*p_task)[i];
 
-                // lock the segment 
-                boost::recursive_mutex::scoped_lock locker(p_segment->mutex);
-
-                // join the planning thread
-                p_segment->thread.join();
-
+                // wait for the planning worker (without holding the segment mutex, which is locked by the worker)
+                p_segment->waitDone();
             }
 
             // advertise feedback to the waypoints tool
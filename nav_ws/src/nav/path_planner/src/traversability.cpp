@@ -25,17 +25,28 @@
 #include <geometry_msgs/PoseArray.h>
 #include <dynamic_reconfigure/server.h>
 
+#include <pcl_ros/point_cloud.h>
+
 //#include <DynamicJoinPcl.h>
 #include <ClusterPcl.h>
 #include <ConversionPcl.h>
 #include <ColorNormalsPcl.h>
 #include <MakeNormalsMarkers.h>
 #include <TravAnalyzer.h>
+#include <TravPointTypes.h>
 
 #include "KdTreeFLANN.h"
+#include "PointCloudDelta.h"
+#include <mr3d_profiling/ProfilerExporter.h>
+#include "LatencyTracer.h"
 #include "Transform.h"
 #include "MultiConfig.h"
+#include "PointCloudShm.h"
+
 
+// the node state is shared by the traversability node and the TraversabilityNodelet (one instance per process)
+namespace traversability
+{
 
 ConversionPcl<pcl::PointXYZRGBNormal> conv_pcl;
 ClusterPcl<pcl::PointXYZRGBNormal> clustering_pcl;
@@ -45,16 +56,24 @@ boost::recursive_mutex trav_analyzer_mutex;
 ros::Publisher pcl_normal_pub;
 ros::Publisher marker_normal_pub;
 ros::Publisher pcl_pub_dyn;
-ros::Publisher pcl_pub_nowall;
-ros::Publisher pcl_pub_wall;
+PointCloudShmPublisher pcl_pub_nowall;
+PointCloudShmPublisher pcl_pub_wall;
 ros::Publisher pcl_pub_borders;
 ros::Publisher pcl_pub_segmented;
-ros::Publisher pcl_pub_traversability;
+PointCloudShmPublisher pcl_pub_traversability;
 
 ros::Publisher pcl_pub_clearence;
 ros::Publisher pcl_pub_density;
 ros::Publisher pcl_pub_label;
 ros::Publisher pcl_pub_roughness;
+ros::Publisher pcl_pub_trav_channels;
+
+// map deltas: the input map is rebuilt from the received deltas, the traversability cloud is also published as deltas
+PointCloudDeltaReceiver<pcl::PointXYZRGBNormal> map_delta_receiver;
+bool b_publish_delta = false;
+PointCloudDeltaPublisher<pcl::PointXYZI> pcl_delta_pub_traversability;
+
+LatencyTracer latency_tracer;
 
 ros::Publisher pcl_pub_path_to_avoid[kMaxNumberOfRobots];
 
@@ -101,9 +120,20 @@ T getParam(ros::NodeHandle& n, const std::string& name, const T& defaultValue)
 //    marker_normal_pub.publish(poseArray);
 //}
 
+// the single channel clouds are only used for visualization: they are serialized only if somebody is listening 
+template<typename PointT>
+void publishIfSubscribed(ros::Publisher& pub, const pcl::PointCloud<PointT>& pcl)
+{
+    if (pub.getNumSubscribers() == 0) return; /// < EXIT POINT
+    sensor_msgs::PointCloud2 msg;
+    pcl::toROSMsg(pcl, msg);
+    pub.publish(msg);
+}
+
 void pointCloudCallback(const sensor_msgs::PointCloud2& map_msg)
 {
     ROS_INFO("traversability_node - got new cloud");
+    latency_tracer.begin(map_msg.header.stamp);
     
     pcl::fromROSMsg(map_msg, map_pcl);
     
@@ -113,6 +143,7 @@ void pointCloudCallback(const sensor_msgs::PointCloud2& map_msg)
                 
         std::vector<int> cluster_info;
         pcl::PointCloud<pcl::PointXYZI> traversability_pcl, clearence_pcl, density_pcl, label_pcl, roughness_pcl;
+        pcl::PointCloud<PointXYZTrav>::Ptr trav_channels_pcl(new pcl::PointCloud<PointXYZTrav>());
 
         /// < perform the clustering and basic segmentation 
         ros::Time time_start_clustering = ros::Time::now(); 
@@ -129,15 +160,15 @@ void pointCloudCallback(const sensor_msgs::PointCloud2& map_msg)
         border_pcl.header.frame_id = map_msg.header.frame_id;
         segmented_pcl.header.frame_id = map_msg.header.frame_id;
 
-        sensor_msgs::PointCloud2 nowall_msg, wall_msg, segmented_msg;
+        // published by pointer: no copies for the nodelets in the same process
+        sensor_msgs::PointCloud2Ptr nowall_msg(new sensor_msgs::PointCloud2()), wall_msg(new sensor_msgs::PointCloud2());
 
-        pcl::toROSMsg(nowall_pcl, nowall_msg);
-        pcl::toROSMsg(wall_pcl, wall_msg);
-        pcl::toROSMsg(segmented_pcl, segmented_msg);
+        pcl::toROSMsg(nowall_pcl, *nowall_msg);
+        pcl::toROSMsg(wall_pcl, *wall_msg);
 
         pcl_pub_nowall.publish(nowall_msg);
         pcl_pub_wall.publish(wall_msg);
-        pcl_pub_segmented.publish(segmented_msg);
+        publishIfSubscribed(pcl_pub_segmented, segmented_pcl);
 
         /// < perform traversability analysis 
         {   
@@ -146,6 +177,7 @@ void pointCloudCallback(const sensor_msgs::PointCloud2& map_msg)
         trav_analyzer.setInput(cluster_info, wall_pcl, nowall_pcl);
         trav_analyzer.computeTrav(traversability_pcl);
         trav_analyzer.getPcl(clearence_pcl, density_pcl, label_pcl, roughness_pcl);
+        trav_analyzer.getTravChannelsPcl(*trav_channels_pcl);
         ros::Duration elapsed_time_trav = ros::Time::now()-time_start_trav;
         ROS_INFO_STREAM("traversability time: " << elapsed_time_trav);
         }
@@ -157,21 +189,22 @@ void pointCloudCallback(const sensor_msgs::PointCloud2& map_msg)
         roughness_pcl.header.frame_id = map_msg.header.frame_id;
         clearence_pcl.header.frame_id = map_msg.header.frame_id;
 
-        sensor_msgs::PointCloud2 trav_msg_out;
-        pcl::toROSMsg(traversability_pcl, trav_msg_out);
+        pcl_conversions::toPCL(map_msg.header.stamp, traversability_pcl.header.stamp); // keep the stamp of the input map
+        sensor_msgs::PointCloud2Ptr trav_msg_out(new sensor_msgs::PointCloud2());
+        pcl::toROSMsg(traversability_pcl, *trav_msg_out);
         pcl_pub_traversability.publish(trav_msg_out);
-
-        pcl::toROSMsg(clearence_pcl, trav_msg_out);
-        pcl_pub_clearence.publish(trav_msg_out);
-
-        pcl::toROSMsg(roughness_pcl, trav_msg_out);
-        pcl_pub_roughness.publish(trav_msg_out);
-
-        pcl::toROSMsg(label_pcl, trav_msg_out);
-        pcl_pub_label.publish(trav_msg_out);
-
-        pcl::toROSMsg(density_pcl, trav_msg_out);
-        pcl_pub_density.publish(trav_msg_out);
+        if (b_publish_delta) pcl_delta_pub_traversability.publish(traversability_pcl);
+        latency_tracer.end();
+
+        // all the channels in a single cloud: it is published as a shared pointer, hence it is serialized (directly from the pcl cloud) 
+        // only for the subscribers in other processes, while the nodelets in the same process receive the same buffer 
+        pcl_conversions::toPCL(map_msg.header, trav_channels_pcl->header);
+        pcl_pub_trav_channels.publish(trav_channels_pcl);
+
+        publishIfSubscribed(pcl_pub_clearence, clearence_pcl);
+        publishIfSubscribed(pcl_pub_roughness, roughness_pcl);
+        publishIfSubscribed(pcl_pub_label, label_pcl);
+        publishIfSubscribed(pcl_pub_density, density_pcl);
         
         for(size_t i=0; i < number_of_robots; i++)
         {
@@ -185,6 +218,17 @@ void pointCloudCallback(const sensor_msgs::PointCloud2& map_msg)
     }
 }
 
+void pointCloudDeltaCallback(const trajectory_control_msgs::PointCloudDelta& map_delta_msg)
+{
+    pcl::PointCloud<pcl::PointXYZRGBNormal> delta_map_pcl;
+    if (!map_delta_receiver.apply(map_delta_msg, delta_map_pcl)) return; /// < EXIT POINT
+
+    // the rebuilt map is processed as a full map message (a local copy, nothing crosses the network)
+    sensor_msgs::PointCloud2 map_msg;
+    pcl::toROSMsg(delta_map_pcl, map_msg);
+    pointCloudCallback(map_msg);
+}
+
 void clusteringpclConfigCallback(ClusterPclConfig& config, uint32_t level)
 {
     clustering_pcl.setConfig(config);
@@ -254,16 +298,22 @@ void mySigintHandler(int signum)
     exit(signum);
 }
 
-int main(int argc, char **argv)
+// resources which live as long as the node 
+boost::shared_ptr<tf::TransformListener> p_tf_listener;
+boost::shared_ptr<dynamic_reconfigure::Server<ClusterPclConfig> > p_clusteringpcl_config_server;
+boost::shared_ptr<dynamic_reconfigure::Server<TravAnalyzerConfig> > p_trav_config_server;
+ros::Subscriber sub_pcl;
+PointCloudShmSubscriber sub_pcl_shm;
+ros::Subscriber laser_proximity_sub;
+ros::Subscriber obst_pcl_sub;
+ros::Subscriber multi_robot_poses_sub;
+ros::Subscriber multi_robot_paths_sub;
+ros::Subscriber core_multi_robot_paths_sub;
+
+// n is the private node handle of the node (or of the nodelet)
+void init(ros::NodeHandle& n)
 {
-    ros::init(argc, argv, "traversability_node");
-
-    //override default sigint handler 
-    signal(SIGINT,mySigintHandler); 
-    
-    tf::TransformListener tf_listener(ros::Duration(10.0));
-
-    ros::NodeHandle n("~");
+    p_tf_listener.reset(new tf::TransformListener(ros::Duration(10.0)));
 
     /// < get parameters
     std::string str_robot_name   = getParam<std::string>(n, "robot_name", "ugv1");   /// < multi-robot
@@ -277,6 +327,10 @@ int main(int argc, char **argv)
     trav_analyzer.setRobotToAvoidRadius(robot_radius);      
 
     robot_frame_name = getParam<std::string>(n, "robot_frame_name", "base_link");    
+    if (getParam<bool>(n, "enable_profiler", false))
+    {
+        mr3d_profiling::ProfilerExporter::instance().start(n, getParam<std::string>(n, "profiler_stats_file", std::string()));
+    }
     
     ROS_INFO_STREAM("traversability node of robot " << robot_id << " alive");
     
@@ -300,28 +354,45 @@ int main(int argc, char **argv)
     }
     
     /// < dynamic reconfigure 
-    dynamic_reconfigure::Server<ClusterPclConfig> clusteringpcl_config_server(ros::NodeHandle("~/ClusteringPcl"));
-    clusteringpcl_config_server.setCallback(boost::bind(&clusteringpclConfigCallback, _1, _2));
+    p_clusteringpcl_config_server.reset(new dynamic_reconfigure::Server<ClusterPclConfig>(ros::NodeHandle(n, "ClusteringPcl")));
+    p_clusteringpcl_config_server->setCallback(boost::bind(&clusteringpclConfigCallback, _1, _2));
 
-    dynamic_reconfigure::Server<TravAnalyzerConfig> trav_config_server(ros::NodeHandle("~/TravAnal"));
-    trav_config_server.setCallback(boost::bind(&travConfigCallback, _1, _2));
+    p_trav_config_server.reset(new dynamic_reconfigure::Server<TravAnalyzerConfig>(ros::NodeHandle(n, "TravAnal")));
+    p_trav_config_server->setCallback(boost::bind(&travConfigCallback, _1, _2));
 
-    conv_pcl.setTFListener(tf_listener);
+    conv_pcl.setTFListener(*p_tf_listener);
     
     /// < Input 
-    ros::Subscriber sub_pcl = n.subscribe("/dynjoinpcl", 1, pointCloudCallback);
+    const bool b_use_shm_transport = getParam<bool>(n, "use_shm_transport", false); /// < intra-host large clouds through shared memory (see PointCloudShm.h)
+    if (getParam<bool>(n, "use_delta_input", false))
+    {
+        sub_pcl = n.subscribe("/dynjoinpcl_delta", 10, pointCloudDeltaCallback); // deltas must not be dropped
+    }
+    else
+    {
+        sub_pcl_shm.subscribe(n, "/dynjoinpcl", 1, pointCloudCallback, b_use_shm_transport);
+    }
     //ros::Subscriber robot_to_avoid_path_sub = n.subscribe("/traj_global_path_other", 1, robotToAvoidPathCallback);   /// < multi-robot
     
-    ros::Subscriber laser_proximity_sub = n.subscribe("/laser_proximity_topic", 1, laserProximityCallback);
+    laser_proximity_sub = n.subscribe("/laser_proximity_topic", 1, laserProximityCallback);
     
-    ros::Subscriber obst_pcl_sub = n.subscribe("/obst_point_cloud", 1, obstPclCallback);
-   
+    obst_pcl_sub = n.subscribe("/obst_point_cloud", 1, obstPclCallback);
+
+    /// < optional ESDF map (esdf_map_out of a voxblox EsdfServer) for the wall clearance, enabled by the TravAnal/use_esdf config
+    std::string esdf_map_topic = getParam<std::string>(n, "esdf_map_topic", std::string());
+    if (!esdf_map_topic.empty())
+    {
+        boost::shared_ptr<EsdfMapAdapter> p_esdf_map(new EsdfMapAdapter());
+        p_esdf_map->init(n, esdf_map_topic);
+        trav_analyzer.setEsdfMap(p_esdf_map);
+    }
+
     //ros::Subscriber other_robot_transform_sub = n.subscribe("/other_robot_transform_sub", 1, otherRobotTransformCallback);  /// < multi-robot
     
-    ros::Subscriber multi_robot_poses_sub = n.subscribe("/multi_robot_poses", 5, multiRobotPoseCallback); /// < multi-robot
+    multi_robot_poses_sub = n.subscribe("/multi_robot_poses", 5, multiRobotPoseCallback); /// < multi-robot
     
-    ros::Subscriber multi_robot_paths_sub = n.subscribe("/multi_robot_paths", 5, multiRobotPathsCallback); /// < multi-robot
-    ros::Subscriber core_multi_robot_paths_sub = n.subscribe("/core/multi_robot_paths", 5, multiRobotPathsCallback); /// < multi-robot
+    multi_robot_paths_sub = n.subscribe("/multi_robot_paths", 5, multiRobotPathsCallback); /// < multi-robot
+    core_multi_robot_paths_sub = n.subscribe("/core/multi_robot_paths", 5, multiRobotPathsCallback); /// < multi-robot
     
     for(size_t id=0; id < kMaxNumberOfRobots; id++)
     {
@@ -335,14 +406,18 @@ int main(int argc, char **argv)
     }
 
     /// < Ouput
-    pcl_pub_nowall = n.advertise<sensor_msgs::PointCloud2>("/clustered_pcl/no_wall", 1, true);
-    pcl_pub_wall   = n.advertise<sensor_msgs::PointCloud2>("/clustered_pcl/wall", 1, true);
+    pcl_pub_nowall.advertise(n, "/clustered_pcl/no_wall", 1, true, b_use_shm_transport);
+    pcl_pub_wall.advertise(n, "/clustered_pcl/wall", 1, true, b_use_shm_transport);
 
-    pcl_pub_traversability = n.advertise<sensor_msgs::PointCloud2>("/trav/traversability", 1, true);
+    pcl_pub_traversability.advertise(n, "/trav/traversability", 1, true, b_use_shm_transport);
+    b_publish_delta = getParam<bool>(n, "publish_delta", false);
+    if (getParam<bool>(n, "enable_latency_tracing", false)) latency_tracer.init(n, "traversability");
+    if (b_publish_delta) pcl_delta_pub_traversability.init(n, "/trav/traversability_delta");
     pcl_pub_clearence = n.advertise<sensor_msgs::PointCloud2>("/trav/clearence", 1, true);
     pcl_pub_density = n.advertise<sensor_msgs::PointCloud2>("/trav/density", 1, true);
     pcl_pub_label = n.advertise<sensor_msgs::PointCloud2>("/trav/label", 1, true);
     pcl_pub_roughness = n.advertise<sensor_msgs::PointCloud2>("/trav/roughness", 1, true);
+    pcl_pub_trav_channels = n.advertise<pcl::PointCloud<PointXYZTrav> >("/trav/channels", 1, true);
 
     pcl_pub_segmented = n.advertise<sensor_msgs::PointCloud2>("/clustered_pcl/segmented", 1, true);
     pcl_normal_pub = n.advertise<sensor_msgs::PointCloud2>("/normals_pcl", 1, true);
@@ -358,6 +433,21 @@ int main(int argc, char **argv)
     
     ROS_INFO_STREAM("starting the node **********************************");
      
+}
+
+} // namespace traversability
+
+#ifndef PATH_PLANNER_NODELET // the nodelet library is built from the same sources 
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "traversability_node");
+
+    //override default sigint handler 
+    signal(SIGINT,traversability::mySigintHandler); 
+
+    ros::NodeHandle n("~");
+    traversability::init(n);
+    
     //ros::MultiThreadedSpinner spinner(2); // Use 4 threads
     //spinner.spin(); // spin() will not return until the node has been shutdown
 
@@ -365,3 +455,4 @@ int main(int argc, char **argv)
     
     return 0;
 }
+#endif
@@ -0,0 +1,215 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR. 
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SCREEN_SPACE_PICKER_H
+#define SCREEN_SPACE_PICKER_H
+
+#include <cmath>
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+#include <OGRE/OgreCamera.h>
+#include <OGRE/OgreMatrix4.h>
+#include <OGRE/OgreVector2.h>
+#include <OGRE/OgreVector3.h>
+#include <OGRE/OgreViewport.h>
+
+#include <pcl/point_cloud.h>
+
+
+namespace path_planner_rviz_wp_plugin   
+{
+
+///	\class ScreenSpacePicker
+///	\author Luigi Freda
+///	\brief Picks the point of a cloud whose projection on the viewport is the closest to a pixel. 
+///        The points in front of the camera are projected once and binned in a screen-space 2D grid, which is rebuilt only when 
+///        the camera (view/projection matrices), the viewport size or the cloud (see invalidate()) change. A pick then visits 
+///        only the grid cells around the pixel, ring by ring, until the closest point found cannot be beaten by the next ring. 
+///        The points projected outside the viewport are scanned only if the viewport border is closer than the best point found. 
+///        The result is the same of a linear scan over the whole cloud. 
+///	\note
+/// \todo
+///	\date
+///	\warning not thread-safe: use it under the lock of the cloud 
+class ScreenSpacePicker
+{
+public:
+    
+    static const int kCellSize = 16; // [pixels]
+    
+public:
+    
+    ScreenSpacePicker():b_valid_(false),width_(0),height_(0),grid_cols_(0),grid_rows_(0){}
+    
+    // the cloud changed: the grid will be rebuilt at the next pick
+    void invalidate() { b_valid_ = false; }
+    
+    // return the index of the cloud point (in front of the camera) whose projection is the closest to the pixel (x,y), -1 if there is none 
+    template<typename PointT>
+    int pick(const Ogre::Viewport* viewport, const pcl::PointCloud<PointT>& cloud, const float x, const float y)
+    {
+        if(!isValid(viewport)) build(viewport, cloud);
+        
+        int best_index = -1;
+        float best_distance2 = std::numeric_limits<float>::max();
+        
+        if(!grid_points_.empty())
+        {
+            const int col = std::min(std::max((int)(x/kCellSize), 0), grid_cols_-1);
+            const int row = std::min(std::max((int)(y/kCellSize), 0), grid_rows_-1);
+            const int max_ring = std::max(grid_cols_, grid_rows_);
+            for(int ring = 0; ring <= max_ring; ring++)
+            {
+                // the points of this ring (and of the next ones) are at least (ring-1)*kCellSize away from the pixel 
+                const float min_distance = (ring - 1)*(float)kCellSize;
+                if( (best_index >= 0) && (min_distance > 0) && (min_distance*min_distance > best_distance2) ) break; /// < BREAK
+                
+                for(int r = row - ring; r <= row + ring; r++)
+                {
+                    if(r < 0 || r >= grid_rows_) continue; /// < CONTINUE
+                    const bool border_row = (r == row - ring) || (r == row + ring);
+                    for(int c = col - ring; c <= col + ring; c += (border_row ? 1 : 2*ring))
+                    {
+                        if(c >= 0 && c < grid_cols_) searchCell(r*grid_cols_ + c, x, y, best_index, best_distance2);
+                        if(ring == 0) break; /// < BREAK
+                    }
+                }
+            }
+        }
+        
+        // the points projected outside the viewport are at least as far as the viewport border 
+        const float border_distance = std::max(std::min(std::min(x, width_ - x), std::min(y, height_ - y)), 0.f);
+        if( (best_index < 0) || (border_distance*border_distance < best_distance2) )
+        {
+            for(size_t i = 0; i < outside_points_.size(); i++)
+            {
+                checkPoint(outside_points_[i], x, y, best_index, best_distance2);
+            }
+        }
+        
+        return best_index;
+    }
+    
+protected:
+    
+    struct ProjectedPoint
+    {
+        float x, y;  // [pixels]
+        int index;   // in the cloud 
+    };
+    
+    bool isValid(const Ogre::Viewport* viewport) const
+    {
+        const Ogre::Camera* camera = viewport->getCamera();
+        return b_valid_ && 
+               (width_ == viewport->getActualWidth()) && (height_ == viewport->getActualHeight()) && 
+               (view_matrix_ == camera->getViewMatrix()) && (projection_matrix_ == camera->getProjectionMatrix());
+    }
+    
+    template<typename PointT>
+    void build(const Ogre::Viewport* viewport, const pcl::PointCloud<PointT>& cloud)
+    {
+        const Ogre::Camera* camera = viewport->getCamera();
+        view_matrix_ = camera->getViewMatrix();
+        projection_matrix_ = camera->getProjectionMatrix();
+        width_  = viewport->getActualWidth();
+        height_ = viewport->getActualHeight();
+        grid_cols_ = std::max((width_ + kCellSize - 1)/kCellSize, 1);
+        grid_rows_ = std::max((height_ + kCellSize - 1)/kCellSize, 1);
+        
+        // project the points in front of the camera (depth > 0) on the viewport
+        std::vector<ProjectedPoint> inside_points; 
+        std::vector<int> cells; 
+        inside_points.reserve(cloud.size());
+        cells.reserve(cloud.size());
+        outside_points_.clear();
+        for(size_t i = 0; i < cloud.size(); i++)
+        {
+            const Ogre::Vector3 point3D_cam = view_matrix_ * Ogre::Vector3(cloud.points[i].x, cloud.points[i].y, cloud.points[i].z);
+            if(-point3D_cam.z <= 0) continue; /// < CONTINUE (behind the camera)
+            
+            const Ogre::Vector3 point2D = projection_matrix_ * point3D_cam;
+            ProjectedPoint point;
+            point.x = ((point2D.x * 0.5) + 0.5) * width_;
+            point.y = (1 - ((point2D.y * 0.5) + 0.5)) * height_;
+            point.index = i;
+            
+            const int col = (int)std::floor(point.x/kCellSize);
+            const int row = (int)std::floor(point.y/kCellSize);
+            if(col >= 0 && col < grid_cols_ && row >= 0 && row < grid_rows_)
+            {
+                inside_points.push_back(point);
+                cells.push_back(row*grid_cols_ + col);
+            }
+            else
+            {
+                outside_points_.push_back(point);
+            }
+        }
+        
+        // counting sort of the inside points by cell 
+        cell_starts_.assign(grid_cols_*grid_rows_ + 1, 0);
+        for(size_t i = 0; i < cells.size(); i++) cell_starts_[cells[i] + 1]++;
+        for(size_t c = 1; c < cell_starts_.size(); c++) cell_starts_[c] += cell_starts_[c-1];
+        grid_points_.resize(inside_points.size());
+        std::vector<int> cell_fill(cell_starts_.begin(), cell_starts_.end() - 1);
+        for(size_t i = 0; i < inside_points.size(); i++) grid_points_[cell_fill[cells[i]]++] = inside_points[i];
+        
+        b_valid_ = true;
+    }
+    
+    void searchCell(const int cell, const float x, const float y, int& best_index, float& best_distance2) const
+    {
+        for(int i = cell_starts_[cell]; i < cell_starts_[cell + 1]; i++)
+        {
+            checkPoint(grid_points_[i], x, y, best_index, best_distance2);
+        }
+    }
+    
+    static void checkPoint(const ProjectedPoint& point, const float x, const float y, int& best_index, float& best_distance2)
+    {
+        const float dx = point.x - x, dy = point.y - y;
+        const float distance2 = dx*dx + dy*dy;
+        if(distance2 < best_distance2)
+        {
+            best_distance2 = distance2;
+            best_index = point.index;
+        }
+    }
+    
+protected:
+    
+    bool b_valid_;
+    
+    Ogre::Matrix4 view_matrix_; 
+    Ogre::Matrix4 projection_matrix_; 
+    int width_, height_; // [pixels]
+    
+    int grid_cols_, grid_rows_; 
+    std::vector<int> cell_starts_;               // points of cell c: grid_points_[cell_starts_[c] .. cell_starts_[c+1]-1]
+    std::vector<ProjectedPoint> grid_points_;    // projected inside the viewport, sorted by cell 
+    std::vector<ProjectedPoint> outside_points_; // projected outside the viewport 
+};
+
+} // namespace path_planner_rviz_wp_plugin
+
+#endif // SCREEN_SPACE_PICKER_H
@@ -62,6 +62,8 @@
 #include <trajectory_control_msgs/message_enums.h> // for SegmentStatus and TaskType
 #include <path_planner/Transform.h>
 
+#include "ScreenSpacePicker.h"
+
 #endif
 
 typedef pcl::PointCloud<pcl::PointXYZ> PointCloud;
@@ -193,7 +195,8 @@ public:
     // N.B.: after calling this function you have to apply changes by using markers_server_->applyChanges(); 
     void markerErase(const std::string marker_name); 
     
-    void taskAppend(const ros::Time& stamp, uint8_t task_type = 0 /*kNormal*/);
+    // if b_optimize_order is true, the planner reorders the waypoints to reduce the total path cost (the marker priorities are respected)
+    void taskAppend(const ros::Time& stamp, uint8_t task_type = 0 /*kNormal*/, bool b_optimize_order = false);
     
     void markerInteractiveCallback(const visualization_msgs::InteractiveMarkerFeedbackConstPtr& feedback);
 
@@ -275,6 +278,7 @@ protected:
     // input point cloud
     PointCloud pcd_;
     boost::recursive_mutex pcd_mtx_;  
+    ScreenSpacePicker pcd_picker_; // screen-space index of pcd_ for picking the closest point to the mouse pointer (use it under pcd_mtx_) 
 
     // marker associated data
     unsigned long markers_count_; // internal counter for markers names generation
@@ -68,21 +68,6 @@ namespace path_planner_rviz_wp_plugin
         
         
         
-static Ogre::Vector2 project3DPointToViewportXYwithDepth(const Ogre::Viewport* view, const Ogre::Vector3& pos, float& depth)
-{
-  Ogre::Camera* cam = view->getCamera();
-  
-  Ogre::Vector3 pos3D_cam = cam->getViewMatrix() * pos;
-  Ogre::Vector3 pos2D = cam->getProjectionMatrix() * pos3D_cam;
-  
-  depth = -pos3D_cam.z; // the depth axis 
-
-  Ogre::Real x = ((pos2D.x * 0.5) + 0.5);
-  Ogre::Real y = 1 - ((pos2D.y * 0.5) + 0.5);
-
-  return  Ogre::Vector2(x * view->getActualWidth(), y * view->getActualHeight());
-}
-
 /* BEGIN_TUTORIAL
  * Construction and destruction
  * ^^^^^^^^^^^^^^^^^^^^^^^^^^^^
@@ -203,6 +188,8 @@ WaypointsTool::WaypointsTool(
     markers_interactive_menu_.insert(exploration_sub_menu_handle,"Pause", boost::bind(&WaypointsTool::markerInteractiveCallback, this, _1));
     markers_interactive_menu_.insert(exploration_sub_menu_handle,"Restart", boost::bind(&WaypointsTool::markerInteractiveCallback, this, _1));  
     
+    markers_interactive_menu_.insert("Append optimized task", boost::bind(&WaypointsTool::markerInteractiveCallback, this, _1)); /// < 17
+    
     
     // right-click menu for 'static' markers (those gray)
     markers_static_menu_.insert("Remove this task", boost::bind(&WaypointsTool::markerStaticCallback, this, _1));
@@ -271,6 +258,7 @@ void WaypointsTool::cloudCallback(const PointCloud::ConstPtr& msg)
 
     // get last point cloud
     pcl::copyPointCloud(*msg, pcd_);
+    pcd_picker_.invalidate();
 
     if (pcl_normals_sub_.getNumPublishers() >= 0)  pcl_normals_sub_.shutdown();   // disconnect the other similar subscriber  
 }
@@ -280,6 +268,7 @@ void WaypointsTool::cloudNormalsCallback(const PointCloud::ConstPtr& msg)
 
     // get last point cloud
     pcl::copyPointCloud(*msg, pcd_);
+    pcd_picker_.invalidate();
 
     if (pcl_sub_.getNumPublishers() >= 0)  pcl_sub_.shutdown();  // disconnect the other similar subscriber  
 }
@@ -290,8 +279,9 @@ void WaypointsTool::cloudNormalsCallback(const PointCloud::ConstPtr& msg)
  * processMouseEvent() is sort of the main function of a Tool, because
  * mouse interactions are the point of Tools.
  *
- * We use the utility function rviz::project3DPointToViewportXY(...) to
- * project the points of the cloud  */
+ * We use the ScreenSpacePicker to find the point of the cloud whose 
+ * projection is the closest to the pointer (the projected cloud is cached 
+ * until the camera or the cloud change) */
 int WaypointsTool::processMouseEvent(rviz::ViewportMouseEvent& event)
 {
     // update viewport for projection of markers over the point cloud
@@ -303,36 +293,18 @@ int WaypointsTool::processMouseEvent(rviz::ViewportMouseEvent& event)
     {
 
         bool ok = false;
-        float depth = 0; 
             
         // find point (of the cloud) with the nearest projection to the pointer
-        double distance = std::numeric_limits<double>::max();
         Ogre::Vector3 marker_position(0, 0, 0);
 
         { // start locking scope 
             boost::recursive_mutex::scoped_lock locker(pcd_mtx_);
 
-            for (size_t i = 0; i < pcd_.size(); i++)  
+            const int index = pcd_picker_.pick(viewport_, pcd_, event.x, event.y);
+            if(index >= 0)
             {
-                Ogre::Vector3 point3D(pcd_.points[i].x, pcd_.points[i].y, pcd_.points[i].z);
-                
-                //Ogre::Vector2 point2D = rviz::project3DPointToViewportXY(viewport_, point3D);
-                Ogre::Vector2 point2D = project3DPointToViewportXYwithDepth(viewport_, point3D, depth);
-
-                if(depth > 0)
-                {
-                    ok = true; 
-                    double d = sqrt(pow(event.x - point2D.x, 2) + pow(event.y - point2D.y, 2));
-                    if (distance > d)
-                    {
-                        marker_position = point3D;
-                        distance = d;
-                    }
-                }
-                /*else
-                {
-                    ROS_INFO_STREAM("WaypointsTool::processMouseEvent() - depth: " << depth << std::endl); 
-                }*/
+                ok = true; 
+                marker_position = Ogre::Vector3(pcd_.points[index].x, pcd_.points[index].y, pcd_.points[index].z);
             }
 
         }// end locking scope
@@ -523,26 +495,12 @@ void WaypointsTool::markerUpdate(const std::string& name, const geometry_msgs::P
     { // start locking scope 
         boost::recursive_mutex::scoped_lock locker(pcd_mtx_);
 
-        float depth = 0; 
-        
         // find point (of the cloud) with the nearest projection of the pointer
-        double distance = std::numeric_limits<double>::max();
-        for (size_t i = 0; i < pcd_.size(); i++)
+        const int index = pcd_picker_.pick(viewport_, pcd_, pointer.x, pointer.y);
+        if(index >= 0)
         {
-            Ogre::Vector3 point3D(pcd_.points[i].x, pcd_.points[i].y, pcd_.points[i].z);
-            //Ogre::Vector2 p = rviz::project3DPointToViewportXY(viewport_, P);
-            Ogre::Vector2 point2D = project3DPointToViewportXYwithDepth(viewport_, point3D, depth);
-
-            if(depth > 0)
-            {
-                ok = true; 
-                double d = sqrt(pow(pointer.x - point2D.x, 2) + pow(pointer.y - point2D.y, 2));
-                if (distance > d)
-                {
-                    position = point3D;
-                    distance = d;
-                }
-            }
+            ok = true; 
+            position = Ogre::Vector3(pcd_.points[index].x, pcd_.points[index].y, pcd_.points[index].z);
         }
 
     } // end locking scope 
@@ -664,7 +622,7 @@ void WaypointsTool::markerErase(const std::string marker_name)
 }
 
 // append a new task by pushing all the current interactive markers 
-void WaypointsTool::taskAppend(const ros::Time& stamp, uint8_t task_type)
+void WaypointsTool::taskAppend(const ros::Time& stamp, uint8_t task_type, bool b_optimize_order)
 {
     int segment_count = 0;
     geometry_msgs::Pose marker_msg;
@@ -678,6 +636,7 @@ void WaypointsTool::taskAppend(const ros::Time& stamp, uint8_t task_type)
     task_msg.name = ss.str();
     task_msg.segment_id = -1;
     task_msg.type = task_type; 
+    task_msg.optimize_order = b_optimize_order; 
     task_msg.header.stamp = stamp;
     task_msg.header.frame_id = world_frame_id_;
     
@@ -695,6 +654,11 @@ void WaypointsTool::taskAppend(const ros::Time& stamp, uint8_t task_type)
             {
                 // add the waypoint (marker position) to the task message
                 task_msg.waypoints.push_back(marker.pose.position);
+                {
+                boost::recursive_mutex::scoped_lock locker(marker_maps_mtx_);
+                std::unordered_map<std::string,PriorityType>::const_iterator it = priorityMarkerMap_.find(marker.name);
+                task_msg.priorities.push_back( (it != priorityMarkerMap_.end()) ? it->second : 1 /*default priority*/ );
+                }
 
                 // convert to a 'static' marker one
                 marker.controls[0].interaction_mode = visualization_msgs::InteractiveMarkerControl::MENU;
@@ -865,6 +829,11 @@ void WaypointsTool::patrollingTaskAppend(const ros::Time& stamp)
             {
                 // add the waypoint (marker position) to the task message
                 task_msg.waypoints.push_back(marker.pose.position);
+                {
+                boost::recursive_mutex::scoped_lock locker(marker_maps_mtx_);
+                std::unordered_map<std::string,PriorityType>::const_iterator it = priorityMarkerMap_.find(marker.name);
+                task_msg.priorities.push_back( (it != priorityMarkerMap_.end()) ? it->second : 1 /*default priority*/ );
+                }
                 
                 patrolling_point.x = marker.pose.position.x;
                 patrolling_point.y = marker.pose.position.y;
@@ -1125,6 +1094,7 @@ void WaypointsTool::explorationPriorityActionsCallback(const exploration_msgs::E
 
 void WaypointsTool::markerInteractiveCallback(const visualization_msgs::InteractiveMarkerFeedbackConstPtr& feedback)
 {
+    static const int kAppendOptimizedTaskMenuEntry = 17;
     static const int kPatrollingMenuOffset = 6;
     static const int kExplorationMenuOffset = 12;    
     
@@ -1149,6 +1119,10 @@ void WaypointsTool::markerInteractiveCallback(const visualization_msgs::Interact
         case 2: // Append cyclic task
             taskAppend(feedback->header.stamp, kPathCyclic);
             break;
+            
+        case kAppendOptimizedTaskMenuEntry: // Append task with optimized waypoints order
+            taskAppend(feedback->header.stamp, kPathNormal, true);
+            break;
 
         case 3: // Remove this (interactive) waypoint
             explorationSendPriorityPoint(feedback->marker_name, exploration_msgs::ExplorationPriorityPoint::kActionRemove); 
@@ -0,0 +1,130 @@
+/**
+* This file is part of the ROS package scan_space_time_filter which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RANGE_IMAGE_CONSISTENCY_FILTER_H_
+#define RANGE_IMAGE_CONSISTENCY_FILTER_H_
+
+#include <deque>
+#include <vector>
+#include <stdint.h>
+
+#include <eigen3/Eigen/Dense>
+
+#include <boost/core/noncopyable.hpp>
+
+#include <sensor_msgs/PointCloud2.h>
+#include <kindr/minimal/quat-transformation.h>
+
+
+///	\class RangeImageConsistencyParams
+///	\author Luigi Freda
+///	\brief
+///	\note
+/// \todo
+///	\date
+///	\warning
+struct RangeImageConsistencyParams
+{
+    int    num_scans_       = 5;      // number of previous scans (range images) each point is checked against
+    int    rows_            = 64;     // rows of the range images (beams of the lidar)
+    int    columns_         = 1024;   // columns of the range images (azimuth steps)
+    double min_elevation_   = -22.5;  // [degrees] elevation of the lowest beam
+    double max_elevation_   = 22.5;   // [degrees] elevation of the highest beam
+    int    window_rows_     = 1;      // half size of the neighborhood window [pixels]
+    int    window_columns_  = 1;      // half size of the neighborhood window [pixels]
+    double abs_tolerance_   = 0.2;    // [m] range tolerance = abs_tolerance_ + rel_tolerance_ * range
+    double rel_tolerance_   = 0.02;
+    int    min_free_votes_  = 2;      // a point seen through by at least this number of scans (and confirmed by none) is removed
+};
+
+
+///	\class RangeImageConsistencyFilter
+///	\author Luigi Freda
+///	\brief Spatio-temporal consistency filter for the scans of a spinning lidar, based on its scan organization instead of 3D
+///        radius searches. The range images (rows = beams, columns = azimuth steps) of the previous num_scans_ scans are kept
+///        with their sensor poses. Each point of a new scan is projected into each previous range image and compared with
+///        the ranges of a small window around its pixel: a scan confirms the point if one of them matches its range, it sees
+///        through the point if all of them are farther (the point was free space). Points seen through by at least
+///        min_free_votes_ scans and confirmed by none (dynamic objects, speckles) are removed. The points are bucketed by
+///        range image row and the rows are processed in parallel.
+///	\note  the points do not need to be organized in the cloud: their pixels are computed from their directions
+/// \todo
+///	\date
+///	\warning
+class RangeImageConsistencyFilter : private boost::noncopyable
+{
+public: // typedefs
+
+    typedef kindr::minimal::QuatTransformation Transformation;
+
+public:
+
+    RangeImageConsistencyFilter();
+
+    // remove from cloud_in the points contradicted by the previous range images (cloud_out has the same fields, unorganized),
+    // then add the scan to the history; T_world_sensor is the pose of the sensor at the scan stamp.
+    // Return false if the cloud has no float x, y, z fields (cloud_out and the history are left untouched)
+    bool filter(const sensor_msgs::PointCloud2& cloud_in, const Transformation& T_world_sensor, sensor_msgs::PointCloud2& cloud_out);
+
+    // forget the previous scans
+    void reset() { history_.clear(); }
+
+public: // setters
+
+    void setParams(const RangeImageConsistencyParams& params);
+
+public: // getters
+
+    const RangeImageConsistencyParams& getParams() const { return params_; }
+
+protected:
+
+    struct RangeImage
+    {
+        std::vector<float> ranges;  // row-major, 0 = no return
+        Eigen::Matrix3f R_sensor_world;
+        Eigen::Vector3f t_sensor_world;
+    };
+
+protected:
+
+    // pixel of a point in the sensor frame; return false if it is outside the vertical field of view
+    inline bool project(const Eigen::Vector3f& p, float& range, int& row, int& col) const;
+
+    // return true if the point (in the sensor frame of the current scan) is not contradicted by the previous scans
+    bool isConsistent(const Eigen::Vector3f& p, const std::vector<Eigen::Matrix3f>& Rs, const std::vector<Eigen::Vector3f>& ts) const;
+
+protected:
+
+    RangeImageConsistencyParams params_;
+    float min_elevation_;        // [rad]
+    float inv_elevation_step_;   // [rows/rad]
+    float inv_azimuth_step_;     // [columns/rad]
+
+    std::deque<RangeImage> history_;  // the oldest in front
+
+    // scratch buffers kept across the scans
+    std::vector<float> xs_, ys_, zs_;
+    std::vector<int> point_rows_;
+    std::vector<int> row_start_, row_points_;  // indices of the points bucketed by row (the last bucket has the invalid points)
+    std::vector<uint8_t> keep_;
+};
+
+#endif //
@@ -0,0 +1,150 @@
+/**
+* This file is part of the ROS package scan_space_time_filter which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SCAN_DESKEW_H_
+#define SCAN_DESKEW_H_
+
+#include <deque>
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/core/noncopyable.hpp>
+
+#include <ros/ros.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <sensor_msgs/Imu.h>
+#include <tf/transform_listener.h>
+
+
+///	\class ScanDeskewParams
+///	\author Luigi Freda
+///	\brief
+///	\note
+/// \todo
+///	\date
+///	\warning
+struct ScanDeskewParams
+{
+    std::string odomFrame_     = "odom"; // frame of the robot poses (e.g. published by odom2tf)
+    int    num_pose_samples_   = 64;     // number of poses sampled over the scan duration
+    double max_scan_duration_  = 0.25;   // [s] scans with a larger time span are not deskewed
+    double tf_wait_timeout_    = 0.1;    // [s] max wait for the pose at the end of the scan
+    double tf_cache_length_    = 10;     // [s]
+
+    bool   use_imu_            = true;   // integrate the IMU angular velocity for the rotation over the scan
+    double imu_buffer_length_  = 1.;     // [s]
+};
+
+
+///	\class ScanDeskew
+///	\author Luigi Freda
+///	\brief Motion compensation of the scans of a spinning lidar (Ouster, Velodyne).
+///        Each point is moved from the sensor frame at its acquisition time (given by the per-point time field "t" or "time")
+///        to the sensor frame at the scan stamp. The sensor poses are sampled over the scan duration: the translation is
+///        interpolated between the TF poses at the scan boundaries, the rotation is obtained by integrating the IMU angular
+///        velocity (or by slerp if no IMU data covers the scan). The points are transformed in parallel on SoA buffers.
+///	\note
+/// \todo
+///	\date
+///	\warning
+class ScanDeskew : private boost::noncopyable
+{
+public: // static constants
+
+    static const int    kMinPoseSamples;
+    static const double kImuMaxGap;       // [s] max distance of the IMU samples from the scan boundaries
+
+public:
+
+    ScanDeskew(const ros::NodeHandle &nh, const ros::NodeHandle &nh_private);
+
+    // deskew the input cloud into the output one; return false if the cloud cannot be deskewed (e.g. no time field or no pose)
+    bool deskew(const sensor_msgs::PointCloud2& cloud_in, sensor_msgs::PointCloud2& cloud_out);
+
+public: // setters
+
+    bool setParams(); // read from ros workspace
+    void setParams(const ScanDeskewParams& params) { params_ = params; }
+
+public: // getters
+
+    const ScanDeskewParams& getParams() const { return params_; }
+
+protected:
+
+    struct ImuSample
+    {
+        ros::Time stamp;
+        tf::Vector3 angular_velocity; // in the IMU frame
+    };
+
+protected:
+
+    void setPubsAndSubs();
+
+    void cloudCallback(const sensor_msgs::PointCloud2::ConstPtr& cloud);
+    void imuCallback(const sensor_msgs::Imu::ConstPtr& imu);
+
+    // update the cached field offsets if the layout of the cloud changed; return false if the layout is not supported
+    bool updateLayout(const sensor_msgs::PointCloud2& cloud);
+
+    bool lookupSensorPose(const std::string& sensor_frame, const ros::Time& time, double timeout, tf::StampedTransform& pose);
+
+    // rotations of the sensor frame w.r.t. itself at start_time, sampled every sample_period; return false if the IMU data do not cover the interval
+    bool integrateImu(const std::string& sensor_frame, const ros::Time& start_time, double sample_period, int num_samples, std::vector<tf::Quaternion>& rotations);
+
+protected:
+
+    ros::NodeHandle nh_;
+    ros::NodeHandle nh_private_;
+
+    ros::Subscriber cloud_sub_;
+    ros::Subscriber imu_sub_;
+    ros::Publisher cloud_pub_;
+
+    boost::shared_ptr<tf::TransformListener> p_tf_listener_;
+
+    ScanDeskewParams params_;
+
+    // cached layout of the input clouds
+    std::vector<sensor_msgs::PointField> fields_;
+    uint32_t point_step_;
+    uint32_t x_offset_, y_offset_, z_offset_;
+    uint32_t time_offset_;
+    uint8_t time_datatype_;
+    bool b_layout_valid_;
+
+    // IMU samples (the oldest in front)
+    boost::mutex imu_mutex_;
+    std::deque<ImuSample> imu_buffer_;
+    std::string imu_frame_;
+    std::string imu_sensor_frame_;  // sensor frame of the cached IMU rotation
+    tf::Quaternion q_sensor_imu_;   // rotation from the IMU frame to the sensor frame
+    bool b_q_sensor_imu_valid_;
+
+    // scratch buffers kept across the scans
+    std::vector<float> xs_, ys_, zs_, ts_;
+    std::vector<float> sample_transforms_; // row-major [R|t] (12 floats) of each pose sample
+    std::vector<tf::Quaternion> sample_rotations_;
+};
+
+#endif //
@@ -70,7 +70,7 @@ private:
     // set the topic name of the publishers
     void setPubsAndSubs();
 
-    void processPointcloudWithTf(const sensor_msgs::PointCloud2::ConstPtr &pointcloud);
+    void processPointcloudWithTf(const sensor_msgs::PointCloud2::ConstPtr &pointcloud_in);
 
 };
 
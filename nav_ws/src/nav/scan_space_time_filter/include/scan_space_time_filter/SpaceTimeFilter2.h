@@ -75,8 +75,8 @@ private:
     // set the topic name of the publishers
     void setPubsAndSubs();
 
-    void processPointcloudWithTf1(const sensor_msgs::PointCloud2::ConstPtr &pointcloud);
-    void processPointcloudWithTf2(const sensor_msgs::PointCloud2::ConstPtr &pointcloud);
+    void processPointcloudWithTf1(const sensor_msgs::PointCloud2::ConstPtr &pointcloud_in);
+    void processPointcloudWithTf2(const sensor_msgs::PointCloud2::ConstPtr &pointcloud_in);
 
     void pubThreadLoop();
 
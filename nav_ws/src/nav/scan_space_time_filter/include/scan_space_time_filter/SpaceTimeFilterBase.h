@@ -28,6 +28,7 @@
 #include <math.h>
 #include <limits>
 #include <algorithm>
+#include <deque>
 
 #include <eigen3/Eigen/StdVector>
 #include <eigen3/Eigen/Dense>
@@ -56,7 +57,10 @@
 #include <ros/ros.h>
 #include <sensor_msgs/PointCloud2.h>
 
+#include "RangeImageConsistencyFilter.h"
+
 #include <path_planner/KdTreeFLANN.h>
+#include <path_planner/PointHashIndex.h>
 
 #include <tf/transform_listener.h>
 #include <kindr/minimal/quat-transformation.h>
@@ -81,6 +85,9 @@ struct SpaceTimeFilterParams
     bool   do_downsampling_      = false;      
     double downsample_leaf_size_ = 0.075; // [m]
 
+    bool   do_consistency_filtering_ = false; // remove the points contradicted by the previous lidar scans (see RangeImageConsistencyFilter)
+    RangeImageConsistencyParams consistency_params_;
+
 };
 
 ///	\class SpaceTimeFilterBase
@@ -115,6 +122,8 @@ public:
     virtual void init();
 
     bool insertPointCloud(const sensor_msgs::PointCloud2::ConstPtr &pointcloud, const uint32_t& index=0);
+    // if do_consistency_filtering_, return the cloud without the points contradicted by the previous scans (every scan must go through it), else the input cloud
+    sensor_msgs::PointCloud2::ConstPtr filterConsistency(const sensor_msgs::PointCloud2::ConstPtr &pointcloud);
     bool filterPointCloud(const sensor_msgs::PointCloud2::ConstPtr &pointcloud, const ros::Time &pcl_stamp, Transformation::Position &q_p_i, Eigen::Vector3d &q_n_i);
 
 public: // setters 
@@ -134,14 +143,22 @@ protected: // private data
     // interaction mutex: to be locked every time a public method is called (setters, getters and planning)
     boost::recursive_mutex interaction_mutex;
 
-    pcl::PointCloud<pcl::PointNormal>::Ptr pcl_pose_;                      
-    std::vector<ros::Time> pcl_pose_stamp_;
-    int oldest_pose_idx_;
+    struct PoseEntry
+    {
+        pcl::PointNormal pose; // the scan index is stored in data[3]
+        ros::Time stamp;
+    };
 
-    pp::KdTreeFLANN<pcl::PointNormal, ::flann::L2_3D<float>> kdtree_pose_; // to search closest pose in spatial-time filter
+    std::deque<PoseEntry, Eigen::aligned_allocator<PoseEntry> > poses_; // time-ordered ring buffer of the stored poses (the oldest in front)
+    uint64_t first_pose_id_;  // id of poses_.front(): poses_[i] has id first_pose_id_ + i
+    ros::Time last_pose_stamp_;
+
+    pp::PointHashIndex<pcl::PointNormal> pose_index_; // to search closest pose in spatial-time filter (cell size = dist_pose_thres_)
 
     SpaceTimeFilterParams params_;
 
+    RangeImageConsistencyFilter consistency_filter_;
+
 protected:
     bool lookupTransform(const std::string &from_frame,
                          const std::string &to_frame, const ros::Time &timestamp,
@@ -0,0 +1,214 @@
+/**
+* This file is part of the ROS package scan_space_time_filter which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "RangeImageConsistencyFilter.h"
+
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+
+namespace
+{
+
+inline float readFloat(const uint8_t* p)
+{
+    float v;
+    memcpy(&v, p, sizeof(float)); // unaligned load
+    return v;
+}
+
+}
+
+
+RangeImageConsistencyFilter::RangeImageConsistencyFilter()
+{
+    setParams(params_);
+}
+
+void RangeImageConsistencyFilter::setParams(const RangeImageConsistencyParams& params)
+{
+    params_ = params;
+    params_.num_scans_ = std::max(params_.num_scans_, 1);
+    params_.rows_ = std::max(params_.rows_, 2);
+    params_.columns_ = std::max(params_.columns_, 1);
+
+    min_elevation_ = params_.min_elevation_ * M_PI / 180.;
+    const double elevation_step = (params_.max_elevation_ - params_.min_elevation_) * M_PI / 180. / (params_.rows_ - 1);
+    inv_elevation_step_ = (elevation_step > 0) ? 1. / elevation_step : 0.;
+    inv_azimuth_step_ = params_.columns_ / (2. * M_PI);
+
+    history_.clear(); // the stored images have the old size
+}
+
+inline bool RangeImageConsistencyFilter::project(const Eigen::Vector3f& p, float& range, int& row, int& col) const
+{
+    const float horizontal_range = sqrtf(p.x()*p.x() + p.y()*p.y());
+    range = sqrtf(horizontal_range*horizontal_range + p.z()*p.z());
+    row = (int)lrintf((atan2f(p.z(), horizontal_range) - min_elevation_) * inv_elevation_step_);
+    if (!(range > 0.f) || (row < 0) || (row >= params_.rows_)) return false; /// < EXIT POINT
+    col = (int)((atan2f(p.y(), p.x()) + (float)M_PI) * inv_azimuth_step_);
+    col = std::min(std::max(col, 0), params_.columns_ - 1);
+    return true;
+}
+
+bool RangeImageConsistencyFilter::isConsistent(const Eigen::Vector3f& p, const std::vector<Eigen::Matrix3f>& Rs, const std::vector<Eigen::Vector3f>& ts) const
+{
+    const int rows = params_.rows_;
+    const int columns = params_.columns_;
+    int free_votes = 0;
+    for (size_t k = 0; k < history_.size(); k++)
+    {
+        float range;
+        int row, col;
+        if (!project(Rs[k] * p + ts[k], range, row, col)) continue;
+
+        const float tolerance = params_.abs_tolerance_ + params_.rel_tolerance_ * range;
+        const std::vector<float>& ranges = history_[k].ranges;
+        bool b_any_return = false;
+        bool b_all_farther = true;
+        for (int r = std::max(row - params_.window_rows_, 0); r <= std::min(row + params_.window_rows_, rows - 1); r++)
+        {
+            const float* ranges_row = ranges.data() + (size_t)r * columns;
+            for (int dc = -params_.window_columns_; dc <= params_.window_columns_; dc++)
+            {
+                const float pixel_range = ranges_row[(col + dc + columns) % columns]; // the azimuth wraps around
+                if (pixel_range <= 0.f) continue;
+                b_any_return = true;
+                if (fabsf(pixel_range - range) <= tolerance) return true; /// < EXIT POINT (confirmed)
+                b_all_farther &= (pixel_range > range + tolerance);
+            }
+        }
+        if (b_any_return && b_all_farther) free_votes++;
+    }
+    return free_votes < params_.min_free_votes_;
+}
+
+bool RangeImageConsistencyFilter::filter(const sensor_msgs::PointCloud2& cloud_in, const Transformation& T_world_sensor, sensor_msgs::PointCloud2& cloud_out)
+{
+    // get the layout
+    int x_offset = -1, y_offset = -1, z_offset = -1;
+    for (size_t j = 0; j < cloud_in.fields.size(); j++)
+    {
+        const sensor_msgs::PointField& field = cloud_in.fields[j];
+        if (field.datatype != sensor_msgs::PointField::FLOAT32) continue;
+        if (field.name == "x") x_offset = field.offset;
+        else if (field.name == "y") y_offset = field.offset;
+        else if (field.name == "z") z_offset = field.offset;
+    }
+    if ((x_offset < 0) || (y_offset < 0) || (z_offset < 0)) return false; /// < EXIT POINT
+
+    const int rows = params_.rows_;
+    const int columns = params_.columns_;
+    const size_t num_points = (size_t)cloud_in.width * cloud_in.height;
+    const uint32_t point_step = cloud_in.point_step;
+
+    // read the points, compute their pixels and the range image of the scan
+    RangeImage image;
+    image.ranges.assign((size_t)rows * columns, 0.f);
+    xs_.resize(num_points);
+    ys_.resize(num_points);
+    zs_.resize(num_points);
+    point_rows_.resize(num_points);
+    row_start_.assign(rows + 2, 0);
+    for (size_t i = 0; i < num_points; i++)
+    {
+        const uint8_t* p = cloud_in.data.data() + (i / cloud_in.width) * cloud_in.row_step + (i % cloud_in.width) * point_step;
+        const Eigen::Vector3f point(readFloat(p + x_offset), readFloat(p + y_offset), readFloat(p + z_offset));
+        xs_[i] = point.x();
+        ys_[i] = point.y();
+        zs_[i] = point.z();
+
+        float range;
+        int row, col;
+        if (!point.allFinite() || !project(point, range, row, col))
+        {
+            row = rows; // invalid points are kept as they are
+        }
+        else
+        {
+            float& pixel_range = image.ranges[(size_t)row * columns + col];
+            if ((pixel_range == 0.f) || (range < pixel_range)) pixel_range = range;
+        }
+        point_rows_[i] = row;
+        row_start_[row + 1]++;
+    }
+
+    // bucket the points by row (counting sort)
+    for (int r = 0; r <= rows; r++) row_start_[r + 1] += row_start_[r];
+    row_points_.resize(num_points);
+    {
+        std::vector<int> row_end(row_start_.begin(), row_start_.end() - 1);
+        for (size_t i = 0; i < num_points; i++) row_points_[row_end[point_rows_[i]]++] = i;
+    }
+
+    // transformations from the current sensor frame to the sensor frames of the previous scans
+    const Eigen::Matrix3f R_world_sensor = T_world_sensor.getRotationMatrix().cast<float>();
+    const Eigen::Vector3f t_world_sensor = T_world_sensor.getPosition().cast<float>();
+    std::vector<Eigen::Matrix3f> Rs(history_.size());
+    std::vector<Eigen::Vector3f> ts(history_.size());
+    for (size_t k = 0; k < history_.size(); k++)
+    {
+        Rs[k] = history_[k].R_sensor_world * R_world_sensor;
+        ts[k] = history_[k].R_sensor_world * t_world_sensor + history_[k].t_sensor_world;
+    }
+
+    // check the rows in parallel
+    keep_.assign(num_points, 1);
+    if (!history_.empty())
+    {
+        #pragma omp parallel for schedule(dynamic)
+        for (int r = 0; r < rows; r++)
+        {
+            for (int j = row_start_[r]; j < row_start_[r + 1]; j++)
+            {
+                const int i = row_points_[j];
+                keep_[i] = isConsistent(Eigen::Vector3f(xs_[i], ys_[i], zs_[i]), Rs, ts);
+            }
+        }
+    }
+
+    // copy the kept points
+    cloud_out.header = cloud_in.header;
+    cloud_out.fields = cloud_in.fields;
+    cloud_out.is_bigendian = cloud_in.is_bigendian;
+    cloud_out.point_step = point_step;
+    cloud_out.is_dense = cloud_in.is_dense;
+    cloud_out.data.resize(num_points * point_step);
+    uint8_t* out = cloud_out.data.data();
+    for (size_t i = 0; i < num_points; i++)
+    {
+        if (!keep_[i]) continue;
+        memcpy(out, cloud_in.data.data() + (i / cloud_in.width) * cloud_in.row_step + (i % cloud_in.width) * point_step, point_step);
+        out += point_step;
+    }
+    cloud_out.data.resize(out - cloud_out.data.data());
+    cloud_out.height = 1;
+    cloud_out.width = cloud_out.data.size() / std::max(point_step, 1u);
+    cloud_out.row_step = cloud_out.data.size();
+
+    // store the range image of the scan
+    image.R_sensor_world = R_world_sensor.transpose();
+    image.t_sensor_world = -(image.R_sensor_world * t_world_sensor);
+    history_.push_back(std::move(image));
+    while ((int)history_.size() > params_.num_scans_) history_.pop_front();
+
+    return true;
+}
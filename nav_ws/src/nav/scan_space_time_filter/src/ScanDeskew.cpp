@@ -0,0 +1,388 @@
+/**
+* This file is part of the ROS package scan_space_time_filter which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ScanDeskew.h"
+
+#include <string.h>
+#include <limits>
+#include <algorithm>
+
+#include <arpa/inet.h>
+
+#include <boost/make_shared.hpp>
+
+
+const int    ScanDeskew::kMinPoseSamples = 2;
+const double ScanDeskew::kImuMaxGap = 0.02; // [s]
+
+
+namespace
+{
+
+inline float readFloat(const uint8_t* p)
+{
+    float v;
+    memcpy(&v, p, sizeof(float)); // unaligned load
+    return v;
+}
+
+inline void writeFloat(uint8_t* p, float v)
+{
+    memcpy(p, &v, sizeof(float));
+}
+
+// time of the point [s] w.r.t. the cloud stamp
+inline float readTime(const uint8_t* p, uint8_t datatype)
+{
+    switch (datatype)
+    {
+    case sensor_msgs::PointField::UINT32:
+        {
+            uint32_t t; // [ns] (Ouster)
+            memcpy(&t, p, sizeof(uint32_t));
+            return t*1e-9f;
+        }
+    case sensor_msgs::PointField::FLOAT64:
+        {
+            double t; // [s]
+            memcpy(&t, p, sizeof(double));
+            return (float)t;
+        }
+    default:
+        return readFloat(p); // [s] (Velodyne)
+    }
+}
+
+}
+
+
+ScanDeskew::ScanDeskew(const ros::NodeHandle &nh, const ros::NodeHandle &nh_private):
+nh_(nh), nh_private_(nh_private),
+point_step_(0), x_offset_(0), y_offset_(4), z_offset_(8), time_offset_(0), time_datatype_(0), b_layout_valid_(false),
+b_q_sensor_imu_valid_(false)
+{
+    setParams();
+    p_tf_listener_ = boost::make_shared<tf::TransformListener>(ros::Duration(params_.tf_cache_length_));
+    setPubsAndSubs();
+}
+
+bool ScanDeskew::setParams()
+{
+    nh_private_.param("odom_frame", params_.odomFrame_, params_.odomFrame_);
+    nh_private_.param("num_pose_samples", params_.num_pose_samples_, params_.num_pose_samples_);
+    nh_private_.param("max_scan_duration", params_.max_scan_duration_, params_.max_scan_duration_);
+    nh_private_.param("tf_wait_timeout", params_.tf_wait_timeout_, params_.tf_wait_timeout_);
+    nh_private_.param("tf_cache_length", params_.tf_cache_length_, params_.tf_cache_length_);
+    nh_private_.param("use_imu", params_.use_imu_, params_.use_imu_);
+    nh_private_.param("imu_buffer_length", params_.imu_buffer_length_, params_.imu_buffer_length_);
+
+    params_.num_pose_samples_ = std::max(params_.num_pose_samples_, kMinPoseSamples);
+
+    ROS_INFO_STREAM("ScanDeskew - odom frame: " << params_.odomFrame_ << ", pose samples: " << params_.num_pose_samples_
+                    << ", use imu: " << (int)params_.use_imu_);
+    return true;
+}
+
+void ScanDeskew::setPubsAndSubs()
+{
+    cloud_pub_ = nh_.advertise<sensor_msgs::PointCloud2>("deskewed_pointcloud", 1);
+    cloud_sub_ = nh_.subscribe("input_pointcloud", 1, &ScanDeskew::cloudCallback, this);
+    if (params_.use_imu_)
+    {
+        imu_sub_ = nh_.subscribe("imu", 200, &ScanDeskew::imuCallback, this);
+    }
+}
+
+void ScanDeskew::imuCallback(const sensor_msgs::Imu::ConstPtr& imu)
+{
+    ImuSample sample;
+    sample.stamp = imu->header.stamp;
+    sample.angular_velocity = tf::Vector3(imu->angular_velocity.x, imu->angular_velocity.y, imu->angular_velocity.z);
+
+    boost::mutex::scoped_lock locker(imu_mutex_);
+    if (!imu_buffer_.empty() && (sample.stamp <= imu_buffer_.back().stamp)) return; /// < EXIT POINT (out of order)
+    imu_frame_ = imu->header.frame_id;
+    imu_buffer_.push_back(sample);
+    while (!imu_buffer_.empty() && ((sample.stamp - imu_buffer_.front().stamp).toSec() > params_.imu_buffer_length_))
+    {
+        imu_buffer_.pop_front();
+    }
+}
+
+void ScanDeskew::cloudCallback(const sensor_msgs::PointCloud2::ConstPtr& cloud)
+{
+    if (cloud_pub_.getNumSubscribers() == 0) return; /// < EXIT POINT
+
+    sensor_msgs::PointCloud2Ptr cloud_out(new sensor_msgs::PointCloud2);
+    if (!deskew(*cloud, *cloud_out))
+    {
+        cloud_pub_.publish(cloud); // forward the input cloud as it is
+        return; /// < EXIT POINT
+    }
+    cloud_pub_.publish(cloud_out);
+}
+
+bool ScanDeskew::updateLayout(const sensor_msgs::PointCloud2& cloud)
+{
+    if (b_layout_valid_ && (cloud.point_step == point_step_) && (cloud.fields.size() == fields_.size()))
+    {
+        bool b_same = true;
+        for (size_t j = 0; j < fields_.size() && b_same; j++)
+        {
+            b_same = (cloud.fields[j].offset == fields_[j].offset) && (cloud.fields[j].datatype == fields_[j].datatype) && (cloud.fields[j].name == fields_[j].name);
+        }
+        if (b_same) return true; /// < EXIT POINT
+    }
+
+    fields_ = cloud.fields;
+    point_step_ = cloud.point_step;
+    int num_xyz_fields = 0;
+    bool b_time_field = false;
+    for (size_t j = 0; j < fields_.size(); j++)
+    {
+        const sensor_msgs::PointField& field = fields_[j];
+        const bool b_float = (field.datatype == sensor_msgs::PointField::FLOAT32);
+        if ((field.name == "x") && b_float) { x_offset_ = field.offset; num_xyz_fields++; }
+        else if ((field.name == "y") && b_float) { y_offset_ = field.offset; num_xyz_fields++; }
+        else if ((field.name == "z") && b_float) { z_offset_ = field.offset; num_xyz_fields++; }
+        else if ((field.name == "t") || (field.name == "time"))
+        {
+            if ((field.datatype == sensor_msgs::PointField::UINT32) ||
+                (field.datatype == sensor_msgs::PointField::FLOAT32) ||
+                (field.datatype == sensor_msgs::PointField::FLOAT64))
+            {
+                time_offset_ = field.offset;
+                time_datatype_ = field.datatype;
+                b_time_field = true;
+            }
+        }
+    }
+    const bool b_host_big_endian = (htonl(1) == 1);
+    b_layout_valid_ = (num_xyz_fields == 3) && b_time_field && (point_step_ > 0) && (bool(cloud.is_bigendian) == b_host_big_endian);
+    if (!b_layout_valid_)
+    {
+        ROS_WARN_STREAM_THROTTLE(5, "ScanDeskew - unsupported cloud layout: float32 x, y, z and a per-point time field (t, time) are required");
+    }
+    return b_layout_valid_;
+}
+
+bool ScanDeskew::lookupSensorPose(const std::string& sensor_frame, const ros::Time& time, double timeout, tf::StampedTransform& pose)
+{
+    try
+    {
+        if (!p_tf_listener_->waitForTransform(params_.odomFrame_, sensor_frame, time, ros::Duration(timeout)))
+        {
+            return false; /// < EXIT POINT
+        }
+        p_tf_listener_->lookupTransform(params_.odomFrame_, sensor_frame, time, pose);
+    }
+    catch (tf::TransformException &ex)
+    {
+        ROS_WARN_STREAM_THROTTLE(5, "ScanDeskew - " << ex.what());
+        return false; /// < EXIT POINT
+    }
+    return true;
+}
+
+bool ScanDeskew::integrateImu(const std::string& sensor_frame, const ros::Time& start_time, double sample_period, int num_samples, std::vector<tf::Quaternion>& rotations)
+{
+    std::vector<ImuSample> samples;
+    std::string imu_frame;
+    {
+        boost::mutex::scoped_lock locker(imu_mutex_);
+        samples.assign(imu_buffer_.begin(), imu_buffer_.end());
+        imu_frame = imu_frame_;
+    }
+    if (samples.empty()) return false; /// < EXIT POINT
+
+    const double t0 = start_time.toSec();
+    const double t_end = t0 + sample_period*(num_samples - 1);
+    if ((samples.front().stamp.toSec() > t0 + kImuMaxGap) || (samples.back().stamp.toSec() < t_end - kImuMaxGap)) return false; /// < EXIT POINT
+
+    // the IMU is rigidly mounted: its rotation w.r.t. the sensor is looked up once
+    if (!b_q_sensor_imu_valid_ || (imu_sensor_frame_ != sensor_frame))
+    {
+        tf::StampedTransform sensor_T_imu;
+        try
+        {
+            p_tf_listener_->lookupTransform(sensor_frame, imu_frame, ros::Time(0), sensor_T_imu);
+        }
+        catch (tf::TransformException &ex)
+        {
+            ROS_WARN_STREAM_THROTTLE(5, "ScanDeskew - " << ex.what());
+            return false; /// < EXIT POINT
+        }
+        q_sensor_imu_ = sensor_T_imu.getRotation();
+        imu_sensor_frame_ = sensor_frame;
+        b_q_sensor_imu_valid_ = true;
+    }
+    const tf::Matrix3x3 R_sensor_imu(q_sensor_imu_);
+
+    // zero-order hold of the angular velocity
+    size_t j = 0; // active IMU sample
+    while ((j + 1 < samples.size()) && (samples[j + 1].stamp.toSec() <= t0)) j++;
+
+    rotations.resize(num_samples);
+    tf::Quaternion q = tf::Quaternion::getIdentity();
+    double t = t0;
+    for (int k = 0; k < num_samples; k++)
+    {
+        const double target = t0 + k*sample_period;
+        while (t < target)
+        {
+            const bool b_next = (j + 1 < samples.size()) && (samples[j + 1].stamp.toSec() < target);
+            const double t_next = b_next ? samples[j + 1].stamp.toSec() : target;
+            const tf::Vector3 w = R_sensor_imu * samples[j].angular_velocity; // in the sensor frame
+            const double angle = w.length()*(t_next - t);
+            if (angle > std::numeric_limits<double>::epsilon())
+            {
+                q *= tf::Quaternion(w.normalized(), angle); // body-frame increment
+            }
+            t = t_next;
+            if (b_next) j++;
+        }
+        rotations[k] = q;
+    }
+    return true;
+}
+
+bool ScanDeskew::deskew(const sensor_msgs::PointCloud2& cloud_in, sensor_msgs::PointCloud2& cloud_out)
+{
+    if (!updateLayout(cloud_in)) return false; /// < EXIT POINT
+
+    const int num_points = std::min<size_t>(cloud_in.width*cloud_in.height, cloud_in.data.size()/point_step_);
+    if (num_points == 0) return false; /// < EXIT POINT
+
+    /// < deinterleave x, y, z and time into the SoA buffers
+    xs_.resize(num_points);
+    ys_.resize(num_points);
+    zs_.resize(num_points);
+    ts_.resize(num_points);
+    float* xs = xs_.data();
+    float* ys = ys_.data();
+    float* zs = zs_.data();
+    float* ts = ts_.data();
+    const uint8_t* data_in = cloud_in.data.data();
+    const uint32_t point_step = point_step_;
+    const uint32_t x_offset = x_offset_, y_offset = y_offset_, z_offset = z_offset_, time_offset = time_offset_;
+    const uint8_t time_datatype = time_datatype_;
+
+    float t_min = std::numeric_limits<float>::max();
+    float t_max = -std::numeric_limits<float>::max();
+    #pragma omp parallel for reduction(min:t_min) reduction(max:t_max)
+    for (int i = 0; i < num_points; i++)
+    {
+        const uint8_t* p = data_in + (size_t)i*point_step;
+        xs[i] = readFloat(p + x_offset);
+        ys[i] = readFloat(p + y_offset);
+        zs[i] = readFloat(p + z_offset);
+        ts[i] = readTime(p + time_offset, time_datatype);
+        t_min = std::min(t_min, ts[i]);
+        t_max = std::max(t_max, ts[i]);
+    }
+
+    const double scan_duration = t_max - t_min;
+    if (!(scan_duration > 0) || (scan_duration > params_.max_scan_duration_))
+    {
+        ROS_WARN_STREAM_THROTTLE(5, "ScanDeskew - scan duration " << scan_duration << " s out of range");
+        return false; /// < EXIT POINT
+    }
+
+    /// < sensor poses at the scan boundaries and at the scan stamp (reference frame of the output cloud)
+    const std::string& sensor_frame = cloud_in.header.frame_id;
+    const ros::Time start_time = cloud_in.header.stamp + ros::Duration(t_min);
+    const ros::Time end_time = cloud_in.header.stamp + ros::Duration(t_max);
+    tf::StampedTransform start_pose, end_pose, ref_pose;
+    if (!lookupSensorPose(sensor_frame, end_time, params_.tf_wait_timeout_, end_pose) ||
+        !lookupSensorPose(sensor_frame, start_time, 0., start_pose) ||
+        !lookupSensorPose(sensor_frame, cloud_in.header.stamp, 0., ref_pose))
+    {
+        ROS_WARN_STREAM_THROTTLE(5, "ScanDeskew - cannot get the sensor poses over the scan");
+        return false; /// < EXIT POINT
+    }
+
+    /// < pose samples: T_ref^-1 * T(t_k)
+    const int num_samples = params_.num_pose_samples_;
+    const double sample_period = scan_duration/(num_samples - 1);
+    const bool b_imu = params_.use_imu_ && integrateImu(sensor_frame, start_time, sample_period, num_samples, sample_rotations_);
+
+    const tf::Transform ref_pose_inverse = ref_pose.inverse();
+    const tf::Quaternion q_start = start_pose.getRotation();
+    const tf::Quaternion q_end = end_pose.getRotation();
+    sample_transforms_.resize(12*num_samples);
+    for (int k = 0; k < num_samples; k++)
+    {
+        const double s = double(k)/(num_samples - 1);
+        const tf::Quaternion q = b_imu ? q_start*sample_rotations_[k] : q_start.slerp(q_end, s);
+        const tf::Transform sample_pose(q, start_pose.getOrigin().lerp(end_pose.getOrigin(), s));
+        const tf::Transform T = ref_pose_inverse*sample_pose;
+        const tf::Matrix3x3& R = T.getBasis();
+        const tf::Vector3& t = T.getOrigin();
+        float* m = &sample_transforms_[12*k];
+        for (int r = 0; r < 3; r++)
+        {
+            m[4*r + 0] = R[r][0];
+            m[4*r + 1] = R[r][1];
+            m[4*r + 2] = R[r][2];
+            m[4*r + 3] = t[r];
+        }
+    }
+
+    /// < transform the points (SoA, vectorized and parallel)
+    const float* transforms = sample_transforms_.data();
+    const float inv_sample_period = 1./sample_period;
+    const int last_sample = num_samples - 1;
+    #pragma omp parallel for simd
+    for (int i = 0; i < num_points; i++)
+    {
+        const int k = std::min(std::max(int((ts[i] - t_min)*inv_sample_period + 0.5f), 0), last_sample);
+        const float* m = transforms + 12*k;
+        const float x = xs[i], y = ys[i], z = zs[i];
+        const bool b_valid = (x != 0.f) | (y != 0.f) | (z != 0.f); // no-return points (at the origin) of organized clouds are kept as they are
+        const float xo = m[0]*x + m[1]*y + m[2]*z + m[3];
+        const float yo = m[4]*x + m[5]*y + m[6]*z + m[7];
+        const float zo = m[8]*x + m[9]*y + m[10]*z + m[11];
+        xs[i] = b_valid ? xo : x;
+        ys[i] = b_valid ? yo : y;
+        zs[i] = b_valid ? zo : z;
+    }
+
+    /// < interleave into the output cloud (the other fields are copied as they are)
+    cloud_out.header = cloud_in.header;
+    cloud_out.height = cloud_in.height;
+    cloud_out.width = cloud_in.width;
+    cloud_out.fields = cloud_in.fields;
+    cloud_out.is_bigendian = cloud_in.is_bigendian;
+    cloud_out.point_step = cloud_in.point_step;
+    cloud_out.row_step = cloud_in.row_step;
+    cloud_out.is_dense = cloud_in.is_dense;
+    cloud_out.data = cloud_in.data;
+    uint8_t* data_out = cloud_out.data.data();
+    #pragma omp parallel for
+    for (int i = 0; i < num_points; i++)
+    {
+        uint8_t* p = data_out + (size_t)i*point_step;
+        writeFloat(p + x_offset, xs[i]);
+        writeFloat(p + y_offset, ys[i]);
+        writeFloat(p + z_offset, zs[i]);
+    }
+
+    return true;
+}
@@ -77,8 +77,11 @@ SpaceTimeFilter::~SpaceTimeFilter()
     std::cout << "SpaceTimeFilter::~SpaceTimeFilter() - end " << std::endl;
 }
 
-void SpaceTimeFilter::processPointcloudWithTf(const sensor_msgs::PointCloud2::ConstPtr &pointcloud)
+void SpaceTimeFilter::processPointcloudWithTf(const sensor_msgs::PointCloud2::ConstPtr &pointcloud_in)
 {
+    // all the scans go through the consistency filter, which keeps the range images of the last ones
+    const sensor_msgs::PointCloud2::ConstPtr pointcloud = filterConsistency(pointcloud_in);
+
     //std::cout << "SpaceTimeFilter::processPointcloudWithTf() - start " << std::endl;
     if(insertPointCloud(pointcloud))
     {
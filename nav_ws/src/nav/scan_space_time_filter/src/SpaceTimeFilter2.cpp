@@ -98,8 +98,9 @@ void SpaceTimeFilter2::setPubsAndSubs()
     pointcloud_sub2_ = nh_.subscribe("dynamic_point_cloud2", 1, &SpaceTimeFilter2::processPointcloudWithTf2, this);
 }
 
-void SpaceTimeFilter2::processPointcloudWithTf1(const sensor_msgs::PointCloud2::ConstPtr &pointcloud)
+void SpaceTimeFilter2::processPointcloudWithTf1(const sensor_msgs::PointCloud2::ConstPtr &pointcloud_in)
 {
+    const sensor_msgs::PointCloud2::ConstPtr pointcloud = pFilter1_->filterConsistency(pointcloud_in);
     //std::cout << "SpaceTimeFilter2::processPointcloudWithTf1() - start " << std::endl;
     if(pFilter1_->insertPointCloud(pointcloud))
     {
@@ -112,8 +113,9 @@ void SpaceTimeFilter2::processPointcloudWithTf1(const sensor_msgs::PointCloud2::
     //std::cout << "SpaceTimeFilter2::processPointcloudWithTf1() - end " << std::endl;
 }
 
-void SpaceTimeFilter2::processPointcloudWithTf2(const sensor_msgs::PointCloud2::ConstPtr &pointcloud)
+void SpaceTimeFilter2::processPointcloudWithTf2(const sensor_msgs::PointCloud2::ConstPtr &pointcloud_in)
 {
+    const sensor_msgs::PointCloud2::ConstPtr pointcloud = pFilter2_->filterConsistency(pointcloud_in);
     //std::cout << "SpaceTimeFilter2::processPointcloudWithTf2() - start " << std::endl;
     if(pFilter2_->insertPointCloud(pointcloud))
     {
@@ -0,0 +1,40 @@
+/**
+* This file is part of the ROS package scan_space_time_filter which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <ScanDeskew.h>
+
+
+int main(int argc, char** argv)
+{
+    ros::init(argc, argv, "scan_deskew");
+
+    ros::NodeHandle nh;
+    ros::NodeHandle nh_private("~");
+
+    ROS_INFO_STREAM("==========================================================");
+    ROS_INFO_STREAM("scan deskew node alive");
+    ROS_INFO_STREAM("==========================================================");
+
+    ScanDeskew scan_deskew(nh, nh_private);
+
+    ros::spin();
+
+    return 0;
+}
@@ -0,0 +1,55 @@
+/**
+* This file is part of the ROS package scan_space_time_filter which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <memory>
+
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+
+#include <ScanDeskew.h>
+
+namespace scan_space_time_filter
+{
+
+///	\class ScanDeskewNodelet
+///	\author Luigi Freda
+///	\brief Nodelet version of scan_deskew_node: loaded in the same manager of the lidar driver and of the scan filter,
+///        the clouds are passed by pointer.
+///	\note
+/// \todo
+///	\date
+///	\warning
+class ScanDeskewNodelet : public nodelet::Nodelet
+{
+public:
+    ScanDeskewNodelet() {}
+
+private:
+    virtual void onInit()
+    {
+        scan_deskew_.reset(new ScanDeskew(getNodeHandle(), getPrivateNodeHandle()));
+    }
+
+    std::unique_ptr<ScanDeskew> scan_deskew_;
+};
+
+} // namespace scan_space_time_filter
+
+PLUGINLIB_EXPORT_CLASS(scan_space_time_filter::ScanDeskewNodelet, nodelet::Nodelet)
@@ -0,0 +1,131 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2017-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <stdint.h>
+
+#include <ros/ros.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <costmap_converter/ObstacleArrayMsg.h>
+#include <tf/transform_listener.h>
+
+#include <Eigen/Core>
+
+
+namespace teb_local_planner
+{
+
+///	\class CloudObstacleConverter
+///	\author Luigi Freda
+///	\brief Converts a dense 3D obstacle point cloud (e.g. the obstacle cloud of laser_proximity_checker or the
+///        clearance points of the traversability) into a compact set of TEB obstacles.
+///        The points are cropped in a local 2D window around the robot, projected on the ground plane,
+///        downsampled on a 2D grid (in the global frame) and clustered. Each cluster is published as a
+///        point, line or convex polygon obstacle in a costmap_converter::ObstacleArrayMsg
+///        (the input of TebOptimLocalPlannerServer::customObstacleCB()).
+///	\note big or non-linear clusters are split along their principal axis until each part is either a thin line
+///       or a polygon smaller than max_polygon_size (this bounds the free space covered by the convex hulls)
+///	\date
+///	\warning
+class CloudObstacleConverter
+{
+public:
+
+    struct Params
+    {
+        double window_size = 4.0;        // half side of the local window around the robot [m]
+        double min_z = -0.3;             // height band (in the robot frame) of the points to be considered [m]
+        double max_z = 1.5;
+        double leaf_size = 0.1;          // side of the 2D downsampling grid cells [m]
+        double cluster_tolerance = 0.2;  // max distance between two cells of the same cluster [m]
+        int min_cluster_size = 1;        // min number of cells of a cluster (smaller clusters are dropped as outliers)
+        double line_max_width = 0.2;     // a cluster thinner than this is converted into a line obstacle [m]
+        double max_polygon_size = 1.0;   // bigger clusters are split [m]
+    };
+
+    typedef std::vector<Eigen::Vector2d, Eigen::aligned_allocator<Eigen::Vector2d> > Points2d;
+
+public:
+
+    CloudObstacleConverter();
+
+    // read the params and set the subscriber/publisher
+    void init(ros::NodeHandle& nh, ros::NodeHandle& param_nh);
+
+    // read the conversion params only (for an owner that manages its own subscriber, see ObstacleBuffer)
+    void readParams(ros::NodeHandle& param_nh);
+
+    void setParams(const Params& params) { params_ = params; }
+    const Params& getParams() const { return params_; }
+
+    // convert the cloud: T_robot_cloud maps the cloud points into the robot frame, T_global_robot maps the robot frame into the output frame
+    // N.B.: msg.header must be set by the caller
+    void convert(const sensor_msgs::PointCloud2& cloud, const tf::Transform& T_robot_cloud, const tf::Transform& T_global_robot,
+                 costmap_converter::ObstacleArrayMsg& msg);
+
+    // closest cropped point of the last converted cloud (robot frame) and its planar distance from the robot origin;
+    // return false if the last cloud had no point in the local window
+    bool getClosestPoint(Eigen::Vector3d& point, double& dist) const;
+
+protected:
+
+    void cloudCallback(const sensor_msgs::PointCloud2ConstPtr& cloud_msg);
+
+    // fill the grid with the cropped and projected points
+    void buildGrid(const sensor_msgs::PointCloud2& cloud, const tf::Transform& T_robot_cloud, const tf::Transform& T_global_robot);
+
+    // extract the clusters of the occupied cells (connected components with neighborhood cluster_tolerance)
+    void extractClusters();
+
+    // add the obstacles of a cluster (recursively split if needed)
+    void addClusterObstacles(const Points2d& cluster, costmap_converter::ObstacleArrayMsg& msg);
+
+    void addObstacle(const Points2d& vertices, costmap_converter::ObstacleArrayMsg& msg);
+
+    static void computeConvexHull(Points2d& points, Points2d& hull);
+
+    static inline uint64_t cellKey(int32_t ix, int32_t iy) { return (static_cast<uint64_t>(static_cast<uint32_t>(ix)) << 32) | static_cast<uint32_t>(iy); }
+
+protected:
+
+    Params params_;
+
+    std::string global_frame_;
+    std::string robot_frame_;
+    double transform_tolerance_;
+
+    // working buffers (kept to avoid reallocations at each cloud)
+    std::unordered_map<uint64_t, int> cell_index_; // key of an occupied cell -> index in cell_coords_
+    std::vector<Eigen::Vector2i> cell_coords_;      // coordinates of the occupied cells
+    std::vector<Points2d> clusters_;                // cell centers of each cluster
+
+    Eigen::Vector3d closest_point_;                 // closest cropped point of the last cloud (robot frame)
+    double closest_dist_squared_;                   // its squared planar distance (infinity if there is none)
+
+    ros::Subscriber cloud_sub_;
+    ros::Publisher obstacles_pub_;
+    tf::TransformListener tf_listener_;
+};
+
+} // namespace teb_local_planner
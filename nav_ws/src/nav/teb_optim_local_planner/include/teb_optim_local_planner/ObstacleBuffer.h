@@ -0,0 +1,115 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2017-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <ros/ros.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <costmap_converter/ObstacleArrayMsg.h>
+#include <tf/transform_listener.h>
+
+#include <Eigen/Core>
+
+#include <teb_optim_local_planner/CloudObstacleConverter.h>
+
+
+namespace teb_local_planner
+{
+
+///	\struct ObstacleSnapshot
+///	\author Luigi Freda
+///	\brief Consistent view of the local obstacles extracted from a single obstacle cloud.
+///        Snapshots are immutable once published by ObstacleBuffer.
+struct ObstacleSnapshot
+{
+    ros::Time stamp;                 // stamp of the source cloud
+    std::string robot_frame;         // frame of the closest point
+    std::string global_frame;        // frame of the obstacles
+
+    bool has_closest_point = false;  // false if there is no obstacle point in the local window
+    Eigen::Vector3d closest_point = Eigen::Vector3d::Zero(); // closest obstacle point (robot frame)
+    double closest_dist = 0;         // planar distance of the closest point from the robot origin [m]
+
+    costmap_converter::ObstacleArrayMsgConstPtr obstacles; // down-sampled obstacle set (global frame)
+
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+typedef std::shared_ptr<const ObstacleSnapshot> ObstacleSnapshotConstPtr;
+
+
+///	\class ObstacleBuffer
+///	\author Luigi Freda
+///	\brief Shared, time-stamped local obstacle buffer: each obstacle cloud is parsed once (crop, projection, down-sampling
+///        and clustering with CloudObstacleConverter) and both the nearest-obstacle summary (for the velocity reduction of
+///        trajectory_control) and the down-sampled obstacle set (for the TEB local planner) are extracted from the same pass
+///        and published with the same stamp.
+///        In-process consumers (e.g. nodelets in the same manager) can read the last snapshot with getSnapshot(), which never
+///        blocks the producer: a new snapshot is built aside and then atomically swapped in.
+///	\note published topics (same format as laser_proximity_checker):
+///       - "obstacles" (costmap_converter::ObstacleArrayMsg, global frame)
+///       - "closest_obst_point" (std_msgs::Float32MultiArray <x,y,z,dist>, robot frame)
+///       - "closest_obst_point_stamped" (geometry_msgs::PointStamped, robot frame)
+///	\date
+///	\warning
+class ObstacleBuffer
+{
+public:
+
+    ObstacleBuffer();
+
+    // read the params and set the subscriber/publishers
+    void init(ros::NodeHandle& nh, ros::NodeHandle& param_nh);
+
+    // get the last snapshot (NULL if no cloud has been processed yet); can be called from any thread
+    ObstacleSnapshotConstPtr getSnapshot() const { return std::atomic_load(&snapshot_); }
+
+    // process a cloud and publish the resulting snapshot; return false if the transforms are not available
+    bool update(const sensor_msgs::PointCloud2& cloud);
+
+protected:
+
+    void cloudCallback(const sensor_msgs::PointCloud2ConstPtr& cloud_msg);
+
+    void publish(const ObstacleSnapshot& snapshot);
+
+protected:
+
+    CloudObstacleConverter converter_; // only accessed by the producer (the cloud callback)
+
+    ObstacleSnapshotConstPtr snapshot_; // accessed with std::atomic_load/std::atomic_store
+
+    std::string global_frame_;
+    std::string robot_frame_;
+    double transform_tolerance_;
+
+    ros::Subscriber cloud_sub_;
+    ros::Publisher obstacles_pub_;
+    ros::Publisher closest_point_pub_;
+    ros::Publisher closest_point_stamped_pub_;
+    tf::TransformListener tf_listener_;
+};
+
+} // namespace teb_local_planner
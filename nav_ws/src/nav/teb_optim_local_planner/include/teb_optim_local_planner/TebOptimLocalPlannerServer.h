@@ -366,6 +366,36 @@ protected:
                            const geometry_msgs::PoseStamped& global_pose,  /*const costmap_2d::Costmap2D& costmap,*/
                            const std::string& global_frame, double max_plan_length, std::vector<geometry_msgs::PoseStamped>& transformed_plan,
                            int* current_goal_idx = NULL, geometry_msgs::TransformStamped* tf_plan_to_global = NULL);
+
+  /**
+    * @brief Look up the transformation from the frame of the global plan to the global planning frame and update the plan cache.
+    * 
+    * The poses of the plan already transformed (see transformGlobalPlan()) are kept as long as the new transformation
+    * does not differ from the cached one by more than the translation/rotation thresholds (e.g. small map->odom corrections).
+    * If the lookup fails, the last valid transformation (if any) is kept.
+    * @param global_plan The global plan
+    * @param global_frame The global planning frame
+    * @return \c true if a valid transformation is available in the cache, \c false otherwise
+    */
+  bool updateGlobalPlanTransform(const std::vector<geometry_msgs::PoseStamped>& global_plan, const std::string& global_frame);
+
+  /**
+    * @brief Get the pose of the robot in the frame of the global plan (uses the cached transformation whenever possible).
+    * @param global_plan The global plan
+    * @param global_pose The global pose of the robot
+    * @param[out] robot_pose The pose of the robot in the frame of the global plan
+    * @return \c true if the pose is transformed, \c false otherwise
+    */
+  bool getRobotPoseInPlanFrame(const std::vector<geometry_msgs::PoseStamped>& global_plan, const geometry_msgs::PoseStamped& global_pose,
+                               geometry_msgs::PoseStamped& robot_pose);
+
+  /**
+    * @brief Get the pose \c idx of the global plan transformed into the global planning frame (lazily computed and cached).
+    * @param global_plan The global plan
+    * @param idx Index of the pose in the global plan
+    * @return The transformed pose
+    */
+  const geometry_msgs::PoseStamped& getTransformedGlobalPlanPose(const std::vector<geometry_msgs::PoseStamped>& global_plan, int idx);
     
   /**
     * @brief Estimate the orientation of a pose from the global_plan that is treated as a local goal for the local planner.
@@ -463,6 +493,7 @@ private:
   PlannerInterfacePtr planner_; //!< Instance of the underlying optimal planner class
   ObstContainer obstacles_; //!< Obstacle vector that should be considered during local trajectory optimization
   std::vector<ros::Time> obstacles_stamps_; 
+  ObstacleGridIndex obstacle_index_; //!< Spatial index over obstacles_ (rebuilt after each update of the container)
   ViaPointContainer via_points_; //!< Container of via-points that should be considered during local trajectory optimization
   TebVisualizationPtr visualization_; //!< Instance of the visualization class (local/global plan, obstacles, ...)
   //boost::shared_ptr<base_local_planner::CostmapModel> costmap_model_;  
@@ -470,6 +501,21 @@ private:
   FailureDetector failure_detector_; //!< Detect if the robot got stucked
   
   std::vector<geometry_msgs::PoseStamped> global_plan_; //!< Store the current global plan
+
+  /// Cache of the global plan transformed into the global planning frame (see updateGlobalPlanTransform() and transformGlobalPlan())
+  struct GlobalPlanCache
+  {
+    bool has_transform = false; //!< Keeps track whether plan_to_global is valid
+    std::string plan_frame; //!< Frame of the global plan
+    std::string global_frame; //!< Global planning frame
+    tf::StampedTransform plan_to_global; //!< Transformation used for the cached poses
+    geometry_msgs::TransformStamped plan_to_global_msg; //!< Same as plan_to_global
+    std::vector<geometry_msgs::PoseStamped> poses; //!< poses[k] is the k-th pose of the global plan transformed into the global frame (lazily extended)
+    int closest_idx = -1; //!< Index of the plan pose closest to the robot found in the last cycle (-1 if unknown)
+
+    void reset() { has_transform = false; poses.clear(); closest_idx = -1; }
+  };
+  GlobalPlanCache plan_cache_; //!< Store the transformed global plan across the control cycles
   
   base_local_planner::OdometryHelperRos odom_helper_; //!< Provides an interface to receive the current velocity from the robot
   
@@ -480,6 +526,10 @@ private:
   ros::Subscriber custom_obst_sub_; //!< Subscriber for custom obstacles received via a ObstacleMsg.
   boost::mutex custom_obst_mutex_; //!< Mutex that locks the obstacle array (multi-threaded)
   costmap_converter::ObstacleArrayMsg custom_obstacle_msg_; //!< Copy of the most recent obstacle message
+  ObstContainer custom_obstacles_cache_; //!< Obstacles of custom_obstacle_msg_ transformed into the global frame
+  std::vector<ros::Time> custom_obstacles_cache_stamps_; //!< Stamps of the obstacles in custom_obstacles_cache_
+  std_msgs::Header custom_obstacles_cache_header_; //!< Header of the message custom_obstacles_cache_ refers to
+  bool custom_obstacles_cache_valid_ = false; //!< Keeps track whether custom_obstacles_cache_ is valid
 
   ros::Subscriber via_points_sub_; //!< Subscriber for custom via-points received via a Path msg.
   bool custom_via_points_active_; //!< Keep track whether valid via-points have been received from via_points_sub_
@@ -523,6 +573,9 @@ private:
   geometry_msgs::Twist last_cmd_twist_;
 
   double transform_tolerance_ = 0.2; // [s] time tolerance for waiting a transform  
+  double plan_tf_cache_translation_threshold_ = 0.005; // [m] the cached transformed plan is recomputed when the plan-to-global transform moves more than this
+  double plan_tf_cache_rotation_threshold_ = 0.002; // [rad] the cached transformed plan is recomputed when the plan-to-global transform rotates more than this
+  double global_plan_search_dist_ = 3.0; // [m] the pose of the plan closest to the robot is searched up to this distance (along the plan) after the last one found (if <=0: whole plan)
   bool use_proportional_saturation_ = false; // If true, reduce all twists components (linear x and y, and angular z) proportionally if any exceed its corresponding bounds, instead of saturating each one individually
 
   double tracks_distance_; // only used for transforming the twist into left-right velocity commands
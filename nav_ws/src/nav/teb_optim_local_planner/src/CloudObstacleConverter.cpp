@@ -0,0 +1,344 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2017-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <teb_optim_local_planner/CloudObstacleConverter.h>
+
+#include <sensor_msgs/point_cloud2_iterator.h>
+
+#include <Eigen/Eigenvalues>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+namespace
+{
+  template<typename T>
+  T getParam(ros::NodeHandle& n, const std::string& name, const T& defaultValue)
+  {
+      T v;
+      if (n.getParam(name, v))
+      {
+          ROS_INFO_STREAM("Found parameter: " << name << ", value: " << v);
+          return v;
+      }
+      else
+      {
+          ROS_WARN_STREAM("Cannot find value for parameter: " << name << ", assigning default: " << defaultValue);
+      }
+      return defaultValue;
+  }
+
+  inline double cross2d(const Eigen::Vector2d& o, const Eigen::Vector2d& a, const Eigen::Vector2d& b)
+  {
+      return (a.x() - o.x()) * (b.y() - o.y()) - (a.y() - o.y()) * (b.x() - o.x());
+  }
+}
+
+namespace teb_local_planner
+{
+
+CloudObstacleConverter::CloudObstacleConverter(): closest_point_(Eigen::Vector3d::Zero()), closest_dist_squared_(std::numeric_limits<double>::infinity()), transform_tolerance_(0.2)
+{
+}
+
+void CloudObstacleConverter::init(ros::NodeHandle& nh, ros::NodeHandle& param_nh)
+{
+    global_frame_ = getParam<std::string>(param_nh, "global_frame", "map");
+    robot_frame_ = getParam<std::string>(param_nh, "robot_base_frame", "base_link");
+    transform_tolerance_ = getParam<double>(param_nh, "transform_tolerance", 0.2);
+
+    readParams(param_nh);
+
+    obstacles_pub_ = nh.advertise<costmap_converter::ObstacleArrayMsg>("obstacles", 1);
+    cloud_sub_ = nh.subscribe("obstacle_cloud", 1, &CloudObstacleConverter::cloudCallback, this);
+}
+
+void CloudObstacleConverter::readParams(ros::NodeHandle& param_nh)
+{
+    params_.window_size = getParam<double>(param_nh, "window_size", params_.window_size);
+    params_.min_z = getParam<double>(param_nh, "min_z", params_.min_z);
+    params_.max_z = getParam<double>(param_nh, "max_z", params_.max_z);
+    params_.leaf_size = getParam<double>(param_nh, "leaf_size", params_.leaf_size);
+    params_.cluster_tolerance = getParam<double>(param_nh, "cluster_tolerance", params_.cluster_tolerance);
+    params_.min_cluster_size = getParam<int>(param_nh, "min_cluster_size", params_.min_cluster_size);
+    params_.line_max_width = getParam<double>(param_nh, "line_max_width", params_.line_max_width);
+    params_.max_polygon_size = getParam<double>(param_nh, "max_polygon_size", params_.max_polygon_size);
+
+    if(params_.leaf_size <= 0)
+    {
+        ROS_WARN("CloudObstacleConverter: leaf_size must be positive, using 0.1");
+        params_.leaf_size = 0.1;
+    }
+}
+
+void CloudObstacleConverter::cloudCallback(const sensor_msgs::PointCloud2ConstPtr& cloud_msg)
+{
+    if(obstacles_pub_.getNumSubscribers() == 0) return; /// < EXIT POINT
+
+    tf::StampedTransform T_robot_cloud;
+    tf::StampedTransform T_global_robot;
+    try
+    {
+        if( !tf_listener_.waitForTransform(global_frame_, robot_frame_, cloud_msg->header.stamp, ros::Duration(transform_tolerance_)) ||
+            !tf_listener_.waitForTransform(robot_frame_, cloud_msg->header.frame_id, cloud_msg->header.stamp, ros::Duration(transform_tolerance_)) )
+        {
+            ROS_WARN_STREAM("CloudObstacleConverter: cannot get the transforms at time " << cloud_msg->header.stamp);
+            return; /// < EXIT POINT
+        }
+        tf_listener_.lookupTransform(robot_frame_, cloud_msg->header.frame_id, cloud_msg->header.stamp, T_robot_cloud);
+        tf_listener_.lookupTransform(global_frame_, robot_frame_, cloud_msg->header.stamp, T_global_robot);
+    }
+    catch(tf::TransformException& ex)
+    {
+        ROS_ERROR("CloudObstacleConverter: %s", ex.what());
+        return; /// < EXIT POINT
+    }
+
+    costmap_converter::ObstacleArrayMsg obstacles_msg;
+    obstacles_msg.header.stamp = cloud_msg->header.stamp;
+    obstacles_msg.header.frame_id = global_frame_;
+    convert(*cloud_msg, T_robot_cloud, T_global_robot, obstacles_msg);
+
+    obstacles_pub_.publish(obstacles_msg);
+}
+
+void CloudObstacleConverter::convert(const sensor_msgs::PointCloud2& cloud, const tf::Transform& T_robot_cloud, const tf::Transform& T_global_robot,
+                                     costmap_converter::ObstacleArrayMsg& msg)
+{
+    msg.obstacles.clear();
+
+    buildGrid(cloud, T_robot_cloud, T_global_robot);
+    extractClusters();
+
+    for(size_t i = 0; i < clusters_.size(); i++)
+    {
+        if((int)clusters_[i].size() < params_.min_cluster_size) continue;
+        addClusterObstacles(clusters_[i], msg);
+    }
+}
+
+bool CloudObstacleConverter::getClosestPoint(Eigen::Vector3d& point, double& dist) const
+{
+    if(!std::isfinite(closest_dist_squared_)) return false; /// < EXIT POINT
+
+    point = closest_point_;
+    dist = std::sqrt(closest_dist_squared_);
+    return true;
+}
+
+void CloudObstacleConverter::buildGrid(const sensor_msgs::PointCloud2& cloud, const tf::Transform& T_robot_cloud, const tf::Transform& T_global_robot)
+{
+    cell_index_.clear();
+    cell_coords_.clear();
+    closest_dist_squared_ = std::numeric_limits<double>::infinity();
+
+    if(cloud.width * cloud.height == 0) return; /// < EXIT POINT
+
+    const double inv_leaf_size = 1./params_.leaf_size;
+
+    sensor_msgs::PointCloud2ConstIterator<float> iter_x(cloud, "x");
+    sensor_msgs::PointCloud2ConstIterator<float> iter_y(cloud, "y");
+    sensor_msgs::PointCloud2ConstIterator<float> iter_z(cloud, "z");
+    for(; iter_x != iter_x.end(); ++iter_x, ++iter_y, ++iter_z)
+    {
+        if(!std::isfinite(*iter_x) || !std::isfinite(*iter_y) || !std::isfinite(*iter_z)) continue;
+
+        // crop in the robot frame
+        const tf::Vector3 p_robot = T_robot_cloud * tf::Vector3(*iter_x, *iter_y, *iter_z);
+        if(p_robot.z() < params_.min_z || p_robot.z() > params_.max_z) continue;
+        if(std::fabs(p_robot.x()) > params_.window_size || std::fabs(p_robot.y()) > params_.window_size) continue;
+
+        // track the closest point (this comes for free with the crop, see ObstacleBuffer)
+        const double dist_squared = p_robot.x()*p_robot.x() + p_robot.y()*p_robot.y();
+        if(dist_squared < closest_dist_squared_)
+        {
+            closest_dist_squared_ = dist_squared;
+            closest_point_ = Eigen::Vector3d(p_robot.x(), p_robot.y(), p_robot.z());
+        }
+
+        // project and downsample in the global frame (the cells do not move with the robot)
+        const tf::Vector3 p_global = T_global_robot * p_robot;
+        const int32_t ix = static_cast<int32_t>(std::floor(p_global.x() * inv_leaf_size));
+        const int32_t iy = static_cast<int32_t>(std::floor(p_global.y() * inv_leaf_size));
+        if(cell_index_.emplace(cellKey(ix, iy), (int)cell_coords_.size()).second)
+        {
+            cell_coords_.push_back(Eigen::Vector2i(ix, iy));
+        }
+    }
+}
+
+void CloudObstacleConverter::extractClusters()
+{
+    clusters_.clear();
+
+    const int radius = std::max(1, (int)std::ceil(params_.cluster_tolerance / params_.leaf_size - 1e-6));
+    const int radius2 = radius * radius;
+
+    std::vector<bool> visited(cell_coords_.size(), false);
+    std::vector<int> queue;
+    queue.reserve(cell_coords_.size());
+
+    for(size_t seed = 0; seed < cell_coords_.size(); seed++)
+    {
+        if(visited[seed]) continue;
+
+        // breadth-first visit of the cells within the tolerance
+        queue.clear();
+        queue.push_back(seed);
+        visited[seed] = true;
+        clusters_.push_back(Points2d());
+        Points2d& cluster = clusters_.back();
+        for(size_t k = 0; k < queue.size(); k++)
+        {
+            const Eigen::Vector2i& c = cell_coords_[queue[k]];
+            cluster.push_back(Eigen::Vector2d((c.x() + 0.5) * params_.leaf_size, (c.y() + 0.5) * params_.leaf_size));
+
+            for(int dx = -radius; dx <= radius; dx++)
+            {
+                for(int dy = -radius; dy <= radius; dy++)
+                {
+                    if(dx*dx + dy*dy > radius2) continue;
+                    std::unordered_map<uint64_t, int>::const_iterator it = cell_index_.find(cellKey(c.x() + dx, c.y() + dy));
+                    if(it == cell_index_.end() || visited[it->second]) continue;
+                    visited[it->second] = true;
+                    queue.push_back(it->second);
+                }
+            }
+        }
+    }
+}
+
+void CloudObstacleConverter::addClusterObstacles(const Points2d& cluster, costmap_converter::ObstacleArrayMsg& msg)
+{
+    if(cluster.empty()) return; /// < EXIT POINT
+
+    if(cluster.size() == 1)
+    {
+        addObstacle(cluster, msg); // point obstacle
+        return; /// < EXIT POINT
+    }
+
+    // principal axes of the cluster
+    Eigen::Vector2d mean = Eigen::Vector2d::Zero();
+    for(size_t i = 0; i < cluster.size(); i++) mean += cluster[i];
+    mean /= cluster.size();
+
+    Eigen::Matrix2d cov = Eigen::Matrix2d::Zero();
+    for(size_t i = 0; i < cluster.size(); i++)
+    {
+        const Eigen::Vector2d d = cluster[i] - mean;
+        cov += d * d.transpose();
+    }
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix2d> solver(cov);
+    const Eigen::Vector2d major_axis = solver.eigenvectors().col(1); // eigenvalues are sorted in increasing order
+    const Eigen::Vector2d minor_axis = solver.eigenvectors().col(0);
+
+    double min_a = 0, max_a = 0, min_b = 0, max_b = 0;
+    for(size_t i = 0; i < cluster.size(); i++)
+    {
+        const Eigen::Vector2d d = cluster[i] - mean;
+        const double a = d.dot(major_axis);
+        const double b = d.dot(minor_axis);
+        min_a = std::min(min_a, a); max_a = std::max(max_a, a);
+        min_b = std::min(min_b, b); max_b = std::max(max_b, b);
+    }
+    const double length = max_a - min_a;
+    const double width = max_b - min_b;
+
+    if(width <= params_.line_max_width)
+    {
+        // thin cluster: line along the major axis
+        Points2d line(2);
+        line[0] = mean + min_a * major_axis;
+        line[1] = mean + max_a * major_axis;
+        addObstacle(line, msg);
+        return; /// < EXIT POINT
+    }
+
+    if(length <= params_.max_polygon_size)
+    {
+        Points2d points(cluster);
+        Points2d hull;
+        computeConvexHull(points, hull);
+        addObstacle(hull, msg);
+        return; /// < EXIT POINT
+    }
+
+    // split the cluster at its mean along the major axis
+    Points2d part1, part2;
+    part1.reserve(cluster.size());
+    part2.reserve(cluster.size());
+    for(size_t i = 0; i < cluster.size(); i++)
+    {
+        if((cluster[i] - mean).dot(major_axis) < 0)
+            part1.push_back(cluster[i]);
+        else
+            part2.push_back(cluster[i]);
+    }
+    addClusterObstacles(part1, msg);
+    addClusterObstacles(part2, msg);
+}
+
+void CloudObstacleConverter::addObstacle(const Points2d& vertices, costmap_converter::ObstacleArrayMsg& msg)
+{
+    costmap_converter::ObstacleMsg obstacle;
+    obstacle.header = msg.header;
+    obstacle.id = msg.obstacles.size();
+    obstacle.radius = 0; // point, line or polygon (no circles)
+    obstacle.orientation.w = 1;
+
+    // a line obstacle with coincident vertices is a point
+    const size_t num_vertices = (vertices.size() == 2 && (vertices[0] - vertices[1]).squaredNorm() < 1e-12) ? 1 : vertices.size();
+    obstacle.polygon.points.resize(num_vertices);
+    for(size_t i = 0; i < num_vertices; i++)
+    {
+        obstacle.polygon.points[i].x = vertices[i].x();
+        obstacle.polygon.points[i].y = vertices[i].y();
+        obstacle.polygon.points[i].z = 0;
+    }
+    msg.obstacles.push_back(obstacle);
+}
+
+void CloudObstacleConverter::computeConvexHull(Points2d& points, Points2d& hull)
+{
+    // Andrew's monotone chain (counter-clockwise, collinear points removed)
+    std::sort(points.begin(), points.end(), [](const Eigen::Vector2d& a, const Eigen::Vector2d& b)
+    {
+        return a.x() < b.x() || (a.x() == b.x() && a.y() < b.y());
+    });
+
+    hull.resize(2 * points.size());
+    size_t k = 0;
+    for(size_t i = 0; i < points.size(); i++) // lower hull
+    {
+        while(k >= 2 && cross2d(hull[k-2], hull[k-1], points[i]) <= 0) k--;
+        hull[k++] = points[i];
+    }
+    for(size_t i = points.size() - 1, t = k + 1; i > 0; i--) // upper hull
+    {
+        while(k >= t && cross2d(hull[k-2], hull[k-1], points[i-1]) <= 0) k--;
+        hull[k++] = points[i-1];
+    }
+    hull.resize(k > 1 ? k - 1 : k); // the last point is equal to the first one
+}
+
+} // namespace teb_local_planner
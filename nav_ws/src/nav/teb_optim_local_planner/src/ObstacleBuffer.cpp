@@ -0,0 +1,145 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2017-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <teb_optim_local_planner/ObstacleBuffer.h>
+
+#include <std_msgs/Float32MultiArray.h>
+#include <geometry_msgs/PointStamped.h>
+
+
+namespace
+{
+  template<typename T>
+  T getParam(ros::NodeHandle& n, const std::string& name, const T& defaultValue)
+  {
+      T v;
+      if (n.getParam(name, v))
+      {
+          ROS_INFO_STREAM("Found parameter: " << name << ", value: " << v);
+          return v;
+      }
+      else
+      {
+          ROS_WARN_STREAM("Cannot find value for parameter: " << name << ", assigning default: " << defaultValue);
+      }
+      return defaultValue;
+  }
+}
+
+namespace teb_local_planner
+{
+
+ObstacleBuffer::ObstacleBuffer(): transform_tolerance_(0.2)
+{
+}
+
+void ObstacleBuffer::init(ros::NodeHandle& nh, ros::NodeHandle& param_nh)
+{
+    global_frame_ = getParam<std::string>(param_nh, "global_frame", "map");
+    robot_frame_ = getParam<std::string>(param_nh, "robot_base_frame", "base_link");
+    transform_tolerance_ = getParam<double>(param_nh, "transform_tolerance", 0.2);
+
+    converter_.readParams(param_nh);
+
+    obstacles_pub_ = nh.advertise<costmap_converter::ObstacleArrayMsg>("obstacles", 1);
+    closest_point_pub_ = nh.advertise<std_msgs::Float32MultiArray>("closest_obst_point", 1);
+    closest_point_stamped_pub_ = nh.advertise<geometry_msgs::PointStamped>("closest_obst_point_stamped", 1);
+    cloud_sub_ = nh.subscribe("obstacle_cloud", 1, &ObstacleBuffer::cloudCallback, this);
+}
+
+void ObstacleBuffer::cloudCallback(const sensor_msgs::PointCloud2ConstPtr& cloud_msg)
+{
+    update(*cloud_msg);
+}
+
+bool ObstacleBuffer::update(const sensor_msgs::PointCloud2& cloud)
+{
+    tf::StampedTransform T_robot_cloud;
+    tf::StampedTransform T_global_robot;
+    try
+    {
+        if( !tf_listener_.waitForTransform(global_frame_, robot_frame_, cloud.header.stamp, ros::Duration(transform_tolerance_)) ||
+            !tf_listener_.waitForTransform(robot_frame_, cloud.header.frame_id, cloud.header.stamp, ros::Duration(transform_tolerance_)) )
+        {
+            ROS_WARN_STREAM("ObstacleBuffer: cannot get the transforms at time " << cloud.header.stamp);
+            return false; /// < EXIT POINT
+        }
+        tf_listener_.lookupTransform(robot_frame_, cloud.header.frame_id, cloud.header.stamp, T_robot_cloud);
+        tf_listener_.lookupTransform(global_frame_, robot_frame_, cloud.header.stamp, T_global_robot);
+    }
+    catch(tf::TransformException& ex)
+    {
+        ROS_ERROR("ObstacleBuffer: %s", ex.what());
+        return false; /// < EXIT POINT
+    }
+
+    // build the new snapshot aside: the readers keep using the previous one in the meanwhile
+    std::shared_ptr<ObstacleSnapshot> snapshot(new ObstacleSnapshot);
+    snapshot->stamp = cloud.header.stamp;
+    snapshot->robot_frame = robot_frame_;
+    snapshot->global_frame = global_frame_;
+
+    costmap_converter::ObstacleArrayMsgPtr obstacles_msg(new costmap_converter::ObstacleArrayMsg);
+    obstacles_msg->header.stamp = cloud.header.stamp;
+    obstacles_msg->header.frame_id = global_frame_;
+    converter_.convert(cloud, T_robot_cloud, T_global_robot, *obstacles_msg);
+    snapshot->obstacles = obstacles_msg;
+
+    snapshot->has_closest_point = converter_.getClosestPoint(snapshot->closest_point, snapshot->closest_dist);
+
+    std::atomic_store(&snapshot_, ObstacleSnapshotConstPtr(snapshot));
+
+    publish(*snapshot);
+
+    return true;
+}
+
+void ObstacleBuffer::publish(const ObstacleSnapshot& snapshot)
+{
+    // the message is shared with the snapshot (no copy for the subscribers in the same nodelet manager)
+    obstacles_pub_.publish(snapshot.obstacles);
+
+    if(!snapshot.has_closest_point) return; /// < EXIT POINT
+
+    if(closest_point_pub_.getNumSubscribers() > 0)
+    {
+        std_msgs::Float32MultiArray closest_point_msg; // <x,y,z,dist>
+        closest_point_msg.data.reserve(4);
+        closest_point_msg.data.push_back(snapshot.closest_point.x());
+        closest_point_msg.data.push_back(snapshot.closest_point.y());
+        closest_point_msg.data.push_back(snapshot.closest_point.z());
+        closest_point_msg.data.push_back(snapshot.closest_dist);
+        closest_point_pub_.publish(closest_point_msg);
+    }
+
+    if(closest_point_stamped_pub_.getNumSubscribers() > 0)
+    {
+        geometry_msgs::PointStamped closest_point_msg;
+        closest_point_msg.header.stamp = snapshot.stamp;
+        closest_point_msg.header.frame_id = snapshot.robot_frame;
+        closest_point_msg.point.x = snapshot.closest_point.x();
+        closest_point_msg.point.y = snapshot.closest_point.y();
+        closest_point_msg.point.z = snapshot.closest_point.z();
+        closest_point_stamped_pub_.publish(closest_point_msg);
+    }
+}
+
+} // namespace teb_local_planner
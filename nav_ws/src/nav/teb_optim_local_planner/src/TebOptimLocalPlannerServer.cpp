@@ -217,6 +217,7 @@ void TebOptimLocalPlannerServer::initialize()
 #endif      
       ROS_INFO("Parallel planning in distinctive topologies disabled.");
     }
+    planner_->setObstacleIndex(&obstacle_index_);
     
     // init other variables
     // tf_ = tf;
@@ -236,6 +237,9 @@ void TebOptimLocalPlannerServer::initialize()
     control_rate_ = getParam<double>(nh, name_ + "/control_rate", 10);
 
     transform_tolerance_ = getParam<double>(param_node_, "transform_tolerance", 0.2);
+    plan_tf_cache_translation_threshold_ = getParam<double>(param_node_, "plan_tf_cache_translation_threshold", plan_tf_cache_translation_threshold_);
+    plan_tf_cache_rotation_threshold_ = getParam<double>(param_node_, "plan_tf_cache_rotation_threshold", plan_tf_cache_rotation_threshold_);
+    global_plan_search_dist_ = getParam<double>(param_node_, "global_plan_search_dist", global_plan_search_dist_);
 
     max_time_for_evanescent_obstacles_ = getParam<double>(param_node_, "max_time_for_evanescent_obstacles", 2.0);
     factor_extending_plan_lookahead_dist_with_obs_ = getParam<double>(param_node_, "factor_extending_plan_lookahead_dist_with_obs", 1.5);
@@ -495,6 +499,9 @@ bool TebOptimLocalPlannerServer::setPlan(const std::vector<geometry_msgs::PoseSt
   // store the global plan
   global_plan_.clear();
   global_plan_ = orig_global_plan;
+  
+  // the transformed poses refer to the old plan
+  plan_cache_.reset();
 
   // we do not clear the local planner here, since setPlan is called frequently whenever the global planner updates the plan.
   // the local planner checks whether it is required to reinitialize the trajectory or not within each velocity computation step.  
@@ -508,7 +515,11 @@ bool TebOptimLocalPlannerServer::setPlan(const std::vector<geometry_msgs::PoseSt
 void TebOptimLocalPlannerServer::clearOldObstacles()
 {
   ROS_ASSERT_MSG(obstacles_.size() == obstacles_stamps_.size(), "Wrong management in obstacles!");
-  if(obstacles_.size() != obstacles_stamps_.size()) obstacles_.clear();
+  if(obstacles_.size() != obstacles_stamps_.size()) 
+  {
+    obstacles_.clear();
+    custom_obstacles_cache_valid_ = false;
+  }
   auto ito = obstacles_.begin();
   auto itos = obstacles_stamps_.begin();
   ros::Time now = ros::Time::now(); 
@@ -594,6 +605,9 @@ uint32_t TebOptimLocalPlannerServer::computeVelocityCommands(const geometry_msgs
   std::cout << "current robot v: (" << robot_vel_.linear.x << ", " << robot_vel_.linear.y << "), omega: " << robot_vel_.angular.z << std::endl; 
 #endif 
 
+  // look up the transform of the global plan (once per cycle, the transformed poses are reused if it did not change significantly)
+  updateGlobalPlanTransform(global_plan_, global_frame_);
+
   // prune global plan to cut off parts of the past (spatially before the robot)
   pruneGlobalPlan(robot_pose, global_plan_, cfg_.trajectory.global_plan_prune_distance);
 
@@ -705,6 +719,9 @@ uint32_t TebOptimLocalPlannerServer::computeVelocityCommands(const geometry_msgs
 
   // also consider custom obstacles (must be called after other updates, since the container is not cleared)
   updateObstacleContainerWithCustomObstacles();
+
+  // rebuild the spatial index used for the association of the obstacles to the trajectory poses
+  obstacle_index_.build(obstacles_);
   
     
   // Do not allow config changes during the following optimization step
@@ -917,7 +934,22 @@ void TebOptimLocalPlannerServer::updateObstacleContainerWithCustomObstacles()
   // Add custom obstacles obtained via message
   boost::mutex::scoped_lock l(custom_obst_mutex_);
 
-  if (!custom_obstacle_msg_.obstacles.empty())
+  if (custom_obstacle_msg_.obstacles.empty())
+    return; /// < EXIT POINT 
+
+  // the obstacles of an already processed message are taken from the cache (no transform lookup)
+  if (custom_obstacles_cache_valid_ &&
+      custom_obstacles_cache_header_.stamp == custom_obstacle_msg_.header.stamp &&
+      custom_obstacles_cache_header_.frame_id == custom_obstacle_msg_.header.frame_id)
+  {
+    obstacles_.insert(obstacles_.end(), custom_obstacles_cache_.begin(), custom_obstacles_cache_.end());
+    obstacles_stamps_.insert(obstacles_stamps_.end(), custom_obstacles_cache_stamps_.begin(), custom_obstacles_cache_stamps_.end());
+    return; /// < EXIT POINT 
+  }
+  
+  const size_t first_new_obstacle = obstacles_.size();
+  bool transform_found = false; // do not cache the obstacles of a message if its transform is not available yet
+
   {
     // We only use the global header to specify the obstacle coordinate system instead of individual ones
     Eigen::Affine3d obstacle_to_map_eig;
@@ -929,11 +961,11 @@ void TebOptimLocalPlannerServer::updateObstacleContainerWithCustomObstacles()
       //                                                                         custom_obstacle_msg_.header.frame_id, ros::Duration(transform_tolerance_));
       tf::StampedTransform transform;
 #if 0      
-      getTransform(global_frame_, ros::Time(0),
+      transform_found = getTransform(global_frame_, ros::Time(0),
                    custom_obstacle_msg_.header.frame_id, ros::Time(0),
                    custom_obstacle_msg_.header.frame_id, transform);
 #else 
-      getTransform(global_frame_, ros::Time(0),
+      transform_found = getTransform(global_frame_, ros::Time(0),
                    custom_obstacle_msg_.header.frame_id, custom_obstacle_msg_.header.stamp,
                    custom_obstacle_msg_.header.frame_id, transform);
 #endif                    
@@ -1003,6 +1035,14 @@ void TebOptimLocalPlannerServer::updateObstacleContainerWithCustomObstacles()
         obstacles_.back()->setCentroidVelocity(custom_obstacle_msg_.obstacles[i].velocities, custom_obstacle_msg_.obstacles[i].orientation);
     }
   }
+
+  // cache the transformed obstacles of this message 
+  custom_obstacles_cache_valid_ = transform_found;
+  if (!transform_found)
+    return; /// < EXIT POINT 
+  custom_obstacles_cache_.assign(obstacles_.begin() + first_new_obstacle, obstacles_.end());
+  custom_obstacles_cache_stamps_.assign(obstacles_stamps_.begin() + first_new_obstacle, obstacles_stamps_.end());
+  custom_obstacles_cache_header_ = custom_obstacle_msg_.header;
 }
 
 void TebOptimLocalPlannerServer::updateViaPointsContainer(const std::vector<geometry_msgs::PoseStamped>& transformed_plan, double min_separation)
@@ -1035,6 +1075,83 @@ Eigen::Vector2d TebOptimLocalPlannerServer::tfPoseToEigenVector2dTransRot(const
 }
       
       
+bool TebOptimLocalPlannerServer::updateGlobalPlanTransform(const std::vector<geometry_msgs::PoseStamped>& global_plan, const std::string& global_frame)
+{
+  if (global_plan.empty())
+    return false;
+
+  const geometry_msgs::PoseStamped& plan_pose = global_plan.front();
+  const bool same_frames = plan_cache_.has_transform &&
+                           plan_cache_.plan_frame == plan_pose.header.frame_id &&
+                           plan_cache_.global_frame == global_frame;
+
+  // get plan_to_global_transform from plan frame to global_frame
+  tf::StampedTransform transform;
+  if (!getTransform(global_frame, ros::Time(), plan_pose.header.frame_id, plan_pose.header.stamp, plan_pose.header.frame_id, transform))
+  {
+    // keep on using the last valid transform (if any)
+    return same_frames; /// < EXIT POINT 
+  }
+
+  if (same_frames)
+  {
+    // keep the cached poses if the transform (e.g. the map->odom correction) did not change significantly
+    const tf::Transform delta = plan_cache_.plan_to_global.inverseTimes(transform);
+    if (delta.getOrigin().length() <= plan_tf_cache_translation_threshold_ &&
+        std::fabs(tf::getYaw(delta.getRotation())) <= plan_tf_cache_rotation_threshold_)
+    {
+      return true; /// < EXIT POINT 
+    }
+  }
+
+  plan_cache_.has_transform = true;
+  plan_cache_.plan_frame = plan_pose.header.frame_id;
+  plan_cache_.global_frame = global_frame;
+  plan_cache_.plan_to_global = transform;
+  tfConvert(transform, plan_cache_.plan_to_global_msg);
+  plan_cache_.poses.clear();
+
+  return true;
+}
+
+bool TebOptimLocalPlannerServer::getRobotPoseInPlanFrame(const std::vector<geometry_msgs::PoseStamped>& global_plan, const geometry_msgs::PoseStamped& global_pose,
+                                                         geometry_msgs::PoseStamped& robot_pose)
+{
+  const std::string& plan_frame = global_plan.front().header.frame_id;
+
+  if (plan_cache_.has_transform && plan_cache_.plan_frame == plan_frame && plan_cache_.global_frame == tf2::getFrameId(global_pose))
+  {
+    // the robot pose is expressed in the global frame: just invert the cached plan_to_global transform
+    tf::StampedTransform global_to_plan(plan_cache_.plan_to_global.inverse(), plan_cache_.plan_to_global.stamp_,
+                                        plan_frame, plan_cache_.global_frame);
+    geometry_msgs::TransformStamped global_to_plan_transform;
+    tfConvert(global_to_plan, global_to_plan_transform);
+    tf2::doTransform(global_pose, robot_pose, global_to_plan_transform);
+    return true; /// < EXIT POINT 
+  }
+
+  // transform robot pose into the plan frame by taking the most recent tf transform
+  tf::StampedTransform transform;
+  if (!getTransform(plan_frame, tf2::getFrameId(global_pose), ros::Time(0), transform))
+    return false; /// < EXIT POINT 
+  geometry_msgs::TransformStamped global_to_plan_transform;
+  tfConvert(transform, global_to_plan_transform);
+  tf2::doTransform(global_pose, robot_pose, global_to_plan_transform);
+  return true;
+}
+
+const geometry_msgs::PoseStamped& TebOptimLocalPlannerServer::getTransformedGlobalPlanPose(const std::vector<geometry_msgs::PoseStamped>& global_plan, int idx)
+{
+  // the cache stores a prefix of the plan (the plan is pruned from the front and consumed from the closest pose onwards)
+  while ((int)plan_cache_.poses.size() <= idx)
+  {
+    const size_t k = plan_cache_.poses.size();
+    plan_cache_.poses.emplace_back();
+    tf2::doTransform(global_plan[k], plan_cache_.poses.back(), plan_cache_.plan_to_global_msg);
+  }
+  return plan_cache_.poses[idx];
+}
+      
 bool TebOptimLocalPlannerServer::pruneGlobalPlan(const geometry_msgs::PoseStamped& global_pose, std::vector<geometry_msgs::PoseStamped>& global_plan, double dist_behind_robot)
 {
   if (global_plan.empty())
@@ -1043,14 +1160,9 @@ bool TebOptimLocalPlannerServer::pruneGlobalPlan(const geometry_msgs::PoseStampe
   try
   {
     // transform robot pose into the plan frame (we do not wait here, since pruning not crucial, if missed a few times)
-    //geometry_msgs::TransformStamped global_to_plan_transform = tf.lookupTransform(global_plan.front().header.frame_id, global_pose.header.frame_id, ros::Time(0));
-    tf::StampedTransform transform;
-    getTransform(global_plan.front().header.frame_id, global_pose.header.frame_id, ros::Time(0), transform);
-    geometry_msgs::TransformStamped global_to_plan_transform;
-    tfConvert(transform, global_to_plan_transform);
-
     geometry_msgs::PoseStamped robot;
-    tf2::doTransform(global_pose, robot, global_to_plan_transform);
+    if (!getRobotPoseInPlanFrame(global_plan, global_pose, robot))
+      return false;
     
     double dist_thresh_sq = dist_behind_robot*dist_behind_robot;
     
@@ -1073,7 +1185,17 @@ bool TebOptimLocalPlannerServer::pruneGlobalPlan(const geometry_msgs::PoseStampe
       return false;
     
     if (erase_end != global_plan.begin())
+    {
+      const int num_erased = (int)std::distance(global_plan.begin(), erase_end);
       global_plan.erase(global_plan.begin(), erase_end);
+
+      // keep the cache aligned with the pruned plan
+      if ((int)plan_cache_.poses.size() > num_erased)
+        plan_cache_.poses.erase(plan_cache_.poses.begin(), plan_cache_.poses.begin() + num_erased);
+      else
+        plan_cache_.poses.clear();
+      plan_cache_.closest_idx = std::max(plan_cache_.closest_idx - num_erased, 0);
+    }
   }
   catch (const tf::TransformException& ex)
   {
@@ -1089,8 +1211,8 @@ bool TebOptimLocalPlannerServer::transformGlobalPlan(const std::vector<geometry_
                   std::vector<geometry_msgs::PoseStamped>& transformed_plan, int* current_goal_idx, geometry_msgs::TransformStamped* tf_plan_to_global)
 {
   // this method is a slightly modified version of base_local_planner/goal_functions.h
-
-  const geometry_msgs::PoseStamped& plan_pose = global_plan[0];
+  // N.B.: the transformed poses are cached in plan_cache_ and recomputed only when the plan-to-global transform changes
+  //       significantly (see updateGlobalPlanTransform())
 
   transformed_plan.clear();
 
@@ -1099,27 +1221,22 @@ bool TebOptimLocalPlannerServer::transformGlobalPlan(const std::vector<geometry_
     if (global_plan.empty())
     {
       ROS_ERROR("Received plan with zero length");
-      *current_goal_idx = 0;
+      if (current_goal_idx) *current_goal_idx = 0;
       return false;
     }
 
-    // get plan_to_global_transform from plan frame to global_frame
-    // geometry_msgs::TransformStamped plan_to_global_transform = tf.lookupTransform(global_frame, ros::Time(), plan_pose.header.frame_id, plan_pose.header.stamp,
-    //                                                                               plan_pose.header.frame_id, ros::Duration(transform_tolerance_));
-
-    tf::StampedTransform transform;
-    getTransform(global_frame, ros::Time(), plan_pose.header.frame_id, plan_pose.header.stamp, plan_pose.header.frame_id, transform);
-    geometry_msgs::TransformStamped plan_to_global_transform;
-    tfConvert(transform, plan_to_global_transform);
+    // get plan_to_global_transform from plan frame to global_frame (already looked up in this cycle if the frames match)
+    if (!plan_cache_.has_transform || plan_cache_.plan_frame != global_plan.front().header.frame_id || plan_cache_.global_frame != global_frame)
+    {
+      if (!updateGlobalPlanTransform(global_plan, global_frame))
+        return false;
+    }
+    const geometry_msgs::TransformStamped& plan_to_global_transform = plan_cache_.plan_to_global_msg;
 
     //let's get the pose of the robot in the frame of the plan
     geometry_msgs::PoseStamped robot_pose;
-    //tf.transform(global_pose, robot_pose, plan_pose.header.frame_id);
-    tf::StampedTransform via_transform;
-    getTransform(plan_pose.header.frame_id, tf2::getFrameId(global_pose), tf2::getTimestamp(robot_pose), via_transform);
-    geometry_msgs::TransformStamped g_via_transform;
-    tfConvert(via_transform, g_via_transform);
-    tf2::doTransform(global_pose, robot_pose, g_via_transform);
+    if (!getRobotPoseInPlanFrame(global_plan, global_pose, robot_pose))
+      return false;
 
     // //we'll discard points on the plan that are outside the local costmap
     // double dist_threshold = std::max(costmap.getSizeInCellsX() * costmap.getResolution() / 2.0,
@@ -1132,10 +1249,22 @@ bool TebOptimLocalPlannerServer::transformGlobalPlan(const std::vector<geometry_
     double sq_dist_threshold = 1e10;
     double sq_dist = 1e10;
     
+    // the robot cannot move far along the plan in one cycle: once the last closest pose is known, the search 
+    // is stopped global_plan_search_dist_ [m] (along the plan) after it instead of scanning the whole plan
+    const int last_closest_idx = std::min(plan_cache_.closest_idx, (int)global_plan.size()-1);
+    double dist_after_last_closest = 0;
+
     //we need to loop to a point on the plan that is within a certain distance of the robot
     bool robot_reached = false;
     for(int j=0; j < (int)global_plan.size(); ++j)
     {
+      if (last_closest_idx >= 0 && global_plan_search_dist_ > 0 && j > last_closest_idx)
+      {
+        dist_after_last_closest += distance_points2d(global_plan[j-1].pose.position, global_plan[j].pose.position);
+        if (dist_after_last_closest > global_plan_search_dist_)
+          break;
+      }
+
       double x_diff = robot_pose.pose.position.x - global_plan[j].pose.position.x;
       double y_diff = robot_pose.pose.position.y - global_plan[j].pose.position.y;
       double new_sq_dist = x_diff * x_diff + y_diff * y_diff;
@@ -1151,18 +1280,14 @@ bool TebOptimLocalPlannerServer::transformGlobalPlan(const std::vector<geometry_
           robot_reached = true;  // minima, probably means that there's a loop in the path, and so we prefer this
       }
     }
-    
-    geometry_msgs::PoseStamped newer_pose;
+    plan_cache_.closest_idx = i;
     
     double plan_length = 0; // check cumulative Euclidean distance along the plan
     
     //now we'll transform until points are outside of our distance threshold
     while(i < (int)global_plan.size() && sq_dist <= sq_dist_threshold && (max_plan_length<=0 || plan_length <= max_plan_length))
     {
-      const geometry_msgs::PoseStamped& pose = global_plan[i];
-      tf2::doTransform(pose, newer_pose, plan_to_global_transform);
-
-      transformed_plan.push_back(newer_pose);
+      transformed_plan.push_back(getTransformedGlobalPlanPose(global_plan, i));
 
       double x_diff = robot_pose.pose.position.x - global_plan[i].pose.position.x;
       double y_diff = robot_pose.pose.position.y - global_plan[i].pose.position.y;
@@ -1179,6 +1304,7 @@ bool TebOptimLocalPlannerServer::transformGlobalPlan(const std::vector<geometry_
     // the resulting transformed plan can be empty. In that case we explicitly inject the global goal.
     if (transformed_plan.empty())
     {
+      geometry_msgs::PoseStamped newer_pose;
       tf2::doTransform(global_plan.back(), newer_pose, plan_to_global_transform);
 
       transformed_plan.push_back(newer_pose);
@@ -1544,8 +1670,28 @@ RobotFootprintModelPtr TebOptimLocalPlannerServer::getRobotFootprintFromParamSer
       try
       {
         Point2dContainer polygon = makeFootprintFromXMLRPC(footprint_xmlrpc, "/footprint_model/vertices");
-        ROS_INFO_STREAM("Footprint model 'polygon' loaded for trajectory optimization.");
-        return boost::make_shared<PolygonRobotFootprint>(polygon);
+        boost::shared_ptr<PolygonRobotFootprint> polygon_model = boost::make_shared<PolygonRobotFootprint>(polygon);
+        
+        // optional signed distance field of the polygon (constant time distances to point and circular obstacles)
+        bool use_distance_field = false;
+        nh.param("footprint_model/use_distance_field", use_distance_field, use_distance_field);
+        if (use_distance_field)
+        {
+          double resolution = 0.02;
+          double margin = config.obstacles.min_obstacle_dist * config.obstacles.obstacle_association_cutoff_factor;
+          nh.param("footprint_model/distance_field_resolution", resolution, resolution);
+          nh.param("footprint_model/distance_field_margin", margin, margin);
+          if (polygon_model->enableDistanceField(resolution, margin))
+            ROS_INFO_STREAM("Footprint model 'polygon' (distance field resolution: " << resolution << "m, margin: " << margin << "m) loaded for trajectory optimization.");
+          else
+            ROS_WARN_STREAM("Footprint model 'polygon' loaded for trajectory optimization, but its distance field cannot be built (resolution: " 
+                            << resolution << "m, margin: " << margin << "m). Using the exact distances instead.");
+        }
+        else
+        {
+          ROS_INFO_STREAM("Footprint model 'polygon' loaded for trajectory optimization.");
+        }
+        return polygon_model;
       } 
       catch(const std::exception& ex)
       {
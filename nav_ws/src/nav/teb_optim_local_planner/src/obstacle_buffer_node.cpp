@@ -0,0 +1,36 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2017-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <teb_optim_local_planner/ObstacleBuffer.h>
+
+int main(int argc, char** argv)
+{
+    ros::init(argc, argv, "obstacle_buffer");
+
+    ros::NodeHandle nh;
+    ros::NodeHandle param_nh("~");
+
+    teb_local_planner::ObstacleBuffer obstacle_buffer;
+    obstacle_buffer.init(nh, param_nh);
+    ros::spin();
+
+    return 0;
+}
@@ -0,0 +1,60 @@
+/**
+* This file is part of the ROS package path_planner which belongs to the framework 3DMR.
+*
+* Copyright (C) 2017-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <memory>
+
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+
+#include <teb_optim_local_planner/ObstacleBuffer.h>
+
+namespace teb_local_planner
+{
+
+///	\class ObstacleBufferNodelet
+///	\author Luigi Freda
+///	\brief Nodelet version of obstacle_buffer_node: loaded in the same manager of the cloud producer,
+///        the clouds and the obstacle messages are passed by pointer.
+///	\note
+/// \todo
+///	\date
+///	\warning
+class ObstacleBufferNodelet : public nodelet::Nodelet
+{
+public:
+    ObstacleBufferNodelet() {}
+
+    // snapshot API for the other nodelets of the same manager
+    ObstacleSnapshotConstPtr getSnapshot() const { return obstacle_buffer_ ? obstacle_buffer_->getSnapshot() : ObstacleSnapshotConstPtr(); }
+
+private:
+    virtual void onInit()
+    {
+        obstacle_buffer_.reset(new ObstacleBuffer());
+        obstacle_buffer_->init(getNodeHandle(), getPrivateNodeHandle());
+    }
+
+    std::unique_ptr<ObstacleBuffer> obstacle_buffer_;
+};
+
+} // namespace teb_local_planner
+
+PLUGINLIB_EXPORT_CLASS(teb_local_planner::ObstacleBufferNodelet, nodelet::Nodelet)
@@ -0,0 +1,153 @@
+/**
+* This file is part of the ROS package tf_remapper which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef POINT_CLOUD_FRAME_REMAPPER_H_
+#define POINT_CLOUD_FRAME_REMAPPER_H_
+
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/core/noncopyable.hpp>
+
+#include <ros/ros.h>
+#include <std_msgs/Header.h>
+#include <sensor_msgs/PointCloud2.h>
+
+
+namespace tf_remapper
+{
+
+///	\class PointCloud2Envelope
+///	\author Luigi Freda
+///	\brief A PointCloud2 with a new header: it shares the fields and the data of the input cloud.
+///        It is serialized (see the traits below) exactly as a sensor_msgs::PointCloud2, so it can be published on
+///        a PointCloud2 topic and the data are written to the wire straight from the input cloud, without a deep copy.
+///	\note
+/// \todo
+///	\date
+///	\warning
+struct PointCloud2Envelope
+{
+    typedef boost::shared_ptr<PointCloud2Envelope> Ptr;
+    typedef boost::shared_ptr<PointCloud2Envelope const> ConstPtr;
+
+    std_msgs::Header header;
+    sensor_msgs::PointCloud2ConstPtr cloud;
+};
+
+
+///	\class PointCloudFrameRemapper
+///	\author Luigi Freda
+///	\brief Receives point clouds and republishes them with the frame_id prefixed by "/robot_name/".
+///        Several input/output topic pairs can be served by one instance (e.g. one nodelet for all the robots)
+///        with the list parameter "topic_pairs", whose items are {input: <topic>, output: <topic>, robot_name: <name>}
+///        (robot_name is optional and defaults to the parameter "robot_name"). Without "topic_pairs", the single
+///        pair /input_topic -> /output_topic is used.
+///	\note
+/// \todo
+///	\date
+///	\warning
+class PointCloudFrameRemapper : private boost::noncopyable
+{
+public:
+
+    PointCloudFrameRemapper(const ros::NodeHandle &nh, const ros::NodeHandle &nh_private);
+
+protected:
+
+    struct TopicPair
+    {
+        std::string prefix;
+        ros::Subscriber sub;
+        ros::Publisher pub;
+    };
+
+    void addTopicPair(const std::string &input_topic, const std::string &output_topic, const std::string &robot_name);
+
+    void pointCloudCallback(const sensor_msgs::PointCloud2ConstPtr &pcl_msg, const TopicPair *pair);
+
+protected:
+
+    ros::NodeHandle nh_;
+    ros::NodeHandle nh_private_;
+
+    std::vector<boost::shared_ptr<TopicPair> > topic_pairs_;
+};
+
+} // namespace tf_remapper
+
+
+namespace ros
+{
+namespace message_traits
+{
+
+template<> struct MD5Sum<tf_remapper::PointCloud2Envelope>
+{
+    static const char* value() { return MD5Sum<sensor_msgs::PointCloud2>::value(); }
+    static const char* value(const tf_remapper::PointCloud2Envelope&) { return value(); }
+};
+
+template<> struct DataType<tf_remapper::PointCloud2Envelope>
+{
+    static const char* value() { return DataType<sensor_msgs::PointCloud2>::value(); }
+    static const char* value(const tf_remapper::PointCloud2Envelope&) { return value(); }
+};
+
+template<> struct Definition<tf_remapper::PointCloud2Envelope>
+{
+    static const char* value() { return Definition<sensor_msgs::PointCloud2>::value(); }
+    static const char* value(const tf_remapper::PointCloud2Envelope&) { return value(); }
+};
+
+} // namespace message_traits
+
+namespace serialization
+{
+
+/// < same wire format of sensor_msgs::PointCloud2, with the header of the envelope
+template<> struct Serializer<tf_remapper::PointCloud2Envelope>
+{
+    template<typename Stream>
+    inline static void write(Stream& stream, const tf_remapper::PointCloud2Envelope& m)
+    {
+        const sensor_msgs::PointCloud2& cloud = *m.cloud;
+        stream.next(m.header);
+        stream.next(cloud.height);
+        stream.next(cloud.width);
+        stream.next(cloud.fields);
+        stream.next(cloud.is_bigendian);
+        stream.next(cloud.point_step);
+        stream.next(cloud.row_step);
+        stream.next(cloud.data);
+        stream.next(cloud.is_dense);
+    }
+
+    inline static uint32_t serializedLength(const tf_remapper::PointCloud2Envelope& m)
+    {
+        return serializationLength(*m.cloud) - serializationLength(m.cloud->header) + serializationLength(m.header);
+    }
+};
+
+} // namespace serialization
+} // namespace ros
+
+#endif // POINT_CLOUD_FRAME_REMAPPER_H_
@@ -0,0 +1,111 @@
+/**
+* This file is part of the ROS package tf_remapper which belongs to the framework 3DMR. 
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> 
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef TF_RELAY_H_
+#define TF_RELAY_H_
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/core/noncopyable.hpp>
+
+#include <ros/ros.h>
+#include <tf2_msgs/TFMessage.h>
+
+
+namespace tf_remapper
+{
+
+///	\class TfRelay
+///	\author Luigi Freda
+///	\brief Event-driven relay of the tf trees of several robots into a single tf tree.
+///        Each source is a pair of tf/tf_static topics with a frame prefix (list parameter "sources", whose items are
+///        {tf: <topic>, tf_static: <topic>, prefix: <prefix>}; tf_static and prefix are optional). The frames of
+///        the received transforms are prefixed (except the ones in the list parameter "blacklist") and the latest
+///        transform of each child frame is kept. A timer at "publish_rate" publishes all the updated transforms of
+///        all the sources in one tf2_msgs::TFMessage; a child frame is published at most at "max_frame_rate"
+///        (0 = no limit). The static transforms are accumulated and republished as a whole on the latched output
+///        tf_static topic when they change.
+///        Unlike tf_listener_and_publisher/tf_merger, no tf listener is needed and no lookup is done.
+///	\note  the callbacks and the timer must be served by a single-threaded spinner
+/// \todo
+///	\date
+///	\warning
+class TfRelay : private boost::noncopyable
+{
+public:
+
+    TfRelay(const ros::NodeHandle &nh, const ros::NodeHandle &nh_private);
+
+protected:
+
+    struct Source
+    {
+        std::string prefix;
+        std::unordered_map<std::string, std::string> remapped_frames; // input frame -> output frame
+        ros::Subscriber tf_sub;
+        ros::Subscriber tf_static_sub;
+    };
+
+    struct FrameState
+    {
+        geometry_msgs::TransformStamped transform; // latest transform, with the output frame names
+        ros::Time last_pub_time;
+        bool pending = false;
+    };
+
+    void addSource(const std::string &tf_topic, const std::string &tf_static_topic, const std::string &prefix);
+
+    // get the output name of a frame of a source (cached)
+    const std::string& remapFrame(Source &source, const std::string &frame);
+
+    void tfCallback(const tf2_msgs::TFMessageConstPtr &msg, Source *source);
+    void tfStaticCallback(const tf2_msgs::TFMessageConstPtr &msg, Source *source);
+
+    void publishTimerCallback(const ros::TimerEvent &event);
+
+protected:
+
+    ros::NodeHandle nh_;
+    ros::NodeHandle nh_private_;
+
+    std::vector<boost::shared_ptr<Source> > sources_;
+    std::unordered_set<std::string> blacklist_;
+
+    std::unordered_map<std::string, FrameState> frames_;  // output child frame -> latest transform
+    std::vector<FrameState*> pending_frames_;
+    ros::Duration min_frame_period_;
+
+    std::unordered_map<std::string, geometry_msgs::TransformStamped> static_transforms_; // output child frame -> static transform
+    bool static_transforms_changed_ = false;
+
+    tf2_msgs::TFMessage tf_out_msg_;   // reused to batch the transforms of a cycle
+    ros::Publisher tf_pub_;
+    ros::Publisher tf_static_pub_;
+    ros::Timer publish_timer_;
+};
+
+} // namespace tf_remapper
+
+#endif // TF_RELAY_H_
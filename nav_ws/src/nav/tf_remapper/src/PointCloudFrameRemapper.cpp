@@ -0,0 +1,117 @@
+/**
+* This file is part of the ROS package tf_remapper which belongs to the framework 3DMR. 
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> 
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <PointCloudFrameRemapper.h>
+
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <XmlRpcValue.h>
+
+
+namespace tf_remapper
+{
+
+template<typename T>
+T getParam(ros::NodeHandle& n, const std::string& name, const T& defaultValue)
+{
+    T v;
+    if (n.getParam(name, v))
+    {
+        ROS_INFO_STREAM("Found parameter: " << name << ", value: " << v);
+        return v;
+    }
+    else
+    {
+        ROS_WARN_STREAM("Cannot find value for parameter: " << name << ", assigning default: " << defaultValue);
+    }
+    return defaultValue;
+}
+
+static std::string getStringMember(XmlRpc::XmlRpcValue& item, const std::string& name, const std::string& defaultValue)
+{
+    if (item.hasMember(name) && item[name].getType() == XmlRpc::XmlRpcValue::TypeString)
+    {
+        return static_cast<std::string>(item[name]);
+    }
+    return defaultValue;
+}
+
+PointCloudFrameRemapper::PointCloudFrameRemapper(const ros::NodeHandle &nh, const ros::NodeHandle &nh_private)
+: nh_(nh)
+, nh_private_(nh_private)
+{
+    /// < get parameters
+    const std::string robot_name = getParam<std::string>(nh_private_, "robot_name", "ugv1");
+
+    XmlRpc::XmlRpcValue topic_pairs;
+    if (nh_private_.getParam("topic_pairs", topic_pairs) && topic_pairs.getType() == XmlRpc::XmlRpcValue::TypeArray)
+    {
+        for (int i = 0; i < topic_pairs.size(); i++)
+        {
+            XmlRpc::XmlRpcValue& item = topic_pairs[i];
+            if (item.getType() != XmlRpc::XmlRpcValue::TypeStruct)
+            {
+                ROS_ERROR_STREAM("PointCloudFrameRemapper - topic_pairs[" << i << "] is not a struct, skipping it");
+                continue;
+            }
+            const std::string input_topic = getStringMember(item, "input", "");
+            const std::string output_topic = getStringMember(item, "output", "");
+            if (input_topic.empty() || output_topic.empty())
+            {
+                ROS_ERROR_STREAM("PointCloudFrameRemapper - topic_pairs[" << i << "] needs input and output, skipping it");
+                continue;
+            }
+            addTopicPair(input_topic, output_topic, getStringMember(item, "robot_name", robot_name));
+        }
+    }
+    else
+    {
+        addTopicPair("/input_topic", "/output_topic", robot_name);
+    }
+}
+
+void PointCloudFrameRemapper::addTopicPair(const std::string &input_topic, const std::string &output_topic, const std::string &robot_name)
+{
+    boost::shared_ptr<TopicPair> pair = boost::make_shared<TopicPair>();
+    pair->prefix = "/" + robot_name + "/";
+
+    /// < publishers
+    pair->pub = nh_private_.advertise<PointCloud2Envelope>(output_topic, 1, true);
+
+    /// < subscribers
+    pair->sub = nh_private_.subscribe<sensor_msgs::PointCloud2>(input_topic, 1,
+                    boost::bind(&PointCloudFrameRemapper::pointCloudCallback, this, _1, pair.get()));
+
+    ROS_INFO_STREAM("PointCloudFrameRemapper - " << pair->sub.getTopic() << " -> " << pair->pub.getTopic() << " with prefix " << pair->prefix);
+    topic_pairs_.push_back(pair);
+}
+
+void PointCloudFrameRemapper::pointCloudCallback(const sensor_msgs::PointCloud2ConstPtr &pcl_msg, const TopicPair *pair)
+{
+    /// < only the header is allocated, the cloud is shared with the input message
+    PointCloud2Envelope::Ptr pcl_out_msg = boost::make_shared<PointCloud2Envelope>();
+    pcl_out_msg->header = pcl_msg->header;
+    pcl_out_msg->header.frame_id = pair->prefix + pcl_msg->header.frame_id;
+    pcl_out_msg->cloud = pcl_msg;
+    pair->pub.publish(pcl_out_msg);
+}
+
+} // namespace tf_remapper
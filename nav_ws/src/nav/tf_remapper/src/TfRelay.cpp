@@ -0,0 +1,224 @@
+/**
+* This file is part of the ROS package tf_remapper which belongs to the framework 3DMR. 
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> 
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <TfRelay.h>
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <XmlRpcValue.h>
+
+
+namespace tf_remapper
+{
+
+template<typename T>
+T getParam(ros::NodeHandle& n, const std::string& name, const T& defaultValue)
+{
+    T v;
+    if (n.getParam(name, v))
+    {
+        ROS_INFO_STREAM("Found parameter: " << name << ", value: " << v);
+        return v;
+    }
+    else
+    {
+        ROS_WARN_STREAM("Cannot find value for parameter: " << name << ", assigning default: " << defaultValue);
+    }
+    return defaultValue;
+}
+
+static std::string getStringMember(XmlRpc::XmlRpcValue& item, const std::string& name, const std::string& defaultValue)
+{
+    if (item.hasMember(name) && item[name].getType() == XmlRpc::XmlRpcValue::TypeString)
+    {
+        return static_cast<std::string>(item[name]);
+    }
+    return defaultValue;
+}
+
+static std::string removeLeadingSlash(const std::string& name)
+{
+    return (!name.empty() && name[0] == '/') ? name.substr(1) : name;
+}
+
+TfRelay::TfRelay(const ros::NodeHandle &nh, const ros::NodeHandle &nh_private)
+: nh_(nh)
+, nh_private_(nh_private)
+{
+    /// < get parameters
+    const std::string output_tf_topic = getParam<std::string>(nh_private_, "output_tf_topic", "/tf");
+    const std::string output_tf_static_topic = getParam<std::string>(nh_private_, "output_tf_static_topic", "/tf_static");
+    const double publish_rate = getParam<double>(nh_private_, "publish_rate", 50.);
+    const double max_frame_rate = getParam<double>(nh_private_, "max_frame_rate", 0.);
+    min_frame_period_ = (max_frame_rate > 0) ? ros::Duration(1./max_frame_rate) : ros::Duration(0.);
+
+    std::vector<std::string> blacklist;
+    nh_private_.getParam("blacklist", blacklist);
+    for (size_t i = 0; i < blacklist.size(); i++)
+    {
+        blacklist_.insert(removeLeadingSlash(blacklist[i]));
+    }
+
+    /// < publishers
+    tf_pub_ = nh_.advertise<tf2_msgs::TFMessage>(output_tf_topic, 100);
+    tf_static_pub_ = nh_.advertise<tf2_msgs::TFMessage>(output_tf_static_topic, 100, true);
+
+    /// < subscribers
+    XmlRpc::XmlRpcValue sources;
+    if (nh_private_.getParam("sources", sources) && sources.getType() == XmlRpc::XmlRpcValue::TypeArray)
+    {
+        for (int i = 0; i < sources.size(); i++)
+        {
+            XmlRpc::XmlRpcValue& item = sources[i];
+            if (item.getType() != XmlRpc::XmlRpcValue::TypeStruct)
+            {
+                ROS_ERROR_STREAM("TfRelay - sources[" << i << "] is not a struct, skipping it");
+                continue;
+            }
+            const std::string tf_topic = getStringMember(item, "tf", "");
+            if (tf_topic.empty())
+            {
+                ROS_ERROR_STREAM("TfRelay - sources[" << i << "] needs a tf topic, skipping it");
+                continue;
+            }
+            addSource(tf_topic, getStringMember(item, "tf_static", ""), getStringMember(item, "prefix", ""));
+        }
+    }
+    else
+    {
+        /// < same defaults of the tf_prefixer script
+        addSource("/tf_old", "/tf_static_old", getParam<std::string>(nh_private_, "prefix", "remapped/"));
+    }
+
+    publish_timer_ = nh_.createTimer(ros::Duration(1./std::max(publish_rate, 1e-3)), &TfRelay::publishTimerCallback, this);
+}
+
+void TfRelay::addSource(const std::string &tf_topic, const std::string &tf_static_topic, const std::string &prefix)
+{
+    boost::shared_ptr<Source> source = boost::make_shared<Source>();
+    source->prefix = removeLeadingSlash(prefix);
+
+    source->tf_sub = nh_.subscribe<tf2_msgs::TFMessage>(tf_topic, 100,
+                        boost::bind(&TfRelay::tfCallback, this, _1, source.get()));
+    if (!tf_static_topic.empty())
+    {
+        source->tf_static_sub = nh_.subscribe<tf2_msgs::TFMessage>(tf_static_topic, 100,
+                                    boost::bind(&TfRelay::tfStaticCallback, this, _1, source.get()));
+    }
+
+    ROS_INFO_STREAM("TfRelay - source " << tf_topic << " " << tf_static_topic << " with prefix '" << source->prefix << "'");
+    sources_.push_back(source);
+}
+
+const std::string& TfRelay::remapFrame(Source &source, const std::string &frame)
+{
+    std::unordered_map<std::string, std::string>::iterator it = source.remapped_frames.find(frame);
+    if (it == source.remapped_frames.end())
+    {
+        const std::string name = removeLeadingSlash(frame);
+        const std::string remapped = (blacklist_.count(name) > 0) ? name : source.prefix + name;
+        it = source.remapped_frames.emplace(frame, remapped).first;
+    }
+    return it->second;
+}
+
+void TfRelay::tfCallback(const tf2_msgs::TFMessageConstPtr &msg, Source *source)
+{
+    for (size_t i = 0; i < msg->transforms.size(); i++)
+    {
+        const geometry_msgs::TransformStamped& transform = msg->transforms[i];
+        const std::string& child_frame = remapFrame(*source, transform.child_frame_id);
+
+        FrameState& state = frames_[child_frame];
+        if (state.pending && transform.header.stamp < state.transform.header.stamp)
+        {
+            continue; // older than the one waiting to be published
+        }
+
+        /// < overwrite the stored transform: its strings keep their capacity
+        state.transform.header.seq = transform.header.seq;
+        state.transform.header.stamp = transform.header.stamp;
+        state.transform.header.frame_id = remapFrame(*source, transform.header.frame_id);
+        state.transform.child_frame_id = child_frame;
+        state.transform.transform = transform.transform;
+        if (!state.pending)
+        {
+            state.pending = true;
+            pending_frames_.push_back(&state);
+        }
+    }
+}
+
+void TfRelay::tfStaticCallback(const tf2_msgs::TFMessageConstPtr &msg, Source *source)
+{
+    for (size_t i = 0; i < msg->transforms.size(); i++)
+    {
+        const geometry_msgs::TransformStamped& transform = msg->transforms[i];
+        geometry_msgs::TransformStamped& out = static_transforms_[remapFrame(*source, transform.child_frame_id)];
+        out = transform;
+        out.header.frame_id = remapFrame(*source, transform.header.frame_id);
+        out.child_frame_id = remapFrame(*source, transform.child_frame_id);
+    }
+    static_transforms_changed_ = true;
+}
+
+void TfRelay::publishTimerCallback(const ros::TimerEvent &event)
+{
+    const ros::Time time_now = ros::Time::now();
+
+    /// < batch the updated transforms of all the sources into a single message
+    tf_out_msg_.transforms.clear();
+    size_t num_still_pending = 0;
+    for (size_t i = 0; i < pending_frames_.size(); i++)
+    {
+        FrameState* state = pending_frames_[i];
+        if (!state->last_pub_time.isZero() && (time_now - state->last_pub_time) < min_frame_period_)
+        {
+            pending_frames_[num_still_pending++] = state; // rate limited, publish it in a next cycle
+            continue;
+        }
+        tf_out_msg_.transforms.push_back(state->transform);
+        state->last_pub_time = time_now;
+        state->pending = false;
+    }
+    pending_frames_.resize(num_still_pending);
+
+    if (!tf_out_msg_.transforms.empty())
+    {
+        tf_pub_.publish(tf_out_msg_);
+    }
+
+    if (static_transforms_changed_)
+    {
+        tf2_msgs::TFMessage tf_static_msg;
+        tf_static_msg.transforms.reserve(static_transforms_.size());
+        for (std::unordered_map<std::string, geometry_msgs::TransformStamped>::const_iterator it = static_transforms_.begin(); it != static_transforms_.end(); ++it)
+        {
+            tf_static_msg.transforms.push_back(it->second);
+        }
+        tf_static_pub_.publish(tf_static_msg);
+        static_transforms_changed_ = false;
+    }
+}
+
+} // namespace tf_remapper
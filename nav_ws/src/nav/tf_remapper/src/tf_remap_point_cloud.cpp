@@ -18,43 +18,10 @@
 * along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
 */
 
-#include <ros/ros.h>
-#include <tf/tf.h>
-
-#include <pcl/point_types.h>
-#include <pcl/point_cloud.h>
-#include <pcl/conversions.h>
-#include <pcl_ros/transforms.h>
-#include <pcl_ros/point_cloud.h>
-
-
-std::string robot_name;
-std::string prefix; 
-
-ros::Publisher pcl_pub;
 
-template<typename T>
-T getParam(ros::NodeHandle& n, const std::string& name, const T& defaultValue)
-{
-    T v;
-    if (n.getParam(name, v))
-    {
-        ROS_INFO_STREAM("Found parameter: " << name << ", value: " << v);
-        return v;
-    }
-    else
-    {
-        ROS_WARN_STREAM("Cannot find value for parameter: " << name << ", assigning default: " << defaultValue);
-    }
-    return defaultValue;
-}
+#include <ros/ros.h>
 
-void pointCloudCallback(const sensor_msgs::PointCloud2& pcl_msg)
-{
-    sensor_msgs::PointCloud2 pcl_out_msg = pcl_msg;
-    pcl_out_msg.header.frame_id = prefix + pcl_msg.header.frame_id;
-    pcl_pub.publish(pcl_out_msg);
-}
+#include <PointCloudFrameRemapper.h>
 
 
 /// < this runs on robot, it receives a point cloud and changes its header so at to have a robot_name prefix
@@ -62,17 +29,10 @@ int main(int argc, char** argv)
 {
     ros::init(argc, argv, "tf_remap_point_cloud"); 
     
-    ros::NodeHandle n("~");
+    ros::NodeHandle n;
+    ros::NodeHandle n_private("~");
     
-    /// < get parameters
-    robot_name = getParam<std::string>(n, "robot_name", "ugv1");
-    prefix = "/" + robot_name + "/";
-    
-    /// < subscribers 
-    ros::Subscriber pcl_sub = n.subscribe("/input_topic", 1, &pointCloudCallback);
-
-    /// < publishers 
-    pcl_pub =  n.advertise<sensor_msgs::PointCloud2>("/output_topic", 1, true);
+    tf_remapper::PointCloudFrameRemapper remapper(n, n_private);
     
     ros::spin();
     return 0;
@@ -0,0 +1,56 @@
+/**
+* This file is part of the ROS package tf_remapper which belongs to the framework 3DMR. 
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> 
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <memory>
+
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+
+#include <PointCloudFrameRemapper.h>
+
+namespace tf_remapper
+{
+
+///	\class TfRemapPointCloudNodelet
+///	\author Luigi Freda
+///	\brief Nodelet version of tf_remap_point_cloud: the input clouds are received by pointer from the nodelets
+///        in the same manager and one instance can serve the clouds of several robots (see PointCloudFrameRemapper).
+///	\note
+/// \todo
+///	\date
+///	\warning
+class TfRemapPointCloudNodelet : public nodelet::Nodelet
+{
+public:
+    TfRemapPointCloudNodelet() {}
+
+private:
+    virtual void onInit()
+    {
+        remapper_.reset(new PointCloudFrameRemapper(getNodeHandle(), getPrivateNodeHandle()));
+    }
+
+    std::unique_ptr<PointCloudFrameRemapper> remapper_;
+};
+
+} // namespace tf_remapper
+
+PLUGINLIB_EXPORT_CLASS(tf_remapper::TfRemapPointCloudNodelet, nodelet::Nodelet)
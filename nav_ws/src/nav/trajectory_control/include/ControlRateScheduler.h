@@ -0,0 +1,98 @@
+/**
+* This file is part of the ROS package trajectory_control which belongs to the framework 3DMR. 
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> 
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once 
+
+#include <vector>
+
+#include <ros/ros.h>
+#include <nav_msgs/Path.h>
+#include <geometry_msgs/Point.h>
+
+
+///	\class ControlRateScheduler
+///	\author Luigi Freda
+///	\brief Adaptive control frequency for the path tracking loop: the rate is raised (up to max_freq) on fast or high-curvature segments 
+///        and lowered (down to min_freq) when the robot is idle or in pure rotation; on the other segments the nominal frequency is used. 
+///        The lookahead samples along the path (arc length and max curvature within the lookahead distance ahead of each node) 
+///        are precomputed once when the path is set and then just indexed by the current reference position. 
+///	\note sleep() replaces ros::Rate::sleep() (which cannot change its period) 
+/// 	\todo 
+///	\date
+///	\warning
+class ControlRateScheduler
+{
+public:
+    
+    static const double kFrequencyHysteresis; // [frac %] min relative change for switching the frequency (avoids chattering) 
+    static const double kIdleLinearVel; // [m/s] below this the robot is considered not translating 
+    static const double kIdleAngularVel; // [rad/s] below this the robot is considered not rotating 
+    
+public:
+    
+    ControlRateScheduler();
+    
+    /// set the frequencies [Hz] and the references: the max frequency is reached at vel_ref [m/s] or at curvature_ref [1/m] ahead 
+    void init(double nominal_freq, double min_freq, double max_freq, double vel_ref, double curvature_ref, double lookahead_distance);
+    
+    /// precompute the lookahead samples of the path 
+    void setPath(const nav_msgs::Path& path);
+    
+    /// update the frequency from the reference velocity, the current commands and the reference position; return the new control period [s]
+    double update(double ref_vel, double linear_vel, double angular_vel, const geometry_msgs::Point& ref_position);
+    
+    /// sleep for the rest of the current period (same semantics of ros::Rate::sleep()) 
+    bool sleep();
+    
+    /// restart the cycle timing (to be called before the first cycle of a control loop)
+    void reset();
+    
+public: // getters 
+    
+    double getFrequency() const { return freq_; }
+    double getPeriod() const { return 1./freq_; }
+    
+    /// max curvature within the lookahead distance ahead of the current path node 
+    double getCurvatureAhead() const { return (i_node_ < curvature_ahead_.size()) ? curvature_ahead_[i_node_] : 0.; }
+    
+protected: 
+    
+    /// advance the current path node towards the reference position (monotonic search in a window ahead) 
+    void updatePathNode(const geometry_msgs::Point& ref_position);
+    
+protected: 
+    
+    double nominal_freq_; 
+    double min_freq_;
+    double max_freq_;
+    double vel_ref_; 
+    double curvature_ref_; 
+    double lookahead_distance_; 
+    
+    double freq_; // current frequency 
+    
+    ros::Time cycle_start_; 
+    
+    // lookahead samples of the path in SoA layout (computed in setPath())
+    std::vector<double> path_x_, path_y_; 
+    std::vector<double> path_s_; // cumulative arc length at each node 
+    std::vector<double> curvature_ahead_; // max |curvature| of the nodes in [s_i, s_i + lookahead_distance_]
+    size_t i_node_; // current node 
+};
@@ -21,6 +21,7 @@
 #pragma once 
 
 #include <iostream>
+#include <vector>
 #include <math.h>
 
 #include <ros/ros.h>
@@ -137,8 +138,9 @@ protected:
 
 ///	\class PathManagerKdt
 ///	\author Luigi Freda
-///	\brief 
-///	\note
+///	\brief  path manager which re-syncs the path index with the closest path node to the robot
+///	\note   the closest node is tracked monotonically in a window ahead of the last one (arc length kTrackingWindowLength);
+///	        the kd-tree is queried only when the robot is not close to the window (large jump or off-path robot)
 /// 	\todo 
 ///	\date
 ///	\warning
@@ -149,19 +151,88 @@ public:
     typedef pcl::PointCloud<PointNode> PointCloudNodes;
     typedef pp::KdTreeFLANN<PointNode> KdTreeNodes;  
     
+    static const double kTrackingWindowLength; // [m] arc length of the tracking window 
+    static const size_t kTrackingWindowMaxSize; // max number of nodes in the tracking window 
+    
 public:
     
-    PathManagerKdt(){}
+    PathManagerKdt():i_closest_(0){}
     
     /// Init
-    void init(double Ts, double vel, double rise_time, const nav_msgs::Path& path_in);
+    void init(double Ts, double vel, double rise_time, const nav_msgs::Path& path_in, const PathSmoother::PathSmootherType& smoother_type=PathSmoother::kNoSmoother);
 
     /// basic step for generating next ref point 
     /// return true when done 
     bool step(const double current_time);
     
+protected: 
+    
+    /// find the closest path node to the robot: window ahead of i_closest_ first, then the kd-tree; return the squared distance  
+    float findClosestNode(size_t& index);
+    
+    /// search the closest node in the tracking window; return false if the window is empty 
+    bool searchTrackingWindow(size_t& index, float& squared_distance) const;
+      
 protected: 
       
     PointCloudNodes plc_points_;
     KdTreeNodes     kdtree_points_;         
+    
+    // path data in SoA layout (size N: nodes, size N-1: segments)
+    std::vector<float> path_x_, path_y_, path_z_; // node positions 
+    std::vector<float> path_s_; // cumulative arc length at each node 
+    std::vector<float> tangent_x_, tangent_y_, tangent_z_; // unit tangent of segment [i,i+1] (zero for degenerate segments)
+    std::vector<float> segment_length_; // length of segment [i,i+1]
+    
+    size_t i_closest_; // last tracked closest node 
+};
+
+
+///	\class PathManagerTimed
+///	\author Luigi Freda
+///	\brief  path manager which precomputes the whole reference trajectory when a path is received:
+///	        the (smoothed) path is time-parameterized with the start velocity ramp (acceleration vel/rise_time) and a curvature velocity limit
+///	        (|omega| <= max angular velocity) and sampled once every Ts in contiguous arrays; step() just advances the trajectory time by 
+///	        the current Ts (see setTs()) and interpolates the samples
+///	\note   as in PathManager, the trajectory time does not advance when step() is not called (e.g. while waiting for the tracking error to decrease)
+/// 	\todo 
+///	\date
+///	\warning
+class PathManagerTimed: public PathManager
+{
+public:
+    
+    static const double kMinVelFraction; // minimum reference velocity (fraction of the cruise velocity) for the time parameterization 
+    
+public:
+    
+    PathManagerTimed(double max_angular_vel):max_angular_vel_(max_angular_vel), d_time_(0), d_sample_Ts_(0){}
+    
+    /// Init
+    void init(double Ts, double vel, double rise_time, const nav_msgs::Path& path_in, const PathSmoother::PathSmootherType& smoother_type=PathSmoother::kNoSmoother);
+
+    /// basic step for generating next ref point 
+    /// return true when done 
+    bool step(const double current_time);
+    
+    double getMaxAngularVel() const { return max_angular_vel_; }
+    void setMaxAngularVel(double max_angular_vel) { max_angular_vel_ = max_angular_vel; }
+    
+protected: 
+    
+    /// compute the velocity profile on the path nodes and sample the trajectory every d_Ts_
+    void buildTrajectory(double rise_time);
+      
+protected: 
+    
+    double max_angular_vel_; // [rad/s] curvature velocity limit: v <= max_angular_vel_/|curvature| 
+    
+    double d_time_; // trajectory time [s]
+    double d_sample_Ts_; // sampling period of the trajectory samples (d_Ts_ at init time) 
+    
+    // trajectory samples in SoA layout: sample k is at time k*d_sample_Ts_ 
+    std::vector<double> traj_x_, traj_y_, traj_z_; 
+    std::vector<double> traj_yaw_; 
+    std::vector<double> traj_vel_; // linear velocity 
+    std::vector<double> traj_omega_; // angular velocity 
 };
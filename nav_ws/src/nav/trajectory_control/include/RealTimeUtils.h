@@ -0,0 +1,202 @@
+/**
+* This file is part of the ROS package trajectory_control which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <ros/ros.h>
+
+#include <boost/thread.hpp>
+#include <boost/core/noncopyable.hpp>
+
+
+/// set the SCHED_FIFO policy with the given priority on the calling thread; return false if it is not permitted (e.g. missing CAP_SYS_NICE or rtprio limit)
+inline bool setRealTimePriority(int priority)
+{
+    sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = priority;
+    const int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (err != 0)
+    {
+        ROS_WARN("setRealTimePriority() - cannot set SCHED_FIFO priority %d: %s", priority, strerror(err));
+        return false; /// < EXIT POINT
+    }
+    ROS_INFO("setRealTimePriority() - SCHED_FIFO priority %d", priority);
+    return true;
+}
+
+
+///	\class TripleBuffer
+///	\author Luigi Freda
+///	\brief Lock-free latest-value snapshot between one writer thread and one reader thread.
+///	       The writer fills its own buffer and swaps it with the middle one; the reader swaps the middle buffer with its own
+///	       only when a new value has been written. Neither side ever waits for the other one.
+///	\note
+/// 	\todo
+///	\date
+///	\warning single producer, single consumer
+template <typename T>
+class TripleBuffer: private boost::noncopyable
+{
+    static const uint8_t kIndexMask = 0x3;
+    static const uint8_t kDirtyFlag = 0x4;
+
+public:
+
+    TripleBuffer():state_(1), write_index_(0), read_index_(2), b_read_valid_(false) {}
+
+    /// writer side
+    void write(const T& value)
+    {
+        buffers_[write_index_] = value;
+        const uint8_t prev = state_.exchange(write_index_ | kDirtyFlag, std::memory_order_acq_rel);
+        write_index_ = prev & kIndexMask;
+    }
+
+    /// reader side: get the last written value; return false if nothing has been written yet
+    bool read(T& value)
+    {
+        if (state_.load(std::memory_order_relaxed) & kDirtyFlag)
+        {
+            const uint8_t prev = state_.exchange(read_index_, std::memory_order_acq_rel);
+            read_index_ = prev & kIndexMask;
+            b_read_valid_ = true;
+        }
+        if (!b_read_valid_) return false; /// < EXIT POINT
+        value = buffers_[read_index_];
+        return true;
+    }
+
+protected:
+
+    T buffers_[3];
+    std::atomic<uint8_t> state_; // index of the middle buffer | dirty flag
+    uint8_t write_index_; // used only by the writer
+    uint8_t read_index_;  // used only by the reader
+    bool b_read_valid_;   // used only by the reader
+};
+
+
+///	\class DeferredLogger
+///	\author Luigi Freda
+///	\brief Logger for real-time loops: log() formats the message into a preallocated lock-free ring buffer (no lock, no I/O, no allocation)
+///	       and a background thread prints it with ROS_INFO. When the ring buffer is full the messages are dropped (and counted).
+///	\note
+/// 	\todo
+///	\date
+///	\warning single producer: log() must be called by one thread only
+class DeferredLogger: private boost::noncopyable
+{
+public:
+
+    static const size_t kRingCapacity = 256; // (power of 2)
+    static const size_t kMessageSize = 256;
+    static const int kDrainPeriodMs = 50;
+
+public:
+
+    DeferredLogger():ring_(kRingCapacity), head_(0), tail_(0), num_dropped_(0), b_running_(false) {}
+
+    ~DeferredLogger() { stop(); }
+
+    void start()
+    {
+        if (b_running_) return; /// < EXIT POINT
+        b_running_ = true;
+        thread_ = boost::thread(&DeferredLogger::drainLoop, this);
+    }
+
+    void stop()
+    {
+        if (!b_running_) return; /// < EXIT POINT
+        b_running_ = false;
+        thread_.join();
+        drain();
+    }
+
+    void log(const char* format, ...)
+    {
+        va_list args;
+        va_start(args, format);
+        vlog(format, args);
+        va_end(args);
+    }
+
+    void vlog(const char* format, va_list args)
+    {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) >= kRingCapacity)
+        {
+            num_dropped_.fetch_add(1, std::memory_order_relaxed);
+            return; /// < EXIT POINT
+        }
+        vsnprintf(ring_[head & (kRingCapacity - 1)].text, kMessageSize, format, args);
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+protected:
+
+    struct Message
+    {
+        char text[kMessageSize];
+    };
+
+    void drainLoop()
+    {
+        while (b_running_)
+        {
+            drain();
+            boost::this_thread::sleep_for(boost::chrono::milliseconds(int(kDrainPeriodMs)));
+        }
+    }
+
+    void drain()
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t head = head_.load(std::memory_order_acquire);
+        for (; tail != head; tail++)
+        {
+            ROS_INFO("%s", ring_[tail & (kRingCapacity - 1)].text);
+        }
+        tail_.store(tail, std::memory_order_release);
+
+        const size_t num_dropped = num_dropped_.exchange(0, std::memory_order_relaxed);
+        if (num_dropped > 0) ROS_WARN("DeferredLogger - dropped %zu messages", num_dropped);
+    }
+
+protected:
+
+    std::vector<Message> ring_;
+    std::atomic<size_t> head_; // written only by the producer
+    std::atomic<size_t> tail_; // written only by the background thread
+    std::atomic<size_t> num_dropped_;
+
+    std::atomic<bool> b_running_;
+    boost::thread thread_;
+};
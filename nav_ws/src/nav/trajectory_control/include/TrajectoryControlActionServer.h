@@ -51,6 +51,10 @@
 #include "PathManager.h"
 #include "LowPassFilter.h"
 #include "CmdVels.h"
+#include "RealTimeUtils.h"
+#include "ControlRateScheduler.h"
+
+#include <path_planner/LatencyTracer.h>
 
 template<typename T>
 T getParam(ros::NodeHandle& n, const std::string& name, const T& defaultValue)
@@ -86,6 +90,13 @@ public:
         kNonLinear = 1
     }; 
     
+    // robot pose computed from the odometry (see imuOdomCallback()) 
+    struct RobotPoseSnapshot
+    {
+        tf::Transform robot_pose_map; 
+        ros::Time stamp; 
+    };
+    
 public:
     
     static const double kTrackDistance; // [m] distance between tracks 
@@ -117,6 +128,7 @@ public:
     
     static const int kDefaultControlLaw; // default control law (should be one in the ControlLawType list)
     static const double kDefaultControlFrequency; // [Hz] default control frequency 
+    static const int kDefaultRtControlPriority; // default SCHED_FIFO priority of the control thread (real-time control)
     static const double kMaxTrackVelocity; // [m/s] maximum track velocity 
     static const double kMaxTrackVelocityOnRotation; //[m/s]  maximum track velocity in m/s on rotations 
     static const double kMaxAngularVelocity; //[rad/s]  maximum angular velocity 
@@ -173,6 +185,8 @@ protected:
     std::string tracks_vel_cmd_topic_;
     ros::Publisher tracks_vel_cmd_pub_;
 
+    LatencyTracer latency_tracer_; // from the received robot path to the first velocity command
+
     tf::StampedTransform tf_robot_pose_map_;
     tf::StampedTransform tf_robot_pose_odom_;
     tf::StampedTransform tf_odom_to_map_;
@@ -202,6 +216,8 @@ protected:
     double kw_CR_; // for Cartesian regulation  
     double kw_; // gain for pure rotational control 
     double control_frequency_;
+    bool adaptive_control_frequency_; // if true the control frequency of the path tracking is adapted to the path segment (see ControlRateScheduler)
+    ControlRateScheduler control_rate_scheduler_; 
     ControlLawType control_law_type_;
 
     double ref_error_for_stopping_path_manager_step; 
@@ -315,6 +331,17 @@ protected: /// < queue controller stuff
 
     std::atomic<bool> need_start_vel_ramp_ = {true}; // need to use vel ramp? 
 
+protected: /// < real-time control stuff 
+    
+    bool rt_control_; // if true: SCHED_FIFO control thread, robot pose from the odometry snapshot, deferred logging 
+    int rt_control_priority_; // SCHED_FIFO priority of the control thread 
+    bool b_rt_priority_set_; 
+    
+    TripleBuffer<RobotPoseSnapshot> robot_pose_snapshot_; // written by imuOdomCallback(), read by the control loop 
+    tf::StampedTransform tf_snapshot_odom_to_map_; // used only by imuOdomCallback() 
+    
+    DeferredLogger deferred_logger_; // per-cycle logs of the control loop 
+
     bool enable_flippers_ = true; 
         
     int robot_id_; 
@@ -322,7 +349,8 @@ protected: /// < queue controller stuff
 
 public:
     
-    TrajectoryControlActionServer(std::string);
+    // param_node is the private node handle (the one of the nodelet in a nodelet manager)
+    TrajectoryControlActionServer(std::string name, const ros::NodeHandle& param_node = ros::NodeHandle("~"));
     ~TrajectoryControlActionServer();
     
     // convert and odo msg to stamped transform 
@@ -408,6 +436,15 @@ protected: /// < other functions
     
     void executeRotation(const trajectory_control_msgs::TrajectoryControlGoalConstPtr&);
     
+    // update tf_robot_pose_map_ and tf_robot_poseB_map_ at each control step: from the odometry snapshot with real-time control, from TF otherwise
+    void updateRobotPose();
+    
+    // compute the robot pose in the map frame from the odometry and write it in robot_pose_snapshot_ (real-time control)
+    void updateRobotPoseSnapshot(const nav_msgs::OdometryConstPtr& msg);
+    
+    // log from the control loop (deferred with real-time control)
+    void logControl(const char* format, ...);
+    
     void checkLaserProximityAndUpdateVelocity();
     
     void tipOverAxis(tf::StampedTransform&, tf::StampedTransform&, tf::StampedTransform&, tf::StampedTransform&, std::vector<double>&);
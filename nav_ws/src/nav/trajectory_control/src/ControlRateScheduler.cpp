@@ -0,0 +1,175 @@
+/**
+* This file is part of the ROS package trajectory_control which belongs to the framework 3DMR. 
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> 
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ControlRateScheduler.h"
+
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <math.h>
+
+#include "SignalUtils.h"
+
+
+const double ControlRateScheduler::kFrequencyHysteresis = 0.1; // [frac %] min relative change for switching the frequency (avoids chattering) 
+const double ControlRateScheduler::kIdleLinearVel = 0.01; // [m/s] below this the robot is considered not translating 
+const double ControlRateScheduler::kIdleAngularVel = 0.01; // [rad/s] below this the robot is considered not rotating 
+
+ControlRateScheduler::ControlRateScheduler():
+nominal_freq_(10), min_freq_(10), max_freq_(10), vel_ref_(1), curvature_ref_(1), lookahead_distance_(1), freq_(10), i_node_(0)
+{
+}
+
+void ControlRateScheduler::init(double nominal_freq, double min_freq, double max_freq, double vel_ref, double curvature_ref, double lookahead_distance)
+{
+    nominal_freq_ = nominal_freq; 
+    min_freq_ = std::min(min_freq, nominal_freq); 
+    max_freq_ = std::max(max_freq, nominal_freq);
+    vel_ref_ = std::max(vel_ref, std::numeric_limits<double>::epsilon());
+    curvature_ref_ = std::max(curvature_ref, std::numeric_limits<double>::epsilon());
+    lookahead_distance_ = std::max(lookahead_distance, 0.);
+    
+    freq_ = nominal_freq_; 
+}
+
+void ControlRateScheduler::setPath(const nav_msgs::Path& path)
+{
+    path_x_.clear();
+    path_y_.clear();
+    path_s_.clear();
+    curvature_ahead_.clear();
+    i_node_ = 0; 
+    
+    // path nodes (coincident points are skipped, as in PathManager::step()) 
+    path_x_.reserve(path.poses.size());
+    path_y_.reserve(path.poses.size());
+    path_s_.reserve(path.poses.size());
+    for(size_t i=0; i<path.poses.size(); i++)
+    {
+        const double x = path.poses[i].pose.position.x;
+        const double y = path.poses[i].pose.position.y;
+        if(!path_x_.empty())
+        {
+            const double length = sqrt(pow(x - path_x_.back(), 2) + pow(y - path_y_.back(), 2));
+            if(length < 1e-4) continue; 
+            path_s_.push_back(path_s_.back() + length);
+        }
+        else
+        {
+            path_s_.push_back(0.);
+        }
+        path_x_.push_back(x);
+        path_y_.push_back(y);
+    }
+    
+    const size_t num_nodes = path_x_.size();
+    if(num_nodes == 0) return; /// < EXIT POINT
+    
+    // curvature at the nodes: turning angle over the mean length of the adjacent segments 
+    std::vector<double> curvature(num_nodes, 0.);
+    for(size_t i=1; i+1<num_nodes; i++)
+    {
+        const double yaw_prev = atan2(path_y_[i] - path_y_[i-1], path_x_[i] - path_x_[i-1]);
+        const double yaw_next = atan2(path_y_[i+1] - path_y_[i], path_x_[i+1] - path_x_[i]);
+        const double mean_length = 0.5*(path_s_[i+1] - path_s_[i-1]);
+        curvature[i] = fabs(diffS1(yaw_next, yaw_prev))/mean_length;
+    }
+    
+    // max curvature in [s_i, s_i + lookahead_distance_]: sliding window maximum (monotonic deque) visiting the nodes backwards 
+    curvature_ahead_.resize(num_nodes);
+    std::deque<size_t> window; // node indices with decreasing curvature from front to back, front is the farthest node 
+    for(size_t k=num_nodes; k-- > 0; )
+    {
+        while(!window.empty() && curvature[window.back()] <= curvature[k]) window.pop_back();
+        window.push_back(k);
+        while(path_s_[window.front()] > path_s_[k] + lookahead_distance_) window.pop_front();
+        curvature_ahead_[k] = curvature[window.front()];
+    }
+}
+
+void ControlRateScheduler::updatePathNode(const geometry_msgs::Point& ref_position)
+{
+    const size_t num_nodes = path_x_.size();
+    if(i_node_ >= num_nodes) return; /// < EXIT POINT
+    
+    // the reference moves forward along the path: search the closest node in a window ahead of the current one 
+    const double s_end = path_s_[i_node_] + 2*lookahead_distance_;
+    double min_squared_distance = pow(ref_position.x - path_x_[i_node_], 2) + pow(ref_position.y - path_y_[i_node_], 2);
+    for(size_t i=i_node_+1; (i<num_nodes) && (path_s_[i] <= s_end); i++)
+    {
+        const double squared_distance = pow(ref_position.x - path_x_[i], 2) + pow(ref_position.y - path_y_[i], 2);
+        if(squared_distance < min_squared_distance)
+        {
+            min_squared_distance = squared_distance;
+            i_node_ = i; 
+        }
+    }
+}
+
+double ControlRateScheduler::update(double ref_vel, double linear_vel, double angular_vel, const geometry_msgs::Point& ref_position)
+{
+    updatePathNode(ref_position);
+    
+    double target_freq = min_freq_; 
+    
+    const double vel = std::max(fabs(linear_vel), fabs(ref_vel));
+    const bool b_pure_rotation = (fabs(linear_vel) < kIdleLinearVel) && (fabs(angular_vel) > kIdleAngularVel);
+    if( !b_pure_rotation && (vel >= kIdleLinearVel) )
+    {
+        const double demand = std::min(std::max(vel/vel_ref_, getCurvatureAhead()/curvature_ref_), 1.);
+        target_freq = nominal_freq_ + demand*(max_freq_ - nominal_freq_);
+    }
+    
+    if(fabs(target_freq - freq_) > kFrequencyHysteresis*freq_)
+    {
+        freq_ = target_freq; 
+    }
+    
+    return getPeriod();
+}
+
+void ControlRateScheduler::reset()
+{
+    cycle_start_ = ros::Time::now();
+}
+
+bool ControlRateScheduler::sleep()
+{
+    const ros::Duration period(getPeriod());
+    ros::Time expected_cycle_end = cycle_start_ + period;
+    const ros::Time now = ros::Time::now();
+    
+    // detect backward jumps in time 
+    if(now < cycle_start_)
+    {
+        expected_cycle_end = now + period;
+    }
+    
+    const ros::Duration sleep_time = expected_cycle_end - now;
+    if(sleep_time <= ros::Duration(0.0))
+    {
+        // if we have overrun by more than a full cycle, restart the timing from now 
+        cycle_start_ = (now > expected_cycle_end + period) ? now : expected_cycle_end;
+        return false; /// < EXIT POINT
+    }
+    
+    cycle_start_ = expected_cycle_end;
+    return sleep_time.sleep();
+}
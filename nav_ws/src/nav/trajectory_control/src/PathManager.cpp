@@ -19,6 +19,7 @@
 */
 
 #include <limits>
+#include <algorithm>
 #include <visualization_msgs/MarkerArray.h>
 
 #include "PathManager.h"
@@ -42,6 +43,11 @@ ros::Publisher debugTrajPointsPub;
 
 const double PathManager::kDistanceToRecomputeIndex = 0.2;
 
+const double PathManagerKdt::kTrackingWindowLength = 2.0; // [m]
+const size_t PathManagerKdt::kTrackingWindowMaxSize = 200;
+
+const double PathManagerTimed::kMinVelFraction = 0.05;
+
 
 PathManager::PathManager() : b_init_(false), b_jump_point_(false), b_end_(true), d_Ts_(0), d_vel_lin_(0), d_vel_ang_(0), d_yaw_last_(0), d_step_offset_(0), i_index_(0), d_estimated_time_(0), d_estimated_distance_(0), smoother_type_(PathSmoother::kNoSmoother)
 {
@@ -124,6 +130,12 @@ void PathManager::init(double Ts, double vel, double rise_time, const nav_msgs::
         }
     }
     d_estimated_time_ = ((fabs(d_vel_lin_) > std::numeric_limits<double>::epsilon()) ? d_estimated_distance_ / d_vel_lin_ : 0);
+    
+    // preallocate the output path: one pose for each nominal step vel*Ts plus the jumped input poses 
+    if((fabs(d_vel_lin_*d_Ts_) > std::numeric_limits<double>::epsilon()))
+    {
+        path_out_.poses.reserve((size_t)(d_estimated_distance_ / fabs(d_vel_lin_*d_Ts_)) + input_path_length);
+    }
 
 
     ROS_INFO("PathManager::init() - #points: %ld, estimated time: %f, estimated distance: %f", path_in_.poses.size(), d_estimated_time_, d_estimated_distance_);
@@ -391,13 +403,13 @@ void PathManager::setRobotPosition(double x, double y, double z)
 // =============================================================================
 
 /// Init
-void PathManagerKdt::init(double Ts, double vel,  double rise_time, const nav_msgs::Path& path_in)
+void PathManagerKdt::init(double Ts, double vel,  double rise_time, const nav_msgs::Path& path_in, const PathSmoother::PathSmootherType& smoother_type)
 {    
     boost::recursive_mutex::scoped_lock locker(mutex_);   
  
     ROS_INFO("PathManagerKdt::init()");
         
-    PathManager::init(Ts, vel, rise_time, path_in);
+    PathManager::init(Ts, vel, rise_time, path_in, smoother_type);
     
     size_t input_path_length = path_in_.poses.size(); 
     
@@ -408,6 +420,16 @@ void PathManagerKdt::init(double Ts, double vel,  double rise_time, const nav_ms
     
     plc_points_.clear(); 
     
+    path_x_.resize(input_path_length);
+    path_y_.resize(input_path_length);
+    path_z_.resize(input_path_length);
+    path_s_.resize(input_path_length);
+    tangent_x_.assign(input_path_length-1, 0.f);
+    tangent_y_.assign(input_path_length-1, 0.f);
+    tangent_z_.assign(input_path_length-1, 0.f);
+    segment_length_.assign(input_path_length-1, 0.f);
+    i_closest_ = 0;
+    
     PointNode point; 
     for(size_t i=0; i<input_path_length;i++)
     {
@@ -416,26 +438,102 @@ void PathManagerKdt::init(double Ts, double vel,  double rise_time, const nav_ms
         point.z     = path_in_.poses[i].pose.position.z;
         point.label = i;
         plc_points_.push_back(point);
+        
+        path_x_[i] = point.x;
+        path_y_[i] = point.y;
+        path_z_[i] = point.z;
+        path_s_[i] = 0.f;
+        if(i > 0)
+        {
+            const float dx = path_x_[i] - path_x_[i-1];
+            const float dy = path_y_[i] - path_y_[i-1];
+            const float dz = path_z_[i] - path_z_[i-1];
+            const float length = sqrt(dx*dx + dy*dy + dz*dz);
+            segment_length_[i-1] = length;
+            if(length > std::numeric_limits<float>::epsilon())
+            {
+                tangent_x_[i-1] = dx/length;
+                tangent_y_[i-1] = dy/length;
+                tangent_z_[i-1] = dz/length;
+            }
+            path_s_[i] = path_s_[i-1] + length;
+        }
     }
     kdtree_points_.setInputCloud(plc_points_.makeShared());    
     
 }
 
+bool PathManagerKdt::searchTrackingWindow(size_t& index, float& squared_distance) const
+{
+    const size_t num_nodes = path_x_.size();
+    if(i_closest_ >= num_nodes) return false; /// < EXIT POINT
+    
+    const float rx = robot_position_.x, ry = robot_position_.y, rz = robot_position_.z;
+    const float s_end = path_s_[i_closest_] + kTrackingWindowLength;
+    const size_t i_end = std::min(num_nodes - 1, i_closest_ + kTrackingWindowMaxSize);
+    
+    // first node of the window 
+    index = i_closest_;
+    {
+        const float dx = rx - path_x_[index], dy = ry - path_y_[index], dz = rz - path_z_[index];
+        squared_distance = dx*dx + dy*dy + dz*dz;
+    }
+    
+    // project the robot on each segment [i,i+1] of the window and take the node closest to the projection 
+    for(size_t i = i_closest_; i < i_end; i++)
+    {
+        if(path_s_[i] > s_end) break; /// < BREAK 
+        
+        const float dx = rx - path_x_[i], dy = ry - path_y_[i], dz = rz - path_z_[i];
+        const float t = dx*tangent_x_[i] + dy*tangent_y_[i] + dz*tangent_z_[i];
+        const size_t j = (t > 0.5f*segment_length_[i]) ? i + 1 : i;
+        
+        const float jx = rx - path_x_[j], jy = ry - path_y_[j], jz = rz - path_z_[j];
+        const float d2 = jx*jx + jy*jy + jz*jz;
+        if(d2 < squared_distance)
+        {
+            squared_distance = d2;
+            index = j;
+        }
+    }
+    return true;
+}
+
+float PathManagerKdt::findClosestNode(size_t& index)
+{
+    float squared_distance = std::numeric_limits<float>::max();
+    const double max_squared_distance = kDistanceToRecomputeIndex*kDistanceToRecomputeIndex;  
+    
+    if(searchTrackingWindow(index, squared_distance) && (squared_distance <= max_squared_distance))
+    {
+        i_closest_ = index; 
+        return squared_distance; /// < EXIT POINT
+    }
+    
+    // large jump or off-path robot: global search 
+    std::vector<int> pointIdxSearch(1);
+    std::vector<float> pointSquaredDistance(1,std::numeric_limits<float>::max());
+    if(kdtree_points_.nearestKSearch(robot_position_, 1, pointIdxSearch, pointSquaredDistance) > 0)
+    {
+        index = plc_points_[pointIdxSearch[0]].label; 
+        squared_distance = pointSquaredDistance[0];
+        i_closest_ = index; 
+    }
+    return squared_distance;
+}
+
 /// basic step for generating next ref point 
 /// return true when done 
 bool PathManagerKdt::step(const double current_time)
 {
-    std::vector<int> pointIdxSearch(1);
-    std::vector<float> pointSquaredDistance(1,std::numeric_limits<float>::max());
-    
     // check if we have to override the i_index_ 
-    if( i_index_ < (path_in_.poses.size()-1) ) 
+    if( (i_index_ + 1) < path_in_.poses.size() ) 
     {   
-        //int n_found = kdtree_points_.radiusSearch(robot_position_,kDistanceToRecomputeIndex,pointIdxSearch,pointSquaredDistance);
-        int n_found = kdtree_points_.nearestKSearch(robot_position_, 1, pointIdxSearch, pointSquaredDistance);
+        size_t closest_index = 0;
+        const float closest_squared_dist = findClosestNode(closest_index);
                
-        PointNode& closest_point = plc_points_[pointIdxSearch[0]];
-        double closest_dist = sqrt(pointSquaredDistance[0]);
+        PointNode& closest_point = plc_points_[closest_index];
+        double closest_dist = sqrt(closest_squared_dist);
         
         if(closest_dist > kDistanceToRecomputeIndex)
         {
@@ -475,7 +573,199 @@ bool PathManagerKdt::step(const double current_time)
         }   
     }
     
-    PathManager::step(ros::Time::now().toSec());
+    return PathManager::step(ros::Time::now().toSec());
+}
+
+
+
+// =============================================================================
+
+/// Init
+void PathManagerTimed::init(double Ts, double vel, double rise_time, const nav_msgs::Path& path_in, const PathSmoother::PathSmootherType& smoother_type)
+{
+    boost::recursive_mutex::scoped_lock locker(mutex_);   
+ 
+    ROS_INFO("PathManagerTimed::init()");
+    
+    PathManager::init(Ts, vel, rise_time, path_in, smoother_type);
+    
+    d_time_ = 0; 
+    d_sample_Ts_ = d_Ts_; 
+    traj_x_.clear();
+    traj_y_.clear();
+    traj_z_.clear();
+    traj_yaw_.clear();
+    traj_vel_.clear();
+    traj_omega_.clear();
+    
+    if(b_end_) return; /// < EXIT POINT (empty path) 
+    
+    buildTrajectory(rise_time); 
+    
+    ROS_INFO("PathManagerTimed::init() - #samples: %zu, estimated time: %f", traj_x_.size(), d_estimated_time_);
+}
+
+void PathManagerTimed::buildTrajectory(double rise_time)
+{
+    const double cruise_vel = fabs(d_vel_lin_);
+    if( (cruise_vel < std::numeric_limits<double>::epsilon()) || (d_sample_Ts_ <= 0) )
+    {
+        b_end_ = true; 
+        return; /// < EXIT POINT
+    }
+    const double min_vel = kMinVelFraction*cruise_vel;  
+    const double acc = (rise_time > 0) ? cruise_vel/rise_time : std::numeric_limits<double>::max(); // the start ramp of VelRamp
+    
+    // path nodes (coincident points are skipped, as in PathManager::step()) 
+    std::vector<double> x, y, z; 
+    for(size_t i = 0, iEnd = path_in_.poses.size(); i < iEnd; i++)
+    {
+        const geometry_msgs::Point& p = path_in_.poses[i].pose.position; 
+        if(!x.empty() && FEQUAL(x.back(), p.x, 1e-4) && FEQUAL(y.back(), p.y, 1e-4)) continue; /// < CONTINUE
+        x.push_back(p.x);
+        y.push_back(p.y);
+        z.push_back(p.z);
+    }
+    const size_t num_nodes = x.size(); 
+    
+    if(num_nodes < 2)
+    {
+        traj_x_.push_back(x[0]);
+        traj_y_.push_back(y[0]);
+        traj_z_.push_back(z[0]);
+        traj_yaw_.push_back(0);
+        traj_vel_.push_back(0);
+        traj_omega_.push_back(0);
+        d_estimated_time_ = 0; 
+        return; /// < EXIT POINT
+    }
+    
+    // segments [i,i+1]: length and yaw
+    const size_t num_segments = num_nodes - 1; 
+    std::vector<double> length(num_segments), yaw(num_segments);
+    for(size_t i = 0; i < num_segments; i++)
+    {
+        const double dx = x[i+1] - x[i], dy = y[i+1] - y[i], dz = z[i+1] - z[i];
+        length[i] = sqrt(dx*dx + dy*dy + dz*dz);
+        yaw[i]    = atan2(dy, dx);
+    }
+    
+    // velocity profile on the nodes: curvature limit, then acceleration limits (forward: start ramp, backward: slow down before the curves) 
+    std::vector<double> vel(num_nodes, cruise_vel);
+    for(size_t i = 1; i < num_segments; i++)
+    {
+        const double curvature = fabs(diffS1(yaw[i], yaw[i-1]))/(0.5*(length[i-1] + length[i])); 
+        if(curvature*cruise_vel > max_angular_vel_) vel[i] = std::max(max_angular_vel_/curvature, min_vel);
+    }
+    vel[0] = (rise_time > 0) ? 0. : vel[0];
+    for(size_t i = 0; i < num_segments; i++)
+    {
+        vel[i+1] = std::min(vel[i+1], sqrt(vel[i]*vel[i] + 2.*acc*length[i]));
+    }
+    for(size_t i = num_segments; i > 1; i--)
+    {
+        vel[i-1] = std::min(vel[i-1], sqrt(vel[i]*vel[i] + 2.*acc*length[i-1]));
+    }
+    
+    // sample the trajectory every d_sample_Ts_ (constant acceleration on each segment)
+    const size_t num_samples_reserve = (size_t)((d_estimated_distance_/cruise_vel + rise_time)/d_sample_Ts_) + num_nodes; // the curves may need more 
+    traj_x_.reserve(num_samples_reserve);
+    traj_y_.reserve(num_samples_reserve);
+    traj_z_.reserve(num_samples_reserve);
+    traj_yaw_.reserve(num_samples_reserve);
+    traj_vel_.reserve(num_samples_reserve);
+    
+    double segment_time_start = 0; // time at node i 
+    double time = 0; 
+    for(size_t i = 0; i < num_segments; i++)
+    {
+        const double v0 = std::max(vel[i], (i==0) ? 0. : min_vel); 
+        const double v1 = std::max(vel[i+1], min_vel); 
+        const double segment_time = 2.*length[i]/(v0 + v1); 
+        const double segment_acc = (v1 - v0)/segment_time; 
+        
+        for(; time < segment_time_start + segment_time; time = traj_x_.size()*d_sample_Ts_)
+        {
+            const double tau = time - segment_time_start; 
+            const double s = v0*tau + 0.5*segment_acc*tau*tau; 
+            const double alpha = (length[i] > 0) ? std::min(s/length[i], 1.) : 1.; 
+            traj_x_.push_back(x[i] + alpha*(x[i+1]-x[i]));
+            traj_y_.push_back(y[i] + alpha*(y[i+1]-y[i]));
+            traj_z_.push_back(z[i] + alpha*(z[i+1]-z[i]));
+            traj_yaw_.push_back(yaw[i]);
+            traj_vel_.push_back(v0 + segment_acc*tau);
+        }
+        segment_time_start += segment_time; 
+    }
+    
+    // last sample on the last node 
+    traj_x_.push_back(x.back());
+    traj_y_.push_back(y.back());
+    traj_z_.push_back(z.back());
+    traj_yaw_.push_back(yaw.back());
+    traj_vel_.push_back(vel.back());
+    
+    const size_t num_samples = traj_x_.size(); 
+    traj_omega_.assign(num_samples, 0.);
+    for(size_t k = 1; k < num_samples; k++)
+    {
+        traj_omega_[k] = diffS1(traj_yaw_[k], traj_yaw_[k-1])/d_sample_Ts_;
+    }
+    
+    d_estimated_time_ = (num_samples - 1)*d_sample_Ts_; 
 }
 
+bool PathManagerTimed::step(const double current_time)
+{
+    boost::recursive_mutex::scoped_lock locker(mutex_);     
+    if (!b_init_)
+    {
+        ROS_ERROR("PathManagerTimed::step() - you did not init!");
+        b_end_ = true;
+        d_vel_ang_ = 0; 
+        
+        return b_end_; /// < EXIT POINT 
+    }
+    
+    const size_t num_samples = traj_x_.size(); 
+    if(num_samples == 0)
+    {
+        b_end_ = true;
+        d_vel_ang_ = 0; 
+        return b_end_; /// < EXIT POINT 
+    }
+    
+    d_time_ += d_Ts_; // the control period (it may differ from the sampling period with an adaptive control frequency)
+    
+    // interpolate the samples k and k+1 
+    const double ks = d_time_/d_sample_Ts_;
+    size_t k = (size_t)floor(ks);
+    double alpha = ks - k; 
+    if(k + 1 >= num_samples)
+    {
+        k = num_samples - 1;
+        alpha = 0; 
+    }
+    const size_t k1 = std::min(k + 1, num_samples - 1); 
+    
+    path_out_.poses.push_back(current_pose_);
+    
+    current_pose_.header = path_in_.poses.back().header;
+    current_pose_.pose.position.x = traj_x_[k] + alpha*(traj_x_[k1] - traj_x_[k]);
+    current_pose_.pose.position.y = traj_y_[k] + alpha*(traj_y_[k1] - traj_y_[k]);
+    current_pose_.pose.position.z = traj_z_[k] + alpha*(traj_z_[k1] - traj_z_[k]);
+    
+    const double yaw = traj_yaw_[k] + alpha*diffS1(traj_yaw_[k1], traj_yaw_[k]);
+    current_pose_.pose.orientation = tf::createQuaternionMsgFromYaw(yaw);
+    
+    d_vel_curr_ = traj_vel_[k] + alpha*(traj_vel_[k1] - traj_vel_[k]);
+    d_vel_ang_  = traj_omega_[k1];
+    d_yaw_last_ = yaw; 
+    
+    b_end_ = (k == num_samples - 1); 
+    
+    sendMarkers();
+    
+    return b_end_;
+}
 
@@ -19,7 +19,9 @@
 */
 
 #include <math.h> 
+#include <stdarg.h>
 #include <TrajectoryControlActionServer.h>
+#include <mr3d_profiling/ProfilerExporter.h>
 
 #include <nifti_teleop/Acquire.h>
 #include <nifti_teleop/Release.h>
@@ -45,6 +47,7 @@ const double TrajectoryControlActionServer::kLaserProximityReducedVelocityResetT
 
 const int TrajectoryControlActionServer::kDefaultControlLaw = TrajectoryControlActionServer::kInputOutputFL; //kNonLinear; // default control law (should be one in the ControlLawType list)
 const double TrajectoryControlActionServer::kDefaultControlFrequency = 15; //[Hz]  default control frequency 
+const int TrajectoryControlActionServer::kDefaultRtControlPriority = 80; // default SCHED_FIFO priority of the control thread 
 //const double TrajectoryControlActionServer::kMinimumWaitingTimeforANewPath = 0.5; // [s] minimum time to wait for giving a new path as input 
 const double TrajectoryControlActionServer::kTimeOutTolerance = 10; // [s] this time will be added to the expected trajectory execution time in order to define a time out
 
@@ -76,8 +79,8 @@ const double TrajectoryControlActionServer::kFinalRefErrorForStoppingTrajControl
 
 const std::string TrajectoryControlActionServer::kTeleopMuxPriorityName = "/nav/cmd_vel"; 
 
-TrajectoryControlActionServer::TrajectoryControlActionServer(std::string name) :
-param_node_("~"),
+TrajectoryControlActionServer::TrajectoryControlActionServer(std::string name, const ros::NodeHandle& param_node) :
+param_node_(param_node),
 action_name(name),
 act_server_(node_, name, boost::bind(&TrajectoryControlActionServer::executeCallback, this, _1), false),
 act_client_(name, true),
@@ -110,7 +113,10 @@ b_local_path_(false),
 b_simple_rotation_(false),
 b_decreased_vel_(false),
 use_max_angular_vel_check_(false),
-velocity_before_reduction_(0.)
+velocity_before_reduction_(0.),
+rt_control_(false),
+rt_control_priority_(kDefaultRtControlPriority),
+b_rt_priority_set_(false)
 {
 
     /// <  get parameters 
@@ -119,13 +125,25 @@ velocity_before_reduction_(0.)
     robot_id_ = atoi(str_robot_name_.substr(3,str_robot_name_.size()).c_str()) - 1;
 
     std::string simulator_name  = getParam<std::string>(param_node_, "simulator", "");   /// < multi-robot
+
+    if (getParam<bool>(param_node_, "enable_profiler", false))
+    {
+        mr3d_profiling::ProfilerExporter::instance().start(param_node_, getParam<std::string>(param_node_, "profiler_stats_file", std::string()));
+    }
+    if (getParam<bool>(param_node_, "enable_latency_tracing", false)) latency_tracer_.init(param_node_, "trajectory_control");
     
     bool b_use_at  = getParam<bool>(param_node_, "use_at", false);   /// < use adaptive traversability    
+    bool b_use_timed_trajectory = getParam<bool>(param_node_, "use_timed_trajectory", false);   /// < precompute the reference trajectory when a path is received 
     if(b_use_at)
     {
         p_path_manager_.reset(new PathManagerKdt);
         ROS_INFO_STREAM("TrajectoryControlActionServer() - using ADAPTIVE TRAVERSABILITY!");
     }
+    else if(b_use_timed_trajectory)
+    {
+        p_path_manager_.reset(new PathManagerTimed(getParam<double>(param_node_, "max_angular_vel", kMaxAngularVelocity)));
+        ROS_INFO_STREAM("TrajectoryControlActionServer() - using precomputed timed trajectory");
+    }
     else
     {
         p_path_manager_.reset(new PathManager);        
@@ -162,6 +180,20 @@ velocity_before_reduction_(0.)
     kw_CR_ = getParam<double>(param_node_, "gain_kw_CR", kDefaultControlGainKw_CR);
     kw_ = getParam<double>(param_node_, "gain_kw", kDefaultAngularGainKw);
     control_frequency_ = getParam<double>(param_node_, "control_frequency", kDefaultControlFrequency);
+    adaptive_control_frequency_ = getParam<bool>(param_node_, "adaptive_control_frequency", false);
+    if(adaptive_control_frequency_)
+    {
+        const double min_control_frequency = getParam<double>(param_node_, "min_control_frequency", 0.5*control_frequency_);
+        const double max_control_frequency = getParam<double>(param_node_, "max_control_frequency", 2.0*control_frequency_);
+        const double control_rate_vel_ref = getParam<double>(param_node_, "control_rate_vel_ref", kMaxTrackVelocity); // [m/s] max frequency at this velocity 
+        const double control_rate_curvature_ref = getParam<double>(param_node_, "control_rate_curvature_ref", 2.0); // [1/m] max frequency at this curvature ahead 
+        const double control_rate_lookahead = getParam<double>(param_node_, "control_rate_lookahead", 1.0); // [m] 
+        control_rate_scheduler_.init(control_frequency_, min_control_frequency, max_control_frequency, control_rate_vel_ref, control_rate_curvature_ref, control_rate_lookahead);
+    }
+    
+    rt_control_ = getParam<bool>(param_node_, "rt_control", false);
+    rt_control_priority_ = getParam<int>(param_node_, "rt_control_priority", kDefaultRtControlPriority);
+    if(rt_control_) deferred_logger_.start();
 
     imu_odom_topic_ = getParam<std::string>(param_node_, "imu_odom_topic", "/imu_odom");
     tracks_vel_cmd_topic_ = getParam<std::string>(param_node_, "tracks_vel_cmd_topic", "/tracks_vel_cmd");
@@ -414,6 +446,7 @@ bool TrajectoryControlActionServer::getRobotPose2(tf::StampedTransform& robot_po
 
 void TrajectoryControlActionServer::resampleAndSmoothPath(const nav_msgs::Path& path_in, nav_msgs::Path& path_out)
 {
+    PROFILE_ZONE("control/resample_and_smooth_path");
     double vel = cruise_vel_;
     ros::Rate rate(control_frequency_);
     double time_step = rate.expectedCycleTime().nsec / 1e9; // durata dell'intervallo temporale
@@ -519,8 +552,9 @@ void TrajectoryControlActionServer::resampleAndSmoothPath(const nav_msgs::Path&
 // cruise_vel_, global_plan_msg_.poses[index], poseB, velB
 void TrajectoryControlActionServer::buildReferenceTrajectory(double vel_ref, const geometry_msgs::PoseStamped& pose_ref, geometry_msgs::Pose& pose_ref_B, geometry_msgs::Twist& vel_ref_B)
 {
+    PROFILE_ZONE("control/build_reference_trajectory");
 #if VERBOSE
-    std::cout <<  "TrajectoryControlActionServer::buildReferenceTrajectory()" << std::endl; 
+    logControl("TrajectoryControlActionServer::buildReferenceTrajectory()");
 #endif 
 
     pose_ref_B = pose_ref.pose; // the reference trajectory is applied on point B as is
@@ -548,7 +582,7 @@ double TrajectoryControlActionServer::computeControlLawIOLin(const tf::StampedTr
     if ((fabs(error_yaw) > kRefAngularErrorForPureRotationControl) && (error_xy > kRefXYErrorForPureRotationControl))
     {
 #if VERBOSE
-        std::cout << "computeControlLawIOLin() - pure rotational control " << std::endl;
+        logControl("computeControlLawIOLin() - pure rotational control");
 #endif
         // pure rotational control 
         linear_vel = 0;
@@ -557,7 +591,7 @@ double TrajectoryControlActionServer::computeControlLawIOLin(const tf::StampedTr
     else
     {
 #if VERBOSE
-        std::cout << "computeControlLawIOLin() - normal control - 2D err:  " << error_xy << std::endl;
+        logControl("computeControlLawIOLin() - normal control - 2D err: %f", error_xy);
 #endif
         double cyaw = cos(yaw);
         double syaw = sin(yaw);
@@ -613,7 +647,7 @@ double TrajectoryControlActionServer::computeControlLawPosition(const tf::Stampe
     if ((fabs(err_yaw) > kRefAngularErrorForPureRotationControl) && (error_xy > kRefXYErrorForPureRotationControl))
     {
 #if VERBOSE
-        std::cout << "computeControlLawPosition() - pure rotational control " << std::endl;
+        logControl("computeControlLawPosition() - pure rotational control");
 #endif
         // pure rotational control 
         linear_vel  = 0;
@@ -622,7 +656,7 @@ double TrajectoryControlActionServer::computeControlLawPosition(const tf::Stampe
     else
     {
 #if VERBOSE
-        std::cout << "computeControlLawPosition() - normal control - 2D err:  " << error_xy << std::endl;
+        logControl("computeControlLawPosition() - normal control - 2D err: %f", error_xy);
 #endif
 
         linear_vel = kv * (err_x * cos(yaw) + err_y * sin(yaw));
@@ -668,7 +702,7 @@ double TrajectoryControlActionServer::computeControlLawNonLin(const tf::StampedT
     if ((fabs(error_yaw) > kRefAngularErrorForPureRotationControl) && (error_xy > kRefXYErrorForPureRotationControl) )
     {
 #if VERBOSE
-        std::cout << "computeControlLawNonLin() - pure rotational control " << std::endl;
+        logControl("computeControlLawNonLin() - pure rotational control");
 #endif
         // pure rotational control 
         linear_vel = 0;
@@ -695,7 +729,7 @@ double TrajectoryControlActionServer::computeControlLawNonLin(const tf::StampedT
         double u2 = -k2 * vd * sinc(e3) * e2 - k3*e3;
         
 #if VERBOSE
-        std::cout << "computeControlLawNonLin() - normal control - 2D err:  " << error_xy << ", k1=k3: " << k1 << std::endl;
+        logControl("computeControlLawNonLin() - normal control - 2D err: %f, k1=k3: %f", error_xy, k1);
 #endif        
 
         linear_vel  = vd * cos(e3) - u1;
@@ -723,7 +757,7 @@ double TrajectoryControlActionServer::computeControlLawNonLin(const tf::StampedT
 double TrajectoryControlActionServer::computeControlLawRotation(const tf::StampedTransform& tf_robot_pose, const geometry_msgs::Pose& ref_pose, const geometry_msgs::Twist& ref_vel, double& linear_vel, double& angular_vel)
 {
 #if VERBOSE
-    std::cout <<  "TrajectoryControlActionServer::computeControlLawRotation()" << std::endl; 
+    logControl("TrajectoryControlActionServer::computeControlLawRotation()");
 #endif 
 
     double roll, pitch, yaw;
@@ -734,7 +768,7 @@ double TrajectoryControlActionServer::computeControlLawRotation(const tf::Stampe
     if (fabs(error_yaw) >= kAngularErrorThreshold)
     {
 #if VERBOSE
-        std::cout << "computeControlLawRotation() - pure rotational control - yaw error:  " << error_yaw << std::endl;
+        logControl("computeControlLawRotation() - pure rotational control - yaw error: %f", error_yaw);
 #endif
         // pure rotational control 
         linear_vel = 0;
@@ -778,13 +812,13 @@ void TrajectoryControlActionServer::getTracksVelCmd(double linear_vel, double an
         float clostest_obst_point_dist = sqrt(closest_obst_point.x()*closest_obst_point.x() + closest_obst_point.y()*closest_obst_point.y());
         double  distance_from_robot    = std::max(clostest_obst_point_dist - kRobotRadius, 0.f);
 #if VERBOSE        
-        ROS_INFO_STREAM("getTracksVelCmd() - distance  from robot: " << distance_from_robot); 
+        logControl("getTracksVelCmd() - distance  from robot: %f", distance_from_robot);
 #endif
         if ( (distance_from_robot >= 0.) && (distance_from_robot < kProximityDistanceThreshold) )
         {
             float obst_point_unit_vecx = (clostest_obst_point_dist > 0.f) ? closest_obst_point.x()/clostest_obst_point_dist : 1.; // this is 'cos(theta)' where theta is the relative direction to the obstacle point 
             double theta = acos(obst_point_unit_vecx);
-            std::cout << "getTracksVelCmd() - theta: " << 180./M_PI * theta << std::endl;
+            logControl("getTracksVelCmd() - theta: %f", 180./M_PI * theta);
             if(theta < kProximityActiveAngle)
             {
                 float vel_towards_obst     = obst_point_unit_vecx * linear_vel; // this is 'v * cos(theta)'
@@ -892,6 +926,12 @@ void TrajectoryControlActionServer::imuDataCallback(const sensor_msgs::ImuConstP
 
 void TrajectoryControlActionServer::imuOdomCallback(const nav_msgs::OdometryConstPtr& msg)
 {
+    if(rt_control_)
+    {
+        updateRobotPoseSnapshot(msg);
+        return; /// < EXIT POINT 
+    }
+    
     boost::recursive_mutex::scoped_lock locker(tf_robot_pose_map_mutex);
         
     odomMsgToStampedTransform(*msg, tf_robot_pose_odom_);
@@ -941,10 +981,76 @@ void TrajectoryControlActionServer::imuOdomCallback(const nav_msgs::OdometryCons
     getRealRobotPoseB(displacement_, tf_robot_pose_map_, tf_robot_poseB_map_);
 }
 
+void TrajectoryControlActionServer::updateRobotPoseSnapshot(const nav_msgs::OdometryConstPtr& msg)
+{
+    tf::StampedTransform robot_pose_odom;
+    odomMsgToStampedTransform(*msg, robot_pose_odom);
+    
+    // the odom-to-map transform changes slowly: take the last one without waiting, the odometry gives the rest  
+    try
+    {
+        tf_listener_.lookupTransform(global_frame_id_, odom_frame_id_, ros::Time(0), tf_snapshot_odom_to_map_);
+    }
+    catch (tf::TransformException& ex)
+    {
+        ROS_WARN_THROTTLE(5, "TrajectoryControlActionServer::updateRobotPoseSnapshot() - cannot get odom-to-map transform: %s", ex.what());
+        if(tf_snapshot_odom_to_map_.frame_id_.empty()) return; /// < EXIT POINT 
+    }
+    
+    RobotPoseSnapshot snapshot;
+    snapshot.robot_pose_map = tf_snapshot_odom_to_map_ * robot_pose_odom;
+    snapshot.stamp = msg->header.stamp;
+    robot_pose_snapshot_.write(snapshot);
+}
+
+void TrajectoryControlActionServer::updateRobotPose()
+{
+    RobotPoseSnapshot snapshot;
+    if(rt_control_ && robot_pose_snapshot_.read(snapshot))
+    {
+        boost::recursive_mutex::scoped_lock locker(tf_robot_pose_map_mutex);
+        tf_robot_pose_map_.setData(snapshot.robot_pose_map);
+        tf_robot_pose_map_.stamp_ = snapshot.stamp;
+        getRealRobotPoseB(displacement_, tf_robot_pose_map_, tf_robot_poseB_map_);
+        return; /// < EXIT POINT 
+    }
+    
+    // no odometry snapshot: look up TF 
+    while (!getRobotPose(tf_robot_pose_odom_, tf_robot_pose_map_, tf_odom_to_map_))
+    {
+        ROS_INFO("Waiting for transformation");
+    }
+    getRealRobotPoseB(displacement_, tf_robot_pose_map_, tf_robot_poseB_map_);
+}
+
+void TrajectoryControlActionServer::logControl(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    if(rt_control_)
+    {
+        deferred_logger_.vlog(format, args);
+    }
+    else
+    {
+        char text[DeferredLogger::kMessageSize];
+        vsnprintf(text, sizeof(text), format, args);
+        std::cout << text << std::endl;
+    }
+    va_end(args);
+}
+
 void TrajectoryControlActionServer::executeCallback(const trajectory_control_msgs::TrajectoryControlGoalConstPtr &goal_msg)
 {
     boost::recursive_mutex::scoped_lock locker(action_mutex);
     
+    // the action server runs the goals in its own thread: make it real-time once
+    if(rt_control_ && !b_rt_priority_set_)
+    {
+        setRealTimePriority(rt_control_priority_);
+        b_rt_priority_set_ = true;
+    }
+    
     if(b_simple_rotation_)
     {
         executeRotation(goal_msg);
@@ -982,6 +1088,12 @@ void TrajectoryControlActionServer::executeCallback(const trajectory_control_msg
     double actual_rise_time = rise_time_;
     if(!need_start_vel_ramp_) actual_rise_time = 0; // check if we need or not a starting vel ramp 
     p_path_manager_->init(timestep, cruise_vel_, actual_rise_time, goal_msg->path, path_smoother_type);
+    
+    if(adaptive_control_frequency_)
+    {
+        control_rate_scheduler_.setPath(p_path_manager_->getPathIn()); // precompute the lookahead samples once 
+        control_rate_scheduler_.reset();
+    }
 
     smoothed_path_pub_.publish(p_path_manager_->getPathIn()); // the input path may have been smoothed depending on the input parameters
 
@@ -1025,13 +1137,7 @@ void TrajectoryControlActionServer::executeCallback(const trajectory_control_msg
     {
         checkLaserProximityAndUpdateVelocity();
                 
-#if 1        
-        while (!getRobotPose(tf_robot_pose_odom_, tf_robot_pose_map_, tf_odom_to_map_))
-        {
-            ROS_INFO("Waiting for transformation");
-        }
-        getRealRobotPoseB(displacement_, tf_robot_pose_map_, tf_robot_poseB_map_);
-#endif 
+        updateRobotPose();
                 
         //ROS_INFO(" ---- cycle step ----  ");
         if (act_server_.isPreemptRequested() || !ros::ok())
@@ -1072,7 +1178,7 @@ void TrajectoryControlActionServer::executeCallback(const trajectory_control_msg
         else
         {
 #if VERBOSE
-            ROS_INFO("Computing commands vel....");
+            logControl("Computing commands vel....");
             //ROS_INFO("Timestep [%f]",timestep);
             //ROS_INFO("Duration [%f]",duration);
             //ROS_INFO("Counter [%f]",counter);
@@ -1095,7 +1201,7 @@ void TrajectoryControlActionServer::executeCallback(const trajectory_control_msg
             }
             else
             {
-                ROS_WARN_STREAM("TrajectoryControlActionServer::executeCallback() - waiting error decreasing for doing next step - 2D err: " << current_track_error_xy);
+                logControl("TrajectoryControlActionServer::executeCallback() - waiting error decreasing for doing next step - 2D err: %f", current_track_error_xy);
             }
 
             geometry_msgs::PoseStamped pose_ref = p_path_manager_->getCurrentPose();
@@ -1164,8 +1270,21 @@ void TrajectoryControlActionServer::executeCallback(const trajectory_control_msg
             sendVelCommands(tracks_cmd, cmd_vels);
             
             
-            rate.sleep();
-            time_counter += timestep;
+            if(adaptive_control_frequency_)
+            {
+                control_rate_scheduler_.sleep();
+                time_counter += timestep;
+                
+                // set the period of the next cycle 
+                timestep = control_rate_scheduler_.update(curr_vel_, linear_vel_, angular_vel_, pose_ref.pose.position);
+                p_path_manager_->setTs(timestep);
+                feedback_msg_.timestep = timestep;
+            }
+            else
+            {
+                rate.sleep();
+                time_counter += timestep;
+            }
             index++;
         }
        
@@ -1277,13 +1396,7 @@ void TrajectoryControlActionServer::executeRotation(const trajectory_control_msg
     while (ros::ok() && !b_time_out && !b_path_end)
     {
 
-#if 1        
-        while (!getRobotPose(tf_robot_pose_odom_, tf_robot_pose_map_, tf_odom_to_map_))
-        {
-            ROS_INFO("Waiting for transformation");
-        }
-        getRealRobotPoseB(displacement_, tf_robot_pose_map_, tf_robot_poseB_map_);
-#endif 
+        updateRobotPose();
 
         //ROS_INFO(" ---- cycle step ----  ");
         if (act_server_.isPreemptRequested() || !ros::ok())
@@ -1415,6 +1528,8 @@ void TrajectoryControlActionServer::robotPathCallBack(const trajectory_control_m
     std::cout << "=============================================================" << std::endl;
     std::cout << "TrajectoryControlActionServer::robotPathCallBack()" << std::endl;
 
+    latency_tracer_.begin(msg->header.stamp); // the planner stamps the robot path with the stamp of the traversability cloud
+
     act_client_.waitForServer();
     trajectory_control_msgs::TrajectoryControlGoal track_goal;
     track_goal.path = msg->path;
@@ -1769,4 +1884,6 @@ void TrajectoryControlActionServer::sendVelCommands(const nifti_robot_driver_msg
     ang_cmd_msg.angular_velocity_left = cmd_vel.omegal_;
     ang_cmd_msg.angular_velocity_right = cmd_vel.omegar_;
     cmd_wheels_pub_.publish(ang_cmd_msg);
+
+    latency_tracer_.end();
 }
@@ -0,0 +1,55 @@
+/**
+* This file is part of the ROS package trajectory_control which belongs to the framework 3DMR. 
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <memory>
+
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+
+#include <TrajectoryControlActionServer.h>
+
+namespace trajectory_control
+{
+
+///	\class TrajectoryControlNodelet
+///	\author Luigi Freda
+///	\brief Nodelet version of trajectory_control: loaded in the nodelet manager of the path_planner nodelets 
+///        (see path_planner/launch/sim_nav_pipeline_nodelets.launch), the paths are received by pointer.
+///	\note  The action name is the name of the nodelet, as the one of the trajectory_control node.
+/// \todo
+///	\date
+///	\warning
+class TrajectoryControlNodelet : public nodelet::Nodelet
+{
+public:
+    TrajectoryControlNodelet() {}
+
+private:
+    virtual void onInit()
+    {
+        action_server_.reset(new TrajectoryControlActionServer(getName(), getPrivateNodeHandle()));
+    }
+
+    std::unique_ptr<TrajectoryControlActionServer> action_server_;
+};
+
+} // namespace trajectory_control
+
+PLUGINLIB_EXPORT_CLASS(trajectory_control::TrajectoryControlNodelet, nodelet::Nodelet)
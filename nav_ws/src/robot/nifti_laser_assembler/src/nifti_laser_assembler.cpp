@@ -12,6 +12,12 @@
 #include <pcl_ros/transforms.h>
 //#include <pcl/point_cloud.h>
 
+#include <string.h>
+#include <stdint.h>
+#include <arpa/inet.h>
+#include <vector>
+#include <algorithm>
+
 //typedef nifti_pcl_common::AssemblerPoint NiftiPoint;
 //typedef pcl::PointCloud<NiftiPoint> sensor_msgs::PointCloud2;
 
@@ -40,6 +46,10 @@ T getParam(ros::NodeHandle& n, const std::string& name, const T& defaultValue)
  * sensor_msgs/PointCloud2 messages.
  */
 class NiftiLaserAssembler {
+public:
+	//! Default max number of scans buffered in a sweep
+	static const int kDefaultMaxSweepScans = 500;
+
 public:
 	//! Constructor. ROS::init() is assumed to have been called before.
 	NiftiLaserAssembler();
@@ -82,11 +92,30 @@ protected:
 	//! Limit the size of the point cloud in points (default: 1000000).
 	int max_size;
 
-	//! Current aggregated point cloud
-	sensor_msgs::PointCloud2 point_cloud;
+	//! Scan of the current sweep with the laser pose in the robot frame at its time stamp
+	struct SweepScan {
+		std::vector<uint8_t> data;
+		ros::Time stamp;
+		tf::Transform laser_to_robot;
+	};
+
+	//! Preallocated buffer of the scans of the current sweep (the slots keep their capacity across the sweeps)
+	std::vector<SweepScan> sweep_scans;
+
+	//! Number of scans in the current sweep
+	size_t num_sweep_scans;
 
-	//! Temporary point cloud
-	sensor_msgs::PointCloud2 tmp_point_cloud;
+	//! Number of points in the current sweep
+	size_t num_sweep_points;
+
+	//! Point layout of the current sweep (taken from its first scan)
+	std::vector<sensor_msgs::PointField> sweep_fields;
+	uint32_t sweep_point_step;
+	uint32_t sweep_x_offset, sweep_y_offset, sweep_z_offset;
+	bool sweep_is_bigendian;
+
+	//! Current aggregated point cloud (published as a shared pointer and reused when no subscriber holds it anymore)
+	sensor_msgs::PointCloud2Ptr point_cloud;
 
 	//! Previous absolute value of the laser angle (to detect when to publish)
 	double previous_angle;
@@ -97,9 +126,6 @@ protected:
 	//! Starting time of the new scan
 	ros::Time start_time;
 
-	//! base_link transform at first time
-	tf::StampedTransform base_transform;
-
 	//! flag to invert scan for gmapping
 	bool using_gmapping;
 
@@ -127,14 +153,26 @@ protected:
 	//! Reprojection from PointCloud to LaserScan
 	void extract_LaserScan(const sensor_msgs::PointCloud2& ptcld);
 
-	//! Get the new scan in the point cloud
-	void append_scan(const sensor_msgs::PointCloud2& scan);
+	//! Store the new scan in the sweep buffer
+	void append_scan(const sensor_msgs::PointCloud2& scan, const tf::StampedTransform& laser_transform);
+
+	//! Deskew the buffered scans into the robot frame at the sweep start; return false if the sweep cannot be assembled
+	bool assemble_sweep(const ros::Time &end_time, bool& no_motion);
+
+	//! Clear the sweep buffer
+	void reset_sweep();
 	
 	//! Get laser angle from the tf
 	double get_laser_angle(const ros::Time &time) const;
 
-	//! Check if the robot moves
-	bool check_no_motion(const ros::Time &time) const;
+	//! Get laser angle and laser transform (in the robot frame) from the tf
+	double get_laser_angle(const ros::Time &time, tf::StampedTransform& laser_transform) const;
+
+	//! Get the robot pose in the world frame
+	bool get_robot_pose(const ros::Time &time, tf::StampedTransform& robot_pose) const;
+
+	//! Check if the robot moves between the two poses
+	bool check_no_motion(const tf::Transform& start_pose, const tf::Transform& end_pose, const ros::Duration& delta) const;
 
 	//! Subscriber to point cloud control (default topic: "/pointcloud_control")
 	ros::Subscriber ptcld_ctrl_sub;
@@ -162,6 +200,17 @@ NiftiLaserAssembler::NiftiLaserAssembler():
 	// max number of points
 	max_size = getParam<int>(n_, "max_size", 1000000);
 
+	// sweep buffer
+	const int max_sweep_scans = std::max(1, getParam<int>(n_, "max_sweep_scans", kDefaultMaxSweepScans));
+	sweep_scans.resize(max_sweep_scans);
+	num_sweep_scans = 0;
+	num_sweep_points = 0;
+	sweep_point_step = 0;
+	sweep_x_offset = 0;
+	sweep_y_offset = 4;
+	sweep_z_offset = 8;
+	sweep_is_bigendian = false;
+
 	using_gmapping = getParam<bool>(n_, "using_gmapping", false);
 
 	// 2d scans
@@ -246,8 +295,13 @@ void NiftiLaserAssembler::ptcld_ctrl_cb(const std_msgs::Bool& on)
  */
 double NiftiLaserAssembler::get_laser_angle(const ros::Time &time) const
 {
-	double angle;
 	tf::StampedTransform tmp_tf;
+	return get_laser_angle(time, tmp_tf);
+}
+
+double NiftiLaserAssembler::get_laser_angle(const ros::Time &time, tf::StampedTransform& tmp_tf) const
+{
+	double angle;
 	geometry_msgs::Quaternion rot;
 	if (!tf_listener.waitForTransform(robot_frame, laser_frame, time,
 		ros::Duration(1.))) {
@@ -272,32 +326,40 @@ double norm(const geometry_msgs::Vector3& vec3){
 	return sqrt(vec3.x*vec3.x+vec3.y*vec3.y+vec3.z*vec3.z);
 }
 /*
- * Decide if the robot was still
+ * Get the robot pose in the world frame
  */
-bool NiftiLaserAssembler::check_no_motion(const ros::Time &time) const
+bool NiftiLaserAssembler::get_robot_pose(const ros::Time &time, tf::StampedTransform& robot_pose) const
 {
-	// Checking with velocity but why not position?
-	geometry_msgs::Twist mean_speed;
-	ros::Duration delta = time - start_time;
-	if (delta>=ros::Duration(59.))
-		return false;
-	if (!tf_listener.waitForTransform(robot_frame, world_frame, time,
+	if (!tf_listener.waitForTransform(world_frame, robot_frame, time,
 		ros::Duration(1.))) {
 		ROS_WARN_STREAM("[NLA] Timeout (1s) while waiting between "<<robot_frame<<
-				" and "<<world_frame<<" before checking motion.");
+				" and "<<world_frame<<".");
 		return false;
 	}
 	try {
-		tf_listener.lookupTwist(robot_frame, world_frame, start_time+delta*0.5,
-				delta, mean_speed);
-	} catch (tf::ExtrapolationException) {
-		ROS_WARN_STREAM("[NLA] Couldn't get twist to check (no) motion.");
+		tf_listener.lookupTransform(world_frame, robot_frame, time, robot_pose);
+	} catch (tf::TransformException& e) {
+		ROS_WARN_STREAM("[NLA] Couldn't get robot pose: " << e.what());
 		return false;
 	}
-	ROS_DEBUG_STREAM("[NLA] Motion: " << norm(mean_speed.linear) << " m/s, " <<
-			norm(mean_speed.angular) << " Rad/s for "<<delta.toSec()<<" s"); 
-	return ((norm(mean_speed.linear)*delta.toSec()<0.02)&&
-			(norm(mean_speed.angular)*delta.toSec()<3*M_PI/180.));
+	return true;
+}
+
+/*
+ * Decide if the robot was still
+ */
+bool NiftiLaserAssembler::check_no_motion(const tf::Transform& start_pose, 
+		const tf::Transform& end_pose, const ros::Duration& delta) const
+{
+	// the mean twist over the sweep times its duration is the relative motion between the poses
+	if (delta>=ros::Duration(59.))
+		return false;
+	const tf::Transform motion = start_pose.inverseTimes(end_pose);
+	const double linear = motion.getOrigin().length();
+	const double angular = fabs(motion.getRotation().getAngleShortestPath());
+	ROS_DEBUG_STREAM("[NLA] Motion: " << linear << " m, " <<
+			angular << " Rad for "<<delta.toSec()<<" s"); 
+	return ((linear<0.02)&&(angular<3*M_PI/180.));
 }
 
 
@@ -423,9 +485,10 @@ void NiftiLaserAssembler::laserscan_cb(const sensor_msgs::LaserScan& scan)
 void NiftiLaserAssembler::scan_cb(const sensor_msgs::PointCloud2& scan)
 {
 	double angle;
+	tf::StampedTransform laser_transform;
 	try
 	{
-		angle = get_laser_angle(scan.header.stamp);
+		angle = get_laser_angle(scan.header.stamp, laser_transform);
 	} 
 	catch (tf::ExtrapolationException e) {
 		ROS_WARN_STREAM("[NLA] Could not resolve rotating angle of the laser.");
@@ -460,86 +523,204 @@ void NiftiLaserAssembler::scan_cb(const sensor_msgs::PointCloud2& scan)
 		//ROS_INFO_STREAM("[NLA] Got scan in range.");
 		if (start_time.isZero())
 			start_time = scan.header.stamp;
-		append_scan(scan);
+		append_scan(scan, laser_transform);
 
 	}
 
 	if ((fabs(previous_angle)<M_PI/2) &&
 			(fabs(angle)>=M_PI/2)) {
 		//ROS_INFO_STREAM("[NLA] End");
-		if (ptcld_ctrl_on){
-			// could decide to update time stamps here (but require a full
-			// transform)
+		bool no_motion = false;
+		if (!ptcld_ctrl_on) {
+			ROS_DEBUG_STREAM("[NLA] Dropping point cloud (disabled).");
+		} else if (assemble_sweep(scan.header.stamp, no_motion)) {
+			// the same cloud is handed to both publishers (no copy)
 			dynamic_point_cloud_pub.publish(point_cloud);
-			if (check_no_motion(scan.header.stamp)){
-				ROS_DEBUG_STREAM("[NLA] Publishing static point cloud (" << point_cloud.width << " points).");
+			if (no_motion){
+				ROS_DEBUG_STREAM("[NLA] Publishing static point cloud (" << point_cloud->width << " points).");
 				point_cloud_pub.publish(point_cloud);
 			} else {
 				ROS_DEBUG_STREAM("[NLA] Point cloud in motion.");
 			}
-		} else {
-			ROS_DEBUG_STREAM("[NLA] Dropping point cloud (disabled).");
 		}
-		point_cloud.data.clear();
-		point_cloud.width = 0;
-		start_time = ros::Time(0);
+		reset_sweep();
 	}
 
 	// if point cloud is full, we publish it
 	// TODO decide if relevant
-	if (point_cloud.width>=(unsigned)max_size) {
+	if (num_sweep_points>=(unsigned)max_size) {
 		ROS_WARN_STREAM("[NLA] Max_size exceeded, clearing.");
-		//point_cloud_pub.publish(point_cloud);
-		point_cloud.data.clear();
-		point_cloud.width = 0;
+		reset_sweep();
 	}
 	previous_angle = angle;
 }
 
 /*
- * Append a scan to the current point cloud
+ * Append a scan to the current sweep
  */
-void NiftiLaserAssembler::append_scan(const sensor_msgs::PointCloud2& scan)
+void NiftiLaserAssembler::append_scan(const sensor_msgs::PointCloud2& scan, 
+		const tf::StampedTransform& laser_transform)
 {
-	// Project the scan into the correct space and time reference
-	if (point_cloud.width<=0)
-	{
-		// transform into /base_link
-		if ((tf_listener.waitForTransform(robot_frame, scan.header.frame_id,
-				scan.header.stamp, ros::Duration(1)))&&
-			(tf_listener.waitForTransform(robot_frame, world_frame,
-				scan.header.stamp, ros::Duration(1)))) {
-			tf_listener.lookupTransform(robot_frame, scan.header.frame_id,
-					scan.header.stamp, base_transform);
-			pcl_ros::transformPointCloud(robot_frame, base_transform, scan,
-					point_cloud);
-			// set base transform for next scans
-			tf_listener.lookupTransform(robot_frame, world_frame,
-					scan.header.stamp, base_transform);
-		} else {
-			ROS_WARN_STREAM("[NLA] Could not initialize new point cloud with new scan.");
+	if (num_sweep_scans>=sweep_scans.size()) {
+		ROS_WARN_STREAM_THROTTLE(1., "[NLA] Sweep buffer full (" << sweep_scans.size() << " scans), dropping scan.");
+		return;
+	}
+	if (scan.point_step==0)
+		return;
+
+	if (num_sweep_scans==0) {
+		// the first scan sets the point layout of the sweep
+		bool has_x = false, has_y = false, has_z = false;
+		for (unsigned int j=0; j<scan.fields.size(); j++) {
+			const sensor_msgs::PointField& field = scan.fields[j];
+			if (field.datatype!=sensor_msgs::PointField::FLOAT32)
+				continue;
+			if (!field.name.compare("x")) {
+				sweep_x_offset = field.offset; has_x = true;
+			} else if (!field.name.compare("y")) {
+				sweep_y_offset = field.offset; has_y = true;
+			} else if (!field.name.compare("z")) {
+				sweep_z_offset = field.offset; has_z = true;
+			}
 		}
-	} else
-	{
-		// transformation in /base_link at the original time
-		tf::StampedTransform current_transform;
-		if (tf_listener.waitForTransform(world_frame, scan.header.frame_id,
+		const bool host_bigendian = (htonl(1)==1);
+		if (!(has_x&&has_y&&has_z) || (bool(scan.is_bigendian)!=host_bigendian)) {
+			ROS_WARN_STREAM_THROTTLE(1., "[NLA] Unsupported scan layout (x, y, z must be float32 in host byte order).");
+			return;
+		}
+		sweep_fields = scan.fields;
+		sweep_point_step = scan.point_step;
+		sweep_is_bigendian = scan.is_bigendian;
+	} else if ((scan.point_step!=sweep_point_step)||(scan.fields.size()!=sweep_fields.size())) {
+		ROS_WARN_STREAM("[NLA] Scan layout changed within a sweep, dropping scan.");
+		return;
+	}
+
+	SweepScan& slot = sweep_scans[num_sweep_scans];
+
+	// laser pose in the robot frame (already fetched for the laser angle in the common case)
+	if (scan.header.frame_id==laser_frame) {
+		slot.laser_to_robot = laser_transform;
+	} else {
+		tf::StampedTransform scan_transform;
+		if (!tf_listener.waitForTransform(robot_frame, scan.header.frame_id,
 				scan.header.stamp, ros::Duration(1))) {
-			tf_listener.lookupTransform(world_frame, scan.header.frame_id,
-					scan.header.stamp, current_transform);
-			pcl_ros::transformPointCloud(robot_frame,
-					base_transform*current_transform, scan, tmp_point_cloud);
-			// fusion of the clouds
-			point_cloud.width += tmp_point_cloud.width;
-			point_cloud.row_step += tmp_point_cloud.row_step;
-			point_cloud.data.insert(point_cloud.data.end(),
-					tmp_point_cloud.data.begin(), tmp_point_cloud.data.end());
-		} else {
 			ROS_WARN_STREAM("[NLA] Could not append scan to current point cloud.");
+			return;
 		}
+		tf_listener.lookupTransform(robot_frame, scan.header.frame_id,
+				scan.header.stamp, scan_transform);
+		slot.laser_to_robot = scan_transform;
+	}
+
+	// copy the raw data (the slot capacity is reused)
+	const size_t num_points = std::min<size_t>(scan.width*scan.height, scan.data.size()/scan.point_step);
+	slot.data.assign(scan.data.begin(), scan.data.begin() + num_points*scan.point_step);
+	slot.stamp = scan.header.stamp;
+	num_sweep_scans++;
+	num_sweep_points += num_points;
+}
+
+/*
+ * Transform the points of a raw buffer in place
+ */
+void transform_points_in_place(const tf::Transform& transform, uint8_t* data,
+		size_t num_points, uint32_t point_step,
+		uint32_t x_offset, uint32_t y_offset, uint32_t z_offset)
+{
+	const tf::Matrix3x3& R = transform.getBasis();
+	const tf::Vector3& t = transform.getOrigin();
+	const float r00 = R[0][0], r01 = R[0][1], r02 = R[0][2];
+	const float r10 = R[1][0], r11 = R[1][1], r12 = R[1][2];
+	const float r20 = R[2][0], r21 = R[2][1], r22 = R[2][2];
+	const float tx = t.x(), ty = t.y(), tz = t.z();
+
+	for (size_t i=0; i<num_points; i++, data+=point_step) {
+		float x, y, z;
+		memcpy(&x, data+x_offset, sizeof(float));
+		memcpy(&y, data+y_offset, sizeof(float));
+		memcpy(&z, data+z_offset, sizeof(float));
+		const float xo = r00*x + r01*y + r02*z + tx;
+		const float yo = r10*x + r11*y + r12*z + ty;
+		const float zo = r20*x + r21*y + r22*z + tz;
+		memcpy(data+x_offset, &xo, sizeof(float));
+		memcpy(data+y_offset, &yo, sizeof(float));
+		memcpy(data+z_offset, &zo, sizeof(float));
 	}
 }
 
+/*
+ * Assemble the scans of the sweep into the robot frame at the sweep start
+ */
+bool NiftiLaserAssembler::assemble_sweep(const ros::Time &end_time, bool& no_motion)
+{
+	no_motion = false;
+	if (num_sweep_scans==0)
+		return false;
+
+	// robot poses at the sweep boundaries: the poses at the scan times are interpolated between them
+	tf::StampedTransform start_pose, end_pose;
+	if (!get_robot_pose(start_time, start_pose)) {
+		ROS_WARN_STREAM("[NLA] Could not initialize new point cloud with new scan.");
+		return false;
+	}
+	const bool has_end_pose = get_robot_pose(end_time, end_pose);
+	if (has_end_pose) {
+		no_motion = check_no_motion(start_pose, end_pose, end_time - start_time);
+	} else {
+		end_pose = start_pose;
+	}
+	const double sweep_duration = (end_time - start_time).toSec();
+	const tf::Transform world_to_base = start_pose.inverse();
+	const tf::Quaternion start_rotation = start_pose.getRotation();
+	const tf::Quaternion end_rotation = end_pose.getRotation();
+
+	// reuse the previous cloud if no subscriber holds it anymore
+	if (!point_cloud || !point_cloud.unique())
+		point_cloud.reset(new sensor_msgs::PointCloud2);
+	sensor_msgs::PointCloud2& cloud = *point_cloud;
+	cloud.header.frame_id = robot_frame;
+	cloud.header.stamp = start_time;
+	cloud.fields = sweep_fields;
+	cloud.point_step = sweep_point_step;
+	cloud.is_bigendian = sweep_is_bigendian;
+	cloud.is_dense = false;
+	cloud.height = 1;
+	cloud.width = num_sweep_points;
+	cloud.row_step = num_sweep_points*sweep_point_step;
+	cloud.data.resize(cloud.row_step);
+
+	uint8_t* dst = cloud.data.empty() ? NULL : &cloud.data[0];
+	for (size_t k=0; k<num_sweep_scans; k++) {
+		const SweepScan& sweep_scan = sweep_scans[k];
+		const size_t num_bytes = sweep_scan.data.size();
+		if (num_bytes==0)
+			continue;
+
+		double s = (sweep_duration>0) ? (sweep_scan.stamp - start_time).toSec()/sweep_duration : 0.;
+		s = std::min(1., std::max(0., s));
+		const tf::Transform robot_pose(start_rotation.slerp(end_rotation, s),
+				start_pose.getOrigin().lerp(end_pose.getOrigin(), s));
+		const tf::Transform laser_to_base = world_to_base*robot_pose*sweep_scan.laser_to_robot;
+
+		memcpy(dst, &sweep_scan.data[0], num_bytes);
+		transform_points_in_place(laser_to_base, dst, num_bytes/sweep_point_step,
+				sweep_point_step, sweep_x_offset, sweep_y_offset, sweep_z_offset);
+		dst += num_bytes;
+	}
+	return true;
+}
+
+/*
+ * Clear the current sweep
+ */
+void NiftiLaserAssembler::reset_sweep()
+{
+	num_sweep_scans = 0;
+	num_sweep_points = 0;
+	start_time = ros::Time(0);
+}
+
 
 /*
  * Main function
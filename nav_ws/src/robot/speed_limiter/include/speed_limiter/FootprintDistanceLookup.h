@@ -0,0 +1,51 @@
+#ifndef SPEED_LIMITER_FOOTPRINT_DISTANCE_LOOKUP_H_
+#define SPEED_LIMITER_FOOTPRINT_DISTANCE_LOOKUP_H_
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include <teb_local_planner/robot_footprint_model.h>
+
+namespace speed_limiter
+{
+
+///	\class FootprintDistanceLookup
+///	\brief Grid in the robot frame storing, for each cell, the distance between the cell center and the robot footprint.
+///        The distances are computed once with the footprint model, so the distance of a point to the footprint is
+///        a single lookup regardless of the footprint shape.
+class FootprintDistanceLookup
+{
+public:
+
+    /// \param footprint the footprint of the robot (at the origin of the robot frame)
+    /// \param max_distance the lookup covers all the points up to this distance from the footprint
+    /// \param resolution [m] size of the cells
+    void init(const teb_local_planner::RobotFootprintModelPtr& footprint, double max_distance, double resolution);
+
+    /// \return the distance of the point (in the robot frame) from the footprint, infinity if outside the lookup
+    inline float getDistance(float x, float y) const
+    {
+        const int col = static_cast<int>(std::floor((x - origin_) * resolution_inv_));
+        const int row = static_cast<int>(std::floor((y - origin_) * resolution_inv_));
+        if (col < 0 || row < 0 || col >= size_ || row >= size_)
+        {
+            return std::numeric_limits<float>::infinity(); /// < EXIT POINT
+        }
+        return distances_[row * size_ + col];
+    }
+
+    bool empty() const { return distances_.empty(); }
+
+protected:
+
+    float origin_ = 0.f;          // [m] coordinate of the first cell corner, for both x and y
+    float resolution_inv_ = 1.f;  // [1/m]
+    int size_ = 0;                // number of cells per side
+
+    std::vector<float> distances_; // row-major, y along the rows
+};
+
+} // namespace speed_limiter
+
+#endif // SPEED_LIMITER_FOOTPRINT_DISTANCE_LOOKUP_H_
@@ -0,0 +1,100 @@
+#ifndef SPEED_LIMITER_SPEED_LIMITER_H_
+#define SPEED_LIMITER_SPEED_LIMITER_H_
+
+#include <map>
+#include <string>
+
+#include <boost/core/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <ros/ros.h>
+#include <tf/transform_listener.h>
+#include <geometry_msgs/Twist.h>
+#include <geometry_msgs/TwistStamped.h>
+#include <sensor_msgs/PointCloud2.h>
+
+#include <speed_limiter/FootprintDistanceLookup.h>
+
+namespace speed_limiter
+{
+
+///	\class SpeedLimiter
+///	\brief C++ implementation of nodes/speed_limiter.py, to be run in a nodelet on the cmd_vel path.
+///        The limits of the sources on adapt_trav_vel_in are handled as in the python node (see the README).
+///        In addition:
+///        - the linear speed is limited according to the distance between the robot footprint and the closest
+///          obstacle point in the direction of motion. The obstacle points are received on obst_point_cloud (e.g.
+///          from the laser_proximity_checker) and the footprint is read with the TEB footprint_model parameters;
+///        - the linear and angular accelerations of the output commands can be limited.
+class SpeedLimiter : private boost::noncopyable
+{
+public:
+
+    SpeedLimiter(const ros::NodeHandle& nh, const ros::NodeHandle& nh_private);
+
+protected:
+
+    void limitCallback(const ros::MessageEvent<geometry_msgs::TwistStamped const>& event);
+
+    void cmdVelCallback(const geometry_msgs::TwistConstPtr& cmd_vel);
+
+    void obstaclesCallback(const sensor_msgs::PointCloud2ConstPtr& cloud);
+
+    /// publish the current limit of the sources on adapt_trav_vel (to be called with the mutex locked)
+    void publishCurrentLimit();
+
+    /// \return the min of the limits, NaN if there is none, and its source
+    static double getMinLimit(const std::map<std::string, double>& limits, std::string& source);
+
+    /// linear speed allowed with an obstacle at the given distance from the footprint, NaN for no limit
+    double getObstacleSpeedLimit(double distance) const;
+
+    /// clamp the change from value_prev to value, with the given max acceleration and deceleration
+    static double limitAcceleration(double value, double value_prev, double dt, double max_acceleration,
+                                    double max_deceleration);
+
+protected:
+
+    ros::NodeHandle nh_;
+    ros::NodeHandle nh_private_;
+
+    ros::Subscriber limit_sub_;
+    ros::Publisher limit_pub_;
+    ros::Subscriber cmd_vel_sub_;
+    ros::Publisher cmd_vel_pub_;
+    ros::Subscriber obstacles_sub_;
+
+    boost::mutex mutex_;
+
+    // limits of the sources
+    std::map<std::string, double> lin_limits_;
+    std::map<std::string, double> ang_limits_;
+    bool override_active_ = false;
+
+    // obstacle limits
+    bool use_obstacles_ = false;
+    boost::shared_ptr<tf::TransformListener> tf_listener_;
+    std::string robot_frame_ = "base_link";
+    FootprintDistanceLookup distance_lookup_;
+    double max_linear_speed_ = 0.6;      // [m/s] linear speed allowed at slow_down_distance_
+    double stop_distance_ = 0.1;         // [m] no motion towards obstacles closer than this to the footprint
+    double slow_down_distance_ = 1.0;    // [m] the linear speed is reduced for obstacles closer than this
+    double min_obstacle_z_ = 0.1;        // [m] points outside [min_obstacle_z_, max_obstacle_z_] are not obstacles
+    double max_obstacle_z_ = 0.5;        // [m]
+    double obstacles_timeout_ = 1.0;     // [s] the obstacle limits expire after this time without clouds
+    float min_front_distance_ = 0.f;     // [m] distances of the closest obstacles in front and behind the robot
+    float min_back_distance_ = 0.f;
+    ros::Time obstacles_stamp_;
+
+    // acceleration limits (0 to disable)
+    double max_linear_acceleration_ = 0.;   // [m/s^2]
+    double max_linear_deceleration_ = 0.;   // [m/s^2]
+    double max_angular_acceleration_ = 0.;  // [rad/s^2]
+    double cmd_vel_timeout_ = 0.5;          // [s] after this time without commands the robot is assumed at rest
+    geometry_msgs::Twist last_cmd_vel_out_;
+    ros::Time last_cmd_vel_time_;
+};
+
+} // namespace speed_limiter
+
+#endif // SPEED_LIMITER_SPEED_LIMITER_H_
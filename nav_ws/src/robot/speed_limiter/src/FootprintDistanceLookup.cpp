@@ -0,0 +1,40 @@
+#include <speed_limiter/FootprintDistanceLookup.h>
+
+#include <algorithm>
+
+#include <teb_local_planner/obstacles.h>
+#include <teb_local_planner/pose_se2.h>
+
+namespace speed_limiter
+{
+
+void FootprintDistanceLookup::init(const teb_local_planner::RobotFootprintModelPtr& footprint, double max_distance,
+                                   double resolution)
+{
+    // the circumscribed radius is infinite for models which do not define it
+    double radius = footprint->getCircumscribedRadius();
+    if (!std::isfinite(radius))
+    {
+        radius = footprint->getInscribedRadius();
+    }
+    const double half_size = std::max(radius, 0.) + max_distance + resolution;
+
+    size_ = std::max(1, static_cast<int>(std::ceil(2. * half_size / resolution)));
+    origin_ = -0.5 * size_ * resolution;
+    resolution_inv_ = 1. / resolution;
+    distances_.resize(size_ * size_);
+
+    const teb_local_planner::PoseSE2 robot_pose(0., 0., 0.);
+    for (int row = 0; row < size_; row++)
+    {
+        const double y = origin_ + (row + 0.5) * resolution;
+        for (int col = 0; col < size_; col++)
+        {
+            const double x = origin_ + (col + 0.5) * resolution;
+            const teb_local_planner::PointObstacle obstacle(x, y);
+            distances_[row * size_ + col] = std::max(footprint->calculateDistance(robot_pose, &obstacle), 0.);
+        }
+    }
+}
+
+} // namespace speed_limiter
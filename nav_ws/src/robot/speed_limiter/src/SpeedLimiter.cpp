@@ -0,0 +1,281 @@
+#include <speed_limiter/SpeedLimiter.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <sensor_msgs/point_cloud2_iterator.h>
+#include <teb_local_planner/teb_local_planner_ros.h>
+
+namespace speed_limiter
+{
+
+SpeedLimiter::SpeedLimiter(const ros::NodeHandle& nh, const ros::NodeHandle& nh_private):
+nh_(nh), nh_private_(nh_private)
+{
+    nh_private_.param("max_linear_acceleration", max_linear_acceleration_, max_linear_acceleration_);
+    nh_private_.param("max_linear_deceleration", max_linear_deceleration_, max_linear_deceleration_);
+    nh_private_.param("max_angular_acceleration", max_angular_acceleration_, max_angular_acceleration_);
+    nh_private_.param("cmd_vel_timeout", cmd_vel_timeout_, cmd_vel_timeout_);
+
+    nh_private_.param("use_obstacles", use_obstacles_, use_obstacles_);
+    if (use_obstacles_)
+    {
+        nh_private_.param("robot_frame", robot_frame_, robot_frame_);
+        nh_private_.param("max_linear_speed", max_linear_speed_, max_linear_speed_);
+        nh_private_.param("stop_distance", stop_distance_, stop_distance_);
+        nh_private_.param("slow_down_distance", slow_down_distance_, slow_down_distance_);
+        nh_private_.param("min_obstacle_z", min_obstacle_z_, min_obstacle_z_);
+        nh_private_.param("max_obstacle_z", max_obstacle_z_, max_obstacle_z_);
+        nh_private_.param("obstacles_timeout", obstacles_timeout_, obstacles_timeout_);
+        slow_down_distance_ = std::max(slow_down_distance_, stop_distance_ + 1e-3);
+
+        double lookup_resolution = 0.02;
+        nh_private_.param("lookup_resolution", lookup_resolution, lookup_resolution);
+
+        // same parameters of the TEB local planner (footprint_model/type, footprint_model/radius, ...)
+        const teb_local_planner::TebConfig teb_config;
+        const teb_local_planner::RobotFootprintModelPtr footprint =
+            teb_local_planner::TebLocalPlannerROS::getRobotFootprintFromParamServer(nh_private_, teb_config);
+        distance_lookup_.init(footprint, slow_down_distance_, lookup_resolution);
+
+        tf_listener_.reset(new tf::TransformListener(nh_));
+        obstacles_sub_ = nh_.subscribe("obst_point_cloud", 1, &SpeedLimiter::obstaclesCallback, this);
+    }
+
+    limit_sub_ = nh_.subscribe("adapt_trav_vel_in", 100, &SpeedLimiter::limitCallback, this);
+    limit_pub_ = nh_.advertise<geometry_msgs::TwistStamped>("adapt_trav_vel", 100, true);
+
+    cmd_vel_sub_ = nh_.subscribe("cmd_vel_in", 10, &SpeedLimiter::cmdVelCallback, this, ros::TransportHints().tcpNoDelay());
+    cmd_vel_pub_ = nh_.advertise<geometry_msgs::Twist>("cmd_vel_out", 10);
+}
+
+void SpeedLimiter::limitCallback(const ros::MessageEvent<geometry_msgs::TwistStamped const>& event)
+{
+    const geometry_msgs::TwistStamped& limit = *event.getMessage();
+
+    std::string name = limit.header.frame_id;
+    if (name.empty())
+    {
+        name = event.getPublisherName();
+        // rostopic nodes are anonymous, but we want to group all of them to one node
+        if (name.compare(0, 9, "/rostopic") == 0)
+        {
+            name = "/rostopic";
+        }
+        ROS_ERROR_STREAM("Publisher " << name << " hasn't set the header.frame_id to identify itself!");
+    }
+
+    const double speed_limit_lin = limit.twist.linear.x;
+    if (speed_limit_lin < 0)
+    {
+        ROS_WARN_STREAM("Speed limit has to be non-negative, " << speed_limit_lin << " given.");
+        return; /// < EXIT POINT
+    }
+
+    const double speed_limit_ang = limit.twist.angular.z;
+    if (speed_limit_ang < 0)
+    {
+        ROS_WARN_STREAM("Speed limit has to be non-negative, " << speed_limit_ang << " given.");
+        return; /// < EXIT POINT
+    }
+
+    ROS_DEBUG_STREAM("Received speed limit (" << speed_limit_lin << ", " << speed_limit_ang << ") from " << name);
+
+    boost::mutex::scoped_lock lock(mutex_);
+
+    if (name == "override")
+    {
+        override_active_ = !std::isnan(speed_limit_lin);
+        // we don't want further processing when override received
+        return; /// < EXIT POINT
+    }
+
+    if (!std::isnan(speed_limit_lin))
+    {
+        lin_limits_[name] = speed_limit_lin;
+    }
+    else
+    {
+        lin_limits_.erase(name);
+    }
+
+    if (!std::isnan(speed_limit_ang))
+    {
+        ang_limits_[name] = speed_limit_ang;
+    }
+    else
+    {
+        ang_limits_.erase(name);
+    }
+
+    publishCurrentLimit();
+}
+
+void SpeedLimiter::publishCurrentLimit()
+{
+    std::string lin_source, ang_source;
+    geometry_msgs::TwistStampedPtr msg(new geometry_msgs::TwistStamped);
+    msg->twist.linear.x = getMinLimit(lin_limits_, lin_source);
+    msg->twist.angular.z = getMinLimit(ang_limits_, ang_source);
+    msg->header.stamp = ros::Time::now();
+    msg->header.frame_id = lin_source + ";" + ang_source;
+    limit_pub_.publish(msg);
+}
+
+double SpeedLimiter::getMinLimit(const std::map<std::string, double>& limits, std::string& source)
+{
+    double min_limit = std::numeric_limits<double>::quiet_NaN();
+    source.clear();
+    for (std::map<std::string, double>::const_iterator it = limits.begin(); it != limits.end(); ++it)
+    {
+        if (std::isnan(min_limit) || it->second < min_limit)
+        {
+            min_limit = it->second;
+            source = it->first;
+        }
+    }
+    return min_limit;
+}
+
+void SpeedLimiter::obstaclesCallback(const sensor_msgs::PointCloud2ConstPtr& cloud)
+{
+    tf::StampedTransform transform;
+    if (cloud->header.frame_id == robot_frame_)
+    {
+        transform.setIdentity();
+    }
+    else
+    {
+        try
+        {
+            tf_listener_->waitForTransform(robot_frame_, cloud->header.frame_id, cloud->header.stamp, ros::Duration(0.1));
+            tf_listener_->lookupTransform(robot_frame_, cloud->header.frame_id, cloud->header.stamp, transform);
+        }
+        catch (const tf::TransformException& ex)
+        {
+            ROS_WARN_STREAM_THROTTLE(1., "Cannot transform the obstacles into " << robot_frame_ << ": " << ex.what());
+            return; /// < EXIT POINT
+        }
+    }
+
+    const tf::Matrix3x3& R = transform.getBasis();
+    const tf::Vector3& t = transform.getOrigin();
+
+    float min_front_distance = std::numeric_limits<float>::infinity();
+    float min_back_distance = std::numeric_limits<float>::infinity();
+    sensor_msgs::PointCloud2ConstIterator<float> iter_x(*cloud, "x");
+    sensor_msgs::PointCloud2ConstIterator<float> iter_y(*cloud, "y");
+    sensor_msgs::PointCloud2ConstIterator<float> iter_z(*cloud, "z");
+    for (; iter_x != iter_x.end(); ++iter_x, ++iter_y, ++iter_z)
+    {
+        const tf::Vector3 point = R * tf::Vector3(*iter_x, *iter_y, *iter_z) + t;
+        if (!std::isfinite(point.z()) || point.z() < min_obstacle_z_ || point.z() > max_obstacle_z_)
+        {
+            continue;
+        }
+        const float distance = distance_lookup_.getDistance(point.x(), point.y());
+        if (point.x() >= 0.)
+        {
+            min_front_distance = std::min(min_front_distance, distance);
+        }
+        else
+        {
+            min_back_distance = std::min(min_back_distance, distance);
+        }
+    }
+
+    boost::mutex::scoped_lock lock(mutex_);
+    min_front_distance_ = min_front_distance;
+    min_back_distance_ = min_back_distance;
+    obstacles_stamp_ = ros::Time::now();
+}
+
+double SpeedLimiter::getObstacleSpeedLimit(double distance) const
+{
+    if (distance >= slow_down_distance_)
+    {
+        return std::numeric_limits<double>::quiet_NaN(); /// < EXIT POINT
+    }
+    const double ratio = (distance - stop_distance_) / (slow_down_distance_ - stop_distance_);
+    return max_linear_speed_ * std::min(std::max(ratio, 0.), 1.);
+}
+
+double SpeedLimiter::limitAcceleration(double value, double value_prev, double dt, double max_acceleration,
+                                       double max_deceleration)
+{
+    const double delta = value - value_prev;
+    // slowing down when the change is opposite to the current speed
+    const double max_delta = (delta * value_prev < 0. && max_deceleration > 0.) ? max_deceleration * dt :
+                                                                                   max_acceleration * dt;
+    if (max_delta <= 0.)
+    {
+        return value; /// < EXIT POINT
+    }
+    return value_prev + std::min(std::max(delta, -max_delta), max_delta);
+}
+
+void SpeedLimiter::cmdVelCallback(const geometry_msgs::TwistConstPtr& cmd_vel)
+{
+    geometry_msgs::TwistPtr out_cmd_vel(new geometry_msgs::Twist(*cmd_vel));
+
+    boost::mutex::scoped_lock lock(mutex_);
+
+    // the acceleration limits smooth the command, then the speed limits are enforced in any case
+    const ros::Time now = ros::Time::now();
+    double dt = (now - last_cmd_vel_time_).toSec();
+    if (last_cmd_vel_time_.isZero() || dt > cmd_vel_timeout_ || dt < 0.)
+    {
+        // the robot is assumed at rest after a pause of the commands
+        last_cmd_vel_out_ = geometry_msgs::Twist();
+        dt = cmd_vel_timeout_;
+    }
+    out_cmd_vel->linear.x = limitAcceleration(out_cmd_vel->linear.x, last_cmd_vel_out_.linear.x, dt,
+                                              max_linear_acceleration_, max_linear_deceleration_);
+    out_cmd_vel->angular.z = limitAcceleration(out_cmd_vel->angular.z, last_cmd_vel_out_.angular.z, dt,
+                                               max_angular_acceleration_, max_angular_acceleration_);
+
+    if (!override_active_)
+    {
+        std::string source;
+        double lin_limit = getMinLimit(lin_limits_, source);
+        const double ang_limit = getMinLimit(ang_limits_, source);
+
+        if (use_obstacles_)
+        {
+            if ((now - obstacles_stamp_).toSec() <= obstacles_timeout_)
+            {
+                const float distance = (out_cmd_vel->linear.x >= 0.) ? min_front_distance_ : min_back_distance_;
+                const double obstacle_limit = getObstacleSpeedLimit(distance);
+                if (std::isnan(lin_limit) || obstacle_limit < lin_limit)
+                {
+                    lin_limit = obstacle_limit;
+                }
+            }
+            else
+            {
+                ROS_WARN_STREAM_THROTTLE(5., "No recent obstacle point cloud, the obstacle speed limit is disabled");
+            }
+        }
+
+        if (!std::isnan(lin_limit) && std::fabs(out_cmd_vel->linear.x) > lin_limit)
+        {
+            ROS_DEBUG_STREAM("Speed limiting decreased linear speed from " << out_cmd_vel->linear.x << " to " << lin_limit);
+            out_cmd_vel->linear.x = std::copysign(lin_limit, out_cmd_vel->linear.x);
+        }
+
+        if (!std::isnan(ang_limit) && std::fabs(out_cmd_vel->angular.z) > ang_limit)
+        {
+            ROS_DEBUG_STREAM("Speed limiting decreased angular speed from " << out_cmd_vel->angular.z << " to " << ang_limit);
+            out_cmd_vel->angular.z = std::copysign(ang_limit, out_cmd_vel->angular.z);
+        }
+    }
+
+    last_cmd_vel_out_ = *out_cmd_vel;
+    last_cmd_vel_time_ = now;
+    lock.unlock();
+
+    cmd_vel_pub_.publish(out_cmd_vel);
+}
+
+} // namespace speed_limiter
@@ -0,0 +1,16 @@
+#include <ros/ros.h>
+
+#include <speed_limiter/SpeedLimiter.h>
+
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "speed_limiter");
+
+    ros::NodeHandle nh;
+    ros::NodeHandle nh_private("~");
+    speed_limiter::SpeedLimiter speed_limiter(nh, nh_private);
+
+    ros::spin();
+
+    return 0;
+}
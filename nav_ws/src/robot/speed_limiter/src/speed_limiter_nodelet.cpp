@@ -0,0 +1,30 @@
+#include <boost/shared_ptr.hpp>
+
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+
+#include <speed_limiter/SpeedLimiter.h>
+
+namespace speed_limiter
+{
+
+///	\class SpeedLimiterNodelet
+///	\brief Runs the SpeedLimiter in a nodelet manager, e.g. the one of the base controller, so that cmd_vel is
+///        limited without serialization and without the latency of a separate python process.
+class SpeedLimiterNodelet : public nodelet::Nodelet
+{
+public:
+
+    virtual void onInit()
+    {
+        speed_limiter_.reset(new SpeedLimiter(getNodeHandle(), getPrivateNodeHandle()));
+    }
+
+protected:
+
+    boost::shared_ptr<SpeedLimiter> speed_limiter_;
+};
+
+} // namespace speed_limiter
+
+PLUGINLIB_EXPORT_CLASS(speed_limiter::SpeedLimiterNodelet, nodelet::Nodelet)
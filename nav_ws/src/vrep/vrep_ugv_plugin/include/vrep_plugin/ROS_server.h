@@ -165,6 +165,10 @@
 
 #include "tf_transform_broadcaster_custom.h"
 
+#include <deque>
+#include <unordered_map>
+#include <boost/thread.hpp>
+
 class SSpecificPublisherData 
 {
     public:
@@ -186,6 +190,39 @@ struct SPublisherData
 	int dependencyCnt;
 };
 
+// Identifies the publishers that can be shared by several streamCmd requests (same command and same aux data)
+struct SPublisherKey
+{
+	int cmdID;
+	int auxInt1;
+	int auxInt2;
+	std::string auxStr;
+
+	bool operator==(const SPublisherKey& other) const
+	{
+		return( (cmdID==other.cmdID)&&(auxInt1==other.auxInt1)&&(auxInt2==other.auxInt2)&&(auxStr==other.auxStr) );
+	}
+};
+
+struct SPublisherKeyHash
+{
+	size_t operator()(const SPublisherKey& key) const
+	{
+		size_t h=std::hash<std::string>()(key.auxStr);
+		h^=std::hash<int>()(key.cmdID)+0x9e3779b9+(h<<6)+(h>>2);
+		h^=std::hash<int>()(key.auxInt1)+0x9e3779b9+(h<<6)+(h>>2);
+		h^=std::hash<int>()(key.auxInt2)+0x9e3779b9+(h<<6)+(h>>2);
+		return(h);
+	}
+};
+
+// A point cloud handed over to the publishing thread
+struct SPointCloudPublishJob
+{
+	ros::Publisher publisher;
+	sensor_msgs::PointCloud2ConstPtr pointcloud;
+};
+
 class ROS_server
 {
 	public:
@@ -220,8 +257,10 @@ class ROS_server
 
 		static bool getObjectGroupData(int objectType,int dataType,std::vector<int>& handles,std::vector<int>& intData,std::vector<float>& floatData,std::vector<std::string>& stringData);
 
+		static bool getPublisherKey(int streamCmd,int auxInt1,int auxInt2,const char* auxString,SPublisherKey& key);
 		static int getPublisherIndexFromCmd(int streamCmd,int auxInt1,int auxInt2,const char* auxString);
 		static int getPublisherIndexFromTopicName(const char* topicName);
+		static void updatePublisherIndices(int firstIndex);
 		static void removeAllPublishers();
 		static bool launchPublisher(SPublisherData& pub,int queueSize);
 		static void shutDownPublisher(SPublisherData& pub);
@@ -232,6 +271,21 @@ class ROS_server
 		static bool streamDepthSensorCloud(SPublisherData& pub, const ros::Time & now,bool& publishedSomething);
 
 		static std::vector<SPublisherData> publishers;
+		static std::unordered_map<std::string,int> publisherIndicesFromTopicName;
+		static std::unordered_map<SPublisherKey,int,SPublisherKeyHash> publisherIndicesFromKey;
+
+		// Point clouds are serialized and published by a dedicated thread, so that the simulation is not blocked
+		static void startPublishingThread();
+		static void stopPublishingThread();
+		static void publishingThreadLoop();
+		static void publishPointCloud(const ros::Publisher& publisher,const sensor_msgs::PointCloud2ConstPtr& pointcloud);
+		static void waitForPublishingQueue();
+		static boost::thread publishingThread;
+		static boost::mutex publishingMutex;
+		static boost::condition_variable publishingCondition;
+		static std::deque<SPointCloudPublishJob> publishingQueue;
+		static bool publishingBusy;
+		static bool publishingThreadStop;
 		static ros::Publisher infoPublisher; // special publisher that is active also when simulation is not running!
 
 		static void removeAllSubscribers();
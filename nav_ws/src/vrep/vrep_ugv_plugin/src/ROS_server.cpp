@@ -30,6 +30,7 @@
 
 #include "sensor_msgs/distortion_models.h"
 #include <boost/algorithm/string/replace.hpp>
+#include <cstring>
 #include <map>
 #include "../include/vrep_plugin/ROS_server.h"
 #include "../include/v_repLib.h"
@@ -50,6 +51,15 @@ bool ROS_server::_waitTriggerEnable=false;
 bool ROS_server::_waitForTrigger=true;
 
 std::vector<SPublisherData> ROS_server::publishers;
+std::unordered_map<std::string,int> ROS_server::publisherIndicesFromTopicName;
+std::unordered_map<SPublisherKey,int,SPublisherKeyHash> ROS_server::publisherIndicesFromKey;
+
+boost::thread ROS_server::publishingThread;
+boost::mutex ROS_server::publishingMutex;
+boost::condition_variable ROS_server::publishingCondition;
+std::deque<SPointCloudPublishJob> ROS_server::publishingQueue;
+bool ROS_server::publishingBusy=false;
+bool ROS_server::publishingThreadStop=false;
 ros::Publisher ROS_server::infoPublisher; // special publisher that is active also when simulation is not running!
 
 std::vector<CSubscriberData*> ROS_server::subscribers;
@@ -106,29 +116,50 @@ static std::string objIdToFrameId(int objId)
 
 struct SPointCloudPublisherData : public SSpecificPublisherData
 {
-	sensor_msgs::PointCloud2 pointcloud;
-	SPointCloudPublisherData(const std::string & obj_name)
-	{
-		pointcloud.header.frame_id = objNameToFrameId(obj_name);
-		pointcloud.fields.resize(3);
-		pointcloud.fields[0].name="x";
-		pointcloud.fields[0].offset=0; 
-		pointcloud.fields[0].datatype=sensor_msgs::PointField::FLOAT32;
-		pointcloud.fields[0].count=1;
-		pointcloud.fields[1].name="y";
-		pointcloud.fields[1].offset=4; 
-		pointcloud.fields[1].datatype=sensor_msgs::PointField::FLOAT32;
-		pointcloud.fields[1].count=1;
-		pointcloud.fields[2].name="z";
-		pointcloud.fields[2].offset=8; 
-		pointcloud.fields[2].datatype=sensor_msgs::PointField::FLOAT32;
-		pointcloud.fields[2].count=1;
-		pointcloud.point_step = 12;
-		pointcloud.height = 1;
-		pointcloud.width = 0; // To be updated
-		pointcloud.row_step = 0; // To be updated
-		pointcloud.is_bigendian = false;
-		pointcloud.is_dense = true;
+	sensor_msgs::PointCloud2Ptr pointcloud;
+	SPointCloudPublisherData(const std::string & obj_name) : pointcloud(new sensor_msgs::PointCloud2)
+	{
+		pointcloud->header.frame_id = objNameToFrameId(obj_name);
+		pointcloud->fields.resize(3);
+		pointcloud->fields[0].name="x";
+		pointcloud->fields[0].offset=0; 
+		pointcloud->fields[0].datatype=sensor_msgs::PointField::FLOAT32;
+		pointcloud->fields[0].count=1;
+		pointcloud->fields[1].name="y";
+		pointcloud->fields[1].offset=4; 
+		pointcloud->fields[1].datatype=sensor_msgs::PointField::FLOAT32;
+		pointcloud->fields[1].count=1;
+		pointcloud->fields[2].name="z";
+		pointcloud->fields[2].offset=8; 
+		pointcloud->fields[2].datatype=sensor_msgs::PointField::FLOAT32;
+		pointcloud->fields[2].count=1;
+		pointcloud->point_step = 12;
+		pointcloud->height = 1;
+		pointcloud->width = 0; // To be updated
+		pointcloud->row_step = 0; // To be updated
+		pointcloud->is_bigendian = false;
+		pointcloud->is_dense = true;
+	}
+
+	// The cloud is reused from one simulation step to the next. Only if the previous one is still
+	// referenced (being published, or kept by an intra-process subscriber) a new one is allocated.
+	sensor_msgs::PointCloud2& getWritablePointCloud()
+	{
+		if (!pointcloud.unique())
+		{
+			sensor_msgs::PointCloud2Ptr cloud(new sensor_msgs::PointCloud2);
+			cloud->header = pointcloud->header;
+			cloud->fields = pointcloud->fields;
+			cloud->point_step = pointcloud->point_step;
+			cloud->height = pointcloud->height;
+			cloud->width = pointcloud->width;
+			cloud->row_step = pointcloud->row_step;
+			cloud->is_bigendian = pointcloud->is_bigendian;
+			cloud->is_dense = pointcloud->is_dense;
+			cloud->data.resize(pointcloud->data.size());
+			pointcloud = cloud;
+		}
+		return(*pointcloud);
 	}
 };
 
@@ -138,12 +169,12 @@ struct SDepthCloudPublisherData : public SPointCloudPublisherData
     std::vector<float> y_scale;
 	SDepthCloudPublisherData(const std::string & obj_name) : SPointCloudPublisherData(obj_name)
 	{
-        pointcloud.fields.resize(4);
-        pointcloud.fields[3].name="rgb";
-        pointcloud.fields[3].offset=12; 
-        pointcloud.fields[3].datatype=sensor_msgs::PointField::UINT32;
-        pointcloud.fields[3].count=1;
-        pointcloud.point_step = 16;
+        pointcloud->fields.resize(4);
+        pointcloud->fields[3].name="rgb";
+        pointcloud->fields[3].offset=12; 
+        pointcloud->fields[3].datatype=sensor_msgs::PointField::UINT32;
+        pointcloud->fields[3].count=1;
+        pointcloud->point_step = 16;
 	}
 };
 
@@ -264,11 +295,14 @@ bool ROS_server::initialize()
 	enableAPIServices();
 	infoPublisher=node->advertise<vrep_common::VrepInfo>("info",1); // special case! This is the only publisher always active!
 
+	startPublishingThread();
+
 	return(true);
 }
 
 void ROS_server::shutDown()
 {
+	stopPublishingThread();
 	infoPublisher.shutdown(); // special case! This is the only publisher always active!
 	disableAPIServices();
 	ros::shutdown();
@@ -391,6 +425,7 @@ std::string ROS_server::addPublisher(const char* topicName,int queueSize,int str
 	if (launchPublisher(pub,queueSize))
 	{ // We launched the publisher!
 		publishers.push_back(pub);
+		updatePublisherIndices(int(publishers.size())-1);
 		return(pub.topicName);
 	}
         else
@@ -401,87 +436,99 @@ std::string ROS_server::addPublisher(const char* topicName,int queueSize,int str
 }
 
 
+bool ROS_server::getPublisherKey(int streamCmd,int auxInt1,int auxInt2,const char* auxString,SPublisherKey& key)
+{ // Only the aux data used by the command type is part of the key
+	key.cmdID=streamCmd;
+	key.auxInt1=0;
+	key.auxInt2=0;
+	key.auxStr.clear();
+	if (streamCmd<simros_strmcmdint_start)
+		return(true); // these command types don't have any aux data
+	if ((streamCmd<simros_strmcmdintint_start)&&(streamCmd>simros_strmcmdint_start))
+	{ // these command types have an integer as aux data!
+		key.auxInt1=auxInt1;
+		return(true);
+	}
+	if ((streamCmd<simros_strmcmdstring_start)&&(streamCmd>simros_strmcmdintint_start))
+	{ // these command types have 2 integers as aux data!
+		key.auxInt1=auxInt1;
+		key.auxInt2=auxInt2;
+		return(true);
+	}
+	if ((streamCmd<simros_strmcmdintstring_start)&&(streamCmd>simros_strmcmdstring_start))
+	{ // these command types have a string as aux data!
+		key.auxStr=auxString;
+		return(true);
+	}
+	if ((streamCmd<simros_strmcmdreserved_start)&&(streamCmd>simros_strmcmdintstring_start))
+	{ // these command types have an integer and a string as aux data!
+		key.auxInt1=auxInt1;
+		key.auxStr=auxString;
+		return(true);
+	}
+	return(false); // publishers of the other command types are never shared
+}
+
 int ROS_server::getPublisherIndexFromCmd(int streamCmd,int auxInt1,int auxInt2,const char* auxString)
 {
-	for (unsigned int i=0;i<publishers.size();i++)
-	{
-		if (publishers[i].cmdID==streamCmd)
-		{ // we have a similar command here. Check if the aux. data is same too:
-			if (streamCmd<simros_strmcmdint_start)
-				return(i); // Yes! (these command types don't have any aux data)
-			if ((streamCmd<simros_strmcmdintint_start)&&(streamCmd>simros_strmcmdint_start))
-			{ // these command types have an integer as aux data!
-				if (publishers[i].auxInt1==auxInt1)
-					return(i); // Yes!
-			}
-			if ((streamCmd<simros_strmcmdstring_start)&&(streamCmd>simros_strmcmdintint_start))
-			{ // these command types have 2 integers as aux data!
-				if ( (publishers[i].auxInt1==auxInt1)&&(publishers[i].auxInt2==auxInt2) )
-					return(i); // Yes!
-			}
-			if ((streamCmd<simros_strmcmdintstring_start)&&(streamCmd>simros_strmcmdstring_start))
-			{ // these command types have a string as aux data!
-				if (publishers[i].auxStr.compare(auxString)==0)
-					return(i); // Yes!
-			}
-			if ((streamCmd<simros_strmcmdreserved_start)&&(streamCmd>simros_strmcmdintstring_start))
-			{ // these command types have an integer and a string as aux data!
-				if ( (publishers[i].auxInt1==auxInt1)&&(publishers[i].auxStr.compare(auxString)==0) )
-					return(i); // Yes!
-			}
-                        /*if (streamCmd>=simros_strmcmdreserved_start)
-                        { // these command types have an integer and a string as aux data!
-				if ( (publishers[i].auxInt1==auxInt1)&&(publishers[i].auxStr.compare(auxString)==0) )
-					return(i); // Yes!
-                        }*/
-		}
-	}
-	return(-1);
+	SPublisherKey key;
+	if (!getPublisherKey(streamCmd,auxInt1,auxInt2,auxString,key))
+		return(-1);
+	std::unordered_map<SPublisherKey,int,SPublisherKeyHash>::const_iterator it=publisherIndicesFromKey.find(key);
+	if (it==publisherIndicesFromKey.end())
+		return(-1);
+	return(it->second);
 }
 
 int ROS_server::getPublisherIndexFromTopicName(const char* topicName)
 {
-	for (unsigned int i=0;i<publishers.size();i++)
+	std::unordered_map<std::string,int>::const_iterator it=publisherIndicesFromTopicName.find(topicName);
+	if (it==publisherIndicesFromTopicName.end())
+		return(-1);
+	return(it->second);
+}
+
+void ROS_server::updatePublisherIndices(int firstIndex)
+{ // (re-)indexes the publishers from firstIndex on, after they were added or moved
+	for (int i=firstIndex;i<int(publishers.size());i++)
 	{
-		if (publishers[i].topicName.compare(topicName)==0)
-			return(i);
+		publisherIndicesFromTopicName[publishers[i].topicName]=i;
+		SPublisherKey key;
+		if (getPublisherKey(publishers[i].cmdID,publishers[i].auxInt1,publishers[i].auxInt2,publishers[i].auxStr.c_str(),key))
+			publisherIndicesFromKey[key]=i;
 	}
-	return(-1);
 }
 
 int ROS_server::removePublisher(const char* topicName,bool ignoreReferenceCounter)
 {
-	for (unsigned int i=0;i<publishers.size();i++)
-	{
-		if (publishers[i].topicName.compare(topicName)==0)
-		{
-			publishers[i].dependencyCnt--;
-			if ((publishers[i].dependencyCnt==0)||ignoreReferenceCounter)
-			{
-				shutDownPublisher(publishers[i]);
-				publishers.erase(publishers.begin()+i);
-				return(0);
-			}
-			else
-				return(publishers[i].dependencyCnt);
-		}
+	int i=getPublisherIndexFromTopicName(topicName);
+	if (i<0)
+		return(-1);
+	publishers[i].dependencyCnt--;
+	if ((publishers[i].dependencyCnt==0)||ignoreReferenceCounter)
+	{
+		shutDownPublisher(publishers[i]);
+		publisherIndicesFromTopicName.erase(publishers[i].topicName);
+		SPublisherKey key;
+		if (getPublisherKey(publishers[i].cmdID,publishers[i].auxInt1,publishers[i].auxInt2,publishers[i].auxStr.c_str(),key))
+			publisherIndicesFromKey.erase(key);
+		publishers.erase(publishers.begin()+i);
+		updatePublisherIndices(i);
+		return(0);
 	}
-	return(-1);
+	else
+		return(publishers[i].dependencyCnt);
 }
 
 int ROS_server::wakePublisher(const char* topicName,int publishCnt)
 {
-	for (unsigned int i=0;i<publishers.size();i++)
-	{
-		if (publishers[i].topicName.compare(topicName)==0)
-		{
-			if (publishCnt<-1)
-				return(publishers[i].publishCnt);
-			publishers[i].publishCnt=publishCnt;
-			return(1);
-		}
-	}
-	return(-2);
+	int i=getPublisherIndexFromTopicName(topicName);
+	if (i<0)
+		return(-2);
+	if (publishCnt<-1)
+		return(publishers[i].publishCnt);
+	publishers[i].publishCnt=publishCnt;
+	return(1);
 }
 
 void ROS_server::removeAllPublishers()
@@ -867,6 +914,7 @@ void ROS_server::shutDownPublisher(SPublisherData& pub)
 {
 	if (pub.specificPublisherData!=NULL)
 	{
+		waitForPublishingQueue(); // the publishing thread might still use this publisher
 		delete pub.specificPublisherData;
 		pub.specificPublisherData=NULL;
 	}
@@ -889,6 +937,77 @@ void ROS_server::shutDownPublisher(SPublisherData& pub)
 //========================================= STREAMING ==========================================================
 //==============================================================================================================
 
+void ROS_server::startPublishingThread()
+{
+	publishingThreadStop=false;
+	publishingThread=boost::thread(&ROS_server::publishingThreadLoop);
+}
+
+void ROS_server::stopPublishingThread()
+{
+	{
+		boost::lock_guard<boost::mutex> lock(publishingMutex);
+		publishingThreadStop=true;
+	}
+	publishingCondition.notify_all();
+	publishingThread.join();
+}
+
+void ROS_server::publishingThreadLoop()
+{ // Publishes the queued point clouds (serialization happens here), until stopped and the queue is empty
+	boost::unique_lock<boost::mutex> lock(publishingMutex);
+	while (true)
+	{
+		while (publishingQueue.empty()&&(!publishingThreadStop))
+			publishingCondition.wait(lock);
+		if (publishingQueue.empty())
+			break;
+		SPointCloudPublishJob job=publishingQueue.front();
+		publishingQueue.pop_front();
+		publishingBusy=true;
+		lock.unlock();
+
+		job.publisher.publish(job.pointcloud);
+		job.pointcloud.reset(); // the streaming side can reuse the cloud now
+
+		lock.lock();
+		publishingBusy=false;
+		publishingCondition.notify_all();
+	}
+}
+
+void ROS_server::publishPointCloud(const ros::Publisher& publisher,const sensor_msgs::PointCloud2ConstPtr& pointcloud)
+{
+	{
+		boost::lock_guard<boost::mutex> lock(publishingMutex);
+		bool replaced=false;
+		for (size_t i=0;i<publishingQueue.size();i++)
+		{ // the previous cloud of this publisher was not published yet: only the newest one is kept
+			if (publishingQueue[i].publisher==publisher)
+			{
+				publishingQueue[i].pointcloud=pointcloud;
+				replaced=true;
+				break;
+			}
+		}
+		if (!replaced)
+		{
+			SPointCloudPublishJob job;
+			job.publisher=publisher;
+			job.pointcloud=pointcloud;
+			publishingQueue.push_back(job);
+		}
+	}
+	publishingCondition.notify_all();
+}
+
+void ROS_server::waitForPublishingQueue()
+{
+	boost::unique_lock<boost::mutex> lock(publishingMutex);
+	while ((!publishingQueue.empty())||publishingBusy)
+		publishingCondition.wait(lock);
+}
+
 
 void ROS_server::streamAllData()
 {
@@ -2137,17 +2256,17 @@ bool ROS_server::streamLaserCloud(SPublisherData& pub, const ros::Time & now,boo
 	if (!data)
 		return(false);
 
-    pcd->pointcloud.data.resize(datalen);
-    std::copy(data,data+datalen,pcd->pointcloud.data.begin());
+	sensor_msgs::PointCloud2& pointcloud=pcd->getWritablePointCloud();
+    pointcloud.data.resize(datalen);
+    std::copy(data,data+datalen,pointcloud.data.begin());
 
-	unsigned int n = pcd->pointcloud.data.size() / 12;
-	pcd->pointcloud.header.frame_id = objIdToFrameId(pub.auxInt1); // Courtesy of Federico Ferri
-	pcd->pointcloud.width = n;
-	pcd->pointcloud.row_step = n * pcd->pointcloud.point_step;
-	pcd->pointcloud.header.stamp = now;
+	unsigned int n = pointcloud.data.size() / 12;
+	pointcloud.header.frame_id = objIdToFrameId(pub.auxInt1); // Courtesy of Federico Ferri
+	pointcloud.width = n;
+	pointcloud.row_step = n * pointcloud.point_step;
+	pointcloud.header.stamp = now;
 	publishedSomething=true;
-	pub.generalPublisher.publish(pcd->pointcloud);
-	pcd->pointcloud.data.clear();
+	publishPointCloud(pub.generalPublisher,pcd->pointcloud);
 
 	simReleaseBuffer(data);
 	return(false); // keep this topic
@@ -2180,9 +2299,11 @@ bool ROS_server::streamDepthSensorCloud(SPublisherData& pub, const ros::Time & n
 	unsigned char * image_buf = simGetVisionSensorCharImage(handle,NULL,NULL);
 
     unsigned int datalen = resol_x * resol_y;
+    sensor_msgs::PointCloud2& pointcloud=pcd->getWritablePointCloud();
+    const unsigned int point_step = pointcloud.point_step;
     if (pcd->x_scale.size() != datalen) {
         // First run, we need to initialise the scaling factors
-        pcd->pointcloud.data.resize(datalen*pcd->pointcloud.point_step);
+        pointcloud.data.resize(datalen*point_step);
         pcd->x_scale.resize(datalen);
         pcd->y_scale.resize(datalen);
         float f = (resol_x/2.) / tan(view_angle/2.);
@@ -2196,23 +2317,23 @@ bool ROS_server::streamDepthSensorCloud(SPublisherData& pub, const ros::Time & n
             }
         }
     }
-    for (unsigned int i=0;i<datalen;i++){
+    // The points are written in place in the preallocated cloud
+    uint8_t * raw = pointcloud.data.data();
+    for (unsigned int i=0;i<datalen;i++,raw+=point_step){
         float depth = near_clip + scale * buff[i];
         float xyz[3] = {depth*pcd->x_scale[i],depth*pcd->y_scale[i],depth};
-        assert(sizeof(xyz)==12);
-        uint8_t * raw = (uint8_t*)xyz;
-        std::copy(raw,raw+12,pcd->pointcloud.data.begin()+i*pcd->pointcloud.point_step);
+        memcpy(raw,xyz,sizeof(xyz));
         unsigned int p = i*3;
         uint8_t argb[4] = {image_buf[p+2],image_buf[p+1],image_buf[p],0};
-        std::copy(argb,argb+4,pcd->pointcloud.data.begin()+i*pcd->pointcloud.point_step+12);
+        memcpy(raw+12,argb,sizeof(argb));
     }
-	pcd->pointcloud.header.frame_id = objIdToFrameId(pub.auxInt1); // Courtesy of Federico Ferri
-    pcd->pointcloud.width = resol_x;
-    pcd->pointcloud.height = resol_y;
-    pcd->pointcloud.row_step = resol_x * pcd->pointcloud.point_step;
-    pcd->pointcloud.header.stamp = now;
+	pointcloud.header.frame_id = objIdToFrameId(pub.auxInt1); // Courtesy of Federico Ferri
+    pointcloud.width = resol_x;
+    pointcloud.height = resol_y;
+    pointcloud.row_step = resol_x * point_step;
+    pointcloud.header.stamp = now;
 	publishedSomething=true;
-    pub.generalPublisher.publish(pcd->pointcloud);
+    publishPointCloud(pub.generalPublisher,pcd->pointcloud);
     simReleaseBuffer((char*)buff);
     simReleaseBuffer((char*)image_buf);
 
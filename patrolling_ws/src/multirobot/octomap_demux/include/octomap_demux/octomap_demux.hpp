@@ -51,13 +51,14 @@ T getParam(ros::NodeHandle& n, const std::string& name, const T& defaultValue)
 class OctomapDeMux {
 
  public:
-  explicit OctomapDeMux(ros::NodeHandle& n);
+  // n_private: node handle of the parameters (a nodelet passes its private node handle)
+  explicit OctomapDeMux(ros::NodeHandle& n, const ros::NodeHandle& n_private = ros::NodeHandle("~"));
   ~OctomapDeMux() {}
   
  protected:
      
     /// \brief Callback for the point_map.
-  void pointMapCallback(const sensor_msgs::PointCloud2& cloud_msg_in);
+  void pointMapCallback(const sensor_msgs::PointCloud2ConstPtr& cloud_msg_in);
   
   std::string pcl_sub_name;
   std::string pcl1_pub_name;
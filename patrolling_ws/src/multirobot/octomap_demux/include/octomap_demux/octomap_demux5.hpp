@@ -51,13 +51,14 @@ T getParam(ros::NodeHandle& n, const std::string& name, const T& defaultValue)
 class OctomapDeMux5 {
 
  public:
-  explicit OctomapDeMux5(ros::NodeHandle& n);
+  // n_private: node handle of the parameters (a nodelet passes its private node handle)
+  explicit OctomapDeMux5(ros::NodeHandle& n, const ros::NodeHandle& n_private = ros::NodeHandle("~"));
   ~OctomapDeMux5() {}
   
  protected:
      
     /// \brief Callback for the point_map.
-  void pointMapCallback(const sensor_msgs::PointCloud2& cloud_msg_in);
+  void pointMapCallback(const sensor_msgs::PointCloud2ConstPtr& cloud_msg_in);
   
   std::string pcl_sub_name;
   
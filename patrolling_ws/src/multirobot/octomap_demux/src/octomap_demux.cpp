@@ -27,9 +27,9 @@
 #include "pcl_ros/transforms.h"
 #include <pcl_ros/impl/transforms.hpp>
 
-OctomapDeMux::OctomapDeMux(ros::NodeHandle& n) :
+OctomapDeMux::OctomapDeMux(ros::NodeHandle& n, const ros::NodeHandle& n_private) :
 nh_(n),
-n_("~"),
+n_(n_private),
 tf_() {
     global_ref = getParam<std::string>(n_, "global_ref", "map");
     ref_frame_1 = getParam<std::string>(n_, "ref_frame_1", "ugv1/map");
@@ -49,14 +49,14 @@ tf_() {
 
 }
 
-void OctomapDeMux::pointMapCallback(const sensor_msgs::PointCloud2& cloud_msg_in) {
-    std::cout << "OctomapDeMux Volumetric mapping Octomap PCD" << cloud_msg_in.header.frame_id << std::endl;
+void OctomapDeMux::pointMapCallback(const sensor_msgs::PointCloud2ConstPtr& cloud_msg_in) {
+    std::cout << "OctomapDeMux Volumetric mapping Octomap PCD" << cloud_msg_in->header.frame_id << std::endl;
 
-    if (cloud_msg_in.header.frame_id.compare(ref_frame_1) == 0) {
-        sensor_msgs::PointCloud2 pcl_out2;
+    if (cloud_msg_in->header.frame_id.compare(ref_frame_1) == 0) {
+        sensor_msgs::PointCloud2Ptr pcl_out2(new sensor_msgs::PointCloud2);
 
         try {
-            pcl_ros::transformPointCloud(ref_frame_2, cloud_msg_in, pcl_out2, tf_);
+            pcl_ros::transformPointCloud(ref_frame_2, *cloud_msg_in, *pcl_out2, tf_);
 
             pcl1_pub_.publish(cloud_msg_in);
             pcl2_pub_.publish(pcl_out2);
@@ -64,11 +64,11 @@ void OctomapDeMux::pointMapCallback(const sensor_msgs::PointCloud2& cloud_msg_in
         } catch (tf::ExtrapolationException e) {
             printf("Failure %s\n", e.what()); //Print exception which was caught
         }
-    } else if (cloud_msg_in.header.frame_id.compare(ref_frame_2) == 0) {
-        sensor_msgs::PointCloud2 pcl_out1;
+    } else if (cloud_msg_in->header.frame_id.compare(ref_frame_2) == 0) {
+        sensor_msgs::PointCloud2Ptr pcl_out1(new sensor_msgs::PointCloud2);
 
         try {
-            pcl_ros::transformPointCloud(ref_frame_1, cloud_msg_in, pcl_out1, tf_);
+            pcl_ros::transformPointCloud(ref_frame_1, *cloud_msg_in, *pcl_out1, tf_);
 
             pcl1_pub_.publish(pcl_out1);
             pcl2_pub_.publish(cloud_msg_in);
@@ -78,12 +78,12 @@ void OctomapDeMux::pointMapCallback(const sensor_msgs::PointCloud2& cloud_msg_in
         }
 
     } else {
-        sensor_msgs::PointCloud2 pcl_out1;
-        sensor_msgs::PointCloud2 pcl_out2;
+        sensor_msgs::PointCloud2Ptr pcl_out1(new sensor_msgs::PointCloud2);
+        sensor_msgs::PointCloud2Ptr pcl_out2(new sensor_msgs::PointCloud2);
 
         try {
-            pcl_ros::transformPointCloud(ref_frame_1, cloud_msg_in, pcl_out1, tf_);
-            pcl_ros::transformPointCloud(ref_frame_2, cloud_msg_in, pcl_out2, tf_);
+            pcl_ros::transformPointCloud(ref_frame_1, *cloud_msg_in, *pcl_out1, tf_);
+            pcl_ros::transformPointCloud(ref_frame_2, *cloud_msg_in, *pcl_out2, tf_);
 
             pcl1_pub_.publish(pcl_out1);
             pcl2_pub_.publish(pcl_out2);
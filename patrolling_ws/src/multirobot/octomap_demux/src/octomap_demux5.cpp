@@ -27,9 +27,9 @@
 #include "pcl_ros/transforms.h"
 #include <pcl_ros/impl/transforms.hpp>
 
-OctomapDeMux5::OctomapDeMux5(ros::NodeHandle& n) :
+OctomapDeMux5::OctomapDeMux5(ros::NodeHandle& n, const ros::NodeHandle& n_private) :
 nh_(n),
-n_("~"),
+n_(n_private),
 tf_() {
     global_ref = getParam<std::string>(n_, "global_ref", "map");
 
@@ -54,8 +54,8 @@ tf_() {
 
 }
 
-void OctomapDeMux5::pointMapCallback(const sensor_msgs::PointCloud2& cloud_msg_in) {
-    std::cout << "OctomapDeMux Volumetric mapping Octomap PCD" << cloud_msg_in.header.frame_id << std::endl;
+void OctomapDeMux5::pointMapCallback(const sensor_msgs::PointCloud2ConstPtr& cloud_msg_in) {
+    std::cout << "OctomapDeMux Volumetric mapping Octomap PCD" << cloud_msg_in->header.frame_id << std::endl;
 
         try {
 
@@ -0,0 +1,51 @@
+/**
+* This file is part of the ROS package octomap_demux which belongs to the framework 3DMR. 
+*
+* Copyright (C) 2017-2019 Luigi Freda <luigifreda at gmail dot com>  
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <memory>
+
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+
+#include "octomap_demux/octomap_demux.hpp"
+
+namespace octomap_demux {
+
+/// \brief Nodelet version of octomap_demux_node: loaded in the same manager of the
+/// mapping and of the consumers of the clouds, the untransformed clouds are
+/// republished by pointer (no serialization and no copies).
+class OctomapDeMuxNodelet : public nodelet::Nodelet {
+
+ public:
+  OctomapDeMuxNodelet() {}
+
+ private:
+  virtual void onInit() {
+    nh_ = getNodeHandle();
+    octomap_demux_.reset(new OctomapDeMux(nh_, getPrivateNodeHandle()));
+  }
+
+  // Node handle (OctomapDeMux keeps a reference to it).
+  ros::NodeHandle nh_;
+  std::unique_ptr<OctomapDeMux> octomap_demux_;
+};
+
+} // namespace octomap_demux
+
+PLUGINLIB_EXPORT_CLASS(octomap_demux::OctomapDeMuxNodelet, nodelet::Nodelet)
@@ -524,8 +524,18 @@ int Conscientious_Reactive_Agent::compute_next_vertex()
                 const size_t list_size = vec_ordered_nodes2.size();
                 
                 // build a navigation cost table on the basis of available information: team model, team deployment and dynamic graph  
-                NavCostTable navCostTable(TEAMSIZE_); // N.B.: this can be limited to a small group of close robots 
+                NavCostTable navCostTable(TEAMSIZE_, graph_dimension_); // N.B.: this can be limited to a small group of close robots 
                 navCostTable.update(tasks_, team_deployment_, graph_, graph_dimension_, graph_mutex_);
+                
+                // refresh our row with the navigation costs from the robot pose to the candidates (a single request to the path planner)
+                std::vector<int> candidate_vertexes(1, next_planned_vertex);
+                for(size_t i = 0; i < list_size; i++) candidate_vertexes.push_back(vec_ordered_nodes2[i].node_id);
+                if( updatePoseNavCosts(candidate_vertexes) )
+                {
+                    std::vector<float> candidate_nav_costs(candidate_vertexes.size());
+                    for(size_t i = 0; i < candidate_vertexes.size(); i++) candidate_nav_costs[i] = getPoseNavCost(candidate_vertexes[i]);
+                    navCostTable.setRow(ID_ROBOT_, candidate_vertexes, candidate_nav_costs);
+                }
                 navCostTable.print();
 
                 // N.B.1: the cost-to-go is originally received in "float" and then converted into "int" by using a scale factor (see for instance PatrolAgent::pathPlanningFeedbackCallback() )
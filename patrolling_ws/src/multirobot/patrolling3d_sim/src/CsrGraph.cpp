@@ -0,0 +1,224 @@
+/**
+* This file is part of the ROS package patrolling3d_sim which belongs to the framework 3DMR. 
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> 
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "CsrGraph.h"
+
+#include <algorithm>
+#include <cstring>
+
+const uint CsrGraph::kMaxVertexNeighbors;
+
+void CsrGraph::clear()
+{
+    ids_.clear();
+    x_.clear(); y_.clear(); z_.clear(); priority_.clear();
+    offsets_.assign(1, 0);
+    neighbors_.clear();
+    costs_.clear();
+    costs_m_.clear();
+    dirs_.clear();
+    nav_data_.clear();
+}
+
+void CsrGraph::buildFromMsg(const patrolling_build_graph_msgs::Graph& msg)
+{
+    clear();
+    
+    const uint dimension = msg.num_nodes; 
+    const ros::Time time_now = ros::Time::now();
+    
+    for (uint i = 0; i < dimension; i++)
+    {
+        addVertex(msg.node_id[i], msg.node_position[i].x, msg.node_position[i].y, msg.node_position[i].z, msg.node_priority[i]);
+        
+        for (uint j = 0; j < dimension; j++)
+        {
+            // row-major order
+            const size_t index = (size_t)i*dimension + j;
+            if (msg.adjacency_matrix[index] == 1)
+            {
+                const uint cost = (uint)std::min( (double)rint(msg.cost_matrix[index]), (double)std::numeric_limits<uint>::max() );
+                addEdge(msg.node_id[j], msg.direction_matrix[index], cost, msg.cost_matrix[index]);
+                setNavData(msg.node_id[i], msg.node_id[j], msg.cost_matrix[index], time_now);
+            }
+        }
+    }
+    finalize();
+}
+
+void CsrGraph::buildFromVertices(const Vertex* vertex_web, const uint dimension)
+{
+    clear();
+    
+    for (uint i = 0; i < dimension; i++)
+    {
+        const Vertex& v = vertex_web[i];
+        addVertex(v.id, v.x, v.y, v.z, v.priority);
+        
+        for (uint k = 0; k < v.num_neigh; k++)
+        {
+            addEdge(v.id_neigh[k], std::string(v.dir[k], strnlen(v.dir[k], 3)), v.cost[k], v.cost_m[k]);
+        }
+        
+        for (Vertex::MapNavData::const_iterator it = v.nav_data.begin(); it != v.nav_data.end(); it++)
+        {
+            setNavData(v.id, it->first, it->second.cost, it->second.timestamp);
+        }
+    }
+    finalize();
+}
+
+void CsrGraph::addVertex(const uint id, const float x, const float y, const float z, const float priority)
+{
+    ids_.push_back(id);
+    x_.push_back(x);
+    y_.push_back(y);
+    z_.push_back(z);
+    priority_.push_back(priority);
+    offsets_.push_back(neighbors_.size());
+}
+
+void CsrGraph::addEdge(const uint idNeighbor, const std::string& dir, const uint cost, const float cost_m)
+{
+    if (ids_.empty()) return; /// < EXIT POINT
+    neighbors_.push_back(idNeighbor);
+    dirs_.push_back(dir.substr(0,2)); // 2 chars + terminator in Vertex::dir
+    costs_.push_back(cost);
+    costs_m_.push_back(cost_m);
+    offsets_.back()++;
+}
+
+void CsrGraph::finalize()
+{
+    sortEdges();
+}
+
+void CsrGraph::toVertices(Vertex* &vertex_web, uint& dimension) const
+{
+    if (vertex_web) delete [] vertex_web;
+    vertex_web = 0;
+    dimension = size();
+    if (dimension == 0) return; /// < EXIT POINT
+    
+    vertex_web = new Vertex[dimension];
+    
+    std::vector<uint> edges;
+    for (uint i = 0; i < dimension; i++)
+    {
+        Vertex& v = vertex_web[i];
+        v.id = ids_[i];
+        v.priority = priority_[i];
+        v.x = x_[i];
+        v.y = y_[i];
+        v.z = z_[i];
+        
+        // keep the cheapest kMaxVertexNeighbors edges (in neighbor id order)
+        edges.clear();
+        for (uint e = offsets_[i]; e < offsets_[i+1]; e++) edges.push_back(e);
+        if (edges.size() > kMaxVertexNeighbors)
+        {
+            ROS_WARN_STREAM("CsrGraph::toVertices() - vertex " << v.id << " has " << edges.size() << " neighbors, keeping the " << kMaxVertexNeighbors << " cheapest ones");
+            std::stable_sort(edges.begin(), edges.end(), [this](uint e1, uint e2){ return costs_[e1] < costs_[e2]; });
+            edges.resize(kMaxVertexNeighbors);
+            std::sort(edges.begin(), edges.end());
+        }
+        
+        setVertexEdges(v, edges);
+    }
+    
+    for (std::unordered_map<uint64_t, VertexNavData>::const_iterator it = nav_data_.begin(); it != nav_data_.end(); it++)
+    {
+        const uint idFrom = (uint)(it->first >> 32); 
+        const uint idTo = (uint)(it->first & 0xffffffff);
+        if (idFrom < dimension) vertex_web[idFrom].nav_data[idTo] = it->second;
+    }
+}
+
+int CsrGraph::findEdge(const uint v1, const uint v2) const
+{
+    if (v1 >= size()) return -1; /// < EXIT POINT
+    
+    const std::vector<uint>::const_iterator begin = neighbors_.begin() + offsets_[v1], end = neighbors_.begin() + offsets_[v1+1];
+    const std::vector<uint>::const_iterator it = std::lower_bound(begin, end, v2);
+    if ( (it == end) || (*it != v2) ) return -1; /// < EXIT POINT
+    return (int)(it - neighbors_.begin());
+}
+
+void CsrGraph::setNavData(const uint idFrom, const uint idTo, const float cost, const ros::Time& timestamp)
+{
+    VertexNavData& navData = nav_data_[getNavKey(idFrom, idTo)];
+    navData.cost = cost;
+    navData.timestamp = timestamp;
+}
+
+float CsrGraph::getDynCostToGo(const uint idFrom, const uint idTo, const ros::Time& time) const
+{
+    float res = -1; 
+    std::unordered_map<uint64_t, VertexNavData>::const_iterator it = nav_data_.find(getNavKey(idFrom, idTo));
+    if ( it != nav_data_.end() )
+    {
+        const ros::Time& timestamp = it->second.timestamp;
+        if ( ( timestamp - time).toSec() < Vertex::kExpirationTimeValidDynCost )
+        {
+            res = it->second.cost;
+        }
+    }
+    return res;
+}
+
+void CsrGraph::setVertexEdges(Vertex& v, const std::vector<uint>& edges) const
+{
+    v.num_neigh = std::min((uint)edges.size(), kMaxVertexNeighbors);
+    for (uint k = 0; k < v.num_neigh; k++)
+    {
+        const uint e = edges[k];
+        v.id_neigh[k] = neighbors_[e];
+        v.cost[k] = costs_[e];
+        v.cost_m[k] = costs_m_[e];
+        memset(&(v.dir[k][0]), 0, 3);
+        dirs_[e].copy(&(v.dir[k][0]), 2);
+    }
+}
+
+void CsrGraph::sortEdges()
+{
+    std::vector<uint> order;
+    std::vector<uint> neighbors(neighbors_.size()), costs(costs_.size());
+    std::vector<float> costs_m(costs_m_.size());
+    std::vector<std::string> dirs(dirs_.size());
+    for (uint i = 0; i < size(); i++)
+    {
+        order.clear();
+        for (uint e = offsets_[i]; e < offsets_[i+1]; e++) order.push_back(e);
+        std::stable_sort(order.begin(), order.end(), [this](uint e1, uint e2){ return neighbors_[e1] < neighbors_[e2]; });
+        for (uint k = 0; k < order.size(); k++)
+        {
+            const uint e = offsets_[i] + k;
+            neighbors[e] = neighbors_[order[k]];
+            costs[e] = costs_[order[k]];
+            costs_m[e] = costs_m_[order[k]];
+            dirs[e].swap(dirs_[order[k]]);
+        }
+    }
+    neighbors_.swap(neighbors);
+    costs_.swap(costs);
+    costs_m_.swap(costs_m);
+    dirs_.swap(dirs);
+}
@@ -0,0 +1,110 @@
+/**
+* This file is part of the ROS package patrolling3d_sim which belongs to the framework 3DMR. 
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> 
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CSR_GRAPH_H
+#define CSR_GRAPH_H
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <stdint.h>
+
+#include "graph.h"
+
+///	\class CsrGraph
+///	\author Luigi Freda 
+///	\brief Patrolling graph in compressed sparse row form: the neighbors of vertex i are neighbors_[offsets_[i]:offsets_[i+1]] (sorted by id), 
+///	       with the edge costs in the parallel arrays costs_ (rounded, as Vertex::cost) and costs_m_ (as Vertex::cost_m). 
+///	       There is no limit on the number of neighbors; the neighbor lookup is a binary search. 
+///	       The dynamic navigation costs (Vertex::nav_data) are stored in a single hashed table keyed by the pair of vertices. 
+///	\note  It is an adapter source for the Vertex array used by the agent algorithms (see toVertices()): a Vertex keeps at most 
+///	       kMaxVertexNeighbors neighbors (the cheapest ones). The vertex ids are the indices in the graph (as with Vertex arrays). 
+/// 	\todo 
+///	\date
+///	\warning not thread-safe (use it under the lock of the graph)
+class CsrGraph
+{
+public: 
+    
+    static const uint kMaxVertexNeighbors = 8; // size of the neighbor arrays of Vertex 
+    
+public: 
+    
+    CsrGraph(){ clear(); }
+    
+    void clear();
+    
+    // build the graph from the message (all the neighbors of the adjacency matrix)
+    void buildFromMsg(const patrolling_build_graph_msgs::Graph& msg);
+    
+    // build the graph from a Vertex array 
+    void buildFromVertices(const Vertex* vertex_web, const uint dimension);
+    
+    // incremental building (e.g. while reading a graph file): add a vertex, then its edges; call finalize() at the end 
+    void addVertex(const uint id, const float x, const float y, const float z, const float priority);
+    void addEdge(const uint idNeighbor, const std::string& dir, const uint cost, const float cost_m); // edge of the last added vertex
+    void finalize();
+    
+    // adapter for the agent algorithms: allocate and fill vertex_web (at most kMaxVertexNeighbors neighbors per vertex)
+    void toVertices(Vertex* &vertex_web, uint& dimension) const; 
+    
+    uint size() const { return (uint)ids_.size(); }
+    uint getNumEdges() const { return (uint)neighbors_.size(); }
+    uint getNumNeighbors(const uint v) const { return offsets_[v+1] - offsets_[v]; }
+    
+    // edge range of v: the edges e in [getEdgesBegin(v), getEdgesEnd(v)) 
+    uint getEdgesBegin(const uint v) const { return offsets_[v]; }
+    uint getEdgesEnd(const uint v) const { return offsets_[v+1]; }
+    uint getNeighbor(const uint e) const { return neighbors_[e]; }
+    uint getCost(const uint e) const { return costs_[e]; }
+    float getCostM(const uint e) const { return costs_m_[e]; }
+    
+    // edge from v1 to v2 (binary search), -1 if they are not neighbors 
+    int findEdge(const uint v1, const uint v2) const;
+    
+    // dynamic navigation costs (see Vertex::nav_data and Vertex::getDynCostToGo())
+    void setNavData(const uint idFrom, const uint idTo, const float cost, const ros::Time& timestamp);
+    float getDynCostToGo(const uint idFrom, const uint idTo, const ros::Time& time) const;
+    
+protected:
+    
+    static uint64_t getNavKey(const uint idFrom, const uint idTo) { return ((uint64_t)idFrom << 32) | idTo; }
+    
+    // sort the edges of each vertex by neighbor id 
+    void sortEdges();
+    
+    // copy the given edges into the neighbor arrays of v (at most kMaxVertexNeighbors)
+    void setVertexEdges(Vertex& v, const std::vector<uint>& edges) const;
+    
+protected:     
+    
+    std::vector<uint> ids_;
+    std::vector<float> x_, y_, z_, priority_;
+    
+    std::vector<uint> offsets_;    // size() + 1 
+    std::vector<uint> neighbors_;  // neighbor ids 
+    std::vector<uint> costs_;
+    std::vector<float> costs_m_;
+    std::vector<std::string> dirs_; // "N","NE","E","SE","S","SW","W","NW" (3 chars max)
+    
+    std::unordered_map<uint64_t, VertexNavData> nav_data_; 
+};
+
+#endif
@@ -108,11 +108,13 @@ void DTAGreedy_Agent::init(int argc, char** argv) {
 
 double DTAGreedy_Agent::compute_cost(int vertex)
 {
+    if (shortest_paths_.contains(current_vertex_, vertex)) return shortest_paths_.getCost(current_vertex_, vertex); /// < EXIT POINT (table lookup)
+    
     uint elem_s_path;
-    int *shortest_path = new int[graph_dimension_]; 
+    std::vector<int> shortest_path(graph_dimension_); 
     int id_neigh;
     
-    dijkstra( current_vertex_, vertex, shortest_path, elem_s_path, graph_, graph_dimension_); //structure with normal costs
+    dijkstra( current_vertex_, vertex, shortest_path.data(), elem_s_path, graph_, graph_dimension_); //structure with normal costs
     double distance = 0;
     
     for(uint j=0; j<elem_s_path; j++){
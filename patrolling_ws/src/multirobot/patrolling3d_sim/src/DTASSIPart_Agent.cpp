@@ -20,9 +20,18 @@ protected:
     //based on the array bids	
     void update_tasks();
 
+    //sum_distances[v] = sum of the path costs from vertex v to all the current tasks. 
+    //It is updated incrementally when a task is added or removed (see update_sum_distances()) 
+    std::vector<double> sum_distances;
+    std::vector<bool> sum_distances_tasks;       // tasks accounted in sum_distances
+    size_t sum_distances_shortest_paths_version; // version of the shortest path table used for sum_distances
+
     //compute center point given current tasks	
     void compute_center_location();
 
+    //add to/subtract from sum_distances the costs of the tasks that changed; everything is recomputed if the shortest paths changed
+    void update_sum_distances();
+
     double compute_sum_distance(int cv);
 
 
@@ -54,6 +63,10 @@ void DTASSIPart_Agent::init(int argc, char** argv)
     //set current center location to current vertex	    
     current_center_location = current_vertex_;
 
+    sum_distances.assign(graph_dimension_, 0.);
+    sum_distances_tasks.assign(graph_dimension_, false);
+    sum_distances_shortest_paths_version = shortest_paths_.getVersion();
+
     //    fprintf(logfile,"initialised current center location to: %d \n",current_center_location);
 
     //initialize parameters
@@ -98,6 +111,8 @@ double DTASSIPart_Agent::compute_bid(int nv)
 
 void DTASSIPart_Agent::compute_center_location()
 {
+    update_sum_distances();
+    
     size_t min = current_vertex_;
     //	printf("compute center:: min: %d current center: %d \n",min,current_center_location);
     double min_dist = compute_sum_distance(min);
@@ -119,23 +134,38 @@ void DTASSIPart_Agent::compute_center_location()
 
 }
 
-double DTASSIPart_Agent::compute_sum_distance(int cv)
+void DTASSIPart_Agent::update_sum_distances()
 {
-    if (cv < 0 || cv >= graph_dimension_)
+    if (sum_distances.size() != graph_dimension_ || sum_distances_shortest_paths_version != shortest_paths_.getVersion())
     {
-        //		printf("return big number: cv = %d",cv);
-        return BIG_NUMBER;
+        // the costs changed: recompute from scratch 
+        sum_distances.assign(graph_dimension_, 0.);
+        sum_distances_tasks.assign(graph_dimension_, false);
+        sum_distances_shortest_paths_version = shortest_paths_.getVersion();
     }
-    double sum = 0.;
+    
     for (size_t i = 0; i < graph_dimension_; i++)
     {
-        if (tasks[i])
+        if (tasks[i] == sum_distances_tasks[i]) continue; /// < CONTINUE
+        
+        const double sign = tasks[i] ? 1. : -1.;
+        for (size_t v = 0; v < graph_dimension_; v++)
         {
-            //			printf("sum: %2.f \n",sum);
-            sum += compute_cost(cv, i);
+            // unreachable tasks are capped to avoid inf - inf when they are removed
+            sum_distances[v] += sign * std::min(compute_cost(v, i), (double) BIG_NUMBER);
         }
+        sum_distances_tasks[i] = tasks[i];
+    }
+}
+
+double DTASSIPart_Agent::compute_sum_distance(int cv)
+{
+    if (cv < 0 || cv >= graph_dimension_)
+    {
+        //		printf("return big number: cv = %d",cv);
+        return BIG_NUMBER;
     }
-    return sum;
+    return sum_distances[cv];
 }
 
 void DTASSIPart_Agent::update_tasks()
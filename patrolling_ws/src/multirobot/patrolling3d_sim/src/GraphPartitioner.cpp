@@ -0,0 +1,557 @@
+/**
+* This file is part of the ROS package patrolling3d_sim which belongs to the framework 3DMR. 
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> 
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "GraphPartitioner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <random>
+#include <utility>
+
+#include "CsrGraph.h"
+
+// shortest travel time of an edge (it bounds the affinities)
+static const double kMinTravelTime = 1e-3; 
+
+// max number of vertices visited by the connectivity check of a move 
+static const size_t kMaxConnectivitySearch = 256; 
+
+// the coarsening stops when a level has more than this fraction of the vertices of the finer level 
+static const double kMinCoarseningRatio = 0.95; 
+
+// max weight of a coarse vertex, as a multiple of the average weight of the vertices of the coarsest level 
+static const double kMaxCoarseVertexWeight = 1.5; 
+
+
+GraphPartitioner::GraphPartitioner(const Options& options):options_(options),num_regions_(0),visit_stamp_(0)
+{
+}
+
+void GraphPartitioner::setGraph(const uint num_vertices, const std::vector<uint>& offsets, const std::vector<uint>& neighbors, const std::vector<double>& travel_times, 
+                                const std::vector<double>& vertex_weights)
+{
+    struct Edge
+    {
+        uint v1, v2; // v1 < v2 
+        double travel_time; 
+        bool operator<(const Edge& other) const 
+        { 
+            if (v1 != other.v1) return v1 < other.v1; 
+            if (v2 != other.v2) return v2 < other.v2; 
+            return travel_time < other.travel_time;
+        }
+    };
+    
+    std::vector<Edge> edges; 
+    edges.reserve(neighbors.size());
+    for (uint v = 0; v < num_vertices; v++)
+    {
+        for (uint e = offsets[v]; e < offsets[v+1]; e++)
+        {
+            const uint u = neighbors[e];
+            if ((u == v) || (u >= num_vertices)) continue; /// < CONTINUE
+            Edge edge;
+            edge.v1 = std::min(u, v);
+            edge.v2 = std::max(u, v);
+            edge.travel_time = std::max(travel_times[e], kMinTravelTime);
+            edges.push_back(edge);
+        }
+    }
+    // the duplicated edges keep the shortest travel time (the first one)
+    std::sort(edges.begin(), edges.end());
+    size_t num_edges = 0; 
+    for (size_t i = 0; i < edges.size(); i++)
+    {
+        if ((num_edges > 0) && (edges[num_edges-1].v1 == edges[i].v1) && (edges[num_edges-1].v2 == edges[i].v2)) continue; /// < CONTINUE
+        edges[num_edges++] = edges[i];
+    }
+    edges.resize(num_edges);
+    
+    Level level; 
+    level.offsets.assign(num_vertices + 1, 0);
+    for (size_t i = 0; i < edges.size(); i++)
+    {
+        level.offsets[edges[i].v1 + 1]++;
+        level.offsets[edges[i].v2 + 1]++;
+    }
+    for (uint v = 0; v < num_vertices; v++)
+    {
+        level.offsets[v+1] += level.offsets[v];
+    }
+    level.neighbors.resize(2 * edges.size());
+    level.affinities.resize(2 * edges.size());
+    std::vector<uint> next(level.offsets.begin(), level.offsets.end() - 1);
+    for (size_t i = 0; i < edges.size(); i++)
+    {
+        const Edge& edge = edges[i];
+        level.neighbors[next[edge.v1]] = edge.v2;
+        level.affinities[next[edge.v1]++] = 1. / edge.travel_time;
+        level.neighbors[next[edge.v2]] = edge.v1;
+        level.affinities[next[edge.v2]++] = 1. / edge.travel_time;
+    }
+    
+    if (vertex_weights.size() == num_vertices)
+        level.weights = vertex_weights;
+    else
+        level.weights.assign(num_vertices, 1.);
+    level.robots.assign(num_vertices, -1);
+    
+    levels_.assign(1, level);
+    last_partition_.clear();
+}
+
+void GraphPartitioner::setGraph(const CsrGraph& graph)
+{
+    const uint num_vertices = graph.size();
+    std::vector<uint> offsets(num_vertices + 1), neighbors(graph.getNumEdges());
+    std::vector<double> travel_times(graph.getNumEdges());
+    for (uint v = 0; v < num_vertices; v++)
+    {
+        offsets[v] = graph.getEdgesBegin(v);
+        for (uint e = graph.getEdgesBegin(v); e < graph.getEdgesEnd(v); e++)
+        {
+            neighbors[e] = graph.getNeighbor(e);
+            travel_times[e] = (graph.getCostM(e) > 0) ? graph.getCostM(e) : graph.getCost(e);
+        }
+    }
+    offsets[num_vertices] = graph.getNumEdges();
+    setGraph(num_vertices, offsets, neighbors, travel_times);
+}
+
+void GraphPartitioner::setGraph(const Vertex* vertex_web, const uint dimension)
+{
+    std::vector<uint> offsets(1, 0), neighbors;
+    std::vector<double> travel_times;
+    for (uint v = 0; v < dimension; v++)
+    {
+        for (uint k = 0; k < vertex_web[v].num_neigh; k++)
+        {
+            neighbors.push_back(vertex_web[v].id_neigh[k]);
+            travel_times.push_back((vertex_web[v].cost_m[k] > 0) ? vertex_web[v].cost_m[k] : vertex_web[v].cost[k]);
+        }
+        offsets.push_back(neighbors.size());
+    }
+    setGraph(dimension, offsets, neighbors, travel_times);
+}
+
+bool GraphPartitioner::setRobots(const std::vector<int>& robot_vertices)
+{
+    if (levels_.empty() || robot_vertices.empty()) return false; /// < EXIT POINT
+    
+    Level& level = levels_[0];
+    for (size_t k = 0; k < robot_vertices.size(); k++)
+    {
+        if ((robot_vertices[k] < 0) || (robot_vertices[k] >= (int)level.size())) return false; /// < EXIT POINT
+    }
+    
+    level.robots.assign(level.size(), -1);
+    for (size_t k = 0; k < robot_vertices.size(); k++)
+    {
+        // a robot sharing its vertex with a previous robot gets an empty region 
+        if (level.robots[robot_vertices[k]] < 0) level.robots[robot_vertices[k]] = k;
+    }
+    num_regions_ = robot_vertices.size();
+    return true;
+}
+
+bool GraphPartitioner::compute(const std::vector<int>& robot_vertices, std::vector<int>& partition)
+{
+    const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    stats_ = Stats();
+    
+    if (!setRobots(robot_vertices)) return false; /// < EXIT POINT
+    
+    // coarsening 
+    levels_.resize(1);
+    const size_t coarse_size = num_regions_ * std::max(options_.coarse_vertices_per_region, (size_t)1);
+    while ((levels_.back().size() > coarse_size) && coarsen()) {}
+    
+    // initial partition of the coarsest level 
+    std::vector<int> coarse_partition; 
+    growRegions(levels_.back(), NULL, coarse_partition);
+    refine(levels_.back(), coarse_partition);
+    
+    // uncoarsening 
+    for (int l = (int)levels_.size() - 2; l >= 0; l--)
+    {
+        const Level& level = levels_[l];
+        partition.resize(level.size());
+        for (uint v = 0; v < level.size(); v++)
+        {
+            partition[v] = coarse_partition[level.coarse_map[v]];
+        }
+        refine(level, partition);
+        coarse_partition.swap(partition);
+    }
+    partition.swap(coarse_partition);
+    
+    last_partition_ = partition;
+    stats_.num_levels = levels_.size();
+    computeStats(partition);
+    stats_.compute_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    return true;
+}
+
+bool GraphPartitioner::update(const std::vector<int>& robot_vertices, std::vector<int>& partition)
+{
+    if (levels_.empty() || (last_partition_.size() != levels_[0].size()) || (num_regions_ != (int)robot_vertices.size()))
+    {
+        return compute(robot_vertices, partition); /// < EXIT POINT
+    }
+    
+    const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    stats_ = Stats();
+    
+    if (!setRobots(robot_vertices)) return false; /// < EXIT POINT
+    
+    // the coarser levels do not match the new robot vertices 
+    levels_.resize(1);
+    const Level& level = levels_[0];
+    
+    partition = last_partition_;
+    bool robots_in_regions = true; 
+    for (uint v = 0; v < level.size(); v++)
+    {
+        if ((level.robots[v] >= 0) && (partition[v] != level.robots[v]))
+        {
+            robots_in_regions = false;
+            break; /// < BREAK
+        }
+    }
+    if (!robots_in_regions)
+    {
+        growRegions(level, &last_partition_, partition);
+    }
+    refine(level, partition);
+    
+    last_partition_ = partition;
+    stats_.num_levels = 1;
+    computeStats(partition);
+    stats_.compute_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    return true;
+}
+
+bool GraphPartitioner::coarsen()
+{
+    const uint n = levels_.back().size();
+    
+    double total_weight = 0; 
+    for (uint v = 0; v < n; v++) total_weight += levels_.back().weights[v];
+    const size_t coarse_size = num_regions_ * std::max(options_.coarse_vertices_per_region, (size_t)1);
+    const double max_weight = kMaxCoarseVertexWeight * total_weight / coarse_size;
+    
+    // heavy-edge matching in a random (reproducible) order 
+    std::vector<uint> order(n);
+    for (uint v = 0; v < n; v++) order[v] = v;
+    std::shuffle(order.begin(), order.end(), std::mt19937(n));
+    
+    const Level& fine = levels_.back();
+    std::vector<int> match(n, -1);
+    for (uint i = 0; i < n; i++)
+    {
+        const uint v = order[i];
+        if (match[v] >= 0) continue; /// < CONTINUE
+        int best = -1; 
+        double best_affinity = 0; 
+        for (uint e = fine.offsets[v]; e < fine.offsets[v+1]; e++)
+        {
+            const uint u = fine.neighbors[e];
+            if (match[u] >= 0) continue; /// < CONTINUE
+            if ((fine.robots[v] >= 0) && (fine.robots[u] >= 0)) continue; /// < CONTINUE
+            if (fine.weights[v] + fine.weights[u] > max_weight) continue; /// < CONTINUE
+            if (fine.affinities[e] > best_affinity)
+            {
+                best_affinity = fine.affinities[e];
+                best = u;
+            }
+        }
+        match[v] = (best >= 0) ? best : v;
+        if (best >= 0) match[best] = v;
+    }
+    
+    std::vector<uint> coarse_map(n, n);
+    std::vector<uint> members; // the vertices of each coarse vertex (two for a matched pair)
+    members.reserve(2 * n);
+    std::vector<uint> members_begin(1, 0);
+    for (uint v = 0; v < n; v++)
+    {
+        if (coarse_map[v] < n) continue; /// < CONTINUE
+        const uint c = members_begin.size() - 1;
+        coarse_map[v] = c;
+        members.push_back(v);
+        if (match[v] != (int)v)
+        {
+            coarse_map[match[v]] = c;
+            members.push_back(match[v]);
+        }
+        members_begin.push_back(members.size());
+    }
+    const uint num_coarse = members_begin.size() - 1;
+    if (num_coarse > kMinCoarseningRatio * n) return false; /// < EXIT POINT
+    
+    Level coarse; 
+    coarse.offsets.reserve(num_coarse + 1);
+    coarse.weights.assign(num_coarse, 0.);
+    coarse.robots.assign(num_coarse, -1);
+    std::vector<double> affinities(num_coarse, 0.);
+    std::vector<int> markers(num_coarse, -1);
+    std::vector<uint> touched; 
+    coarse.offsets.push_back(0);
+    for (uint c = 0; c < num_coarse; c++)
+    {
+        for (uint i = members_begin[c]; i < members_begin[c+1]; i++)
+        {
+            const uint v = members[i];
+            coarse.weights[c] += fine.weights[v];
+            if (fine.robots[v] >= 0) coarse.robots[c] = fine.robots[v];
+            
+            // merge the parallel edges 
+            for (uint e = fine.offsets[v]; e < fine.offsets[v+1]; e++)
+            {
+                const uint cu = coarse_map[fine.neighbors[e]];
+                if (cu == c) continue; /// < CONTINUE
+                if (markers[cu] != (int)c)
+                {
+                    markers[cu] = c;
+                    affinities[cu] = 0;
+                    touched.push_back(cu);
+                }
+                affinities[cu] += fine.affinities[e];
+            }
+        }
+        for (size_t i = 0; i < touched.size(); i++)
+        {
+            coarse.neighbors.push_back(touched[i]);
+            coarse.affinities.push_back(affinities[touched[i]]);
+        }
+        touched.clear();
+        coarse.offsets.push_back(coarse.neighbors.size());
+    }
+    
+    levels_.back().coarse_map.swap(coarse_map);
+    levels_.push_back(coarse); 
+    return true;
+}
+
+void GraphPartitioner::growRegions(const Level& level, const std::vector<int>* previous, std::vector<int>& partition)
+{
+    typedef std::pair<double, uint> QueueItem; // (travel time from the robot vertex, vertex)
+    typedef std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem> > Queue; 
+    
+    const uint n = level.size();
+    partition.assign(n, -1);
+    std::vector<double> region_weights(num_regions_, 0.);
+    std::vector<Queue> queues(num_regions_);
+    for (uint v = 0; v < n; v++)
+    {
+        if (level.robots[v] >= 0) queues[level.robots[v]].push(QueueItem(0., v));
+    }
+    
+    // the lightest region grows first 
+    while (true)
+    {
+        int region = -1; 
+        for (int k = 0; k < num_regions_; k++)
+        {
+            if (!queues[k].empty() && ((region < 0) || (region_weights[k] < region_weights[region]))) region = k;
+        }
+        if (region < 0) break; /// < BREAK
+        
+        const QueueItem item = queues[region].top();
+        queues[region].pop();
+        const uint v = item.second;
+        if (partition[v] >= 0) continue; /// < CONTINUE
+        
+        partition[v] = region;
+        region_weights[region] += level.weights[v];
+        for (uint e = level.offsets[v]; e < level.offsets[v+1]; e++)
+        {
+            const uint u = level.neighbors[e];
+            if (partition[u] >= 0) continue; /// < CONTINUE
+            if ((level.robots[u] >= 0) && (level.robots[u] != region)) continue; /// < CONTINUE
+            double travel_time = 1. / level.affinities[e];
+            if (previous && ((*previous)[u] != region)) travel_time *= 1. + options_.sticky_growth_penalty;
+            queues[region].push(QueueItem(item.first + travel_time, u));
+        }
+    }
+    
+    // the components without robots go to the lightest region 
+    std::vector<uint> stack; 
+    for (uint v = 0; v < n; v++)
+    {
+        if (partition[v] >= 0) continue; /// < CONTINUE
+        const int region = std::min_element(region_weights.begin(), region_weights.end()) - region_weights.begin();
+        partition[v] = region;
+        stack.push_back(v);
+        while (!stack.empty())
+        {
+            const uint w = stack.back();
+            stack.pop_back();
+            region_weights[region] += level.weights[w];
+            for (uint e = level.offsets[w]; e < level.offsets[w+1]; e++)
+            {
+                const uint u = level.neighbors[e];
+                if (partition[u] >= 0) continue; /// < CONTINUE
+                partition[u] = region;
+                stack.push_back(u);
+            }
+        }
+    }
+}
+
+void GraphPartitioner::refine(const Level& level, std::vector<int>& partition)
+{
+    const uint n = level.size();
+    std::vector<double> region_weights(num_regions_, 0.);
+    double total_weight = 0; 
+    for (uint v = 0; v < n; v++)
+    {
+        region_weights[partition[v]] += level.weights[v];
+        total_weight += level.weights[v];
+    }
+    const double max_weight = (1. + options_.imbalance_tolerance) * total_weight / num_regions_;
+    
+    std::vector<double> connections(num_regions_, 0.); // affinity of v to each region 
+    std::vector<char> is_touched(num_regions_, 0);
+    std::vector<int> touched; 
+    for (int pass = 0; pass < options_.max_refinement_passes; pass++)
+    {
+        size_t num_moves = 0; 
+        for (uint v = 0; v < n; v++)
+        {
+            if (level.robots[v] >= 0) continue; /// < CONTINUE (the robot vertices stay in their regions)
+            
+            const int region = partition[v];
+            for (uint e = level.offsets[v]; e < level.offsets[v+1]; e++)
+            {
+                const int r = partition[level.neighbors[e]];
+                if (!is_touched[r])
+                {
+                    is_touched[r] = 1; 
+                    touched.push_back(r);
+                }
+                connections[r] += level.affinities[e];
+            }
+            
+            // the move with the highest cut gain which keeps the balance, or which reduces the weight of an overweight region 
+            int best = -1; 
+            double best_gain = -std::numeric_limits<double>::max();
+            for (size_t i = 0; i < touched.size(); i++)
+            {
+                const int r = touched[i];
+                if (r == region) continue; /// < CONTINUE
+                const double gain = connections[r] - connections[region];
+                const double new_weight = region_weights[r] + level.weights[v];
+                const bool improves_cut = (gain > 0) && (new_weight <= max_weight);
+                const bool improves_balance = (region_weights[region] > max_weight) && (new_weight < region_weights[region]);
+                if ((improves_cut || improves_balance) && (gain > best_gain))
+                {
+                    best_gain = gain;
+                    best = r;
+                }
+            }
+            
+            for (size_t i = 0; i < touched.size(); i++)
+            {
+                connections[touched[i]] = 0;
+                is_touched[touched[i]] = 0;
+            }
+            touched.clear();
+            
+            if ((best >= 0) && isMoveConnected(level, partition, v))
+            {
+                region_weights[region] -= level.weights[v];
+                region_weights[best] += level.weights[v];
+                partition[v] = best;
+                num_moves++;
+            }
+        }
+        stats_.num_moves += num_moves;
+        if (num_moves == 0) break; /// < BREAK
+    }
+}
+
+bool GraphPartitioner::isMoveConnected(const Level& level, const std::vector<int>& partition, const uint v)
+{
+    const int region = partition[v];
+    
+    // the neighbors of v in its region must stay connected without v 
+    std::vector<uint> targets; 
+    for (uint e = level.offsets[v]; e < level.offsets[v+1]; e++)
+    {
+        if (partition[level.neighbors[e]] == region) targets.push_back(level.neighbors[e]);
+    }
+    if (targets.size() <= 1) return true; /// < EXIT POINT
+    
+    if (visit_stamps_.size() < level.size()) visit_stamps_.assign(level.size(), 0);
+    if (++visit_stamp_ == 0)
+    {
+        std::fill(visit_stamps_.begin(), visit_stamps_.end(), 0);
+        visit_stamp_ = 1;
+    }
+    
+    std::queue<uint> queue; 
+    visit_stamps_[v] = visit_stamp_;
+    visit_stamps_[targets[0]] = visit_stamp_;
+    queue.push(targets[0]);
+    size_t num_found = 1, num_visited = 0; 
+    while (!queue.empty() && (num_visited++ < kMaxConnectivitySearch))
+    {
+        const uint w = queue.front();
+        queue.pop();
+        for (uint e = level.offsets[w]; e < level.offsets[w+1]; e++)
+        {
+            const uint u = level.neighbors[e];
+            if ((partition[u] != region) || (visit_stamps_[u] == visit_stamp_)) continue; /// < CONTINUE
+            visit_stamps_[u] = visit_stamp_;
+            if (std::find(targets.begin(), targets.end(), u) != targets.end())
+            {
+                if (++num_found == targets.size()) return true; /// < EXIT POINT
+            }
+            queue.push(u);
+        }
+    }
+    return false;
+}
+
+void GraphPartitioner::computeStats(const std::vector<int>& partition)
+{
+    const Level& level = levels_[0];
+    std::vector<double> region_weights(num_regions_, 0.);
+    double total_weight = 0; 
+    for (uint v = 0; v < level.size(); v++)
+    {
+        region_weights[partition[v]] += level.weights[v];
+        total_weight += level.weights[v];
+        for (uint e = level.offsets[v]; e < level.offsets[v+1]; e++)
+        {
+            if ((level.neighbors[e] > v) && (partition[level.neighbors[e]] != partition[v]))
+            {
+                stats_.num_cut_edges++;
+                stats_.cut_travel_time += 1. / level.affinities[e];
+            }
+        }
+    }
+    const double avg_weight = total_weight / num_regions_;
+    stats_.max_imbalance = (avg_weight > 0) ? *std::max_element(region_weights.begin(), region_weights.end()) / avg_weight : 0.;
+}
@@ -0,0 +1,146 @@
+/**
+* This file is part of the ROS package patrolling3d_sim which belongs to the framework 3DMR. 
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> 
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GRAPH_PARTITIONER_H
+#define GRAPH_PARTITIONER_H
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "graph.h"
+
+class CsrGraph; 
+
+///	\class GraphPartitioner
+///	\author Luigi Freda 
+///	\brief Partition of a graph (patrolling graph or traversability graph) into balanced connected regions, one for each robot: 
+///	       region k contains the vertex of robot k. The edge weights are travel times, the cut prefers the long edges. 
+///	       compute() is multilevel (as METIS): 
+///	       1) coarsening: heavy-edge matching on the edge affinities (1/travel time), two robot vertices are never merged; 
+///	       2) initial partition of the coarsest graph: the regions grow from the robot vertices along the shortest paths, the lightest region first; 
+///	       3) uncoarsening: the partition is projected to each finer graph and refined by greedy boundary moves which decrease the cut 
+///	          or the imbalance, and never disconnect a region. 
+///	       update() rebalances incrementally after the robots moved: when every robot is still in its region only the refinement runs, 
+///	       otherwise the regions regrow from the robot vertices preferring the vertices of their previous region (sticky growth), so that 
+///	       the assignment changes as little as possible. 
+///	\note  The partitioner does not depend on ROS: the same regions can be computed by a patrolling agent, by the exploration team model 
+///	       or by the batch simulator. The vertices of a component without robots go to the lightest region (which is then not connected). 
+///	       A robot sharing its vertex with a previous robot gets an empty region. 
+/// 	\todo 
+///	\date
+///	\warning not thread-safe (use a partitioner per thread)
+class GraphPartitioner
+{
+public: 
+    
+    struct Options
+    {
+        Options():imbalance_tolerance(0.1),coarse_vertices_per_region(20),max_refinement_passes(8),sticky_growth_penalty(2.0){}
+        
+        double imbalance_tolerance;        // a region weighs at most (1 + imbalance_tolerance) x the average weight (if the moves allow it)
+        size_t coarse_vertices_per_region; // the coarsening stops at about this number of vertices per region 
+        int max_refinement_passes;         // boundary passes at each level 
+        double sticky_growth_penalty;      // update(): the travel times to the vertices of other previous regions are multiplied by 1 + penalty
+    };
+    
+    struct Stats
+    {
+        Stats():num_levels(0),num_cut_edges(0),cut_travel_time(0),max_imbalance(0),num_moves(0),compute_time(0){}
+        
+        size_t num_levels;       // graphs of the multilevel hierarchy (1 for the incremental updates)
+        size_t num_cut_edges; 
+        double cut_travel_time;  // sum of the travel times of the cut edges
+        double max_imbalance;    // weight of the heaviest region / average weight 
+        size_t num_moves;        // refinement moves 
+        double compute_time;     // [s]
+    };
+    
+public: 
+    
+    GraphPartitioner(const Options& options = Options()); 
+    
+    // undirected graph in CSR form: the neighbors of v are neighbors[offsets[v]:offsets[v+1]], with the travel times in the parallel array; 
+    // the missing reverse edges are added and the duplicated edges keep the shortest travel time; vertex_weights default to 1 
+    void setGraph(const uint num_vertices, const std::vector<uint>& offsets, const std::vector<uint>& neighbors, const std::vector<double>& travel_times, 
+                  const std::vector<double>& vertex_weights = std::vector<double>());
+    
+    // the travel times are the metric edge costs (cost_m) 
+    void setGraph(const CsrGraph& graph);
+    void setGraph(const Vertex* vertex_web, const uint dimension);
+    
+    uint size() const { return levels_.empty() ? 0 : levels_[0].size(); }
+    
+    // partition[v] = robot (index in robot_vertices) of the region of vertex v; return false if there is no robot or a robot vertex is invalid 
+    bool compute(const std::vector<int>& robot_vertices, std::vector<int>& partition);
+    
+    // incremental rebalancing from the last partition (a full compute() if there is none for the same graph and number of robots)
+    bool update(const std::vector<int>& robot_vertices, std::vector<int>& partition);
+    
+    const Stats& getStats() const { return stats_; }
+    const Options& getOptions() const { return options_; }
+    
+protected:
+    
+    // a graph of the multilevel hierarchy 
+    struct Level
+    {
+        uint size() const { return (uint)weights.size(); }
+        
+        std::vector<uint> offsets;      // size() + 1 
+        std::vector<uint> neighbors;
+        std::vector<double> affinities; // 1 / travel time, summed over the merged edges 
+        std::vector<double> weights;    // vertex weights, summed over the merged vertices 
+        std::vector<int> robots;        // robot of a vertex containing a robot vertex, -1 otherwise 
+        std::vector<uint> coarse_map;   // vertex of the next coarser level containing this vertex 
+    };
+    
+    bool setRobots(const std::vector<int>& robot_vertices); 
+    
+    // coarsen levels_.back() into a new level; return false if it did not shrink enough 
+    bool coarsen();
+    
+    // grow the regions from the robot vertices; previous (if not null) is the previous region of each vertex for the sticky growth
+    void growRegions(const Level& level, const std::vector<int>* previous, std::vector<int>& partition);
+    
+    // greedy boundary refinement 
+    void refine(const Level& level, std::vector<int>& partition);
+    
+    // whether the region of v stays connected without v (bounded search, false if the bound is reached)
+    bool isMoveConnected(const Level& level, const std::vector<int>& partition, const uint v);
+    
+    void computeStats(const std::vector<int>& partition);
+    
+protected:
+    
+    Options options_; 
+    Stats stats_; 
+    
+    std::vector<Level> levels_; // levels_[0] is the input graph 
+    int num_regions_; 
+    
+    std::vector<int> last_partition_; // for update() 
+    
+    // search buffers 
+    std::vector<uint> visit_stamps_; 
+    uint visit_stamp_; 
+};
+
+#endif
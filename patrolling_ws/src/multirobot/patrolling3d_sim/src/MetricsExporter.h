@@ -0,0 +1,247 @@
+/**
+* This file is part of the ROS package patrolling3d_sim which belongs to the framework 3DMR. 
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> 
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef METRICS_EXPORTER_H
+#define METRICS_EXPORTER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+
+///	\class RobotCounters
+///	\author Luigi Freda
+///	\brief Counters of the events of a robot, incremented by the results callbacks and read by the exporter without locking. 
+///	\note
+/// 	\todo 
+///	\date
+///	\warning
+struct RobotCounters
+{
+    RobotCounters() { reset(); }
+
+    void reset()
+    {
+        messages.store(0, std::memory_order_relaxed);
+        visits.store(0, std::memory_order_relaxed);
+        interferences.store(0, std::memory_order_relaxed);
+    }
+
+    void addMessage() { messages.fetch_add(1, std::memory_order_relaxed); }
+    void addVisit() { visits.fetch_add(1, std::memory_order_relaxed); }
+    void addInterference() { interferences.fetch_add(1, std::memory_order_relaxed); }
+
+    std::atomic<uint64_t> messages;      // results messages received from the robot 
+    std::atomic<uint64_t> visits;        // vertices reached/intercepted by the robot 
+    std::atomic<uint64_t> interferences; // interferences sent by the robot 
+};
+
+
+///	\class MetricsSnapshot
+///	\author Luigi Freda
+///	\brief The global patrolling metrics at a given time. 
+///	\note
+/// 	\todo 
+///	\date
+///	\warning
+struct MetricsSnapshot
+{
+    static const int kNumQuantiles = 4; 
+
+    // level of the i-th exported quantile 
+    static double getQuantileLevel(int i)
+    {
+        static const double levels[kNumQuantiles] = {0.5, 0.9, 0.95, 0.99};
+        return levels[i];
+    }
+
+    MetricsSnapshot():time(0),idleness_count(0),idleness_min(0),idleness_avg(0),idleness_stddev(0),idleness_max(0),idleness_sum(0),
+                      complete_patrol(0),interferences(0)
+    {
+        for (int i = 0; i < kNumQuantiles; i++) idleness_quantiles[i] = 0;
+    }
+
+    double time; // time elapsed from the start of the patrolling (s)
+    size_t idleness_count;
+    double idleness_min, idleness_avg, idleness_stddev, idleness_max, idleness_sum;
+    double idleness_quantiles[kNumQuantiles]; // idleness at the quantiles getQuantileLevel(i) 
+    unsigned int complete_patrol;
+    unsigned int interferences;
+};
+
+
+///	\class MetricsExporter
+///	\author Luigi Freda
+///	\brief Periodic export of the patrolling metrics as time series, to analyze long runs without parsing the text reports: 
+///	       - <basename>_metrics.csv: one row of global metrics for each flush; 
+///	       - <basename>_robot_metrics.csv: one row for each robot and flush; 
+///	       - <basename>.prom: the last metrics in the Prometheus text format (e.g. for the textfile collector of the node exporter), 
+///	         rewritten at each flush and replaced atomically. 
+///	\note  the files are flushed at each write()
+/// 	\todo 
+///	\date
+///	\warning write() is not thread-safe 
+class MetricsExporter
+{
+public:
+
+    MetricsExporter():csv_file_(NULL),robot_csv_file_(NULL){}
+    ~MetricsExporter() { close(); }
+
+    bool open(const std::string& basename, bool csv, bool prometheus)
+    {
+        close();
+        bool ok = true;
+        if (csv)
+        {
+            csv_file_ = fopen((basename + "_metrics.csv").c_str(), "w");
+            robot_csv_file_ = fopen((basename + "_robot_metrics.csv").c_str(), "w");
+            ok = (csv_file_ != NULL) && (robot_csv_file_ != NULL);
+            if (csv_file_)
+            {
+                fprintf(csv_file_, "Time;Idleness count;Idleness min;Idleness avg;Idleness stddev;Idleness max");
+                for (int i = 0; i < MetricsSnapshot::kNumQuantiles; i++) 
+                {
+                    fprintf(csv_file_, ";Idleness p%g", 100 * MetricsSnapshot::getQuantileLevel(i));
+                }
+                fprintf(csv_file_, ";Complete patrol cycles;Interferences\n"); // header
+            }
+            if (robot_csv_file_)
+            {
+                fprintf(robot_csv_file_, "Time;Robot;Messages;Visits;Interferences\n"); // header
+            }
+        }
+        if (prometheus)
+        {
+            prometheus_filename_ = basename + ".prom";
+        }
+        return ok;
+    }
+
+    void close()
+    {
+        if (csv_file_) fclose(csv_file_);
+        if (robot_csv_file_) fclose(robot_csv_file_);
+        csv_file_ = NULL;
+        robot_csv_file_ = NULL;
+        prometheus_filename_.clear();
+    }
+
+    // append the metrics of the snapshot and of the first num_robots robots 
+    void write(const MetricsSnapshot& snapshot, const RobotCounters robots[], size_t num_robots)
+    {
+        // read the counters once, so that all the outputs agree 
+        messages_.resize(num_robots);
+        visits_.resize(num_robots);
+        interferences_.resize(num_robots);
+        for (size_t k = 0; k < num_robots; k++)
+        {
+            messages_[k] = robots[k].messages.load(std::memory_order_relaxed);
+            visits_[k] = robots[k].visits.load(std::memory_order_relaxed);
+            interferences_[k] = robots[k].interferences.load(std::memory_order_relaxed);
+        }
+
+        if (csv_file_)
+        {
+            fprintf(csv_file_, "%.1f;%lu;%.2f;%.2f;%.2f;%.2f", snapshot.time, (unsigned long) snapshot.idleness_count, snapshot.idleness_min,
+                    snapshot.idleness_avg, snapshot.idleness_stddev, snapshot.idleness_max);
+            for (int i = 0; i < MetricsSnapshot::kNumQuantiles; i++) 
+            {
+                fprintf(csv_file_, ";%.2f", snapshot.idleness_quantiles[i]);
+            }
+            fprintf(csv_file_, ";%u;%u\n", snapshot.complete_patrol, snapshot.interferences);
+            fflush(csv_file_);
+        }
+        if (robot_csv_file_)
+        {
+            for (size_t k = 0; k < num_robots; k++)
+            {
+                fprintf(robot_csv_file_, "%.1f;%lu;%llu;%llu;%llu\n", snapshot.time, (unsigned long) k, (unsigned long long) messages_[k],
+                        (unsigned long long) visits_[k], (unsigned long long) interferences_[k]);
+            }
+            fflush(robot_csv_file_);
+        }
+        if (!prometheus_filename_.empty())
+        {
+            writePrometheus(snapshot, num_robots);
+        }
+    }
+
+protected:
+
+    void writePrometheus(const MetricsSnapshot& snapshot, size_t num_robots)
+    {
+        // the readers never see a partial file 
+        const std::string tmp_filename = prometheus_filename_ + ".tmp";
+        FILE* file = fopen(tmp_filename.c_str(), "w");
+        if (!file) return; /// < EXIT POINT
+
+        fprintf(file, "# HELP patrolling_elapsed_seconds Time elapsed from the start of the patrolling.\n");
+        fprintf(file, "# TYPE patrolling_elapsed_seconds gauge\n");
+        fprintf(file, "patrolling_elapsed_seconds %.3f\n", snapshot.time);
+
+        fprintf(file, "# HELP patrolling_idleness_seconds Idleness of the vertices at their visits.\n");
+        fprintf(file, "# TYPE patrolling_idleness_seconds summary\n");
+        for (int i = 0; i < MetricsSnapshot::kNumQuantiles; i++) 
+        {
+            fprintf(file, "patrolling_idleness_seconds{quantile=\"%g\"} %.3f\n", MetricsSnapshot::getQuantileLevel(i), snapshot.idleness_quantiles[i]);
+        }
+        fprintf(file, "patrolling_idleness_seconds_sum %.3f\n", snapshot.idleness_sum);
+        fprintf(file, "patrolling_idleness_seconds_count %lu\n", (unsigned long) snapshot.idleness_count);
+
+        fprintf(file, "# HELP patrolling_idleness_max_seconds Maximum idleness of the vertices at their visits.\n");
+        fprintf(file, "# TYPE patrolling_idleness_max_seconds gauge\n");
+        fprintf(file, "patrolling_idleness_max_seconds %.3f\n", snapshot.idleness_max);
+
+        fprintf(file, "# HELP patrolling_complete_patrol_cycles Number of times all the vertices have been visited.\n");
+        fprintf(file, "# TYPE patrolling_complete_patrol_cycles gauge\n");
+        fprintf(file, "patrolling_complete_patrol_cycles %u\n", snapshot.complete_patrol);
+
+        writePrometheusCounter(file, "patrolling_robot_messages_total", "Results messages received from the robot.", messages_, num_robots);
+        writePrometheusCounter(file, "patrolling_robot_visits_total", "Vertices visited by the robot.", visits_, num_robots);
+        writePrometheusCounter(file, "patrolling_robot_interferences_total", "Interferences of the robot.", interferences_, num_robots);
+
+        fclose(file);
+        rename(tmp_filename.c_str(), prometheus_filename_.c_str());
+    }
+
+    static void writePrometheusCounter(FILE* file, const char* name, const char* help, const std::vector<uint64_t>& values, size_t num_robots)
+    {
+        fprintf(file, "# HELP %s %s\n", name, help);
+        fprintf(file, "# TYPE %s counter\n", name);
+        for (size_t k = 0; k < num_robots; k++)
+        {
+            fprintf(file, "%s{robot=\"%lu\"} %llu\n", name, (unsigned long) k, (unsigned long long) values[k]);
+        }
+    }
+
+protected:
+
+    FILE* csv_file_;
+    FILE* robot_csv_file_;
+    std::string prometheus_filename_; // empty if the Prometheus output is disabled 
+
+    std::vector<uint64_t> messages_, visits_, interferences_; // counters read at the last write()
+};
+
+
+#endif
@@ -24,12 +24,15 @@
 #include <sstream>
 #include <set>  
 #include <vector>
+#include <limits>
 
 #include "PatrolAgent.h"
 
-///	\class NodeInfo
+///	\class NavCostTable
 ///	\author Luigi Freda 
-///	\brief A class for representing a navigation cost table (available information from Team Model, Team Deployment and Dynamic Graph) 
+///	\brief A class for representing a navigation cost table (available information from Team Model, Team Deployment and Dynamic Graph). 
+///	       The costs are stored in a dense teamSize x graphSize matrix (row-major, -1 if unknown) with their timestamps; 
+///	       the best and second best robot of each node are cached and recomputed only for the nodes changed by set().
 ///	\note 
 /// 	\todo 
 ///	\date
@@ -37,70 +40,87 @@
 class NavCostTable
 {
 public: 
-    typedef std::map<int, float> RobotNavCostMap; // for each robot =>  { key: node id, value: nav cost-to-go }
     
-public: 
-    
-    NavCostTable(size_t teamSizeIn):table(teamSizeIn),teamSize(teamSizeIn){}
+    NavCostTable(size_t teamSizeIn, size_t graphSizeIn):
+        costs(teamSizeIn*graphSizeIn, -1), timestamps(teamSizeIn*graphSizeIn),
+        bestRobot(graphSizeIn, -1), bestCost(graphSizeIn, -1), secondBestCost(graphSizeIn, -1), dirty(graphSizeIn, false),
+        teamSize(teamSizeIn), graphSize(graphSizeIn){}
     
     // set navigation cost 
-    void set(const int robot_id, const int node_id, const float nav_cost) 
+    void set(const int robot_id, const int node_id, const float nav_cost, const ros::Time& timestamp = ros::Time()) 
     {
-        if( (robot_id < 0) || (node_id < 0) || ( nav_cost < 0) )
+        if( (robot_id < 0) || (robot_id >= (int)teamSize) || (node_id < 0) || (node_id >= (int)graphSize) || ( nav_cost < 0) )
         {
             ROS_ERROR_STREAM("NavCostTable::set() - invalid robot_id: " << robot_id << ", node_id: " << node_id << ", nav_cost: " << nav_cost);            
             return;
         }            
         
-        table[robot_id][node_id] = nav_cost; 
+        const size_t index = robot_id*graphSize + node_id;
+        costs[index]      = nav_cost; 
+        timestamps[index] = timestamp; 
+        dirty[node_id]    = true; 
+    }
+    
+    // set the navigation costs of robot_id for the given nodes at once (unknown costs, i.e. negative, are skipped)
+    void setRow(const int robot_id, const std::vector<int>& node_ids, const std::vector<float>& nav_costs, const ros::Time& timestamp = ros::Time()) 
+    {
+        for(size_t k=0; k<node_ids.size() && k<nav_costs.size(); k++)
+        {
+            if( nav_costs[k] >= 0 ) set(robot_id, node_ids[k], nav_costs[k], timestamp);
+        }
     }
     
-    // get navigation cost 
-    float get(const int robot_id, const int node_id)
+    // get navigation cost (-1 if unknown)
+    float get(const int robot_id, const int node_id) const
     {
-        float res = -1;
-        if( (robot_id < 0) || (node_id < 0) )       
+        if( (robot_id < 0) || (robot_id >= (int)teamSize) || (node_id < 0) || (node_id >= (int)graphSize) )       
         {
             ROS_ERROR_STREAM("NavCostTable::get() - invalid robot_id: " << robot_id << ", node_id: " << node_id );            
-            return res;
+            return -1; /// < EXIT POINT
         }                       
         
-        const RobotNavCostMap& robotCosts = table[robot_id];
-        RobotNavCostMap::const_iterator it = robotCosts.find(node_id);
-        if(it!=robotCosts.end())
-        {
-            res = it->second;
-        }
-        return res;
+        return costs[robot_id*graphSize + node_id];
     }
     
+    // get the time the navigation cost has been estimated (zero if unknown) 
+    const ros::Time& getTimestamp(const int robot_id, const int node_id) const { return timestamps[robot_id*graphSize + node_id]; }
+    
     // check if robot_id has the best navigation cost-to-go for node_id
     bool is_best(const int robot_id, const int node_id, const float nav_cost)
     {
-        bool res = true; 
-        if( (robot_id < 0) || (node_id < 0) || (nav_cost < 0) ) 
+        if( (robot_id < 0) || (node_id < 0) || (node_id >= (int)graphSize) || (nav_cost < 0) ) 
         {
             ROS_ERROR_STREAM("NavCostTable::is_best() - invalid robot_id: " << robot_id << ", node_id: " << node_id << ", nav_cost: " << nav_cost);            
-            return res;
+            return true; /// < EXIT POINT
         }
         
-        for(size_t ri=0; ri<teamSize; ri++)
-        {
-            if( ri != robot_id )
-            {
-                const float cost_ri = get(ri, node_id);
-                if( ( cost_ri >= 0) && ( cost_ri < nav_cost ) )
-                {
-                    res = false;
-                    break;
-                }
-            }            
-        }  
-        std::cout << "NavCostTable::is_best() robot_id: " << robot_id << ", node_id: " << node_id << ", nav_cost: " << nav_cost << ", res: " << res << std::endl;
-        return res; 
+        updateBest(node_id);
+        
+        // best cost among the other robots 
+        const float other_cost = (bestRobot[node_id] == robot_id) ? secondBestCost[node_id] : bestCost[node_id];
+        return !( (other_cost >= 0) && (other_cost < nav_cost) ); 
     }
     
-    void update(const TeamModel& teamModel, const TeamDeployment& teamDeployment, const Vertex* graph, const size_t graphSize, boost::recursive_mutex& graph_mutex)
+    // get the robot with the best navigation cost-to-go for node_id (-1 if no cost is known)
+    int getBestRobot(const int node_id, float& best_cost)
+    {
+        best_cost = -1;
+        if( (node_id < 0) || (node_id >= (int)graphSize) ) return -1; /// < EXIT POINT 
+        
+        updateBest(node_id);
+        best_cost = bestCost[node_id];
+        return bestRobot[node_id];
+    }
+    
+    // get the robot with the best navigation cost-to-go for each node (-1 if no cost is known)
+    void getBestRobots(std::vector<int>& best_robots, std::vector<float>& best_costs)
+    {
+        for(size_t node_id=0; node_id<graphSize; node_id++) updateBest(node_id);
+        best_robots = bestRobot;
+        best_costs  = bestCost; 
+    }
+    
+    void update(const TeamModel& teamModel, const TeamDeployment& teamDeployment, const Vertex* graph, const size_t graphSizeIn, boost::recursive_mutex& graph_mutex)
     {        
         // get available information from dynamic graph and update
         {          
@@ -114,22 +134,22 @@ public:
             // N.B.: we can use the navigation cost computed from node1 to node2 only if the robot is over one of these two evaluation nodes 
             const int node_id = teamDeployment.where(ri, time_now);
             
-            if( ( node_id > -1 ) && ( node_id < graphSize) )
+            if( ( node_id > -1 ) && ( node_id < graphSizeIn) && ( node_id < graphSize) )
             {
                 // robot ri is over the vertex with id node_id    
-                set(ri,node_id,0);
+                set(ri,node_id,0,time_now);
                 
                 Vertex::MapNavData::const_iterator it = graph[node_id].nav_data.begin(), itEnd = graph[node_id].nav_data.end();
                 for( ; it != itEnd; it++)
                 {
                     const uint& idTo = it->first;
                     const ros::Time& timestamp = it->second.timestamp;
-                    if ( (timestamp - time_now).toSec() < Vertex::kExpirationTimeValidDynCost )
+                    if ( ( (timestamp - time_now).toSec() < Vertex::kExpirationTimeValidDynCost ) && ( idTo < graphSize ) )
                     {
                         const float cost = it->second.cost;
                         if( cost > 0 )
                         {
-                            set(ri,idTo,cost);
+                            set(ri,idTo,cost,timestamp);
                         }                        
                     }
                 }                
@@ -155,7 +175,7 @@ public:
                 {
                     const int ri_goal = teamModel.id_current_selected_vertex[ri];
                     const float ri_cost = (float)teamModel.nav_cost_to_go[ri];
-                    set(ri,ri_goal,ri_cost);                    
+                    set(ri,ri_goal,ri_cost,timestamp);                    
                 }
             }         
         }
@@ -164,30 +184,67 @@ public:
         
     }
        
-    void print()
+    void print() const
     {
         std::cout << "NavCostTable::print() - teamSize: " << teamSize << std::endl;
         
         for(size_t ri=0; ri<teamSize; ri++)
         {
             std::cout << "robot: " << ri << std::endl;            
-            const RobotNavCostMap& robotCosts = table[ri];
-            RobotNavCostMap::const_iterator it = robotCosts.begin(), itEnd = robotCosts.end();
-            for(; it!=itEnd; it++)
+            for(size_t node_id=0; node_id<graphSize; node_id++)
             {
+                const float nav_cost = costs[ri*graphSize + node_id];
+                if( nav_cost < 0 ) continue; /// < CONTINUE 
                 std::cout << "\t";
-                const int node_id = it->first;
-                const float nav_cost = it->second;
                 std::cout << "\t" << "(id,cost) = (" << node_id << ", " << nav_cost << ")" << std::endl;    
             }    
         }           
     }    
     
+protected: 
+    
+    // recompute the best and second best robot of a changed node (a column of the table)
+    void updateBest(const size_t node_id)
+    {
+        if( !dirty[node_id] ) return; /// < EXIT POINT
+        
+        int best_robot = -1;
+        float best = std::numeric_limits<float>::max(), second = std::numeric_limits<float>::max();
+        for(size_t ri=0, index=node_id; ri<teamSize; ri++, index+=graphSize)
+        {
+            const float cost = costs[index];
+            if( cost < 0 ) continue; /// < CONTINUE 
+            if( cost < best )
+            {
+                second = best; 
+                best = cost; 
+                best_robot = ri; 
+            }
+            else if( cost < second )
+            {
+                second = cost; 
+            }
+        }
+        
+        bestRobot[node_id]      = best_robot;
+        bestCost[node_id]       = (best_robot > -1) ? best : -1;
+        secondBestCost[node_id] = (second < std::numeric_limits<float>::max()) ? second : -1;
+        dirty[node_id] = false; 
+    }
+    
 public:     
     
-    std::vector<RobotNavCostMap> table;
+    std::vector<float> costs;          // teamSize x graphSize, row-major (-1: unknown)
+    std::vector<ros::Time> timestamps; // teamSize x graphSize, row-major
+    
+    std::vector<int> bestRobot;          // for each node, the robot with the smallest cost (-1: none)
+    std::vector<float> bestCost;         // for each node, the smallest cost (-1: none)
+    std::vector<float> secondBestCost;   // for each node, the second smallest cost (-1: none)
+    std::vector<bool> dirty;             // for each node, true if the best robot must be recomputed 
+    
     size_t teamSize;
+    size_t graphSize;
     
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -69,6 +69,7 @@
 
 #include "PatrolAgent.h"
 #include "PatrollingMarkerController.h"
+#include "algorithms.h"
 
 
 using namespace std;
@@ -98,7 +99,7 @@ const double TeamDeployment::kExpirationTimeTeamDeployment = 1; // [s]
     
 // 
 
-const double PatrolAgent::kSleepTimeAfterSendingNewGoal = 0.2; // [seconds] to wait after sending a new goal
+const double PatrolAgent::kSleepTimeAfterSendingNewGoal = 0.2; // [seconds] hold-off after sending a new goal
 const double PatrolAgent::kSleepTimeAfterSendingAbort   = 1; // [seconds] to wait after sending an abort
 
 const float PatrolAgent::kScalePathNavCostFromFloatToInt = patrolling_build_graph_msgs::Graph::kNavCostConversionFloatToUint;//10.; // scaling factor for path navigation cost 
@@ -116,6 +117,8 @@ const double PatrolAgent::kTimeoutForReachingGoal = 60; // [s]
 
 const double PatrolAgent::kTimeoutForLastPathPlanningMsg = 60; // [s]
 
+const double PatrolAgent::kExpirationTimePoseNavCosts = 5; // [s]
+
 const double PatrolAgent::kInterferenceDistance = 1.2;
 const double PatrolAgent::kInterferenceDistance2 = PatrolAgent::kInterferenceDistance * PatrolAgent::kInterferenceDistance;
 
@@ -128,6 +131,7 @@ const double PatrolAgent::kMaxDistPointPrioritySquared = PatrolAgent::kMaxDistPo
 PatrolAgent::PatrolAgent():node_("~")
 {
     ID_ROBOT_ = -1;
+    random_seed_ = -1;
     
     p_listener_       = NULL;
     current_vertex_   = -1;
@@ -180,6 +184,9 @@ void PatrolAgent::init(int argc, char** argv)
     node_.getParam("graph_topic", graph_topic_);
     graph_sub_ = node_.subscribe<patrolling_build_graph_msgs::Graph>(graph_topic_, 10, boost::bind(&PatrolAgent::graphCallback, this, _1));
     
+    graph_delta_topic_ = getParam<std::string>(node_, "graph_delta_topic", "/patrolling/graph_delta");
+    graph_delta_sub_ = node_.subscribe<patrolling_build_graph_msgs::GraphDelta>(graph_delta_topic_, 10, boost::bind(&PatrolAgent::graphDeltaCallback, this, _1));
+    
     nodes_topic_sub_ = node_.subscribe<visualization_msgs::MarkerArray>("/patrolling_nodes_markers", 1, boost::bind(&PatrolAgent::patrollingNodesCallback, this, _1));
 
     node_.getParam("nodes_topic", nodes_topic_); // "vrep/ugv%d/patrolling_nodes_updated_markers"
@@ -212,6 +219,14 @@ void PatrolAgent::init(int argc, char** argv)
         printf("ID_ROBOT = %d\n", ID_ROBOT_); //-1 in the case there is only 1 robot.
     }
 
+    /// < a non-negative seed makes the random decisions reproducible (deterministic replays); each robot gets its own sequence 
+    random_seed_ = getParam<int>(node_, "random_seed", -1);
+    if (random_seed_ >= 0)
+    {
+        srand(random_seed_ + ID_ROBOT_);
+        set_decision_random_seed(random_seed_ + ID_ROBOT_);
+    }
+
     if (argc < 4)
     {
         b_interactive_ = false; // default behavior use predefined nodes
@@ -266,7 +281,8 @@ void PatrolAgent::init(int argc, char** argv)
             graph_ = new Vertex[graph_dimension_];
 
             //Get the Graph info from the Graph File
-            GetGraphInfo3D(graph_, graph_dimension_, str_graph_file_name_.c_str());
+            GetGraphInfo3D(graph_, graph_dimension_, str_graph_file_name_.c_str(), &graph_csr_);
+            shortest_paths_.update(graph_csr_);
             printf(" Graph info DONE ---------------------------- \n");
             build_graph_event_.event = patrolling_build_graph_msgs::BuildGraphEvent::GRAPH_BUILT;
         }
@@ -309,7 +325,8 @@ void PatrolAgent::init(int argc, char** argv)
             graph_ = new Vertex[graph_dimension_];
 
             //Get the Graph info from the Graph File
-            GetGraphInfo3D(graph_, graph_dimension_, str_graph_file_name_.c_str());
+            GetGraphInfo3D(graph_, graph_dimension_, str_graph_file_name_.c_str(), &graph_csr_);
+            shortest_paths_.update(graph_csr_);
             printf(" Graph info DONE ---------------------------- \n");
             
             if(p_marker_controller) p_marker_controller->setMarkerColor(Colors::Green(), "Graph Received");
@@ -356,7 +373,10 @@ void PatrolAgent::init(int argc, char** argv)
     resend_goal_count_ = 0;
     communication_delay_ = 0.0;
     lost_message_rate_   = 0.0;
+    results_batch_period_   = 0.0;
+    results_batch_max_size_ = 4096;
     b_task_reallocation_ = false;
+    b_run_loop_notified_ = false;
     
     vertex_id_other_robot_global_ = -1;
     id_sender_global_             = -1;
@@ -468,6 +488,7 @@ void PatrolAgent::init(int argc, char** argv)
         node_.getParam("planning_goal_abort_topic", planning_goal_abort_topic_); // vrep/ugv%d/goal_abort_topic
 
         node_.getParam("path_plan_stat_topic", path_plan_stat_topic_); // "vrep/ugv%d/path_planning_status"
+        path_costs_service_name_ = getParam<std::string>(node_, "path_costs_service_name", ""); // "vrep/ugv%d/path_costs_service"
         //node_.getParam("patrolling_pause_topic", patrolling_pause_topic_); // "vrep/ugv%d/path_planning_status"
 
 
@@ -505,6 +526,11 @@ void PatrolAgent::init(int argc, char** argv)
         planning_goal_abort_pub_ = node_.advertise<std_msgs::Bool>(planning_goal_abort_topic_, 10);
 
         path_plan_stat_sub_ = node_.subscribe(path_plan_stat_topic_, 20, &PatrolAgent::pathPlanningFeedbackCallback, this);
+        
+        if (!path_costs_service_name_.empty())
+        {
+            path_costs_client_ = node_.serviceClient<trajectory_control_msgs::PathCosts>(path_costs_service_name_);
+        }
 
         ros::spinOnce();
 
@@ -519,6 +545,10 @@ void PatrolAgent::init(int argc, char** argv)
         last_communication_delay_time_ = ros::Time::now().toSec();
 
         readParams();
+        if (results_batch_period_ > 0)
+        {
+            results_batch_timer_ = node_.createTimer(ros::Duration(results_batch_period_), &PatrolAgent::resultsBatchTimerCallback, this);
+        }
         ROS_INFO("END INIT OK");
         
         done = true;
@@ -550,10 +580,45 @@ void PatrolAgent::graphCallback(const patrolling_build_graph_msgs::Graph::ConstP
     
     if (build_graph_event_.event == patrolling_build_graph_msgs::BuildGraphEvent::START_PATROLLING)
     {
-        GetGraphFromMsg(graph_, graph_dimension_, msg);
+        GetGraphFromMsg(graph_, graph_dimension_, msg, &graph_csr_);
+        shortest_paths_.update(graph_csr_);
+        graph_msg_ = *msg;
         build_graph_event_.event = patrolling_build_graph_msgs::BuildGraphEvent::GRAPH_RECEIVED;
         ROS_INFO_STREAM("PatrolAgent::graphCallback() - graph received");
     }
+    else if (msg->version != graph_msg_.version)
+    {
+        ROS_WARN_STREAM("PatrolAgent::graphCallback() - ignoring graph " << msg->version << " received while patrolling graph " << graph_msg_.version);
+    }
+}
+
+void PatrolAgent::graphDeltaCallback(const patrolling_build_graph_msgs::GraphDelta::ConstPtr& msg)
+{
+    boost::recursive_mutex::scoped_lock graph_locker(graph_mutex_);   
+    
+    if (build_graph_event_.event != patrolling_build_graph_msgs::BuildGraphEvent::GRAPH_RECEIVED) return; /// < EXIT POINT
+    
+    if (!ApplyGraphDelta(graph_msg_, *msg))
+    {
+        ROS_WARN_STREAM("PatrolAgent::graphDeltaCallback() - cannot apply the graph delta");
+        return; /// < EXIT POINT
+    }
+    
+    // the dynamic navigation data is kept (the number of nodes does not change with a delta)
+    std::vector<Vertex::MapNavData> nav_data(graph_dimension_);
+    for (uint i = 0; i < graph_dimension_; i++) nav_data[i].swap(graph_[i].nav_data);
+    
+    patrolling_build_graph_msgs::GraphConstPtr graph_msg(new patrolling_build_graph_msgs::Graph(graph_msg_));
+    GetGraphFromMsg(graph_, graph_dimension_, graph_msg, &graph_csr_);
+    shortest_paths_.update(graph_csr_);
+    
+    for (uint i = 0; i < graph_dimension_; i++) graph_[i].nav_data.swap(nav_data[i]);
+    
+    if (!msg->node_index.empty()) build_kdtree_nodes(); // nodes may have moved
+    buildPatrollingEdgesAsMarkers();
+    
+    ROS_INFO_STREAM("PatrolAgent::graphDeltaCallback() - graph updated to version " << graph_msg_.version << 
+                    " (changed nodes: " << msg->node_index.size() << ", changed edges: " << msg->edge_from.size() << ")");
 }
 
 
@@ -615,6 +680,18 @@ void PatrolAgent::readParams()
         ROS_WARN_STREAM("Cannot read parameter /lost_message_rate. Using default value: " << lost_message_rate_);
         //ros::param::set("/lost_message_rate", lost_message_rate);
     }
+    
+    if (!ros::param::get("/results_batch_period", results_batch_period_))
+    {
+        results_batch_period_ = 0.0; // no batching 
+        ROS_WARN_STREAM("Cannot read parameter /results_batch_period. Using default value: " << results_batch_period_);
+    }
+    
+    if (!ros::param::get("/results_batch_max_size", results_batch_max_size_))
+    {
+        results_batch_max_size_ = 4096;
+        ROS_WARN_STREAM("Cannot read parameter /results_batch_max_size. Using default value: " << results_batch_max_size_);
+    }
 
 }
 
@@ -631,9 +708,10 @@ void PatrolAgent::run()
     time_last_path_planning_success_ = time_zero_;
     time_last_no_node_conflict_      = time_zero_; 
     time_last_reached_goal_          = time_zero_; 
+    time_last_new_goal_              = -kSleepTimeAfterSendingNewGoal;
             
     // Asynch spinner (non-blocking)
-    ros::AsyncSpinner spinner(2); // Use n threads
+    ros::AsyncSpinner spinner(getParam<int>(node_, "num_spinner_threads", 2)); // Use n threads (1: callbacks in arrival order)
     spinner.start();
     // ros::waitForShutdown();
     
@@ -645,7 +723,10 @@ void PatrolAgent::run()
 
     if(p_marker_controller) p_marker_controller->setMarkerColor(Colors::Yellow(), "Ready");
     
-    ros::Rate loop_rate(kPatrolAgentLoopRate); //0.033 seconds or 30Hz
+    /// < the periodic tasks run at the ticks (kPatrolAgentLoopRate), the callbacks wake up the loop in between (see notifyRunLoop()) 
+    const double tick_period = 1./kPatrolAgentLoopRate; // [s]
+    double time_last_tick = ros::Time::now().toSec(); 
+    bool b_tick = true; 
 
     while (ros::ok())
     {
@@ -657,9 +738,9 @@ void PatrolAgent::run()
         case patrolling_build_graph_msgs::BuildGraphEvent::GRAPH_RECEIVED:
 
             /// < update patrolling graph status (in any case, even if paused)
-            update_idleness();
+            if( b_tick ) update_idleness();
             
-            if( time_index % kPatrolAgentLoopRate == 0 )
+            if( b_tick && time_index % kPatrolAgentLoopRate == 0 )
             {
                 ROS_INFO_STREAM("PatrolAgent::run() - goal_complete: " << (int)b_goal_complete_ 
                         << ", interference: " << (int)b_interference_ 
@@ -678,7 +759,7 @@ void PatrolAgent::run()
                 
                 /// < check if this robot covered/intercepted a vertex 
                 int covered_vertex = -1;                
-                if( time_index % kCheckVisitedVertexSubrate == 0 )
+                if( b_tick && time_index % kCheckVisitedVertexSubrate == 0 )
                 {
                     bool b_new_interception = false; 
                     // check if 1) we are currently over a vertex (distance <= kVisitedNodeDistance, b_new_interception = false)
@@ -724,7 +805,7 @@ void PatrolAgent::run()
 #endif                      
                 
                 /// < check interference (not used in the planning)
-                if( time_index % kCheckInterferenceSubrate == 0 )
+                if( b_tick && time_index % kCheckInterferenceSubrate == 0 )
                 {
                     b_interference_ = check_interference(ID_ROBOT_); /// this was managed inside trajResultCallBack()
                 }
@@ -768,7 +849,7 @@ void PatrolAgent::run()
                 else
                 {
                     // broadcast continuously selected message (according to sub-rate)
-                    if( ( time_index % kSelectBroadcastSubrate == 0 ) && (planner_status_.success) )
+                    if( b_tick && ( time_index % kSelectBroadcastSubrate == 0 ) && (planner_status_.success) )
                     {
                         broadcast_goal_selected(next_vertex_,planner_status_.path_cost);
                     }                    
@@ -816,13 +897,13 @@ void PatrolAgent::run()
                 
                 
                 // broadcast continuously idleness message (according to sub-rate)
-                if( ( time_index % kIdlenessSynchBroadcastSubrate == 0 ) && ( time_index > 0) )
+                if( b_tick && ( time_index % kIdlenessSynchBroadcastSubrate == 0 ) && ( time_index > 0) )
                 {
                     broadcast_idleness();
                 }      
                 
                 // check tasks reset (according to sub-rate)
-                if( ( time_index % kCheckTaskResetSubrate == 0 ) && ( time_index > 0) )
+                if( b_tick && ( time_index % kCheckTaskResetSubrate == 0 ) && ( time_index > 0) )
                 {
                     check_tasks_reset();
                 }                     
@@ -881,8 +962,11 @@ void PatrolAgent::run()
                     }
 #endif
 
+                    // the hold-off gives the path planner the time to take the last new goal (its replies to the previous one are not considered) 
+                    const bool b_new_goal_hold_off = (ros::Time::now().toSec() - time_zero_ - time_last_new_goal_) < kSleepTimeAfterSendingNewGoal;
+                    
                     //if( (!planner_status_.success) || b_node_conflict_) // || b_timeout_for_reaching_goal_)
-                    if( b_path_planning_failure_ || b_node_conflict_ || b_next_vertex_intercepted_by_teammate_) // || b_timeout_for_reaching_goal_)
+                    if( !b_new_goal_hold_off && (b_path_planning_failure_ || b_node_conflict_ || b_next_vertex_intercepted_by_teammate_) ) // || b_timeout_for_reaching_goal_)
                     {
                         
                         // update your reference node id (in case the robot stopped its travel)
@@ -908,7 +992,7 @@ void PatrolAgent::run()
                                 << ", => selecting another target node\n");
                         onGoalNotComplete();
                         
-                        ros::Duration(kSleepTimeAfterSendingNewGoal).sleep();
+                        time_last_new_goal_ = ros::Time::now().toSec() - time_zero_;
                     }
                     
 
@@ -943,14 +1027,42 @@ void PatrolAgent::run()
 
         }
 
-        loop_rate.sleep();
-        time_index++;
+        /// < wait for the next tick or for a notification from the callbacks 
+        waitRunLoop(time_last_tick + tick_period - ros::Time::now().toSec());
+        
+        const double time_now = ros::Time::now().toSec(); 
+        b_tick = (time_now >= time_last_tick + tick_period);
+        if( b_tick )
+        {
+            // do not accumulate the missed ticks 
+            time_last_tick = (time_now - time_last_tick < 2*tick_period) ? (time_last_tick + tick_period) : time_now; 
+            time_index++;
+        }
         
         ///ros::spinOnce();
 
     } // while ros.ok    
 }
 
+void PatrolAgent::notifyRunLoop()
+{
+    {
+    boost::mutex::scoped_lock locker(run_loop_mutex_);
+    b_run_loop_notified_ = true; 
+    }
+    run_loop_cond_.notify_one();
+}
+
+void PatrolAgent::waitRunLoop(double timeout)
+{
+    boost::mutex::scoped_lock locker(run_loop_mutex_);
+    if( !b_run_loop_notified_ && (timeout > 0) )
+    {
+        run_loop_cond_.timed_wait(locker, boost::posix_time::microseconds((int64_t)(timeout*1e6)));
+    }
+    b_run_loop_notified_ = false; 
+}
+
 void PatrolAgent::onGoalComplete()
 {
     boost::recursive_mutex::scoped_lock graph_locker(graph_mutex_);   
@@ -1318,6 +1430,8 @@ void PatrolAgent::pathPlanningFeedbackCallback(const trajectory_control_msgs::Pl
    
     std::cout << "ROBOT_ID: " << ID_ROBOT_ << " planner_status " << (bool)planner_status_.success << " path_cost " << planner_status_.path_cost <<"\n";
     
+    notifyRunLoop();
+    
     std::cout << "ROBOT_ID " << ID_ROBOT_ << " pathPlanningFeedbackCallback() - end \n";
     std::cout << "..............................................................\n";
 }
@@ -1369,6 +1483,8 @@ void PatrolAgent::trajectoryTrackingResultCallback(const trajectory_control_msgs
     /// < check interference 
     //b_interference_ = check_interference(ID_ROBOT_);
     
+    notifyRunLoop();
+    
     std::cout << "ROBOT_ID " << ID_ROBOT_ << " trajectoryTrackingResultCallback - end \n";
     std::cout << "..............................................................\n";
 
@@ -2032,15 +2148,119 @@ void PatrolAgent::do_send_message(Int16MultiArrayMsg &msg)
     }
     ROS_INFO_STREAM("PatrolAgent::do_send_message - timestamp: " << msg.header.stamp << std::endl;);
     
+    // the initialization messages are exchanged with the monitor before patrolling: they are not batched  
+    const bool b_batch = (results_batch_period_ > 0) && (msg.data.size() > 1) && (msg.data[1] != INITIALIZE_MSG_TYPE);
+    if (b_batch)
+    {
+        {
+        boost::recursive_mutex::scoped_lock batch_locker(results_batch_mutex_);
+        results_batch_.setIdRobot(ID_ROBOT_);
+        results_batch_.add(msg.data);
+        if ((int)results_batch_.size() < results_batch_max_size_) return; /// < EXIT POINT 
+        }
+        flushResultsBatch();
+        return; /// < EXIT POINT 
+    }
+    
+    flushResultsBatch(); // keep the order of the messages 
+    
     results_pub_.publish(msg);
     ros::spinOnce();
 }
 
+void PatrolAgent::flushResultsBatch()
+{
+    Int16MultiArrayMsg msg;
+    {
+    boost::recursive_mutex::scoped_lock batch_locker(results_batch_mutex_);
+    if (results_batch_.empty()) return; /// < EXIT POINT 
+    results_batch_.flush(msg.data);
+    }
+    
+#if USE_STAMPED_MSG_INT16_MULTIARRAY 
+    msg.header.stamp = ros::Time::now();
+#endif  
+    
+    results_pub_.publish(msg);
+}
+
+void PatrolAgent::resultsBatchTimerCallback(const ros::TimerEvent&)
+{
+    flushResultsBatch();
+}
+
 void PatrolAgent::receive_results()
 {
 
 }
 
+bool PatrolAgent::updatePoseNavCosts(const std::vector<int>& vertices)
+{
+    if (path_costs_service_name_.empty()) return false; /// < EXIT POINT
+    
+    trajectory_control_msgs::PathCosts srv;
+    std::vector<int> goal_vertices; 
+    
+    float x = 0, y = 0, z = 0, theta = 0;
+    getRobotPose3D(ID_ROBOT_, x, y, z, theta);
+    
+    srv.request.start.header.frame_id    = "map";
+    srv.request.start.header.stamp       = ros::Time::now();
+    srv.request.start.pose.position.x    = x;
+    srv.request.start.pose.position.y    = y;
+    srv.request.start.pose.position.z    = z;
+    srv.request.start.pose.orientation.w = 1;
+    
+    {
+    boost::recursive_mutex::scoped_lock graph_locker(graph_mutex_);
+    
+    for (size_t k = 0, kEnd = vertices.empty() ? graph_dimension_ : vertices.size(); k < kEnd; k++)
+    {
+        const int vertex = vertices.empty() ? (int)k : vertices[k];
+        if ((vertex < 0) || (vertex >= (int)graph_dimension_)) continue; /// < CONTINUE 
+        
+        geometry_msgs::PoseStamped goal = srv.request.start;
+        goal.pose.position.x = graph_[vertex].x;
+        goal.pose.position.y = graph_[vertex].y;
+        goal.pose.position.z = graph_[vertex].z;
+        srv.request.goals.push_back(goal);
+        goal_vertices.push_back(vertex);
+    }
+    
+    } // end graph mutex block 
+    
+    if (goal_vertices.empty()) return false; /// < EXIT POINT
+    
+    if (!path_costs_client_.call(srv) || (srv.response.path_costs.size() != goal_vertices.size()))
+    {
+        ROS_WARN_STREAM("PatrolAgent::updatePoseNavCosts() - failed to call service " << path_costs_service_name_);
+        return false; /// < EXIT POINT
+    }
+    
+    boost::recursive_mutex::scoped_lock nav_costs_locker(pose_nav_costs_mutex_);
+    
+    // the costs of the other vertices refer to an older pose
+    pose_nav_costs_.assign(graph_dimension_, -1);
+    for (size_t k = 0; k < goal_vertices.size(); k++)
+    {
+        const double path_cost = srv.response.path_costs[k];
+        if (path_cost >= 0) pose_nav_costs_[goal_vertices[k]] = path_cost * kScalePathNavCostFromFloatToInt; // as in pathPlanningFeedbackCallback()
+    }
+    pose_nav_costs_time_ = srv.request.start.header.stamp;
+    
+    return srv.response.success;
+}
+
+float PatrolAgent::getPoseNavCost(int vertex)
+{
+    boost::recursive_mutex::scoped_lock nav_costs_locker(pose_nav_costs_mutex_);
+    
+    if ((vertex < 0) || (vertex >= (int)pose_nav_costs_.size())) return -1; /// < EXIT POINT
+    if ((ros::Time::now() - pose_nav_costs_time_).toSec() > kExpirationTimePoseNavCosts) return -1; /// < EXIT POINT
+    
+    return pose_nav_costs_[vertex];
+}
+
 void PatrolAgent::broadcast_interference()
 {
     //interference: [ID,msg_type]
@@ -2105,15 +2325,36 @@ void PatrolAgent::resultsCallback(const Int16MultiArrayMsg::ConstPtr& msg)
 {
     boost::recursive_mutex::scoped_lock locker(results_callback_mutex);
     
-    std::vector<signed short>::const_iterator it = msg->data.begin();
-
-    vec_results_.clear();
-
-    for (size_t k = 0; k < msg->data.size(); k++)
+    if (msg->data.size() < 2) return; /// < EXIT POINT
+    
+    if (ResultsBatch::isBatch(msg->data))
     {
-        vec_results_.push_back(*it);
-        it++;
+        if (!results_batch_seq_tracker_.check(msg->data[0], ResultsBatch::getSeq(msg->data))) return; /// < EXIT POINT
+        
+        // only the headers are read here: each message is copied when it is processed  
+        std::vector<ResultsBatch::Range> ranges;
+        if (!ResultsBatch::getMessages(msg->data, ranges))
+        {
+            ROS_WARN_STREAM("PatrolAgent::resultsCallback() - malformed batch from robot " << msg->data[0]);
+        }
+        for (size_t k = 0; k < ranges.size(); k++)
+        {
+            processResults(msg, ranges[k].first, ranges[k].second);
+        }
     }
+    else
+    {
+        processResults(msg, 0, msg->data.size());
+    }
+    
+    notifyRunLoop(); // teammates' intentions, interceptions and conflicts 
+             
+    ros::spinOnce();
+}
+
+void PatrolAgent::processResults(const Int16MultiArrayMsg::ConstPtr& msg, size_t data_begin, size_t data_end)
+{
+    vec_results_.assign(msg->data.begin() + data_begin, msg->data.begin() + data_end);
     
 
     int id_sender = vec_results_[0];
@@ -2195,8 +2436,6 @@ void PatrolAgent::resultsCallback(const Int16MultiArrayMsg::ConstPtr& msg)
             receive_results();
         }
     }
-             
-    ros::spinOnce();
 
 }
 
@@ -2567,6 +2806,7 @@ void PatrolAgent::pausePatrollingCallback(const std_msgs::Bool& msg)
         if(p_marker_controller) p_marker_controller->setMarkerColor(Colors::Green(), "Patrolling");
     }
     b_pause_ = msg.data;           
+    notifyRunLoop();
 }
 
 
@@ -2919,6 +3159,9 @@ void PatrolAgent::updateDynNavCost(const int vertex1, const int vertex2, const i
     VertexNavData& v2NavData = v2.nav_data[vertex1];
     v2NavData.cost = nav_cost;    
     v2NavData.timestamp = timestamp;    
+    
+    graph_csr_.setNavData(vertex1, vertex2, nav_cost, timestamp);
+    graph_csr_.setNavData(vertex2, vertex1, nav_cost, timestamp);
 
     PrintDynamicGraph(graph_,graph_dimension_,time_zero_);      
 }
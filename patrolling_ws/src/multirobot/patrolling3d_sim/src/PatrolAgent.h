@@ -68,6 +68,8 @@
 #include <ros/ros.h>
 
 #include <boost/thread/recursive_mutex.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
 
 #include <move_base_msgs/MoveBaseAction.h>
 #include <actionlib/client/simple_action_client.h>
@@ -87,6 +89,7 @@ typedef std_msgs::Int16MultiArray Int16MultiArrayMsg;
 #include <trajectory_control_msgs/PlanningFeedback.h>
 #include <trajectory_control_msgs/PlanningTask.h>
 #include <trajectory_control_msgs/PlanningStatus.h>
+#include <trajectory_control_msgs/PathCosts.h>
 #include <trajectory_control_msgs/TrajectoryControlActionResult.h>
 
 #include <std_msgs/Bool.h>
@@ -102,6 +105,8 @@ typedef std_msgs::Int16MultiArray Int16MultiArrayMsg;
 
 #include "graph.h"
 #include "graph_viz.h"
+#include "ShortestPathTable.h"
+#include "ResultsBatch.h"
 
 
 #define NUM_MAX_ROBOTS 32
@@ -258,14 +263,15 @@ public:
     
 protected:
     
-    static const int kPatrolAgentLoopRate = 30; //[Hz] loop rate for the main loop (contained in the run() method)
-    static const double kSleepTimeAfterSendingNewGoal; // [seconds] to wait after sending a new goal 
+    static const int kPatrolAgentLoopRate = 10; //[Hz] tick rate of the periodic tasks of the main loop (contained in the run() method); 
+                                                // the loop is also woken up by the callbacks (see notifyRunLoop())
+    static const double kSleepTimeAfterSendingNewGoal; // [seconds] hold-off after sending a new goal (before checking again for failures and conflicts)
     static const double kSleepTimeAfterSendingAbort; // [seconds] to wait after sending an abort
-    static const int kCheckVisitedVertexSubrate = 15; // with the main 30Hz this is equivalent to 2Hz
-    static const int kCheckInterferenceSubrate = 15;  // with the main 30Hz this is equivalent to 2Hz
-    static const int kCheckTaskResetSubrate = 30; // with the main 30Hz this is equivalent to 1Hz        
-    static const int kSelectBroadcastSubrate = 15; // with the main 30Hz this is equivalent to 2Hz 
-    static const int kIdlenessSynchBroadcastSubrate = 150; // with the main 30Hz this is equivalent to 0.2Hz
+    static const int kCheckVisitedVertexSubrate = 5; // with the main 10Hz this is equivalent to 2Hz
+    static const int kCheckInterferenceSubrate = 5;  // with the main 10Hz this is equivalent to 2Hz
+    static const int kCheckTaskResetSubrate = 10; // with the main 10Hz this is equivalent to 1Hz        
+    static const int kSelectBroadcastSubrate = 5; // with the main 10Hz this is equivalent to 2Hz 
+    static const int kIdlenessSynchBroadcastSubrate = 50; // with the main 10Hz this is equivalent to 0.2Hz
         
     static const float kScalePathNavCostFromFloatToInt; 
     static const double kScaleIdlenessFromFloatToInt;
@@ -282,6 +288,8 @@ protected:
     
     static const double kTimeoutForLastPathPlanningMsg; // [s]
     
+    static const double kExpirationTimePoseNavCosts; // [s] validity of the navigation costs from the robot pose (see updatePoseNavCosts())
+    
     static const int kMaxNumAttemptsForRandomNodeSelection = 50;
     
     static const double kInterferenceDistance;
@@ -312,6 +320,13 @@ public:
 
     void getRobotPose(int robotid, float &x, float &y, float &theta);
     void getRobotPose3D(int robotid, float &x, float &y, float &z, float &theta);
+    
+    // refresh the navigation costs from the robot pose to the given vertices (all of them if empty) with a single one-to-many request 
+    // to the path planner (see path_costs_service_name); return false if the service is not used or the request failed 
+    bool updatePoseNavCosts(const std::vector<int>& vertices = std::vector<int>());
+    
+    // navigation cost from the robot pose to the vertex, scaled as planner_status_.path_cost (-1 if unknown or expired)
+    float getPoseNavCost(int vertex);
 
 
  public: /// < patrolling main events
@@ -320,6 +335,9 @@ public:
     
     virtual void onGoalComplete(); // what to do when a goal has been reached
     virtual void processEvents(); // processes algorithm-specific events
+    
+    void notifyRunLoop(); // wake up the main loop (called by the callbacks which change its state)
+    void waitRunLoop(double timeout); // wait for a notification or the timeout [s]
 
     
     int compute_next_switching_vertex();
@@ -372,12 +390,14 @@ public: /// <  robot-robot communication
     virtual void send_results(); // when goal is completed
     virtual void receive_results(); // asynchronous call
     void do_send_message(Int16MultiArrayMsg &msg);
+    void flushResultsBatch(); // publish the pending batch of messages (if any)
     
 public: /// < callbacks 
 
     void positionsCallback(const nav_msgs::Odometry::ConstPtr& msg);
     void resultsCallback(const Int16MultiArrayMsg::ConstPtr& msg);
     void results3dCallback(const Int16MultiArrayMsg::ConstPtr& msg); /// < automatically called by resultsCallback()
+    void resultsBatchTimerCallback(const ros::TimerEvent&);
     void patrollingNodesCallback(const visualization_msgs::MarkerArray::ConstPtr& msg);
     void pathPlanningFeedbackCallback(const trajectory_control_msgs::PlanningStatus::ConstPtr& msg);
     
@@ -386,6 +406,7 @@ public: /// < callbacks
  
     void buildGraphEventCallback(const patrolling_build_graph_msgs::BuildGraphEvent::ConstPtr&);
     void graphCallback(const patrolling_build_graph_msgs::Graph::ConstPtr& msg);
+    void graphDeltaCallback(const patrolling_build_graph_msgs::GraphDelta::ConstPtr& msg);
     void pausePatrollingCallback(const std_msgs::Bool& msg);
  
     //void goalDoneCallback(const actionlib::SimpleClientGoalState &state, const move_base_msgs::MoveBaseResultConstPtr &result);
@@ -395,6 +416,13 @@ public: /// < callbacks
     void priorityPointCallback(const patrolling_build_graph_msgs::PriorityPoint::ConstPtr&);    
     
     boost::recursive_mutex results_callback_mutex;  // to protect double link to callback 
+    
+protected: 
+    
+    // process the message stored in msg->data[data_begin, data_end) (a single message or one of a batch)
+    void processResults(const Int16MultiArrayMsg::ConstPtr& msg, size_t data_begin, size_t data_end);
+    
+public:     
     boost::recursive_mutex positions_callback_mutex; // to protect double link to callback 
 
 protected: /// < 3D GUI
@@ -426,6 +454,7 @@ protected:
 
     int TEAMSIZE_;
     int ID_ROBOT_; // my ID 
+    int random_seed_; // seed of the random decisions (< 0: seeded with the current time) 
 
     double xPos_[NUM_MAX_ROBOTS]; // position table 
     double yPos_[NUM_MAX_ROBOTS]; 
@@ -471,6 +500,15 @@ protected:
     
     bool b_timeout_for_reaching_goal_;
     double time_last_reached_goal_;
+    double time_last_new_goal_; // time of the last new goal sent after a failure or a conflict
+    
+    std::vector<float> pose_nav_costs_; // navigation costs from the robot pose to the vertices (see updatePoseNavCosts())
+    ros::Time pose_nav_costs_time_;
+    boost::recursive_mutex pose_nav_costs_mutex_;
+    
+    boost::mutex run_loop_mutex_;
+    boost::condition_variable run_loop_cond_; 
+    bool b_run_loop_notified_; 
     
     bool b_critical_node_conflict_; 
     bool b_critical_node_conflict_forced_;     
@@ -480,6 +518,9 @@ protected:
     Vertex *graph_;        /// < the graph 
     uint graph_dimension_; /// < graph size
     boost::recursive_mutex graph_mutex_;    
+    CsrGraph graph_csr_;               /// < the full graph in CSR form (graph_ is its adapter for the agent algorithms, see CsrGraph::toVertices())
+    patrolling_build_graph_msgs::Graph graph_msg_; /// < the last received graph (the graph deltas are applied to it)
+    ShortestPathTable shortest_paths_; /// < all-pairs shortest paths of graph_csr_ (updated with graph_)
     
     double* vec_instantaneous_idleness_; // local idleness
     boost::recursive_mutex idleness_mutex_;
@@ -502,6 +543,12 @@ protected:
     
     double lost_message_rate_;
     
+    double results_batch_period_; // [s] the sent messages are batched and published with this period (<= 0: no batching); the batch is stamped when published
+    int results_batch_max_size_;  // a batch is published as soon as it reaches this number of int16 entries 
+    ResultsBatch results_batch_;
+    boost::recursive_mutex results_batch_mutex_;
+    ResultsBatchSeqTracker results_batch_seq_tracker_; // to drop the batches received twice (e.g. through /results and /core/results)
+    
     std::string initial_positions_;
     
     //MoveBaseClient *ac; // action client for reaching target goals
@@ -531,6 +578,7 @@ protected: /// < ROS
     ros::Subscriber results_sub_;
     ros::Subscriber core_results_sub_;
     ros::Publisher  results_pub_;
+    ros::Timer      results_batch_timer_;
     
     //ros::Publisher cmd_vel_pub;
     ros::Publisher goal_pub_;
@@ -540,6 +588,9 @@ protected: /// < ROS
     //ros::Publisher tracks_vel_cmd_pub;
     ros::Subscriber patrolling_pause_sub_;
     ros::Subscriber path_plan_stat_sub_;
+    
+    std::string path_costs_service_name_; // one-to-many planning service of the path planner ("": not used)
+    ros::ServiceClient path_costs_client_;
 
     trajectory_control_msgs::TrajectoryControlActionResult traj_res_msg_;
     geometry_msgs::PoseStamped goal_msg_;
@@ -561,6 +612,8 @@ protected: /// < ROS
     ros::Subscriber build_graph_event_sub_;
     std::string graph_topic_;
     ros::Subscriber graph_sub_;
+    std::string graph_delta_topic_;
+    ros::Subscriber graph_delta_sub_;
     std::string priority_point_topic_;
     ros::Subscriber priority_point_sub_;        
     
@@ -62,7 +62,7 @@ int Random_Agent::compute_next_vertex()
     uint num_neighs = graph_[current_vertex_].num_neigh;
     uint next_vertex;
 
-    srand(time(NULL));
+    if (random_seed_ < 0) srand(time(NULL)); // a fixed seed is set once in PatrolAgent::init() 
     int i = rand() % num_neighs;
     next_vertex = graph_[current_vertex_].id_neigh[i];
 
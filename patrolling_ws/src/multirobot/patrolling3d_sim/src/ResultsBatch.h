@@ -0,0 +1,164 @@
+/**
+* This file is part of the ROS package patrolling3d_sim which belongs to the framework 3DMR. 
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> 
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RESULTS_BATCH_H
+#define RESULTS_BATCH_H
+
+#include <map>
+#include <vector>
+#include <utility>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "message_types.h"
+
+///	\class ResultsBatch
+///	\author Luigi Freda 
+///	\brief A batch of team messages packed in a single results message (see BATCH_MSG_TYPE in message_types.h):
+///	       [ID_ROBOT, BATCH_MSG_TYPE, seq, num_msgs, len_1, msg_1[0..len_1-1], ..., len_n, msg_n[0..len_n-1]]
+///	       where each msg_k is a regular message [ID_ROBOT, msg_type, ...]. The length prefixes let a receiver 
+///	       reach the header of each message without unpacking the others. 
+///	\note 
+/// 	\todo 
+///	\date
+///	\warning not thread-safe 
+class ResultsBatch
+{
+public: 
+    
+    typedef std::vector<int16_t> Data; 
+    typedef std::pair<size_t, size_t> Range; // [begin, end) of a message in the batch data 
+    
+    static const size_t kHeaderSize = 4; 
+    static const int kSeqModulo = 32768; // the sequence number is sent as an int16
+    
+public: 
+    
+    ResultsBatch(int id_robot = 0):id_robot_(id_robot),seq_(0){}
+    
+    void setIdRobot(int id_robot) { id_robot_ = id_robot; }
+    
+    bool empty() const { return data_.empty(); }
+    
+    // number of int16 entries 
+    size_t size() const { return data_.size(); }
+    
+    // append a regular message 
+    void add(const Data& msg_data)
+    {
+        if(data_.empty())
+        {
+            data_.push_back(id_robot_);
+            data_.push_back(BATCH_MSG_TYPE);
+            data_.push_back(seq_);
+            data_.push_back(0);
+        }
+        data_.push_back(msg_data.size());
+        data_.insert(data_.end(), msg_data.begin(), msg_data.end());
+        data_[3]++;
+    }
+    
+    // move the batch into msg_data and start a new one 
+    void flush(Data& msg_data)
+    {
+        msg_data.swap(data_);
+        data_.clear();
+        seq_ = (seq_ + 1) % kSeqModulo;
+    }
+    
+public: 
+    
+    static bool isBatch(const Data& data) { return (data.size() >= kHeaderSize) && (data[1] == BATCH_MSG_TYPE); }
+    
+    static int getSeq(const Data& data) { return data[2]; }
+    
+    // get the ranges of the messages in the batch data; return false if the batch is malformed 
+    static bool getMessages(const Data& data, std::vector<Range>& ranges)
+    {
+        ranges.clear();
+        if(!isBatch(data)) return false; /// < EXIT POINT
+        
+        const int num_msgs = data[3];
+        size_t pos = kHeaderSize;
+        for(int k = 0; k < num_msgs; k++)
+        {
+            if(pos >= data.size()) return false; /// < EXIT POINT
+            const int len = data[pos++];
+            if( (len < 2) || (pos + len > data.size()) ) return false; /// < EXIT POINT
+            ranges.push_back(Range(pos, pos + len));
+            pos += len;
+        }
+        return true; 
+    }
+    
+protected: 
+    
+    int id_robot_;
+    int seq_; 
+    Data data_;
+};
+
+
+///	\class ResultsBatchSeqTracker
+///	\author Luigi Freda 
+///	\brief Keep track of the last batch sequence number received from each robot (in order to drop duplicated or 
+///	       out-of-date batches and count the lost ones)
+///	\note 
+/// 	\todo 
+///	\date
+///	\warning not thread-safe 
+class ResultsBatchSeqTracker
+{
+public: 
+    
+    static const int kSeqWindow = 64; // a batch at most kSeqWindow behind the last received one is considered out-of-date
+    
+public: 
+    
+    ResultsBatchSeqTracker():num_lost_(0){}
+    
+    // return false if the batch has been already received (or it is older than the last received one); 
+    // a larger backward jump is taken as a restart of the sender
+    bool check(int id_robot, int seq)
+    {
+        std::map<int, int>::iterator it = last_seq_.find(id_robot);
+        if(it == last_seq_.end())
+        {
+            last_seq_[id_robot] = seq;
+            return true; /// < EXIT POINT
+        }
+        
+        const int delta = (seq - it->second + ResultsBatch::kSeqModulo) % ResultsBatch::kSeqModulo;
+        if( (delta == 0) || (delta > ResultsBatch::kSeqModulo - kSeqWindow) ) return false; /// < EXIT POINT
+        
+        if(delta <= ResultsBatch::kSeqModulo/2) num_lost_ += delta - 1; // otherwise the sender has been restarted 
+        it->second = seq;
+        return true; 
+    }
+    
+    size_t getNumLost() const { return num_lost_; }
+    
+protected: 
+    
+    std::map<int, int> last_seq_; // key: robot id, value: last received sequence number 
+    size_t num_lost_;
+};
+
+#endif /* RESULTS_BATCH_H */
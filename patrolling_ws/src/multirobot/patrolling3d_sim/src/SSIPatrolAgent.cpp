@@ -138,8 +138,21 @@ void SSIPatrolAgent::init(int argc, char** argv) {
     threshold = cf.getDParam("threshold");			
     hist = cf.getDParam("hist");
 
+    const std::string allocator_name = cf.getParam("allocator");
+    allocator_time_budget = cf.getDParam("allocator_time_budget", 0.1);
+    if (!allocator_name.empty()){
+        const int allocator_type = TaskAllocator::getType(allocator_name);
+        if (allocator_type < 0){
+            ROS_WARN_STREAM("SSIPatrolAgent::init() - unknown allocator " << allocator_name << ": using the auctions with messages");
+        } else {
+            allocator.reset(TaskAllocator::create(allocator_type));
+            ROS_INFO_STREAM("SSIPatrolAgent::init() - allocator " << allocator->getName() << ", time budget " << allocator_time_budget << " [s]");
+        }
+    }
+
     std::stringstream paramss;
     paramss << timeout << "," << theta_idl << "," << theta_cost << "," << theta_hop << "," << threshold << "," << hist;
+    if (allocator) paramss << "," << allocator->getName() << "," << allocator_time_budget;
 
     ros::param::set("/algorithm_params",paramss.str());
 
@@ -147,23 +160,11 @@ void SSIPatrolAgent::init(int argc, char** argv) {
 
 double SSIPatrolAgent::compute_cost(int vertex)
 {
-    uint elem_s_path;
-    int *shortest_path = new int[graph_dimension_]; 
-    int id_neigh;
-    
-    dijkstra( current_vertex_, vertex, shortest_path, elem_s_path, graph_, graph_dimension_); //structure with normal costs
-    double distance = 0;
-    
-    for(uint j=0; j<elem_s_path; j++){
-//        printf("path[%u] = %d\n",j,shortest_path[j]);
-        
-        if (j<elem_s_path-1){
-            id_neigh = is_neigh(shortest_path[j], shortest_path[j+1], graph_, graph_dimension_);
-            distance += graph_[shortest_path[j]].cost[id_neigh];
-        }       
-    }
+    // cost from the robot pose if available (see updatePoseNavCosts() in compute_next_vertex())
+    const float pose_cost = getPoseNavCost(vertex);
+    if (pose_cost >= 0) return pose_cost; /// < EXIT POINT
     
-    return distance;
+    return compute_cost(current_vertex_, vertex);
 } 
         
 
@@ -193,11 +194,13 @@ double SSIPatrolAgent::compute_cost(int vertex)
 
 double SSIPatrolAgent::compute_cost(int cv, int nv)
 {
+    if (shortest_paths_.contains(cv, nv)) return shortest_paths_.getCost(cv, nv); /// < EXIT POINT (table lookup)
+    
     uint elem_s_path;
-    int *shortest_path = new int[graph_dimension_]; 
+    std::vector<int> shortest_path(graph_dimension_); 
     int id_neigh;
     
-    dijkstra( cv, nv, shortest_path, elem_s_path, graph_, graph_dimension_); //structure with normal costs
+    dijkstra( cv, nv, shortest_path.data(), elem_s_path, graph_, graph_dimension_); //structure with normal costs
     double distance = 0;
     
     for(uint j=0; j<elem_s_path; j++){
@@ -215,27 +218,14 @@ double SSIPatrolAgent::compute_cost(int cv, int nv)
 
 size_t SSIPatrolAgent::compute_hops(int cv, int nv)
 {
+    if (shortest_paths_.contains(cv, nv)) return shortest_paths_.getHops(cv, nv); /// < EXIT POINT (table lookup)
+    
     uint elem_s_path;
-    int *shortest_path = new int[graph_dimension_]; 
-    int id_neigh;
+    std::vector<int> shortest_path(graph_dimension_); 
     
-    dijkstra( cv, nv, shortest_path, elem_s_path, graph_, graph_dimension_); //structure with normal costs
+    dijkstra( cv, nv, shortest_path.data(), elem_s_path, graph_, graph_dimension_); //structure with normal costs
     
-#if 1
     return elem_s_path-1;
-#else    
-    size_t hops = 0;
-    
-    for(uint j=0; j<elem_s_path; j++){
-//        printf("path[%u] = %d\n",j,shortest_path[j]);
-        
-        if (j<elem_s_path-1){
-            id_neigh = is_neigh(shortest_path[j], shortest_path[j+1], graph_, graph_dimension_);
-			hops++;
-        }       
-    }
-    return hops;
-#endif
 }        
 
 
@@ -321,69 +311,114 @@ int SSIPatrolAgent::select_next_vertex(int cv,bool* sv){
 
 double SSIPatrolAgent::compute_bid(int nv){
 
+#if DEBUG_PRINT
 	printf("## computing bid for vertex %d \n",nv);
-/*	printf("current tasks = ");
-	for (size_t i = 0; i<dimension;i++){
-		printf(" %d, ",tasks[i]);	
-    }
-    printf("] \n"); */
+#endif
 
 	if (nv==next_vertex_ || nv==next_next_vertex){
 //		printf("already going to %d sending 0 (current target: %d, current next target: %d)",nv,next_vertex,next_next_vertex);
 		return 0.;
 	}
 
-	//local copy of task list for computing the bid, put as selected the ones I do not want to consider 
-	bool* my_tasks = new bool[graph_dimension_];
-	//printf("current tasks [");
-	for (size_t i = 0; i<graph_dimension_; i++){
-	//	printf(" %d, ",tasks[i]);
-		my_tasks[i] = !tasks[i];
-	} 
-	//printf(" ] \n");*/
-
-	//add nv to my_tasks (regardless of whether this was my responsibility already)
-	my_tasks[nv] = false;
-
-/*	printf("my tasks [");
-	for (size_t i = 0; i<dimension; i++){
-		printf(" %d, ",my_tasks[i]);
-	} 
-	printf(" ] \n");
-*/
-	//accumulator for total path cost
-	double path_cost = 0.;
-
 	//put as first location the current target if any
-	int ci = -1;
-	if (next_vertex_ != -1){
-		ci = next_vertex_;
-		path_cost = compute_cost(ci);//this should give the geometric distance from robot position to destination 
-		my_tasks[ci] = true; //remove this task from the list
-		//printf("[Target Set] Pathcost from %d to %d : %.2f \n",current_vertex,ci,path_cost);
-	} else { 
-		ci = return_next_vertex(current_vertex_,my_tasks);
-		path_cost = compute_cost(ci);
-		//printf("[Target NOT Set] Pathcost from %d to %d : %.2f \n",current_vertex,ci,path_cost);
-	}
-	//handle remaining locations in reverse utility order
-	while (!all_selected(my_tasks)){
-		int ni = return_next_vertex(ci,my_tasks);
-		path_cost += compute_cost(ci,ni);
-		//printf("[while loop] pathcost from %d to %d : %.2f \n",ci,ni,path_cost);
-		ci=ni;
-	}
-	if (ci >= 0 && ci < graph_dimension_){
-		printf("returning back from (last task) %d to (current vertex) %d (cost = %.2f) \n",ci,current_vertex_,path_cost);
-		path_cost += compute_cost(ci,current_vertex_);
-	}
-	printf("## total cost = %.2f \n",path_cost);
+	const int start = tour_start_vertex();
+	if (start < 0 || start >= graph_dimension_) return BIG_NUMBER; /// < EXIT POINT
+
+	//this should give the geometric distance from robot position to destination 
+	double path_cost = compute_cost(start);
 
-	delete[] my_tasks;
+	//the tour through the current tasks plus nv at its cheapest position (regardless of whether nv was my responsibility already)
+	double insertion_cost = 0.;
+	size_t insertion_pos = 0;
+	path_cost += compute_tour_cost(start, nv, &insertion_cost, &insertion_pos) + insertion_cost;
+
+#if DEBUG_PRINT
+	printf("## total cost = %.2f (insertion cost = %.2f, tour size = %zu) \n",path_cost,insertion_cost,tour.size());
+#endif
 
 	return path_cost;
 }
 
+int SSIPatrolAgent::tour_start_vertex() const {
+	return (next_vertex_ != -1) ? next_vertex_ : current_vertex_;
+}
+
+double SSIPatrolAgent::compute_tour_cost(int start, int nv, double* insertion_cost, size_t* insertion_pos){
+
+	//the tour is closed on the current vertex (if any)
+	const bool back = (current_vertex_ >= 0 && current_vertex_ < graph_dimension_);
+
+	double cost = 0.;
+	double best_insertion = BIG_NUMBER;
+	size_t best_pos = tour.size();
+	bool nv_in_tour = (nv == start);
+
+	int prev = start;
+	for (size_t i = 0; i <= tour.size(); i++){
+		int v = current_vertex_;
+		if (i < tour.size()){
+			v = tour[i];
+			if (v == start) continue; // the current target is the first location
+			if (v == nv) nv_in_tour = true;
+		} else if (!back){
+			//open tour: nv can only be appended
+			if (nv >= 0){
+				const double append_cost = compute_cost(prev,nv);
+				if (append_cost < best_insertion){
+					best_insertion = append_cost;
+					best_pos = i;
+				}
+			}
+			break;
+		}
+
+		const double edge_cost = compute_cost(prev,v);
+		cost += edge_cost;
+
+		//cost of the detour prev -> nv -> v
+		if (nv >= 0){
+			const double detour_cost = compute_cost(prev,nv) + compute_cost(nv,v) - edge_cost;
+			if (detour_cost < best_insertion){
+				best_insertion = detour_cost;
+				best_pos = i;
+			}
+		}
+		prev = v;
+	}
+
+	if (insertion_cost) *insertion_cost = nv_in_tour ? 0. : best_insertion;
+	if (insertion_pos) *insertion_pos = best_pos;
+	return cost;
+}
+
+void SSIPatrolAgent::update_tour(){
+
+	//remove the vertices that are no longer tasks (the order of the others is kept)
+	std::vector<bool> in_tour(graph_dimension_, false);
+	size_t num = 0;
+	for (size_t i = 0; i < tour.size(); i++){
+		const int v = tour[i];
+		if (v >= 0 && v < graph_dimension_ && tasks[v] && !in_tour[v]){
+			in_tour[v] = true;
+			tour[num++] = v;
+		}
+	}
+	tour.resize(num);
+
+	//insert the new tasks at their cheapest positions
+	const int start = tour_start_vertex();
+	if (start < 0 || start >= graph_dimension_) return; /// < EXIT POINT
+	for (size_t v = 0; v < graph_dimension_; v++){
+		if (tasks[v] && !in_tour[v]){
+			double insertion_cost = 0.;
+			size_t insertion_pos = tour.size();
+			compute_tour_cost(start, v, &insertion_cost, &insertion_pos);
+			tour.insert(tour.begin() + insertion_pos, (int)v);
+			in_tour[v] = true;
+		}
+	}
+}
+
 void SSIPatrolAgent::force_bid(int nv,double bv,int rid){
 	//printf("forcing bid for vertex %d with value %.2f from robot %d \n",nv,bv,rid);
 	bids[nv].bidValue = bv;
@@ -415,7 +450,12 @@ int SSIPatrolAgent::compute_next_vertex() {
 // current_vertex (goal just reached)
 int SSIPatrolAgent::compute_next_vertex(int cv) {
 
+    if (allocator) return compute_next_vertex_with_allocator(cv); /// < EXIT POINT
+
     update_global_idleness();
+    
+    // costs from the robot pose to all the vertices with a single request to the path planner (used by the bids, see compute_cost())
+    updatePoseNavCosts();
 
 
 	//consider all possible vertices as next target (i.e., set all vertices to false)	
@@ -495,10 +535,74 @@ int SSIPatrolAgent::compute_next_vertex(int cv) {
 }
 
 
+int SSIPatrolAgent::compute_next_vertex_with_allocator(int cv) {
+
+    update_global_idleness();
+
+    if (cv < 0 || cv >= graph_dimension_) return select_next_vertex(cv,selected_vertices); /// < EXIT POINT
+
+    //this robot is the first one of the problem
+    TaskAllocator::Problem problem;
+    problem.time_budget = allocator_time_budget;
+    problem.robot_vertices.push_back(cv);
+    for (int id = 0; id < TEAMSIZE_; id++){
+        if (id == ID_ROBOT_) continue;
+        problem.robot_vertices.push_back(IdentifyVertex3D(graph_, graph_dimension_, xPos_[id], yPos_[id], zPos_[id]));
+    }
+    for (size_t i = 0; i < graph_dimension_; i++){
+        if ((int)i != cv) problem.tasks.push_back(i);
+    }
+
+    TaskAllocator::Allocation allocation;
+    if (!allocator->allocate(shortest_paths_, problem, allocation)){
+        ROS_WARN_STREAM("SSIPatrolAgent::compute_next_vertex_with_allocator() - " << allocator->getName() << " exceeded the time budget: " 
+                        << allocation.num_fallback_tasks << " tasks allocated to the closest robots");
+    }
+#if DEBUG_PRINT
+    printf("DTAP %s allocation: robots %zu, cost %.2f, iterations %zu, time %.4f [s]\n",allocator->getName(),problem.robot_vertices.size(),
+           allocation.total_cost,allocation.num_iterations,allocation.compute_time);
+#endif
+
+    const std::vector<int>& bundle = allocation.bundles[0];
+    nactivetasks = bundle.size();
+    for (size_t i = 0; i < graph_dimension_; i++){
+        tasks[i] = false;
+    }
+    for (size_t k = 0; k < bundle.size(); k++){
+        tasks[bundle[k]] = true;
+    }
+    update_tour();
+
+    //no tasks (e.g. more robots than vertices): the vertex with the highest utility
+    if (bundle.empty()){
+        reset_selected_vertices(selected_vertices);
+        selected_vertices[cv] = true;
+        return select_next_vertex(cv,selected_vertices); /// < EXIT POINT
+    }
+
+    double maxUtility = -1e9;
+    int nv = bundle[0];
+    for (size_t k = 0; k < bundle.size(); k++){
+        const double U = utility(cv,bundle[k]);
+        if (U > maxUtility){
+            maxUtility = U;
+            nv = bundle[k];
+        }
+    }
+    return nv;
+}
+
+
 // NOTE: redefined in DTASSIPart_Agent
 void SSIPatrolAgent::update_tasks(){
+    bool changed = false;
     for (size_t i = 0; i< graph_dimension_; i++){
-        tasks[i] = (bids[i].robotId == ID_ROBOT_);
+        const bool task = (bids[i].robotId == ID_ROBOT_);
+        if (tasks[i] != task) changed = true;
+        tasks[i] = task;
+    }
+    if (changed){
+        update_tour();
     }
 }
 
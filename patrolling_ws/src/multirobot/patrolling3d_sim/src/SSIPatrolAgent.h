@@ -13,6 +13,7 @@
 #include "PatrolAgent.h"
 #include "algorithms.h"
 #include "config.h"
+#include "TaskAllocator.h"
 
 
 #define CONFIG_FILENAME "params/DTA/DTASSI.params"
@@ -55,6 +56,11 @@ protected:
     // number of active tasks
     int nactivetasks;
 
+    //tour of this robot through its tasks: task vertices in visiting order. The tour starts from the current target (or the current vertex if 
+    //there is no target, see tour_start_vertex()) and goes back to the current vertex. It is maintained by cheapest insertion when the tasks 
+    //change (see update_tour()), so a bid only needs the cost of inserting one more vertex.
+    std::vector<int> tour;
+
     //vertices that has been selected within the same optimization loop but for which the robot did not win the auction
     bool* selected_vertices;
     
@@ -82,6 +88,18 @@ protected:
     double hist;
 
     ConfigFile cf;
+
+    //task allocation solver (config param "allocator": SSI, Parallel or CBBA, see TaskAllocator). If set, the tasks are allocated locally
+    //on the team model (the teammates start from the vertices closest to their last known positions) instead of the auctions with the 
+    //task request and bid messages, so the robot does not wait for the bids.
+    boost::shared_ptr<TaskAllocator> allocator;
+
+    //compute time budget of the allocator [s] (config param "allocator_time_budget", <= 0 unlimited)
+    double allocator_time_budget;
+
+    //allocate all vertices to the team with the allocator, update tasks with the bundle of this robot and
+    //return the task with the highest utility from the current vertex (cv)
+    int compute_next_vertex_with_allocator(int cv);
 	
     //allocate an array of bool one for each vertex, set all to false
     bool* create_selected_vertices();
@@ -105,11 +123,21 @@ protected:
     int return_next_vertex(int currv, bool* sv);
 
  
-    //compute minimum path cost considering all tasks (tasks) and the next vertex (nv). 
-    //The first room is always the current goal (if any), then rooms are visited in decreasing order of utility. 
-    //The path cost is sum of travel cost given the order. 
+    //compute the path cost of the tour through all tasks (tasks) and the next vertex (nv). 
+    //The first room is always the current goal (if any), then rooms are visited in the order of the tour, where nv is put at its cheapest insertion position. 
+    //The path cost is sum of travel cost given the order (the shortest path costs are table lookups, see compute_cost()). 
     virtual double compute_bid(int nv);	
 
+    //first vertex of the tour: the current target if any, otherwise the current vertex 
+    int tour_start_vertex() const;
+
+    //return the path cost of the tour from start, through the tour vertices, back to the current vertex;
+    //if nv >= 0, compute also the cheapest insertion of nv in the tour: the extra cost (0 if nv is already in the tour) and the position in the array tour
+    double compute_tour_cost(int start, int nv, double* insertion_cost, size_t* insertion_pos);
+
+    //remove from the tour the vertices that are no longer tasks and insert the new tasks at their cheapest positions 
+    void update_tour();
+
     //force the best bid for dest to be the one from robotId with value bidvalue	
     void force_bid(int nv,double bidvalue,int robotId);
 
@@ -0,0 +1,114 @@
+/**
+* This file is part of the ROS package patrolling3d_sim which belongs to the framework 3DMR. 
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> 
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ShortestPathTable.h"
+
+#include <queue>
+#include <functional>
+
+const double ShortestPathTable::kInfiniteCost = std::numeric_limits<double>::infinity();
+const size_t ShortestPathTable::kInfiniteHops = std::numeric_limits<size_t>::max();
+
+bool ShortestPathTable::update(const Vertex* graph, const uint dimension)
+{
+    CsrGraph csr_graph; 
+    csr_graph.buildFromVertices(graph, dimension);
+    return update(csr_graph);
+}
+
+bool ShortestPathTable::update(const CsrGraph& graph)
+{
+    std::vector<uint> signature; 
+    getEdgesSignature(graph, signature); 
+    if( (graph.size() == dimension_) && (signature == edges_signature_) ) return false; /// < EXIT POINT 
+    
+    dimension_ = graph.size(); 
+    version_++;
+    edges_signature_.swap(signature); 
+    costs_.assign((size_t)dimension_*dimension_, kInfiniteCost);
+    hops_.assign((size_t)dimension_*dimension_, kInfiniteHops);
+    
+    for(uint source=0; source<dimension_; source++)
+    {
+        computeFrom(graph, source); 
+    }
+    
+    ROS_INFO_STREAM("ShortestPathTable::update() - computed the shortest paths of " << dimension_ << " vertices");
+    return true;
+}
+
+void ShortestPathTable::clear()
+{
+    dimension_ = 0; 
+    version_++;
+    costs_.clear();
+    hops_.clear();
+    edges_signature_.clear();
+}
+
+void ShortestPathTable::computeFrom(const CsrGraph& graph, const uint source)
+{
+    double* costs = &costs_[(size_t)source*dimension_];
+    size_t* hops  = &hops_[(size_t)source*dimension_];
+    
+    typedef std::pair<double, uint> HeapEntry;
+    std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry> > heap;
+    std::vector<bool> visited(dimension_, false);
+    
+    costs[source] = 0;
+    hops[source] = 0;
+    heap.push(HeapEntry(0, source));
+    
+    while(!heap.empty())
+    {
+        const uint v = heap.top().second;
+        heap.pop();
+        if(visited[v]) continue; /// < CONTINUE (stale entry)
+        visited[v] = true; 
+        
+        for(uint e=graph.getEdgesBegin(v), eEnd=graph.getEdgesEnd(v); e<eEnd; e++)
+        {
+            const uint j = graph.getNeighbor(e);
+            if( (j >= dimension_) || visited[j] ) continue; /// < CONTINUE
+            
+            const double cost = costs[v] + graph.getCost(e);
+            if(cost < costs[j])
+            {
+                costs[j] = cost; 
+                hops[j]  = hops[v] + 1;
+                heap.push(HeapEntry(cost, j));
+            }
+        }
+    }
+}
+
+void ShortestPathTable::getEdgesSignature(const CsrGraph& graph, std::vector<uint>& signature)
+{
+    signature.clear();
+    for(uint i=0; i<graph.size(); i++)
+    {
+        signature.push_back(graph.getNumNeighbors(i));
+        for(uint e=graph.getEdgesBegin(i), eEnd=graph.getEdgesEnd(i); e<eEnd; e++)
+        {
+            signature.push_back(graph.getNeighbor(e));
+            signature.push_back(graph.getCost(e));
+        }
+    }
+}
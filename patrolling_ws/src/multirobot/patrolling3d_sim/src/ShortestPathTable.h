@@ -0,0 +1,85 @@
+/**
+* This file is part of the ROS package patrolling3d_sim which belongs to the framework 3DMR. 
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> 
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SHORTEST_PATH_TABLE_H
+#define SHORTEST_PATH_TABLE_H
+
+#include <vector>
+#include <limits>
+
+#include "graph.h"
+#include "CsrGraph.h"
+
+///	\class ShortestPathTable
+///	\author Luigi Freda 
+///	\brief All-pairs shortest paths of the patrolling graph (repeated binary-heap Dijkstra on the CSR graph with the edge costs Vertex::cost): 
+///	       for each pair of vertices, the cost and the number of hops of the shortest path. 
+///	       It is computed once when the graph is loaded/received and recomputed only when the graph edges or their costs change. 
+///	\note  The vertex ids are the indices in the graph array (as in dijkstra()). 
+/// 	\todo 
+///	\date
+///	\warning not thread-safe (update it under the lock of the graph)
+class ShortestPathTable
+{
+public: 
+    
+    static const double kInfiniteCost; 
+    static const size_t kInfiniteHops; 
+    
+public: 
+    
+    ShortestPathTable():dimension_(0),version_(0){}
+    
+    // recompute the table if the graph (size, neighbors or edge costs) changed; return true if it was recomputed 
+    bool update(const CsrGraph& graph);
+    bool update(const Vertex* graph, const uint dimension);
+    
+    void clear();
+    
+    bool isValid() const { return dimension_ > 0; }
+    uint size() const { return dimension_; }
+    
+    // incremented each time the table is recomputed or cleared (to invalidate data derived from the costs)
+    size_t getVersion() const { return version_; }
+    bool contains(const int from, const int to) const { return (from >= 0) && (to >= 0) && ((uint)from < dimension_) && ((uint)to < dimension_); }
+        
+    // cost of the shortest path from 'from' to 'to' (kInfiniteCost if it does not exist); the vertices must be contained 
+    double getCost(const int from, const int to) const { return costs_[from*dimension_ + to]; }
+    
+    // number of hops of the shortest path from 'from' to 'to' (kInfiniteHops if it does not exist); the vertices must be contained 
+    size_t getHops(const int from, const int to) const { return hops_[from*dimension_ + to]; }
+    
+protected:
+    
+    void computeFrom(const CsrGraph& graph, const uint source);
+    
+    static void getEdgesSignature(const CsrGraph& graph, std::vector<uint>& signature);
+    
+protected:     
+    
+    uint dimension_;
+    size_t version_; 
+    std::vector<double> costs_; // dimension_ x dimension_, row-major (a row for each source vertex)
+    std::vector<size_t> hops_;   // dimension_ x dimension_, row-major 
+    
+    std::vector<uint> edges_signature_; // neighbors and edge costs of all the vertices when the table was computed 
+};
+
+#endif
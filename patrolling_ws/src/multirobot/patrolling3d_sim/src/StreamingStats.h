@@ -0,0 +1,391 @@
+/**
+* This file is part of the ROS package patrolling3d_sim which belongs to the framework 3DMR. 
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> 
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef STREAMING_STATS_H
+#define STREAMING_STATS_H
+
+#include <math.h>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+
+///	\class WelfordStats
+///	\author Luigi Freda
+///	\brief Streaming mean, variance, min and max of a signal with O(1) updates (Welford's algorithm, numerically stable). 
+///	       A sample can also be replaced by a new value (the set of samples keeps its size): this is used for the statistics 
+///	       over the vertices of a graph when the value of a single vertex changes.
+///	\note  min and max are not updated by replace()
+/// 	\todo 
+///	\date
+///	\warning
+class WelfordStats
+{
+public:
+
+    WelfordStats() { reset(); }
+
+    void reset()
+    {
+        n_ = 0;
+        mean_ = 0;
+        m2_ = 0;
+        min_ = std::numeric_limits<double>::max();
+        max_ = -std::numeric_limits<double>::max();
+    }
+
+    void add(double x)
+    {
+        n_++;
+        const double delta = x - mean_;
+        mean_ += delta / n_;
+        m2_ += delta * (x - mean_);
+        if (x < min_) min_ = x;
+        if (x > max_) max_ = x;
+    }
+
+    // replace a sample of value old_x with new_x
+    void replace(double old_x, double new_x)
+    {
+        if (n_ == 0) return; /// < EXIT POINT
+        const double old_mean = mean_;
+        mean_ += (new_x - old_x) / n_;
+        m2_ += (new_x - old_x) * (new_x - mean_ + old_x - old_mean);
+        if (m2_ < 0) m2_ = 0;
+    }
+
+public: /// getters
+
+    size_t getCount() const { return n_; }
+    double getMean() const { return mean_; }
+
+    // population variance (as 1/N * sqrt(N*sum(x^2) - sum(x)^2) computed by the monitor)
+    double getVariance() const { return (n_ > 0) ? std::max(m2_ / n_, 0.) : 0.; }
+    double getStdDev() const { return sqrt(getVariance()); }
+
+    double getMin() const { return (n_ > 0) ? min_ : 0.; }
+    double getMax() const { return (n_ > 0) ? max_ : 0.; }
+
+protected:
+
+    size_t n_;
+    double mean_;
+    double m2_;
+    double min_, max_;
+};
+
+
+///	\class P2Quantile
+///	\author Luigi Freda
+///	\brief Streaming estimate of a quantile of a signal with O(1) memory and updates (P-square algorithm of Jain and Chlamtac). 
+///	       Five markers track the min, the p/2, p, (1+p)/2 quantiles and the max; their heights are adjusted with a piecewise-parabolic 
+///	       interpolation as the samples arrive. The quantile is exact until five samples have been received.
+///	\note
+/// 	\todo 
+///	\date
+///	\warning
+class P2Quantile
+{
+public:
+
+    P2Quantile(double p = 0.5):p_(p) { reset(); }
+
+    void reset()
+    {
+        count_ = 0;
+        for (int i = 0; i < 5; i++) { q_[i] = 0; n_[i] = i; }
+        np_[0] = 0; np_[1] = 2 * p_; np_[2] = 4 * p_; np_[3] = 2 + 2 * p_; np_[4] = 4;
+        dn_[0] = 0; dn_[1] = p_ / 2; dn_[2] = p_; dn_[3] = (1 + p_) / 2; dn_[4] = 1;
+    }
+
+    void add(double x)
+    {
+        if (count_ < 5)
+        {
+            // keep the first samples sorted
+            int i = count_++;
+            for (; (i > 0) && (q_[i - 1] > x); i--) q_[i] = q_[i - 1];
+            q_[i] = x;
+            return; /// < EXIT POINT
+        }
+        count_++;
+
+        // find the cell of x and update the extreme markers
+        int k;
+        if (x < q_[0])
+        {
+            q_[0] = x;
+            k = 0;
+        }
+        else if (x >= q_[4])
+        {
+            q_[4] = x;
+            k = 3;
+        }
+        else
+        {
+            for (k = 0; (k < 3) && (x >= q_[k + 1]); k++) {}
+        }
+
+        for (int i = k + 1; i < 5; i++) n_[i]++;
+        for (int i = 0; i < 5; i++) np_[i] += dn_[i];
+
+        // adjust the heights of the middle markers
+        for (int i = 1; i < 4; i++)
+        {
+            const double d = np_[i] - n_[i];
+            if (((d >= 1) && (n_[i + 1] - n_[i] > 1)) || ((d <= -1) && (n_[i - 1] - n_[i] < -1)))
+            {
+                const int ds = (d > 0) ? 1 : -1;
+                const double qp = parabolic(i, ds);
+                if ((q_[i - 1] < qp) && (qp < q_[i + 1]))
+                    q_[i] = qp;
+                else
+                    q_[i] += ds * (q_[i + ds] - q_[i]) / (n_[i + ds] - n_[i]); // linear
+                n_[i] += ds;
+            }
+        }
+    }
+
+public: /// getters
+
+    size_t getCount() const { return count_; }
+
+    double getValue() const
+    {
+        if (count_ == 0) return 0; /// < EXIT POINT
+        if (count_ < 5) return q_[std::min((size_t) (p_ * count_), count_ - 1)]; /// < EXIT POINT
+        return q_[2];
+    }
+
+protected:
+
+    double parabolic(int i, int ds) const
+    {
+        return q_[i] + ds / (n_[i + 1] - n_[i - 1]) *
+                ((n_[i] - n_[i - 1] + ds) * (q_[i + 1] - q_[i]) / (n_[i + 1] - n_[i]) +
+                 (n_[i + 1] - n_[i] - ds) * (q_[i] - q_[i - 1]) / (n_[i] - n_[i - 1]));
+    }
+
+protected:
+
+    double p_;
+    size_t count_;
+    double q_[5];   // marker heights
+    double n_[5];   // marker positions
+    double np_[5];  // desired marker positions
+    double dn_[5];  // increments of the desired positions
+};
+
+
+///	\class MinCountTracker
+///	\author Luigi Freda
+///	\brief Minimum of a set of counters (e.g. number of visits of the vertices) which are only incremented by one, with O(1) updates: 
+///	       the number of counters for each count value is stored. Negative counters are not considered in the minimum until they reach zero. 
+///	\note
+/// 	\todo 
+///	\date
+///	\warning
+class MinCountTracker
+{
+public:
+
+    MinCountTracker() { reset(0, 0); }
+
+    void reset(const int* counts, size_t size)
+    {
+        histogram_.clear();
+        min_ = -1;
+        for (size_t i = 0; i < size; i++)
+        {
+            if (counts[i] >= 0) insert(counts[i]);
+        }
+    }
+
+    // a counter has been incremented from old_count to old_count+1
+    void increment(int old_count)
+    {
+        if (old_count >= 0)
+        {
+            histogram_[old_count]--;
+        }
+        insert(old_count + 1);
+        // the minimum moves forward when its last counter has been incremented
+        while ((min_ >= 0) && (histogram_[min_] == 0)) min_++;
+    }
+
+    // minimum of the non-negative counters (-1 if there is none)
+    int getMin() const { return min_; }
+
+protected:
+
+    void insert(int count)
+    {
+        if (count < 0) return; /// < EXIT POINT
+        if ((size_t) count >= histogram_.size()) histogram_.resize(count + 1, 0);
+        histogram_[count]++;
+        if ((min_ < 0) || (count < min_)) min_ = count;
+    }
+
+protected:
+
+    std::vector<size_t> histogram_; // for each count value, the number of counters with that value
+    int min_;
+};
+
+
+
+///	\class TDigest
+///	\author Luigi Freda
+///	\brief Streaming estimate of all the quantiles of a signal (merging t-digest of Dunning). The samples are clustered in centroids 
+///	       (mean, weight) whose size is small at the tails and large at the median, so that the extreme quantiles stay accurate. 
+///	       The samples are buffered and merged into the centroids when the buffer is full: O(compression) memory, amortized O(log) updates.
+///	\note  the quantile is interpolated between the centroids 
+/// 	\todo 
+///	\date
+///	\warning
+class TDigest
+{
+public:
+
+    TDigest(double compression = 100):compression_(compression) 
+    { 
+        buffer_capacity_ = (size_t) (5 * compression_);
+        reset(); 
+    }
+
+    void reset()
+    {
+        centroids_.clear();
+        buffer_.clear();
+        buffer_.reserve(buffer_capacity_);
+        count_ = 0;
+        min_ = std::numeric_limits<double>::max();
+        max_ = -std::numeric_limits<double>::max();
+    }
+
+    void add(double x)
+    {
+        buffer_.push_back(Centroid(x, 1));
+        count_++;
+        if (x < min_) min_ = x;
+        if (x > max_) max_ = x;
+        if (buffer_.size() >= buffer_capacity_) merge();
+    }
+
+public: /// getters
+
+    size_t getCount() const { return count_; }
+
+    double getMin() const { return (count_ > 0) ? min_ : 0.; }
+    double getMax() const { return (count_ > 0) ? max_ : 0.; }
+
+    // estimate of the quantile q in [0,1] (the pending samples are merged first)
+    double getQuantile(double q)
+    {
+        merge();
+        if (centroids_.empty()) return 0; /// < EXIT POINT
+        if (centroids_.size() == 1) return centroids_[0].mean; /// < EXIT POINT
+        q = std::min(std::max(q, 0.), 1.);
+
+        // the center of a centroid is at the middle of its cumulated weight
+        const double index = q * count_;
+        const Centroid& first = centroids_.front();
+        if (index < first.weight / 2) 
+        {
+            return min_ + (first.mean - min_) * index / (first.weight / 2); /// < EXIT POINT
+        }
+        double cumulated = 0;
+        for (size_t i = 0; i + 1 < centroids_.size(); i++)
+        {
+            const Centroid& c = centroids_[i];
+            const Centroid& next = centroids_[i + 1];
+            const double center = cumulated + c.weight / 2;
+            const double next_center = cumulated + c.weight + next.weight / 2;
+            if (index < next_center)
+            {
+                return c.mean + (next.mean - c.mean) * (index - center) / (next_center - center); /// < EXIT POINT
+            }
+            cumulated += c.weight;
+        }
+        const Centroid& last = centroids_.back();
+        const double last_center = count_ - last.weight / 2;
+        return last.mean + (max_ - last.mean) * std::min((index - last_center) / (last.weight / 2), 1.);
+    }
+
+protected:
+
+    struct Centroid
+    {
+        Centroid(double m = 0, double w = 0):mean(m),weight(w){}
+        bool operator<(const Centroid& other) const { return mean < other.mean; }
+        double mean;
+        double weight;
+    };
+
+    // scale function k1 of the t-digest: the centroids span at most one unit of k 
+    double k(double q) const { return compression_ / (2 * M_PI) * asin(2 * q - 1); }
+    double kInverse(double k) const 
+    { 
+        if (k >= compression_ / 4) return 1; /// < EXIT POINT
+        return (sin(k * 2 * M_PI / compression_) + 1) / 2; 
+    }
+
+    void merge()
+    {
+        if (buffer_.empty()) return; /// < EXIT POINT
+        buffer_.insert(buffer_.end(), centroids_.begin(), centroids_.end());
+        std::sort(buffer_.begin(), buffer_.end());
+
+        centroids_.clear();
+        Centroid current = buffer_[0];
+        double cumulated = 0;
+        double q_limit = kInverse(k(0) + 1);
+        for (size_t i = 1; i < buffer_.size(); i++)
+        {
+            const Centroid& next = buffer_[i];
+            if ((cumulated + current.weight + next.weight) / count_ <= q_limit)
+            {
+                current.weight += next.weight;
+                current.mean += (next.mean - current.mean) * next.weight / current.weight;
+            }
+            else
+            {
+                cumulated += current.weight;
+                centroids_.push_back(current);
+                q_limit = kInverse(k(cumulated / count_) + 1);
+                current = next;
+            }
+        }
+        centroids_.push_back(current);
+        buffer_.clear();
+    }
+
+protected:
+
+    double compression_;
+    size_t buffer_capacity_;
+    std::vector<Centroid> centroids_; // sorted by mean 
+    std::vector<Centroid> buffer_;    // samples not merged yet 
+    size_t count_;
+    double min_, max_;
+};
+
+#endif
@@ -0,0 +1,353 @@
+/**
+* This file is part of the ROS package patrolling3d_sim which belongs to the framework 3DMR. 
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> 
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "TaskAllocator.h"
+
+#include <algorithm>
+#include <limits>
+
+const char* TaskAllocator::kTypeNames[TaskAllocator::kNumTypes] = {"SSI", "Parallel", "CBBA"};
+
+const double TaskAllocator::kMaxCost = 1e9;
+
+const size_t ConsensusBundleTaskAllocator::kMaxNumIterationsPerTask = 2;
+
+
+TaskAllocator* TaskAllocator::create(int type)
+{
+    switch (type)
+    {
+    case kSequentialSingleItem:
+        return new SequentialSingleItemTaskAllocator();
+    case kParallel:
+        return new ParallelTaskAllocator();
+    case kConsensusBundle:
+        return new ConsensusBundleTaskAllocator();
+    }
+    return NULL;
+}
+
+int TaskAllocator::getType(const std::string& name)
+{
+    for (int i = 0; i < kNumTypes; i++)
+    {
+        if (name == kTypeNames[i]) return i; /// < EXIT POINT
+    }
+    return -1;
+}
+
+bool TaskAllocator::allocate(const ShortestPathTable& paths, const Problem& problem, Allocation& allocation)
+{
+    start_time_ = std::chrono::steady_clock::now();
+    time_budget_ = problem.time_budget;
+    
+    const size_t num_robots = problem.robot_vertices.size();
+    allocation = Allocation();
+    allocation.bundles.resize(num_robots);
+    allocation.costs.assign(num_robots, 0.);
+    if (num_robots == 0) return true; /// < EXIT POINT
+    
+    std::vector<bool> allocated(problem.tasks.size(), false);
+    solve(paths, problem, allocation, allocated);
+    
+    // fallback: the unallocated tasks are appended to the bundle of the closest robot 
+    for (size_t j = 0; j < problem.tasks.size(); j++)
+    {
+        if (allocated[j]) continue; /// < CONTINUE
+        
+        size_t closest = 0;
+        double min_cost = std::numeric_limits<double>::max();
+        for (size_t r = 0; r < num_robots; r++)
+        {
+            const double cost = getCost(paths, problem.robot_vertices[r], problem.tasks[j]);
+            if (cost < min_cost)
+            {
+                min_cost = cost;
+                closest = r;
+            }
+        }
+        allocation.bundles[closest].push_back(problem.tasks[j]);
+        allocation.num_fallback_tasks++;
+    }
+    
+    for (size_t r = 0; r < num_robots; r++)
+    {
+        allocation.costs[r] = computeBundleCost(paths, problem.robot_vertices[r], allocation.bundles[r]);
+        allocation.total_cost += allocation.costs[r];
+    }
+    
+    allocation.compute_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time_).count();
+    return allocation.num_fallback_tasks == 0;
+}
+
+double TaskAllocator::computeBundleCost(const ShortestPathTable& paths, const int start, const std::vector<int>& bundle)
+{
+    double cost = 0.;
+    int prev = start;
+    for (size_t i = 0; i < bundle.size(); i++)
+    {
+        cost += getCost(paths, prev, bundle[i]);
+        prev = bundle[i];
+    }
+    return cost;
+}
+
+double TaskAllocator::computeInsertionCost(const ShortestPathTable& paths, const int start, const std::vector<int>& bundle, const int task, size_t& pos)
+{
+    // append 
+    pos = bundle.size();
+    double min_cost = getCost(paths, bundle.empty() ? start : bundle.back(), task);
+    
+    // detour prev -> task -> bundle[i]
+    int prev = start;
+    for (size_t i = 0; i < bundle.size(); i++)
+    {
+        const double cost = getCost(paths, prev, task) + getCost(paths, task, bundle[i]) - getCost(paths, prev, bundle[i]);
+        if (cost < min_cost)
+        {
+            min_cost = cost;
+            pos = i;
+        }
+        prev = bundle[i];
+    }
+    return min_cost;
+}
+
+bool TaskAllocator::isBudgetExceeded() const
+{
+    if (time_budget_ <= 0) return false; /// < EXIT POINT
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time_).count() > time_budget_;
+}
+
+double TaskAllocator::getCost(const ShortestPathTable& paths, const int from, const int to)
+{
+    if (!paths.contains(from, to)) return kMaxCost; /// < EXIT POINT
+    return std::min(paths.getCost(from, to), kMaxCost);
+}
+
+
+/// < ==========================================================================
+
+
+void SequentialSingleItemTaskAllocator::solve(const ShortestPathTable& paths, const Problem& problem, Allocation& allocation, std::vector<bool>& allocated)
+{
+    const size_t num_robots = problem.robot_vertices.size();
+    const size_t num_tasks = problem.tasks.size();
+    
+    // bids[r*num_tasks + j]: cheapest insertion cost of task j in the bundle of robot r (and its position)
+    std::vector<double> bids(num_robots*num_tasks);
+    std::vector<size_t> positions(num_robots*num_tasks);
+    
+    for (size_t r = 0; r < num_robots; r++)
+    {
+        for (size_t j = 0; j < num_tasks; j++)
+        {
+            bids[r*num_tasks + j] = computeInsertionCost(paths, problem.robot_vertices[r], allocation.bundles[r], problem.tasks[j], positions[r*num_tasks + j]);
+        }
+    }
+    
+    for (size_t round = 0; round < num_tasks; round++)
+    {
+        if (isBudgetExceeded()) break; /// < BREAK
+        
+        // auction: lowest bid over all robots and unallocated tasks 
+        size_t winner = 0, task = num_tasks;
+        double min_bid = std::numeric_limits<double>::max();
+        for (size_t r = 0; r < num_robots; r++)
+        {
+            for (size_t j = 0; j < num_tasks; j++)
+            {
+                if (!allocated[j] && (bids[r*num_tasks + j] < min_bid))
+                {
+                    min_bid = bids[r*num_tasks + j];
+                    winner = r;
+                    task = j;
+                }
+            }
+        }
+        if (task == num_tasks) break; /// < BREAK
+        
+        std::vector<int>& bundle = allocation.bundles[winner];
+        bundle.insert(bundle.begin() + positions[winner*num_tasks + task], problem.tasks[task]);
+        allocated[task] = true;
+        allocation.num_iterations++;
+        
+        // only the bids of the winner changed
+        for (size_t j = 0; j < num_tasks; j++)
+        {
+            if (allocated[j]) continue; /// < CONTINUE
+            bids[winner*num_tasks + j] = computeInsertionCost(paths, problem.robot_vertices[winner], bundle, problem.tasks[j], positions[winner*num_tasks + j]);
+        }
+    }
+}
+
+
+/// < ==========================================================================
+
+
+void ParallelTaskAllocator::solve(const ShortestPathTable& paths, const Problem& problem, Allocation& allocation, std::vector<bool>& allocated)
+{
+    const size_t num_robots = problem.robot_vertices.size();
+    const size_t num_tasks = problem.tasks.size();
+    
+    // single round: each task goes to the robot with the closest start vertex 
+    typedef std::pair<double, size_t> CostTask; 
+    std::vector<std::vector<CostTask> > won_tasks(num_robots);
+    for (size_t j = 0; j < num_tasks; j++)
+    {
+        size_t winner = 0;
+        double min_bid = std::numeric_limits<double>::max();
+        for (size_t r = 0; r < num_robots; r++)
+        {
+            const double bid = getCost(paths, problem.robot_vertices[r], problem.tasks[j]);
+            if (bid < min_bid)
+            {
+                min_bid = bid;
+                winner = r;
+            }
+        }
+        won_tasks[winner].push_back(CostTask(min_bid, j));
+    }
+    allocation.num_iterations = 1;
+    
+    // order the bundles: the won tasks are inserted from the closest one at their cheapest positions
+    for (size_t r = 0; r < num_robots; r++)
+    {
+        std::sort(won_tasks[r].begin(), won_tasks[r].end());
+        std::vector<int>& bundle = allocation.bundles[r];
+        for (size_t k = 0; k < won_tasks[r].size(); k++)
+        {
+            if (isBudgetExceeded()) return; /// < EXIT POINT
+            
+            const size_t j = won_tasks[r][k].second;
+            size_t pos = bundle.size();
+            computeInsertionCost(paths, problem.robot_vertices[r], bundle, problem.tasks[j], pos);
+            bundle.insert(bundle.begin() + pos, problem.tasks[j]);
+            allocated[j] = true;
+        }
+    }
+}
+
+
+/// < ==========================================================================
+
+
+// the bid of robot r outbids the winning bid of a task (ties are broken by the lower robot id)
+static inline bool outbids(const double bid, const size_t r, const double winning_bid, const int winner)
+{
+    return (bid < winning_bid) || ( (bid == winning_bid) && ((winner < 0) || ((int)r < winner)) );
+}
+
+void ConsensusBundleTaskAllocator::solve(const ShortestPathTable& paths, const Problem& problem, Allocation& allocation, std::vector<bool>& allocated)
+{
+    const size_t num_robots = problem.robot_vertices.size();
+    const size_t num_tasks = problem.tasks.size();
+    const double kNoBid = std::numeric_limits<double>::infinity();
+    
+    // winning bids and winners shared after each consensus phase
+    std::vector<double> winning_bids(num_tasks, kNoBid);
+    std::vector<int> winners(num_tasks, -1);
+    
+    // for each robot: the tasks in the order they were added to the bundle and its bid on each task of its bundle 
+    std::vector<std::vector<size_t> > added_tasks(num_robots);
+    std::vector<std::vector<double> > bids(num_robots, std::vector<double>(num_tasks, kNoBid));
+    
+    for (size_t iteration = 0; iteration < std::max(kMaxNumIterationsPerTask*num_tasks, (size_t)1); iteration++)
+    {
+        bool changed = false;
+        allocation.num_iterations++;
+        
+        // bundle phase: each robot adds the tasks it can outbid, the cheapest one first 
+        for (size_t r = 0; r < num_robots; r++)
+        {
+            std::vector<int>& bundle = allocation.bundles[r];
+            double last_bid = added_tasks[r].empty() ? 0. : bids[r][added_tasks[r].back()];
+            while (!isBudgetExceeded())
+            {
+                size_t best_task = num_tasks, best_pos = 0;
+                double best_bid = kNoBid;
+                for (size_t j = 0; j < num_tasks; j++)
+                {
+                    if (bids[r][j] != kNoBid) continue; /// < CONTINUE (already in the bundle)
+                    
+                    size_t pos = 0;
+                    const double bid = std::max(computeInsertionCost(paths, problem.robot_vertices[r], bundle, problem.tasks[j], pos), last_bid);
+                    if (outbids(bid, r, winning_bids[j], winners[j]) && (bid < best_bid))
+                    {
+                        best_bid = bid;
+                        best_task = j;
+                        best_pos = pos;
+                    }
+                }
+                if (best_task == num_tasks) break; /// < BREAK
+                
+                bundle.insert(bundle.begin() + best_pos, problem.tasks[best_task]);
+                added_tasks[r].push_back(best_task);
+                bids[r][best_task] = best_bid;
+                last_bid = best_bid;
+                changed = true;
+            }
+        }
+        
+        // consensus phase: the lowest bid of each task wins, then each robot drops its first outbid task and the following ones;
+        // it is repeated after the drops since the dropped tasks may have no winner anymore 
+        for (int pass = 0; pass < 2; pass++)
+        {
+            std::fill(winning_bids.begin(), winning_bids.end(), kNoBid);
+            std::fill(winners.begin(), winners.end(), -1);
+            for (size_t r = 0; r < num_robots; r++)
+            {
+                for (size_t k = 0; k < added_tasks[r].size(); k++)
+                {
+                    const size_t j = added_tasks[r][k];
+                    if (outbids(bids[r][j], r, winning_bids[j], winners[j]))
+                    {
+                        winning_bids[j] = bids[r][j];
+                        winners[j] = r;
+                    }
+                }
+            }
+            if (pass > 0) break; /// < BREAK
+            
+            for (size_t r = 0; r < num_robots; r++)
+            {
+                std::vector<size_t>& tasks = added_tasks[r];
+                size_t k = 0;
+                while ((k < tasks.size()) && (winners[tasks[k]] == (int)r)) k++;
+                for (size_t kk = k; kk < tasks.size(); kk++)
+                {
+                    const size_t j = tasks[kk];
+                    std::vector<int>& bundle = allocation.bundles[r];
+                    bundle.erase(std::find(bundle.begin(), bundle.end(), problem.tasks[j]));
+                    bids[r][j] = kNoBid;
+                    changed = true;
+                }
+                tasks.resize(k);
+            }
+        }
+        
+        if (!changed || isBudgetExceeded()) break; /// < BREAK
+    }
+    
+    for (size_t j = 0; j < num_tasks; j++)
+    {
+        allocated[j] = (winners[j] >= 0);
+    }
+}
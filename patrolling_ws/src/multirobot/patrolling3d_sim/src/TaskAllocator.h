@@ -0,0 +1,181 @@
+/**
+* This file is part of the ROS package patrolling3d_sim which belongs to the framework 3DMR. 
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> 
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TASK_ALLOCATOR_H
+#define TASK_ALLOCATOR_H
+
+#include <vector>
+#include <string>
+#include <chrono>
+
+#include "ShortestPathTable.h"
+
+///	\class TaskAllocator
+///	\author Luigi Freda 
+///	\brief Interface of the task allocation solvers of the DTA agents. A problem is a team of robots (a start vertex for each robot) and 
+///	       a set of task vertices: each robot gets a bundle, i.e. an ordered path of tasks from its start vertex, and the objective is 
+///	       the sum of the path costs (MinSum, shortest path costs of a ShortestPathTable). 
+///	       Every solver takes an explicit compute time budget: when it is exceeded, the tasks which are still unallocated are appended to 
+///	       the bundle of the robot whose start vertex is the closest one (see Allocation::num_fallback_tasks). 
+///	       Implementations: 
+///	       - SequentialSingleItemTaskAllocator: one task per round, to the robot with the lowest marginal (cheapest insertion) cost
+///	       - ParallelTaskAllocator: all tasks in a single round, each one to the robot with the closest start vertex, then each bundle is ordered by cheapest insertion
+///	       - ConsensusBundleTaskAllocator: consensus-based bundle algorithm (CBBA) with marginal costs and full communication 
+///	\note  The solvers do not depend on ROS: the same allocation can be computed by an agent on its team model or by the batch simulator. 
+/// 	\todo 
+///	\date
+///	\warning not thread-safe (use an allocator per thread)
+class TaskAllocator
+{
+public: 
+    
+    enum Type
+    {
+        kSequentialSingleItem = 0, 
+        kParallel, 
+        kConsensusBundle, 
+        kNumTypes
+    };
+    
+    static const char* kTypeNames[kNumTypes];
+    
+    // cost used for the unreachable vertices (it avoids inf - inf in the marginal costs)
+    static const double kMaxCost; 
+    
+    struct Problem
+    {
+        Problem():time_budget(0){}
+        
+        std::vector<int> robot_vertices; // start vertex of each robot 
+        std::vector<int> tasks;          // task vertices to allocate 
+        double time_budget;              // [s] compute time budget (<= 0 unlimited)
+    };
+    
+    struct Allocation
+    {
+        Allocation():total_cost(0),num_fallback_tasks(0),num_iterations(0),compute_time(0){}
+        
+        std::vector<std::vector<int> > bundles; // for each robot, its tasks in visiting order 
+        std::vector<double> costs;              // for each robot, the path cost of its bundle from its start vertex
+        double total_cost; 
+        
+        size_t num_fallback_tasks; // tasks allocated to the closest robot after the time budget was exceeded
+        size_t num_iterations;     // rounds (auctions) or consensus iterations 
+        double compute_time;       // [s]
+    };
+    
+public: 
+    
+    // return NULL if type is not valid 
+    static TaskAllocator* create(int type); 
+    
+    // return -1 if name is not a type name 
+    static int getType(const std::string& name);
+    
+public: 
+    
+    virtual ~TaskAllocator(){}
+    
+    virtual int getType() const = 0; 
+    const char* getName() const { return kTypeNames[getType()]; }
+    
+    // allocate the tasks of problem (the vertices must be contained in paths); 
+    // return false if some tasks were left to the fallback (time budget exceeded or no consensus reached)
+    bool allocate(const ShortestPathTable& paths, const Problem& problem, Allocation& allocation);
+    
+    // path cost from start through the vertices of bundle 
+    static double computeBundleCost(const ShortestPathTable& paths, const int start, const std::vector<int>& bundle);
+    
+    // marginal cost of the cheapest insertion of task in the path start -> bundle; pos is the insertion index in bundle
+    static double computeInsertionCost(const ShortestPathTable& paths, const int start, const std::vector<int>& bundle, const int task, size_t& pos);
+    
+protected:
+    
+    // solver: fill allocation.bundles and allocation.num_iterations; leave the unallocated tasks to the fallback
+    virtual void solve(const ShortestPathTable& paths, const Problem& problem, Allocation& allocation, std::vector<bool>& allocated) = 0;
+    
+    bool isBudgetExceeded() const; 
+    
+    static double getCost(const ShortestPathTable& paths, const int from, const int to);
+    
+protected:
+    
+    std::chrono::steady_clock::time_point start_time_; 
+    double time_budget_; 
+};
+
+
+///	\class SequentialSingleItemTaskAllocator
+///	\author Luigi Freda 
+///	\brief Sequential single-item (SSI) auctions: at each round every robot bids on every unallocated task its cheapest insertion cost 
+///	       into its bundle and the lowest bid wins. Only the bids of the last winner are recomputed at each round. 
+class SequentialSingleItemTaskAllocator: public TaskAllocator
+{
+public: 
+    
+    int getType() const { return kSequentialSingleItem; }
+    
+protected:
+    
+    void solve(const ShortestPathTable& paths, const Problem& problem, Allocation& allocation, std::vector<bool>& allocated);
+};
+
+
+///	\class ParallelTaskAllocator
+///	\author Luigi Freda 
+///	\brief Parallel single-item auctions in a single round: each task goes to the robot with the closest start vertex, then each robot orders 
+///	       its bundle by cheapest insertion. It is the fastest solver (no coordination rounds) and the least accurate one. 
+class ParallelTaskAllocator: public TaskAllocator
+{
+public: 
+    
+    int getType() const { return kParallel; }
+    
+protected:
+    
+    void solve(const ShortestPathTable& paths, const Problem& problem, Allocation& allocation, std::vector<bool>& allocated);
+};
+
+
+///	\class ConsensusBundleTaskAllocator
+///	\author Luigi Freda 
+///	\brief Consensus-based bundle algorithm (CBBA): in the bundle phase each robot greedily adds to its bundle the tasks it can outbid 
+///	       (cheapest insertion cost lower than the current winning bid), in the consensus phase the lowest bid of each task wins and 
+///	       each robot drops its first outbid task together with all the tasks it added after it (their marginal costs are no longer valid). 
+///	       The two phases are iterated until no bundle changes, with the max number of iterations kMaxNumIterationsPerTask x number of tasks. 
+///	       The insertion costs do not have diminishing marginal gains, so a bid is warped to be not lower than the previous bid of the 
+///	       same bundle: this guarantees the convergence (see Johnson et al., "Allowing non-submodular score functions in distributed task allocation", CDC 2012). 
+///	\note  The communication is assumed complete and synchronous, so all the robots share the winning bids after each consensus phase. 
+class ConsensusBundleTaskAllocator: public TaskAllocator
+{
+public: 
+    
+    static const size_t kMaxNumIterationsPerTask; 
+    
+public: 
+    
+    int getType() const { return kConsensusBundle; }
+    
+protected:
+    
+    void solve(const ShortestPathTable& paths, const Problem& problem, Allocation& allocation, std::vector<bool>& allocated);
+};
+
+#endif
@@ -38,6 +38,12 @@
 #include <ctime>
 #include <climits>
 #include <cmath>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <random>
+#include <vector>
 #include <ros/ros.h>
 
 #include "graph.h"
@@ -48,6 +54,21 @@ uint reward_count = 0;
 
 using namespace std;
 
+// random source of the decision functions: a per-thread generator once seeded by set_decision_random_seed() (batch simulations), 
+// otherwise rand() seeded with the current time (agents)
+static thread_local bool decision_rand_seeded = false; 
+static thread_local std::mt19937 decision_rand_generator; 
+
+void set_decision_random_seed(uint seed){
+  decision_rand_generator.seed(seed);
+  decision_rand_seeded = true;
+}
+
+static int decision_rand(){
+  if(decision_rand_seeded) return (int)(decision_rand_generator() & INT_MAX); /// < EXIT POINT
+  srand ( time(NULL) );
+  return rand();
+}
 
 
 uint random (uint current_vertex, Vertex *vertex_web){
@@ -56,8 +77,7 @@ uint random (uint current_vertex, Vertex *vertex_web){
   uint num_neighs = vertex_web[current_vertex].num_neigh;
   uint next_vertex;
   
-  srand ( time(NULL) );
-  int i = rand() % num_neighs;
+  int i = decision_rand() % num_neighs;
   next_vertex = vertex_web[current_vertex].id_neigh[i];
   
   return next_vertex;
@@ -97,8 +117,7 @@ uint conscientious_reactive (uint current_vertex, Vertex *vertex_web, double *in
     }      
       
     if(hits>0){	//more than one possibility (choose at random)
-      srand ( time(NULL) );
-      i = rand() % (hits+1) + 0; 	//0, ... ,hits
+      i = decision_rand() % (hits+1) + 0; 	//0, ... ,hits
 	
       //printf("rand integer = %d\n", i);
       next_vertex = possibilities [i];		// random vertex with higher idleness
@@ -196,8 +215,7 @@ uint heuristic_conscientious_reactive (uint current_vertex, Vertex *vertex_web,
     
     if(hits>0){	//more than one possibility (choose at random)
       //printf("MORE THAN ONE POSSIBILITY, CHOOSE RANDOMLY\n");
-      srand ( time(NULL) );
-      i = rand() % (hits+1) + 0; 	//0, ... ,hits
+      i = decision_rand() % (hits+1) + 0; 	//0, ... ,hits
 	
       //printf("rand integer = %d\n", i);
       next_vertex = possibilities [i];		// random vertex with higher idleness
@@ -275,8 +293,7 @@ uint greedy_bayesian_strategy (uint current_vertex, Vertex *vertex_web, double *
     }      
       
     if(hits>0){	//more than one possibility (choose at random)
-      srand ( time(NULL) );
-      i = rand() % (hits+1) + 0; 	//0, ... ,hits
+      i = decision_rand() % (hits+1) + 0; 	//0, ... ,hits
 	
       //printf("rand integer = %d\n", i);
       next_vertex = possibilities [i];		// random vertex with higher idleness
@@ -389,8 +406,7 @@ uint state_exchange_bayesian_strategy (uint current_vertex, Vertex *vertex_web,
     }      
       
     if(hits>0){	//more than one possibility (choose at random)
-      srand ( time(NULL) );
-      i = rand() % (hits+1) + 0; 	//0, ... ,hits
+      i = decision_rand() % (hits+1) + 0; 	//0, ... ,hits
 	
       //printf("rand integer = %d\n", i);
       next_vertex = possibilities [i];		// random vertex with higher idleness
@@ -407,109 +423,62 @@ uint state_exchange_bayesian_strategy (uint current_vertex, Vertex *vertex_web,
 
 }
 
-void dijkstra( uint source, uint destination, int *shortest_path, uint &elem_s_path, Vertex *vertex_web, uint dimension){
-  
-  uint i,j,k,x;
-  int id_next_vertex=-1;
+// Binary-heap Dijkstra from source to destination: edge_cost(v,k) is the cost of the edge from v to its k-th neighbor.
+// The shortest path is rebuilt from the predecessors (no path copies per vertex); elem_s_path is 0 if destination cannot be reached. 
+template <typename CostT, typename EdgeCostF>
+static void dijkstra_heap( uint source, uint destination, int *shortest_path, uint &elem_s_path, Vertex *vertex_web, uint dimension, EdgeCostF edge_cost){
   
-  s_path *tab_dijkstra = new s_path[dimension];
+  elem_s_path = 0;
+  if (source >= dimension || destination >= dimension) return;
   
-  //Initialization:
-  for(i=0; i<dimension; i++){
-	
-	tab_dijkstra[i].id = vertex_web[i].id;
-	tab_dijkstra[i].elem_path = 0;
-	tab_dijkstra[i].visit = false;
-	
-	if (vertex_web[i].id == source) {
-	  tab_dijkstra[i].dist = 0;
-	  tab_dijkstra[i].path[0] = source;
-	  tab_dijkstra[i].elem_path++;
-	  id_next_vertex = i;
-	}else{
-	  tab_dijkstra[i].dist = INT_MAX;
-	}
-
-  }  
+  typedef std::pair<CostT, uint> HeapEntry;
+  std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry> > heap;
+  std::vector<CostT> dist(dimension, std::numeric_limits<CostT>::max());
+  std::vector<int> previous(dimension, -1);
+  std::vector<bool> visit(dimension, false);
   
-  int next_vertex = source;
-  int minim_dist;
-  bool cont;
+  dist[source] = 0;
+  heap.push(HeapEntry(0, source));
   
-  while(true){	
+  while(!heap.empty()){
 	
-//	printf("next_vertex = %i\n", next_vertex);
+	const uint next_vertex = heap.top().second;
+	heap.pop();
+	
+	if(visit[next_vertex]) continue; // stale entry 
+	visit[next_vertex] = true;
 	
 	if(next_vertex == destination){
 	 break; 
 	}
 	
-	tab_dijkstra[id_next_vertex].visit = true;
-	
-	/* id_next_vertex has INDEX of next_vertex in tab_dijkstra */
-	/* j has INDEX of the neighbor in tab_disjkstra */
-	/* k has index of the neighbor in the neighbor table of next_vertex */
-	
-	//Go to neihgobors;	
-	for(k=0; k<vertex_web[next_vertex].num_neigh; k++){
-	  
-		cont = false;
-		
-		//condition - cannot have been visited:
-		for(j=0; j<dimension; j++){
-		  if(tab_dijkstra[j].id == vertex_web[next_vertex].id_neigh[k] && tab_dijkstra[j].visit == false){
-			cont = true;
-			break;
-		  }		  
-		}
-		
-		if(cont){
-		  
-		  //calculate distance from this neighbor:
-		  if( tab_dijkstra[id_next_vertex].dist + vertex_web[next_vertex].cost[k] < tab_dijkstra[j].dist){
-			
-			//update distance to this vertex:
-			tab_dijkstra[j].dist = tab_dijkstra[id_next_vertex].dist + vertex_web[next_vertex].cost[k];
-			
-			//update path (previous path + this one):
-			for (x=0; x<tab_dijkstra[id_next_vertex].elem_path; x++){			 
-			  tab_dijkstra[j].path[x] = tab_dijkstra[id_next_vertex].path[x];			  
-			}
-			
-			tab_dijkstra[j].path[tab_dijkstra[id_next_vertex].elem_path] = tab_dijkstra[j].id;
-			tab_dijkstra[j].elem_path = tab_dijkstra[id_next_vertex].elem_path+1;
-
-		  }	
-		  
-		}
-		
-
- 
-	}
-	
-	minim_dist = INT_MAX;
-	
-	//decide next_vertex:
-	for(i=0; i<dimension; i++){	  
-	  
-	  if(tab_dijkstra[i].dist < minim_dist && tab_dijkstra[i].visit == false){
-		minim_dist = tab_dijkstra[i].dist;
-		next_vertex = tab_dijkstra[i].id;
-		id_next_vertex = i;
-	  }	 
+	//Go to neighbors:
+	for(uint k=0; k<vertex_web[next_vertex].num_neigh; k++){
+	  const uint j = vertex_web[next_vertex].id_neigh[k];
+	  if(j >= dimension || visit[j]) continue;
 	  
+	  const CostT d = dist[next_vertex] + edge_cost(next_vertex, k);
+	  if(d < dist[j]){
+		dist[j] = d;
+		previous[j] = next_vertex;
+		heap.push(HeapEntry(d, j));
+	  }
 	}
-	
   }
   
-  //Save shortest_path & delete tab_dijkstra... 
-  elem_s_path = tab_dijkstra[id_next_vertex].elem_path; //id_next_vertex has the ID of the destination in tab_dijkstra
-
-  for(i=0; i<elem_s_path; i++){	
-	shortest_path[i] = tab_dijkstra[id_next_vertex].path[i];	
+  if(!visit[destination]) return; // not reachable
+  
+  //Save shortest_path (from source to destination):
+  for(int v = destination; v >= 0; v = previous[v]){
+	shortest_path[elem_s_path++] = v;
   }
+  std::reverse(shortest_path, shortest_path + elem_s_path);
+}
+
+void dijkstra( uint source, uint destination, int *shortest_path, uint &elem_s_path, Vertex *vertex_web, uint dimension){
   
-  delete [] tab_dijkstra;
+  dijkstra_heap<int>(source, destination, shortest_path, elem_s_path, vertex_web, dimension, 
+					 [vertex_web](uint v, uint k){ return (int)vertex_web[v].cost[k]; });
   
 }
 
@@ -529,107 +498,8 @@ int is_neigh(uint vertex1, uint vertex2, Vertex *vertex_web, uint dimension){
 
 void dijkstra_mcost( uint source, uint destination, int *shortest_path, uint &elem_s_path, Vertex *vertex_web, double new_costs[][8], uint dimension){
   
-  uint i,j,k,x;
-  int id_next_vertex=-1;
-  
-  s_path_mcost *tab_dijkstra = new s_path_mcost[dimension];
-  
-  //Initialization:
-  for(i=0; i<dimension; i++){
-	
-	tab_dijkstra[i].id = vertex_web[i].id;
-	tab_dijkstra[i].elem_path = 0;
-	tab_dijkstra[i].visit = false;
-	
-	if (vertex_web[i].id == source) {
-	  tab_dijkstra[i].dist = 0.0;
-	  tab_dijkstra[i].path[0] = source;
-	  tab_dijkstra[i].elem_path++;
-	  id_next_vertex = i;
-	}else{
-	  tab_dijkstra[i].dist = INFINITY;
-	}
-
-  }  
-  
-  int next_vertex = source;
-  double minim_dist;
-  bool cont;
-  
-  while(true){	
-	
-//	printf("next_vertex = %i\n", next_vertex);
-	
-	if(next_vertex == destination){
-	 break; 
-	}
-	
-	tab_dijkstra[id_next_vertex].visit = true;
-	
-	/* id_next_vertex has INDEX of next_vertex in tab_dijkstra */
-	/* j has INDEX of the neighbor in tab_disjkstra */
-	/* k has index of the neighbor in the neighbor table of next_vertex */
-	
-	//Go to neihgobors;	
-	for(k=0; k<vertex_web[next_vertex].num_neigh; k++){
-	  
-		cont = false;
-		
-		//condition - cannot have been visited:
-		for(j=0; j<dimension; j++){
-		  if(tab_dijkstra[j].id == vertex_web[next_vertex].id_neigh[k] && tab_dijkstra[j].visit == false){
-			cont = true;
-			break;
-		  }		  
-		}
-		
-		if(cont){
-		  
-		  //calculate distance from this neighbor:
-		  if( tab_dijkstra[id_next_vertex].dist + new_costs[next_vertex][k] < tab_dijkstra[j].dist){
-			
-			//update distance to this vertex:
-			tab_dijkstra[j].dist = tab_dijkstra[id_next_vertex].dist + new_costs[next_vertex][k];
-			
-			//update path (previous path + this one):
-			for (x=0; x<tab_dijkstra[id_next_vertex].elem_path; x++){			 
-			  tab_dijkstra[j].path[x] = tab_dijkstra[id_next_vertex].path[x];			  
-			}
-			
-			tab_dijkstra[j].path[tab_dijkstra[id_next_vertex].elem_path] = tab_dijkstra[j].id;
-			tab_dijkstra[j].elem_path = tab_dijkstra[id_next_vertex].elem_path+1;
-
-		  }	
-		  
-		}
-		
-
- 
-	}
-	
-	minim_dist = INFINITY;
-	
-	//decide next_vertex:
-	for(i=0; i<dimension; i++){	  
-	  
-	  if(tab_dijkstra[i].dist < minim_dist && tab_dijkstra[i].visit == false){
-		minim_dist = tab_dijkstra[i].dist;
-		next_vertex = tab_dijkstra[i].id;
-		id_next_vertex = i;
-	  }	 
-	  
-	}
-	
-  }
-  
-  //Save shortest_path & delete tab_dijkstra... 
-  elem_s_path = tab_dijkstra[id_next_vertex].elem_path; //id_next_vertex has the ID of the destination in tab_dijkstra
-
-  for(i=0; i<elem_s_path; i++){	
-	shortest_path[i] = tab_dijkstra[id_next_vertex].path[i];	
-  }
-  
-  delete [] tab_dijkstra;
+  dijkstra_heap<double>(source, destination, shortest_path, elem_s_path, vertex_web, dimension, 
+						[new_costs](uint v, uint k){ return new_costs[v][k]; });
   
 }
 
@@ -789,8 +659,7 @@ uint heuristic_pathfinder_conscientious_cognitive (uint current_vertex, Vertex *
 	
 	if(hits>0){	//more than one possibility (choose at random)
 		//printf("MORE THAN ONE POSSIBILITY, CHOOSE RANDOMLY\n");
-		srand ( time(NULL) );
-		i = rand() % (hits+1) + 0; 	//0, ... ,hits
+		i = decision_rand() % (hits+1) + 0; 	//0, ... ,hits
 			
 		//printf("rand integer = %d\n", i);
 		next_vertex = possibilities [i];		// random vertex with higher idleness
@@ -69,6 +69,9 @@ typedef struct {
 //    return  log(x) * M_LOG2E;
 //}
 
+// make the random choices of the decision functions below reproducible in the calling thread 
+void set_decision_random_seed(uint seed);
+
 uint random (uint current_vertex, Vertex *vertex_web);
 
 uint conscientious_reactive (uint current_vertex, Vertex *vertex_web, double *instantaneous_idleness);
@@ -0,0 +1,568 @@
+/**
+* This file is part of the ROS package patrolling3d_sim which belongs to the framework 3DMR.
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com>
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// Headless batch simulator of the patrolling strategies.
+/// The robots move at constant speed over the edges of a kinematic graph model (travel time = edge length / speed, no planner,
+/// no collisions) and take their decisions at each vertex with the functions of algorithms.cpp, sharing their visits as with an ideal
+/// communication. The idleness statistics are the ones of the monitor.
+/// The DTA_* algorithms allocate all the vertices to the team with a TaskAllocator each time a robot reaches its target (the other robots
+/// start from the vertices they are going to), then the robot goes to the task of its bundle with the highest idleness along the shortest path.
+/// Partition_CR splits the graph into balanced connected regions with a GraphPartitioner (incrementally rebalanced each time a robot reaches
+/// a vertex) and each robot moves to the neighbor of its region with the highest idleness.
+/// All the combinations of algorithms, team sizes and seeds are run in parallel and the results are written to a CSV file (one row per run).
+/// No ROS master is required.
+///
+/// usage: batch_sim <graph file> <algorithms> <team sizes> <num seeds> <duration [s]> <output csv file> [speed [m/s]] [num threads] [allocator time budget [s]]
+///        e.g. batch_sim maps/vrep_crossroad/vrep_crossroad.graph Conscientious_Reactive,SEBS,DTA_SSI,DTA_CBBA 1,2,4 100 3600 results.csv
+///        (the allocator time budget is unlimited by default, so the runs are reproducible)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <climits>
+#include <string>
+#include <vector>
+#include <queue>
+#include <sstream>
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <memory>
+
+#include "graph.h"
+#include "algorithms.h"
+#include "ShortestPathTable.h"
+#include "TaskAllocator.h"
+#include "GraphPartitioner.h"
+
+
+// decision functions of the agents available in the batch simulator
+enum BatchAlgorithm
+{
+    kRandom = 0,
+    kConscientiousReactive,
+    kHeuristicConscientiousReactive,
+    kGBS,
+    kSEBS,
+    kCyclic,
+    kDTASequentialSingleItem,
+    kDTAParallel,
+    kDTAConsensusBundle,
+    kPartitionConscientiousReactive,
+    kNumBatchAlgorithms
+};
+
+static const char* kBatchAlgorithmNames[kNumBatchAlgorithms] = {"Random", "Conscientious_Reactive", "Heuristic_Conscientious_Reactive", "GBS", "SEBS", "Cyclic",
+                                                                "DTA_SSI", "DTA_Parallel", "DTA_CBBA", "Partition_CR"};
+
+// the TaskAllocator type of a DTA algorithm (-1 for the other algorithms)
+static int getAllocatorType(int algorithm)
+{
+    switch (algorithm)
+    {
+    case kDTASequentialSingleItem:
+        return TaskAllocator::kSequentialSingleItem;
+    case kDTAParallel:
+        return TaskAllocator::kParallel;
+    case kDTAConsensusBundle:
+        return TaskAllocator::kConsensusBundle;
+    }
+    return -1;
+}
+
+// parameters of GBS and SEBS (default values of GBS_Agent and SEBS_Agent)
+static const double kG1 = 0.1;
+static const double kG2 = 100.0;
+static const double kEdgeMin = 1.0;
+
+
+struct BatchJob
+{
+    int algorithm;
+    int team_size;
+    uint seed;
+};
+
+struct BatchResult
+{
+    BatchResult():valid(false),complete_patrol(0),worst_avg_idleness(0),avg_graph_idl(0),median_graph_idl(0),stddev_graph_idl(0),
+                  min_idleness(0),gavg(0),gstddev(0),max_idleness(0),interference_cnt(0),tot_visits(0),avg_visits(0),
+                  num_allocations(0),avg_allocation_time(0){}
+
+    bool valid;
+    uint complete_patrol;
+    double worst_avg_idleness, avg_graph_idl, median_graph_idl, stddev_graph_idl;
+    double min_idleness, gavg, gstddev, max_idleness;
+    uint interference_cnt, tot_visits;
+    double avg_visits;
+    uint num_allocations;       // DTA algorithms (allocations) and Partition_CR (partition updates)
+    double avg_allocation_time; // [s]
+};
+
+// a robot arrival at the end of its current edge
+struct ArrivalEvent
+{
+    ArrivalEvent(double timeIn, int robotIn):time(timeIn),robot(robotIn){}
+
+    // the earliest arrival on top (ties broken by robot id to keep the runs reproducible)
+    bool operator<(const ArrivalEvent& other) const { return (time > other.time) || ( (time == other.time) && (robot > other.robot) ); }
+
+    double time;
+    int robot;
+};
+
+
+// travel length of the edge from vertex to its k-th neighbor: the distance between the two vertices (the edge cost if they coincide)
+static double edgeLength(const Vertex* graph, uint vertex, uint k)
+{
+    const Vertex& v1 = graph[vertex];
+    const Vertex& v2 = graph[v1.id_neigh[k]];
+    const double dx = v2.x - v1.x, dy = v2.y - v1.y, dz = v2.z - v1.z;
+    const double length = sqrt(dx*dx + dy*dy + dz*dz);
+    return (length > 0) ? length : (double)v1.cost[k];
+}
+
+static int neighborIndex(const Vertex* graph, uint vertex, uint neighbor)
+{
+    for (uint k = 0; k < graph[vertex].num_neigh; k++)
+    {
+        if (graph[vertex].id_neigh[k] == neighbor) return k; /// < EXIT POINT
+    }
+    return -1;
+}
+
+template <typename T>
+static bool parseList(const std::string& str, std::vector<T>& list)
+{
+    list.clear();
+    std::stringstream ss(str);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        std::stringstream item_ss(item);
+        T value;
+        if (!(item_ss >> value)) return false; /// < EXIT POINT
+        list.push_back(value);
+    }
+    return !list.empty();
+}
+
+static int getAlgorithm(const std::string& name)
+{
+    for (int i = 0; i < kNumBatchAlgorithms; i++)
+    {
+        if (name == kBatchAlgorithmNames[i]) return i; /// < EXIT POINT
+    }
+    return -1;
+}
+
+
+// neighbor of vertex on a shortest path toward target (-1 if target is not reachable)
+static int nextHop(const Vertex* graph, const ShortestPathTable& paths, uint vertex, int target)
+{
+    int next = -1;
+    double min_cost = ShortestPathTable::kInfiniteCost;
+    for (uint k = 0; k < graph[vertex].num_neigh; k++)
+    {
+        const int neighbor = graph[vertex].id_neigh[k];
+        const double cost = graph[vertex].cost[k] + paths.getCost(neighbor, target);
+        if (cost < min_cost)
+        {
+            min_cost = cost;
+            next = neighbor;
+        }
+    }
+    return next;
+}
+
+// simulate one patrolling run and compute the monitor statistics
+static void simulate(const BatchJob& job, const std::vector<Vertex>& graph_in, const std::vector<int>& cyclic_path, const ShortestPathTable& paths,
+                     double duration, double speed, double allocator_time_budget, BatchResult& result)
+{
+    const uint dimension = graph_in.size();
+    if ((job.team_size < 1) || ((uint)job.team_size > dimension)) return; /// < EXIT POINT
+
+    std::vector<Vertex> graph(graph_in); // the decision functions take a non-const graph
+
+    set_decision_random_seed(job.seed);
+    std::mt19937 generator(job.seed);
+
+    // visits and idleness (as in the monitor and PatrolAgent::update_idleness())
+    std::vector<double> last_visit(dimension, 0.), instantaneous_idleness(dimension, 0.);
+    std::vector<int> number_of_visits(dimension, -1); // first visit should not be counted for avg
+    std::vector<double> total_0(dimension, 0.), total_1(dimension, 0.), total_2(dimension, 0.);
+    std::vector<double> avg_idleness(dimension, 0.), stddev_idleness(dimension, 0.);
+    double gT0 = 0., gT1 = 0., gT2 = 0.;
+    double min_idleness = 0., max_idleness = 0.;
+
+    // robots: the edge (from -> to) they are traversing and their arrival time
+    std::vector<int> from(job.team_size), to(job.team_size), path_index(job.team_size, 0);
+    std::vector<double> arrival(job.team_size, 0.);
+    std::vector<int> tab_intention(job.team_size, -1);
+    uint interference_cnt = 0;
+
+    // DTA algorithms: allocator and target vertex of each robot
+    std::unique_ptr<TaskAllocator> allocator(TaskAllocator::create(getAllocatorType(job.algorithm)));
+    std::vector<int> targets(job.team_size, -1);
+    TaskAllocator::Problem problem;
+    problem.time_budget = allocator_time_budget;
+    TaskAllocator::Allocation allocation;
+    double allocation_time = 0.;
+
+    // Partition_CR: region of each vertex
+    GraphPartitioner partitioner;
+    std::vector<int> partition;
+    if (job.algorithm == kPartitionConscientiousReactive) partitioner.setGraph(graph.data(), dimension);
+
+    // distinct random initial vertices
+    std::vector<int> start_vertices(dimension);
+    for (uint i = 0; i < dimension; i++) start_vertices[i] = i;
+    std::shuffle(start_vertices.begin(), start_vertices.end(), generator);
+
+    std::priority_queue<ArrivalEvent> events;
+    for (int r = 0; r < job.team_size; r++)
+    {
+        from[r] = to[r] = start_vertices[r];
+        if (job.algorithm == kCyclic)
+        {
+            // robots start along the cyclic path at their position
+            path_index[r] = std::find(cyclic_path.begin(), cyclic_path.end(), to[r]) - cyclic_path.begin();
+        }
+        events.push(ArrivalEvent(0., r));
+    }
+
+    while (!events.empty())
+    {
+        const ArrivalEvent event = events.top();
+        events.pop();
+        if (event.time > duration) break; /// < BREAK
+
+        const double now = event.time;
+        const int r = event.robot;
+        const int goal = to[r];
+
+        // update stats (as in the monitor)
+        number_of_visits[goal]++;
+        if (number_of_visits[goal] > 0)
+        {
+            const double current_idleness = graph[goal].priority * (now - last_visit[goal]);
+
+            if (current_idleness > max_idleness)
+                max_idleness = current_idleness;
+            if (current_idleness < min_idleness || min_idleness < 0.1)
+                min_idleness = current_idleness;
+
+            // global stats
+            gT0++;
+            gT1 += current_idleness;
+            gT2 += current_idleness * current_idleness;
+
+            // node stats
+            total_0[goal] += 1.0;
+            total_1[goal] += current_idleness;
+            total_2[goal] += current_idleness * current_idleness;
+            avg_idleness[goal] = total_1[goal] / total_0[goal];
+            stddev_idleness[goal] = 1.0 / total_0[goal] * sqrt(std::max(total_0[goal] * total_2[goal] - total_1[goal] * total_1[goal], 0.));
+        }
+        last_visit[goal] = now;
+
+        // decide the next vertex
+        for (uint i = 0; i < dimension; i++)
+        {
+            instantaneous_idleness[i] = graph[i].priority * (now - last_visit[i]);
+        }
+
+        if (graph[goal].num_neigh == 0) continue; /// < CONTINUE (the robot stays on an isolated vertex)
+
+        int next_vertex = -1;
+        switch (job.algorithm)
+        {
+        case kRandom:
+            next_vertex = random(goal, graph.data());
+            break;
+        case kConscientiousReactive:
+            next_vertex = conscientious_reactive(goal, graph.data(), instantaneous_idleness.data());
+            break;
+        case kHeuristicConscientiousReactive:
+            next_vertex = heuristic_conscientious_reactive(goal, graph.data(), instantaneous_idleness.data());
+            break;
+        case kGBS:
+            next_vertex = greedy_bayesian_strategy(goal, graph.data(), instantaneous_idleness.data(), kG1, kG2, kEdgeMin);
+            break;
+        case kSEBS:
+            next_vertex = state_exchange_bayesian_strategy(goal, graph.data(), instantaneous_idleness.data(), tab_intention.data(), job.team_size, kG1, kG2, kEdgeMin);
+            break;
+        case kCyclic:
+            path_index[r] = (path_index[r] + 1) % cyclic_path.size();
+            next_vertex = cyclic_path[path_index[r]];
+            break;
+        case kDTASequentialSingleItem:
+        case kDTAParallel:
+        case kDTAConsensusBundle:
+            if ((targets[r] < 0) || (targets[r] == goal))
+            {
+                // allocate all the other vertices: this robot starts from goal, the others from the vertices they are going to
+                problem.robot_vertices.assign(to.begin(), to.end());
+                problem.robot_vertices[r] = goal;
+                problem.tasks.clear();
+                for (uint i = 0; i < dimension; i++)
+                {
+                    if ((int)i != goal) problem.tasks.push_back(i);
+                }
+                allocator->allocate(paths, problem, allocation);
+                result.num_allocations++;
+                allocation_time += allocation.compute_time;
+
+                // the task of the bundle with the highest idleness (a random neighbor if the bundle is empty)
+                const std::vector<int>& bundle = allocation.bundles[r];
+                targets[r] = bundle.empty() ? graph[goal].id_neigh[generator() % graph[goal].num_neigh] : bundle[0];
+                for (size_t k = 1; k < bundle.size(); k++)
+                {
+                    if (instantaneous_idleness[bundle[k]] > instantaneous_idleness[targets[r]]) targets[r] = bundle[k];
+                }
+            }
+            next_vertex = nextHop(graph.data(), paths, goal, targets[r]);
+            if (next_vertex < 0)
+            {
+                // unreachable target: a random neighbor and a new allocation at the next vertex
+                targets[r] = -1;
+                next_vertex = graph[goal].id_neigh[generator() % graph[goal].num_neigh];
+            }
+            break;
+        case kPartitionConscientiousReactive:
+            // rebalance the regions: this robot is at goal, the others are at the vertices they are going to
+            partitioner.update(to, partition);
+            result.num_allocations++;
+            allocation_time += partitioner.getStats().compute_time;
+
+            // the neighbor of its region with the highest idleness (conscientious reactive if the region is only the robot vertex)
+            for (uint k = 0; k < graph[goal].num_neigh; k++)
+            {
+                const int neighbor = graph[goal].id_neigh[k];
+                if ((partition[neighbor] == r) && ((next_vertex < 0) || (instantaneous_idleness[neighbor] > instantaneous_idleness[next_vertex]))) next_vertex = neighbor;
+            }
+            if (next_vertex < 0) next_vertex = conscientious_reactive(goal, graph.data(), instantaneous_idleness.data());
+            break;
+        }
+
+        const int k = neighborIndex(graph.data(), goal, next_vertex);
+        if (k < 0)
+        {
+            ROS_ERROR_STREAM("batch_sim - " << kBatchAlgorithmNames[job.algorithm] << " selected vertex " << next_vertex << " which is not a neighbor of " << goal);
+            return; /// < EXIT POINT
+        }
+        tab_intention[r] = next_vertex;
+
+        // interference: another robot is traversing the same edge in the opposite direction
+        for (int q = 0; q < job.team_size; q++)
+        {
+            if ((q != r) && (from[q] == next_vertex) && (to[q] == goal) && (arrival[q] > now)) interference_cnt++;
+        }
+
+        from[r] = goal;
+        to[r] = next_vertex;
+        arrival[r] = now + edgeLength(graph.data(), goal, k) / speed;
+        events.push(ArrivalEvent(arrival[r], r));
+    }
+
+    // graph stats (as in the monitor)
+    double T0 = 0.0, T1 = 0.0, T2 = 0.0;
+    result.worst_avg_idleness = 0.;
+    result.complete_patrol = INT_MAX;
+    result.tot_visits = 0;
+    for (uint i = 0; i < dimension; i++)
+    {
+        T0++;
+        T1 += avg_idleness[i];
+        T2 += avg_idleness[i] * avg_idleness[i];
+        if (avg_idleness[i] > result.worst_avg_idleness) result.worst_avg_idleness = avg_idleness[i];
+        result.complete_patrol = std::min(result.complete_patrol, (uint)std::max(number_of_visits[i], 0));
+        result.tot_visits += std::max(number_of_visits[i], 0);
+    }
+    result.avg_graph_idl = T1 / T0;
+    result.stddev_graph_idl = 1.0 / T0 * sqrt(std::max(T0 * T2 - T1 * T1, 0.));
+
+    std::vector<double> sorted_avg_idleness(avg_idleness);
+    std::sort(sorted_avg_idleness.begin(), sorted_avg_idleness.end());
+    const uint middle = dimension / 2;
+    result.median_graph_idl = (dimension % 2 == 0) ? (sorted_avg_idleness[middle - 1] + sorted_avg_idleness[middle]) / 2. : sorted_avg_idleness[middle];
+
+    // global stats
+    result.min_idleness = min_idleness;
+    result.max_idleness = max_idleness;
+    result.gavg = gT1 / std::max(gT0, 1.);
+    result.gstddev = 1.0 / std::max(gT0, 1.) * sqrt(std::max(gT0 * gT2 - gT1 * gT1, 0.));
+
+    result.interference_cnt = interference_cnt;
+    result.avg_visits = (double)result.tot_visits / dimension;
+    result.avg_allocation_time = allocation_time / std::max(result.num_allocations, 1u);
+    result.valid = true;
+}
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 7)
+    {
+        printf("usage: %s <graph file> <algorithms> <team sizes> <num seeds> <duration [s]> <output csv file> [speed [m/s]] [num threads] [allocator time budget [s]]\n", argv[0]);
+        printf("   algorithms: comma-separated list of");
+        for (int i = 0; i < kNumBatchAlgorithms; i++) printf(" %s", kBatchAlgorithmNames[i]);
+        printf("\n   team sizes: comma-separated list, e.g. 1,2,4\n");
+        return -1;
+    }
+
+    const std::string graph_file = argv[1];
+
+    std::vector<std::string> algorithm_names;
+    std::vector<int> team_sizes;
+    if (!parseList(argv[2], algorithm_names) || !parseList(argv[3], team_sizes))
+    {
+        printf("ERROR!!! invalid algorithms or team sizes lists\n");
+        return -1;
+    }
+    const int num_seeds = atoi(argv[4]);
+    const double duration = atof(argv[5]);
+    const std::string output_file = argv[6];
+    const double speed = (argc > 7) ? atof(argv[7]) : 0.5;
+    const int num_threads = (argc > 8) ? atoi(argv[8]) : std::max((int)std::thread::hardware_concurrency(), 1);
+    const double allocator_time_budget = (argc > 9) ? atof(argv[9]) : 0.;
+    if ((num_seeds < 1) || (duration <= 0) || (speed <= 0) || (num_threads < 1))
+    {
+        printf("ERROR!!! num seeds, duration, speed and num threads must be positive\n");
+        return -1;
+    }
+
+    std::vector<int> algorithms;
+    for (size_t i = 0; i < algorithm_names.size(); i++)
+    {
+        const int algorithm = getAlgorithm(algorithm_names[i]);
+        if (algorithm < 0)
+        {
+            printf("ERROR!!! unknown algorithm %s\n", algorithm_names[i].c_str());
+            return -1;
+        }
+        algorithms.push_back(algorithm);
+    }
+
+    // load the graph
+    const uint dimension = GetGraphDimension(graph_file.c_str());
+    if (dimension == 0)
+    {
+        printf("ERROR!!! cannot load graph %s\n", graph_file.c_str());
+        return -1;
+    }
+    std::vector<Vertex> graph(dimension);
+    GetGraphInfo3D(graph.data(), dimension, graph_file.c_str());
+    printf("Loaded graph %s with %u vertices\n", graph_file.c_str(), dimension);
+
+    // the cyclic path depends only on the graph (and cyclic() uses the global rand()): compute it once
+    std::vector<int> cyclic_path;
+    if (std::find(algorithms.begin(), algorithms.end(), (int)kCyclic) != algorithms.end())
+    {
+        std::vector<int> path(8 * dimension);
+        const int path_elements = cyclic(dimension, graph.data(), path.data());
+        // the last vertex closes the cycle
+        if (path_elements > 1) cyclic_path.assign(path.begin(), path.begin() + path_elements - 1);
+        if (cyclic_path.empty())
+        {
+            printf("ERROR!!! cannot compute a cyclic path on %s\n", graph_file.c_str());
+            return -1;
+        }
+    }
+
+    // the shortest paths of the DTA algorithms depend only on the graph: compute them once (the table is shared by the runs)
+    ShortestPathTable paths;
+    for (size_t a = 0; a < algorithms.size(); a++)
+    {
+        if (getAllocatorType(algorithms[a]) >= 0)
+        {
+            paths.update(graph.data(), dimension);
+            break; /// < BREAK
+        }
+    }
+
+    std::vector<BatchJob> jobs;
+    for (size_t a = 0; a < algorithms.size(); a++)
+    {
+        for (size_t t = 0; t < team_sizes.size(); t++)
+        {
+            for (int s = 0; s < num_seeds; s++)
+            {
+                BatchJob job;
+                job.algorithm = algorithms[a];
+                job.team_size = team_sizes[t];
+                job.seed = s;
+                jobs.push_back(job);
+            }
+        }
+    }
+
+    // run the jobs in parallel
+    std::vector<BatchResult> results(jobs.size());
+    std::atomic<size_t> next_job(0);
+    std::mutex print_mutex;
+    std::vector<std::thread> workers;
+    for (int i = 0; i < std::min(num_threads, (int)jobs.size()); i++)
+    {
+        workers.push_back(std::thread([&]()
+        {
+            for (size_t j = next_job++; j < jobs.size(); j = next_job++)
+            {
+                simulate(jobs[j], graph, cyclic_path, paths, duration, speed, allocator_time_budget, results[j]);
+                if ((j + 1) % 100 == 0)
+                {
+                    std::lock_guard<std::mutex> locker(print_mutex);
+                    printf("batch_sim - started %zu/%zu runs\n", j + 1, jobs.size());
+                }
+            }
+        }));
+    }
+    for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+
+    // write results
+    FILE *file = fopen(output_file.c_str(), "w");
+    if (file == NULL)
+    {
+        printf("ERROR!!! cannot open output file %s\n", output_file.c_str());
+        return -1;
+    }
+    fprintf(file, "Algorithm;Team size;Seed;Duration;Complete patrol cycles;Worst avg idleness;Avg idleness;Median idleness;Stddev idleness;"
+                  "Idleness min;Idleness avg;Idleness stddev;Idleness max;Interferences;Visits;Avg visits per node;Allocations;Avg allocation time [ms]\n"); // header
+    size_t num_invalid = 0;
+    for (size_t j = 0; j < jobs.size(); j++)
+    {
+        const BatchResult& r = results[j];
+        if (!r.valid)
+        {
+            num_invalid++;
+            continue; /// < CONTINUE
+        }
+        fprintf(file, "%s;%d;%u;%.1f;%u;%.2f;%.2f;%.2f;%.2f;%.2f;%.2f;%.2f;%.2f;%u;%u;%.2f;%u;%.3f\n", kBatchAlgorithmNames[jobs[j].algorithm], jobs[j].team_size, jobs[j].seed, duration,
+                r.complete_patrol, r.worst_avg_idleness, r.avg_graph_idl, r.median_graph_idl, r.stddev_graph_idl,
+                r.min_idleness, r.gavg, r.gstddev, r.max_idleness, r.interference_cnt, r.tot_visits, r.avg_visits,
+                r.num_allocations, r.avg_allocation_time * 1000.);
+    }
+    fclose(file);
+
+    printf("batch_sim - written %zu runs to %s (%zu invalid runs skipped)\n", jobs.size() - num_invalid, output_file.c_str(), num_invalid);
+    return 0;
+}
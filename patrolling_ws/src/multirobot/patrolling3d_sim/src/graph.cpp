@@ -61,6 +61,7 @@
 #include <ros/ros.h>
 
 #include "graph.h"
+#include "CsrGraph.h"
 
 uint WIDTH_PX;
 uint HEIGHT_PX;
@@ -202,7 +203,7 @@ void GetGraphInfo(Vertex *vertex_web, uint dimension, const char* graph_file)
 
 }
 
-void GetGraphInfo3D(Vertex *vertex_web, uint dimension, const char* graph_file)
+void GetGraphInfo3D(Vertex *vertex_web, uint dimension, const char* graph_file, CsrGraph* csr_graph)
 {
 
     FILE *file;
@@ -217,6 +218,8 @@ void GetGraphInfo3D(Vertex *vertex_web, uint dimension, const char* graph_file)
     {
         ROS_INFO("Graph File Opened. Getting Graph Info.\n");
         //ROS_INFO_STREAM("dimension: " << dimension);
+        
+        if (csr_graph) csr_graph->clear();
 
         uint i, j;
         float temp;
@@ -246,15 +249,35 @@ void GetGraphInfo3D(Vertex *vertex_web, uint dimension, const char* graph_file)
             vertex_web[i].z *= RESOLUTION; //convert to m
             //printf ("Node id: %u z: %f \n",vertex_web[i].id,vertex_web[i].z);
 
-            r = fscanf(file, "%u", &vertex_web[i].num_neigh);
-            //printf ("Node id: %u num of neighborhood: %u \n",vertex_web[i].id,vertex_web[i].num_neigh);
+            uint num_neigh = 0;
+            r = fscanf(file, "%u", &num_neigh);
+            //printf ("Node id: %u num of neighborhood: %u \n",vertex_web[i].id,num_neigh);
+            
+            // the Vertex keeps the first CsrGraph::kMaxVertexNeighbors neighbors, csr_graph all of them
+            vertex_web[i].num_neigh = std::min(num_neigh, CsrGraph::kMaxVertexNeighbors);
+            if (num_neigh > CsrGraph::kMaxVertexNeighbors)
+            {
+                ROS_WARN_STREAM("GetGraphInfo3D() - vertex " << vertex_web[i].id << " has " << num_neigh << " neighbors, the Vertex keeps the first " << CsrGraph::kMaxVertexNeighbors);
+            }
+            if (csr_graph) csr_graph->addVertex(vertex_web[i].id, vertex_web[i].x, vertex_web[i].y, vertex_web[i].z, vertex_web[i].priority);
 
-            for (j = 0; j < vertex_web[i].num_neigh; j++)
+            for (j = 0; j < num_neigh; j++)
             {
-                r = fscanf(file, "%u", &vertex_web[i].id_neigh[j]);
-                r = fscanf(file, "%s", &vertex_web[i].dir[j]);
-                r = fscanf(file, "%u", &vertex_web[i].cost[j]); //could be possibly converted to meters...
-                //printf("\tNode id: %u Neigh Node id = %u, DIR = %s, COST = %u\n",vertex_web[i].id, vertex_web[i].id_neigh[j], vertex_web[i].dir[j], vertex_web[i].cost[j]);
+                uint id_neigh = 0, cost = 0;
+                char dir[32] = {0};
+                r = fscanf(file, "%u", &id_neigh);
+                r = fscanf(file, "%31s", dir);
+                r = fscanf(file, "%u", &cost); //could be possibly converted to meters...
+                //printf("\tNode id: %u Neigh Node id = %u, DIR = %s, COST = %u\n",vertex_web[i].id, id_neigh, dir, cost);
+                
+                if (j < CsrGraph::kMaxVertexNeighbors)
+                {
+                    vertex_web[i].id_neigh[j] = id_neigh;
+                    memset(&(vertex_web[i].dir[j][0]), 0, 3);
+                    strncpy(&(vertex_web[i].dir[j][0]), dir, 2);
+                    vertex_web[i].cost[j] = cost;
+                }
+                if (csr_graph) csr_graph->addEdge(id_neigh, dir, cost, -1.f); // the metric cost is not in the file
             }
             
             //getchar(); 
@@ -280,6 +303,8 @@ void GetGraphInfo3D(Vertex *vertex_web, uint dimension, const char* graph_file)
     //printf ("[v=10], x = %f (meters)\n",vertex_web[10].x); 
 
     fclose(file);
+    
+    if (csr_graph) csr_graph->finalize();
 
 }
 
@@ -393,7 +418,7 @@ char* itoa(int value, char* str, int radix)
     return str;
 }
 
-uint GetGraphFromMsg(Vertex* &vertex_web, uint& dimension, const patrolling_build_graph_msgs::Graph::ConstPtr& msg)
+uint GetGraphFromMsg(Vertex* &vertex_web, uint& dimension, const patrolling_build_graph_msgs::Graph::ConstPtr& msg, CsrGraph* csr_graph)
 {
     std::cout << "GetGraphFromMsg()" << std::endl; 
     
@@ -405,7 +430,7 @@ uint GetGraphFromMsg(Vertex* &vertex_web, uint& dimension, const patrolling_buil
     WIDTH_M  = (float) WIDTH_PX * RESOLUTION;
     HEIGHT_M = (float) HEIGHT_PX * RESOLUTION;
 
-    if (vertex_web) delete vertex_web;
+    if (vertex_web) delete [] vertex_web;
     vertex_web = 0;
     
     //    # general information
@@ -464,57 +489,68 @@ uint GetGraphFromMsg(Vertex* &vertex_web, uint& dimension, const patrolling_buil
     if(dimension == 0) 
     {
         ROS_WARN_STREAM("GetGraphFromMsg() - received zero size graph");
+        if (csr_graph) csr_graph->clear();
         return 0;
     }
     
-    vertex_web = new Vertex[dimension];
+    // the graph is built in CSR form (no limit on the number of neighbors) and then adapted to the Vertex array 
+    CsrGraph local_csr_graph; 
+    CsrGraph& graph = csr_graph ? *csr_graph : local_csr_graph;
+    graph.buildFromMsg(*msg);
+    graph.toVertices(vertex_web, dimension);
+    
+    for (uint i = 0; i < dimension; i++)
+    {
+        std::cout << "vertex id: " << vertex_web[i].id << ", priority: " << vertex_web[i].priority << std::endl;
+    }
+    
+    return dimension; 
+}
 
-    for (int i = 0; i < dimension; i++)
+bool ApplyGraphDelta(patrolling_build_graph_msgs::Graph& graph_msg, const patrolling_build_graph_msgs::GraphDelta& delta)
+{
+    if ( (delta.base_version != graph_msg.version) || (delta.num_nodes != graph_msg.num_nodes) )
     {
-        vertex_web[i].id = msg->node_id[i];
-        std::cout << "vertex id: " <<  msg->node_id[i] << std::endl;         
-        
-        vertex_web[i].priority = msg->node_priority[i];
-        std::cout << "priority: " <<  msg->node_priority[i] << std::endl;         
-        
-        vertex_web[i].x = msg->node_position[i].x;
-        vertex_web[i].y = msg->node_position[i].y;
-        vertex_web[i].z = msg->node_position[i].z;
-        
-        vertex_web[i].num_neigh = std::max(std::min((int)msg->num_neighbours[i],(int)8),0);
-        
-        //std::cout << "id: " << i << " num_neighbours: " << vertex_web[i].num_neigh << std::endl;
-        
-        int index_insertion = 0; 
+        ROS_WARN_STREAM("ApplyGraphDelta() - delta " << delta.base_version << " -> " << delta.version << " (nodes: " << delta.num_nodes << 
+                        ") does not apply to graph " << graph_msg.version << " (nodes: " << graph_msg.num_nodes << ")");
+        return false; /// < EXIT POINT
+    }
+    
+    const uint num_nodes = graph_msg.num_nodes;
+    
+    // check the indices first: the graph is left unchanged if the delta is malformed 
+    for (size_t k = 0; k < delta.node_index.size(); k++)
+    {
+        if (delta.node_index[k] >= num_nodes) return false; /// < EXIT POINT
+    }
+    for (size_t k = 0; k < delta.edge_from.size(); k++)
+    {
+        if ( (delta.edge_from[k] >= num_nodes) || (delta.edge_to[k] >= num_nodes) ) return false; /// < EXIT POINT
+    }
+    
+    for (size_t k = 0; k < delta.node_index.size(); k++)
+    {
+        const uint i = delta.node_index[k];
+        graph_msg.node_priority[i] = delta.node_priority[k];
+        graph_msg.node_position[i] = delta.node_position[k];
+    }
+    
+    for (size_t k = 0; k < delta.edge_from.size(); k++)
+    {
+        const uint i = delta.edge_from[k];
+        const uint j = delta.edge_to[k];
         
-        for (int j = 0; j < dimension; j++)
-        {
-            // row-major order
-            int index = i*dimension + j;
-            if(msg->adjacency_matrix[index] == 1)
-            {
-                vertex_web[i].id_neigh[index_insertion] = msg->node_id[j];
-                //std::cout << "neighbour id: " << vertex_web[i].id_neigh[index_insertion];
-                
-                memset(&(vertex_web[i].dir[index_insertion][0]),0,3);
-                msg->direction_matrix[index].copy(&(vertex_web[i].dir[index_insertion][0]),msg->direction_matrix[index].size());
-                //std::cout << " dir: " << std::string(vertex_web[i].dir[index_insertion]);
-                
-                vertex_web[i].cost[index_insertion]   = (uint)std::min( (double)rint(msg->cost_matrix[index]), (double)std::numeric_limits<uint>::max() );
-                vertex_web[i].cost_m[index_insertion] = msg->cost_matrix[index];
-                
-                vertex_web[i].nav_data[msg->node_id[j]].cost = vertex_web[i].cost_m[index_insertion]; 
-                vertex_web[i].nav_data[msg->node_id[j]].timestamp = ros::Time::now(); 
-                //std::cout << " cost: " << vertex_web[i].cost[index_insertion] << std::endl;
-                
-                index_insertion++;
-            }
-            
-            if (index_insertion == vertex_web[i].num_neigh) break; 
-        }
+        const uint index = i*num_nodes + j; // row-major order
+        if (graph_msg.adjacency_matrix[index] && !delta.edge_exists[k]) graph_msg.num_neighbours[i]--;
+        if (!graph_msg.adjacency_matrix[index] && delta.edge_exists[k]) graph_msg.num_neighbours[i]++;
+        graph_msg.adjacency_matrix[index] = delta.edge_exists[k];
+        graph_msg.direction_matrix[index] = delta.edge_direction[k];
+        graph_msg.cost_matrix[index]      = delta.edge_cost[k];
     }
     
-    return dimension; 
+    graph_msg.header  = delta.header;
+    graph_msg.version = delta.version;
+    return true;
 }
 
 
@@ -69,6 +69,7 @@
 
 #include <ros/ros.h>
 #include <patrolling_build_graph_msgs/Graph.h>
+#include <patrolling_build_graph_msgs/GraphDelta.h>
 
 //File Line of the First Vertex ID to read (Protection) - fscanf() ignores blank lines
 #define FIRST_VID 5
@@ -142,7 +143,10 @@ extern float HEIGHT_M;
 
 uint GetGraphDimension(const char* graph_file);
 
-void GetGraphInfo3D(Vertex *vertex_web, uint dimension, const char* graph_file);
+class CsrGraph;
+
+// if csr_graph is not null, it is filled with the full graph (vertex_web keeps at most CsrGraph::kMaxVertexNeighbors neighbors per vertex)
+void GetGraphInfo3D(Vertex *vertex_web, uint dimension, const char* graph_file, CsrGraph* csr_graph = 0);
 
 void GetGraphInfo(Vertex *vertex_web, uint dimension, const char* graph_file);
 
@@ -152,7 +156,11 @@ uint IdentifyVertex3D(Vertex *vertex_web, uint size, double x, double y, double
 
 uint GetNumberEdges(Vertex *vertex_web, uint dimension);
 
-uint GetGraphFromMsg(Vertex* &vertex_web, uint& dimension, const patrolling_build_graph_msgs::Graph::ConstPtr& msg);
+// if csr_graph is not null, it is filled with the full graph (vertex_web keeps at most CsrGraph::kMaxVertexNeighbors neighbors per vertex)
+uint GetGraphFromMsg(Vertex* &vertex_web, uint& dimension, const patrolling_build_graph_msgs::Graph::ConstPtr& msg, CsrGraph* csr_graph = 0);
+
+// apply the delta to graph_msg (the delta base version must be the graph version); return false if the delta cannot be applied 
+bool ApplyGraphDelta(patrolling_build_graph_msgs::Graph& graph_msg, const patrolling_build_graph_msgs::GraphDelta& delta);
 
 void PrintDynamicGraph(const Vertex* vertex_web, size_t size, double time_zero);
 
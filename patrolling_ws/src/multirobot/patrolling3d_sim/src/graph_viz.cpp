@@ -22,9 +22,12 @@
 
 #include "graph_viz.h"
 
+#include <algorithm>
+
 const double GraphViz::kMaxIdlenessForDrawing  = 100;
 const double GraphViz::kMaxIdlenessRadius = 0.5;
 const double GraphViz::kMarkerTextHeight = 0.15;
+const double GraphViz::kDefaultMarkersMaxRate = 2; // [Hz]
 
 GraphViz::GraphViz(): node_("~")
 {
@@ -37,7 +40,12 @@ GraphViz::GraphViz(): node_("~")
     nodes_topic_pub_ = node_.advertise<visualization_msgs::MarkerArray>(nodes_topic_name_, 10);
     
     edges_topic_name_ = getParam<std::string>(node_, "edges_topic_name", "/edges_markers");
-    edges_topic_pub_ = node_.advertise<visualization_msgs::Marker>(edges_topic_name_, 10);
+    edges_topic_pub_ = node_.advertise<visualization_msgs::Marker>(edges_topic_name_, 10, true); // latched: the edges are published once
+    
+    markers_max_rate_ = getParam<double>(node_, "markers_max_rate", kDefaultMarkersMaxRate);
+    b_nodes_markers_updated_ = false;
+    b_edges_markers_built_ = false;
+    b_edges_markers_updated_ = false;
     
     num_robots_ = getParam<int>(node_, "num_robots", 2);
     global_frame_ = getParam<std::string>(node_, "global_frame", "map");
@@ -70,7 +78,12 @@ GraphViz::GraphViz(std::string& gf, std::string& ntn, int n, std::string& glf, s
     listener_ = new tf::TransformListener();
     
     edges_topic_name_ = getParam<std::string>(node_, "edges_topic_name", "/edges_markers");
-    edges_topic_pub_ = node_.advertise<visualization_msgs::Marker>(edges_topic_name_, 10);
+    edges_topic_pub_ = node_.advertise<visualization_msgs::Marker>(edges_topic_name_, 10, true); // latched: the edges are published once
+    
+    markers_max_rate_ = getParam<double>(node_, "markers_max_rate", kDefaultMarkersMaxRate);
+    b_nodes_markers_updated_ = false;
+    b_edges_markers_built_ = false;
+    b_edges_markers_updated_ = false;
     
     init();
     
@@ -96,7 +109,12 @@ GraphViz::GraphViz(Vertex* vertex_web, int graph_dimension, std::string& ntn, in
     listener_ = new tf::TransformListener();
     
     edges_topic_name_ = getParam<std::string>(node_, "edges_topic_name", "/edges_markers");
-    edges_topic_pub_ = node_.advertise<visualization_msgs::Marker>(edges_topic_name_, 10); 
+    edges_topic_pub_ = node_.advertise<visualization_msgs::Marker>(edges_topic_name_, 10, true); // latched: the edges are published once
+    
+    markers_max_rate_ = getParam<double>(node_, "markers_max_rate", kDefaultMarkersMaxRate);
+    b_nodes_markers_updated_ = false;
+    b_edges_markers_built_ = false;
+    b_edges_markers_updated_ = false;
     
     init(vertex_web,graph_dimension);
 
@@ -392,10 +410,12 @@ void GraphViz::buildPatrollingNodesAsMarkers()
 
 void GraphViz::buildPatrollingEdgesAsMarkers()
 {
-    std::cout << "GraphViz::buildPatrollingEdgesAsMarkers() - start" << std::endl; 
-    
     boost::recursive_mutex::scoped_lock nodes_marker_array_locker(marker_edges_list_mutex_);  
     
+    if(b_edges_markers_built_) return; /// < EXIT POINT (the edges do not change after the graph is loaded)
+    
+    std::cout << "GraphViz::buildPatrollingEdgesAsMarkers() - start" << std::endl; 
+    
     marker_edges_list_.points.clear();
 
     marker_edges_list_.header.frame_id = global_frame_;
@@ -415,8 +435,6 @@ void GraphViz::buildPatrollingEdgesAsMarkers()
     geometry_msgs::Point pointA;
     geometry_msgs::Point pointB;
     
-    std::vector< std::vector<int> > mat_adj = std::vector< std::vector<int> >(graph_dimension_, std::vector<int>(graph_dimension_,0));
-    
     for (int ii = 0; ii < graph_dimension_; ii++)
     {
         pointA.x = vertex3D_web_[ii].x;
@@ -428,86 +446,56 @@ void GraphViz::buildPatrollingEdgesAsMarkers()
         for (int j = 0; j < num_neighbours; j++)
         {
             int id_neighbour = vertex3D_web_[ii].id_neigh[j];
+            
+            // each undirected edge is drawn once: from its lower vertex, or from ii if id_neighbour has not ii as neighbour 
+            if(id_neighbour < ii)
+            {
+                const std::vector<int>& neighbours_of_neighbour = vertex3D_web_[id_neighbour].id_neigh;
+                if(std::find(neighbours_of_neighbour.begin(), neighbours_of_neighbour.end(), ii) != neighbours_of_neighbour.end()) continue; /// < CONTINUE
+            }
+            
             pointB.x = vertex3D_web_[id_neighbour].x;
             pointB.y = vertex3D_web_[id_neighbour].y;
             pointB.z = vertex3D_web_[id_neighbour].z;
             
-            if(mat_adj[ii][id_neighbour] == 0)
-            {
-                marker_edges_list_.points.push_back(pointA);
-                marker_edges_list_.points.push_back(pointB);
-                mat_adj[ii][id_neighbour] = 1;
-                mat_adj[id_neighbour][ii] = 1;
-            }
+            marker_edges_list_.points.push_back(pointA);
+            marker_edges_list_.points.push_back(pointB);
         }
         
     }
     
-    edges_topic_pub_.publish(marker_edges_list_);
+    b_edges_markers_built_ = true;
+    b_edges_markers_updated_ = true;
+    publishPatrollingEdgesAsMarkers();
     
     std::cout << "GraphViz::buildPatrollingEdgesAsMarkers() - end" << std::endl;     
 }
 
 void GraphViz::buildPatrollingNodesAsMarkers(double time, double time_zero)
 {
+    boost::recursive_mutex::scoped_lock nodes_marker_array_locker(nodes_marker_array_mutex_);  
+    
+    if(marker_nodes_.markers.size() != 2*(size_t)graph_dimension_) buildPatrollingNodesAsMarkers();
+    
+    if(!isNodesMarkersPublishingDue()) return; /// < EXIT POINT
+    
+    const ros::Time stamp = ros::Time::now();
 
-    marker_nodes_.markers.clear();
-
-
-    std_msgs::Header header;
-    header.frame_id = global_frame_;
-    header.stamp = ros::Time::now();
-
+    // the markers are updated in place: a sphere and a text for each node 
     for (int i = 0; i < graph_dimension_; i++)
     {
-
-        visualization_msgs::Marker marker;
-        marker.header = header;
-        std::stringstream ss;
-        ss << "patrolling_nodes_" << vertex3D_web_[i].id;
-        marker.ns = ss.str();
-        marker.id = vertex3D_web_[i].id;
-        marker.type = visualization_msgs::Marker::SPHERE;
-        marker.action = visualization_msgs::Marker::ADD;
-        marker.pose.position.x = vertex3D_web_[i].x;
-        marker.pose.position.y = vertex3D_web_[i].y;
-        marker.pose.position.z = vertex3D_web_[i].z;
-        marker.pose.orientation.x = 0.0;
-        marker.pose.orientation.y = 0.0;
-        marker.pose.orientation.z = 0.0;
-        marker.pose.orientation.w = 1.0;
+        visualization_msgs::Marker& marker = marker_nodes_.markers[2*i];
+        marker.header.stamp = stamp;
         
         double normalized_idleness = std::min(vertex3D_web_[i].current_idleness,(double)kMaxIdlenessForDrawing)/kMaxIdlenessForDrawing;
                 
         double idleness_radius = 0.2 + normalized_idleness*kMaxIdlenessRadius;
         
         marker.scale.x = marker.scale.y =  idleness_radius;
-        marker.scale.z = 0.1;
-        marker.color.a = 0.8; // Don't forget to set the alpha!
-        marker.color.r = 1.0;
         marker.color.g = 1.0 - normalized_idleness;
-        marker.color.b = 0.0;
-        
-        //marker.lifetime = ros::Duration();
-        //marker.frame_locked = false;
-        marker_nodes_.markers.push_back(marker);
-
-        visualization_msgs::Marker marker_t;
-        marker_t = marker;
-        std::stringstream ss2;
-        ss2 << "patrolling_nodes_text_" << vertex3D_web_[i].id;
-        marker_t.ns = ss2.str();
-        marker_t.type = visualization_msgs::Marker::TEXT_VIEW_FACING;
-        marker_t.pose.position.x = vertex3D_web_[i].x;
-        marker_t.pose.position.y = vertex3D_web_[i].y;
-        marker_t.pose.position.z = vertex3D_web_[i].z + 0.5;
-        marker_t.color.r = 1.0;
-        marker_t.color.g = 1.0;
-        marker_t.color.b = 1.0;
-        marker_t.scale.x = 1;
-        marker_t.scale.y = 1;
-        marker_t.scale.z = kMarkerTextHeight;
 
+        visualization_msgs::Marker& marker_t = marker_nodes_.markers[2*i+1];
+        marker_t.header.stamp = stamp;
 
         std::stringstream sss;
         sss.precision(2);
@@ -520,38 +508,47 @@ void GraphViz::buildPatrollingNodesAsMarkers(double time, double time_zero)
         {
             sss << "\tID = " << vertex3D_web_[i].id_neigh[j] << " DIR = " << vertex3D_web_[i].dir[j] << " COST = " << vertex3D_web_[i].cost[j] << "\n";
         }
-        //double tt =  header.stamp.toSec() - time_zero.toSec();
         double tt = time - time_zero;
         sss << "Current Time: " << tt << " sec." << "\n";
 #endif
-        //sss << "Num of visits: " << vertex_web[i].number_of_visits << "\n";
         sss << "#visits: " << vertex3D_web_[i].number_of_visits << "\n";
-        //sss << "Current Idleness: " << vertex_web[i].current_idleness << "\n";
         sss << "idleness: " << vertex3D_web_[i].current_idleness << "\n";
         sss << "priority: " << vertex3D_web_[i].priority << "\n";                
 #if 0
         sss << "Last Visit: " << vertex3D_web_[i].last_visit << "\n";
 #endif
         marker_t.text = sss.str();
-
-        marker_nodes_.markers.push_back(marker_t);
-        
     }
     
+    b_nodes_markers_updated_ = true;
 }
 
-void GraphViz::publishPatrollingNodesAsMarkers()
+bool GraphViz::isNodesMarkersPublishingDue() const
 {
+    if(nodes_topic_pub_.getNumSubscribers() == 0) return false; /// < EXIT POINT
+    if(markers_max_rate_ <= 0 || last_nodes_markers_publish_time_.isZero()) return true; /// < EXIT POINT
+    return (ros::Time::now() - last_nodes_markers_publish_time_).toSec() >= 1./markers_max_rate_;
+}
 
+void GraphViz::publishPatrollingNodesAsMarkers()
+{
+    boost::recursive_mutex::scoped_lock nodes_marker_array_locker(nodes_marker_array_mutex_);  
+    
+    if(!b_nodes_markers_updated_) return; /// < EXIT POINT
+    
     nodes_topic_pub_.publish(marker_nodes_);
-    //nodes.markers.clear();
-    //buildPatrollingNodesAsMarkers(); // In order to refresh the current time of each node
+    last_nodes_markers_publish_time_ = ros::Time::now();
+    b_nodes_markers_updated_ = false;
 }
 
 void GraphViz::publishPatrollingEdgesAsMarkers()
 {
-
+    boost::recursive_mutex::scoped_lock nodes_marker_array_locker(marker_edges_list_mutex_);  
+    
+    if(!b_edges_markers_updated_) return; /// < EXIT POINT
+    
     edges_topic_pub_.publish(marker_edges_list_);
+    b_edges_markers_updated_ = false;
 }
 
 void GraphViz::getRobotPoses()
@@ -151,7 +151,9 @@ public:
 ///	\class VertexViz3D
 ///	\author Luigi Freda (2016-present) and Mario Gianni (2016)
 ///	\brief A class for visualizing a patrolling graph 
-///	\note
+///	\note The node markers are built once and then only their idleness size/color and text are updated in place, at most at the rate 
+///       "markers_max_rate" [Hz] (0 = unlimited) and only when the nodes topic has subscribers. The edges LINE_LIST is built once and 
+///       published on a latched topic.
 /// 	\todo 
 ///	\date
 ///	\warning
@@ -161,6 +163,7 @@ class GraphViz
     static const double kMaxIdlenessForDrawing;
     static const double kMaxIdlenessRadius; 
     static const double kMarkerTextHeight; 
+    static const double kDefaultMarkersMaxRate; // [Hz]
     
 public:
 
@@ -179,19 +182,33 @@ public:
     visualization_msgs::Marker marker_edges_list_;
     boost::recursive_mutex marker_edges_list_mutex_;
 
+    // build the node markers (a sphere and a text for each node)
     void buildPatrollingNodesAsMarkers();
+    // update in place the node markers with the current idleness (nothing is done if the publication is not due, see isNodesMarkersPublishingDue())
     void buildPatrollingNodesAsMarkers(double, double);
     
+    // build the edges LINE_LIST (only once: the edges do not change after the graph is loaded)
     void buildPatrollingEdgesAsMarkers(); 
     
+    // publish the node markers if they were updated 
     void publishPatrollingNodesAsMarkers();
+    // publish the edges if they were built after the last publication (the topic is latched)
     void publishPatrollingEdgesAsMarkers();
+    
+    // true if the nodes topic has subscribers and the last publication is older than 1/markers_max_rate_ 
+    bool isNodesMarkersPublishingDue() const;
 
     std::string nodes_topic_name_;
     ros::Publisher nodes_topic_pub_;
     
     std::string edges_topic_name_;
     ros::Publisher edges_topic_pub_;
+    
+    double markers_max_rate_; // [Hz] max publishing rate of the node markers (0 = unlimited)
+    ros::Time last_nodes_markers_publish_time_; 
+    bool b_nodes_markers_updated_; // updated and not published yet
+    bool b_edges_markers_built_;   
+    bool b_edges_markers_updated_; // built and not published yet
 
     std::string boundaries_topic_name_;
     ros::Publisher boundaries_topic_pub_;
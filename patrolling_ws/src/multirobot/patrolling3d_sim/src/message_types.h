@@ -81,6 +81,7 @@
 #define VERTEX_COVERED_MSG_TYPE 18     // a vertex is covered: [ID_ROBOT, msg_type, vertex]   
 #define IDLENESS_SYNC_MSG_TYPE 19      // idleness synchronization message:  [ID_ROBOT, msg_type, idleness[1],...,idleness[dimension]] 
 #define NAV_COST_MSG_TYPE 20 // selected and verified a goal from a graph node: [ID_ROBOT, msg_type, vertex1, vertex2, nav_cost] 
+#define BATCH_MSG_TYPE 21        // batch of messages sent by a robot: [ID_ROBOT, msg_type, seq, num_msgs, len_1, msg_1, ..., len_n, msg_n] (see ResultsBatch.h)
 
 // Sub-message types 
 #define SUB_MSG_REALLOCATION (-1000)
@@ -84,6 +84,7 @@ typedef std_msgs::Int16MultiArray Int16MultiArrayMsg;
 #endif
 
 #include <std_msgs/String.h>
+#include <std_msgs/Float32MultiArray.h>
 #include <octomap_msgs/GetOctomap.h>
 #include <octomap/octomap.h>
 #include <octomap_msgs/Octomap.h>
@@ -98,6 +99,9 @@ typedef std_msgs::Int16MultiArray Int16MultiArrayMsg;
 using namespace std;
 
 #include "MovingAverage.h"
+#include "StreamingStats.h"
+#include "MetricsExporter.h"
+#include "ResultsBatch.h"
 
 #include "graph.h"
 #include "graph_viz.h"
@@ -131,6 +135,9 @@ typedef unsigned int uint;
 ros::Subscriber results_sub;
 ros::Subscriber core_results_sub;
 ros::Publisher results_pub; //, screenshot_pub;
+ros::Publisher idleness_stats_pub;
+std::string idleness_stats_topic;
+ResultsBatchSeqTracker results_batch_seq_tracker; // to drop the batches received twice
 
 ros::ServiceClient client;
 ros::Publisher map_pub;
@@ -188,7 +195,19 @@ double worst_avg_idleness, avg_graph_idl, median_graph_idl, stddev_graph_idl, av
 double min_idleness = 0, max_idleness = 0.0;
 double min_idleness_moving = DBL_MAX, max_idleness_moving = 0.0;
 double gavg, gstddev;
-double gT0 = 0.0, gT1 = 0.0, gT2 = 0.0;
+
+// streaming statistics updated in O(1) at each visit 
+WelfordStats global_idleness_stats;          // idleness of all the visits 
+P2Quantile global_idleness_median(0.5);      // median idleness of all the visits 
+P2Quantile global_idleness_p95(0.95);        // 95th percentile idleness of all the visits 
+WelfordStats node_avg_idleness_stats;        // avg idleness of the vertices (one sample for each vertex)
+MinCountTracker visits_min_tracker;          // minimum number of visits of the vertices (complete patrol cycles)
+TDigest global_idleness_digest;              // quantiles of the idleness of all the visits 
+
+// metrics exported as time series 
+RobotCounters robot_counters[NUM_MAX_ROBOTS];
+MetricsExporter metrics_exporter;
+double metrics_flush_period = 10.0;          // (seconds) period of the metrics export, 0 to disable it 
 
 uint interference_cnt = 0;
 uint complete_patrol = 0;
@@ -244,23 +263,12 @@ void set_time_last_goal_reached(int k, double current_absolute_time)
     pthread_mutex_unlock(&lock_last_goal_reached);
 }
 
-void resultsCallback(const Int16MultiArrayMsg::ConstPtr& msg)
+// process the message stored in msg->data[data_begin, data_end) 
+void processResults(const Int16MultiArrayMsg::ConstPtr& msg, size_t data_begin, size_t data_end)
 {
-    ROS_INFO("resultsCB - begin");
-    
     boost::recursive_mutex::scoped_lock locker(statistics_mutex);
 
-    std::vector<signed short>::const_iterator it = msg->data.begin();
-
-    std::vector<int> vresults;
-
-    vresults.clear();
-
-    for (size_t k = 0; k < msg->data.size(); k++)
-    {
-        vresults.push_back(*it);
-        it++;
-    }
+    std::vector<int> vresults(msg->data.begin() + data_begin, msg->data.begin() + data_end);
 
     int id_robot = vresults[0]; // robot sending the message
     int msg_type = vresults[1]; // message type
@@ -272,6 +280,11 @@ void resultsCallback(const Int16MultiArrayMsg::ConstPtr& msg)
         std::cout << "Updating teamsize: " << teamsize << std::endl; 
     }
 
+    if( (id_robot >= 0) && (id_robot < NUM_MAX_ROBOTS) )
+    {
+        robot_counters[id_robot].addMessage();
+    }
+
     std::cout << "Robot " << id_robot << " sent msg of type " << msg_type << std::endl;
     if (msg_type == INITIALIZE_MSG_TYPE)
         std::cout << "INITIALIZE_MSG_TYPE" << std::endl;
@@ -415,6 +428,10 @@ void resultsCallback(const Int16MultiArrayMsg::ConstPtr& msg)
         {
             ROS_INFO("Robot %d sent interference.\n", id_robot);
             interference_cnt++;
+            if( (id_robot >= 0) && (id_robot < NUM_MAX_ROBOTS) )
+            {
+                robot_counters[id_robot].addInterference();
+            }
             ros::spinOnce();
         }
         break;
@@ -430,6 +447,36 @@ void resultsCallback(const Int16MultiArrayMsg::ConstPtr& msg)
     //    g_v->checkCollision();
     //    g_v->publishRobotBoudariesAsMarkers();
 
+}
+
+void resultsCallback(const Int16MultiArrayMsg::ConstPtr& msg)
+{
+    ROS_INFO("resultsCB - begin");
+    
+    boost::recursive_mutex::scoped_lock locker(statistics_mutex);
+    
+    if (msg->data.size() < 2) return; /// < EXIT POINT
+
+    if (ResultsBatch::isBatch(msg->data))
+    {
+        // a batch can be received twice (through /results and /core/results)
+        if (!results_batch_seq_tracker.check(msg->data[0], ResultsBatch::getSeq(msg->data))) return; /// < EXIT POINT
+        
+        std::vector<ResultsBatch::Range> ranges;
+        if (!ResultsBatch::getMessages(msg->data, ranges))
+        {
+            ROS_WARN_STREAM("resultsCB - malformed batch from robot " << msg->data[0]);
+        }
+        for (size_t k = 0; k < ranges.size(); k++)
+        {
+            processResults(msg, ranges[k].first, ranges[k].second);
+        }
+    }
+    else
+    {
+        processResults(msg, 0, msg->data.size());
+    }
+
     ROS_INFO("resultsCB - end");
 }
 
@@ -761,6 +808,51 @@ bool check_dead_robots()
 
 
 // update stats after robot 'id_robot' visits node 'goal'
+// publish the streaming idleness statistics on a compact topic, data layout: 
+// [time, number of idleness samples, min, avg, stddev, max, median, 95th percentile, avg of vertex avg idleness, stddev of vertex avg idleness, complete patrol cycles, interferences]
+void publish_idleness_stats(double current_absolute_time)
+{
+    std_msgs::Float32MultiArray msg;
+    msg.data.reserve(12);
+    msg.data.push_back(current_absolute_time - time_zero);
+    msg.data.push_back(global_idleness_stats.getCount());
+    msg.data.push_back(global_idleness_stats.getMin());
+    msg.data.push_back(global_idleness_stats.getMean());
+    msg.data.push_back(global_idleness_stats.getStdDev());
+    msg.data.push_back(global_idleness_stats.getMax());
+    msg.data.push_back(global_idleness_median.getValue());
+    msg.data.push_back(global_idleness_p95.getValue());
+    msg.data.push_back(node_avg_idleness_stats.getMean());
+    msg.data.push_back(node_avg_idleness_stats.getStdDev());
+    msg.data.push_back(complete_patrol);
+    msg.data.push_back(interference_cnt);
+    idleness_stats_pub.publish(msg);
+}
+
+// write the streaming statistics and the robot counters with the metrics exporter (no scan of the vertices)
+void write_metrics(double current_absolute_time)
+{
+    MetricsSnapshot snapshot;
+    {
+    boost::recursive_mutex::scoped_lock locker(statistics_mutex);
+    snapshot.time            = current_absolute_time - time_zero;
+    snapshot.idleness_count  = global_idleness_stats.getCount();
+    snapshot.idleness_min    = global_idleness_stats.getMin();
+    snapshot.idleness_avg    = global_idleness_stats.getMean();
+    snapshot.idleness_stddev = global_idleness_stats.getStdDev();
+    snapshot.idleness_max    = global_idleness_stats.getMax();
+    snapshot.idleness_sum    = global_idleness_stats.getMean() * global_idleness_stats.getCount();
+    for (int i = 0; i < MetricsSnapshot::kNumQuantiles; i++)
+    {
+        snapshot.idleness_quantiles[i] = global_idleness_digest.getQuantile(MetricsSnapshot::getQuantileLevel(i));
+    }
+    snapshot.complete_patrol = complete_patrol;
+    snapshot.interferences   = interference_cnt;
+    }
+    // the robot counters are read without locking 
+    metrics_exporter.write(snapshot, robot_counters, std::min(teamsize, (uint) NUM_MAX_ROBOTS));
+}
+
 void update_stats(int id_robot, int goal)
 {
     boost::recursive_mutex::scoped_lock locker(statistics_mutex);
@@ -781,6 +873,11 @@ void update_stats(int id_robot, int goal)
     printf("Robot %d reached/visited goal %d (current time: %.2f, alg: %s, nav: %s)\n", id_robot, goal, current_absolute_time, algorithm.c_str(), nav_mod.c_str());
 
     number_of_visits [goal]++;
+    visits_min_tracker.increment(number_of_visits [goal] - 1);
+    if( (id_robot >= 0) && (id_robot < NUM_MAX_ROBOTS) )
+    {
+        robot_counters[id_robot].addVisit();
+    }
 
     set_time_last_goal_reached(id_robot, current_absolute_time);
 
@@ -807,15 +904,18 @@ void update_stats(int id_robot, int goal)
             min_idleness = current_idleness [goal];
 
         // global stats
-        gT0++;
-        gT1 += current_idleness[goal];
-        gT2 += current_idleness[goal] * current_idleness[goal];
+        global_idleness_stats.add(current_idleness[goal]);
+        global_idleness_median.add(current_idleness[goal]);
+        global_idleness_p95.add(current_idleness[goal]);
+        global_idleness_digest.add(current_idleness[goal]);
 
         // node stats
+        const double old_avg_idleness = avg_idleness [goal];
         total_0 [goal] += 1.0;
         total_1 [goal] += current_idleness [goal];
         total_2 [goal] += current_idleness [goal] * current_idleness [goal];
         avg_idleness [goal] = total_1[goal] / total_0[goal];
+        node_avg_idleness_stats.replace(old_avg_idleness, avg_idleness [goal]);
         stddev_idleness[goal] = 1.0 / total_0[goal] * sqrt(total_0[goal] * total_2[goal] - total_1[goal] * total_1[goal]);
 
         printf(" idl current = %.2f, ", current_idleness[goal]);
@@ -838,7 +938,7 @@ void update_stats(int id_robot, int goal)
 
     }
 
-    complete_patrol = calculate_patrol_cycle(number_of_visits, graph_dimension_);
+    complete_patrol = (visits_min_tracker.getMin() < 0) ? INT_MAX : visits_min_tracker.getMin(); // as calculate_patrol_cycle() without scanning the vertices 
     printf("   complete patrol cycles = %d\n", complete_patrol);
 
     // Compute node with highest current idleness
@@ -873,6 +973,8 @@ void update_stats(int id_robot, int goal)
     graph_viz->setNumRobots(teamsize);
     }
 
+    publish_idleness_stats(current_absolute_time);
+
     ROS_INFO("  update_stats - end");
 
 }
@@ -910,8 +1012,6 @@ void update_idleness(double current_absolute_time)
     {
         current_idleness[i] = graph_[i].priority * (new_relative_time_last_visit - relative_time_last_visit[i]);
         
-        std::cout << " update_idleness() : idleness [" << i << "] " << current_idleness[i] << std::endl; 
-                 
         if (current_idleness [i] > max_idleness_moving)
         {
             max_idleness_moving = current_idleness [i];
@@ -923,9 +1023,6 @@ void update_idleness(double current_absolute_time)
         }
        
         current_avg_graph_idleness += node_idleness_moving_avg[i].GetAverage(current_idleness[i]); 
-        
-        std::cout << " update_idleness() : min " << min_idleness_moving << std::endl; 
-        std::cout << " update_idleness() : max " << max_idleness_moving << std::endl;  
     }
     
     current_avg_graph_idleness = current_avg_graph_idleness/std::max(graph_dimension_,(uint)1);
@@ -1058,6 +1155,21 @@ void initVisitsAndIdleness()
         stddev_idleness[i] = 0.0;
         
     }
+    
+    global_idleness_stats.reset();
+    global_idleness_median.reset();
+    global_idleness_p95.reset();
+    global_idleness_digest.reset();
+    node_avg_idleness_stats.reset();
+    for (size_t i = 0; i < graph_dimension_; i++)
+    {
+        node_avg_idleness_stats.add(avg_idleness[i]);
+    }
+    visits_min_tracker.reset(number_of_visits, graph_dimension_);
+    for (size_t k = 0; k < NUM_MAX_ROBOTS; k++)
+    {
+        robot_counters[k].reset();
+    }
 }
 
 
@@ -1311,6 +1423,14 @@ int main(int argc, char** argv)
     fprintf(resultstimecsvfile, "Time;Idleness min;Idleness avg;Idleness stddev;Idleness max;Interferences\n"); // header
     fprintf(moving_avg_time_results_file, "Time;Idleness min;Idleness avg;Idleness stddev;Idleness max;Interferences\n"); // header
 
+    metrics_flush_period    = getParam<double>(n_, "metrics_flush_period", metrics_flush_period);
+    bool b_metrics_csv        = getParam<bool>(n_, "metrics_csv", true);
+    bool b_metrics_prometheus = getParam<bool>(n_, "metrics_prometheus", true);
+    if ( (metrics_flush_period > 0) && !metrics_exporter.open(expname, b_metrics_csv, b_metrics_prometheus) )
+    {
+        ROS_WARN_STREAM("Cannot open the metrics files " << expname << "_*metrics.csv");
+    }
+
 #if LOG_MONITOR
     char logfilename[80];
     sprintf(logfilename, "monitor_%s.log", strnow);
@@ -1341,6 +1461,9 @@ int main(int argc, char** argv)
 
     //Publicar dados para "results"
     results_pub      = nh.advertise<Int16MultiArrayMsg>("/results", 100);
+    
+    idleness_stats_topic = getParam<std::string>(n_, "idleness_stats_topic", "/patrolling/idleness_stats");
+    idleness_stats_pub   = nh.advertise<std_msgs::Float32MultiArray>(idleness_stats_topic, 10);
         
     bool done = false;
     while (
@@ -1442,8 +1565,21 @@ int main(int argc, char** argv)
     
     /// < main loop ============================================================
     int time_index=1; 
+    double next_metrics_flush_time = 0; 
     while (ros::ok())
     {
+        // periodic export of the metrics: the results callbacks have the priority, the export is postponed (by one period at most) 
+        // when the last loop cycle overran its period 
+        if (!b_initialize && (metrics_flush_period > 0))
+        {
+            double time_now = ros::Time::now().toSec();
+            bool b_overrun = loop_rate.cycleTime() > loop_rate.expectedCycleTime();
+            if ( (time_now >= next_metrics_flush_time) && (!b_overrun || (time_now >= next_metrics_flush_time + metrics_flush_period)) )
+            {
+                write_metrics(time_now);
+                next_metrics_flush_time = time_now + metrics_flush_period;
+            }
+        }
 
         if( time_index++ % kMonitorLoopRate == 0 )
         {
@@ -1501,13 +1637,11 @@ int main(int argc, char** argv)
                     stddev_graph_idl = 0.0;
                     avg_stddev_graph_idl = 0.0;
 
-                    // Compute avg and stddev
-                    double T0 = 0.0, T1 = 0.0, T2 = 0.0, S1 = 0.0;
+                    // Compute worst and avg stddev (avg and stddev are streamed at each visit)
+                    double T0 = 0.0, S1 = 0.0;
                     for (size_t i = 0; i < graph_dimension_; i++)
                     {
                         T0++;
-                        T1 += avg_idleness[i];
-                        T2 += avg_idleness[i] * avg_idleness[i];
                         S1 += stddev_idleness[i];
                         if (avg_idleness[i] > worst_avg_idleness)
                         {
@@ -1515,12 +1649,12 @@ int main(int argc, char** argv)
                         }
                     }
 
-                    avg_graph_idl = T1 / T0;
-                    stddev_graph_idl = 1.0 / T0 * sqrt(T0 * T2 - T1 * T1);
-                    avg_stddev_graph_idl = S1 / T0;
+                    avg_graph_idl = node_avg_idleness_stats.getMean();
+                    stddev_graph_idl = node_avg_idleness_stats.getStdDev();
+                    avg_stddev_graph_idl = S1 / std::max(T0,1.);
                     // global stats
-                    gavg = gT1 / std::max(gT0,1.);
-                    gstddev = 1.0 / std::max(gT0,1.) * sqrt(gT0 * gT2 - gT1 * gT1);
+                    gavg = global_idleness_stats.getMean();
+                    gstddev = global_idleness_stats.getStdDev();
                     
 //                    gavg_moving_avg    = 
 //                    gstddev_moving_avg = 
@@ -1859,6 +1993,12 @@ int main(int argc, char** argv)
     fclose(idlfile);
     fclose(resultstimecsvfile);
 
+    if (!b_initialize && (metrics_flush_period > 0))
+    {
+        write_metrics(current_absolute_time);
+    }
+    metrics_exporter.close();
+
 
 
 
@@ -41,6 +41,8 @@
 
 #include <algorithm>
 #include <cmath>
+#include <map>
+#include <array>
 
 #include <pcl/conversions.h>
 
@@ -49,11 +51,13 @@
 
 #include <patrolling_build_graph_msgs/BuildGraphEvent.h>
 #include <patrolling_build_graph_msgs/Graph.h>
+#include <patrolling_build_graph_msgs/GraphDelta.h>
 #include <patrolling_build_graph_msgs/PatrollingPoints.h>
 #include <patrolling_build_graph_msgs/PriorityPoint.h>
 
 #include <boost/foreach.hpp>
 #include <robot_trajectory_saver_msgs/CheckPath.h>
+#include <robot_trajectory_saver_msgs/CheckPaths.h>
 
 #include "build_graph_utils.h"
 
@@ -123,6 +127,42 @@ public:
     static const double kMaxEdgePitch;
     static const double kHeighEdgeCost; 
     static const double kMaxDistPointPriority;
+    static const double kEdgeCacheResolution; 
+
+    // results of the validation of a candidate edge 
+    enum EdgeCheck
+    {
+        kEdgeCheckNone = 0,
+        kEdgeCheckValid,
+        kEdgeCheckTooSteep,
+        kEdgeCheckGroundIntersection,
+        kEdgeCheckWallIntersection
+    };
+    
+    // results of the path planner on a candidate edge 
+    enum PathCheck
+    {
+        kPathCheckNone = 0,
+        kPathCheckFound,
+        kPathCheckNotFound
+    };
+    
+    // cached validation of a directed candidate edge: it is valid as long as the wall and traversability clouds do not change 
+    struct EdgeCacheEntry
+    {
+        EdgeCacheEntry():wall_pcd_version(-1),traversability_pcd_version(-1),edge_check(kEdgeCheckNone),path_check(kPathCheckNone),path_cost(0.){}
+        
+        int wall_pcd_version;
+        int traversability_pcd_version; 
+        int edge_check; // EdgeCheck
+        int path_check; // PathCheck
+        double path_cost;
+    };
+    
+    // a directed edge is identified by the positions of its endpoints (quantized with kEdgeCacheResolution): 
+    // the edges of the nodes which are not added, moved or removed keep their key across the rebuilds 
+    typedef std::array<int,6> EdgeKey;
+    typedef std::map<EdgeKey, EdgeCacheEntry> EdgeCache;
 
 public: 
     
@@ -132,6 +172,8 @@ public:
     void buildVertexGraph();
     void writeVertexGraphOnFile();
     void publishGraph();
+    // publish the changes of vertex_graph_ with respect to the graph last sent to the robots (a full graph if the number of nodes changed)
+    void publishGraphDelta();
 
     void initMatGraphDataStructures();
     void printAdjacencyMatrix();
@@ -145,6 +187,14 @@ public:
     bool checkEdgeNoGroundIntersection(int i, int j, pcl::PointXYZ& s, pcl::PointXYZ& e);
     bool checkEdgeNoWallIntersection(int node_id, int other_node_id, pcl::PointXYZ& node_pt, pcl::PointXYZ& other_node_pt);
 
+    // find the candidate neighbours of each node (within node_max_dist_neighbours_, sorted by distance) and validate in parallel the candidate edges 
+    // (pitch, ground and wall checks) for all of them: mat_edge_checks[i][j] is the EdgeCheck of the edge from node i to node j 
+    // N.B.: the checks of the edges found in edge_cache_ (with the current cloud versions) are not recomputed 
+    void computeCandidateEdges(std::vector<std::vector<int> >& candidates_idx, std::vector<std::vector<float> >& candidates_squared_dist, utils::MatrixInt& mat_edge_checks);
+    
+    EdgeKey getEdgeKey(const pcl::PointXYZ& s, const pcl::PointXYZ& t) const;
+    bool isEdgeCacheEntryValid(const EdgeCacheEntry& entry) const; 
+
 public:  /// < callbacks 
     
     // callback which is invoked when a new patrolling task is appended 
@@ -158,6 +208,9 @@ public:  /// < callbacks
     
     bool callRobotTrajSaverNodeCheckPathService(nav_msgs::Path&, int, int, int&);
     
+    // batched version of callRobotTrajSaverNodeCheckPathService(): the i-th query is the path from s_node_ids[i] to d_node_ids[i] (one round trip for all of them)
+    bool callRobotTrajSaverNodeCheckPathsService(nav_msgs::Path& pois, const std::vector<int>& s_node_ids, const std::vector<int>& d_node_ids, std::vector<bool>& results, std::vector<int>& path_costs);
+    
     void sendToRobotsCallback(const std_msgs::Bool& msg);
     
     void priorityPointCallback(const patrolling_build_graph_msgs::PriorityPoint::ConstPtr&);
@@ -176,12 +229,16 @@ public:
     boost::recursive_mutex mutex_nodes_pcd_;
     
     pcl::PointCloud<pcl::PointXYZ> *p_wall_pcd_;
+    pcl::KdTreeFLANN<pcl::PointXYZ> *p_kdtree_wall_; // built once per wall cloud update 
     boost::recursive_mutex mutex_wall_pcd_;
     bool b_wall_pcd_ready_;
+    int wall_pcd_version_; // incremented at each wall cloud update 
         
     pcl::PointCloud<pcl::PointXYZ> *p_traversability_pcd_; 
+    pcl::KdTreeFLANN<pcl::PointXYZ> *p_kdtree_traversability_; // built once per traversability cloud update 
     boost::recursive_mutex mutex_traversability_pcd_;
     bool b_traversability_pcd_ready_;
+    int traversability_pcd_version_; // incremented at each traversability cloud update 
     
 public: /// < file management     
 
@@ -217,6 +274,9 @@ public: /// < ROS pubs, subs
 
     std::string traj_robot_saver_check_path_service_name_;
     ros::ServiceClient traj_robot_saver_check_path_service_client_;
+    
+    std::string traj_robot_saver_check_paths_service_name_;
+    ros::ServiceClient traj_robot_saver_check_paths_service_client_;
         
     // publishers 
     std::string edges_marker_topic_;
@@ -228,6 +288,9 @@ public: /// < ROS pubs, subs
     std::string graph_topic_;
     ros::Publisher graph_pub_;
     
+    std::string graph_delta_topic_;
+    ros::Publisher graph_delta_pub_;
+    
     // visualization messages 
     visualization_msgs::Marker marker_lines_list_;
     boost::recursive_mutex mutex_marker_lines_list_;
@@ -238,6 +301,10 @@ public: /// < collision checking
     double ground_collisions_check_radius_;
     double wall_collisions_check_radius_;
     int max_num_line_collisions_;
+    
+    EdgeCache edge_cache_; // validations of the candidate edges of the last build (protected by mutex_mat_graph_)
+    
+    int num_threads_; // threads used for validating the candidate edges (<= 0: all the available ones)
 
 public: /// < graph structures and infos
     
@@ -255,6 +322,10 @@ public: /// < graph structures and infos
     // vertex graph struct  
     std::vector<Vertex3D> vertex_graph_;
     boost::recursive_mutex mutex_vertex_graph_;
+    
+    // graph last sent to the robots (empty if not sent yet) and its version 
+    std::vector<Vertex3D> published_vertex_graph_;
+    uint32_t graph_version_;
 
 private:
 
@@ -20,11 +20,14 @@
 
 #include "patrolling_build_graph/build_graph.h"
 
-const int GraphBuilder::kMaxAllowedBranchingFactor = 8; // must be < 8 given the current graph data structure 
+#include <omp.h>
+
+const int GraphBuilder::kMaxAllowedBranchingFactor = 16; // the agents store the full graph in CSR form (patrolling3d_sim/CsrGraph.h); the agent algorithms using Vertex see at most 8 neighbors 
 const double GraphBuilder::kZOffset = 0.3;
 const double GraphBuilder::kMaxEdgePitch = M_PI/6;
 const double GraphBuilder::kHeighEdgeCost = 1e+10; 
 const double GraphBuilder::kMaxDistPointPriority = 0.2;
+const double GraphBuilder::kEdgeCacheResolution = 0.01; // [m]
 
 
 GraphBuilder::GraphBuilder() : n_("~")
@@ -34,13 +37,18 @@ GraphBuilder::GraphBuilder() : n_("~")
     
     b_wall_pcd_ready_           = false;
     b_traversability_pcd_ready_ = false;
+    wall_pcd_version_           = 0;
+    traversability_pcd_version_ = 0;
     
+    graph_version_ = 0;
 
     p_nodes_pcd_          = new pcl::PointCloud<pcl::PointXYZ>();
     p_nodes_filtered_pcd_ = new pcl::PointCloud<pcl::PointXYZ>();
     p_kdtree_             = new pcl::KdTreeFLANN<pcl::PointXYZ>();
     p_wall_pcd_           = new pcl::PointCloud<pcl::PointXYZ>();
     p_traversability_pcd_ = new pcl::PointCloud<pcl::PointXYZ>();
+    p_kdtree_wall_            = new pcl::KdTreeFLANN<pcl::PointXYZ>();
+    p_kdtree_traversability_  = new pcl::KdTreeFLANN<pcl::PointXYZ>();
 
     num_nodes_ = 0;
 
@@ -48,7 +56,7 @@ GraphBuilder::GraphBuilder() : n_("~")
     nodes_topic_sub_ = node_.subscribe(nodes_topic_name_, 50, &GraphBuilder::nodesCallback, this);
     
     node_branching_factor_ = getParam<int>(n_, "node_branching_factor", 3);
-    // max allowed branchig factor is 8
+    // max allowed branchig factor (see kMaxAllowedBranchingFactor)
     node_branching_factor_ = std::min(node_branching_factor_,GraphBuilder::kMaxAllowedBranchingFactor);
     
     node_max_dist_neighbours_ = getParam<int>(n_, "node_max_dist_neighbours", 5);
@@ -68,6 +76,9 @@ GraphBuilder::GraphBuilder() : n_("~")
     graph_topic_ = getParam<std::string>(n_, "graph_topic", "/patrolling/graph");
     graph_pub_ = node_.advertise<patrolling_build_graph_msgs::Graph>(graph_topic_, 10);
     
+    graph_delta_topic_ = getParam<std::string>(n_, "graph_delta_topic", "/patrolling/graph_delta");
+    graph_delta_pub_ = node_.advertise<patrolling_build_graph_msgs::GraphDelta>(graph_delta_topic_, 10);
+    
     priority_point_topic_ = getParam<std::string>(n_, "priority_point_topic_", "/priority_point");
     priority_point_sub_ = node_.subscribe(priority_point_topic_, 10, &GraphBuilder::priorityPointCallback, this);
     
@@ -77,6 +88,8 @@ GraphBuilder::GraphBuilder() : n_("~")
     wall_collisions_check_radius_    = getParam<double>(n_, "ground_collisions_check_radius", 0.25); 
 
     max_num_line_collisions_ = getParam<int>(n_, "max_num_line_collisions", 1); // 5
+    
+    num_threads_ = getParam<int>(n_, "num_threads", 0); 
 
     filename_ = getParam<std::string>(n_, "filename", "vrep.graph");
 
@@ -100,6 +113,9 @@ GraphBuilder::GraphBuilder() : n_("~")
 
     traj_robot_saver_check_path_service_name_ = getParam<std::string>(n_, "traj_robot_saver_check_path_service_name", "traj_robot_saver_check_path_service");
     traj_robot_saver_check_path_service_client_ = node_.serviceClient<robot_trajectory_saver_msgs::CheckPath>(traj_robot_saver_check_path_service_name_);
+    
+    traj_robot_saver_check_paths_service_name_ = getParam<std::string>(n_, "traj_robot_saver_check_paths_service_name", "traj_robot_saver_check_paths_service");
+    traj_robot_saver_check_paths_service_client_ = node_.serviceClient<robot_trajectory_saver_msgs::CheckPaths>(traj_robot_saver_check_paths_service_name_);
 
     b_interactive_ = getParam<bool>(n_, "interactive", true);
 }
@@ -153,7 +169,13 @@ void GraphBuilder::pcdWallCallback(const sensor_msgs::PointCloud2ConstPtr& cloud
     if (p_wall_pcd_) delete p_wall_pcd_;
     p_wall_pcd_ = new pcl::PointCloud<pcl::PointXYZ>();
     pcl::fromROSMsg(*cloud_in, *p_wall_pcd_);
-    b_wall_pcd_ready_ = true; 
+    
+    // build the kdtree once here: it is shared by all the edge checks 
+    if (p_kdtree_wall_) delete p_kdtree_wall_;
+    p_kdtree_wall_ = new pcl::KdTreeFLANN<pcl::PointXYZ>();
+    b_wall_pcd_ready_ = !p_wall_pcd_->points.empty(); 
+    if (b_wall_pcd_ready_) p_kdtree_wall_->setInputCloud(p_wall_pcd_->makeShared());
+    wall_pcd_version_++; // the cached wall checks are now stale 
 }
 
 void GraphBuilder::pcdTraversabilityCallback(const sensor_msgs::PointCloud2ConstPtr& cloud_in)
@@ -176,9 +198,14 @@ void GraphBuilder::pcdTraversabilityCallback(const sensor_msgs::PointCloud2Const
         q.z = pt.z;
         p_traversability_pcd_->points.push_back(q);
     }
+    delete temp_pcd;
     
-    b_traversability_pcd_ready_ = true; 
-
+    // build the kdtree once here: it is shared by all the edge checks 
+    if (p_kdtree_traversability_) delete p_kdtree_traversability_;
+    p_kdtree_traversability_ = new pcl::KdTreeFLANN<pcl::PointXYZ>();
+    b_traversability_pcd_ready_ = !p_traversability_pcd_->points.empty(); 
+    if (b_traversability_pcd_ready_) p_kdtree_traversability_->setInputCloud(p_traversability_pcd_->makeShared());
+    traversability_pcd_version_++; // the cached ground checks are now stale 
 }
 
 bool GraphBuilder::callRobotTrajSaverNodeCheckPathService(nav_msgs::Path& pois, int s_node_id, int d_node_id, int& path_cost)
@@ -207,6 +234,45 @@ bool GraphBuilder::callRobotTrajSaverNodeCheckPathService(nav_msgs::Path& pois,
     }
 }
 
+bool GraphBuilder::callRobotTrajSaverNodeCheckPathsService(nav_msgs::Path& pois, const std::vector<int>& s_node_ids, const std::vector<int>& d_node_ids, std::vector<bool>& results, std::vector<int>& path_costs)
+{
+    results.assign(s_node_ids.size(), false);
+    path_costs.assign(s_node_ids.size(), 0);
+    
+    if (s_node_ids.size() != d_node_ids.size())
+    {
+        ROS_ERROR("GraphBuilder::callRobotTrajSaverNodeCheckPathsService() - source and destination lists have different sizes");
+        return false;
+    }
+    
+    if (traj_robot_saver_check_paths_service_client_.waitForExistence(ros::Duration(5.0)))
+    {
+        robot_trajectory_saver_msgs::CheckPaths srv;
+        srv.request.point_of_interest = pois;
+        srv.request.source_node_id.assign(s_node_ids.begin(), s_node_ids.end());
+        srv.request.destination_node_id.assign(d_node_ids.begin(), d_node_ids.end());
+        if (traj_robot_saver_check_paths_service_client_.call(srv) && (srv.response.result.size() == s_node_ids.size()))
+        {
+            for (size_t i = 0; i < s_node_ids.size(); i++)
+            {
+                results[i]    = srv.response.result[i];
+                path_costs[i] = srv.response.path_cost[i];
+            }
+            return true;
+        }
+        else
+        {
+            ROS_ERROR("Failed to call batched service provided by robot_trajectory_saver_node");
+            return false;
+        }
+    }
+    else
+    {
+        ROS_ERROR("robot_traj_service check_paths is not UP!!! There is an issue");
+        return false;
+    }
+}
+
 
 void GraphBuilder::initMatGraphDataStructures()
 {
@@ -284,15 +350,6 @@ bool GraphBuilder::checkEdgeMaxPitch(int i, int j, pcl::PointXYZ& s, pcl::PointX
     delta.y = t.y - s.y;
     delta.z = t.z - s.z;
 
-    if (delta.z < 0)
-    {
-        std::cout << "checkEdgeMaxPitch() - NEIGHBORHOOD_ID " << j << " is UNDER CURRENT_NODE_ID " << i << std::endl;
-    }
-    else
-    {
-        std::cout << "checkEdgeMaxPitch() - NEIGHBORHOOD_ID " << j << " is ON_TOP_OF CURRENT_NODE_ID " << i << std::endl;
-    }
-
     double norm = sqrt(pow(delta.x, 2) + pow(delta.y, 2) + pow(delta.z, 2));
 
     pcl::PointXYZ unit_vec;
@@ -302,17 +359,8 @@ bool GraphBuilder::checkEdgeMaxPitch(int i, int j, pcl::PointXYZ& s, pcl::PointX
 
     double pitch = asin(unit_vec.z);
 
-    if ((pitch > -kMaxEdgePitch) && (pitch < kMaxEdgePitch))
-    {
-        std::cout << "checkEdgeMaxPitch() - pitch(CURRENT_NODE_ID, NEIGHBORHOOD_ID) = (" << i << ", " << j << ") = " << pitch << " --> OK " << std::endl;
-        return true;
-
-    }
-    else
-    {
-        std::cout << "Pitch(CURRENT_NODE_ID, NEIGHBORHOOD_ID) = (" << i << ", " << j << ") = " << pitch << " --> TOO STEEP " << std::endl;
-        return false;
-    }
+    // N.B.: no output here, this is called in parallel by computeCandidateEdges()
+    return (pitch > -kMaxEdgePitch) && (pitch < kMaxEdgePitch);
 
 }
 
@@ -332,8 +380,7 @@ bool GraphBuilder::checkEdgeNoGroundIntersection(int i, int j, pcl::PointXYZ& s,
     double z_delta_max = 0.1;
 
     std::vector<int> num_intersections;
-    pcl::KdTreeFLANN<pcl::PointXYZ> *kdtree_collision = new pcl::KdTreeFLANN<pcl::PointXYZ>();
-    kdtree_collision->setInputCloud(p_traversability_pcd_->makeShared());
+    const pcl::KdTreeFLANN<pcl::PointXYZ>& kdtree_collision = *p_kdtree_traversability_;
 
     pcl::PointXYZ d;
     d.x = e.x - s.x;
@@ -375,7 +422,7 @@ bool GraphBuilder::checkEdgeNoGroundIntersection(int i, int j, pcl::PointXYZ& s,
             std::vector<int> pointIdxRadiusSearch;
             std::vector<float> pointRadiusSquaredDistance;
 
-            int neighborhoods = kdtree_collision->radiusSearch(start, ground_collisions_check_radius_, pointIdxRadiusSearch, pointRadiusSquaredDistance);
+            int neighborhoods = kdtree_collision.radiusSearch(start, ground_collisions_check_radius_, pointIdxRadiusSearch, pointRadiusSquaredDistance);
 
             num_intersections.push_back(neighborhoods);
 
@@ -424,15 +471,14 @@ bool GraphBuilder::checkEdgeNoWallIntersection(int node_id, int other_node_id, p
 
     //ROS_INFO("Collision checking test START");
 
-    pcl::KdTreeFLANN<pcl::PointXYZ> *kdtree_collision = new pcl::KdTreeFLANN<pcl::PointXYZ>();
-    kdtree_collision->setInputCloud(p_wall_pcd_->makeShared());
+    const pcl::KdTreeFLANN<pcl::PointXYZ>& kdtree_collision = *p_kdtree_wall_;
 
     while (delta_perc <= 1.0)
     {
         std::vector<int> pointIdxRadiusSearch;
         std::vector<float> pointRadiusSquaredDistance;
 
-        int neighborhoods = kdtree_collision->radiusSearch(t, wall_collisions_check_radius_, pointIdxRadiusSearch, pointRadiusSquaredDistance);
+        int neighborhoods = kdtree_collision.radiusSearch(t, wall_collisions_check_radius_, pointIdxRadiusSearch, pointRadiusSquaredDistance);
 
         num_intersections.push_back(neighborhoods);
 
@@ -448,12 +494,114 @@ bool GraphBuilder::checkEdgeNoWallIntersection(int node_id, int other_node_id, p
 
     int max_num_intersections = compute_max_num_intersections(num_intersections);
 
-    std::cout << "The edge <" << node_id << "," << other_node_id << ">" << " hit " << max_num_intersections << " points belonging to wall pcd" << std::endl;
-    
+    // N.B.: no output here, this is called in parallel by computeCandidateEdges()
     return max_num_intersections <= max_num_line_collisions_;
 }
 
 
+GraphBuilder::EdgeKey GraphBuilder::getEdgeKey(const pcl::PointXYZ& s, const pcl::PointXYZ& t) const
+{
+    EdgeKey key;
+    key[0] = (int)round(s.x/kEdgeCacheResolution);
+    key[1] = (int)round(s.y/kEdgeCacheResolution);
+    key[2] = (int)round(s.z/kEdgeCacheResolution);
+    key[3] = (int)round(t.x/kEdgeCacheResolution);
+    key[4] = (int)round(t.y/kEdgeCacheResolution);
+    key[5] = (int)round(t.z/kEdgeCacheResolution);
+    return key;
+}
+
+bool GraphBuilder::isEdgeCacheEntryValid(const EdgeCacheEntry& entry) const
+{
+    return (entry.edge_check != kEdgeCheckNone) && 
+           (entry.wall_pcd_version == wall_pcd_version_) && 
+           (entry.traversability_pcd_version == traversability_pcd_version_);
+}
+
+void GraphBuilder::computeCandidateEdges(std::vector<std::vector<int> >& candidates_idx, std::vector<std::vector<float> >& candidates_squared_dist, utils::MatrixInt& mat_edge_checks)
+{
+    boost::recursive_mutex::scoped_lock locker_mat(mutex_mat_graph_);
+    boost::recursive_mutex::scoped_lock locker_nodes(mutex_nodes_pcd_);
+    boost::recursive_mutex::scoped_lock locker_wall(mutex_wall_pcd_);
+    boost::recursive_mutex::scoped_lock locker_trav(mutex_traversability_pcd_);
+    
+    candidates_idx.assign(num_nodes_, std::vector<int>());
+    candidates_squared_dist.assign(num_nodes_, std::vector<float>());
+    mat_edge_checks = utils::MatrixInt(num_nodes_, num_nodes_, kEdgeCheckNone);
+    
+    const int num_threads = (num_threads_ > 0) ? num_threads_ : omp_get_max_threads();
+    
+    // N.B.: the kdtrees and edge_cache_ are only read here (their searches are const) and the checks of different edges are independent
+    #pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+    for (int node_id = 0; node_id < num_nodes_; node_id++)
+    {
+        pcl::PointXYZ node_pt = p_nodes_filtered_pcd_->points[node_id];
+        
+        // the candidates are sorted by distance, the first one is the node itself 
+        p_kdtree_->radiusSearch(node_pt, node_max_dist_neighbours_, candidates_idx[node_id], candidates_squared_dist[node_id]);
+        
+        for (size_t l = 1; l < candidates_idx[node_id].size(); l++)
+        {
+            const int other_node_id = candidates_idx[node_id][l];
+            pcl::PointXYZ other_node_pt = p_nodes_filtered_pcd_->points[other_node_id];
+            
+            // the edges which do not touch added, moved or removed nodes are found in the cache 
+            EdgeCache::const_iterator it = edge_cache_.find(getEdgeKey(node_pt, other_node_pt));
+            if ((it != edge_cache_.end()) && isEdgeCacheEntryValid(it->second))
+            {
+                mat_edge_checks[node_id][other_node_id] = it->second.edge_check;
+                continue; /// < CONTINUE
+            }
+            
+            int edge_check = kEdgeCheckValid;
+            if (!checkEdgeMaxPitch(node_id, other_node_id, node_pt, other_node_pt))
+            {
+                edge_check = kEdgeCheckTooSteep;
+            }
+            else if (!checkEdgeNoGroundIntersection(node_id, other_node_id, node_pt, other_node_pt))
+            {
+                edge_check = kEdgeCheckGroundIntersection;
+            }
+            else if (!checkEdgeNoWallIntersection(node_id, other_node_id, node_pt, other_node_pt))
+            {
+                edge_check = kEdgeCheckWallIntersection;
+            }
+            mat_edge_checks[node_id][other_node_id] = edge_check; // each thread writes only the row of its node 
+        }
+    }
+    
+    // keep only the candidate edges of the current nodes (the stale entries are dropped)
+    EdgeCache edge_cache;
+    int num_cached_edges = 0, num_candidate_edges = 0;
+    for (int node_id = 0; node_id < num_nodes_; node_id++)
+    {
+        const pcl::PointXYZ& node_pt = p_nodes_filtered_pcd_->points[node_id];
+        for (size_t l = 1; l < candidates_idx[node_id].size(); l++)
+        {
+            const int other_node_id = candidates_idx[node_id][l];
+            const EdgeKey key = getEdgeKey(node_pt, p_nodes_filtered_pcd_->points[other_node_id]);
+            
+            EdgeCache::const_iterator it = edge_cache_.find(key);
+            if ((it != edge_cache_.end()) && isEdgeCacheEntryValid(it->second))
+            {
+                edge_cache[key] = it->second; // path planner result included 
+                num_cached_edges++;
+            }
+            else
+            {
+                EdgeCacheEntry& entry = edge_cache[key];
+                entry.wall_pcd_version           = wall_pcd_version_;
+                entry.traversability_pcd_version = traversability_pcd_version_;
+                entry.edge_check                 = mat_edge_checks[node_id][other_node_id];
+            }
+            num_candidate_edges++;
+        }
+    }
+    edge_cache_.swap(edge_cache);
+    
+    ROS_INFO("Candidate edges: %d, reused from the previous build: %d", num_candidate_edges, num_cached_edges);
+}
+
 void GraphBuilder::nodesCallback(const patrolling_build_graph_msgs::PatrollingPoints::ConstPtr& nodes_msg) 
 {  
     boost::recursive_mutex::scoped_lock locker_mat(mutex_mat_graph_);
@@ -528,11 +676,14 @@ void GraphBuilder::nodesCallback(const patrolling_build_graph_msgs::PatrollingPo
         marker_lines_list_.points.clear();
 
 
-        std::vector<int> pointIdxNKNSearch(num_nodes_);
-        std::vector<float> pointNKNSquaredDistance(num_nodes_);
-
         p_kdtree_->setInputCloud(p_nodes_filtered_pcd_->makeShared());
 
+        // candidate neighbours and validation of the candidate edges (computed in parallel once for all the nodes)
+        std::vector<std::vector<int> > candidates_idx;
+        std::vector<std::vector<float> > candidates_squared_dist;
+        utils::MatrixInt mat_edge_checks;
+        computeCandidateEdges(candidates_idx, candidates_squared_dist, mat_edge_checks);
+
 
         for (int node_id = 0; node_id < num_nodes_; node_id++)
         {
@@ -542,10 +693,9 @@ void GraphBuilder::nodesCallback(const patrolling_build_graph_msgs::PatrollingPo
             
             pcl::PointXYZ node_pt = p_nodes_filtered_pcd_->points[node_id];
 
-            int num_neighbours = p_kdtree_->nearestKSearch(node_pt, num_nodes_, pointIdxNKNSearch, pointNKNSquaredDistance);
-
-            // remove nodes which are far than node_max_dist_neighbours_
-            remove_far_nodes(pointIdxNKNSearch, pointNKNSquaredDistance, node_max_dist_neighbours_ * node_max_dist_neighbours_);
+            // nodes within node_max_dist_neighbours_ (sorted by distance)
+            const std::vector<int>& pointIdxNKNSearch = candidates_idx[node_id];
+            const std::vector<float>& pointNKNSquaredDistance = candidates_squared_dist[node_id];
             
             int num_potential_neighbours = pointNKNSquaredDistance.size();
             num_potential_neighbours = std::max(std::min(node_branching_factor_, num_potential_neighbours - 1), 0); // -1 since we have to remove the first found neighbor which is the node under analysis itself
@@ -560,9 +710,6 @@ void GraphBuilder::nodesCallback(const patrolling_build_graph_msgs::PatrollingPo
                 std::cout << "\tNode neigh_ID: " << pointIdxNKNSearch[l] << " at distance " << sqrt(pointNKNSquaredDistance[l]) << " from Node ID: " << node_id << "\n";
             }
 
-            boost::recursive_mutex::scoped_lock locker_wall(mutex_wall_pcd_);
-            boost::recursive_mutex::scoped_lock locker_trav(mutex_traversability_pcd_);
-
             int nearest_ksearch_id = 1; // we have to discard point in [0] since it is the same node
 
             bool b_done = false;
@@ -588,106 +735,118 @@ void GraphBuilder::nodesCallback(const patrolling_build_graph_msgs::PatrollingPo
 
                     if (mat_adj_[node_id][pointIdxNKNSearch[nearest_ksearch_id]] == 0)
                     {
+                        const int edge_check = mat_edge_checks[node_id][pointIdxNKNSearch[nearest_ksearch_id]];
+                        
                         /// < check edge pitch 
-                        bool b_edge_pitch_is_ok = checkEdgeMaxPitch(node_id, pointIdxNKNSearch[nearest_ksearch_id], node_pt, p_nodes_filtered_pcd_->points[pointIdxNKNSearch[nearest_ksearch_id]]);
+                        bool b_edge_pitch_is_ok = (edge_check != kEdgeCheckTooSteep);
 
                         if (b_edge_pitch_is_ok)
                         {
                             std::cout << "It does not exist an edge between node id " << node_id << " and " << pointIdxNKNSearch[nearest_ksearch_id] << " let's see if we can add it!!!" << std::endl;
 
                             /// < check ground intersection 
-                            bool b_edge_no_ground_intersections = checkEdgeNoGroundIntersection(node_id, pointIdxNKNSearch[nearest_ksearch_id], node_pt, p_nodes_filtered_pcd_->points[pointIdxNKNSearch[nearest_ksearch_id]]);
+                            bool b_edge_no_ground_intersections = (edge_check != kEdgeCheckGroundIntersection);
 
                             if (b_edge_no_ground_intersections)
                             {
                                 /// < check wall intersection 
-                                bool b_edge_no_wall_intersections = checkEdgeNoWallIntersection(node_id, pointIdxNKNSearch[nearest_ksearch_id], node_pt, p_nodes_filtered_pcd_->points[pointIdxNKNSearch[nearest_ksearch_id]]);
+                                bool b_edge_no_wall_intersections = (edge_check == kEdgeCheckValid);
 
                                 if(b_edge_no_wall_intersections)    
                                 {
-                                    /// < call path planner service to check the cost and traversability of the edge 
+                                    /// < call path planner service to check the cost and traversability of the edge (if not already done with the current clouds)
                                     
-                                    trajectory_control_msgs::PathPlanning srv_msg;
-                                    srv_msg.request.start.header.stamp = ros::Time::now();
-                                    srv_msg.request.start.header.frame_id = "map";
+                                    EdgeCacheEntry& cache_entry = edge_cache_[getEdgeKey(node_pt, p_nodes_filtered_pcd_->points[pointIdxNKNSearch[nearest_ksearch_id]])];
+                                    if (cache_entry.path_check == kPathCheckNone)
+                                    {
+                                        trajectory_control_msgs::PathPlanning srv_msg;
+                                        srv_msg.request.start.header.stamp = ros::Time::now();
+                                        srv_msg.request.start.header.frame_id = "map";
 
-                                    srv_msg.request.goal.header.stamp = srv_msg.request.start.header.stamp;
-                                    srv_msg.request.goal.header.frame_id = srv_msg.request.start.header.frame_id;
+                                        srv_msg.request.goal.header.stamp = srv_msg.request.start.header.stamp;
+                                        srv_msg.request.goal.header.frame_id = srv_msg.request.start.header.frame_id;
 
-                                    srv_msg.request.start.pose.position.x = node_pt.x;
-                                    srv_msg.request.start.pose.position.y = node_pt.y;
-                                    srv_msg.request.start.pose.position.z = node_pt.z;
+                                        srv_msg.request.start.pose.position.x = node_pt.x;
+                                        srv_msg.request.start.pose.position.y = node_pt.y;
+                                        srv_msg.request.start.pose.position.z = node_pt.z;
 
-                                    srv_msg.request.goal.pose.position.x = p_nodes_filtered_pcd_->points[pointIdxNKNSearch[nearest_ksearch_id]].x;
-                                    srv_msg.request.goal.pose.position.y = p_nodes_filtered_pcd_->points[pointIdxNKNSearch[nearest_ksearch_id]].y;
-                                    srv_msg.request.goal.pose.position.z = p_nodes_filtered_pcd_->points[pointIdxNKNSearch[nearest_ksearch_id]].z;
+                                        srv_msg.request.goal.pose.position.x = p_nodes_filtered_pcd_->points[pointIdxNKNSearch[nearest_ksearch_id]].x;
+                                        srv_msg.request.goal.pose.position.y = p_nodes_filtered_pcd_->points[pointIdxNKNSearch[nearest_ksearch_id]].y;
+                                        srv_msg.request.goal.pose.position.z = p_nodes_filtered_pcd_->points[pointIdxNKNSearch[nearest_ksearch_id]].z;
 
-                                    if (path_planner_service_client_.call(srv_msg))
-                                    {
-                                        if (srv_msg.response.success)
+                                        if (path_planner_service_client_.call(srv_msg))
                                         {
-                                            std::cout << "Fill cost matrix by adding to edge <" << node_id << "," << pointIdxNKNSearch[nearest_ksearch_id] << "> cost: " << srv_msg.response.path_cost << std::endl;
-                                            mat_edge_costs_[node_id][pointIdxNKNSearch[nearest_ksearch_id]] = srv_msg.response.path_cost;
-                                            std::cout << "Fill cost matrix by adding to edge <" << pointIdxNKNSearch[nearest_ksearch_id] << "," << node_id << "> cost: " << srv_msg.response.path_cost << std::endl;
-                                            mat_edge_costs_[pointIdxNKNSearch[nearest_ksearch_id]][node_id] = srv_msg.response.path_cost;
-
-                                            std::cout << "Fill adiacency matrix by adding the edge <" << node_id << "," << pointIdxNKNSearch[nearest_ksearch_id] << ">" << std::endl;
-                                            mat_adj_[node_id][pointIdxNKNSearch[nearest_ksearch_id]] = 1;
-                                            std::cout << "Fill adiacency matrix by adding the edge <" << pointIdxNKNSearch[nearest_ksearch_id] << "," << node_id << ">" << std::endl;
-                                            mat_adj_[pointIdxNKNSearch[nearest_ksearch_id]][node_id] = 1;
-
-                                            printAdjacencyMatrix();
-
-                                            geometry_msgs::Point pointA; // Point A of the line
-                                            pointA.x = node_pt.x;
-                                            pointA.y = node_pt.y;
-                                            pointA.z = node_pt.z + kZOffset;
-
-                                            geometry_msgs::Point pointB; // Point B of the line
-                                            pointB.x = p_nodes_filtered_pcd_->points[pointIdxNKNSearch[nearest_ksearch_id]].x;
-                                            pointB.y = p_nodes_filtered_pcd_->points[pointIdxNKNSearch[nearest_ksearch_id]].y;
-                                            pointB.z = p_nodes_filtered_pcd_->points[pointIdxNKNSearch[nearest_ksearch_id]].z + kZOffset;
-
-                                            // FILL GRAPH MARKER LINES
-                                            marker_lines_list_.points.push_back(pointA);
-                                            marker_lines_list_.points.push_back(pointB);
-
-                                            // FILL DIRECTIONS
-                                            geometry_msgs::Point d;
-                                            d.x = pointB.x - pointA.x;
-                                            d.y = pointB.y - pointA.y;
-                                            d.z = pointB.z - pointA.z;
-
-                                            std::cout << "Computing the direction of node " << pointIdxNKNSearch[nearest_ksearch_id] << " with respect to node " << node_id << std::endl;
-                                            double angle = atan2(d.y, d.x);
-                                            std::cout << "atan2(d.y, d.x)=" << angle << "\n";
-                                            double angle02PI = normalize_angle_positive(angle);
-                                            std::cout << "normalize_angle_positive(angle)=" << angle02PI << "\n";
-                                            std::string dir = compute_direction(angle02PI);
-
-                                            //printDirectionsMatrix();
-
-                                            mat_directions_[node_id][pointIdxNKNSearch[nearest_ksearch_id]] = dir;
-                                            mat_directions_[pointIdxNKNSearch[nearest_ksearch_id]][node_id] = compute_inverse_direction(dir);
-
-                                            printDirectionsMatrix();
-
-                                            //std::cout << "\tID = " << pointIdxNKNSearch[j] << " DIR = " << dir << "\n";
-                                            std::cout << "Edge <" << node_id << "," << pointIdxNKNSearch[nearest_ksearch_id] << ">" << "\n";
-                                            std::cout << "Angle " << angle02PI << " Direction " << dir << "\n";
-                                            std::cout << "Edge <" << pointIdxNKNSearch[nearest_ksearch_id] << "," << node_id << ">" << "\n";
-                                            std::cout << "Angle " << normalize_angle_positive(angle02PI + 0.5 * M_PI) << " Direction " << mat_directions_[pointIdxNKNSearch[nearest_ksearch_id]][node_id] << "\n";
-
+                                            cache_entry.path_check = srv_msg.response.success ? kPathCheckFound : kPathCheckNotFound;
+                                            cache_entry.path_cost  = srv_msg.response.path_cost;
                                         }
                                         else
                                         {
-                                            std::cout << "A path between <" << node_id << "," << pointIdxNKNSearch[nearest_ksearch_id] << "> does not exist!" << std::endl;
+                                            std::cout << "Path planner service call FAILURE\n";
                                         }
-
                                     }
                                     else
                                     {
-                                        std::cout << "Path planner service call FAILURE\n";
+                                        std::cout << "Using the cached path planner result of edge <" << node_id << "," << pointIdxNKNSearch[nearest_ksearch_id] << ">" << std::endl;
+                                    }
+
+                                    if (cache_entry.path_check == kPathCheckFound)
+                                    {
+                                        std::cout << "Fill cost matrix by adding to edge <" << node_id << "," << pointIdxNKNSearch[nearest_ksearch_id] << "> cost: " << cache_entry.path_cost << std::endl;
+                                        mat_edge_costs_[node_id][pointIdxNKNSearch[nearest_ksearch_id]] = cache_entry.path_cost;
+                                        std::cout << "Fill cost matrix by adding to edge <" << pointIdxNKNSearch[nearest_ksearch_id] << "," << node_id << "> cost: " << cache_entry.path_cost << std::endl;
+                                        mat_edge_costs_[pointIdxNKNSearch[nearest_ksearch_id]][node_id] = cache_entry.path_cost;
+
+                                        std::cout << "Fill adiacency matrix by adding the edge <" << node_id << "," << pointIdxNKNSearch[nearest_ksearch_id] << ">" << std::endl;
+                                        mat_adj_[node_id][pointIdxNKNSearch[nearest_ksearch_id]] = 1;
+                                        std::cout << "Fill adiacency matrix by adding the edge <" << pointIdxNKNSearch[nearest_ksearch_id] << "," << node_id << ">" << std::endl;
+                                        mat_adj_[pointIdxNKNSearch[nearest_ksearch_id]][node_id] = 1;
+
+                                        printAdjacencyMatrix();
+
+                                        geometry_msgs::Point pointA; // Point A of the line
+                                        pointA.x = node_pt.x;
+                                        pointA.y = node_pt.y;
+                                        pointA.z = node_pt.z + kZOffset;
+
+                                        geometry_msgs::Point pointB; // Point B of the line
+                                        pointB.x = p_nodes_filtered_pcd_->points[pointIdxNKNSearch[nearest_ksearch_id]].x;
+                                        pointB.y = p_nodes_filtered_pcd_->points[pointIdxNKNSearch[nearest_ksearch_id]].y;
+                                        pointB.z = p_nodes_filtered_pcd_->points[pointIdxNKNSearch[nearest_ksearch_id]].z + kZOffset;
+
+                                        // FILL GRAPH MARKER LINES
+                                        marker_lines_list_.points.push_back(pointA);
+                                        marker_lines_list_.points.push_back(pointB);
+
+                                        // FILL DIRECTIONS
+                                        geometry_msgs::Point d;
+                                        d.x = pointB.x - pointA.x;
+                                        d.y = pointB.y - pointA.y;
+                                        d.z = pointB.z - pointA.z;
+
+                                        std::cout << "Computing the direction of node " << pointIdxNKNSearch[nearest_ksearch_id] << " with respect to node " << node_id << std::endl;
+                                        double angle = atan2(d.y, d.x);
+                                        std::cout << "atan2(d.y, d.x)=" << angle << "\n";
+                                        double angle02PI = normalize_angle_positive(angle);
+                                        std::cout << "normalize_angle_positive(angle)=" << angle02PI << "\n";
+                                        std::string dir = compute_direction(angle02PI);
+
+                                        //printDirectionsMatrix();
+
+                                        mat_directions_[node_id][pointIdxNKNSearch[nearest_ksearch_id]] = dir;
+                                        mat_directions_[pointIdxNKNSearch[nearest_ksearch_id]][node_id] = compute_inverse_direction(dir);
+
+                                        printDirectionsMatrix();
+
+                                        //std::cout << "\tID = " << pointIdxNKNSearch[j] << " DIR = " << dir << "\n";
+                                        std::cout << "Edge <" << node_id << "," << pointIdxNKNSearch[nearest_ksearch_id] << ">" << "\n";
+                                        std::cout << "Angle " << angle02PI << " Direction " << dir << "\n";
+                                        std::cout << "Edge <" << pointIdxNKNSearch[nearest_ksearch_id] << "," << node_id << ">" << "\n";
+                                        std::cout << "Angle " << normalize_angle_positive(angle02PI + 0.5 * M_PI) << " Direction " << mat_directions_[pointIdxNKNSearch[nearest_ksearch_id]][node_id] << "\n";
+
+                                    }
+                                    else if (cache_entry.path_check == kPathCheckNotFound)
+                                    {
+                                        std::cout << "A path between <" << node_id << "," << pointIdxNKNSearch[nearest_ksearch_id] << "> does not exist!" << std::endl;
                                     }
 
                                 }
@@ -736,6 +895,9 @@ void GraphBuilder::nodesCallback(const patrolling_build_graph_msgs::PatrollingPo
         //publishBuildGraphEvent();
         
         //publishGraph(); 
+        
+        // the robots already patrolling the previous graph only receive the changes 
+        publishGraphDelta();
     }
 }
 
@@ -847,6 +1009,7 @@ void GraphBuilder::publishGraph()
    
     std::cout << "GraphBuilder::publishGraph(): num nodes " << num_nodes << std::endl; 
     
+    msg.version    = graph_version_ + 1;
     msg.num_nodes  = num_nodes;
     
     msg.node_id.resize(num_nodes);
@@ -933,6 +1096,92 @@ void GraphBuilder::publishGraph()
     
     graph_pub_.publish(msg);
     ROS_INFO_STREAM("GraphBuilder::publishGraph() - published graph");
+    
+    graph_version_ = msg.version;
+    published_vertex_graph_ = vertex_graph_;
+}
+
+void GraphBuilder::publishGraphDelta()
+{
+    boost::recursive_mutex::scoped_lock locker_mat(mutex_mat_graph_);
+    boost::recursive_mutex::scoped_lock locker_vert(mutex_vertex_graph_);
+    
+    if (published_vertex_graph_.empty()) return; /// < EXIT POINT  the graph has not been sent to the robots yet 
+    
+    if (published_vertex_graph_.size() != vertex_graph_.size())
+    {
+        ROS_WARN_STREAM("GraphBuilder::publishGraphDelta() - the number of nodes changed (" << published_vertex_graph_.size() << " -> " << vertex_graph_.size() << "), publishing the full graph");
+        if (!vertex_graph_.empty()) publishGraph();
+        return; /// < EXIT POINT
+    }
+    
+    const int num_nodes = vertex_graph_.size();
+    
+    patrolling_build_graph_msgs::GraphDelta msg;
+    msg.header.stamp = ros::Time::now();
+    msg.base_version = graph_version_;
+    msg.version = graph_version_ + 1;
+    msg.num_nodes = num_nodes;
+    
+    for (int i = 0; i < num_nodes; i++)
+    {
+        const Vertex3D& v_old = published_vertex_graph_[i];
+        const Vertex3D& v     = vertex_graph_[i];
+        
+        if ( (v.priority != v_old.priority) || (v.x != v_old.x) || (v.y != v_old.y) || (v.z != v_old.z) )
+        {
+            geometry_msgs::Point position;
+            position.x = v.x;
+            position.y = v.y;
+            position.z = v.z;
+            msg.node_index.push_back(i);
+            msg.node_priority.push_back(v.priority);
+            msg.node_position.push_back(position);
+        }
+        
+        // N.B.: ids are equal to indices (see buildVertexGraph())
+        std::map<int,int> old_neighbours, neighbours; // { key: neighbour id, value: position in the neighbour lists }
+        for (int k = 0; k < v_old.num_neighbours; k++) old_neighbours[v_old.id_neighbour[k]] = k;
+        for (int k = 0; k < v.num_neighbours; k++) neighbours[v.id_neighbour[k]] = k;
+        
+        // removed edges 
+        for (std::map<int,int>::const_iterator it = old_neighbours.begin(); it != old_neighbours.end(); ++it)
+        {
+            if (neighbours.count(it->first)) continue; /// < CONTINUE
+            msg.edge_from.push_back(i);
+            msg.edge_to.push_back(it->first);
+            msg.edge_exists.push_back(false);
+            msg.edge_direction.push_back("-");
+            msg.edge_cost.push_back(0.);
+        }
+        
+        // added or changed edges 
+        for (std::map<int,int>::const_iterator it = neighbours.begin(); it != neighbours.end(); ++it)
+        {
+            const int k = it->second;
+            std::map<int,int>::const_iterator it_old = old_neighbours.find(it->first);
+            if ( (it_old != old_neighbours.end()) && 
+                 (v_old.dir[it_old->second] == v.dir[k]) && (v_old.cost[it_old->second] == v.cost[k]) ) continue; /// < CONTINUE
+            msg.edge_from.push_back(i);
+            msg.edge_to.push_back(it->first);
+            msg.edge_exists.push_back(true);
+            msg.edge_direction.push_back(v.dir[k]);
+            msg.edge_cost.push_back(v.cost[k]);
+        }
+    }
+    
+    if (msg.node_index.empty() && msg.edge_from.empty())
+    {
+        ROS_INFO_STREAM("GraphBuilder::publishGraphDelta() - the graph did not change");
+        return; /// < EXIT POINT
+    }
+    
+    graph_delta_pub_.publish(msg);
+    ROS_INFO_STREAM("GraphBuilder::publishGraphDelta() - published graph delta " << msg.base_version << " -> " << msg.version << 
+                    " (changed nodes: " << msg.node_index.size() << ", changed edges: " << msg.edge_from.size() << ")");
+    
+    graph_version_ = msg.version;
+    published_vertex_graph_ = vertex_graph_;
 }
 
 
@@ -1002,6 +1251,8 @@ void GraphBuilder::priorityPointCallback(const patrolling_build_graph_msgs::Prio
     {
         vertex_graph_[index_min].priority = msg->priority; 
         ROS_INFO_STREAM("set priority on node: " << msg->id << ", closest point distance: " << dist_min);        
+        
+        publishGraphDelta();
     }
     else
     {
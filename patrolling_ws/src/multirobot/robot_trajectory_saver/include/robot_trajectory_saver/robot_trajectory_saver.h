@@ -24,12 +24,19 @@
 #include <string>
 #include <sstream>
 #include <vector>
+#include <queue>
+#include <unordered_map>
+#include <map>
+#include <algorithm>
+#include <limits>
+#include <stdint.h>
 #include <ros/ros.h>
 #include <tf/transform_listener.h>
 #include <robot_trajectory_saver_msgs/SaveRobotTrajectories.h>
 #include <robot_trajectory_saver_msgs/LoadRobotTrajectories.h>
 #include <robot_trajectory_saver_msgs/GetRobotTrajectories.h>
 #include <robot_trajectory_saver_msgs/CheckPath.h>
+#include <robot_trajectory_saver_msgs/CheckPaths.h>
 
 #include <nav_msgs/Odometry.h> 
 
@@ -55,6 +62,8 @@
 #include <visualization_msgs/Marker.h>
 #include <boost/graph/dijkstra_shortest_paths.hpp>
 
+#include "robot_trajectory_saver/trajectory_index.h"
+
 inline bool exist_file(const std::string& name)
 {
     struct stat buffer;
@@ -85,6 +94,19 @@ struct Point3D
     double z;
 };
 
+/* Edge record of the binary graph file (see RobotTrajectorySaver::writeBinaryGraph()) */
+struct BinaryGraphEdge
+{
+    uint32_t source;
+    uint32_t target;
+    double weight;
+};
+
+/* Header of the binary graph file: magic and format version */
+static const char kBinaryGraphMagic[] = "3DMRTRJG";
+static const size_t kBinaryGraphMagicSize = 8;
+static const uint32_t kBinaryGraphVersion = 1;
+
 typedef adjacency_list < listS, vecS, undirectedS, property<vertex_properties_t, Point3D>, property < edge_weight_t, double > > Graph;
 typedef graph_traits<Graph>::edge_iterator edge_iterator;
 typedef graph_traits<Graph>::vertex_descriptor Vertex;
@@ -208,9 +230,12 @@ public:
     /* Service Callback responsible of saving robot trajectories onto a file */
     bool getRobotTrajectoriesCallback(robot_trajectory_saver_msgs::GetRobotTrajectories::Request& request, robot_trajectory_saver_msgs::GetRobotTrajectories::Response& response);
 
-    /* Service Callback responsible for checking if a path exists (Dijkstra) between two nodes and retrieve the cost (Euclidean distance) */
+    /* Service Callback responsible for checking if a path exists (A*) between two nodes and retrieve the cost (number of path nodes) */
     bool checkPath(robot_trajectory_saver_msgs::CheckPath::Request& request, robot_trajectory_saver_msgs::CheckPath::Response& response);
 
+    /* Service Callback responsible for checking a list of paths at once: the queries are grouped by source and the sources are searched in parallel */
+    bool checkPaths(robot_trajectory_saver_msgs::CheckPaths::Request& request, robot_trajectory_saver_msgs::CheckPaths::Response& response);
+
     /* Spin at fixed rate */
     void ros_spin();
 
@@ -271,6 +296,9 @@ protected:
     /* PARAM Name of both the directory and the file where the trajectories are saved as dot file */
     std::string map_filename;
 
+    /* PARAM If true the trajectories are saved as dot file (for debugging) instead of the binary format */
+    bool save_dot_file;
+
     /* PARAM Name of topic of inso node publishing imu_odom */
     std::string imu_odom_topic;
 
@@ -293,6 +321,9 @@ protected:
     /* PARAM Name of the service to check if a path exists (Dijkstra) between two nodes and retrieve the cost (Euclidean distance) */
     std::string check_path_service_name;
 
+    /* PARAM Name of the service to check a list of paths at once (see check_path_service_name) */
+    std::string check_paths_service_name;
+
     /* Data structure representing a list of robot trajectories */
     std::vector<RobotTrajectory> ugv_trajectories;
 
@@ -302,6 +333,9 @@ protected:
     /* It will be filled with the vertexes of the graph red from file ate the beginning if exists */
     pcl::PointCloud<pcl::PointXYZ> *cloud_in_init_graph;
 
+    /* Downsampled trajectory points (the vertexes of the graph red from file and the robot poses), updated as the poses are appended */
+    TrajectoryVoxelGrid trajectory_voxels;
+
     /* visualization_msgs Trajectory graph */
     visualization_msgs::Marker line_list;
 
@@ -311,6 +345,20 @@ protected:
     /* TF */
     tf::TransformListener tf_;
 
+    /* Search tree of the last A* query from a source: the closed vertices have their shortest path in the predecessor map */
+    struct SearchTree
+    {
+        std::vector<Vertex> predecessors;
+        std::vector<double> distances;
+        std::vector<bool> closed;
+    };
+
+    /* Search trees of the last queries, by source vertex (reset when the trajectory graph changes) */
+    std::unordered_map<Vertex, SearchTree> search_trees;
+
+    /* Scale of the Euclidean A* heuristic, such that it never exceeds the edge weights (computed when the trajectory graph changes) */
+    double heuristic_scale;
+
     /* Publisher of the graph as markers built from robot trajectories */
     ros::Publisher trajectories_marker_pub;
 
@@ -338,6 +386,9 @@ protected:
     /* Ros Service for checking if a path exists (Dijkstra) between two nodes and retrieve the cost (Euclidean distance) */
     ros::ServiceServer check_path;
 
+    /* Ros Service for checking a list of paths at once */
+    ros::ServiceServer check_paths;
+
 private:
 
     /* Private ROS Node Handle for parameters setting */
@@ -358,20 +409,53 @@ private:
     /* Mutex to be used when save robt trajectories service is called */
     pthread_mutex_t lock_robot_trajectories;
 
+    /* Append a global pose to the trajectory of robot i (and its position to trajectory_voxels) */
+    void addGlobalRobotPose(int i, const tf::StampedTransform& robot_pose_map);
+
+    /* Build graph_ptr from the downsampled trajectory points */
+    void buildTrajectoryGraph();
+
     /* Function which initialize the process of graph building */
-    void initialize(double, int, pcl::PointCloud<pcl::PointXYZ>*, pcl::KdTreeFLANN<pcl::PointXYZ>*);
+    void initialize(double, const pcl::PointCloud<pcl::PointXYZ>&, DisjointSets&);
 
     /* Step for connecting connected components in the neighborhood */
-    void linkConnectedComponents(double, double, double, int, pcl::PointCloud<pcl::PointXYZ>*, pcl::KdTreeFLANN<pcl::PointXYZ>*);
+    void linkConnectedComponents(double, double, double, const pcl::PointCloud<pcl::PointXYZ>&, DisjointSets&);
 
     /* Function used for computing a path given the robot trajectories graph and two nodes */
     bool findVertex(int i, Vertex& vertex);
 
-    /* Function which computes the path given the robot trajectories graph and two nodes */
+    /* Function which computes the path given the robot trajectories graph and two nodes (empty if there is no path) */
     void computeShortestPath(int i, int j, std::vector<int>& path);
 
+    /* A* from source which stops once the destinations are closed (Dijkstra with more than one destination); the search tree is kept in tree */
+    void searchShortestPath(Vertex source, const std::vector<Vertex>& destinations, SearchTree& tree) const;
+
+    /* Path from source to destination in the search tree of source; false if destination has not been closed */
+    bool getPath(const SearchTree& tree, Vertex source, Vertex destination, std::vector<int>& path) const;
+
+    /* If node_id is a point of interest (see checkPath()) replace it with its closest node of the graph */
+    void resolvePointOfInterest(const nav_msgs::Path& point_of_interest, int n_nodes, int& node_id, int& n_augmented_path_nodes);
+
+    /* To be called when the trajectory graph changes: drops the cached search trees and updates the heuristic scale */
+    void resetPathCache();
+
+    /* Maximum number of cached search trees */
+    static const size_t kMaxNumSearchTrees = 256;
+
+    /* Read a trajectory graph file, binary or dot (the format is detected from the file header) */
+    bool readGraph(const std::string& file_path, Graph& graph);
+
+    /* Read a binary trajectory graph file */
+    bool readBinaryGraph(const std::string& file_path, Graph& graph);
+
+    /* Read a dot trajectory graph file written by write_graphviz() */
+    bool readDotGraph(const std::string& file_path, Graph& graph);
+
+    /* Write the graph in the binary format: vertex positions and edges are stored as raw arrays */
+    bool writeBinaryGraph(const std::string& file_path, Graph& graph);
+
     /* Find the node of the graph with minimum distance from a poi */
-    void findClosestVertex(int n_point_of_interest, geometry_msgs::Point s, int& i, Point3D& p, double& d);
+    void findClosestVertex(geometry_msgs::Point s, int& i, Point3D& p, double& d);
 
 };
 
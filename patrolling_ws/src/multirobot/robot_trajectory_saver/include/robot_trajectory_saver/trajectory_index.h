@@ -0,0 +1,235 @@
+/**
+* This file is part of the ROS package robot_trajectory_saver which belongs to the framework 3DMR. 
+*
+* Copyright (C) 2016-present Luigi Freda <luigifreda at gmail dot com> and Alcor Lab (La Sapienza University)
+* For more information see <https://github.com/luigifreda/3dmr>
+*
+* 3DMR is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* 3DMR is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with 3DMR. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TRAJECTORY_INDEX_H
+#define TRAJECTORY_INDEX_H
+
+#include <vector>
+#include <unordered_map>
+#include <cmath>
+#include <algorithm>
+#include <stdint.h>
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+
+
+/* Voxel grid of the trajectory points updated as the poses are appended: each voxel keeps the centroid of its points */
+/* (the same points as a pcl::VoxelGrid filter with the same leaf size). The voxel map is also the spatial hash of */
+/* the radius searches over the centroids, since a centroid lies inside its voxel */
+class TrajectoryVoxelGrid
+{
+public:
+
+    TrajectoryVoxelGrid(double leaf_size = 1.) : leaf_size_(leaf_size)
+    {
+    }
+
+    /* Change the leaf size (the voxels are cleared) */
+    void setLeafSize(double leaf_size)
+    {
+        leaf_size_ = leaf_size;
+        clear();
+    }
+
+    double getLeafSize() const
+    {
+        return leaf_size_;
+    }
+
+    void clear()
+    {
+        voxel_index_.clear();
+        voxels_.clear();
+    }
+
+    /* Number of voxels (centroids) */
+    size_t size() const
+    {
+        return voxels_.size();
+    }
+
+    /* O(1) */
+    void insert(double x, double y, double z)
+    {
+        const uint64_t key = getVoxelKey(getVoxelCoord(x), getVoxelCoord(y), getVoxelCoord(z));
+        std::unordered_map<uint64_t, int>::iterator it = voxel_index_.find(key);
+        if (it == voxel_index_.end())
+        {
+            it = voxel_index_.insert(std::make_pair(key, (int) voxels_.size())).first;
+            voxels_.push_back(Voxel());
+        }
+        Voxel& voxel = voxels_[it->second];
+        voxel.sum_x += x;
+        voxel.sum_y += y;
+        voxel.sum_z += z;
+        voxel.count++;
+    }
+
+    /* Centroid of the i-th voxel (voxels are in order of creation) */
+    pcl::PointXYZ getCentroid(int i) const
+    {
+        const Voxel& voxel = voxels_[i];
+        pcl::PointXYZ p;
+        p.x = voxel.sum_x / voxel.count;
+        p.y = voxel.sum_y / voxel.count;
+        p.z = voxel.sum_z / voxel.count;
+        return p;
+    }
+
+    /* The i-th point of the cloud is the centroid of the i-th voxel */
+    void getCentroids(pcl::PointCloud<pcl::PointXYZ>& cloud) const
+    {
+        cloud.points.resize(voxels_.size());
+        for (size_t i = 0; i < voxels_.size(); i++)
+        {
+            cloud.points[i] = getCentroid(i);
+        }
+        cloud.width = cloud.points.size();
+        cloud.height = 1;
+    }
+
+    /* Indices of the centroids in cloud (see getCentroids()) within radius of p, p included if it is a centroid */
+    void radiusSearch(const pcl::PointCloud<pcl::PointXYZ>& cloud, const pcl::PointXYZ& p, double radius, std::vector<int>& indices) const
+    {
+        indices.clear();
+        const double squared_radius = radius * radius;
+        const int64_t x_min = getVoxelCoord(p.x - radius), x_max = getVoxelCoord(p.x + radius);
+        const int64_t y_min = getVoxelCoord(p.y - radius), y_max = getVoxelCoord(p.y + radius);
+        const int64_t z_min = getVoxelCoord(p.z - radius), z_max = getVoxelCoord(p.z + radius);
+        for (int64_t vx = x_min; vx <= x_max; vx++)
+        {
+            for (int64_t vy = y_min; vy <= y_max; vy++)
+            {
+                for (int64_t vz = z_min; vz <= z_max; vz++)
+                {
+                    std::unordered_map<uint64_t, int>::const_iterator it = voxel_index_.find(getVoxelKey(vx, vy, vz));
+                    if (it == voxel_index_.end())
+                    {
+                        continue;
+                    }
+                    const pcl::PointXYZ& q = cloud.points[it->second];
+                    const double squared_distance = pow(q.x - p.x, 2) + pow(q.y - p.y, 2) + pow(q.z - p.z, 2);
+                    if (squared_distance <= squared_radius)
+                    {
+                        indices.push_back(it->second);
+                    }
+                }
+            }
+        }
+    }
+
+protected:
+
+    struct Voxel
+    {
+        Voxel() : sum_x(0), sum_y(0), sum_z(0), count(0)
+        {
+        }
+        double sum_x, sum_y, sum_z;
+        int count;
+    };
+
+    int64_t getVoxelCoord(double x) const
+    {
+        return (int64_t) floor(x / leaf_size_);
+    }
+
+    static uint64_t getVoxelKey(int64_t vx, int64_t vy, int64_t vz)
+    {
+        /* 21 bits per axis */
+        const int64_t kOffset = 1 << 20;
+        return ((((uint64_t) (vx + kOffset)) & 0x1fffff) << 42) |
+               ((((uint64_t) (vy + kOffset)) & 0x1fffff) << 21) |
+                (((uint64_t) (vz + kOffset)) & 0x1fffff);
+    }
+
+protected:
+
+    double leaf_size_;
+    std::unordered_map<uint64_t, int> voxel_index_; /* key of a voxel -> its index in voxels_ */
+    std::vector<Voxel> voxels_;
+};
+
+
+/* Union-find over the vertices 0..n-1 (path halving and union by size) */
+class DisjointSets
+{
+public:
+
+    DisjointSets(int n = 0)
+    {
+        reset(n);
+    }
+
+    void reset(int n)
+    {
+        parent_.resize(n);
+        size_.assign(n, 1);
+        for (int i = 0; i < n; i++)
+        {
+            parent_[i] = i;
+        }
+        num_sets_ = n;
+    }
+
+    int find(int i)
+    {
+        while (parent_[i] != i)
+        {
+            parent_[i] = parent_[parent_[i]];
+            i = parent_[i];
+        }
+        return i;
+    }
+
+    /* Return false if i and j were already in the same set */
+    bool join(int i, int j)
+    {
+        i = find(i);
+        j = find(j);
+        if (i == j)
+        {
+            return false;
+        }
+        if (size_[i] < size_[j])
+        {
+            std::swap(i, j);
+        }
+        parent_[j] = i;
+        size_[i] += size_[j];
+        num_sets_--;
+        return true;
+    }
+
+    int getNumSets() const
+    {
+        return num_sets_;
+    }
+
+protected:
+
+    std::vector<int> parent_;
+    std::vector<int> size_;
+    int num_sets_;
+};
+
+
+#endif /* TRAJECTORY_INDEX_H */
@@ -20,6 +20,8 @@
 
 #include <robot_trajectory_saver/robot_trajectory_saver.h>
 
+#include <cstring>
+
 void print(Graph* graph_ptr)
 {
 
@@ -67,24 +69,17 @@ void RobotTrajectorySaver::fromBoostGraphToNavMsgPath(nav_msgs::Path& path)
 
 bool RobotTrajectorySaver::findVertex(int i, Vertex& vertex)
 {
-    property_map<Graph, vertex_index_t>::type index = get(vertex_index, *graph_ptr);
-
-    std::pair<vertex_iterator, vertex_iterator> vp;
-    for (vp = vertices(*graph_ptr); vp.first != vp.second; ++vp.first)
+    /* vertices are stored in a vecS: the vertex index is the vertex descriptor */
+    if ((graph_ptr == 0) || (i < 0) || (i >= (int) num_vertices(*graph_ptr)))
     {
-        if (index[*vp.first] == i)
-        {
-            vertex = *vp.first;
-            return true;
-        }
-        //std::cout << index[*vp.first] << std::endl;
+        return false;
     }
-    return false;
+    vertex = boost::vertex(i, *graph_ptr);
+    return true;
 }
 
 void RobotTrajectorySaver::computeShortestPath(int i, int j, std::vector<int>& path)
 {
-    property_map<Graph, vertex_index_t>::type index = get(vertex_index, *graph_ptr);
     Vertex source;
     bool source_found = findVertex(i, source);
 
@@ -93,33 +88,148 @@ void RobotTrajectorySaver::computeShortestPath(int i, int j, std::vector<int>& p
 
     if (source_found && destination_found)
     {
-        path.push_back(j);
+        /* queries from the same source reuse its search tree as long as the destination has been closed */
+        if ((search_trees.count(source) == 0) && (search_trees.size() >= kMaxNumSearchTrees))
+        {
+            search_trees.clear();
+        }
+        SearchTree& tree = search_trees[source];
+        if (tree.closed.empty() || !tree.closed[destination])
+        {
+            searchShortestPath(source, std::vector<Vertex>(1, destination), tree);
+        }
+
+        if (!getPath(tree, source, destination, path))
+        {
+            std::cout << "No path between nodes " << i << " and " << j << std::endl;
+        }
+    }
+    else
+    {
+        std::cout << "Invalid source and destination nodes" << std::endl;
+    }
+}
+
+bool RobotTrajectorySaver::getPath(const SearchTree& tree, Vertex source, Vertex destination, std::vector<int>& path) const
+{
+    if (!tree.closed[destination])
+    {
+        return false;
+    }
+
+    property_map<Graph, vertex_index_t>::type index = get(vertex_index, *graph_ptr);
+    for (Vertex v = destination; v != source; v = tree.predecessors[v])
+    {
+        path.push_back(index[v]);
+    }
+    path.push_back(index[source]);
+    std::reverse(path.begin(), path.end());
+    return true;
+}
+
+void RobotTrajectorySaver::searchShortestPath(Vertex source, const std::vector<Vertex>& destinations, SearchTree& tree) const
+{
+    const size_t n_vertices = num_vertices(*graph_ptr);
+    VertexPositions v_positions = get(vertex_properties, *graph_ptr);
+    property_map<Graph, edge_weight_t>::type weight = get(edge_weight, *graph_ptr);
+
+    tree.predecessors.resize(n_vertices);
+    for (size_t k = 0; k < n_vertices; k++)
+    {
+        tree.predecessors[k] = k;
+    }
+    tree.distances.assign(n_vertices, std::numeric_limits<double>::max());
+    tree.closed.assign(n_vertices, false);
+
+    /* the heuristic is used only with a single destination, otherwise this is a Dijkstra stopped once all the destinations are closed */
+    const bool use_heuristic = (destinations.size() == 1);
+    const Point3D goal = v_positions[destinations[0]];
+
+    std::vector<bool> is_destination(n_vertices, false);
+    size_t n_open_destinations = 0;
+    for (size_t k = 0; k < destinations.size(); k++)
+    {
+        if (!is_destination[destinations[k]])
+        {
+            is_destination[destinations[k]] = true;
+            n_open_destinations++;
+        }
+    }
 
-        std::vector<Vertex> p(num_vertices(*graph_ptr));
-        std::vector<int> d(num_vertices(*graph_ptr));
+    /* open list ordered by f = g + h (entries of already closed vertices are skipped) */
+    typedef std::pair<double, Vertex> OpenEntry;
+    std::priority_queue<OpenEntry, std::vector<OpenEntry>, std::greater<OpenEntry> > open_list;
 
-        dijkstra_shortest_paths(*graph_ptr, source, predecessor_map(boost::make_iterator_property_map(p.begin(), get(boost::vertex_index, *graph_ptr))).distance_map(boost::make_iterator_property_map(d.begin(), get(boost::vertex_index, *graph_ptr))));
+    tree.distances[source] = 0;
+    open_list.push(OpenEntry(0, source));
 
-        Vertex pred = p[destination];
-        Edge e1;
-        bool found;
-        tie(e1, found) = edge(destination, pred, *graph_ptr);
+    while (!open_list.empty())
+    {
+        const Vertex u = open_list.top().second;
+        open_list.pop();
+        if (tree.closed[u])
+        {
+            continue;
+        }
+        tree.closed[u] = true;
+
+        /* early termination: with a consistent heuristic the path of a closed vertex is optimal */
+        if (is_destination[u] && (--n_open_destinations == 0))
+        {
+            break;
+        }
 
-        if (pred != destination)
+        graph_traits<Graph>::out_edge_iterator ei, ei_end;
+        for (tie(ei, ei_end) = out_edges(u, *graph_ptr); ei != ei_end; ++ei)
         {
-            while (pred != source)
+            const Vertex v = target(*ei, *graph_ptr);
+            if (tree.closed[v])
             {
-                int k = index[pred];
+                continue;
+            }
+            const double d = tree.distances[u] + get(weight, *ei);
+            if (d < tree.distances[v])
+            {
+                tree.distances[v] = d;
+                tree.predecessors[v] = u;
+                double h = 0;
+                if (use_heuristic)
+                {
+                    const Point3D& p = v_positions[v];
+                    h = heuristic_scale * sqrt(pow(goal.x - p.x, 2) + pow(goal.y - p.y, 2) + pow(goal.z - p.z, 2));
+                }
+                open_list.push(OpenEntry(d + h, v));
+            }
+        }
+    }
+}
+
+void RobotTrajectorySaver::resetPathCache()
+{
+    search_trees.clear();
 
-                path.insert(path.begin(), k);
-                tie(e1, found) = edge(p[pred], pred, *graph_ptr);
-                pred = p[pred];
+    /* the largest scale for which the Euclidean distance never exceeds an edge weight (the edge weights are scaled distances) */
+    heuristic_scale = std::numeric_limits<double>::max();
+    if (graph_ptr != 0)
+    {
+        VertexPositions v_positions = get(vertex_properties, *graph_ptr);
+        property_map<Graph, edge_weight_t>::type weight = get(edge_weight, *graph_ptr);
+
+        std::pair<edge_iterator, edge_iterator> ei = edges(*graph_ptr);
+        for (edge_iterator edge_iter = ei.first; edge_iter != ei.second; ++edge_iter)
+        {
+            const Point3D& p_s = v_positions[source(*edge_iter, *graph_ptr)];
+            const Point3D& p_t = v_positions[target(*edge_iter, *graph_ptr)];
+            const double length = sqrt(pow(p_t.x - p_s.x, 2) + pow(p_t.y - p_s.y, 2) + pow(p_t.z - p_s.z, 2));
+            if (length > 0)
+            {
+                heuristic_scale = std::min(heuristic_scale, std::max(get(weight, *edge_iter), 0.) / length);
             }
         }
     }
-    else
+    if (heuristic_scale == std::numeric_limits<double>::max())
     {
-        std::cout << "Invalid source and destination nodes" << std::endl;
+        heuristic_scale = 0;
     }
 }
 
@@ -198,145 +308,131 @@ void RobotTrajectorySaver::visualize(visualization_msgs::Marker& line_list)
 
 }
 
-void RobotTrajectorySaver::initialize(double radius, int total_nr_points, pcl::PointCloud<pcl::PointXYZ>* point_cloud_in_total, pcl::KdTreeFLANN<pcl::PointXYZ> *kdtree_total)
+void RobotTrajectorySaver::addGlobalRobotPose(int i, const tf::StampedTransform& robot_pose_map)
 {
+    ugv_trajectories[i].global_robot_poses.push_back(robot_pose_map);
+    trajectory_voxels.insert(robot_pose_map.getOrigin().getX(), robot_pose_map.getOrigin().getY(), robot_pose_map.getOrigin().getZ());
+}
 
-    VertexPositions v_positions = get(vertex_properties, *graph_ptr);
+void RobotTrajectorySaver::buildTrajectoryGraph()
+{
+    pcl::PointCloud<pcl::PointXYZ> cloud_in_filtered;
 
-    std::vector<int> pointIdxRadiusSearch;
+    pthread_mutex_lock(&lock_robot_trajectories);
+    trajectory_voxels.getCentroids(cloud_in_filtered);
+    pthread_mutex_unlock(&lock_robot_trajectories);
 
-    std::vector<float> pointRadiusSquaredDistance;
+    int total_nr_points = cloud_in_filtered.points.size();
 
-    int i = 0;
-    int j = 0;
+    if (graph_ptr) delete graph_ptr;
+    graph_ptr = new Graph(total_nr_points);
 
-    while (i < total_nr_points)
+    VertexPositions v_positions = get(vertex_properties, *graph_ptr);
+    for (int i = 0; i < total_nr_points; i++)
     {
+        Point3D p;
+        p.x = cloud_in_filtered.points[i].x;
+        p.y = cloud_in_filtered.points[i].y;
+        p.z = cloud_in_filtered.points[i].z;
+        v_positions[i] = p;
+    }
 
-        pcl::PointXYZ searchPoint = point_cloud_in_total->points[i];
-
-        int n_points = kdtree_total->radiusSearch(searchPoint, radius, pointIdxRadiusSearch, pointRadiusSquaredDistance);
+    DisjointSets components(total_nr_points);
+    initialize(min_radius, cloud_in_filtered, components);
+    linkConnectedComponents(min_radius, radius_incr, max_radius, cloud_in_filtered, components);
+    resetPathCache();
 
-        if (n_points > 1)
-        { // The first point is the searchPoint itself
+    std::cout << "Trajectory graph: " << total_nr_points << " vertices, " << num_edges(*graph_ptr) << " edges, " << components.getNumSets() << " connected components" << std::endl;
+}
 
-            for (unsigned int k = 1; k < pointIdxRadiusSearch.size(); k++)
-            {
+void RobotTrajectorySaver::initialize(double radius, const pcl::PointCloud<pcl::PointXYZ>& point_cloud_in_total, DisjointSets& components)
+{
+    int total_nr_points = point_cloud_in_total.points.size();
 
-                j = pointIdxRadiusSearch[k];
+    std::vector<int> pointIdxRadiusSearch;
 
-                geometry_msgs::Point tail;
-                tail.x = point_cloud_in_total->points[j].x;
-                tail.y = point_cloud_in_total->points[j].y;
-                tail.z = point_cloud_in_total->points[j].z;
+    for (int i = 0; i < total_nr_points; i++)
+    {
 
+        const pcl::PointXYZ& searchPoint = point_cloud_in_total.points[i];
 
-                double scaled_distance = sqrt(pow(tail.x - searchPoint.x, 2) + pow(tail.y - searchPoint.y, 2) + scaled_factor * pow(tail.z - searchPoint.z, 2));
-                //ROS_INFO("SCLAED DISTANCE: %f - RADIUS: %f",scaled_distance,radius);
-                if (scaled_distance < radius)
-                {
+        trajectory_voxels.radiusSearch(point_cloud_in_total, searchPoint, radius, pointIdxRadiusSearch);
 
-                    Edge e = add_edge(i, j, scaled_distance, *graph_ptr).first;
+        for (unsigned int k = 0; k < pointIdxRadiusSearch.size(); k++)
+        {
 
-                    Vertex s = source(e, *graph_ptr);
-                    Point3D p_s;
-                    p_s.x = searchPoint.x;
-                    p_s.y = searchPoint.y;
-                    p_s.z = searchPoint.z;
-                    v_positions[s] = p_s;
+            int j = pointIdxRadiusSearch[k];
+            if (j <= i)
+            {
+                /* each pair is checked once (the graph is undirected) */
+                continue;
+            }
 
-                    Vertex t = target(e, *graph_ptr);
-                    Point3D p_t;
-                    p_t.x = point_cloud_in_total->points[j].x;
-                    p_t.y = point_cloud_in_total->points[j].y;
-                    p_t.z = point_cloud_in_total->points[j].z;
-                    v_positions[t] = p_t;
+            const pcl::PointXYZ& tail = point_cloud_in_total.points[j];
 
-                }
+            double scaled_distance = sqrt(pow(tail.x - searchPoint.x, 2) + pow(tail.y - searchPoint.y, 2) + scaled_factor * pow(tail.z - searchPoint.z, 2));
+            //ROS_INFO("SCLAED DISTANCE: %f - RADIUS: %f",scaled_distance,radius);
+            if (scaled_distance < radius)
+            {
+                add_edge(i, j, scaled_distance, *graph_ptr);
+                components.join(i, j);
             }
         }
 
-        i++;
-
     }
-
 }
 
-void RobotTrajectorySaver::linkConnectedComponents(double min, double incr, double rmax, int total_nr_points, pcl::PointCloud<pcl::PointXYZ>* point_cloud_in_total, pcl::KdTreeFLANN<pcl::PointXYZ> *kdtree_total)
+void RobotTrajectorySaver::linkConnectedComponents(double min, double incr, double rmax, const pcl::PointCloud<pcl::PointXYZ>& point_cloud_in_total, DisjointSets& components)
 {
+    int total_nr_points = point_cloud_in_total.points.size();
+
     double count = min;
-    VertexPositions v_positions = get(vertex_properties, *graph_ptr);
 
-    while (count < rmax)
+    std::vector<int> pointIdxRadiusSearch;
+    std::vector<int> component(total_nr_points);
+
+    while ((count < rmax) && (components.getNumSets() > 1))
     {
         count += incr;
 
-        std::vector<int> pointIdxRadiusSearch;
-        std::vector<float> pointRadiusSquaredDistance;
-
-        std::vector<int> component(num_vertices(*graph_ptr));
-        int num = connected_components(*graph_ptr, &component[0]);
-
-        int i = 0;
-        int j = 0;
+        /* components at the beginning of the step: all the pairs of different components within the radius are linked */
+        for (int i = 0; i < total_nr_points; i++)
+        {
+            component[i] = components.find(i);
+        }
 
-        while (i < total_nr_points)
+        for (int i = 0; i < total_nr_points; i++)
         {
 
-            pcl::PointXYZ searchPoint = point_cloud_in_total->points[i];
+            const pcl::PointXYZ& searchPoint = point_cloud_in_total.points[i];
 
-            int n_points = kdtree_total->radiusSearch(searchPoint, count, pointIdxRadiusSearch, pointRadiusSquaredDistance);
+            trajectory_voxels.radiusSearch(point_cloud_in_total, searchPoint, count, pointIdxRadiusSearch);
 
-            if (n_points > 0)
+            for (unsigned int k = 0; k < pointIdxRadiusSearch.size(); k++)
             {
+                int j = pointIdxRadiusSearch[k];
 
-                for (unsigned int k = 0; k < pointIdxRadiusSearch.size(); k++)
+                if ((j > i) && (component[i] != component[j]))
                 {
-                    j = pointIdxRadiusSearch[k];
-
-                    if (component[i] != component[j])
-                    {
 
-                        geometry_msgs::Point tail;
-                        tail.x = point_cloud_in_total->points[j].x;
-                        tail.y = point_cloud_in_total->points[j].y;
-                        tail.z = point_cloud_in_total->points[j].z;
+                    const pcl::PointXYZ& tail = point_cloud_in_total.points[j];
 
-
-                        double scaled_distance = sqrt(pow(tail.x - searchPoint.x, 2) + pow(tail.y - searchPoint.y, 2) + pow(scaled_factor * tail.z - searchPoint.z, 2));
-                        //ROS_INFO("SCLAED DISTANCE: %f - RADIUS: %f",scaled_distance,rmax);
-                        if (scaled_distance < count)
-                        {
-
-                            Edge e = add_edge(i, j, scaled_distance, *graph_ptr).first;
-
-                            Vertex s = source(e, *graph_ptr);
-                            Point3D p_s;
-                            p_s.x = searchPoint.x;
-                            p_s.y = searchPoint.y;
-                            p_s.z = searchPoint.z;
-                            v_positions[s] = p_s;
-
-                            Vertex t = target(e, *graph_ptr);
-                            Point3D p_t;
-                            p_t.x = point_cloud_in_total->points[j].x;
-                            p_t.y = point_cloud_in_total->points[j].y;
-                            p_t.z = point_cloud_in_total->points[j].z;
-                            v_positions[t] = p_t;
-
-                        }
+                    double scaled_distance = sqrt(pow(tail.x - searchPoint.x, 2) + pow(tail.y - searchPoint.y, 2) + scaled_factor * pow(tail.z - searchPoint.z, 2));
+                    //ROS_INFO("SCLAED DISTANCE: %f - RADIUS: %f",scaled_distance,rmax);
+                    if (scaled_distance < count)
+                    {
+                        add_edge(i, j, scaled_distance, *graph_ptr);
+                        components.join(i, j);
                     }
                 }
             }
 
-            i++;
-
         }
 
     }
 }
 
-void RobotTrajectorySaver::findClosestVertex(int n_point_of_interest, geometry_msgs::Point s, int& i, Point3D& p, double& d)
+void RobotTrajectorySaver::findClosestVertex(geometry_msgs::Point s, int& i, Point3D& p, double& d)
 {
 
     double min_dist = MAX_DISTANCE;
@@ -344,154 +440,191 @@ void RobotTrajectorySaver::findClosestVertex(int n_point_of_interest, geometry_m
     property_map<Graph, vertex_index_t>::type index = get(vertex_index, *graph_ptr);
     VertexPositions v_positions = get(vertex_properties, *graph_ptr);
 
-    for (int i = 0; i < n_point_of_interest; i++)
+    std::pair<vertex_iterator, vertex_iterator> vp;
+    for (vp = vertices(*graph_ptr); vp.first != vp.second; ++vp.first)
     {
 
-        std::pair<vertex_iterator, vertex_iterator> vp;
-        for (vp = vertices(*graph_ptr); vp.first != vp.second; ++vp.first)
+        //Vertex v = *vp.first;
+        //Point3D p = v_positions[v];
+        double dist = sqrt(pow(s.x - v_positions[*vp.first].x, 2) + pow(s.y - v_positions[*vp.first].y, 2) + pow(s.z - v_positions[*vp.first].z, 2));
+        if (dist < min_dist)
         {
-
-            //Vertex v = *vp.first;
-            //Point3D p = v_positions[v];
-            double dist = sqrt(pow(s.x - v_positions[*vp.first].x, 2) + pow(s.y - v_positions[*vp.first].y, 2) + pow(s.z - v_positions[*vp.first].z, 2));
-            if (dist < min_dist)
-            {
-                min_dist = dist;
-                d = min_dist;
-                i = index[*vp.first];
-                p = v_positions[*vp.first];
-            }
-
+            min_dist = dist;
+            d = min_dist;
+            i = index[*vp.first];
+            p = v_positions[*vp.first];
         }
+
     }
 
 }
 
-bool RobotTrajectorySaver::checkPath(robot_trajectory_saver_msgs::CheckPath::Request& request, robot_trajectory_saver_msgs::CheckPath::Response& response)
+void RobotTrajectorySaver::resolvePointOfInterest(const nav_msgs::Path& point_of_interest, int n_nodes, int& node_id, int& n_augmented_path_nodes)
 {
+    /* the graph of the trajectories is augmented with the points of interest: */
+    /* the i-th point is the node n_nodes + i, linked only to its closest node of the graph. */
+    /* The points are not added to the graph (this would drop the cached search trees): a path to or from a point */
+    /* is the path to or from its closest node with the point appended */
+    int i = node_id - n_nodes;
+    if ((i < 0) || (i >= (int) point_of_interest.poses.size()))
+    {
+        return;
+    }
 
-    /* create a new graph  starting from the graph of the trajectories and augmenting them with new nodes and edges */
-    /* nodes are the point of interest in the req message */
-    Graph* augmented_graph_ptr = graph_ptr;
-    int n_nodes = num_vertices(*graph_ptr);
+    int j = -1;
+    Point3D p_t;
+    double weight;
+    findClosestVertex(point_of_interest.poses[i].pose.position, j, p_t, weight);
 
-    VertexPositions v_positions = get(vertex_properties, *graph_ptr);
+    node_id = j;
+    n_augmented_path_nodes++;
+}
 
-    int n_point_of_interest = request.point_of_interest.poses.size();
+bool RobotTrajectorySaver::checkPath(robot_trajectory_saver_msgs::CheckPath::Request& request, robot_trajectory_saver_msgs::CheckPath::Response& response)
+{
+    response.path_cost = 0;
+    response.result = false;
 
-    for (int i = 0; i < n_point_of_interest; i++)
+    if (graph_ptr == 0)
     {
-
-        int j;
-        Point3D p_t;
-        double weight;
-        findClosestVertex(n_point_of_interest, request.point_of_interest.poses[i].pose.position, j, p_t, weight);
-        int k = n_nodes + i;
-        Edge e = add_edge(k, j, weight, *augmented_graph_ptr).first;
-
-        Vertex s = source(e, *augmented_graph_ptr);
-        Point3D p_s;
-        p_s.x = request.point_of_interest.poses[i].pose.position.x;
-        p_s.y = request.point_of_interest.poses[i].pose.position.y;
-        p_s.z = request.point_of_interest.poses[i].pose.position.z;
-        v_positions[s] = p_s;
-
-        Vertex t = target(e, *graph_ptr);
-        v_positions[t] = p_t;
+        return true;
     }
+    int n_nodes = num_vertices(*graph_ptr);
+
+    int source_node_id = request.source_node_id;
+    int destination_node_id = request.destination_node_id;
+    int n_augmented_path_nodes = 0;
+    resolvePointOfInterest(request.point_of_interest, n_nodes, source_node_id, n_augmented_path_nodes);
+    resolvePointOfInterest(request.point_of_interest, n_nodes, destination_node_id, n_augmented_path_nodes);
+
     std::vector<int> node_id_path;
-    computeShortestPath(request.source_node_id, request.destination_node_id, node_id_path);
+    computeShortestPath(source_node_id, destination_node_id, node_id_path);
 
     if (node_id_path.size() > 0)
     {
-        response.path_cost = node_id_path.size();
+        response.path_cost = node_id_path.size() + n_augmented_path_nodes;
         response.result = true;
     }
-    else
-    {
-        response.path_cost = 0;
-        response.result = false;
-    }
 
     return true;
 }
 
-bool RobotTrajectorySaver::getRobotTrajectoriesCallback(robot_trajectory_saver_msgs::GetRobotTrajectories::Request& request, robot_trajectory_saver_msgs::GetRobotTrajectories::Response& response)
+bool RobotTrajectorySaver::checkPaths(robot_trajectory_saver_msgs::CheckPaths::Request& request, robot_trajectory_saver_msgs::CheckPaths::Response& response)
 {
+    const size_t n_queries = std::min(request.source_node_id.size(), request.destination_node_id.size());
+    response.result.assign(n_queries, false);
+    response.path_cost.assign(n_queries, 0);
 
-    std::cout << "Service callback called: getRobotTrajectoriesCallback " << std::endl;
-    pcl::PointCloud<pcl::PointXYZ> *cloud_in;
-    pcl::PointCloud<pcl::PointXYZ>* cloud_in_filtered;
-
-    cloud_in = new pcl::PointCloud<pcl::PointXYZ>();
-    cloud_in_filtered = new pcl::PointCloud<pcl::PointXYZ>();
-
-    //if (read_file) {
-    for (int i = 0; i < cloud_in_init_graph->points.size(); i++)
+    if (graph_ptr == 0)
     {
-        cloud_in->points.push_back(cloud_in_init_graph->points[i]);
+        return true;
     }
-    //    read_file = false;
-    //}
-
-    pthread_mutex_lock(&lock_robot_trajectories);
+    int n_nodes = num_vertices(*graph_ptr);
 
-    for (int i = 0; i < num_robots; i++)
+    /* group the queries by source: one search tree serves all the destinations of a source */
+    std::vector<Vertex> destinations(n_queries);
+    std::vector<int> n_augmented_path_nodes(n_queries, 0);
+    std::map<Vertex, std::vector<size_t> > queries_by_source;
+    for (size_t k = 0; k < n_queries; k++)
     {
-        for (int j = 0; j < ugv_trajectories[i].global_robot_poses.size(); j++)
+        int source_node_id = request.source_node_id[k];
+        int destination_node_id = request.destination_node_id[k];
+        resolvePointOfInterest(request.point_of_interest, n_nodes, source_node_id, n_augmented_path_nodes[k]);
+        resolvePointOfInterest(request.point_of_interest, n_nodes, destination_node_id, n_augmented_path_nodes[k]);
+
+        Vertex source;
+        if (findVertex(source_node_id, source) && findVertex(destination_node_id, destinations[k]))
+        {
+            queries_by_source[source].push_back(k);
+        }
+        else
         {
-            pcl::PointXYZ q;
-            q.x = ugv_trajectories[i].global_robot_poses[j].getOrigin().getX();
-            q.y = ugv_trajectories[i].global_robot_poses[j].getOrigin().getY();
-            q.z = ugv_trajectories[i].global_robot_poses[j].getOrigin().getZ();
-            cloud_in->points.push_back(q);
+            std::cout << "Invalid source and destination nodes " << request.source_node_id[k] << ", " << request.destination_node_id[k] << std::endl;
         }
     }
 
-    pthread_mutex_unlock(&lock_robot_trajectories);
-
-#if 0
-    if (read_file)
+    const size_t n_sources = queries_by_source.size();
+    std::vector<Vertex> sources;
+    std::vector<const std::vector<size_t>*> source_queries;
+    std::vector<const SearchTree*> trees(n_sources, (const SearchTree*) 0);
+    std::vector<SearchTree> new_trees(n_sources);
+    for (std::map<Vertex, std::vector<size_t> >::const_iterator it = queries_by_source.begin(); it != queries_by_source.end(); ++it)
     {
-        property_map<Graph, vertex_index_t>::type index = get(vertex_index, *graph_ptr);
-        VertexPositions v_positions = get(vertex_properties, *graph_ptr);
-        std::cout << "Num of vertices of the graph red from file: " << num_vertices(*graph_ptr) << std::endl;
-        std::pair<vertex_iterator, vertex_iterator> vp;
-        for (vp = vertices(*graph_ptr); vp.first != vp.second; ++vp.first)
-        {
+        const size_t g = sources.size();
+        sources.push_back(it->first);
+        source_queries.push_back(&it->second);
 
-            Vertex v = *vp.first;
-            Point3D p = v_positions[v];
-            pcl::PointXYZ q;
-            q.x = p.x;
-            q.y = p.y;
-            q.z = p.z;
-            cloud_in->points.push_back(q);
+        /* a cached tree is used if all the destinations of the source have been closed */
+        std::unordered_map<Vertex, SearchTree>::const_iterator it_tree = search_trees.find(it->first);
+        if (it_tree != search_trees.end())
+        {
+            bool b_all_closed = true;
+            for (size_t l = 0; b_all_closed && (l < it->second.size()); l++)
+            {
+                b_all_closed = it_tree->second.closed[destinations[it->second[l]]];
+            }
+            if (b_all_closed)
+            {
+                trees[g] = &it_tree->second;
+            }
+        }
+    }
 
+    /* the searches of different sources are independent (the graph is only read) */
+    #pragma omp parallel for schedule(dynamic)
+    for (int g = 0; g < (int) n_sources; g++)
+    {
+        if (trees[g] != 0)
+        {
+            continue;
+        }
+        std::vector<Vertex> source_destinations;
+        for (size_t l = 0; l < source_queries[g]->size(); l++)
+        {
+            source_destinations.push_back(destinations[(*source_queries[g])[l]]);
         }
+        searchShortestPath(sources[g], source_destinations, new_trees[g]);
+    }
 
+    std::vector<int> node_id_path;
+    for (size_t g = 0; g < n_sources; g++)
+    {
+        const SearchTree& tree = (trees[g] != 0) ? *trees[g] : new_trees[g];
+        for (size_t l = 0; l < source_queries[g]->size(); l++)
+        {
+            const size_t k = (*source_queries[g])[l];
+            node_id_path.clear();
+            if (getPath(tree, sources[g], destinations[k], node_id_path))
+            {
+                response.path_cost[k] = node_id_path.size() + n_augmented_path_nodes[k];
+                response.result[k] = true;
+            }
+        }
     }
-#endif
 
-    pcl::VoxelGrid<pcl::PointXYZ> *sor;
-    sor = new pcl::VoxelGrid<pcl::PointXYZ>();
-    sor->setInputCloud(cloud_in->makeShared());
-    sor->setLeafSize(leaf_size, leaf_size, leaf_size);
-    sor->filter(*cloud_in_filtered);
+    /* keep the new trees for the next queries */
+    for (size_t g = 0; g < n_sources; g++)
+    {
+        if (trees[g] != 0)
+        {
+            continue;
+        }
+        if ((search_trees.count(sources[g]) == 0) && (search_trees.size() >= kMaxNumSearchTrees))
+        {
+            search_trees.clear();
+        }
+        std::swap(search_trees[sources[g]], new_trees[g]);
+    }
 
-    pcl::KdTreeFLANN<pcl::PointXYZ> *kdtree;
-    kdtree = new pcl::KdTreeFLANN<pcl::PointXYZ>();
+    return true;
+}
 
-    kdtree->setInputCloud(cloud_in_filtered->makeShared());
-    int total_nr_points = cloud_in_filtered->points.size();
+bool RobotTrajectorySaver::getRobotTrajectoriesCallback(robot_trajectory_saver_msgs::GetRobotTrajectories::Request& request, robot_trajectory_saver_msgs::GetRobotTrajectories::Response& response)
+{
 
-    if (graph_ptr) delete graph_ptr;
-    graph_ptr = new Graph(total_nr_points);
+    std::cout << "Service callback called: getRobotTrajectoriesCallback " << std::endl;
 
-#if 1
-    initialize(min_radius, total_nr_points, cloud_in_filtered, kdtree);
-    linkConnectedComponents(min_radius, radius_incr, max_radius, total_nr_points, cloud_in_filtered, kdtree);
-#endif
+    buildTrajectoryGraph();
 
     line_list.header.stamp = ros::Time::now();
     line_list.points.clear();
@@ -508,18 +641,120 @@ bool RobotTrajectorySaver::getRobotTrajectoriesCallback(robot_trajectory_saver_m
 bool RobotTrajectorySaver::loadRobotTrajectoriesCallback(robot_trajectory_saver_msgs::LoadRobotTrajectories::Request& request, robot_trajectory_saver_msgs::LoadRobotTrajectories::Response& response)
 {
 
-    Graph* graph_ptr = new Graph(0);
-    VertexPositions v_positions = get(vertex_properties, *graph_ptr);
-
-    std::vector<int> indexes;
-    std::vector<Point3D> coordinates;
+    Graph graph(0);
+    readGraph(request.file_path, graph);
 
     nav_msgs::Path path;
     path.header.frame_id = global_frame;
     path.header.stamp = ros::Time::now();
 
-    std::ifstream graph_filename;
-    graph_filename.open(request.file_path.c_str());
+    VertexPositions v_positions = get(vertex_properties, graph);
+    std::pair<vertex_iterator, vertex_iterator> vp;
+    for (vp = vertices(graph); vp.first != vp.second; ++vp.first)
+    {
+        Point3D p = v_positions[*vp.first];
+
+        geometry_msgs::PoseStamped ps;
+        ps.header.frame_id = global_frame;
+        ps.header.stamp = path.header.stamp;
+        ps.pose.position.x = p.x;
+        ps.pose.position.y = p.y;
+        ps.pose.position.z = p.z;
+        ps.pose.orientation.w = 1;
+        path.poses.push_back(ps);
+    }
+
+    response.trajectories = path;
+    return true;
+}
+
+bool RobotTrajectorySaver::readGraph(const std::string& file_path, Graph& graph)
+{
+    std::ifstream file(file_path.c_str(), std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cout << "Cannot open the trajectory graph file " << file_path << std::endl;
+        return false;
+    }
+
+    char magic[kBinaryGraphMagicSize] = {0};
+    file.read(magic, kBinaryGraphMagicSize);
+    const bool b_binary = file.good() && (memcmp(magic, kBinaryGraphMagic, kBinaryGraphMagicSize) == 0);
+    file.close();
+
+    return b_binary ? readBinaryGraph(file_path, graph) : readDotGraph(file_path, graph);
+}
+
+bool RobotTrajectorySaver::readBinaryGraph(const std::string& file_path, Graph& graph)
+{
+    FILE* file = fopen(file_path.c_str(), "rb");
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    char magic[kBinaryGraphMagicSize];
+    uint32_t version = 0;
+    uint32_t n_vertices = 0;
+    uint64_t n_edges = 0;
+    bool ok = (fread(magic, 1, kBinaryGraphMagicSize, file) == kBinaryGraphMagicSize) &&
+              (memcmp(magic, kBinaryGraphMagic, kBinaryGraphMagicSize) == 0) &&
+              (fread(&version, sizeof(version), 1, file) == 1) &&
+              (fread(&n_vertices, sizeof(n_vertices), 1, file) == 1) &&
+              (fread(&n_edges, sizeof(n_edges), 1, file) == 1);
+    if (ok && (version != kBinaryGraphVersion))
+    {
+        std::cout << "Unsupported version " << version << " of the trajectory graph file " << file_path << std::endl;
+        ok = false;
+    }
+
+    std::vector<Point3D> positions;
+    std::vector<BinaryGraphEdge> graph_edges;
+    if (ok)
+    {
+        positions.resize(n_vertices);
+        graph_edges.resize(n_edges);
+        ok = (fread(positions.data(), sizeof(Point3D), n_vertices, file) == n_vertices) &&
+             (fread(graph_edges.data(), sizeof(BinaryGraphEdge), n_edges, file) == n_edges);
+    }
+    fclose(file);
+
+    if (!ok)
+    {
+        std::cout << "Invalid trajectory graph file " << file_path << std::endl;
+        return false;
+    }
+
+    graph = Graph(n_vertices);
+    VertexPositions v_positions = get(vertex_properties, graph);
+    for (uint32_t i = 0; i < n_vertices; i++)
+    {
+        v_positions[i] = positions[i];
+    }
+    for (uint64_t k = 0; k < n_edges; k++)
+    {
+        if ((graph_edges[k].source >= n_vertices) || (graph_edges[k].target >= n_vertices))
+        {
+            std::cout << "Invalid edge in the trajectory graph file " << file_path << std::endl;
+            return false;
+        }
+        add_edge(graph_edges[k].source, graph_edges[k].target, graph_edges[k].weight, graph);
+    }
+    return true;
+}
+
+bool RobotTrajectorySaver::readDotGraph(const std::string& file_path, Graph& graph)
+{
+    std::ifstream graph_filename(file_path.c_str());
+    if (!graph_filename.is_open() || empty_file(graph_filename))
+    {
+        return false;
+    }
+
+    /* the DOT node ids are the vertex indices (see write_graphviz()) */
+    std::vector<std::pair<int, Point3D> > nodes;
+    std::vector<BinaryGraphEdge> graph_edges;
+    int max_id = -1;
 
     std::string line;
     while (std::getline(graph_filename, line))
@@ -530,22 +765,12 @@ bool RobotTrajectorySaver::loadRobotTrajectoriesCallback(robot_trajectory_saver_
         // Nodes are under the form 163 [x = 7.59997, y = 2.56912, z = 2.39076];
         if (sscanf(line.c_str(), "%d %*s = %lf, %*s = %lf, %*s = %lf %*s", &id, &x, &y, &z) == 4)
         {
-            //std::cout << "Node ID " << id << " x = " << x << " y = " << y << " z = " << z << "\n";
-            indexes.push_back(id);
             Point3D p;
             p.x = x;
             p.y = y;
             p.z = z;
-            coordinates.push_back(p);
-
-            geometry_msgs::PoseStamped ps;
-            ps.header.frame_id = global_frame;
-            ps.header.stamp = path.header.stamp;
-            ps.pose.position.x = p.x;
-            ps.pose.position.y = p.y;
-            ps.pose.position.z = p.z;
-            ps.pose.orientation.w = 1;
-            path.poses.push_back(ps);
+            nodes.push_back(std::make_pair(id, p));
+            max_id = std::max(max_id, id);
         }
 
         int i, j;
@@ -553,89 +778,80 @@ bool RobotTrajectorySaver::loadRobotTrajectoriesCallback(robot_trajectory_saver_
         // Edges are under the form 8--18  [weight = "0.718538"];
         if (sscanf(line.c_str(), "%d--%d %*s = \"%lf\" %*s", &i, &j, &w) == 3)
         {
-            //std::cout << "Edge=["<< i << "," << j << "] weight="<< w <<"\n"; 
-
-            Edge e = add_edge(i, j, w, *graph_ptr).first;
-            Vertex s = source(e, *graph_ptr);
-
-            int i_source, i_target;
-            for (int k = 0; k < indexes.size(); k++)
-            {
-                if (indexes[k] == i)
-                {
-                    i_source = k;
-                }
-                if (indexes[k] == j)
-                {
-                    i_target = k;
-                }
-            }
-
-            v_positions[s] = coordinates[i_source];
-
-            Vertex t = target(e, *graph_ptr);
-            v_positions[t] = coordinates[i_target];
-
-
-
+            BinaryGraphEdge e;
+            e.source = i;
+            e.target = j;
+            e.weight = w;
+            graph_edges.push_back(e);
+            max_id = std::max(max_id, std::max(i, j));
         }
     }
     graph_filename.close();
-    response.trajectories = path;
+
+    graph = Graph(max_id + 1);
+    VertexPositions v_positions = get(vertex_properties, graph);
+    for (size_t k = 0; k < nodes.size(); k++)
+    {
+        if (nodes[k].first >= 0)
+        {
+            v_positions[nodes[k].first] = nodes[k].second;
+        }
+    }
+    for (size_t k = 0; k < graph_edges.size(); k++)
+    {
+        add_edge(graph_edges[k].source, graph_edges[k].target, graph_edges[k].weight, graph);
+    }
     return true;
 }
 
-bool RobotTrajectorySaver::saveRobotTrajectoriesCallback(robot_trajectory_saver_msgs::SaveRobotTrajectories::Request& request, robot_trajectory_saver_msgs::SaveRobotTrajectories::Response& response)
+bool RobotTrajectorySaver::writeBinaryGraph(const std::string& file_path, Graph& graph)
 {
-
-    pcl::PointCloud<pcl::PointXYZ> *cloud_in;
-    pcl::PointCloud<pcl::PointXYZ>* cloud_in_filtered;
-
-    cloud_in = new pcl::PointCloud<pcl::PointXYZ>();
-    cloud_in_filtered = new pcl::PointCloud<pcl::PointXYZ>();
-
-    //    if (read_file) {
-    for (int i = 0; i < cloud_in_init_graph->points.size(); i++)
+    /* layout: magic, version (uint32), number of vertices (uint32), number of edges (uint64), */
+    /* the vertex positions (3 doubles each, in index order) and the edges (BinaryGraphEdge) */
+    const uint32_t n_vertices = num_vertices(graph);
+    VertexPositions v_positions = get(vertex_properties, graph);
+    std::vector<Point3D> positions(n_vertices);
+    for (uint32_t i = 0; i < n_vertices; i++)
     {
-        cloud_in->points.push_back(cloud_in_init_graph->points[i]);
+        positions[i] = v_positions[i];
     }
-    //       read_file = false;
-    //   }
-
-
-    pthread_mutex_lock(&lock_robot_trajectories);
 
-    for (int i = 0; i < num_robots; i++)
+    property_map<Graph, vertex_index_t>::type index = get(vertex_index, graph);
+    property_map<Graph, edge_weight_t>::type weight = get(edge_weight, graph);
+    std::vector<BinaryGraphEdge> graph_edges;
+    graph_edges.reserve(num_edges(graph));
+    std::pair<edge_iterator, edge_iterator> ei = edges(graph);
+    for (edge_iterator edge_iter = ei.first; edge_iter != ei.second; ++edge_iter)
     {
-        for (int j = 0; j < ugv_trajectories[i].global_robot_poses.size(); j++)
-        {
-            pcl::PointXYZ q;
-            q.x = ugv_trajectories[i].global_robot_poses[j].getOrigin().getX();
-            q.y = ugv_trajectories[i].global_robot_poses[j].getOrigin().getY();
-            q.z = ugv_trajectories[i].global_robot_poses[j].getOrigin().getZ();
-            cloud_in->points.push_back(q);
-        }
+        BinaryGraphEdge e;
+        e.source = index[source(*edge_iter, graph)];
+        e.target = index[target(*edge_iter, graph)];
+        e.weight = get(weight, *edge_iter);
+        graph_edges.push_back(e);
     }
+    const uint64_t n_edges = graph_edges.size();
+    const uint32_t version = kBinaryGraphVersion;
 
-    pthread_mutex_unlock(&lock_robot_trajectories);
-
-    pcl::VoxelGrid<pcl::PointXYZ> *sor;
-    sor = new pcl::VoxelGrid<pcl::PointXYZ>();
-    sor->setInputCloud(cloud_in->makeShared());
-    sor->setLeafSize(leaf_size, leaf_size, leaf_size);
-    sor->filter(*cloud_in_filtered);
-
-    pcl::KdTreeFLANN<pcl::PointXYZ> *kdtree;
-    kdtree = new pcl::KdTreeFLANN<pcl::PointXYZ>();
-
-    kdtree->setInputCloud(cloud_in_filtered->makeShared());
-    int total_nr_points = cloud_in_filtered->points.size();
+    FILE* file = fopen(file_path.c_str(), "wb");
+    if (file == NULL)
+    {
+        std::cout << "Cannot write the trajectory graph file " << file_path << std::endl;
+        return false;
+    }
+    bool ok = (fwrite(kBinaryGraphMagic, 1, kBinaryGraphMagicSize, file) == kBinaryGraphMagicSize) &&
+              (fwrite(&version, sizeof(version), 1, file) == 1) &&
+              (fwrite(&n_vertices, sizeof(n_vertices), 1, file) == 1) &&
+              (fwrite(&n_edges, sizeof(n_edges), 1, file) == 1) &&
+              (fwrite(positions.data(), sizeof(Point3D), n_vertices, file) == n_vertices) &&
+              (fwrite(graph_edges.data(), sizeof(BinaryGraphEdge), n_edges, file) == n_edges);
+    ok = (fclose(file) == 0) && ok;
+    return ok;
+}
 
-    if (graph_ptr) delete graph_ptr;
-    graph_ptr = new Graph(total_nr_points);
+bool RobotTrajectorySaver::saveRobotTrajectoriesCallback(robot_trajectory_saver_msgs::SaveRobotTrajectories::Request& request, robot_trajectory_saver_msgs::SaveRobotTrajectories::Response& response)
+{
 
-    initialize(min_radius, total_nr_points, cloud_in_filtered, kdtree);
-    linkConnectedComponents(min_radius, radius_incr, max_radius, total_nr_points, cloud_in_filtered, kdtree);
+    buildTrajectoryGraph();
 
     line_list.header.stamp = ros::Time::now();
     line_list.points.clear();
@@ -643,8 +859,16 @@ bool RobotTrajectorySaver::saveRobotTrajectoriesCallback(robot_trajectory_saver_
     visualize(line_list);
     trajectories_marker_pub.publish(line_list);
 
-    std::ofstream dotfile(request.file_path.c_str());
-    write_graphviz(dotfile, *graph_ptr, WriteVertexPosition<Graph>(*graph_ptr), WriteEdgeWeight<Graph>(*graph_ptr));
+    if (save_dot_file)
+    {
+        /* text format for debugging */
+        std::ofstream dotfile(request.file_path.c_str());
+        write_graphviz(dotfile, *graph_ptr, WriteVertexPosition<Graph>(*graph_ptr), WriteEdgeWeight<Graph>(*graph_ptr));
+    }
+    else
+    {
+        writeBinaryGraph(request.file_path, *graph_ptr);
+    }
     return true;
 
 }
@@ -668,7 +892,7 @@ void RobotTrajectorySaver::navMsgToStampedTransform(int robot_id, const nav_msgs
         q.setW(msg->poses[i].pose.orientation.w);
         robot_pose_map.setRotation(q);
 
-        ugv_trajectories[robot_id].global_robot_poses.push_back(robot_pose_map);
+        addGlobalRobotPose(robot_id, robot_pose_map);
     }
 }
 
@@ -718,7 +942,7 @@ void RobotTrajectorySaver::imuOdomCallbackUgv1(const nav_msgs::OdometryConstPtr&
             tf::StampedTransform from_odom_to_map;
             tf_.lookupTransform(global_frame, ugv_trajectories[0].robot_frame_, msg->header.stamp, robot_pose_map);
             tf_.lookupTransform(global_frame, ugv_trajectories[0].odom_frame_, msg->header.stamp, from_odom_to_map);
-            ugv_trajectories[0].global_robot_poses.push_back(robot_pose_map);
+            addGlobalRobotPose(0, robot_pose_map);
             ugv_trajectories[0].from_odoms_to_map.push_back(from_odom_to_map);
         }
         catch (tf::LookupException& ex)
@@ -743,7 +967,7 @@ void RobotTrajectorySaver::imuOdomCallbackUgv1(const nav_msgs::OdometryConstPtr&
         robot_pose_map.setBasis(transformation.getBasis());
         robot_pose_map.setOrigin(transformation.getOrigin());
         robot_pose_map.setRotation(transformation.getRotation());
-        ugv_trajectories[0].global_robot_poses.push_back(robot_pose_map);
+        addGlobalRobotPose(0, robot_pose_map);
     }
 }
 
@@ -761,7 +985,7 @@ void RobotTrajectorySaver::imuOdomCallbackUgv2(const nav_msgs::OdometryConstPtr&
             tf::StampedTransform from_odom_to_map;
             tf_.lookupTransform(global_frame, ugv_trajectories[1].robot_frame_, msg->header.stamp, robot_pose_map);
             tf_.lookupTransform(global_frame, ugv_trajectories[1].odom_frame_, msg->header.stamp, from_odom_to_map);
-            ugv_trajectories[1].global_robot_poses.push_back(robot_pose_map);
+            addGlobalRobotPose(1, robot_pose_map);
             ugv_trajectories[1].from_odoms_to_map.push_back(from_odom_to_map);
         }
         catch (tf::LookupException& ex)
@@ -786,7 +1010,7 @@ void RobotTrajectorySaver::imuOdomCallbackUgv2(const nav_msgs::OdometryConstPtr&
         robot_pose_map.setBasis(transformation.getBasis());
         robot_pose_map.setOrigin(transformation.getOrigin());
         robot_pose_map.setRotation(transformation.getRotation());
-        ugv_trajectories[1].global_robot_poses.push_back(robot_pose_map);
+        addGlobalRobotPose(1, robot_pose_map);
     }
 }
 
@@ -796,102 +1020,43 @@ void RobotTrajectorySaver::initTrajectoriesFromExistingDotFile()
     if (cloud_in_init_graph) delete cloud_in_init_graph;
     cloud_in_init_graph = new pcl::PointCloud<pcl::PointXYZ>();
 
+    if (graph_ptr) delete graph_ptr;
     graph_ptr = new Graph(0);
 
-    VertexPositions v_positions = get(vertex_properties, *graph_ptr);
-
-    std::vector<int> indexes;
-    std::vector<Point3D> coordinates;
-
-    std::ifstream graph_filename;
-
-    if (exist_file(map_filename))
+    if (!exist_file(map_filename))
     {
+        std::cout << "Trajectory Graph can not initialized. File does not exists!" << std::endl;
+        return;
+    }
 
-        graph_filename.open(map_filename.c_str());
-
-        if (!empty_file(graph_filename))
-        {
-
-            std::string line;
-            while (std::getline(graph_filename, line))
-            {
-
-                int id;
-                double x, y, z;
-                // Nodes are under the form 163 [x = 7.59997, y = 2.56912, z = 2.39076];
-                if (sscanf(line.c_str(), "%d %*s = %lf, %*s = %lf, %*s = %lf %*s", &id, &x, &y, &z) == 4)
-                {
-                    //std::cout << "Node ID " << id << " x = " << x << " y = " << y << " z = " << z << "\n";
-                    indexes.push_back(id);
-                    Point3D p;
-                    p.x = x;
-                    p.y = y;
-                    p.z = z;
-                    coordinates.push_back(p);
-                    pcl::PointXYZ q;
-                    q.x = p.x;
-                    q.y = p.y;
-                    q.z = p.z;
-                    cloud_in_init_graph->points.push_back(q);
-                }
-
-                int i, j;
-                double w;
-                // Edges are under the form 8--18  [weight = "0.718538"];
-                if (sscanf(line.c_str(), "%d--%d %*s = \"%lf\" %*s", &i, &j, &w) == 3)
-                {
-                    //std::cout << "Edge=[" << i << "," << j << "] weight=" << w << "\n";
-
-                    Edge e = add_edge(i, j, w, *graph_ptr).first;
-                    Vertex s = source(e, *graph_ptr);
-
-                    int i_source, i_target;
-                    for (int k = 0; k < indexes.size(); k++)
-                    {
-                        if (indexes[k] == i)
-                        {
-                            i_source = k;
-                        }
-                        if (indexes[k] == j)
-                        {
-                            i_target = k;
-                        }
-                    }
-
-                    v_positions[s] = coordinates[i_source];
-
-                    Vertex t = target(e, *graph_ptr);
-                    v_positions[t] = coordinates[i_target];
-
-                }
-            }
-            graph_filename.close();
-
-            line_list.header.stamp = ros::Time::now();
-            line_list.points.clear();
-            line_list.colors.clear();
-            visualize(line_list);
-            trajectories_marker_pub.publish(line_list);
-            //write_graphviz(std::cout, *graph_ptr, write_vertex_position<Graph>(*graph_ptr), write_edge_weight<Graph>(*graph_ptr));
-            //read_file = true;
-        }
-        else
-        {
-            std::cout << "Trajectory Graph can not initialized. File is empty!" << std::endl;
-            if (cloud_in_init_graph) delete cloud_in_init_graph;
-            cloud_in_init_graph = new pcl::PointCloud<pcl::PointXYZ>();
-            cloud_in_init_graph->points.resize(0);
-        }
-
+    ros::WallTime start_time = ros::WallTime::now();
+    if (!readGraph(map_filename, *graph_ptr))
+    {
+        std::cout << "Trajectory Graph can not initialized. File is empty!" << std::endl;
+        return;
     }
-    else
+
+    VertexPositions v_positions = get(vertex_properties, *graph_ptr);
+    std::pair<vertex_iterator, vertex_iterator> vp;
+    for (vp = vertices(*graph_ptr); vp.first != vp.second; ++vp.first)
     {
-        std::cout << "Trajectory Graph can not initialized. File does not exists!" << std::endl;
-        if (cloud_in_init_graph) delete cloud_in_init_graph;
-        cloud_in_init_graph = new pcl::PointCloud<pcl::PointXYZ>();
-        cloud_in_init_graph->points.resize(0);
+        Point3D p = v_positions[*vp.first];
+        pcl::PointXYZ q;
+        q.x = p.x;
+        q.y = p.y;
+        q.z = p.z;
+        cloud_in_init_graph->points.push_back(q);
+        trajectory_voxels.insert(q.x, q.y, q.z);
     }
+    resetPathCache();
+
+    std::cout << "Trajectory graph loaded from " << map_filename << ": " << num_vertices(*graph_ptr) << " vertices, " << num_edges(*graph_ptr) << " edges in " << (ros::WallTime::now() - start_time).toSec() << " s" << std::endl;
+
+    line_list.header.stamp = ros::Time::now();
+    line_list.points.clear();
+    line_list.colors.clear();
+    visualize(line_list);
+    trajectories_marker_pub.publish(line_list);
 }
 
 void RobotTrajectorySaver::initRobotTrajectories()
@@ -919,7 +1084,7 @@ bool RobotTrajectorySaver::initRobotTrajectory(int i)
             tf_.lookupTransform(ugv_trajectories[i].odom_frame_, ugv_trajectories[i].robot_frame_, ros::Time(), robot_pose_odom);
             tf_.lookupTransform(global_frame, ugv_trajectories[i].odom_frame_, ros::Time(), from_odom_to_map);
             
-            ugv_trajectories[i].global_robot_poses.push_back(robot_pose_map);
+            addGlobalRobotPose(i, robot_pose_map);
             ugv_trajectories[i].odom_robot_poses.push_back(robot_pose_odom);
             ugv_trajectories[i].from_odoms_to_map.push_back(from_odom_to_map);
 
@@ -973,7 +1138,7 @@ bool RobotTrajectorySaver::updateRobotPose(int i)
             tf_.lookupTransform(global_frame, ugv_trajectories[i].robot_frame_, ros::Time(), robot_pose_map);
             tf_.lookupTransform(ugv_trajectories[i].odom_frame_, ugv_trajectories[i].robot_frame_, ros::Time(), robot_pose_odom);
             tf_.lookupTransform(global_frame, ugv_trajectories[i].odom_frame_, ros::Time(), from_odom_to_map);
-            ugv_trajectories[i].global_robot_poses.push_back(robot_pose_map);
+            addGlobalRobotPose(i, robot_pose_map);
             ugv_trajectories[i].odom_robot_poses.push_back(robot_pose_odom);
             ugv_trajectories[i].from_odoms_to_map.push_back(from_odom_to_map);
 
@@ -1014,7 +1179,7 @@ void RobotTrajectorySaver::ros_spin()
     }
 }
 
-RobotTrajectorySaver::RobotTrajectorySaver() : n_("~"), tf_(), graph_ptr(0L), cloud_in_init_graph(0L)
+RobotTrajectorySaver::RobotTrajectorySaver() : n_("~"), tf_(), graph_ptr(0L), cloud_in_init_graph(0L), heuristic_scale(0)
 {
 
     read_file = false;
@@ -1032,6 +1197,8 @@ RobotTrajectorySaver::RobotTrajectorySaver() : n_("~"), tf_(), graph_ptr(0L), cl
 
     map_filename = getParam<std::string>(n_, "map", "vrep3D.dot");
 
+    save_dot_file = getParam<bool>(n_, "save_dot_file", false);
+
     ugv_trajectories.clear();
     for (int i = 0; i < num_robots; i++)
     {
@@ -1128,6 +1295,7 @@ RobotTrajectorySaver::RobotTrajectorySaver() : n_("~"), tf_(), graph_ptr(0L), cl
     frequency = getParam<double>(n_, "frequency", 1);
 
     leaf_size = getParam<double>(n_, "leaf_size", 1);
+    trajectory_voxels.setLeafSize(leaf_size);
 
     min_radius = getParam<double>(n_, "min_radius", 1);
     max_radius = getParam<double>(n_, "max_radius", 3.5);
@@ -1159,6 +1327,9 @@ RobotTrajectorySaver::RobotTrajectorySaver() : n_("~"), tf_(), graph_ptr(0L), cl
     check_path_service_name = getParam<std::string>(n_, "check_path_service_name", "check_path");
     check_path = n_.advertiseService(check_path_service_name, &RobotTrajectorySaver::checkPath, this);
 
+    check_paths_service_name = getParam<std::string>(n_, "check_paths_service_name", "check_paths");
+    check_paths = n_.advertiseService(check_paths_service_name, &RobotTrajectorySaver::checkPaths, this);
+
     pthread_mutex_init(&lock_robot_trajectories, NULL);
 
 
@@ -0,0 +1,142 @@
+/*********************************************************************
+ *
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016,
+ *  TU Dortmund - Institute of Control Theory and Systems Engineering.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the institute nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: Luigi Freda
+ *********************************************************************/
+
+#ifndef FOOTPRINT_DISTANCE_FIELD_H
+#define FOOTPRINT_DISTANCE_FIELD_H
+
+#include <vector>
+
+#include <teb_local_planner/distance_calculations.h>
+
+
+namespace teb_local_planner
+{
+
+/**
+ * @class FootprintDistanceField
+ * @brief Precomputed signed distance field of a polygon footprint in the robot frame
+ * 
+ * The signed distance to the polygon (negative inside) is sampled on a regular grid covering the bounding box
+ * of the polygon enlarged by a margin. Queries are answered by bilinear interpolation of the grid samples
+ * in constant time (independently of the number of vertices). Points outside the grid are not answered:
+ * the caller is expected to fall back to the exact distance computation.
+ */
+class FootprintDistanceField
+{
+public:
+
+  static const int kMaxNumSamples; //!< The field is not built if it requires more samples
+
+  /**
+   * @brief Construct an empty (invalid) field
+   */
+  FootprintDistanceField();
+
+  /**
+   * @brief Sample the signed distance field of a closed polygon
+   * @param vertices polygon vertices in the robot frame (do not repeat the first and last vertex at the end)
+   * @param resolution distance between two grid samples [m]
+   * @param margin the grid covers the bounding box of the polygon enlarged by this margin [m]
+   * @return \c true if the field is built, \c false if the parameters are invalid or the grid would be too large
+   */
+  bool build(const Point2dContainer& vertices, double resolution, double margin);
+
+  /**
+   * @brief Release the grid (the field becomes invalid)
+   */
+  void clear();
+
+  /**
+   * @brief Check whether the field has been built
+   */
+  bool isValid() const {return !values_.empty();}
+
+  /**
+   * @brief Get the signed distance of a point to the polygon by bilinear interpolation
+   * @param point query point in the robot frame
+   * @param[out] distance signed distance to the polygon boundary (negative inside)
+   * @return \c false if the point is outside the grid (\c distance is not set)
+   */
+  bool getDistance(const Eigen::Vector2d& point, double& distance) const
+  {
+    const double fx = (point.x() - origin_x_) * inv_resolution_;
+    const double fy = (point.y() - origin_y_) * inv_resolution_;
+    // the negated comparisons also reject NaN
+    if (!(fx >= 0.0 && fy >= 0.0 && fx < max_coord_x_ && fy < max_coord_y_))
+      return false;
+
+    const int ix = static_cast<int>(fx);
+    const int iy = static_cast<int>(fy);
+    const double tx = fx - ix;
+    const double ty = fy - iy;
+
+    const double* v = &values_[iy * size_x_ + ix];
+    const double v0 = v[0] + tx * (v[1] - v[0]);
+    const double v1 = v[size_x_] + tx * (v[size_x_ + 1] - v[size_x_]);
+    distance = v0 + ty * (v1 - v0);
+    return true;
+  }
+
+  double resolution() const {return resolution_;} //!< Return the distance between two grid samples [m]
+  double margin() const {return margin_;} //!< Return the margin around the bounding box of the polygon [m]
+
+  /**
+   * @brief Signed distance of a point to a closed polygon (negative inside)
+   * @param point 2D point
+   * @param vertices polygon vertices (do not repeat the first and last vertex at the end)
+   * @return signed distance
+   */
+  static double computeSignedDistance(const Eigen::Vector2d& point, const Point2dContainer& vertices);
+
+private:
+
+  double origin_x_; //!< Position of the first sample (lower left corner of the grid)
+  double origin_y_;
+  double resolution_;
+  double inv_resolution_;
+  double margin_;
+  int size_x_; //!< Number of samples along x
+  int size_y_; //!< Number of samples along y
+  double max_coord_x_; //!< size_x_-1: queries must fall inside the last cell
+  double max_coord_y_; //!< size_y_-1: queries must fall inside the last cell
+  std::vector<double> values_; //!< Row-major samples (y rows of size_x_ values)
+};
+
+} // namespace teb_local_planner
+
+#endif /* FOOTPRINT_DISTANCE_FIELD_H */
@@ -0,0 +1,299 @@
+/*********************************************************************
+ *
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016,
+ *  TU Dortmund - Institute of Control Theory and Systems Engineering.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the institute nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * Notes:
+ * The following class is derived from a class defined by the
+ * g2o-framework. g2o is licensed under the terms of the BSD License.
+ * Refer to the base class source for detailed licensing information.
+ *
+ * Author: Luigi Freda
+ *********************************************************************/
+
+
+#ifndef EDGE_DIFF_DRIVE_H
+#define EDGE_DIFF_DRIVE_H
+
+#include <teb_local_planner/g2o_types/vertex_pose.h>
+#include <teb_local_planner/g2o_types/vertex_timediff.h>
+#include <teb_local_planner/g2o_types/base_teb_edges.h>
+#include <teb_local_planner/g2o_types/penalties.h>
+#include <teb_local_planner/teb_config.h>
+#include <teb_local_planner/misc.h>
+
+
+namespace teb_local_planner
+{
+
+/**
+ * @class DiffDriveSegment
+ * @brief Signed translational velocity and angular velocity between two consecutive poses and their derivatives
+ * 
+ * The velocity is computed as in EdgeVelocity and EdgeAcceleration (Euclidean distance, direction given by 
+ * a fast sigmoid of the projection of the displacement on the heading of the first pose).
+ * The derivatives are taken w.r.t. the states of the poses and of the time difference.
+ */
+struct DiffDriveSegment
+{
+  /**
+   * @brief Compute velocities and derivatives of the segment
+   * @param position1 position of the first pose
+   * @param theta1 orientation of the first pose
+   * @param position2 position of the second pose
+   * @param theta2 orientation of the second pose
+   * @param dt time difference between the two poses
+   */
+  void compute(const Eigen::Vector2d& position1, double theta1, const Eigen::Vector2d& position2, double theta2, double dt)
+  {
+    const Eigen::Vector2d delta = position2 - position1;
+    const double cos1 = std::cos(theta1);
+    const double sin1 = std::sin(theta1);
+    const double dist = delta.norm();
+    
+    // direction: fast_sigmoid(s) = s/(1+|s|), fast_sigmoid'(s) = 1/(1+|s|)^2
+    const double s = 100 * (delta.x()*cos1 + delta.y()*sin1);
+    const double denom = 1 + std::fabs(s);
+    const double sigma = s / denom;
+    const double dsigma_ds = 100 / (denom*denom); // including the derivative of the argument
+    
+    dt_inv = 1 / dt;
+    vel = dist * dt_inv * sigma;
+    omega = g2o::normalize_theta(theta2 - theta1) * dt_inv;
+
+    const double aux = dist * dt_inv * dsigma_ds;
+    dvel_dposition2 = aux * Eigen::Vector2d(cos1, sin1);
+    if (dist > 0)
+      dvel_dposition2 += (dt_inv * sigma / dist) * delta;
+    dvel_dtheta1 = aux * (-delta.x()*sin1 + delta.y()*cos1);
+    dvel_ddt = -vel * dt_inv;
+  }
+
+  double dt_inv; //!< Inverse of the time difference
+  double vel; //!< Signed translational velocity
+  double omega; //!< Angular velocity
+  Eigen::Vector2d dvel_dposition2; //!< Derivative of vel w.r.t. the second position (the one w.r.t. the first position is its opposite)
+  double dvel_dtheta1; //!< Derivative of vel w.r.t. the first orientation (vel does not depend on the second one)
+  double dvel_ddt; //!< Derivative of vel w.r.t. the time difference
+  // omega derivatives: -dt_inv (theta1), dt_inv (theta2), -omega*dt_inv (dt)
+  
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+
+/**
+ * @class EdgeVelocityDiffDrive
+ * @brief Variant of EdgeVelocity for differential drive robots with analytic Jacobians.
+ * 
+ * The cost function is the one of EdgeVelocity with the Euclidean approximation of the arc length
+ * (trajectory.exact_arc_length disabled). The Jacobians are computed analytically in fixed-size blocks
+ * instead of by numeric differentiation.
+ * @see EdgeVelocity, TebOptimalPlanner::AddEdgesVelocity
+ * @remarks Do not forget to call setTebConfig()
+ */
+class EdgeVelocityDiffDrive : public BaseTebMultiEdge<2, double>
+{
+public:
+  
+  /**
+   * @brief Construct edge.
+   */	      
+  EdgeVelocityDiffDrive()
+  {
+    this->resize(3); // Since we derive from a g2o::BaseMultiEdge, set the desired number of vertices
+  }
+  
+  /**
+   * @brief Actual cost function
+   */  
+  void computeError()
+  {
+    ROS_ASSERT_MSG(cfg_, "You must call setTebConfig on EdgeVelocityDiffDrive()");
+    computeSegment();
+    
+    _error[0] = penaltyBoundToInterval(segment_.vel, -cfg_->robot.max_vel_x_backwards, cfg_->robot.max_vel_x,cfg_->optim.penalty_epsilon);
+    _error[1] = penaltyBoundToInterval(segment_.omega, cfg_->robot.max_vel_theta,cfg_->optim.penalty_epsilon);
+
+    ROS_ASSERT_MSG(std::isfinite(_error[0]), "EdgeVelocityDiffDrive::computeError() _error[0]=%f _error[1]=%f\n",_error[0],_error[1]);
+  }
+
+  /**
+   * @brief Jacobi matrix of the cost function specified in computeError().
+   */
+  void linearizeOplus()
+  {
+    ROS_ASSERT_MSG(cfg_, "You must call setTebConfig on EdgeVelocityDiffDrive()");
+    computeSegment();
+    
+    const double dev_vel = penaltyBoundToIntervalDerivative(segment_.vel, -cfg_->robot.max_vel_x_backwards, cfg_->robot.max_vel_x,cfg_->optim.penalty_epsilon);
+    const double dev_omega = penaltyBoundToIntervalDerivative(segment_.omega, cfg_->robot.max_vel_theta,cfg_->optim.penalty_epsilon);
+    const Eigen::Vector2d dvel_dpos = dev_vel * segment_.dvel_dposition2;
+    const double domega_dtheta = dev_omega * segment_.dt_inv;
+    
+    Eigen::Matrix<double,2,3> jacobian_conf1;
+    jacobian_conf1 << -dvel_dpos.x(), -dvel_dpos.y(), dev_vel * segment_.dvel_dtheta1,
+                      0,              0,              -domega_dtheta;
+    Eigen::Matrix<double,2,3> jacobian_conf2;
+    jacobian_conf2 << dvel_dpos.x(),  dvel_dpos.y(),  0,
+                      0,              0,              domega_dtheta;
+    Eigen::Matrix<double,2,1> jacobian_dt;
+    jacobian_dt << dev_vel * segment_.dvel_ddt, -domega_dtheta * segment_.omega;
+    
+    _jacobianOplus[0] = jacobian_conf1;
+    _jacobianOplus[1] = jacobian_conf2;
+    _jacobianOplus[2] = jacobian_dt;
+  }
+  
+protected:
+  
+  void computeSegment()
+  {
+    const VertexPose* conf1 = static_cast<const VertexPose*>(_vertices[0]);
+    const VertexPose* conf2 = static_cast<const VertexPose*>(_vertices[1]);
+    const VertexTimeDiff* deltaT = static_cast<const VertexTimeDiff*>(_vertices[2]);
+    segment_.compute(conf1->position(), conf1->theta(), conf2->position(), conf2->theta(), deltaT->dt());
+  }
+  
+  DiffDriveSegment segment_; //!< Velocities and derivatives at the current estimate
+  
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+
+/**
+ * @class EdgeAccelerationDiffDrive
+ * @brief Variant of EdgeAcceleration for differential drive robots with analytic Jacobians.
+ * 
+ * The cost function is the one of EdgeAcceleration with the Euclidean approximation of the arc length
+ * (trajectory.exact_arc_length disabled). The Jacobians are computed analytically in fixed-size blocks
+ * instead of by numeric differentiation.
+ * @see EdgeAcceleration, TebOptimalPlanner::AddEdgesAcceleration
+ * @remarks Do not forget to call setTebConfig()
+ */
+class EdgeAccelerationDiffDrive : public BaseTebMultiEdge<2, double>
+{
+public:
+
+  /**
+   * @brief Construct edge.
+   */ 
+  EdgeAccelerationDiffDrive()
+  {
+    this->resize(5);
+  }
+    
+  /**
+   * @brief Actual cost function
+   */   
+  void computeError()
+  {
+    ROS_ASSERT_MSG(cfg_, "You must call setTebConfig on EdgeAccelerationDiffDrive()");
+    computeSegments();
+    
+    _error[0] = penaltyBoundToInterval(acc_lin_, cfg_->robot.acc_lim_x, cfg_->optim.penalty_epsilon);
+    _error[1] = penaltyBoundToInterval(acc_rot_, cfg_->robot.acc_lim_theta, cfg_->optim.penalty_epsilon);
+
+    ROS_ASSERT_MSG(std::isfinite(_error[0]), "EdgeAccelerationDiffDrive::computeError() translational: _error[0]=%f\n",_error[0]);
+    ROS_ASSERT_MSG(std::isfinite(_error[1]), "EdgeAccelerationDiffDrive::computeError() rotational: _error[1]=%f\n",_error[1]);
+  }
+
+  /**
+   * @brief Jacobi matrix of the cost function specified in computeError().
+   */
+  void linearizeOplus()
+  {
+    ROS_ASSERT_MSG(cfg_, "You must call setTebConfig on EdgeAccelerationDiffDrive()");
+    computeSegments();
+    
+    // derivatives of the penalties including the factor 2/(dt1+dt2) of the accelerations
+    const double dev_lin = penaltyBoundToIntervalDerivative(acc_lin_, cfg_->robot.acc_lim_x, cfg_->optim.penalty_epsilon) * aux_;
+    const double dev_rot = penaltyBoundToIntervalDerivative(acc_rot_, cfg_->robot.acc_lim_theta, cfg_->optim.penalty_epsilon) * aux_;
+    const Eigen::Vector2d dacc_dpos1 = dev_lin * segment1_.dvel_dposition2;
+    const Eigen::Vector2d dacc_dpos3 = dev_lin * segment2_.dvel_dposition2;
+    const Eigen::Vector2d dacc_dpos2 = -dacc_dpos1 - dacc_dpos3;
+    
+    Eigen::Matrix<double,2,3> jacobian_pose1;
+    jacobian_pose1 << dacc_dpos1.x(), dacc_dpos1.y(), -dev_lin * segment1_.dvel_dtheta1,
+                      0,              0,              dev_rot * segment1_.dt_inv;
+    Eigen::Matrix<double,2,3> jacobian_pose2;
+    jacobian_pose2 << dacc_dpos2.x(), dacc_dpos2.y(), dev_lin * segment2_.dvel_dtheta1,
+                      0,              0,              -dev_rot * (segment1_.dt_inv + segment2_.dt_inv);
+    Eigen::Matrix<double,2,3> jacobian_pose3;
+    jacobian_pose3 << dacc_dpos3.x(), dacc_dpos3.y(), 0,
+                      0,              0,              dev_rot * segment2_.dt_inv;
+    Eigen::Matrix<double,2,1> jacobian_dt1;
+    jacobian_dt1 << dev_lin * (-segment1_.dvel_ddt - 0.5*acc_lin_), dev_rot * (segment1_.omega * segment1_.dt_inv - 0.5*acc_rot_);
+    Eigen::Matrix<double,2,1> jacobian_dt2;
+    jacobian_dt2 << dev_lin * (segment2_.dvel_ddt - 0.5*acc_lin_), dev_rot * (-segment2_.omega * segment2_.dt_inv - 0.5*acc_rot_);
+    
+    _jacobianOplus[0] = jacobian_pose1;
+    _jacobianOplus[1] = jacobian_pose2;
+    _jacobianOplus[2] = jacobian_pose3;
+    _jacobianOplus[3] = jacobian_dt1;
+    _jacobianOplus[4] = jacobian_dt2;
+  }
+  
+protected:
+  
+  void computeSegments()
+  {
+    const VertexPose* pose1 = static_cast<const VertexPose*>(_vertices[0]);
+    const VertexPose* pose2 = static_cast<const VertexPose*>(_vertices[1]);
+    const VertexPose* pose3 = static_cast<const VertexPose*>(_vertices[2]);
+    const VertexTimeDiff* dt1 = static_cast<const VertexTimeDiff*>(_vertices[3]);
+    const VertexTimeDiff* dt2 = static_cast<const VertexTimeDiff*>(_vertices[4]);
+    
+    segment1_.compute(pose1->position(), pose1->theta(), pose2->position(), pose2->theta(), dt1->dt());
+    segment2_.compute(pose2->position(), pose2->theta(), pose3->position(), pose3->theta(), dt2->dt());
+    
+    aux_ = 2 / (dt1->dt() + dt2->dt());
+    acc_lin_ = (segment2_.vel - segment1_.vel) * aux_;
+    acc_rot_ = (segment2_.omega - segment1_.omega) * aux_;
+  }
+  
+  DiffDriveSegment segment1_; //!< Velocities and derivatives of the first segment at the current estimate
+  DiffDriveSegment segment2_; //!< Velocities and derivatives of the second segment at the current estimate
+  double aux_; //!< 2/(dt1+dt2)
+  double acc_lin_; //!< Translational acceleration
+  double acc_rot_; //!< Rotational acceleration
+      
+public: 
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+
+} // end namespace
+
+#endif // EDGE_DIFF_DRIVE_H
@@ -62,6 +62,7 @@
 #include <teb_local_planner/equivalence_relations.h>
 #include <teb_local_planner/pose_se2.h>
 #include <teb_local_planner/teb_config.h>
+#include <teb_local_planner/obstacle_index.h>
 
 namespace teb_local_planner
 {
@@ -140,10 +141,76 @@ protected:
    */
   void DepthFirst(HcGraph& g, std::vector<HcGraphVertexType>& visited, const HcGraphVertexType& goal, double start_orientation, double goal_orientation, const geometry_msgs::Twist* start_velocity, bool free_goal_vel = false);
 
+  /**
+   * @brief Best-first search of the cheapest paths of distinct homotopy classes between the start and the specified goal vertex.
+   *
+   * Partial paths are expanded in the order of their length plus the distance to the goal and carry the H-signature of their prefix,
+   * accumulated edge by edge (refer to HSignatureSegments). A partial path is pruned if a cheaper one with an equivalent prefix
+   * has already been expanded from the same vertex, or if hcp.max_number_classes distinct prefixes have been expanded from it.
+   * Complete paths are passed to the planner in the order of their length, the search stops as soon as hcp.max_number_classes
+   * trajectories are available.
+   * @param g Graph on which the search should be performed
+   * @param start Start vertex
+   * @param goal Desired goal vertex
+   * @param start_orientation Orientation of the first trajectory pose, required to initialize the trajectory/TEB
+   * @param goal_orientation Orientation of the goal trajectory pose, required to initialize the trajectory/TEB
+   * @param start_velocity start velocity (optional)
+   * @param free_goal_vel if \c true, a nonzero final velocity at the goal pose is allowed, otherwise the final velocity will be zero (default: false)
+   */
+  void BestFirst(const HcGraph& g, const HcGraphVertexType& start, const HcGraphVertexType& goal, double start_orientation, double goal_orientation, const geometry_msgs::Twist* start_velocity, bool free_goal_vel = false);
+
+  /**
+   * @brief Find the paths between the start and the goal vertex and pass them to the planner
+   *
+   * Calls BestFirst() or DepthFirst() depending on hcp.graph_search_best_first.
+   * @param start Start vertex
+   * @param goal Desired goal vertex
+   * @param start_orientation Orientation of the first trajectory pose, required to initialize the trajectory/TEB
+   * @param goal_orientation Orientation of the goal trajectory pose, required to initialize the trajectory/TEB
+   * @param start_velocity start velocity (optional)
+   * @param free_goal_vel if \c true, a nonzero final velocity at the goal pose is allowed, otherwise the final velocity will be zero (default: false)
+   */
+  void searchPaths(const HcGraphVertexType& start, const HcGraphVertexType& goal, double start_orientation, double goal_orientation, const geometry_msgs::Twist* start_velocity, bool free_goal_vel = false);
+
+  /**
+   * @brief Return a spatial index valid for the current obstacle container of the planner
+   *
+   * The index of the HomotopyClassPlanner is used if it is up to date, otherwise the own index is rebuilt.
+   * @return pointer to the index or \c NULL if there are no obstacles
+   */
+  const ObstacleGridIndex* updateObstacleIndex();
+
+  /**
+   * @brief Check if the edge between two vertices intersects an obstacle
+   *
+   * Only the obstacles returned by the spatial index around the edge are tested.
+   * @param index spatial index of the obstacles (see updateObstacleIndex())
+   * @param line_start start of the edge
+   * @param line_end end of the edge
+   * @param min_dist minimum distance to the obstacles
+   * @return \c true if the edge intersects an obstacle
+   */
+  bool checkEdgeCollision(const ObstacleGridIndex* index, const Eigen::Vector2d& line_start, const Eigen::Vector2d& line_end, double min_dist);
+
+  /**
+   * @brief Add the collision free edges from a vertex to the given candidate vertices
+   *
+   * If hcp.roadmap_graph_max_neighbors is positive, only the edges to the nearest collision free candidates are added.
+   * The edges are added in the order of the candidates, so that the graph does not depend on the pruning.
+   * @param vertex vertex from which the edges start
+   * @param[in,out] candidates candidate end vertices of the edges (in vertex order), reordered by the method
+   * @param index spatial index of the obstacles (see updateObstacleIndex()), no collision check if \c NULL
+   * @param min_dist minimum distance to the obstacles
+   */
+  void addCandidateEdges(HcGraphVertexType vertex, std::vector<HcGraphVertexType>& candidates, const ObstacleGridIndex* index, double min_dist);
+
 
 protected:
     const TebConfig* cfg_; //!< Config class that stores and manages all related parameters
     HomotopyClassPlanner* const hcp_; //!< Raw pointer to the HomotopyClassPlanner. The HomotopyClassPlanner itself is guaranteed to outlive the graph search class it is holding.
+    ObstacleGridIndex obstacle_index_; //!< Own spatial index over the obstacles, used if the planner does not provide an up to date one
+    std::vector<int> obstacle_candidates_; //!< Buffer for the obstacle candidates of the edge collision checks
+    std::vector<HcGraphVertexType> vertex_candidates_; //!< Buffer for the candidate end vertices of the edges
 
 public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
@@ -183,7 +250,7 @@ public:
 class ProbRoadmapGraph : public GraphSearchInterface
 {
 public:
-  ProbRoadmapGraph(const TebConfig& cfg, HomotopyClassPlanner* hcp) : GraphSearchInterface(cfg, hcp){}
+  ProbRoadmapGraph(const TebConfig& cfg, HomotopyClassPlanner* hcp) : GraphSearchInterface(cfg, hcp), samples_start_(Eigen::Vector2d::Zero()), samples_goal_(Eigen::Vector2d::Zero()), samples_area_width_(0), samples_area_length_scale_(0){}
 
   virtual ~ProbRoadmapGraph(){}
 
@@ -209,6 +276,16 @@ public:
 
 private:
     boost::random::mt19937 rnd_generator_; //!< Random number generator used by createProbRoadmapGraph to sample graph keypoints.
+
+    //! Samples of the last roadmap (reused while start and goal do not move more than hcp.roadmap_graph_resample_distance)
+    Point2dContainer samples_;
+    Eigen::Vector2d samples_start_; //!< Start position of the last roadmap
+    Eigen::Vector2d samples_goal_; //!< Goal position of the last roadmap
+    double samples_area_width_; //!< Area width of the last roadmap
+    double samples_area_length_scale_; //!< Area length scale of the last roadmap
+
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 };
 } // end namespace
 
@@ -56,6 +56,133 @@
 namespace teb_local_planner
 {
 
+/**
+ * @brief Contributions of the path segments to the H-signature (refer to HSignature)
+ *
+ * The H-signature of a path is the sum of the contributions of its segments. The obstacle dependent coefficients
+ * only depend on the start and end point of the path: they are computed once at construction, so that the
+ * H-signature can be accumulated segment by segment (e.g. along the partial paths of a graph search).
+ */
+class HSignatureSegments
+{
+public:
+    typedef std::complex<long double> cplx;
+
+    /**
+    * @brief Compute the obstacle coefficients for paths between the given start and end point
+    * @param cfg TebConfig storing some user configuration options
+    * @param obstacles obstacle container (can be NULL)
+    * @param start start point of the paths
+    * @param end end point of the paths
+    */
+    HSignatureSegments(const TebConfig& cfg, const ObstContainer* obstacles, const cplx& start, const cplx& end)
+    {
+        if (obstacles == NULL || obstacles->empty())
+            return;
+
+        // guess values for f0
+        // paper proposes a+b=N-1 && |a-b|<=1, 1...N obstacles
+        int m = std::max( (int)obstacles->size()-1, 5 );  // for only a few obstacles we need a min threshold in order to get significantly high H-Signatures
+
+        int a = (int) std::ceil(double(m)/2.0);
+        int b = m-a;
+
+        // guess map size (only a really really coarse guess is required
+        // use distance from start to goal as distance to each direction
+        cplx delta = end-start;
+        cplx normal(-delta.imag(), delta.real());
+        cplx map_bottom_left;
+        cplx map_top_right;
+        if (std::abs(delta) < 3.0)
+        { // set minimum bound on distance (we do not want to have numerical instabilities) and 3.0 performs fine...
+            map_bottom_left = start + cplx(0, -3);
+            map_top_right = start + cplx(3, 3);
+        }
+        else
+        {
+            map_bottom_left = start - normal;
+            map_top_right = start + delta + normal;
+        }
+
+        centroids_.resize(obstacles->size());
+        for (std::size_t l=0; l<obstacles->size(); ++l)
+            centroids_[l] = obstacles->at(l)->getCentroidCplx();
+
+        coefficients_.resize(obstacles->size());
+        for (std::size_t l=0; l<obstacles->size(); ++l) // iterate all obstacles
+        {
+            const cplx& obst_l = centroids_[l];
+            //cplx f0 = (long double) prescaler * std::pow(obst_l-map_bottom_left,a) * std::pow(obst_l-map_top_right,b);
+            cplx f0 = (long double) cfg.hcp.h_signature_prescaler * (long double)a*(obst_l-map_bottom_left) * (long double)b*(obst_l-map_top_right);
+
+            // denum contains product with all obstacles exepct j==l
+            cplx Al = f0;
+            for (std::size_t j=0; j<obstacles->size(); ++j)
+            {
+                if (j==l)
+                    continue;
+                cplx diff = obst_l - centroids_[j];
+                //if (diff.real()!=0 || diff.imag()!=0)
+                if (std::abs(diff)<0.05) // skip really close obstacles
+                    continue;
+                 else
+                    Al /= diff;
+            }
+            coefficients_[l] = Al;
+        }
+    }
+
+    /**
+    * @brief Contribution of the segment [z1, z2] to the H-signature
+    * @param z1 start of the segment
+    * @param z2 end of the segment
+    * @return value to be added to the H-signature of the path
+    */
+    cplx segmentValue(const cplx& z1, const cplx& z2) const
+    {
+        cplx value = 0;
+        double imag_proposals[5];
+        for (std::size_t l=0; l<centroids_.size(); ++l) // iterate all obstacles
+        {
+            const cplx& obst_l = centroids_[l];
+            // compute log value
+            double diff2 = std::abs(z2-obst_l);
+            double diff1 = std::abs(z1-obst_l);
+            if (diff2 == 0 || diff1 == 0)
+                continue;
+            double log_real = std::log(diff2)-std::log(diff1);
+            // complex ln has more than one solution -> choose minimum abs angle -> paper
+            double arg_diff = std::arg(z2-obst_l)-std::arg(z1-obst_l);
+            imag_proposals[0] = arg_diff;
+            imag_proposals[1] = arg_diff+2*M_PI;
+            imag_proposals[2] = arg_diff-2*M_PI;
+            imag_proposals[3] = arg_diff+4*M_PI;
+            imag_proposals[4] = arg_diff-4*M_PI;
+            double log_imag = *std::min_element(imag_proposals, imag_proposals+5, smaller_than_abs);
+            cplx log_value(log_real,log_imag);
+            //cplx log_value = std::log(z2-obst_l)-std::log(z1-obst_l); // the principal solution doesn't seem to work
+            value += coefficients_[l]*log_value;
+        }
+        return value;
+    }
+
+    /**
+    * @brief Check if two H-signature values are equivalent (refer to HSignature::isEqual())
+    * @param cfg TebConfig storing some user configuration options
+    * @param h1 first H-signature value
+    * @param h2 second H-signature value
+    */
+    static bool isEqual(const TebConfig& cfg, const cplx& h1, const cplx& h2)
+    {
+        return std::abs(h1.real() - h2.real())<=cfg.hcp.h_signature_threshold && std::abs(h1.imag() - h2.imag())<=cfg.hcp.h_signature_threshold;
+    }
+
+private:
+    std::vector<cplx> centroids_; //!< Obstacle centroids
+    std::vector<cplx> coefficients_; //!< Obstacle coefficients (Al)
+};
+
+
 /**
  * @brief The H-signature defines an equivalence relation based on homology in terms of complex calculus.
  *
@@ -105,84 +232,18 @@ public:
 
         ROS_ASSERT_MSG(cfg_->hcp.h_signature_prescaler>0.1 && cfg_->hcp.h_signature_prescaler<=1, "Only a prescaler on the interval (0.1,1] ist allowed.");
 
-        // guess values for f0
-        // paper proposes a+b=N-1 && |a-b|<=1, 1...N obstacles
-        int m = std::max( (int)obstacles->size()-1, 5 );  // for only a few obstacles we need a min threshold in order to get significantly high H-Signatures
-
-        int a = (int) std::ceil(double(m)/2.0);
-        int b = m-a;
-
         std::advance(path_end, -1); // reduce path_end by 1 (since we check line segments between those path points
 
-        typedef std::complex<long double> cplx;
-        // guess map size (only a really really coarse guess is required
-        // use distance from start to goal as distance to each direction
+        // the obstacle coefficients depend on the start and end point of the path
         // TODO: one could move the map determination outside this function, since it remains constant for the whole planning interval
-        cplx start = fun_cplx_point(*path_start);
-        cplx end = fun_cplx_point(*path_end); // path_end points to the last point now after calling std::advance before
-        cplx delta = end-start;
-        cplx normal(-delta.imag(), delta.real());
-        cplx map_bottom_left;
-        cplx map_top_right;
-        if (std::abs(delta) < 3.0)
-        { // set minimum bound on distance (we do not want to have numerical instabilities) and 3.0 performs fine...
-            map_bottom_left = start + cplx(0, -3);
-            map_top_right = start + cplx(3, 3);
-        }
-        else
-        {
-            map_bottom_left = start - normal;
-            map_top_right = start + delta + normal;
-        }
+        const HSignatureSegments segments(*cfg_, obstacles, fun_cplx_point(*path_start), fun_cplx_point(*path_end));
 
         hsignature_ = 0; // reset local signature
 
-        std::vector<double> imag_proposals(5);
-
         // iterate path
         while(path_start != path_end)
         {
-            cplx z1 = fun_cplx_point(*path_start);
-            cplx z2 = fun_cplx_point(*std::next(path_start));
-
-            for (std::size_t l=0; l<obstacles->size(); ++l) // iterate all obstacles
-            {
-                cplx obst_l = obstacles->at(l)->getCentroidCplx();
-                //cplx f0 = (long double) prescaler * std::pow(obst_l-map_bottom_left,a) * std::pow(obst_l-map_top_right,b);
-                cplx f0 = (long double) cfg_->hcp.h_signature_prescaler * (long double)a*(obst_l-map_bottom_left) * (long double)b*(obst_l-map_top_right);
-
-                // denum contains product with all obstacles exepct j==l
-                cplx Al = f0;
-                for (std::size_t j=0; j<obstacles->size(); ++j)
-                {
-                    if (j==l)
-                        continue;
-                    cplx obst_j = obstacles->at(j)->getCentroidCplx();
-                    cplx diff = obst_l - obst_j;
-                    //if (diff.real()!=0 || diff.imag()!=0)
-                    if (std::abs(diff)<0.05) // skip really close obstacles
-                        continue;
-                     else
-                        Al /= diff;
-                }
-                // compute log value
-                double diff2 = std::abs(z2-obst_l);
-                double diff1 = std::abs(z1-obst_l);
-                if (diff2 == 0 || diff1 == 0)
-                    continue;
-                double log_real = std::log(diff2)-std::log(diff1);
-                // complex ln has more than one solution -> choose minimum abs angle -> paper
-                double arg_diff = std::arg(z2-obst_l)-std::arg(z1-obst_l);
-                imag_proposals.at(0) = arg_diff;
-                imag_proposals.at(1) = arg_diff+2*M_PI;
-                imag_proposals.at(2) = arg_diff-2*M_PI;
-                imag_proposals.at(3) = arg_diff+4*M_PI;
-                imag_proposals.at(4) = arg_diff-4*M_PI;
-                double log_imag = *std::min_element(imag_proposals.begin(),imag_proposals.end(),smaller_than_abs);
-                cplx log_value(log_real,log_imag);
-                //cplx log_value = std::log(z2-obst_l)-std::log(z1-obst_l); // the principal solution doesn't seem to work
-                hsignature_ += Al*log_value;
-            }
+            hsignature_ += segments.segmentValue(fun_cplx_point(*path_start), fun_cplx_point(*std::next(path_start)));
             ++path_start;
         }
     }
@@ -197,9 +258,7 @@ public:
         const HSignature* hother = dynamic_cast<const HSignature*>(&other); // TODO: better architecture without dynamic_cast
         if (hother)
         {
-            double diff_real = std::abs(hother->hsignature_.real() - hsignature_.real());
-            double diff_imag = std::abs(hother->hsignature_.imag() - hsignature_.imag());
-            if (diff_real<=cfg_->hcp.h_signature_threshold && diff_imag<=cfg_->hcp.h_signature_threshold)
+            if (HSignatureSegments::isEqual(*cfg_, hother->hsignature_, hsignature_))
                 return true; // Found! Homotopy class already exists, therefore nothing added
         }
         else
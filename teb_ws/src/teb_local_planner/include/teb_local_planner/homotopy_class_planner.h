@@ -63,6 +63,7 @@
 #include <teb_local_planner/robot_footprint_model.h>
 #include <teb_local_planner/equivalence_relations.h>
 #include <teb_local_planner/graph_search.h>
+#include <teb_local_planner/worker_pool.h>
 
 
 namespace teb_local_planner
@@ -273,6 +274,8 @@ public:
    * a new trajectory/TEB will be initialized. \n
    *
    * Everything is prepared now for the optimization step: see optimizeAllTEBs().
+   * If multithreading is enabled, the previous best TEB is already optimized in the worker pool during the graph search
+   * (see startBestTebOptimization()).
    * @param start Current start pose (e.g. pose of the robot)
    * @param goal Goal pose (e.g. robot's goal)
    * @param dist_to_obst Allowed distance to obstacles: if not satisfying, the path will be rejected (note, this is not the distance used for optimization).
@@ -336,6 +339,21 @@ public:
    */
   void optimizeAllTEBs(int iter_innerloop, int iter_outerloop);
 
+  /**
+   * @brief Start the optimization of the previous best TEB in the worker pool (multithreading only).
+   *
+   * The graph search of exploreEquivalenceClassesAndInitTebs() only adds new candidates, hence it can be
+   * performed concurrently. The via-points of the TEBs are updated before the optimization is started.
+   * optimizeAllTEBs() waits for the result and skips this TEB.
+   */
+  void startBestTebOptimization();
+
+  /**
+   * @brief Return the persistent worker pool (created at the first call or if the maximum number of classes changes)
+   * @return worker pool with one worker per candidate
+   */
+  WorkerPool& workerPool();
+
   /**
    * @brief Returns a shared pointer to the TEB related to the initial plan
    * @return A non-empty shared ptr is returned if a match was found; Otherwise the shared ptr is empty.
@@ -371,6 +389,12 @@ public:
    */
   virtual void setPreferredTurningDir(RotType dir);
 
+  /**
+   * @brief Assign a spatial index over the obstacle container to all current and future TEBs
+   * @param obstacle_index pointer to the index (can also be a nullptr)
+   */
+  virtual void setObstacleIndex(const ObstacleGridIndex* obstacle_index);
+
   /**
    * @brief Calculate the equivalence class of a path
    *
@@ -452,6 +476,12 @@ public:
    */
   const ObstContainer* obstacles() const {return obstacles_;}
 
+  /**
+   * @brief Access the spatial index over the obstacles (read-only)
+   * @return const pointer to the index (can be a nullptr)
+   */
+  const ObstacleGridIndex* obstacleIndex() const {return obstacle_index_;}
+
   /**
    * @brief Returns true if the planner is initialized
    */
@@ -543,6 +573,7 @@ protected:
   // external objects (store weak pointers)
   const TebConfig* cfg_; //!< Config class that stores and manages all related parameters
   ObstContainer* obstacles_; //!< Store obstacles that are relevant for planning
+  const ObstacleGridIndex* obstacle_index_; //!< Optional spatial index over the obstacles (forwarded to the TEBs)
   const ViaPointContainer* via_points_; //!< Store the current list of via-points
 
   // internal objects (memory management owned)
@@ -568,6 +599,9 @@ protected:
 
   TebOptimalPlannerPtr last_best_teb_;  //!< Points to the plan used in the previous control cycle
 
+  TebOptimalPlannerPtr prestarted_teb_; //!< TEB whose optimization has been started by startBestTebOptimization()
+  WorkerPoolPtr worker_pool_; //!< Workers for the parallel optimization of the TEBs (declared last: the workers are joined before the TEBs are destroyed)
+
 
 
 public:
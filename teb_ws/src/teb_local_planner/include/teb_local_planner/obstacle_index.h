@@ -0,0 +1,135 @@
+/*********************************************************************
+ *
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016,
+ *  TU Dortmund - Institute of Control Theory and Systems Engineering.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the institute nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: Luigi Freda
+ *********************************************************************/
+
+#ifndef OBSTACLE_INDEX_H
+#define OBSTACLE_INDEX_H
+
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+
+#include <teb_local_planner/obstacles.h>
+
+
+namespace teb_local_planner
+{
+
+/**
+ * @class ObstacleGridIndex
+ * @brief 2D grid index over an obstacle container for the association of the obstacles to the TEB poses
+ * 
+ * Each obstacle is registered in the grid cells overlapped by its bounding box. Obstacles whose bounding box
+ * is unknown or covers too many cells are kept in a separate list and returned by every query.
+ * The index refers to the obstacles by their position in the container: it must be rebuilt each time the container changes.
+ * Queries do not modify the index (they can be run concurrently).
+ */
+class ObstacleGridIndex
+{
+public:
+
+  static const double kDefaultCellSize; //!< Default side of the grid cells [m]
+  static const int kMaxCellsPerObstacle; //!< Obstacles covering more cells are not registered in the grid
+
+  /**
+   * @brief Construct an empty index
+   * @param cell_size side of the grid cells [m]
+   */
+  ObstacleGridIndex(double cell_size = kDefaultCellSize);
+
+  /**
+   * @brief Rebuild the index on the given obstacle container
+   * @param obstacles obstacle container (referred by the index: it must outlive it)
+   */
+  void build(const ObstContainer& obstacles);
+
+  /**
+   * @brief Clear the index
+   */
+  void clear();
+
+  /**
+   * @brief Check if the index has been built on the given container and the container size did not change since then
+   * @param obstacles obstacle container
+   * @return \c true if the index can be queried for this container
+   */
+  bool isValidFor(const ObstContainer* obstacles) const {return obstacles != nullptr && obstacles == obstacles_ && obstacles->size() == num_obstacles_;}
+
+  /**
+   * @brief Collect the obstacles whose bounding box may be within the given radius from a position
+   * @param position query position
+   * @param radius search radius [m]
+   * @param[out] indices container indices of the candidate obstacles (sorted, without duplicates). 
+   *                     The candidates are a superset of the obstacles within the radius.
+   */
+  void query(const Eigen::Vector2d& position, double radius, std::vector<int>& indices) const;
+
+  /**
+   * @brief Collect the obstacles whose bounding box may be within the given radius from a line segment
+   * @param line_start start of the segment
+   * @param line_end end of the segment
+   * @param radius search radius [m]
+   * @param[out] indices container indices of the candidate obstacles (sorted, without duplicates).
+   *                     The candidates are a superset of the obstacles within the radius.
+   */
+  void querySegment(const Eigen::Vector2d& line_start, const Eigen::Vector2d& line_end, double radius, std::vector<int>& indices) const;
+
+  double cellSize() const {return cell_size_;} //!< Return the side of the grid cells [m]
+  
+protected:
+
+  static bool getBoundingBox(const Obstacle* obstacle, Eigen::Vector2d& min_corner, Eigen::Vector2d& max_corner);
+
+  int64_t getCellCoord(double x) const {return (int64_t)std::floor(x/cell_size_);}
+
+  static uint64_t getCellKey(int64_t cx, int64_t cy)
+  {
+    return (((uint64_t)(uint32_t)cx) << 32) | (uint64_t)(uint32_t)cy;
+  }
+
+  typedef std::unordered_map<uint64_t, std::vector<int> > CellMap;
+
+  double cell_size_;
+  CellMap cells_;
+  std::vector<int> unbounded_; //!< obstacles not registered in the grid
+  const ObstContainer* obstacles_;
+  std::size_t num_obstacles_;
+};
+
+} // namespace teb_local_planner
+
+#endif /* OBSTACLE_INDEX_H */
@@ -67,6 +67,7 @@
 
 #include <nav_msgs/Odometry.h>
 #include <limits.h>
+#include <array>
 
 namespace teb_local_planner
 {
@@ -279,6 +280,12 @@ public:
    */
   const ObstContainer& getObstVector() const {return *obstacles_;}
 
+  /**
+   * @brief Assign a spatial index over the obstacle container (used for the obstacle association if it is valid for the current container)
+   * @param obstacle_index pointer to the index (can also be a nullptr)
+   */
+  virtual void setObstacleIndex(const ObstacleGridIndex* obstacle_index) {obstacle_index_ = obstacle_index;}
+
   //@}
   
   /** @name Take via-points into account */
@@ -385,6 +392,22 @@ public:
    */
   bool isOptimized() const {return optimized_;};
 
+  //! Statistics of the last call to optimizeTEB() (for profiling and benchmarking)
+  struct OptimizationStatistics
+  {
+    int outer_iterations = 0; //!< Number of completed outer iterations
+    int solver_iterations = 0; //!< Number of solver iterations (summed over the outer iterations)
+    int num_vertices = 0; //!< Number of vertices of the last optimized graph
+    int num_edges = 0; //!< Number of edges of the last optimized graph
+    void reset() { *this = OptimizationStatistics(); }
+  };
+
+  /**
+   * @brief Access the statistics of the last call to optimizeTEB()
+   * @return const reference to the statistics
+   */
+  const OptimizationStatistics& getOptimizationStatistics() const {return statistics_;};
+
   /**
    * @brief Returns true if the planner has diverged.
    */
@@ -541,6 +564,39 @@ protected:
    * @see optimizeGraph
    */
   void clearGraph();
+
+  /**
+   * @brief Keep the edges of the internal hyper-graph for the next buildGraph() call (graph reuse mode, see TebConfig::Optimization::reuse_graph).
+   *
+   * The vertices are removed from the optimizer, since the TEB might delete them before the next call.
+   * @see buildGraph
+   * @see clearGraph
+   */
+  void retainGraph();
+
+  /**
+   * @brief Match the retained edges with the current TEB and delete all edges that cannot be reused.
+   *
+   * The structural edges (velocity, acceleration, time-optimal, shortest path and kinematics) between
+   * consecutive poses are grouped by the first pose. A group is kept if its poses and time differences are unchanged,
+   * all other edges (obstacles, via-points, start/goal velocity, ...) are deleted and created again by buildGraph().
+   * @see buildGraph
+   */
+  void prepareGraphReuse();
+
+  /**
+   * @brief Add a structural edge of pose \c index to the graph and register it for the graph reuse mode.
+   * @param index index of the first pose (and time difference) connected by the edge
+   * @param edge edge to be added (the optimizer takes ownership)
+   */
+  void addStaticEdge(int index, g2o::OptimizableGraph::Edge* edge);
+
+  /**
+   * @brief Check if the structural edges of pose \c index were kept from the previous graph.
+   * @param index index of the first pose connected by the edges
+   * @return \c true, if the edges are already part of the graph
+   */
+  bool isStaticEdgeGroupReused(int index) const {return index < (int)static_edge_groups_.size() && static_edge_groups_[index].reused;}
   
   /**
    * @brief Add all relevant vertices to the hyper-graph as optimizable variables.
@@ -674,7 +730,9 @@ protected:
   // external objects (store weak pointers)
   const TebConfig* cfg_; //!< Config class that stores and manages all related parameters
   ObstContainer* obstacles_; //!< Store obstacles that are relevant for planning
+  const ObstacleGridIndex* obstacle_index_; //!< Optional spatial index over the obstacles
   const ViaPointContainer* via_points_; //!< Store via points for planning
+  std::vector<int> via_point_hints_; //!< Closest pose of each via-point in the last graph, used as hint of the next closest pose queries
   std::vector<ObstContainer> obstacles_per_vertex_; //!< Store the obstacles associated with the n-1 initial vertices
   
   double cost_; //!< Store cost value of the current hyper-graph
@@ -687,6 +745,20 @@ protected:
   std::pair<bool, geometry_msgs::Twist> vel_start_; //!< Store the initial velocity at the start pose
   std::pair<bool, geometry_msgs::Twist> vel_goal_; //!< Store the final velocity at the goal pose
 
+  //! Structural edges between the poses index, index+1 (and index+2) of the graph, kept in the graph reuse mode
+  struct StaticEdgeGroup
+  {
+    std::array<const g2o::HyperGraph::Vertex*, 5> vertices; //!< pose(i), pose(i+1), timediff(i), pose(i+2), timediff(i+1) (NULL if not existing)
+    std::vector<g2o::OptimizableGraph::Edge*> edges; //!< Edges owned by the optimizer
+    bool reused; //!< \c true if the edges were kept from the previous graph
+  };
+  std::vector<StaticEdgeGroup> static_edge_groups_; //!< Structural edges of the retained graph (graph reuse mode)
+  std::array<double, 15> static_edge_params_; //!< Parameters the structural edges were created with (graph reuse mode)
+  bool graph_retained_; //!< \c true if the edges of the last graph were kept by retainGraph()
+  double warm_start_lambda_; //!< Levenberg-Marquardt damping of the last optimization, used as initial damping of a reused graph
+  bool diff_drive_edges_; //!< Use the differential drive edges with analytic Jacobians (selected by buildGraph())
+  OptimizationStatistics statistics_; //!< Statistics of the last call to optimizeTEB()
+
   bool initialized_; //!< Keeps track about the correct initialization of this class
   bool optimized_; //!< This variable is \c true as long as the last optimization has been completed successful
   
@@ -49,6 +49,7 @@
 // this package
 #include <teb_local_planner/pose_se2.h>
 #include <teb_local_planner/robot_footprint_model.h>
+#include <teb_local_planner/obstacle_index.h>
 
 // messages
 #include <geometry_msgs/PoseArray.h>
@@ -165,6 +166,16 @@ public:
   {
   }
 
+  /**
+   * @brief Set a spatial index over the obstacle container used by the planner.
+   * 
+   * The index must be rebuilt by the caller each time the obstacle container changes (it is ignored otherwise).
+   * @param obstacle_index Pointer to the index (NULL to disable it)
+   */
+  virtual void setObstacleIndex(const ObstacleGridIndex* obstacle_index)
+  {
+  }
+
   /**
    * @brief Check whether the planned trajectory is feasible or not.
    * 
@@ -42,7 +42,9 @@
 
 #include <teb_local_planner/pose_se2.h>
 #include <teb_local_planner/obstacles.h>
+#include <teb_local_planner/footprint_distance_field.h>
 #include <visualization_msgs/Marker.h>
+#include <limits>
 
 namespace teb_local_planner
 {
@@ -109,6 +111,14 @@ public:
    */
   virtual double getInscribedRadius() = 0;
 
+  /**
+   * @brief Compute the circumscribed radius of the footprint model (around the robot center)
+   * 
+   * The distance from the footprint to an obstacle is not smaller than the distance from the robot center minus this radius.
+   * @return circumscribed radius (infinity if unknown)
+   */
+  virtual double getCircumscribedRadius() {return std::numeric_limits<double>::infinity();}
+
 	
 
 public:	
@@ -180,6 +190,12 @@ public:
    */
   virtual double getInscribedRadius() {return 0.0;}
 
+  /**
+   * @brief Compute the circumscribed radius of the footprint model
+   * @return circumscribed radius
+   */
+  virtual double getCircumscribedRadius() {return 0.0;}
+
   /**
    * @brief Visualize the robot using a markers
    * 
@@ -303,6 +319,12 @@ public:
    */
   virtual double getInscribedRadius() {return radius_;}
 
+  /**
+   * @brief Compute the circumscribed radius of the footprint model
+   * @return circumscribed radius
+   */
+  virtual double getCircumscribedRadius() {return radius_;}
+
 private:
     
   double radius_;
@@ -421,6 +443,15 @@ public:
       return std::min(min_longitudinal, min_lateral);
   }
 
+  /**
+   * @brief Compute the circumscribed radius of the footprint model
+   * @return circumscribed radius
+   */
+  virtual double getCircumscribedRadius() 
+  {
+      return std::max(std::abs(front_offset_) + front_radius_, std::abs(rear_offset_) + rear_radius_);
+  }
+
 private:
     
   double front_offset_;
@@ -599,6 +630,15 @@ public:
       return 0.0; // lateral distance = 0.0
   }
 
+  /**
+   * @brief Compute the circumscribed radius of the footprint model
+   * @return circumscribed radius
+   */
+  virtual double getCircumscribedRadius() 
+  {
+      return std::max(line_start_.norm(), line_end_.norm());
+  }
+
 private:
     
   /**
@@ -631,6 +671,9 @@ public:
 /**
  * @class PolygonRobotFootprint
  * @brief Class that approximates the robot with a closed polygon
+ * 
+ * The distances to point and circular obstacles can optionally be taken from a precomputed
+ * signed distance field of the polygon (see enableDistanceField()).
  */
 class PolygonRobotFootprint : public BaseRobotFootprintModel
 {
@@ -653,7 +696,34 @@ public:
    * @brief Set vertices of the contour/footprint
    * @param vertices footprint vertices (only x and y) around the robot center (0,0) (do not repeat the first and last vertex at the end)
    */
-  void setVertices(const Point2dContainer& vertices) {vertices_ = vertices;}
+  void setVertices(const Point2dContainer& vertices) 
+  {
+    vertices_ = vertices;
+    if (distance_field_.isValid())
+      distance_field_.build(vertices_, distance_field_.resolution(), distance_field_.margin());
+  }
+  
+  /**
+   * @brief Precompute the signed distance field of the footprint in the robot frame
+   * 
+   * Once enabled, the distance to point and circular obstacles located inside the field is obtained
+   * by bilinear interpolation in constant time. The interpolated distance is negative if the obstacle
+   * is inside the footprint. Other obstacles and far away points are handled by the exact computation.
+   * @param resolution distance between two samples of the field [m]
+   * @param margin the field covers the bounding box of the footprint enlarged by this margin [m]
+   * @return \c true if the field is built, \c false otherwise (the exact computation is used)
+   */
+  bool enableDistanceField(double resolution, double margin) {return distance_field_.build(vertices_, resolution, margin);}
+  
+  /**
+   * @brief Release the signed distance field (the exact distance computation is used)
+   */
+  void disableDistanceField() {distance_field_.clear();}
+  
+  /**
+   * @brief Check whether the distances are taken from the signed distance field
+   */
+  bool hasDistanceField() const {return distance_field_.isValid();}
   
   /**
     * @brief Calculate the distance between the robot and an obstacle
@@ -663,6 +733,10 @@ public:
     */
   virtual double calculateDistance(const PoseSE2& current_pose, const Obstacle* obstacle) const
   {
+    double dist;
+    if (distance_field_.isValid() && lookupDistanceField(current_pose, obstacle, obstacle->getCentroid(), dist))
+      return dist;
+    
     Point2dContainer polygon_world(vertices_.size());
     transformToWorld(current_pose, polygon_world);
     return obstacle->getMinimumDistance(polygon_world);
@@ -677,6 +751,15 @@ public:
     */
   virtual double estimateSpatioTemporalDistance(const PoseSE2& current_pose, const Obstacle* obstacle, double t) const
   {
+    if (distance_field_.isValid())
+    {
+      Eigen::Vector2d predicted_position;
+      obstacle->predictCentroidConstantVelocity(t, predicted_position);
+      double dist;
+      if (lookupDistanceField(current_pose, obstacle, predicted_position, dist))
+        return dist;
+    }
+    
     Point2dContainer polygon_world(vertices_.size());
     transformToWorld(current_pose, polygon_world);
     return obstacle->getMinimumSpatioTemporalDistance(polygon_world, t);
@@ -747,6 +830,18 @@ public:
      return std::min(min_dist, std::min(vertex_dist, edge_dist));
   }
 
+  /**
+   * @brief Compute the circumscribed radius of the footprint model
+   * @return circumscribed radius
+   */
+  virtual double getCircumscribedRadius() 
+  {
+     double max_dist = 0.0;
+     for (std::size_t i = 0; i < vertices_.size(); ++i)
+        max_dist = std::max(max_dist, vertices_[i].norm());
+     return max_dist;
+  }
+
 private:
     
   /**
@@ -764,8 +859,36 @@ private:
       polygon_world[i].y() = current_pose.y() + sin_th * vertices_[i].x() + cos_th * vertices_[i].y();
     }
   }
+  
+  /**
+    * @brief Get the distance to a point or circular obstacle from the signed distance field
+    * @param current_pose Current robot pose
+    * @param obstacle Pointer to the obstacle
+    * @param obstacle_position (predicted) position of the obstacle centroid
+    * @param[out] distance distance between the footprint and the obstacle
+    * @return \c false if the obstacle type is not supported or the obstacle is outside the field
+    */
+  bool lookupDistanceField(const PoseSE2& current_pose, const Obstacle* obstacle, const Eigen::Vector2d& obstacle_position, double& distance) const
+  {
+    double radius = 0.0;
+    if (const CircularObstacle* circular = dynamic_cast<const CircularObstacle*>(obstacle))
+      radius = circular->radius();
+    else if (!dynamic_cast<const PointObstacle*>(obstacle))
+      return false;
+    
+    // transform the obstacle position into the robot frame
+    const double cos_th = std::cos(current_pose.theta());
+    const double sin_th = std::sin(current_pose.theta());
+    const Eigen::Vector2d delta = obstacle_position - current_pose.position();
+    const Eigen::Vector2d point_robot(cos_th * delta.x() + sin_th * delta.y(), -sin_th * delta.x() + cos_th * delta.y());
+    if (!distance_field_.getDistance(point_robot, distance))
+      return false;
+    distance -= radius;
+    return true;
+  }
 
   Point2dContainer vertices_;
+  FootprintDistanceField distance_field_; //!< Optional signed distance field of the footprint in the robot frame
   
 };
 
@@ -153,6 +153,8 @@ public:
 
     bool optimization_activate; //!< Activate the optimization
     bool optimization_verbose; //!< Print verbose information
+    bool reuse_graph; //!< Keep the hyper-graph between optimizations and rebuild only the edges of modified poses and the obstacle/via-point edges
+    bool analytic_jacobians; //!< Use velocity and acceleration edges with analytic Jacobians for differential drive robots (ignored if exact_arc_length is enabled)
 
     double penalty_epsilon; //!< Add a small safety margin to penalty functions for hard-constraint approximations
 
@@ -198,6 +200,9 @@ public:
     int roadmap_graph_no_samples; //! < Specify the number of samples generated for creating the roadmap graph, if simple_exploration is turend off.
     double roadmap_graph_area_width; //!< Random keypoints/waypoints are sampled in a rectangular region between start and goal. Specify the width of that region in meters.
     double roadmap_graph_area_length_scale; //!< The length of the rectangular region is determined by the distance between start and goal. This parameter further scales the distance such that the geometric center remains equal!
+    int roadmap_graph_max_neighbors; //!< Maximum number of edges from each graph vertex to its nearest forward vertices (0: connect all the forward vertices)
+    double roadmap_graph_resample_distance; //!< Reuse the roadmap samples while start and goal moved less than this distance [m] (0: resample at each planning cycle)
+    bool graph_search_best_first; //!< Search the shortest paths of distinct homotopy classes in the exploration graph first (otherwise enumerate all the paths depth first)
     double h_signature_prescaler; //!< Scale number of obstacle value in order to allow huge number of obstacles. Do not choose it extremly low, otherwise obstacles cannot be distinguished from each other (0.2<H<=1).
     double h_signature_threshold; //!< Two h-signatures are assumed to be equal, if both the difference of real parts and complex parts are below the specified threshold.
 
@@ -322,6 +327,8 @@ public:
     optim.no_outer_iterations = 4;
     optim.optimization_activate = true;
     optim.optimization_verbose = false;
+    optim.reuse_graph = false;
+    optim.analytic_jacobians = false;
     optim.penalty_epsilon = 0.05;
     optim.weight_max_vel_x = 2; //1
     optim.weight_max_vel_y = 2;
@@ -363,6 +370,9 @@ public:
     hcp.roadmap_graph_no_samples = 15;
     hcp.roadmap_graph_area_width = 6; // [m]
     hcp.roadmap_graph_area_length_scale = 1.0;
+    hcp.roadmap_graph_max_neighbors = 0;
+    hcp.roadmap_graph_resample_distance = 0;
+    hcp.graph_search_best_first = true;
     hcp.h_signature_prescaler = 1;
     hcp.h_signature_threshold = 0.1;
     hcp.switching_blocking_period = 0.0;
@@ -54,6 +54,7 @@
 // G2O Types
 #include <teb_local_planner/g2o_types/vertex_pose.h>
 #include <teb_local_planner/g2o_types/vertex_timediff.h>
+#include <teb_local_planner/trajectory_pose_index.h>
 
 
 namespace teb_local_planner
@@ -496,7 +497,7 @@ public:
    * 	- inserts a new sample if \f$ \Delta T_i > \Delta T_{ref} + \Delta T_{hyst} \f$
    *    - removes a sample if \f$ \Delta T_i < \Delta T_{ref} - \Delta T_{hyst} \f$
    * 
-   * Each call only one new sample (pose-dt-pair) is inserted or removed.
+   * Each iteration is a single sweep over the trajectory (see autoResizeSweep()), hence its cost is linear in the number of samples.
    * @param dt_ref reference temporal resolution
    * @param dt_hysteresis hysteresis to avoid oscillations
    * @param min_samples minimum number of samples that should be remain in the trajectory after resizing
@@ -532,30 +533,46 @@ public:
   /** @name Utility and status methods */
   //@{
   
+  /**
+   * @brief Build the spatial index of the pose positions used by the findClosestTrajectoryPose() queries (if not up to date).
+   * 
+   * The index is invalidated by the methods which add, insert, delete or resize the poses. 
+   * Poses modified through their references (e.g. Pose(), the optimizer) are not tracked: call invalidatePoseIndex() after changing them.
+   * Without a valid index, the queries scan all the poses.
+   * The results of the queries are the same with and without the index.
+   */
+  void updatePoseIndex();
+  
+  /**
+   * @brief Invalidate the spatial index of the pose positions (see updatePoseIndex())
+   */
+  void invalidatePoseIndex();
+  
+  /**
+   * @brief Check whether the spatial index of the pose positions is up to date (see updatePoseIndex())
+   */
+  bool isPoseIndexValid() const;
+  
   /**
    * @brief Find the closest point on the trajectory w.r.t. to a provided reference point.
    * 
    * This function can be useful to find the part of a trajectory that is close to an obstacle.
-   * 
-   * @todo implement a more efficient version that first performs a coarse search.
-   * @todo implement a fast approximation that assumes only one local minima w.r.t to the distance:
-   *       Allows simple comparisons starting from the middle of the trajectory.
+   * If the pose index is valid (see updatePoseIndex()), only the parts of the trajectory close to the reference point are visited.
    * 
    * @param ref_point reference point (2D position vector)
    * @param[out] distance [optional] the resulting minimum distance
    * @param begin_idx start search at this pose index
+   * @param hint_idx [optional] index of a pose expected to be close to the reference point (e.g. the result of the previous query 
+   *        for a slowly moving point): it speeds up the indexed search, the result does not depend on it
    * @return Index to the closest pose in the pose sequence
    */
-  int findClosestTrajectoryPose(const Eigen::Ref<const Eigen::Vector2d>& ref_point, double* distance = NULL, int begin_idx=0) const;
+  int findClosestTrajectoryPose(const Eigen::Ref<const Eigen::Vector2d>& ref_point, double* distance = NULL, int begin_idx=0, int hint_idx=-1) const;
 
   /**
    * @brief Find the closest point on the trajectory w.r.t. to a provided reference line.
    * 
    * This function can be useful to find the part of a trajectory that is close to an (line) obstacle.
-   * 
-   * @todo implement a more efficient version that first performs a coarse search.
-   * @todo implement a fast approximation that assumes only one local minima w.r.t to the distance:
-   *       Allows simple comparisons starting from the middle of the trajectory.
+   * If the pose index is valid (see updatePoseIndex()), only the parts of the trajectory close to the reference line are visited.
    * 
    * @param ref_line_start start of the reference line (2D position vector)
 	 * @param ref_line_end end of the reference line (2D position vector)
@@ -568,10 +585,7 @@ public:
    * @brief Find the closest point on the trajectory w.r.t. to a provided reference polygon.
    * 
    * This function can be useful to find the part of a trajectory that is close to an (polygon) obstacle.
-   * 
-   * @todo implement a more efficient version that first performs a coarse search.
-   * @todo implement a fast approximation that assumes only one local minima w.r.t to the distance:
-   *       Allows simple comparisons starting from the middle of the trajectory.
+   * If the pose index is valid (see updatePoseIndex()), only the parts of the trajectory close to the reference polygon are visited.
    * 
    * @param vertices vertex container containing Eigen::Vector2d points (the last and first point are connected)
    * @param[out] distance [optional] the resulting minimum distance
@@ -642,9 +656,26 @@ public:
   //@}
 	
 protected:
+  /**
+   * @brief One iteration of autoResize(): the timediffs are checked from the start to the goal, 
+   *        intervals are split or merged in place of the inserted or removed samples.
+   *
+   * The resized pose and timediff sequences are built in new containers and swapped in: the result is the same
+   * as the one of an iteration of insertPose()/insertTimeDiff() and deletePose()/deleteTimeDiff() calls, without their O(n) shifts.
+   * @param dt_ref reference temporal resolution
+   * @param dt_hysteresis hysteresis to avoid oscillations
+   * @param min_samples minimum number of samples that should be remain in the trajectory after resizing
+   * @param max_samples maximum number of samples that should not be exceeded during resizing
+   * @return \c true if samples have been inserted or removed
+   */
+  bool autoResizeSweep(double dt_ref, double dt_hysteresis, int min_samples, int max_samples);
+
   PoseSequence pose_vec_; //!< Internal container storing the sequence of optimzable pose vertices
   TimeDiffSequence timediff_vec_;  //!< Internal container storing the sequence of optimzable timediff vertices
   
+  TrajectoryPoseIndex pose_index_; //!< Spatial index of the pose positions (see updatePoseIndex())
+  bool pose_index_valid_; //!< \c true if pose_index_ is up to date with the pose sequence
+  
 public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 };
@@ -0,0 +1,146 @@
+/*********************************************************************
+ *
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016,
+ *  TU Dortmund - Institute of Control Theory and Systems Engineering.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the institute nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: Luigi Freda
+ * Author: Luigi Freda
+ *********************************************************************/
+
+#ifndef TRAJECTORY_POSE_INDEX_H
+#define TRAJECTORY_POSE_INDEX_H
+
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/StdVector>
+
+#include <teb_local_planner/distance_calculations.h>
+#include <teb_local_planner/g2o_types/vertex_pose.h>
+
+
+namespace teb_local_planner
+{
+
+/**
+ * @class TrajectoryPoseIndex
+ * @brief Bounding volume hierarchy over the pose positions of a trajectory for the closest pose queries of the TimedElasticBand
+ * 
+ * The leaves are runs of consecutive poses (a trajectory is spatially coherent, so their bounding boxes are small) and 
+ * the hierarchy is an implicit balanced binary tree over the leaves, built bottom-up in linear time.
+ * A query descends the tree (nearest child first) and skips the subtrees whose bounding box is farther than the best pose found so far.
+ * The results (closest index and distance, ties resolved by the lowest index) are the same as the ones of a linear scan of the poses.
+ * The index keeps a copy of the positions: it must be rebuilt each time the poses change.
+ * Queries do not modify the index (they can be run concurrently).
+ */
+class TrajectoryPoseIndex
+{
+public:
+
+  static const int kPosesPerLeaf; //!< Number of consecutive poses in each leaf of the hierarchy
+
+  /**
+   * @brief Construct an empty index
+   */
+  TrajectoryPoseIndex();
+
+  /**
+   * @brief Rebuild the index on the given pose sequence
+   * @param poses pose vertices of the trajectory
+   */
+  void build(const std::vector<VertexPose*>& poses);
+
+  /**
+   * @brief Clear the index
+   */
+  void clear();
+
+  int size() const {return (int)positions_.size();} //!< Return the number of indexed poses
+
+  /**
+   * @brief Find the closest pose (Euclidean distance) to a reference point
+   * @param ref_point reference point (2D)
+   * @param[out] distance the distance to the closest pose
+   * @param begin_idx start the search at this pose index
+   * @param hint_idx index of a pose expected to be close to the reference point (e.g. the result of a previous query), ignored if out of range
+   * @return index of the closest pose, -1 if there is no pose from \c begin_idx on
+   */
+  int findClosest(const Eigen::Vector2d& ref_point, double* distance, int begin_idx = 0, int hint_idx = -1) const;
+
+  /**
+   * @brief Find the closest pose to a line segment
+   * @param ref_line_start start of the reference line (2D)
+   * @param ref_line_end end of the reference line (2D)
+   * @param[out] distance the distance to the closest pose
+   * @return index of the closest pose, -1 if there is no pose
+   */
+  int findClosest(const Eigen::Vector2d& ref_line_start, const Eigen::Vector2d& ref_line_end, double* distance) const;
+
+  /**
+   * @brief Find the closest pose to the boundary of a polygon (at least three vertices)
+   * @param vertices vertices of the polygon (closed by an edge from the last to the first vertex)
+   * @param[out] distance the distance to the closest pose
+   * @return index of the closest pose, -1 if there is no pose
+   */
+  int findClosest(const Point2dContainer& vertices, double* distance) const;
+
+protected:
+
+  /**
+   * @brief Branch and bound search of the pose with the minimum cost
+   * @param begin_idx first pose index
+   * @param hint_idx index of the initial best pose (-1 if none)
+   * @param box_lower_bound function returning a lower bound of the cost of the poses in a box (min and max corners)
+   * @param pose_cost function returning the cost of a pose position
+   * @param[out] min_cost cost of the returned pose
+   * @return index of the pose with the minimum cost, -1 if there is no pose from \c begin_idx on
+   */
+  template <typename BoxLowerBound, typename PoseCost>
+  int search(int begin_idx, int hint_idx, const BoxLowerBound& box_lower_bound, const PoseCost& pose_cost, double& min_cost) const;
+
+  static double squaredDistancePointToBox(const Eigen::Vector2d& point, const Eigen::Vector2d& box_min, const Eigen::Vector2d& box_max);
+
+  static double distanceSegmentToBox(const Eigen::Vector2d& line_start, const Eigen::Vector2d& line_end, const Eigen::Vector2d& box_min, const Eigen::Vector2d& box_max);
+
+  Point2dContainer positions_; //!< positions of the poses
+  Point2dContainer box_min_; //!< min corners of the nodes (node 1 is the root, the children of node k are 2k and 2k+1)
+  Point2dContainer box_max_; //!< max corners of the nodes
+  int num_leaves_; //!< number of leaves of the implicit tree (a power of two, the last ones can be empty)
+
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+} // namespace teb_local_planner
+
+#endif /* TRAJECTORY_POSE_INDEX_H */
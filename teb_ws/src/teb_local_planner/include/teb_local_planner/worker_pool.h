@@ -0,0 +1,169 @@
+/*********************************************************************
+ *
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016,
+ *  TU Dortmund - Institute of Control Theory and Systems Engineering.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the institute nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: Luigi Freda
+ *********************************************************************/
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <deque>
+#include <algorithm>
+
+#include <boost/thread.hpp>
+#include <boost/function.hpp>
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/core/noncopyable.hpp>
+
+
+namespace teb_local_planner
+{
+
+/**
+ * @class WorkerPool
+ * @brief Fixed set of worker threads that execute the pushed jobs in FIFO order
+ * 
+ * The threads are created once in the constructor, hence pushing a job does not spawn any thread.
+ * Jobs are pushed and waited for by a single owner thread (e.g. the planner), see wait().
+ */
+class WorkerPool : private boost::noncopyable
+{
+public:
+
+  typedef boost::function<void()> Job; //!< Job executed by a worker
+
+  /**
+   * @brief Construct the pool and start the workers
+   * @param no_workers number of worker threads (if <= 0, the number of hardware threads is used)
+   */
+  WorkerPool(int no_workers = 0) : no_unfinished_jobs_(0), stop_(false)
+  {
+    if (no_workers <= 0)
+      no_workers = std::max((int)boost::thread::hardware_concurrency(), 1);
+    for (int i=0; i < no_workers; ++i)
+      workers_.create_thread(boost::bind(&WorkerPool::workerLoop, this));
+    no_workers_ = no_workers;
+  }
+
+  /**
+   * @brief Destruct the pool: pending jobs are dropped, running jobs are completed
+   */
+  ~WorkerPool()
+  {
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      stop_ = true;
+      jobs_.clear();
+    }
+    job_cond_.notify_all();
+    workers_.join_all();
+  }
+
+  /**
+   * @brief Queue a job for execution (returns immediately)
+   * @param job job to be executed by the next free worker
+   */
+  void push(const Job& job)
+  {
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      jobs_.push_back(job);
+      ++no_unfinished_jobs_;
+    }
+    job_cond_.notify_one();
+  }
+
+  /**
+   * @brief Block until all pushed jobs have been executed
+   * @warning Must not be called by a worker.
+   */
+  void wait()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    while (no_unfinished_jobs_ > 0)
+      done_cond_.wait(lock);
+  }
+
+  /**
+   * @brief Return the number of worker threads
+   */
+  int numWorkers() const {return no_workers_;}
+
+protected:
+
+  /**
+   * @brief Main loop of each worker thread
+   */
+  void workerLoop()
+  {
+    while (true)
+    {
+      Job job;
+      {
+        boost::mutex::scoped_lock lock(mutex_);
+        while (jobs_.empty() && !stop_)
+          job_cond_.wait(lock);
+        if (stop_)
+          return;
+        job = jobs_.front();
+        jobs_.pop_front();
+      }
+
+      job();
+
+      boost::mutex::scoped_lock lock(mutex_);
+      if (--no_unfinished_jobs_ == 0)
+        done_cond_.notify_all();
+    }
+  }
+
+  boost::mutex mutex_; //!< Protects the job queue and the counter of unfinished jobs
+  boost::condition_variable job_cond_; //!< Signals new jobs (or the stop request) to the workers
+  boost::condition_variable done_cond_; //!< Signals that all jobs have been executed
+  std::deque<Job> jobs_; //!< Queue of pending jobs
+  int no_unfinished_jobs_; //!< Number of pending or running jobs
+  bool stop_; //!< Stop request for the workers
+
+  boost::thread_group workers_; //!< Worker threads
+  int no_workers_; //!< Number of worker threads
+};
+
+//! Abbrev. for shared instances of the WorkerPool
+typedef boost::shared_ptr<WorkerPool> WorkerPoolPtr;
+
+} // namespace teb_local_planner
+
+#endif /* WORKER_POOL_H */
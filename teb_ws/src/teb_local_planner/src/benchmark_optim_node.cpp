@@ -0,0 +1,515 @@
+/*********************************************************************
+ *
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016,
+ *  TU Dortmund - Institute of Control Theory and Systems Engineering.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the institute nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: Luigi Freda
+ *********************************************************************/
+
+// Headless benchmark of the trajectory optimization.
+// A set of scripted scenarios (obstacle layouts, via-points, robot models and config overrides) is loaded
+// from the parameter server (see cfg/benchmark_scenarios.yaml). Each scenario is planned with the
+// TebOptimalPlanner and the HomotopyClassPlanner for a fixed number of cycles and the node reports
+// cycle time percentiles, solver iterations, graph sizes and heap allocations per cycle.
+
+#include <teb_local_planner/teb_local_planner_ros.h>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <cmath>
+#include <string>
+#include <vector>
+
+
+using namespace teb_local_planner; // it is ok here to import everything for testing purposes
+
+// ============= Allocation counters ================
+// All the heap allocations of the process are counted (including the ones of the ros threads, which are
+// negligible since the node does not spin). With glibc, malloc() is interposed so that also the Eigen
+// aligned allocations (vertices and edges of g2o) are taken into account, otherwise only operator new is.
+namespace
+{
+std::atomic<unsigned long> g_num_allocations(0);
+std::atomic<unsigned long> g_allocated_bytes(0);
+
+inline void countAllocation(std::size_t size)
+{
+  g_num_allocations.fetch_add(1, std::memory_order_relaxed);
+  g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+}
+
+#ifdef __GLIBC__
+
+extern "C"
+{
+void* __libc_malloc(std::size_t size);
+void* __libc_calloc(std::size_t num, std::size_t size);
+void* __libc_realloc(void* ptr, std::size_t size);
+
+void* malloc(std::size_t size)
+{
+  countAllocation(size);
+  return __libc_malloc(size);
+}
+
+void* calloc(std::size_t num, std::size_t size)
+{
+  countAllocation(num*size);
+  return __libc_calloc(num, size);
+}
+
+void* realloc(void* ptr, std::size_t size)
+{
+  countAllocation(size);
+  return __libc_realloc(ptr, size);
+}
+}
+
+#else
+
+void* operator new(std::size_t size)
+{
+  countAllocation(size);
+  void* ptr = std::malloc(size ? size : 1);
+  if (!ptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+#endif
+
+
+// ============= Scenarios ================
+
+struct Scenario
+{
+  std::string name;
+  PoseSE2 start;
+  PoseSE2 goal;
+  ObstContainer obstacles;
+  std::vector<Eigen::Vector2d, Eigen::aligned_allocator<Eigen::Vector2d> > obstacle_velocities; //!< velocity of each obstacle (point and circular obstacles are moved at each cycle)
+  ViaPointContainer via_points;
+  TebConfig config; //!< base config plus the overrides of the scenario
+  double cycle_dt = 0.1; //!< time [s] the obstacles are moved forward at each cycle
+  bool reinit_every_cycle = false; //!< if true the planner is cleared before each cycle (cold start)
+};
+
+struct CycleStats
+{
+  double time_ms = 0;
+  bool success = false;
+  int num_tebs = 0;
+  int outer_iterations = 0;
+  int solver_iterations = 0;
+  int num_vertices = 0;
+  int num_edges = 0;
+  unsigned long num_allocations = 0;
+  unsigned long allocated_bytes = 0;
+};
+
+struct BenchmarkResult
+{
+  std::string scenario;
+  std::string planner;
+  std::vector<CycleStats> cycles;
+};
+
+
+bool readPose(const ros::NodeHandle& nh, const std::string& name, PoseSE2& pose)
+{
+  XmlRpc::XmlRpcValue value;
+  if (!nh.getParam(name, value))
+    return false;
+  std::string full_name = nh.resolveName(name);
+  if (value.getType() != XmlRpc::XmlRpcValue::TypeArray || value.size() != 3)
+  {
+    ROS_ERROR_STREAM("benchmark: the parameter " << full_name << " must be a list [x, y, theta]");
+    return false;
+  }
+  pose = PoseSE2(TebLocalPlannerROS::getNumberFromXMLRPC(value[0], full_name),
+                 TebLocalPlannerROS::getNumberFromXMLRPC(value[1], full_name),
+                 TebLocalPlannerROS::getNumberFromXMLRPC(value[2], full_name));
+  return true;
+}
+
+double readNumber(XmlRpc::XmlRpcValue& value, const std::string& key, const std::string& full_name, double default_value)
+{
+  if (!value.hasMember(key))
+    return default_value;
+  return TebLocalPlannerROS::getNumberFromXMLRPC(value[key], full_name + "/" + key);
+}
+
+bool readObstacle(XmlRpc::XmlRpcValue& value, const std::string& full_name, Scenario& scenario)
+{
+  if (value.getType() != XmlRpc::XmlRpcValue::TypeStruct || !value.hasMember("type"))
+  {
+    ROS_ERROR_STREAM("benchmark: the obstacle " << full_name << " must be a dictionary with a 'type' field");
+    return false;
+  }
+
+  const std::string type = static_cast<std::string>(value["type"]);
+  ObstaclePtr obstacle;
+  if (type == "point")
+  {
+    obstacle = boost::make_shared<PointObstacle>(readNumber(value, "x", full_name, 0), readNumber(value, "y", full_name, 0));
+  }
+  else if (type == "circular")
+  {
+    obstacle = boost::make_shared<CircularObstacle>(readNumber(value, "x", full_name, 0), readNumber(value, "y", full_name, 0),
+                                                    readNumber(value, "radius", full_name, 0));
+  }
+  else if (type == "line")
+  {
+    obstacle = boost::make_shared<LineObstacle>(readNumber(value, "x1", full_name, 0), readNumber(value, "y1", full_name, 0),
+                                                readNumber(value, "x2", full_name, 0), readNumber(value, "y2", full_name, 0));
+  }
+  else if (type == "polygon")
+  {
+    if (!value.hasMember("vertices"))
+    {
+      ROS_ERROR_STREAM("benchmark: the polygon obstacle " << full_name << " has no 'vertices' field");
+      return false;
+    }
+    Point2dContainer vertices = TebLocalPlannerROS::makeFootprintFromXMLRPC(value["vertices"], full_name + "/vertices");
+    obstacle = boost::make_shared<PolygonObstacle>(vertices);
+  }
+  else
+  {
+    ROS_ERROR_STREAM("benchmark: unknown type '" << type << "' of the obstacle " << full_name);
+    return false;
+  }
+
+  Eigen::Vector2d velocity(readNumber(value, "vx", full_name, 0), readNumber(value, "vy", full_name, 0));
+  if (!velocity.isZero())
+    obstacle->setCentroidVelocity(velocity);
+
+  scenario.obstacles.push_back(obstacle);
+  scenario.obstacle_velocities.push_back(velocity);
+  return true;
+}
+
+bool loadScenario(const ros::NodeHandle& nh, const std::string& name, const TebConfig& base_config, Scenario& scenario)
+{
+  ros::NodeHandle scenario_nh(nh, "scenario/" + name);
+  scenario.name = name;
+
+  if (!readPose(scenario_nh, "start", scenario.start) || !readPose(scenario_nh, "goal", scenario.goal))
+  {
+    ROS_ERROR_STREAM("benchmark: the scenario " << scenario_nh.getNamespace() << " must define 'start' and 'goal'");
+    return false;
+  }
+
+  XmlRpc::XmlRpcValue obstacles;
+  if (scenario_nh.getParam("obstacles", obstacles))
+  {
+    const std::string full_name = scenario_nh.resolveName("obstacles");
+    if (obstacles.getType() != XmlRpc::XmlRpcValue::TypeArray)
+    {
+      ROS_ERROR_STREAM("benchmark: the parameter " << full_name << " must be a list");
+      return false;
+    }
+    for (int i = 0; i < obstacles.size(); ++i)
+    {
+      if (!readObstacle(obstacles[i], full_name + "[" + std::to_string(i) + "]", scenario))
+        return false;
+    }
+  }
+
+  XmlRpc::XmlRpcValue via_points;
+  if (scenario_nh.getParam("via_points", via_points))
+  {
+    const std::string full_name = scenario_nh.resolveName("via_points");
+    if (via_points.getType() != XmlRpc::XmlRpcValue::TypeArray)
+    {
+      ROS_ERROR_STREAM("benchmark: the parameter " << full_name << " must be a list of [x, y]");
+      return false;
+    }
+    for (int i = 0; i < via_points.size(); ++i)
+    {
+      if (via_points[i].getType() != XmlRpc::XmlRpcValue::TypeArray || via_points[i].size() != 2)
+      {
+        ROS_ERROR_STREAM("benchmark: the via-point " << full_name << "[" << i << "] must be a list [x, y]");
+        return false;
+      }
+      scenario.via_points.emplace_back(TebLocalPlannerROS::getNumberFromXMLRPC(via_points[i][0], full_name),
+                                       TebLocalPlannerROS::getNumberFromXMLRPC(via_points[i][1], full_name));
+    }
+  }
+
+  scenario_nh.param("cycle_dt", scenario.cycle_dt, scenario.cycle_dt);
+  scenario_nh.param("reinit_every_cycle", scenario.reinit_every_cycle, scenario.reinit_every_cycle);
+
+  // the teb parameters defined in the scenario namespace override the base ones
+  scenario.config = base_config;
+  scenario.config.loadRosParamFromNodeHandle(scenario_nh);
+
+  // robot model of the scenario (the base one if not specified)
+  if (scenario_nh.hasParam("footprint_model/type"))
+    scenario.config.robot_model = TebLocalPlannerROS::getRobotFootprintFromParamServer(scenario_nh, scenario.config);
+
+  return true;
+}
+
+void moveObstacles(Scenario& scenario)
+{
+  for (std::size_t i = 0; i < scenario.obstacles.size(); ++i)
+  {
+    const Eigen::Vector2d& velocity = scenario.obstacle_velocities[i];
+    if (velocity.isZero())
+      continue;
+
+    Obstacle* obstacle = scenario.obstacles[i].get();
+    if (PointObstacle* point = dynamic_cast<PointObstacle*>(obstacle))
+      point->position() += velocity * scenario.cycle_dt;
+    else if (CircularObstacle* circle = dynamic_cast<CircularObstacle*>(obstacle))
+      circle->position() += velocity * scenario.cycle_dt;
+  }
+}
+
+
+// ============= Benchmark ================
+
+void collectStatistics(const TebOptimalPlanner& planner, CycleStats& stats)
+{
+  const TebOptimalPlanner::OptimizationStatistics& optim_stats = planner.getOptimizationStatistics();
+  stats.num_tebs++;
+  stats.outer_iterations += optim_stats.outer_iterations;
+  stats.solver_iterations += optim_stats.solver_iterations;
+  stats.num_vertices += optim_stats.num_vertices;
+  stats.num_edges += optim_stats.num_edges;
+}
+
+BenchmarkResult runBenchmark(Scenario& scenario, const std::string& planner_type, int num_cycles, int num_warmup_cycles)
+{
+  BenchmarkResult result;
+  result.scenario = scenario.name;
+  result.planner = planner_type;
+  result.cycles.reserve(num_cycles);
+
+  // obstacles are moved during the run: restore them at the end
+  std::vector<Eigen::Vector2d, Eigen::aligned_allocator<Eigen::Vector2d> > initial_positions;
+  for (const ObstaclePtr& obstacle : scenario.obstacles)
+    initial_positions.push_back(obstacle->getCentroid());
+
+  PlannerInterfacePtr planner;
+  if (planner_type == "homotopy")
+    planner = PlannerInterfacePtr(new HomotopyClassPlanner(scenario.config, &scenario.obstacles, TebVisualizationPtr(), &scenario.via_points));
+  else
+    planner = PlannerInterfacePtr(new TebOptimalPlanner(scenario.config, &scenario.obstacles, TebVisualizationPtr(), &scenario.via_points));
+
+  for (int i = 0; i < num_warmup_cycles + num_cycles; ++i)
+  {
+    if (scenario.reinit_every_cycle)
+      planner->clearPlanner();
+
+    const unsigned long num_allocations = g_num_allocations.load(std::memory_order_relaxed);
+    const unsigned long allocated_bytes = g_allocated_bytes.load(std::memory_order_relaxed);
+    const std::chrono::steady_clock::time_point t_start = std::chrono::steady_clock::now();
+
+    const bool success = planner->plan(scenario.start, scenario.goal);
+
+    const std::chrono::steady_clock::time_point t_end = std::chrono::steady_clock::now();
+
+    if (i >= num_warmup_cycles)
+    {
+      CycleStats stats;
+      stats.time_ms = std::chrono::duration<double, std::milli>(t_end - t_start).count();
+      stats.num_allocations = g_num_allocations.load(std::memory_order_relaxed) - num_allocations;
+      stats.allocated_bytes = g_allocated_bytes.load(std::memory_order_relaxed) - allocated_bytes;
+      stats.success = success;
+
+      if (HomotopyClassPlanner* hcp = dynamic_cast<HomotopyClassPlanner*>(planner.get()))
+      {
+        for (const TebOptimalPlannerPtr& teb : hcp->getTrajectoryContainer())
+          collectStatistics(*teb, stats);
+      }
+      else
+      {
+        collectStatistics(static_cast<const TebOptimalPlanner&>(*planner), stats);
+      }
+      result.cycles.push_back(stats);
+    }
+
+    moveObstacles(scenario);
+  }
+
+  for (std::size_t i = 0; i < scenario.obstacles.size(); ++i)
+  {
+    Obstacle* obstacle = scenario.obstacles[i].get();
+    if (PointObstacle* point = dynamic_cast<PointObstacle*>(obstacle))
+      point->position() = initial_positions[i];
+    else if (CircularObstacle* circle = dynamic_cast<CircularObstacle*>(obstacle))
+      circle->position() = initial_positions[i];
+  }
+
+  return result;
+}
+
+// nearest-rank percentile of the sorted values
+double percentile(const std::vector<double>& sorted_values, double p)
+{
+  if (sorted_values.empty())
+    return 0;
+  std::size_t rank = static_cast<std::size_t>(std::ceil(p / 100.0 * sorted_values.size()));
+  rank = std::min(std::max<std::size_t>(rank, 1), sorted_values.size());
+  return sorted_values[rank - 1];
+}
+
+template <typename T>
+double mean(const std::vector<CycleStats>& cycles, T CycleStats::*field)
+{
+  if (cycles.empty())
+    return 0;
+  double sum = 0;
+  for (const CycleStats& stats : cycles)
+    sum += static_cast<double>(stats.*field);
+  return sum / cycles.size();
+}
+
+void printReport(const std::vector<BenchmarkResult>& results, std::FILE* out, bool csv)
+{
+  if (csv)
+    std::fprintf(out, "scenario,planner,cycles,success_rate,time_p50_ms,time_p90_ms,time_p99_ms,time_max_ms,time_mean_ms,"
+                      "tebs,outer_iterations,solver_iterations,vertices,edges,allocations,allocated_kb\n");
+  else
+    std::fprintf(out, "%-24s %-9s %6s %6s %8s %8s %8s %8s %5s %6s %7s %7s %7s %9s %10s\n",
+                 "scenario", "planner", "cycles", "succ%", "p50[ms]", "p90[ms]", "p99[ms]", "max[ms]",
+                 "tebs", "outer", "iters", "verts", "edges", "allocs", "alloc[kB]");
+
+  for (const BenchmarkResult& result : results)
+  {
+    std::vector<double> times;
+    times.reserve(result.cycles.size());
+    for (const CycleStats& stats : result.cycles)
+      times.push_back(stats.time_ms);
+    std::sort(times.begin(), times.end());
+
+    const double success_rate = 100.0 * mean(result.cycles, &CycleStats::success);
+    const char* format = csv ? "%s,%s,%zu,%.1f,%.3f,%.3f,%.3f,%.3f,%.3f,%.2f,%.2f,%.2f,%.1f,%.1f,%.1f,%.1f\n"
+                             : "%-24s %-9s %6zu %6.1f %8.3f %8.3f %8.3f %8.3f %5.2f %6.2f %7.2f %7.1f %7.1f %9.1f %10.1f\n";
+    if (csv)
+      std::fprintf(out, format, result.scenario.c_str(), result.planner.c_str(), result.cycles.size(), success_rate,
+                   percentile(times, 50), percentile(times, 90), percentile(times, 99), percentile(times, 100),
+                   mean(result.cycles, &CycleStats::time_ms), mean(result.cycles, &CycleStats::num_tebs),
+                   mean(result.cycles, &CycleStats::outer_iterations), mean(result.cycles, &CycleStats::solver_iterations),
+                   mean(result.cycles, &CycleStats::num_vertices), mean(result.cycles, &CycleStats::num_edges),
+                   mean(result.cycles, &CycleStats::num_allocations), mean(result.cycles, &CycleStats::allocated_bytes) / 1024.0);
+    else
+      std::fprintf(out, format, result.scenario.c_str(), result.planner.c_str(), result.cycles.size(), success_rate,
+                   percentile(times, 50), percentile(times, 90), percentile(times, 99), percentile(times, 100),
+                   mean(result.cycles, &CycleStats::num_tebs),
+                   mean(result.cycles, &CycleStats::outer_iterations), mean(result.cycles, &CycleStats::solver_iterations),
+                   mean(result.cycles, &CycleStats::num_vertices), mean(result.cycles, &CycleStats::num_edges),
+                   mean(result.cycles, &CycleStats::num_allocations), mean(result.cycles, &CycleStats::allocated_bytes) / 1024.0);
+  }
+}
+
+
+// =============== Main function =================
+int main( int argc, char** argv )
+{
+  ros::init(argc, argv, "benchmark_optim_node");
+  ros::NodeHandle n("~");
+
+  // base config and robot model (overridden by the single scenarios)
+  TebConfig config;
+  config.loadRosParamFromNodeHandle(n);
+  config.robot_model = TebLocalPlannerROS::getRobotFootprintFromParamServer(n, config);
+
+  int num_cycles = 100;
+  int num_warmup_cycles = 5;
+  std::vector<std::string> planners = {"teb", "homotopy"};
+  std::vector<std::string> scenario_names;
+  std::string output_file;
+  n.param("cycles", num_cycles, num_cycles);
+  n.param("warmup_cycles", num_warmup_cycles, num_warmup_cycles);
+  n.param("planners", planners, planners);
+  n.param("output_file", output_file, output_file);
+  if (!n.getParam("scenarios", scenario_names) || scenario_names.empty())
+  {
+    ROS_ERROR("benchmark: no scenarios specified with the parameter '%s'", n.resolveName("scenarios").c_str());
+    return 1;
+  }
+
+  std::vector<Scenario> scenarios(scenario_names.size());
+  for (std::size_t i = 0; i < scenario_names.size(); ++i)
+  {
+    if (!loadScenario(n, scenario_names[i], config, scenarios[i]))
+      return 1;
+  }
+
+  std::vector<BenchmarkResult> results;
+  for (Scenario& scenario : scenarios)
+  {
+    for (const std::string& planner_type : planners)
+    {
+      if (planner_type != "teb" && planner_type != "homotopy")
+      {
+        ROS_WARN("benchmark: unknown planner '%s' (expected 'teb' or 'homotopy'), skipped", planner_type.c_str());
+        continue;
+      }
+      ROS_INFO("benchmark: running scenario '%s' with planner '%s' (%d cycles)", scenario.name.c_str(), planner_type.c_str(), num_cycles);
+      results.push_back(runBenchmark(scenario, planner_type, num_cycles, num_warmup_cycles));
+    }
+  }
+
+  printReport(results, stdout, false);
+
+  if (!output_file.empty())
+  {
+    std::FILE* out = std::fopen(output_file.c_str(), "w");
+    if (!out)
+    {
+      ROS_ERROR("benchmark: cannot open the output file %s", output_file.c_str());
+      return 1;
+    }
+    printReport(results, out, true);
+    std::fclose(out);
+    ROS_INFO("benchmark: results written to %s", output_file.c_str());
+  }
+
+  return 0;
+}
@@ -0,0 +1,124 @@
+/*********************************************************************
+ *
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016,
+ *  TU Dortmund - Institute of Control Theory and Systems Engineering.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the institute nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: Luigi Freda
+ *********************************************************************/
+
+#include <teb_local_planner/footprint_distance_field.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace teb_local_planner
+{
+
+const int FootprintDistanceField::kMaxNumSamples = 4000000;
+
+
+FootprintDistanceField::FootprintDistanceField() : origin_x_(0.0), origin_y_(0.0), resolution_(0.0), inv_resolution_(0.0), margin_(0.0),
+                                                   size_x_(0), size_y_(0), max_coord_x_(0.0), max_coord_y_(0.0)
+{
+}
+
+void FootprintDistanceField::clear()
+{
+  values_.clear();
+  size_x_ = size_y_ = 0;
+  max_coord_x_ = max_coord_y_ = 0.0;
+}
+
+bool FootprintDistanceField::build(const Point2dContainer& vertices, double resolution, double margin)
+{
+  clear();
+  resolution_ = resolution;
+  margin_ = margin;
+  
+  if (vertices.size() < 3 || !(resolution > 0.0) || !(margin >= 0.0))
+    return false;
+
+  Eigen::Vector2d min_corner = vertices.front();
+  Eigen::Vector2d max_corner = vertices.front();
+  for (const Eigen::Vector2d& vertex : vertices)
+  {
+    min_corner = min_corner.cwiseMin(vertex);
+    max_corner = max_corner.cwiseMax(vertex);
+  }
+  min_corner.array() -= margin;
+  max_corner.array() += margin;
+
+  // at least two samples per axis (one cell) in order to interpolate
+  const double num_x = std::ceil((max_corner.x() - min_corner.x()) / resolution) + 1;
+  const double num_y = std::ceil((max_corner.y() - min_corner.y()) / resolution) + 1;
+  if (num_x * num_y > kMaxNumSamples)
+    return false;
+
+  origin_x_ = min_corner.x();
+  origin_y_ = min_corner.y();
+  inv_resolution_ = 1.0 / resolution;
+  size_x_ = std::max(2, static_cast<int>(num_x));
+  size_y_ = std::max(2, static_cast<int>(num_y));
+  max_coord_x_ = size_x_ - 1;
+  max_coord_y_ = size_y_ - 1;
+
+  values_.resize(size_x_ * size_y_);
+  for (int iy = 0; iy < size_y_; ++iy)
+  {
+    for (int ix = 0; ix < size_x_; ++ix)
+    {
+      const Eigen::Vector2d point(origin_x_ + ix * resolution, origin_y_ + iy * resolution);
+      values_[iy * size_x_ + ix] = computeSignedDistance(point, vertices);
+    }
+  }
+  return true;
+}
+
+double FootprintDistanceField::computeSignedDistance(const Eigen::Vector2d& point, const Point2dContainer& vertices)
+{
+  const double dist = distance_point_to_polygon_2d(point, vertices);
+
+  // crossing number test
+  bool inside = false;
+  for (std::size_t i = 0, j = vertices.size() - 1; i < vertices.size(); j = i++)
+  {
+    const Eigen::Vector2d& vi = vertices[i];
+    const Eigen::Vector2d& vj = vertices[j];
+    if ( (vi.y() > point.y()) != (vj.y() > point.y()) &&
+         point.x() < (vj.x() - vi.x()) * (point.y() - vi.y()) / (vj.y() - vi.y()) + vi.x() )
+      inside = !inside;
+  }
+  return inside ? -dist : dist;
+}
+
+} // namespace teb_local_planner
@@ -38,6 +38,11 @@
 
 #include <teb_local_planner/graph_search.h>
 #include <teb_local_planner/homotopy_class_planner.h>
+#include <teb_local_planner/h_signature.h>
+
+#include <algorithm>
+#include <functional>
+#include <queue>
 
 namespace teb_local_planner
 {
@@ -89,6 +94,162 @@ void GraphSearchInterface::DepthFirst(HcGraph& g, std::vector<HcGraphVertexType>
 }
 
 
+void GraphSearchInterface::BestFirst(const HcGraph& g, const HcGraphVertexType& start, const HcGraphVertexType& goal, double start_orientation,
+                                     double goal_orientation, const geometry_msgs::Twist* start_velocity, bool free_goal_vel)
+{
+  typedef HSignatureSegments::cplx cplx;
+
+  // Partial path: last vertex, index of the node of the previous vertex, length and H-signature of the path
+  struct SearchNode
+  {
+    HcGraphVertexType vertex;
+    int parent;
+    double cost;
+    cplx hsignature;
+  };
+  typedef std::pair<double, int> QueueEntry; // (cost + distance to goal, node index)
+
+  const int max_classes = cfg_->hcp.max_number_classes;
+  if ((int)hcp_->getTrajectoryContainer().size() >= max_classes)
+    return; // We do not need to search for further possible alternative homotopy classes.
+
+  // The H-signature of the 2d obstacle configuration is only used to compare the prefixes: the class of the complete paths
+  // is checked by the planner (which also takes dynamic obstacles into account).
+  const HSignatureSegments segments(*cfg_, hcp_->obstacles(), getCplxFromHcGraph(start, g), getCplxFromHcGraph(goal, g));
+  const Eigen::Vector2d& goal_pos = g[goal].pos;
+
+  std::vector<SearchNode> nodes;
+  std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry> > open;
+  std::vector< std::vector<cplx> > expanded(boost::num_vertices(g)); // prefix classes expanded from each vertex
+
+  SearchNode root = {start, -1, 0.0, cplx(0, 0)};
+  nodes.push_back(root);
+  open.push(QueueEntry((goal_pos - g[start].pos).norm(), 0));
+
+  std::vector<HcGraphVertexType> path;
+  while (!open.empty() && (int)hcp_->getTrajectoryContainer().size() < max_classes)
+  {
+    const int node_idx = open.top().second;
+    open.pop();
+    const SearchNode node = nodes[node_idx]; // copy, nodes is extended below
+
+    // Prune the path if a cheaper one with an equivalent prefix already reached this vertex
+    std::vector<cplx>& vertex_classes = expanded[node.vertex];
+    bool dominated = false;
+    for (std::size_t k = 0; k < vertex_classes.size() && !dominated; ++k)
+      dominated = HSignatureSegments::isEqual(*cfg_, vertex_classes[k], node.hsignature);
+    if (dominated || (node.vertex != goal && (int)vertex_classes.size() >= max_classes))
+      continue;
+    vertex_classes.push_back(node.hsignature);
+
+    if (node.vertex == goal) // goal reached
+    {
+      path.clear();
+      for (int k = node_idx; k >= 0; k = nodes[k].parent)
+        path.push_back(nodes[k].vertex);
+      std::reverse(path.begin(), path.end());
+
+      // Add new TEB, if this path belongs to a new homotopy class
+      hcp_->addAndInitNewTeb(path.begin(), path.end(), boost::bind(getVector2dFromHcGraph, _1, boost::cref(g)),
+                             start_orientation, goal_orientation, start_velocity, free_goal_vel);
+      continue;
+    }
+
+    // Expand: the edges point towards the goal, hence the paths are simple
+    HcGraphAdjecencyIterator it, end;
+    for ( boost::tie(it,end) = boost::adjacent_vertices(node.vertex,g); it!=end; ++it)
+    {
+      const Eigen::Vector2d& pos = g[node.vertex].pos;
+      const Eigen::Vector2d& next_pos = g[*it].pos;
+      SearchNode child = {*it, node_idx, node.cost + (next_pos - pos).norm(),
+                          node.hsignature + segments.segmentValue(getCplxFromHcGraph(node.vertex, g), getCplxFromHcGraph(*it, g))};
+      nodes.push_back(child);
+      open.push(QueueEntry(child.cost + (goal_pos - next_pos).norm(), (int)nodes.size() - 1));
+    }
+  }
+}
+
+
+void GraphSearchInterface::searchPaths(const HcGraphVertexType& start, const HcGraphVertexType& goal, double start_orientation, double goal_orientation,
+                                       const geometry_msgs::Twist* start_velocity, bool free_goal_vel)
+{
+  if (cfg_->hcp.graph_search_best_first)
+  {
+    BestFirst(graph_, start, goal, start_orientation, goal_orientation, start_velocity, free_goal_vel);
+    return;
+  }
+
+  std::vector<HcGraphVertexType> visited;
+  visited.push_back(start);
+  DepthFirst(graph_, visited, goal, start_orientation, goal_orientation, start_velocity, free_goal_vel);
+}
+
+
+const ObstacleGridIndex* GraphSearchInterface::updateObstacleIndex()
+{
+  const ObstContainer* obstacles = hcp_->obstacles();
+  if (obstacles == NULL)
+    return NULL;
+  if (hcp_->obstacleIndex() != NULL && hcp_->obstacleIndex()->isValidFor(obstacles))
+    return hcp_->obstacleIndex();
+  if (!obstacle_index_.isValidFor(obstacles))
+    obstacle_index_.build(*obstacles);
+  return &obstacle_index_;
+}
+
+
+bool GraphSearchInterface::checkEdgeCollision(const ObstacleGridIndex* index, const Eigen::Vector2d& line_start, const Eigen::Vector2d& line_end, double min_dist)
+{
+  const ObstContainer& obstacles = *hcp_->obstacles();
+  index->querySegment(line_start, line_end, min_dist, obstacle_candidates_);
+  for (std::size_t k = 0; k < obstacle_candidates_.size(); ++k)
+  {
+    if ( obstacles[obstacle_candidates_[k]]->checkLineIntersection(line_start, line_end, min_dist) )
+      return true;
+  }
+  return false;
+}
+
+
+void GraphSearchInterface::addCandidateEdges(HcGraphVertexType vertex, std::vector<HcGraphVertexType>& candidates, const ObstacleGridIndex* index, double min_dist)
+{
+  const Eigen::Vector2d& pos = graph_[vertex].pos;
+  const int max_neighbors = cfg_->hcp.roadmap_graph_max_neighbors;
+  std::size_t num_edges = candidates.size();
+
+  if (max_neighbors > 0 && (int)candidates.size() > max_neighbors)
+  {
+    // check the nearest candidates first and keep the first max_neighbors collision free ones
+    std::sort(candidates.begin(), candidates.end(), [&](HcGraphVertexType a, HcGraphVertexType b)
+    {
+      const double dist_a = (graph_[a].pos - pos).squaredNorm();
+      const double dist_b = (graph_[b].pos - pos).squaredNorm();
+      return dist_a < dist_b || (dist_a == dist_b && a < b);
+    });
+    num_edges = 0;
+    for (std::size_t k = 0; k < candidates.size() && (int)num_edges < max_neighbors; ++k)
+    {
+      if (index == NULL || !checkEdgeCollision(index, pos, graph_[candidates[k]].pos, min_dist))
+        candidates[num_edges++] = candidates[k];
+    }
+    std::sort(candidates.begin(), candidates.begin() + num_edges); // restore the vertex order
+  }
+  else if (index != NULL)
+  {
+    num_edges = 0;
+    for (std::size_t k = 0; k < candidates.size(); ++k)
+    {
+      if (!checkEdgeCollision(index, pos, graph_[candidates[k]].pos, min_dist))
+        candidates[num_edges++] = candidates[k];
+    }
+  }
+
+  // Create Edges
+  for (std::size_t k = 0; k < num_edges; ++k)
+    boost::add_edge(vertex, candidates[k], graph_);
+}
+
+
 
 void lrKeyPointGraph::createGraph(const PoseSE2& start, const PoseSE2& goal, double dist_to_obst, double obstacle_heading_threshold, const geometry_msgs::Twist* start_velocity, bool free_goal_vel)
 {
@@ -153,9 +314,11 @@ void lrKeyPointGraph::createGraph(const PoseSE2& start, const PoseSE2& goal, dou
   graph_[goal_vtx].pos = goal.position();
 
   // Insert Edges
+  const ObstacleGridIndex* obstacle_index = updateObstacleIndex();
   HcGraphVertexIterator it_i, end_i, it_j, end_j;
   for (boost::tie(it_i,end_i) = boost::vertices(graph_); it_i!=end_i-1; ++it_i) // ignore goal in this loop
   {
+    vertex_candidates_.clear();
     for (boost::tie(it_j,end_j) = boost::vertices(graph_); it_j!=end_j; ++it_j) // check all forward connections
     {
       if (it_i==it_j)
@@ -186,33 +349,16 @@ void lrKeyPointGraph::createGraph(const PoseSE2& start, const PoseSE2& goal, dou
         }
       }
 
-      // Collision Check
-
-      if (hcp_->obstacles()!=NULL)
-      {
-        bool collision = false;
-        for (ObstContainer::const_iterator it_obst = hcp_->obstacles()->begin(); it_obst != hcp_->obstacles()->end(); ++it_obst)
-        {
-          if ( (*it_obst)->checkLineIntersection(graph_[*it_i].pos,graph_[*it_j].pos, 0.5*dist_to_obst) )
-          {
-            collision = true;
-            break;
-          }
-        }
-        if (collision)
-          continue;
-      }
-
-      // Create Edge
-      boost::add_edge(*it_i,*it_j,graph_);
+      vertex_candidates_.push_back(*it_j);
     }
+
+    // Collision Check and Edge Creation
+    addCandidateEdges(*it_i, vertex_candidates_, obstacle_index, 0.5*dist_to_obst);
   }
 
 
   // Find all paths between start and goal!
-  std::vector<HcGraphVertexType> visited;
-  visited.push_back(start_vtx);
-  DepthFirst(graph_,visited,goal_vtx, start.theta(), goal.theta(), start_velocity, free_goal_vel);
+  searchPaths(start_vtx, goal_vtx, start.theta(), goal.theta(), start_velocity, free_goal_vel);
 }
 
 
@@ -263,34 +409,35 @@ void ProbRoadmapGraph::createGraph(const PoseSE2& start, const PoseSE2& goal, do
   diff.normalize(); // normalize in place
 
 
-  // Start sampling
-  for (int i=0; i < cfg_->hcp.roadmap_graph_no_samples; ++i)
+  // Reuse the samples of the last roadmap if start and goal did not move significantly
+  const double resample_dist = cfg_->hcp.roadmap_graph_resample_distance;
+  const bool reuse_samples = resample_dist > 0 && (int)samples_.size() == cfg_->hcp.roadmap_graph_no_samples
+                             && samples_area_width_ == area_width && samples_area_length_scale_ == cfg_->hcp.roadmap_graph_area_length_scale
+                             && (start.position() - samples_start_).norm() < resample_dist && (goal.position() - samples_goal_).norm() < resample_dist;
+
+  if (!reuse_samples)
   {
-    Eigen::Vector2d sample;
-//     bool coll_free;
-//     do // sample as long as a collision free sample is found
-//     {
+    samples_.clear();
+    samples_start_ = start.position();
+    samples_goal_ = goal.position();
+    samples_area_width_ = area_width;
+    samples_area_length_scale_ = cfg_->hcp.roadmap_graph_area_length_scale;
+
+    // Start sampling
+    for (int i=0; i < cfg_->hcp.roadmap_graph_no_samples; ++i)
+    {
       // Sample coordinates
-      sample = area_origin + rot_phi*Eigen::Vector2d(distribution_x(rnd_generator_), distribution_y(rnd_generator_));
-
-      // Test for collision
       // we do not care for collision checking here to improve efficiency, since we perform resampling repeatedly.
       // occupied vertices are ignored in the edge insertion state since they always violate the edge-obstacle collision check.
-//       coll_free = true;
-//       for (ObstContainer::const_iterator it_obst = obstacles_->begin(); it_obst != obstacles_->end(); ++it_obst)
-//       {
-//         if ( (*it_obst)->checkCollision(sample, dist_to_obst)) // TODO really keep dist_to_obst here?
-//         {
-//           coll_free = false;
-//           break;
-//         }
-//       }
-//
-//     } while (!coll_free && ros::ok());
+      samples_.push_back(area_origin + rot_phi*Eigen::Vector2d(distribution_x(rnd_generator_), distribution_y(rnd_generator_)));
+    }
+  }
 
+  for (std::size_t i=0; i < samples_.size(); ++i)
+  {
     // Add new vertex
     HcGraphVertexType v = boost::add_vertex(graph_);
-    graph_[v].pos = sample;
+    graph_[v].pos = samples_[i];
   }
 
   // Now add goal vertex
@@ -299,9 +446,11 @@ void ProbRoadmapGraph::createGraph(const PoseSE2& start, const PoseSE2& goal, do
 
 
   // Insert Edges
+  const ObstacleGridIndex* obstacle_index = updateObstacleIndex();
   HcGraphVertexIterator it_i, end_i, it_j, end_j;
   for (boost::tie(it_i,end_i) = boost::vertices(graph_); it_i!=boost::prior(end_i); ++it_i) // ignore goal in this loop
   {
+    vertex_candidates_.clear();
     for (boost::tie(it_j,end_j) = boost::vertices(graph_); it_j!=end_j; ++it_j) // check all forward connections
     {
       if (it_i==it_j) // same vertex found
@@ -314,29 +463,15 @@ void ProbRoadmapGraph::createGraph(const PoseSE2& start, const PoseSE2& goal, do
       if (distij.dot(diff)<=obstacle_heading_threshold)
           continue; // diff is already normalized
 
-
-      // Collision Check
-      bool collision = false;
-      for (ObstContainer::const_iterator it_obst = hcp_->obstacles()->begin(); it_obst != hcp_->obstacles()->end(); ++it_obst)
-      {
-        if ( (*it_obst)->checkLineIntersection(graph_[*it_i].pos,graph_[*it_j].pos, dist_to_obst) )
-        {
-          collision = true;
-          break;
-        }
-      }
-      if (collision)
-        continue;
-
-      // Create Edge
-      boost::add_edge(*it_i,*it_j,graph_);
+      vertex_candidates_.push_back(*it_j);
     }
+
+    // Collision Check and Edge Creation
+    addCandidateEdges(*it_i, vertex_candidates_, obstacle_index, dist_to_obst);
   }
 
   /// Find all paths between start and goal!
-  std::vector<HcGraphVertexType> visited;
-  visited.push_back(start_vtx);
-  DepthFirst(graph_,visited,goal_vtx, start.theta(), goal.theta(), start_velocity, free_goal_vel);
+  searchPaths(start_vtx, goal_vtx, start.theta(), goal.theta(), start_velocity, free_goal_vel);
 }
 
 } // end namespace
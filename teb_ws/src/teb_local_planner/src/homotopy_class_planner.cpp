@@ -38,12 +38,14 @@
 
 #include <teb_local_planner/homotopy_class_planner.h>
 
+#include <boost/make_shared.hpp>
+
 #include <limits>
 
 namespace teb_local_planner
 {
 
-HomotopyClassPlanner::HomotopyClassPlanner() : cfg_(NULL), obstacles_(NULL), via_points_(NULL), initial_plan_(NULL), initialized_(false)
+HomotopyClassPlanner::HomotopyClassPlanner() : cfg_(NULL), obstacles_(NULL), obstacle_index_(NULL), via_points_(NULL), initial_plan_(NULL), initialized_(false)
 {
 }
 
@@ -62,6 +64,7 @@ void HomotopyClassPlanner::initialize(const TebConfig& cfg, ObstContainer* obsta
 {
   cfg_ = &cfg;
   obstacles_ = obstacles;
+  obstacle_index_ = NULL;
   via_points_ = via_points;
 
   if (cfg_->hcp.simple_exploration)
@@ -317,6 +320,8 @@ void HomotopyClassPlanner::updateReferenceTrajectoryViaPoints(bool all_trajector
     // enable via-points for all tebs
     for (std::size_t i=0; i < equivalence_classes_.size(); ++i)
     {
+        if (tebs_[i] == prestarted_teb_) // already being optimized (via-points were set before)
+          continue;
         tebs_[i]->setViaPoints(via_points_);
     }
   }
@@ -325,6 +330,8 @@ void HomotopyClassPlanner::updateReferenceTrajectoryViaPoints(bool all_trajector
     // enable via-points for teb in the same hommotopy class as the initial_plan and deactivate it for all other ones
     for (std::size_t i=0; i < equivalence_classes_.size(); ++i)
     {
+      if (tebs_[i] == prestarted_teb_) // already being optimized (via-points were set before)
+        continue;
       if(initial_plan_eq_class_->isEqual(*equivalence_classes_[i].first))
         tebs_[i]->setViaPoints(via_points_);
       else
@@ -351,6 +358,10 @@ void HomotopyClassPlanner::exploreEquivalenceClassesAndInitTebs(const PoseSE2& s
     initial_plan_teb_ = getInitialPlanTEB(); // this method searches for initial_plan_eq_class_ in the teb container (-> if !initial_plan_teb_)
   }
 
+  // the graph search only adds new candidates: optimize the previous best teb meanwhile
+  if (cfg_->hcp.enable_multithreading)
+    startBestTebOptimization();
+
   // now explore new homotopy classes and initialize tebs if new ones are found. The appropriate createGraph method is chosen via polymorphism.
   graph_search_->createGraph(start,goal,dist_to_obst,cfg_->hcp.obstacle_heading_threshold, start_vel, free_goal_vel);
 }
@@ -361,6 +372,7 @@ TebOptimalPlannerPtr HomotopyClassPlanner::addAndInitNewTeb(const PoseSE2& start
   if(tebs_.size() >= cfg_->hcp.max_number_classes)
     return TebOptimalPlannerPtr();
   TebOptimalPlannerPtr candidate =  TebOptimalPlannerPtr( new TebOptimalPlanner(*cfg_, obstacles_, visualization_));
+  candidate->setObstacleIndex(obstacle_index_);
 
   candidate->teb().initTrajectoryToGoal(start, goal, 0, cfg_->robot.max_vel_x, cfg_->trajectory.min_samples, cfg_->trajectory.allow_init_with_backwards_motion);
 
@@ -416,6 +428,7 @@ TebOptimalPlannerPtr HomotopyClassPlanner::addAndInitNewTeb(const std::vector<ge
   if(tebs_.size() >= cfg_->hcp.max_number_classes)
     return TebOptimalPlannerPtr();
   TebOptimalPlannerPtr candidate = TebOptimalPlannerPtr( new TebOptimalPlanner(*cfg_, obstacles_, visualization_));
+  candidate->setObstacleIndex(obstacle_index_);
 
   candidate->teb().initTrajectoryToGoal(initial_plan, cfg_->robot.max_vel_x, cfg_->robot.max_vel_theta,
     cfg_->trajectory.global_plan_overwrite_orientation, cfg_->trajectory.min_samples, cfg_->trajectory.allow_init_with_backwards_motion);
@@ -468,19 +481,22 @@ void HomotopyClassPlanner::optimizeAllTEBs(int iter_innerloop, int iter_outerloo
   // optimize TEBs in parallel since they are independend of each other
   if (cfg_->hcp.enable_multithreading)
   {
-    // Must prevent .join_all() from throwing exception if interruption was
+    // Must prevent .wait() from throwing exception if interruption was
     // requested, as this can lead to multiple threads operating on the same
     // TEB, which leads to SIGSEGV
     boost::this_thread::disable_interruption di;
 
-    boost::thread_group teb_threads;
+    WorkerPool& pool = workerPool();
     for (TebOptPlannerContainer::iterator it_teb = tebs_.begin(); it_teb != tebs_.end(); ++it_teb)
     {
-      teb_threads.create_thread( boost::bind(&TebOptimalPlanner::optimizeTEB, it_teb->get(), iter_innerloop, iter_outerloop,
-                                             true, cfg_->hcp.selection_obst_cost_scale, cfg_->hcp.selection_viapoint_cost_scale,
-                                             cfg_->hcp.selection_alternative_time_cost) );
+      if (*it_teb == prestarted_teb_) // see startBestTebOptimization()
+        continue;
+      pool.push( boost::bind(&TebOptimalPlanner::optimizeTEB, it_teb->get(), iter_innerloop, iter_outerloop,
+                             true, cfg_->hcp.selection_obst_cost_scale, cfg_->hcp.selection_viapoint_cost_scale,
+                             cfg_->hcp.selection_alternative_time_cost) );
     }
-    teb_threads.join_all();
+    pool.wait(); // includes the prestarted teb
+    prestarted_teb_.reset();
   }
   else
   {
@@ -492,6 +508,33 @@ void HomotopyClassPlanner::optimizeAllTEBs(int iter_innerloop, int iter_outerloo
   }
 }
 
+void HomotopyClassPlanner::startBestTebOptimization()
+{
+  prestarted_teb_.reset();
+
+  // renewAndAnalyzeOldTebs() moved the previous best teb to the front of the container
+  if (!best_teb_ || tebs_.empty() || tebs_.front() != best_teb_)
+    return;
+
+  // the via-points cannot be changed anymore once the optimization is started
+  updateReferenceTrajectoryViaPoints(cfg_->hcp.viapoints_all_candidates);
+
+  WorkerPool& pool = workerPool();
+  prestarted_teb_ = best_teb_;
+  pool.push( boost::bind(&TebOptimalPlanner::optimizeTEB, prestarted_teb_.get(), cfg_->optim.no_inner_iterations, cfg_->optim.no_outer_iterations,
+                         true, cfg_->hcp.selection_obst_cost_scale, cfg_->hcp.selection_viapoint_cost_scale,
+                         cfg_->hcp.selection_alternative_time_cost) );
+}
+
+WorkerPool& HomotopyClassPlanner::workerPool()
+{
+  // one worker per candidate, as the number of candidates is bounded by max_number_classes
+  const int no_workers = std::max(cfg_->hcp.max_number_classes, 1);
+  if (!worker_pool_ || (worker_pool_->numWorkers() != no_workers && !prestarted_teb_)) // do not drop the prestarted job
+    worker_pool_ = boost::make_shared<WorkerPool>(no_workers);
+  return *worker_pool_;
+}
+
 TebOptimalPlannerPtr HomotopyClassPlanner::getInitialPlanTEB()
 {
     // first check stored teb object
@@ -746,6 +789,15 @@ void HomotopyClassPlanner::setPreferredTurningDir(RotType dir)
   }
 }
 
+void HomotopyClassPlanner::setObstacleIndex(const ObstacleGridIndex* obstacle_index)
+{
+  obstacle_index_ = obstacle_index;
+  for (TebOptPlannerContainer::const_iterator it_teb = tebs_.begin(); it_teb != tebs_.end(); ++it_teb)
+  {
+    (*it_teb)->setObstacleIndex(obstacle_index);
+  }
+}
+
 bool HomotopyClassPlanner::hasDiverged() const
 {
   // Early return if there is no best trajectory initialized
@@ -0,0 +1,226 @@
+/*********************************************************************
+ *
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016,
+ *  TU Dortmund - Institute of Control Theory and Systems Engineering.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the institute nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: Luigi Freda
+ *********************************************************************/
+
+#include <teb_local_planner/obstacle_index.h>
+#include <teb_local_planner/distance_calculations.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace teb_local_planner
+{
+
+const double ObstacleGridIndex::kDefaultCellSize = 0.5;
+const int ObstacleGridIndex::kMaxCellsPerObstacle = 64;
+
+
+ObstacleGridIndex::ObstacleGridIndex(double cell_size) : cell_size_(cell_size > 0 ? cell_size : kDefaultCellSize), obstacles_(nullptr), num_obstacles_(0)
+{
+}
+
+void ObstacleGridIndex::clear()
+{
+  cells_.clear();
+  unbounded_.clear();
+  obstacles_ = nullptr;
+  num_obstacles_ = 0;
+}
+
+void ObstacleGridIndex::build(const ObstContainer& obstacles)
+{
+  // keep the buckets (and their capacity) of the previous build
+  for (CellMap::iterator it = cells_.begin(); it != cells_.end(); ++it)
+    it->second.clear();
+  unbounded_.clear();
+  obstacles_ = &obstacles;
+  num_obstacles_ = obstacles.size();
+
+  Eigen::Vector2d min_corner, max_corner;
+  for (int i = 0; i < (int)obstacles.size(); ++i)
+  {
+    if (!getBoundingBox(obstacles[i].get(), min_corner, max_corner))
+    {
+      unbounded_.push_back(i);
+      continue;
+    }
+    const int64_t cx_min = getCellCoord(min_corner.x()), cx_max = getCellCoord(max_corner.x());
+    const int64_t cy_min = getCellCoord(min_corner.y()), cy_max = getCellCoord(max_corner.y());
+    if ((cx_max - cx_min + 1)*(cy_max - cy_min + 1) > kMaxCellsPerObstacle)
+    {
+      unbounded_.push_back(i);
+      continue;
+    }
+    for (int64_t cx = cx_min; cx <= cx_max; ++cx)
+      for (int64_t cy = cy_min; cy <= cy_max; ++cy)
+        cells_[getCellKey(cx, cy)].push_back(i);
+  }
+}
+
+void ObstacleGridIndex::query(const Eigen::Vector2d& position, double radius, std::vector<int>& indices) const
+{
+  indices.clear();
+  if (obstacles_ == nullptr)
+    return;
+
+  const int64_t cx_min = getCellCoord(position.x() - radius), cx_max = getCellCoord(position.x() + radius);
+  const int64_t cy_min = getCellCoord(position.y() - radius), cy_max = getCellCoord(position.y() + radius);
+  const double num_query_cells = double(cx_max - cx_min + 1)*double(cy_max - cy_min + 1);
+  
+  if (num_query_cells > (double)cells_.size())
+  {
+    // the query square covers more cells than the stored ones: scan the stored cells
+    for (CellMap::const_iterator it = cells_.begin(); it != cells_.end(); ++it)
+    {
+      const int64_t cx = (int32_t)(it->first >> 32);
+      const int64_t cy = (int32_t)(it->first & 0xffffffff);
+      if (cx >= cx_min && cx <= cx_max && cy >= cy_min && cy <= cy_max)
+        indices.insert(indices.end(), it->second.begin(), it->second.end());
+    }
+  }
+  else
+  {
+    for (int64_t cx = cx_min; cx <= cx_max; ++cx)
+    {
+      for (int64_t cy = cy_min; cy <= cy_max; ++cy)
+      {
+        CellMap::const_iterator it = cells_.find(getCellKey(cx, cy));
+        if (it != cells_.end())
+          indices.insert(indices.end(), it->second.begin(), it->second.end());
+      }
+    }
+  }
+  indices.insert(indices.end(), unbounded_.begin(), unbounded_.end());
+
+  // an obstacle can be registered in more cells; the container order is restored for the callers
+  std::sort(indices.begin(), indices.end());
+  indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+}
+
+void ObstacleGridIndex::querySegment(const Eigen::Vector2d& line_start, const Eigen::Vector2d& line_end, double radius, std::vector<int>& indices) const
+{
+  indices.clear();
+  if (obstacles_ == nullptr)
+    return;
+
+  const Eigen::Vector2d min_corner = line_start.cwiseMin(line_end);
+  const Eigen::Vector2d max_corner = line_start.cwiseMax(line_end);
+  const int64_t cx_min = getCellCoord(min_corner.x() - radius), cx_max = getCellCoord(max_corner.x() + radius);
+  const int64_t cy_min = getCellCoord(min_corner.y() - radius), cy_max = getCellCoord(max_corner.y() + radius);
+  const double num_query_cells = double(cx_max - cx_min + 1)*double(cy_max - cy_min + 1);
+
+  // a cell is visited if its center is within the radius plus half of the cell diagonal from the segment
+  const double max_center_dist = radius + 0.5*std::sqrt(2.0)*cell_size_;
+  const auto is_cell_near_segment = [&](int64_t cx, int64_t cy)
+  {
+    const Eigen::Vector2d center((cx + 0.5)*cell_size_, (cy + 0.5)*cell_size_);
+    return distance_point_to_segment_2d(center, line_start, line_end) <= max_center_dist;
+  };
+
+  if (num_query_cells > (double)cells_.size())
+  {
+    // the query rectangle covers more cells than the stored ones: scan the stored cells
+    for (CellMap::const_iterator it = cells_.begin(); it != cells_.end(); ++it)
+    {
+      const int64_t cx = (int32_t)(it->first >> 32);
+      const int64_t cy = (int32_t)(it->first & 0xffffffff);
+      if (cx >= cx_min && cx <= cx_max && cy >= cy_min && cy <= cy_max && !it->second.empty() && is_cell_near_segment(cx, cy))
+        indices.insert(indices.end(), it->second.begin(), it->second.end());
+    }
+  }
+  else
+  {
+    for (int64_t cx = cx_min; cx <= cx_max; ++cx)
+    {
+      for (int64_t cy = cy_min; cy <= cy_max; ++cy)
+      {
+        CellMap::const_iterator it = cells_.find(getCellKey(cx, cy));
+        if (it != cells_.end() && !it->second.empty() && is_cell_near_segment(cx, cy))
+          indices.insert(indices.end(), it->second.begin(), it->second.end());
+      }
+    }
+  }
+  indices.insert(indices.end(), unbounded_.begin(), unbounded_.end());
+
+  std::sort(indices.begin(), indices.end());
+  indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+}
+
+bool ObstacleGridIndex::getBoundingBox(const Obstacle* obstacle, Eigen::Vector2d& min_corner, Eigen::Vector2d& max_corner)
+{
+  if (const PointObstacle* point = dynamic_cast<const PointObstacle*>(obstacle))
+  {
+    min_corner = max_corner = point->position();
+    return true;
+  }
+  if (const CircularObstacle* circle = dynamic_cast<const CircularObstacle*>(obstacle))
+  {
+    const Eigen::Vector2d extent(circle->radius(), circle->radius());
+    min_corner = circle->position() - extent;
+    max_corner = circle->position() + extent;
+    return true;
+  }
+  if (const LineObstacle* line = dynamic_cast<const LineObstacle*>(obstacle))
+  {
+    min_corner = line->start().cwiseMin(line->end());
+    max_corner = line->start().cwiseMax(line->end());
+    return true;
+  }
+  if (const PillObstacle* pill = dynamic_cast<const PillObstacle*>(obstacle))
+  {
+    const Eigen::Vector2d extent(pill->radius(), pill->radius());
+    min_corner = pill->start().cwiseMin(pill->end()) - extent;
+    max_corner = pill->start().cwiseMax(pill->end()) + extent;
+    return true;
+  }
+  if (const PolygonObstacle* polygon = dynamic_cast<const PolygonObstacle*>(obstacle))
+  {
+    const Point2dContainer& vertices = polygon->vertices();
+    if (vertices.empty())
+      return false;
+    min_corner = max_corner = vertices.front();
+    for (std::size_t i = 1; i < vertices.size(); ++i)
+    {
+      min_corner = min_corner.cwiseMin(vertices[i]);
+      max_corner = max_corner.cwiseMax(vertices[i]);
+    }
+    return true;
+  }
+  return false;
+}
+
+} // namespace teb_local_planner
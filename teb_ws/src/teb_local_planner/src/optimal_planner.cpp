@@ -42,6 +42,7 @@
 #include <teb_local_planner/g2o_types/edge_velocity.h>
 #include <teb_local_planner/g2o_types/edge_velocity_obstacle_ratio.h>
 #include <teb_local_planner/g2o_types/edge_acceleration.h>
+#include <teb_local_planner/g2o_types/edge_diff_drive.h>
 #include <teb_local_planner/g2o_types/edge_kinematics.h>
 #include <teb_local_planner/g2o_types/edge_time_optimal.h>
 #include <teb_local_planner/g2o_types/edge_shortest_path.h>
@@ -51,7 +52,9 @@
 #include <teb_local_planner/g2o_types/edge_prefer_rotdir.h>
 
 #include <memory>
+#include <unordered_map>
 #include <limits>
+#include <cmath>
 
 
 namespace teb_local_planner
@@ -59,8 +62,8 @@ namespace teb_local_planner
 
 // ============== Implementation ===================
 
-TebOptimalPlanner::TebOptimalPlanner() : cfg_(NULL), obstacles_(NULL), via_points_(NULL), cost_(HUGE_VAL), prefer_rotdir_(RotType::none),
-                                         initialized_(false), optimized_(false)
+TebOptimalPlanner::TebOptimalPlanner() : cfg_(NULL), obstacles_(NULL), obstacle_index_(NULL), via_points_(NULL), cost_(HUGE_VAL), prefer_rotdir_(RotType::none),
+                                         graph_retained_(false), warm_start_lambda_(0), diff_drive_edges_(false), initialized_(false), optimized_(false)
 {    
 }
   
@@ -86,9 +89,15 @@ void TebOptimalPlanner::initialize(const TebConfig& cfg, ObstContainer* obstacle
   
   cfg_ = &cfg;
   obstacles_ = obstacles;
+  obstacle_index_ = NULL;
   via_points_ = via_points;
+  via_point_hints_.clear();
   cost_ = HUGE_VAL;
   prefer_rotdir_ = RotType::none;
+  static_edge_groups_.clear();
+  graph_retained_ = false;
+  warm_start_lambda_ = 0;
+  statistics_.reset();
   setVisualization(visual);
   
   vel_start_.first = true;
@@ -144,6 +153,8 @@ void TebOptimalPlanner::registerG2OTypes()
   factory->registerType("EDGE_ACCELERATION_HOLONOMIC", new g2o::HyperGraphElementCreator<EdgeAccelerationHolonomic>);
   factory->registerType("EDGE_ACCELERATION_HOLONOMIC_START", new g2o::HyperGraphElementCreator<EdgeAccelerationHolonomicStart>);
   factory->registerType("EDGE_ACCELERATION_HOLONOMIC_GOAL", new g2o::HyperGraphElementCreator<EdgeAccelerationHolonomicGoal>);
+  factory->registerType("EDGE_VELOCITY_DIFF_DRIVE", new g2o::HyperGraphElementCreator<EdgeVelocityDiffDrive>);
+  factory->registerType("EDGE_ACCELERATION_DIFF_DRIVE", new g2o::HyperGraphElementCreator<EdgeAccelerationDiffDrive>);
   factory->registerType("EDGE_KINEMATICS_DIFF_DRIVE", new g2o::HyperGraphElementCreator<EdgeKinematicsDiffDrive>);
   factory->registerType("EDGE_KINEMATICS_CARLIKE", new g2o::HyperGraphElementCreator<EdgeKinematicsCarlike>);
   factory->registerType("EDGE_OBSTACLE", new g2o::HyperGraphElementCreator<EdgeObstacle>);
@@ -187,6 +198,7 @@ bool TebOptimalPlanner::optimizeTEB(int iterations_innerloop, int iterations_out
   
   bool success = false;
   optimized_ = false;
+  statistics_.reset();
   
   double weight_multiplier = 1.0;
 
@@ -218,11 +230,15 @@ bool TebOptimalPlanner::optimizeTEB(int iterations_innerloop, int iterations_out
         return false;
     }
     optimized_ = true;
+    statistics_.outer_iterations++;
     
     if (compute_cost_afterwards && i==iterations_outerloop-1) // compute cost vec only in the last iteration
       computeCurrentCost(obst_cost_scale, viapoint_cost_scale, alternative_time_cost);
       
-    clearGraph();
+    if (cfg_->optim.reuse_graph)
+      retainGraph();
+    else
+      clearGraph();
     
     weight_multiplier *= cfg_->optim.weight_adapt_factor;
   }
@@ -322,7 +338,7 @@ bool TebOptimalPlanner::plan(const PoseSE2& start, const PoseSE2& goal, const ge
 
 bool TebOptimalPlanner::buildGraph(double weight_multiplier)
 {
-  if (!optimizer_->edges().empty() || !optimizer_->vertices().empty())
+  if ((!optimizer_->edges().empty() && !graph_retained_) || !optimizer_->vertices().empty())
   {
     ROS_WARN("Cannot build graph, because it is not empty. Call graphClear()!");
     return false;
@@ -330,9 +346,35 @@ bool TebOptimalPlanner::buildGraph(double weight_multiplier)
 
   optimizer_->setComputeBatchStatistics(cfg_->recovery.divergence_detection_enable);
   
+  // select the edge variants once for the whole graph: the analytic diff-drive edges implement the non-holonomic
+  // velocity/acceleration cost functions with the Euclidean approximation of the arc length only
+  diff_drive_edges_ = cfg_->optim.analytic_jacobians && !cfg_->trajectory.exact_arc_length && cfg_->robot.max_vel_y == 0;
+  
+  // keep the unchanged structural edges of the previous graph (or delete it, if the reuse mode has been switched off)
+  if (cfg_->optim.reuse_graph)
+    prepareGraphReuse();
+  else if (graph_retained_)
+    clearGraph();
+  
   // add TEB vertices
   AddTEBVertices();
   
+  // connect the reused edges to the vertices again
+  for (const StaticEdgeGroup& group : static_edge_groups_)
+  {
+    if (!group.reused)
+      continue;
+    for (g2o::OptimizableGraph::Edge* edge : group.edges)
+    {
+      for (g2o::HyperGraph::Vertex* vertex : edge->vertices())
+        vertex->edges().insert(edge);
+    }
+  }
+  
+  // the poses might have been moved since the last update of the pose index (optimizer, external changes): 
+  // it is rebuilt on demand by the edges that query the closest poses
+  teb_.invalidatePoseIndex();
+  
   // add Edges (local cost functions)
   if (cfg_->obstacles.legacy_obstacle_association)
     AddEdgesObstaclesLegacy(weight_multiplier);
@@ -384,8 +426,36 @@ bool TebOptimalPlanner::optimizeGraph(int no_iterations,bool clear_after)
   optimizer_->setVerbose(cfg_->optim.optimization_verbose);
   optimizer_->initializeOptimization();
 
+  // warm start the damping of the solver if the graph has been reused
+  g2o::OptimizationAlgorithmLevenberg* lm = dynamic_cast<g2o::OptimizationAlgorithmLevenberg*>(optimizer_->algorithm());
+  if (lm)
+  {
+    bool warm_start = false;
+    if (cfg_->optim.reuse_graph && warm_start_lambda_ > 0 && std::isfinite(warm_start_lambda_))
+    {
+      for (const StaticEdgeGroup& group : static_edge_groups_)
+      {
+        if (group.reused)
+        {
+          warm_start = true;
+          break;
+        }
+      }
+    }
+    lm->setUserLambdaInit(warm_start ? warm_start_lambda_ : 0); // 0: g2o computes the initial damping from the hessian
+  }
+
   int iter = optimizer_->optimize(no_iterations);
 
+  if (lm)
+    warm_start_lambda_ = lm->currentLambda();
+  
+  teb_.invalidatePoseIndex(); // the poses have been moved
+
+  statistics_.solver_iterations += iter;
+  statistics_.num_vertices = static_cast<int>(optimizer_->vertices().size());
+  statistics_.num_edges = static_cast<int>(optimizer_->edges().size());
+
   // Save Hessian for visualization
   //  g2o::OptimizationAlgorithmLevenberg* lm = dynamic_cast<g2o::OptimizationAlgorithmLevenberg*> (optimizer_->solver());
   //  lm->solver()->saveHessian("~/MasterThesis/Matlab/Hessian.txt");
@@ -415,6 +485,78 @@ void TebOptimalPlanner::clearGraph()
     optimizer_->vertices().clear();  // necessary, because optimizer->clear deletes pointer-targets (therefore it deletes TEB states!)
     optimizer_->clear();
   }
+  static_edge_groups_.clear();
+  graph_retained_ = false;
+}
+
+void TebOptimalPlanner::retainGraph()
+{
+  // the TEB might delete or insert vertices until the next buildGraph() call, hence only the edges are kept.
+  // the references from the vertices to the edges are cleared in AddTEBVertices().
+  optimizer_->vertices().clear();
+  graph_retained_ = true;
+}
+
+void TebOptimalPlanner::prepareGraphReuse()
+{
+  const std::array<double, 15> params = {{cfg_->optim.weight_max_vel_x, cfg_->optim.weight_max_vel_y, cfg_->optim.weight_max_vel_theta,
+                                          cfg_->optim.weight_acc_lim_x, cfg_->optim.weight_acc_lim_y, cfg_->optim.weight_acc_lim_theta,
+                                          cfg_->optim.weight_kinematics_nh, cfg_->optim.weight_kinematics_forward_drive,
+                                          cfg_->optim.weight_kinematics_turning_radius, cfg_->optim.weight_optimaltime,
+                                          cfg_->optim.weight_shortest_path, cfg_->robot.max_vel_y, cfg_->robot.acc_lim_y,
+                                          cfg_->robot.min_turning_radius, diff_drive_edges_ ? 1.0 : 0.0}};
+
+  std::vector<StaticEdgeGroup> old_groups;
+  old_groups.swap(static_edge_groups_);
+  if (!graph_retained_ || params != static_edge_params_)
+    old_groups.clear(); // the weights have been changed: rebuild all edges
+  static_edge_params_ = params;
+
+  // the first pose identifies the group (poses are removed or inserted by updateAndPruneTEB() and autoResize())
+  std::unordered_map<const g2o::HyperGraph::Vertex*, StaticEdgeGroup*> old_group_map;
+  old_group_map.reserve(old_groups.size());
+  for (StaticEdgeGroup& group : old_groups)
+    old_group_map.emplace(group.vertices[0], &group);
+
+  g2o::HyperGraph::EdgeSet old_edges;
+  old_edges.swap(optimizer_->edges());
+
+  const int n = teb_.sizePoses();
+  const int no_groups = std::max(0, std::min(n - 1, teb_.sizeTimeDiffs()));
+  static_edge_groups_.resize(no_groups);
+  for (int i=0; i < no_groups; ++i)
+  {
+    StaticEdgeGroup& group = static_edge_groups_[i];
+    group.vertices = {{teb_.PoseVertex(i), teb_.PoseVertex(i+1), teb_.TimeDiffVertex(i),
+                       i+2 < n ? teb_.PoseVertex(i+2) : NULL, i+1 < no_groups ? teb_.TimeDiffVertex(i+1) : NULL}};
+    group.edges.clear();
+    group.reused = false;
+
+    auto old_group = old_group_map.find(group.vertices[0]);
+    if (old_group == old_group_map.end() || old_group->second->vertices != group.vertices)
+      continue;
+
+    group.edges.swap(old_group->second->edges);
+    for (g2o::OptimizableGraph::Edge* edge : group.edges)
+    {
+      old_edges.erase(edge);
+      optimizer_->edges().insert(edge);
+    }
+    group.reused = true;
+  }
+
+  // delete all other edges. Do not use optimizer_->removeEdge(), since their vertices might be deleted already.
+  for (g2o::HyperGraph::Edge* edge : old_edges)
+    delete edge;
+
+  graph_retained_ = false;
+}
+
+void TebOptimalPlanner::addStaticEdge(int index, g2o::OptimizableGraph::Edge* edge)
+{
+  optimizer_->addEdge(edge);
+  if (index < (int)static_edge_groups_.size())
+    static_edge_groups_[index].edges.push_back(edge);
 }
 
 
@@ -428,10 +570,12 @@ void TebOptimalPlanner::AddTEBVertices()
   auto iter_obstacle = obstacles_per_vertex_.begin();
   for (int i=0; i<teb_.sizePoses(); ++i)
   {
+    teb_.PoseVertex(i)->edges().clear(); // might still refer to the edges of a retained graph
     teb_.PoseVertex(i)->setId(id_counter++);
     optimizer_->addVertex(teb_.PoseVertex(i));
     if (teb_.sizeTimeDiffs()!=0 && i<teb_.sizeTimeDiffs())
     {
+      teb_.TimeDiffVertex(i)->edges().clear();
       teb_.TimeDiffVertex(i)->setId(id_counter++);
       optimizer_->addVertex(teb_.TimeDiffVertex(i));
     }
@@ -478,6 +622,14 @@ void TebOptimalPlanner::AddEdgesObstacles(double weight_multiplier)
     };
   };
     
+  const double force_inclusion_dist = cfg_->obstacles.min_obstacle_dist*cfg_->obstacles.obstacle_association_force_inclusion_factor;
+  const double cutoff_dist = cfg_->obstacles.min_obstacle_dist*cfg_->obstacles.obstacle_association_cutoff_factor;
+
+  // the distance of the footprint from an obstacle is not smaller than the distance of the robot center minus the circumscribed radius
+  const double search_radius = std::max(force_inclusion_dist, cutoff_dist) + cfg_->robot_model->getCircumscribedRadius();
+  const bool use_index = obstacle_index_ != nullptr && obstacle_index_->isValidFor(obstacles_) && std::isfinite(search_radius);
+  std::vector<int> candidates;
+  
   // iterate all teb points, skipping the last and, if the EdgeVelocityObstacleRatio edges should not be created, the first one too
   const int first_vertex = cfg_->optim.weight_velocity_obstacle_ratio == 0 ? 1 : 0;
   for (int i = first_vertex; i < teb_.sizePoses() - 1; ++i)
@@ -489,25 +641,23 @@ void TebOptimalPlanner::AddEdgesObstacles(double weight_multiplier)
       
       const Eigen::Vector2d pose_orient = teb_.Pose(i).orientationUnitVec();
       
-      // iterate obstacles
-      for (const ObstaclePtr& obst : *obstacles_)
-      {
+      auto associate_obstacle = [&] (const ObstaclePtr& obst) {
         // we handle dynamic obstacles differently below
         if(cfg_->obstacles.include_dynamic_obstacles && obst->isDynamic())
-          continue;
+          return;
 
           // calculate distance to robot model
           double dist = cfg_->robot_model->calculateDistance(teb_.Pose(i), obst.get());
           
           // force considering obstacle if really close to the current pose
-        if (dist < cfg_->obstacles.min_obstacle_dist*cfg_->obstacles.obstacle_association_force_inclusion_factor)
+        if (dist < force_inclusion_dist)
           {
               iter_obstacle->push_back(obst);
-              continue;
+              return;
           }
           // cut-off distance
-          if (dist > cfg_->obstacles.min_obstacle_dist*cfg_->obstacles.obstacle_association_cutoff_factor)
-            continue;
+          if (dist > cutoff_dist)
+            return;
           
           // determine side (left or right) and assign obstacle if closer than the previous one
           if (cross2d(pose_orient, obst->getCentroid()) > 0) // left
@@ -526,7 +676,20 @@ void TebOptimalPlanner::AddEdgesObstacles(double weight_multiplier)
                   right_obstacle = obst;
               }
           }
-      }   
+      };
+
+      // iterate obstacles (the candidates of the index are sorted: same association as the full iteration)
+      if (use_index)
+      {
+        obstacle_index_->query(teb_.Pose(i).position(), search_radius, candidates);
+        for (int idx : candidates)
+          associate_obstacle((*obstacles_)[idx]);
+      }
+      else
+      {
+        for (const ObstaclePtr& obst : *obstacles_)
+          associate_obstacle(obst);
+      }
       
       if (left_obstacle)
         iter_obstacle->push_back(left_obstacle);
@@ -562,6 +725,9 @@ void TebOptimalPlanner::AddEdgesObstaclesLegacy(double weight_multiplier)
   information_inflated(0,1) = information_inflated(1,0) = 0;
   
   bool inflated = cfg_->obstacles.inflation_dist > cfg_->obstacles.min_obstacle_dist;
+  
+  if (cfg_->obstacles.obstacle_poses_affected < teb_.sizePoses())
+    teb_.updatePoseIndex(); // the closest poses of all the obstacles are queried
     
   for (ObstContainer::const_iterator obst = obstacles_->begin(); obst != obstacles_->end(); ++obst)
   {
@@ -683,10 +849,15 @@ void TebOptimalPlanner::AddEdgesViaPoints()
   if (n<3) // we do not have any degrees of freedom for reaching via-points
     return;
   
-  for (ViaPointContainer::const_iterator vp_it = via_points_->begin(); vp_it != via_points_->end(); ++vp_it)
+  teb_.updatePoseIndex();
+  via_point_hints_.resize(via_points_->size(), -1);
+  
+  int vp_idx = 0;
+  for (ViaPointContainer::const_iterator vp_it = via_points_->begin(); vp_it != via_points_->end(); ++vp_it, ++vp_idx)
   {
-    
-    int index = teb_.findClosestTrajectoryPose(*vp_it, NULL, start_pose_idx);
+    // the closest pose of the via-point in the last graph is a good guess (the trajectory moves little between two iterations)
+    int index = teb_.findClosestTrajectoryPose(*vp_it, NULL, start_pose_idx, via_point_hints_[vp_idx]);
+    via_point_hints_[vp_idx] = index;
     if (cfg_->trajectory.via_points_ordered)
       start_pose_idx = index+2; // skip a point to have a DOF inbetween for further via-points
      
@@ -733,13 +904,26 @@ void TebOptimalPlanner::AddEdgesVelocity()
 
     for (int i=0; i < n - 1; ++i)
     {
+      if (isStaticEdgeGroupReused(i))
+        continue;
+      if (diff_drive_edges_)
+      {
+        EdgeVelocityDiffDrive* velocity_edge = new EdgeVelocityDiffDrive;
+        velocity_edge->setVertex(0,teb_.PoseVertex(i));
+        velocity_edge->setVertex(1,teb_.PoseVertex(i+1));
+        velocity_edge->setVertex(2,teb_.TimeDiffVertex(i));
+        velocity_edge->setInformation(information);
+        velocity_edge->setTebConfig(*cfg_);
+        addStaticEdge(i, velocity_edge);
+        continue;
+      }
       EdgeVelocity* velocity_edge = new EdgeVelocity;
       velocity_edge->setVertex(0,teb_.PoseVertex(i));
       velocity_edge->setVertex(1,teb_.PoseVertex(i+1));
       velocity_edge->setVertex(2,teb_.TimeDiffVertex(i));
       velocity_edge->setInformation(information);
       velocity_edge->setTebConfig(*cfg_);
-      optimizer_->addEdge(velocity_edge);
+      addStaticEdge(i, velocity_edge);
     }
   }
   else // holonomic-robot
@@ -756,13 +940,15 @@ void TebOptimalPlanner::AddEdgesVelocity()
 
     for (int i=0; i < n - 1; ++i)
     {
+      if (isStaticEdgeGroupReused(i))
+        continue;
       EdgeVelocityHolonomic* velocity_edge = new EdgeVelocityHolonomic;
       velocity_edge->setVertex(0,teb_.PoseVertex(i));
       velocity_edge->setVertex(1,teb_.PoseVertex(i+1));
       velocity_edge->setVertex(2,teb_.TimeDiffVertex(i));
       velocity_edge->setInformation(information);
       velocity_edge->setTebConfig(*cfg_);
-      optimizer_->addEdge(velocity_edge);
+      addStaticEdge(i, velocity_edge);
     } 
     
   }
@@ -798,6 +984,21 @@ void TebOptimalPlanner::AddEdgesAcceleration()
     // now add the usual acceleration edge for each tuple of three teb poses
     for (int i=0; i < n - 2; ++i)
     {
+      if (isStaticEdgeGroupReused(i))
+        continue;
+      if (diff_drive_edges_)
+      {
+        EdgeAccelerationDiffDrive* acceleration_edge = new EdgeAccelerationDiffDrive;
+        acceleration_edge->setVertex(0,teb_.PoseVertex(i));
+        acceleration_edge->setVertex(1,teb_.PoseVertex(i+1));
+        acceleration_edge->setVertex(2,teb_.PoseVertex(i+2));
+        acceleration_edge->setVertex(3,teb_.TimeDiffVertex(i));
+        acceleration_edge->setVertex(4,teb_.TimeDiffVertex(i+1));
+        acceleration_edge->setInformation(information);
+        acceleration_edge->setTebConfig(*cfg_);
+        addStaticEdge(i, acceleration_edge);
+        continue;
+      }
       EdgeAcceleration* acceleration_edge = new EdgeAcceleration;
       acceleration_edge->setVertex(0,teb_.PoseVertex(i));
       acceleration_edge->setVertex(1,teb_.PoseVertex(i+1));
@@ -806,7 +1007,7 @@ void TebOptimalPlanner::AddEdgesAcceleration()
       acceleration_edge->setVertex(4,teb_.TimeDiffVertex(i+1));
       acceleration_edge->setInformation(information);
       acceleration_edge->setTebConfig(*cfg_);
-      optimizer_->addEdge(acceleration_edge);
+      addStaticEdge(i, acceleration_edge);
     }
     
     // check if a goal velocity should be taken into accound
@@ -846,6 +1047,8 @@ void TebOptimalPlanner::AddEdgesAcceleration()
     // now add the usual acceleration edge for each tuple of three teb poses
     for (int i=0; i < n - 2; ++i)
     {
+      if (isStaticEdgeGroupReused(i))
+        continue;
       EdgeAccelerationHolonomic* acceleration_edge = new EdgeAccelerationHolonomic;
       acceleration_edge->setVertex(0,teb_.PoseVertex(i));
       acceleration_edge->setVertex(1,teb_.PoseVertex(i+1));
@@ -854,7 +1057,7 @@ void TebOptimalPlanner::AddEdgesAcceleration()
       acceleration_edge->setVertex(4,teb_.TimeDiffVertex(i+1));
       acceleration_edge->setInformation(information);
       acceleration_edge->setTebConfig(*cfg_);
-      optimizer_->addEdge(acceleration_edge);
+      addStaticEdge(i, acceleration_edge);
     }
     
     // check if a goal velocity should be taken into accound
@@ -884,11 +1087,13 @@ void TebOptimalPlanner::AddEdgesTimeOptimal()
 
   for (int i=0; i < teb_.sizeTimeDiffs(); ++i)
   {
+    if (isStaticEdgeGroupReused(i))
+      continue;
     EdgeTimeOptimal* timeoptimal_edge = new EdgeTimeOptimal;
     timeoptimal_edge->setVertex(0,teb_.TimeDiffVertex(i));
     timeoptimal_edge->setInformation(information);
     timeoptimal_edge->setTebConfig(*cfg_);
-    optimizer_->addEdge(timeoptimal_edge);
+    addStaticEdge(i, timeoptimal_edge);
   }
 }
 
@@ -902,12 +1107,14 @@ void TebOptimalPlanner::AddEdgesShortestPath()
 
   for (int i=0; i < teb_.sizePoses()-1; ++i)
   {
+    if (isStaticEdgeGroupReused(i))
+      continue;
     EdgeShortestPath* shortest_path_edge = new EdgeShortestPath;
     shortest_path_edge->setVertex(0,teb_.PoseVertex(i));
     shortest_path_edge->setVertex(1,teb_.PoseVertex(i+1));
     shortest_path_edge->setInformation(information);
     shortest_path_edge->setTebConfig(*cfg_);
-    optimizer_->addEdge(shortest_path_edge);
+    addStaticEdge(i, shortest_path_edge);
   }
 }
 
@@ -926,12 +1133,14 @@ void TebOptimalPlanner::AddEdgesKinematicsDiffDrive()
   
   for (int i=0; i < teb_.sizePoses()-1; i++) // ignore twiced start only
   {
+    if (isStaticEdgeGroupReused(i))
+      continue;
     EdgeKinematicsDiffDrive* kinematics_edge = new EdgeKinematicsDiffDrive;
     kinematics_edge->setVertex(0,teb_.PoseVertex(i));
     kinematics_edge->setVertex(1,teb_.PoseVertex(i+1));      
     kinematics_edge->setInformation(information_kinematics);
     kinematics_edge->setTebConfig(*cfg_);
-    optimizer_->addEdge(kinematics_edge);
+    addStaticEdge(i, kinematics_edge);
   }	 
 }
 
@@ -948,12 +1157,14 @@ void TebOptimalPlanner::AddEdgesKinematicsCarlike()
   
   for (int i=0; i < teb_.sizePoses()-1; i++) // ignore twiced start only
   {
+    if (isStaticEdgeGroupReused(i))
+      continue;
     EdgeKinematicsCarlike* kinematics_edge = new EdgeKinematicsCarlike;
     kinematics_edge->setVertex(0,teb_.PoseVertex(i));
     kinematics_edge->setVertex(1,teb_.PoseVertex(i+1));      
     kinematics_edge->setInformation(information_kinematics);
     kinematics_edge->setTebConfig(*cfg_);
-    optimizer_->addEdge(kinematics_edge);
+    addStaticEdge(i, kinematics_edge);
   }  
 }
 
@@ -1042,7 +1253,7 @@ void TebOptimalPlanner::computeCurrentCost(double obst_cost_scale, double viapoi
 { 
   // check if graph is empty/exist  -> important if function is called between buildGraph and optimizeGraph/clearGraph
   bool graph_exist_flag(false);
-  if (optimizer_->edges().empty() && optimizer_->vertices().empty())
+  if (optimizer_->vertices().empty()) // a retained graph has edges only
   {
     // here the graph is build again, for time efficiency make sure to call this function 
     // between buildGraph and Optimize (deleted), but it depends on the application
@@ -1089,8 +1300,13 @@ void TebOptimalPlanner::computeCurrentCost(double obst_cost_scale, double viapoi
   }
 
   // delete temporary created graph
-  if (!graph_exist_flag) 
-    clearGraph();
+  if (!graph_exist_flag)
+  {
+    if (cfg_->optim.reuse_graph)
+      retainGraph();
+    else
+      clearGraph();
+  }
 }
 
 
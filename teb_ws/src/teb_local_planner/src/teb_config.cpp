@@ -117,6 +117,8 @@ void TebConfig::loadRosParamFromNodeHandle(const ros::NodeHandle& nh)
   nh.param("no_outer_iterations", optim.no_outer_iterations, optim.no_outer_iterations);
   nh.param("optimization_activate", optim.optimization_activate, optim.optimization_activate);
   nh.param("optimization_verbose", optim.optimization_verbose, optim.optimization_verbose);
+  nh.param("reuse_graph", optim.reuse_graph, optim.reuse_graph);
+  nh.param("analytic_jacobians", optim.analytic_jacobians, optim.analytic_jacobians);
   nh.param("penalty_epsilon", optim.penalty_epsilon, optim.penalty_epsilon);
   nh.param("weight_max_vel_x", optim.weight_max_vel_x, optim.weight_max_vel_x);
   nh.param("weight_max_vel_y", optim.weight_max_vel_y, optim.weight_max_vel_y);
@@ -155,6 +157,9 @@ void TebConfig::loadRosParamFromNodeHandle(const ros::NodeHandle& nh)
   nh.param("roadmap_graph_samples", hcp.roadmap_graph_no_samples, hcp.roadmap_graph_no_samples); 
   nh.param("roadmap_graph_area_width", hcp.roadmap_graph_area_width, hcp.roadmap_graph_area_width); 
   nh.param("roadmap_graph_area_length_scale", hcp.roadmap_graph_area_length_scale, hcp.roadmap_graph_area_length_scale);
+  nh.param("roadmap_graph_max_neighbors", hcp.roadmap_graph_max_neighbors, hcp.roadmap_graph_max_neighbors);
+  nh.param("roadmap_graph_resample_distance", hcp.roadmap_graph_resample_distance, hcp.roadmap_graph_resample_distance);
+  nh.param("graph_search_best_first", hcp.graph_search_best_first, hcp.graph_search_best_first);
   nh.param("h_signature_prescaler", hcp.h_signature_prescaler, hcp.h_signature_prescaler); 
   nh.param("h_signature_threshold", hcp.h_signature_threshold, hcp.h_signature_threshold); 
   nh.param("obstacle_keypoint_offset", hcp.obstacle_keypoint_offset, hcp.obstacle_keypoint_offset); 
@@ -250,6 +255,8 @@ void TebConfig::reconfigure(TebLocalPlannerReconfigureConfig& cfg)
   optim.no_outer_iterations = cfg.no_outer_iterations;
   optim.optimization_activate = cfg.optimization_activate;
   optim.optimization_verbose = cfg.optimization_verbose;
+  optim.reuse_graph = cfg.reuse_graph;
+  optim.analytic_jacobians = cfg.analytic_jacobians;
   optim.penalty_epsilon = cfg.penalty_epsilon;
   optim.weight_max_vel_x = cfg.weight_max_vel_x;
   optim.weight_max_vel_y = cfg.weight_max_vel_y;
@@ -287,6 +294,9 @@ void TebConfig::reconfigure(TebLocalPlannerReconfigureConfig& cfg)
   hcp.roadmap_graph_no_samples = cfg.roadmap_graph_no_samples;
   hcp.roadmap_graph_area_width = cfg.roadmap_graph_area_width;
   hcp.roadmap_graph_area_length_scale = cfg.roadmap_graph_area_length_scale;
+  hcp.roadmap_graph_max_neighbors = cfg.roadmap_graph_max_neighbors;
+  hcp.roadmap_graph_resample_distance = cfg.roadmap_graph_resample_distance;
+  hcp.graph_search_best_first = cfg.graph_search_best_first;
   hcp.h_signature_prescaler = cfg.h_signature_prescaler;
   hcp.h_signature_threshold = cfg.h_signature_threshold;
   hcp.viapoints_all_candidates = cfg.viapoints_all_candidates;
@@ -122,6 +122,7 @@ void TebLocalPlannerROS::initialize(std::string name, tf2_ros::Buffer* tf, costm
       planner_ = PlannerInterfacePtr(new TebOptimalPlanner(cfg_, &obstacles_, visualization_, &via_points_));
       ROS_INFO("Parallel planning in distinctive topologies disabled.");
     }
+    planner_->setObstacleIndex(&obstacle_index_);
     
     // init other variables
     tf_ = tf;
@@ -350,6 +351,9 @@ uint32_t TebLocalPlannerROS::computeVelocityCommands(const geometry_msgs::PoseSt
   
   // also consider custom obstacles (must be called after other updates, since the container is not cleared)
   updateObstacleContainerWithCustomObstacles();
+
+  // rebuild the spatial index used for the association of the obstacles to the trajectory poses
+  obstacle_index_.build(obstacles_);
   
     
   // Do not allow config changes during the following optimization step
@@ -1139,8 +1143,28 @@ RobotFootprintModelPtr TebLocalPlannerROS::getRobotFootprintFromParamServer(cons
       try
       {
         Point2dContainer polygon = makeFootprintFromXMLRPC(footprint_xmlrpc, "/footprint_model/vertices");
-        ROS_INFO_STREAM("Footprint model 'polygon' loaded for trajectory optimization.");
-        return boost::make_shared<PolygonRobotFootprint>(polygon);
+        boost::shared_ptr<PolygonRobotFootprint> polygon_model = boost::make_shared<PolygonRobotFootprint>(polygon);
+        
+        // optional signed distance field of the polygon (constant time distances to point and circular obstacles)
+        bool use_distance_field = false;
+        nh.param("footprint_model/use_distance_field", use_distance_field, use_distance_field);
+        if (use_distance_field)
+        {
+          double resolution = 0.02;
+          double margin = config.obstacles.min_obstacle_dist * config.obstacles.obstacle_association_cutoff_factor;
+          nh.param("footprint_model/distance_field_resolution", resolution, resolution);
+          nh.param("footprint_model/distance_field_margin", margin, margin);
+          if (polygon_model->enableDistanceField(resolution, margin))
+            ROS_INFO_STREAM("Footprint model 'polygon' (distance field resolution: " << resolution << "m, margin: " << margin << "m) loaded for trajectory optimization.");
+          else
+            ROS_WARN_STREAM("Footprint model 'polygon' loaded for trajectory optimization, but its distance field cannot be built (resolution: " 
+                            << resolution << "m, margin: " << margin << "m). Using the exact distances instead.");
+        }
+        else
+        {
+          ROS_INFO_STREAM("Footprint model 'polygon' loaded for trajectory optimization.");
+        }
+        return polygon_model;
       } 
       catch(const std::exception& ex)
       {
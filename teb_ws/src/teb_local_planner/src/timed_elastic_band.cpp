@@ -66,7 +66,7 @@ namespace
 } // namespace
 
 
-TimedElasticBand::TimedElasticBand()
+TimedElasticBand::TimedElasticBand() : pose_index_valid_(false)
 {		
 }
 
@@ -81,6 +81,7 @@ void TimedElasticBand::addPose(const PoseSE2& pose, bool fixed)
 {
   VertexPose* pose_vertex = new VertexPose(pose, fixed);
   pose_vec_.push_back( pose_vertex );
+  invalidatePoseIndex();
   return;
 }
 
@@ -88,6 +89,7 @@ void TimedElasticBand::addPose(const Eigen::Ref<const Eigen::Vector2d>& position
 {
   VertexPose* pose_vertex = new VertexPose(position, theta, fixed);
   pose_vec_.push_back( pose_vertex );
+  invalidatePoseIndex();
   return;
 }
 
@@ -95,6 +97,7 @@ void TimedElasticBand::addPose(const Eigen::Ref<const Eigen::Vector2d>& position
 {
   VertexPose* pose_vertex = new VertexPose(x, y, theta, fixed);
   pose_vec_.push_back( pose_vertex );
+  invalidatePoseIndex();
   return;
 }
 
@@ -149,6 +152,7 @@ void TimedElasticBand::deletePose(int index)
   ROS_ASSERT(index<pose_vec_.size());
   delete pose_vec_.at(index);
   pose_vec_.erase(pose_vec_.begin()+index);
+  invalidatePoseIndex();
 }
 
 void TimedElasticBand::deletePoses(int index, int number)
@@ -157,6 +161,7 @@ void TimedElasticBand::deletePoses(int index, int number)
   for (int i = index; i<index+number; ++i)
     delete pose_vec_.at(i);
   pose_vec_.erase(pose_vec_.begin()+index, pose_vec_.begin()+index+number);
+  invalidatePoseIndex();
 }
 
 void TimedElasticBand::deleteTimeDiff(int index)
@@ -178,18 +183,21 @@ void TimedElasticBand::insertPose(int index, const PoseSE2& pose)
 {
   VertexPose* pose_vertex = new VertexPose(pose);
   pose_vec_.insert(pose_vec_.begin()+index, pose_vertex);
+  invalidatePoseIndex();
 }
 
 void TimedElasticBand::insertPose(int index, const Eigen::Ref<const Eigen::Vector2d>& position, double theta)
 {
   VertexPose* pose_vertex = new VertexPose(position, theta);
   pose_vec_.insert(pose_vec_.begin()+index, pose_vertex);
+  invalidatePoseIndex();
 }
 
 void TimedElasticBand::insertPose(int index, double x, double y, double theta)
 {
   VertexPose* pose_vertex = new VertexPose(x, y, theta);
   pose_vec_.insert(pose_vec_.begin()+index, pose_vertex);
+  invalidatePoseIndex();
 }
 
 void TimedElasticBand::insertTimeDiff(int index, double dt)
@@ -204,6 +212,7 @@ void TimedElasticBand::clearTimedElasticBand()
   for (PoseSequence::iterator pose_it = pose_vec_.begin(); pose_it != pose_vec_.end(); ++pose_it)
     delete *pose_it;
   pose_vec_.clear();
+  invalidatePoseIndex();
   
   for (TimeDiffSequence::iterator dt_it = timediff_vec_.begin(); dt_it != timediff_vec_.end(); ++dt_it)
     delete *dt_it;
@@ -228,61 +237,108 @@ void TimedElasticBand::autoResize(double dt_ref, double dt_hysteresis, int min_s
 {  
   ROS_ASSERT(sizeTimeDiffs() == 0 || sizeTimeDiffs() + 1 == sizePoses());
   /// iterate through all TEB states and add/remove states!
-  bool modified = true;
-
-  for (int rep = 0; rep < 100 && modified; ++rep) // actually it should be while(), but we want to make sure to not get stuck in some oscillation, hence max 100 repitions.
+  for (int rep = 0; rep < 100; ++rep) // actually it should be while(), but we want to make sure to not get stuck in some oscillation, hence max 100 repitions.
   {
-    modified = false;
+    if (!autoResizeSweep(dt_ref, dt_hysteresis, min_samples, max_samples) || fast_mode)
+      break;
+  }
+}
 
-    for(int i=0; i < sizeTimeDiffs(); ++i) // TimeDiff connects Point(i) with Point(i+1)
+bool TimedElasticBand::autoResizeSweep(double dt_ref, double dt_hysteresis, int min_samples, int max_samples)
+{
+  invalidatePoseIndex();
+  const int num_input_timediffs = sizeTimeDiffs();
+  if (num_input_timediffs == 0)
+    return false;
+
+  // The resized sequences are built in new containers and swapped in at the end: the vertices which are kept are moved, 
+  // no vertex is shifted inside the sequences.
+  PoseSequence poses;
+  TimeDiffSequence timediffs;
+  poses.reserve(pose_vec_.size());
+  timediffs.reserve(timediff_vec_.size());
+  poses.push_back(pose_vec_.front());
+
+  // An interval is a timediff with the pose at its end (it starts at poses.back()). 
+  // The second halves of the split intervals are stacked before the remaining input intervals.
+  typedef std::pair<VertexTimeDiff*, VertexPose*> Interval;
+  std::vector<Interval> pending;
+  int next_input = 0;
+  auto hasNext = [&]() { return !pending.empty() || next_input < num_input_timediffs; };
+  auto nextTimeDiff = [&]() { return pending.empty() ? timediff_vec_[next_input] : pending.back().first; };
+  auto popNext = [&]() 
+  {
+    if (!pending.empty())
+    {
+      Interval interval = pending.back();
+      pending.pop_back();
+      return interval;
+    }
+    Interval interval(timediff_vec_[next_input], pose_vec_[next_input+1]);
+    ++next_input;
+    return interval;
+  };
+
+  int num_timediffs = num_input_timediffs; // current number of timediffs of the resized trajectory
+  bool modified = false;
+  Interval current = popNext();
+  while (true)
+  {
+    double& dt = current.first->dt();
+    if (dt > dt_ref + dt_hysteresis && num_timediffs < max_samples)
     {
-      if(TimeDiff(i) > dt_ref + dt_hysteresis && sizeTimeDiffs()<max_samples)
+      // Force the planner to have equal timediffs between poses (dt_ref +/- dt_hyteresis).
+      if (dt > 2*dt_ref)
       {
-          // Force the planner to have equal timediffs between poses (dt_ref +/- dt_hyteresis).
-          // (new behaviour)
-          if (TimeDiff(i) > 2*dt_ref) 
-          {
-              double newtime = 0.5*TimeDiff(i);
-
-              TimeDiff(i) = newtime;
-              insertPose(i+1, PoseSE2::average(Pose(i),Pose(i+1)) );
-              insertTimeDiff(i+1,newtime);
-
-              i--; // check the updated pose diff again
-              modified = true;
-          } 
-          else 
-          {
-              if (i < sizeTimeDiffs() - 1) 
-              {
-                  timediffs().at(i+1)->dt()+= timediffs().at(i)->dt() - dt_ref;
-              }
-              timediffs().at(i)->dt() = dt_ref;
-          }
+        // split the interval at the average pose, the first half is checked again
+        dt *= 0.5;
+        pending.push_back(Interval(new VertexTimeDiff(dt), current.second));
+        current.second = new VertexPose(PoseSE2::average(poses.back()->pose(), current.second->pose()));
+        ++num_timediffs;
+        modified = true;
+        continue;
       }
-      else if(TimeDiff(i) < dt_ref - dt_hysteresis && sizeTimeDiffs()>min_samples) // only remove samples if size is larger than min_samples.
+      // shift the exceeding time to the next interval (if any)
+      if (hasNext())
+        nextTimeDiff()->dt() += dt - dt_ref;
+      dt = dt_ref;
+    }
+    else if (dt < dt_ref - dt_hysteresis && num_timediffs > min_samples) // only remove samples if size is larger than min_samples.
+    {
+      if (hasNext())
       {
-        //ROS_DEBUG("teb_local_planner: autoResize() deleting bandpoint i=%u, #TimeDiffs=%lu",i,sizeTimeDiffs());
-
-        if(i < ((int)sizeTimeDiffs()-1))
-        {
-          TimeDiff(i+1) = TimeDiff(i+1) + TimeDiff(i);
-          deleteTimeDiff(i);
-          deletePose(i+1);
-          i--; // check the updated pose diff again
-        }
-        else
-        { // last motion should be adjusted, shift time to the interval before
-          TimeDiff(i-1) += TimeDiff(i);
-          deleteTimeDiff(i);
-          deletePose(i);
-        }
-
+        // merge the interval into the next one, which is checked again
+        Interval next = popNext();
+        next.first->dt() += dt;
+        delete current.first;
+        delete current.second;
+        current = next;
+        --num_timediffs;
         modified = true;
+        continue;
+      }
+      if (!timediffs.empty())
+      { 
+        // last motion should be adjusted, shift time to the interval before (and remove its end pose)
+        timediffs.back()->dt() += dt;
+        delete current.first;
+        delete poses.back();
+        poses.back() = current.second;
+        modified = true;
+        break;
       }
     }
-    if (fast_mode) break;
+
+    timediffs.push_back(current.first);
+    poses.push_back(current.second);
+    if (!hasNext())
+      break;
+    current = popNext();
   }
+
+  pose_vec_.swap(poses);
+  timediff_vec_.swap(timediffs);
+  return modified;
 }
 
 
@@ -452,12 +508,34 @@ bool TimedElasticBand::initTrajectoryToGoal(const std::vector<geometry_msgs::Pos
 }
 
 
-int TimedElasticBand::findClosestTrajectoryPose(const Eigen::Ref<const Eigen::Vector2d>& ref_point, double* distance, int begin_idx) const
+void TimedElasticBand::updatePoseIndex()
+{
+  if (pose_index_valid_)
+    return;
+  pose_index_.build(pose_vec_);
+  pose_index_valid_ = true;
+}
+
+void TimedElasticBand::invalidatePoseIndex()
+{
+  pose_index_valid_ = false;
+}
+
+bool TimedElasticBand::isPoseIndexValid() const
+{
+  return pose_index_valid_ && pose_index_.size() == sizePoses();
+}
+
+
+int TimedElasticBand::findClosestTrajectoryPose(const Eigen::Ref<const Eigen::Vector2d>& ref_point, double* distance, int begin_idx, int hint_idx) const
 {
   int n = sizePoses();
   if (begin_idx < 0 || begin_idx >= n)
     return -1;
 
+  if (isPoseIndexValid())
+    return pose_index_.findClosest(ref_point, distance, begin_idx, hint_idx);
+
   double min_dist_sq = std::numeric_limits<double>::max();
   int min_idx = -1;
   
@@ -480,6 +558,9 @@ int TimedElasticBand::findClosestTrajectoryPose(const Eigen::Ref<const Eigen::Ve
 
 int TimedElasticBand::findClosestTrajectoryPose(const Eigen::Ref<const Eigen::Vector2d>& ref_line_start, const Eigen::Ref<const Eigen::Vector2d>& ref_line_end, double* distance) const
 {
+  if (isPoseIndexValid())
+    return pose_index_.findClosest(ref_line_start, ref_line_end, distance);
+
   double min_dist = std::numeric_limits<double>::max();
   int min_idx = -1;
 
@@ -508,6 +589,9 @@ int TimedElasticBand::findClosestTrajectoryPose(const Point2dContainer& vertices
   else if (vertices.size() == 2)
     return findClosestTrajectoryPose(vertices.front(), vertices.back());
   
+  if (isPoseIndexValid())
+    return pose_index_.findClosest(vertices, distance);
+
   double min_dist = std::numeric_limits<double>::max();
   int min_idx = -1;
 
@@ -557,6 +641,8 @@ void TimedElasticBand::updateAndPruneTEB(boost::optional<const PoseSE2&> new_sta
   // first and simple approach: change only start confs (and virtual start conf for inital velocity)
   // TEST if optimizer can handle this "hard" placement
 
+  invalidatePoseIndex();
+
   if (new_start && sizePoses()>0)
   {    
     // find nearest state (using l2-norm) in order to prune the trajectory
@@ -0,0 +1,262 @@
+/*********************************************************************
+ *
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2016,
+ *  TU Dortmund - Institute of Control Theory and Systems Engineering.
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the institute nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: Luigi Freda
+ * Author: Luigi Freda
+ *********************************************************************/
+
+#include <teb_local_planner/trajectory_pose_index.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace teb_local_planner
+{
+
+const int TrajectoryPoseIndex::kPosesPerLeaf = 8;
+
+namespace
+{
+  // Tolerance on the lower bounds of the boxes: a box is skipped only if it is farther than the best pose by more than this,
+  // so that the rounding errors of the bounds cannot change the result.
+  const double kBoundTolerance = 1e-9;
+} // namespace
+
+
+TrajectoryPoseIndex::TrajectoryPoseIndex() : num_leaves_(0)
+{
+}
+
+void TrajectoryPoseIndex::clear()
+{
+  positions_.clear();
+  box_min_.clear();
+  box_max_.clear();
+  num_leaves_ = 0;
+}
+
+void TrajectoryPoseIndex::build(const std::vector<VertexPose*>& poses)
+{
+  const int n = (int)poses.size();
+  positions_.resize(n);
+  for (int i = 0; i < n; ++i)
+    positions_[i] = poses[i]->position();
+
+  num_leaves_ = 1;
+  while (num_leaves_ * kPosesPerLeaf < n)
+    num_leaves_ *= 2;
+
+  // empty nodes get an inverted box: their lower bound is infinite
+  const double inf = std::numeric_limits<double>::infinity();
+  box_min_.assign(2*num_leaves_, Eigen::Vector2d(inf, inf));
+  box_max_.assign(2*num_leaves_, Eigen::Vector2d(-inf, -inf));
+  for (int i = 0; i < n; ++i)
+  {
+    const int node = num_leaves_ + i / kPosesPerLeaf;
+    box_min_[node] = box_min_[node].cwiseMin(positions_[i]);
+    box_max_[node] = box_max_[node].cwiseMax(positions_[i]);
+  }
+  for (int node = num_leaves_ - 1; node >= 1; --node)
+  {
+    box_min_[node] = box_min_[2*node].cwiseMin(box_min_[2*node+1]);
+    box_max_[node] = box_max_[2*node].cwiseMax(box_max_[2*node+1]);
+  }
+}
+
+template <typename BoxLowerBound, typename PoseCost>
+int TrajectoryPoseIndex::search(int begin_idx, int hint_idx, const BoxLowerBound& box_lower_bound, const PoseCost& pose_cost, double& min_cost) const
+{
+  const int n = size();
+  min_cost = std::numeric_limits<double>::max();
+  int min_idx = -1;
+  if (begin_idx < 0 || begin_idx >= n)
+    return -1;
+
+  // the first pose with the minimum cost wins, as in a linear scan
+  auto update = [&](int i)
+  {
+    const double cost = pose_cost(positions_[i]);
+    if (cost < min_cost || (cost == min_cost && i < min_idx))
+    {
+      min_cost = cost;
+      min_idx = i;
+    }
+  };
+
+  if (hint_idx >= begin_idx && hint_idx < n)
+    update(hint_idx);
+
+  struct Node
+  {
+    int node;
+    int first_leaf; // range of leaves of the node [first_leaf, first_leaf + num_leaves)
+    int num_leaves;
+    double lower_bound;
+  };
+  Node stack[64];
+  int stack_size = 0;
+  stack[stack_size++] = Node{1, 0, num_leaves_, box_lower_bound(box_min_[1], box_max_[1])};
+
+  while (stack_size > 0)
+  {
+    const Node current = stack[--stack_size];
+    if (current.lower_bound > min_cost + kBoundTolerance)
+      continue;
+    if ((current.first_leaf + current.num_leaves) * kPosesPerLeaf <= begin_idx)
+      continue; // all the poses of the node are before begin_idx
+
+    if (current.num_leaves == 1)
+    {
+      const int i_end = std::min(n, (current.first_leaf + 1) * kPosesPerLeaf);
+      for (int i = std::max(begin_idx, current.first_leaf * kPosesPerLeaf); i < i_end; ++i)
+        update(i);
+      continue;
+    }
+
+    const int half = current.num_leaves / 2;
+    Node left{2*current.node, current.first_leaf, half, box_lower_bound(box_min_[2*current.node], box_max_[2*current.node])};
+    Node right{2*current.node+1, current.first_leaf + half, half, box_lower_bound(box_min_[2*current.node+1], box_max_[2*current.node+1])};
+    // visit the nearest child first
+    if (left.lower_bound <= right.lower_bound)
+    {
+      stack[stack_size++] = right;
+      stack[stack_size++] = left;
+    }
+    else
+    {
+      stack[stack_size++] = left;
+      stack[stack_size++] = right;
+    }
+  }
+  return min_idx;
+}
+
+int TrajectoryPoseIndex::findClosest(const Eigen::Vector2d& ref_point, double* distance, int begin_idx, int hint_idx) const
+{
+  double min_dist_sq;
+  const int min_idx = search(begin_idx, hint_idx,
+    [&](const Eigen::Vector2d& box_min, const Eigen::Vector2d& box_max) {return squaredDistancePointToBox(ref_point, box_min, box_max);},
+    [&](const Eigen::Vector2d& position) {return (ref_point - position).squaredNorm();},
+    min_dist_sq);
+  if (min_idx >= 0 && distance)
+    *distance = std::sqrt(min_dist_sq);
+  return min_idx;
+}
+
+int TrajectoryPoseIndex::findClosest(const Eigen::Vector2d& ref_line_start, const Eigen::Vector2d& ref_line_end, double* distance) const
+{
+  double min_dist;
+  const int min_idx = search(0, -1,
+    [&](const Eigen::Vector2d& box_min, const Eigen::Vector2d& box_max) {return distanceSegmentToBox(ref_line_start, ref_line_end, box_min, box_max);},
+    [&](const Eigen::Vector2d& position) {return distance_point_to_segment_2d(position, ref_line_start, ref_line_end);},
+    min_dist);
+  if (distance)
+    *distance = min_dist;
+  return min_idx;
+}
+
+int TrajectoryPoseIndex::findClosest(const Point2dContainer& vertices, double* distance) const
+{
+  double min_dist;
+  const int min_idx = search(0, -1,
+    [&](const Eigen::Vector2d& box_min, const Eigen::Vector2d& box_max) 
+    {
+      double bound = distanceSegmentToBox(vertices.back(), vertices.front(), box_min, box_max);
+      for (int j = 0; j < (int) vertices.size()-1; ++j)
+        bound = std::min(bound, distanceSegmentToBox(vertices[j], vertices[j+1], box_min, box_max));
+      return bound;
+    },
+    [&](const Eigen::Vector2d& position) 
+    {
+      // same as the linear scan of TimedElasticBand::findClosestTrajectoryPose()
+      double dist_to_polygon = std::numeric_limits<double>::max();
+      for (int j = 0; j < (int) vertices.size()-1; ++j)
+        dist_to_polygon = std::min(dist_to_polygon, distance_point_to_segment_2d(position, vertices[j], vertices[j+1]));
+      return std::min(dist_to_polygon, distance_point_to_segment_2d(position, vertices.back(), vertices.front()));
+    },
+    min_dist);
+  if (distance)
+    *distance = min_dist;
+  return min_idx;
+}
+
+double TrajectoryPoseIndex::squaredDistancePointToBox(const Eigen::Vector2d& point, const Eigen::Vector2d& box_min, const Eigen::Vector2d& box_max)
+{
+  if (box_min.x() > box_max.x())
+    return std::numeric_limits<double>::infinity(); // empty box
+  const double dx = std::max(0., std::max(box_min.x() - point.x(), point.x() - box_max.x()));
+  const double dy = std::max(0., std::max(box_min.y() - point.y(), point.y() - box_max.y()));
+  return dx*dx + dy*dy;
+}
+
+double TrajectoryPoseIndex::distanceSegmentToBox(const Eigen::Vector2d& line_start, const Eigen::Vector2d& line_end, const Eigen::Vector2d& box_min, const Eigen::Vector2d& box_max)
+{
+  if (box_min.x() > box_max.x())
+    return std::numeric_limits<double>::infinity(); // empty box
+
+  // clip the segment against the box (Liang-Barsky): if a part of it is inside, the distance is zero
+  const Eigen::Vector2d dir = line_end - line_start;
+  double t_min = 0, t_max = 1;
+  bool inside = true;
+  for (int k = 0; k < 2 && inside; ++k)
+  {
+    if (dir[k] == 0)
+    {
+      inside = line_start[k] >= box_min[k] && line_start[k] <= box_max[k];
+      continue;
+    }
+    double t0 = (box_min[k] - line_start[k]) / dir[k];
+    double t1 = (box_max[k] - line_start[k]) / dir[k];
+    if (t0 > t1)
+      std::swap(t0, t1);
+    t_min = std::max(t_min, t0);
+    t_max = std::min(t_max, t1);
+    inside = t_min <= t_max;
+  }
+  if (inside)
+    return 0;
+
+  // disjoint convex sets: the distance is attained at a vertex of one of them
+  double dist = std::min(std::sqrt(squaredDistancePointToBox(line_start, box_min, box_max)), 
+                         std::sqrt(squaredDistancePointToBox(line_end, box_min, box_max)));
+  dist = std::min(dist, distance_point_to_segment_2d(box_min, line_start, line_end));
+  dist = std::min(dist, distance_point_to_segment_2d(box_max, line_start, line_end));
+  dist = std::min(dist, distance_point_to_segment_2d(Eigen::Vector2d(box_min.x(), box_max.y()), line_start, line_end));
+  dist = std::min(dist, distance_point_to_segment_2d(Eigen::Vector2d(box_max.x(), box_min.y()), line_start, line_end));
+  return dist;
+}
+
+} // namespace teb_local_planner
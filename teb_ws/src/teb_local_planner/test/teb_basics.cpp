@@ -66,6 +66,91 @@ TEST(TEBBasic, autoResize)
   }
 }
 
+TEST(TEBBasic, autoResizeLongTrajectory)
+{
+  double dt = 0.1;
+  double dt_hysteresis = dt/3.;
+  teb_local_planner::TimedElasticBand teb;
+  
+  teb.addPose(teb_local_planner::PoseSE2(0., 0., 0.));
+  for (int i = 1; i <= 500; ++i) {
+    // alternate too coarse and too fine timediffs
+    teb.addPoseAndTimeDiff(teb_local_planner::PoseSE2(i * 1., 0., 0.), (i % 2) ? 5*dt : 0.2*dt);
+  }
+
+  // auto resize + test of the result
+  teb.autoResize(dt, dt_hysteresis, 3, 5000, false);
+  ASSERT_LE(teb.sizeTimeDiffs(), 5000);
+  ASSERT_EQ(teb.sizeTimeDiffs() + 1, teb.sizePoses());
+  ASSERT_DOUBLE_EQ(teb.Pose(0).x(), 0.);
+  ASSERT_DOUBLE_EQ(teb.BackPose().x(), 500.);
+  for (int i = 0; i < teb.sizeTimeDiffs(); ++i) {
+    ASSERT_LE(teb.TimeDiff(i), dt + dt_hysteresis + 1e-3) << "dt is greater than allowed: " << i;
+    ASSERT_LE(dt - dt_hysteresis - 1e-3, teb.TimeDiff(i)) << "dt is less than allowed: " << i;
+  }
+  for (int i = 1; i < teb.sizePoses(); ++i) {
+    ASSERT_LE(teb.Pose(i-1).x(), teb.Pose(i).x()) << "poses are not ordered: " << i;
+  }
+}
+
+TEST(TEBBasic, findClosestTrajectoryPoseIndexed)
+{
+  teb_local_planner::TimedElasticBand teb;
+  
+  // spiral with a few coincident poses
+  for (int i = 0; i < 300; ++i) {
+    double angle = 0.05 * (i - i % 7);
+    teb.addPose(teb_local_planner::PoseSE2(0.02 * i * std::cos(angle), 0.02 * i * std::sin(angle), angle));
+  }
+
+  teb_local_planner::Point2dContainer polygon;
+  polygon.push_back(Eigen::Vector2d(0.5, 0.5));
+  polygon.push_back(Eigen::Vector2d(2.5, 1.));
+  polygon.push_back(Eigen::Vector2d(1., 2.5));
+
+  std::vector<Eigen::Vector2d> points;
+  for (double x = -7.; x <= 7.; x += 0.7)
+    for (double y = -7.; y <= 7.; y += 0.9)
+      points.push_back(Eigen::Vector2d(x, y));
+
+  // linear scans
+  std::vector<int> point_idx, line_idx, polygon_idx;
+  std::vector<double> point_dist, line_dist, polygon_dist;
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    double dist;
+    point_idx.push_back(teb.findClosestTrajectoryPose(points[i], &dist, i % 50));
+    point_dist.push_back(dist);
+    line_idx.push_back(teb.findClosestTrajectoryPose(points[i], points[(i * 7) % points.size()], &dist));
+    line_dist.push_back(dist);
+    teb_local_planner::Point2dContainer moved_polygon = polygon;
+    for (std::size_t j = 0; j < moved_polygon.size(); ++j)
+      moved_polygon[j] += points[i];
+    polygon_idx.push_back(teb.findClosestTrajectoryPose(moved_polygon, &dist));
+    polygon_dist.push_back(dist);
+  }
+
+  // indexed queries
+  teb.updatePoseIndex();
+  ASSERT_TRUE(teb.isPoseIndexValid());
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    double dist;
+    ASSERT_EQ(point_idx[i], teb.findClosestTrajectoryPose(points[i], &dist, i % 50, (i * 13) % 300)) << "point " << i;
+    ASSERT_DOUBLE_EQ(point_dist[i], dist);
+    ASSERT_EQ(line_idx[i], teb.findClosestTrajectoryPose(points[i], points[(i * 7) % points.size()], &dist)) << "line " << i;
+    ASSERT_DOUBLE_EQ(line_dist[i], dist);
+    teb_local_planner::Point2dContainer moved_polygon = polygon;
+    for (std::size_t j = 0; j < moved_polygon.size(); ++j)
+      moved_polygon[j] += points[i];
+    ASSERT_EQ(polygon_idx[i], teb.findClosestTrajectoryPose(moved_polygon, &dist)) << "polygon " << i;
+    ASSERT_DOUBLE_EQ(polygon_dist[i], dist);
+  }
+
+  // the index is invalidated by the changes of the pose sequence
+  teb.addPose(teb_local_planner::PoseSE2(100., 100., 0.));
+  ASSERT_FALSE(teb.isPoseIndexValid());
+  ASSERT_EQ(teb.sizePoses() - 1, teb.findClosestTrajectoryPose(Eigen::Vector2d(99., 99.)));
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);